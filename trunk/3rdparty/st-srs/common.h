@@ -195,6 +195,8 @@ struct _st_thread {
     _st_thread_t *right;          /* -- see docs/timeout_heap.txt for details */
     int heap_index;
 
+    st_utime_t runq_at;         /* The time when put on run queue, if runq_stamp is on */
+
     void **private_data;        /* Per thread private data */
 
     _st_cond_t *term;           /* Termination condition variable for join */
@@ -250,6 +252,7 @@ typedef struct _st_vp {
     st_switch_cb_t switch_out_cb;    /* called when a thread is switched out */
     st_switch_cb_t switch_in_cb;    /* called when a thread is switched in */
 #endif
+    int runq_stamp;             /* Whether stamp the time when put thread on run queue */
 } _st_vp_t;
 
 
@@ -271,6 +274,11 @@ extern _st_vp_t        _st_this_vp;
 extern _st_thread_t *_st_this_thread;
 extern _st_eventsys_t *_st_eventsys;
 
+#ifdef MD_HAVE_IO_URING
+extern int _st_uring_write_enabled;
+ssize_t _st_uring_writev(int osfd, const struct iovec *iov, int iov_cnt, st_utime_t timeout);
+#endif
+
 #define _ST_CURRENT_THREAD()            (_st_this_thread)
 #define _ST_SET_CURRENT_THREAD(_thread) (_st_this_thread = (_thread))
 
@@ -298,7 +306,11 @@ extern _st_eventsys_t *_st_eventsys;
 #define _ST_ADD_IOQ(_pq)    ST_APPEND_LINK(&_pq.links, &_ST_IOQ)
 #define _ST_DEL_IOQ(_pq)    ST_REMOVE_LINK(&_pq.links)
 
-#define _ST_ADD_RUNQ(_thr)  ST_APPEND_LINK(&(_thr)->links, &_ST_RUNQ)
+#define _ST_ADD_RUNQ(_thr)  \
+    ST_BEGIN_MACRO          \
+    if (_st_this_vp.runq_stamp) (_thr)->runq_at = st_utime(); \
+    ST_APPEND_LINK(&(_thr)->links, &_ST_RUNQ); \
+    ST_END_MACRO
 #define _ST_DEL_RUNQ(_thr)  ST_REMOVE_LINK(&(_thr)->links)
 
 #define _ST_ADD_SLEEPQ(_thr, _timeout)  _st_add_sleep_q(_thr, _timeout)
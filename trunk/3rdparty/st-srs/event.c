@@ -46,6 +46,13 @@
 #ifdef MD_HAVE_EPOLL
 #include <sys/epoll.h>
 #endif
+#ifdef MD_HAVE_IO_URING
+#include <stdint.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
 
 #if defined(USE_POLL) && !defined(MD_HAVE_POLL)
     /* Force poll usage if explicitly asked for it */
@@ -1358,6 +1365,645 @@ static _st_eventsys_t _st_epoll_eventsys = {
 #endif  /* MD_HAVE_EPOLL */
 
 
+#if defined (MD_HAVE_IO_URING) && defined (MD_HAVE_EPOLL)
+/*****************************************
+ * io_uring event system
+ *
+ * The readiness of descriptors is polled by one-shot IORING_OP_POLL_ADD, and the
+ * writes are IORING_OP_WRITEV if enabled. The SQEs are only queued when coroutine
+ * waits, and submitted in batch with the wait for completions by one syscall when
+ * the vp is idle, so there is no syscall per poll like the epoll_ctl of epoll.
+ * Fall back to epoll if the io_uring is not supported by kernel.
+ */
+
+#ifndef ST_URING_ENTRIES
+    #define ST_URING_ENTRIES 4096
+#endif
+
+/* The slot of a SQE, the user_data of SQE is the index of slot plus 1, 0 is ignored. */
+#define _ST_URING_SLOT_FREE 0
+#define _ST_URING_SLOT_POLL 1  /* Polling for a pollfd. */
+#define _ST_URING_SLOT_DEAD 2  /* Poll removed, wait for its CQE. */
+#define _ST_URING_SLOT_WRITE 3 /* Writing for a coroutine. */
+
+typedef struct _st_uring_op {
+    _st_thread_t *thread;
+    int res;
+    int done;
+} _st_uring_op_t;
+
+typedef struct _st_uring_slot {
+    int type;
+    int fd;
+    /* The list of poll slots of fd, or the free list. */
+    int prev;
+    int next;
+    struct pollfd *pd;
+    _st_uring_op_t *op;
+} _st_uring_slot_t;
+
+static struct _st_uringdata {
+    int ring_fd;
+    unsigned entries;
+    /* The SQ and CQ rings mapped from kernel. */
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, *sq_flags;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* The slots of SQE and the free list. */
+    _st_uring_slot_t *slots;
+    int nn_slots;
+    int free_slot;
+    /* The head of poll slots for each fd. */
+    int *fd_slots;
+    int fd_slots_size;
+    int pid;
+} *_st_uring_data;
+
+/* Whether write by IORING_OP_WRITEV, @see st_uring_set_write */
+int _st_uring_write_enabled = 0;
+static int _st_uring_entries = ST_URING_ENTRIES;
+
+static int _st_uring_setup(void)
+{
+    struct io_uring_params p;
+    struct _st_uringdata *d = _st_uring_data;
+    size_t size;
+
+    memset(&p, 0, sizeof(p));
+#ifdef IORING_SETUP_SUBMIT_ALL
+    p.flags = IORING_SETUP_SUBMIT_ALL;
+#endif
+    d->ring_fd = (int) syscall(__NR_io_uring_setup, d->entries, &p);
+#ifdef IORING_SETUP_SUBMIT_ALL
+    if (d->ring_fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        d->ring_fd = (int) syscall(__NR_io_uring_setup, d->entries, &p);
+    }
+#endif
+    if (d->ring_fd < 0)
+        return -1;
+
+    /* Never drop CQE when overflow, and wait with timeout by EXT_ARG. */
+    if (!(p.features & IORING_FEAT_NODROP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+        close(d->ring_fd);
+        d->ring_fd = -1;
+        errno = ENOSYS;
+        return -1;
+    }
+
+    d->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    d->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        size = d->sq_ring_size > d->cq_ring_size ? d->sq_ring_size : d->cq_ring_size;
+        d->sq_ring_size = d->cq_ring_size = size;
+    }
+
+    d->sq_ring = mmap(NULL, d->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d->ring_fd, IORING_OFF_SQ_RING);
+    if (d->sq_ring == MAP_FAILED)
+        goto failed;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        d->cq_ring = d->sq_ring;
+    } else {
+        d->cq_ring = mmap(NULL, d->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d->ring_fd, IORING_OFF_CQ_RING);
+        if (d->cq_ring == MAP_FAILED) {
+            munmap(d->sq_ring, d->sq_ring_size);
+            goto failed;
+        }
+    }
+    d->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    d->sqes = (struct io_uring_sqe *) mmap(NULL, d->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d->ring_fd, IORING_OFF_SQES);
+    if (d->sqes == MAP_FAILED) {
+        if (d->cq_ring != d->sq_ring)
+            munmap(d->cq_ring, d->cq_ring_size);
+        munmap(d->sq_ring, d->sq_ring_size);
+        goto failed;
+    }
+
+    d->sq_head = (unsigned *) ((char *) d->sq_ring + p.sq_off.head);
+    d->sq_tail = (unsigned *) ((char *) d->sq_ring + p.sq_off.tail);
+    d->sq_mask = (unsigned *) ((char *) d->sq_ring + p.sq_off.ring_mask);
+    d->sq_array = (unsigned *) ((char *) d->sq_ring + p.sq_off.array);
+    d->sq_flags = (unsigned *) ((char *) d->sq_ring + p.sq_off.flags);
+    d->cq_head = (unsigned *) ((char *) d->cq_ring + p.cq_off.head);
+    d->cq_tail = (unsigned *) ((char *) d->cq_ring + p.cq_off.tail);
+    d->cq_mask = (unsigned *) ((char *) d->cq_ring + p.cq_off.ring_mask);
+    d->cqes = (struct io_uring_cqe *) ((char *) d->cq_ring + p.cq_off.cqes);
+    d->entries = p.sq_entries;
+    d->pid = getpid();
+
+    return 0;
+
+ failed:
+    close(d->ring_fd);
+    d->ring_fd = -1;
+    return -1;
+}
+
+static void _st_uring_teardown(void)
+{
+    struct _st_uringdata *d = _st_uring_data;
+
+    munmap(d->sqes, d->sqes_size);
+    if (d->cq_ring != d->sq_ring)
+        munmap(d->cq_ring, d->cq_ring_size);
+    munmap(d->sq_ring, d->sq_ring_size);
+    close(d->ring_fd);
+    d->ring_fd = -1;
+}
+
+ST_HIDDEN int _st_uring_init(void)
+{
+    _st_uring_data = (struct _st_uringdata *) calloc(1, sizeof(*_st_uring_data));
+    if (!_st_uring_data)
+        return -1;
+
+    _st_uring_data->entries = (unsigned) _st_uring_entries;
+    _st_uring_data->free_slot = -1;
+    if (_st_uring_setup() < 0) {
+        free(_st_uring_data);
+        _st_uring_data = NULL;
+
+        /* Fall back to epoll, for example, the io_uring is disabled by kernel. */
+        _st_uring_write_enabled = 0;
+        _st_eventsys = &_st_epoll_eventsys;
+        return _st_epoll_init();
+    }
+
+    return 0;
+}
+
+/* Submit the queued SQEs, and wait for nn completions with timeout in us, -1 for ever. */
+static int _st_uring_enter(unsigned nn, int timeout)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned flags, to_submit;
+    int r0;
+
+    to_submit = *d->sq_tail - *d->sq_head;
+    flags = 0;
+    if (nn || (*d->sq_flags & IORING_SQ_CQ_OVERFLOW))
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+
+    memset(&arg, 0, sizeof(arg));
+    if (timeout >= 0) {
+        ts.tv_sec = timeout / 1000000;
+        ts.tv_nsec = (timeout % 1000000) * 1000;
+        arg.ts = (unsigned long long) (uintptr_t) &ts;
+    }
+
+    r0 = (int) syscall(__NR_io_uring_enter, d->ring_fd, to_submit, nn, flags, &arg, sizeof(arg));
+    if (r0 < 0 && (errno == ETIME || errno == EINTR))
+        r0 = 0;
+    return r0;
+}
+
+static struct io_uring_sqe *_st_uring_get_sqe(void)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    struct io_uring_sqe *sqe;
+    unsigned tail, index;
+
+    /* The SQ is full, submit them without wait. */
+    tail = *d->sq_tail;
+    if (tail - __atomic_load_n(d->sq_head, __ATOMIC_ACQUIRE) >= d->entries) {
+        if (_st_uring_enter(0, 0) < 0 && errno != EBUSY && errno != EAGAIN)
+            return NULL;
+        if (tail - __atomic_load_n(d->sq_head, __ATOMIC_ACQUIRE) >= d->entries) {
+            errno = EAGAIN;
+            return NULL;
+        }
+    }
+
+    index = tail & *d->sq_mask;
+    sqe = &d->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    d->sq_array[index] = index;
+    __atomic_store_n(d->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+static int _st_uring_slot_new(int type, int fd)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    _st_uring_slot_t *ptr;
+    int i, n;
+
+    if (d->free_slot < 0) {
+        n = d->nn_slots ? d->nn_slots * 2 : 1024;
+        ptr = (_st_uring_slot_t *) realloc(d->slots, n * sizeof(_st_uring_slot_t));
+        if (!ptr)
+            return -1;
+        for (i = n - 1; i >= d->nn_slots; i--) {
+            ptr[i].type = _ST_URING_SLOT_FREE;
+            ptr[i].next = d->free_slot;
+            d->free_slot = i;
+        }
+        d->slots = ptr;
+        d->nn_slots = n;
+    }
+
+    i = d->free_slot;
+    d->free_slot = d->slots[i].next;
+    d->slots[i].type = type;
+    d->slots[i].fd = fd;
+    d->slots[i].prev = d->slots[i].next = -1;
+    d->slots[i].pd = NULL;
+    d->slots[i].op = NULL;
+
+    return i;
+}
+
+static void _st_uring_slot_free(int i)
+{
+    struct _st_uringdata *d = _st_uring_data;
+
+    d->slots[i].type = _ST_URING_SLOT_FREE;
+    d->slots[i].next = d->free_slot;
+    d->free_slot = i;
+}
+
+static void _st_uring_slot_unlink(int i)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    _st_uring_slot_t *s = &d->slots[i];
+
+    if (s->prev >= 0)
+        d->slots[s->prev].next = s->next;
+    else
+        d->fd_slots[s->fd] = s->next;
+    if (s->next >= 0)
+        d->slots[s->next].prev = s->prev;
+    s->prev = s->next = -1;
+}
+
+ST_HIDDEN int _st_uring_fd_expand(int maxfd)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    int *ptr;
+    int i, n = d->fd_slots_size ? d->fd_slots_size : 1024;
+
+    while (maxfd >= n)
+        n <<= 1;
+
+    ptr = (int *) realloc(d->fd_slots, n * sizeof(int));
+    if (!ptr)
+        return -1;
+    for (i = d->fd_slots_size; i < n; i++)
+        ptr[i] = -1;
+
+    d->fd_slots = ptr;
+    d->fd_slots_size = n;
+
+    return 0;
+}
+
+static int _st_uring_poll_add(int i)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    _st_uring_slot_t *s = &d->slots[i];
+    struct io_uring_sqe *sqe;
+    unsigned events;
+
+    if ((sqe = _st_uring_get_sqe()) == NULL)
+        return -1;
+
+    events = (unsigned) s->pd->events;
+#if __BYTE_ORDER == __BIG_ENDIAN
+    events = (events << 16) | (events >> 16);
+#endif
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = s->fd;
+    sqe->poll32_events = events;
+    sqe->user_data = (unsigned long long) i + 1;
+
+    return 0;
+}
+
+ST_HIDDEN void _st_uring_pollset_del(struct pollfd *pds, int npds)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    struct io_uring_sqe *sqe;
+    struct pollfd *pd;
+    struct pollfd *epd = pds + npds;
+    int i;
+
+    for (pd = pds; pd < epd; pd++) {
+        if (pd->fd < 0 || pd->fd >= d->fd_slots_size)
+            continue;
+
+        /* The fired poll is already removed. */
+        for (i = d->fd_slots[pd->fd]; i >= 0; i = d->slots[i].next) {
+            if (d->slots[i].pd == pd)
+                break;
+        }
+        if (i < 0)
+            continue;
+
+        /* Keep the slot until its CQE, so the user_data is never reused before it. */
+        _st_uring_slot_unlink(i);
+        d->slots[i].type = _ST_URING_SLOT_DEAD;
+        d->slots[i].pd = NULL;
+
+        /* It's OK if failed, the poll will fire and be ignored. */
+        if ((sqe = _st_uring_get_sqe()) != NULL) {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->addr = (unsigned long long) i + 1;
+            sqe->user_data = 0;
+        }
+    }
+}
+
+ST_HIDDEN int _st_uring_pollset_add(struct pollfd *pds, int npds)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    _st_uring_slot_t *s;
+    int i, k, fd;
+
+    /* Do as many checks as possible up front */
+    for (k = 0; k < npds; k++) {
+        fd = pds[k].fd;
+        if (fd < 0 || !pds[k].events ||
+            (pds[k].events & ~(POLLIN | POLLOUT | POLLPRI))) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (fd >= d->fd_slots_size && _st_uring_fd_expand(fd) < 0)
+            return -1;
+    }
+
+    for (k = 0; k < npds; k++) {
+        fd = pds[k].fd;
+        pds[k].revents = 0;
+
+        if ((i = _st_uring_slot_new(_ST_URING_SLOT_POLL, fd)) < 0)
+            break;
+        s = &d->slots[i];
+        s->pd = &pds[k];
+        if ((s->next = d->fd_slots[fd]) >= 0)
+            d->slots[s->next].prev = i;
+        d->fd_slots[fd] = i;
+
+        if (_st_uring_poll_add(i) < 0) {
+            _st_uring_slot_unlink(i);
+            _st_uring_slot_free(i);
+            break;
+        }
+    }
+
+    if (k < npds) {
+        /* Error */
+        int err = errno;
+        /* Unroll the state */
+        _st_uring_pollset_del(pds, k);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void _st_uring_wakeup(_st_thread_t *thread)
+{
+    if (thread->state != _ST_ST_IO_WAIT)
+        return;
+
+    if (thread->flags & _ST_FL_ON_SLEEPQ)
+        _ST_DEL_SLEEPQ(thread);
+    thread->state = _ST_ST_RUNNABLE;
+    _ST_ADD_RUNQ(thread);
+}
+
+/* Reap the CQEs, set the revents of pollfd or the result of write, return the number of polls fired. */
+static int _st_uring_reap(void)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    struct io_uring_cqe *cqe;
+    _st_uring_slot_t *s;
+    unsigned head, tail;
+    int i, nn = 0;
+
+    head = *d->cq_head;
+    tail = __atomic_load_n(d->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        cqe = &d->cqes[head & *d->cq_mask];
+        if (cqe->user_data == 0 || cqe->user_data > (unsigned long long) d->nn_slots)
+            continue;
+
+        i = (int) cqe->user_data - 1;
+        s = &d->slots[i];
+        if (s->type == _ST_URING_SLOT_POLL) {
+            if (cqe->res >= 0)
+                s->pd->revents = (short) (cqe->res & (s->pd->events | POLLERR | POLLHUP | POLLNVAL));
+            else
+                s->pd->revents = (cqe->res == -EBADF) ? POLLNVAL : POLLERR;
+            _st_uring_slot_unlink(i);
+            _st_uring_slot_free(i);
+            nn++;
+        } else if (s->type == _ST_URING_SLOT_DEAD) {
+            _st_uring_slot_free(i);
+        } else if (s->type == _ST_URING_SLOT_WRITE) {
+            s->op->res = cqe->res;
+            s->op->done = 1;
+            _st_uring_wakeup(s->op->thread);
+            _st_uring_slot_free(i);
+        }
+    }
+    __atomic_store_n(d->cq_head, head, __ATOMIC_RELEASE);
+
+    return nn;
+}
+
+/* We probably forked, the ring is shared with parent, so create a new one and add the polls again. */
+static void _st_uring_refork(void)
+{
+    struct _st_uringdata *d = _st_uring_data;
+    _st_uring_slot_t *s;
+    int i;
+
+    _st_uring_teardown();
+    if (_st_uring_setup() < 0) {
+        /* There is nothing we can do here, will retry later */
+        return;
+    }
+
+    for (i = 0; i < d->nn_slots; i++) {
+        s = &d->slots[i];
+        if (s->type == _ST_URING_SLOT_POLL) {
+            _st_uring_poll_add(i);
+        } else if (s->type == _ST_URING_SLOT_DEAD) {
+            _st_uring_slot_free(i);
+        } else if (s->type == _ST_URING_SLOT_WRITE) {
+            s->op->res = -ECANCELED;
+            s->op->done = 1;
+            _st_uring_wakeup(s->op->thread);
+            _st_uring_slot_free(i);
+        }
+    }
+}
+
+ST_HIDDEN void _st_uring_dispatch(void)
+{
+    st_utime_t min_timeout;
+    _st_clist_t *q;
+    _st_pollq_t *pq;
+    struct pollfd *pds, *epds;
+    int timeout, notify;
+
+    if (_ST_SLEEPQ == NULL) {
+        timeout = -1;
+    } else {
+        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 : (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        timeout = (int) (min_timeout > 0x7fffffff ? 0x7fffffff : min_timeout);
+    }
+
+    if (_st_uring_data->pid != getpid())
+        _st_uring_refork();
+    if (_st_uring_data->ring_fd < 0)
+        return;
+
+    /* Submit all queued SQEs of this tick, and wait for I/O operations by one syscall. */
+    _st_uring_enter(timeout ? 1 : 0, timeout);
+
+    if (_st_uring_reap() > 0) {
+        for (q = _ST_IOQ.next; q != &_ST_IOQ; q = q->next) {
+            pq = _ST_POLLQUEUE_PTR(q);
+            notify = 0;
+            epds = pq->pds + pq->npds;
+
+            for (pds = pq->pds; pds < epds; pds++) {
+                if (pds->revents) {
+                    notify = 1;
+                    break;
+                }
+            }
+            if (notify) {
+                ST_REMOVE_LINK(&pq->links);
+                pq->on_ioq = 0;
+                /* Remove the polls that didn't fire. */
+                _st_uring_pollset_del(pq->pds, pq->npds);
+
+                if (pq->thread->flags & _ST_FL_ON_SLEEPQ)
+                    _ST_DEL_SLEEPQ(pq->thread);
+                pq->thread->state = _ST_ST_RUNNABLE;
+                _ST_ADD_RUNQ(pq->thread);
+            }
+        }
+    }
+}
+
+ST_HIDDEN int _st_uring_fd_new(int osfd)
+{
+    if (osfd >= _st_uring_data->fd_slots_size && _st_uring_fd_expand(osfd) < 0)
+        return -1;
+
+    return 0;
+}
+
+ST_HIDDEN int _st_uring_fd_close(int osfd)
+{
+    if (osfd < _st_uring_data->fd_slots_size && _st_uring_data->fd_slots[osfd] >= 0) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    return 0;
+}
+
+ST_HIDDEN int _st_uring_fd_getlimit(void)
+{
+    /* zero means no specific limit */
+    return 0;
+}
+
+/*
+ * Write the iov by IORING_OP_WRITEV, which is submitted in batch when vp is idle.
+ * Return the bytes written, or -1 with errno, EAGAIN if the socket is not ready.
+ */
+ssize_t _st_uring_writev(int osfd, const struct iovec *iov, int iov_cnt, st_utime_t timeout)
+{
+    struct io_uring_sqe *sqe;
+    _st_uring_op_t op;
+    _st_thread_t *me = _ST_CURRENT_THREAD();
+    int i, err;
+
+    if (me->flags & _ST_FL_INTERRUPT) {
+        me->flags &= ~_ST_FL_INTERRUPT;
+        errno = EINTR;
+        return -1;
+    }
+
+    if ((i = _st_uring_slot_new(_ST_URING_SLOT_WRITE, osfd)) < 0)
+        return -1;
+    if ((sqe = _st_uring_get_sqe()) == NULL) {
+        _st_uring_slot_free(i);
+        return -1;
+    }
+
+    op.thread = me;
+    op.res = 0;
+    op.done = 0;
+    _st_uring_data->slots[i].op = &op;
+
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = osfd;
+    sqe->addr = (unsigned long long) (uintptr_t) iov;
+    sqe->len = (unsigned) iov_cnt;
+    sqe->off = (unsigned long long) -1;
+    sqe->user_data = (unsigned long long) i + 1;
+
+    if (timeout != ST_UTIME_NO_TIMEOUT)
+        _ST_ADD_SLEEPQ(me, timeout);
+    me->state = _ST_ST_IO_WAIT;
+    _ST_SWITCH_CONTEXT(me);
+
+    if (!op.done) {
+        /* Timeout or interrupted, cancel it and wait for done, because the iov is used by kernel. */
+        err = (me->flags & _ST_FL_INTERRUPT) ? EINTR : ETIME;
+        if ((sqe = _st_uring_get_sqe()) != NULL) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = (unsigned long long) i + 1;
+            sqe->user_data = 0;
+        }
+        while (!op.done) {
+            me->state = _ST_ST_IO_WAIT;
+            _ST_SWITCH_CONTEXT(me);
+        }
+        me->flags &= ~_ST_FL_INTERRUPT;
+        errno = err;
+        return -1;
+    }
+
+    if (op.res < 0) {
+        errno = -op.res;
+        return -1;
+    }
+
+    return op.res;
+}
+
+static _st_eventsys_t _st_uring_eventsys = {
+    "io_uring",
+    ST_EVENTSYS_IO_URING,
+    _st_uring_init,
+    _st_uring_dispatch,
+    _st_uring_pollset_add,
+    _st_uring_pollset_del,
+    _st_uring_fd_new,
+    _st_uring_fd_close,
+    _st_uring_fd_getlimit
+};
+#endif  /* MD_HAVE_IO_URING */
+
+
 /*****************************************
  * Public functions
  */
@@ -1393,6 +2039,11 @@ int st_set_eventsys(int eventsys)
             _st_eventsys = &_st_epoll_eventsys;
 #endif
         break;
+#if defined (MD_HAVE_IO_URING) && defined (MD_HAVE_EPOLL)
+    case ST_EVENTSYS_IO_URING:
+        _st_eventsys = &_st_uring_eventsys;
+        break;
+#endif
     default:
         errno = EINVAL;
         return -1;
@@ -1411,3 +2062,21 @@ const char *st_get_eventsys_name(void)
     return _st_eventsys ? _st_eventsys->name : "";
 }
 
+int st_uring_set(int entries, int write)
+{
+#if defined (MD_HAVE_IO_URING) && defined (MD_HAVE_EPOLL)
+    if (_st_eventsys) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    if (entries > 0)
+        _st_uring_entries = entries;
+    _st_uring_write_enabled = write;
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
@@ -555,6 +555,26 @@ ssize_t st_write(_st_netfd_t *fd, const void *buf, size_t nbyte, st_utime_t time
 }
 
 
+#ifndef MD_HAVE_IO_URING
+    #define _st_uring_write_enabled 0
+#endif
+
+/*
+ * Write once, by IORING_OP_WRITEV and wait for it if enabled, which returns EINTR
+ * when thread is interrupted, so never retry EINTR for it.
+ */
+static ssize_t _st_writev_once(_st_netfd_t *fd, const struct iovec *iov, int iov_cnt, st_utime_t timeout)
+{
+#ifdef MD_HAVE_IO_URING
+    if (_st_uring_write_enabled)
+        return _st_uring_writev(fd->osfd, iov, iov_cnt, timeout);
+#endif
+    if (iov_cnt == 1)
+        return write(fd->osfd, iov->iov_base, iov->iov_len);
+    return writev(fd->osfd, iov, iov_cnt);
+}
+
+
 ssize_t st_writev(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_utime_t timeout)
 {
     ssize_t n, rv;
@@ -579,8 +599,8 @@ ssize_t st_writev(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_uti
                 rv = -1;
             break;
         }
-        if ((n = writev(fd->osfd, tmp_iov, iov_cnt)) < 0) {
-            if (errno == EINTR)
+        if ((n = _st_writev_once(fd, tmp_iov, iov_cnt, timeout)) < 0) {
+            if (errno == EINTR && !_st_uring_write_enabled)
                 continue;
             if (!_IO_NOT_READY_ERROR) {
                 rv = -1;
@@ -635,12 +655,9 @@ int st_writev_resid(_st_netfd_t *fd, struct iovec **iov, int *iov_size, st_utime
     ssize_t n;
     
     while (*iov_size > 0) {
-        if (*iov_size == 1)
-            n = write(fd->osfd, (*iov)->iov_base, (*iov)->iov_len);
-        else
-            n = writev(fd->osfd, *iov, *iov_size);
+        n = _st_writev_once(fd, *iov, *iov_size, timeout);
         if (n < 0) {
-            if (errno == EINTR)
+            if (errno == EINTR && !_st_uring_write_enabled)
                 continue;
             if (!_IO_NOT_READY_ERROR)
                 return -1;
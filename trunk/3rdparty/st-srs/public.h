@@ -68,6 +68,7 @@
 #define ST_EVENTSYS_SELECT  1
 #define ST_EVENTSYS_POLL    2
 #define ST_EVENTSYS_ALT     3
+#define ST_EVENTSYS_IO_URING 4
 
 #ifdef __cplusplus
 extern "C" {
@@ -88,11 +89,19 @@ extern int st_getfdlimit(void);
 extern int st_set_eventsys(int eventsys);
 extern int st_get_eventsys(void);
 extern const char *st_get_eventsys_name(void);
+/* Set the number of SQ entries and whether write by io_uring, before st_init. */
+extern int st_uring_set(int entries, int write);
 
 #ifdef ST_SWITCH_CB
 extern st_switch_cb_t st_set_switch_in_cb(st_switch_cb_t cb);
 extern st_switch_cb_t st_set_switch_out_cb(st_switch_cb_t cb);
 #endif
+/* Whether stamp the time when put thread on run queue, to get the delay of run queue. */
+extern int st_set_runq_stamp(int on);
+/* Get the time when thread is put on run queue, 0 if not stamped. */
+extern st_utime_t st_thread_runq_at(st_thread_t thread);
+/* Get the usable stack of thread, -1 for the primordial thread which has no stack of ST. */
+extern int st_thread_stack(st_thread_t thread, char **bottom, char **top);
 
 extern st_thread_t st_thread_self(void);
 extern void st_thread_exit(void *retval);
@@ -211,6 +211,29 @@ st_switch_cb_t st_set_switch_out_cb(st_switch_cb_t cb)
 }
 #endif
 
+int st_set_runq_stamp(int on)
+{
+    int wason = _st_this_vp.runq_stamp;
+    _st_this_vp.runq_stamp = on;
+    return wason;
+}
+
+st_utime_t st_thread_runq_at(_st_thread_t *thread)
+{
+    return thread->runq_at;
+}
+
+int st_thread_stack(_st_thread_t *thread, char **bottom, char **top)
+{
+    /* The primordial thread runs on the stack of process. */
+    if (!thread || !thread->stack)
+        return -1;
+
+    *bottom = thread->stack->stk_bottom;
+    *top = thread->stack->stk_top;
+    return 0;
+}
+
 
 /*
  * Start function for the idle thread
@@ -333,6 +356,9 @@ void _st_thread_main(void)
      */
     MD_CAP_STACK(&thread);
     
+    /* The thread is switched in for the first time, not by _ST_SWITCH_CONTEXT */
+    ST_SWITCH_IN_CB(thread);
+    
     /* Run thread main */
     thread->retval = (*thread->start)(thread->arg);
     
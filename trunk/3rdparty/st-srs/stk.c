@@ -59,20 +59,28 @@ static char *_st_new_stk_segment(int size);
 _st_stack_t *_st_stack_new(int stack_size)
 {
     _st_clist_t *qp;
-    _st_stack_t *ts;
+    _st_stack_t *ts, *best = NULL;
     int extra;
     
+    /*
+     * Pick the smallest free stack that is big enough, so a small stack
+     * never pins a big one, and stop at the first exact match.
+     */
     for (qp = _st_free_stacks.next; qp != &_st_free_stacks; qp = qp->next) {
         ts = _ST_THREAD_STACK_PTR(qp);
-        if (ts->stk_size >= stack_size) {
-            /* Found a stack that is big enough */
-            ST_REMOVE_LINK(&ts->links);
-            _st_num_free_stacks--;
-            ts->links.next = NULL;
-            ts->links.prev = NULL;
-            return ts;
+        if (ts->stk_size >= stack_size && (!best || ts->stk_size < best->stk_size)) {
+            best = ts;
+            if (ts->stk_size == stack_size)
+                break;
         }
     }
+    if (best) {
+        ST_REMOVE_LINK(&best->links);
+        _st_num_free_stacks--;
+        best->links.next = NULL;
+        best->links.prev = NULL;
+        return best;
+    }
     
     /* Make a new thread stack object. */
     if ((ts = (_st_stack_t *)calloc(1, sizeof(_st_stack_t))) == NULL)
@@ -88,8 +96,9 @@ _st_stack_t *_st_stack_new(int stack_size)
     ts->stk_bottom = ts->vaddr + REDZONE;
     ts->stk_top = ts->stk_bottom + stack_size;
     
-#ifdef DEBUG
+    /* The stack grows down, so always guard the bottom to crash on overflow. */
     mprotect(ts->vaddr, REDZONE, PROT_NONE);
+#ifdef DEBUG
     mprotect(ts->stk_top + extra, REDZONE, PROT_NONE);
 #endif
     
@@ -121,7 +130,10 @@ void _st_stack_free(_st_stack_t *ts)
 static char *_st_new_stk_segment(int size)
 {
 #ifdef MALLOC_STACK
-    void *vaddr = malloc(size);
+    /* Page aligned, so the redzone could be protected as guard page. */
+    void *vaddr = NULL;
+    if (posix_memalign(&vaddr, _ST_PAGE_SIZE, size) != 0)
+        return NULL;
 #else
     static int zero_fd = -1;
     int mmap_flags = MAP_PRIVATE;
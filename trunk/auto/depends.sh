@@ -316,6 +316,15 @@ if [ $SRS_EXPORT_LIBRTMP_PROJECT = NO ]; then
     if [[ $SRS_OSX == YES ]]; then
         _ST_MAKE=darwin-debug && _ST_EXTRA_CFLAGS="-DMD_HAVE_KQUEUE" && _ST_LD=${SRS_TOOL_CC} && _ST_OBJ="DARWIN_*"
     fi
+    # Support the io_uring event system of ST, if the kernel header is ok, @remark the kernel
+    # is checked at runtime, and fall back to epoll if not supported.
+    if [[ $SRS_OSX == NO ]]; then
+        echo "#include <linux/io_uring.h>" > ${SRS_OBJS}/_tmp_uring.c &&
+        echo "int main() { return IORING_FEAT_EXT_ARG + IORING_OP_POLL_ADD; }" >> ${SRS_OBJS}/_tmp_uring.c &&
+        ${SRS_TOOL_CC} -c ${SRS_OBJS}/_tmp_uring.c -o ${SRS_OBJS}/_tmp_uring.o >/dev/null 2>&1 &&
+        _ST_EXTRA_CFLAGS="$_ST_EXTRA_CFLAGS -DMD_HAVE_IO_URING"
+        rm -f ${SRS_OBJS}/_tmp_uring.c ${SRS_OBJS}/_tmp_uring.o
+    fi
     # Always alloc on heap, @see https://github.com/ossrs/srs/issues/509#issuecomment-719931676
     _ST_EXTRA_CFLAGS="$_ST_EXTRA_CFLAGS -DMALLOC_STACK"
     # Pass the global extra flags.
@@ -432,6 +441,26 @@ if [ $SRS_EXPORT_LIBRTMP_PROJECT = NO ]; then
     ret=$?; if [[ $ret -ne 0 ]]; then echo "Warning: Ignore error to link players to cherrypy static-dir."; fi
 fi
 
+#####################################################################################
+# zlib, for the gzip variant of HLS/DASH playlists, use the system library.
+#####################################################################################
+if [[ $SRS_CROSS_BUILD == NO && $SRS_OSX == NO ]]; then
+    if [[ ! -f /usr/include/zlib.h && ! -f /usr/local/include/zlib.h ]]; then
+        echo "SRS requires zlib, for example: sudo apt-get install -y zlib1g-dev, or sudo yum install -y zlib-devel"; exit -1;
+    fi
+    echo "Use system zlib for gzip."
+fi
+
+#####################################################################################
+# libsrt, for SRT server, use the system library.
+#####################################################################################
+if [[ $SRS_SRT == YES ]]; then
+    if [[ ! -f /usr/include/srt/srt.h && ! -f /usr/local/include/srt/srt.h ]]; then
+        echo "SRT requires libsrt, for example: sudo apt-get install -y libsrt-openssl-dev"; exit -1;
+    fi
+    echo "Use system libsrt for SRT server."
+fi
+
 #####################################################################################
 # openssl, for rtmp complex handshake and HLS encryption.
 #####################################################################################
@@ -16,6 +16,7 @@ help=no
 ################################################################
 # feature options
 SRS_HDS=NO
+SRS_SRT=NO
 SRS_NGINX=NO
 SRS_FFMPEG_TOOL=NO
 SRS_LIBRTMP=NO
@@ -124,6 +125,7 @@ Features:
 
   --with-ssl                Enable rtmp complex handshake, requires openssl-devel installed.
   --with-hds                Enable hds streaming, mux RTMP to F4M/F4V files.
+  --with-srt                Enable SRT server, publish and play MPEG-TS over SRT, requires libsrt installed.
   --with-stream-caster      Enable stream caster to serve other stream over other protocol.
   --with-stat               Enable the data statistic, for http api.
   --with-librtmp            Enable srs-librtmp, library for client.
@@ -132,6 +134,7 @@ Features:
 
   --without-ssl             Disable rtmp complex handshake.
   --without-hds             Disable hds, the adobe http dynamic streaming.
+  --without-srt             Disable SRT server, the secure reliable transport.
   --without-stream-caster   Disable stream caster, only listen and serve RTMP/HTTP.
   --without-stat            Disable the data statistic feature.
   --without-librtmp         Disable srs-librtmp, library for client.
@@ -208,6 +211,7 @@ function parse_user_option() {
         
         --with-ssl)                     SRS_SSL=YES                 ;;
         --with-hds)                     SRS_HDS=YES                 ;;
+        --with-srt)                     SRS_SRT=YES                 ;;
         --with-nginx)                   SRS_NGINX=YES               ;;
         --with-ffmpeg)                  SRS_FFMPEG_TOOL=YES         ;;
         --with-transcode)               SRS_TRANSCODE=YES           ;;
@@ -227,6 +231,7 @@ function parse_user_option() {
         --with-mips-ubuntu12)           SRS_CROSS_BUILD=YES         ;;
 
         --without-hds)                  SRS_HDS=NO                  ;;
+        --without-srt)                  SRS_SRT=NO                  ;;
         --without-nginx)                SRS_NGINX=NO                ;;
         --without-ffmpeg)               SRS_FFMPEG_TOOL=NO          ;;
         --without-librtmp)              SRS_LIBRTMP=NO              ;;
@@ -490,6 +495,7 @@ function apply_user_detail_options() {
     # disable almost all features for export srs-librtmp.
     if [ $SRS_EXPORT_LIBRTMP_PROJECT != NO ]; then
         SRS_HDS=NO
+        SRS_SRT=NO
         SRS_SSL=NO
         SRS_TRANSCODE=NO
         SRS_HTTP_CALLBACK=NO
@@ -517,6 +523,7 @@ function regenerate_options() {
 SRS_AUTO_CONFIGURE="--prefix=${SRS_PREFIX}"
     if [ $SRS_HLS = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-hls"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-hls"; fi
     if [ $SRS_HDS = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-hds"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-hds"; fi
+    if [ $SRS_SRT = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-srt"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-srt"; fi
     if [ $SRS_DVR = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-dvr"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-dvr"; fi
     if [ $SRS_SSL = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-ssl"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-ssl"; fi
     if [ $SRS_TRANSCODE = YES ]; then SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --with-transcode"; else SRS_AUTO_CONFIGURE="${SRS_AUTO_CONFIGURE} --without-transcode"; fi
@@ -8,6 +8,8 @@
 #     $APP_NAME the app name to output. ie. srs_utest
 #     $MODULE_DIR the src dir of utest code. ie. src/utest
 #     $LINK_OPTIONS the link options for utest. ie. -lpthread -ldl
+#     $BENCH_NAME the micro-benchmark app to output, optional. ie. srs_ubench
+#     $BENCH_FILES the files of micro-benchmark, without gtest. ie. srs_ubench
 
 FILE=${SRS_OBJS}/utest/${SRS_MAKEFILE}
 # create dir for Makefile
@@ -19,6 +21,9 @@ mkdir -p ${SRS_OBJS}/utest
 SRS_TRUNK_PREFIX=../../..
 # gest dir, relative to objs/utest, it's trunk/objs/gtest
 GTEST_DIR=${SRS_TRUNK_PREFIX}/${SRS_OBJS_DIR}/gtest
+# the micro-benchmark binary, built with the utest objects but without gtest.
+BENCH_APP=""
+if [[ ! -z ${BENCH_NAME} ]]; then BENCH_APP="${SRS_TRUNK_PREFIX}/${SRS_OBJS_DIR}/${BENCH_NAME}"; fi
 
 cat << END > ${FILE}
 # user must run make the ${SRS_OBJS_DIR}/utest dir
@@ -53,7 +58,7 @@ CXXFLAGS += -g -Wall -Wextra -O0 ${EXTRA_DEFINES}
 
 # All tests produced by this Makefile.  Remember to add new tests you
 # created to the list.
-TESTS = ${SRS_TRUNK_PREFIX}/${SRS_OBJS_DIR}/${APP_NAME}
+TESTS = ${SRS_TRUNK_PREFIX}/${SRS_OBJS_DIR}/${APP_NAME} ${BENCH_APP}
 
 # All Google Test headers.  Usually you shouldn't change this
 # definition.
@@ -178,6 +183,25 @@ ${SRS_TRUNK_PREFIX}/${SRS_OBJS_DIR}/${APP_NAME} : \$(SRS_UTEST_DEPS) ${MODULE_OB
 	\$(CXX) -o \$@ \$(CPPFLAGS) \$(CXXFLAGS) \$^ \$(DEPS_LIBRARIES_FILES) ${LINK_OPTIONS}
 END
 
+#####################################################################################
+# App for micro-benchmark, which has its own main, so never link with gtest.
+if [[ ! -z ${BENCH_NAME} ]]; then
+    echo "" >> ${FILE}
+    echo "# generate the micro-benchmark binary" >> ${FILE}
+    BENCH_OBJS=()
+    for item in ${BENCH_FILES[*]}; do
+        BENCH_OBJS="${BENCH_OBJS[@]} ${item}.o"
+        cat << END >> ${FILE}
+${item}.o : ${SRS_TRUNK_PREFIX}/${MODULE_DIR}/${item}.cpp \$(SRS_UTEST_DEPS)
+	\$(CXX) \$(CPPFLAGS) \$(CXXFLAGS) \$(SRS_UTEST_INC) -c ${SRS_TRUNK_PREFIX}/${MODULE_DIR}/${item}.cpp -o \$@
+END
+    done
+    cat << END >> ${FILE}
+${BENCH_APP} : \$(SRS_UTEST_DEPS) ${BENCH_OBJS}
+	\$(CXX) -o \$@ \$(CPPFLAGS) \$(CXXFLAGS) \$^ \$(DEPS_LIBRARIES_FILES) ${LINK_OPTIONS}
+END
+fi
+
 #####################################################################################
 # parent Makefile, to create module output dir before compile it.
 echo "	@mkdir -p ${SRS_OBJS_DIR}/utest" >> ${SRS_WORKDIR}/${SRS_MAKEFILE}
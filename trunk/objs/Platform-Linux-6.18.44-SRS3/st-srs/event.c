@@ -0,0 +1 @@
+.src/./event.c
\ No newline at end of file
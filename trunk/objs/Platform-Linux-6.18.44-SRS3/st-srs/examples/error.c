@@ -0,0 +1 @@
+../.src/./examples/./error.c
\ No newline at end of file
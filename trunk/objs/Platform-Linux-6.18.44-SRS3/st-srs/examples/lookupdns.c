@@ -0,0 +1 @@
+../.src/./examples/./lookupdns.c
\ No newline at end of file
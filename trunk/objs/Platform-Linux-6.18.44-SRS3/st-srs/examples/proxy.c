@@ -0,0 +1 @@
+../.src/./examples/./proxy.c
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./examples/./res.c
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./examples/./server.c
\ No newline at end of file
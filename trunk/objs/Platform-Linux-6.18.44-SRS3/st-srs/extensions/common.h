@@ -0,0 +1 @@
+../.src/./extensions/./common.h
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./extensions/./dnscache.c
\ No newline at end of file
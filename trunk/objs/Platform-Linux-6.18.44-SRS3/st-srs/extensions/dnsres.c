@@ -0,0 +1 @@
+../.src/./extensions/./dnsres.c
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./extensions/./lrucache.c
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./extensions/./stx.h
\ No newline at end of file
@@ -0,0 +1 @@
+../.src/./extensions/./stx_fileio.c
\ No newline at end of file
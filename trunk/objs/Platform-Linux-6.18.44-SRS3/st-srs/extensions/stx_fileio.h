@@ -0,0 +1 @@
+../.src/./extensions/./stx_fileio.h
\ No newline at end of file
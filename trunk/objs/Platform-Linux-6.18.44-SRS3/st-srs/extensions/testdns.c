@@ -0,0 +1 @@
+../.src/./extensions/./testdns.c
\ No newline at end of file
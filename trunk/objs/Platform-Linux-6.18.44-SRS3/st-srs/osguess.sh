@@ -0,0 +1 @@
+.src/./osguess.sh
\ No newline at end of file
@@ -0,0 +1 @@
+.src/./st.spec
\ No newline at end of file
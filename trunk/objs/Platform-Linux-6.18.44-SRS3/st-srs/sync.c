@@ -0,0 +1 @@
+.src/./sync.c
\ No newline at end of file
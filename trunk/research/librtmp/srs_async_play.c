@@ -0,0 +1,151 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2018 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+
+#include "../../objs/include/srs_librtmp.h"
+
+// The player, driven by poll in one thread.
+typedef struct {
+    srs_rtmp_t rtmp;
+    int id;
+    int64_t nb_packets;
+    int64_t nb_bytes;
+    uint32_t timestamp;
+} Player;
+
+int on_packet(void* param, char type, uint32_t timestamp, char* data, int size)
+{
+    Player* player = (Player*)param;
+    
+    player->nb_packets++;
+    player->nb_bytes += size;
+    if (type == SRS_RTMP_TYPE_AUDIO || type == SRS_RTMP_TYPE_VIDEO) {
+        player->timestamp = timestamp;
+    }
+    
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    printf("play RTMP streams by non-blocking librtmp, driven by poll in one thread\n");
+    printf("srs(ossrs) client librtmp library.\n");
+    printf("version: %d.%d.%d\n", srs_version_major(), srs_version_minor(), srs_version_revision());
+    
+    if (argc <= 2) {
+        printf("Usage: %s <rtmp_url> <players>\n"
+            "   rtmp_url     RTMP stream url to play\n"
+            "   players      The number of players\n"
+            "For example:\n"
+            "   %s rtmp://127.0.0.1:1935/live/livestream 100\n",
+            argv[0], argv[0]);
+        exit(-1);
+    }
+    
+    int nb_players = atoi(argv[2]);
+    if (nb_players <= 0) {
+        srs_human_trace("invalid players %s", argv[2]);
+        exit(-1);
+    }
+    
+    Player* players = (Player*)calloc(nb_players, sizeof(Player));
+    struct pollfd* fds = (struct pollfd*)calloc(nb_players, sizeof(struct pollfd));
+    
+    // Handshake and play in blocking mode, then switch to non-blocking.
+    int i;
+    for (i = 0; i < nb_players; i++) {
+        Player* player = players + i;
+        player->id = i;
+        player->rtmp = srs_rtmp_create(argv[1]);
+        
+        if (srs_rtmp_handshake(player->rtmp) != 0 || srs_rtmp_connect_app(player->rtmp) != 0
+            || srs_rtmp_play_stream(player->rtmp) != 0) {
+            srs_human_trace("player #%d play failed.", i);
+            goto rtmp_destroy;
+        }
+        
+        if (srs_rtmp_set_nonblock(player->rtmp, 1) != 0) {
+            srs_human_trace("player #%d set nonblock failed.", i);
+            goto rtmp_destroy;
+        }
+        
+        fds[i].fd = srs_rtmp_get_fd(player->rtmp);
+    }
+    srs_human_trace("%d players play stream success", nb_players);
+    
+    int64_t last = srs_utils_time_ms();
+    for (;;) {
+        for (i = 0; i < nb_players; i++) {
+            fds[i].events = POLLIN;
+            if (srs_rtmp_want_write(players[i].rtmp)) {
+                fds[i].events |= POLLOUT;
+            }
+        }
+        
+        if (poll(fds, nb_players, 1000) < 0) {
+            srs_human_trace("poll failed.");
+            goto rtmp_destroy;
+        }
+        
+        for (i = 0; i < nb_players; i++) {
+            Player* player = players + i;
+            
+            if ((fds[i].revents & POLLOUT) && srs_rtmp_on_writable(player->rtmp) != 0) {
+                srs_human_trace("player #%d write failed.", i);
+                goto rtmp_destroy;
+            }
+            
+            if ((fds[i].revents & (POLLIN | POLLERR | POLLHUP)) && srs_rtmp_on_readable(player->rtmp, on_packet, player) != 0) {
+                srs_human_trace("player #%d read failed.", i);
+                goto rtmp_destroy;
+            }
+        }
+        
+        if (srs_utils_time_ms() - last >= 3000) {
+            last = srs_utils_time_ms();
+            
+            int64_t nb_packets = 0, nb_bytes = 0;
+            for (i = 0; i < nb_players; i++) {
+                nb_packets += players[i].nb_packets;
+                nb_bytes += players[i].nb_bytes;
+            }
+            srs_human_trace("%d players, packets=%d, bytes=%d, #0 time=%d",
+                nb_players, (int)nb_packets, (int)nb_bytes, (int)players[0].timestamp);
+        }
+    }
+    
+rtmp_destroy:
+    for (i = 0; i < nb_players; i++) {
+        if (players[i].rtmp) {
+            srs_rtmp_destroy(players[i].rtmp);
+        }
+    }
+    free(players);
+    free(fds);
+    
+    return 0;
+}
@@ -0,0 +1,707 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <ctype.h>
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "../../objs/include/srs_librtmp.h"
+
+// The fanout benchmark, a publisher and N players, each in a process, for librtmp is blocking.
+// The publisher marks the h264 video by timestamp in SEI, the same as publish.latency_marker of SRS,
+// so the players get the latency from publisher to player, on the same host.
+
+// The max number of latency samples of each player, to fit in PIPE_BUF for atomic write.
+#define BENCH_MAX_SAMPLES 512
+// The size of timestamp marker NALU with the 4bytes length, @see SRS_FLV_VIDEO_MARKER_SIZE
+#define BENCH_MARKER_SIZE 40
+// The uuid of SEI user data unregistered for the timestamp marker.
+#define BENCH_MARKER_UUID "srs-latency-mark"
+// The timeout in ms to recv or send for players and publisher.
+#define BENCH_TIMEOUT_MS 5000
+
+// The result of a player, written to the pipe when done.
+typedef struct {
+    int id;
+    int ret;
+    int64_t bytes;
+    int64_t frames;
+    // The time in ms to first video frame, since connect, -1 if none.
+    int ttff;
+    // The time in ms the player played.
+    int elapsed;
+    int nb_latency;
+    int latency[BENCH_MAX_SAMPLES];
+} bench_result_t;
+
+// User options.
+const char* in_flv_file = NULL;
+const char* publish_url = NULL;
+const char* play_url = NULL;
+int nb_players = 10;
+int duration = 30;
+int ramp = 10;
+int marker_interval = 1000;
+int server_pid = 0;
+
+int64_t bench_time_us()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((int64_t)now.tv_sec) * 1000 * 1000 + (int64_t)now.tv_usec;
+}
+
+// Parse the timestamp marker, which must be the first NALU of h264 frame, @see SrsFlvVideo::marker
+int bench_parse_marker(char* data, int size, int64_t* ptimestamp)
+{
+    if (size < 5 + BENCH_MARKER_SIZE || (data[0] & 0x0f) != 7 || data[1] != 1) {
+        return 0;
+    }
+
+    unsigned char* p = (unsigned char*)data + 5;
+    if (p[0] != 0 || p[1] != 0 || p[2] != 0 || p[3] != BENCH_MARKER_SIZE - 4) {
+        return 0;
+    }
+    if ((p[4] & 0x1f) != 6 || p[5] != 0x05 || p[6] != 32 || memcmp(p + 7, BENCH_MARKER_UUID, 16) != 0) {
+        return 0;
+    }
+
+    int64_t v = 0;
+    int i;
+    for (i = 0; i < 16; i++) {
+        char ch = (char)p[23 + i];
+        if (ch >= '0' && ch <= '9') {
+            v = (v << 4) | (ch - '0');
+        } else if (ch >= 'a' && ch <= 'f') {
+            v = (v << 4) | (ch - 'a' + 10);
+        } else {
+            return 0;
+        }
+    }
+
+    *ptimestamp = v;
+    return 1;
+}
+
+// Mark the h264 frame of NALUs by timestamp, @see SrsFlvVideo::mark
+// @return the marked data, which user should free, or NULL if not a h264 frame of 4bytes NALUs.
+char* bench_mark(char* data, int size, int64_t timestamp, int* psize)
+{
+    if (size < 5 || (data[0] & 0x0f) != 7 || data[1] != 1) {
+        return NULL;
+    }
+
+    int pos;
+    for (pos = 5; pos < size;) {
+        if (pos + 4 > size) {
+            return NULL;
+        }
+        unsigned char* p = (unsigned char*)data + pos;
+        int nb_nalu = (int)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+        if (nb_nalu <= 0 || nb_nalu > size - pos - 4) {
+            return NULL;
+        }
+        pos += 4 + nb_nalu;
+    }
+
+    int nb_data = size + BENCH_MARKER_SIZE;
+    char* buf = (char*)malloc(nb_data);
+    memcpy(buf, data, 5);
+
+    char* p = buf + 5;
+    *p++ = 0; *p++ = 0; *p++ = 0; *p++ = BENCH_MARKER_SIZE - 4;
+    *p++ = 6; *p++ = 0x05; *p++ = 32;
+    memcpy(p, BENCH_MARKER_UUID, 16);
+    p += 16;
+
+    int i;
+    for (i = 15; i >= 0; i--) {
+        p[i] = "0123456789abcdef"[timestamp & 0x0f];
+        timestamp >>= 4;
+    }
+    p += 16;
+    *p++ = (char)0x80;
+    memcpy(p, data + 5, size - 5);
+
+    *psize = nb_data;
+    return buf;
+}
+
+// Publish the flv file in loop, at the speed of timestamp, until the deadline.
+int do_publish(int64_t deadline)
+{
+    int ret = 0;
+
+    srs_flv_t flv = NULL;
+    if ((flv = srs_flv_open_read(in_flv_file)) == NULL) {
+        srs_human_trace("open flv %s failed", in_flv_file);
+        return -1;
+    }
+
+    srs_rtmp_t rtmp = srs_rtmp_create(publish_url);
+    srs_rtmp_set_timeout(rtmp, BENCH_TIMEOUT_MS, BENCH_TIMEOUT_MS);
+
+    if ((ret = srs_rtmp_handshake(rtmp)) != 0 || (ret = srs_rtmp_connect_app(rtmp)) != 0
+        || (ret = srs_rtmp_publish_stream(rtmp)) != 0) {
+        srs_human_trace("publish %s failed, ret=%d", publish_url, ret);
+        goto failed;
+    }
+
+    char header[13];
+    if ((ret = srs_flv_read_header(flv, header)) != 0) {
+        goto failed;
+    }
+    int64_t starttime = srs_utils_time_ms();
+    int64_t header_pos = srs_flv_tellg(flv);
+    int64_t last_marker = 0;
+    // The base and last timestamp of loop, to keep the timestamp monotonically increasing.
+    uint32_t base = 0, last = 0;
+
+    while (srs_utils_time_ms() < deadline) {
+        char type;
+        int size;
+        uint32_t timestamp;
+        if ((ret = srs_flv_read_tag_header(flv, &type, &size, &timestamp)) != 0) {
+            if (!srs_flv_is_eof(ret)) {
+                goto failed;
+            }
+            srs_flv_lseek(flv, header_pos);
+            base = last + 40;
+            continue;
+        }
+
+        char* data = (char*)malloc(size);
+        if ((ret = srs_flv_read_tag_data(flv, data, size)) != 0) {
+            free(data);
+            goto failed;
+        }
+        last = base + timestamp;
+
+        if (type != SRS_RTMP_TYPE_AUDIO && type != SRS_RTMP_TYPE_VIDEO) {
+            free(data);
+            continue;
+        }
+
+        int64_t now = bench_time_us();
+        if (type == SRS_RTMP_TYPE_VIDEO && marker_interval > 0 && now - last_marker >= marker_interval * 1000) {
+            int nb_marked = 0;
+            char* marked = bench_mark(data, size, now, &nb_marked);
+            if (marked) {
+                free(data);
+                data = marked;
+                size = nb_marked;
+                last_marker = now;
+            }
+        }
+
+        if ((ret = srs_rtmp_write_packet(rtmp, type, last, data, size)) != 0) {
+            srs_human_trace("publish write failed, ret=%d", ret);
+            goto failed;
+        }
+
+        int64_t diff = (int64_t)last - (srs_utils_time_ms() - starttime);
+        if (diff > 0) {
+            usleep((useconds_t)(diff * 1000));
+        }
+    }
+
+failed:
+    srs_rtmp_destroy(rtmp);
+    srs_flv_close(flv);
+    return ret;
+}
+
+// Whether got a video frame of stream, the first one for ttff, and the marker for latency.
+void on_player_packet(bench_result_t* r, int64_t starttime, char type, char* data, int size)
+{
+    r->bytes += size;
+
+    if (type != SRS_RTMP_TYPE_AUDIO && type != SRS_RTMP_TYPE_VIDEO) {
+        return;
+    }
+    r->frames++;
+
+    if (type != SRS_RTMP_TYPE_VIDEO || srs_flv_is_sequence_header(data, size)) {
+        return;
+    }
+
+    int64_t now = bench_time_us();
+    if (r->ttff < 0) {
+        r->ttff = (int)((now - starttime) / 1000);
+    }
+
+    int64_t timestamp = 0;
+    if (r->nb_latency < BENCH_MAX_SAMPLES && bench_parse_marker(data, size, &timestamp)) {
+        r->latency[r->nb_latency++] = (int)((now - timestamp) / 1000);
+    }
+}
+
+int do_rtmp_play(bench_result_t* r, int64_t deadline)
+{
+    int ret = 0;
+    int64_t starttime = bench_time_us();
+
+    srs_rtmp_t rtmp = srs_rtmp_create(play_url);
+    srs_rtmp_set_timeout(rtmp, BENCH_TIMEOUT_MS, BENCH_TIMEOUT_MS);
+
+    if ((ret = srs_rtmp_handshake(rtmp)) != 0 || (ret = srs_rtmp_connect_app(rtmp)) != 0
+        || (ret = srs_rtmp_play_stream(rtmp)) != 0) {
+        goto failed;
+    }
+
+    while (srs_utils_time_ms() < deadline) {
+        char type;
+        int size;
+        uint32_t timestamp;
+        char* data = NULL;
+        if ((ret = srs_rtmp_read_packet(rtmp, &type, &timestamp, &data, &size)) != 0) {
+            goto failed;
+        }
+
+        on_player_packet(r, starttime, type, data, size);
+        srs_rtmp_free_packet(data);
+    }
+
+failed:
+    srs_rtmp_destroy(rtmp);
+    return ret;
+}
+
+// The reader of HTTP response body, which decodes the chunked encoding.
+typedef struct {
+    int fd;
+    int chunked;
+    // The left bytes of current chunk.
+    int left;
+    char buf[4096];
+    int pos;
+    int nb_buf;
+} bench_http_t;
+
+int bench_http_fill(bench_http_t* h)
+{
+    if (h->pos < h->nb_buf) {
+        return 0;
+    }
+
+    ssize_t nn = recv(h->fd, h->buf, sizeof(h->buf), 0);
+    if (nn <= 0) {
+        return -1;
+    }
+    h->pos = 0;
+    h->nb_buf = (int)nn;
+    return 0;
+}
+
+// Read a line ends with CRLF, without the CRLF.
+int bench_http_line(bench_http_t* h, char* line, int size)
+{
+    int n = 0;
+    for (;;) {
+        if (bench_http_fill(h) != 0) {
+            return -1;
+        }
+        char ch = h->buf[h->pos++];
+        if (ch == '\n') {
+            break;
+        }
+        if (ch != '\r' && n < size - 1) {
+            line[n++] = ch;
+        }
+    }
+    line[n] = 0;
+    return n;
+}
+
+int bench_http_read(bench_http_t* h, char* data, int size)
+{
+    while (size > 0) {
+        if (h->chunked && h->left == 0) {
+            char line[64];
+            // The CRLF after previous chunk, then the size of chunk.
+            int n = bench_http_line(h, line, sizeof(line));
+            if (n == 0) {
+                n = bench_http_line(h, line, sizeof(line));
+            }
+            if (n <= 0 || (h->left = (int)strtol(line, NULL, 16)) <= 0) {
+                return -1;
+            }
+        }
+
+        if (bench_http_fill(h) != 0) {
+            return -1;
+        }
+        int nn = h->nb_buf - h->pos;
+        nn = nn < size? nn : size;
+        if (h->chunked) {
+            nn = nn < h->left? nn : h->left;
+            h->left -= nn;
+        }
+
+        memcpy(data, h->buf + h->pos, nn);
+        h->pos += nn;
+        data += nn;
+        size -= nn;
+    }
+    return 0;
+}
+
+int do_http_play(bench_http_t* h, bench_result_t* r, int64_t deadline)
+{
+    int64_t starttime = bench_time_us();
+
+    // Parse the url http://host[:port]/path
+    char host[256];
+    int port = 80;
+    const char* p = play_url + 7;
+    const char* path = strchr(p, '/');
+    if (!path) {
+        return -1;
+    }
+    const char* colon = memchr(p, ':', path - p);
+    int nb_host = (int)((colon? colon : path) - p);
+    if (nb_host <= 0 || nb_host >= (int)sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, p, nb_host);
+    host[nb_host] = 0;
+    if (colon) {
+        port = atoi(colon + 1);
+    }
+
+    struct hostent* he = gethostbyname(host);
+    if (!he) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    memcpy(&addr.sin_addr, he->h_addr_list[0], sizeof(addr.sin_addr));
+
+    struct timeval tv;
+    tv.tv_sec = BENCH_TIMEOUT_MS / 1000;
+    tv.tv_usec = 0;
+    setsockopt(h->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(h->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if (connect(h->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        return -1;
+    }
+
+    char req[1024];
+    int nb_req = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: srs_benchmark\r\n\r\n", path, host);
+    if (send(h->fd, req, nb_req, 0) != nb_req) {
+        return -1;
+    }
+
+    char line[1024];
+    if (bench_http_line(h, line, sizeof(line)) <= 0 || !strstr(line, " 200")) {
+        return -1;
+    }
+    for (;;) {
+        int n = bench_http_line(h, line, sizeof(line));
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        int j;
+        for (j = 0; j < n; j++) {
+            line[j] = (char)tolower(line[j]);
+        }
+        if (strstr(line, "transfer-encoding:") && strstr(line, "chunked")) {
+            h->chunked = 1;
+        }
+    }
+
+    // The flv header and the first previous tag size.
+    char header[13];
+    if (bench_http_read(h, header, sizeof(header)) != 0 || header[0] != 'F') {
+        return -1;
+    }
+
+    while (srs_utils_time_ms() < deadline) {
+        char tag[11];
+        if (bench_http_read(h, tag, sizeof(tag)) != 0) {
+            return -1;
+        }
+        int size = (int)((uint8_t)tag[1] << 16 | (uint8_t)tag[2] << 8 | (uint8_t)tag[3]);
+
+        char* data = (char*)malloc(size + 4);
+        if (bench_http_read(h, data, size + 4) != 0) {
+            free(data);
+            return -1;
+        }
+
+        on_player_packet(r, starttime, tag[0], data, size);
+        free(data);
+    }
+
+    return 0;
+}
+
+int do_play(bench_result_t* r, int64_t deadline)
+{
+    if (strncmp(play_url, "http://", 7) != 0) {
+        return do_rtmp_play(r, deadline);
+    }
+
+    bench_http_t h;
+    memset(&h, 0, sizeof(h));
+    if ((h.fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return -1;
+    }
+
+    int ret = do_http_play(&h, r, deadline);
+    close(h.fd);
+    return ret;
+}
+
+// Get the cpu ticks of process, the utime and stime in /proc/pid/stat.
+int64_t bench_cpu_ticks(int pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+
+    char buf[1024];
+    size_t nn = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[nn] = 0;
+
+    // Skip the comm, which may contains spaces, then the state is the 3rd field.
+    char* p = strrchr(buf, ')');
+    if (!p) {
+        return -1;
+    }
+
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return -1;
+    }
+    return (int64_t)(utime + stime);
+}
+
+int bench_compare(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+// Get the percentile of sorted values.
+int bench_percentile(int* values, int nn, int percent)
+{
+    if (nn <= 0) {
+        return -1;
+    }
+    int i = (nn * percent + 99) / 100 - 1;
+    return values[i < 0? 0 : i];
+}
+
+int main(int argc, char** argv)
+{
+    printf("fanout benchmark, publish a stream and play it by N players.\n");
+    printf("srs(ossrs) client librtmp library.\n");
+    printf("version: %d.%d.%d\n", srs_version_major(), srs_version_minor(), srs_version_revision());
+
+    if (argc <= 2) {
+        printf("Usage: %s [-i in_flv_file -y publish_url] <-u play_url> [-n players] [-d duration] [-r ramp] [-m marker] [-p pid]\n"
+            "   in_flv_file     input flv file, publish in loop. Ignore it to play the stream of others.\n"
+            "   publish_url     rtmp url to publish to.\n"
+            "   play_url        rtmp url, or http url of flv, to play. Default to the publish_url.\n"
+            "   players         the number of players, each in a process. Default to 10.\n"
+            "   duration        the seconds to play. Default to 30.\n"
+            "   ramp            the interval in ms to start each player. Default to 10.\n"
+            "   marker          the interval in ms to mark the video by timestamp for latency, 0 to disable. Default to 1000.\n"
+            "   pid             the pid of SRS, to stat the cpu of server, for example, $(cat objs/srs.pid)\n"
+            "For example:\n"
+            "   %s -i doc/source.200kbps.768x320.flv -y rtmp://127.0.0.1/live/bench -n 100 -p $(cat objs/srs.pid)\n"
+            "   %s -i doc/source.200kbps.768x320.flv -y rtmp://127.0.0.1/live/bench -u http://127.0.0.1:8080/live/bench.flv\n",
+            argv[0], argv[0], argv[0]);
+        exit(-1);
+    }
+
+    int opt;
+    for (opt = 0; opt < argc - 1; opt++) {
+        char* p = argv[opt];
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+        switch (p[1]) {
+            case 'i': in_flv_file = argv[opt + 1]; break;
+            case 'y': publish_url = argv[opt + 1]; break;
+            case 'u': play_url = argv[opt + 1]; break;
+            case 'n': nb_players = atoi(argv[opt + 1]); break;
+            case 'd': duration = atoi(argv[opt + 1]); break;
+            case 'r': ramp = atoi(argv[opt + 1]); break;
+            case 'm': marker_interval = atoi(argv[opt + 1]); break;
+            case 'p': server_pid = atoi(argv[opt + 1]); break;
+            default: break;
+        }
+    }
+
+    if (!play_url) {
+        play_url = publish_url;
+    }
+    if (!play_url || nb_players <= 0 || duration <= 0 || (in_flv_file && !publish_url)) {
+        srs_human_trace("invalid options, see usage");
+        return -1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    // The publisher lasts until all players done.
+    int64_t starttime = srs_utils_time_ms();
+    int64_t deadline = starttime + (int64_t)nb_players * ramp + 1000 + duration * 1000;
+    pid_t publisher = 0;
+    if (in_flv_file) {
+        srs_human_trace("publish %s to %s", in_flv_file, publish_url);
+        fflush(stdout);
+        if ((publisher = fork()) == 0) {
+            int ret = do_publish(deadline + 1000);
+            srs_human_trace("publish done, ret=%d", ret);
+            exit(ret);
+        }
+        // Wait for the stream to be published.
+        usleep(1000 * 1000);
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        srs_human_trace("create pipe failed");
+        return -1;
+    }
+
+    srs_human_trace("start %d players of %s, duration=%ds", nb_players, play_url, duration);
+    int64_t cpu_start = server_pid? bench_cpu_ticks(server_pid) : -1;
+    int64_t cpu_starttime = srs_utils_time_ms();
+
+    int i;
+    fflush(stdout);
+    for (i = 0; i < nb_players; i++) {
+        if (fork() == 0) {
+            close(fds[0]);
+
+            bench_result_t r;
+            memset(&r, 0, sizeof(r));
+            r.id = i;
+            r.ttff = -1;
+
+            int64_t play_starttime = srs_utils_time_ms();
+            r.ret = do_play(&r, play_starttime + duration * 1000);
+            r.elapsed = (int)(srs_utils_time_ms() - play_starttime);
+
+            // The write is atomic, for the result is less than PIPE_BUF.
+            ssize_t nn = write(fds[1], &r, sizeof(r));
+            exit(nn == sizeof(r)? 0 : -1);
+        }
+        if (ramp > 0) {
+            usleep(ramp * 1000);
+        }
+    }
+    close(fds[1]);
+
+    // Collect the results of players, until all players exit.
+    bench_result_t* results = (bench_result_t*)malloc(sizeof(bench_result_t) * nb_players);
+    int nb_results = 0;
+    while (nb_results < nb_players) {
+        ssize_t nn = read(fds[0], &results[nb_results], sizeof(bench_result_t));
+        if (nn != sizeof(bench_result_t)) {
+            break;
+        }
+        nb_results++;
+    }
+
+    int64_t cpu_end = server_pid? bench_cpu_ticks(server_pid) : -1;
+    int64_t cpu_elapsed = srs_utils_time_ms() - cpu_starttime;
+
+    if (publisher > 0) {
+        kill(publisher, SIGTERM);
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    // Aggregate the results.
+    int nb_ok = 0;
+    int64_t bytes = 0, frames = 0, elapsed = 0;
+    int* ttffs = (int*)malloc(sizeof(int) * (nb_results + 1));
+    int nb_ttffs = 0;
+    int* latencies = (int*)malloc(sizeof(int) * (nb_results * BENCH_MAX_SAMPLES + 1));
+    int nb_latencies = 0;
+    for (i = 0; i < nb_results; i++) {
+        bench_result_t* r = &results[i];
+        if (r->ret == 0) {
+            nb_ok++;
+        }
+        bytes += r->bytes;
+        frames += r->frames;
+        elapsed += r->elapsed;
+        if (r->ttff >= 0) {
+            ttffs[nb_ttffs++] = r->ttff;
+        }
+        memcpy(latencies + nb_latencies, r->latency, sizeof(int) * r->nb_latency);
+        nb_latencies += r->nb_latency;
+    }
+    qsort(ttffs, nb_ttffs, sizeof(int), bench_compare);
+    qsort(latencies, nb_latencies, sizeof(int), bench_compare);
+
+    printf("\n");
+    printf("players: %d, ok=%d, failed=%d, lost=%d\n", nb_players, nb_ok, nb_results - nb_ok, nb_players - nb_results);
+    printf("throughput: %d kbps, %d kbps per player, %d fps per player\n",
+        (int)(cpu_elapsed > 0? bytes * 8 / cpu_elapsed : 0),
+        (int)(elapsed > 0? bytes * 8 / elapsed : 0),
+        (int)(elapsed > 0? frames * 1000 / elapsed : 0));
+    printf("ttff: %d players, p50=%dms, p90=%dms, p99=%dms, max=%dms\n", nb_ttffs,
+        bench_percentile(ttffs, nb_ttffs, 50), bench_percentile(ttffs, nb_ttffs, 90),
+        bench_percentile(ttffs, nb_ttffs, 99), bench_percentile(ttffs, nb_ttffs, 100));
+    printf("latency: %d samples, p50=%dms, p90=%dms, p99=%dms, max=%dms\n", nb_latencies,
+        bench_percentile(latencies, nb_latencies, 50), bench_percentile(latencies, nb_latencies, 90),
+        bench_percentile(latencies, nb_latencies, 99), bench_percentile(latencies, nb_latencies, 100));
+    if (cpu_start >= 0 && cpu_end >= 0 && cpu_elapsed > 0) {
+        double cpu = (double)(cpu_end - cpu_start) * 1000 * 100 / sysconf(_SC_CLK_TCK) / cpu_elapsed;
+        printf("cpu: %.2f%% of pid %d, %.4f%% per player\n", cpu, server_pid, cpu / nb_players);
+    }
+
+    free(results);
+    free(ttffs);
+    free(latencies);
+
+    return nb_ok == nb_players? 0 : -1;
+}
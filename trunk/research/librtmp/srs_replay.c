@@ -0,0 +1,487 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// For memmem.
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <inttypes.h>
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "../../objs/include/srs_librtmp.h"
+
+// Replay the ingest sessions captured by SRS, @see publish.capture of vhost and capture of stream_caster,
+// each copy in a process, with the same chunk sizes, burstiness and jitter of the real encoder.
+// The RTMP session is sent from the handshake, and the responses of server are dropped. The MPEG-TS
+// datagrams are sent to port+i for the copy i, so user should config a stream_caster for each copy.
+
+// The header of capture file, @see SrsCaptureWriter
+#define REPLAY_MAGIC "SCAP"
+#define REPLAY_HEADER_SIZE 8
+#define REPLAY_RECORD_SIZE 12
+#define REPLAY_TYPE_RTMP 1
+#define REPLAY_TYPE_MPEGTS 2
+// The size of RTMP handshake C0C1C2, the commands are after it.
+#define REPLAY_HANDSHAKE_SIZE 3073
+// The max bytes to search the publish command for the stream name.
+#define REPLAY_SEARCH_SIZE (64 * 1024)
+// The timeout in ms to send for RTMP.
+#define REPLAY_TIMEOUT_MS 5000
+
+// The record of capture, the bytes are in the data of capture.
+typedef struct {
+    int64_t time;
+    int offset;
+    int size;
+} replay_record_t;
+
+// The capture loaded in memory.
+typedef struct {
+    int type;
+    char* data;
+    int nb_data;
+    replay_record_t* records;
+    int nb_records;
+} replay_capture_t;
+
+// The result of a copy, written to the pipe when done.
+typedef struct {
+    int id;
+    int ret;
+    int64_t bytes;
+    int64_t records;
+    // The time in ms the copy replayed.
+    int elapsed;
+    // The max lag in ms behind the schedule, for example, the server applies backpressure.
+    int max_lag;
+    // The number of records sent later than 100ms.
+    int64_t nb_lags;
+} replay_result_t;
+
+// User options.
+const char* in_cap_file = NULL;
+const char* server = NULL;
+int nb_copies = 1;
+double rate = 1.0;
+int ramp = 100;
+
+int64_t replay_time_us()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((int64_t)now.tv_sec) * 1000 * 1000 + (int64_t)now.tv_usec;
+}
+
+uint32_t replay_be32(unsigned char* p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// Load the capture file to memory, the bytes of records are contiguous in data.
+int replay_load(const char* file, replay_capture_t* cap)
+{
+    FILE* f = fopen(file, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, REPLAY_MAGIC, 4) != 0) {
+        fclose(f);
+        return -1;
+    }
+    cap->type = header[5];
+
+    fseek(f, 0, SEEK_END);
+    long nb_file = ftell(f);
+    fseek(f, REPLAY_HEADER_SIZE, SEEK_SET);
+
+    cap->data = (char*)malloc(nb_file);
+    cap->records = (replay_record_t*)malloc(sizeof(replay_record_t) * (nb_file / REPLAY_RECORD_SIZE + 1));
+
+    for (;;) {
+        unsigned char head[REPLAY_RECORD_SIZE];
+        if (fread(head, 1, sizeof(head), f) != sizeof(head)) {
+            break;
+        }
+
+        replay_record_t* r = &cap->records[cap->nb_records];
+        r->time = (int64_t)replay_be32(head) << 32 | replay_be32(head + 4);
+        r->size = (int)replay_be32(head + 8);
+        r->offset = cap->nb_data;
+
+        // Ignore the truncated record, for example, the server is killed.
+        if (r->size < 0 || cap->nb_data + r->size > nb_file) {
+            break;
+        }
+        if (fread(cap->data + cap->nb_data, 1, r->size, f) != (size_t)r->size) {
+            break;
+        }
+
+        cap->nb_data += r->size;
+        cap->nb_records++;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Rename the stream of RTMP publisher for the copy, to publish each copy to its own stream. The last
+// chars of name, before the ? of params, are replaced by the index of copy, so the size of commands
+// and the chunks never change. For example, the copy 3 of 20 is livestre03 for livestream.
+// @remark The name must be in the same chunk of command, which is generally true for the small command.
+int replay_rename(replay_capture_t* cap, int index)
+{
+    int width = 1;
+    int n;
+    for (n = nb_copies - 1; n >= 10; n /= 10) {
+        width++;
+    }
+
+    char* start = cap->data + REPLAY_HANDSHAKE_SIZE;
+    int nb_search = cap->nb_data - REPLAY_HANDSHAKE_SIZE;
+    if (nb_search > REPLAY_SEARCH_SIZE) {
+        nb_search = REPLAY_SEARCH_SIZE;
+    }
+    if (nb_search <= 0) {
+        return -1;
+    }
+
+    // The publish command: string(publish), number(transaction id), null, string(stream).
+    const char* cmd = "\x02\x00\x07publish";
+    char* p = (char*)memmem(start, nb_search, cmd, 10);
+    if (!p || p + 10 + 9 + 1 + 3 > start + nb_search || p[10] != 0x00 || p[19] != 0x05 || p[20] != 0x02) {
+        return -1;
+    }
+    p += 20;
+    int nb_name = (int)((unsigned char)p[1] << 8 | (unsigned char)p[2]);
+    if (p + 3 + nb_name > start + nb_search) {
+        return -1;
+    }
+
+    // The amf0 string of name, to rename the releaseStream and FCPublish too.
+    int nb_pattern = 3 + nb_name;
+    char* pattern = (char*)malloc(nb_pattern);
+    memcpy(pattern, p, nb_pattern);
+
+    char* q = (char*)memchr(pattern + 3, '?', nb_name);
+    int nb_stream = q? (int)(q - pattern - 3) : nb_name;
+    if (nb_stream <= width) {
+        free(pattern);
+        return -1;
+    }
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "%0*d", width, index);
+
+    int nb_renamed = 0;
+    for (p = start; p < start + nb_search;) {
+        q = (char*)memmem(p, start + nb_search - p, pattern, nb_pattern);
+        if (!q) {
+            break;
+        }
+        memcpy(q + 3 + nb_stream - width, suffix, width);
+        p = q + nb_pattern;
+        nb_renamed++;
+    }
+
+    if (index == 0) {
+        srs_human_trace("rename stream %.*s, %d commands", nb_stream, pattern + 3, nb_renamed);
+    }
+
+    free(pattern);
+    return 0;
+}
+
+// Connect to server, the port is added by the index of copy for MPEG-TS.
+int replay_connect(int type, int index, struct sockaddr_in* addr)
+{
+    char host[256];
+    snprintf(host, sizeof(host), "%s", server);
+
+    int port = (type == REPLAY_TYPE_RTMP)? 1935 : 8935;
+    char* colon = strchr(host, ':');
+    if (colon) {
+        *colon = 0;
+        port = atoi(colon + 1);
+    }
+    if (type == REPLAY_TYPE_MPEGTS) {
+        port += index;
+    }
+
+    struct hostent* he = gethostbyname(host);
+    if (!he) {
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    memcpy(&addr->sin_addr, he->h_addr_list[0], sizeof(addr->sin_addr));
+
+    int fd = socket(AF_INET, (type == REPLAY_TYPE_RTMP)? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (type == REPLAY_TYPE_RTMP) {
+        struct timeval tv;
+        tv.tv_sec = REPLAY_TIMEOUT_MS / 1000;
+        tv.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        if (connect(fd, (struct sockaddr*)addr, sizeof(struct sockaddr_in)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+// Drop the responses of server, until the time in us, or wait if UDP.
+int replay_wait(int fd, int type, int64_t until)
+{
+    for (;;) {
+        int64_t now = replay_time_us();
+        if (now >= until) {
+            return 0;
+        }
+
+        int timeout = (int)((until - now + 999) / 1000);
+        if (type != REPLAY_TYPE_RTMP) {
+            usleep((useconds_t)(until - now));
+            continue;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout) <= 0) {
+            continue;
+        }
+
+        char buf[4096];
+        if (recv(fd, buf, sizeof(buf), 0) <= 0) {
+            return -1;
+        }
+    }
+}
+
+int do_replay(replay_capture_t* cap, replay_result_t* r)
+{
+    if (cap->type == REPLAY_TYPE_RTMP && nb_copies > 1 && replay_rename(cap, r->id) != 0) {
+        srs_human_trace("copy %d rename stream failed", r->id);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    int fd = replay_connect(cap->type, r->id, &addr);
+    if (fd < 0) {
+        srs_human_trace("copy %d connect %s failed", r->id, server);
+        return -1;
+    }
+
+    int ret = 0;
+    int64_t starttime = replay_time_us();
+
+    int i;
+    for (i = 0; i < cap->nb_records; i++) {
+        replay_record_t* record = &cap->records[i];
+        char* data = cap->data + record->offset;
+
+        // Send as fast as possible if the rate is 0.
+        int64_t due = starttime + (rate > 0? (int64_t)(record->time / rate) : 0);
+        if ((ret = replay_wait(fd, cap->type, due)) != 0) {
+            srs_human_trace("copy %d closed by server", r->id);
+            break;
+        }
+
+        ssize_t nn;
+        if (cap->type == REPLAY_TYPE_RTMP) {
+            nn = send(fd, data, record->size, 0);
+        } else {
+            nn = sendto(fd, data, record->size, 0, (struct sockaddr*)&addr, sizeof(addr));
+        }
+        if (nn != record->size) {
+            srs_human_trace("copy %d send failed, record=%d", r->id, i);
+            ret = -1;
+            break;
+        }
+
+        int lag = (int)((replay_time_us() - due) / 1000);
+        if (lag > r->max_lag) {
+            r->max_lag = lag;
+        }
+        if (lag > 100) {
+            r->nb_lags++;
+        }
+        r->bytes += record->size;
+        r->records++;
+    }
+
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    printf("replay the ingest sessions captured by SRS, by N copies.\n");
+    printf("srs(ossrs) client librtmp library.\n");
+    printf("version: %d.%d.%d\n", srs_version_major(), srs_version_minor(), srs_version_revision());
+
+    if (argc <= 2) {
+        printf("Usage: %s <-i in_cap_file> <-y server> [-n copies] [-x rate] [-r ramp]\n"
+            "   in_cap_file     the capture file, @see publish.capture of vhost, or capture of stream_caster.\n"
+            "   server          the host:port of server, the RTMP or the MPEG-TS over UDP port.\n"
+            "   copies          the number of copies, each in a process. Default to 1.\n"
+            "                   for RTMP, the last chars of stream are replaced by the index of copy.\n"
+            "                   for MPEG-TS, the copy i is sent to the port+i.\n"
+            "   rate            the speed to replay, 1 is the real time, 0 is as fast as possible. Default to 1.\n"
+            "   ramp            the interval in ms to start each copy. Default to 100.\n"
+            "For example:\n"
+            "   %s -i objs/capture/live/livestream.1602720000000.cap -y 127.0.0.1:1935 -n 100\n"
+            "   %s -i objs/capture/mpegts.1602720000000.cap -y 127.0.0.1:8935 -x 2\n",
+            argv[0], argv[0], argv[0]);
+        exit(-1);
+    }
+
+    int opt;
+    for (opt = 0; opt < argc - 1; opt++) {
+        char* p = argv[opt];
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+        switch (p[1]) {
+            case 'i': in_cap_file = argv[opt + 1]; break;
+            case 'y': server = argv[opt + 1]; break;
+            case 'n': nb_copies = atoi(argv[opt + 1]); break;
+            case 'x': rate = atof(argv[opt + 1]); break;
+            case 'r': ramp = atoi(argv[opt + 1]); break;
+            default: break;
+        }
+    }
+
+    if (!in_cap_file || !server || nb_copies <= 0 || rate < 0) {
+        srs_human_trace("invalid options, see usage");
+        return -1;
+    }
+
+    replay_capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+    if (replay_load(in_cap_file, &cap) != 0 || cap.nb_records <= 0) {
+        srs_human_trace("load capture %s failed", in_cap_file);
+        return -1;
+    }
+    if (cap.type != REPLAY_TYPE_RTMP && cap.type != REPLAY_TYPE_MPEGTS) {
+        srs_human_trace("invalid capture type %d", cap.type);
+        return -1;
+    }
+
+    int64_t duration = cap.records[cap.nb_records - 1].time / 1000;
+    srs_human_trace("load %s, type=%s, records=%d, bytes=%d, duration=%dms", in_cap_file,
+        (cap.type == REPLAY_TYPE_RTMP)? "rtmp" : "mpegts", cap.nb_records, cap.nb_data, (int)duration);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        srs_human_trace("create pipe failed");
+        return -1;
+    }
+
+    srs_human_trace("start %d copies to %s, rate=%.2f", nb_copies, server, rate);
+    int64_t starttime = srs_utils_time_ms();
+
+    int i;
+    fflush(stdout);
+    for (i = 0; i < nb_copies; i++) {
+        if (fork() == 0) {
+            close(fds[0]);
+
+            replay_result_t r;
+            memset(&r, 0, sizeof(r));
+            r.id = i;
+
+            int64_t copy_starttime = srs_utils_time_ms();
+            r.ret = do_replay(&cap, &r);
+            r.elapsed = (int)(srs_utils_time_ms() - copy_starttime);
+
+            // The write is atomic, for the result is less than PIPE_BUF.
+            ssize_t nn = write(fds[1], &r, sizeof(r));
+            exit(nn == sizeof(r)? 0 : -1);
+        }
+        if (ramp > 0) {
+            usleep(ramp * 1000);
+        }
+    }
+    close(fds[1]);
+
+    // Collect the results of copies, until all copies exit.
+    int nb_ok = 0, nb_results = 0, max_lag = 0;
+    int64_t bytes = 0, records = 0, nb_lags = 0;
+    for (;;) {
+        replay_result_t r;
+        if (read(fds[0], &r, sizeof(r)) != sizeof(r)) {
+            break;
+        }
+        nb_results++;
+        if (r.ret == 0) {
+            nb_ok++;
+        }
+        bytes += r.bytes;
+        records += r.records;
+        nb_lags += r.nb_lags;
+        if (r.max_lag > max_lag) {
+            max_lag = r.max_lag;
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    int64_t elapsed = srs_utils_time_ms() - starttime;
+
+    printf("\n");
+    printf("copies: %d, ok=%d, failed=%d, lost=%d\n", nb_copies, nb_ok, nb_results - nb_ok, nb_copies - nb_results);
+    printf("throughput: %d kbps, %" PRId64 " records, %" PRId64 " bytes, elapsed=%dms\n",
+        (int)(elapsed > 0? bytes * 8 / elapsed : 0), records, bytes, (int)elapsed);
+    printf("lag: max=%dms, %" PRId64 " records later than 100ms\n", max_lag, nb_lags);
+
+    free(cap.data);
+    free(cap.records);
+
+    return nb_ok == nb_copies? 0 : -1;
+}
+
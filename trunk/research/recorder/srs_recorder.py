@@ -0,0 +1,116 @@
+#!/usr/bin/python
+'''
+The MIT License (MIT)
+
+Copyright (c) 2013-2020 SRS(ossrs)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+'''
+
+#################################################################################
+# to decode the events of flight recorder, dumped by SIGUSR2 or http api:
+#       curl http://127.0.0.1:1985/api/v1/recorder -o srs.recorder
+#       python srs_recorder.py srs.recorder
+#       python srs_recorder.py srs.recorder --type writev --min-ms 10
+#       python srs_recorder.py srs.recorder --summary
+# @see SrsFlightRecorder of src/kernel/srs_kernel_recorder.hpp
+#################################################################################
+import sys, struct, time, optparse
+
+# @see SrsRecorderHeader and SrsRecorderEvent
+HEADER_FORMAT = "8sIIqqQQiI"
+EVENT_FORMAT = "QqiHHii"
+MAGIC = b"SRSFREC1"
+
+# @see SrsRecorderEventType
+TYPES = {1: "writev", 2: "hook", 3: "fileio", 4: "shrink", 5: "slice"}
+
+def decode(data):
+    if len(data) < struct.calcsize("<" + HEADER_FORMAT) or data[0:8] != MAGIC:
+        raise Exception("invalid magic, not a recorder dump")
+
+    # The dump is in host byte order, detect it by version.
+    order = "<"
+    if struct.unpack("<I", data[8:12])[0] != 1:
+        order = ">"
+
+    hsize = struct.calcsize(order + HEADER_FORMAT)
+    (magic, version, event_size, monotonic, wall, nn_events, nn_total, pid, reserved) = \
+        struct.unpack(order + HEADER_FORMAT, data[0:hsize])
+    if version != 1 or event_size != struct.calcsize(order + EVENT_FORMAT):
+        raise Exception("invalid version=%s, event_size=%s" % (version, event_size))
+
+    header = {"pid": pid, "monotonic": monotonic, "wall": wall, "events": nn_events, "total": nn_total}
+
+    events = []
+    for i in range(nn_events):
+        pos = hsize + i * event_size
+        if pos + event_size > len(data):
+            break
+        (sequence, at, cid, etype, reserved, duration, value) = struct.unpack(order + EVENT_FORMAT, data[pos:pos + event_size])
+        events.append({
+            "sequence": sequence - 1, "cid": cid, "type": TYPES.get(etype, "unknown"), "duration": duration, "value": value,
+            # Convert the monotonic time to wall clock, by the time of dump.
+            "wall": wall - (monotonic - at),
+        })
+    return (header, events)
+
+def format_time(us):
+    return "%s.%03d" % (time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(us // 1000000)), (us // 1000) % 1000)
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] file")
+    parser.add_option("--type", dest="type", default=None, help="only show the type, writev|hook|fileio|shrink|slice")
+    parser.add_option("--min-ms", dest="min_ms", type="float", default=0, help="only show the events not shorter than it")
+    parser.add_option("--summary", dest="summary", action="store_true", default=False, help="summary by type")
+    (options, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.print_help()
+        sys.exit(-1)
+
+    f = open(args[0], "rb")
+    data = f.read()
+    f.close()
+
+    (header, events) = decode(data)
+    print("pid=%s, events=%s, total=%s, dropped=%s, dump at %s" % (header["pid"], header["events"], header["total"],
+        header["total"] - header["events"], format_time(header["wall"])))
+
+    events = [e for e in events if (not options.type or e["type"] == options.type) and e["duration"] >= options.min_ms * 1000]
+    events.sort(key=lambda e: e["wall"])
+
+    if options.summary:
+        stats = {}
+        for e in events:
+            s = stats.setdefault(e["type"], {"count": 0, "sum": 0, "max": 0, "value": 0})
+            s["count"] += 1
+            s["sum"] += e["duration"]
+            s["max"] = max(s["max"], e["duration"])
+            s["value"] += e["value"]
+        print("%-8s %10s %12s %12s %14s" % ("type", "count", "avg_ms", "max_ms", "value"))
+        for k in sorted(stats.keys()):
+            s = stats[k]
+            print("%-8s %10d %12.3f %12.3f %14d" % (k, s["count"], s["sum"] / 1000.0 / s["count"], s["max"] / 1000.0, s["value"]))
+        return
+
+    print("%-23s %-8s %8s %12s %12s" % ("time", "type", "cid", "duration_ms", "value"))
+    for e in events:
+        print("%-23s %-8s %8d %12.3f %12d" % (format_time(e["wall"]), e["type"], e["cid"], e["duration"] / 1000.0, e["value"]))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,328 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_abr.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_config.hpp>
+
+SrsAbrSwitcher::SrsAbrSwitcher(SrsConnection* c, SrsRequest* r)
+{
+    conn = c;
+    req = r->copy();
+    
+    current = 0;
+    source = NULL;
+    target = -1;
+    target_source = NULL;
+    pending = NULL;
+    pending_at = 0;
+    cache = new SrsMessageArray(SRS_PERF_MW_MSGS);
+    meta = vsh = ash = NULL;
+    offset = 0;
+    last_time = -1;
+    
+    down_queue = 0;
+    up_stable = 0;
+    backoff = 1;
+    stable_at = 0;
+    up_at = 0;
+    nn_switches = 0;
+}
+
+SrsAbrSwitcher::~SrsAbrSwitcher()
+{
+    cancel();
+    srs_freep(cache);
+    srs_freep(req);
+}
+
+bool SrsAbrSwitcher::initialize(SrsSource* s)
+{
+    source = s;
+    
+    if (!_srs_config->get_vhost_abr_enabled(req->vhost)) {
+        return false;
+    }
+    
+    vector<string> renditions = _srs_config->get_vhost_abr_renditions(req->vhost);
+    if (renditions.empty()) {
+        return false;
+    }
+    
+    // The rendition is the suffix of stream, so the player of rendition never switches again.
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        if (srs_string_ends_with(req->stream, renditions.at(i))) {
+            return false;
+        }
+    }
+    
+    streams.push_back(req->stream);
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        streams.push_back(req->stream + renditions.at(i));
+    }
+    
+    down_queue = _srs_config->get_vhost_abr_down_queue(req->vhost);
+    up_stable = _srs_config->get_vhost_abr_up_stable(req->vhost);
+    
+    srs_trace("abr: renditions=%d, down_queue=%dms, up_stable=%dms", (int)renditions.size(),
+        srsu2msi(down_queue), srsu2msi(up_stable));
+    
+    return true;
+}
+
+int SrsAbrSwitcher::rendition()
+{
+    return current;
+}
+
+srs_error_t SrsAbrSwitcher::cycle(SrsConsumer*& consumer, bool& switched)
+{
+    srs_error_t err = srs_success;
+    
+    switched = false;
+    
+    if (!pending) {
+        decide(consumer);
+    }
+    
+    if (!pending) {
+        return err;
+    }
+    
+    // Give up when the rendition is unpublished or never got the keyframe.
+    if (target_source->inactive() || srs_get_system_time() - pending_at > SRS_ABR_SWITCH_TIMEOUT) {
+        srs_warn("abr: cancel switch %d=>%d, stream=%s, active=%d", current, target, streams.at(target).c_str(),
+            !target_source->inactive());
+        cancel();
+        return err;
+    }
+    
+    bool ready = false;
+    if ((err = fetch_keyframe(ready)) != srs_success) {
+        return srs_error_wrap(err, "abr fetch keyframe");
+    }
+    
+    if (!ready) {
+        return err;
+    }
+    
+    srs_trace("abr: switch %d=>%d, stream=%s, queue=%dms, offset=%" PRId64 ", switches=%d", current, target,
+        streams.at(target).c_str(), srsu2msi(consumer->duration()), offset, ++nn_switches);
+    
+    if (target < current) {
+        up_at = srs_get_system_time();
+    }
+    
+    // The messages in queue of current consumer are dropped, the player continues from the keyframe.
+    srs_freep(consumer);
+    consumer = pending;
+    pending = NULL;
+    current = target;
+    source = target_source;
+    target = -1;
+    target_source = NULL;
+    stable_at = 0;
+    switched = true;
+    
+    return err;
+}
+
+void SrsAbrSwitcher::rebase(SrsSharedPtrMessage** msgs, int count)
+{
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        msg->timestamp += offset;
+        
+        // The audio before the keyframe of rendition, and the headers, never go back.
+        if (msg->timestamp < last_time) {
+            msg->timestamp = last_time;
+        }
+        last_time = msg->timestamp;
+    }
+}
+
+void SrsAbrSwitcher::decide(SrsConsumer* consumer)
+{
+    srs_utime_t now = srs_get_system_time();
+    srs_utime_t queue = consumer->duration();
+    
+    // Switch to the stream of player, when the rendition is unpublished.
+    if (current > 0 && source->inactive()) {
+        start(0);
+        return;
+    }
+    
+    // Switch down when the queue grows, and hold the next switch up longer if the last one failed.
+    if (queue >= down_queue) {
+        stable_at = 0;
+        if (up_at > 0 && now - up_at < up_stable * backoff) {
+            backoff = srs_min(backoff * 2, SRS_ABR_MAX_BACKOFF);
+        }
+        up_at = 0;
+        
+        for (int i = current + 1; i < (int)streams.size() && !pending; i++) {
+            start(i);
+        }
+        return;
+    }
+    
+    if (queue > down_queue / 4) {
+        stable_at = 0;
+        return;
+    }
+    
+    if (!stable_at) {
+        stable_at = now;
+    }
+    
+    // The last switch up succeed, when it keeps stable for long enough.
+    if (up_at > 0 && now - up_at >= up_stable * backoff) {
+        backoff = 1;
+        up_at = 0;
+    }
+    
+    if (current > 0 && now - stable_at >= up_stable * backoff) {
+        stable_at = 0;
+        for (int i = current - 1; i >= 0 && !pending; i--) {
+            start(i);
+        }
+    }
+}
+
+void SrsAbrSwitcher::start(int index)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* r = req->copy();
+    r->stream = streams.at(index);
+    SrsSource* s = _srs_sources->find(r);
+    srs_freep(r);
+    
+    // Ignore the rendition which is not publishing.
+    if (!s || s->inactive()) {
+        return;
+    }
+    
+    // The metadata and sequence headers are dumped, the gop cache is not, so it starts from the next keyframe.
+    if ((err = s->create_consumer(conn, pending, true, true, false)) != srs_success) {
+        srs_warn("abr: ignore rendition %s, err %s", streams.at(index).c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(pending);
+        return;
+    }
+    
+    target = index;
+    target_source = s;
+    pending_at = srs_get_system_time();
+}
+
+srs_error_t SrsAbrSwitcher::fetch_keyframe(bool& ready)
+{
+    srs_error_t err = srs_success;
+    
+    int count = 0;
+    if ((err = pending->dump_packets(cache, count)) != srs_success) {
+        return srs_error_wrap(err, "dump packets");
+    }
+    
+    // Find the first keyframe, and keep the latest headers before it.
+    int keyframe = -1;
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = cache->msgs[i];
+        cache->msgs[i] = NULL;
+        
+        if (!msg->is_av()) {
+            srs_freep(meta);
+            meta = msg;
+        } else if (msg->is_video() && SrsFlvVideo::sh(msg->payload, msg->size)) {
+            srs_freep(vsh);
+            vsh = msg;
+        } else if (msg->is_audio() && SrsFlvAudio::sh(msg->payload, msg->size)) {
+            srs_freep(ash);
+            ash = msg;
+        } else if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+            cache->msgs[i] = msg;
+            keyframe = i;
+            break;
+        } else {
+            srs_freep(msg);
+        }
+    }
+    
+    if (keyframe < 0) {
+        return err;
+    }
+    
+    // Start from the keyframe, the headers are before it, at the same time.
+    offset = (last_time >= 0)? last_time - cache->msgs[keyframe]->timestamp : 0;
+    
+    SrsSharedPtrMessage* headers[] = {meta, vsh, ash};
+    for (int i = 0; i < 3; i++) {
+        if (headers[i] && (err = pending->enqueue_corrected(headers[i])) != srs_success) {
+            cache->free(count);
+            return srs_error_wrap(err, "enqueue header");
+        }
+        headers[i] = NULL;
+    }
+    meta = vsh = ash = NULL;
+    
+    for (int i = keyframe; i < count; i++) {
+        SrsSharedPtrMessage* msg = cache->msgs[i];
+        cache->msgs[i] = NULL;
+        if ((err = pending->enqueue_corrected(msg)) != srs_success) {
+            cache->free(count);
+            return srs_error_wrap(err, "enqueue message");
+        }
+    }
+    
+    ready = true;
+    
+    return err;
+}
+
+void SrsAbrSwitcher::cancel()
+{
+    srs_freep(pending);
+    target = -1;
+    target_source = NULL;
+    free_headers();
+}
+
+void SrsAbrSwitcher::free_headers()
+{
+    srs_freep(meta);
+    srs_freep(vsh);
+    srs_freep(ash);
+}
+
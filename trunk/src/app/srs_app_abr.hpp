@@ -0,0 +1,116 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_ABR_HPP
+#define SRS_APP_ABR_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+class SrsSource;
+class SrsConsumer;
+class SrsConnection;
+class SrsRequest;
+class SrsSharedPtrMessage;
+class SrsMessageArray;
+
+// The max duration to wait for the keyframe of rendition, then give up the switch.
+#define SRS_ABR_SWITCH_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The max times of up_stable to hold, when the up switches fail again and again.
+#define SRS_ABR_MAX_BACKOFF 8
+
+// The server-side ABR(adaptive bitrate) for RTMP and HTTP-FLV players, which switches the consumer
+// of player in the rendition group, generally the streams transcoded from the stream, @see vhost abr.
+// 1. Switch down when the queue of consumer grows, that is the delivery rate is lower than the bitrate.
+// 2. Switch up when the queue keeps small for a duration, which is doubled when the switch up fails.
+// The switch is GOP-aligned: the consumer of rendition is created without gop cache, and the player
+// keeps playing the current one, until the rendition got a keyframe, then the metadata, sequence headers
+// and the keyframe of rendition are sent, with the timestamp rebased to continue the stream of player.
+class SrsAbrSwitcher
+{
+private:
+    SrsConnection* conn;
+    SrsRequest* req;
+    // The streams of rendition group, from the highest bitrate to lowest, the first one is the stream of player.
+    std::vector<std::string> streams;
+    // The rendition and its source, which the consumer of player is reading.
+    int current;
+    SrsSource* source;
+    // The rendition switching to, whose consumer is waiting for the keyframe, -1 if not switching.
+    int target;
+    SrsSource* target_source;
+    SrsConsumer* pending;
+    srs_utime_t pending_at;
+    // The messages fetched from pending consumer.
+    SrsMessageArray* cache;
+    // The latest metadata and sequence headers of pending consumer, before the keyframe.
+    SrsSharedPtrMessage* meta;
+    SrsSharedPtrMessage* vsh;
+    SrsSharedPtrMessage* ash;
+    // The offset in ms to rebase the timestamp of rendition to the stream of player.
+    int64_t offset;
+    // The timestamp in ms of the last message to player, -1 if nothing sent.
+    int64_t last_time;
+private:
+    // Switch down when the queue of consumer exceeds it.
+    srs_utime_t down_queue;
+    // Switch up when the queue keeps under a quarter of down_queue for it, multiplied by backoff.
+    srs_utime_t up_stable;
+    int backoff;
+    // When the queue starts to be small, 0 if not.
+    srs_utime_t stable_at;
+    // When switched up, to detect the failed up switch.
+    srs_utime_t up_at;
+    // The number of switches.
+    int nn_switches;
+public:
+    SrsAbrSwitcher(SrsConnection* c, SrsRequest* r);
+    virtual ~SrsAbrSwitcher();
+public:
+    // Initialize the switcher for the consumer of source of player.
+    // @return Whether the ABR is enabled for the stream of player.
+    virtual bool initialize(SrsSource* s);
+    // The index of current rendition, 0 is the stream of player.
+    virtual int rendition();
+    // Decide whether to switch by the queue of consumer, and switch it at the keyframe of rendition.
+    // @param consumer The consumer of player, replaced by the consumer of rendition when switched,
+    //      and the old one is freed.
+    // @param switched Whether the consumer is replaced, user should apply the settings to new consumer.
+    virtual srs_error_t cycle(SrsConsumer*& consumer, bool& switched);
+    // Rebase the timestamp of messages dumped from consumer, to keep the stream of player continuous.
+    virtual void rebase(SrsSharedPtrMessage** msgs, int count);
+private:
+    virtual void decide(SrsConsumer* consumer);
+    // Start to switch to the rendition, ignore if not available.
+    virtual void start(int index);
+    // Fetch messages from the pending consumer, until the keyframe.
+    // @param ready Whether got the keyframe, and the pending consumer starts from the headers and the keyframe.
+    virtual srs_error_t fetch_keyframe(bool& ready);
+    virtual void cancel();
+    virtual void free_headers();
+};
+
+#endif
+
@@ -0,0 +1,256 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <srs_app_access_log.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_log.hpp>
+#include <srs_app_statistic.hpp>
+
+SrsAccessLog* _srs_access_log = new SrsAccessLog();
+
+SrsTokenBucket::SrsTokenBucket()
+{
+    rate = 0;
+    burst = 1;
+    tokens = 1;
+    last = 0;
+}
+
+SrsTokenBucket::~SrsTokenBucket()
+{
+}
+
+void SrsTokenBucket::set(int r, int b)
+{
+    rate = r;
+    burst = srs_max(1, b);
+    tokens = burst;
+    last = 0;
+}
+
+bool SrsTokenBucket::consume(srs_utime_t now)
+{
+    if (rate <= 0) {
+        return true;
+    }
+    
+    // Refill the tokens by the elapsed time, up to burst.
+    if (last > 0 && now > last) {
+        tokens += (double)rate * (now - last) / SRS_UTIME_SECONDS;
+        tokens = srs_min((double)burst, tokens);
+    }
+    last = now;
+    
+    if (tokens < 1) {
+        return false;
+    }
+    
+    tokens -= 1;
+    return true;
+}
+
+SrsAccessLog::SrsAccessLog()
+{
+    format = SrsAccessLogFormatJson;
+    writer = NULL;
+    nn_records = nn_sampled = nn_limited = 0;
+}
+
+SrsAccessLog::~SrsAccessLog()
+{
+    srs_freep(writer);
+}
+
+srs_error_t SrsAccessLog::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (writer || !_srs_config->get_access_log_enabled()) {
+        return err;
+    }
+    
+    path = _srs_config->get_access_log_path();
+    format = (_srs_config->get_access_log_format() == "binary")? SrsAccessLogFormatBinary : SrsAccessLogFormatJson;
+    bucket.set(_srs_config->get_access_log_rate(), _srs_config->get_access_log_burst());
+    
+    writer = new SrsAsyncLogWriter();
+    // The drops are counted by metrics, never write the notice to binary records.
+    writer->set_drop_notice(false);
+    if ((err = writer->start(SRS_ACCESS_LOG_RING)) != srs_success) {
+        srs_freep(writer);
+        return srs_error_wrap(err, "start writer");
+    }
+    
+    reopen();
+    
+    srs_trace("access log: path=%s, format=%s, rate=%d, burst=%d", path.c_str(),
+        (format == SrsAccessLogFormatBinary)? "binary" : "json", _srs_config->get_access_log_rate(),
+        _srs_config->get_access_log_burst());
+    
+    return err;
+}
+
+void SrsAccessLog::reopen()
+{
+    if (!writer) {
+        return;
+    }
+    
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if (fd < 0) {
+        srs_warn("access log: open %s failed", path.c_str());
+        return;
+    }
+    
+    // The writer closes the previous fd.
+    writer->set_fd(fd);
+}
+
+void SrsAccessLog::on_session(SrsStatisticClient* client)
+{
+    if (!writer || !client->req) {
+        return;
+    }
+    
+    // Sample by the id of client, which is increasing, so it's about the percent of sessions.
+    int sample = _srs_config->get_vhost_access_log_sample(client->req->vhost);
+    if (client->id % 100 >= sample) {
+        nn_sampled++;
+        return;
+    }
+    
+    srs_utime_t tick = srs_get_monotonic_time();
+    if (!bucket.consume(tick)) {
+        nn_limited++;
+        return;
+    }
+    
+    string v;
+    srs_utime_t now = srs_get_system_time();
+    if (format == SrsAccessLogFormatBinary) {
+        encode_binary(client, now, tick - client->create, v);
+    } else {
+        encode_json(client, now, tick - client->create, v);
+    }
+    
+    writer->write(v.data(), (int)v.length());
+    nn_records++;
+}
+
+int64_t SrsAccessLog::records()
+{
+    return nn_records;
+}
+
+int64_t SrsAccessLog::sampled()
+{
+    return nn_sampled;
+}
+
+int64_t SrsAccessLog::limited()
+{
+    return nn_limited;
+}
+
+int64_t SrsAccessLog::drops()
+{
+    return writer? writer->drops() : 0;
+}
+
+void SrsAccessLog::encode_json(SrsStatisticClient* client, srs_utime_t now, srs_utime_t duration, string& v)
+{
+    SrsRequest* req = client->req;
+    
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.field("time")->integer(srsu2ms(now));
+    jw.field("cid")->integer(client->id);
+    jw.field("type")->str(srs_client_type_string(client->type));
+    jw.field("ip")->str(req->ip);
+    jw.field("vhost")->str(req->vhost);
+    jw.field("app")->str(req->app);
+    jw.field("stream")->str(req->stream);
+    jw.field("duration_ms")->integer(srsu2ms(duration));
+    jw.field("recv_bytes")->integer(client->recv_bytes);
+    jw.field("send_bytes")->integer(client->send_bytes);
+    jw.field("drops")->integer(client->nb_drops);
+    jw.field("frame_drops")->integer(client->nb_frame_drops);
+    jw.field("ttff_ms")->integer(client->ttff < 0? -1 : srsu2ms(client->ttff));
+    jw.object_end();
+    
+    v = jw.dumps();
+    v.append("\n");
+}
+
+void SrsAccessLog::encode_binary(SrsStatisticClient* client, srs_utime_t now, srs_utime_t duration, string& v)
+{
+    SrsRequest* req = client->req;
+    
+    string strs[4];
+    strs[0] = req->ip;
+    strs[1] = req->vhost;
+    strs[2] = req->app;
+    strs[3] = req->stream;
+    
+    int size = 60;
+    for (int i = 0; i < 4; i++) {
+        if ((int)strs[i].length() > SRS_ACCESS_LOG_MAX_STRING) {
+            strs[i] = strs[i].substr(0, SRS_ACCESS_LOG_MAX_STRING);
+        }
+        size += 2 + (int)strs[i].length();
+    }
+    
+    v.resize(size);
+    SrsBuffer buf((char*)v.data(), size);
+    
+    buf.write_2bytes((int16_t)size);
+    buf.write_1bytes(SRS_ACCESS_LOG_VERSION);
+    buf.write_1bytes((int8_t)client->type);
+    buf.write_8bytes(srsu2ms(now));
+    buf.write_4bytes(client->id);
+    buf.write_8bytes(srsu2ms(duration));
+    buf.write_8bytes(client->recv_bytes);
+    buf.write_8bytes(client->send_bytes);
+    buf.write_8bytes(client->nb_drops);
+    buf.write_8bytes(client->nb_frame_drops);
+    buf.write_4bytes(client->ttff < 0? -1 : (int32_t)srsu2ms(client->ttff));
+    
+    for (int i = 0; i < 4; i++) {
+        buf.write_2bytes((int16_t)strs[i].length());
+        buf.write_string(strs[i]);
+    }
+}
+
@@ -0,0 +1,112 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SRS_APP_ACCESS_LOG_HPP
+#define SRS_APP_ACCESS_LOG_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+class SrsAsyncLogWriter;
+struct SrsStatisticClient;
+
+// The ring size of access log writer.
+#define SRS_ACCESS_LOG_RING (1024 * 1024)
+// The max length of each string field in binary record, truncated if exceed.
+#define SRS_ACCESS_LOG_MAX_STRING 1024
+// The version of binary record.
+#define SRS_ACCESS_LOG_VERSION 1
+
+// The format of access log.
+enum SrsAccessLogFormat
+{
+    // One json object for each line.
+    SrsAccessLogFormatJson = 0,
+    // The binary record in network order, see conf/full.conf for layout.
+    SrsAccessLogFormatBinary,
+};
+
+// The token bucket to limit the rate, which is refilled by rate tokens per second up to burst.
+class SrsTokenBucket
+{
+private:
+    int rate;
+    int burst;
+    double tokens;
+    srs_utime_t last;
+public:
+    SrsTokenBucket();
+    virtual ~SrsTokenBucket();
+public:
+    // Set the rate per second and burst, rate 0 for no limit.
+    virtual void set(int r, int b);
+    // Consume a token at now, return false if no token.
+    virtual bool consume(srs_utime_t now);
+};
+
+// The access log, which writes one structured record for each session when the client disconnects,
+// so the log pipeline never parses the free-form trace lines. The records are sampled by vhost and
+// limited by a token bucket, then written by the async log writer thread.
+class SrsAccessLog
+{
+private:
+    SrsAccessLogFormat format;
+    SrsTokenBucket bucket;
+    // The async writer, NULL if disabled.
+    SrsAsyncLogWriter* writer;
+    std::string path;
+private:
+    // The number of records written, sampled out and limited by rate.
+    int64_t nn_records;
+    int64_t nn_sampled;
+    int64_t nn_limited;
+public:
+    SrsAccessLog();
+    virtual ~SrsAccessLog();
+public:
+    // Start the writer thread if enabled.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start();
+    // Reopen the access log file for log rotate.
+    virtual void reopen();
+    // Write the record of session, when the client disconnects.
+    virtual void on_session(SrsStatisticClient* client);
+public:
+    // The number of records written, sampled out, limited by rate and dropped for ring is full.
+    virtual int64_t records();
+    virtual int64_t sampled();
+    virtual int64_t limited();
+    virtual int64_t drops();
+public:
+    // Encode the record of session to v, the now is the wall time of record.
+    virtual void encode_json(SrsStatisticClient* client, srs_utime_t now, srs_utime_t duration, std::string& v);
+    virtual void encode_binary(SrsStatisticClient* client, srs_utime_t now, srs_utime_t duration, std::string& v);
+};
+
+// The global access log.
+extern SrsAccessLog* _srs_access_log;
+
+#endif
+
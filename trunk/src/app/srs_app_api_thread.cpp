@@ -0,0 +1,647 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_api_thread.hpp>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_server.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_app_conn.hpp>
+
+// The monotonic time in srs_utime_t, which is safe for both the ST thread and the API thread.
+static int64_t srs_api_thread_now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * SRS_UTIME_SECONDS + ts.tv_nsec / 1000;
+}
+
+// Get the deadline for pthread_cond_timedwait, which is by the realtime clock.
+static timespec srs_api_thread_deadline(srs_utime_t timeout)
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    
+    int64_t v = (int64_t)ts.tv_sec * SRS_UTIME_SECONDS + ts.tv_nsec / 1000 + timeout;
+    ts.tv_sec = v / SRS_UTIME_SECONDS;
+    ts.tv_nsec = (v % SRS_UTIME_SECONDS) * 1000;
+    return ts;
+}
+
+// Write all bytes to the blocking socket, return false if failed.
+static bool srs_api_thread_write(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t nn = ::write(fd, data, size);
+        if (nn < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nn <= 0) {
+            return false;
+        }
+        data += nn;
+        size -= nn;
+    }
+    return true;
+}
+
+SrsApiSnapshot::SrsApiSnapshot()
+{
+    update_time = 0;
+    refs = 0;
+}
+
+SrsApiSnapshot::~SrsApiSnapshot()
+{
+}
+
+SrsApiCommand::SrsApiCommand(SrsApiCommandType t, int v)
+{
+    type = t;
+    id = v;
+    code = ERROR_SUCCESS;
+    done = false;
+    abandoned = false;
+}
+
+SrsApiCommand::~SrsApiCommand()
+{
+}
+
+SrsApiThread* _srs_api_thread = new SrsApiThread();
+
+SrsApiThread::SrsApiThread()
+{
+    server = NULL;
+    interval = 0;
+    crossdomain = false;
+    lfd = NULL;
+    started = false;
+    quit = false;
+    trd = new SrsDummyCoroutine();
+    
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    snapshot = NULL;
+    last_request = 0;
+    wanted = false;
+    pipes[0] = pipes[1] = -1;
+    pipe_stfd = NULL;
+    
+    nn_requests = nn_snapshots = nn_commands = 0;
+}
+
+SrsApiThread::~SrsApiThread()
+{
+    stop();
+    
+    srs_freep(trd);
+    srs_close_stfd(pipe_stfd);
+    if (pipes[1] > 0) {
+        ::close(pipes[1]);
+    }
+    srs_close_stfd(lfd);
+    
+    srs_freep(snapshot);
+    
+    std::deque<SrsApiCommand*>::iterator it;
+    for (it = commands.begin(); it != commands.end(); ++it) {
+        SrsApiCommand* cmd = *it;
+        srs_freep(cmd);
+    }
+    commands.clear();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+srs_error_t SrsApiThread::start(SrsServer* s)
+{
+    srs_error_t err = srs_success;
+    
+    if (started || !_srs_config->get_http_api_enabled() || !_srs_config->get_http_api_control_enabled()) {
+        return err;
+    }
+    
+    server = s;
+    interval = _srs_config->get_http_api_control_interval();
+    crossdomain = _srs_config->get_http_api_crossdomain();
+    
+    string ip; int port = 0;
+    string ep = _srs_config->get_http_api_control_listen();
+    srs_parse_endpoint(ep, ip, port);
+    if ((err = srs_tcp_listen(ip, port, &lfd)) != srs_success) {
+        return srs_error_wrap(err, "listen %s", ep.c_str());
+    }
+    
+    if (::pipe(pipes) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+    
+    // The thread should never block when notify the coroutine.
+    int flags = ::fcntl(pipes[1], F_GETFL, 0);
+    if (flags == -1 || ::fcntl(pipes[1], F_SETFL, flags | O_NONBLOCK) == -1) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "nonblock pipe");
+    }
+    
+    if ((pipe_stfd = srs_netfd_open(pipes[0])) == NULL) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "open pipe");
+    }
+    
+    // The first snapshot, for the API thread to serve the requests before the first interval.
+    if ((err = publish()) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("api-thread", this, _srs_context->get_id());
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    int r0 = 0;
+    if ((r0 = pthread_create(&tid, NULL, SrsApiThread::pfn, this)) != 0) {
+        return srs_error_new(ERROR_SYSTEM_API_THREAD, "create thread, r0=%d", r0);
+    }
+    started = true;
+    
+    srs_trace("api thread started, listen=%s, interval=%dms", ep.c_str(), srsu2msi(interval));
+    
+    return err;
+}
+
+void SrsApiThread::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(tid, NULL);
+    started = false;
+    
+    trd->stop();
+    
+    srs_trace("api thread stopped, requests=%" PRId64 ", snapshots=%" PRId64 ", commands=%" PRId64,
+        nn_requests, nn_snapshots, nn_commands);
+}
+
+srs_error_t SrsApiThread::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    char buf[64];
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "api thread");
+        }
+        
+        // Wakeup for the commands or the wanted snapshot, or to publish snapshot in interval.
+        ssize_t nn = srs_read(pipe_stfd, buf, sizeof(buf), interval);
+        if (nn <= 0 && (nn == 0 || errno != ETIME)) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "read pipe");
+        }
+        
+        consume();
+        
+        pthread_mutex_lock(&lock);
+        bool active = wanted || srs_api_thread_now() - last_request < SRS_API_THREAD_IDLE_INTERVALS * interval;
+        bool stale = !snapshot || srs_api_thread_now() - snapshot->update_time >= interval;
+        pthread_mutex_unlock(&lock);
+        
+        // Never publish when idle, the API thread wants a fresh one when requested.
+        if (!active || !stale) {
+            continue;
+        }
+        
+        if ((err = publish()) != srs_success) {
+            srs_warn("api thread: ignore publish err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsApiThread::publish()
+{
+    srs_error_t err = srs_success;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsApiSnapshot* v = new SrsApiSnapshot();
+    SrsAutoFree(SrsApiSnapshot, v);
+    
+    if (true) {
+        SrsJsonObject* obj = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, obj);
+        
+        obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+        obj->set("server", SrsJsonAny::integer(stat->server_id()));
+        srs_api_dump_summaries(obj);
+        
+        v->bodies["/api/v1/summaries"] = obj->dumps();
+    }
+    
+    SrsJsonWriter jw;
+    
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
+    jw.field("vhosts")->array_start();
+    if ((err = stat->dumps_vhosts(&jw)) != srs_success) {
+        return srs_error_wrap(err, "dump vhosts");
+    }
+    jw.array_end();
+    jw.object_end();
+    v->bodies["/api/v1/vhosts"] = jw.dumps();
+    
+    jw.clear();
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
+    jw.field("streams")->array_start();
+    if ((err = stat->dumps_streams(&jw)) != srs_success) {
+        return srs_error_wrap(err, "dump streams");
+    }
+    jw.array_end();
+    jw.object_end();
+    v->bodies["/api/v1/streams"] = jw.dumps();
+    
+    // All clients in a page, for the snapshot never pages.
+    jw.clear();
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
+    jw.field("clients")->array_start();
+    int next = -1;
+    if ((err = stat->dumps_clients(&jw, -1, 0, INT_MAX, &next)) != srs_success) {
+        return srs_error_wrap(err, "dump clients");
+    }
+    jw.array_end();
+    jw.object_end();
+    v->bodies["/api/v1/clients"] = jw.dumps();
+    
+    if (true) {
+        stringstream ss;
+        stat->dumps_metrics(ss);
+        v->bodies["/metrics"] = ss.str();
+    }
+    
+    update(v);
+    v = NULL;
+    
+    return err;
+}
+
+void SrsApiThread::update(SrsApiSnapshot* v)
+{
+    v->update_time = srs_api_thread_now();
+    
+    // Replace the latest snapshot, the old one is freed by the last reader.
+    SrsApiSnapshot* old = NULL;
+    pthread_mutex_lock(&lock);
+    old = snapshot;
+    snapshot = v;
+    wanted = false;
+    nn_snapshots++;
+    if (old && old->refs > 0) {
+        old->refs = -old->refs;
+        old = NULL;
+    }
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    srs_freep(old);
+}
+
+void SrsApiThread::consume()
+{
+    std::deque<SrsApiCommand*> cmds;
+    
+    pthread_mutex_lock(&lock);
+    cmds.swap(commands);
+    pthread_mutex_unlock(&lock);
+    
+    std::deque<SrsApiCommand*>::iterator it;
+    for (it = cmds.begin(); it != cmds.end(); ++it) {
+        SrsApiCommand* cmd = *it;
+        int code = execute(cmd);
+        
+        pthread_mutex_lock(&lock);
+        bool abandoned = cmd->abandoned;
+        cmd->code = code;
+        cmd->done = true;
+        nn_commands++;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&lock);
+        
+        if (abandoned) {
+            srs_freep(cmd);
+        }
+    }
+}
+
+int SrsApiThread::execute(SrsApiCommand* cmd)
+{
+    if (cmd->type == SrsApiCommandKick) {
+        SrsStatisticClient* client = SrsStatistic::instance()->find_client(cmd->id);
+        
+        // The client published in process maybe without connection, for example, the UDP caster.
+        if (!client || !client->conn) {
+            return ERROR_RTMP_CLIENT_NOT_FOUND;
+        }
+        
+        client->conn->expire();
+        srs_warn("api thread: kickoff client id=%d ok", cmd->id);
+        return ERROR_SUCCESS;
+    }
+    
+    if (cmd->type == SrsApiCommandReload) {
+        if (!_srs_config->get_raw_api() || !_srs_config->get_raw_api_allow_reload()) {
+            return ERROR_SYSTEM_CONFIG_RAW_DISABLED;
+        }
+        
+        server->on_signal(SRS_SIGNAL_RELOAD);
+        return ERROR_SUCCESS;
+    }
+    
+    return ERROR_SYSTEM_API_THREAD;
+}
+
+void* SrsApiThread::pfn(void* arg)
+{
+    // The signals are always handled by the ST thread.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    SrsApiThread* p = (SrsApiThread*)arg;
+    p->serve_loop();
+    
+    return NULL;
+}
+
+void SrsApiThread::serve_loop()
+{
+    int fd = srs_netfd_fileno(lfd);
+    
+    while (true) {
+        pthread_mutex_lock(&lock);
+        bool stopped = quit;
+        pthread_mutex_unlock(&lock);
+        
+        if (stopped) {
+            return;
+        }
+        
+        // Wakeup in a while to check whether quit.
+        pollfd pd;
+        pd.fd = fd;
+        pd.events = POLLIN;
+        pd.revents = 0;
+        if (::poll(&pd, 1, 100) <= 0) {
+            continue;
+        }
+        
+        int cfd = ::accept(fd, NULL, NULL);
+        if (cfd < 0) {
+            continue;
+        }
+        
+        serve(cfd);
+        ::close(cfd);
+    }
+}
+
+void SrsApiThread::serve(int fd)
+{
+    // The accepted socket is blocking, so we limit the time to serve a client.
+    timeval tv;
+    tv.tv_sec = SRS_API_THREAD_TIMEOUT / SRS_UTIME_SECONDS;
+    tv.tv_usec = SRS_API_THREAD_TIMEOUT % SRS_UTIME_SECONDS;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    // Read the header of request, the body is ignored for all APIs are without body.
+    string header;
+    char buf[1024];
+    while (header.find("\r\n\r\n") == string::npos) {
+        if (header.length() > SRS_API_THREAD_MAX_HEADER) {
+            return;
+        }
+        
+        ssize_t nn = ::read(fd, buf, sizeof(buf));
+        if (nn < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nn <= 0) {
+            return;
+        }
+        header.append(buf, nn);
+    }
+    
+    // Parse the request line, for example, GET /api/v1/streams?callback=x HTTP/1.1
+    string line = header.substr(0, header.find("\r\n"));
+    size_t p0 = line.find(' ');
+    size_t p1 = (p0 == string::npos)? string::npos : line.find(' ', p0 + 1);
+    if (p1 == string::npos) {
+        return;
+    }
+    
+    string method = line.substr(0, p0);
+    string uri = line.substr(p0 + 1, p1 - p0 - 1);
+    string path = uri.substr(0, uri.find('?'));
+    string query = (uri.find('?') == string::npos)? "" : uri.substr(uri.find('?') + 1);
+    if (path.length() > 1 && srs_string_ends_with(path, "/")) {
+        path = path.substr(0, path.length() - 1);
+    }
+    
+    map<string, string> args;
+    srs_parse_query_string(query, args);
+    
+    pthread_mutex_lock(&lock);
+    nn_requests++;
+    pthread_mutex_unlock(&lock);
+    
+    int status = 200;
+    string type = "application/json";
+    string body;
+    SrsApiSnapshot* v = NULL;
+    
+    if (method == "GET" && path == "/api/v1/raw" && args["rpc"] == "reload") {
+        int code = marshal(SrsApiCommandReload, 0);
+        body = "{\"code\":" + srs_int2str(code) + "}";
+    } else if (method == "DELETE" && srs_string_starts_with(path, "/api/v1/clients/")) {
+        int code = marshal(SrsApiCommandKick, ::atoi(path.substr(16).c_str()));
+        body = "{\"code\":" + srs_int2str(code) + "}";
+    } else if (method == "GET" && (v = acquire()) != NULL && v->bodies.find(path) != v->bodies.end()) {
+        if (path == "/metrics") {
+            type = "text/plain; version=0.0.4";
+        }
+    } else {
+        status = 404;
+        type = "text/plain";
+        body = "Not Found";
+    }
+    
+    const string& data = (v && status == 200)? v->bodies[path] : body;
+    
+    // The JSONP is supported by callback, like the API of ST thread.
+    string callback = args["callback"];
+    bool jsonp = !callback.empty() && type == "application/json";
+    size_t size = data.length() + (jsonp? callback.length() + 2 : 0);
+    
+    stringstream ss;
+    ss << "HTTP/1.1 " << status << " " << (status == 200? "OK" : "Not Found") << "\r\n"
+        << "Server: " << RTMP_SIG_SRS_SERVER << "\r\n"
+        << "Content-Type: " << (jsonp? "text/javascript" : type) << "\r\n"
+        << "Content-Length: " << size << "\r\n"
+        << "Connection: close\r\n";
+    if (crossdomain) {
+        ss << "Access-Control-Allow-Origin: *\r\n";
+    }
+    ss << "\r\n";
+    if (jsonp) {
+        ss << callback << "(";
+    }
+    
+    string h = ss.str();
+    if (srs_api_thread_write(fd, h.data(), h.length()) && srs_api_thread_write(fd, data.data(), data.length()) && jsonp) {
+        srs_api_thread_write(fd, ")", 1);
+    }
+    
+    if (v) {
+        release(v);
+    }
+}
+
+int SrsApiThread::marshal(SrsApiCommandType type, int id)
+{
+    SrsApiCommand* cmd = new SrsApiCommand(type, id);
+    
+    pthread_mutex_lock(&lock);
+    commands.push_back(cmd);
+    pthread_mutex_unlock(&lock);
+    
+    notify();
+    
+    timespec ts = srs_api_thread_deadline(SRS_API_THREAD_WAIT);
+    
+    pthread_mutex_lock(&lock);
+    while (!cmd->done && !quit && pthread_cond_timedwait(&cond, &lock, &ts) != ETIMEDOUT) {
+    }
+    bool done = cmd->done;
+    int code = cmd->code;
+    if (!done) {
+        cmd->abandoned = true;
+    }
+    pthread_mutex_unlock(&lock);
+    
+    if (!done) {
+        return ERROR_SYSTEM_API_THREAD;
+    }
+    
+    srs_freep(cmd);
+    return code;
+}
+
+SrsApiSnapshot* SrsApiThread::acquire()
+{
+    int64_t now = srs_api_thread_now();
+    
+    pthread_mutex_lock(&lock);
+    last_request = now;
+    
+    // Wait for a fresh snapshot when stale, for example, the first request after idle.
+    if (!snapshot || now - snapshot->update_time > 2 * interval) {
+        wanted = true;
+        pthread_mutex_unlock(&lock);
+        
+        notify();
+        
+        timespec ts = srs_api_thread_deadline(SRS_API_THREAD_WAIT);
+        
+        pthread_mutex_lock(&lock);
+        while (wanted && !quit && pthread_cond_timedwait(&cond, &lock, &ts) != ETIMEDOUT) {
+        }
+    }
+    
+    SrsApiSnapshot* v = snapshot;
+    if (v) {
+        v->refs++;
+    }
+    pthread_mutex_unlock(&lock);
+    
+    return v;
+}
+
+void SrsApiThread::release(SrsApiSnapshot* v)
+{
+    // The snapshot replaced by ST thread is marked by negative refs, and freed by the last reader.
+    pthread_mutex_lock(&lock);
+    bool free = false;
+    if (v->refs > 0) {
+        v->refs--;
+    } else {
+        v->refs++;
+        free = (v->refs == 0);
+    }
+    pthread_mutex_unlock(&lock);
+    
+    if (free) {
+        srs_freep(v);
+    }
+}
+
+void SrsApiThread::notify()
+{
+    char v = 0;
+    if (::write(pipes[1], &v, 1) < 0) {
+        // Ignore, the pipe is full, the coroutine is notified.
+    }
+}
+
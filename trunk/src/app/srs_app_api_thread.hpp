@@ -0,0 +1,158 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_API_THREAD_HPP
+#define SRS_APP_API_THREAD_HPP
+
+#include <srs_core.hpp>
+
+#include <pthread.h>
+#include <string>
+#include <map>
+#include <deque>
+
+#include <srs_app_st.hpp>
+
+class SrsServer;
+
+// The timeout to recv and send of a request, the thread serves the requests one by one.
+#define SRS_API_THREAD_TIMEOUT (3 * SRS_UTIME_SECONDS)
+// The timeout for the thread to wait for the ST thread, to execute a command or publish a snapshot.
+#define SRS_API_THREAD_WAIT (1 * SRS_UTIME_SECONDS)
+// The max size of request header.
+#define SRS_API_THREAD_MAX_HEADER 8192
+// Stop publishing snapshot when no request for some intervals.
+#define SRS_API_THREAD_IDLE_INTERVALS 10
+
+// The immutable snapshot of statistic, published by the ST thread and served by the API thread.
+class SrsApiSnapshot
+{
+public:
+    // The time when published, by monotonic clock of OS.
+    int64_t update_time;
+    // The JSON or text body of API, by path.
+    std::map<std::string, std::string> bodies;
+    // The references by API thread, protected by the lock of SrsApiThread.
+    int refs;
+public:
+    SrsApiSnapshot();
+    virtual ~SrsApiSnapshot();
+};
+
+// The type of command, marshalled from the API thread to the ST thread.
+enum SrsApiCommandType
+{
+    SrsApiCommandKick = 0,
+    SrsApiCommandReload,
+};
+
+// The mutating command, for example, to kickoff client, which is executed by the ST thread.
+class SrsApiCommand
+{
+public:
+    SrsApiCommandType type;
+    // The client id to kickoff.
+    int id;
+    // The result code, set by ST thread.
+    int code;
+    // Whether executed by ST thread, protected by lock.
+    bool done;
+    // Whether abandoned by API thread for timeout, the ST thread frees it, protected by lock.
+    bool abandoned;
+public:
+    SrsApiCommand(SrsApiCommandType t, int v);
+    virtual ~SrsApiCommand();
+};
+
+// The control plane of HTTP API, served by an OS thread, so the heavy dumps and the aggressive
+// scrapers never delay the media coroutines. The read-only APIs are served from the snapshot
+// published by the ST thread in interval, like RCU, and the mutating APIs are marshalled to
+// the ST thread by a queue.
+// @remark The API thread is an OS thread, so it can never use any ST API or write log.
+class SrsApiThread : virtual public ISrsCoroutineHandler
+{
+private:
+    SrsServer* server;
+    srs_utime_t interval;
+    bool crossdomain;
+    srs_netfd_t lfd;
+    pthread_t tid;
+    bool started;
+    bool quit;
+    SrsCoroutine* trd;
+private:
+    // Protect the snapshot, commands and the stat below.
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // The latest snapshot, the old one is freed when no reference.
+    SrsApiSnapshot* snapshot;
+    // The commands to execute by ST thread.
+    std::deque<SrsApiCommand*> commands;
+    // The time of last request, to stop publishing snapshot when idle.
+    int64_t last_request;
+    // Whether the API thread wants a fresh snapshot.
+    bool wanted;
+    // The pipe to notify the ST thread.
+    int pipes[2];
+    srs_netfd_t pipe_stfd;
+private:
+    int64_t nn_requests;
+    int64_t nn_snapshots;
+    int64_t nn_commands;
+public:
+    SrsApiThread();
+    virtual ~SrsApiThread();
+public:
+    // Listen and start the API thread, and the coroutine to publish snapshot and execute commands.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start(SrsServer* s);
+    virtual void stop();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    // Publish a new snapshot of statistic, for ST thread.
+    virtual srs_error_t publish();
+    virtual void update(SrsApiSnapshot* v);
+    // Execute the commands from API thread, for ST thread.
+    virtual void consume();
+    virtual int execute(SrsApiCommand* cmd);
+private:
+    static void* pfn(void* arg);
+    virtual void serve_loop();
+    // Serve a request of client, for API thread.
+    virtual void serve(int fd);
+    // Marshal the command to ST thread and wait for the result code, for API thread.
+    virtual int marshal(SrsApiCommandType type, int id);
+    // Acquire the fresh snapshot, and release it when done, for API thread.
+    virtual SrsApiSnapshot* acquire();
+    virtual void release(SrsApiSnapshot* v);
+    // Notify the ST thread.
+    virtual void notify();
+};
+
+// The control plane of HTTP API.
+extern SrsApiThread* _srs_api_thread;
+
+#endif
+
@@ -27,6 +27,12 @@ using namespace std;
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_config.hpp>
+
+// The stat of workers, key is the name of worker.
+static std::map<std::string, SrsAsyncCallStat*> _srs_async_call_stats;
 
 ISrsAsyncCallTask::ISrsAsyncCallTask()
 {
@@ -36,18 +42,92 @@ ISrsAsyncCallTask::~ISrsAsyncCallTask()
 {
 }
 
-SrsAsyncCallWorker::SrsAsyncCallWorker()
+string ISrsAsyncCallTask::key()
+{
+    return "";
+}
+
+bool ISrsAsyncCallTask::merge(ISrsAsyncCallTask* /*next*/)
+{
+    return false;
+}
+
+bool ISrsAsyncCallTask::interruptible()
+{
+    return true;
+}
+
+SrsAsyncCallStat::SrsAsyncCallStat()
+{
+    workers = depth = peak = 0;
+    executed = failed = dropped = merged = timeouts = 0;
+}
+
+SrsAsyncCallRunner::SrsAsyncCallRunner(ISrsAsyncCallTask* t)
+{
+    task = t;
+    trd = new SrsDummyCoroutine();
+    done = srs_cond_new();
+    finished = false;
+    result = srs_success;
+}
+
+SrsAsyncCallRunner::~SrsAsyncCallRunner()
+{
+    srs_freep(trd);
+    srs_cond_destroy(done);
+    srs_freep(result);
+}
+
+srs_error_t SrsAsyncCallRunner::run(srs_utime_t timeout, bool& timedout)
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("async-task", this, _srs_context->get_id());
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    if (!finished) {
+        srs_cond_timedwait(done, timeout);
+    }
+    timedout = !finished;
+    
+    // Interrupt the task if timeout, which quits at the next io of it, for example, the http hooks.
+    trd->stop();
+    
+    err = result;
+    result = srs_success;
+    
+    return err;
+}
+
+srs_error_t SrsAsyncCallRunner::cycle()
+{
+    result = task->call();
+    finished = true;
+    srs_cond_signal(done);
+    
+    return srs_success;
+}
+
+SrsAsyncCallLane::SrsAsyncCallLane(SrsAsyncCallWorker* w)
 {
+    worker = w;
     trd = new SrsDummyCoroutine();
+    started = false;
     wait = srs_cond_new();
-    lock = srs_mutex_new();
+    busy = false;
+    idle = srs_cond_new();
 }
 
-SrsAsyncCallWorker::~SrsAsyncCallWorker()
+SrsAsyncCallLane::~SrsAsyncCallLane()
 {
     srs_freep(trd);
     
-    std::vector<ISrsAsyncCallTask*>::iterator it;
+    std::deque<ISrsAsyncCallTask*>::iterator it;
     for (it = tasks.begin(); it != tasks.end(); ++it) {
         ISrsAsyncCallTask* task = *it;
         srs_freep(task);
@@ -55,91 +135,259 @@ SrsAsyncCallWorker::~SrsAsyncCallWorker()
     tasks.clear();
     
     srs_cond_destroy(wait);
-    srs_mutex_destroy(lock);
+    srs_cond_destroy(idle);
 }
 
-srs_error_t SrsAsyncCallWorker::execute(ISrsAsyncCallTask* t)
+srs_error_t SrsAsyncCallLane::start(int cid)
 {
     srs_error_t err = srs_success;
     
-    tasks.push_back(t);
-    srs_cond_signal(wait);
+    if (started) {
+        return err;
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("async", this, cid);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    started = true;
     
     return err;
 }
 
-int SrsAsyncCallWorker::count()
+void SrsAsyncCallLane::notify()
 {
-    return (int)tasks.size();
+    srs_cond_signal(wait);
 }
 
-srs_error_t SrsAsyncCallWorker::start()
+void SrsAsyncCallLane::wait_idle()
 {
-    srs_error_t err = srs_success;
-    
-    srs_freep(trd);
-    trd = new SrsSTCoroutine("async", this, _srs_context->get_id());
-    
-    if ((err = trd->start()) != srs_success) {
-        return srs_error_wrap(err, "coroutine");
+    while (busy) {
+        srs_cond_wait(idle);
     }
-    
-    return err;
 }
 
-void SrsAsyncCallWorker::stop()
+void SrsAsyncCallLane::stop()
 {
-    flush_tasks();
     srs_cond_signal(wait);
     trd->stop();
+    started = false;
 }
 
-srs_error_t SrsAsyncCallWorker::cycle()
+srs_error_t SrsAsyncCallLane::cycle()
 {
     srs_error_t err = srs_success;
     
     while (true) {
         if ((err = trd->pull()) != srs_success) {
-            return srs_error_wrap(err, "async call worker");
+            return srs_error_wrap(err, "async call lane");
         }
         
         if (tasks.empty()) {
             srs_cond_wait(wait);
+            continue;
         }
-
-        flush_tasks();
+        
+        ISrsAsyncCallTask* task = tasks.front();
+        tasks.pop_front();
+        
+        busy = true;
+        worker->call(task);
+        busy = false;
+        srs_cond_signal(idle);
     }
     
     return err;
 }
 
-void SrsAsyncCallWorker::flush_tasks()
+SrsAsyncCallWorker::SrsAsyncCallWorker(string n)
+{
+    name = n;
+    cid = 0;
+    max_tasks = 0;
+    timeout = 0;
+    
+    if (_srs_async_call_stats.find(name) == _srs_async_call_stats.end()) {
+        _srs_async_call_stats[name] = new SrsAsyncCallStat();
+    }
+    stat = _srs_async_call_stats[name];
+    stat->workers++;
+}
+
+SrsAsyncCallWorker::~SrsAsyncCallWorker()
+{
+    stat->depth -= count();
+    stat->workers--;
+    
+    std::vector<SrsAsyncCallLane*>::iterator it;
+    for (it = lanes.begin(); it != lanes.end(); ++it) {
+        SrsAsyncCallLane* lane = *it;
+        srs_freep(lane);
+    }
+    lanes.clear();
+}
+
+srs_error_t SrsAsyncCallWorker::execute(ISrsAsyncCallTask* t)
 {
     srs_error_t err = srs_success;
+    
+    SrsAsyncCallLane* lane = lane_of(t->key());
+    std::deque<ISrsAsyncCallTask*>& tasks = lane->tasks;
+    
+    // Merge to the queued task of the same key, for example, the stale notify of stream.
+    std::deque<ISrsAsyncCallTask*>::reverse_iterator it;
+    for (it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        ISrsAsyncCallTask* task = *it;
+        if (task->key() == t->key() && task->merge(t)) {
+            stat->merged++;
+            srs_freep(t);
+            return err;
+        }
+    }
+    
+    // Drop the oldest task when the lane is full, for example, the callback server is down.
+    if (max_tasks > 0 && (int)tasks.size() >= max_tasks) {
+        ISrsAsyncCallTask* task = tasks.front();
+        tasks.pop_front();
+        
+        srs_warn("async: %s drop %s, tasks=%d", name.c_str(), task->to_string().c_str(), (int)tasks.size());
+        srs_freep(task);
+        
+        stat->depth--;
+        stat->dropped++;
+    }
+    
+    tasks.push_back(t);
+    stat->depth++;
+    stat->peak = srs_max(stat->peak, stat->depth);
+    
+    if ((err = lane->start(cid)) != srs_success) {
+        return srs_error_wrap(err, "start lane");
+    }
+    lane->notify();
+    
+    return err;
+}
 
-    // Avoid the async call blocking other coroutines.
-    std::vector<ISrsAsyncCallTask*> copy;
-    if (true) {
-        SrsLocker(lock);
+int SrsAsyncCallWorker::count()
+{
+    int nn = 0;
+    for (int i = 0; i < (int)lanes.size(); i++) {
+        nn += (int)lanes.at(i)->tasks.size();
+    }
+    return nn;
+}
 
-        if (tasks.empty()) {
-            return;
+srs_error_t SrsAsyncCallWorker::start()
+{
+    srs_error_t err = srs_success;
+    
+    cid = _srs_context->get_id();
+    
+    // The coroutine of lane is started when got a task.
+    int nn_lanes = 1;
+    if (_srs_config) {
+        nn_lanes = _srs_config->get_async_call_lanes();
+        max_tasks = _srs_config->get_async_call_max_tasks();
+        timeout = _srs_config->get_async_call_timeout();
+    }
+    
+    while ((int)lanes.size() < nn_lanes) {
+        lanes.push_back(new SrsAsyncCallLane(this));
+    }
+    
+    // Start the lanes which already got tasks.
+    for (int i = 0; i < (int)lanes.size(); i++) {
+        SrsAsyncCallLane* lane = lanes.at(i);
+        if (!lane->tasks.empty() && (err = lane->start(cid)) != srs_success) {
+            return srs_error_wrap(err, "start lane");
         }
+    }
+    
+    return err;
+}
 
-        copy = tasks;
-        tasks.clear();
+void SrsAsyncCallWorker::stop()
+{
+    for (int i = 0; i < (int)lanes.size(); i++) {
+        SrsAsyncCallLane* lane = lanes.at(i);
+        lane->wait_idle();
+        flush_tasks(lane);
+        lane->stop();
     }
+}
 
-    std::vector<ISrsAsyncCallTask*>::iterator it;
-    for (it = copy.begin(); it != copy.end(); ++it) {
-        ISrsAsyncCallTask* task = *it;
+void SrsAsyncCallWorker::call(ISrsAsyncCallTask* task)
+{
+    srs_error_t err = srs_success;
+    
+    stat->depth--;
+    stat->executed++;
+    
+    bool timedout = false;
+    if (timeout <= 0 || !task->interruptible()) {
+        err = task->call();
+    } else {
+        SrsAsyncCallRunner runner(task);
+        err = runner.run(timeout, timedout);
+    }
+    
+    if (timedout) {
+        stat->timeouts++;
+        srs_warn("async: %s timeout %dms, %s", name.c_str(), srsu2msi(timeout), task->to_string().c_str());
+    }
+    
+    if (err != srs_success) {
+        stat->failed++;
+        srs_warn("ignore task failed %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    srs_freep(task);
+}
 
-        if ((err = task->call()) != srs_success) {
-            srs_warn("ignore task failed %s", srs_error_desc(err).c_str());
-            srs_freep(err);
-        }
-        srs_freep(task);
+void SrsAsyncCallWorker::dumps(SrsJsonObject* obj)
+{
+    std::map<std::string, SrsAsyncCallStat*>::iterator it;
+    for (it = _srs_async_call_stats.begin(); it != _srs_async_call_stats.end(); ++it) {
+        SrsAsyncCallStat* s = it->second;
+        obj->set(it->first, SrsJsonAny::object()
+            ->set("workers", SrsJsonAny::integer(s->workers))
+            ->set("depth", SrsJsonAny::integer(s->depth))
+            ->set("peak", SrsJsonAny::integer(s->peak))
+            ->set("executed", SrsJsonAny::integer(s->executed))
+            ->set("failed", SrsJsonAny::integer(s->failed))
+            ->set("dropped", SrsJsonAny::integer(s->dropped))
+            ->set("merged", SrsJsonAny::integer(s->merged))
+            ->set("timeouts", SrsJsonAny::integer(s->timeouts)));
     }
 }
 
+SrsAsyncCallLane* SrsAsyncCallWorker::lane_of(string key)
+{
+    if (lanes.empty()) {
+        lanes.push_back(new SrsAsyncCallLane(this));
+    }
+    
+    uint32_t hash = 0;
+    for (int i = 0; i < (int)key.length(); i++) {
+        hash = hash * 31 + (uint8_t)key.at(i);
+    }
+    
+    return lanes.at(hash % lanes.size());
+}
 
+void SrsAsyncCallWorker::flush_tasks(SrsAsyncCallLane* lane)
+{
+    // Avoid the async call blocking other coroutines.
+    std::deque<ISrsAsyncCallTask*> copy;
+    copy.swap(lane->tasks);
+    
+    std::deque<ISrsAsyncCallTask*>::iterator it;
+    for (it = copy.begin(); it != copy.end(); ++it) {
+        ISrsAsyncCallTask* task = *it;
+        call(task);
+    }
+}
@@ -28,9 +28,14 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <map>
 
 #include <srs_app_thread.hpp>
 
+class SrsJsonObject;
+class SrsAsyncCallWorker;
+
 // The async call for http hooks, for the http hooks will switch st-thread,
 // so we must use isolate thread to avoid the thread corrupt,
 // for example, when dvr call http hooks, the video receive thread got
@@ -49,21 +54,101 @@ public:
     // Convert task to string to describe it.
     // It's used for logger.
     virtual std::string to_string() = 0;
+    // The key to partition the tasks to lanes, the tasks of the same key are executed in order.
+    // @remark The default key is empty, so all tasks of worker run in the same lane.
+    virtual std::string key();
+    // Merge the next task of the same key into this one, which is queued and not executed yet.
+    // @return true if merged, then the next one is dropped.
+    // @remark The default is never merge.
+    virtual bool merge(ISrsAsyncCallTask* next);
+    // Whether the task is interrupted when timeout, for example, the http hooks.
+    // @remark The task which writes file should never be interrupted.
+    virtual bool interruptible();
+};
+
+// The stat of async call workers of the same name, for example, the hls workers of all streams.
+struct SrsAsyncCallStat
+{
+    int workers;
+    // The queued tasks, and the max of it.
+    int depth;
+    int peak;
+    int64_t executed;
+    int64_t failed;
+    int64_t dropped;
+    int64_t merged;
+    int64_t timeouts;
+    SrsAsyncCallStat();
+};
+
+// The one-shot coroutine to execute a task, to interrupt it when timeout.
+class SrsAsyncCallRunner : public ISrsCoroutineHandler
+{
+private:
+    ISrsAsyncCallTask* task;
+    SrsCoroutine* trd;
+    srs_cond_t done;
+    bool finished;
+    srs_error_t result;
+public:
+    SrsAsyncCallRunner(ISrsAsyncCallTask* t);
+    virtual ~SrsAsyncCallRunner();
+public:
+    // Execute the task and wait for it, interrupt it when timeout.
+    // @param timedout Whether the task is interrupted for timeout.
+    virtual srs_error_t run(srs_utime_t timeout, bool& timedout);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+// The lane of worker, which executes its tasks one by one in a coroutine.
+class SrsAsyncCallLane : public ISrsCoroutineHandler
+{
+private:
+    SrsAsyncCallWorker* worker;
+    SrsCoroutine* trd;
+    bool started;
+    srs_cond_t wait;
+    // Whether executing a task, and the cond to wait for it done.
+    bool busy;
+    srs_cond_t idle;
+public:
+    std::deque<ISrsAsyncCallTask*> tasks;
+public:
+    SrsAsyncCallLane(SrsAsyncCallWorker* w);
+    virtual ~SrsAsyncCallLane();
+public:
+    // Start the coroutine of lane, ignore if started.
+    virtual srs_error_t start(int cid);
+    virtual void notify();
+    // Wait for the executing task done, to keep the order of tasks when flush.
+    virtual void wait_idle();
+    virtual void stop();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
 };
 
 // The async callback for dvr, callback and other async worker.
 // When worker call with the task, the worker will do it in isolate thread.
 // That is, the task is execute/call in async mode.
-class SrsAsyncCallWorker : public ISrsCoroutineHandler
+// The tasks are dispatched to lanes by key, so a slow task only blocks the tasks in its lane,
+// and the queue of lane is bounded, the queued task is merged by the next one, or dropped if full.
+class SrsAsyncCallWorker
 {
 private:
-    SrsCoroutine* trd;
-protected:
-    std::vector<ISrsAsyncCallTask*> tasks;
-    srs_cond_t wait;
-    srs_mutex_t lock;
+    std::string name;
+    int cid;
+    std::vector<SrsAsyncCallLane*> lanes;
+    // The max queued tasks of a lane, 0 for no limit.
+    int max_tasks;
+    // The timeout of task, 0 for no timeout.
+    srs_utime_t timeout;
+    SrsAsyncCallStat* stat;
 public:
-    SrsAsyncCallWorker();
+    // @param n The name of worker, for coroutine and stat.
+    SrsAsyncCallWorker(std::string n = "async");
     virtual ~SrsAsyncCallWorker();
 public:
     virtual srs_error_t execute(ISrsAsyncCallTask* t);
@@ -71,11 +156,14 @@ public:
 public:
     virtual srs_error_t start();
     virtual void stop();
-// Interface ISrsReusableThreadHandler
 public:
-    virtual srs_error_t cycle();
+    // Execute the task with timeout, and free it.
+    virtual void call(ISrsAsyncCallTask* task);
+    // Dumps the stat of all async call workers.
+    static void dumps(SrsJsonObject* obj);
 private:
-    virtual void flush_tasks();
+    virtual SrsAsyncCallLane* lane_of(std::string key);
+    virtual void flush_tasks(SrsAsyncCallLane* lane);
 };
 
 #endif
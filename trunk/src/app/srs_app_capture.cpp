@@ -0,0 +1,317 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_capture.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_service_st.hpp>
+
+// The size of header and the head of record, in bytes.
+#define SRS_CAPTURE_HEADER_SIZE 8
+#define SRS_CAPTURE_RECORD_SIZE 12
+
+SrsCaptureWriter::SrsCaptureWriter(SrsCaptureType t)
+{
+    type = t;
+    fw = new SrsFileWriter();
+    starttime = -1;
+    nn_records = 0;
+    nn_bytes = 0;
+}
+
+SrsCaptureWriter::~SrsCaptureWriter()
+{
+    if (nn_records > 0) {
+        srs_trace("capture: close %s, records=%" PRId64 ", bytes=%" PRId64, path.c_str(), nn_records, nn_bytes);
+    }
+    
+    fw->close();
+    srs_freep(fw);
+}
+
+srs_error_t SrsCaptureWriter::open(string p)
+{
+    srs_error_t err = srs_success;
+    
+    path = p;
+    
+    string dir = srs_path_dirname(path);
+    if ((err = srs_create_dir_recursively(dir)) != srs_success) {
+        return srs_error_wrap(err, "create dir %s", dir.c_str());
+    }
+    
+    // The records are small, for example, a read of socket, so write the file in large block.
+    fw->set_buffer(SRS_CAPTURE_MAX_PENDING, false);
+    if ((err = fw->open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+    
+    char header[SRS_CAPTURE_HEADER_SIZE];
+    SrsBuffer stream(header, sizeof(header));
+    stream.write_bytes((char*)SRS_CAPTURE_MAGIC, 4);
+    stream.write_1bytes(SRS_CAPTURE_VERSION);
+    stream.write_1bytes(type);
+    stream.write_2bytes(0);
+    
+    if ((err = fw->write(header, sizeof(header), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+    
+    srs_trace("capture: open %s, type=%d", path.c_str(), type);
+    
+    return err;
+}
+
+srs_error_t SrsCaptureWriter::write(srs_utime_t at, char* buf, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if (starttime < 0) {
+        starttime = at;
+    }
+    
+    char head[SRS_CAPTURE_RECORD_SIZE];
+    SrsBuffer stream(head, sizeof(head));
+    stream.write_8bytes(srs_max(0, at - starttime));
+    stream.write_4bytes(size);
+    
+    if ((err = fw->write(head, sizeof(head), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write record");
+    }
+    if ((err = fw->write(buf, size, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write bytes");
+    }
+    
+    nn_records++;
+    nn_bytes += size;
+    
+    return err;
+}
+
+int64_t SrsCaptureWriter::records()
+{
+    return nn_records;
+}
+
+SrsCaptureReadWriter::SrsCaptureReadWriter(SrsStSocket* s)
+{
+    skt = s;
+    writer = NULL;
+    pending = true;
+    cache = new SrsSimpleStream();
+}
+
+SrsCaptureReadWriter::~SrsCaptureReadWriter()
+{
+    srs_freep(writer);
+    srs_freep(cache);
+}
+
+srs_error_t SrsCaptureReadWriter::start(string path)
+{
+    srs_error_t err = srs_success;
+    
+    if (writer || !pending) {
+        return err;
+    }
+    pending = false;
+    
+    writer = new SrsCaptureWriter(SrsCaptureTypeRtmp);
+    if ((err = writer->open(path)) != srs_success) {
+        stop();
+        return srs_error_wrap(err, "open capture");
+    }
+    
+    char* p = cache->bytes();
+    for (int i = 0; i < (int)cache_records.size(); i++) {
+        std::pair<srs_utime_t, int>& record = cache_records.at(i);
+        if ((err = writer->write(record.first, p, record.second)) != srs_success) {
+            stop();
+            return srs_error_wrap(err, "write capture");
+        }
+        p += record.second;
+    }
+    
+    cache->erase(cache->length());
+    cache_records.clear();
+    
+    return err;
+}
+
+void SrsCaptureReadWriter::stop()
+{
+    pending = false;
+    srs_freep(writer);
+    
+    cache->erase(cache->length());
+    cache_records.clear();
+}
+
+void SrsCaptureReadWriter::capture(char* buf, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if (size <= 0 || (!writer && !pending)) {
+        return;
+    }
+    
+    // The arrival time must be accurate, for the jitter of encoder is what we capture.
+    srs_utime_t now = srs_update_system_time();
+    
+    if (writer) {
+        if ((err = writer->write(now, buf, size)) != srs_success) {
+            srs_warn("capture: stop for err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            stop();
+        }
+        return;
+    }
+    
+    if (cache->length() + size > SRS_CAPTURE_MAX_PENDING) {
+        srs_warn("capture: drop for %d bytes not identified", cache->length() + size);
+        stop();
+        return;
+    }
+    
+    cache->append(buf, size);
+    cache_records.push_back(std::make_pair(now, size));
+}
+
+void SrsCaptureReadWriter::set_recv_timeout(srs_utime_t tm)
+{
+    skt->set_recv_timeout(tm);
+}
+
+srs_utime_t SrsCaptureReadWriter::get_recv_timeout()
+{
+    return skt->get_recv_timeout();
+}
+
+srs_error_t SrsCaptureReadWriter::read_fully(void* buf, size_t size, ssize_t* nread)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nn = 0;
+    err = skt->read_fully(buf, size, &nn);
+    capture((char*)buf, (int)nn);
+    
+    if (nread) {
+        *nread = nn;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsCaptureReadWriter::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nn = 0;
+    err = skt->readv(iov, iov_size, &nn);
+    
+    ssize_t left = nn;
+    for (int i = 0; i < iov_size && left > 0; i++) {
+        int size = (int)srs_min(left, (ssize_t)iov[i].iov_len);
+        capture((char*)iov[i].iov_base, size);
+        left -= size;
+    }
+    
+    if (nread) {
+        *nread = nn;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsCaptureReadWriter::read(void* buf, size_t size, ssize_t* nread)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nn = 0;
+    err = skt->read(buf, size, &nn);
+    capture((char*)buf, (int)nn);
+    
+    if (nread) {
+        *nread = nn;
+    }
+    
+    return err;
+}
+
+void SrsCaptureReadWriter::set_send_timeout(srs_utime_t tm)
+{
+    skt->set_send_timeout(tm);
+}
+
+srs_utime_t SrsCaptureReadWriter::get_send_timeout()
+{
+    return skt->get_send_timeout();
+}
+
+int64_t SrsCaptureReadWriter::get_recv_bytes()
+{
+    return skt->get_recv_bytes();
+}
+
+int64_t SrsCaptureReadWriter::get_send_bytes()
+{
+    return skt->get_send_bytes();
+}
+
+srs_error_t SrsCaptureReadWriter::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    return skt->write(buf, size, nwrite);
+}
+
+srs_error_t SrsCaptureReadWriter::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
+{
+    return skt->writev(iov, iov_size, nwrite);
+}
+
+srs_error_t SrsCaptureReadWriter::enable_zerocopy()
+{
+    return skt->enable_zerocopy();
+}
+
+srs_error_t SrsCaptureReadWriter::writev_zerocopy(const iovec* iov, int iov_size, uint32_t* pid, ssize_t* nwrite)
+{
+    return skt->writev_zerocopy(iov, iov_size, pid, nwrite);
+}
+
+srs_error_t SrsCaptureReadWriter::reap_zerocopy()
+{
+    return skt->reap_zerocopy();
+}
+
+bool SrsCaptureReadWriter::zerocopy_completed(uint32_t id)
+{
+    return skt->zerocopy_completed(id);
+}
+
@@ -0,0 +1,123 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_CAPTURE_HPP
+#define SRS_APP_CAPTURE_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+#include <srs_protocol_io.hpp>
+
+class SrsFileWriter;
+class SrsStSocket;
+class SrsSimpleStream;
+
+// The magic of capture file.
+#define SRS_CAPTURE_MAGIC "SCAP"
+#define SRS_CAPTURE_VERSION 1
+// The max bytes to cache before the session is identified, the capture is dropped if exceeds.
+#define SRS_CAPTURE_MAX_PENDING (64 * 1024)
+
+// The type of bytes in capture file.
+enum SrsCaptureType
+{
+    // The bytes of a TCP connection of RTMP, from the handshake.
+    SrsCaptureTypeRtmp = 1,
+    // The datagrams of MPEG-TS over UDP, each record is a datagram.
+    SrsCaptureTypeMpegts = 2,
+};
+
+// The writer of capture file, the raw bytes and the arrival time of an ingest session, which is
+// replayed by research/librtmp/srs_replay. All numbers are in big-endian, the file is:
+//      header: 4B magic "SCAP", 1B version, 1B type, 2B reserved.
+//      record: 8B arrival time in us since the first record, 4B size, then the bytes.
+class SrsCaptureWriter
+{
+private:
+    SrsCaptureType type;
+    SrsFileWriter* fw;
+    std::string path;
+    // The arrival time of the first record, -1 if no record.
+    srs_utime_t starttime;
+    int64_t nn_records;
+    int64_t nn_bytes;
+public:
+    SrsCaptureWriter(SrsCaptureType t);
+    virtual ~SrsCaptureWriter();
+public:
+    // Open the file and write the header, the dir is created if not exists.
+    virtual srs_error_t open(std::string p);
+    // Write the bytes arrived at the time.
+    virtual srs_error_t write(srs_utime_t at, char* buf, int size);
+    virtual int64_t records();
+};
+
+// The io to capture the bytes read from the RTMP client. The bytes are cached before the session is
+// identified, then written to file when start to capture the publisher, or dropped when stop.
+// @remark The error of capture never fails the session, it's only warned and the capture is stopped.
+class SrsCaptureReadWriter : public ISrsProtocolReadWriter, public ISrsZeroCopyWriter
+{
+private:
+    SrsStSocket* skt;
+    SrsCaptureWriter* writer;
+    // Whether cache the bytes, before start or stop.
+    bool pending;
+    SrsSimpleStream* cache;
+    // The arrival time and size of cached bytes.
+    std::vector< std::pair<srs_utime_t, int> > cache_records;
+public:
+    SrsCaptureReadWriter(SrsStSocket* s);
+    virtual ~SrsCaptureReadWriter();
+public:
+    // Start to capture to the file, with the cached bytes. Ignore if started.
+    virtual srs_error_t start(std::string path);
+    // Stop to capture and drop the cached bytes, for example, the client is a player.
+    virtual void stop();
+private:
+    virtual void capture(char* buf, int size);
+// Interface ISrsProtocolReadWriter
+public:
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual srs_utime_t get_recv_timeout();
+    virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread);
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+    virtual void set_send_timeout(srs_utime_t tm);
+    virtual srs_utime_t get_send_timeout();
+    virtual int64_t get_recv_bytes();
+    virtual int64_t get_send_bytes();
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+    virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsZeroCopyWriter
+public:
+    virtual srs_error_t enable_zerocopy();
+    virtual srs_error_t writev_zerocopy(const iovec* iov, int iov_size, uint32_t* pid, ssize_t* nwrite);
+    virtual srs_error_t reap_zerocopy();
+    virtual bool zerocopy_completed(uint32_t id);
+};
+
+#endif
+
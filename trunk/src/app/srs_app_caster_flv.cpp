@@ -41,12 +41,75 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtmp_conn.hpp>
-#include <srs_protocol_utility.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_ingest_native.hpp>
+#include <srs_service_http_conn.hpp>
+
+// The max bytes of body to decode once, which is limited by the buffer of connection.
+#define SRS_HTTP_CASTER_SLICE (64 * 1024)
+// The hold window in ms of bridge, to sort the messages of ts by dts.
+#define SRS_HTTP_CASTER_HOLD 300
 
-#define SRS_HTTP_FLV_STREAM_BUFFER 4096
+// Read size bytes of body to buf, from the buffer of connection.
+static srs_error_t srs_http_read_fully(SrsHttpResponseReader* rr, char* buf, int size)
+{
+    srs_error_t err = srs_success;
+    
+    int nb_read = 0;
+    while (nb_read < size) {
+        char* p = NULL;
+        ssize_t nn = 0;
+        if ((err = rr->read_slice(size - nb_read, &p, &nn)) != srs_success) {
+            return srs_error_wrap(err, "read slice");
+        }
+        
+        if (nn <= 0) {
+            return srs_error_new(ERROR_HTTP_REQUEST_EOF, "EOF, read=%d, size=%d", nb_read, size);
+        }
+        
+        memcpy(buf + nb_read, p, nn);
+        nb_read += (int)nn;
+    }
+    
+    return err;
+}
+
+// Read size bytes of body in place, or copy to buf when the bytes are not contiguous in the buffer
+// of connection, for example, the last chunk ends in the middle.
+// @param pdata The bytes read, which is valid until next read, NULL when EOF before any byte.
+static srs_error_t srs_http_read_bytes(SrsHttpResponseReader* rr, char* buf, int size, char** pdata)
+{
+    srs_error_t err = srs_success;
+    
+    *pdata = NULL;
+    
+    char* p = NULL;
+    ssize_t nn = 0;
+    if ((err = rr->read_slice(size, &p, &nn)) != srs_success) {
+        return srs_error_wrap(err, "read slice");
+    }
+    
+    if (nn <= 0) {
+        return err;
+    }
+    
+    if (nn == size) {
+        *pdata = p;
+        return err;
+    }
+    
+    memcpy(buf, p, nn);
+    if ((err = srs_http_read_fully(rr, buf + nn, size - (int)nn)) != srs_success) {
+        return srs_error_wrap(err, "read fully");
+    }
+    *pdata = buf;
+    
+    return err;
+}
 
-SrsAppCasterFlv::SrsAppCasterFlv(SrsConfDirective* c)
+SrsAppCasterFlv::SrsAppCasterFlv(ISrsSourceHandler* h, SrsConfDirective* c)
 {
+    handler = h;
     http_mux = new SrsHttpServeMux();
     output = _srs_config->get_stream_caster_output(c);
     manager = new SrsCoroutineManager();
@@ -54,6 +117,10 @@ SrsAppCasterFlv::SrsAppCasterFlv(SrsConfDirective* c)
 
 SrsAppCasterFlv::~SrsAppCasterFlv()
 {
+    // The caster is owned by the listener, so never free it by the mux.
+    if (entry) {
+        entry->handler = NULL;
+    }
     srs_freep(http_mux);
     srs_freep(manager);
 }
@@ -82,7 +149,7 @@ srs_error_t SrsAppCasterFlv::on_tcp_client(srs_netfd_t stfd)
         srs_warn("empty ip for fd=%d", srs_netfd_fileno(stfd));
     }
 
-    SrsHttpConn* conn = new SrsDynamicHttpConn(this, stfd, http_mux, ip);
+    SrsHttpConn* conn = new SrsDynamicHttpConn(this, stfd, http_mux, ip, handler);
     conns.push_back(conn);
     
     if ((err = conn->start()) != srs_success) {
@@ -128,6 +195,8 @@ srs_error_t SrsAppCasterFlv::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     // remove the extension.
     if (srs_string_ends_with(o, ".flv")) {
         o = o.substr(0, o.length() - 4);
+    } else if (srs_string_ends_with(o, ".ts")) {
+        o = o.substr(0, o.length() - 3);
     }
     
     srs_error_t err = conn->proxy(w, r, o);
@@ -138,16 +207,16 @@ srs_error_t SrsAppCasterFlv::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     return err;
 }
 
-SrsDynamicHttpConn::SrsDynamicHttpConn(IConnectionManager* cm, srs_netfd_t fd, SrsHttpServeMux* m, string cip)
+SrsDynamicHttpConn::SrsDynamicHttpConn(IConnectionManager* cm, srs_netfd_t fd, SrsHttpServeMux* m, string cip, ISrsSourceHandler* h)
 : SrsHttpConn(cm, fd, m, cip)
 {
-    sdk = NULL;
+    publisher = new SrsLocalPublisher(h);
     pprint = SrsPithyPrint::create_caster();
 }
 
 SrsDynamicHttpConn::~SrsDynamicHttpConn()
 {
-    srs_freep(sdk);
+    srs_freep(publisher);
     srs_freep(pprint);
 }
 
@@ -161,85 +230,104 @@ srs_error_t SrsDynamicHttpConn::proxy(ISrsHttpResponseWriter* w, ISrsHttpMessage
     srs_error_t err = srs_success;
     
     output = o;
-    srs_trace("flv: proxy %s to %s", r->uri().c_str(), output.c_str());
-    
-    char* buffer = new char[SRS_HTTP_FLV_STREAM_BUFFER];
-    SrsAutoFreeA(char, buffer);
+    bool ts = srs_string_ends_with(r->path(), ".ts");
+    srs_trace("flv: proxy %s to %s, ts=%d", r->uri().c_str(), output.c_str(), ts);
     
-    ISrsHttpResponseReader* rr = r->body_reader();
-    SrsHttpFileReader reader(rr);
-    SrsFlvDecoder dec;
-    
-    if ((err = dec.initialize(&reader)) != srs_success) {
-        return srs_error_wrap(err, "init decoder");
-    }
-    
-    char header[9];
-    if ((err = dec.read_header(header)) != srs_success) {
-        return srs_error_wrap(err, "read header");
-    }
+    SrsHttpResponseReader* rr = dynamic_cast<SrsHttpResponseReader*>(r->body_reader());
+    srs_assert(rr);
     
-    char pps[4];
-    if ((err = dec.read_previous_tag_size(pps)) != srs_success) {
-        return srs_error_wrap(err, "read pts");
+    // The flv header and the first previous tag size.
+    if (!ts) {
+        char buf[13];
+        char* p = NULL;
+        if ((err = srs_http_read_bytes(rr, buf, 13, &p)) != srs_success) {
+            return srs_error_wrap(err, "read header");
+        }
+        
+        if (!p || p[0] != 'F' || p[1] != 'L' || p[2] != 'V') {
+            return srs_error_new(ERROR_KERNEL_FLV_HEADER, "flv header must start with FLV");
+        }
     }
     
-    err = do_proxy(rr, &dec);
-    sdk->close();
+    err = do_proxy(rr, ts);
+    publisher->unpublish();
     
     return err;
 }
 
-srs_error_t SrsDynamicHttpConn::do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecoder* dec)
+srs_error_t SrsDynamicHttpConn::do_proxy(SrsHttpResponseReader* rr, bool ts)
 {
     srs_error_t err = srs_success;
     
-    srs_freep(sdk);
-    
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
+    if ((err = publisher->initialize(output, ip)) != srs_success) {
+        return srs_error_wrap(err, "init publisher");
+    }
     
-    if ((err = sdk->connect()) != srs_success) {
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
+    // The client of statistic is this connection, so it's able to be kicked off by API.
+    publisher->set_client(srs_id(), this);
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish %s", output.c_str());
     }
     
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        return srs_error_wrap(err, "publish");
+    if (ts) {
+        return proxy_ts(rr);
     }
+    return proxy_flv(rr);
+}
+
+srs_error_t SrsDynamicHttpConn::proxy_flv(SrsHttpResponseReader* rr)
+{
+    srs_error_t err = srs_success;
     
-    char pps[4];
     while (!rr->eof()) {
         pprint->elapse();
         
-        char type;
-        int32_t size;
-        uint32_t time;
-        if ((err = dec->read_tag_header(&type, &size, &time)) != srs_success) {
+        // The tag header, and the end of body is at the tag boundary.
+        char th[11];
+        char* p = NULL;
+        if ((err = srs_http_read_bytes(rr, th, 11, &p)) != srs_success) {
             return srs_error_wrap(err, "read tag header");
         }
+        if (!p) {
+            break;
+        }
         
-        char* data = new char[size];
-        if ((err = dec->read_tag_data(data, size)) != srs_success) {
-            srs_freepa(data);
-            return srs_error_wrap(err, "read tag data");
+        // TagType UB [5], DataSize UI24, Timestamp UI24, TimestampExtended UI8
+        char type = p[0] & 0x1F;
+        int32_t size = (uint8_t)p[1] << 16 | (uint8_t)p[2] << 8 | (uint8_t)p[3];
+        uint32_t time = (uint32_t)(uint8_t)p[7] << 24 | (uint8_t)p[4] << 16 | (uint8_t)p[5] << 8 | (uint8_t)p[6];
+        
+        SrsCommonMessage msg;
+        if (type == SrsFrameTypeAudio) {
+            msg.header.initialize_audio(size, time, 1);
+        } else if (type == SrsFrameTypeVideo) {
+            msg.header.initialize_video(size, time, 1);
+        } else if (type == SrsFrameTypeScript) {
+            msg.header.initialize_amf0_script(size, 1);
+        } else {
+            return srs_error_new(ERROR_STREAM_CASTER_FLV_TAG, "unknown tag=%#x", (uint8_t)type);
         }
         
-        SrsSharedPtrMessage* msg = NULL;
-        if ((err = srs_rtmp_create_msg(type, time, data, size, sdk->sid(), &msg)) != srs_success) {
-            return srs_error_wrap(err, "create message");
+        // Copy the payload from the buffer of connection to the message from pool.
+        if (size > 0) {
+            msg.create_payload(size);
+            msg.size = size;
+            if ((err = srs_http_read_fully(rr, msg.payload, size)) != srs_success) {
+                return srs_error_wrap(err, "read tag data");
+            }
         }
         
-        // TODO: FIXME: for post flv, reconnect when error.
-        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
-            return srs_error_wrap(err, "send message");
+        if ((err = publisher->on_message(&msg)) != srs_success) {
+            return srs_error_wrap(err, "publish message");
         }
         
         if (pprint->can_print()) {
-            srs_trace("flv: send msg %d age=%d, dts=%d, size=%d", type, pprint->age(), time, size);
+            srs_trace("flv: publish msg %d age=%d, dts=%d, size=%d", type, pprint->age(), time, size);
         }
         
-        if ((err = dec->read_previous_tag_size(pps)) != srs_success) {
+        // The previous tag size.
+        char pts[4];
+        if ((err = srs_http_read_bytes(rr, pts, 4, &p)) != srs_success) {
             return srs_error_wrap(err, "read pts");
         }
     }
@@ -247,6 +335,45 @@ srs_error_t SrsDynamicHttpConn::do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecod
     return err;
 }
 
+srs_error_t SrsDynamicHttpConn::proxy_ts(SrsHttpResponseReader* rr)
+{
+    srs_error_t err = srs_success;
+    
+    SrsTsSourceBridge* bridge = new SrsTsSourceBridge();
+    SrsAutoFree(SrsTsSourceBridge, bridge);
+    bridge->set_publisher(publisher);
+    
+    int64_t nn_bytes = 0;
+    while (!rr->eof()) {
+        pprint->elapse();
+        
+        // The packets are decoded in place, only the partial packet at the end of slice is copied.
+        char* p = NULL;
+        ssize_t nn = 0;
+        if ((err = rr->read_slice(SRS_HTTP_CASTER_SLICE, &p, &nn)) != srs_success) {
+            return srs_error_wrap(err, "read slice");
+        }
+        if (nn <= 0) {
+            break;
+        }
+        nn_bytes += nn;
+        
+        if ((err = bridge->on_data(p, (int)nn)) != srs_success) {
+            return srs_error_wrap(err, "demux ts");
+        }
+        
+        if ((err = bridge->flush(SRS_HTTP_CASTER_HOLD)) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        
+        if (pprint->can_print()) {
+            srs_trace("flv: publish ts age=%d, bytes=%" PRId64 ", queued=%d", pprint->age(), nn_bytes, bridge->nb_queued());
+        }
+    }
+    
+    return bridge->flush(0);
+}
+
 SrsHttpFileReader::SrsHttpFileReader(ISrsHttpResponseReader* h)
 {
     http = h;
@@ -36,9 +36,10 @@ class SrsStSocket;
 class SrsRequest;
 class SrsPithyPrint;
 class ISrsHttpResponseReader;
-class SrsFlvDecoder;
+class SrsHttpResponseReader;
 class SrsTcpClient;
-class SrsSimpleRtmpClient;
+class ISrsSourceHandler;
+class SrsLocalPublisher;
 
 #include <srs_app_thread.hpp>
 #include <srs_app_listener.hpp>
@@ -46,17 +47,18 @@ class SrsSimpleRtmpClient;
 #include <srs_app_http_conn.hpp>
 #include <srs_kernel_file.hpp>
 
-// The stream caster for flv stream over HTTP POST.
+// The stream caster for flv or ts stream over HTTP POST, by the extension of url.
 class SrsAppCasterFlv : virtual public ISrsTcpHandler
     , virtual public IConnectionManager, virtual public ISrsHttpHandler
 {
 private:
+    ISrsSourceHandler* handler;
     std::string output;
     SrsHttpServeMux* http_mux;
     std::vector<SrsHttpConn*> conns;
     SrsCoroutineManager* manager;
 public:
-    SrsAppCasterFlv(SrsConfDirective* c);
+    SrsAppCasterFlv(ISrsSourceHandler* h, SrsConfDirective* c);
     virtual ~SrsAppCasterFlv();
 public:
     virtual srs_error_t initialize();
@@ -72,21 +74,28 @@ public:
 };
 
 // The dynamic http connection, never drop the body.
+// The body is decoded in place from the buffer of connection, and the payload of tag is copied
+// to the message from pool once, then published to source directly.
 class SrsDynamicHttpConn : public SrsHttpConn
 {
 private:
     std::string output;
     SrsPithyPrint* pprint;
-    SrsSimpleRtmpClient* sdk;
+    // The publisher to publish the posted flv to source in process.
+    SrsLocalPublisher* publisher;
 public:
-    SrsDynamicHttpConn(IConnectionManager* cm, srs_netfd_t fd, SrsHttpServeMux* m, std::string cip);
+    SrsDynamicHttpConn(IConnectionManager* cm, srs_netfd_t fd, SrsHttpServeMux* m, std::string cip, ISrsSourceHandler* h);
     virtual ~SrsDynamicHttpConn();
 public:
     virtual srs_error_t on_got_http_message(ISrsHttpMessage* msg);
 public:
     virtual srs_error_t proxy(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string o);
 private:
-    virtual srs_error_t do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecoder* dec);
+    virtual srs_error_t do_proxy(SrsHttpResponseReader* rr, bool ts);
+    // Decode the flv tags after header, and publish each tag.
+    virtual srs_error_t proxy_flv(SrsHttpResponseReader* rr);
+    // Demux the ts packets by bridge, which publishes the messages sorted by dts.
+    virtual srs_error_t proxy_ts(SrsHttpResponseReader* rr);
 };
 
 // The http wrapper for file reader, to read http post stream like a file.
@@ -52,6 +52,7 @@ using namespace std;
 #include <srs_app_http_hooks.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_rtmp_stack.hpp>
+#include <srs_app_security.hpp>
 
 using namespace srs_internal;
 
@@ -67,6 +68,9 @@ const char* _srs_version = "XCORE-" RTMP_SIG_SRS_SERVER;
 // default config file.
 #define SRS_CONF_DEFAULT_COFNIG_FILE "conf/srs.conf"
 
+// Yield to other coroutines every some vhosts, when reload.
+#define SRS_CONF_RELOAD_YIELD_VHOSTS 100
+
 // '\n'
 #define SRS_LF (char)SRS_CONSTS_LF
 
@@ -194,6 +198,43 @@ bool srs_directive_equals(SrsConfDirective* a, SrsConfDirective* b)
     return true;
 }
 
+// The 64 bits FNV-1a hash, of the bytes and the terminating zero.
+static uint64_t srs_fnv1a(uint64_t h, const string& v)
+{
+    for (int i = 0; i <= (int)v.length(); i++) {
+        h ^= (uint8_t)v.c_str()[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t srs_directive_fingerprint(SrsConfDirective* conf)
+{
+    if (!conf) {
+        return 0;
+    }
+    
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = srs_fnv1a(h, conf->name);
+    
+    for (int i = 0; i < (int)conf->args.size(); i++) {
+        h = srs_fnv1a(h, conf->args.at(i));
+    }
+    
+    // Mix the children in order, with the depth mark, so a{b;c;} never equals a{b{c;}}.
+    h = srs_fnv1a(h, "{");
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        uint64_t v = srs_directive_fingerprint(conf->at(i));
+        for (int j = 0; j < 8; j++) {
+            h ^= (uint8_t)(v >> (j * 8));
+            h *= 0x100000001b3ULL;
+        }
+    }
+    h = srs_fnv1a(h, "}");
+    
+    return h;
+}
+
 bool srs_directive_equals(SrsConfDirective* a, SrsConfDirective* b, string except)
 {
     // both NULL, equal.
@@ -250,6 +291,26 @@ bool srs_config_ingest_is_stream(string type)
     return type == "stream";
 }
 
+bool srs_config_ingest_is_hls(string type)
+{
+    return type == "hls";
+}
+
+bool srs_config_ingest_is_http_ts(string type)
+{
+    return type == "http_ts";
+}
+
+bool srs_config_ingest_is_rtsp(string type)
+{
+    return type == "rtsp";
+}
+
+bool srs_config_ingest_is_playout(string type)
+{
+    return type == "playout";
+}
+
 bool srs_config_dvr_is_plan_segment(string plan)
 {
     return plan == "segment";
@@ -1124,6 +1185,40 @@ srs_error_t SrsConfDirective::read_token(SrsConfigBuffer* buffer, vector<string>
     return err;
 }
 
+SrsVhostSnapshot::SrsVhostSnapshot()
+{
+    generation = -1;
+    
+    gop_cache = atc = atc_auto = mix_correct = false;
+    gop_cache_max_duration = gop_cache_fast_start = 0;
+    gop_cache_max_size = 0;
+    http_remux_fast_cache = 0;
+    time_shift = 0;
+    time_shift_max_size = 0;
+    time_jitter = 0;
+    queue_length = 0;
+    mr_enabled = false;
+    mr_sleep = mw_sleep = 0;
+    mw_adaptive = mw_aggregate = false;
+    realtime = tcp_nodelay = false;
+    send_min_interval = 0;
+    reduce_sequence_header = false;
+    pacing_factor = 0;
+    notsent_lowat = 0;
+    drop_ratio = 0;
+    low_priority = false;
+    latency_marker = 0;
+    reconnect_grace = 0;
+    security_enabled = false;
+    token_enabled = token_play = token_publish = false;
+    security = new SrsSecurityRules();
+}
+
+SrsVhostSnapshot::~SrsVhostSnapshot()
+{
+    srs_freep(security);
+}
+
 SrsConfig::SrsConfig()
 {
     dolphin = false;
@@ -1135,11 +1230,21 @@ SrsConfig::SrsConfig()
     root = new SrsConfDirective();
     root->conf_line = 0;
     root->name = "root";
+    
+    vhost_index_dirty = true;
+    vhost_generation = 0;
 }
 
 SrsConfig::~SrsConfig()
 {
     srs_freep(root);
+    
+    std::map<std::string, SrsVhostSnapshot*>::iterator it;
+    for (it = vhost_snapshots.begin(); it != vhost_snapshots.end(); ++it) {
+        SrsVhostSnapshot* snapshot = it->second;
+        srs_freep(snapshot);
+    }
+    vhost_snapshots.clear();
 }
 
 bool SrsConfig::is_dolphin()
@@ -1216,32 +1321,48 @@ srs_error_t SrsConfig::reload_vhost(SrsConfDirective* old_root)
     //      ENABLED     =>  DISABLED
     //      ENABLED     =>  ENABLED (modified)
     
-    // collect all vhost names
+    // collect all vhost names, index by name to avoid walking the root for each vhost.
+    // @remark The first one is used for the duplicated vhosts, like SrsConfDirective::get.
     std::vector<std::string> vhosts;
+    std::map<std::string, SrsConfDirective*> new_vhosts;
+    std::map<std::string, SrsConfDirective*> old_vhosts;
     for (int i = 0; i < (int)root->directives.size(); i++) {
         SrsConfDirective* vhost = root->at(i);
-        if (vhost->name != "vhost") {
+        if (vhost->name != "vhost" || new_vhosts.find(vhost->arg0()) != new_vhosts.end()) {
             continue;
         }
+        new_vhosts[vhost->arg0()] = vhost;
         vhosts.push_back(vhost->arg0());
     }
     for (int i = 0; i < (int)old_root->directives.size(); i++) {
         SrsConfDirective* vhost = old_root->at(i);
-        if (vhost->name != "vhost") {
+        if (vhost->name != "vhost" || old_vhosts.find(vhost->arg0()) != old_vhosts.end()) {
             continue;
         }
-        if (root->get("vhost", vhost->arg0())) {
-            continue;
+        old_vhosts[vhost->arg0()] = vhost;
+        if (new_vhosts.find(vhost->arg0()) == new_vhosts.end()) {
+            vhosts.push_back(vhost->arg0());
         }
-        vhosts.push_back(vhost->arg0());
     }
     
     // process each vhost
+    int nn_changed = 0;
     for (int i = 0; i < (int)vhosts.size(); i++) {
         std::string vhost = vhosts.at(i);
         
-        SrsConfDirective* old_vhost = old_root->get("vhost", vhost);
-        SrsConfDirective* new_vhost = root->get("vhost", vhost);
+        // Yield to other coroutines for lots of vhosts, to never stall the media.
+        if (i > 0 && (i % SRS_CONF_RELOAD_YIELD_VHOSTS) == 0) {
+            srs_usleep(0);
+        }
+        
+        SrsConfDirective* old_vhost = old_vhosts[vhost];
+        SrsConfDirective* new_vhost = new_vhosts[vhost];
+        
+        // Skip the vhost which is not changed, by fingerprint of the whole vhost.
+        if (old_vhost && new_vhost && srs_directive_fingerprint(old_vhost) == srs_directive_fingerprint(new_vhost)) {
+            continue;
+        }
+        nn_changed++;
         
         //      DISABLED    =>  ENABLED
         if (!get_vhost_enabled(old_vhost) && get_vhost_enabled(new_vhost)) {
@@ -1446,6 +1567,8 @@ srs_error_t SrsConfig::reload_vhost(SrsConfDirective* old_root)
                   get_vhost_enabled(old_vhost), get_vhost_enabled(new_vhost));
     }
     
+    srs_trace("reload vhosts, changed %d of %d", nn_changed, (int)vhosts.size());
+    
     return err;
 }
 
@@ -1459,6 +1582,9 @@ srs_error_t SrsConfig::reload_conf(SrsConfig* conf)
     root = conf->root;
     conf->root = NULL;
     
+    // Update the snapshots, before notify the handlers.
+    on_vhosts_changed(true);
+    
     // merge config.
     std::vector<ISrsReloadHandler*>::iterator it;
     
@@ -2064,6 +2190,8 @@ srs_error_t SrsConfig::global_to_json(SrsJsonObject* obj)
                     sobj->set(sdir->name, sdir->dumps_arg0_to_str());
                 } else if (sdir->name == "summaries") {
                     sobj->set(sdir->name, sdir->dumps_arg0_to_boolean());
+                } else if (sdir->name == "version") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
                 }
             }
             obj->set(dir->name, sobj);
@@ -2117,6 +2245,30 @@ srs_error_t SrsConfig::global_to_json(SrsJsonObject* obj)
                     sobj->set(sdir->name, sdir->dumps_arg0_to_str());
                 } else if (sdir->name == "dir") {
                     sobj->set(sdir->name, sdir->dumps_arg0_to_str());
+                } else if (sdir->name == "vod_index_cache") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "vod_hls_cache") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "vod_hls_fragment") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_number());
+                } else if (sdir->name == "vod_moov_cache") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "file_cache_fds") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "file_cache_valid") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_number());
+                } else if (sdir->name == "file_cache_max_size") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "file_cache_memory") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "segment_max_age") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "lazy_mount") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_boolean());
+                } else if (sdir->name == "http2") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_boolean());
+                } else if (sdir->name == "http2_max_streams") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
                 }
             }
             obj->set(dir->name, sobj);
@@ -2136,6 +2288,10 @@ srs_error_t SrsConfig::global_to_json(SrsJsonObject* obj)
                     sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
                 } else if (sdir->name == "rtp_port_max") {
                     sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "rtp_reorder_depth") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "capture") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_str());
                 }
             }
             obj->set(dir->name, sobj);
@@ -2318,6 +2474,28 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 cluster->set("vhost", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "debug_srs_upnode") {
                 cluster->set("debug_srs_upnode", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "origin_balance") {
+                cluster->set("origin_balance", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "origin_stagger") {
+                cluster->set("origin_stagger", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "protocol") {
+                cluster->set("protocol", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "mux_connections") {
+                cluster->set("mux_connections", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "peers") {
+                cluster->set("peers", sdir->dumps_args());
+            } else if (sdir->name == "publish_window") {
+                cluster->set("publish_window", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "publish_inflight") {
+                cluster->set("publish_inflight", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "publish_rtt_chunk") {
+                cluster->set("publish_rtt_chunk", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "standby") {
+                cluster->set("standby", sdir->dumps_args());
+            } else if (sdir->name == "hls_origin") {
+                cluster->set("hls_origin", sdir->dumps_args());
+            } else if (sdir->name == "hls_playlist_ttl") {
+                cluster->set("hls_playlist_ttl", sdir->dumps_arg0_to_integer());
             }
         }
     }
@@ -2356,14 +2534,42 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 play->set("atc_auto", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "mw_latency") {
                 play->set("mw_latency", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "mw_adaptive") {
+                play->set("mw_adaptive", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "mw_aggregate") {
+                play->set("mw_aggregate", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "gop_cache") {
                 play->set("gop_cache", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "gop_cache_max_duration") {
+                play->set("gop_cache_max_duration", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "gop_cache_max_size") {
+                play->set("gop_cache_max_size", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "gop_cache_fast_start") {
+                play->set("gop_cache_fast_start", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "time_shift") {
+                play->set("time_shift", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "time_shift_max_size") {
+                play->set("time_shift_max_size", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "queue_length") {
                 play->set("queue_length", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "reduce_sequence_header") {
                 play->set("reduce_sequence_header", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "send_min_interval") {
                 play->set("send_min_interval", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "tcp_congestion") {
+                play->set("tcp_congestion", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "pacing_factor") {
+                play->set("pacing_factor", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "zerocopy") {
+                play->set("zerocopy", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "notsent_lowat") {
+                play->set("notsent_lowat", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "drop_ratio") {
+                play->set("drop_ratio", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "egress_share") {
+                play->set("egress_share", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "resume") {
+                play->set("resume", sdir->dumps_arg0_to_integer());
             }
         }
     }
@@ -2384,6 +2590,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 publish->set("firstpkt_timeout", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "normal_timeout") {
                 publish->set("normal_timeout", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "batch") {
+                publish->set("batch", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "capture") {
+                publish->set("capture", sdir->dumps_arg0_to_str());
             }
         }
     }
@@ -2490,6 +2700,8 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
             
             if (sdir->name == "fast_cache") {
                 http_remux->set("fast_cache", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "mp4_fragment") {
+                http_remux->set("mp4_fragment", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "mount") {
                 http_remux->set("mount", sdir->dumps_arg0_to_str());
             }
@@ -2524,6 +2736,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 http_hooks->set("on_hls", sdir->dumps_args());
             } else if (sdir->name == "on_hls_notify") {
                 http_hooks->set("on_hls_notify", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "cache_ttl") {
+                http_hooks->set("cache_ttl", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "batch_interval") {
+                http_hooks->set("batch_interval", sdir->dumps_arg0_to_number());
             }
         }
     }
@@ -2542,6 +2758,8 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_fragment", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "hls_td_ratio") {
                 hls->set("hls_td_ratio", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_fast_start") {
+                hls->set("hls_fast_start", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "hls_aof_ratio") {
                 hls->set("hls_aof_ratio", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "hls_window") {
@@ -2576,6 +2794,22 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_dts_directly", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "hls_wait_keyframe") {
                 hls->set("hls_wait_keyframe", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_checksum") {
+                hls->set("hls_checksum", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_memory") {
+                hls->set("hls_memory", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_memory_archive") {
+                hls->set("hls_memory_archive", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_ll") {
+                hls->set("hls_ll", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_ll_part") {
+                hls->set("hls_ll_part", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_audio_aggregate") {
+                hls->set("hls_audio_aggregate", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_pcr_interval") {
+                hls->set("hls_pcr_interval", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_variants") {
+                hls->set("hls_variants", sdir->dumps_args());
             } else if (sdir->name == "hls_keys") {
                 hls->set("hls_keys", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "hls_fragments_per_key") {
@@ -2586,6 +2820,8 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_key_file_path", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "hls_key_url") {
                 hls->set("hls_key_url", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "hls_key_offload") {
+                hls->set("hls_key_offload", sdir->dumps_arg0_to_boolean());
             }
         }
     }
@@ -2630,6 +2866,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 dvr->set("dvr_duration", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "dvr_wait_keyframe") {
                 dvr->set("dvr_wait_keyframe", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "dvr_mp4_fragment") {
+                dvr->set("dvr_mp4_fragment", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "dvr_mp4_finalize") {
+                dvr->set("dvr_mp4_finalize", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "time_jitter") {
                 dvr->set("time_jitter", sdir->dumps_arg0_to_str());
             }
@@ -3007,6 +3247,7 @@ srs_error_t SrsConfig::raw_create_vhost(string vhost, bool& applied)
     
     SrsConfDirective* conf = root->get_or_create("vhost", vhost);
     conf->get_or_create("enabled")->set_arg0("on");
+    on_vhosts_changed(true);
     
     if ((err = do_reload_vhost_added(vhost)) != srs_success) {
         return srs_error_wrap(err, "reload vhost");
@@ -3026,6 +3267,7 @@ srs_error_t SrsConfig::raw_update_vhost(string vhost, string name, bool& applied
     // the vhost must be disabled, so we donot need to reload.
     SrsConfDirective* conf = root->get_or_create("vhost", vhost);
     conf->set_arg0(name);
+    on_vhosts_changed(true);
     
     applied = true;
     
@@ -3045,6 +3287,7 @@ srs_error_t SrsConfig::raw_delete_vhost(string vhost, bool& applied)
     // remove the directive.
     root->remove(conf);
     srs_freep(conf);
+    on_vhosts_changed(true);
     
     applied = true;
     
@@ -3482,13 +3725,19 @@ srs_error_t SrsConfig::check_normal_config()
         std::string n = conf->name;
         if (n != "listen" && n != "pid" && n != "chunk_size" && n != "ff_log_dir"
             && n != "srs_log_tank" && n != "srs_log_level" && n != "srs_log_file"
+            && n != "srs_log_async" && n != "srs_log_async_size"
             && n != "max_connections" && n != "daemon" && n != "heartbeat"
             && n != "http_api" && n != "stats" && n != "vhost" && n != "pithy_print_ms"
             && n != "http_server" && n != "stream_caster"
             && n != "utc_time" && n != "work_dir" && n != "asprocess"
             && n != "ff_log_level" && n != "grace_final_wait" && n != "force_grace_quit"
-            && n != "grace_start_wait" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
-            && n != "inotify_auto_reload" && n != "auto_reload_for_docker"
+            && n != "grace_start_wait" && n != "grace_drain_timeout" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
+            && n != "ingest_start_jitter"
+            && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "workers"
+            && n != "disk_io" && n != "io_uring" && n != "fanout" && n != "async_call" && n != "accept" && n != "handshake" && n != "admission"
+            && n != "access_log" && n != "overload" && n != "scheduler" && n != "flight_recorder" && n != "transcode_scheduler"
+            && n != "rtsp_client" && n != "affinity" && n != "memory" && n != "tls" && n != "srt_server"
+            && n != "rtc_server" && n != "relay_server"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
@@ -3498,10 +3747,28 @@ srs_error_t SrsConfig::check_normal_config()
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             SrsConfDirective* obj = conf->at(i);
             string n = obj->name;
-            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api") {
+            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api" && n != "snapshot" && n != "control") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.%s", n.c_str());
             }
             
+            if (n == "control") {
+                for (int j = 0; j < (int)obj->directives.size(); j++) {
+                    string m = obj->at(j)->name;
+                    if (m != "enabled" && m != "listen" && m != "interval") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.control.%s", m.c_str());
+                    }
+                }
+            }
+            
+            if (n == "snapshot") {
+                for (int j = 0; j < (int)obj->directives.size(); j++) {
+                    string m = obj->at(j)->name;
+                    if (m != "enabled" && m != "interval" && m != "ffmpeg" && m != "decoders" && m != "timeout") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.snapshot.%s", m.c_str());
+                    }
+                }
+            }
+            
             if (n == "raw_api") {
                 for (int j = 0; j < (int)obj->directives.size(); j++) {
                     string m = obj->at(j)->name;
@@ -3516,7 +3783,10 @@ srs_error_t SrsConfig::check_normal_config()
         SrsConfDirective* conf = root->get("http_server");
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain") {
+            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain" && n != "vod_index_cache"
+                && n != "vod_hls_cache" && n != "vod_hls_fragment" && n != "vod_moov_cache" && n != "segment_max_age"
+                && n != "file_cache_fds" && n != "file_cache_valid" && n != "file_cache_max_size" && n != "file_cache_memory" && n != "lazy_mount"
+                && n != "http2" && n != "http2_max_streams") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_stream.%s", n.c_str());
             }
         }
@@ -3526,7 +3796,7 @@ srs_error_t SrsConfig::check_normal_config()
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
             if (n != "enabled" && n != "interval" && n != "url"
-                && n != "device_id" && n != "summaries") {
+                && n != "device_id" && n != "summaries" && n != "version") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal heartbeat.%s", n.c_str());
             }
         }
@@ -3540,6 +3810,213 @@ srs_error_t SrsConfig::check_normal_config()
             }
         }
     }
+    if (true) {
+        SrsConfDirective* conf = get_workers();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "count" && n != "relay_port") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal workers.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_affinity();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "cpus") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal affinity.%s", n.c_str());
+            }
+        }
+        
+        vector<int> cpus;
+        if ((err = srs_parse_cpus(get_affinity_cpus(), cpus)) != srs_success) {
+            return srs_error_wrap(err, "affinity.cpus");
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_memory();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "huge_pages" && n != "numa") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal memory.%s", n.c_str());
+            }
+        }
+        
+        string huge_pages = get_memory_huge_pages();
+        if (huge_pages != "off" && huge_pages != "transparent" && huge_pages != "explicit") {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal memory.huge_pages=%s", huge_pages.c_str());
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_tls();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "rtmps" && n != "https" && n != "certificate" && n != "key" && n != "ktls"
+                && n != "session_tickets" && n != "ticket_key" && n != "session_timeout") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal tls.%s", n.c_str());
+            }
+        }
+        
+        if (get_tls_enabled() && (get_tls_certificate().empty() || get_tls_key().empty())) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "tls requires certificate and key");
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_srt_server();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "listen" && n != "latency" && n != "maxbw" && n != "payload_size"
+                && n != "peer_idle_timeout" && n != "default_app") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal srt_server.%s", n.c_str());
+            }
+        }
+        
+        int payload_size = get_srt_payload_size();
+        if (payload_size <= 0 || payload_size > 1456 || (payload_size % 188) != 0) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal srt_server.payload_size=%d", payload_size);
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_rtc_server();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "listen" && n != "candidate") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal rtc_server.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_relay_server();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "listen" && n != "secret") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal relay_server.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_disk_io();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "threads" && n != "max_pending" && n != "fsync"
+                && n != "buffer" && n != "direct" && n != "mux") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal disk_io.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_fanout();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "threads" && n != "max_pending") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal fanout.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_async_call();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "lanes" && n != "max_tasks" && n != "timeout") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal async_call.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_io_uring();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "entries" && n != "write") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal io_uring.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_accept();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "batch" && n != "rate" && n != "defer" && n != "fastopen") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal accept.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_handshake();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "dh_pool") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal handshake.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_admission();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "max_kbps" && n != "rtmp_redirect" && n != "http_redirect") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal admission.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_overload();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "max_lag" && n != "max_cpu" && n != "drop_ratio") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal overload.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_access_log();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "path" && n != "format" && n != "rate" && n != "burst") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal access_log.%s", n.c_str());
+            }
+        }
+        
+        string format = get_access_log_format();
+        if (format != "json" && format != "binary") {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal access_log.format=%s", format.c_str());
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_scheduler();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "profile" && n != "slice") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal scheduler.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_flight_recorder();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "events" && n != "threshold" && n != "file") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal flight_recorder.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_transcode_scheduler();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "cpu" && n != "nvenc" && n != "qsv") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal transcode_scheduler.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = get_rtsp_client();
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "rtp_port_min" && n != "rtp_port_max" && n != "timeout" && n != "rtp_reorder_depth") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal rtsp_client.%s", n.c_str());
+            }
+        }
+    }
     
     ////////////////////////////////////////////////////////////////////////
     // check listen for rtmp.
@@ -3564,6 +4041,20 @@ srs_error_t SrsConfig::check_normal_config()
         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid heartbeat.interval=%" PRId64,
             get_heartbeat_interval());
     }
+    if (get_heartbeat_version() != 1 && get_heartbeat_version() != 2) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid heartbeat.version=%d", get_heartbeat_version());
+    }
+    
+    ////////////////////////////////////////////////////////////////////////
+    // check workers
+    ////////////////////////////////////////////////////////////////////////
+    if (get_workers_count() <= 0) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid workers.count=%d", get_workers_count());
+    }
+    if (get_workers_relay_port() <= 0 || get_workers_relay_port() + get_workers_count() > 65535) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid workers.relay_port=%d, count=%d",
+            get_workers_relay_port(), get_workers_count());
+    }
     
     ////////////////////////////////////////////////////////////////////////
     // check stats
@@ -3634,7 +4125,8 @@ srs_error_t SrsConfig::check_normal_config()
             SrsConfDirective* conf = stream_caster->at(i);
             string n = conf->name;
             if (n != "enabled" && n != "caster" && n != "output"
-                && n != "listen" && n != "rtp_port_min" && n != "rtp_port_max") {
+                && n != "listen" && n != "rtp_port_min" && n != "rtp_port_max" && n != "rtp_reorder_depth"
+                && n != "capture") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal stream_caster.%s", n.c_str());
             }
         }
@@ -3654,9 +4146,10 @@ srs_error_t SrsConfig::check_normal_config()
                 && n != "dvr" && n != "ingest" && n != "hls" && n != "http_hooks"
                 && n != "refer" && n != "forward" && n != "transcode" && n != "bandcheck"
                 && n != "play" && n != "publish" && n != "cluster"
-                && n != "security" && n != "http_remux" && n != "dash"
+                && n != "security" && n != "token" && n != "http_remux" && n != "dash"
                 && n != "http_static" && n != "hds" && n != "exec"
-                && n != "in_ack_size" && n != "out_ack_size") {
+                && n != "in_ack_size" && n != "out_ack_size" && n != "access_log_sample" && n != "low_priority"
+                && n != "srt" && n != "multicast" && n != "upload" && n != "abr" && n != "rtc") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.%s", n.c_str());
             }
             // for each sub directives of vhost.
@@ -3664,7 +4157,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter"
+                        && m != "dvr_mp4_fragment" && m != "dvr_mp4_finalize") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3685,26 +4179,83 @@ srs_error_t SrsConfig::check_normal_config()
             } else if (n == "play") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
-                    if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency"
-                        && m != "gop_cache" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header") {
+                    if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency" && m != "mw_adaptive"
+                        && m != "mw_aggregate" && m != "gop_cache" && m != "gop_cache_max_duration" && m != "gop_cache_max_size" && m != "gop_cache_fast_start"
+                        && m != "time_shift" && m != "time_shift_max_size"
+                        && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
+                        && m != "tcp_congestion" && m != "pacing_factor" && m != "zerocopy" && m != "notsent_lowat"
+                        && m != "drop_ratio" && m != "egress_share" && m != "resume") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.play.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
             } else if (n == "cluster") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
-                    if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster") {
+                    if (m != "mode" && m != "origin" && m != "token_traverse" && m != "token_traverse_ttl" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
+                        && m != "origin_cluster" && m != "origin_balance" && m != "origin_stagger" && m != "protocol" && m != "mux_connections" && m != "peers"
+                        && m != "publish_window" && m != "publish_inflight" && m != "publish_rtt_chunk" && m != "standby"
+                        && m != "hls_origin" && m != "hls_playlist_ttl") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
             } else if (n == "publish") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
-                    if (m != "mr" && m != "mr_latency" && m != "firstpkt_timeout" && m != "normal_timeout" && m != "parse_sps") {
+                    if (m != "mr" && m != "mr_latency" && m != "firstpkt_timeout" && m != "normal_timeout" && m != "parse_sps"
+                        && m != "batch" && m != "latency_marker" && m != "reconnect_grace" && m != "capture") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.publish.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
+            } else if (n == "srt") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "latency" && m != "tlpktdrop") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.srt.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
+            } else if (n == "rtc") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "nack") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.rtc.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
+            } else if (n == "multicast") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    SrsConfDirective* sconf = conf->at(j);
+                    string m = sconf->name;
+                    if (m != "enabled" && m != "channel" && m != "ttl" && m != "interface" && m != "delay") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.multicast.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                    if (m == "channel" && sconf->args.size() != 2) {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.multicast.channel of %s, args=%d", vhost->arg0().c_str(), (int)sconf->args.size());
+                    }
+                }
+            } else if (n == "upload") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "endpoint" && m != "access_key" && m != "secret_key" && m != "region"
+                        && m != "local_copy" && m != "retries" && m != "part_size" && m != "hls" && m != "dvr") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.upload.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                    // The HTTPS is not supported by the HTTP client.
+                    if (m == "endpoint" && !srs_string_starts_with(conf->at(j)->arg0(), "http://")) {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.upload.endpoint %s of %s, should be http://host:port/bucket",
+                            conf->at(j)->arg0().c_str(), vhost->arg0().c_str());
+                    }
+                    // The S3 requires each part except the last one at least 5MB.
+                    if (m == "part_size" && ::atoi(conf->at(j)->arg0().c_str()) < 5) {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.upload.part_size %s of %s, should be at least 5MB",
+                            conf->at(j)->arg0().c_str(), vhost->arg0().c_str());
+                    }
+                }
+            } else if (n == "abr") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "renditions" && m != "down_queue" && m != "up_stable") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.abr.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
             } else if (n == "ingest") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
@@ -3722,7 +4273,7 @@ srs_error_t SrsConfig::check_normal_config()
             } else if (n == "http_remux") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
-                    if (m != "enabled" && m != "mount" && m != "fast_cache") {
+                    if (m != "enabled" && m != "mount" && m != "fast_cache" && m != "mp4_fragment") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.http_remux.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3730,7 +4281,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "dash_fragment" && m != "dash_update_period" && m != "dash_timeshift" && m != "dash_path"
-                        && m != "dash_mpd_file") {
+                        && m != "dash_mpd_file" && m != "dash_chunk_duration") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dash.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3738,10 +4289,12 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "hls_entry_prefix" && m != "hls_path" && m != "hls_fragment" && m != "hls_window" && m != "hls_on_error"
-                        && m != "hls_storage" && m != "hls_mount" && m != "hls_td_ratio" && m != "hls_aof_ratio" && m != "hls_acodec" && m != "hls_vcodec"
+                        && m != "hls_storage" && m != "hls_mount" && m != "hls_td_ratio" && m != "hls_fast_start" && m != "hls_aof_ratio" && m != "hls_acodec" && m != "hls_vcodec"
                         && m != "hls_m3u8_file" && m != "hls_ts_file" && m != "hls_ts_floor" && m != "hls_cleanup" && m != "hls_nb_notify"
                         && m != "hls_wait_keyframe" && m != "hls_dispose" && m != "hls_keys" && m != "hls_fragments_per_key" && m != "hls_key_file"
-                        && m != "hls_key_file_path" && m != "hls_key_url" && m != "hls_dts_directly") {
+                        && m != "hls_key_file_path" && m != "hls_key_offload" && m != "hls_key_url" && m != "hls_dts_directly" && m != "hls_checksum"
+                        && m != "hls_memory" && m != "hls_memory_archive" && m != "hls_ll" && m != "hls_ll_part"
+                        && m != "hls_variants" && m != "hls_audio_aggregate" && m != "hls_pcr_interval") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.hls.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                     
@@ -3755,7 +4308,8 @@ srs_error_t SrsConfig::check_normal_config()
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "on_connect" && m != "on_close" && m != "on_publish"
                         && m != "on_unpublish" && m != "on_play" && m != "on_stop"
-                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify") {
+                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify"
+                        && m != "cache_ttl" && m != "batch_interval") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.http_hooks.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3774,13 +4328,23 @@ srs_error_t SrsConfig::check_normal_config()
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.security.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
+            } else if (n == "token") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "keys" && m != "play" && m != "publish") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.token.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
             } else if (n == "transcode") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     SrsConfDirective* trans = conf->at(j);
                     string m = trans->name.c_str();
-                    if (m != "enabled" && m != "ffmpeg" && m != "engine") {
+                    if (m != "enabled" && m != "ffmpeg" && m != "engine" && m != "priority" && m != "group" && m != "feed") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
+                    if (m == "feed" && trans->arg0() != "rtmp" && trans->arg0() != "unix") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.feed=%s of %s", trans->arg0().c_str(), vhost->arg0().c_str());
+                    }
                     if (m == "engine") {
                         for (int k = 0; k < (int)trans->directives.size(); k++) {
                             string e = trans->at(k)->name;
@@ -3789,7 +4353,7 @@ srs_error_t SrsConfig::check_normal_config()
                                 && e != "vthreads" && e != "vprofile" && e != "vpreset" && e != "vparams"
                                 && e != "acodec" && e != "abitrate" && e != "asample_rate" && e != "achannels"
                                 && e != "aparams" && e != "output" && e != "perfile"
-                                && e != "iformat" && e != "oformat") {
+                                && e != "iformat" && e != "oformat" && e != "resource") {
                                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.engine.%s of %s", m.c_str(), vhost->arg0().c_str());
                             }
                         }
@@ -3830,16 +4394,19 @@ srs_error_t SrsConfig::check_normal_config()
     ////////////////////////////////////////////////////////////////////////
     // check chunk size
     ////////////////////////////////////////////////////////////////////////
-    if (get_global_chunk_size() < SRS_CONSTS_RTMP_MIN_CHUNK_SIZE
-        || get_global_chunk_size() > SRS_CONSTS_RTMP_MAX_CHUNK_SIZE) {
-        srs_warn("chunk_size=%s should be in [%d, %d]", get_global_chunk_size(),
+    // @remark Never use get_chunk_size for each vhost, which finds the global chunk_size in all root
+    //      directives, that is O(N^2) for lots of vhosts.
+    int global_chunk_size = get_global_chunk_size();
+    if (global_chunk_size < SRS_CONSTS_RTMP_MIN_CHUNK_SIZE || global_chunk_size > SRS_CONSTS_RTMP_MAX_CHUNK_SIZE) {
+        srs_warn("chunk_size=%d should be in [%d, %d]", global_chunk_size,
             SRS_CONSTS_RTMP_MIN_CHUNK_SIZE, SRS_CONSTS_RTMP_MAX_CHUNK_SIZE);
     }
     for (int i = 0; i < (int)vhosts.size(); i++) {
         SrsConfDirective* vhost = vhosts[i];
-        if (get_chunk_size(vhost->arg0()) < SRS_CONSTS_RTMP_MIN_CHUNK_SIZE
-            || get_chunk_size(vhost->arg0()) > SRS_CONSTS_RTMP_MAX_CHUNK_SIZE) {
-            srs_warn("chunk_size=%s of %s should be in [%d, %d]", get_global_chunk_size(), vhost->arg0().c_str(),
+        SrsConfDirective* conf = vhost->get("chunk_size");
+        int chunk_size = (conf && !conf->arg0().empty())? ::atoi(conf->arg0().c_str()) : global_chunk_size;
+        if (chunk_size < SRS_CONSTS_RTMP_MIN_CHUNK_SIZE || chunk_size > SRS_CONSTS_RTMP_MAX_CHUNK_SIZE) {
+            srs_warn("chunk_size=%d of %s should be in [%d, %d]", chunk_size, vhost->arg0().c_str(),
                 SRS_CONSTS_RTMP_MIN_CHUNK_SIZE, SRS_CONSTS_RTMP_MAX_CHUNK_SIZE);
         }
     }
@@ -3911,6 +4478,9 @@ srs_error_t SrsConfig::parse_buffer(SrsConfigBuffer* buffer)
     // We use a new root to parse buffer, to allow parse multiple times.
     srs_freep(root);
     root = new SrsConfDirective();
+    
+    // Resolve the snapshots later, because the directives maybe transformed.
+    on_vhosts_changed(false);
 
     // Parse root tree from buffer.
     if ((err = root->parse(buffer)) != srs_success) {
@@ -4098,6 +4668,18 @@ bool SrsConfig::is_force_grace_quit()
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
+srs_utime_t SrsConfig::get_grace_drain_timeout()
+{
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("grace_drain_timeout");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atol(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
 bool SrsConfig::disable_daemon_for_docker()
 {
     static bool DEFAULT = true;
@@ -4201,23 +4783,39 @@ string SrsConfig::get_stream_caster_output(SrsConfDirective* conf)
     return conf->arg0();
 }
 
-int SrsConfig::get_stream_caster_listen(SrsConfDirective* conf)
+string SrsConfig::get_stream_caster_capture(SrsConfDirective* conf)
 {
-    static int DEFAULT = 0;
+    static string DEFAULT = "";
     
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("listen");
+    conf = conf->get("capture");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return conf->arg0();
 }
 
-int SrsConfig::get_stream_caster_rtp_port_min(SrsConfDirective* conf)
+int SrsConfig::get_stream_caster_listen(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_stream_caster_rtp_port_min(SrsConfDirective* conf)
 {
     static int DEFAULT = 0;
     
@@ -4249,20 +4847,48 @@ int SrsConfig::get_stream_caster_rtp_port_max(SrsConfDirective* conf)
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_stream_caster_rtp_reorder_depth(SrsConfDirective* conf)
+{
+    static int DEFAULT = 16;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("rtp_reorder_depth");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
 SrsConfDirective* SrsConfig::get_vhost(string vhost, bool try_default_vhost)
 {
     srs_assert(root);
     
-    for (int i = 0; i < (int)root->directives.size(); i++) {
-        SrsConfDirective* conf = root->at(i);
+    // Build the index, the first vhost wins when duplicated.
+    if (vhost_index_dirty) {
+        vhost_index.clear();
         
-        if (!conf->is_vhost()) {
-            continue;
+        for (int i = 0; i < (int)root->directives.size(); i++) {
+            SrsConfDirective* conf = root->at(i);
+            
+            if (!conf->is_vhost()) {
+                continue;
+            }
+            
+            if (vhost_index.find(conf->arg0()) == vhost_index.end()) {
+                vhost_index[conf->arg0()] = conf;
+            }
         }
         
-        if (conf->arg0() == vhost) {
-            return conf;
-        }
+        vhost_index_dirty = false;
+    }
+    
+    std::map<std::string, SrsConfDirective*>::iterator it = vhost_index.find(vhost);
+    if (it != vhost_index.end()) {
+        return it->second;
     }
     
     if (try_default_vhost && vhost != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
@@ -4287,6 +4913,86 @@ void SrsConfig::get_vhosts(vector<SrsConfDirective*>& vhosts)
     }
 }
 
+SrsVhostSnapshot* SrsConfig::get_vhost_snapshot(string vhost)
+{
+    // Use the name of matched vhost, so the unknown vhosts share the default one.
+    SrsConfDirective* conf = get_vhost(vhost);
+    string name = conf? conf->arg0() : "";
+    
+    SrsVhostSnapshot* snapshot = NULL;
+    
+    std::map<std::string, SrsVhostSnapshot*>::iterator it = vhost_snapshots.find(name);
+    if (it != vhost_snapshots.end()) {
+        snapshot = it->second;
+    } else {
+        snapshot = new SrsVhostSnapshot();
+        vhost_snapshots[name] = snapshot;
+    }
+    
+    if (snapshot->generation != vhost_generation) {
+        resolve_vhost_snapshot(name, snapshot);
+    }
+    
+    return snapshot;
+}
+
+void SrsConfig::on_vhosts_changed(bool resolve)
+{
+    vhost_index_dirty = true;
+    vhost_generation++;
+    
+    if (!resolve) {
+        return;
+    }
+    
+    // Never free the snapshots, which maybe referenced by sources and connections.
+    std::map<std::string, SrsVhostSnapshot*>::iterator it;
+    for (it = vhost_snapshots.begin(); it != vhost_snapshots.end(); ++it) {
+        resolve_vhost_snapshot(it->first, it->second);
+    }
+}
+
+void SrsConfig::resolve_vhost_snapshot(string vhost, SrsVhostSnapshot* snapshot)
+{
+    snapshot->generation = vhost_generation;
+    
+    snapshot->gop_cache = get_gop_cache(vhost);
+    snapshot->gop_cache_max_duration = get_gop_cache_max_duration(vhost);
+    snapshot->gop_cache_max_size = get_gop_cache_max_size(vhost);
+    snapshot->gop_cache_fast_start = get_gop_cache_fast_start(vhost);
+    snapshot->http_remux_fast_cache = get_vhost_http_remux_fast_cache(vhost);
+    snapshot->time_shift = get_time_shift(vhost);
+    snapshot->time_shift_max_size = get_time_shift_max_size(vhost);
+    snapshot->atc = get_atc(vhost);
+    snapshot->atc_auto = get_atc_auto(vhost);
+    snapshot->time_jitter = get_time_jitter(vhost);
+    snapshot->mix_correct = get_mix_correct(vhost);
+    snapshot->queue_length = get_queue_length(vhost);
+    snapshot->mr_enabled = get_mr_enabled(vhost);
+    snapshot->mr_sleep = get_mr_sleep(vhost);
+    snapshot->mw_sleep = get_mw_sleep(vhost);
+    snapshot->mw_adaptive = get_mw_adaptive(vhost);
+    snapshot->mw_aggregate = get_mw_aggregate(vhost);
+    snapshot->realtime = get_realtime_enabled(vhost);
+    snapshot->tcp_nodelay = get_tcp_nodelay(vhost);
+    snapshot->send_min_interval = get_send_min_interval(vhost);
+    snapshot->reduce_sequence_header = get_reduce_sequence_header(vhost);
+    snapshot->tcp_congestion = get_tcp_congestion(vhost);
+    snapshot->pacing_factor = get_pacing_factor(vhost);
+    snapshot->zerocopy = get_play_zerocopy(vhost);
+    snapshot->notsent_lowat = get_play_notsent_lowat(vhost);
+    snapshot->drop_ratio = get_drop_ratio(vhost);
+    snapshot->low_priority = get_vhost_low_priority(vhost);
+    snapshot->latency_marker = get_publish_latency_marker(vhost);
+    snapshot->reconnect_grace = get_publish_reconnect_grace(vhost);
+    snapshot->security_enabled = get_security_enabled(vhost);
+    snapshot->security->compile(get_security_rules(vhost));
+    snapshot->token_enabled = get_token_enabled(vhost);
+    snapshot->token_keys = get_token_keys(vhost);
+    snapshot->token_play = get_token_play(vhost);
+    snapshot->token_publish = get_token_publish(vhost);
+}
+
 bool SrsConfig::get_vhost_enabled(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -4332,6 +5038,116 @@ bool SrsConfig::get_gop_cache(string vhost)
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+srs_utime_t SrsConfig::get_gop_cache_max_duration(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("gop_cache_max_duration");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+int64_t SrsConfig::get_gop_cache_max_size(string vhost)
+{
+    static int64_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("gop_cache_max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (int64_t)::atoi(conf->arg0().c_str()) * 1024;
+}
+
+srs_utime_t SrsConfig::get_gop_cache_fast_start(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("gop_cache_fast_start");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+srs_utime_t SrsConfig::get_time_shift(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("time_shift");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+int64_t SrsConfig::get_time_shift_max_size(string vhost)
+{
+    static int64_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("time_shift_max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (int64_t)::atoi(conf->arg0().c_str()) * 1024;
+}
+
 bool SrsConfig::get_debug_srs_upnode(string vhost)
 {
     static bool DEFAULT = true;
@@ -4571,6 +5387,41 @@ int SrsConfig::get_out_ack_size(string vhost)
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_vhost_access_log_sample(string vhost)
+{
+    static int DEFAULT = 100;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("access_log_sample");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    int v = ::atoi(conf->arg0().c_str());
+    return srs_min(100, srs_max(0, v));
+}
+
+bool SrsConfig::get_vhost_low_priority(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("low_priority");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 int SrsConfig::get_chunk_size(string vhost)
 {
     if (vhost.empty()) {
@@ -4681,6 +5532,50 @@ srs_utime_t SrsConfig::get_mw_sleep(string vhost)
     return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
+bool SrsConfig::get_mw_adaptive(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mw_adaptive");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_mw_aggregate(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mw_aggregate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_realtime_enabled(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -4757,219 +5652,185 @@ bool SrsConfig::get_reduce_sequence_header(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-srs_utime_t SrsConfig::get_publish_1stpkt_timeout(string vhost)
+string SrsConfig::get_tcp_congestion(string vhost)
 {
-    // when no msg recevied for publisher, use larger timeout.
-    static srs_utime_t DEFAULT = 20 * SRS_UTIME_SECONDS;
+    static string DEFAULT = "";
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("publish");
+    conf = conf->get("play");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("firstpkt_timeout");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("tcp_congestion");
+    if (!conf) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+    return conf->arg0();
 }
 
-srs_utime_t SrsConfig::get_publish_normal_timeout(string vhost)
+double SrsConfig::get_pacing_factor(string vhost)
 {
-    // the timeout for publish recv.
-    // we must use more smaller timeout, for the recv never know the status
-    // of underlayer socket.
-    static srs_utime_t DEFAULT = 5 * SRS_UTIME_SECONDS;
+    static double DEFAULT = 0;
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("publish");
+    conf = conf->get("play");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("normal_timeout");
+    conf = conf->get("pacing_factor");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
-}
-
-int SrsConfig::get_global_chunk_size()
-{
-    SrsConfDirective* conf = root->get("chunk_size");
-    if (!conf || conf->arg0().empty()) {
-        return SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
-    }
-    
-    return ::atoi(conf->arg0().c_str());
+    return ::atof(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_forward_enabled(string vhost)
+int SrsConfig::get_play_zerocopy(string vhost)
 {
-    static bool DEFAULT = false;
+    static int DEFAULT = 0;
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("forward");
+    conf = conf->get("play");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("zerocopy");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return ::atoi(conf->arg0().c_str()) * 1024;
 }
 
-SrsConfDirective* SrsConfig::get_forwards(string vhost)
+int SrsConfig::get_play_notsent_lowat(string vhost)
 {
+    static int DEFAULT = 0;
+    
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    conf = conf->get("forward");
+    conf = conf->get("play");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("destination");
+    conf = conf->get("notsent_lowat");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str()) * 1024;
 }
 
-SrsConfDirective* SrsConfig::get_vhost_http_hooks(string vhost)
+double SrsConfig::get_drop_ratio(string vhost)
 {
+    static double DEFAULT = 0;
+    
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("http_hooks");
-}
-
-bool SrsConfig::get_vhost_http_hooks_enabled(string vhost)
-{
-    static bool DEFAULT = false;
-    
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    conf = conf->get("play");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("drop_ratio");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    double v = ::atof(conf->arg0().c_str());
+    return (v > 0 && v < 1)? v : DEFAULT;
 }
 
-SrsConfDirective* SrsConfig::get_vhost_on_connect(string vhost)
+srs_utime_t SrsConfig::get_vhost_play_resume(string vhost)
 {
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_connect");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_close(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    conf = conf->get("play");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_close");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_publish(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
-    if (!conf) {
-        return NULL;
+    conf = conf->get("resume");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return conf->get("on_publish");
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-SrsConfDirective* SrsConfig::get_vhost_on_unpublish(string vhost)
+int SrsConfig::get_vhost_egress_share(string vhost)
 {
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_unpublish");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_play(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    conf = conf->get("play");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_play");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_stop(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
-    if (!conf) {
-        return NULL;
+    conf = conf->get("egress_share");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return conf->get("on_stop");
+    int v = ::atoi(conf->arg0().c_str());
+    return (v > 0 && v <= 100)? v : DEFAULT;
 }
 
-SrsConfDirective* SrsConfig::get_vhost_on_dvr(string vhost)
+int SrsConfig::get_vhost_srt_latency(string vhost)
 {
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    int DEFAULT = get_srt_latency();
+    
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_dvr");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_hls(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    conf = conf->get("srt");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("on_hls");
-}
-
-SrsConfDirective* SrsConfig::get_vhost_on_hls_notify(string vhost)
-{
-    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
-    if (!conf) {
-        return NULL;
+    conf = conf->get("latency");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return conf->get("on_hls_notify");
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_bw_check_enabled(string vhost)
+bool SrsConfig::get_rtc_enabled(string vhost)
 {
     static bool DEFAULT = false;
     
@@ -4978,7 +5839,7 @@ bool SrsConfig::get_bw_check_enabled(string vhost)
         return DEFAULT;
     }
     
-    conf = conf->get("bandcheck");
+    conf = conf->get("rtc");
     if (!conf) {
         return DEFAULT;
     }
@@ -4991,116 +5852,139 @@ bool SrsConfig::get_bw_check_enabled(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_bw_check_key(string vhost)
+bool SrsConfig::get_rtc_nack_enabled(string vhost)
 {
-    static string DEFAULT = "";
+    static bool DEFAULT = true;
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("bandcheck");
+    conf = conf->get("rtc");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("key");
+    conf = conf->get("nack");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-srs_utime_t SrsConfig::get_bw_check_interval(string vhost)
+bool SrsConfig::get_vhost_multicast_enabled(string vhost)
 {
-    static int64_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+    static bool DEFAULT = false;
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("bandcheck");
+    conf = conf->get("multicast");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("interval");
-    if (!conf) {
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-int SrsConfig::get_bw_check_limit_kbps(string vhost)
+string SrsConfig::get_vhost_multicast_channel(string vhost, string stream)
 {
-    static int DEFAULT = 1000;
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return "";
+    }
+    
+    conf = conf->get("multicast");
+    if (!conf) {
+        return "";
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* channel = conf->directives.at(i);
+        if (channel->name == "channel" && channel->arg0() == stream) {
+            return channel->arg1();
+        }
+    }
+    
+    return "";
+}
+
+int SrsConfig::get_vhost_multicast_ttl(string vhost)
+{
+    static int DEFAULT = 16;
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("bandcheck");
+    conf = conf->get("multicast");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("limit_kbps");
-    if (!conf) {
+    conf = conf->get("ttl");
+    if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
     return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_vhost_is_edge(string vhost)
-{
-    SrsConfDirective* conf = get_vhost(vhost);
-    return get_vhost_is_edge(conf);
-}
-
-bool SrsConfig::get_vhost_is_edge(SrsConfDirective* vhost)
+string SrsConfig::get_vhost_multicast_interface(string vhost)
 {
-    static bool DEFAULT = false;
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = vhost;
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("cluster");
+    conf = conf->get("multicast");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("mode");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("interface");
+    if (!conf) {
         return DEFAULT;
     }
     
-    return "remote" == conf->arg0();
+    return conf->arg0();
 }
 
-SrsConfDirective* SrsConfig::get_vhost_edge_origin(string vhost)
+srs_utime_t SrsConfig::get_vhost_multicast_delay(string vhost)
 {
+    static srs_utime_t DEFAULT = 100 * SRS_UTIME_MILLISECONDS;
+    
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    conf = conf->get("cluster");
+    conf = conf->get("multicast");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("origin");
+    conf = conf->get("delay");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-bool SrsConfig::get_vhost_edge_token_traverse(string vhost)
+bool SrsConfig::get_vhost_upload_enabled(string vhost)
 {
     static bool DEFAULT = false;
     
@@ -5109,12 +5993,12 @@ bool SrsConfig::get_vhost_edge_token_traverse(string vhost)
         return DEFAULT;
     }
     
-    conf = conf->get("cluster");
+    conf = conf->get("upload");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("token_traverse");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -5122,21 +6006,21 @@ bool SrsConfig::get_vhost_edge_token_traverse(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
+string SrsConfig::get_vhost_upload_endpoint(string vhost)
 {
-    static string DEFAULT = "[vhost]";
+    static string DEFAULT = "";
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("cluster");
+    conf = conf->get("upload");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vhost");
+    conf = conf->get("endpoint");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -5144,302 +6028,353 @@ string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
     return conf->arg0();
 }
 
-bool SrsConfig::get_vhost_origin_cluster(string vhost)
+string SrsConfig::get_vhost_upload_access_key(string vhost)
 {
-    static bool DEFAULT = false;
+    static string DEFAULT = "";
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("cluster");
+    conf = conf->get("upload");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("origin_cluster");
+    conf = conf->get("access_key");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return conf->arg0();
 }
 
-vector<string> SrsConfig::get_vhost_coworkers(string vhost)
+string SrsConfig::get_vhost_upload_secret_key(string vhost)
 {
-    vector<string> coworkers;
-
+    static string DEFAULT = "";
+    
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return coworkers;
+        return DEFAULT;
     }
-
-    conf = conf->get("cluster");
+    
+    conf = conf->get("upload");
     if (!conf) {
-        return coworkers;
+        return DEFAULT;
     }
-
-    conf = conf->get("coworkers");
-    for (int i = 0; i < (int)conf->args.size(); i++) {
-        coworkers.push_back(conf->args.at(i));
+    
+    conf = conf->get("secret_key");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
-
-    return coworkers;
+    
+    return conf->arg0();
 }
 
-bool SrsConfig::get_security_enabled(string vhost)
+string SrsConfig::get_vhost_upload_region(string vhost)
 {
-    static bool DEFAULT = false;
+    static string DEFAULT = "us-east-1";
     
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    SrsConfDirective* security = conf->get("security");
-    if (!security) {
+    conf = conf->get("upload");
+    if (!conf) {
         return DEFAULT;
     }
     
-    conf = security->get("enabled");
+    conf = conf->get("region");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return conf->arg0();
 }
 
-SrsConfDirective* SrsConfig::get_security_rules(string vhost)
+bool SrsConfig::get_vhost_upload_local_copy(string vhost)
 {
+    static bool DEFAULT = true;
+    
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf->get("security");
-}
-
-SrsConfDirective* SrsConfig::get_transcode(string vhost, string scope)
-{
-    SrsConfDirective* conf = get_vhost(vhost);
+    conf = conf->get("upload");
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    conf = conf->get("transcode");
-    if (!conf || conf->arg0() != scope) {
-        return NULL;
+    conf = conf->get("local_copy");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return conf;
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-bool SrsConfig::get_transcode_enabled(SrsConfDirective* conf)
+int SrsConfig::get_vhost_upload_retries(string vhost)
 {
-    static bool DEFAULT = false;
+    static int DEFAULT = 3;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("upload");
+    if (!conf) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    conf = conf->get("retries");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_transcode_ffmpeg(SrsConfDirective* conf)
+int SrsConfig::get_vhost_upload_part_size(string vhost)
 {
-    static string DEFAULT = "";
+    static int DEFAULT = 5 * 1024 * 1024;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("ffmpeg");
+    conf = conf->get("upload");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("part_size");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str()) * 1024 * 1024;
 }
 
-vector<SrsConfDirective*> SrsConfig::get_transcode_engines(SrsConfDirective* conf)
+bool SrsConfig::get_vhost_upload_hls(string vhost)
 {
-    vector<SrsConfDirective*> engines;
+    static bool DEFAULT = true;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return engines;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* engine = conf->directives[i];
-        
-        if (engine->name == "engine") {
-            engines.push_back(engine);
-        }
+    conf = conf->get("upload");
+    if (!conf) {
+        return DEFAULT;
     }
     
-    return engines;
+    conf = conf->get("hls");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-bool SrsConfig::get_engine_enabled(SrsConfDirective* conf)
+bool SrsConfig::get_vhost_upload_dvr(string vhost)
 {
-    static bool DEFAULT = false;
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
     
+    conf = conf->get("upload");
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("dvr");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-string srs_prefix_underscores_ifno(string name)
+bool SrsConfig::get_vhost_abr_enabled(string vhost)
 {
-    if (srs_string_starts_with(name, "-")) {
-        return name;
-    } else {
-        return "-" + name;
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("abr");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-vector<string> SrsConfig::get_engine_perfile(SrsConfDirective* conf)
+vector<string> SrsConfig::get_vhost_abr_renditions(string vhost)
 {
-    vector<string> perfile;
-    
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return perfile;
+        return vector<string>();
     }
     
-    conf = conf->get("perfile");
+    conf = conf->get("abr");
     if (!conf) {
-        return perfile;
+        return vector<string>();
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* option = conf->directives[i];
-        if (!option) {
-            continue;
-        }
-        
-        perfile.push_back(srs_prefix_underscores_ifno(option->name));
-        if (!option->arg0().empty()) {
-            perfile.push_back(option->arg0());
-        }
+    conf = conf->get("renditions");
+    if (!conf) {
+        return vector<string>();
     }
     
-    return perfile;
+    return conf->args;
 }
 
-string SrsConfig::get_engine_iformat(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_vhost_abr_down_queue(string vhost)
 {
-    static string DEFAULT = "flv";
+    static srs_utime_t DEFAULT = 2 * SRS_UTIME_SECONDS;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("iformat");
+    conf = conf->get("abr");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("down_queue");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-vector<string> SrsConfig::get_engine_vfilter(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_vhost_abr_up_stable(string vhost)
 {
-    vector<string> vfilter;
+    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return vfilter;
+        return DEFAULT;
     }
     
-    conf = conf->get("vfilter");
+    conf = conf->get("abr");
     if (!conf) {
-        return vfilter;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* filter = conf->directives[i];
-        if (!filter) {
-            continue;
-        }
-        
-        vfilter.push_back(srs_prefix_underscores_ifno(filter->name));
-        if (!filter->arg0().empty()) {
-            vfilter.push_back(filter->arg0());
-        }
+    conf = conf->get("up_stable");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return vfilter;
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-string SrsConfig::get_engine_vcodec(SrsConfDirective* conf)
+bool SrsConfig::get_vhost_srt_tlpktdrop(string vhost)
 {
-    static string DEFAULT = "";
+    static bool DEFAULT = true;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vcodec");
+    conf = conf->get("srt");
     if (!conf) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    conf = conf->get("tlpktdrop");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-int SrsConfig::get_engine_vbitrate(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_publish_1stpkt_timeout(string vhost)
 {
-    static int DEFAULT = 0;
+    // when no msg recevied for publisher, use larger timeout.
+    static srs_utime_t DEFAULT = 20 * SRS_UTIME_SECONDS;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vbitrate");
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("firstpkt_timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-double SrsConfig::get_engine_vfps(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_publish_normal_timeout(string vhost)
 {
-    static double DEFAULT = 0;
+    // the timeout for publish recv.
+    // we must use more smaller timeout, for the recv never know the status
+    // of underlayer socket.
+    static srs_utime_t DEFAULT = 5 * SRS_UTIME_SECONDS;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vfps");
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("normal_timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atof(conf->arg0().c_str());
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-int SrsConfig::get_engine_vwidth(SrsConfDirective* conf)
+int SrsConfig::get_publish_batch(string vhost)
 {
     static int DEFAULT = 0;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vwidth");
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("batch");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -5447,237 +6382,3544 @@ int SrsConfig::get_engine_vwidth(SrsConfDirective* conf)
     return ::atoi(conf->arg0().c_str());
 }
 
-int SrsConfig::get_engine_vheight(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_publish_latency_marker(string vhost)
 {
-    static int DEFAULT = 0;
+    static srs_utime_t DEFAULT = 0;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vheight");
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("latency_marker");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return (srs_utime_t)(srs_max(0, ::atoi(conf->arg0().c_str())) * SRS_UTIME_MILLISECONDS);
 }
 
-int SrsConfig::get_engine_vthreads(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_publish_reconnect_grace(string vhost)
 {
-    static int DEFAULT = 1;
+    static srs_utime_t DEFAULT = 0;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vthreads");
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("reconnect_grace");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return (srs_utime_t)(srs_max(0, ::atoi(conf->arg0().c_str())) * SRS_UTIME_MILLISECONDS);
 }
 
-string SrsConfig::get_engine_vprofile(SrsConfDirective* conf)
+string SrsConfig::get_publish_capture(string vhost)
 {
     static string DEFAULT = "";
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("vprofile");
+    conf = conf->get("publish");
     if (!conf) {
         return DEFAULT;
     }
     
+    conf = conf->get("capture");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
     return conf->arg0();
 }
 
-string SrsConfig::get_engine_vpreset(SrsConfDirective* conf)
+bool SrsConfig::get_publish_capture_any()
 {
-    static string DEFAULT = "";
+    vector<SrsConfDirective*> vhosts;
+    get_vhosts(vhosts);
     
-    if (!conf) {
-        return DEFAULT;
+    for (int i = 0; i < (int)vhosts.size(); i++) {
+        SrsConfDirective* vhost = vhosts.at(i);
+        if (!get_publish_capture(vhost->arg0()).empty()) {
+            return true;
+        }
     }
     
-    conf = conf->get("vpreset");
-    if (!conf) {
-        return DEFAULT;
+    return false;
+}
+
+int SrsConfig::get_global_chunk_size()
+{
+    SrsConfDirective* conf = root->get("chunk_size");
+    if (!conf || conf->arg0().empty()) {
+        return SRS_CONSTS_RTMP_SRS_CHUNK_SIZE;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-vector<string> SrsConfig::get_engine_vparams(SrsConfDirective* conf)
+bool SrsConfig::get_forward_enabled(string vhost)
 {
-    vector<string> vparams;
+    static bool DEFAULT = false;
     
+    SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return vparams;
+        return DEFAULT;
     }
     
-    conf = conf->get("vparams");
+    conf = conf->get("forward");
     if (!conf) {
-        return vparams;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* filter = conf->directives[i];
-        if (!filter) {
-            continue;
-        }
-        
-        vparams.push_back(srs_prefix_underscores_ifno(filter->name));
-        if (!filter->arg0().empty()) {
-            vparams.push_back(filter->arg0());
-        }
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return vparams;
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_engine_acodec(SrsConfDirective* conf)
+SrsConfDirective* SrsConfig::get_forwards(string vhost)
 {
-    static string DEFAULT = "";
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    conf = conf->get("forward");
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("destination");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_http_hooks(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("http_hooks");
+}
+
+bool SrsConfig::get_vhost_http_hooks_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_connect(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_connect");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_close(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_close");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_publish(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_publish");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_unpublish(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_unpublish");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_play(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_play");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_stop(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_stop");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_dvr(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_dvr");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_hls(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_hls");
+}
+
+SrsConfDirective* SrsConfig::get_vhost_on_hls_notify(string vhost)
+{
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("on_hls_notify");
+}
+
+srs_utime_t SrsConfig::get_vhost_http_hooks_cache_ttl(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cache_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_vhost_http_hooks_batch_interval(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("batch_interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_bw_check_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("bandcheck");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_bw_check_key(string vhost)
+{
+    static string DEFAULT = "";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("bandcheck");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("key");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_bw_check_interval(string vhost)
+{
+    static int64_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("bandcheck");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("interval");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+int SrsConfig::get_bw_check_limit_kbps(string vhost)
+{
+    static int DEFAULT = 1000;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("bandcheck");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("limit_kbps");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_vhost_is_edge(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    return get_vhost_is_edge(conf);
+}
+
+bool SrsConfig::get_vhost_is_edge(SrsConfDirective* vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = vhost;
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mode");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return "remote" == conf->arg0();
+}
+
+SrsConfDirective* SrsConfig::get_vhost_edge_origin(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("origin");
+}
+
+bool SrsConfig::get_vhost_edge_token_traverse(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("token_traverse");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_vhost_edge_token_traverse_ttl(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("token_traverse_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
+{
+    static string DEFAULT = "[vhost]";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vhost");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_vhost_edge_origin_balance(string vhost)
+{
+    static string DEFAULT = "round_robin";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("origin_balance");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_vhost_edge_origin_stagger(string vhost)
+{
+    static srs_utime_t DEFAULT = 300 * SRS_UTIME_MILLISECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("origin_stagger");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+string SrsConfig::get_vhost_edge_protocol(string vhost)
+{
+    static string DEFAULT = "rtmp";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("protocol");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_vhost_edge_mux_connections(string vhost)
+{
+    static int DEFAULT = 2;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mux_connections");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
+}
+
+vector<string> SrsConfig::get_vhost_edge_peers(string vhost)
+{
+    vector<string> peers;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return peers;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return peers;
+    }
+    
+    conf = conf->get("peers");
+    for (int i = 0; conf && i < (int)conf->args.size(); i++) {
+        peers.push_back(conf->args.at(i));
+    }
+    
+    return peers;
+}
+
+vector<string> SrsConfig::get_vhost_edge_hls_origin(string vhost)
+{
+    vector<string> origins;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return origins;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return origins;
+    }
+    
+    conf = conf->get("hls_origin");
+    for (int i = 0; conf && i < (int)conf->args.size(); i++) {
+        origins.push_back(conf->args.at(i));
+    }
+    
+    return origins;
+}
+
+srs_utime_t SrsConfig::get_vhost_edge_hls_playlist_ttl(string vhost)
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_playlist_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+int SrsConfig::get_vhost_edge_publish_window(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("publish_window");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_vhost_edge_publish_inflight(string vhost)
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("publish_inflight");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_vhost_edge_publish_rtt_chunk(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("publish_rtt_chunk");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_vhost_origin_cluster(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("origin_cluster");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+vector<string> SrsConfig::get_vhost_coworkers(string vhost)
+{
+    vector<string> coworkers;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return coworkers;
+    }
+
+    conf = conf->get("cluster");
+    if (!conf) {
+        return coworkers;
+    }
+
+    conf = conf->get("coworkers");
+    for (int i = 0; i < (int)conf->args.size(); i++) {
+        coworkers.push_back(conf->args.at(i));
+    }
+
+    return coworkers;
+}
+
+vector<string> SrsConfig::get_vhost_standby(string vhost)
+{
+    vector<string> standby;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return standby;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return standby;
+    }
+    
+    conf = conf->get("standby");
+    for (int i = 0; conf && i < (int)conf->args.size(); i++) {
+        standby.push_back(conf->args.at(i));
+    }
+    
+    return standby;
+}
+
+bool SrsConfig::get_security_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    SrsConfDirective* security = conf->get("security");
+    if (!security) {
+        return DEFAULT;
+    }
+    
+    conf = security->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_security_rules(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("security");
+}
+
+bool SrsConfig::get_token_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("token");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+vector<string> SrsConfig::get_token_keys(string vhost)
+{
+    vector<string> keys;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return keys;
+    }
+    
+    conf = conf->get("token");
+    if (!conf) {
+        return keys;
+    }
+    
+    conf = conf->get("keys");
+    if (!conf) {
+        return keys;
+    }
+    
+    return conf->args;
+}
+
+bool SrsConfig::get_token_play(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("token");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("play");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_token_publish(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("token");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("publish");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_transcode(string vhost, string scope)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    conf = conf->get("transcode");
+    if (!conf || conf->arg0() != scope) {
+        return NULL;
+    }
+    
+    return conf;
+}
+
+bool SrsConfig::get_transcode_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_transcode_ffmpeg(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("ffmpeg");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_transcode_group(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("group");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_transcode_feed(SrsConfDirective* conf)
+{
+    static string DEFAULT = "rtmp";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("feed");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_transcode_priority(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("priority");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+vector<SrsConfDirective*> SrsConfig::get_transcode_engines(SrsConfDirective* conf)
+{
+    vector<SrsConfDirective*> engines;
+    
+    if (!conf) {
+        return engines;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* engine = conf->directives[i];
+        
+        if (engine->name == "engine") {
+            engines.push_back(engine);
+        }
+    }
+    
+    return engines;
+}
+
+bool SrsConfig::get_engine_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_engine_resource(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("resource");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string srs_prefix_underscores_ifno(string name)
+{
+    if (srs_string_starts_with(name, "-")) {
+        return name;
+    } else {
+        return "-" + name;
+    }
+}
+
+vector<string> SrsConfig::get_engine_perfile(SrsConfDirective* conf)
+{
+    vector<string> perfile;
+    
+    if (!conf) {
+        return perfile;
+    }
+    
+    conf = conf->get("perfile");
+    if (!conf) {
+        return perfile;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* option = conf->directives[i];
+        if (!option) {
+            continue;
+        }
+        
+        perfile.push_back(srs_prefix_underscores_ifno(option->name));
+        if (!option->arg0().empty()) {
+            perfile.push_back(option->arg0());
+        }
+    }
+    
+    return perfile;
+}
+
+string SrsConfig::get_engine_iformat(SrsConfDirective* conf)
+{
+    static string DEFAULT = "flv";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("iformat");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+vector<string> SrsConfig::get_engine_vfilter(SrsConfDirective* conf)
+{
+    vector<string> vfilter;
+    
+    if (!conf) {
+        return vfilter;
+    }
+    
+    conf = conf->get("vfilter");
+    if (!conf) {
+        return vfilter;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* filter = conf->directives[i];
+        if (!filter) {
+            continue;
+        }
+        
+        vfilter.push_back(srs_prefix_underscores_ifno(filter->name));
+        if (!filter->arg0().empty()) {
+            vfilter.push_back(filter->arg0());
+        }
+    }
+    
+    return vfilter;
+}
+
+string SrsConfig::get_engine_vcodec(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vcodec");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_engine_vbitrate(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vbitrate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+double SrsConfig::get_engine_vfps(SrsConfDirective* conf)
+{
+    static double DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vfps");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atof(conf->arg0().c_str());
+}
+
+int SrsConfig::get_engine_vwidth(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vwidth");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_engine_vheight(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vheight");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_engine_vthreads(SrsConfDirective* conf)
+{
+    static int DEFAULT = 1;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vthreads");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+string SrsConfig::get_engine_vprofile(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vprofile");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_engine_vpreset(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vpreset");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+vector<string> SrsConfig::get_engine_vparams(SrsConfDirective* conf)
+{
+    vector<string> vparams;
+    
+    if (!conf) {
+        return vparams;
+    }
+    
+    conf = conf->get("vparams");
+    if (!conf) {
+        return vparams;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* filter = conf->directives[i];
+        if (!filter) {
+            continue;
+        }
+        
+        vparams.push_back(srs_prefix_underscores_ifno(filter->name));
+        if (!filter->arg0().empty()) {
+            vparams.push_back(filter->arg0());
+        }
+    }
+    
+    return vparams;
+}
+
+string SrsConfig::get_engine_acodec(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("acodec");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_engine_abitrate(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("abitrate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_engine_asample_rate(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("asample_rate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_engine_achannels(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("achannels");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+vector<string> SrsConfig::get_engine_aparams(SrsConfDirective* conf)
+{
+    vector<string> aparams;
+    
+    if (!conf) {
+        return aparams;
+    }
+    
+    conf = conf->get("aparams");
+    if (!conf) {
+        return aparams;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* filter = conf->directives[i];
+        if (!filter) {
+            continue;
+        }
+        
+        aparams.push_back(srs_prefix_underscores_ifno(filter->name));
+        if (!filter->arg0().empty()) {
+            aparams.push_back(filter->arg0());
+        }
+    }
+    
+    return aparams;
+}
+
+string SrsConfig::get_engine_oformat(SrsConfDirective* conf)
+{
+    static string DEFAULT = "flv";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("oformat");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_engine_output(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("output");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+SrsConfDirective* SrsConfig::get_exec(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("exec");
+}
+
+bool SrsConfig::get_exec_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_exec(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+vector<SrsConfDirective*> SrsConfig::get_exec_publishs(string vhost)
+{
+    vector<SrsConfDirective*> eps;
+    
+    SrsConfDirective* conf = get_exec(vhost);
+    if (!conf) {
+        return eps;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* ep = conf->at(i);
+        if (ep->name == "publish") {
+            eps.push_back(ep);
+        }
+    }
+    
+    return eps;
+}
+
+vector<SrsConfDirective*> SrsConfig::get_ingesters(string vhost)
+{
+    vector<SrsConfDirective*> integers;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return integers;
+    }
+    
+    for (int i = 0; i < (int)conf->directives.size(); i++) {
+        SrsConfDirective* ingester = conf->directives[i];
+        
+        if (ingester->name == "ingest") {
+            integers.push_back(ingester);
+        }
+    }
+    
+    return integers;
+}
+
+SrsConfDirective* SrsConfig::get_ingest_by_id(string vhost, string ingest_id)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("ingest", ingest_id);
+}
+
+bool SrsConfig::get_ingest_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_ingest_ffmpeg(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("ffmpeg");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_ingest_input_type(SrsConfDirective* conf)
+{
+    static string DEFAULT = "file";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("input");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("type");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_ingest_input_url(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("input");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("url");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_ingest_input_prefetch(SrsConfDirective* conf)
+{
+    static int DEFAULT = 3;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("input");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("prefetch");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
+}
+
+bool SrsConfig::get_ingest_input_loop(SrsConfDirective* conf)
+{
+    static bool DEFAULT = true;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("input");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("loop");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_ingest_start_jitter()
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("ingest_start_jitter");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atol(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+bool SrsConfig::get_ingest_input_rtsp_tcp(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("input");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("transport");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0() == "tcp";
+}
+
+bool SrsConfig::get_log_tank_file()
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = root->get("srs_log_tank");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0() != "console";
+}
+
+string SrsConfig::get_log_level()
+{
+    static string DEFAULT = "trace";
+    
+    SrsConfDirective* conf = root->get("srs_log_level");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_log_file()
+{
+    static string DEFAULT = "./objs/srs.log";
+    
+    SrsConfDirective* conf = root->get("srs_log_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_log_async()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("srs_log_async");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_log_async_size()
+{
+    static int DEFAULT = 4096;
+    
+    SrsConfDirective* conf = root->get("srs_log_async_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    int v = ::atoi(conf->arg0().c_str());
+    return v > 0? v : DEFAULT;
+}
+
+bool SrsConfig::get_ff_log_enabled()
+{
+    string log = get_ff_log_dir();
+    return log != SRS_CONSTS_NULL_FILE;
+}
+
+string SrsConfig::get_ff_log_dir()
+{
+    static string DEFAULT = "./objs";
+    
+    SrsConfDirective* conf = root->get("ff_log_dir");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_ff_log_level()
+{
+    static string DEFAULT = "info";
+
+    SrsConfDirective* conf = root->get("ff_log_level");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+SrsConfDirective* SrsConfig::get_dash(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    return conf? conf->get("dash") : NULL;
+}
+
+bool SrsConfig::get_dash_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_dash_fragment(string vhost)
+{
+    static int DEFAULT = 30 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_dash_update_period(string vhost)
+{
+    static srs_utime_t DEFAULT = 150 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_update_period");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_dash_timeshift(string vhost)
+{
+    static srs_utime_t DEFAULT = 300 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_timeshift");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_dash_chunk_duration(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_chunk_duration");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+string SrsConfig::get_dash_path(string vhost)
+{
+    static string DEFAULT = "./objs/nginx/html";
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_path");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_dash_mpd_file(string vhost)
+{
+    static string DEFAULT = "[app]/[stream].mpd";
+    
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dash_mpd_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+SrsConfDirective* SrsConfig::get_hls(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    return conf? conf->get("hls") : NULL;
+}
+
+bool SrsConfig::get_hls_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_hls_entry_prefix(string vhost)
+{
+    static string DEFAULT = "";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_entry_prefix");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_path(string vhost)
+{
+    static string DEFAULT = "./objs/nginx/html";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_path");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_m3u8_file(string vhost)
+{
+    static string DEFAULT = "[app]/[stream].m3u8";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_m3u8_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_ts_file(string vhost)
+{
+    static string DEFAULT = "[app]/[stream]-[seq].ts";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_ts_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_hls_ts_floor(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_ts_floor");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_hls_fragment(string vhost)
+{
+    static srs_utime_t DEFAULT = 10 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+double SrsConfig::get_hls_td_ratio(string vhost)
+{
+    static double DEFAULT = 1.5;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_td_ratio");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atof(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_hls_fast_start(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_fast_start");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+double SrsConfig::get_hls_aof_ratio(string vhost)
+{
+    static double DEFAULT = 2.0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_aof_ratio");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atof(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_hls_window(string vhost)
+{
+    static srs_utime_t DEFAULT = (60 * SRS_UTIME_SECONDS);
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_window");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+string SrsConfig::get_hls_on_error(string vhost)
+{
+    // try to ignore the error.
+    static string DEFAULT = "continue";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_on_error");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_acodec(string vhost)
+{
+    static string DEFAULT = "aac";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_acodec");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_vcodec(string vhost)
+{
+    static string DEFAULT = "h264";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_vcodec");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_vhost_hls_nb_notify(string vhost)
+{
+    static int DEFAULT = 64;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_nb_notify");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_vhost_hls_dts_directly(string vhost)
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("hls_dts_directly");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_hls_cleanup(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_cleanup");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_hls_dispose(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_dispose");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_hls_wait_keyframe(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_wait_keyframe");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_hls_checksum(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_checksum");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_hls_memory(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_memory");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_hls_memory_archive(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_memory_archive");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_hls_ll(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_ll");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_hls_ll_part(string vhost)
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_ll_part");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_hls_audio_aggregate(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_audio_aggregate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+srs_utime_t SrsConfig::get_hls_pcr_interval(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_pcr_interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+vector<string> SrsConfig::get_hls_variants(string vhost)
+{
+    vector<string> variants;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return variants;
+    }
+    
+    conf = conf->get("hls_variants");
+    if (!conf) {
+        return variants;
+    }
+    
+    for (int i = 0; i < (int)conf->args.size(); i++) {
+        variants.push_back(conf->args.at(i));
+    }
+    
+    return variants;
+}
+
+bool SrsConfig::get_hls_keys(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_keys");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_hls_fragments_per_key(string vhost)
+{
+    static int DEFAULT = 5;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_fragments_per_key");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_hls_key_offload(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_key_offload");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_hls_key_file(string vhost)
+{
+    static string DEFAULT = "[app]/[stream]-[seq].key";
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_key_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_key_file_path(std::string vhost)
+{
+     //put the key in ts path defaultly.
+    static string DEFAULT = get_hls_path(vhost);
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_key_file_path");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_hls_key_url(std::string vhost)
+{
+     //put the key in ts path defaultly.
+    static string DEFAULT = get_hls_path(vhost);
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_key_url");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+SrsConfDirective *SrsConfig::get_hds(const string &vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("hds");
+}
+
+bool SrsConfig::get_hds_enabled(const string &vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hds(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_hds_path(const string &vhost)
+{
+    static string DEFAULT = "./objs/nginx/html";
+    
+    SrsConfDirective* conf = get_hds(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hds_path");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_hds_fragment(const string &vhost)
+{
+    static srs_utime_t DEFAULT = (10 * SRS_UTIME_SECONDS);
+    
+    SrsConfDirective* conf = get_hds(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hds_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_hds_window(const string &vhost)
+{
+    static srs_utime_t DEFAULT = (60 * SRS_UTIME_SECONDS);
+    
+    SrsConfDirective* conf = get_hds(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hds_window");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+SrsConfDirective* SrsConfig::get_dvr(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("dvr");
+}
+
+bool SrsConfig::get_dvr_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_dvr_apply(string vhost)
+{
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return NULL;
+    }
+    
+    conf = conf->get("dvr_apply");
+    if (!conf || conf->arg0().empty()) {
+        return NULL;
+    }
+    
+    return conf;
+    
+}
+
+string SrsConfig::get_dvr_path(string vhost)
+{
+    static string DEFAULT = "./objs/nginx/html/[app]/[stream].[timestamp].flv";
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_path");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_dvr_plan(string vhost)
+{
+    static string DEFAULT = "session";
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_plan");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_dvr_duration(string vhost)
+{
+    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_duration");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_wait_keyframe(string vhost)
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_wait_keyframe");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_dvr_mp4_fragment(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_mp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_mp4_finalize(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_mp4_finalize");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_dvr_time_jitter(string vhost)
+{
+    static string DEFAULT = "full";
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    
+    if (!conf) {
+        return srs_time_jitter_string2int(DEFAULT);
+    }
+    
+    conf = conf->get("time_jitter");
+    if (!conf || conf->arg0().empty()) {
+        return srs_time_jitter_string2int(DEFAULT);
+    }
+    
+    return srs_time_jitter_string2int(conf->arg0());
+}
+
+bool SrsConfig::get_http_api_enabled()
+{
+    SrsConfDirective* conf = root->get("http_api");
+    return get_http_api_enabled(conf);
+}
+
+bool SrsConfig::get_http_api_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_http_api_listen()
+{
+    static string DEFAULT = "1985";
+    
+    SrsConfDirective* conf = root->get("http_api");
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_http_api_crossdomain()
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("crossdomain");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_raw_api()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("raw_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_raw_api_allow_reload()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("raw_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("allow_reload");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_raw_api_allow_query()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("raw_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("allow_query");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_raw_api_allow_update()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("raw_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("allow_update");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_http_api_control()
+{
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("control");
+}
+
+bool SrsConfig::get_http_api_control_enabled()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_http_api_control();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_http_api_control_listen()
+{
+    static string DEFAULT = "1986";
+    
+    SrsConfDirective* conf = get_http_api_control();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_http_api_control_interval()
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_http_api_control();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_max(100, ::atoi(conf->arg0().c_str())) * SRS_UTIME_MILLISECONDS;
+}
+
+SrsConfDirective* SrsConfig::get_http_api_snapshot()
+{
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return NULL;
+    }
+    
+    return conf->get("snapshot");
+}
+
+bool SrsConfig::get_snapshot_enabled()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_http_api_snapshot();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_snapshot_interval()
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_http_api_snapshot();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+string SrsConfig::get_snapshot_ffmpeg()
+{
+    static string DEFAULT = "";
+    
+    SrsConfDirective* conf = get_http_api_snapshot();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("ffmpeg");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_snapshot_decoders()
+{
+    static int DEFAULT = 2;
+    
+    SrsConfDirective* conf = get_http_api_snapshot();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("decoders");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_snapshot_timeout()
+{
+    static srs_utime_t DEFAULT = 5 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_http_api_snapshot();
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("timeout");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_http_stream_enabled()
+{
+    SrsConfDirective* conf = root->get("http_server");
+    return get_http_stream_enabled(conf);
+}
+
+bool SrsConfig::get_http_stream_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_http_stream_listen()
+{
+    static string DEFAULT = "8080";
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_http_stream_dir()
+{
+    static string DEFAULT = "./objs/nginx/html";
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dir");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_http_stream_crossdomain()
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("crossdomain");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_http_stream_vod_index_cache()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vod_index_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_http_stream_vod_hls_cache()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vod_hls_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_http_stream_vod_hls_fragment()
+{
+    static srs_utime_t DEFAULT = 10 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vod_hls_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+int SrsConfig::get_http_stream_vod_moov_cache()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("vod_moov_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_http_stream_file_cache_fds()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("file_cache_fds");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_http_stream_file_cache_valid()
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("file_cache_valid");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+int SrsConfig::get_http_stream_file_cache_max_size()
+{
+    static int DEFAULT = 256;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("file_cache_max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_http_stream_file_cache_memory()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("file_cache_memory");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_http_stream_segment_max_age()
+{
+    static int DEFAULT = 0;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("segment_max_age");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_http_stream_lazy_mount()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("lazy_mount");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_http_stream_http2()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http2");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_http_stream_http2_max_streams()
+{
+    static int DEFAULT = 100;
+    
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http2_max_streams");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    int v = ::atoi(conf->arg0().c_str());
+    if (v <= 0) {
+        return DEFAULT;
+    }
+    
+    return v;
+}
+
+bool SrsConfig::get_vhost_http_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_static");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_vhost_http_mount(string vhost)
+{
+    static string DEFAULT = "[vhost]/";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_static");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mount");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_vhost_http_dir(string vhost)
+{
+    static string DEFAULT = "./objs/nginx/html";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_static");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dir");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+bool SrsConfig::get_vhost_http_remux_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_vhost_http_remux_fast_cache(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("fast_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+srs_utime_t SrsConfig::get_vhost_http_remux_mp4_fragment(string vhost)
+{
+    static srs_utime_t DEFAULT = 500 * SRS_UTIME_MILLISECONDS;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+string SrsConfig::get_vhost_http_remux_mount(string vhost)
+{
+    static string DEFAULT = "[vhost]/[app]/[stream].flv";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("http_remux");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("mount");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+SrsConfDirective* SrsConfig::get_heartbeart()
+{
+    return root->get("heartbeat");
+}
+
+bool SrsConfig::get_heartbeat_enabled()
+{
+    static bool DEFAULT = false;
     
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("acodec");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-int SrsConfig::get_engine_abitrate(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_heartbeat_interval()
 {
-    static int DEFAULT = 0;
+    static srs_utime_t DEFAULT = (srs_utime_t)(9.9 * SRS_UTIME_SECONDS);
     
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("abitrate");
+    conf = conf->get("interval");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-int SrsConfig::get_engine_asample_rate(SrsConfDirective* conf)
+string SrsConfig::get_heartbeat_url()
 {
-    static int DEFAULT = 0;
+    static string DEFAULT = "http://" SRS_CONSTS_LOCALHOST ":8085/api/v1/servers";
     
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("asample_rate");
+    conf = conf->get("url");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return conf->arg0();
 }
 
-int SrsConfig::get_engine_achannels(SrsConfDirective* conf)
+string SrsConfig::get_heartbeat_device_id()
 {
-    static int DEFAULT = 0;
+    static string DEFAULT = "";
     
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("achannels");
+    conf = conf->get("device_id");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return conf->arg0();
 }
 
-vector<string> SrsConfig::get_engine_aparams(SrsConfDirective* conf)
+bool SrsConfig::get_heartbeat_summaries()
 {
-    vector<string> aparams;
-    
-    if (!conf) {
-        return aparams;
-    }
+    static bool DEFAULT = false;
     
-    conf = conf->get("aparams");
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
-        return aparams;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* filter = conf->directives[i];
-        if (!filter) {
-            continue;
-        }
-        
-        aparams.push_back(srs_prefix_underscores_ifno(filter->name));
-        if (!filter->arg0().empty()) {
-            aparams.push_back(filter->arg0());
-        }
+    conf = conf->get("summaries");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return aparams;
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_engine_oformat(SrsConfDirective* conf)
+int SrsConfig::get_heartbeat_version()
 {
-    static string DEFAULT = "flv";
+    static int DEFAULT = 1;
     
+    SrsConfDirective* conf = get_heartbeart();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("oformat");
+    conf = conf->get("version");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_engine_output(SrsConfDirective* conf)
+SrsConfDirective* SrsConfig::get_stats()
 {
-    static string DEFAULT = "";
+    return root->get("stats");
+}
+
+int SrsConfig::get_stats_network()
+{
+    static int DEFAULT = 0;
     
+    SrsConfDirective* conf = get_stats();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("output");
+    conf = conf->get("network");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-SrsConfDirective* SrsConfig::get_exec(string vhost)
+SrsConfDirective* SrsConfig::get_stats_disk_device()
 {
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = get_stats();
     if (!conf) {
         return NULL;
     }
     
-    return conf->get("exec");
+    conf = conf->get("disk");
+    if (!conf || conf->args.size() == 0) {
+        return NULL;
+    }
+    
+    return conf;
 }
 
-bool SrsConfig::get_exec_enabled(string vhost)
+SrsConfDirective* SrsConfig::get_workers()
+{
+    return root->get("workers");
+}
+
+bool SrsConfig::get_workers_enabled()
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_exec(vhost);
+    SrsConfDirective* conf = get_workers();
     if (!conf) {
         return DEFAULT;
     }
@@ -5690,315 +9932,269 @@ bool SrsConfig::get_exec_enabled(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-vector<SrsConfDirective*> SrsConfig::get_exec_publishs(string vhost)
+int SrsConfig::get_workers_count()
 {
-    vector<SrsConfDirective*> eps;
+    static int DEFAULT = 2;
     
-    SrsConfDirective* conf = get_exec(vhost);
+    SrsConfDirective* conf = get_workers();
     if (!conf) {
-        return eps;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* ep = conf->at(i);
-        if (ep->name == "publish") {
-            eps.push_back(ep);
-        }
+    conf = conf->get("count");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return eps;
+    return ::atoi(conf->arg0().c_str());
 }
 
-vector<SrsConfDirective*> SrsConfig::get_ingesters(string vhost)
+int SrsConfig::get_workers_relay_port()
 {
-    vector<SrsConfDirective*> integers;
+    static int DEFAULT = 19350;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = get_workers();
     if (!conf) {
-        return integers;
+        return DEFAULT;
     }
     
-    for (int i = 0; i < (int)conf->directives.size(); i++) {
-        SrsConfDirective* ingester = conf->directives[i];
-        
-        if (ingester->name == "ingest") {
-            integers.push_back(ingester);
-        }
+    conf = conf->get("relay_port");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
     }
     
-    return integers;
+    return ::atoi(conf->arg0().c_str());
 }
 
-SrsConfDirective* SrsConfig::get_ingest_by_id(string vhost, string ingest_id)
+SrsConfDirective* SrsConfig::get_affinity()
 {
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return NULL;
-    }
-    
-    return conf->get("ingest", ingest_id);
+    return root->get("affinity");
 }
 
-bool SrsConfig::get_ingest_enabled(SrsConfDirective* conf)
+string SrsConfig::get_affinity_cpus()
 {
-    static bool DEFAULT = false;
+    static string DEFAULT = "";
     
+    SrsConfDirective* conf = get_affinity();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("cpus");
+    if (!conf || conf->arg0().empty() || conf->arg0() == "off") {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return conf->arg0();
 }
 
-string SrsConfig::get_ingest_ffmpeg(SrsConfDirective* conf)
+SrsConfDirective* SrsConfig::get_memory()
 {
-    static string DEFAULT = "";
+    return root->get("memory");
+}
+
+string SrsConfig::get_memory_huge_pages()
+{
+    static string DEFAULT = "off";
     
+    SrsConfDirective* conf = get_memory();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("ffmpeg");
-    if (!conf) {
+    conf = conf->get("huge_pages");
+    if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
     return conf->arg0();
 }
 
-string SrsConfig::get_ingest_input_type(SrsConfDirective* conf)
+bool SrsConfig::get_memory_numa()
 {
-    static string DEFAULT = "file";
-    
-    if (!conf) {
-        return DEFAULT;
-    }
+    static bool DEFAULT = false;
     
-    conf = conf->get("input");
+    SrsConfDirective* conf = get_memory();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("type");
+    conf = conf->get("numa");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_ingest_input_url(SrsConfDirective* conf)
+SrsConfDirective* SrsConfig::get_tls()
 {
-    static string DEFAULT = "";
-    
-    if (!conf) {
-        return DEFAULT;
-    }
+    return root->get("tls");
+}
+
+bool SrsConfig::get_tls_enabled()
+{
+    static bool DEFAULT = false;
     
-    conf = conf->get("input");
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("url");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_log_tank_file()
+string SrsConfig::get_tls_rtmps()
 {
-    static bool DEFAULT = true;
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = root->get("srs_log_tank");
-    if (!conf || conf->arg0().empty()) {
+    SrsConfDirective* conf = get_tls();
+    if (!conf) {
         return DEFAULT;
     }
     
-    return conf->arg0() != "console";
-}
-
-string SrsConfig::get_log_level()
-{
-    static string DEFAULT = "trace";
-    
-    SrsConfDirective* conf = root->get("srs_log_level");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("rtmps");
+    if (!conf || conf->arg0().empty() || conf->arg0() == "off") {
         return DEFAULT;
     }
     
     return conf->arg0();
 }
 
-string SrsConfig::get_log_file()
+string SrsConfig::get_tls_https()
 {
-    static string DEFAULT = "./objs/srs.log";
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = root->get("srs_log_file");
-    if (!conf || conf->arg0().empty()) {
+    SrsConfDirective* conf = get_tls();
+    if (!conf) {
         return DEFAULT;
     }
     
-    return conf->arg0();
-}
-
-bool SrsConfig::get_ff_log_enabled()
-{
-    string log = get_ff_log_dir();
-    return log != SRS_CONSTS_NULL_FILE;
-}
-
-string SrsConfig::get_ff_log_dir()
-{
-    static string DEFAULT = "./objs";
-    
-    SrsConfDirective* conf = root->get("ff_log_dir");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("https");
+    if (!conf || conf->arg0().empty() || conf->arg0() == "off") {
         return DEFAULT;
     }
     
     return conf->arg0();
 }
 
-string SrsConfig::get_ff_log_level()
-{
-    static string DEFAULT = "info";
-
-    SrsConfDirective* conf = root->get("ff_log_level");
-    if (!conf || conf->arg0().empty()) {
-        return DEFAULT;
-    }
-
-    return conf->arg0();
-}
-
-SrsConfDirective* SrsConfig::get_dash(string vhost)
-{
-    SrsConfDirective* conf = get_vhost(vhost);
-    return conf? conf->get("dash") : NULL;
-}
-
-bool SrsConfig::get_dash_enabled(string vhost)
+string SrsConfig::get_tls_certificate()
 {
-    static bool DEFAULT = false;
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("certificate");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return conf->arg0();
 }
 
-srs_utime_t SrsConfig::get_dash_fragment(string vhost)
+string SrsConfig::get_tls_key()
 {
-    static int DEFAULT = 30 * SRS_UTIME_SECONDS;
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dash_fragment");
+    conf = conf->get("key");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return conf->arg0();
 }
 
-srs_utime_t SrsConfig::get_dash_update_period(string vhost)
+bool SrsConfig::get_tls_ktls()
 {
-    static srs_utime_t DEFAULT = 150 * SRS_UTIME_SECONDS;
+    static bool DEFAULT = true;
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dash_update_period");
+    conf = conf->get("ktls");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-srs_utime_t SrsConfig::get_dash_timeshift(string vhost)
+bool SrsConfig::get_tls_session_tickets()
 {
-    static srs_utime_t DEFAULT = 300 * SRS_UTIME_SECONDS;
+    static bool DEFAULT = true;
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dash_timeshift");
+    conf = conf->get("session_tickets");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-string SrsConfig::get_dash_path(string vhost)
+string SrsConfig::get_tls_ticket_key()
 {
-    static string DEFAULT = "./objs/nginx/html";
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dash_path");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("ticket_key");
+    if (!conf || conf->arg0().empty() || conf->arg0() == "off") {
         return DEFAULT;
     }
     
     return conf->arg0();
 }
 
-string SrsConfig::get_dash_mpd_file(string vhost)
+srs_utime_t SrsConfig::get_tls_session_timeout()
 {
-    static string DEFAULT = "[app]/[stream].mpd";
+    static srs_utime_t DEFAULT = 300 * SRS_UTIME_SECONDS;
     
-    SrsConfDirective* conf = get_dash(vhost);
+    SrsConfDirective* conf = get_tls();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dash_mpd_file");
+    conf = conf->get("session_timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-SrsConfDirective* SrsConfig::get_hls(string vhost)
+SrsConfDirective* SrsConfig::get_srt_server()
 {
-    SrsConfDirective* conf = get_vhost(vhost);
-    return conf? conf->get("hls") : NULL;
+    return root->get("srt_server");
 }
 
-bool SrsConfig::get_hls_enabled(string vhost)
+bool SrsConfig::get_srt_enabled()
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
-    
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
@@ -6011,601 +10207,617 @@ bool SrsConfig::get_hls_enabled(string vhost)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_hls_entry_prefix(string vhost)
+int SrsConfig::get_srt_listen()
 {
-    static string DEFAULT = "";
+    static int DEFAULT = 10080;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_entry_prefix");
-    if (!conf) {
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_hls_path(string vhost)
+int SrsConfig::get_srt_latency()
 {
-    static string DEFAULT = "./objs/nginx/html";
+    static int DEFAULT = 120;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_path");
+    conf = conf->get("latency");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_hls_m3u8_file(string vhost)
+int64_t SrsConfig::get_srt_maxbw()
 {
-    static string DEFAULT = "[app]/[stream].m3u8";
+    static int64_t DEFAULT = -1;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_m3u8_file");
+    conf = conf->get("maxbw");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoll(conf->arg0().c_str());
 }
 
-string SrsConfig::get_hls_ts_file(string vhost)
+int SrsConfig::get_srt_payload_size()
 {
-    static string DEFAULT = "[app]/[stream]-[seq].ts";
+    static int DEFAULT = 1316;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_ts_file");
+    conf = conf->get("payload_size");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_hls_ts_floor(string vhost)
+srs_utime_t SrsConfig::get_srt_peer_idle_timeout()
 {
-    static bool DEFAULT = false;
+    static srs_utime_t DEFAULT = 10 * SRS_UTIME_SECONDS;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_ts_floor");
+    conf = conf->get("peer_idle_timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-srs_utime_t SrsConfig::get_hls_fragment(string vhost)
+string SrsConfig::get_srt_default_app()
 {
-    static srs_utime_t DEFAULT = 10 * SRS_UTIME_SECONDS;
+    static string DEFAULT = "live";
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_srt_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_fragment");
+    conf = conf->get("default_app");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return conf->arg0();
 }
 
-double SrsConfig::get_hls_td_ratio(string vhost)
+SrsConfDirective* SrsConfig::get_rtc_server()
 {
-    static double DEFAULT = 1.5;
+    return root->get("rtc_server");
+}
+
+bool SrsConfig::get_rtc_server_enabled()
+{
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_rtc_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_td_ratio");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atof(conf->arg0().c_str());
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-double SrsConfig::get_hls_aof_ratio(string vhost)
+int SrsConfig::get_rtc_server_listen()
 {
-    static double DEFAULT = 2.0;
+    static int DEFAULT = 8000;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_rtc_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_aof_ratio");
+    conf = conf->get("listen");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atof(conf->arg0().c_str());
+    return ::atoi(conf->arg0().c_str());
 }
 
-srs_utime_t SrsConfig::get_hls_window(string vhost)
+string SrsConfig::get_rtc_server_candidate()
 {
-    static srs_utime_t DEFAULT = (60 * SRS_UTIME_SECONDS);
+    static string DEFAULT = "*";
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_rtc_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_window");
+    conf = conf->get("candidate");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return conf->arg0();
 }
 
-string SrsConfig::get_hls_on_error(string vhost)
+SrsConfDirective* SrsConfig::get_relay_server()
 {
-    // try to ignore the error.
-    static string DEFAULT = "continue";
+    return root->get("relay_server");
+}
+
+bool SrsConfig::get_relay_server_enabled()
+{
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_relay_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_on_error");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_hls_acodec(string vhost)
+int SrsConfig::get_relay_server_listen()
 {
-    static string DEFAULT = "aac";
+    static int DEFAULT = 1935;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_relay_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_acodec");
+    conf = conf->get("listen");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_hls_vcodec(string vhost)
+string SrsConfig::get_relay_server_secret()
 {
-    static string DEFAULT = "h264";
+    static string DEFAULT = "";
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_relay_server();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_vcodec");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("secret");
+    if (!conf) {
         return DEFAULT;
     }
     
     return conf->arg0();
 }
 
-int SrsConfig::get_vhost_hls_nb_notify(string vhost)
+SrsConfDirective* SrsConfig::get_disk_io()
 {
-    static int DEFAULT = 64;
+    return root->get("disk_io");
+}
+
+bool SrsConfig::get_disk_io_enabled()
+{
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_nb_notify");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_vhost_hls_dts_directly(string vhost)
+int SrsConfig::get_disk_io_threads()
 {
-    static bool DEFAULT = true;
-
-    SrsConfDirective* conf = get_hls(vhost);
+    static int DEFAULT = 2;
+    
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
-
-    conf = conf->get("hls_dts_directly");
+    
+    conf = conf->get("threads");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
-
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_hls_cleanup(string vhost)
+int64_t SrsConfig::get_disk_io_max_pending()
 {
-    static bool DEFAULT = true;
+    static int64_t DEFAULT = 16 * 1024 * 1024;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_cleanup");
+    conf = conf->get("max_pending");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return 1024 * (int64_t)::atoll(conf->arg0().c_str());
 }
 
-srs_utime_t SrsConfig::get_hls_dispose(string vhost)
+bool SrsConfig::get_disk_io_fsync()
 {
-    static srs_utime_t DEFAULT = 0;
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_dispose");
+    conf = conf->get("fsync");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_hls_wait_keyframe(string vhost)
+int SrsConfig::get_disk_io_buffer()
 {
-    static bool DEFAULT = true;
+    static int DEFAULT = 64 * 1024;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_wait_keyframe");
+    conf = conf->get("buffer");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return 1024 * ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_hls_keys(string vhost)
+bool SrsConfig::get_disk_io_direct()
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_keys");
+    conf = conf->get("direct");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-int SrsConfig::get_hls_fragments_per_key(string vhost)
+bool SrsConfig::get_disk_io_mux()
 {
-    static int DEFAULT = 5;
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_disk_io();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_fragments_per_key");
+    conf = conf->get("mux");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_hls_key_file(string vhost)
+SrsConfDirective* SrsConfig::get_fanout()
 {
-    static string DEFAULT = "[app]/[stream]-[seq].key";
+    return root->get("fanout");
+}
+
+bool SrsConfig::get_fanout_enabled()
+{
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_fanout();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_key_file");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_hls_key_file_path(std::string vhost)
+int SrsConfig::get_fanout_threads()
 {
-     //put the key in ts path defaultly.
-    static string DEFAULT = get_hls_path(vhost);
+    static int DEFAULT = 4;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_fanout();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_key_file_path");
+    conf = conf->get("threads");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_hls_key_url(std::string vhost)
+int SrsConfig::get_fanout_max_pending()
 {
-     //put the key in ts path defaultly.
-    static string DEFAULT = get_hls_path(vhost);
+    static int DEFAULT = 4 * 1024 * 1024;
     
-    SrsConfDirective* conf = get_hls(vhost);
+    SrsConfDirective* conf = get_fanout();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hls_key_url");
+    conf = conf->get("max_pending");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return 1024 * ::atoi(conf->arg0().c_str());
 }
 
-SrsConfDirective *SrsConfig::get_hds(const string &vhost)
+SrsConfDirective* SrsConfig::get_async_call()
 {
-    SrsConfDirective* conf = get_vhost(vhost);
-    
-    if (!conf) {
-        return NULL;
-    }
-    
-    return conf->get("hds");
+    return root->get("async_call");
 }
 
-bool SrsConfig::get_hds_enabled(const string &vhost)
+int SrsConfig::get_async_call_lanes()
 {
-    static bool DEFAULT = false;
+    static int DEFAULT = 4;
     
-    SrsConfDirective* conf = get_hds(vhost);
+    SrsConfDirective* conf = get_async_call();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("lanes");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
 }
 
-string SrsConfig::get_hds_path(const string &vhost)
+int SrsConfig::get_async_call_max_tasks()
 {
-    static string DEFAULT = "./objs/nginx/html";
+    static int DEFAULT = 1024;
     
-    SrsConfDirective* conf = get_hds(vhost);
+    SrsConfDirective* conf = get_async_call();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hds_path");
+    conf = conf->get("max_tasks");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-srs_utime_t SrsConfig::get_hds_fragment(const string &vhost)
+srs_utime_t SrsConfig::get_async_call_timeout()
 {
-    static srs_utime_t DEFAULT = (10 * SRS_UTIME_SECONDS);
+    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
     
-    SrsConfDirective* conf = get_hds(vhost);
+    SrsConfDirective* conf = get_async_call();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hds_fragment");
+    conf = conf->get("timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-srs_utime_t SrsConfig::get_hds_window(const string &vhost)
+SrsConfDirective* SrsConfig::get_io_uring()
 {
-    static srs_utime_t DEFAULT = (60 * SRS_UTIME_SECONDS);
+    return root->get("io_uring");
+}
+
+bool SrsConfig::get_io_uring_enabled()
+{
+    static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_hds(vhost);
+    SrsConfDirective* conf = get_io_uring();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("hds_window");
+    conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
-}
-
-SrsConfDirective* SrsConfig::get_dvr(string vhost)
-{
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return NULL;
-    }
-    
-    return conf->get("dvr");
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_dvr_enabled(string vhost)
+int SrsConfig::get_io_uring_entries()
 {
-    static bool DEFAULT = false;
+    static int DEFAULT = 4096;
     
-    SrsConfDirective* conf = get_dvr(vhost);
+    SrsConfDirective* conf = get_io_uring();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("entries");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-SrsConfDirective* SrsConfig::get_dvr_apply(string vhost)
+bool SrsConfig::get_io_uring_write()
 {
-    SrsConfDirective* conf = get_dvr(vhost);
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_io_uring();
     if (!conf) {
-        return NULL;
+        return DEFAULT;
     }
     
-    conf = conf->get("dvr_apply");
+    conf = conf->get("write");
     if (!conf || conf->arg0().empty()) {
-        return NULL;
+        return DEFAULT;
     }
     
-    return conf;
-    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-string SrsConfig::get_dvr_path(string vhost)
+SrsConfDirective* SrsConfig::get_accept()
 {
-    static string DEFAULT = "./objs/nginx/html/[app]/[stream].[timestamp].flv";
+    return root->get("accept");
+}
+
+int SrsConfig::get_accept_batch()
+{
+    static int DEFAULT = 16;
     
-    SrsConfDirective* conf = get_dvr(vhost);
+    SrsConfDirective* conf = get_accept();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dvr_path");
+    conf = conf->get("batch");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
 }
 
-string SrsConfig::get_dvr_plan(string vhost)
+int SrsConfig::get_accept_rate()
 {
-    static string DEFAULT = "session";
+    static int DEFAULT = 0;
     
-    SrsConfDirective* conf = get_dvr(vhost);
+    SrsConfDirective* conf = get_accept();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dvr_plan");
+    conf = conf->get("rate");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-srs_utime_t SrsConfig::get_dvr_duration(string vhost)
+int SrsConfig::get_accept_defer()
 {
-    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+    static int DEFAULT = 0;
     
-    SrsConfDirective* conf = get_dvr(vhost);
+    SrsConfDirective* conf = get_accept();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dvr_duration");
+    conf = conf->get("defer");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_dvr_wait_keyframe(string vhost)
+int SrsConfig::get_accept_fastopen()
 {
-    static bool DEFAULT = true;
+    static int DEFAULT = 0;
     
-    SrsConfDirective* conf = get_dvr(vhost);
+    SrsConfDirective* conf = get_accept();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dvr_wait_keyframe");
+    conf = conf->get("fastopen");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-int SrsConfig::get_dvr_time_jitter(string vhost)
+SrsConfDirective* SrsConfig::get_handshake()
 {
-    static string DEFAULT = "full";
-    
-    SrsConfDirective* conf = get_dvr(vhost);
+    return root->get("handshake");
+}
+
+int SrsConfig::get_handshake_dh_pool()
+{
+    static int DEFAULT = 128;
     
+    SrsConfDirective* conf = get_handshake();
     if (!conf) {
-        return srs_time_jitter_string2int(DEFAULT);
+        return DEFAULT;
     }
     
-    conf = conf->get("time_jitter");
+    conf = conf->get("dh_pool");
     if (!conf || conf->arg0().empty()) {
-        return srs_time_jitter_string2int(DEFAULT);
+        return DEFAULT;
     }
     
-    return srs_time_jitter_string2int(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_http_api_enabled()
+SrsConfDirective* SrsConfig::get_admission()
 {
-    SrsConfDirective* conf = root->get("http_api");
-    return get_http_api_enabled(conf);
+    return root->get("admission");
 }
 
-bool SrsConfig::get_http_api_enabled(SrsConfDirective* conf)
+bool SrsConfig::get_admission_enabled()
 {
     static bool DEFAULT = false;
     
+    SrsConfDirective* conf = get_admission();
     if (!conf) {
         return DEFAULT;
     }
@@ -6618,51 +10830,67 @@ bool SrsConfig::get_http_api_enabled(SrsConfDirective* conf)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_http_api_listen()
+int SrsConfig::get_admission_max_kbps()
 {
-    static string DEFAULT = "1985";
-    
-    SrsConfDirective* conf = root->get("http_api");
+    static int DEFAULT = 0;
     
+    SrsConfDirective* conf = get_admission();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("listen");
+    conf = conf->get("max_kbps");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_http_api_crossdomain()
+vector<string> SrsConfig::get_admission_rtmp_redirect()
 {
-    static bool DEFAULT = true;
+    vector<string> servers;
     
-    SrsConfDirective* conf = root->get("http_api");
+    SrsConfDirective* conf = get_admission();
     if (!conf) {
-        return DEFAULT;
+        return servers;
     }
     
-    conf = conf->get("crossdomain");
-    if (!conf || conf->arg0().empty()) {
-        return DEFAULT;
+    conf = conf->get("rtmp_redirect");
+    for (int i = 0; conf && i < (int)conf->args.size(); i++) {
+        servers.push_back(conf->args.at(i));
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return servers;
 }
 
-bool SrsConfig::get_raw_api()
+vector<string> SrsConfig::get_admission_http_redirect()
 {
-    static bool DEFAULT = false;
+    vector<string> servers;
     
-    SrsConfDirective* conf = root->get("http_api");
+    SrsConfDirective* conf = get_admission();
     if (!conf) {
-        return DEFAULT;
+        return servers;
     }
     
-    conf = conf->get("raw_api");
+    conf = conf->get("http_redirect");
+    for (int i = 0; conf && i < (int)conf->args.size(); i++) {
+        servers.push_back(conf->args.at(i));
+    }
+    
+    return servers;
+}
+
+SrsConfDirective* SrsConfig::get_overload()
+{
+    return root->get("overload");
+}
+
+bool SrsConfig::get_overload_enabled()
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_overload();
     if (!conf) {
         return DEFAULT;
     }
@@ -6675,82 +10903,67 @@ bool SrsConfig::get_raw_api()
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_raw_api_allow_reload()
+srs_utime_t SrsConfig::get_overload_max_lag()
 {
-    static bool DEFAULT = false;
-    
-    SrsConfDirective* conf = root->get("http_api");
-    if (!conf) {
-        return DEFAULT;
-    }
+    static srs_utime_t DEFAULT = 100 * SRS_UTIME_MILLISECONDS;
     
-    conf = conf->get("raw_api");
+    SrsConfDirective* conf = get_overload();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("allow_reload");
+    conf = conf->get("max_lag");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-bool SrsConfig::get_raw_api_allow_query()
+int SrsConfig::get_overload_max_cpu()
 {
-    static bool DEFAULT = false;
-    
-    SrsConfDirective* conf = root->get("http_api");
-    if (!conf) {
-        return DEFAULT;
-    }
+    static int DEFAULT = 90;
     
-    conf = conf->get("raw_api");
+    SrsConfDirective* conf = get_overload();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("allow_query");
+    conf = conf->get("max_cpu");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_raw_api_allow_update()
+double SrsConfig::get_overload_drop_ratio()
 {
-    static bool DEFAULT = false;
-    
-    SrsConfDirective* conf = root->get("http_api");
-    if (!conf) {
-        return DEFAULT;
-    }
+    static double DEFAULT = 0.3;
     
-    conf = conf->get("raw_api");
+    SrsConfDirective* conf = get_overload();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("allow_update");
+    conf = conf->get("drop_ratio");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return ::atof(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_http_stream_enabled()
+SrsConfDirective* SrsConfig::get_access_log()
 {
-    SrsConfDirective* conf = root->get("http_server");
-    return get_http_stream_enabled(conf);
+    return root->get("access_log");
 }
 
-bool SrsConfig::get_http_stream_enabled(SrsConfDirective* conf)
+bool SrsConfig::get_access_log_enabled()
 {
     static bool DEFAULT = false;
     
+    SrsConfDirective* conf = get_access_log();
     if (!conf) {
         return DEFAULT;
     }
@@ -6763,16 +10976,16 @@ bool SrsConfig::get_http_stream_enabled(SrsConfDirective* conf)
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_http_stream_listen()
+string SrsConfig::get_access_log_path()
 {
-    static string DEFAULT = "8080";
+    static string DEFAULT = "./objs/access.log";
     
-    SrsConfDirective* conf = root->get("http_server");
+    SrsConfDirective* conf = get_access_log();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("listen");
+    conf = conf->get("path");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -6780,16 +10993,16 @@ string SrsConfig::get_http_stream_listen()
     return conf->arg0();
 }
 
-string SrsConfig::get_http_stream_dir()
+string SrsConfig::get_access_log_format()
 {
-    static string DEFAULT = "./objs/nginx/html";
+    static string DEFAULT = "json";
     
-    SrsConfDirective* conf = root->get("http_server");
+    SrsConfDirective* conf = get_access_log();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dir");
+    conf = conf->get("format");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -6797,148 +11010,145 @@ string SrsConfig::get_http_stream_dir()
     return conf->arg0();
 }
 
-bool SrsConfig::get_http_stream_crossdomain()
+int SrsConfig::get_access_log_rate()
 {
-    static bool DEFAULT = true;
+    static int DEFAULT = 1000;
     
-    SrsConfDirective* conf = root->get("http_server");
+    SrsConfDirective* conf = get_access_log();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("crossdomain");
+    conf = conf->get("rate");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
 }
 
-bool SrsConfig::get_vhost_http_enabled(string vhost)
+int SrsConfig::get_access_log_burst()
 {
-    static bool DEFAULT = false;
-    
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return DEFAULT;
-    }
+    static int DEFAULT = 2000;
     
-    conf = conf->get("http_static");
+    SrsConfDirective* conf = get_access_log();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("enabled");
+    conf = conf->get("burst");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
 }
 
-string SrsConfig::get_vhost_http_mount(string vhost)
+SrsConfDirective* SrsConfig::get_scheduler()
 {
-    static string DEFAULT = "[vhost]/";
-    
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return DEFAULT;
-    }
+    return root->get("scheduler");
+}
+
+bool SrsConfig::get_scheduler_profile()
+{
+    static bool DEFAULT = false;
     
-    conf = conf->get("http_static");
+    SrsConfDirective* conf = get_scheduler();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("mount");
+    conf = conf->get("profile");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-string SrsConfig::get_vhost_http_dir(string vhost)
+int SrsConfig::get_scheduler_slice()
 {
-    static string DEFAULT = "./objs/nginx/html";
-    
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return DEFAULT;
-    }
+    static int DEFAULT = 64 * 1024;
     
-    conf = conf->get("http_static");
+    SrsConfDirective* conf = get_scheduler();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("dir");
+    conf = conf->get("slice");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
 }
 
-bool SrsConfig::get_vhost_http_remux_enabled(string vhost)
+SrsConfDirective* SrsConfig::get_flight_recorder()
 {
-    static bool DEFAULT = false;
-
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return DEFAULT;
-    }
+    return root->get("flight_recorder");
+}
 
-    conf = conf->get("http_remux");
+bool SrsConfig::get_flight_recorder_enabled()
+{
+    static bool DEFAULT = true;
+    
+    SrsConfDirective* conf = get_flight_recorder();
     if (!conf) {
         return DEFAULT;
     }
-
+    
     conf = conf->get("enabled");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
-
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
-srs_utime_t SrsConfig::get_vhost_http_remux_fast_cache(string vhost)
+int SrsConfig::get_flight_recorder_events()
 {
-    static srs_utime_t DEFAULT = 0;
-    
-    SrsConfDirective* conf = get_vhost(vhost);
-    if (!conf) {
-        return DEFAULT;
-    }
+    static int DEFAULT = 65536;
     
-    conf = conf->get("http_remux");
+    SrsConfDirective* conf = get_flight_recorder();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("fast_cache");
+    conf = conf->get("events");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
 }
 
-string SrsConfig::get_vhost_http_remux_mount(string vhost)
+srs_utime_t SrsConfig::get_flight_recorder_threshold()
 {
-    static string DEFAULT = "[vhost]/[app]/[stream].flv";
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_MILLISECONDS;
     
-    SrsConfDirective* conf = get_vhost(vhost);
+    SrsConfDirective* conf = get_flight_recorder();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("http_remux");
+    conf = conf->get("threshold");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_max(0, (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS));
+}
+
+string SrsConfig::get_flight_recorder_file()
+{
+    static string DEFAULT = "./objs/srs.recorder";
+    
+    SrsConfDirective* conf = get_flight_recorder();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("mount");
+    conf = conf->get("file");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
@@ -6946,16 +11156,16 @@ string SrsConfig::get_vhost_http_remux_mount(string vhost)
     return conf->arg0();
 }
 
-SrsConfDirective* SrsConfig::get_heartbeart()
+SrsConfDirective* SrsConfig::get_transcode_scheduler()
 {
-    return root->get("heartbeat");
+    return root->get("transcode_scheduler");
 }
 
-bool SrsConfig::get_heartbeat_enabled()
+bool SrsConfig::get_transcode_scheduler_enabled()
 {
     static bool DEFAULT = false;
     
-    SrsConfDirective* conf = get_heartbeart();
+    SrsConfDirective* conf = get_transcode_scheduler();
     if (!conf) {
         return DEFAULT;
     }
@@ -6968,107 +11178,92 @@ bool SrsConfig::get_heartbeat_enabled()
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-srs_utime_t SrsConfig::get_heartbeat_interval()
+int SrsConfig::get_transcode_scheduler_slots(string resource)
 {
-    static srs_utime_t DEFAULT = (srs_utime_t)(9.9 * SRS_UTIME_SECONDS);
+    static int DEFAULT = 0;
     
-    SrsConfDirective* conf = get_heartbeart();
+    SrsConfDirective* conf = get_transcode_scheduler();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("interval");
+    conf = conf->get(resource);
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
 }
 
-string SrsConfig::get_heartbeat_url()
+SrsConfDirective* SrsConfig::get_rtsp_client()
 {
-    static string DEFAULT = "http://" SRS_CONSTS_LOCALHOST ":8085/api/v1/servers";
+    return root->get("rtsp_client");
+}
+
+int SrsConfig::get_rtsp_client_rtp_port_min()
+{
+    static int DEFAULT = 58000;
     
-    SrsConfDirective* conf = get_heartbeart();
+    SrsConfDirective* conf = get_rtsp_client();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("url");
+    conf = conf->get("rtp_port_min");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_heartbeat_device_id()
+int SrsConfig::get_rtsp_client_rtp_port_max()
 {
-    static string DEFAULT = "";
+    static int DEFAULT = 58008;
     
-    SrsConfDirective* conf = get_heartbeart();
+    SrsConfDirective* conf = get_rtsp_client();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("device_id");
+    conf = conf->get("rtp_port_max");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_heartbeat_summaries()
+srs_utime_t SrsConfig::get_rtsp_client_timeout()
 {
-    static bool DEFAULT = false;
+    static srs_utime_t DEFAULT = 5 * SRS_UTIME_SECONDS;
     
-    SrsConfDirective* conf = get_heartbeart();
+    SrsConfDirective* conf = get_rtsp_client();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("summaries");
+    conf = conf->get("timeout");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
-}
-
-SrsConfDirective* SrsConfig::get_stats()
-{
-    return root->get("stats");
+    return srs_max(1, ::atoi(conf->arg0().c_str())) * SRS_UTIME_SECONDS;
 }
 
-int SrsConfig::get_stats_network()
+int SrsConfig::get_rtsp_client_rtp_reorder_depth()
 {
-    static int DEFAULT = 0;
+    static int DEFAULT = 16;
     
-    SrsConfDirective* conf = get_stats();
+    SrsConfDirective* conf = get_rtsp_client();
     if (!conf) {
         return DEFAULT;
     }
     
-    conf = conf->get("network");
+    conf = conf->get("rtp_reorder_depth");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
     
-    return ::atoi(conf->arg0().c_str());
-}
-
-SrsConfDirective* SrsConfig::get_stats_disk_device()
-{
-    SrsConfDirective* conf = get_stats();
-    if (!conf) {
-        return NULL;
-    }
-    
-    conf = conf->get("disk");
-    if (!conf || conf->args.size() == 0) {
-        return NULL;
-    }
-    
-    return conf;
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
 }
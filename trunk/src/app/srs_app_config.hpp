@@ -46,6 +46,7 @@ class SrsConfig;
 class SrsRequest;
 class SrsJsonArray;
 class SrsConfDirective;
+class SrsSecurityRules;
 
 /**
  * whether the two vector actual equals, for instance,
@@ -65,7 +66,7 @@ bool srs_vector_actual_equals(const std::vector<T>& a, const std::vector<T>& b)
             return false;
         }
     }
-
+    
     // all elements of b in a.
     for (int i = 0; i < (int)b.size(); i++) {
         const T& e = b.at(i);
@@ -73,7 +74,7 @@ bool srs_vector_actual_equals(const std::vector<T>& a, const std::vector<T>& b)
             return false;
         }
     }
-
+    
     return true;
 }
 
@@ -108,12 +109,19 @@ namespace srs_internal
 // Deep compare directive.
 extern bool srs_directive_equals(SrsConfDirective* a, SrsConfDirective* b);
 extern bool srs_directive_equals(SrsConfDirective* a, SrsConfDirective* b, std::string except);
+// The hash of directive tree, the name, args and all children, 0 for NULL.
+// @remark The same tree always has the same fingerprint, and different trees almost never collide.
+extern uint64_t srs_directive_fingerprint(SrsConfDirective* conf);
 
 // The helper utilities, used for compare the consts values.
 extern bool srs_config_hls_is_on_error_ignore(std::string strategy);
 extern bool srs_config_hls_is_on_error_continue(std::string strategy);
 extern bool srs_config_ingest_is_file(std::string type);
 extern bool srs_config_ingest_is_stream(std::string type);
+extern bool srs_config_ingest_is_hls(std::string type);
+extern bool srs_config_ingest_is_http_ts(std::string type);
+extern bool srs_config_ingest_is_rtsp(std::string type);
+extern bool srs_config_ingest_is_playout(std::string type);
 extern bool srs_config_dvr_is_plan_segment(std::string plan);
 extern bool srs_config_dvr_is_plan_session(std::string plan);
 extern bool srs_stream_caster_is_udp(std::string caster);
@@ -261,6 +269,54 @@ private:
     virtual srs_error_t read_token(srs_internal::SrsConfigBuffer* buffer, std::vector<std::string>& args, int& line_start);
 };
 
+// The resolved play and publish settings of vhost, to avoid walking the directive tree in the hot path.
+// @remark It's safe to keep the pointer, which is updated when reload and never freed until config destroyed.
+class SrsVhostSnapshot
+{
+public:
+    // The generation of config when resolved, @see SrsConfig::vhost_generation.
+    int generation;
+public:
+    bool gop_cache;
+    srs_utime_t gop_cache_max_duration;
+    int64_t gop_cache_max_size;
+    srs_utime_t gop_cache_fast_start;
+    srs_utime_t http_remux_fast_cache;
+    srs_utime_t time_shift;
+    int64_t time_shift_max_size;
+    bool atc;
+    bool atc_auto;
+    int time_jitter;
+    bool mix_correct;
+    srs_utime_t queue_length;
+    bool mr_enabled;
+    srs_utime_t mr_sleep;
+    srs_utime_t mw_sleep;
+    bool mw_adaptive;
+    bool mw_aggregate;
+    bool realtime;
+    bool tcp_nodelay;
+    srs_utime_t send_min_interval;
+    bool reduce_sequence_header;
+    std::string tcp_congestion;
+    double pacing_factor;
+    int zerocopy;
+    int notsent_lowat;
+    double drop_ratio;
+    bool low_priority;
+    srs_utime_t latency_marker;
+    srs_utime_t reconnect_grace;
+    bool security_enabled;
+    SrsSecurityRules* security;
+    bool token_enabled;
+    std::vector<std::string> token_keys;
+    bool token_play;
+    bool token_publish;
+public:
+    SrsVhostSnapshot();
+    virtual ~SrsVhostSnapshot();
+};
+
 // The config service provider.
 // For the config supports reload, so never keep the reference cross st-thread,
 // that is, never save the SrsConfDirective* get by any api of config,
@@ -298,6 +354,14 @@ private:
 protected:
     // The directive root.
     SrsConfDirective* root;
+private:
+    // The vhost directives indexed by name, rebuilt when vhosts changed.
+    std::map<std::string, SrsConfDirective*> vhost_index;
+    bool vhost_index_dirty;
+    // The resolved vhosts by name, @see SrsVhostSnapshot
+    std::map<std::string, SrsVhostSnapshot*> vhost_snapshots;
+    // Increase when vhosts changed, to resolve the snapshots again.
+    int vhost_generation;
 // Reload  section
 private:
     // The reload subscribers, when reload, callback all handlers.
@@ -476,6 +540,8 @@ public:
     virtual srs_utime_t get_grace_final_wait();
     // Whether force to gracefully quit, never fast quit.
     virtual bool is_force_grace_quit();
+    // Get the max wait in ms for connections to quit when gracefully quit or upgrade, 0 to wait for ever.
+    virtual srs_utime_t get_grace_drain_timeout();
     // Whether disable daemon for docker.
     virtual bool disable_daemon_for_docker();
     // Whether use inotify to auto reload by watching config file changes.
@@ -492,12 +558,16 @@ public:
     virtual std::string get_stream_caster_engine(SrsConfDirective* conf);
     // Get the output rtmp url of stream_caster, the output config.
     virtual std::string get_stream_caster_output(SrsConfDirective* conf);
+    // Get the path to capture the datagrams and arrival time of stream caster, empty to disable.
+    virtual std::string get_stream_caster_capture(SrsConfDirective* conf);
     // Get the listen port of stream caster.
     virtual int get_stream_caster_listen(SrsConfDirective* conf);
     // Get the min udp port for rtp of stream caster rtsp.
     virtual int get_stream_caster_rtp_port_min(SrsConfDirective* conf);
     // Get the max udp port for rtp of stream caster rtsp.
     virtual int get_stream_caster_rtp_port_max(SrsConfDirective* conf);
+    // Get the depth of reorder buffer for rtp packets, in packets.
+    virtual int get_stream_caster_rtp_reorder_depth(SrsConfDirective* conf);
 // vhost specified section
 public:
     // Get the vhost directive by vhost name.
@@ -506,6 +576,15 @@ public:
     virtual SrsConfDirective* get_vhost(std::string vhost, bool try_default_vhost = true);
     // Get all vhosts in config file.
     virtual void get_vhosts(std::vector<SrsConfDirective*>& vhosts);
+    // Get the resolved settings of vhost, fallback to default vhost.
+    virtual SrsVhostSnapshot* get_vhost_snapshot(std::string vhost);
+protected:
+    // Notify the vhosts changed, for example, parse or reload, the index and snapshots are obsoleted.
+    // @param resolve Whether resolve the snapshots now, for reload to update them before notify handlers.
+    virtual void on_vhosts_changed(bool resolve);
+private:
+    virtual void resolve_vhost_snapshot(std::string vhost, SrsVhostSnapshot* snapshot);
+public:
     // Whether vhost is enabled
     // @param vhost, the vhost name.
     // @return true when vhost is ok; otherwise, false.
@@ -519,6 +598,25 @@ public:
     // @return true when gop_cache is ok; otherwise, false.
     // @remark, default true.
     virtual bool get_gop_cache(std::string vhost);
+    // Get the max duration of gop cache, in srs_utime_t.
+    // The gop cache keeps the gops in the duration, drop the old gop when exceed.
+    // @remark, default 0, only keep the last gop.
+    virtual srs_utime_t get_gop_cache_max_duration(std::string vhost);
+    // Get the max size of gop cache in bytes.
+    // When the last gop exceed the size, clear the gop cache and wait for the next keyframe.
+    // @remark, default 0, no limit.
+    virtual int64_t get_gop_cache_max_size(std::string vhost);
+    // Get the fast start of gop cache, in srs_utime_t.
+    // When dump to client, start from the first keyframe in the duration before the last message.
+    // @remark, default 0, start from the first cached message.
+    virtual srs_utime_t get_gop_cache_fast_start(std::string vhost);
+    // Get the duration of time shift buffer, in srs_utime_t.
+    // The player starts from the past by param timeshift in seconds, which is limited by the duration.
+    // @remark, default 0, disabled.
+    virtual srs_utime_t get_time_shift(std::string vhost);
+    // Get the max size of time shift buffer in bytes.
+    // @remark, default 0, no limit.
+    virtual int64_t get_time_shift_max_size(std::string vhost);
     // Whether debug_srs_upnode is enabled of vhost.
     // debug_srs_upnode is very important feature for tracable log,
     // but some server, for instance, flussonic donot support it.
@@ -562,6 +660,10 @@ public:
     virtual int get_in_ack_size(std::string vhost);
     // Get the output default ack size, to notify the peer to send acknowledge to server.
     virtual int get_out_ack_size(std::string vhost);
+    // Get the percent of sessions to write to access log, in [0, 100].
+    virtual int get_vhost_access_log_sample(std::string vhost);
+    // Whether the vhost is low priority, whose HLS and DVR are paused first when overload.
+    virtual bool get_vhost_low_priority(std::string vhost);
     // Get the chunk size of vhost.
     // @param vhost, the vhost to get the chunk size. use global if not specified.
     //       empty string to get the global.
@@ -580,6 +682,11 @@ public:
     // @param vhost, the vhost to get the mw sleep time.
     // TODO: FIXME: add utest for mw config.
     virtual srs_utime_t get_mw_sleep(std::string vhost);
+    // Whether adaptive the mw sleep by the bitrate and send buffer of play connection,
+    // in [min, mw_latency], @see SrsMwAdaptive.
+    virtual bool get_mw_adaptive(std::string vhost);
+    // Whether pack the audio and video of a merged-write batch to an RTMP aggregate message.
+    virtual bool get_mw_aggregate(std::string vhost);
     // Whether min latency mode enabled.
     // @param vhost, the vhost to get the min_latency.
     // TODO: FIXME: add utest for min_latency.
@@ -590,10 +697,80 @@ public:
     virtual srs_utime_t get_send_min_interval(std::string vhost);
     // Whether reduce the sequence header.
     virtual bool get_reduce_sequence_header(std::string vhost);
+    // Get the congestion control algorithm for play clients, empty to use the system default.
+    virtual std::string get_tcp_congestion(std::string vhost);
+    // Get the factor of stream bitrate, to limit the pacing rate of play clients, 0 to disable.
+    virtual double get_pacing_factor(std::string vhost);
+    // Get the min bytes of a send to use MSG_ZEROCOPY for play clients, 0 to disable.
+    virtual int get_play_zerocopy(std::string vhost);
+    // Get the TCP_NOTSENT_LOWAT in bytes for play clients, 0 to disable.
+    virtual int get_play_notsent_lowat(std::string vhost);
+    // Get the ratio of queue_length to drop frames for slow consumer, 0 to disable.
+    virtual double get_drop_ratio(std::string vhost);
+    // Get the grace duration to keep the consumer of disconnected player, for it to resume by token, 0 to disable.
+    virtual srs_utime_t get_vhost_play_resume(std::string vhost);
+    // Get the percent of egress budget for the players of vhost, 0 for no limit except the budget.
+    virtual int get_vhost_egress_share(std::string vhost);
+    // Get the latency in ms of SRT clients of vhost, default to the latency of srt_server.
+    virtual int get_vhost_srt_latency(std::string vhost);
+    // Whether SRT drops the packets too late to play, rather than to recover them.
+    virtual bool get_vhost_srt_tlpktdrop(std::string vhost);
+    // Whether the WebRTC players are allowed for vhost, @see rtc_server
+    virtual bool get_rtc_enabled(std::string vhost);
+    // Whether retransmit the lost RTP packets by the NACK of WebRTC players.
+    virtual bool get_rtc_nack_enabled(std::string vhost);
+    // Whether the multicast of MPEG-TS is enabled for vhost.
+    virtual bool get_vhost_multicast_enabled(std::string vhost);
+    // Get the output url of multicast channel, for example, udp://239.1.1.1:5000, empty if not configured.
+    // @param stream The stream url without vhost, that is, [app]/[stream].
+    virtual std::string get_vhost_multicast_channel(std::string vhost, std::string stream);
+    // Get the TTL of multicast datagrams.
+    virtual int get_vhost_multicast_ttl(std::string vhost);
+    // Get the local ip of interface to send multicast, empty to use the route.
+    virtual std::string get_vhost_multicast_interface(std::string vhost);
+    // Get the delay to pace the datagrams by PCR, to absorb the jitter of stream.
+    virtual srs_utime_t get_vhost_multicast_delay(std::string vhost);
+    // Whether upload the HLS/DVR files of vhost to the S3 compatible object storage.
+    virtual bool get_vhost_upload_enabled(std::string vhost);
+    // Get the endpoint of bucket to upload to, for example, http://127.0.0.1:9000/bucket
+    virtual std::string get_vhost_upload_endpoint(std::string vhost);
+    // Get the access key and secret key to sign the request by AWS SigV4.
+    virtual std::string get_vhost_upload_access_key(std::string vhost);
+    virtual std::string get_vhost_upload_secret_key(std::string vhost);
+    // Get the region of bucket, used by the signature.
+    virtual std::string get_vhost_upload_region(std::string vhost);
+    // Whether keep the local copy of uploaded files.
+    virtual bool get_vhost_upload_local_copy(std::string vhost);
+    // Get the max number of retries for a failed upload.
+    virtual int get_vhost_upload_retries(std::string vhost);
+    // Get the size in bytes of part for multipart upload.
+    virtual int get_vhost_upload_part_size(std::string vhost);
+    // Whether upload the HLS segments and playlists.
+    virtual bool get_vhost_upload_hls(std::string vhost);
+    // Whether upload the DVR files.
+    virtual bool get_vhost_upload_dvr(std::string vhost);
+    // Whether the server-side ABR is enabled for the RTMP and HTTP-FLV players of vhost.
+    virtual bool get_vhost_abr_enabled(std::string vhost);
+    // Get the suffixes of renditions, from the highest bitrate to lowest, for example, _hd _sd.
+    virtual std::vector<std::string> get_vhost_abr_renditions(std::string vhost);
+    // Get the queue of player to switch down to the lower rendition.
+    virtual srs_utime_t get_vhost_abr_down_queue(std::string vhost);
+    // Get the duration of small queue to switch up to the higher rendition.
+    virtual srs_utime_t get_vhost_abr_up_stable(std::string vhost);
     // The 1st packet timeout in srs_utime_t for encoder.
     virtual srs_utime_t get_publish_1stpkt_timeout(std::string vhost);
     // The normal packet timeout in srs_utime_t for encoder.
     virtual srs_utime_t get_publish_normal_timeout(std::string vhost);
+    // The max number of messages to parse and deliver to source in a batch, 0 or 1 to disable.
+    virtual int get_publish_batch(std::string vhost);
+    // The interval in srs_utime_t to mark the video by timestamp for latency, 0 to disable.
+    virtual srs_utime_t get_publish_latency_marker(std::string vhost);
+    // The grace in srs_utime_t to wait for the publisher to reconnect, keeping the players and muxers, 0 to disable.
+    virtual srs_utime_t get_publish_reconnect_grace(std::string vhost);
+    // The path to capture the raw bytes and arrival time of RTMP publisher, empty to disable.
+    virtual std::string get_publish_capture(std::string vhost);
+    // Whether any vhost captures the RTMP publisher, to cache the bytes before client identified.
+    virtual bool get_publish_capture_any();
 private:
     // Get the global chunk size.
     virtual int get_global_chunk_size();
@@ -638,6 +815,12 @@ public:
     // Get the on_hls_notify callbacks of vhost.
     // @return the on_hls_notify callback directive, the args is the url to callback.
     virtual SrsConfDirective* get_vhost_on_hls_notify(std::string vhost);
+    // Get the ttl to cache the decision of on_connect and on_play, in srs_utime_t.
+    // @remark 0 to disable the cache.
+    virtual srs_utime_t get_vhost_http_hooks_cache_ttl(std::string vhost);
+    // Get the interval to batch the on_close and on_stop events, in srs_utime_t.
+    // @remark 0 to disable the batch, callback for each event.
+    virtual srs_utime_t get_vhost_http_hooks_batch_interval(std::string vhost);
 // bwct(bandwidth check tool) section
 public:
     // Whether bw check enabled for vhost.
@@ -673,21 +856,54 @@ public:
     // For example, we verify all clients on the origin FMS by server-side as,
     // all clients connected to edge must be tranverse to origin to verify.
     virtual bool get_vhost_edge_token_traverse(std::string vhost);
+    // Get the duration to cache the token traverse result of origin, 0 to never cache it.
+    virtual srs_utime_t get_vhost_edge_token_traverse_ttl(std::string vhost);
     // Get the transformed vhost for edge,
     // @see https://github.com/ossrs/srs/issues/372
     virtual std::string get_vhost_edge_transform_vhost(std::string vhost);
+    // Get the load balance of origins for edge, round_robin or consistent_hash.
+    virtual std::string get_vhost_edge_origin_balance(std::string vhost);
+    // Get the delay to connect the next origin in race for edge, 0 to connect the selected one only.
+    virtual srs_utime_t get_vhost_edge_origin_stagger(std::string vhost);
+    // Get the protocol to pull stream from origin for edge, rtmp, flv or mux.
+    virtual std::string get_vhost_edge_protocol(std::string vhost);
+    // Get the number of RTMP connections to each origin, shared by the streams of edge in mux protocol.
+    virtual int get_vhost_edge_mux_connections(std::string vhost);
+    // Get the HTTP APIs of edge peers, to pull stream from the peer which pulls it from origin.
+    virtual std::vector<std::string> get_vhost_edge_peers(std::string vhost);
+    // Get the HTTP servers of origin to proxy the HLS for edge, empty to disable.
+    virtual std::vector<std::string> get_vhost_edge_hls_origin(std::string vhost);
+    // Get the ttl in srs_utime_t of the m3u8 proxied from origin for edge.
+    virtual srs_utime_t get_vhost_edge_hls_playlist_ttl(std::string vhost);
+    // Get the window ack size for publish edge to request origin, 0 to not request.
+    virtual int get_vhost_edge_publish_window(std::string vhost);
+    // Get the max bytes in flight not acked by origin for publish edge, 0 to disable.
+    virtual int get_vhost_edge_publish_inflight(std::string vhost);
+    // Whether publish edge uses the large chunk size for origin of large RTT.
+    virtual bool get_vhost_edge_publish_rtt_chunk(std::string vhost);
     // Whether enable the origin cluster.
     // @see https://github.com/ossrs/srs/wiki/v3_EN_OriginCluster
     virtual bool get_vhost_origin_cluster(std::string vhost);
     // Get the co-workers of origin cluster.
     // @see https://github.com/ossrs/srs/wiki/v3_EN_OriginCluster
     virtual std::vector<std::string> get_vhost_coworkers(std::string vhost);
+    // Get the standby origins, to replicate the streams of origin to, for edges to failover.
+    virtual std::vector<std::string> get_vhost_standby(std::string vhost);
 // vhost security section
 public:
     // Whether the secrity of vhost enabled.
     virtual bool get_security_enabled(std::string vhost);
     // Get the security rules.
     virtual SrsConfDirective* get_security_rules(std::string vhost);
+// vhost token section
+public:
+    // Whether verify the signed token of client in process, @see srs_verify_token
+    virtual bool get_token_enabled(std::string vhost);
+    // The HMAC keys to verify the token, the token signed by any of them is valid, for key rotation.
+    virtual std::vector<std::string> get_token_keys(std::string vhost);
+    // Whether require the token for play and publish.
+    virtual bool get_token_play(std::string vhost);
+    virtual bool get_token_publish(std::string vhost);
 // vhost transcode section
 public:
     // Get the transcode directive of vhost in specified scope.
@@ -704,10 +920,19 @@ public:
     virtual bool get_transcode_enabled(SrsConfDirective* conf);
     // Get the ffmpeg tool path of transcode.
     virtual std::string get_transcode_ffmpeg(SrsConfDirective* conf);
+    // Whether encode all engines of transcode by one ffmpeg, to decode the input once.
+    virtual bool get_transcode_group(SrsConfDirective* conf);
+    // Get the input of ffmpeg, rtmp to play the RTMP stream, unix to read the FLV feed by unix domain socket.
+    virtual std::string get_transcode_feed(SrsConfDirective* conf);
+    // Get the priority of transcode, the higher one gets the slot of scheduler first.
+    virtual int get_transcode_priority(SrsConfDirective* conf);
     // Get the engines of transcode.
     virtual std::vector<SrsConfDirective*> get_transcode_engines(SrsConfDirective* conf);
     // Whether the engine is enabled.
     virtual bool get_engine_enabled(SrsConfDirective* conf);
+    // Get the resource of engine for transcode scheduler, which can be cpu, nvenc, qsv or none,
+    // empty to guess by the vcodec.
+    virtual std::string get_engine_resource(SrsConfDirective* conf);
     // Get the perfile of engine
     virtual std::vector<std::string> get_engine_perfile(SrsConfDirective* conf);
     // Get the iformat of engine
@@ -784,6 +1009,14 @@ public:
     virtual std::string get_ingest_input_type(SrsConfDirective* conf);
     // Get the ingest input url.
     virtual std::string get_ingest_input_url(SrsConfDirective* conf);
+    // Get the number of segments to fetch concurrently, for the native hls ingest.
+    virtual int get_ingest_input_prefetch(SrsConfDirective* conf);
+    // Whether pull the camera by RTP over RTSP connection, for the native rtsp ingest.
+    virtual bool get_ingest_input_rtsp_tcp(SrsConfDirective* conf);
+    // Whether loop the file when reach the end, for the native playout ingest.
+    virtual bool get_ingest_input_loop(SrsConfDirective* conf);
+    // Get the max random delay to start each ingester, to avoid starting all ingesters at the same time.
+    virtual srs_utime_t get_ingest_start_jitter();
 // log section
 public:
     // Whether log to file.
@@ -792,6 +1025,11 @@ public:
     virtual std::string get_log_level();
     // Get the log file path.
     virtual std::string get_log_file();
+    // Whether write the log file by the async writer thread.
+    // @remark Do not support reload.
+    virtual bool get_log_async();
+    // Get the ring size in KB of async log writer.
+    virtual int get_log_async_size();
     // Whether ffmpeg log enabled
     virtual bool get_ff_log_enabled();
     // The ffmpeg log dir.
@@ -811,6 +1049,8 @@ public:
     virtual srs_utime_t get_dash_update_period(std::string vhost);
     // Get the depth of timeshift buffer in srs_utime_t.
     virtual srs_utime_t get_dash_timeshift(std::string vhost);
+    // Get the duration of CMAF chunk in srs_utime_t, 0 to write the whole segment at once.
+    virtual srs_utime_t get_dash_chunk_duration(std::string vhost);
     // Get the base/home dir/path for dash, into which write files.
     virtual std::string get_dash_path(std::string vhost);
     // Get the path for DASH MPD, to generate the MPD file.
@@ -836,6 +1076,8 @@ public:
     virtual srs_utime_t get_hls_fragment(std::string vhost);
     // Get the hls td(target duration) ratio.
     virtual double get_hls_td_ratio(std::string vhost);
+    // Get the duration of first segment for hls fast start, 0 to disable.
+    virtual srs_utime_t get_hls_fast_start(std::string vhost);
     // Get the hls aof(audio overflow) ratio.
     virtual double get_hls_aof_ratio(std::string vhost);
     // Get the hls window time, in srs_utime_t.
@@ -857,10 +1099,28 @@ public:
     virtual srs_utime_t get_hls_dispose(std::string vhost);
     // Whether reap the ts when got keyframe.
     virtual bool get_hls_wait_keyframe(std::string vhost);
+    // Whether write the crc32 of ts to a sidecar file.
+    virtual bool get_hls_checksum(std::string vhost);
+    // Whether keep the live m3u8 and ts in memory, served by http server without disk io.
+    virtual bool get_hls_memory(std::string vhost);
+    // Whether still write the m3u8 and ts to disk, when hls in memory.
+    virtual bool get_hls_memory_archive(std::string vhost);
+    // Whether enable the low-latency hls, with partial segments and blocking playlist reload.
+    virtual bool get_hls_ll(std::string vhost);
+    // Get the target duration of partial segment for low-latency hls.
+    virtual srs_utime_t get_hls_ll_part(std::string vhost);
+    // Get the max duration of audio frames to aggregate in a PES, 0 for the default.
+    virtual srs_utime_t get_hls_audio_aggregate(std::string vhost);
+    // Get the min interval of PCR on the PCR PID, 0 to write PCR at keyframe only.
+    virtual srs_utime_t get_hls_pcr_interval(std::string vhost);
+    // Get the renditions of hls variant group, each is suffix:bandwidth[:resolution].
+    virtual std::vector<std::string> get_hls_variants(std::string vhost);
     // encrypt ts or not
     virtual bool get_hls_keys(std::string vhost);
     // how many fragments can one key encrypted.
     virtual int get_hls_fragments_per_key(std::string vhost);
+    // Whether encrypt ts in the disk io threads, when disk io is enabled.
+    virtual bool get_hls_key_offload(std::string vhost);
     // Get the HLS key file path template.
     virtual std::string get_hls_key_file(std::string vhost);
     // Get the HLS key file store path.
@@ -904,6 +1164,10 @@ public:
     virtual srs_utime_t get_dvr_duration(std::string vhost);
     // Whether wait keyframe to reap segment.
     virtual bool get_dvr_wait_keyframe(std::string vhost);
+    // Get the fragment duration of fMP4 for dvr, 0 to write progressive MP4.
+    virtual srs_utime_t get_dvr_mp4_fragment(std::string vhost);
+    // Whether convert the fMP4 to progressive MP4 when dvr file reaped.
+    virtual bool get_dvr_mp4_finalize(std::string vhost);
     // Get the time_jitter algorithm for dvr.
     virtual int get_dvr_time_jitter(std::string vhost);
 // http api section
@@ -925,6 +1189,28 @@ public:
     virtual bool get_raw_api_allow_query();
     // Whether allow rpc update.
     virtual bool get_raw_api_allow_update();
+private:
+    virtual SrsConfDirective* get_http_api_control();
+public:
+    // Whether serve the control plane of HTTP API by a separate thread.
+    virtual bool get_http_api_control_enabled();
+    // The listen endpoint of the control plane API.
+    virtual std::string get_http_api_control_listen();
+    // The interval to publish the snapshot of statistic for the control plane API.
+    virtual srs_utime_t get_http_api_control_interval();
+private:
+    virtual SrsConfDirective* get_http_api_snapshot();
+public:
+    // Whether enable the keyframe snapshot API.
+    virtual bool get_snapshot_enabled();
+    // The interval to regenerate the snapshot of a stream, requests in it are served from cache.
+    virtual srs_utime_t get_snapshot_interval();
+    // The ffmpeg binary to decode the snapshot to JPEG, empty to disable JPEG.
+    virtual std::string get_snapshot_ffmpeg();
+    // The max number of ffmpeg to decode JPEG at the same time.
+    virtual int get_snapshot_decoders();
+    // The timeout for a JPEG to decode, including waiting for a decoder.
+    virtual srs_utime_t get_snapshot_timeout();
 // http stream section
 private:
     // Whether http stream enabled.
@@ -939,6 +1225,30 @@ public:
     virtual std::string get_http_stream_dir();
     // Whether enable crossdomain for http static and stream server.
     virtual bool get_http_stream_crossdomain();
+    // Get the max number of flv files to cache the keyframe index for vod seeking, 0 to disable.
+    virtual int get_http_stream_vod_index_cache();
+    // Get the max number of segments to cache for the vod hls packaged on the fly, 0 to disable.
+    virtual int get_http_stream_vod_hls_cache();
+    // Get the duration of segment for the vod hls packaged on the fly.
+    virtual srs_utime_t get_http_stream_vod_hls_fragment();
+    // Get the max number of trimmed moov to cache for the mp4 pseudo-streaming, 0 to disable.
+    virtual int get_http_stream_vod_moov_cache();
+    // Get the max number of opened files to cache for the http static files, 0 to disable.
+    virtual int get_http_stream_file_cache_fds();
+    // Get the period to validate the cached file by stat.
+    virtual srs_utime_t get_http_stream_file_cache_valid();
+    // Get the max size in KB of file to cache in memory.
+    virtual int get_http_stream_file_cache_max_size();
+    // Get the max memory in MB to cache the small files, 0 to disable.
+    virtual int get_http_stream_file_cache_memory();
+    // Get the max-age in seconds of the Cache-Control for hls and dash segments, 0 to disable.
+    virtual int get_http_stream_segment_max_age();
+    // Whether mount the http static of vhost when the first request of vhost, not on startup.
+    virtual bool get_http_stream_lazy_mount();
+    // Whether serve the HLS, DASH and static files over HTTP/2, by h2c prior knowledge or ALPN of HTTPS.
+    virtual bool get_http_stream_http2();
+    // Get the max number of concurrent streams of a HTTP/2 connection.
+    virtual int get_http_stream_http2_max_streams();
 public:
     // Get whether vhost enabled http stream
     virtual bool get_vhost_http_enabled(std::string vhost);
@@ -954,6 +1264,8 @@ public:
     virtual bool get_vhost_http_remux_enabled(std::string vhost);
     // Get the fast cache duration for http audio live stream.
     virtual srs_utime_t get_vhost_http_remux_fast_cache(std::string vhost);
+    // Get the fragment duration for http fMP4 live stream, 0 for a fragment per GOP.
+    virtual srs_utime_t get_vhost_http_remux_mp4_fragment(std::string vhost);
     // Get the http flv live stream mount point for vhost.
     // used to generate the flv stream mount path.
     virtual std::string get_vhost_http_remux_mount(std::string vhost);
@@ -972,6 +1284,8 @@ public:
     virtual std::string get_heartbeat_device_id();
     // Whether report with summaries of http api: /api/v1/summaries.
     virtual bool get_heartbeat_summaries();
+    // Get the version of heartbeat, 1 for full state, 2 for delta since the last acknowledged.
+    virtual int get_heartbeat_version();
 // stats section
 private:
     // Get the stats directive.
@@ -985,6 +1299,269 @@ public:
     // The device name configed in args of directive.
     // @return the disk device name to stat. NULL if not configed.
     virtual SrsConfDirective* get_stats_disk_device();
+// workers section
+private:
+    // Get the workers directive.
+    virtual SrsConfDirective* get_workers();
+public:
+    // Whether fork multiple worker processes, which share the listen ports by SO_REUSEPORT.
+    // @remark do not support reload.
+    virtual bool get_workers_enabled();
+    // Get the number of worker processes.
+    virtual int get_workers_count();
+    // Get the base port of inter-worker relay, worker N listens at 127.0.0.1:(relay_port+N).
+    virtual int get_workers_relay_port();
+// affinity section
+private:
+    // Get the affinity directive.
+    virtual SrsConfDirective* get_affinity();
+public:
+    // Get the list of cpus to bind the thread of ST, for example, 0-3,8, empty to not bind.
+    // @remark do not support reload.
+    virtual std::string get_affinity_cpus();
+// memory section
+private:
+    // Get the memory directive.
+    virtual SrsConfDirective* get_memory();
+public:
+    // Get the huge pages to back the pool of messages, which is off, transparent or explicit.
+    // @remark do not support reload.
+    virtual std::string get_memory_huge_pages();
+    // Whether bind the pool of messages to the NUMA node of the bound cpu.
+    virtual bool get_memory_numa();
+// tls section
+private:
+    // Get the tls directive.
+    virtual SrsConfDirective* get_tls();
+public:
+    // Whether the TLS of RTMPS and HTTPS is enabled.
+    // @remark do not support reload.
+    virtual bool get_tls_enabled();
+    // Get the listen endpoint of RTMPS, empty to disable.
+    virtual std::string get_tls_rtmps();
+    // Get the listen endpoint of HTTPS for http server, empty to disable.
+    virtual std::string get_tls_https();
+    // Get the file of certificate chain in PEM.
+    virtual std::string get_tls_certificate();
+    // Get the file of private key in PEM.
+    virtual std::string get_tls_key();
+    // Whether enable the kernel TLS after handshake.
+    virtual bool get_tls_ktls();
+    // Whether resume the sessions by tickets.
+    virtual bool get_tls_session_tickets();
+    // Get the file of keys for tickets, empty to generate it.
+    virtual std::string get_tls_ticket_key();
+    // Get the lifetime of sessions.
+    virtual srs_utime_t get_tls_session_timeout();
+// srt_server section
+private:
+    // Get the srt_server directive.
+    virtual SrsConfDirective* get_srt_server();
+public:
+    // Whether the SRT server is enabled, which requires the --with-srt.
+    // @remark do not support reload.
+    virtual bool get_srt_enabled();
+    // Get the listen port of SRT over UDP.
+    virtual int get_srt_listen();
+    // Get the default latency in ms of SRT, the window to recover the lost packets.
+    virtual int get_srt_latency();
+    // Get the max bandwidth in bytes per second of SRT sender, -1 for infinite.
+    virtual int64_t get_srt_maxbw();
+    // Get the payload size of SRT message, which is N*188 bytes TS packets.
+    virtual int get_srt_payload_size();
+    // Get the timeout for peer without any packet.
+    virtual srs_utime_t get_srt_peer_idle_timeout();
+    // Get the app for streamid without app.
+    virtual std::string get_srt_default_app();
+// rtc_server section
+private:
+    // Get the rtc_server directive.
+    virtual SrsConfDirective* get_rtc_server();
+public:
+    // Whether the WebRTC server is enabled.
+    // @remark do not support reload.
+    virtual bool get_rtc_server_enabled();
+    // Get the listen port of WebRTC over UDP, for ICE, DTLS and SRTP.
+    virtual int get_rtc_server_listen();
+    // Get the candidate ip for the SDP answer, * for the ip of server.
+    virtual std::string get_rtc_server_candidate();
+// relay_server section
+private:
+    // Get the relay_server directive.
+    virtual SrsConfDirective* get_relay_server();
+public:
+    // Whether the relay server over UDP is enabled, for the edge pulls by protocol udp.
+    // @remark do not support reload.
+    virtual bool get_relay_server_enabled();
+    // Get the listen port of relay over UDP.
+    virtual int get_relay_server_listen();
+    // Get the shared secret of relay, to authenticate the packets between origin and edges.
+    virtual std::string get_relay_server_secret();
+// disk_io section
+private:
+    // Get the disk_io directive.
+    virtual SrsConfDirective* get_disk_io();
+public:
+    // Whether write the HLS/DVR/DASH files in disk io threads.
+    // @remark do not support reload.
+    virtual bool get_disk_io_enabled();
+    // Get the number of disk io threads.
+    virtual int get_disk_io_threads();
+    // Get the max pending bytes of disk io, the writer waits when exceed it.
+    virtual int64_t get_disk_io_max_pending();
+    // Whether fsync the file before close.
+    virtual bool get_disk_io_fsync();
+    // Get the size in bytes of write buffer of file, 0 to write directly.
+    // @remark It works whether disk io threads are enabled or not.
+    virtual int get_disk_io_buffer();
+    // Whether write the buffer by O_DIRECT, only when disk io threads are disabled.
+    virtual bool get_disk_io_direct();
+    // Whether packetize the ts in disk io threads.
+    virtual bool get_disk_io_mux();
+// fanout section
+private:
+    // Get the fanout directive.
+    virtual SrsConfDirective* get_fanout();
+public:
+    // Whether deliver the HTTP-FLV players by fanout threads.
+    // @remark do not support reload.
+    virtual bool get_fanout_enabled();
+    // Get the number of fanout threads.
+    virtual int get_fanout_threads();
+    // Get the max unsent bytes of a player in fanout thread.
+    virtual int get_fanout_max_pending();
+// async_call section
+private:
+    // Get the async_call directive.
+    virtual SrsConfDirective* get_async_call();
+public:
+    // Get the number of lanes of each async call worker, the tasks of a key run in order in its lane.
+    virtual int get_async_call_lanes();
+    // Get the max queued tasks of a lane, the oldest one is dropped when full, 0 for no limit.
+    virtual int get_async_call_max_tasks();
+    // Get the timeout of an async task, such as the http hooks, 0 for no timeout.
+    virtual srs_utime_t get_async_call_timeout();
+// io_uring section
+private:
+    // Get the io_uring directive.
+    virtual SrsConfDirective* get_io_uring();
+public:
+    // Whether use the io_uring event system of ST, fall back to epoll if not supported.
+    // @remark do not support reload.
+    virtual bool get_io_uring_enabled();
+    // Get the number of SQ entries of io_uring.
+    virtual int get_io_uring_entries();
+    // Whether write by io_uring, batched in one submission per scheduler tick.
+    virtual bool get_io_uring_write();
+// accept section
+private:
+    // Get the accept directive.
+    virtual SrsConfDirective* get_accept();
+public:
+    // Get the max number of clients accepted in a batch, then dispatch them.
+    // @remark do not support reload.
+    virtual int get_accept_batch();
+    // Get the max number of clients accepted per second, 0 for no limit.
+    virtual int get_accept_rate();
+    // Get the TCP_DEFER_ACCEPT in seconds, 0 to disable.
+    // @remark do not support reload.
+    virtual int get_accept_defer();
+    // Get the queue length of TCP_FASTOPEN, 0 to disable.
+    // @remark do not support reload.
+    virtual int get_accept_fastopen();
+// handshake section
+private:
+    // Get the handshake directive.
+    virtual SrsConfDirective* get_handshake();
+public:
+    // Get the number of pre-generated DH key pairs for complex handshake, 0 to disable.
+    // @remark do not support reload.
+    virtual int get_handshake_dh_pool();
+// admission section
+private:
+    // Get the admission directive.
+    virtual SrsConfDirective* get_admission();
+public:
+    // Whether reject or redirect the new players when the egress exceeds the budget.
+    virtual bool get_admission_enabled();
+    // Get the egress budget of server in kbps, 0 for no limit.
+    virtual int get_admission_max_kbps();
+    // Get the RTMP servers to redirect the rejected RTMP players to.
+    virtual std::vector<std::string> get_admission_rtmp_redirect();
+    // Get the HTTP servers to redirect the rejected HTTP players to.
+    virtual std::vector<std::string> get_admission_http_redirect();
+// overload section
+private:
+    // Get the overload directive.
+    virtual SrsConfDirective* get_overload();
+public:
+    // Whether shed the load in tiers when the scheduler lags or the CPU saturates.
+    // @remark do not support reload.
+    virtual bool get_overload_enabled();
+    // Get the max lag of scheduler, the pressure is 1 when reach it.
+    virtual srs_utime_t get_overload_max_lag();
+    // Get the max CPU percent of a core, the pressure is 1 when reach it.
+    virtual int get_overload_max_cpu();
+    // Get the drop ratio of slow consumers, when overload reaches the tier to drop frames.
+    virtual double get_overload_drop_ratio();
+// access log section
+private:
+    // Get the access log directive.
+    virtual SrsConfDirective* get_access_log();
+public:
+    // Whether write a structured record for each session to access log.
+    virtual bool get_access_log_enabled();
+    // Get the path of access log file.
+    virtual std::string get_access_log_path();
+    // Get the format of access log, json or binary.
+    virtual std::string get_access_log_format();
+    // Get the max records per second to write, 0 for no limit.
+    virtual int get_access_log_rate();
+    // Get the max records to write in a burst.
+    virtual int get_access_log_burst();
+// scheduler section
+private:
+    // Get the scheduler directive.
+    virtual SrsConfDirective* get_scheduler();
+public:
+    // Whether profile the delay of run queue and cpu of coroutines, by the switch callbacks of ST.
+    virtual bool get_scheduler_profile();
+    // Get the bytes of slice for player to write, then yield to the publishers, 0 to never yield.
+    virtual int get_scheduler_slice();
+// flight recorder section
+private:
+    // Get the flight_recorder directive.
+    virtual SrsConfDirective* get_flight_recorder();
+public:
+    // Whether record the events of hot path to the ring of flight recorder.
+    virtual bool get_flight_recorder_enabled();
+    // Get the max number of events in ring.
+    virtual int get_flight_recorder_events();
+    // Get the min duration of event to record, 0 to record all.
+    virtual srs_utime_t get_flight_recorder_threshold();
+    // Get the file to dump the events, when got signal.
+    virtual std::string get_flight_recorder_file();
+// transcode scheduler section
+private:
+    // Get the transcode_scheduler directive.
+    virtual SrsConfDirective* get_transcode_scheduler();
+public:
+    // Whether limit the ffmpeg of transcode by the slots of resource.
+    virtual bool get_transcode_scheduler_enabled();
+    // Get the number of slots for resource, such as cpu, nvenc or qsv, 0 for unlimited.
+    virtual int get_transcode_scheduler_slots(std::string resource);
+// rtsp client section
+private:
+    // Get the rtsp_client directive.
+    virtual SrsConfDirective* get_rtsp_client();
+public:
+    // Get the shared local UDP ports to receive RTP of all cameras, in [min, max).
+    virtual int get_rtsp_client_rtp_port_min();
+    virtual int get_rtsp_client_rtp_port_max();
+    // Get the timeout to wait for RTP packets, then fallback to TCP or retry.
+    virtual srs_utime_t get_rtsp_client_timeout();
+    // Get the depth of reorder buffer for RTP packets over UDP.
+    virtual int get_rtsp_client_rtp_reorder_depth();
 };
 
 #endif
@@ -23,13 +23,125 @@
 
 #include <srs_app_conn.hpp>
 
+#include <stdlib.h>
+#include <string.h>
 #include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#ifndef SRS_AUTO_OSX
+#include <linux/sockios.h>
+#endif
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_core_performance.hpp>
+
+// The interval to update the pacing rate by the bitrate of stream.
+#define SRS_PACING_UPDATE_INTERVAL (3 * SRS_UTIME_SECONDS)
+
+// The timeout of TLS handshake, to drop the idle clients.
+#define SRS_TLS_HANDSHAKE_TIMEOUT (15 * SRS_UTIME_SECONDS)
+
+// For old glibc, the SO_MAX_PACING_RATE is supported since linux 3.13.
+#if !defined(SRS_AUTO_OSX) && !defined(SO_MAX_PACING_RATE)
+#define SO_MAX_PACING_RATE 47
+#endif
+
+SrsMwAdaptive::SrsMwAdaptive()
+{
+    max_sleep = window = SRS_PERF_MW_SLEEP;
+    realtime = SRS_PERF_MIN_LATENCY_ENABLED;
+    kbps = 0;
+    starttime = 0;
+    start_bytes = 0;
+    congested = false;
+}
+
+SrsMwAdaptive::~SrsMwAdaptive()
+{
+}
+
+void SrsMwAdaptive::initialize(srs_utime_t mw_latency, bool min_latency)
+{
+    max_sleep = mw_latency;
+    realtime = min_latency;
+    update_window();
+}
+
+bool SrsMwAdaptive::sample(srs_utime_t now, int64_t send_bytes)
+{
+    if (starttime <= 0 || now < starttime) {
+        starttime = now;
+        start_bytes = send_bytes;
+        return false;
+    }
+    
+    srs_utime_t elapsed = now - starttime;
+    if (elapsed < SRS_PERF_MW_ADAPTIVE_INTERVAL) {
+        return false;
+    }
+    
+    // The bytes*8/ms is the kbps.
+    int v = (int)((send_bytes - start_bytes) * 8 / srsu2ms(elapsed));
+    
+    // Smooth the bitrate, except the first sample.
+    kbps = (kbps > 0)? (kbps * 3 + v) / 4 : v;
+    
+    starttime = now;
+    start_bytes = send_bytes;
+    
+    update_window();
+    return true;
+}
+
+void SrsMwAdaptive::on_send_queue(int unsent, int sndbuf)
+{
+    // When the peer is slower than us, the data piles up in the send buffer, and it's
+    // useless to send small pieces, so we use the max window to merge more messages.
+    congested = (sndbuf > 0 && unsent > sndbuf / 2);
+    update_window();
+}
+
+srs_utime_t SrsMwAdaptive::sleep()
+{
+    return window;
+}
+
+int SrsMwAdaptive::min_msgs()
+{
+    // For realtime or small window, send when got one+ msgs.
+    if (realtime || window < max_sleep) {
+        return 0;
+    }
+    
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    return SRS_PERF_MW_MIN_MSGS;
+#else
+    return 0;
+#endif
+}
+
+int SrsMwAdaptive::get_kbps()
+{
+    return kbps;
+}
+
+void SrsMwAdaptive::update_window()
+{
+    if (congested) {
+        window = max_sleep;
+        return;
+    }
+    
+    // Scale the window by the bitrate, use the max window for high bitrate.
+    srs_utime_t v = max_sleep * kbps / SRS_PERF_MW_ADAPTIVE_KBPS;
+    
+    window = srs_max(v, srs_min(max_sleep, SRS_PERF_MW_ADAPTIVE_MIN));
+    window = srs_min(window, max_sleep);
+}
 
 SrsConnection::SrsConnection(IConnectionManager* cm, srs_netfd_t c, string cip)
 {
@@ -37,13 +149,19 @@ SrsConnection::SrsConnection(IConnectionManager* cm, srs_netfd_t c, string cip)
     stfd = c;
     ip = cip;
     create_time = srsu2ms(srs_get_system_time());
+    pacing_kbps = 0;
+    pacing_update_at = 0;
+    slot = -1;
+    tls = NULL;
     
     skt = new SrsStSocket();
     clk = new SrsWallClock();
     kbps = new SrsKbps(clk);
     kbps->set_io(skt, skt);
     
-    trd = new SrsSTCoroutine("conn", this);
+    SrsSTCoroutine* st = new SrsSTCoroutine("conn", this);
+    st->set_stack_size(SRS_PERF_STACK_CONN);
+    trd = st;
 }
 
 SrsConnection::~SrsConnection()
@@ -63,6 +181,18 @@ void SrsConnection::remark(int64_t* in, int64_t* out)
     kbps->remark(in, out);
 }
 
+void SrsConnection::counters(int64_t* in, int64_t* out)
+{
+    *in = skt->get_recv_bytes();
+    *out = skt->get_send_bytes();
+}
+
+void SrsConnection::stalls(srs_utime_t* time, int64_t* count)
+{
+    *time = skt->get_stall_time();
+    *count = skt->get_stalls();
+}
+
 void SrsConnection::dispose()
 {
     trd->interrupt();
@@ -83,6 +213,11 @@ srs_error_t SrsConnection::start()
     return err;
 }
 
+void SrsConnection::set_tls(SrsTlsContext* v)
+{
+    tls = v;
+}
+
 srs_error_t SrsConnection::set_tcp_nodelay(bool v)
 {
     srs_error_t err = srs_success;
@@ -166,9 +301,145 @@ srs_error_t SrsConnection::set_socket_buffer(srs_utime_t buffer_v)
     return err;
 }
 
+srs_error_t SrsConnection::set_tcp_congestion(string algo)
+{
+    srs_error_t err = srs_success;
+    
+    if (algo.empty()) {
+        return err;
+    }
+    
+    int fd = srs_netfd_fileno(stfd);
+    
+#ifdef SRS_AUTO_OSX
+    srs_warn("ignore TCP_CONGESTION %s, fd=%d", algo.c_str(), fd);
+    return err;
+#else
+    int r0 = 0;
+    char ov[16];
+    socklen_t nb_ov = sizeof(ov);
+    memset(ov, 0, sizeof(ov));
+    if ((r0 = getsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, ov, &nb_ov)) != 0) {
+        return srs_error_new(ERROR_SOCKET_CONGESTION, "getsockopt fd=%d, r0=%d", fd, r0);
+    }
+    
+    // The algorithm must be loaded and allowed, @see /proc/sys/net/ipv4/tcp_allowed_congestion_control
+    if ((r0 = setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, algo.data(), (socklen_t)algo.length())) != 0) {
+        return srs_error_new(ERROR_SOCKET_CONGESTION, "setsockopt fd=%d, cc=%s, r0=%d", fd, algo.c_str(), r0);
+    }
+    
+    srs_trace("set fd=%d TCP_CONGESTION %s=>%s", fd, ov, algo.c_str());
+    
+    return err;
+#endif
+}
+
+srs_error_t SrsConnection::set_pacing_rate(int v)
+{
+    srs_error_t err = srs_success;
+    
+    int fd = srs_netfd_fileno(stfd);
+    
+#ifdef SRS_AUTO_OSX
+    srs_warn("ignore SO_MAX_PACING_RATE %dkbps, fd=%d", v, fd);
+    return err;
+#else
+    // In bytes per second, ~0 for unlimited.
+    uint32_t iv = (v > 0)? (uint32_t)((int64_t)v * 1000 / 8) : ~0U;
+    
+    int r0 = 0;
+    if ((r0 = setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &iv, sizeof(iv))) != 0) {
+        return srs_error_new(ERROR_SOCKET_PACING, "setsockopt fd=%d, rate=%d, r0=%d", fd, v, r0);
+    }
+    
+    srs_trace("set fd=%d SO_MAX_PACING_RATE %d=>%dkbps", fd, pacing_kbps, v);
+    pacing_kbps = v;
+    
+    return err;
+#endif
+}
+
+srs_error_t SrsConnection::set_notsent_lowat(int v)
+{
+    srs_error_t err = srs_success;
+    
+    if (v <= 0) {
+        return err;
+    }
+    
+    int fd = srs_netfd_fileno(stfd);
+    
+#ifdef SRS_AUTO_OSX
+    srs_warn("ignore TCP_NOTSENT_LOWAT %d, fd=%d", v, fd);
+    return err;
+#else
+    int r0 = 0;
+    if ((r0 = setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &v, sizeof(v))) != 0) {
+        return srs_error_new(ERROR_SOCKET_LOWAT, "setsockopt fd=%d, lowat=%d, r0=%d", fd, v, r0);
+    }
+    
+    srs_trace("set fd=%d TCP_NOTSENT_LOWAT %d", fd, v);
+    
+    return err;
+#endif
+}
+
+srs_error_t SrsConnection::update_pacing(double factor)
+{
+    srs_error_t err = srs_success;
+    
+    if (factor <= 0) {
+        return err;
+    }
+    
+    srs_utime_t now = srs_get_monotonic_time();
+    if (pacing_update_at > 0 && now - pacing_update_at < SRS_PACING_UPDATE_INTERVAL) {
+        return err;
+    }
+    pacing_update_at = now;
+    
+    // Ignore when the bitrate of stream is unknown, for example, the stream is not sampled.
+    int kbps = (int)(SrsStatistic::instance()->get_client_stream_kbps(srs_id()) * factor);
+    if (kbps <= 0) {
+        return err;
+    }
+    
+    // Ignore the small changes, to avoid the syscall.
+    if (pacing_kbps > 0 && ::abs(kbps - pacing_kbps) * 10 < pacing_kbps) {
+        return err;
+    }
+    
+    return set_pacing_rate(kbps);
+}
+
+srs_error_t SrsConnection::get_send_queue(int* unsent, int* sndbuf)
+{
+    srs_error_t err = srs_success;
+    
+    int r0 = 0;
+    int fd = srs_netfd_fileno(stfd);
+    socklen_t nb_v = sizeof(int);
+    
+    if ((r0 = getsockopt(fd, SOL_SOCKET, SO_SNDBUF, sndbuf, &nb_v)) != 0) {
+        return srs_error_new(ERROR_SOCKET_SNDBUF, "getsockopt fd=%d, r0=%d", fd, r0);
+    }
+    
+    *unsent = 0;
+#ifndef SRS_AUTO_OSX
+    if ((r0 = ioctl(fd, SIOCOUTQ, unsent)) != 0) {
+        return srs_error_new(ERROR_SOCKET_SNDBUF, "ioctl SIOCOUTQ fd=%d, r0=%d", fd, r0);
+    }
+#endif
+    
+    return err;
+}
+
 srs_error_t SrsConnection::cycle()
 {
-    srs_error_t err = do_cycle();
+    srs_error_t err = tls? tls_accept() : srs_success;
+    if (err == srs_success) {
+        err = do_cycle();
+    }
     
     // Notify manager to remove it.
     manager->remove(this);
@@ -207,4 +478,35 @@ void SrsConnection::expire()
     trd->interrupt();
 }
 
+int SrsConnection::get_slot()
+{
+    return slot;
+}
+
+void SrsConnection::set_slot(int v)
+{
+    slot = v;
+}
+
+srs_error_t SrsConnection::tls_accept()
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t rtm = skt->get_recv_timeout();
+    srs_utime_t stm = skt->get_send_timeout();
+    skt->set_recv_timeout(SRS_TLS_HANDSHAKE_TIMEOUT);
+    skt->set_send_timeout(SRS_TLS_HANDSHAKE_TIMEOUT);
+    
+    err = skt->tls_accept(tls);
+    
+    skt->set_recv_timeout(rtm);
+    skt->set_send_timeout(stm);
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "tls accept");
+    }
+    
+    return err;
+}
+
 
@@ -35,6 +35,48 @@
 #include <srs_service_conn.hpp>
 
 class SrsWallClock;
+class SrsTlsContext;
+
+// The adaptive MW(merged-write) window for play connection, to tune the wait of consumer
+// by the send bitrate and the unsent bytes in socket send buffer, in [min, mw_latency].
+// For low bitrate stream such as pure audio, use small window to reduce the latency,
+// while for high bitrate stream, merge more messages to reduce the syscalls.
+class SrsMwAdaptive
+{
+private:
+    // The max window, the mw_latency of vhost.
+    srs_utime_t max_sleep;
+    // Whether the min_latency of vhost enabled.
+    bool realtime;
+    // The current window.
+    srs_utime_t window;
+    // The bitrate in kbps, smoothed by samples.
+    int kbps;
+    // The start time and send bytes of current sample.
+    srs_utime_t starttime;
+    int64_t start_bytes;
+    // Whether the socket send buffer is congested.
+    bool congested;
+public:
+    SrsMwAdaptive();
+    virtual ~SrsMwAdaptive();
+public:
+    // Initialize or reset by the mw_latency and min_latency of vhost.
+    virtual void initialize(srs_utime_t mw_latency, bool min_latency);
+    // Sample the total send bytes of connection.
+    // @return Whether got a new sample, user should update the send queue by on_send_queue.
+    virtual bool sample(srs_utime_t now, int64_t send_bytes);
+    // When got the unsent bytes and size of socket send buffer.
+    virtual void on_send_queue(int unsent, int sndbuf);
+public:
+    // The window to wait for messages.
+    virtual srs_utime_t sleep();
+    // The min messages to wait for.
+    virtual int min_msgs();
+    virtual int get_kbps();
+private:
+    virtual void update_window();
+};
 
 // The basic connection of SRS,
 // all connections accept from listener must extends from this base class,
@@ -54,21 +96,34 @@ protected:
     std::string ip;
     // The underlayer socket.
     SrsStSocket* skt;
+    // The TLS context to handshake before serving, NULL for plaintext.
+    SrsTlsContext* tls;
     // The connection total kbps.
     // not only the rtmp or http connection, all type of connection are
     // need to statistic the kbps of io.
     // The SrsStatistic will use it indirectly to statistic the bytes delta of current connection.
     SrsKbps* kbps;
     SrsWallClock* clk;
+    // The current pacing rate in kbps, 0 for unlimited.
+    int pacing_kbps;
+    // The last time to update the pacing rate.
+    srs_utime_t pacing_update_at;
     // The create time in milliseconds.
     // for current connection to log self create time and calculate the living time.
     int64_t create_time;
+    // The index of connection in manager, to remove it in O(1), -1 if not managed.
+    int slot;
 public:
     SrsConnection(IConnectionManager* cm, srs_netfd_t c, std::string cip);
     virtual ~SrsConnection();
 // Interface ISrsKbpsDelta
 public:
     virtual void remark(int64_t* in, int64_t* out);
+public:
+    // Get the total bytes of connection by the plain counters of socket, without sampling the kbps.
+    virtual void counters(int64_t* in, int64_t* out);
+    // Get the total time and number of stalls to write the socket, @see SRS_ST_STALL_THRESHOLD
+    virtual void stalls(srs_utime_t* time, int64_t* count);
 public:
     // To dipose the connection.
     virtual void dispose();
@@ -80,10 +135,28 @@ public:
     // when client cycle thread stop, invoke the on_thread_stop(), which will use server
     // To remove the client by server->remove(this).
     virtual srs_error_t start();
+    // Serve the connection over TLS, the handshake is done in the coroutine before serving.
+    virtual void set_tls(SrsTlsContext* v);
     // Set socket option TCP_NODELAY.
     virtual srs_error_t set_tcp_nodelay(bool v);
     // Set socket option SO_SNDBUF in srs_utime_t.
     virtual srs_error_t set_socket_buffer(srs_utime_t buffer_v);
+    // Set socket option TCP_CONGESTION, the congestion control algorithm, for example, bbr.
+    // @remark Ignore for OSX, which is not supported.
+    virtual srs_error_t set_tcp_congestion(std::string algo);
+    // Set socket option SO_MAX_PACING_RATE in kbps, 0 for unlimited.
+    // @remark Ignore for OSX, which is not supported.
+    virtual srs_error_t set_pacing_rate(int v);
+    // Set socket option TCP_NOTSENT_LOWAT in bytes, the socket is writable only when the unsent bytes are
+    // less than it, so the backlog of slow peer is kept in user space, 0 to disable.
+    // @remark Ignore for OSX, which is not supported.
+    virtual srs_error_t set_notsent_lowat(int v);
+    // Update the pacing rate to the bitrate of stream played by this connection, multiply by factor.
+    // @remark Does nothing if factor is not positive, or the bitrate changed less than 10%.
+    virtual srs_error_t update_pacing(double factor);
+    // Get the unsent bytes and the size of socket send buffer.
+    // @remark The unsent is always 0 for OSX, which is not supported.
+    virtual srs_error_t get_send_queue(int* unsent, int* sndbuf);
 // Interface ISrsOneCycleThreadHandler
 public:
     // The thread cycle function,
@@ -97,6 +170,12 @@ public:
     virtual std::string remote_ip();
     // Set connection to expired.
     virtual void expire();
+    // Get and set the index of connection in manager.
+    virtual int get_slot();
+    virtual void set_slot(int v);
+private:
+    // Do the TLS handshake with timeout.
+    virtual srs_error_t tls_accept();
 protected:
     // For concrete connection to do the cycle.
     virtual srs_error_t do_cycle() = 0;
@@ -33,15 +33,57 @@ using namespace std;
 #include <srs_protocol_utility.hpp>
 #include <srs_service_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_http_hooks.hpp>
+
+SrsCoWorkersNotifyTask::SrsCoWorkersNotifyTask(string t, string u)
+{
+    target = t;
+    url = u;
+}
+
+SrsCoWorkersNotifyTask::~SrsCoWorkersNotifyTask()
+{
+}
+
+srs_error_t SrsCoWorkersNotifyTask::call()
+{
+    return SrsHttpHooks::notify_co_workers(url);
+}
+
+string SrsCoWorkersNotifyTask::to_string()
+{
+    return "notify " + url;
+}
+
+string SrsCoWorkersNotifyTask::key()
+{
+    return target;
+}
+
+bool SrsCoWorkersNotifyTask::merge(ISrsAsyncCallTask* next)
+{
+    SrsCoWorkersNotifyTask* task = dynamic_cast<SrsCoWorkersNotifyTask*>(next);
+    if (!task || task->target != target) {
+        return false;
+    }
+    
+    url = task->url;
+    return true;
+}
 
 SrsCoWorkers* SrsCoWorkers::_instance = NULL;
 
 SrsCoWorkers::SrsCoWorkers()
 {
+    async = new SrsAsyncCallWorker("coworkers");
+    async_started = false;
 }
 
 SrsCoWorkers::~SrsCoWorkers()
 {
+    async->stop();
+    srs_freep(async);
+    
     map<string, SrsRequest*>::iterator it;
     for (it = streams.begin(); it != streams.end(); ++it) {
         SrsRequest* r = it->second;
@@ -58,36 +100,28 @@ SrsCoWorkers* SrsCoWorkers::instance()
     return _instance;
 }
 
-SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, string stream)
+SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, string stream, bool peer)
 {
     SrsRequest* r = find_stream_info(vhost, app, stream);
     if (!r) {
         // TODO: FIXME: Find stream from our origin util return to the start point.
         return SrsJsonAny::null();
     }
+    
+    // For edge peer, only serve the stream pulled from origin, to avoid loop between peers.
+    if (peer && origin_pulls.find(r->get_stream_url()) == origin_pulls.end()) {
+        return SrsJsonAny::null();
+    }
 
     // The service port parsing from listen port.
-    string listen_host;
+    string service_ip;
     int listen_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
-    vector<string> listen_hostports = _srs_config->get_listens();
-    if (!listen_hostports.empty()) {
-        string list_hostport = listen_hostports.at(0);
-
-        if (list_hostport.find(":") != string::npos) {
-            srs_parse_hostport(list_hostport, listen_host, listen_port);
-        } else {
-            listen_port = ::atoi(list_hostport.c_str());
-        }
-    }
+    service_address(service_ip, listen_port);
 
     // The ip of server, we use the request coworker-host as ip, if listen host is localhost or loopback.
     // For example, the server may behind a NAT(192.x.x.x), while its ip is a docker ip(172.x.x.x),
     // we should use the NAT(192.x.x.x) address as it's the exposed ip.
     // @see https://github.com/ossrs/srs/issues/1501
-    string service_ip;
-    if (listen_host != SRS_CONSTS_LOCALHOST && listen_host != SRS_CONSTS_LOOPBACK && listen_host != SRS_CONSTS_LOOPBACK6) {
-        service_ip = listen_host;
-    }
     if (service_ip.empty()) {
         int coworker_port;
         string coworker_host = coworker;
@@ -154,6 +188,11 @@ srs_error_t SrsCoWorkers::on_publish(SrsSource* s, SrsRequest* r)
     // Always use the latest one.
     streams[url] = r->copy();
     
+    // The local stream overwrites the remote one.
+    remotes.erase(url);
+    
+    notify(r, "on_publish");
+    
     return err;
 }
 
@@ -166,5 +205,128 @@ void SrsCoWorkers::on_unpublish(SrsSource* s, SrsRequest* r)
         srs_freep(it->second);
         streams.erase(it);
     }
+    
+    notify(r, "on_unpublish");
+}
+
+void SrsCoWorkers::on_remote_publish(string vhost, string app, string stream, string ip, int port, srs_utime_t version)
+{
+    string url = srs_generate_stream_url(vhost, app, stream);
+    
+    map<string, SrsCoWorkerLocation>::iterator it = remotes.find(url);
+    if (it != remotes.end() && it->second.version > version) {
+        return;
+    }
+    
+    SrsCoWorkerLocation& location = remotes[url];
+    location.ip = ip;
+    location.port = port;
+    location.version = version;
+}
+
+void SrsCoWorkers::on_remote_unpublish(string vhost, string app, string stream, string ip, int port, srs_utime_t version)
+{
+    string url = srs_generate_stream_url(vhost, app, stream);
+    
+    // Only remove the location of the origin, for the stream may republish to another origin.
+    map<string, SrsCoWorkerLocation>::iterator it = remotes.find(url);
+    if (it == remotes.end() || it->second.version > version) {
+        return;
+    }
+    if (it->second.ip != ip || it->second.port != port) {
+        return;
+    }
+    
+    remotes.erase(it);
+}
+
+bool SrsCoWorkers::find_remote(string vhost, string app, string stream, string& ip, int& port)
+{
+    string url = srs_generate_stream_url(vhost, app, stream);
+    
+    map<string, SrsCoWorkerLocation>::iterator it = remotes.find(url);
+    if (it == remotes.end()) {
+        return false;
+    }
+    
+    ip = it->second.ip;
+    port = it->second.port;
+    return true;
+}
+
+void SrsCoWorkers::notify(SrsRequest* r, string action)
+{
+    srs_error_t err = srs_success;
+    
+    // Only the origin of cluster notify the co-workers.
+    if (_srs_config->get_vhost_is_edge(r->vhost) || !_srs_config->get_vhost_origin_cluster(r->vhost)) {
+        return;
+    }
+    
+    vector<string> coworkers = _srs_config->get_vhost_coworkers(r->vhost);
+    if (coworkers.empty()) {
+        return;
+    }
+    
+    if (!async_started) {
+        if ((err = async->start()) != srs_success) {
+            srs_warn("coworkers: ignore start error %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            return;
+        }
+        async_started = true;
+    }
+    
+    // The host is empty if not specified, the co-worker use the peer ip instead.
+    string host;
+    int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    service_address(host, port);
+    
+    srs_utime_t version = srs_update_system_time();
+    
+    for (int i = 0; i < (int)coworkers.size(); i++) {
+        string url = "http://" + coworkers.at(i) + "/api/v1/clusters?action=" + action
+            + "&vhost=" + r->vhost + "&app=" + r->app + "&stream=" + r->stream
+            + "&port=" + srs_int2str(port) + "&version=" + srs_int2str(version);
+        
+        // @remark Never append the empty value, which breaks the parsing of query string.
+        if (!host.empty()) {
+            url += "&host=" + host;
+        }
+        
+        if ((err = async->execute(new SrsCoWorkersNotifyTask(coworkers.at(i) + r->get_stream_url(), url))) != srs_success) {
+            srs_warn("coworkers: ignore notify error %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+}
+
+void SrsCoWorkers::service_address(string& host, int& port)
+{
+    string listen_host;
+    vector<string> listen_hostports = _srs_config->get_listens();
+    if (!listen_hostports.empty()) {
+        string list_hostport = listen_hostports.at(0);
+        
+        if (list_hostport.find(":") != string::npos) {
+            srs_parse_hostport(list_hostport, listen_host, port);
+        } else {
+            port = ::atoi(list_hostport.c_str());
+        }
+    }
+    
+    if (listen_host != SRS_CONSTS_LOCALHOST && listen_host != SRS_CONSTS_LOOPBACK && listen_host != SRS_CONSTS_LOOPBACK6) {
+        host = listen_host;
+    }
 }
 
+
+void SrsCoWorkers::on_origin_pull(SrsRequest* r)
+{
+    origin_pulls.insert(r->get_stream_url());
+}
+
+void SrsCoWorkers::on_origin_unpull(SrsRequest* r)
+{
+    origin_pulls.erase(r->get_stream_url());
+}
@@ -28,30 +28,88 @@
 
 #include <string>
 #include <map>
+#include <set>
+
+#include <srs_app_async_call.hpp>
 
 class SrsJsonAny;
 class SrsRequest;
 class SrsSource;
 
+// The location of stream in other origin, pushed by the origin when publish.
+struct SrsCoWorkerLocation
+{
+    std::string ip;
+    int port;
+    // The version of location, the time of event, to ignore the stale event.
+    srs_utime_t version;
+};
+
+// The task to notify the co-worker the event of stream.
+class SrsCoWorkersNotifyTask : public ISrsAsyncCallTask
+{
+private:
+    // The co-worker and stream url, the notifies of it are executed in order.
+    std::string target;
+    std::string url;
+public:
+    SrsCoWorkersNotifyTask(std::string t, std::string u);
+    virtual ~SrsCoWorkersNotifyTask();
+public:
+    virtual srs_error_t call();
+    virtual std::string to_string();
+    virtual std::string key();
+    // The queued notify is stale, when a newer event of the stream comes.
+    virtual bool merge(ISrsAsyncCallTask* next);
+};
+
 // For origin cluster.
+// @remark The origin pushes the publish and unpublish events to co-workers, which caches the location
+//      of stream, to redirect the player without the HTTP query to all co-workers.
 class SrsCoWorkers
 {
 private:
     static SrsCoWorkers* _instance;
 private:
     std::map<std::string, SrsRequest*> streams;
+    // The streams in other origins, pushed by co-workers, key is stream url.
+    std::map<std::string, SrsCoWorkerLocation> remotes;
+    // The worker to notify co-workers.
+    SrsAsyncCallWorker* async;
+    bool async_started;
+    // The edge streams pulled from origin directly, which can be pulled by edge peers.
+    std::set<std::string> origin_pulls;
 private:
     SrsCoWorkers();
     virtual ~SrsCoWorkers();
 public:
     static SrsCoWorkers* instance();
 public:
-    virtual SrsJsonAny* dumps(std::string vhost, std::string coworker, std::string app, std::string stream);
+    // Dumps the location of stream.
+    // @param peer Only for the edge stream pulled from origin, for edge peers to pull from.
+    virtual SrsJsonAny* dumps(std::string vhost, std::string coworker, std::string app, std::string stream, bool peer = false);
 private:
     virtual SrsRequest* find_stream_info(std::string vhost, std::string app, std::string stream);
 public:
     virtual srs_error_t on_publish(SrsSource* s, SrsRequest* r);
     virtual void on_unpublish(SrsSource* s, SrsRequest* r);
+public:
+    // When co-worker notify the event of stream.
+    // @param version The version of event, ignore if older than current.
+    virtual void on_remote_publish(std::string vhost, std::string app, std::string stream, std::string ip, int port, srs_utime_t version);
+    virtual void on_remote_unpublish(std::string vhost, std::string app, std::string stream, std::string ip, int port, srs_utime_t version);
+    // Find the location of stream in other origin from the pushed events.
+    // @return true if found.
+    virtual bool find_remote(std::string vhost, std::string app, std::string stream, std::string& ip, int& port);
+private:
+    // Notify all co-workers about the event of local stream.
+    virtual void notify(SrsRequest* r, std::string action);
+    // Get the service host and port of this server, host is empty if not specified.
+    virtual void service_address(std::string& host, int& port);
+public:
+    // When edge starts or stops pulling stream from origin.
+    virtual void on_origin_pull(SrsRequest* r);
+    virtual void on_origin_unpull(SrsRequest* r);
 };
 
 #endif
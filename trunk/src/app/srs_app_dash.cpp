@@ -33,14 +33,66 @@
 #include <srs_kernel_file.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_mp4.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_http_static.hpp>
+#include <srs_app_hls.hpp>
 
 #include <stdlib.h>
 #include <sstream>
 using namespace std;
 
+SrsDashGrowingStore* _srs_dash_growing = new SrsDashGrowingStore();
+
+SrsDashGrowingStore::SrsDashGrowingStore()
+{
+    cond = NULL;
+}
+
+SrsDashGrowingStore::~SrsDashGrowingStore()
+{
+}
+
+void SrsDashGrowingStore::update(string path)
+{
+    segments[SrsHlsMemoryStore::normalize(path)]++;
+    
+    if (cond) {
+        srs_cond_broadcast(cond);
+    }
+}
+
+void SrsDashGrowingStore::complete(string path)
+{
+    segments.erase(SrsHlsMemoryStore::normalize(path));
+    
+    if (cond) {
+        srs_cond_broadcast(cond);
+    }
+}
+
+bool SrsDashGrowingStore::is_growing(string path)
+{
+    if (segments.empty()) {
+        return false;
+    }
+    
+    return segments.find(SrsHlsMemoryStore::normalize(path)) != segments.end();
+}
+
+void SrsDashGrowingStore::wait(srs_utime_t timeout)
+{
+    // Create when required, for ST maybe not initialized when construct.
+    if (!cond) {
+        cond = srs_cond_new();
+    }
+    
+    srs_cond_timedwait(cond, timeout);
+}
+
 SrsInitMp4::SrsInitMp4()
 {
     fw = new SrsFileWriter();
+    _srs_disk_io->attach(fw);
     init = new SrsMp4M2tsInitEncoder();
 }
 
@@ -67,6 +119,9 @@ srs_error_t SrsInitMp4::write(SrsFormat* format, bool video, int tid)
         return srs_error_wrap(err, "write init");
     }
     
+    // Close to flush the file, before rename it.
+    fw->close();
+    
     return err;
 }
 
@@ -74,12 +129,19 @@ SrsFragmentedMp4::SrsFragmentedMp4()
 {
     fw = new SrsFileWriter();
     enc = new SrsMp4M2tsSegmentEncoder();
+    chunk = 0;
+    chunk_start = chunk_end = -1;
+    growing = false;
 }
 
 SrsFragmentedMp4::~SrsFragmentedMp4()
 {
     srs_freep(enc);
     srs_freep(fw);
+    
+    if (growing) {
+        _srs_dash_growing->complete(fullpath());
+    }
 }
 
 srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, SrsMpdWriter* mpd, uint32_t tid)
@@ -101,15 +163,27 @@ srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, SrsMpdWriter
         return srs_error_wrap(err, "create dir");
     }
     
-    string path_tmp = tmppath();
-    if ((err = fw->open(path_tmp)) != srs_success) {
-        return srs_error_wrap(err, "Open fmp4 failed, path=%s", path_tmp.c_str());
+    // The chunked segment is written in current thread, so the chunk is readable once it's notified.
+    chunk = _srs_config->get_dash_chunk_duration(r->vhost);
+    if (!chunk) {
+        _srs_disk_io->attach(fw);
+    }
+    
+    string path = chunk? fullpath() : tmppath();
+    if ((err = fw->open(path)) != srs_success) {
+        return srs_error_wrap(err, "Open fmp4 failed, path=%s", path.c_str());
     }
     
     if ((err = enc->initialize(fw, (uint32_t)sequence_number, basetime, tid)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
     
+    if (chunk) {
+        growing = true;
+        _srs_http_file_meta->invalidate(path);
+        _srs_dash_growing->update(path);
+    }
+    
     return err;
 }
 
@@ -139,6 +213,29 @@ srs_error_t SrsFragmentedMp4::write(SrsSharedPtrMessage* shared_msg, SrsFormat*
     
     append(shared_msg->timestamp);
     
+    if (chunk_start < 0) {
+        chunk_start = shared_msg->timestamp;
+    }
+    chunk_end = shared_msg->timestamp;
+    
+    return err;
+}
+
+srs_error_t SrsFragmentedMp4::flush_chunk(uint64_t& dts)
+{
+    srs_error_t err = srs_success;
+    
+    if (!chunk || chunk_start < 0 || chunk_end - chunk_start < srsu2ms(chunk)) {
+        return err;
+    }
+    chunk_start = chunk_end = -1;
+    
+    if ((err = enc->flush_chunk(dts)) != srs_success) {
+        return srs_error_wrap(err, "flush chunk");
+    }
+    
+    _srs_dash_growing->update(fullpath());
+    
     return err;
 }
 
@@ -150,8 +247,21 @@ srs_error_t SrsFragmentedMp4::reap(uint64_t& dts)
         return srs_error_wrap(err, "Flush encoder failed");
     }
     
+    // Flush the cache at the boundary of segment, because close ignores the error.
+    if ((err = fw->flush()) != srs_success) {
+        return srs_error_wrap(err, "Flush fmp4 failed");
+    }
+    
     srs_freep(fw);
     
+    // The chunked segment is written to the official file, it's complete now.
+    if (growing) {
+        growing = false;
+        _srs_dash_growing->complete(fullpath());
+        _srs_http_file_meta->invalidate(fullpath());
+        return err;
+    }
+    
     if ((err = rename()) != srs_success) {
         return srs_error_wrap(err, "rename");
     }
@@ -162,8 +272,8 @@ srs_error_t SrsFragmentedMp4::reap(uint64_t& dts)
 SrsMpdWriter::SrsMpdWriter()
 {
     req = NULL;
-    timeshit = update_period = fragment = 0;
-    last_update_mpd = 0;
+    timeshit = update_period = fragment = chunk = 0;
+    dirty = true;
 }
 
 SrsMpdWriter::~SrsMpdWriter()
@@ -184,11 +294,17 @@ srs_error_t SrsMpdWriter::on_publish()
     update_period = _srs_config->get_dash_update_period(r->vhost);
     timeshit = _srs_config->get_dash_timeshift(r->vhost);
     home = _srs_config->get_dash_path(r->vhost);
-    mpd_file = _srs_config->get_dash_mpd_file(r->vhost);
+    chunk = srs_min(_srs_config->get_dash_chunk_duration(r->vhost), fragment);
 
-    string mpd_path = srs_path_build_stream(mpd_file, req->vhost, req->app, req->stream);
+    // The MPD path only depends on the stream, so build it once for all writes.
+    string mpd_file = _srs_config->get_dash_mpd_file(r->vhost);
+    mpd_path = srs_path_build_stream(mpd_file, req->vhost, req->app, req->stream);
     fragment_home = srs_path_dirname(mpd_path) + "/" + req->stream;
 
+    // Always write the MPD when publish, for the config may change.
+    dirty = true;
+    content = "";
+
     srs_trace("DASH: Config fragment=%" PRId64 ", period=%" PRId64, fragment, update_period);
 
     return srs_success;
@@ -202,25 +318,27 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format)
 {
     srs_error_t err = srs_success;
     
-    // MPD is not expired?
-    if (last_update_mpd != 0 && srs_get_system_time() - last_update_mpd < update_period) {
+    // The MPD only changes when there is a new segment.
+    if (!dirty) {
         return err;
     }
-    last_update_mpd = srs_get_system_time();
+    dirty = false;
     
-    string mpd_path = srs_path_build_stream(mpd_file, req->vhost, req->app, req->stream);
     string full_path = home + "/" + mpd_path;
     string full_home = srs_path_dirname(full_path);
     
-    fragment_home = srs_path_dirname(mpd_path) + "/" + req->stream;
-    
-    if ((err = srs_create_dir_recursively(full_home)) != srs_success) {
-        return srs_error_wrap(err, "Create MPD home failed, home=%s", full_home.c_str());
+    // For low-latency DASH, the segment is available when the first chunk is written, see DASH-IF IOP LL-DASH.
+    string ll_profile, ll_template;
+    if (chunk) {
+        stringstream ato;
+        ato << " availabilityTimeOffset=\"" << srsu2ms(fragment - chunk) / 1000.0 << "\" availabilityTimeComplete=\"false\"";
+        ll_template = ato.str();
+        ll_profile = ",http://www.dashif.org/guidelines/low-latency-live-v5";
     }
     
     stringstream ss;
     ss << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << endl
-    << "<MPD profiles=\"urn:mpeg:dash:profile:isoff-live:2011,http://dashif.org/guidelines/dash-if-simple\" " << endl
+    << "<MPD profiles=\"urn:mpeg:dash:profile:isoff-live:2011,http://dashif.org/guidelines/dash-if-simple" << ll_profile << "\" " << endl
     << "    ns1:schemaLocation=\"urn:mpeg:dash:schema:mpd:2011 DASH-MPD.xsd\" " << endl
     << "    xmlns=\"urn:mpeg:dash:schema:mpd:2011\" xmlns:ns1=\"http://www.w3.org/2001/XMLSchema-instance\" " << endl
     << "    type=\"dynamic\" minimumUpdatePeriod=\"PT" << update_period / SRS_UTIME_SECONDS << "S\" " << endl
@@ -230,9 +348,7 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format)
     << "    <Period start=\"PT0S\">" << endl;
     if (format->acodec) {
         ss  << "        <AdaptationSet mimeType=\"audio/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">" << endl;
-        ss  << "            <SegmentTemplate duration=\"" << fragment / SRS_UTIME_SECONDS << "\" "
-        << "initialization=\"$RepresentationID$-init.mp4\" "
-        << "media=\"$RepresentationID$-$Number$.m4s\" />" << endl;
+        ss  << segment_template(aruns, ll_template);
         ss  << "            <Representation id=\"audio\" bandwidth=\"48000\" codecs=\"mp4a.40.2\" />" << endl;
         ss  << "        </AdaptationSet>" << endl;
     }
@@ -240,9 +356,7 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format)
         int w = format->vcodec->width;
         int h = format->vcodec->height;
         ss  << "        <AdaptationSet mimeType=\"video/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">" << endl;
-        ss  << "            <SegmentTemplate duration=\"" << fragment / SRS_UTIME_SECONDS << "\" "
-        << "initialization=\"$RepresentationID$-init.mp4\" "
-        << "media=\"$RepresentationID$-$Number$.m4s\" />" << endl;
+        ss  << segment_template(vruns, ll_template);
         ss  << "            <Representation id=\"video\" bandwidth=\"800000\" codecs=\"avc1.64001e\" "
         << "width=\"" << w << "\" height=\"" << h << "\"/>" << endl;
         ss  << "        </AdaptationSet>" << endl;
@@ -250,24 +364,52 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format)
     ss  << "    </Period>" << endl
     << "</MPD>" << endl;
     
+    // Ignore if not changed, so the player and CDN always get the same MPD.
+    string v = ss.str();
+    if (v == content) {
+        return err;
+    }
+    
+    if ((err = _srs_disk_io->create_dir(full_home)) != srs_success) {
+        return srs_error_wrap(err, "Create MPD home failed, home=%s", full_home.c_str());
+    }
+    
     SrsFileWriter* fw = new SrsFileWriter();
     SrsAutoFree(SrsFileWriter, fw);
+    _srs_disk_io->attach(fw);
     
     string full_path_tmp = full_path + ".tmp";
     if ((err = fw->open(full_path_tmp)) != srs_success) {
         return srs_error_wrap(err, "Open MPD file=%s failed", full_path_tmp.c_str());
     }
     
-    string content = ss.str();
-    if ((err = fw->write((void*)content.data(), content.length(), NULL)) != srs_success) {
+    if ((err = fw->write((void*)v.data(), v.length(), NULL)) != srs_success) {
         return srs_error_wrap(err, "Write MPD file=%s failed", full_path.c_str());
     }
     
-    if (::rename(full_path_tmp.c_str(), full_path.c_str()) < 0) {
+    // Close to flush the file, before rename it.
+    fw->close();
+    
+    int r0 = _srs_disk_io->rename(full_path_tmp, full_path);
+    _srs_http_file_meta->invalidate(full_path);
+    if (r0 < 0) {
         return srs_error_new(ERROR_DASH_WRITE_FAILED, "Rename %s to %s failed", full_path_tmp.c_str(), full_path.c_str());
     }
     
-    srs_trace("DASH: Refresh MPD success, size=%dB, file=%s", content.length(), full_path.c_str());
+    content = v;
+    
+    // Serve the MPD in memory, the ETag is changed only when rewritten.
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile(content.data(), (int)content.length());
+    if (true) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "\"%llx-%x\"", (unsigned long long)srs_get_system_time(), (int)content.length());
+        file->set_etag(buf);
+    }
+    file->compress();
+    _srs_hls_memory->update(full_path, file);
+    
+    srs_trace("DASH: Refresh MPD success, size=%dB, timeline=%d/%d, file=%s", content.length(), (int)vruns.size(),
+        (int)aruns.size(), full_path.c_str());
     
     return err;
 }
@@ -294,18 +436,82 @@ srs_error_t SrsMpdWriter::get_fragment(bool video, std::string& home, std::strin
         file_name = "audio-" + srs_int2str(sn) + ".m4s";
     }
     
+    append(video? vruns : aruns, sn);
+    dirty = true;
+    
     return err;
 }
 
+void SrsMpdWriter::append(vector<SrsMpdRun>& runs, int64_t sn)
+{
+    // The fragment is reaped in the same sn, which overwrites the segment.
+    if (!runs.empty() && sn < runs.back().start + runs.back().count) {
+        return;
+    }
+    
+    if (!runs.empty() && sn == runs.back().start + runs.back().count) {
+        runs.back().count++;
+    } else {
+        SrsMpdRun run;
+        run.start = sn;
+        run.count = 1;
+        runs.push_back(run);
+    }
+    
+    // Remove the segments out of timeshift window, so the discontinuity is removed finally.
+    int64_t oldest = sn - srs_max(timeshit / fragment, 1);
+    while (!runs.empty() && runs.front().start + runs.front().count <= oldest) {
+        runs.erase(runs.begin());
+    }
+    if (!runs.empty() && runs.front().start < oldest) {
+        runs.front().count -= oldest - runs.front().start;
+        runs.front().start = oldest;
+    }
+}
+
+string SrsMpdWriter::segment_template(vector<SrsMpdRun>& runs, string ll_template)
+{
+    stringstream ss;
+    
+    // The segments are continuous, the player calculates the number by the wallclock.
+    if (runs.size() <= 1) {
+        ss  << "            <SegmentTemplate duration=\"" << fragment / SRS_UTIME_SECONDS << "\" "
+        << "initialization=\"$RepresentationID$-init.mp4\" "
+        << "media=\"$RepresentationID$-$Number$.m4s\"" << ll_template << " />" << endl;
+        return ss.str();
+    }
+    
+    // There is a gap of number, for example, republish, which is described by S@n, see ISO/IEC 23009-1:2019.
+    int64_t d = srsu2ms(fragment);
+    ss  << "            <SegmentTemplate timescale=\"1000\" startNumber=\"" << runs.front().start << "\" "
+    << "initialization=\"$RepresentationID$-init.mp4\" "
+    << "media=\"$RepresentationID$-$Number$.m4s\"" << ll_template << ">" << endl;
+    ss  << "                <SegmentTimeline>" << endl;
+    for (int i = 0; i < (int)runs.size(); i++) {
+        SrsMpdRun& run = runs.at(i);
+        ss  << "                    <S t=\"" << run.start * d << "\" n=\"" << run.start << "\" d=\"" << d << "\"";
+        if (run.count > 1) {
+            ss  << " r=\"" << run.count - 1 << "\"";
+        }
+        ss  << " />" << endl;
+    }
+    ss  << "                </SegmentTimeline>" << endl;
+    ss  << "            </SegmentTemplate>" << endl;
+    
+    return ss.str();
+}
+
 SrsDashController::SrsDashController()
 {
     req = NULL;
-    video_tack_id = 0;
-    audio_track_id = 1;
+    video_tack_id = 1;
+    audio_track_id = 2;
     mpd = new SrsMpdWriter();
     vcurrent = acurrent = NULL;
     vfragments = new SrsFragmentWindow();
     afragments = new SrsFragmentWindow();
+    vfragmenter = new SrsFragmenter();
+    afragmenter = new SrsFragmenter();
     audio_dts = video_dts = 0;
 }
 
@@ -316,6 +522,8 @@ SrsDashController::~SrsDashController()
     srs_freep(acurrent);
     srs_freep(vfragments);
     srs_freep(afragments);
+    srs_freep(vfragmenter);
+    srs_freep(afragmenter);
 }
 
 srs_error_t SrsDashController::initialize(SrsRequest* r)
@@ -339,6 +547,10 @@ srs_error_t SrsDashController::on_publish()
 
     fragment = _srs_config->get_dash_fragment(r->vhost);
     home = _srs_config->get_dash_path(r->vhost);
+    
+    // The tracks are in different fragments, so each track has its fragmenter.
+    vfragmenter->initialize(fragment);
+    afragmenter->initialize(fragment);
 
     if ((err = mpd->on_publish()) != srs_success) {
         return srs_error_wrap(err, "mpd");
@@ -386,7 +598,7 @@ srs_error_t SrsDashController::on_audio(SrsSharedPtrMessage* shared_audio, SrsFo
         return refresh_init_mp4(shared_audio, format);
     }
     
-    if (acurrent->duration() >= fragment) {
+    if (afragmenter->on_frame(shared_audio->timestamp, false, false)) {
         if ((err = acurrent->reap(audio_dts)) != srs_success) {
             return srs_error_wrap(err, "reap current");
         }
@@ -403,6 +615,10 @@ srs_error_t SrsDashController::on_audio(SrsSharedPtrMessage* shared_audio, SrsFo
         return srs_error_wrap(err, "Write audio to fragment failed");
     }
     
+    if ((err = acurrent->flush_chunk(audio_dts)) != srs_success) {
+        return srs_error_wrap(err, "Write audio chunk failed");
+    }
+    
     if ((err = refresh_mpd(format)) != srs_success) {
         return srs_error_wrap(err, "Refresh the MPD failed");
     }
@@ -418,8 +634,8 @@ srs_error_t SrsDashController::on_video(SrsSharedPtrMessage* shared_video, SrsFo
         return refresh_init_mp4(shared_video, format);
     }
     
-    bool reopen = format->video->frame_type == SrsVideoAvcFrameTypeKeyFrame && vcurrent->duration() >= fragment;
-    if (reopen) {
+    bool keyframe = format->video->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+    if (vfragmenter->on_frame(shared_video->timestamp, true, keyframe)) {
         if ((err = vcurrent->reap(video_dts)) != srs_success) {
             return srs_error_wrap(err, "reap current");
         }
@@ -436,6 +652,10 @@ srs_error_t SrsDashController::on_video(SrsSharedPtrMessage* shared_video, SrsFo
         return srs_error_wrap(err, "Write video to fragment failed");
     }
     
+    if ((err = vcurrent->flush_chunk(video_dts)) != srs_success) {
+        return srs_error_wrap(err, "Write video chunk failed");
+    }
+    
     if ((err = refresh_mpd(format)) != srs_success) {
         return srs_error_wrap(err, "Refresh the MPD failed");
     }
@@ -470,7 +690,7 @@ srs_error_t SrsDashController::refresh_init_mp4(SrsSharedPtrMessage* msg, SrsFor
     }
     
     string full_home = home + "/" + req->app + "/" + req->stream;
-    if ((err = srs_create_dir_recursively(full_home)) != srs_success) {
+    if ((err = _srs_disk_io->create_dir(full_home)) != srs_success) {
         return srs_error_wrap(err, "Create media home failed, home=%s", full_home.c_str());
     }
     
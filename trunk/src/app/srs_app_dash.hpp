@@ -28,8 +28,10 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 #include <srs_app_fragment.hpp>
+#include <srs_service_st.hpp>
 
 class SrsRequest;
 class SrsOriginHub;
@@ -40,6 +42,32 @@ class SrsMpdWriter;
 class SrsMp4M2tsInitEncoder;
 class SrsMp4M2tsSegmentEncoder;
 
+// The growing segments of low-latency DASH, which are written chunk by chunk, keyed by the file path.
+// The muxer updates the segment for each chunk, and the http server serves it in chunked encoding,
+// until the segment is complete.
+class SrsDashGrowingStore
+{
+private:
+    // The number of chunks written of segments.
+    std::map<std::string, int> segments;
+    srs_cond_t cond;
+public:
+    SrsDashGrowingStore();
+    virtual ~SrsDashGrowingStore();
+public:
+    // A chunk is written to segment, notify the waiting requests.
+    virtual void update(std::string path);
+    // The segment is complete or removed, notify the waiting requests.
+    virtual void complete(std::string path);
+    // Whether the segment is growing.
+    virtual bool is_growing(std::string path);
+    // Wait for any segment update, or timeout.
+    virtual void wait(srs_utime_t timeout);
+};
+
+// The global growing segments of DASH.
+extern SrsDashGrowingStore* _srs_dash_growing;
+
 // The init mp4 for FMP4.
 class SrsInitMp4 : public SrsFragment
 {
@@ -60,24 +88,52 @@ class SrsFragmentedMp4 : public SrsFragment
 private:
     SrsFileWriter* fw;
     SrsMp4M2tsSegmentEncoder* enc;
+private:
+    // The duration of CMAF chunk, 0 to write the whole segment when reap.
+    srs_utime_t chunk;
+    // The dts in ms of the first and last sample of current chunk, -1 for no sample.
+    int64_t chunk_start;
+    int64_t chunk_end;
+    // Whether the segment is growing, that is, written to the official file chunk by chunk.
+    bool growing;
 public:
     SrsFragmentedMp4();
     virtual ~SrsFragmentedMp4();
 public:
     // Initialize the fragment, create the home dir, open the file.
+    // @remark For chunked segment, write to the official file directly, rather than the tmp file.
     virtual srs_error_t initialize(SrsRequest* r, bool video, SrsMpdWriter* mpd, uint32_t tid);
     // Write media message to fragment.
     virtual srs_error_t write(SrsSharedPtrMessage* shared_msg, SrsFormat* format);
+    // Write the cached samples as a chunk when the chunk duration is reached, ignore if not chunked.
+    // @param dts The dts of last sample written, see reap.
+    virtual srs_error_t flush_chunk(uint64_t& dts);
     // Reap the fragment, close the fd and rename tmp to official file.
     virtual srs_error_t reap(uint64_t& dts);
 };
 
+// The continuous segments of a track, numbered from start, to build the SegmentTimeline.
+struct SrsMpdRun
+{
+    int64_t start;
+    int64_t count;
+};
+
 // The writer to write MPD for DASH.
+// The MPD uses the SegmentTemplate by $Number$, which is static when the segments are continuous, so it's
+// only rewritten when changed, for example, the codec changed or there is a discontinuity in timeshift
+// window, which is described by the SegmentTimeline until it's out of window.
 class SrsMpdWriter
 {
 private:
     SrsRequest* req;
-    srs_utime_t last_update_mpd;
+    // The continuous segments of video and audio in timeshift window.
+    std::vector<SrsMpdRun> vruns;
+    std::vector<SrsMpdRun> aruns;
+    // Whether got new segment, so the MPD should be generated and compared with the last one.
+    bool dirty;
+    // The content of last written MPD.
+    std::string content;
 private:
     // The duration of fragment in srs_utime_t.
     srs_utime_t fragment;
@@ -87,8 +143,10 @@ private:
     srs_utime_t timeshit;
     // The base or home dir for dash to write files.
     std::string home;
-    // The MPD path template, from which to build the file path.
-    std::string mpd_file;
+    // The MPD path relative to home, built from the template when publish.
+    std::string mpd_path;
+    // The duration of CMAF chunk in srs_utime_t, 0 to disable the low-latency DASH.
+    srs_utime_t chunk;
 private:
     // The home for fragment, relative to home.
     std::string fragment_home;
@@ -105,6 +163,11 @@ public:
     // Get the fragment relative home and filename.
     // The basetime is the absolute time in srs_utime_t, while the sn(sequence number) is basetime/fragment.
     virtual srs_error_t get_fragment(bool video, std::string& home, std::string& filename, int64_t& sn, srs_utime_t& basetime);
+private:
+    // Append the segment sn to runs, and remove the segments out of timeshift window.
+    virtual void append(std::vector<SrsMpdRun>& runs, int64_t sn);
+    // Build the SegmentTemplate, with SegmentTimeline if there is a discontinuity.
+    virtual std::string segment_template(std::vector<SrsMpdRun>& runs, std::string ll_template);
 };
 
 // The controller for DASH, control the MPD and FMP4 generating system.
@@ -118,6 +181,8 @@ private:
     SrsFragmentWindow* vfragments;
     SrsFragmentedMp4* acurrent;
     SrsFragmentWindow* afragments;
+    SrsFragmenter* vfragmenter;
+    SrsFragmenter* afragmenter;
     uint64_t audio_dts;
     uint64_t video_dts;
 private:
@@ -0,0 +1,722 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_disk_io.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+using namespace std;
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_config.hpp>
+#include <srs_kernel_recorder.hpp>
+
+SrsDiskIoPool* _srs_disk_io = new SrsDiskIoPool();
+
+// Create the dir and its parents, return the errno or 0 for success.
+// @remark Never use srs_create_dir_recursively in disk io thread, which writes log.
+static int srs_disk_io_mkdirs(const string& dir)
+{
+    mode_t mode = S_IRUSR|S_IWUSR|S_IXUSR|S_IRGRP|S_IWGRP|S_IXGRP|S_IROTH|S_IXOTH;
+    
+    for (size_t pos = 1; pos <= dir.length(); pos++) {
+        if (pos < dir.length() && dir.at(pos) != '/') {
+            continue;
+        }
+        
+        string parent = dir.substr(0, pos);
+        if (::mkdir(parent.c_str(), mode) < 0 && errno != EEXIST) {
+            return errno;
+        }
+    }
+    
+    return 0;
+}
+
+SrsDiskIoJob::SrsDiskIoJob(SrsDiskIoJobType t)
+{
+    type = t;
+    fd = -1;
+    buf = NULL;
+    size = 0;
+    offset = 0;
+    filter = NULL;
+    producer = NULL;
+    sync = false;
+    starttime = 0;
+    nn_failed = 0;
+    error = 0;
+    done = false;
+}
+
+SrsDiskIoJob::~SrsDiskIoJob()
+{
+    srs_freepa(buf);
+    srs_freep(producer);
+}
+
+void SrsDiskIoJob::execute()
+{
+    // Record the slow disk io, without cid because it's not in coroutine.
+    srs_utime_t starttime = _srs_recorder->begin();
+    do_execute();
+    _srs_recorder->end(SrsRecorderEventFileIO, starttime, (type == SrsDiskIoJobWrite)? size : 0, 0);
+}
+
+void SrsDiskIoJob::do_execute()
+{
+    if (type == SrsDiskIoJobWrite) {
+        // Generate the data in this thread, for example, packetize the ts.
+        if (producer) {
+            buf = new char[size];
+            producer->produce(buf, size);
+            srs_freep(producer);
+        }
+        
+        // Transform the data in this thread, for example, encrypt the ts.
+        if (filter && (error = filter->filter(buf, size)) != 0) {
+            return;
+        }
+        
+        int left = size;
+        while (left > 0) {
+            ssize_t nn = ::pwrite(fd, buf + size - left, left, (off_t)(offset + size - left));
+            if (nn < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nn <= 0) {
+                error = (nn < 0)? errno : EIO;
+                return;
+            }
+            left -= (int)nn;
+        }
+    } else if (type == SrsDiskIoJobClose) {
+        if (sync && ::fsync(fd) < 0) {
+            error = errno;
+        }
+        if (::close(fd) < 0 && !error) {
+            error = errno;
+        }
+    } else if (type == SrsDiskIoJobRename) {
+        if (::rename(from.c_str(), to.c_str()) < 0) {
+            error = errno;
+        }
+    } else if (type == SrsDiskIoJobUnlink) {
+        std::vector<std::string>::iterator it;
+        for (it = paths.begin(); it != paths.end(); ++it) {
+            if (::unlink(it->c_str()) < 0) {
+                error = errno;
+                nn_failed++;
+            }
+        }
+    } else if (type == SrsDiskIoJobMkdir) {
+        error = srs_disk_io_mkdirs(paths.at(0));
+    }
+}
+
+SrsDiskIoThread::SrsDiskIoThread(SrsDiskIoPool* p)
+{
+    pool = p;
+    started = false;
+    quit = false;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsDiskIoThread::~SrsDiskIoThread()
+{
+    stop();
+    
+    std::deque<SrsDiskIoJob*>::iterator it;
+    for (it = jobs.begin(); it != jobs.end(); ++it) {
+        SrsDiskIoJob* job = *it;
+        srs_freep(job);
+    }
+    jobs.clear();
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+srs_error_t SrsDiskIoThread::start()
+{
+    srs_error_t err = srs_success;
+    
+    int r0 = 0;
+    if ((r0 = pthread_create(&tid, NULL, SrsDiskIoThread::pfn, this)) != 0) {
+        return srs_error_new(ERROR_SYSTEM_DISK_IO_THREAD, "create thread, r0=%d", r0);
+    }
+    started = true;
+    
+    return err;
+}
+
+void SrsDiskIoThread::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(tid, NULL);
+    started = false;
+}
+
+void SrsDiskIoThread::push(SrsDiskIoJob* job)
+{
+    pthread_mutex_lock(&lock);
+    jobs.push_back(job);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void* SrsDiskIoThread::pfn(void* arg)
+{
+    // The signals are always handled by the ST thread.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    SrsDiskIoThread* p = (SrsDiskIoThread*)arg;
+    p->cycle();
+    
+    return NULL;
+}
+
+void SrsDiskIoThread::cycle()
+{
+    while (true) {
+        SrsDiskIoJob* job = NULL;
+        
+        pthread_mutex_lock(&lock);
+        while (!quit && jobs.empty()) {
+            pthread_cond_wait(&cond, &lock);
+        }
+        if (!jobs.empty()) {
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        pthread_mutex_unlock(&lock);
+        
+        // Quit until all jobs are done.
+        if (!job) {
+            return;
+        }
+        
+        job->execute();
+        pool->on_thread_done(job);
+    }
+}
+
+SrsDiskIoPool::SrsDiskIoPool()
+{
+    started = false;
+    sync = false;
+    max_pending = 0;
+    buffer_size = 0;
+    direct = false;
+    mux = false;
+    trd = new SrsDummyCoroutine();
+    cond = NULL;
+    pthread_mutex_init(&lock, NULL);
+    pipes[0] = pipes[1] = -1;
+    pipe_stfd = NULL;
+    
+    nn_pending = 0;
+    pending_bytes = peak_pending_bytes = 0;
+    nn_jobs = nn_bytes = nn_errors = 0;
+    nn_produces = 0;
+    nn_stalls = 0;
+    stall_time = 0;
+    latency = max_latency = 0;
+    
+    unlinks_starttime = 0;
+    nn_pending_unlinks = 0;
+    nn_unlinks = nn_unlink_errors = 0;
+    unlink_lag = max_unlink_lag = 0;
+    nn_mkdirs = nn_dir_hits = 0;
+}
+
+SrsDiskIoPool::~SrsDiskIoPool()
+{
+    // Stop the threads first, all jobs will be done.
+    std::vector<SrsDiskIoThread*>::iterator it;
+    for (it = threads.begin(); it != threads.end(); ++it) {
+        SrsDiskIoThread* thread = *it;
+        srs_freep(thread);
+    }
+    threads.clear();
+    
+    // Remove the files in the batch which is not submitted.
+    std::vector<std::string>::iterator it3;
+    for (it3 = unlinks.begin(); it3 != unlinks.end(); ++it3) {
+        ::unlink(it3->c_str());
+    }
+    unlinks.clear();
+    
+    srs_freep(trd);
+    srs_close_stfd(pipe_stfd);
+    if (pipes[1] > 0) {
+        ::close(pipes[1]);
+    }
+    
+    std::vector<SrsDiskIoJob*>::iterator it2;
+    for (it2 = dones.begin(); it2 != dones.end(); ++it2) {
+        SrsDiskIoJob* job = *it2;
+        if (job->type == SrsDiskIoJobWrite || job->type == SrsDiskIoJobUnlink) {
+            srs_freep(job);
+        }
+    }
+    dones.clear();
+    
+    if (cond) {
+        srs_cond_destroy(cond);
+    }
+    pthread_mutex_destroy(&lock);
+}
+
+srs_error_t SrsDiskIoPool::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (started) {
+        return err;
+    }
+    
+    // The write buffer works without the threads.
+    buffer_size = _srs_config->get_disk_io_buffer();
+    direct = _srs_config->get_disk_io_direct();
+    
+    if (!_srs_config->get_disk_io_enabled()) {
+        return err;
+    }
+    
+    sync = _srs_config->get_disk_io_fsync();
+    mux = _srs_config->get_disk_io_mux();
+    max_pending = _srs_config->get_disk_io_max_pending();
+    cond = srs_cond_new();
+    
+    if (::pipe(pipes) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+    
+    // The thread should never block when notify the coroutine.
+    int flags = ::fcntl(pipes[1], F_GETFL, 0);
+    if (flags == -1 || ::fcntl(pipes[1], F_SETFL, flags | O_NONBLOCK) == -1) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "nonblock pipe");
+    }
+    
+    if ((pipe_stfd = srs_netfd_open(pipes[0])) == NULL) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "open pipe");
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("disk-io", this, _srs_context->get_id());
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    int nn_threads = srs_max(1, _srs_config->get_disk_io_threads());
+    for (int i = 0; i < nn_threads; i++) {
+        SrsDiskIoThread* thread = new SrsDiskIoThread(this);
+        threads.push_back(thread);
+        
+        if ((err = thread->start()) != srs_success) {
+            return srs_error_wrap(err, "start thread #%d", i);
+        }
+    }
+    
+    started = true;
+    srs_trace("disk io: start %d threads, fsync=%d, max_pending=%dKB", nn_threads, sync, (int)(max_pending / 1024));
+    
+    return err;
+}
+
+bool SrsDiskIoPool::enabled()
+{
+    return started;
+}
+
+bool SrsDiskIoPool::mux_enabled()
+{
+    return started && mux;
+}
+
+void SrsDiskIoPool::attach(SrsFileWriter* writer)
+{
+    if (started) {
+        writer->set_async(this);
+    }
+    writer->set_buffer(buffer_size, direct && !started);
+}
+
+int SrsDiskIoPool::rename(string from, string to)
+{
+    if (!started) {
+        return ::rename(from.c_str(), to.c_str());
+    }
+    
+    // The files to unlink are requested before the rename, which might be the same path, for example,
+    // the segment of previous publish, so we must remove them before rename.
+    flush_unlinks();
+    
+    SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobRename);
+    SrsAutoFree(SrsDiskIoJob, job);
+    
+    job->from = from;
+    job->to = to;
+    job->starttime = srs_update_monotonic_time();
+    
+    // Rename is not about any fd, use the first thread.
+    threads.at(0)->push(job);
+    wait(job);
+    
+    if (job->error) {
+        errno = job->error;
+        return -1;
+    }
+    
+    return 0;
+}
+
+int SrsDiskIoPool::unlink(string path)
+{
+    if (!started) {
+        return ::unlink(path.c_str());
+    }
+    
+    if (unlinks.empty()) {
+        unlinks_starttime = srs_get_monotonic_time();
+    }
+    unlinks.push_back(path);
+    nn_pending_unlinks++;
+    
+    if ((int)unlinks.size() >= SRS_DISK_IO_UNLINK_BATCH) {
+        flush_unlinks();
+    }
+    
+    return 0;
+}
+
+srs_error_t SrsDiskIoPool::create_dir(string dir)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t now = srs_get_monotonic_time();
+    std::map<std::string, srs_utime_t>::iterator it = dirs.find(dir);
+    if (it != dirs.end() && now - it->second < SRS_DISK_IO_DIR_TTL) {
+        nn_dir_hits++;
+        return err;
+    }
+    
+    if (!started) {
+        if ((err = srs_create_dir_recursively(dir)) != srs_success) {
+            return srs_error_wrap(err, "create dir");
+        }
+    } else {
+        SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobMkdir);
+        SrsAutoFree(SrsDiskIoJob, job);
+        
+        job->paths.push_back(dir);
+        job->starttime = srs_update_monotonic_time();
+        
+        // Mkdir is not about any fd, use the first thread.
+        threads.at(0)->push(job);
+        wait(job);
+        
+        if (job->error) {
+            errno = job->error;
+            return srs_error_new(ERROR_SYSTEM_CREATE_DIR, "create dir %s", dir.c_str());
+        }
+    }
+    
+    if ((int)dirs.size() >= SRS_DISK_IO_MAX_DIRS) {
+        dirs.clear();
+    }
+    dirs[dir] = now;
+    nn_mkdirs++;
+    
+    return err;
+}
+
+void SrsDiskIoPool::dumps(SrsJsonObject* obj)
+{
+    obj->set("enabled", SrsJsonAny::boolean(started));
+    obj->set("threads", SrsJsonAny::integer((int)threads.size()));
+    obj->set("fsync", SrsJsonAny::boolean(sync));
+    obj->set("max_pending", SrsJsonAny::integer(max_pending));
+    obj->set("pending", SrsJsonAny::integer(nn_pending));
+    obj->set("pending_bytes", SrsJsonAny::integer(pending_bytes));
+    obj->set("peak_pending_bytes", SrsJsonAny::integer(peak_pending_bytes));
+    obj->set("jobs", SrsJsonAny::integer(nn_jobs));
+    obj->set("bytes", SrsJsonAny::integer(nn_bytes));
+    obj->set("errors", SrsJsonAny::integer(nn_errors));
+    obj->set("mux", SrsJsonAny::boolean(mux));
+    obj->set("produces", SrsJsonAny::integer(nn_produces));
+    obj->set("stalls", SrsJsonAny::integer(nn_stalls));
+    obj->set("stall_ms", SrsJsonAny::integer(srsu2ms(stall_time)));
+    obj->set("avg_latency_ms", SrsJsonAny::integer(nn_jobs? srsu2ms(latency) / nn_jobs : 0));
+    obj->set("max_latency_ms", SrsJsonAny::integer(srsu2ms(max_latency)));
+    obj->set("pending_unlinks", SrsJsonAny::integer(nn_pending_unlinks));
+    obj->set("unlinks", SrsJsonAny::integer(nn_unlinks));
+    obj->set("unlink_errors", SrsJsonAny::integer(nn_unlink_errors));
+    obj->set("unlink_lag_ms", SrsJsonAny::integer(srsu2ms(unlink_lag)));
+    obj->set("max_unlink_lag_ms", SrsJsonAny::integer(srsu2ms(max_unlink_lag)));
+    obj->set("mkdirs", SrsJsonAny::integer(nn_mkdirs));
+    obj->set("dir_hits", SrsJsonAny::integer(nn_dir_hits));
+}
+
+srs_error_t SrsDiskIoPool::submit_write(int fd, char* buf, int size, int64_t offset, ISrsFileFilter* filter)
+{
+    SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobWrite);
+    job->fd = fd;
+    job->buf = buf;
+    job->size = size;
+    job->offset = offset;
+    job->filter = filter;
+    
+    return do_submit_write(job);
+}
+
+srs_error_t SrsDiskIoPool::submit_produce(int fd, ISrsFileProducer* producer, int size, int64_t offset, ISrsFileFilter* filter)
+{
+    SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobWrite);
+    job->fd = fd;
+    job->producer = producer;
+    job->size = size;
+    job->offset = offset;
+    job->filter = filter;
+    
+    nn_produces++;
+    
+    return do_submit_write(job);
+}
+
+srs_error_t SrsDiskIoPool::do_submit_write(SrsDiskIoJob* job)
+{
+    srs_error_t err = srs_success;
+    
+    int fd = job->fd;
+    int size = job->size;
+    
+    // Return the error of previous writes.
+    std::map<int, int>::iterator it = errors.find(fd);
+    if (it != errors.end()) {
+        srs_freep(job);
+        errno = it->second;
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "write fd=%d", fd);
+    }
+    
+    // Backpressure, wait when disk is slower than stream.
+    if (pending_bytes > 0 && pending_bytes + size > max_pending) {
+        nn_stalls++;
+        
+        srs_utime_t starttime = srs_update_monotonic_time();
+        while (pending_bytes > 0 && pending_bytes + size > max_pending) {
+            srs_cond_wait(cond);
+        }
+        stall_time += srs_update_monotonic_time() - starttime;
+    }
+    
+    nn_pending++;
+    pending_bytes += size;
+    peak_pending_bytes = srs_max(peak_pending_bytes, pending_bytes);
+    
+    job->starttime = srs_get_monotonic_time();
+    thread_of(fd)->push(job);
+    
+    return err;
+}
+
+srs_error_t SrsDiskIoPool::submit_close(int fd)
+{
+    srs_error_t err = srs_success;
+    
+    SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobClose);
+    SrsAutoFree(SrsDiskIoJob, job);
+    
+    job->fd = fd;
+    job->sync = sync;
+    job->starttime = srs_update_monotonic_time();
+    
+    // The close is executed after all writes of fd, by the same thread.
+    thread_of(fd)->push(job);
+    wait(job);
+    
+    int error = job->error;
+    std::map<int, int>::iterator it = errors.find(fd);
+    if (it != errors.end()) {
+        error = it->second;
+        errors.erase(it);
+    }
+    
+    if (error) {
+        errno = error;
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "close fd=%d", fd);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDiskIoPool::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    char buf[64];
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "disk io");
+        }
+        
+        // Wakeup to flush the files to unlink, when there is no job done.
+        ssize_t nn = srs_read(pipe_stfd, buf, sizeof(buf), SRS_DISK_IO_UNLINK_INTERVAL);
+        if (nn <= 0 && (nn == 0 || errno != ETIME)) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "read pipe");
+        }
+        
+        if (nn > 0) {
+            consume();
+        }
+        
+        if (!unlinks.empty() && srs_get_monotonic_time() - unlinks_starttime >= SRS_DISK_IO_UNLINK_INTERVAL) {
+            flush_unlinks();
+        }
+    }
+    
+    return err;
+}
+
+void SrsDiskIoPool::on_thread_done(SrsDiskIoJob* job)
+{
+    pthread_mutex_lock(&lock);
+    bool notify = dones.empty();
+    dones.push_back(job);
+    pthread_mutex_unlock(&lock);
+    
+    // Only notify for the first done job, the coroutine consumes all.
+    if (notify) {
+        char v = 0;
+        if (::write(pipes[1], &v, 1) < 0) {
+            // Ignore, the pipe is full, the coroutine is notified.
+        }
+    }
+}
+
+SrsDiskIoThread* SrsDiskIoPool::thread_of(int fd)
+{
+    return threads.at(fd % (int)threads.size());
+}
+
+void SrsDiskIoPool::wait(SrsDiskIoJob* job)
+{
+    while (!job->done) {
+        srs_cond_wait(cond);
+    }
+}
+
+void SrsDiskIoPool::consume()
+{
+    std::vector<SrsDiskIoJob*> jobs;
+    if (true) {
+        pthread_mutex_lock(&lock);
+        jobs.swap(dones);
+        pthread_mutex_unlock(&lock);
+    }
+    
+    srs_utime_t now = srs_update_monotonic_time();
+    
+    std::vector<SrsDiskIoJob*>::iterator it;
+    for (it = jobs.begin(); it != jobs.end(); ++it) {
+        SrsDiskIoJob* job = *it;
+        
+        // The unlink jobs are free here, for nobody waits for it.
+        if (job->type == SrsDiskIoJobUnlink) {
+            nn_pending_unlinks -= (int)job->paths.size();
+            nn_unlinks += (int64_t)job->paths.size();
+            nn_unlink_errors += job->nn_failed;
+            unlink_lag = now - job->starttime;
+            max_unlink_lag = srs_max(max_unlink_lag, unlink_lag);
+            
+            if (job->error) {
+                srs_warn("disk io: unlink %d/%d files failed, errno=%d(%s)", job->nn_failed, (int)job->paths.size(), job->error, strerror(job->error));
+            }
+            
+            srs_freep(job);
+            continue;
+        }
+        
+        nn_jobs++;
+        latency += now - job->starttime;
+        max_latency = srs_max(max_latency, now - job->starttime);
+        
+        if (job->error) {
+            nn_errors++;
+            srs_warn("disk io: type=%d, fd=%d failed, errno=%d(%s)", job->type, job->fd, job->error, strerror(job->error));
+        }
+        
+        // The close and rename jobs are free by the waiter.
+        if (job->type != SrsDiskIoJobWrite) {
+            job->done = true;
+            continue;
+        }
+        
+        nn_pending--;
+        pending_bytes -= job->size;
+        nn_bytes += job->size;
+        if (job->error && errors.find(job->fd) == errors.end()) {
+            errors[job->fd] = job->error;
+        }
+        srs_freep(job);
+    }
+    
+    if (!jobs.empty()) {
+        srs_cond_broadcast(cond);
+    }
+}
+
+void SrsDiskIoPool::flush_unlinks()
+{
+    if (unlinks.empty()) {
+        return;
+    }
+    
+    SrsDiskIoJob* job = new SrsDiskIoJob(SrsDiskIoJobUnlink);
+    job->paths.swap(unlinks);
+    job->starttime = unlinks_starttime;
+    
+    // Unlink is not about any fd, use the first thread, in order with rename.
+    threads.at(0)->push(job);
+}
+
@@ -0,0 +1,240 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_DISK_IO_HPP
+#define SRS_APP_DISK_IO_HPP
+
+#include <srs_core.hpp>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include <srs_kernel_file.hpp>
+#include <srs_app_st.hpp>
+
+class SrsJsonObject;
+class SrsDiskIoPool;
+
+// The max number of files to unlink in a job.
+#define SRS_DISK_IO_UNLINK_BATCH 64
+// The interval to flush the files to unlink, when batch is not full.
+#define SRS_DISK_IO_UNLINK_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+// The dir is stat again after this time, in case it's removed by others.
+#define SRS_DISK_IO_DIR_TTL (10 * SRS_UTIME_SECONDS)
+// The max number of cached dirs, clear all when exceed.
+#define SRS_DISK_IO_MAX_DIRS 4096
+
+// The type of disk io job.
+enum SrsDiskIoJobType
+{
+    SrsDiskIoJobWrite = 0,
+    SrsDiskIoJobClose,
+    SrsDiskIoJobRename,
+    SrsDiskIoJobUnlink,
+    SrsDiskIoJobMkdir,
+};
+
+// The job to execute in the disk io thread.
+class SrsDiskIoJob
+{
+public:
+    SrsDiskIoJobType type;
+    int fd;
+    // For write, the data to write at offset of fd.
+    char* buf;
+    int size;
+    int64_t offset;
+    // For write, the filter to apply to buf before write, NULL to write as is.
+    ISrsFileFilter* filter;
+    // For write, the producer to generate buf in thread, NULL if buf is ready.
+    ISrsFileProducer* producer;
+    // For close, whether fsync before close.
+    bool sync;
+    // For rename, the path from and to.
+    std::string from;
+    std::string to;
+    // For unlink, the batch of files to remove. For mkdir, the dir to create recursively.
+    std::vector<std::string> paths;
+    // For unlink, the number of files failed to remove.
+    int nn_failed;
+    // The time in srs_utime_t when the job is submitted.
+    srs_utime_t starttime;
+public:
+    // The errno of job, set by disk io thread, 0 for success.
+    int error;
+    // Whether job is done, set by the coroutine of pool.
+    bool done;
+public:
+    SrsDiskIoJob(SrsDiskIoJobType t);
+    virtual ~SrsDiskIoJob();
+public:
+    // Execute the job in disk io thread.
+    virtual void execute();
+private:
+    virtual void do_execute();
+};
+
+// The disk io thread, which is an OS thread not ST coroutine,
+// so it can never use any ST API, and only do the disk io.
+class SrsDiskIoThread
+{
+private:
+    SrsDiskIoPool* pool;
+    pthread_t tid;
+    bool started;
+    bool quit;
+    // The jobs queue, protected by lock.
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    std::deque<SrsDiskIoJob*> jobs;
+public:
+    SrsDiskIoThread(SrsDiskIoPool* p);
+    virtual ~SrsDiskIoThread();
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    // Push job to thread, execute in order.
+    virtual void push(SrsDiskIoJob* job);
+private:
+    static void* pfn(void* arg);
+    virtual void cycle();
+};
+
+// The pool of disk io threads, to execute the segment writes, fsync and rename,
+// so that the disk stall never blocks the ST thread.
+// The coroutine submit job to thread then wait for the completion,
+// which is delivered back by a pipe to the pool coroutine.
+// @remark The jobs of a fd are always executed by the same thread, in order.
+class SrsDiskIoPool : virtual public ISrsAsyncFileIO, virtual public ISrsCoroutineHandler
+{
+private:
+    bool started;
+    bool sync;
+    int64_t max_pending;
+    // The write buffer of file, and whether by O_DIRECT.
+    int buffer_size;
+    bool direct;
+    // Whether packetize the ts in threads.
+    bool mux;
+    std::vector<SrsDiskIoThread*> threads;
+    SrsCoroutine* trd;
+    // Signal when any job is done.
+    srs_cond_t cond;
+private:
+    // The done jobs from threads, protected by lock.
+    pthread_mutex_t lock;
+    std::vector<SrsDiskIoJob*> dones;
+    // The pipe to notify the coroutine when jobs done.
+    int pipes[2];
+    srs_netfd_t pipe_stfd;
+private:
+    // The errno of fd, set when write failed.
+    std::map<int, int> errors;
+private:
+    // The pending jobs and bytes, only for write.
+    int nn_pending;
+    int64_t pending_bytes;
+    int64_t peak_pending_bytes;
+    // The total number of jobs, bytes and errors.
+    int64_t nn_jobs;
+    int64_t nn_bytes;
+    int64_t nn_errors;
+    // The number of writes generated by producer.
+    int64_t nn_produces;
+    // The number of stalls and wait time, when pending bytes exceed the max.
+    int64_t nn_stalls;
+    srs_utime_t stall_time;
+    // The total and max latency from submitted to done.
+    srs_utime_t latency;
+    srs_utime_t max_latency;
+private:
+    // The files to unlink in batch, and the time of the first one.
+    std::vector<std::string> unlinks;
+    srs_utime_t unlinks_starttime;
+    // The number of files to unlink, which are not done.
+    int nn_pending_unlinks;
+    int64_t nn_unlinks;
+    int64_t nn_unlink_errors;
+    // The lag of unlink, from requested to done.
+    srs_utime_t unlink_lag;
+    srs_utime_t max_unlink_lag;
+    // The dirs which exist, to the time when ensured.
+    std::map<std::string, srs_utime_t> dirs;
+    int64_t nn_mkdirs;
+    int64_t nn_dir_hits;
+public:
+    SrsDiskIoPool();
+    virtual ~SrsDiskIoPool();
+public:
+    // Start the disk io threads if enabled.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start();
+    // Whether the disk io threads are started.
+    virtual bool enabled();
+    // Whether packetize the ts of HLS in threads, only when enabled.
+    virtual bool mux_enabled();
+    // Write the file by disk io threads if enabled, and cache the writes in block.
+    // @remark User must attach before open the file.
+    virtual void attach(SrsFileWriter* writer);
+    // Rename file in disk io thread if enabled, the return value and errno are the same as ::rename.
+    virtual int rename(std::string from, std::string to);
+    // Unlink file in disk io thread in batch if enabled, the return value and errno are the same as ::unlink,
+    // while it's always 0 if enabled, because the error is only logged and counted when done.
+    virtual int unlink(std::string path);
+    // Create the dir recursively in disk io thread if enabled, and skip it when it was ensured
+    // recently, so we don't stat and mkdir for each segment.
+    virtual srs_error_t create_dir(std::string dir);
+    // Dumps the stat of disk io to json object.
+    virtual void dumps(SrsJsonObject* obj);
+// Interface ISrsAsyncFileIO
+public:
+    virtual srs_error_t submit_write(int fd, char* buf, int size, int64_t offset, ISrsFileFilter* filter);
+    virtual srs_error_t submit_produce(int fd, ISrsFileProducer* producer, int size, int64_t offset, ISrsFileFilter* filter);
+    virtual srs_error_t submit_close(int fd);
+private:
+    virtual srs_error_t do_submit_write(SrsDiskIoJob* job);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+public:
+    // Called by disk io thread when job is done.
+    virtual void on_thread_done(SrsDiskIoJob* job);
+private:
+    virtual SrsDiskIoThread* thread_of(int fd);
+    // Wait for the job done, which is submitted by the coroutine.
+    virtual void wait(SrsDiskIoJob* job);
+    // Consume the done jobs from threads.
+    virtual void consume();
+    // Submit the files to unlink as a job.
+    virtual void flush_unlinks();
+};
+
+// The global disk io pool.
+extern SrsDiskIoPool* _srs_disk_io;
+
+#endif
+
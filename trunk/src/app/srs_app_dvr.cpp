@@ -24,6 +24,7 @@
 #include <srs_app_dvr.hpp>
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -42,6 +43,9 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_kernel_mp4.hpp>
 #include <srs_app_fragment.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_upload.hpp>
+#include <srs_app_events.hpp>
 
 SrsDvrSegmenter::SrsDvrSegmenter()
 {
@@ -51,7 +55,9 @@ SrsDvrSegmenter::SrsDvrSegmenter()
     
     fragment = new SrsFragment();
     fs = new SrsFileWriter();
+    _srs_disk_io->attach(fs);
     jitter_algorithm = SrsRtmpJitterAlgorithmOFF;
+    path_template = new SrsPathTemplate();
     
     _srs_config->subscribe(this);
 }
@@ -63,6 +69,7 @@ SrsDvrSegmenter::~SrsDvrSegmenter()
     srs_freep(fragment);
     srs_freep(jitter);
     srs_freep(fs);
+    srs_freep(path_template);
 }
 
 srs_error_t SrsDvrSegmenter::initialize(SrsDvrPlan* p, SrsRequest* r)
@@ -72,6 +79,7 @@ srs_error_t SrsDvrSegmenter::initialize(SrsDvrPlan* p, SrsRequest* r)
     
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_dvr_time_jitter(req->vhost);
     wait_keyframe = _srs_config->get_dvr_wait_keyframe(req->vhost);
+    compile_path();
     
     return srs_success;
 }
@@ -180,10 +188,16 @@ srs_error_t SrsDvrSegmenter::close()
     
     // Close the encoder, then close the fs object.
     err = close_encoder();
+    // Flush the cache at the boundary of segment, because close ignores the error.
+    srs_error_t r0 = fs->flush();
     fs->close(); // Always close the file.
     if (err != srs_success) {
+        srs_freep(r0);
         return srs_error_wrap(err, "close encoder");
     }
+    if (r0 != srs_success) {
+        return srs_error_wrap(r0, "flush");
+    }
     
     // when tmp flv file exists, reap it.
     if ((err = fragment->rename()) != srs_success) {
@@ -200,6 +214,11 @@ srs_error_t SrsDvrSegmenter::close()
 }
 
 string SrsDvrSegmenter::generate_path()
+{
+    return path_template->render();
+}
+
+void SrsDvrSegmenter::compile_path()
 {
     // the path in config, for example,
     //      /data/[vhost]/[app]/[stream]/[2006]/[01]/[02]/[15].[04].[05].[999].flv
@@ -210,12 +229,7 @@ string SrsDvrSegmenter::generate_path()
         path_config += "/[stream].[timestamp].flv";
     }
     
-    // the flv file path
-    std::string flv_path = path_config;
-    flv_path = srs_path_build_stream(flv_path, req->vhost, req->app, req->stream);
-    flv_path = srs_path_build_timestamp(flv_path);
-    
-    return flv_path;
+    path_template->compile(path_config, req->vhost, req->app, req->stream, _srs_config->get_utc_time());
 }
 
 srs_error_t SrsDvrSegmenter::on_update_duration(SrsSharedPtrMessage* msg)
@@ -234,6 +248,7 @@ srs_error_t SrsDvrSegmenter::on_reload_vhost_dvr(std::string vhost)
     
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_dvr_time_jitter(req->vhost);
     wait_keyframe = _srs_config->get_dvr_wait_keyframe(req->vhost);
+    compile_path();
     
     return err;
 }
@@ -533,6 +548,210 @@ srs_error_t SrsDvrMp4Segmenter::close_encoder()
     return err;
 }
 
+SrsDvrFmp4Segmenter::SrsDvrFmp4Segmenter()
+{
+    enc = new SrsMp4FragmentEncoder();
+    duration = 0;
+    vtid = atid = 0;
+    init_written = false;
+}
+
+SrsDvrFmp4Segmenter::~SrsDvrFmp4Segmenter()
+{
+    srs_freep(enc);
+}
+
+srs_error_t SrsDvrFmp4Segmenter::refresh_metadata()
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::open_encoder()
+{
+    srs_freep(enc);
+    enc = new SrsMp4FragmentEncoder();
+    
+    duration = _srs_config->get_dvr_mp4_fragment(req->vhost);
+    vtid = atid = 0;
+    init_written = false;
+    
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_metadata(SrsSharedPtrMessage* /*metadata*/)
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format)
+{
+    // TODO: FIXME: Support other audio codecs.
+    if (!format->acodec || format->acodec->id != SrsAudioCodecIdAAC) {
+        return srs_success;
+    }
+    return write_sample(false, (uint32_t)audio->timestamp, format);
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_video(SrsSharedPtrMessage* video, SrsFormat* format)
+{
+    // TODO: FIXME: Support other video codecs.
+    if (!format->vcodec || (format->vcodec->id != SrsVideoCodecIdAVC && format->vcodec->id != SrsVideoCodecIdHEVC)) {
+        return srs_success;
+    }
+    return write_sample(true, (uint32_t)video->timestamp, format);
+}
+
+srs_error_t SrsDvrFmp4Segmenter::close_encoder()
+{
+    srs_error_t err = srs_success;
+    
+    if (!enc->empty() && (err = enc->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush fragment");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::write_sample(bool video, uint32_t dts, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    // The sequence header is written in init, before the first sample. There is only one
+    // moov in a file, so we ignore the sequence header change, please reap another segment.
+    bool sh = video? format->is_avc_sequence_header() : format->is_aac_sequence_header();
+    if (sh) {
+        if (init_written) {
+            srs_warn("dvr ignore %s sequence header change for fMP4", video? "video" : "audio");
+        }
+        return err;
+    }
+    
+    if (!format->raw || format->nb_raw <= 0) {
+        return err;
+    }
+    
+    if (!init_written) {
+        vtid = (format->vcodec && !format->vcodec->avc_extra_data.empty())? 1 : 0;
+        atid = (format->acodec && !format->acodec->aac_extra_data.empty())? 2 : 0;
+        
+        // Ignore the samples without sequence header.
+        if (!vtid && !atid) {
+            return err;
+        }
+        
+        SrsMp4M2tsInitEncoder init;
+        if ((err = init.initialize(fs)) != srs_success) {
+            return srs_error_wrap(err, "init");
+        }
+        if ((err = init.write(format, (int)vtid, (int)atid)) != srs_success) {
+            return srs_error_wrap(err, "write init");
+        }
+        
+        if ((err = enc->initialize(fs, vtid, atid)) != srs_success) {
+            return srs_error_wrap(err, "init fragment");
+        }
+        
+        init_written = true;
+    }
+    
+    // Reap the fragment when its duration exceeds, and start the next one from keyframe if there is video.
+    bool keyframe = video && format->video->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+    if (!enc->empty()) {
+        bool overflow = enc->duration() * SRS_UTIME_MILLISECONDS >= duration;
+        if (overflow && (keyframe || !vtid) && (err = enc->flush()) != srs_success) {
+            return srs_error_wrap(err, "flush fragment");
+        }
+    }
+    
+    if (video) {
+        uint32_t pts = dts + (uint32_t)format->video->cts;
+        err = enc->write_sample(SrsMp4HandlerTypeVIDE, format->video->frame_type, dts, pts, (uint8_t*)format->raw, (uint32_t)format->nb_raw);
+    } else {
+        err = enc->write_sample(SrsMp4HandlerTypeSOUN, 0x00, dts, dts, (uint8_t*)format->raw, (uint32_t)format->nb_raw);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+    
+    return err;
+}
+
+SrsDvrAsyncCallFinalizeMp4::SrsDvrAsyncCallFinalizeMp4(string p)
+{
+    path = p;
+}
+
+SrsDvrAsyncCallFinalizeMp4::~SrsDvrAsyncCallFinalizeMp4()
+{
+}
+
+srs_error_t SrsDvrAsyncCallFinalizeMp4::call()
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = srs_update_monotonic_time();
+    
+    // Keep the fMP4 when failed, which is also playable.
+    string tmp = path + ".finalize";
+    if ((err = do_finalize(tmp)) != srs_success) {
+        ::unlink(tmp.c_str());
+        return srs_error_wrap(err, "finalize %s", path.c_str());
+    }
+    
+    if (::rename(tmp.c_str(), path.c_str()) < 0) {
+        ::unlink(tmp.c_str());
+        return srs_error_new(ERROR_SYSTEM_FILE_RENAME, "rename %s to %s", tmp.c_str(), path.c_str());
+    }
+    
+    srs_trace("dvr finalize mp4 %s, cost=%dms", path.c_str(), srsu2msi(srs_update_monotonic_time() - starttime));
+    
+    return err;
+}
+
+string SrsDvrAsyncCallFinalizeMp4::to_string()
+{
+    return "finalize mp4 " + path;
+}
+
+bool SrsDvrAsyncCallFinalizeMp4::interruptible()
+{
+    return false;
+}
+
+srs_error_t SrsDvrAsyncCallFinalizeMp4::do_finalize(string tmp)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileReader fr;
+    if ((err = fr.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+    
+    SrsFileWriter fw;
+    if ((err = fw.open(tmp)) != srs_success) {
+        return srs_error_wrap(err, "open %s", tmp.c_str());
+    }
+    
+    SrsMp4Defragmenter defrag;
+    if ((err = defrag.initialize(&fr, &fw)) != srs_success) {
+        return srs_error_wrap(err, "init defragmenter");
+    }
+    
+    // Convert fragment by fragment, and yield to other coroutines, for a huge file.
+    for (bool done = false; !done;) {
+        if ((err = defrag.step(&done)) != srs_success) {
+            return srs_error_wrap(err, "convert fragment");
+        }
+        srs_usleep(0);
+    }
+    
+    if ((err = defrag.flush()) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+    
+    return err;
+}
+
 SrsDvrAsyncCallOnDvr::SrsDvrAsyncCallOnDvr(int c, SrsRequest* r, string p)
 {
     cid = c;
@@ -582,13 +801,52 @@ string SrsDvrAsyncCallOnDvr::to_string()
     return ss.str();
 }
 
+SrsDvrAsyncCallUpload::SrsDvrAsyncCallUpload(SrsRequest* r, string p)
+{
+    req = r->copy();
+    path = p;
+}
+
+SrsDvrAsyncCallUpload::~SrsDvrAsyncCallUpload()
+{
+    srs_freep(req);
+}
+
+srs_error_t SrsDvrAsyncCallUpload::call()
+{
+    srs_error_t err = srs_success;
+    
+    // The key is relative to the dir before the first variable of dvr_path.
+    string root = _srs_config->get_dvr_path(req->vhost);
+    size_t pos = root.find("[");
+    root = srs_path_dirname(pos == string::npos? root : root.substr(0, pos));
+    
+    // The file is uploaded after reaped, for the muxer of FLV and MP4 seeks back to update the header.
+    bool local_copy = _srs_config->get_vhost_upload_local_copy(req->vhost);
+    if ((err = _srs_uploader->put_file(req, SrsUploader::key_of(root, path), path, !local_copy)) != srs_success) {
+        return srs_error_wrap(err, "upload %s", path.c_str());
+    }
+    
+    return err;
+}
+
+string SrsDvrAsyncCallUpload::to_string()
+{
+    return "upload " + path;
+}
+
+bool SrsDvrAsyncCallUpload::interruptible()
+{
+    return false;
+}
+
 SrsDvrPlan::SrsDvrPlan()
 {
     req = NULL;
     
     dvr_enabled = false;
     segment = NULL;
-    async = new SrsAsyncCallWorker();
+    async = new SrsAsyncCallWorker("dvr");
 }
 
 SrsDvrPlan::~SrsDvrPlan()
@@ -678,10 +936,23 @@ srs_error_t SrsDvrPlan::on_reap_segment()
     SrsFragment* fragment = segment->current();
     string fullpath = fragment->fullpath();
     
+    // Convert the fMP4 to MP4 before callback, in the same worker.
+    if (dynamic_cast<SrsDvrFmp4Segmenter*>(segment) && _srs_config->get_dvr_mp4_finalize(req->vhost)) {
+        if ((err = async->execute(new SrsDvrAsyncCallFinalizeMp4(fullpath))) != srs_success) {
+            return srs_error_wrap(err, "finalize mp4");
+        }
+    }
+    
     if ((err = async->execute(new SrsDvrAsyncCallOnDvr(cid, req, fullpath))) != srs_success) {
         return srs_error_wrap(err, "reap segment");
     }
     
+    _srs_events->on_dvr(req, fullpath);
+    
+    if (_srs_uploader->dvr_enabled(req->vhost) && (err = async->execute(new SrsDvrAsyncCallUpload(req, fullpath))) != srs_success) {
+        return srs_error_wrap(err, "upload segment");
+    }
+    
     return err;
 }
 
@@ -880,7 +1151,8 @@ srs_error_t SrsDvrSegmentPlan::update_duration(SrsSharedPtrMessage* msg)
         
         char* payload = msg->payload;
         int size = msg->size;
-        bool is_key_frame = SrsFlvVideo::h264(payload, size) && SrsFlvVideo::keyframe(payload, size) && !SrsFlvVideo::sh(payload, size);
+        bool is_key_frame = (SrsFlvVideo::h264(payload, size) || SrsFlvVideo::hevc(payload, size))
+            && SrsFlvVideo::keyframe(payload, size) && !SrsFlvVideo::sh(payload, size);
         if (!is_key_frame) {
             return err;
         }
@@ -953,7 +1225,9 @@ srs_error_t SrsDvr::initialize(SrsOriginHub* h, SrsRequest* r)
     
     std::string path = _srs_config->get_dvr_path(r->vhost);
     SrsDvrSegmenter* segmenter = NULL;
-    if (srs_string_ends_with(path, ".mp4")) {
+    if (srs_string_ends_with(path, ".mp4") && _srs_config->get_dvr_mp4_fragment(r->vhost) > 0) {
+        segmenter = new SrsDvrFmp4Segmenter();
+    } else if (srs_string_ends_with(path, ".mp4")) {
         segmenter = new SrsDvrMp4Segmenter();
     } else {
         segmenter = new SrsDvrFlvSegmenter();
@@ -38,10 +38,12 @@ class SrsSharedPtrMessage;
 class SrsFileWriter;
 class SrsFlvTransmuxer;
 class SrsDvrPlan;
+class SrsPathTemplate;
 class SrsJsonAny;
 class SrsJsonObject;
 class SrsThread;
 class SrsMp4Encoder;
+class SrsMp4FragmentEncoder;
 class SrsFragment;
 class SrsFormat;
 
@@ -59,12 +61,15 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
+protected:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
     SrsRtmpJitterAlgorithm jitter_algorithm;
+    // The compiled dvr_path, to render the path of each segment.
+    SrsPathTemplate* path_template;
 public:
     SrsDvrSegmenter();
     virtual ~SrsDvrSegmenter();
@@ -101,6 +106,8 @@ protected:
 private:
     // Generate the flv segment path.
     virtual std::string generate_path();
+    // Compile the path template of dvr_path.
+    virtual void compile_path();
     // When update the duration of segment by rtmp msg.
     virtual srs_error_t on_update_duration(SrsSharedPtrMessage* msg);
 // Interface ISrsReloadHandler
@@ -155,6 +162,51 @@ protected:
     virtual srs_error_t close_encoder();
 };
 
+// The MP4 segmenter to write fragmented MP4 (moof+mdat), which only caches the samples of
+// current fragment, so the memory is constant for long recording.
+class SrsDvrFmp4Segmenter : public SrsDvrSegmenter
+{
+private:
+    // The fMP4 encoder, for fragments after the init.
+    SrsMp4FragmentEncoder* enc;
+    // The duration of fragment.
+    srs_utime_t duration;
+    // The track id of video and audio in init, 0 if no such track.
+    uint32_t vtid;
+    uint32_t atid;
+    // Whether the init(ftyp+moov) is written.
+    bool init_written;
+public:
+    SrsDvrFmp4Segmenter();
+    virtual ~SrsDvrFmp4Segmenter();
+public:
+    virtual srs_error_t refresh_metadata();
+protected:
+    virtual srs_error_t open_encoder();
+    virtual srs_error_t encode_metadata(SrsSharedPtrMessage* metadata);
+    virtual srs_error_t encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format);
+    virtual srs_error_t encode_video(SrsSharedPtrMessage* video, SrsFormat* format);
+    virtual srs_error_t close_encoder();
+private:
+    virtual srs_error_t write_sample(bool video, uint32_t dts, SrsFormat* format);
+};
+
+// The dvr async call, to convert the fMP4 to progressive MP4.
+class SrsDvrAsyncCallFinalizeMp4 : public ISrsAsyncCallTask
+{
+private:
+    std::string path;
+public:
+    SrsDvrAsyncCallFinalizeMp4(std::string p);
+    virtual ~SrsDvrAsyncCallFinalizeMp4();
+public:
+    virtual srs_error_t call();
+    virtual std::string to_string();
+    virtual bool interruptible();
+private:
+    virtual srs_error_t do_finalize(std::string tmp);
+};
+
 // the dvr async call.
 class SrsDvrAsyncCallOnDvr : public ISrsAsyncCallTask
 {
@@ -170,6 +222,21 @@ public:
     virtual std::string to_string();
 };
 
+// The async task to upload the reaped file to object storage, after the on_dvr hook.
+class SrsDvrAsyncCallUpload : public ISrsAsyncCallTask
+{
+private:
+    std::string path;
+    SrsRequest* req;
+public:
+    SrsDvrAsyncCallUpload(SrsRequest* r, std::string p);
+    virtual ~SrsDvrAsyncCallUpload();
+public:
+    virtual srs_error_t call();
+    virtual std::string to_string();
+    virtual bool interruptible();
+};
+
 // The DVR plan, when and how to reap segment.
 class SrsDvrPlan : public ISrsReloadHandler
 {
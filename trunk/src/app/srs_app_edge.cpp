@@ -27,6 +27,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <errno.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -46,6 +48,16 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_balance.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_caster_flv.hpp>
+#include <srs_app_coworkers.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_relay.hpp>
 
 // when edge timeout, retry next.
 #define SRS_EDGE_INGESTER_TIMEOUT (5 * SRS_UTIME_SECONDS)
@@ -53,114 +65,1124 @@ using namespace std;
 // when edge error, wait for quit
 #define SRS_EDGE_FORWARDER_TIMEOUT (150 * SRS_UTIME_MILLISECONDS)
 
+// The RTT of origin is large, to use the max chunk size for edge publish.
+#define SRS_EDGE_FORWARDER_LARGE_RTT (100 * SRS_UTIME_MILLISECONDS)
+
+// The max messages queued for a channel of mux session, the channel fails when overflow.
+#define SRS_EDGE_MUX_MAX_MSGS 4096
+// The first transaction id of mux session, larger than the connect and createStream of client.
+#define SRS_EDGE_MUX_TRANSACTION_ID 10
+
+// when edge timeout, retry next.
+#define SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT (3 * SRS_UTIME_SECONDS)
+// The max results of token traverse to cache, remove the expired ones when exceed.
+#define SRS_EDGE_TOKEN_CACHE_MAX 10000
+
+SrsLbServerStats* _srs_edge_origins = new SrsLbServerStats();
+
+ISrsLoadBalancer* srs_edge_create_balancer(string vhost)
+{
+    if (_srs_config->get_vhost_edge_origin_balance(vhost) == "consistent_hash") {
+        return new SrsLbConsistentHash(_srs_edge_origins);
+    }
+    return new SrsLbRoundRobin();
+}
+
 SrsEdgeUpstream::SrsEdgeUpstream()
 {
 }
 
-SrsEdgeUpstream::~SrsEdgeUpstream()
+SrsEdgeUpstream::~SrsEdgeUpstream()
+{
+}
+
+SrsEdgeRtmpUpstream::SrsEdgeRtmpUpstream(string r, bool p)
+{
+    redirect = r;
+    peer = p;
+    sdk = NULL;
+}
+
+SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
+{
+    close();
+}
+
+srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* req = r;
+    
+    SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+    
+    // @see https://github.com/ossrs/srs/issues/79
+    // when origin is error, for instance, server is shutdown,
+    // then user remove the vhost then reload, the conf is empty.
+    if (!conf) {
+        return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+    }
+    
+    // support vhost tranform for edge,
+    // @see https://github.com/ossrs/srs/issues/372
+    std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+    vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+    if (peer) {
+        vhost = req->vhost;
+    }
+    
+    srs_freep(sdk);
+    srs_utime_t cto = SRS_EDGE_INGESTER_TIMEOUT;
+    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
+    
+    std::string url;
+    
+    // override the origin info by redirect.
+    if (!redirect.empty()) {
+        int port;
+        string server, _schema, _vhost, _app, _stream, _param;
+        srs_discovery_tc_url(redirect, _schema, server, _vhost, _app, _stream, port, _param);
+        
+        selected_ip = server;
+        selected_port = port;
+        
+        url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
+        sdk = new SrsSimpleRtmpClient(url, cto, sto);
+        
+        if ((err = sdk->connect()) != srs_success) {
+            return srs_error_wrap(err, "edge pull %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
+        }
+    } else {
+        // Race the selected origin and the next ones, the selected one starts first.
+        std::string selected = lb->select(conf->args, req->get_stream_url());
+        srs_utime_t stagger = _srs_config->get_vhost_edge_origin_stagger(req->vhost);
+        
+        int index = (int)(std::find(conf->args.begin(), conf->args.end(), selected) - conf->args.begin());
+        int nn_servers = (stagger > 0)? (int)conf->args.size() : 1;
+        
+        SrsRtmpConnectRacer racer(_srs_edge_origins, stagger);
+        for (int i = 0; i < nn_servers; i++) {
+            std::string origin = conf->args.at((index + i) % conf->args.size());
+            
+            std::string server;
+            int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+            srs_parse_hostport(origin, server, port);
+            
+            url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
+            racer.add(origin, url, cto, sto);
+        }
+        
+        std::string winner;
+        srs_utime_t rtt = 0;
+        if ((err = racer.race(&sdk, winner, rtt)) != srs_success) {
+            return srs_error_wrap(err, "edge pull %s failed, cto=%dms, sto=%dms.", req->get_stream_url().c_str(), srsu2msi(cto), srsu2msi(sto));
+        }
+        lb->on_winner(winner);
+        
+        // Remember the current selected server.
+        selected_port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        srs_parse_hostport(winner, selected_ip, selected_port);
+        url = srs_generate_rtmp_url(selected_ip, selected_port, req->host, vhost, req->app, req->stream, req->param);
+    }
+    
+    if ((err = sdk->play(_srs_config->get_chunk_size(req->vhost))) != srs_success) {
+        return srs_error_wrap(err, "edge pull %s stream failed", url.c_str());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsEdgeRtmpUpstream::recv_message(SrsCommonMessage** pmsg)
+{
+    return sdk->recv_message(pmsg);
+}
+
+srs_error_t SrsEdgeRtmpUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    return sdk->decode_message(msg, ppacket);
+}
+
+void SrsEdgeRtmpUpstream::close()
+{
+    srs_freep(sdk);
+}
+
+void SrsEdgeRtmpUpstream::selected(string& server, int& port)
+{
+    server = selected_ip;
+    port = selected_port;
+}
+
+void SrsEdgeRtmpUpstream::set_recv_timeout(srs_utime_t tm)
+{
+    sdk->set_recv_timeout(tm);
+}
+
+void SrsEdgeRtmpUpstream::kbps_sample(const char* label, int64_t age)
+{
+    sdk->kbps_sample(label, age);
+}
+
+SrsEdgeHttpFlvUpstream::SrsEdgeHttpFlvUpstream()
+{
+    sdk = NULL;
+    hr = NULL;
+    reader = NULL;
+    decoder = NULL;
+    selected_port = 0;
+}
+
+SrsEdgeHttpFlvUpstream::~SrsEdgeHttpFlvUpstream()
+{
+    close();
+}
+
+srs_error_t SrsEdgeHttpFlvUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* req = r;
+    
+    SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+    if (!conf) {
+        return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+    }
+    
+    // select the origin, the HTTP server of origin.
+    std::string server = lb->select(conf->args, req->get_stream_url());
+    int port = SRS_DEFAULT_HTTP_PORT;
+    srs_parse_hostport(server, server, port);
+    
+    selected_ip = server;
+    selected_port = port;
+    
+    // The vhost of HTTP is specified by the Host header.
+    std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+    vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+    
+    std::string path = "/" + req->app + "/" + req->stream + ".flv";
+    if (!req->param.empty()) {
+        path += req->param;
+    }
+    
+    close();
+    sdk = new SrsHttpClient();
+    
+    if ((err = sdk->initialize(server, port, SRS_EDGE_INGESTER_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "init client");
+    }
+    if (vhost != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
+        sdk->set_header("Host", vhost);
+    }
+    
+    srs_utime_t starttime = srs_update_monotonic_time();
+    if ((err = sdk->get(path, "", &hr)) != srs_success) {
+        lb->on_failure();
+        return srs_error_wrap(err, "edge pull http://%s:%d%s failed", server.c_str(), port, path.c_str());
+    }
+    lb->on_success(srs_update_monotonic_time() - starttime);
+    
+    if (hr->status_code() != SRS_CONSTS_HTTP_OK) {
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "edge pull http://%s:%d%s status=%d", server.c_str(), port, path.c_str(), hr->status_code());
+    }
+    
+    reader = new SrsHttpFileReader(hr->body_reader());
+    decoder = new SrsFlvDecoder();
+    
+    if ((err = decoder->initialize(reader)) != srs_success) {
+        return srs_error_wrap(err, "init decoder");
+    }
+    
+    char header[9];
+    if ((err = decoder->read_header(header)) != srs_success) {
+        return srs_error_wrap(err, "read header");
+    }
+    
+    char pps[4];
+    if ((err = decoder->read_previous_tag_size(pps)) != srs_success) {
+        return srs_error_wrap(err, "read pts");
+    }
+    
+    srs_trace("edge pull http://%s:%d%s, host=%s", server.c_str(), port, path.c_str(), vhost.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsEdgeHttpFlvUpstream::recv_message(SrsCommonMessage** pmsg)
+{
+    srs_error_t err = srs_success;
+    
+    char type;
+    int32_t size;
+    uint32_t time;
+    if ((err = decoder->read_tag_header(&type, &size, &time)) != srs_success) {
+        return srs_error_wrap(err, "read tag header");
+    }
+    
+    char* data = new char[size];
+    if ((err = decoder->read_tag_data(data, size)) != srs_success) {
+        srs_freepa(data);
+        return srs_error_wrap(err, "read tag data");
+    }
+    
+    char pps[4];
+    if ((err = decoder->read_previous_tag_size(pps)) != srs_success) {
+        srs_freepa(data);
+        return srs_error_wrap(err, "read pts");
+    }
+    
+    // The data is owned by the message, and handed off to the shared message of source.
+    // @remark The stream id is always 1 for the stream of RTMP client.
+    SrsCommonMessage* msg = NULL;
+    if ((err = srs_rtmp_create_msg(type, time, data, size, 1, &msg)) != srs_success) {
+        return srs_error_wrap(err, "create message");
+    }
+    
+    *pmsg = msg;
+    
+    return err;
+}
+
+srs_error_t SrsEdgeHttpFlvUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    srs_error_t err = srs_success;
+    
+    // Only the onMetaData in flv, there is no RTMP command.
+    if (!msg->header.is_amf0_data() && !msg->header.is_amf3_data()) {
+        return err;
+    }
+    
+    SrsBuffer stream(msg->payload, msg->size);
+    
+    std::string command;
+    if ((err = srs_amf0_read_string(&stream, command)) != srs_success) {
+        return srs_error_wrap(err, "decode command name");
+    }
+    
+    if (command != SRS_CONSTS_RTMP_SET_DATAFRAME && command != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+    
+    stream.skip(-1 * stream.pos());
+    
+    SrsPacket* packet = new SrsOnMetaDataPacket();
+    if ((err = packet->decode(&stream)) != srs_success) {
+        srs_freep(packet);
+        return srs_error_wrap(err, "decode metadata");
+    }
+    
+    *ppacket = packet;
+    
+    return err;
+}
+
+void SrsEdgeHttpFlvUpstream::close()
+{
+    srs_freep(decoder);
+    srs_freep(reader);
+    srs_freep(hr);
+    srs_freep(sdk);
+}
+
+void SrsEdgeHttpFlvUpstream::selected(string& server, int& port)
+{
+    server = selected_ip;
+    port = selected_port;
+}
+
+void SrsEdgeHttpFlvUpstream::set_recv_timeout(srs_utime_t tm)
+{
+    sdk->set_recv_timeout(tm);
+}
+
+void SrsEdgeHttpFlvUpstream::kbps_sample(const char* label, int64_t age)
+{
+    sdk->kbps_sample(label, age);
+}
+
+SrsEdgeUdpUpstream::SrsEdgeUdpUpstream()
+{
+    sdk = NULL;
+    selected_port = 0;
+}
+
+SrsEdgeUdpUpstream::~SrsEdgeUdpUpstream()
+{
+    close();
+}
+
+srs_error_t SrsEdgeUdpUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* req = r;
+    
+    SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+    if (!conf) {
+        return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+    }
+    
+    // select the origin, the relay server of origin.
+    std::string server = lb->select(conf->args, req->get_stream_url());
+    int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    srs_parse_hostport(server, server, port);
+    
+    selected_ip = server;
+    selected_port = port;
+    
+    std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+    vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+    
+    std::string url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
+    
+    close();
+    sdk = new SrsRelayClient(server, port, url);
+    
+    srs_utime_t starttime = srs_update_monotonic_time();
+    if ((err = sdk->connect(SRS_EDGE_INGESTER_TIMEOUT)) != srs_success) {
+        lb->on_failure();
+        return srs_error_wrap(err, "edge pull udp %s failed", url.c_str());
+    }
+    lb->on_success(srs_update_monotonic_time() - starttime);
+    
+    srs_trace("edge pull udp %s", url.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsEdgeUdpUpstream::recv_message(SrsCommonMessage** pmsg)
+{
+    return sdk->recv_message(pmsg);
+}
+
+srs_error_t SrsEdgeUdpUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    srs_error_t err = srs_success;
+    
+    // Only the metadata is relayed, there is no RTMP command.
+    if (!msg->header.is_amf0_data() && !msg->header.is_amf3_data()) {
+        return err;
+    }
+    
+    SrsBuffer stream(msg->payload, msg->size);
+    
+    std::string command;
+    if ((err = srs_amf0_read_string(&stream, command)) != srs_success) {
+        return srs_error_wrap(err, "decode command name");
+    }
+    
+    if (command != SRS_CONSTS_RTMP_SET_DATAFRAME && command != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+    
+    stream.skip(-1 * stream.pos());
+    
+    SrsPacket* packet = new SrsOnMetaDataPacket();
+    if ((err = packet->decode(&stream)) != srs_success) {
+        srs_freep(packet);
+        return srs_error_wrap(err, "decode metadata");
+    }
+    
+    *ppacket = packet;
+    
+    return err;
+}
+
+void SrsEdgeUdpUpstream::close()
+{
+    srs_freep(sdk);
+}
+
+void SrsEdgeUdpUpstream::selected(string& server, int& port)
+{
+    server = selected_ip;
+    port = selected_port;
+}
+
+void SrsEdgeUdpUpstream::set_recv_timeout(srs_utime_t tm)
+{
+    sdk->set_recv_timeout(tm);
+}
+
+void SrsEdgeUdpUpstream::kbps_sample(const char* label, int64_t age)
+{
+    sdk->kbps_sample(label, age);
+}
+
+SrsEdgeMuxUpstream::SrsEdgeMuxUpstream()
+{
+    req = NULL;
+    session = NULL;
+    stream_id = 0;
+    wait = srs_cond_new();
+    timeout = SRS_EDGE_INGESTER_TIMEOUT;
+    error_code = ERROR_SUCCESS;
+    selected_port = 0;
+}
+
+SrsEdgeMuxUpstream::~SrsEdgeMuxUpstream()
+{
+    close();
+    srs_cond_destroy(wait);
+}
+
+srs_error_t SrsEdgeMuxUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
+{
+    srs_error_t err = srs_success;
+    
+    req = r;
+    
+    SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+    if (!conf) {
+        return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+    }
+    
+    std::string server = lb->select(conf->args, req->get_stream_url());
+    int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    srs_parse_hostport(server, server, port);
+    
+    selected_ip = server;
+    selected_port = port;
+    
+    std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
+    vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+    
+    // The streams are spread over the connections of the same origin, vhost and app.
+    std::string stream_url = req->get_stream_url();
+    int nn_connections = _srs_config->get_vhost_edge_mux_connections(req->vhost);
+    uint32_t index = srs_crc32_ieee(stream_url.data(), (int)stream_url.length()) % nn_connections;
+    
+    std::string key = server + ":" + srs_int2str(port) + "/" + vhost + "/" + req->app + "#" + srs_int2str(index);
+    std::string url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, "mux", "");
+    
+    close();
+    error_code = ERROR_SUCCESS;
+    session = _srs_edge_mux->fetch(key, url);
+    
+    // Only the failure of connection is feedback to balancer, not the failure of stream.
+    std::string stream = srs_generate_stream_with_query(req->host, vhost, req->stream, req->param);
+    srs_utime_t starttime = srs_update_monotonic_time();
+    if ((err = session->open(this, stream, SRS_EDGE_INGESTER_TIMEOUT)) != srs_success) {
+        if (session->is_failed()) {
+            lb->on_failure();
+        }
+        return srs_error_wrap(err, "edge mux pull %s, stream=%s", key.c_str(), stream.c_str());
+    }
+    lb->on_success(srs_update_monotonic_time() - starttime);
+    
+    srs_trace("edge mux pull %s, stream=%s, stream_id=%d, channels=%d", key.c_str(), stream.c_str(), stream_id, session->nn_channels());
+    
+    return err;
+}
+
+srs_error_t SrsEdgeMuxUpstream::recv_message(SrsCommonMessage** pmsg)
+{
+    if (msgs.empty() && error_code == ERROR_SUCCESS) {
+        // The ingester is stopped, for example, no players.
+        if (srs_cond_timedwait(wait, timeout) != 0 && errno == EINTR) {
+            return srs_error_new(ERROR_SOCKET_READ, "mux channel stream_id=%d interrupted", stream_id);
+        }
+    }
+    
+    // Consume the messages before the error.
+    if (!msgs.empty()) {
+        *pmsg = msgs.front();
+        msgs.pop_front();
+        return srs_success;
+    }
+    
+    if (error_code != ERROR_SUCCESS) {
+        return srs_error_new(error_code, "mux channel stream_id=%d", stream_id);
+    }
+    return srs_error_new(ERROR_SOCKET_TIMEOUT, "mux channel stream_id=%d timeout %dms", stream_id, srsu2msi(timeout));
+}
+
+srs_error_t SrsEdgeMuxUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = session->decode_message(msg, ppacket)) != srs_success) {
+        return srs_error_wrap(err, "decode message");
+    }
+    
+    // The origin responses error for the stream, without closing the session, except the RTMP 302 redirect.
+    SrsCallPacket* call = dynamic_cast<SrsCallPacket*>(*ppacket);
+    if (!call || !call->arguments || !call->arguments->is_object()) {
+        return err;
+    }
+    
+    SrsAmf0Object* evt = call->arguments->to_object();
+    SrsAmf0Any* prop = evt->ensure_property_string(StatusLevel);
+    if (!prop || prop->to_str() != StatusLevelError || evt->get_property("ex")) {
+        return err;
+    }
+    
+    prop = evt->ensure_property_string(StatusDescription);
+    std::string desc = prop? prop->to_str() : "";
+    srs_freep(*ppacket);
+    
+    return srs_error_new(ERROR_RTMP_EDGE_MUX, "mux play stream_id=%d failed, %s", stream_id, desc.c_str());
+}
+
+void SrsEdgeMuxUpstream::close()
+{
+    if (session) {
+        session->close(this);
+        session = NULL;
+    }
+    stream_id = 0;
+    
+    std::deque<SrsCommonMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsCommonMessage* msg = *it;
+        srs_freep(msg);
+    }
+    msgs.clear();
+}
+
+void SrsEdgeMuxUpstream::selected(string& server, int& port)
+{
+    server = selected_ip;
+    port = selected_port;
+}
+
+void SrsEdgeMuxUpstream::set_recv_timeout(srs_utime_t tm)
+{
+    timeout = tm;
+}
+
+void SrsEdgeMuxUpstream::kbps_sample(const char* label, int64_t age)
+{
+    if (session) {
+        session->kbps_sample(label, age);
+    }
+}
+
+int SrsEdgeMuxUpstream::wait_stream(srs_utime_t tm)
+{
+    if (stream_id == 0 && error_code == ERROR_SUCCESS) {
+        srs_cond_timedwait(wait, tm);
+    }
+    return stream_id;
+}
+
+void SrsEdgeMuxUpstream::on_stream(int sid)
+{
+    stream_id = sid;
+    srs_cond_signal(wait);
+}
+
+void SrsEdgeMuxUpstream::on_message(SrsCommonMessage* msg)
+{
+    // The channel is too slow to consume, for example, blocked by the source.
+    if (msgs.size() >= SRS_EDGE_MUX_MAX_MSGS) {
+        srs_freep(msg);
+        on_error(ERROR_RTMP_EDGE_MUX);
+        return;
+    }
+    
+    msgs.push_back(msg);
+    srs_cond_signal(wait);
+}
+
+void SrsEdgeMuxUpstream::on_error(int code)
+{
+    if (error_code == ERROR_SUCCESS) {
+        error_code = code;
+    }
+    srs_cond_signal(wait);
+}
+
+SrsEdgeMuxSession::SrsEdgeMuxSession(string k, string url)
+{
+    key = k;
+    sdk = new SrsMuxRtmpClient(url, SRS_EDGE_INGESTER_TIMEOUT, SRS_CONSTS_RTMP_PULSE);
+    trd = new SrsDummyCoroutine();
+    
+    connecting = false;
+    connected = false;
+    failed = false;
+    ready = srs_cond_new();
+    error_code = ERROR_SUCCESS;
+    transaction_id = SRS_EDGE_MUX_TRANSACTION_ID;
+}
+
+SrsEdgeMuxSession::~SrsEdgeMuxSession()
+{
+    trd->stop();
+    srs_freep(trd);
+    srs_freep(sdk);
+    srs_cond_destroy(ready);
+}
+
+string SrsEdgeMuxSession::get_key()
+{
+    return key;
+}
+
+bool SrsEdgeMuxSession::is_failed()
+{
+    return failed;
+}
+
+int SrsEdgeMuxSession::nn_channels()
+{
+    return (int)channels.size();
+}
+
+srs_error_t SrsEdgeMuxSession::open(SrsEdgeMuxUpstream* channel, string stream, srs_utime_t tm)
+{
+    srs_error_t err = srs_success;
+    
+    // The channel keeps the session alive, until it's closed.
+    channels.push_back(channel);
+    
+    if (!connected && !failed) {
+        if (connecting) {
+            srs_cond_timedwait(ready, tm);
+        } else {
+            connecting = true;
+            if ((err = connect()) != srs_success) {
+                fail(srs_error_code(err));
+            }
+            connecting = false;
+            srs_cond_broadcast(ready);
+            
+            if (err != srs_success) {
+                return srs_error_wrap(err, "connect");
+            }
+            connected = true;
+        }
+    }
+    
+    if (failed) {
+        return srs_error_new(error_code, "session failed");
+    }
+    if (!connected) {
+        return srs_error_new(ERROR_SOCKET_TIMEOUT, "connect timeout %dms", srsu2msi(tm));
+    }
+    
+    int tid = transaction_id++;
+    pendings[tid] = channel;
+    
+    SrsCreateStreamPacket* create = new SrsCreateStreamPacket();
+    create->transaction_id = tid;
+    if ((err = sdk->send_and_free_packet(create, 0)) != srs_success) {
+        pendings.erase(tid);
+        fail(srs_error_code(err));
+        return srs_error_wrap(err, "send create stream");
+    }
+    
+    int sid = channel->wait_stream(tm);
+    pendings.erase(tid);
+    
+    if (failed) {
+        return srs_error_new(error_code, "session failed");
+    }
+    if (sid <= 0) {
+        return srs_error_new(ERROR_SOCKET_TIMEOUT, "create stream timeout %dms", srsu2msi(tm));
+    }
+    streams[sid] = channel;
+    
+    SrsPlayPacket* play = new SrsPlayPacket();
+    play->stream_name = stream;
+    if ((err = sdk->send_and_free_packet(play, sid)) != srs_success) {
+        fail(srs_error_code(err));
+        return srs_error_wrap(err, "send play stream_id=%d", sid);
+    }
+    
+    return err;
+}
+
+void SrsEdgeMuxSession::close(SrsEdgeMuxUpstream* channel)
+{
+    srs_error_t err = srs_success;
+    
+    int sid = 0;
+    std::map<int, SrsEdgeMuxUpstream*>::iterator it;
+    for (it = streams.begin(); it != streams.end(); ++it) {
+        if (it->second == channel) {
+            sid = it->first;
+            streams.erase(it);
+            break;
+        }
+    }
+    
+    for (it = pendings.begin(); it != pendings.end(); ++it) {
+        if (it->second == channel) {
+            pendings.erase(it);
+            break;
+        }
+    }
+    
+    // Close the stream before removing the channel, which keeps the session alive when sending.
+    if (sid > 0 && connected && !failed) {
+        SrsCloseStreamPacket* pkt = new SrsCloseStreamPacket();
+        if ((err = sdk->send_and_free_packet(pkt, sid)) != srs_success) {
+            fail(srs_error_code(err));
+            srs_warn("mux close stream_id=%d, %s", sid, srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    std::vector<SrsEdgeMuxUpstream*>::iterator found = std::find(channels.begin(), channels.end(), channel);
+    if (found != channels.end()) {
+        channels.erase(found);
+    }
+    
+    if (channels.empty()) {
+        _srs_edge_mux->release(this);
+    }
+}
+
+srs_error_t SrsEdgeMuxSession::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    return sdk->decode_message(msg, ppacket);
+}
+
+void SrsEdgeMuxSession::kbps_sample(const char* label, int64_t age)
+{
+    sdk->kbps_sample(label, age);
+}
+
+srs_error_t SrsEdgeMuxSession::connect()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = sdk->connect()) != srs_success) {
+        return srs_error_wrap(err, "edge mux connect %s", key.c_str());
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("edge-mux", this);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    srs_trace("edge mux connected %s", key.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsEdgeMuxSession::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    sdk->set_recv_timeout(SRS_CONSTS_RTMP_PULSE);
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "edge mux pull");
+        }
+        
+        SrsCommonMessage* msg = NULL;
+        if ((err = sdk->recv_message(&msg)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                srs_error_reset(err);
+                continue;
+            }
+            
+            fail(srs_error_code(err));
+            return srs_error_wrap(err, "recv message");
+        }
+        
+        if ((err = dispatch(msg)) != srs_success) {
+            fail(srs_error_code(err));
+            return srs_error_wrap(err, "dispatch message");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsEdgeMuxSession::dispatch(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // The message of stream is owned by the channel.
+    std::map<int, SrsEdgeMuxUpstream*>::iterator it = streams.find(msg->header.stream_id);
+    if (it != streams.end()) {
+        it->second->on_message(msg);
+        return err;
+    }
+    
+    // Ignore the messages of closed streams, and the control messages processed by protocol.
+    SrsAutoFree(SrsCommonMessage, msg);
+    if (!msg->header.is_amf0_command() && !msg->header.is_amf3_command()) {
+        return err;
+    }
+    
+    SrsPacket* pkt = NULL;
+    if ((err = sdk->decode_message(msg, &pkt)) != srs_success) {
+        return srs_error_wrap(err, "decode message");
+    }
+    SrsAutoFree(SrsPacket, pkt);
+    
+    SrsCreateStreamResPacket* res = dynamic_cast<SrsCreateStreamResPacket*>(pkt);
+    if (res) {
+        it = pendings.find((int)res->transaction_id);
+        if (it != pendings.end()) {
+            it->second->on_stream((int)res->stream_id);
+        }
+    }
+    
+    return err;
+}
+
+void SrsEdgeMuxSession::fail(int code)
+{
+    failed = true;
+    if (error_code == ERROR_SUCCESS) {
+        error_code = code;
+    }
+    
+    std::vector<SrsEdgeMuxUpstream*>::iterator it;
+    for (it = channels.begin(); it != channels.end(); ++it) {
+        SrsEdgeMuxUpstream* channel = *it;
+        channel->on_error(error_code);
+    }
+}
+
+SrsEdgeMuxSessions* _srs_edge_mux = new SrsEdgeMuxSessions();
+
+SrsEdgeMuxSessions::SrsEdgeMuxSessions()
+{
+}
+
+SrsEdgeMuxSessions::~SrsEdgeMuxSessions()
 {
+    std::map<std::string, SrsEdgeMuxSession*>::iterator it;
+    for (it = sessions.begin(); it != sessions.end(); ++it) {
+        SrsEdgeMuxSession* session = it->second;
+        srs_freep(session);
+    }
+    sessions.clear();
 }
 
-SrsEdgeRtmpUpstream::SrsEdgeRtmpUpstream(string r)
+SrsEdgeMuxSession* SrsEdgeMuxSessions::fetch(string key, string url)
 {
-    redirect = r;
-    sdk = NULL;
+    std::map<std::string, SrsEdgeMuxSession*>::iterator it = sessions.find(key);
+    if (it != sessions.end() && !it->second->is_failed()) {
+        return it->second;
+    }
+    
+    // The failed session is released by its channels, when they're closed.
+    SrsEdgeMuxSession* session = new SrsEdgeMuxSession(key, url);
+    sessions[key] = session;
+    
+    return session;
 }
 
-SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
+void SrsEdgeMuxSessions::release(SrsEdgeMuxSession* session)
 {
-    close();
+    std::map<std::string, SrsEdgeMuxSession*>::iterator it = sessions.find(session->get_key());
+    if (it != sessions.end() && it->second == session) {
+        sessions.erase(it);
+    }
+    
+    srs_trace("edge mux release %s, sessions=%d", session->get_key().c_str(), (int)sessions.size());
+    srs_freep(session);
 }
 
-srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
+SrsEdgeTokenCache* _srs_edge_tokens = new SrsEdgeTokenCache();
+
+SrsEdgeTokenCache::SrsEdgeTokenCache()
+{
+    nn_hits = nn_coalesced = nn_misses = nn_failures = 0;
+}
+
+SrsEdgeTokenCache::~SrsEdgeTokenCache()
+{
+    std::map<std::string, SrsEdgeTokenResult*>::iterator it;
+    for (it = results.begin(); it != results.end(); ++it) {
+        SrsEdgeTokenResult* r = it->second;
+        srs_cond_destroy(r->cond);
+        srs_freep(r);
+    }
+    results.clear();
+}
+
+srs_error_t SrsEdgeTokenCache::verify(SrsRequest* req, srs_utime_t ttl)
 {
     srs_error_t err = srs_success;
     
-    SrsRequest* req = r;
+    string key = key_of(req);
     
-    std::string url;
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
+    SrsEdgeTokenResult* r = NULL;
+    std::map<std::string, SrsEdgeTokenResult*>::iterator it = results.find(key);
+    if (it != results.end()) {
+        r = it->second;
+    }
+    
+    // Wait for the in-flight verify of the same key, and share its result.
+    if (r && r->pending) {
+        nn_coalesced++;
         
-        // @see https://github.com/ossrs/srs/issues/79
-        // when origin is error, for instance, server is shutdown,
-        // then user remove the vhost then reload, the conf is empty.
-        if (!conf) {
-            return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
+        r->nn_waiters++;
+        while (r->pending) {
+            if (srs_cond_wait(r->cond) != 0) {
+                r->nn_waiters--;
+                return srs_error_new(ERROR_EDGE_TOKEN_TRAVERSE, "edge token interrupted, key=%s", key.c_str());
+            }
         }
+        r->nn_waiters--;
         
-        // select the origin.
-        std::string server = lb->select(conf->args);
-        int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
-        srs_parse_hostport(server, server, port);
-        
-        // override the origin info by redirect.
-        if (!redirect.empty()) {
-            int _port;
-            string _schema, _vhost, _app, _stream, _param, _host;
-            srs_discovery_tc_url(redirect, _schema, _host, _vhost, _app, _stream, _port, _param);
-            
-            server = _host;
-            port = _port;
+        if (r->code != ERROR_SUCCESS) {
+            return srs_error_new(r->code, "edge token coalesced, key=%s", key.c_str());
         }
-
-        // Remember the current selected server.
-        selected_ip = server;
-        selected_port = port;
+        return err;
+    }
+    
+    // Use the cached result.
+    if (r && r->expire > srs_get_monotonic_time()) {
+        nn_hits++;
         
-        // support vhost tranform for edge,
-        // @see https://github.com/ossrs/srs/issues/372
-        std::string vhost = _srs_config->get_vhost_edge_transform_vhost(req->vhost);
-        vhost = srs_string_replace(vhost, "[vhost]", req->vhost);
+        if (r->code != ERROR_SUCCESS) {
+            return srs_error_new(r->code, "edge token cached, key=%s", key.c_str());
+        }
+        srs_trace("edge token cached ok, tcUrl=%s", req->tcUrl.c_str());
+        return err;
+    }
+    
+    if (!r) {
+        shrink();
         
-        url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
+        r = new SrsEdgeTokenResult();
+        r->nn_waiters = 0;
+        r->cond = srs_cond_new();
+        results[key] = r;
     }
+    nn_misses++;
     
-    srs_freep(sdk);
-    srs_utime_t cto = SRS_EDGE_INGESTER_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(url, cto, sto);
+    // Verify by origin, the clients of same key will wait for it.
+    bool reached = false;
+    r->pending = true;
+    err = do_verify(req, reached);
+    r->pending = false;
     
-    if ((err = sdk->connect()) != srs_success) {
-        return srs_error_wrap(err, "edge pull %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
+    r->code = srs_error_code(err);
+    r->expire = (reached && ttl > 0)? srs_get_monotonic_time() + ttl : 0;
+    srs_cond_broadcast(r->cond);
     
-    if ((err = sdk->play(_srs_config->get_chunk_size(req->vhost))) != srs_success) {
-        return srs_error_wrap(err, "edge pull %s stream failed", url.c_str());
+    if (err != srs_success) {
+        nn_failures++;
     }
     
     return err;
 }
 
-srs_error_t SrsEdgeRtmpUpstream::recv_message(SrsCommonMessage** pmsg)
+string SrsEdgeTokenCache::key_of(SrsRequest* req)
 {
-    return sdk->recv_message(pmsg);
+    // The param is in the format of ?k0=v0&k1=v1
+    string param = req->param;
+    if (!param.empty() && param.at(0) == '?') {
+        param = param.substr(1);
+    }
+    
+    // Never share the result between clients, or the params such as the ip-bound token are bypassed.
+    return req->ip + "|" + req->vhost + "|" + req->app + "|" + param;
 }
 
-srs_error_t SrsEdgeRtmpUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+int64_t SrsEdgeTokenCache::hits()
 {
-    return sdk->decode_message(msg, ppacket);
+    return nn_hits;
 }
 
-void SrsEdgeRtmpUpstream::close()
+int64_t SrsEdgeTokenCache::coalesced()
 {
-    srs_freep(sdk);
+    return nn_coalesced;
 }
 
-void SrsEdgeRtmpUpstream::selected(string& server, int& port)
+int64_t SrsEdgeTokenCache::misses()
 {
-    server = selected_ip;
-    port = selected_port;
+    return nn_misses;
 }
 
-void SrsEdgeRtmpUpstream::set_recv_timeout(srs_utime_t tm)
+int64_t SrsEdgeTokenCache::failures()
 {
-    sdk->set_recv_timeout(tm);
+    return nn_failures;
 }
 
-void SrsEdgeRtmpUpstream::kbps_sample(const char* label, int64_t age)
+srs_error_t SrsEdgeTokenCache::do_verify(SrsRequest* req, bool& reached)
 {
-    sdk->kbps_sample(label, age);
+    vector<string> args = _srs_config->get_vhost_edge_origin(req->vhost)->args;
+    if (args.empty()) {
+        reached = true;
+        return srs_success;
+    }
+    
+    for (int i = 0; i < (int)args.size(); i++) {
+        string hostport = args.at(i);
+        
+        // select the origin.
+        string server;
+        int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        srs_parse_hostport(hostport, server, port);
+        
+        SrsTcpClient* transport = new SrsTcpClient(server, port, SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT);
+        SrsAutoFree(SrsTcpClient, transport);
+        
+        srs_error_t err = srs_success;
+        if ((err = transport->connect()) != srs_success) {
+            srs_warn("Illegal edge token, tcUrl=%s, %s", req->tcUrl.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            continue;
+        }
+        
+        reached = true;
+        
+        SrsRtmpClient* client = new SrsRtmpClient(transport);
+        SrsAutoFree(SrsRtmpClient, client);
+        return verify_by(client, req);
+    }
+    
+    return srs_error_new(ERROR_EDGE_PORT_INVALID, "rtmp: Illegal edge token, server=%d", (int)args.size());
+}
+
+srs_error_t SrsEdgeTokenCache::verify_by(SrsRtmpClient* client, SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+    
+    client->set_recv_timeout(SRS_CONSTS_RTMP_TIMEOUT);
+    client->set_send_timeout(SRS_CONSTS_RTMP_TIMEOUT);
+    
+    if ((err = client->handshake()) != srs_success) {
+        return srs_error_wrap(err, "rtmp: handshake");
+    }
+    
+    // for token tranverse, always take the debug info(which carries token).
+    SrsServerInfo si;
+    if ((err = client->connect_app(req->app, req->tcUrl, req, true, &si)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: connect tcUrl");
+    }
+    
+    srs_trace("edge token auth ok, tcUrl=%s", req->tcUrl.c_str());
+    return err;
+}
+
+void SrsEdgeTokenCache::shrink()
+{
+    if ((int)results.size() < SRS_EDGE_TOKEN_CACHE_MAX) {
+        return;
+    }
+    
+    srs_utime_t now = srs_get_monotonic_time();
+    
+    std::map<std::string, SrsEdgeTokenResult*>::iterator it;
+    for (it = results.begin(); it != results.end();) {
+        SrsEdgeTokenResult* r = it->second;
+        
+        // The result is in use.
+        if (r->pending || r->nn_waiters > 0 || r->expire > now) {
+            ++it;
+            continue;
+        }
+        
+        srs_cond_destroy(r->cond);
+        srs_freep(r);
+        results.erase(it++);
+    }
 }
 
 SrsEdgeIngester::SrsEdgeIngester()
@@ -172,6 +1194,7 @@ SrsEdgeIngester::SrsEdgeIngester()
     upstream = new SrsEdgeRtmpUpstream("");
     lb = new SrsLbRoundRobin();
     trd = new SrsDummyCoroutine();
+    start_time = 0;
 }
 
 SrsEdgeIngester::~SrsEdgeIngester()
@@ -189,6 +1212,9 @@ srs_error_t SrsEdgeIngester::initialize(SrsSource* s, SrsPlayEdge* e, SrsRequest
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    lb = srs_edge_create_balancer(req->vhost);
+    
     return srs_success;
 }
 
@@ -200,8 +1226,12 @@ srs_error_t SrsEdgeIngester::start()
         return srs_error_wrap(err, "notify source");
     }
     
+    start_time = srs_get_monotonic_time();
+    
     srs_freep(trd);
-    trd = new SrsSTCoroutine("edge-igs", this);
+    SrsSTCoroutine* st = new SrsSTCoroutine("edge-igs", this);
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
     
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "coroutine");
@@ -214,6 +1244,7 @@ void SrsEdgeIngester::stop()
 {
     trd->stop();
     upstream->close();
+    lb->on_close();
     
     // notice to unpublish.
     if (source) {
@@ -239,12 +1270,12 @@ srs_error_t SrsEdgeIngester::cycle()
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "edge ingester");
         }
-
+        
         if ((err = do_cycle()) != srs_success) {
             srs_warn("EdgeIngester: Ignore error, %s", srs_error_desc(err).c_str());
             srs_freep(err);
         }
-
+        
         srs_usleep(SRS_EDGE_INGESTER_CIMS);
     }
     
@@ -254,15 +1285,31 @@ srs_error_t SrsEdgeIngester::cycle()
 srs_error_t SrsEdgeIngester::do_cycle()
 {
     srs_error_t err = srs_success;
-
+    
     std::string redirect;
     while (true) {
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "do cycle pull");
         }
         
+        // Prefer the edge peer which already pulls the stream, except for RTMP 302.
+        std::string peer;
+        if (redirect.empty()) {
+            discover_peer(peer);
+        }
+        
         srs_freep(upstream);
-        upstream = new SrsEdgeRtmpUpstream(redirect);
+        if (!peer.empty()) {
+            upstream = new SrsEdgeRtmpUpstream(peer, true);
+        } else if (_srs_config->get_vhost_edge_protocol(req->vhost) == "flv") {
+            upstream = new SrsEdgeHttpFlvUpstream();
+        } else if (_srs_config->get_vhost_edge_protocol(req->vhost) == "mux") {
+            upstream = new SrsEdgeMuxUpstream();
+        } else if (_srs_config->get_vhost_edge_protocol(req->vhost) == "udp") {
+            upstream = new SrsEdgeUdpUpstream();
+        } else {
+            upstream = new SrsEdgeRtmpUpstream(redirect);
+        }
         
         if ((err = source->on_source_id_changed(_srs_context->get_id())) != srs_success) {
             return srs_error_wrap(err, "on source id changed");
@@ -275,21 +1322,32 @@ srs_error_t SrsEdgeIngester::do_cycle()
         if ((err = edge->on_ingest_play()) != srs_success) {
             return srs_error_wrap(err, "notify edge play");
         }
-
+        
         // set to larger timeout to read av data from origin.
         upstream->set_recv_timeout(SRS_EDGE_INGESTER_TIMEOUT);
         
+        // Serve the edge peers, only when pulling from origin.
+        SrsCoWorkers* coworkers = SrsCoWorkers::instance();
+        if (peer.empty()) {
+            coworkers->on_origin_pull(req);
+        }
+        
         err = ingest(redirect);
+        lb->on_close();
+        
+        if (peer.empty()) {
+            coworkers->on_origin_unpull(req);
+        }
         
         // retry for rtmp 302 immediately.
         if (srs_error_code(err) == ERROR_CONTROL_REDIRECT) {
             int port;
             string server;
             upstream->selected(server, port);
-
+            
             string url = req->get_stream_url();
             srs_warn("RTMP redirect %s from %s:%d to %s", url.c_str(), server.c_str(), port, redirect.c_str());
-
+            
             srs_error_reset(err);
             continue;
         }
@@ -304,13 +1362,42 @@ srs_error_t SrsEdgeIngester::do_cycle()
     return err;
 }
 
+void SrsEdgeIngester::discover_peer(string& url)
+{
+    srs_error_t err = srs_success;
+    
+    vector<string> peers = _srs_config->get_vhost_edge_peers(req->vhost);
+    for (int i = 0; i < (int)peers.size(); i++) {
+        string peer = peers.at(i);
+        
+        string api = "http://" + peer + "/api/v1/clusters?"
+            + "vhost=" + req->vhost + "&ip=" + req->host + "&app=" + req->app + "&stream=" + req->stream
+            + "&coworker=" + peer + "&peer=1";
+        
+        string host; int port = 0;
+        if ((err = SrsHttpHooks::discover_co_workers(api, host, port)) != srs_success) {
+            srs_error_reset(err);
+            continue;
+        }
+        
+        // Ignore if host or port is invalid.
+        if (host.empty() || port == 0) {
+            continue;
+        }
+        
+        url = "rtmp://" + host + ":" + srs_int2str(port) + "/" + req->app;
+        srs_trace("edge pull from peer %s, api=%s, url=%s", peer.c_str(), api.c_str(), url.c_str());
+        return;
+    }
+}
+
 srs_error_t SrsEdgeIngester::ingest(string& redirect)
 {
     srs_error_t err = srs_success;
     
     SrsPithyPrint* pprint = SrsPithyPrint::create_edge();
     SrsAutoFree(SrsPithyPrint, pprint);
-
+    
     // we only use the redict once.
     // reset the redirect to empty, for maybe the origin changed.
     redirect = "";
@@ -357,6 +1444,14 @@ srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, stri
     
     // process video packet
     if (msg->header.is_video()) {
+        // Stat the time to first frame from origin.
+        if (start_time > 0 && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            srs_utime_t elapsed = srs_get_monotonic_time() - start_time;
+            SrsStatistic::instance()->on_edge_ttff(req, elapsed);
+            srs_trace("edge ttff=%dms, url=%s", srsu2msi(elapsed), req->get_stream_url().c_str());
+            start_time = 0;
+        }
+        
         if ((err = source->on_video(msg)) != srs_success) {
             return srs_error_wrap(err, "source consume video");
         }
@@ -417,7 +1512,7 @@ srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, stri
                 return err;
             }
             SrsAmf0Object* ex = prop->to_object();
-
+            
             // The redirect is tcUrl while redirect2 is RTMP URL.
             // https://github.com/ossrs/srs/issues/1575#issuecomment-574999798
             if ((prop = ex->ensure_property_string("redirect2")) == NULL) {
@@ -435,11 +1530,115 @@ srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, stri
     return err;
 }
 
+SrsEdgeForwarderReceiver::SrsEdgeForwarderReceiver(SrsSimpleRtmpClient* s, srs_cond_t c)
+{
+    sdk = s;
+    signal = c;
+    sequence = 0;
+    acked = false;
+    error_code = ERROR_SUCCESS;
+    trd = new SrsDummyCoroutine();
+}
+
+SrsEdgeForwarderReceiver::~SrsEdgeForwarderReceiver()
+{
+    stop();
+    srs_freep(trd);
+}
+
+srs_error_t SrsEdgeForwarderReceiver::start()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("edge-fwr-recv", this, _srs_context->get_id());
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    return err;
+}
+
+void SrsEdgeForwarderReceiver::stop()
+{
+    trd->stop();
+}
+
+bool SrsEdgeForwarderReceiver::has_ack()
+{
+    return acked;
+}
+
+int64_t SrsEdgeForwarderReceiver::inflight()
+{
+    // The sequence number wraps at 4GB, so does the diff in uint32.
+    uint32_t sent = (uint32_t)sdk->get_send_bytes();
+    return (int64_t)(uint32_t)(sent - sequence);
+}
+
+int SrsEdgeForwarderReceiver::error()
+{
+    return error_code;
+}
+
+srs_error_t SrsEdgeForwarderReceiver::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    sdk->set_recv_timeout(SRS_CONSTS_RTMP_PULSE);
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "edge forward recv pull");
+        }
+        
+        SrsCommonMessage* msg = NULL;
+        if ((err = sdk->recv_message(&msg)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                srs_error_reset(err);
+                continue;
+            }
+            
+            // Notify the forwarder, which should never write to the fd.
+            error_code = srs_error_code(err);
+            srs_cond_signal(signal);
+            return srs_error_wrap(err, "recv message");
+        }
+        SrsAutoFree(SrsCommonMessage, msg);
+        
+        // Ignore the other control messages, which are processed by protocol.
+        if (!msg->header.is_ackledgement()) {
+            continue;
+        }
+        
+        SrsPacket* pkt = NULL;
+        if ((err = sdk->decode_message(msg, &pkt)) != srs_success) {
+            error_code = srs_error_code(err);
+            srs_cond_signal(signal);
+            return srs_error_wrap(err, "decode message");
+        }
+        SrsAutoFree(SrsPacket, pkt);
+        
+        SrsAcknowledgementPacket* ack = dynamic_cast<SrsAcknowledgementPacket*>(pkt);
+        if (ack) {
+            sequence = ack->sequence_number;
+            acked = true;
+            srs_cond_signal(signal);
+        }
+    }
+    
+    return err;
+}
+
 SrsEdgeForwarder::SrsEdgeForwarder()
 {
     edge = NULL;
     req = NULL;
     send_error_code = ERROR_SUCCESS;
+    receiver = NULL;
+    wait = srs_cond_new();
+    inflight_budget = 0;
     
     sdk = NULL;
     lb = new SrsLbRoundRobin();
@@ -454,6 +1653,7 @@ SrsEdgeForwarder::~SrsEdgeForwarder()
     srs_freep(lb);
     srs_freep(trd);
     srs_freep(queue);
+    srs_cond_destroy(wait);
 }
 
 void SrsEdgeForwarder::set_queue_size(srs_utime_t queue_size)
@@ -467,6 +1667,9 @@ srs_error_t SrsEdgeForwarder::initialize(SrsSource* s, SrsPublishEdge* e, SrsReq
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    lb = srs_edge_create_balancer(req->vhost);
+    
     return srs_success;
 }
 
@@ -483,7 +1686,7 @@ srs_error_t SrsEdgeForwarder::start()
         srs_assert(conf);
         
         // select the origin.
-        std::string server = lb->select(conf->args);
+        std::string server = lb->select(conf->args, req->get_stream_url());
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
         srs_parse_hostport(server, server, port);
         
@@ -496,26 +1699,56 @@ srs_error_t SrsEdgeForwarder::start()
     }
     
     // open socket.
+    srs_freep(receiver);
     srs_freep(sdk);
     srs_utime_t cto = SRS_EDGE_FORWARDER_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    srs_utime_t starttime = srs_update_monotonic_time();
     if ((err = sdk->connect()) != srs_success) {
+        lb->on_failure();
         return srs_error_wrap(err, "sdk connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
+    srs_utime_t elapsed = srs_update_monotonic_time() - starttime;
+    lb->on_success(elapsed);
+    
+    // For origin of large RTT, use the max chunk size to decrease the chunk headers and writes.
+    // @remark The connect takes about 3 RTTs, for the tcp connect, handshake and connect app.
+    int chunk_size = _srs_config->get_chunk_size(req->vhost);
+    if (_srs_config->get_vhost_edge_publish_rtt_chunk(req->vhost) && elapsed >= SRS_EDGE_FORWARDER_LARGE_RTT * 3) {
+        chunk_size = SRS_CONSTS_RTMP_MAX_CHUNK_SIZE;
+    }
     
-    if ((err = sdk->publish(_srs_config->get_chunk_size(req->vhost))) != srs_success) {
+    if ((err = sdk->publish(chunk_size)) != srs_success) {
         return srs_error_wrap(err, "sdk publish");
     }
     
+    // Request origin to ack in a large window, and limit the bytes in flight by acks.
+    int window = _srs_config->get_vhost_edge_publish_window(req->vhost);
+    if (window > 0 && (err = sdk->set_window_ack_size(window)) != srs_success) {
+        return srs_error_wrap(err, "set window ack size");
+    }
+    inflight_budget = _srs_config->get_vhost_edge_publish_inflight(req->vhost);
+    if (window <= 0 || inflight_budget <= 0) {
+        inflight_budget = 0;
+    } else {
+        inflight_budget = srs_max(inflight_budget, 2 * (int64_t)window);
+    }
+    
+    receiver = new SrsEdgeForwarderReceiver(sdk, wait);
+    if ((err = receiver->start()) != srs_success) {
+        return srs_error_wrap(err, "receiver");
+    }
+    
     srs_freep(trd);
     trd = new SrsSTCoroutine("edge-fwr", this, _srs_context->get_id());
     
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "coroutine");
     }
-    srs_trace("edge-fwr publish url %s", url.c_str());
+    srs_trace("edge-fwr publish url %s, rtt=%dms, chunk=%d, window=%d, inflight=%d", url.c_str(),
+        srsu2msi(elapsed), chunk_size, window, (int)inflight_budget);
     
     return err;
 }
@@ -523,8 +1756,10 @@ srs_error_t SrsEdgeForwarder::start()
 void SrsEdgeForwarder::stop()
 {
     trd->stop();
+    srs_freep(receiver);
     queue->clear();
     srs_freep(sdk);
+    lb->on_close();
 }
 
 // when error, edge ingester sleep for a while and retry.
@@ -540,11 +1775,11 @@ srs_error_t SrsEdgeForwarder::cycle()
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "thread pull");
         }
-
+        
         if ((err = do_cycle()) != srs_success) {
             return srs_error_wrap(err, "do cycle");
         }
-
+        
         srs_usleep(SRS_EDGE_FORWARDER_CIMS);
     }
     
@@ -557,8 +1792,6 @@ srs_error_t SrsEdgeForwarder::do_cycle()
 {
     srs_error_t err = srs_success;
     
-    sdk->set_recv_timeout(SRS_CONSTS_RTMP_PULSE);
-    
     SrsPithyPrint* pprint = SrsPithyPrint::create_edge();
     SrsAutoFree(SrsPithyPrint, pprint);
     
@@ -574,21 +1807,23 @@ srs_error_t SrsEdgeForwarder::do_cycle()
             continue;
         }
         
-        // read from client.
-        if (true) {
-            SrsCommonMessage* msg = NULL;
-            err = sdk->recv_message(&msg);
-            
-            srs_verbose("edge loop recv message. ret=%d", ret);
-            if (err != srs_success && srs_error_code(err) != ERROR_SOCKET_TIMEOUT) {
-                srs_error("edge push get server control message failed. err=%s", srs_error_desc(err).c_str());
-                send_error_code = srs_error_code(err);
-                srs_error_reset(err);
-                continue;
+        // The control messages from origin are received by receiver.
+        if (receiver->error() != ERROR_SUCCESS) {
+            srs_error("edge push get server control message failed. code=%d", receiver->error());
+            send_error_code = receiver->error();
+            continue;
+        }
+        
+        pprint->elapse();
+        
+        // Wait for the acks of origin, when too many bytes in flight.
+        if (inflight_budget > 0 && receiver->has_ack() && receiver->inflight() > inflight_budget) {
+            if (pprint->can_print()) {
+                srs_trace("-> " SRS_CONSTS_LOG_EDGE_PUBLISH " wait ack, inflight=%d, budget=%d, queue=%d",
+                    (int)receiver->inflight(), (int)inflight_budget, queue->size());
             }
-            
-            srs_error_reset(err);
-            srs_freep(msg);
+            srs_cond_timedwait(wait, SRS_CONSTS_RTMP_PULSE);
+            continue;
         }
         
         // forward all messages.
@@ -598,16 +1833,14 @@ srs_error_t SrsEdgeForwarder::do_cycle()
             return srs_error_wrap(err, "queue dumps packets");
         }
         
-        pprint->elapse();
-        
         // pithy print
         if (pprint->can_print()) {
             sdk->kbps_sample(SRS_CONSTS_LOG_EDGE_PUBLISH, pprint->age(), count);
         }
         
-        // ignore when no messages.
+        // Wait for messages when queue is empty, signaled by proxy.
         if (count <= 0) {
-            srs_verbose("edge no packets to push.");
+            srs_cond_timedwait(wait, SRS_CONSTS_RTMP_PULSE);
             continue;
         }
         
@@ -647,6 +1880,9 @@ srs_error_t SrsEdgeForwarder::proxy(SrsCommonMessage* msg)
         return srs_error_wrap(err, "enqueue message");
     }
     
+    // Wakeup the forwarder to send it.
+    srs_cond_signal(wait);
+    
     return err;
 }
 
@@ -692,9 +1928,9 @@ void SrsPlayEdge::on_all_client_stop()
     if (state == SrsEdgeStatePlay || state == SrsEdgeStateIngestConnected) {
         SrsEdgeState pstate = state;
         state = SrsEdgeStateIngestStopping;
-
+        
         ingester->stop();
-
+        
         state = SrsEdgeStateInit;
         srs_trace("edge change from %d to %d then %d (init).", pstate, SrsEdgeStateIngestStopping, state);
         
@@ -30,6 +30,9 @@
 #include <srs_app_thread.hpp>
 
 #include <string>
+#include <deque>
+#include <map>
+#include <vector>
 
 class SrsStSocket;
 class SrsRtmpServer;
@@ -42,10 +45,18 @@ class SrsCommonMessage;
 class SrsMessageQueue;
 class ISrsProtocolReadWriter;
 class SrsKbps;
-class SrsLbRoundRobin;
+class ISrsLoadBalancer;
+class SrsHttpClient;
+class ISrsHttpMessage;
+class SrsHttpFileReader;
+class SrsFlvDecoder;
+class SrsLbServerStats;
 class SrsTcpClient;
 class SrsSimpleRtmpClient;
 class SrsPacket;
+class SrsMuxRtmpClient;
+class SrsEdgeMuxSession;
+class SrsRelayClient;
 
 // The state of edge, auto machine
 enum SrsEdgeState
@@ -71,6 +82,12 @@ enum SrsEdgeUserState
     SrsEdgeUserStateReloading = 100,
 };
 
+// The stat of origin servers, shared by all edge streams, for the load balance of origins.
+extern SrsLbServerStats* _srs_edge_origins;
+
+// Create the load balancer of origins for edge, by the config of vhost.
+extern ISrsLoadBalancer* srs_edge_create_balancer(std::string vhost);
+
 // The upstream of edge, can be rtmp or http.
 class SrsEdgeUpstream
 {
@@ -78,7 +95,7 @@ public:
     SrsEdgeUpstream();
     virtual ~SrsEdgeUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb) = 0;
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb) = 0;
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg) = 0;
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket) = 0;
     virtual void close() = 0;
@@ -94,6 +111,8 @@ private:
     // For RTMP 302, if not empty,
     // use this <ip[:port]> as upstream.
     std::string redirect;
+    // Whether the redirect is an edge peer, which serves the vhost of edge itself, not transformed.
+    bool peer;
     SrsSimpleRtmpClient* sdk;
 private:
     // Current selected server, the ip:port.
@@ -101,10 +120,39 @@ private:
     int selected_port;
 public:
     // @param rediect, override the server. ignore if empty.
-    SrsEdgeRtmpUpstream(std::string r);
+    // @param p Whether the redirect is an edge peer.
+    SrsEdgeRtmpUpstream(std::string r, bool p = false);
     virtual ~SrsEdgeRtmpUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
+    virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
+    virtual void close();
+public:
+    virtual void selected(std::string& server, int& port);
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void kbps_sample(const char* label, int64_t age);
+};
+
+// The HTTP-FLV upstream of edge, to pull the stream over HTTP from origin,
+// which can be proxied by HTTP load balancers.
+// @remark The payload of flv tag is handed off to message without copy.
+class SrsEdgeHttpFlvUpstream : public SrsEdgeUpstream
+{
+private:
+    SrsHttpClient* sdk;
+    ISrsHttpMessage* hr;
+    SrsHttpFileReader* reader;
+    SrsFlvDecoder* decoder;
+private:
+    // Current selected server, the ip:port.
+    std::string selected_ip;
+    int selected_port;
+public:
+    SrsEdgeHttpFlvUpstream();
+    virtual ~SrsEdgeHttpFlvUpstream();
+public:
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual void close();
@@ -114,6 +162,186 @@ public:
     virtual void kbps_sample(const char* label, int64_t age);
 };
 
+// The UDP upstream of edge, to pull the stream from the relay server of origin, @see relay_server.
+// A lost packet only stalls its GOP, and the connection survives the NAT rebinding of edge.
+class SrsEdgeUdpUpstream : public SrsEdgeUpstream
+{
+private:
+    SrsRelayClient* sdk;
+private:
+    // Current selected server, the ip:port.
+    std::string selected_ip;
+    int selected_port;
+public:
+    SrsEdgeUdpUpstream();
+    virtual ~SrsEdgeUdpUpstream();
+public:
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
+    virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
+    virtual void close();
+public:
+    virtual void selected(std::string& server, int& port);
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void kbps_sample(const char* label, int64_t age);
+};
+
+// The mux upstream of edge, which is a channel of the mux session, to pull the stream
+// by a stream_id of the session shared by many streams, @see vhost cluster protocol mux.
+class SrsEdgeMuxUpstream : public SrsEdgeUpstream
+{
+private:
+    SrsRequest* req;
+    SrsEdgeMuxSession* session;
+    // The stream_id of this channel in session, 0 if not created.
+    int stream_id;
+    // The messages dispatched by session, and the cond to wait for them.
+    std::deque<SrsCommonMessage*> msgs;
+    srs_cond_t wait;
+    srs_utime_t timeout;
+    // The error code of channel, ERROR_SUCCESS if ok.
+    int error_code;
+private:
+    // Current selected server, the ip:port.
+    std::string selected_ip;
+    int selected_port;
+public:
+    SrsEdgeMuxUpstream();
+    virtual ~SrsEdgeMuxUpstream();
+public:
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
+    virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
+    virtual void close();
+public:
+    virtual void selected(std::string& server, int& port);
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void kbps_sample(const char* label, int64_t age);
+// For mux session.
+public:
+    // Wait for the stream_id created by origin, 0 if timeout or error.
+    virtual int wait_stream(srs_utime_t tm);
+    virtual void on_stream(int sid);
+    virtual void on_message(SrsCommonMessage* msg);
+    virtual void on_error(int code);
+};
+
+// The mux session to origin, carries the streams of many channels in one RTMP connection,
+// each stream is played by a stream_id created by the channel, and the messages from origin
+// are dispatched to channels by a receiver coroutine, by the stream_id of message.
+class SrsEdgeMuxSession : public ISrsCoroutineHandler
+{
+private:
+    std::string key;
+    SrsMuxRtmpClient* sdk;
+    SrsCoroutine* trd;
+    // The state of connection, the first channel connects it while others wait for ready.
+    bool connecting;
+    bool connected;
+    bool failed;
+    srs_cond_t ready;
+    // The error code of session, ERROR_SUCCESS if ok.
+    int error_code;
+    // The channels opened, the ones playing by stream_id and the ones creating stream by transaction id.
+    std::vector<SrsEdgeMuxUpstream*> channels;
+    std::map<int, SrsEdgeMuxUpstream*> streams;
+    std::map<int, SrsEdgeMuxUpstream*> pendings;
+    int transaction_id;
+public:
+    SrsEdgeMuxSession(std::string k, std::string url);
+    virtual ~SrsEdgeMuxSession();
+public:
+    virtual std::string get_key();
+    virtual bool is_failed();
+    virtual int nn_channels();
+    // Open the channel, connect to origin if not connected, then create stream and play it.
+    // @param stream The stream with query to play, @see srs_generate_stream_with_query
+    virtual srs_error_t open(SrsEdgeMuxUpstream* channel, std::string stream, srs_utime_t tm);
+    // Close the stream of channel, the session is released when no channels.
+    virtual void close(SrsEdgeMuxUpstream* channel);
+    virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
+    virtual void kbps_sample(const char* label, int64_t age);
+private:
+    virtual srs_error_t connect();
+// Interface ISrsReusableThread2Handler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t dispatch(SrsCommonMessage* msg);
+    virtual void fail(int code);
+};
+
+// The mux sessions of edge, by the origin, vhost, app and the index of connection.
+class SrsEdgeMuxSessions
+{
+private:
+    std::map<std::string, SrsEdgeMuxSession*> sessions;
+public:
+    SrsEdgeMuxSessions();
+    virtual ~SrsEdgeMuxSessions();
+public:
+    // Fetch the session by key, or create a new one when not found or failed.
+    virtual SrsEdgeMuxSession* fetch(std::string key, std::string url);
+    // Release the session which has no channels.
+    virtual void release(SrsEdgeMuxSession* session);
+};
+
+extern SrsEdgeMuxSessions* _srs_edge_mux;
+
+// The result of token verified by origin, @see SrsEdgeTokenCache
+struct SrsEdgeTokenResult
+{
+    // Whether the verify is in flight, the clients of same key wait for it.
+    bool pending;
+    // The error code of verify, ERROR_SUCCESS if the origin accepts the token.
+    int code;
+    // The result is valid before expire, 0 for not cached.
+    srs_utime_t expire;
+    // The number of clients waiting for the pending verify.
+    int nn_waiters;
+    srs_cond_t cond;
+};
+
+// The cache for token traverse of edge, keyed by (ip, vhost, app, param), to avoid connecting to origin
+// for each publish, for example, the encoder reconnects again and again. The concurrent clients of same
+// key share one connection to origin, and the result is cached in ttl, @see vhost cluster token_traverse_ttl.
+// @remark The mux session to origin is connected by the tcUrl of edge, which never carries the token of
+//      client, so each verify still opens a dedicated connection to origin.
+// @remark The result is not cached when failed to connect to any origin.
+// @remark The ip and whole param are in key, because the origin may bind the token to ip or other params.
+class SrsEdgeTokenCache
+{
+private:
+    std::map<std::string, SrsEdgeTokenResult*> results;
+    int64_t nn_hits;
+    int64_t nn_coalesced;
+    int64_t nn_misses;
+    int64_t nn_failures;
+public:
+    SrsEdgeTokenCache();
+    virtual ~SrsEdgeTokenCache();
+public:
+    // Verify the token of client by origin, or use the cached result.
+    // @param ttl The duration to cache the result, 0 to never cache it.
+    virtual srs_error_t verify(SrsRequest* req, srs_utime_t ttl);
+    // Build the cache key of request.
+    static std::string key_of(SrsRequest* req);
+public:
+    virtual int64_t hits();
+    virtual int64_t coalesced();
+    virtual int64_t misses();
+    virtual int64_t failures();
+private:
+    // Connect to origin to verify the token.
+    // @param reached Whether connected to any origin, to cache the result of origin.
+    virtual srs_error_t do_verify(SrsRequest* req, bool& reached);
+    virtual srs_error_t verify_by(SrsRtmpClient* client, SrsRequest* req);
+    // Remove the expired results when too many.
+    virtual void shrink();
+};
+
+extern SrsEdgeTokenCache* _srs_edge_tokens;
+
 // The edge used to ingest stream from origin.
 class SrsEdgeIngester : public ISrsCoroutineHandler
 {
@@ -122,8 +350,10 @@ private:
     SrsPlayEdge* edge;
     SrsRequest* req;
     SrsCoroutine* trd;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     SrsEdgeUpstream* upstream;
+    // The time to start ingest, to stat the time to first frame, 0 if done.
+    srs_utime_t start_time;
 public:
     SrsEdgeIngester();
     virtual ~SrsEdgeIngester();
@@ -137,11 +367,45 @@ public:
     virtual srs_error_t cycle();
 private:
     virtual srs_error_t do_cycle();
+    // Discover the edge peer which pulls the stream from origin.
+    // @param url Output the tcUrl of peer, empty if not found.
+    virtual void discover_peer(std::string& url);
 private:
     virtual srs_error_t ingest(std::string& redirect);
     virtual srs_error_t process_publish_message(SrsCommonMessage* msg, std::string& redirect);
 };
 
+// The receiver of edge forwarder, which reads the acks and control messages from origin in a
+// standalone coroutine, so the forwarder pipelines the messages to origin without waiting on it.
+class SrsEdgeForwarderReceiver : public ISrsCoroutineHandler
+{
+private:
+    SrsCoroutine* trd;
+    SrsSimpleRtmpClient* sdk;
+    // To notify the forwarder when got ack or error.
+    srs_cond_t signal;
+    // The sequence number of last ack, that is the bytes received by origin.
+    uint32_t sequence;
+    bool acked;
+    // The error code of receiving, ERROR_SUCCESS if ok.
+    int error_code;
+public:
+    SrsEdgeForwarderReceiver(SrsSimpleRtmpClient* s, srs_cond_t c);
+    virtual ~SrsEdgeForwarderReceiver();
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    // Whether got any ack from origin.
+    virtual bool has_ack();
+    // Get the bytes in flight, which is sent but not acked by origin.
+    virtual int64_t inflight();
+    // Get the error code of receiving, ERROR_SUCCESS if ok.
+    virtual int error();
+// Interface ISrsReusableThread2Handler
+public:
+    virtual srs_error_t cycle();
+};
+
 // The edge used to forward stream to origin.
 class SrsEdgeForwarder : public ISrsCoroutineHandler
 {
@@ -151,7 +415,7 @@ private:
     SrsRequest* req;
     SrsCoroutine* trd;
     SrsSimpleRtmpClient* sdk;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     // we must ensure one thread one fd principle,
     // that is, a fd must be write/read by the one thread.
     // The publish service thread will proxy(msg), and the edge forward thread
@@ -159,6 +423,11 @@ private:
     SrsMessageQueue* queue;
     // error code of send, for edge proxy thread to query.
     int send_error_code;
+    // The receiver of acks from origin, and the cond to wait for messages or acks.
+    SrsEdgeForwarderReceiver* receiver;
+    srs_cond_t wait;
+    // The max bytes in flight not acked by origin, 0 to disable.
+    int64_t inflight_budget;
 public:
     SrsEdgeForwarder();
     virtual ~SrsEdgeForwarder();
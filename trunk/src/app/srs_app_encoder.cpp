@@ -24,6 +24,7 @@
 #include <srs_app_encoder.hpp>
 
 #include <algorithm>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -34,13 +35,474 @@ using namespace std;
 #include <srs_app_ffmpeg.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_service_st.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
 
 // for encoder to detect the dead loop
 static std::vector<std::string> _transcoded_url;
 
+SrsTranscodeTicket::SrsTranscodeTicket()
+{
+    priority = 0;
+    popularity = 0;
+    granted = false;
+    queued_at = 0;
+}
+
+SrsTranscodeTicket::~SrsTranscodeTicket()
+{
+}
+
+string srs_transcode_guess_resource(string vcodec)
+{
+    if (vcodec == "copy" || vcodec == "vn") {
+        return "none";
+    }
+    
+    if (srs_string_contains(vcodec, "nvenc")) {
+        return "nvenc";
+    }
+    
+    if (srs_string_contains(vcodec, "qsv")) {
+        return "qsv";
+    }
+    
+    return "cpu";
+}
+
+SrsTranscodeScheduler* _srs_transcode_scheduler = new SrsTranscodeScheduler();
+
+SrsTranscodeScheduler::SrsTranscodeScheduler()
+{
+    enabled = false;
+}
+
+SrsTranscodeScheduler::~SrsTranscodeScheduler()
+{
+}
+
+void SrsTranscodeScheduler::initialize()
+{
+    enabled = _srs_config->get_transcode_scheduler_enabled();
+    
+    slots["cpu"] = _srs_config->get_transcode_scheduler_slots("cpu");
+    slots["nvenc"] = _srs_config->get_transcode_scheduler_slots("nvenc");
+    slots["qsv"] = _srs_config->get_transcode_scheduler_slots("qsv");
+    
+    if (enabled) {
+        srs_trace("transcode scheduler cpu=%d, nvenc=%d, qsv=%d", slots["cpu"], slots["nvenc"], slots["qsv"]);
+    }
+}
+
+void SrsTranscodeScheduler::set_slots(string resource, int v)
+{
+    slots[resource] = v;
+}
+
+void SrsTranscodeScheduler::set_enabled(bool v)
+{
+    enabled = v;
+}
+
+void SrsTranscodeScheduler::subscribe(SrsTranscodeTicket* ticket)
+{
+    ticket->granted = false;
+    ticket->queued_at = srs_get_system_time();
+    
+    if (std::find(tickets.begin(), tickets.end(), ticket) == tickets.end()) {
+        tickets.push_back(ticket);
+    }
+}
+
+void SrsTranscodeScheduler::unsubscribe(SrsTranscodeTicket* ticket)
+{
+    std::vector<SrsTranscodeTicket*>::iterator it = std::find(tickets.begin(), tickets.end(), ticket);
+    if (it != tickets.end()) {
+        tickets.erase(it);
+    }
+    
+    if (ticket->granted && limited(ticket->resource)) {
+        srs_trace("transcode release %s slot, stream=%s, engine=%s, used=%d, queued=%d", ticket->resource.c_str(),
+            ticket->stream.c_str(), ticket->engine.c_str(), nb_used(ticket->resource), nb_queued(ticket->resource));
+    }
+    ticket->granted = false;
+}
+
+bool SrsTranscodeScheduler::acquire(SrsTranscodeTicket* ticket)
+{
+    if (ticket->granted) {
+        return true;
+    }
+    
+    // Always grant the unlimited resource, to report the utilization.
+    if (!limited(ticket->resource)) {
+        ticket->granted = true;
+        return true;
+    }
+    
+    if (nb_used(ticket->resource) >= slots[ticket->resource]) {
+        return false;
+    }
+    
+    // Leave the free slot for the best queued ticket.
+    if (best(ticket->resource) != ticket) {
+        return false;
+    }
+    
+    ticket->granted = true;
+    srs_trace("transcode acquire %s slot, stream=%s, engine=%s, priority=%d, popularity=%d, wait=%dms, used=%d/%d",
+        ticket->resource.c_str(), ticket->stream.c_str(), ticket->engine.c_str(), ticket->priority, ticket->popularity,
+        srsu2msi(srs_get_system_time() - ticket->queued_at), nb_used(ticket->resource), slots[ticket->resource]);
+    
+    return true;
+}
+
+int SrsTranscodeScheduler::nb_used(string resource)
+{
+    int nn = 0;
+    for (int i = 0; i < (int)tickets.size(); i++) {
+        SrsTranscodeTicket* ticket = tickets[i];
+        if (ticket->resource == resource && ticket->granted) {
+            nn++;
+        }
+    }
+    return nn;
+}
+
+int SrsTranscodeScheduler::nb_queued(string resource)
+{
+    int nn = 0;
+    for (int i = 0; i < (int)tickets.size(); i++) {
+        SrsTranscodeTicket* ticket = tickets[i];
+        if (ticket->resource == resource && !ticket->granted) {
+            nn++;
+        }
+    }
+    return nn;
+}
+
+void SrsTranscodeScheduler::dumps(SrsJsonObject* obj)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    obj->set("enabled", SrsJsonAny::boolean(enabled));
+    
+    SrsJsonObject* resources = SrsJsonAny::object();
+    obj->set("resources", resources);
+    
+    const char* names[] = {"cpu", "nvenc", "qsv", "none"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        string name = names[i];
+        
+        SrsJsonObject* res = SrsJsonAny::object();
+        resources->set(name, res);
+        
+        res->set("slots", SrsJsonAny::integer(limited(name)? slots[name] : 0));
+        res->set("used", SrsJsonAny::integer(nb_used(name)));
+        res->set("queued", SrsJsonAny::integer(nb_queued(name)));
+    }
+    
+    SrsJsonArray* arr = SrsJsonAny::array();
+    obj->set("tickets", arr);
+    
+    for (int i = 0; i < (int)tickets.size(); i++) {
+        SrsTranscodeTicket* ticket = tickets[i];
+        
+        SrsJsonObject* t = SrsJsonAny::object();
+        arr->append(t);
+        
+        t->set("stream", SrsJsonAny::str(ticket->stream.c_str()));
+        t->set("engine", SrsJsonAny::str(ticket->engine.c_str()));
+        t->set("resource", SrsJsonAny::str(ticket->resource.c_str()));
+        t->set("priority", SrsJsonAny::integer(ticket->priority));
+        t->set("popularity", SrsJsonAny::integer(ticket->popularity));
+        t->set("granted", SrsJsonAny::boolean(ticket->granted));
+        t->set("age", SrsJsonAny::integer(srsu2ms(now - ticket->queued_at)));
+    }
+}
+
+bool SrsTranscodeScheduler::limited(string resource)
+{
+    if (!enabled || resource == "none") {
+        return false;
+    }
+    
+    std::map<std::string, int>::iterator it = slots.find(resource);
+    return it != slots.end() && it->second > 0;
+}
+
+SrsTranscodeTicket* SrsTranscodeScheduler::best(string resource)
+{
+    SrsTranscodeTicket* v = NULL;
+    
+    for (int i = 0; i < (int)tickets.size(); i++) {
+        SrsTranscodeTicket* ticket = tickets[i];
+        if (ticket->resource != resource || ticket->granted) {
+            continue;
+        }
+        
+        if (!v || ticket->priority > v->priority) {
+            v = ticket;
+        } else if (ticket->priority == v->priority) {
+            if (ticket->popularity > v->popularity) {
+                v = ticket;
+            } else if (ticket->popularity == v->popularity && ticket->queued_at < v->queued_at) {
+                v = ticket;
+            }
+        }
+    }
+    
+    return v;
+}
+
+// The directory of unix domain socket of feed.
+#define SRS_TRANSCODE_FEED_DIR "/tmp"
+
+SrsTranscodeFeedWriter::SrsTranscodeFeedWriter(ISrsProtocolReadWriter* io)
+{
+    skt = io;
+}
+
+SrsTranscodeFeedWriter::~SrsTranscodeFeedWriter()
+{
+}
+
+srs_error_t SrsTranscodeFeedWriter::open(string /*file*/)
+{
+    return srs_success;
+}
+
+void SrsTranscodeFeedWriter::close()
+{
+}
+
+bool SrsTranscodeFeedWriter::is_open()
+{
+    return true;
+}
+
+int64_t SrsTranscodeFeedWriter::tellg()
+{
+    return 0;
+}
+
+srs_error_t SrsTranscodeFeedWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    return skt->write(buf, count, pnwrite);
+}
+
+srs_error_t SrsTranscodeFeedWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    return skt->writev(iov, iovcnt, pnwrite);
+}
+
+SrsTranscodeFeedConn::SrsTranscodeFeedConn(SrsRequest* r, srs_netfd_t fd)
+{
+    req = r->copy();
+    stfd = fd;
+    skt = new SrsStSocket();
+    trd = new SrsSTCoroutine("feed", this);
+    done = false;
+}
+
+SrsTranscodeFeedConn::~SrsTranscodeFeedConn()
+{
+    trd->stop();
+    
+    srs_freep(trd);
+    srs_freep(skt);
+    srs_close_stfd(stfd);
+    srs_freep(req);
+}
+
+srs_error_t SrsTranscodeFeedConn::start()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = skt->initialize(stfd)) != srs_success) {
+        return srs_error_wrap(err, "init socket");
+    }
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start feed");
+    }
+    
+    return err;
+}
+
+bool SrsTranscodeFeedConn::finished()
+{
+    return done;
+}
+
+srs_error_t SrsTranscodeFeedConn::cycle()
+{
+    srs_error_t err = do_cycle();
+    done = true;
+    
+    srs_trace("feed: done for %s, sent=%" PRId64 ", err=%s", req->get_stream_url().c_str(),
+        skt->get_send_bytes(), srs_error_desc(err).c_str());
+    srs_freep(err);
+    
+    return srs_success;
+}
+
+srs_error_t SrsTranscodeFeedConn::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    SrsSource* source = _srs_sources->find(req);
+    if (!source) {
+        return srs_error_new(ERROR_SOURCE_NOT_FOUND, "no source");
+    }
+    
+    // Start from the GOP cache, for ffmpeg to decode from the keyframe.
+    SrsConsumer* consumer = NULL;
+    if ((err = source->create_consumer(NULL, consumer)) != srs_success) {
+        return srs_error_wrap(err, "create consumer");
+    }
+    SrsAutoFree(SrsConsumer, consumer);
+    
+    SrsTranscodeFeedWriter writer(skt);
+    SrsFlvStreamEncoder enc;
+    if ((err = enc.initialize(&writer)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    srs_utime_t mw_sleep = _srs_config->get_mw_sleep(req->vhost);
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    
+    srs_trace("feed: start for %s, mw_sleep=%dms", req->get_stream_url().c_str(), srsu2msi(mw_sleep));
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "feed");
+        }
+        
+        consumer->wait(SRS_PERF_MW_MIN_MSGS, mw_sleep, SRS_CONSTS_RTMP_PULSE);
+        
+        int count = 0;
+        if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
+            return srs_error_wrap(err, "dump packets");
+        }
+        
+        if (count <= 0) {
+            continue;
+        }
+        
+        err = enc.write_tags(msgs.msgs, count);
+        
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "write tags");
+        }
+    }
+    
+    return err;
+}
+
+SrsTranscodeFeed::SrsTranscodeFeed(SrsRequest* r)
+{
+    static int nn_feeds = 0;
+    path = SRS_TRANSCODE_FEED_DIR "/srs-feed-" + srs_int2str(getpid()) + "-" + srs_int2str(++nn_feeds) + ".sock";
+    
+    req = r->copy();
+    lfd = NULL;
+    trd = new SrsSTCoroutine("feed-listen", this);
+}
+
+SrsTranscodeFeed::~SrsTranscodeFeed()
+{
+    trd->stop();
+    srs_freep(trd);
+    
+    for (int i = 0; i < (int)conns.size(); i++) {
+        SrsTranscodeFeedConn* conn = conns.at(i);
+        srs_freep(conn);
+    }
+    conns.clear();
+    
+    if (lfd) {
+        srs_close_stfd(lfd);
+        ::unlink(path.c_str());
+    }
+    
+    srs_freep(req);
+}
+
+srs_error_t SrsTranscodeFeed::listen()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_unix_listen(path, &lfd)) != srs_success) {
+        return srs_error_wrap(err, "listen %s", path.c_str());
+    }
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start feed");
+    }
+    
+    srs_trace("feed: listen at %s for %s", path.c_str(), req->get_stream_url().c_str());
+    
+    return err;
+}
+
+string SrsTranscodeFeed::url()
+{
+    return "unix:" + path;
+}
+
+srs_error_t SrsTranscodeFeed::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "feed");
+        }
+        
+        srs_netfd_t fd = srs_accept(lfd, NULL, NULL, SRS_UTIME_NO_TIMEOUT);
+        if (!fd) {
+            continue;
+        }
+        
+        // Free the connections of ffmpeg which is restarted.
+        for (std::vector<SrsTranscodeFeedConn*>::iterator it = conns.begin(); it != conns.end();) {
+            SrsTranscodeFeedConn* conn = *it;
+            if (conn->finished()) {
+                srs_freep(conn);
+                it = conns.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        SrsTranscodeFeedConn* conn = new SrsTranscodeFeedConn(req, fd);
+        conns.push_back(conn);
+        
+        if ((err = conn->start()) != srs_success) {
+            srs_warn("feed: ignore err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    return err;
+}
+
 SrsEncoder::SrsEncoder()
 {
     trd = new SrsDummyCoroutine();
+    feed = NULL;
     pprint = SrsPithyPrint::create_encoder();
 }
 
@@ -85,6 +547,9 @@ void SrsEncoder::on_unpublish()
 {
     trd->stop();
     clear_engines();
+    
+    // Stop the feed after the ffmpegs are stopped.
+    srs_freep(feed);
 }
 
 // when error, encoder sleep for a while and retry.
@@ -125,9 +590,20 @@ srs_error_t SrsEncoder::do_cycle()
 {
     srs_error_t err = srs_success;
     
-    std::vector<SrsFFMPEG*>::iterator it;
-    for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
-        SrsFFMPEG* ffmpeg = *it;
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    for (int i = 0; i < (int)ffmpegs.size(); i++) {
+        SrsFFMPEG* ffmpeg = ffmpegs[i];
+        SrsTranscodeTicket* ticket = tickets[i];
+        
+        // The popular stream gets the slot first.
+        SrsStatisticStream* stream = stat->find_stream_by_url(ticket->stream);
+        ticket->popularity = stream? stream->nb_clients : 0;
+        
+        // Wait for the slot of scheduler.
+        if (!_srs_transcode_scheduler->acquire(ticket)) {
+            continue;
+        }
         
         // start all ffmpegs.
         if ((err = ffmpeg->start()) != srs_success) {
@@ -153,18 +629,27 @@ void SrsEncoder::clear_engines()
     for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
         SrsFFMPEG* ffmpeg = *it;
         
-        std::string output = ffmpeg->output();
-        
-        std::vector<std::string>::iterator tu_it;
-        tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), output);
-        if (tu_it != _transcoded_url.end()) {
-            _transcoded_url.erase(tu_it);
+        std::vector<std::string> outputs = ffmpeg->outputs();
+        for (int i = 0; i < (int)outputs.size(); i++) {
+            std::vector<std::string>::iterator tu_it;
+            tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), outputs[i]);
+            if (tu_it != _transcoded_url.end()) {
+                _transcoded_url.erase(tu_it);
+            }
         }
         
         srs_freep(ffmpeg);
     }
     
     ffmpegs.clear();
+    
+    for (int i = 0; i < (int)tickets.size(); i++) {
+        SrsTranscodeTicket* ticket = tickets[i];
+        _srs_transcode_scheduler->unsubscribe(ticket);
+        srs_freep(ticket);
+    }
+    
+    tickets.clear();
 }
 
 SrsFFMPEG* SrsEncoder::at(int index)
@@ -231,6 +716,22 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
         return err;
     }
     
+    // For group, all engines are encoded by the first ffmpeg, which decodes the input once.
+    bool group = _srs_config->get_transcode_group(conf);
+    SrsFFMPEG* first = NULL;
+    
+    // For unix feed, all ffmpegs of encoder read the FLV stream from the same feed.
+    std::string input;
+    if (_srs_config->get_transcode_feed(conf) == "unix") {
+        if (!feed) {
+            feed = new SrsTranscodeFeed(req);
+            if ((err = feed->listen()) != srs_success) {
+                return srs_error_wrap(err, "feed");
+            }
+        }
+        input = feed->url();
+    }
+    
     // create engine
     for (int i = 0; i < (int)engines.size(); i++) {
         SrsConfDirective* engine = engines[i];
@@ -240,18 +741,29 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
         }
         
         SrsFFMPEG* ffmpeg = new SrsFFMPEG(ffmpeg_bin);
-        if ((err = initialize_ffmpeg(ffmpeg, req, engine)) != srs_success) {
+        if ((err = initialize_ffmpeg(ffmpeg, req, engine, input)) != srs_success) {
             srs_freep(ffmpeg);
             return srs_error_wrap(err, "init ffmpeg");
         }
         
+        if (group && first) {
+            first->append_rendition(ffmpeg);
+            srs_trace("transcode group %s, engine %s to %s", conf->arg0().c_str(), engine->arg0().c_str(), ffmpeg->output().c_str());
+            continue;
+        }
+        first = ffmpeg;
+        
         ffmpegs.push_back(ffmpeg);
+        
+        SrsTranscodeTicket* ticket = create_ticket(req, conf, engine);
+        _srs_transcode_scheduler->subscribe(ticket);
+        tickets.push_back(ticket);
     }
     
     return err;
 }
 
-srs_error_t SrsEncoder::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, SrsConfDirective* engine)
+srs_error_t SrsEncoder::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, SrsConfDirective* engine, string feed)
 {
     srs_error_t err = srs_success;
     
@@ -314,7 +826,7 @@ srs_error_t SrsEncoder::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, Sr
     }
     _transcoded_url.push_back(output);
     
-    if ((err = ffmpeg->initialize(input, output, log_file)) != srs_success) {
+    if ((err = ffmpeg->initialize(feed.empty()? input : feed, output, log_file)) != srs_success) {
         return srs_error_wrap(err, "init ffmpeg");
     }
     if ((err = ffmpeg->initialize_transcode(engine)) != srs_success) {
@@ -324,15 +836,36 @@ srs_error_t SrsEncoder::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, Sr
     return err;
 }
 
+SrsTranscodeTicket* SrsEncoder::create_ticket(SrsRequest* req, SrsConfDirective* conf, SrsConfDirective* engine)
+{
+    SrsTranscodeTicket* ticket = new SrsTranscodeTicket();
+    
+    ticket->stream = req->get_stream_url();
+    ticket->engine = engine->arg0();
+    ticket->priority = _srs_config->get_transcode_priority(conf);
+    
+    ticket->resource = _srs_config->get_engine_resource(engine);
+    if (ticket->resource.empty()) {
+        ticket->resource = srs_transcode_guess_resource(_srs_config->get_engine_vcodec(engine));
+    }
+    
+    return ticket;
+}
+
 void SrsEncoder::show_encode_log_message()
 {
     pprint->elapse();
     
     // reportable
     if (pprint->can_print()) {
+        int nn_queued = 0;
+        for (int i = 0; i < (int)tickets.size(); i++) {
+            nn_queued += tickets[i]->granted? 0 : 1;
+        }
+        
         // TODO: FIXME: show more info.
-        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, input=%s",
-                  pprint->age(), (int)ffmpegs.size(), input_stream_name.c_str());
+        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, queued=%d, input=%s",
+                  pprint->age(), (int)ffmpegs.size(), nn_queued, input_stream_name.c_str());
     }
 }
 
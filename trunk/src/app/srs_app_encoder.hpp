@@ -28,13 +28,151 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 #include <srs_app_thread.hpp>
+#include <srs_app_st.hpp>
+#include <srs_kernel_file.hpp>
 
 class SrsConfDirective;
 class SrsRequest;
 class SrsPithyPrint;
 class SrsFFMPEG;
+class SrsJsonObject;
+class SrsStSocket;
+class ISrsProtocolReadWriter;
+
+// The ticket of a ffmpeg to request the slot of transcode scheduler.
+class SrsTranscodeTicket
+{
+public:
+    // The stream url and the engine name, for api.
+    std::string stream;
+    std::string engine;
+    // The resource, cpu, nvenc, qsv or none.
+    std::string resource;
+    // The higher priority gets the slot first.
+    int priority;
+    // The number of clients of stream, the more popular one gets the slot first.
+    int popularity;
+    // Whether the slot is granted.
+    bool granted;
+    // When queued, the earlier one gets the slot first.
+    srs_utime_t queued_at;
+public:
+    SrsTranscodeTicket();
+    virtual ~SrsTranscodeTicket();
+};
+
+// Guess the resource of transcode by the vcodec, for example, h264_nvenc is nvenc.
+extern std::string srs_transcode_guess_resource(std::string vcodec);
+
+// The scheduler to limit the number of ffmpeg of transcode by the slots of resource,
+// for example, the number of cpu cores or nvenc sessions. The ticket without slot is
+// queued, ordered by priority, popularity then the queued time.
+// @remark The ffmpeg keeps the slot until the stream unpublished, even it's restarted.
+class SrsTranscodeScheduler
+{
+private:
+    bool enabled;
+    // The slots of resource, 0 or not exists for unlimited.
+    std::map<std::string, int> slots;
+    std::vector<SrsTranscodeTicket*> tickets;
+public:
+    SrsTranscodeScheduler();
+    virtual ~SrsTranscodeScheduler();
+public:
+    // Initialize the slots from config.
+    virtual void initialize();
+    // Set the slots of resource, 0 for unlimited.
+    virtual void set_slots(std::string resource, int v);
+    virtual void set_enabled(bool v);
+public:
+    // Queue the ticket, user must unsubscribe it before free.
+    virtual void subscribe(SrsTranscodeTicket* ticket);
+    // Release the slot and remove the ticket from queue.
+    virtual void unsubscribe(SrsTranscodeTicket* ticket);
+    // Try to acquire the slot for ticket, return whether granted.
+    virtual bool acquire(SrsTranscodeTicket* ticket);
+public:
+    // Get the number of granted or queued tickets of resource.
+    virtual int nb_used(std::string resource);
+    virtual int nb_queued(std::string resource);
+    // Dumps the utilization of resources and all tickets.
+    virtual void dumps(SrsJsonObject* obj);
+private:
+    // Whether the resource is limited.
+    virtual bool limited(std::string resource);
+    // Get the best queued ticket of resource.
+    virtual SrsTranscodeTicket* best(std::string resource);
+};
+
+extern SrsTranscodeScheduler* _srs_transcode_scheduler;
+
+// Write the FLV stream to the socket of feed directly.
+class SrsTranscodeFeedWriter : public SrsFileWriter
+{
+private:
+    ISrsProtocolReadWriter* skt;
+public:
+    SrsTranscodeFeedWriter(ISrsProtocolReadWriter* io);
+    virtual ~SrsTranscodeFeedWriter();
+public:
+    virtual srs_error_t open(std::string file);
+    virtual void close();
+public:
+    virtual bool is_open();
+    virtual int64_t tellg();
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+};
+
+// The connection of ffmpeg to the feed, to write the FLV stream of source.
+class SrsTranscodeFeedConn : public ISrsCoroutineHandler
+{
+private:
+    SrsRequest* req;
+    srs_netfd_t stfd;
+    SrsStSocket* skt;
+    SrsCoroutine* trd;
+    bool done;
+public:
+    SrsTranscodeFeedConn(SrsRequest* r, srs_netfd_t fd);
+    virtual ~SrsTranscodeFeedConn();
+public:
+    virtual srs_error_t start();
+    // Whether the ffmpeg closed the connection, or failed.
+    virtual bool finished();
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+};
+
+// The feed of transcode, to write the FLV stream of source to ffmpeg by unix domain socket,
+// instead of ffmpeg plays the RTMP stream from loopback, without the handshake and chunks of RTMP.
+class SrsTranscodeFeed : public ISrsCoroutineHandler
+{
+private:
+    std::string path;
+    SrsRequest* req;
+    srs_netfd_t lfd;
+    SrsCoroutine* trd;
+    std::vector<SrsTranscodeFeedConn*> conns;
+public:
+    SrsTranscodeFeed(SrsRequest* r);
+    virtual ~SrsTranscodeFeed();
+public:
+    // Listen at the unix domain socket, and accept the ffmpegs.
+    virtual srs_error_t listen();
+    // The input url of ffmpeg, for example, unix:/tmp/srs-feed-1234-1.sock
+    virtual std::string url();
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+};
 
 // The encoder for a stream, may use multiple
 // ffmpegs to transcode the specified stream.
@@ -43,6 +181,10 @@ class SrsEncoder : public ISrsCoroutineHandler
 private:
     std::string input_stream_name;
     std::vector<SrsFFMPEG*> ffmpegs;
+    // The ticket of scheduler, for each ffmpeg.
+    std::vector<SrsTranscodeTicket*> tickets;
+    // The feed for ffmpegs, NULL if all ffmpegs play the RTMP stream.
+    SrsTranscodeFeed* feed;
 private:
     SrsCoroutine* trd;
     SrsPithyPrint* pprint;
@@ -62,7 +204,9 @@ private:
     virtual SrsFFMPEG* at(int index);
     virtual srs_error_t parse_scope_engines(SrsRequest* req);
     virtual srs_error_t parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf);
-    virtual srs_error_t initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, SrsConfDirective* engine);
+    // @param feed The input url of ffmpeg, empty to play the RTMP stream.
+    virtual srs_error_t initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsRequest* req, SrsConfDirective* engine, std::string feed);
+    virtual SrsTranscodeTicket* create_ticket(SrsRequest* req, SrsConfDirective* conf, SrsConfDirective* engine);
     virtual void show_encode_log_message();
 };
 
@@ -0,0 +1,237 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_events.hpp>
+
+#include <errno.h>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+
+SrsEvent::SrsEvent()
+{
+    id = 0;
+}
+
+SrsEvent::~SrsEvent()
+{
+}
+
+SrsEventBus* _srs_events = new SrsEventBus();
+
+SrsEventBus::SrsEventBus()
+{
+    next_id = 1;
+    cond = NULL;
+    nn_subscribers = 0;
+    nn_events = 0;
+    nn_overflows = 0;
+}
+
+SrsEventBus::~SrsEventBus()
+{
+    std::deque<SrsEvent*>::iterator it;
+    for (it = history.begin(); it != history.end(); ++it) {
+        SrsEvent* event = *it;
+        srs_freep(event);
+    }
+    history.clear();
+    
+    if (cond) {
+        srs_cond_destroy(cond);
+    }
+}
+
+void SrsEventBus::on_publish(SrsRequest* req, int cid)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "publish", req);
+    jw.field("cid")->integer(cid);
+    emit(&jw, "publish");
+}
+
+void SrsEventBus::on_unpublish(SrsRequest* req)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "unpublish", req);
+    emit(&jw, "unpublish");
+}
+
+void SrsEventBus::on_connect(int id, SrsRequest* req, SrsRtmpConnType type)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "connect", req);
+    jw.field("client_id")->integer(id);
+    jw.field("ip")->str(req->ip);
+    jw.field("client_type")->str(srs_client_type_string(type));
+    emit(&jw, "connect");
+}
+
+void SrsEventBus::on_close(int id, SrsRequest* req, SrsRtmpConnType type, int64_t send_bytes, int64_t recv_bytes)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "close", req);
+    jw.field("client_id")->integer(id);
+    jw.field("ip")->str(req->ip);
+    jw.field("client_type")->str(srs_client_type_string(type));
+    jw.field("send_bytes")->integer(send_bytes);
+    jw.field("recv_bytes")->integer(recv_bytes);
+    emit(&jw, "close");
+}
+
+void SrsEventBus::on_hls(SrsRequest* req, string file, string url, int seq, srs_utime_t duration)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "hls", req);
+    jw.field("file")->str(file);
+    jw.field("url")->str(url);
+    jw.field("seq_no")->integer(seq);
+    jw.field("duration")->number(srsu2ms(duration) / 1000.0);
+    emit(&jw, "hls");
+}
+
+void SrsEventBus::on_dvr(SrsRequest* req, string file)
+{
+    SrsJsonWriter jw;
+    begin(&jw, "dvr", req);
+    jw.field("file")->str(file);
+    emit(&jw, "dvr");
+}
+
+int64_t SrsEventBus::last_id()
+{
+    return next_id - 1;
+}
+
+int64_t SrsEventBus::fetch(int64_t after, const set<string>& types, bool sse, string& out, int64_t* plost)
+{
+    *plost = 0;
+    
+    if (history.empty()) {
+        return after;
+    }
+    
+    // The events after the id are lost, for it's too old.
+    int64_t oldest = history.front()->id;
+    if (after < oldest - 1) {
+        *plost = oldest - 1 - after;
+        after = oldest - 1;
+        nn_overflows++;
+    }
+    
+    // The events in history are continuous by id, so we seek to it directly.
+    for (size_t i = (size_t)(after + 1 - oldest); i < history.size(); i++) {
+        SrsEvent* event = history.at(i);
+        after = event->id;
+        
+        if (!types.empty() && types.find(event->type) == types.end()) {
+            continue;
+        }
+        
+        if (sse) {
+            out += "id: " + srs_int2str(event->id) + "\nevent: " + event->type + "\ndata: " + event->data + "\n\n";
+        } else {
+            out += event->data + "\n";
+        }
+    }
+    
+    return after;
+}
+
+srs_error_t SrsEventBus::wait(srs_utime_t timeout)
+{
+    if (!cond) {
+        cond = srs_cond_new();
+    }
+    
+    // The timeout is ok, and the others are interrupted by the coroutine.
+    if (srs_cond_timedwait(cond, timeout) < 0 && errno != ETIME) {
+        return srs_error_new(ERROR_SOCKET_TIMEOUT, "interrupted");
+    }
+    
+    return srs_success;
+}
+
+void SrsEventBus::subscribe()
+{
+    nn_subscribers++;
+}
+
+void SrsEventBus::unsubscribe()
+{
+    nn_subscribers--;
+}
+
+int SrsEventBus::subscribers()
+{
+    return nn_subscribers;
+}
+
+int64_t SrsEventBus::events()
+{
+    return nn_events;
+}
+
+int64_t SrsEventBus::overflows()
+{
+    return nn_overflows;
+}
+
+void SrsEventBus::begin(SrsJsonWriter* jw, string type, SrsRequest* req)
+{
+    jw->object_start();
+    jw->field("id")->integer(next_id);
+    jw->field("type")->str(type);
+    jw->field("time")->integer(srsu2ms(srs_get_system_time()));
+    jw->field("vhost")->str(req->vhost);
+    jw->field("app")->str(req->app);
+    jw->field("stream")->str(req->stream);
+}
+
+void SrsEventBus::emit(SrsJsonWriter* jw, string type)
+{
+    jw->object_end();
+    
+    SrsEvent* event = new SrsEvent();
+    event->id = next_id++;
+    event->type = type;
+    event->data = jw->dumps();
+    
+    history.push_back(event);
+    nn_events++;
+    
+    if (history.size() > SRS_EVENTS_HISTORY) {
+        SrsEvent* front = history.front();
+        history.pop_front();
+        srs_freep(front);
+    }
+    
+    if (cond) {
+        srs_cond_broadcast(cond);
+    }
+}
+
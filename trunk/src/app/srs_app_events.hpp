@@ -0,0 +1,108 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_EVENTS_HPP
+#define SRS_APP_EVENTS_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <deque>
+#include <set>
+
+#include <srs_app_st.hpp>
+#include <srs_rtmp_stack.hpp>
+
+class SrsRequest;
+class SrsJsonWriter;
+
+// The number of recent events kept for subscribers, which is the bound of a slow subscriber,
+// and for the subscriber to resume from the last event id after reconnect.
+#define SRS_EVENTS_HISTORY 1024
+// The interval to send heartbeat to subscriber, to keep the connection alive.
+#define SRS_EVENTS_HEARTBEAT (15 * SRS_UTIME_SECONDS)
+
+// The lifecycle event of stream and client, serialized once for all subscribers.
+class SrsEvent
+{
+public:
+    int64_t id;
+    std::string type;
+    // The event in JSON.
+    std::string data;
+public:
+    SrsEvent();
+    virtual ~SrsEvent();
+};
+
+// The bus of lifecycle events, fed by the statistic and the call sites of hooks, and streamed
+// to the subscribers of /api/v1/events. All subscribers share the events in history, and each
+// one only keeps the id of last event it sent, so a slow subscriber never grows the memory,
+// and it's notified by an overflow event when lost some events.
+class SrsEventBus
+{
+private:
+    int64_t next_id;
+    std::deque<SrsEvent*> history;
+    // Signal the subscribers when new event.
+    srs_cond_t cond;
+private:
+    int nn_subscribers;
+    int64_t nn_events;
+    int64_t nn_overflows;
+public:
+    SrsEventBus();
+    virtual ~SrsEventBus();
+public:
+    virtual void on_publish(SrsRequest* req, int cid);
+    virtual void on_unpublish(SrsRequest* req);
+    virtual void on_connect(int id, SrsRequest* req, SrsRtmpConnType type);
+    virtual void on_close(int id, SrsRequest* req, SrsRtmpConnType type, int64_t send_bytes, int64_t recv_bytes);
+    virtual void on_hls(SrsRequest* req, std::string file, std::string url, int seq, srs_utime_t duration);
+    virtual void on_dvr(SrsRequest* req, std::string file);
+public:
+    // The id of last event, the subscriber starts from it when not resumed.
+    virtual int64_t last_id();
+    // Format the events after the id and in types to out, all types if empty, return the id of last event.
+    // @param sse Whether in format of server-sent events, or JSON lines.
+    // @param plost Output the number of events lost, for the subscriber is too slow or resumed from too old.
+    virtual int64_t fetch(int64_t after, const std::set<std::string>& types, bool sse, std::string& out, int64_t* plost);
+    // Wait for the new event, error when the coroutine is interrupted.
+    virtual srs_error_t wait(srs_utime_t timeout);
+    virtual void subscribe();
+    virtual void unsubscribe();
+public:
+    virtual int subscribers();
+    virtual int64_t events();
+    virtual int64_t overflows();
+private:
+    // Write the common fields of event.
+    virtual void begin(SrsJsonWriter* jw, std::string type, SrsRequest* req);
+    virtual void emit(SrsJsonWriter* jw, std::string type);
+};
+
+// The bus of lifecycle events.
+extern SrsEventBus* _srs_events;
+
+#endif
+
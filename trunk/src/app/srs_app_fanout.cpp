@@ -0,0 +1,906 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <srs_app_fanout.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_config.hpp>
+
+SrsFanoutPool* _srs_fanout = new SrsFanoutPool();
+
+SrsFanoutPlayer::SrsFanoutPlayer(int f, SrsFanoutRelay* r, int64_t t)
+{
+    fd = f;
+    relay = r;
+    
+    cond = srs_cond_new();
+    closed = false;
+    removed = false;
+    removing = false;
+    
+    last_time = t;
+    offset = 0;
+    based = false;
+    skipping = false;
+    pos = 0;
+    writing = false;
+    finished = false;
+    error = 0;
+    nn_bytes = 0;
+    nn_skips = 0;
+}
+
+SrsFanoutPlayer::~SrsFanoutPlayer()
+{
+    srs_cond_destroy(cond);
+}
+
+SrsFanoutItem::SrsFanoutItem()
+{
+    type = SrsFanoutItemMessage;
+    relay = NULL;
+    msg = NULL;
+    skip = false;
+    player = NULL;
+}
+
+SrsFanoutItem::~SrsFanoutItem()
+{
+}
+
+SrsFanoutRelay::SrsFanoutRelay(SrsFanoutThread* t, SrsSource* s)
+{
+    thread = t;
+    source = s;
+    consumer = NULL;
+    trd = new SrsDummyCoroutine();
+    msgs = new SrsMessageArray(SRS_PERF_MW_MSGS);
+    mw_sleep = 0;
+    dropped = false;
+    nn_players = 0;
+}
+
+SrsFanoutRelay::~SrsFanoutRelay()
+{
+    srs_freep(trd);
+    srs_freep(consumer);
+    srs_freep(msgs);
+}
+
+srs_error_t SrsFanoutRelay::initialize(SrsRequest* r)
+{
+    srs_error_t err = srs_success;
+    
+    // The relay starts from the next message of source, without the metadata, sequence headers and gop cache,
+    // which are sent by the player itself.
+    if ((err = source->create_consumer(NULL, consumer, false, false, false)) != srs_success) {
+        return srs_error_wrap(err, "create consumer");
+    }
+    
+    mw_sleep = _srs_config->get_mw_sleep(r->vhost);
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("fanout", this, _srs_context->get_id());
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+SrsSource* SrsFanoutRelay::get_source()
+{
+    return source;
+}
+
+SrsFanoutThread* SrsFanoutRelay::get_thread()
+{
+    return thread;
+}
+
+void SrsFanoutRelay::flush()
+{
+    srs_error_t err = srs_success;
+    
+    bool pushed = false;
+    while (true) {
+        int count = 0;
+        if ((err = consumer->dump_packets(msgs, count)) != srs_success) {
+            srs_warn("fanout: ignore dump err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            break;
+        }
+        
+        if (count <= 0) {
+            break;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            SrsFanoutItem item;
+            item.relay = this;
+            item.msg = msgs->msgs[i];
+            item.skip = dropped;
+            msgs->msgs[i] = NULL;
+            
+            // Drop the message when thread is too slow, the players skip to the next keyframe.
+            if (!thread->push(item)) {
+                thread->nn_drops++;
+                dropped = true;
+                srs_freep(item.msg);
+                continue;
+            }
+            dropped = false;
+            pushed = true;
+        }
+    }
+    
+    if (pushed) {
+        thread->notify();
+    }
+}
+
+srs_error_t SrsFanoutRelay::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "fanout relay");
+        }
+        
+        consumer->wait(SRS_PERF_MW_MIN_MSGS, mw_sleep, SRS_CONSTS_RTMP_PULSE);
+        flush();
+    }
+    
+    return err;
+}
+
+SrsFanoutThread::SrsFanoutThread(SrsFanoutPool* p)
+{
+    pool = p;
+    started = false;
+    quit = false;
+    max_pending = 0;
+    epfd = efd = -1;
+    
+    items = new SrsFanoutItem[SRS_FANOUT_RING_SIZE];
+    head = tail = 0;
+    
+    nn_players = 0;
+    nn_drops = 0;
+}
+
+SrsFanoutThread::~SrsFanoutThread()
+{
+    stop();
+    
+    // Free the messages which are not consumed by thread.
+    for (uint64_t i = head; i < tail; i++) {
+        SrsFanoutItem& item = items[i & (SRS_FANOUT_RING_SIZE - 1)];
+        if (item.type == SrsFanoutItemMessage) {
+            srs_freep(item.msg);
+        }
+    }
+    srs_freepa(items);
+    
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = done_msgs.begin(); it != done_msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    done_msgs.clear();
+    
+    if (epfd >= 0) {
+        ::close(epfd);
+    }
+    if (efd >= 0) {
+        ::close(efd);
+    }
+}
+
+bool SrsFanoutThread::push(SrsFanoutItem& item)
+{
+    if (tail - head >= SRS_FANOUT_RING_SIZE) {
+        return false;
+    }
+    
+    items[tail & (SRS_FANOUT_RING_SIZE - 1)] = item;
+    
+    // Publish the slot before the sequence, for the consumer in other thread.
+    __sync_synchronize();
+    tail = tail + 1;
+    
+    return true;
+}
+
+void SrsFanoutThread::notify()
+{
+    uint64_t v = 1;
+    if (efd >= 0 && ::write(efd, &v, sizeof(v)) < 0) {
+        // Ignore, the eventfd is readable, the thread is notified.
+    }
+}
+
+void* SrsFanoutThread::pfn(void* arg)
+{
+    // The signals are always handled by the ST thread.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    SrsFanoutThread* p = (SrsFanoutThread*)arg;
+    p->cycle();
+    
+    return NULL;
+}
+
+int SrsFanoutThread::consume()
+{
+    uint64_t end = tail;
+    
+    // Read the slots after the sequence, which is published by producer.
+    __sync_synchronize();
+    
+    for (uint64_t i = head; i < end; i++) {
+        on_item(items[i & (SRS_FANOUT_RING_SIZE - 1)]);
+    }
+    
+    // Release the slots after read, for the producer in other thread.
+    __sync_synchronize();
+    int count = (int)(end - head);
+    head = end;
+    
+    return count;
+}
+
+void SrsFanoutThread::on_item(SrsFanoutItem& item)
+{
+    if (item.type == SrsFanoutItemMessage) {
+        std::map<SrsFanoutRelay*, std::vector<SrsFanoutPlayer*> >::iterator it = players.find(item.relay);
+        for (int i = 0; it != players.end() && i < (int)it->second.size(); i++) {
+            SrsFanoutPlayer* player = it->second.at(i);
+            
+            // The GOP is broken by the dropped messages, skip to the next keyframe.
+            if (item.skip && !player->skipping) {
+                player->skipping = true;
+                player->nn_skips++;
+            }
+            
+            deliver(player, item.msg);
+        }
+        
+        // The message is freed by ST thread, because the payload is shared by other messages.
+        done_msgs.push_back(item.msg);
+        return;
+    }
+    
+    SrsFanoutPlayer* player = item.player;
+    if (item.type == SrsFanoutItemRemove) {
+        do_close(player, 0);
+        removeds.push_back(player);
+        return;
+    }
+    
+    players[player->relay].push_back(player);
+    
+#ifdef __linux__
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = player;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, player->fd, &ev) < 0) {
+        close(player, errno);
+    }
+#endif
+}
+
+void SrsFanoutThread::on_event(SrsFanoutPlayer* player, uint32_t events)
+{
+    if (player->finished) {
+        return;
+    }
+    
+    // Drain the bytes sent by client, and close when client closed the FD.
+    char buf[4096];
+    while (true) {
+        ssize_t nn = ::read(player->fd, buf, sizeof(buf));
+        if (nn > 0) {
+            continue;
+        }
+        
+        if (nn == 0) {
+            close(player, 0);
+            return;
+        }
+        
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close(player, errno);
+            return;
+        }
+        break;
+    }
+    
+    if (player->writing) {
+        flush(player);
+    }
+}
+
+void SrsFanoutThread::deliver(SrsFanoutPlayer* player, SrsSharedPtrMessage* msg)
+{
+    if (player->finished) {
+        return;
+    }
+    
+    std::string& pending = player->pending;
+    
+    // Skip to the keyframe when all unsent bytes are written, so the player never gets a broken GOP.
+    if (player->skipping) {
+        if (!msg->is_video() || !SrsFlvVideo::keyframe(msg->payload, msg->size) || SrsFlvVideo::sh(msg->payload, msg->size)) {
+            return;
+        }
+        if (player->pos < pending.size()) {
+            return;
+        }
+        player->skipping = false;
+    }
+    
+    if ((int)(pending.size() - player->pos) >= max_pending) {
+        player->skipping = true;
+        player->nn_skips++;
+        return;
+    }
+    
+    // Rebase the timestamp of relay to continue the stream of player, for the jitter of consumers are different.
+    char type = SrsFrameTypeScript;
+    int64_t timestamp = 0;
+    if (msg->is_av()) {
+        type = msg->is_audio()? SrsFrameTypeAudio : SrsFrameTypeVideo;
+        if (!player->based) {
+            player->offset = (player->last_time >= 0)? player->last_time - msg->timestamp : 0;
+            player->based = true;
+        }
+        timestamp = srs_max(player->last_time, msg->timestamp + player->offset);
+        player->last_time = timestamp;
+    }
+    timestamp &= 0x7fffffff;
+    
+    // Each tag is a chunk of the HTTP chunked encoding.
+    char chunk[32];
+    int nb_chunk = snprintf(chunk, sizeof(chunk), "%x\r\n", SRS_FLV_TAG_HEADER_SIZE + msg->size + SRS_FLV_PREVIOUS_TAG_SIZE);
+    
+    char header[SRS_FLV_TAG_HEADER_SIZE];
+    SrsBuffer hs(header, sizeof(header));
+    hs.write_1bytes(type);
+    hs.write_3bytes(msg->size);
+    hs.write_3bytes((int32_t)timestamp);
+    hs.write_1bytes((timestamp >> 24) & 0xFF);
+    hs.write_3bytes(0x00);
+    
+    char pts[SRS_FLV_PREVIOUS_TAG_SIZE + 2];
+    SrsBuffer ps(pts, sizeof(pts));
+    ps.write_4bytes(SRS_FLV_TAG_HEADER_SIZE + msg->size);
+    ps.write_1bytes('\r');
+    ps.write_1bytes('\n');
+    
+    iovec iovs[4];
+    iovs[0].iov_base = chunk;
+    iovs[0].iov_len = nb_chunk;
+    iovs[1].iov_base = header;
+    iovs[1].iov_len = sizeof(header);
+    iovs[2].iov_base = msg->payload;
+    iovs[2].iov_len = msg->size;
+    iovs[3].iov_base = pts;
+    iovs[3].iov_len = sizeof(pts);
+    
+    // Write directly when no unsent bytes, or append to the unsent bytes in order.
+    size_t nn = 0;
+    if (player->pos >= pending.size()) {
+        msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = iovs;
+        mh.msg_iovlen = 4;
+        
+        ssize_t r0 = ::sendmsg(player->fd, &mh, MSG_NOSIGNAL);
+        if (r0 < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            close(player, errno);
+            return;
+        }
+        
+        nn = (size_t)srs_max(0, r0);
+        player->nn_bytes += nn;
+        
+        pending.clear();
+        player->pos = 0;
+    } else if (player->pos >= pending.size() / 2) {
+        pending.erase(0, player->pos);
+        player->pos = 0;
+    }
+    
+    for (int i = 0; i < 4; i++) {
+        if (nn >= iovs[i].iov_len) {
+            nn -= iovs[i].iov_len;
+            continue;
+        }
+        pending.append((char*)iovs[i].iov_base + nn, iovs[i].iov_len - nn);
+        nn = 0;
+    }
+    
+    if (player->pos < pending.size()) {
+        watch(player, true);
+    }
+}
+
+void SrsFanoutThread::flush(SrsFanoutPlayer* player)
+{
+    std::string& pending = player->pending;
+    
+    while (player->pos < pending.size()) {
+        ssize_t nn = ::send(player->fd, pending.data() + player->pos, pending.size() - player->pos, MSG_NOSIGNAL);
+        if (nn < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        
+        if (nn < 0) {
+            close(player, errno);
+            return;
+        }
+        
+        player->pos += nn;
+        player->nn_bytes += nn;
+    }
+    
+    pending.clear();
+    player->pos = 0;
+    watch(player, false);
+}
+
+void SrsFanoutThread::watch(SrsFanoutPlayer* player, bool writing)
+{
+    if (player->writing == writing) {
+        return;
+    }
+    player->writing = writing;
+    
+#ifdef __linux__
+    epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (writing? EPOLLOUT : 0);
+    ev.data.ptr = player;
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, player->fd, &ev) < 0) {
+        close(player, errno);
+    }
+#endif
+}
+
+void SrsFanoutThread::close(SrsFanoutPlayer* player, int error)
+{
+    if (player->finished) {
+        return;
+    }
+    
+    do_close(player, error);
+    
+    // Notify the ST thread to remove it.
+    closeds.push_back(player);
+}
+
+void SrsFanoutThread::do_close(SrsFanoutPlayer* player, int error)
+{
+    if (player->finished) {
+        return;
+    }
+    
+#ifdef __linux__
+    epoll_ctl(epfd, EPOLL_CTL_DEL, player->fd, NULL);
+#endif
+    ::close(player->fd);
+    player->finished = true;
+    player->error = error;
+    
+    std::map<SrsFanoutRelay*, std::vector<SrsFanoutPlayer*> >::iterator it = players.find(player->relay);
+    if (it != players.end()) {
+        std::vector<SrsFanoutPlayer*>& ps = it->second;
+        std::vector<SrsFanoutPlayer*>::iterator pit = std::find(ps.begin(), ps.end(), player);
+        if (pit != ps.end()) {
+            *pit = ps.back();
+            ps.pop_back();
+        }
+        if (ps.empty()) {
+            players.erase(it);
+        }
+    }
+
+}
+
+#ifdef __linux__
+srs_error_t SrsFanoutThread::start(int max)
+{
+    srs_error_t err = srs_success;
+    
+    max_pending = max;
+    
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "epoll create");
+    }
+    
+    if ((efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "eventfd");
+    }
+    
+    // The NULL data is the eventfd.
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "epoll add eventfd");
+    }
+    
+    int r0 = 0;
+    if ((r0 = pthread_create(&tid, NULL, SrsFanoutThread::pfn, this)) != 0) {
+        return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "create thread, r0=%d", r0);
+    }
+    started = true;
+    
+    return err;
+}
+
+void SrsFanoutThread::cycle()
+{
+    epoll_event events[SRS_FANOUT_MAX_EVENTS];
+    
+    while (!quit) {
+        int nn = epoll_wait(epfd, events, SRS_FANOUT_MAX_EVENTS, srsu2msi(SRS_FANOUT_INTERVAL));
+        
+        for (int i = 0; i < nn; i++) {
+            SrsFanoutPlayer* player = (SrsFanoutPlayer*)events[i].data.ptr;
+            
+            if (!player) {
+                uint64_t v = 0;
+                if (::read(efd, &v, sizeof(v)) < 0) {
+                    // Ignore, the eventfd is drained.
+                }
+                continue;
+            }
+            
+            on_event(player, events[i].events);
+        }
+        
+        consume();
+        
+        // Return the done messages and players to ST thread in batch.
+        if (!done_msgs.empty() || !closeds.empty() || !removeds.empty()) {
+            pool->on_thread_done(done_msgs, closeds, removeds);
+        }
+    }
+    
+    // Close all players when quit, for the server is quit.
+    std::map<SrsFanoutRelay*, std::vector<SrsFanoutPlayer*> >::iterator it;
+    for (it = players.begin(); it != players.end(); ++it) {
+        std::vector<SrsFanoutPlayer*>& ps = it->second;
+        for (int i = 0; i < (int)ps.size(); i++) {
+            ::close(ps.at(i)->fd);
+        }
+    }
+    players.clear();
+}
+#else
+srs_error_t SrsFanoutThread::start(int max)
+{
+    return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "fanout requires linux");
+}
+
+void SrsFanoutThread::cycle()
+{
+}
+#endif
+
+void SrsFanoutThread::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    quit = true;
+    notify();
+    
+    pthread_join(tid, NULL);
+    started = false;
+}
+
+SrsFanoutPool::SrsFanoutPool()
+{
+    started = false;
+    next = 0;
+    trd = new SrsDummyCoroutine();
+    pthread_mutex_init(&lock, NULL);
+    pipes[0] = pipes[1] = -1;
+    pipe_stfd = NULL;
+    
+    nn_handovers = 0;
+    nn_players = 0;
+}
+
+SrsFanoutPool::~SrsFanoutPool()
+{
+    std::vector<SrsFanoutThread*>::iterator it;
+    for (it = threads.begin(); it != threads.end(); ++it) {
+        SrsFanoutThread* thread = *it;
+        srs_freep(thread);
+    }
+    threads.clear();
+    
+    srs_freep(trd);
+    srs_close_stfd(pipe_stfd);
+    if (pipes[1] > 0) {
+        ::close(pipes[1]);
+    }
+    
+    std::vector<SrsSharedPtrMessage*>::iterator it2;
+    for (it2 = msgs.begin(); it2 != msgs.end(); ++it2) {
+        SrsSharedPtrMessage* msg = *it2;
+        srs_freep(msg);
+    }
+    msgs.clear();
+    
+    pthread_mutex_destroy(&lock);
+}
+
+srs_error_t SrsFanoutPool::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (started || !_srs_config->get_fanout_enabled()) {
+        return err;
+    }
+    
+    if (::pipe(pipes) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+    
+    // The thread should never block when notify the coroutine.
+    int flags = ::fcntl(pipes[1], F_GETFL, 0);
+    if (flags == -1 || ::fcntl(pipes[1], F_SETFL, flags | O_NONBLOCK) == -1) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "nonblock pipe");
+    }
+    
+    if ((pipe_stfd = srs_netfd_open(pipes[0])) == NULL) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "open pipe");
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("fanout", this, _srs_context->get_id());
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    int nn_threads = srs_max(1, _srs_config->get_fanout_threads());
+    int max_pending = _srs_config->get_fanout_max_pending();
+    for (int i = 0; i < nn_threads; i++) {
+        SrsFanoutThread* thread = new SrsFanoutThread(this);
+        threads.push_back(thread);
+        
+        if ((err = thread->start(max_pending)) != srs_success) {
+            return srs_error_wrap(err, "start thread #%d", i);
+        }
+    }
+    started = true;
+    
+    srs_trace("fanout: threads=%d, max_pending=%d", nn_threads, max_pending);
+    
+    return err;
+}
+
+bool SrsFanoutPool::enabled()
+{
+    return started;
+}
+
+srs_error_t SrsFanoutPool::handover(SrsSource* source, SrsRequest* req, int fd, int64_t last_time, SrsFanoutPlayer** pplayer)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFanoutThread* thread = threads.at(next++ % (int)threads.size());
+    
+    SrsFanoutRelay* relay = NULL;
+    std::map<SrsSource*, SrsFanoutRelay*>::iterator it = thread->relays.find(source);
+    if (it != thread->relays.end()) {
+        relay = it->second;
+    } else {
+        relay = new SrsFanoutRelay(thread, source);
+        if ((err = relay->initialize(req)) != srs_success) {
+            srs_freep(relay);
+            ::close(fd);
+            return srs_error_wrap(err, "init relay");
+        }
+        thread->relays[source] = relay;
+    }
+    
+    // Push the messages before the player, so the player starts from the next message of source.
+    relay->flush();
+    
+    SrsFanoutPlayer* player = new SrsFanoutPlayer(fd, relay, last_time);
+    
+    SrsFanoutItem item;
+    item.type = SrsFanoutItemAdd;
+    item.player = player;
+    if (!thread->push(item)) {
+        if (relay->nn_players <= 0) {
+            thread->relays.erase(source);
+            srs_freep(relay);
+        }
+        srs_freep(player);
+        ::close(fd);
+        return srs_error_new(ERROR_SYSTEM_FANOUT_THREAD, "ring full, players=%d", thread->nn_players);
+    }
+    thread->notify();
+    
+    relay->nn_players++;
+    thread->nn_players++;
+    nn_players++;
+    nn_handovers++;
+    
+    *pplayer = player;
+    
+    return err;
+}
+
+bool SrsFanoutPool::remove(SrsFanoutPlayer* player)
+{
+    if (player->removing) {
+        return true;
+    }
+    
+    SrsFanoutThread* thread = player->relay->get_thread();
+    
+    SrsFanoutItem item;
+    item.type = SrsFanoutItemRemove;
+    item.player = player;
+    if (!thread->push(item)) {
+        return false;
+    }
+    thread->notify();
+    
+    player->removing = true;
+    return true;
+}
+
+void SrsFanoutPool::release(SrsFanoutPlayer* player)
+{
+    srs_assert(player->removed);
+    
+    SrsFanoutRelay* relay = player->relay;
+    SrsFanoutThread* thread = relay->get_thread();
+    
+    relay->nn_players--;
+    thread->nn_players--;
+    nn_players--;
+    
+    // Free the relay when no player, the messages in ring are returned without player.
+    if (relay->nn_players <= 0) {
+        thread->relays.erase(relay->get_source());
+        srs_freep(relay);
+    }
+    
+    srs_freep(player);
+}
+
+srs_error_t SrsFanoutPool::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    char buf[64];
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "fanout");
+        }
+        
+        ssize_t nn = srs_read(pipe_stfd, buf, sizeof(buf), SRS_UTIME_NO_TIMEOUT);
+        if (nn <= 0) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "read pipe");
+        }
+        
+        consume();
+    }
+    
+    return err;
+}
+
+void SrsFanoutPool::on_thread_done(std::vector<SrsSharedPtrMessage*>& dmsgs, std::vector<SrsFanoutPlayer*>& dclosed,
+    std::vector<SrsFanoutPlayer*>& dremoved)
+{
+    pthread_mutex_lock(&lock);
+    bool notify = msgs.empty() && closeds.empty() && removeds.empty();
+    msgs.insert(msgs.end(), dmsgs.begin(), dmsgs.end());
+    closeds.insert(closeds.end(), dclosed.begin(), dclosed.end());
+    removeds.insert(removeds.end(), dremoved.begin(), dremoved.end());
+    pthread_mutex_unlock(&lock);
+    
+    dmsgs.clear();
+    dclosed.clear();
+    dremoved.clear();
+    
+    // Only notify for the first batch, the coroutine consumes all.
+    if (notify) {
+        char v = 0;
+        if (::write(pipes[1], &v, 1) < 0) {
+            // Ignore, the pipe is full, the coroutine is notified.
+        }
+    }
+}
+
+void SrsFanoutPool::consume()
+{
+    std::vector<SrsSharedPtrMessage*> dmsgs;
+    std::vector<SrsFanoutPlayer*> dclosed;
+    std::vector<SrsFanoutPlayer*> dremoved;
+    if (true) {
+        pthread_mutex_lock(&lock);
+        dmsgs.swap(msgs);
+        dclosed.swap(closeds);
+        dremoved.swap(removeds);
+        pthread_mutex_unlock(&lock);
+    }
+    
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = dmsgs.begin(); it != dmsgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    
+    std::vector<SrsFanoutPlayer*>::iterator it2;
+    for (it2 = dclosed.begin(); it2 != dclosed.end(); ++it2) {
+        SrsFanoutPlayer* player = *it2;
+        player->closed = true;
+        srs_cond_signal(player->cond);
+    }
+    
+    for (it2 = dremoved.begin(); it2 != dremoved.end(); ++it2) {
+        SrsFanoutPlayer* player = *it2;
+        player->removed = true;
+        srs_cond_signal(player->cond);
+    }
+}
+
@@ -0,0 +1,276 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_FANOUT_HPP
+#define SRS_APP_FANOUT_HPP
+
+#include <srs_core.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include <srs_app_st.hpp>
+
+class SrsSource;
+class SrsConsumer;
+class SrsRequest;
+class SrsSharedPtrMessage;
+class SrsMessageArray;
+class SrsFanoutPool;
+class SrsFanoutThread;
+class SrsFanoutRelay;
+
+// The number of items in the ring of fanout thread, must be power of 2.
+#define SRS_FANOUT_RING_SIZE 65536
+// The max number of events for each epoll wait.
+#define SRS_FANOUT_MAX_EVENTS 256
+// The max time for thread to wait, to check whether quit.
+#define SRS_FANOUT_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+// The interval for the player coroutine to check whether the stream is over.
+#define SRS_FANOUT_CHECK_INTERVAL (1 * SRS_UTIME_SECONDS)
+
+// The player handed over to fanout thread, which writes the HTTP-FLV stream to its socket.
+// @remark Created and freed by ST thread, the thread never touches it after removed.
+class SrsFanoutPlayer
+{
+public:
+    // The fd duplicated from the connection, owned by fanout thread after added.
+    int fd;
+    SrsFanoutRelay* relay;
+// The fields of ST thread.
+public:
+    // Signal when closed or removed by thread.
+    srs_cond_t cond;
+    // Whether the player is closed by thread, for example, the peer closed the socket.
+    bool closed;
+    // Whether the player is removed by thread, which never touches it, so we can free it.
+    bool removed;
+    // Whether the remove is pushed to thread.
+    bool removing;
+// The fields of fanout thread, which are read by ST thread after removed.
+public:
+    // The timestamp in ms of last message written to player, the messages of relay are rebased to it.
+    int64_t last_time;
+    int64_t offset;
+    bool based;
+    // Whether drop the messages until the next keyframe, for the unsent bytes exceed the max.
+    bool skipping;
+    // The unsent bytes, from the position.
+    std::string pending;
+    size_t pos;
+    // Whether the socket is watched for writable.
+    bool writing;
+    // Whether the socket is closed by thread.
+    bool finished;
+    // The errno when closed, 0 if closed by peer or removed.
+    int error;
+    // The bytes written and the times of skip.
+    int64_t nn_bytes;
+    int nn_skips;
+public:
+    SrsFanoutPlayer(int f, SrsFanoutRelay* r, int64_t t);
+    virtual ~SrsFanoutPlayer();
+};
+
+// The type of item in the ring of fanout thread.
+enum SrsFanoutItemType
+{
+    SrsFanoutItemMessage = 0,
+    SrsFanoutItemAdd,
+    SrsFanoutItemRemove,
+};
+
+// The item from ST thread to fanout thread.
+class SrsFanoutItem
+{
+public:
+    SrsFanoutItemType type;
+    // For message, the message of relay, returned to pool to free after written to players.
+    SrsFanoutRelay* relay;
+    SrsSharedPtrMessage* msg;
+    // For message, whether the previous messages of relay are dropped, so the players skip to the next keyframe.
+    bool skip;
+    // For add and remove, the player.
+    SrsFanoutPlayer* player;
+public:
+    SrsFanoutItem();
+    virtual ~SrsFanoutItem();
+};
+
+// The local relay of source in a fanout thread, which is a consumer of source, and pushes the
+// messages to thread once, then the thread writes them to all players of the relay.
+class SrsFanoutRelay : virtual public ISrsCoroutineHandler
+{
+private:
+    SrsFanoutThread* thread;
+    SrsSource* source;
+    SrsConsumer* consumer;
+    SrsCoroutine* trd;
+    SrsMessageArray* msgs;
+    srs_utime_t mw_sleep;
+    // Whether dropped messages for the ring is full, the next pushed message marks the players to skip.
+    bool dropped;
+public:
+    // The number of players, which are added and not removed.
+    int nn_players;
+public:
+    SrsFanoutRelay(SrsFanoutThread* t, SrsSource* s);
+    virtual ~SrsFanoutRelay();
+public:
+    virtual srs_error_t initialize(SrsRequest* r);
+    virtual SrsSource* get_source();
+    virtual SrsFanoutThread* get_thread();
+    // Push all messages of consumer to thread.
+    virtual void flush();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+// The fanout thread, which is an OS thread not ST coroutine, so it can never use any ST API or
+// write log. It consumes the items of ring, and writes the messages to its players by epoll.
+// @remark The ring is lock-free, the single producer is the ST thread, and the single consumer is
+//      the fanout thread, while the messages and players are returned to pool by lock.
+class SrsFanoutThread
+{
+private:
+    SrsFanoutPool* pool;
+    pthread_t tid;
+    bool started;
+    volatile bool quit;
+    // The max unsent bytes of player.
+    int max_pending;
+    int epfd;
+    // The eventfd to wakeup the thread when push items.
+    int efd;
+private:
+    // The ring of items, the position of ring is the total items modulo size.
+    SrsFanoutItem* items;
+    volatile uint64_t head;
+    volatile uint64_t tail;
+private:
+    // The players of each relay, only used by fanout thread.
+    std::map<SrsFanoutRelay*, std::vector<SrsFanoutPlayer*> > players;
+    // The done messages and players of a loop, returned to pool in batch.
+    std::vector<SrsSharedPtrMessage*> done_msgs;
+    std::vector<SrsFanoutPlayer*> closeds;
+    std::vector<SrsFanoutPlayer*> removeds;
+// The fields of ST thread.
+public:
+    // The relay of each source.
+    std::map<SrsSource*, SrsFanoutRelay*> relays;
+    // The number of players in thread.
+    int nn_players;
+    // The number of messages dropped, because the ring is full.
+    int64_t nn_drops;
+public:
+    SrsFanoutThread(SrsFanoutPool* p);
+    virtual ~SrsFanoutThread();
+public:
+    // Start the thread, with the max unsent bytes of player.
+    virtual srs_error_t start(int max);
+    virtual void stop();
+    // Push item to ring, return false if full.
+    virtual bool push(SrsFanoutItem& item);
+    // Wakeup the thread to consume the items.
+    virtual void notify();
+private:
+    static void* pfn(void* arg);
+    virtual void cycle();
+    // Consume the items in ring, return the number of items.
+    virtual int consume();
+    virtual void on_item(SrsFanoutItem& item);
+    virtual void on_event(SrsFanoutPlayer* player, uint32_t events);
+    // Write the message to player, or append to the unsent bytes.
+    virtual void deliver(SrsFanoutPlayer* player, SrsSharedPtrMessage* msg);
+    // Write the unsent bytes when socket is writable.
+    virtual void flush(SrsFanoutPlayer* player);
+    // Watch the socket for writable or not.
+    virtual void watch(SrsFanoutPlayer* player, bool writing);
+    // Close the socket of player by thread, and notify the ST thread to remove it.
+    virtual void close(SrsFanoutPlayer* player, int error);
+    // Close the socket of player, and remove it from its relay.
+    virtual void do_close(SrsFanoutPlayer* player, int error);
+};
+
+// The pool of fanout threads, to deliver a hot HTTP-FLV stream by multiple cpus.
+// The player hands over its socket to a thread after the gop cache is sent, and waits for it done,
+// which is delivered back by a pipe to the pool coroutine, like the disk io pool.
+class SrsFanoutPool : virtual public ISrsCoroutineHandler
+{
+private:
+    bool started;
+    std::vector<SrsFanoutThread*> threads;
+    // The next thread for player, by round-robin.
+    int next;
+    SrsCoroutine* trd;
+private:
+    // The done messages and players from threads, protected by lock.
+    pthread_mutex_t lock;
+    std::vector<SrsSharedPtrMessage*> msgs;
+    std::vector<SrsFanoutPlayer*> closeds;
+    std::vector<SrsFanoutPlayer*> removeds;
+    // The pipe to notify the coroutine when done.
+    int pipes[2];
+    srs_netfd_t pipe_stfd;
+private:
+    // The total number of players handed over, and the players in threads.
+    int64_t nn_handovers;
+    int nn_players;
+public:
+    SrsFanoutPool();
+    virtual ~SrsFanoutPool();
+public:
+    // Start the fanout threads if enabled.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start();
+    // Whether the fanout threads are started.
+    virtual bool enabled();
+    // Hand over the player to a fanout thread, which writes the messages of source to the fd.
+    // @param fd The fd duplicated by caller, which is owned by pool, even if failed.
+    // @param last_time The timestamp in ms of last message written by player.
+    virtual srs_error_t handover(SrsSource* source, SrsRequest* req, int fd, int64_t last_time, SrsFanoutPlayer** pplayer);
+    // Remove the player from thread, return false if the ring is full, user should retry it.
+    virtual bool remove(SrsFanoutPlayer* player);
+    // Free the player which is removed by thread.
+    virtual void release(SrsFanoutPlayer* player);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+public:
+    // Called by fanout thread when messages written, players closed or removed.
+    virtual void on_thread_done(std::vector<SrsSharedPtrMessage*>& dmsgs, std::vector<SrsFanoutPlayer*>& dclosed,
+        std::vector<SrsFanoutPlayer*>& dremoved);
+private:
+    // Consume the done messages and players from threads.
+    virtual void consume();
+};
+
+// The global fanout pool.
+extern SrsFanoutPool* _srs_fanout;
+
+#endif
+
@@ -80,6 +80,12 @@ SrsFFMPEG::~SrsFFMPEG()
     stop();
     
     srs_freep(process);
+    
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        SrsFFMPEG* rendition = renditions[i];
+        srs_freep(rendition);
+    }
+    renditions.clear();
 }
 
 void SrsFFMPEG::append_iparam(string iparam)
@@ -97,6 +103,23 @@ string SrsFFMPEG::output()
     return _output;
 }
 
+vector<string> SrsFFMPEG::outputs()
+{
+    vector<string> v;
+    v.push_back(_output);
+    
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        v.push_back(renditions[i]->output());
+    }
+    
+    return v;
+}
+
+void SrsFFMPEG::append_rendition(SrsFFMPEG* rendition)
+{
+    renditions.push_back(rendition);
+}
+
 srs_error_t SrsFFMPEG::initialize(string in, string out, string log)
 {
     srs_error_t err = srs_success;
@@ -191,7 +214,8 @@ srs_error_t SrsFFMPEG::initialize_transcode(SrsConfDirective* engine)
     // for not rtmp input, donot append the iformat,
     // for example, "-f flv" before "-i udp://192.168.1.252:2222"
     // @see https://github.com/ossrs/srs/issues/290
-    if (!srs_string_starts_with(input, "rtmp://")) {
+    // @remark The feed of unix domain socket is also FLV.
+    if (!srs_string_starts_with(input, "rtmp://") && !srs_string_starts_with(input, "unix:")) {
         iformat = "";
     }
     
@@ -268,50 +292,78 @@ srs_error_t SrsFFMPEG::start()
         }
     }
     
+    // The outputs, the renditions share the decoded input.
+    build_output(params);
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        renditions[i]->build_output(params);
+    }
+    
+    // when specified the log file.
+    if (!log_file.empty()) {
+        // stdout
+        params.push_back("1");
+        params.push_back(">");
+        params.push_back(log_file);
+        // stderr
+        params.push_back("2");
+        params.push_back(">");
+        params.push_back(log_file);
+    }
+    
+    // initialize the process.
+    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
+        return srs_error_wrap(err, "init process");
+    }
+    
+    return process->start();
+}
+
+void SrsFFMPEG::build_output(vector<string>& argv)
+{
     // video specified.
     if (vcodec != SRS_RTMP_ENCODER_NO_VIDEO) {
-        params.push_back("-vcodec");
-        params.push_back(vcodec);
+        argv.push_back("-vcodec");
+        argv.push_back(vcodec);
     } else {
-        params.push_back("-vn");
+        argv.push_back("-vn");
     }
     
     // the codec params is disabled when copy
     if (vcodec != SRS_RTMP_ENCODER_COPY && vcodec != SRS_RTMP_ENCODER_NO_VIDEO) {
         if (vbitrate > 0) {
-            params.push_back("-b:v");
-            params.push_back(srs_int2str(vbitrate * 1000));
+            argv.push_back("-b:v");
+            argv.push_back(srs_int2str(vbitrate * 1000));
         }
         
         if (vfps > 0) {
-            params.push_back("-r");
-            params.push_back(srs_float2str(vfps));
+            argv.push_back("-r");
+            argv.push_back(srs_float2str(vfps));
         }
         
         if (vwidth > 0 && vheight > 0) {
-            params.push_back("-s");
-            params.push_back(srs_int2str(vwidth) + "x" + srs_int2str(vheight));
+            argv.push_back("-s");
+            argv.push_back(srs_int2str(vwidth) + "x" + srs_int2str(vheight));
         }
         
         // TODO: add aspect if needed.
         if (vwidth > 0 && vheight > 0) {
-            params.push_back("-aspect");
-            params.push_back(srs_int2str(vwidth) + ":" + srs_int2str(vheight));
+            argv.push_back("-aspect");
+            argv.push_back(srs_int2str(vwidth) + ":" + srs_int2str(vheight));
         }
         
         if (vthreads > 0) {
-            params.push_back("-threads");
-            params.push_back(srs_int2str(vthreads));
+            argv.push_back("-threads");
+            argv.push_back(srs_int2str(vthreads));
         }
         
         if (!vprofile.empty()) {
-            params.push_back("-profile:v");
-            params.push_back(vprofile);
+            argv.push_back("-profile:v");
+            argv.push_back(vprofile);
         }
         
         if (!vpreset.empty()) {
-            params.push_back("-preset");
-            params.push_back(vpreset);
+            argv.push_back("-preset");
+            argv.push_back(vpreset);
         }
         
         // vparams
@@ -320,7 +372,7 @@ srs_error_t SrsFFMPEG::start()
             for (it = vparams.begin(); it != vparams.end(); ++it) {
                 std::string p = *it;
                 if (!p.empty()) {
-                    params.push_back(p);
+                    argv.push_back(p);
                 }
             }
         }
@@ -328,28 +380,28 @@ srs_error_t SrsFFMPEG::start()
     
     // audio specified.
     if (acodec != SRS_RTMP_ENCODER_NO_AUDIO) {
-        params.push_back("-acodec");
-        params.push_back(acodec);
+        argv.push_back("-acodec");
+        argv.push_back(acodec);
     } else {
-        params.push_back("-an");
+        argv.push_back("-an");
     }
     
     // the codec params is disabled when copy
     if (acodec != SRS_RTMP_ENCODER_NO_AUDIO) {
         if (acodec != SRS_RTMP_ENCODER_COPY) {
             if (abitrate > 0) {
-                params.push_back("-b:a");
-                params.push_back(srs_int2str(abitrate * 1000));
+                argv.push_back("-b:a");
+                argv.push_back(srs_int2str(abitrate * 1000));
             }
             
             if (asample_rate > 0) {
-                params.push_back("-ar");
-                params.push_back(srs_int2str(asample_rate));
+                argv.push_back("-ar");
+                argv.push_back(srs_int2str(asample_rate));
             }
             
             if (achannels > 0) {
-                params.push_back("-ac");
-                params.push_back(srs_int2str(achannels));
+                argv.push_back("-ac");
+                argv.push_back(srs_int2str(achannels));
             }
             
             // aparams
@@ -357,7 +409,7 @@ srs_error_t SrsFFMPEG::start()
             for (it = aparams.begin(); it != aparams.end(); ++it) {
                 std::string p = *it;
                 if (!p.empty()) {
-                    params.push_back(p);
+                    argv.push_back(p);
                 }
             }
         } else {
@@ -369,8 +421,8 @@ srs_error_t SrsFFMPEG::start()
                 if (pn == "-bsf:a" && i < (int)aparams.size()) {
                     std::string pv = aparams[i++];
                     if (pv == "aac_adtstoasc") {
-                        params.push_back(pn);
-                        params.push_back(pv);
+                        argv.push_back(pn);
+                        argv.push_back(pv);
                     }
                 }
             }
@@ -379,31 +431,12 @@ srs_error_t SrsFFMPEG::start()
     
     // output
     if (oformat != "off" && !oformat.empty()) {
-        params.push_back("-f");
-        params.push_back(oformat);
+        argv.push_back("-f");
+        argv.push_back(oformat);
     }
     
-    params.push_back("-y");
-    params.push_back(_output);
-    
-    // when specified the log file.
-    if (!log_file.empty()) {
-        // stdout
-        params.push_back("1");
-        params.push_back(">");
-        params.push_back(log_file);
-        // stderr
-        params.push_back("2");
-        params.push_back(">");
-        params.push_back(log_file);
-    }
-    
-    // initialize the process.
-    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
-        return srs_error_wrap(err, "init process");
-    }
-    
-    return process->start();
+    argv.push_back("-y");
+    argv.push_back(_output);
 }
 
 srs_error_t SrsFFMPEG::cycle()
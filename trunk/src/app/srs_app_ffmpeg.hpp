@@ -66,6 +66,9 @@ private:
     std::vector<std::string>    aparams;
     std::string                 oformat;
     std::string                 _output;
+private:
+    // The renditions encoded from the same decoded input, in the same process.
+    std::vector<SrsFFMPEG*>     renditions;
 public:
     SrsFFMPEG(std::string ffmpeg_bin);
     virtual ~SrsFFMPEG();
@@ -73,6 +76,13 @@ public:
     virtual void append_iparam(std::string iparam);
     virtual void set_oformat(std::string format);
     virtual std::string output();
+    // Get the output of this and all renditions.
+    virtual std::vector<std::string> outputs();
+    // Encode another rendition by this process, for example, a ladder of 4 bitrates decodes the
+    // input once, instead of 4 times by 4 processes.
+    // @remark The input, perfile and vfilter of rendition are ignored, only the encoders and output are used.
+    // @remark This ffmpeg takes the ownership of rendition.
+    virtual void append_rendition(SrsFFMPEG* rendition);
 public:
     virtual srs_error_t initialize(std::string in, std::string out, std::string log);
     virtual srs_error_t initialize_transcode(SrsConfDirective* engine);
@@ -80,6 +90,10 @@ public:
 public:
     virtual srs_error_t start();
     virtual srs_error_t cycle();
+private:
+    // Build the params of codecs and output.
+    virtual void build_output(std::vector<std::string>& argv);
+public:
     virtual void stop();
 public:
     virtual void fast_stop();
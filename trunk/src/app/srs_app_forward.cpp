@@ -27,6 +27,7 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -46,133 +47,266 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_kernel_balance.hpp>
 
-SrsForwarder::SrsForwarder(SrsOriginHub* h)
+// The mark in param of stream replicated to standby origin.
+#define SRS_STANDBY_REPLICA_MARK "srs_standby_replica"
+
+SrsForwardCursor::SrsForwardCursor()
 {
-    hub = h;
-    
-    req = NULL;
-    sh_video = sh_audio = NULL;
-    
-    sdk = NULL;
-    trd = new SrsDummyCoroutine();
-    queue = new SrsMessageQueue();
+    sequence = 0;
+    nb_drops = 0;
+}
+
+SrsForwardCursor::~SrsForwardCursor()
+{
+}
+
+SrsForwardRing::SrsForwardRing()
+{
+    av_start_time = av_end_time = -1;
+    max_queue_size = 0;
+    base = 0;
     jitter = new SrsRtmpJitter();
+    msgs = new SrsMessageRing();
 }
 
-SrsForwarder::~SrsForwarder()
+SrsForwardRing::~SrsForwardRing()
 {
-    srs_freep(sdk);
-    srs_freep(trd);
-    srs_freep(queue);
-    srs_freep(jitter);
+    clear();
     
-    srs_freep(sh_video);
-    srs_freep(sh_audio);
+    srs_freep(jitter);
+    srs_freep(msgs);
 }
 
-srs_error_t SrsForwarder::initialize(SrsRequest* r, string ep)
+void SrsForwardRing::set_queue_size(srs_utime_t queue_size)
 {
-    srs_error_t err = srs_success;
-    
-    // it's ok to use the request object,
-    // SrsSource already copy it and never delete it.
-    req = r;
-    
-    // the ep(endpoint) to forward to
-    ep_forward = ep;
-    
-    return err;
+    max_queue_size = queue_size;
 }
 
-void SrsForwarder::set_queue_size(srs_utime_t queue_size)
+int SrsForwardRing::size()
 {
-    queue->set_queue_size(queue_size);
+    return msgs->size();
 }
 
-srs_error_t SrsForwarder::on_publish()
+void SrsForwardRing::set_memory(SrsMemoryStat* v)
 {
-    srs_error_t err = srs_success;
-    
-    srs_freep(trd);
-    trd = new SrsSTCoroutine("forward", this);
-    if ((err = trd->start()) != srs_success) {
-        return srs_error_wrap(err, "start thread");
-    }
-    
-    return err;
+    msgs->set_memory(v);
 }
 
-void SrsForwarder::on_unpublish()
+void SrsForwardRing::attach(SrsForwardCursor* cursor)
 {
-    trd->stop();
-    sdk->close();
+    cursor->sequence = base + msgs->size();
+    cursors.push_back(cursor);
+}
+
+void SrsForwardRing::detach(SrsForwardCursor* cursor)
+{
+    std::vector<SrsForwardCursor*>::iterator it = std::find(cursors.begin(), cursors.end(), cursor);
+    if (it != cursors.end()) {
+        cursors.erase(it);
+    }
+    
+    // Free all messages when no forwarder, or remove the messages only pinned by the cursor.
+    if (cursors.empty()) {
+        clear();
+    } else {
+        trim();
+    }
 }
 
-srs_error_t SrsForwarder::on_meta_data(SrsSharedPtrMessage* shared_metadata)
+srs_error_t SrsForwardRing::enqueue(SrsSharedPtrMessage* shared_msg)
 {
     srs_error_t err = srs_success;
     
-    SrsSharedPtrMessage* metadata = shared_metadata->copy();
+    // No forwarder to read it.
+    if (cursors.empty()) {
+        return err;
+    }
+    
+    SrsSharedPtrMessage* msg = shared_msg->copy();
     
     // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(metadata, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
+    if ((err = jitter->correct(msg, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
+        srs_freep(msg);
         return srs_error_wrap(err, "jitter");
     }
     
-    if ((err = queue->enqueue(metadata)) != srs_success) {
-        return srs_error_wrap(err, "enqueue metadata");
+    if (msg->is_av()) {
+        if (av_start_time == -1) {
+            av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+        }
+        av_end_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+    }
+    
+    msgs->push_back(msg);
+    
+    while (!msgs->empty() && av_end_time - av_start_time > max_queue_size) {
+        shrink();
     }
     
     return err;
 }
 
-srs_error_t SrsForwarder::on_audio(SrsSharedPtrMessage* shared_audio)
+srs_error_t SrsForwardRing::dump_packets(SrsForwardCursor* cursor, int max_count, SrsSharedPtrMessage** pmsgs, int& count, bool& resync)
 {
     srs_error_t err = srs_success;
     
-    SrsSharedPtrMessage* msg = shared_audio->copy();
+    count = 0;
+    resync = false;
     
-    // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(msg, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
-        return srs_error_wrap(err, "jitter");
+    // The messages of cursor are shrinked, skip to the first message of ring.
+    if (cursor->sequence < base) {
+        cursor->nb_drops += base - cursor->sequence;
+        cursor->sequence = base;
+        resync = true;
     }
     
-    if (SrsFlvAudio::sh(msg->payload, msg->size)) {
-        srs_freep(sh_audio);
-        sh_audio = msg->copy();
+    int offset = (int)(cursor->sequence - base);
+    int nb_msgs = srs_min(max_count, msgs->size() - offset);
+    for (int i = 0; i < nb_msgs; i++) {
+        pmsgs[count++] = msgs->at(offset + i)->copy();
     }
+    cursor->sequence += count;
     
-    if ((err = queue->enqueue(msg)) != srs_success) {
-        return srs_error_wrap(err, "enqueue audio");
+    if (count > 0) {
+        trim();
     }
     
     return err;
 }
 
-srs_error_t SrsForwarder::on_video(SrsSharedPtrMessage* shared_video)
+void SrsForwardRing::clear()
 {
-    srs_error_t err = srs_success;
+    base += msgs->size();
+    msgs->free();
+    av_start_time = av_end_time = -1;
+}
+
+void SrsForwardRing::shrink()
+{
+    // Keep the last gop, or remove all msgs if no keyframe or the gop is too large.
+    int nb_remove = msgs->last_keyframe();
+    if (nb_remove <= 0) {
+        nb_remove = msgs->size();
+    }
     
-    SrsSharedPtrMessage* msg = shared_video->copy();
+    msgs->erase_front(nb_remove);
+    base += nb_remove;
     
-    // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(msg, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
-        return srs_error_wrap(err, "jitter");
+    update_start_time();
+}
+
+void SrsForwardRing::trim()
+{
+    int64_t sequence = base + msgs->size();
+    
+    std::vector<SrsForwardCursor*>::iterator it;
+    for (it = cursors.begin(); it != cursors.end(); ++it) {
+        SrsForwardCursor* cursor = *it;
+        sequence = srs_min(sequence, cursor->sequence);
     }
     
-    if (SrsFlvVideo::sh(msg->payload, msg->size)) {
-        srs_freep(sh_video);
-        sh_video = msg->copy();
+    if (sequence <= base) {
+        return;
     }
     
-    if ((err = queue->enqueue(msg)) != srs_success) {
-        return srs_error_wrap(err, "enqueue video");
+    msgs->erase_front((int)(sequence - base));
+    base = sequence;
+    
+    update_start_time();
+}
+
+void SrsForwardRing::update_start_time()
+{
+    if (msgs->empty()) {
+        av_start_time = av_end_time;
+        return;
     }
     
+    for (int i = 0; i < msgs->size(); i++) {
+        SrsSharedPtrMessage* msg = msgs->at(i);
+        if (msg->is_av()) {
+            av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+            return;
+        }
+    }
+}
+
+SrsLbServerStats* _srs_forward_destinations = new SrsLbServerStats();
+
+SrsForwarder::SrsForwarder(SrsOriginHub* h, SrsForwardRing* r)
+{
+    hub = h;
+    ring = r;
+    
+    req = NULL;
+    relay = false;
+    replica = false;
+    
+    sdk = NULL;
+    trd = new SrsDummyCoroutine();
+    cursor = new SrsForwardCursor();
+}
+
+SrsForwarder::~SrsForwarder()
+{
+    ring->detach(cursor);
+    
+    srs_freep(sdk);
+    srs_freep(trd);
+    srs_freep(cursor);
+    
+    free_headers();
+}
+
+srs_error_t SrsForwarder::initialize(SrsRequest* r, string ep, bool relay_to_worker, bool replicate_to_standby)
+{
+    srs_error_t err = srs_success;
+    
+    // it's ok to use the request object,
+    // SrsSource already copy it and never delete it.
+    req = r;
+    
+    // the ep(endpoint) to forward to
+    ep_forward = ep;
+    relay = relay_to_worker;
+    replica = replicate_to_standby;
+    
     return err;
 }
 
+srs_error_t SrsForwarder::on_publish()
+{
+    srs_error_t err = srs_success;
+    
+    // Read the messages from now on, before connected to server.
+    ring->detach(cursor);
+    ring->attach(cursor);
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("forward", this);
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start thread");
+    }
+    
+    return err;
+}
+
+void SrsForwarder::on_unpublish()
+{
+    trd->stop();
+    if (sdk) {
+        sdk->close();
+    }
+}
+
+void SrsForwarder::on_sequence_header(SrsSharedPtrMessage* shared_msg)
+{
+    headers.push_back(shared_msg->copy());
+}
+
 // when error, forwarder sleep for a while and retry.
 #define SRS_FORWARDER_CIMS (3 * SRS_UTIME_SECONDS)
 
@@ -210,16 +344,33 @@ srs_error_t SrsForwarder::do_cycle()
         // parse host:port from hostport.
         srs_parse_hostport(ep_forward, server, port);
         
-        // generate url
-        url = srs_generate_rtmp_url(server, port, req->host, req->vhost, req->app, req->stream, req->param);
+        // generate url, mark the relay stream for sibling worker never relay it again.
+        std::string param = relay? srs_worker_relay_param(req->param) : req->param;
+        if (replica) {
+            param = srs_standby_replica_param(param);
+        }
+        url = srs_generate_rtmp_url(server, port, req->host, req->vhost, req->app, req->stream, param);
+    }
+    
+    // Never connect the destination failed recently, until its backoff elapsed.
+    SrsLbServerStat* stat = _srs_forward_destinations->fetch(ep_forward);
+    srs_utime_t now = srs_get_system_time();
+    if (!stat->is_healthy(now)) {
+        return srs_error_new(ERROR_ST_CONNECT, "destination %s is down for %dms, failures=%d", ep_forward.c_str(),
+            srsu2msi(stat->down_until - now), stat->failures);
     }
     
     srs_freep(sdk);
     srs_utime_t cto = SRS_FORWARDER_CIMS;
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
-    sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
-    if ((err = sdk->connect()) != srs_success) {
+    // The destination races alone, for the stat of failures.
+    SrsRtmpConnectRacer racer(_srs_forward_destinations, 0);
+    racer.add(ep_forward, url, cto, sto);
+    
+    std::string winner;
+    srs_utime_t rtt = 0;
+    if ((err = racer.race(&sdk, winner, rtt)) != srs_success) {
         return srs_error_wrap(err, "sdk connect url=%s, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
     
@@ -227,10 +378,6 @@ srs_error_t SrsForwarder::do_cycle()
         return srs_error_wrap(err, "sdk publish");
     }
     
-    if ((err = hub->on_forwarder_start(this)) != srs_success) {
-        return srs_error_wrap(err, "notify hub start");
-    }
-    
     if ((err = forward()) != srs_success) {
         return srs_error_wrap(err, "forward");
     }
@@ -252,15 +399,8 @@ srs_error_t SrsForwarder::forward()
     
     // update sequence header
     // TODO: FIXME: maybe need to zero the sequence header timestamp.
-    if (sh_video) {
-        if ((err = sdk->send_and_free_message(sh_video->copy())) != srs_success) {
-            return srs_error_wrap(err, "send video sh");
-        }
-    }
-    if (sh_audio) {
-        if ((err = sdk->send_and_free_message(sh_audio->copy())) != srs_success) {
-            return srs_error_wrap(err, "send audio sh");
-        }
+    if ((err = send_headers()) != srs_success) {
+        return srs_error_wrap(err, "send headers");
     }
     
     while (true) {
@@ -286,13 +426,27 @@ srs_error_t SrsForwarder::forward()
         // forward all messages.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
         int count = 0;
-        if ((err = queue->dump_packets(msgs.max, msgs.msgs, count)) != srs_success) {
+        bool resync = false;
+        if ((err = ring->dump_packets(cursor, msgs.max, msgs.msgs, count, resync)) != srs_success) {
             return srs_error_wrap(err, "dump packets");
         }
         
+        // The forwarder is too slow and skipped some messages, resend the sequence headers.
+        if (resync) {
+            if ((err = send_headers()) != srs_success) {
+                for (int i = 0; i < count; i++) {
+                    srs_freep(msgs.msgs[i]);
+                }
+                return srs_error_wrap(err, "resend headers");
+            }
+        }
+        
         // pithy print
         if (pprint->can_print()) {
             sdk->kbps_sample(SRS_CONSTS_LOG_FOWARDER, pprint->age(), count);
+            if (cursor->nb_drops) {
+                srs_trace("-> " SRS_CONSTS_LOG_FOWARDER " slow forwarder, ring=%d, drop=%" PRId64, ring->size(), cursor->nb_drops);
+            }
         }
         
         // ignore when no messages.
@@ -309,4 +463,76 @@ srs_error_t SrsForwarder::forward()
     return err;
 }
 
+srs_error_t SrsForwarder::send_headers()
+{
+    srs_error_t err = srs_success;
+    
+    // Request the metadata and sequence headers from hub.
+    free_headers();
+    if ((err = hub->on_forwarder_start(this)) != srs_success) {
+        return srs_error_wrap(err, "notify hub start");
+    }
+    
+    for (int i = 0; i < (int)headers.size(); i++) {
+        SrsSharedPtrMessage* msg = headers.at(i);
+        headers.at(i) = NULL;
+        
+        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+            free_headers();
+            return srs_error_wrap(err, "send header");
+        }
+    }
+    headers.clear();
+    
+    return err;
+}
+
+void SrsForwarder::free_headers()
+{
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = headers.begin(); it != headers.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    headers.clear();
+}
+
+string srs_standby_replica_param(string param)
+{
+    if (param.empty()) {
+        return "?" SRS_STANDBY_REPLICA_MARK "=1";
+    }
+    return param + "&" SRS_STANDBY_REPLICA_MARK "=1";
+}
+
+bool srs_standby_is_replica(SrsRequest* req)
+{
+    return req && srs_string_contains(req->param, SRS_STANDBY_REPLICA_MARK "=");
+}
+
+string srs_standby_strip_replica_param(string param)
+{
+    return srs_query_remove(param, SRS_STANDBY_REPLICA_MARK);
+}
+
+bool srs_standby_is_peer(string vhost, string ip)
+{
+    vector<string> peers = _srs_config->get_vhost_standby(vhost);
+    for (int i = 0; i < (int)peers.size(); i++) {
+        std::string host;
+        int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        srs_parse_hostport(peers.at(i), host, port);
+        
+        if (host == ip) {
+            return true;
+        }
+        
+        int family = 0;
+        if (srs_dns_resolve(host, family) == ip) {
+            return true;
+        }
+    }
+    
+    return false;
+}
 
@@ -27,6 +27,7 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
 
 #include <srs_app_st.hpp>
 #include <srs_app_thread.hpp>
@@ -34,7 +35,6 @@
 class ISrsProtocolReadWriter;
 class SrsSharedPtrMessage;
 class SrsOnMetaDataPacket;
-class SrsMessageQueue;
 class SrsRtmpJitter;
 class SrsRtmpClient;
 class SrsRequest;
@@ -42,6 +42,73 @@ class SrsSource;
 class SrsOriginHub;
 class SrsKbps;
 class SrsSimpleRtmpClient;
+class SrsMessageRing;
+class SrsMemoryStat;
+class SrsLbServerStats;
+
+// The stat of forward destinations, shared by all forwarders, to backoff the destinations failed recently.
+extern SrsLbServerStats* _srs_forward_destinations;
+
+// The read cursor of a forwarder on the shared forward ring.
+class SrsForwardCursor
+{
+public:
+    // The sequence of the next message to read.
+    int64_t sequence;
+    // The total messages skipped, because the forwarder is too slow.
+    int64_t nb_drops;
+public:
+    SrsForwardCursor();
+    virtual ~SrsForwardCursor();
+};
+
+// The ring of messages shared by all forwarders of a source. The hub enqueues each message once,
+// and each forwarder reads it by its own cursor, so the memory never multiplies by the number of
+// destinations. The messages read by all cursors are removed, and when the ring exceeds the queue
+// size, it shrinks to the last gop, the slow forwarder skips to it and resends the sequence headers.
+// @remark The messages are shared ptr, so their cached chunk headers are reused by all destinations.
+class SrsForwardRing
+{
+private:
+    // The start and end time of av messages.
+    srs_utime_t av_start_time;
+    srs_utime_t av_end_time;
+    // The max queue size, shrink if exceed it.
+    srs_utime_t max_queue_size;
+    SrsRtmpJitter* jitter;
+    // The sequence of the first message in ring.
+    int64_t base;
+    SrsMessageRing* msgs;
+    std::vector<SrsForwardCursor*> cursors;
+public:
+    SrsForwardRing();
+    virtual ~SrsForwardRing();
+public:
+    virtual void set_queue_size(srs_utime_t queue_size);
+    // Get the number of messages in ring.
+    virtual int size();
+    // Report the bytes of ring to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
+    // Attach the cursor, which reads from the next enqueued message.
+    virtual void attach(SrsForwardCursor* cursor);
+    virtual void detach(SrsForwardCursor* cursor);
+public:
+    // Enqueue the message for all forwarders.
+    // @param shared_msg, directly ptr, copy it if need to save it.
+    virtual srs_error_t enqueue(SrsSharedPtrMessage* shared_msg);
+    // Get the messages for the cursor, user should free the messages in pmsgs.
+    // @param resync, output whether the cursor skipped the shrinked messages, so the sequence
+    //      headers should be sent again.
+    virtual srs_error_t dump_packets(SrsForwardCursor* cursor, int max_count, SrsSharedPtrMessage** pmsgs, int& count, bool& resync);
+    // Free all messages in ring.
+    virtual void clear();
+private:
+    // Remove the messages before the last keyframe, or all if no keyframe.
+    virtual void shrink();
+    // Remove the messages read by all cursors.
+    virtual void trim();
+    virtual void update_start_time();
+};
 
 // Forward the stream to other servers.
 class SrsForwarder : public ISrsCoroutineHandler
@@ -50,35 +117,33 @@ private:
     // The ep to forward, server[:port].
     std::string ep_forward;
     SrsRequest* req;
+    // Whether relay to the sibling worker, mark the stream to avoid relay loop.
+    bool relay;
+    // Whether replicate to the standby origin, mark the stream as replica.
+    bool replica;
 private:
     SrsCoroutine* trd;
 private:
     SrsOriginHub* hub;
     SrsSimpleRtmpClient* sdk;
-    SrsRtmpJitter* jitter;
-    SrsMessageQueue* queue;
-    // Cache the sequence header for retry when slave is failed.
+    // The shared ring of hub, and the cursor of this forwarder.
+    SrsForwardRing* ring;
+    SrsForwardCursor* cursor;
+    // The metadata and sequence headers to send before the messages of ring, fed by hub when
+    // connected to server or the cursor skipped the shrinked messages.
     // @see https://github.com/ossrs/srs/issues/150
-    SrsSharedPtrMessage* sh_audio;
-    SrsSharedPtrMessage* sh_video;
+    std::vector<SrsSharedPtrMessage*> headers;
 public:
-    SrsForwarder(SrsOriginHub* h);
+    SrsForwarder(SrsOriginHub* h, SrsForwardRing* r);
     virtual ~SrsForwarder();
 public:
-    virtual srs_error_t initialize(SrsRequest* r, std::string ep);
-    virtual void set_queue_size(srs_utime_t queue_size);
+    virtual srs_error_t initialize(SrsRequest* r, std::string ep, bool relay_to_worker, bool replicate_to_standby);
 public:
     virtual srs_error_t on_publish();
     virtual void on_unpublish();
-    // Forward the audio packet.
-    // @param shared_metadata, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* shared_metadata);
-    // Forward the audio packet.
-    // @param shared_audio, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_audio(SrsSharedPtrMessage* shared_audio);
-    // Forward the video packet.
-    // @param shared_video, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_video(SrsSharedPtrMessage* shared_video);
+    // Feed the metadata or sequence header, sent before the messages of ring.
+    // @param shared_msg, directly ptr, copy it if need to save it.
+    virtual void on_sequence_header(SrsSharedPtrMessage* shared_msg);
 // Interface ISrsReusableThread2Handler.
 public:
     virtual srs_error_t cycle();
@@ -86,7 +151,19 @@ private:
     virtual srs_error_t do_cycle();
 private:
     virtual srs_error_t forward();
+    virtual srs_error_t send_headers();
+    virtual void free_headers();
 };
 
+// Append the replica mark to the stream param, for the stream is replicated to standby origin.
+extern std::string srs_standby_replica_param(std::string param);
+// Whether the request is replicated from another origin, which should never replicate or forward it again.
+// @remark The mark is only trusted from the standby peers, see srs_standby_is_peer.
+extern bool srs_standby_is_replica(SrsRequest* req);
+// Strip the replica mark from the stream param, for the client is not a standby peer.
+extern std::string srs_standby_strip_replica_param(std::string param);
+// Whether the ip of client is one of the standby peers of vhost, which replicates the stream to us.
+extern bool srs_standby_is_peer(std::string vhost, std::string ip);
+
 #endif
 
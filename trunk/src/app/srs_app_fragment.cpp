@@ -26,6 +26,8 @@
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_http_static.hpp>
 
 #include <unistd.h>
 #include <sstream>
@@ -92,7 +94,9 @@ srs_error_t SrsFragment::unlink_file()
 {
     srs_error_t err = srs_success;
     
-    if (::unlink(filepath.c_str()) < 0) {
+    _srs_http_file_meta->invalidate(filepath);
+    
+    if (_srs_disk_io->unlink(filepath) < 0) {
         return srs_error_new(ERROR_SYSTEM_FRAGMENT_UNLINK, "unlink %s", filepath.c_str());
     }
     
@@ -105,7 +109,7 @@ srs_error_t SrsFragment::create_dir()
     
     std::string segment_dir = srs_path_dirname(filepath);
     
-    if ((err = srs_create_dir_recursively(segment_dir)) != srs_success) {
+    if ((err = _srs_disk_io->create_dir(segment_dir)) != srs_success) {
         return srs_error_wrap(err, "create %s", segment_dir.c_str());
     }
     
@@ -144,7 +148,8 @@ srs_error_t SrsFragment::rename()
 	   full_path = srs_string_replace(full_path, "[duration]", ss.str());
     }
 
-    int r0 = ::rename(tmp_file.c_str(), full_path.c_str());
+    int r0 = _srs_disk_io->rename(tmp_file, full_path);
+    _srs_http_file_meta->invalidate(full_path);
     if (r0 < 0) {
         return srs_error_new(ERROR_SYSTEM_FRAGMENT_RENAME, "rename %s to %s", tmp_file.c_str(), full_path.c_str());
     }
@@ -281,3 +286,61 @@ SrsFragment* SrsFragmentWindow::at(int index)
     return fragments.at(index);
 }
 
+
+SrsFragmenter::SrsFragmenter()
+{
+    fragment = 0;
+    start = last = -1;
+    has_video = false;
+    nn_fragments = 0;
+}
+
+SrsFragmenter::~SrsFragmenter()
+{
+}
+
+void SrsFragmenter::initialize(srs_utime_t v)
+{
+    fragment = v;
+    start = last = -1;
+    has_video = false;
+    nn_fragments = 0;
+}
+
+bool SrsFragmenter::on_frame(int64_t dts, bool video, bool keyframe)
+{
+    has_video = has_video || video;
+    
+    if (start < 0) {
+        start = last = dts;
+        nn_fragments++;
+        return false;
+    }
+    
+    // The video fragment always starts at keyframe, and audio is ignored.
+    bool reap = duration() >= fragment;
+    if (has_video) {
+        reap = reap && video && keyframe;
+    }
+    
+    if (reap) {
+        start = dts;
+        nn_fragments++;
+    }
+    last = dts;
+    
+    return reap;
+}
+
+srs_utime_t SrsFragmenter::duration()
+{
+    if (start < 0 || last < start) {
+        return 0;
+    }
+    return (last - start) * SRS_UTIME_MILLISECONDS;
+}
+
+int64_t SrsFragmenter::count()
+{
+    return nn_fragments;
+}
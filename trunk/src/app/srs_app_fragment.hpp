@@ -101,5 +101,36 @@ public:
     virtual SrsFragment* at(int index);
 };
 
+// The keyframe-aligned fragmenter, which decides the boundaries of fragments, so the writers of formats,
+// for example, DASH and HDS, only serialize the samples to container.
+// A new fragment starts at a video keyframe when the duration is reached, or at any frame for pure audio.
+class SrsFragmenter
+{
+private:
+    // The duration in srs_utime_t to start a new fragment.
+    srs_utime_t fragment;
+    // The dts in ms of the first and last frame of current fragment, -1 for no frame.
+    int64_t start;
+    int64_t last;
+    // Whether got any video, then the fragment is aligned to keyframe.
+    bool has_video;
+    // The number of fragments started.
+    int64_t nn_fragments;
+public:
+    SrsFragmenter();
+    virtual ~SrsFragmenter();
+public:
+    // Reset the fragmenter, with the duration of fragment.
+    virtual void initialize(srs_utime_t v);
+    // Feed a frame with dts in ms, return true if a new fragment starts at this frame, that is,
+    // the current fragment should be reaped before the frame is written.
+    // @remark The first fragment starts at the first frame, which is not a boundary.
+    virtual bool on_frame(int64_t dts, bool video, bool keyframe);
+    // The duration of current fragment, from the first to the last frame.
+    virtual srs_utime_t duration();
+    // The number of fragments started.
+    virtual int64_t count();
+};
+
 #endif
 
@@ -30,6 +30,7 @@
 #include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 using namespace std;
 
@@ -42,6 +43,9 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_config.hpp>
+#include <srs_app_fragment.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_kernel_file.hpp>
 
 static void update_box(char *start, int size)
 {
@@ -52,213 +56,161 @@ static void update_box(char *start, int size)
     start[3] = p_size[0];
 }
 
-char flv_header[] = {'F', 'L', 'V',
-    0x01, 0x05, 0x00, 0x00, 0x00, 0x09,
-    0x00, 0x00, 0x00, 0x00};
+// The size of FLV tag header and previous tag size.
+#define SRS_HDS_TAG_HEADER 11
+#define SRS_HDS_TAG_SIZE 4
 
-string serialFlv(SrsSharedPtrMessage *msg)
+// The HDS fragment, an mdat box of FLV tags, where the samples are the messages of fragment.
+class SrsHdsFragment : public SrsFragment
 {
-    int size = 15 + msg->size;
-    char *byte = new char[size];
-    
-    SrsBuffer *stream = new SrsBuffer(byte, size);
-    SrsAutoFree(SrsBuffer, stream);
-    
-    // tag header
-    long long dts = msg->timestamp;
-    char type = msg->is_video() ? 0x09 : 0x08;
-    
-    stream->write_1bytes(type);
-    stream->write_3bytes(msg->size);
-    stream->write_3bytes((int32_t)dts);
-    stream->write_1bytes(dts >> 24 & 0xFF);
-    stream->write_3bytes(0);
-    stream->write_bytes(msg->payload, msg->size);
-    
-    // pre tag size
-    int preTagSize = msg->size + 11;
-    stream->write_4bytes(preTagSize);
-    
-    string ret(stream->data(), stream->size());
-    
-    delete [] byte;
-    
-    return ret;
+private:
+    int index;
+    int64_t start_time;
+    std::vector<SrsSharedPtrMessage*> msgs;
+    SrsSharedPtrMessage* video_sh;
+    SrsSharedPtrMessage* audio_sh;
+public:
+    SrsHdsFragment(int idx, int64_t st, SrsSharedPtrMessage* vsh, SrsSharedPtrMessage* ash);
+    virtual ~SrsHdsFragment();
+public:
+    // Write the sample to fragment, which is serialized when flush.
+    virtual void write(SrsSharedPtrMessage* msg);
+    // Serialize the samples to the mdat box, write to the tmp file then rename it.
+    virtual srs_error_t flush();
+    virtual int get_index();
+    virtual int64_t get_start_time();
+private:
+    virtual srs_error_t write_tag(SrsFileWriter* fw, SrsSharedPtrMessage* msg, int64_t timestamp);
+};
+
+SrsHdsFragment::SrsHdsFragment(int idx, int64_t st, SrsSharedPtrMessage* vsh, SrsSharedPtrMessage* ash)
+{
+    index = idx;
+    start_time = st;
+    video_sh = vsh ? vsh->copy() : NULL;
+    audio_sh = ash ? ash->copy() : NULL;
 }
 
-class SrsHdsFragment
+SrsHdsFragment::~SrsHdsFragment()
 {
-public:
-    SrsHdsFragment(SrsRequest *r)
-    : req(r)
-    , index(-1)
-    , start_time(0)
-    , videoSh(NULL)
-    , audioSh(NULL)
-    {
-        
-    }
+    srs_freep(video_sh);
+    srs_freep(audio_sh);
     
-    ~SrsHdsFragment()
-    {
-        srs_freep(videoSh);
-        srs_freep(audioSh);
-        
-        // clean msgs
-        list<SrsSharedPtrMessage *>::iterator iter;
-        for (iter = msgs.begin(); iter != msgs.end(); ++iter) {
-            SrsSharedPtrMessage *msg = *iter;
-            srs_freep(msg);
-        }
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
     }
+}
+
+void SrsHdsFragment::write(SrsSharedPtrMessage* msg)
+{
+    msgs.push_back(msg->copy());
+    append(msg->timestamp);
+}
+
+srs_error_t SrsHdsFragment::flush()
+{
+    srs_error_t err = srs_success;
     
-    void on_video(SrsSharedPtrMessage *msg)
-    {
-        SrsSharedPtrMessage *_msg = msg->copy();
-        msgs.push_back(_msg);
+    int64_t size = 8;
+    if (video_sh) {
+        size += SRS_HDS_TAG_HEADER + video_sh->size + SRS_HDS_TAG_SIZE;
     }
-    
-    void on_audio(SrsSharedPtrMessage *msg)
-    {
-        SrsSharedPtrMessage *_msg = msg->copy();
-        msgs.push_back(_msg);
+    if (audio_sh) {
+        size += SRS_HDS_TAG_HEADER + audio_sh->size + SRS_HDS_TAG_SIZE;
     }
-    
-    /*!
-     flush data to disk.
-     */
-    srs_error_t flush()
-    {
-        string data;
-        if (videoSh) {
-            videoSh->timestamp = start_time;
-            data.append(serialFlv(videoSh));
-        }
-        
-        if (audioSh) {
-            audioSh->timestamp = start_time;
-            data.append(serialFlv(audioSh));
-        }
-        
-        list<SrsSharedPtrMessage *>::iterator iter;
-        for (iter = msgs.begin(); iter != msgs.end(); ++iter) {
-            SrsSharedPtrMessage *msg = *iter;
-            data.append(serialFlv(msg));
-        }
-        
-        char box_header[8];
-        SrsBuffer ss(box_header, 8);
-        ss.write_4bytes((int32_t)(8 + data.size()));
-        ss.write_string("mdat");
-        
-        data = string(ss.data(), ss.size()) + data;
-        
-        const char *file_path = path.c_str();
-        int fd = open(file_path, O_WRONLY | O_CREAT, S_IRWXU | S_IRGRP | S_IROTH);
-        if (fd < 0) {
-            return srs_error_new(-1, "open fragment file failed, path=%s", file_path);
-        }
-        
-        if (write(fd, data.data(), data.size()) != (int)data.size()) {
-            close(fd);
-            return srs_error_new(-1, "write fragment file failed, path=", file_path);
-        }
-        close(fd);
-        
-        srs_trace("build fragment success=%s", file_path);
-        
-        return srs_success;
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        size += SRS_HDS_TAG_HEADER + msg->size + SRS_HDS_TAG_SIZE;
     }
     
-    /*!
-     calc the segment duration in milliseconds.
-     @return 0 if no msgs
-     or the last msg dts minus the first msg dts.
-     */
-    int duration()
-    {
-        int duration_ms = 0;
-        long long first_msg_ts = 0;
-        long long last_msg_ts = 0;
-        
-        if (msgs.size() >= 2) {
-            SrsSharedPtrMessage *first_msg = msgs.front();
-            first_msg_ts = first_msg->timestamp;
-            
-            SrsSharedPtrMessage *last_msg = msgs.back();
-            last_msg_ts = last_msg->timestamp;
-            
-            duration_ms = (int)(last_msg_ts - first_msg_ts);
-        }
-        
-        return duration_ms;
+    if ((err = create_dir()) != srs_success) {
+        return srs_error_wrap(err, "create dir");
     }
     
-    /*!
-     set/get index
-     */
-    inline void set_index(int idx)
-    {
-        char file_path[1024] = {0};
-        snprintf(file_path, 1024, "%s/%s/%sSeg1-Frag%d", _srs_config->get_hds_path(req->vhost).c_str()
-                , req->app.c_str(), req->stream.c_str(), idx);
-        
-        path = file_path;
-        index = idx;
-    }
+    SrsFileWriter fw;
+    _srs_disk_io->attach(&fw);
     
-    inline int get_index()
-    {
-        return index;
+    string path = tmppath();
+    if ((err = fw.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open fragment %s", path.c_str());
     }
     
-    /*!
-     set/get start time
-     */
-    inline void set_start_time(long long st)
-    {
-        start_time = st;
-    }
+    char box_header[8];
+    SrsBuffer ss(box_header, 8);
+    ss.write_4bytes((int32_t)size);
+    ss.write_string("mdat");
     
-    inline long long get_start_time()
-    {
-        return start_time;
+    if ((err = fw.write(box_header, sizeof(box_header), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write mdat");
     }
     
-    void set_video_sh(SrsSharedPtrMessage *msg)
-    {
-        srs_freep(videoSh);
-        videoSh = msg->copy();
+    // The sequence headers start at the start time of fragment.
+    if (video_sh && (err = write_tag(&fw, video_sh, start_time)) != srs_success) {
+        return srs_error_wrap(err, "write video sh");
     }
-    
-    void set_audio_sh(SrsSharedPtrMessage *msg)
-    {
-        srs_freep(audioSh);
-        audioSh = msg->copy();
+    if (audio_sh && (err = write_tag(&fw, audio_sh, start_time)) != srs_success) {
+        return srs_error_wrap(err, "write audio sh");
     }
     
-    string fragment_path()
-    {
-        return path;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        if ((err = write_tag(&fw, msg, msg->timestamp)) != srs_success) {
+            return srs_error_wrap(err, "write tag");
+        }
     }
+    fw.close();
     
-private:
-    SrsRequest *req;
-    list<SrsSharedPtrMessage *> msgs;
+    if ((err = rename()) != srs_success) {
+        return srs_error_wrap(err, "rename");
+    }
     
-    /*!
-     the index of this fragment
-     */
-    int index;
-    long long start_time;
+    srs_trace("build fragment success=%s", fullpath().c_str());
     
-    SrsSharedPtrMessage *videoSh;
-    SrsSharedPtrMessage *audioSh;
-    string path;
-};
+    return err;
+}
+
+int SrsHdsFragment::get_index()
+{
+    return index;
+}
+
+int64_t SrsHdsFragment::get_start_time()
+{
+    return start_time;
+}
+
+srs_error_t SrsHdsFragment::write_tag(SrsFileWriter* fw, SrsSharedPtrMessage* msg, int64_t timestamp)
+{
+    char header[SRS_HDS_TAG_HEADER];
+    SrsBuffer th(header, sizeof(header));
+    th.write_1bytes(msg->is_video() ? 0x09 : 0x08);
+    th.write_3bytes(msg->size);
+    th.write_3bytes((int32_t)timestamp);
+    th.write_1bytes((int8_t)(timestamp >> 24 & 0xFF));
+    th.write_3bytes(0);
+    
+    char pts[SRS_HDS_TAG_SIZE];
+    SrsBuffer ps(pts, sizeof(pts));
+    ps.write_4bytes(msg->size + SRS_HDS_TAG_HEADER);
+    
+    iovec iovs[3];
+    iovs[0].iov_base = header;
+    iovs[0].iov_len = sizeof(header);
+    iovs[1].iov_base = msg->payload;
+    iovs[1].iov_len = msg->size;
+    iovs[2].iov_base = pts;
+    iovs[2].iov_len = sizeof(pts);
+    
+    return fw->writev(iovs, 3, NULL);
+}
 
 SrsHds::SrsHds()
-: currentSegment(NULL)
+: fragmenter(new SrsFragmenter())
+, fragments(new SrsFragmentWindow())
+, current(NULL)
 , fragment_index(1)
 , video_sh(NULL)
 , audio_sh(NULL)
@@ -270,6 +222,12 @@ SrsHds::SrsHds()
 
 SrsHds::~SrsHds()
 {
+    srs_freep(current);
+    srs_freep(fragments);
+    srs_freep(fragmenter);
+    srs_freep(video_sh);
+    srs_freep(audio_sh);
+    srs_freep(hds_req);
 }
 
 srs_error_t SrsHds::on_publish(SrsRequest *req)
@@ -288,6 +246,7 @@ srs_error_t SrsHds::on_publish(SrsRequest *req)
     hds_enabled = true;
     
     hds_req = req->copy();
+    fragmenter->initialize(_srs_config->get_hds_fragment(vhost));
     
     return flush_mainfest();
 }
@@ -306,15 +265,11 @@ srs_error_t SrsHds::on_unpublish()
     srs_freep(audio_sh);
     srs_freep(hds_req);
     
-    // clean fragments
-    list<SrsHdsFragment *>::iterator iter;
-    for (iter = fragments.begin(); iter != fragments.end(); ++iter) {
-        SrsHdsFragment *st = *iter;
-        srs_freep(st);
-    }
-    fragments.clear();
+    // Free the fragments, but keep the files.
+    srs_freep(fragments);
+    fragments = new SrsFragmentWindow();
     
-    srs_freep(currentSegment);
+    srs_freep(current);
     
     srs_trace("HDS un-published");
     
@@ -323,101 +278,79 @@ srs_error_t SrsHds::on_unpublish()
 
 srs_error_t SrsHds::on_video(SrsSharedPtrMessage* msg)
 {
-    srs_error_t err = srs_success;
-    
     if (!hds_enabled) {
-        return err;
+        return srs_success;
     }
     
-    if (SrsFlvVideo::sh(msg->payload, msg->size)) {
+    bool sh = SrsFlvVideo::sh(msg->payload, msg->size);
+    if (sh) {
         srs_freep(video_sh);
         video_sh = msg->copy();
     }
     
-    if (!currentSegment) {
-        currentSegment = new SrsHdsFragment(hds_req);
-        currentSegment->set_index(fragment_index++);
-        currentSegment->set_start_time(msg->timestamp);
-        
-        if (video_sh)
-            currentSegment->set_video_sh(video_sh);
-        
-        if (audio_sh)
-            currentSegment->set_audio_sh(audio_sh);
+    bool keyframe = !sh && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    return write(msg, keyframe);
+}
+
+srs_error_t SrsHds::on_audio(SrsSharedPtrMessage* msg)
+{
+    if (!hds_enabled) {
+        return srs_success;
     }
     
-    currentSegment->on_video(msg);
+    if (SrsFlvAudio::sh(msg->payload, msg->size)) {
+        srs_freep(audio_sh);
+        audio_sh = msg->copy();
+    }
     
-    double fragment_duration = srsu2ms(_srs_config->get_hds_fragment(hds_req->vhost));
-    if (currentSegment->duration() >= fragment_duration) {
-        // flush segment
-        if ((err = currentSegment->flush()) != srs_success) {
-            return srs_error_wrap(err, "flush segment");
+    return write(msg, false);
+}
+
+srs_error_t SrsHds::write(SrsSharedPtrMessage* msg, bool keyframe)
+{
+    srs_error_t err = srs_success;
+    
+    if (fragmenter->on_frame(msg->timestamp, msg->is_video(), keyframe) && current) {
+        if ((err = reap()) != srs_success) {
+            return srs_error_wrap(err, "reap");
         }
+    }
+    
+    if (!current) {
+        current = new SrsHdsFragment(fragment_index, msg->timestamp, video_sh, audio_sh);
         
-        srs_trace("flush Segment success.");
-        fragments.push_back(currentSegment);
-        currentSegment = NULL;
-        adjust_windows();
-        
-        // flush bootstrap
-        if ((err = flush_bootstrap()) != srs_success) {
-            return srs_error_wrap(err, "flush bootstrap");
-        }
+        char file_path[1024] = {0};
+        snprintf(file_path, 1024, "%s/%s/%sSeg1-Frag%d", _srs_config->get_hds_path(hds_req->vhost).c_str(),
+            hds_req->app.c_str(), hds_req->stream.c_str(), fragment_index);
+        current->set_path(file_path);
         
-        srs_trace("flush BootStrap success.");
+        fragment_index++;
     }
     
+    current->write(msg);
+    
     return err;
 }
 
-srs_error_t SrsHds::on_audio(SrsSharedPtrMessage* msg)
+srs_error_t SrsHds::reap()
 {
     srs_error_t err = srs_success;
     
-    if (!hds_enabled) {
-        return err;
+    // flush segment
+    if ((err = current->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush segment");
     }
     
-    if (SrsFlvAudio::sh(msg->payload, msg->size)) {
-        srs_freep(audio_sh);
-        audio_sh = msg->copy();
-    }
+    fragments->append(current);
+    current = NULL;
     
-    if (!currentSegment) {
-        currentSegment = new SrsHdsFragment(hds_req);
-        currentSegment->set_index(fragment_index++);
-        currentSegment->set_start_time(msg->timestamp);
-        
-        if (video_sh)
-            currentSegment->set_video_sh(video_sh);
-        
-        if (audio_sh)
-            currentSegment->set_audio_sh(audio_sh);
-    }
-    
-    currentSegment->on_audio(msg);
+    // shrink the window, and remove the expired files.
+    fragments->shrink(_srs_config->get_hds_window(hds_req->vhost));
+    fragments->clear_expired(true);
     
-    double fragment_duration = srsu2ms(_srs_config->get_hds_fragment(hds_req->vhost));
-    if (currentSegment->duration() >= fragment_duration) {
-        // flush segment
-        if ((err = currentSegment->flush()) != srs_success) {
-            return srs_error_wrap(err, "flush segment");
-        }
-        
-        srs_info("flush Segment success.");
-        
-        // reset the current segment
-        fragments.push_back(currentSegment);
-        currentSegment = NULL;
-        adjust_windows();
-        
-        // flush bootstrap
-        if ((err = flush_bootstrap()) != srs_success) {
-            return srs_error_wrap(err, "flush bootstrap");
-        }
-        
-        srs_info("flush BootStrap success.");
+    // flush bootstrap
+    if ((err = flush_bootstrap()) != srs_success) {
+        return srs_error_wrap(err, "flush bootstrap");
     }
     
     return err;
@@ -444,13 +377,13 @@ srs_error_t SrsHds::flush_mainfest()
     }
     string path = dir + "/" + hds_req->stream + ".f4m";
     
-    int fd = open(path.c_str(), O_WRONLY | O_CREAT, S_IRWXU | S_IRGRP | S_IROTH);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRGRP | S_IROTH);
     if (fd < 0) {
         return srs_error_new(ERROR_HDS_OPEN_F4M_FAILED, "open manifest file failed, path=%s", path.c_str());
     }
     
     int f4m_size = (int)strlen(buf);
-    if (write(fd, buf, f4m_size) != f4m_size) {
+    if (::write(fd, buf, f4m_size) != f4m_size) {
         close(fd);
         return srs_error_new(ERROR_HDS_WRITE_F4M_FAILED, "write manifest file failed, path=", path.c_str());
     }
@@ -503,8 +436,8 @@ srs_error_t SrsHds::flush_bootstrap()
      The CurrentMedia Time can be the total duration.
      For media presentations that are not live, CurrentMediaTime can be 0.
      */
-    SrsHdsFragment *st = fragments.back();
-    abst.write_8bytes(st->get_start_time());
+    SrsHdsFragment* last = dynamic_cast<SrsHdsFragment*>(fragments->at(fragments->size() - 1));
+    abst.write_8bytes(last->get_start_time());
     
     // SmpteTimeCodeOffset
     abst.write_8bytes(0);
@@ -675,15 +608,14 @@ srs_error_t SrsHds::flush_bootstrap()
      The number of items in this FragmentRunEntryTable.
      The minimum value is 1.
      */
-    abst.write_4bytes((int32_t)fragments.size());
+    abst.write_4bytes((int32_t)fragments->size());
     size_afrt += 4;
     
-    list<SrsHdsFragment *>::iterator iter;
-    for (iter = fragments.begin(); iter != fragments.end(); ++iter) {
-        SrsHdsFragment *st = *iter;
+    for (int i = 0; i < fragments->size(); i++) {
+        SrsHdsFragment* st = dynamic_cast<SrsHdsFragment*>(fragments->at(i));
         abst.write_4bytes(st->get_index());
         abst.write_8bytes(st->get_start_time());
-        abst.write_4bytes(st->duration());
+        abst.write_4bytes(srsu2msi(st->duration()));
         size_afrt += 16;
     }
     
@@ -693,12 +625,12 @@ srs_error_t SrsHds::flush_bootstrap()
     
     string path = _srs_config->get_hds_path(hds_req->vhost) + "/" + hds_req->app + "/" + hds_req->stream +".abst";
     
-    int fd = open(path.c_str(), O_WRONLY | O_CREAT, S_IRWXU | S_IRGRP | S_IROTH);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU | S_IRGRP | S_IROTH);
     if (fd < 0) {
         return srs_error_new(ERROR_HDS_OPEN_BOOTSTRAP_FAILED, "open bootstrap file failed, path=%s", path.c_str());
     }
     
-    if (write(fd, start_abst, size_abst) != size_abst) {
+    if (::write(fd, start_abst, size_abst) != size_abst) {
         close(fd);
         return srs_error_new(ERROR_HDS_WRITE_BOOTSTRAP_FAILED, "write bootstrap file failed, path=", path.c_str());
     }
@@ -709,22 +641,4 @@ srs_error_t SrsHds::flush_bootstrap()
     return err;
 }
 
-void SrsHds::adjust_windows()
-{
-    int windows_size = 0;
-    list<SrsHdsFragment *>::iterator iter;
-    for (iter = fragments.begin(); iter != fragments.end(); ++iter) {
-        SrsHdsFragment *fragment = *iter;
-        windows_size += fragment->duration();
-    }
-    
-    double windows_size_limit = srsu2ms(_srs_config->get_hds_window(hds_req->vhost));
-    if (windows_size > windows_size_limit ) {
-        SrsHdsFragment *fragment = fragments.front();
-        unlink(fragment->fragment_path().c_str());
-        fragments.erase(fragments.begin());
-        srs_freep(fragment);
-    }
-}
-
 #endif
@@ -28,14 +28,16 @@
 
 #ifdef SRS_AUTO_HDS
 
-#include <list>
-
 class SrsRequest;
 class SrsSharedPtrMessage;
 class SrsHdsFragment;
 class SrsSource;
+class SrsFragmenter;
+class SrsFragmentWindow;
 
 // Mux RTMP to Adobe HDS streaming.
+// The fragments are decided by the keyframe-aligned fragmenter, shared with DASH, and the
+// fragment is an mdat box of FLV tags, described by the f4m manifest and abst bootstrap.
 class SrsHds
 {
 public:
@@ -49,18 +51,20 @@ public:
     srs_error_t on_audio(SrsSharedPtrMessage* msg);
     
 private:
+    srs_error_t write(SrsSharedPtrMessage* msg, bool keyframe);
+    srs_error_t reap();
     srs_error_t flush_mainfest();
     srs_error_t flush_bootstrap();
-    void adjust_windows();
     
 private:
-    std::list<SrsHdsFragment *> fragments;
-    SrsHdsFragment *currentSegment;
+    SrsFragmenter* fragmenter;
+    SrsFragmentWindow* fragments;
+    SrsHdsFragment* current;
     int fragment_index;
-    SrsSharedPtrMessage *video_sh;
-    SrsSharedPtrMessage *audio_sh;
+    SrsSharedPtrMessage* video_sh;
+    SrsSharedPtrMessage* audio_sh;
     
-    SrsRequest *hds_req;
+    SrsRequest* hds_req;
     bool hds_enabled;
 };
 
@@ -35,13 +35,19 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_app_http_conn.hpp>
 #include <srs_protocol_amf0.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_kernel_utility.hpp>
 
 SrsHttpHeartbeat::SrsHttpHeartbeat()
 {
+    version = 0;
+    acked_version = 0;
+    acked = NULL;
 }
 
 SrsHttpHeartbeat::~SrsHttpHeartbeat()
 {
+    srs_freep(acked);
 }
 
 void SrsHttpHeartbeat::heartbeat()
@@ -86,12 +92,44 @@ srs_error_t SrsHttpHeartbeat::do_heartbeat()
         srs_api_dump_summaries(summaries);
     }
     
+    // For v2, report the streams keyed by id, for the delta of each stream.
+    bool v2 = _srs_config->get_heartbeat_version() == 2;
+    if (v2) {
+        SrsJsonWriter jw;
+        jw.array_start();
+        if ((err = SrsStatistic::instance()->dumps_streams(&jw)) != srs_success) {
+            return srs_error_wrap(err, "dump streams");
+        }
+        jw.array_end();
+        
+        SrsJsonAny* arr = SrsJsonAny::loads(jw.dumps());
+        SrsAutoFree(SrsJsonAny, arr);
+        
+        SrsJsonObject* streams = SrsJsonAny::object();
+        obj->set("streams", streams);
+        
+        for (int i = 0; arr && arr->is_array() && i < arr->to_array()->count(); i++) {
+            SrsJsonAny* stream = arr->to_array()->at(i);
+            SrsJsonAny* id = stream->is_object()? stream->to_object()->get_property("id") : NULL;
+            if (id && id->is_integer()) {
+                streams->set(srs_int2str(id->to_integer()), srs_json_copy(stream));
+            }
+        }
+    }
+    
     SrsHttpClient http;
+    http.set_pool(SrsHttpClientPool::instance());
     if ((err = http.initialize(uri.get_host(), uri.get_port())) != srs_success) {
         return srs_error_wrap(err, "init uri=%s", uri.get_url().c_str());
     }
     
     std::string req = obj->dumps();
+    if (v2) {
+        SrsJsonObject* body = delta(obj);
+        SrsAutoFree(SrsJsonObject, body);
+        req = body->dumps();
+    }
+    
     ISrsHttpMessage* msg = NULL;
     if ((err = http.post(uri.get_path(), req, &msg)) != srs_success) {
         return srs_error_wrap(err, "http post hartbeart uri failed. url=%s, request=%s", url.c_str(), req.c_str());
@@ -103,6 +141,118 @@ srs_error_t SrsHttpHeartbeat::do_heartbeat()
         return srs_error_wrap(err, "read body");
     }
     
+    if (v2) {
+        on_response(res, obj);
+    }
+    
     return err;
 }
 
+SrsJsonObject* SrsHttpHeartbeat::delta(SrsJsonObject* state)
+{
+    SrsJsonObject* body = SrsJsonAny::object();
+    body->set("version", SrsJsonAny::integer(++version));
+    body->set("base", SrsJsonAny::integer(acked_version));
+    
+    SrsJsonObject* patch = srs_json_merge_patch(acked, state);
+    body->set("delta", patch? patch : SrsJsonAny::object());
+    
+    return body;
+}
+
+void SrsHttpHeartbeat::on_response(string res, SrsJsonObject* state)
+{
+    SrsJsonAny* any = SrsJsonAny::loads(res);
+    SrsAutoFree(SrsJsonAny, any);
+    
+    // Not acknowledged, the next delta is still based on the old one.
+    if (!any || !any->is_object()) {
+        return;
+    }
+    SrsJsonObject* obj = any->to_object();
+    
+    // The server requests the full state, for example, it's restarted.
+    SrsJsonAny* prop = obj->get_property("resync");
+    if (prop && prop->is_boolean() && prop->to_boolean()) {
+        srs_trace("heartbeat: resync full state, version=%" PRId64 ", base=%" PRId64, version, acked_version);
+        srs_freep(acked);
+        acked_version = 0;
+        return;
+    }
+    
+    prop = obj->get_property("ack");
+    if (prop && prop->is_integer() && prop->to_integer() == version) {
+        srs_freep(acked);
+        acked = srs_json_copy(state)->to_object();
+        acked_version = version;
+    }
+}
+
+SrsJsonAny* srs_json_copy(SrsJsonAny* v)
+{
+    if (v->is_string()) {
+        return SrsJsonAny::str(v->to_str().c_str());
+    } else if (v->is_boolean()) {
+        return SrsJsonAny::boolean(v->to_boolean());
+    } else if (v->is_integer()) {
+        return SrsJsonAny::integer(v->to_integer());
+    } else if (v->is_number()) {
+        return SrsJsonAny::number(v->to_number());
+    } else if (v->is_object()) {
+        SrsJsonObject* from = v->to_object();
+        SrsJsonObject* obj = SrsJsonAny::object();
+        for (int i = 0; i < from->count(); i++) {
+            obj->set(from->key_at(i), srs_json_copy(from->value_at(i)));
+        }
+        return obj;
+    } else if (v->is_array()) {
+        SrsJsonArray* from = v->to_array();
+        SrsJsonArray* arr = SrsJsonAny::array();
+        for (int i = 0; i < from->count(); i++) {
+            arr->add(srs_json_copy(from->at(i)));
+        }
+        return arr;
+    }
+    return SrsJsonAny::null();
+}
+
+SrsJsonObject* srs_json_merge_patch(SrsJsonObject* from, SrsJsonObject* to)
+{
+    SrsJsonObject* patch = SrsJsonAny::object();
+    
+    for (int i = 0; i < to->count(); i++) {
+        std::string key = to->key_at(i);
+        SrsJsonAny* v = to->value_at(i);
+        SrsJsonAny* prev = from? from->get_property(key) : NULL;
+        
+        // Recursive for object, or the new object is all changed.
+        if (v->is_object() && (!prev || prev->is_object())) {
+            SrsJsonObject* sub = srs_json_merge_patch(prev? prev->to_object() : NULL, v->to_object());
+            if (sub) {
+                patch->set(key, sub);
+            } else if (!prev) {
+                patch->set(key, SrsJsonAny::object());
+            }
+            continue;
+        }
+        
+        if (!prev || prev->dumps() != v->dumps()) {
+            patch->set(key, srs_json_copy(v));
+        }
+    }
+    
+    // The removed field is null.
+    for (int i = 0; from && i < from->count(); i++) {
+        std::string key = from->key_at(i);
+        if (!to->get_property(key)) {
+            patch->set(key, SrsJsonAny::null());
+        }
+    }
+    
+    if (patch->count() == 0) {
+        srs_freep(patch);
+    }
+    
+    return patch;
+}
+
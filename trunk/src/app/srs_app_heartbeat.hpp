@@ -26,9 +26,21 @@
 
 #include <srs_core.hpp>
 
+#include <string>
+
+class SrsJsonAny;
+class SrsJsonObject;
+
 // The http heartbeat to api-server to notice api that the information of SRS.
+// For heartbeat v2, only POST the changed fields since the state acknowledged by api-server.
 class SrsHttpHeartbeat
 {
+private:
+    // The version of last heartbeat.
+    int64_t version;
+    // The version and state acknowledged by api-server, 0 and NULL to POST the full state.
+    int64_t acked_version;
+    SrsJsonObject* acked;
 public:
     SrsHttpHeartbeat();
     virtual ~SrsHttpHeartbeat();
@@ -36,7 +48,18 @@ public:
     virtual void heartbeat();
 private:
     virtual srs_error_t do_heartbeat();
+    // Build the request of v2, the changed fields of state since the acknowledged one.
+    virtual SrsJsonObject* delta(SrsJsonObject* state);
+    // Parse the response of v2, to acknowledge the state or resync the full state.
+    virtual void on_response(std::string res, SrsJsonObject* state);
 };
 
+// Deep copy the json value.
+extern SrsJsonAny* srs_json_copy(SrsJsonAny* v);
+// Generate the JSON merge patch(RFC7396) from the object to another, NULL if equal.
+// @param from The source object, NULL for the empty object.
+// @remark A field removed is null in patch, and the array is always replaced.
+extern SrsJsonObject* srs_json_merge_patch(SrsJsonObject* from, SrsJsonObject* to);
+
 #endif
 
@@ -51,27 +51,411 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_http_static.hpp>
+#include <srs_app_upload.hpp>
+#include <srs_app_events.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_app_statistic.hpp>
 #include <openssl/rand.h>
+#include <zlib.h>
 
 // drop the segment when duration of ts too small.
 // TODO: FIXME: Refine to time unit.
 #define SRS_AUTO_HLS_SEGMENT_MIN_DURATION (100 * SRS_UTIME_MILLISECONDS)
 
+// The size of buffer to read the ts, to calc the checksum.
+#define SRS_HLS_CHECKSUM_BUFFER_SIZE 65536
+
 // fragment plus the deviation percent.
 #define SRS_HLS_FLOOR_REAP_PERCENT 0.3
 // reset the piece id when deviation overflow this.
 #define SRS_JUMP_WHEN_PIECE_DEVIATION 20
+// the number of last segments to keep parts for LL-HLS.
+#define SRS_HLS_LL_SEGMENTS 3
+// the deviation in ms of keyframe to follow the cut of variant group.
+#define SRS_HLS_VARIANT_DEVIATION 100
+// the number of last cuts to keep for the variant group.
+#define SRS_HLS_VARIANT_CUTS 64
+// The min size of playlist to compress, the small one is sent as is.
+#define SRS_HLS_GZIP_MIN_SIZE 1024
+
+SrsHlsMemoryFile::SrsHlsMemoryPayload::SrsHlsMemoryPayload()
+{
+    data = NULL;
+    size = 0;
+    shared_count = 0;
+}
+
+SrsHlsMemoryFile::SrsHlsMemoryPayload::~SrsHlsMemoryPayload()
+{
+    srs_freepa(data);
+}
+
+SrsHlsMemoryFile::SrsHlsMemoryFile()
+{
+    ptr = NULL;
+}
+
+SrsHlsMemoryFile::SrsHlsMemoryFile(const char* data, int size)
+{
+    ptr = new SrsHlsMemoryPayload();
+    ptr->size = size;
+    if (size > 0) {
+        ptr->data = new char[size];
+        memcpy(ptr->data, data, size);
+    }
+}
+
+SrsHlsMemoryFile::~SrsHlsMemoryFile()
+{
+    if (ptr) {
+        if (ptr->shared_count == 0) {
+            srs_freep(ptr);
+        } else {
+            ptr->shared_count--;
+        }
+    }
+}
+
+char* SrsHlsMemoryFile::data()
+{
+    return ptr->data;
+}
+
+int SrsHlsMemoryFile::size()
+{
+    return ptr->size;
+}
+
+string SrsHlsMemoryFile::etag()
+{
+    return ptr->etag;
+}
+
+void SrsHlsMemoryFile::set_etag(string v)
+{
+    ptr->etag = v;
+}
+
+void SrsHlsMemoryFile::compress()
+{
+    ptr->gzip.clear();
+    
+    if (ptr->size < SRS_HLS_GZIP_MIN_SIZE) {
+        return;
+    }
+    
+    // The windowBits 16+15 for the gzip header and trailer, see deflateInit2 of zlib.
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    
+    uLong bound = deflateBound(&zs, (uLong)ptr->size);
+    char* buf = new char[bound];
+    SrsAutoFreeA(char, buf);
+    
+    zs.next_in = (Bytef*)ptr->data;
+    zs.avail_in = (uInt)ptr->size;
+    zs.next_out = (Bytef*)buf;
+    zs.avail_out = (uInt)bound;
+    
+    int r0 = deflate(&zs, Z_FINISH);
+    int nn_gzip = (int)zs.total_out;
+    deflateEnd(&zs);
+    
+    // Ignore the variant which is not smaller, so the client always gets the smallest one.
+    if (r0 != Z_STREAM_END || nn_gzip >= ptr->size) {
+        return;
+    }
+    
+    ptr->gzip.assign(buf, nn_gzip);
+}
+
+const string& SrsHlsMemoryFile::gzip()
+{
+    return ptr->gzip;
+}
+
+SrsHlsMemoryFile* SrsHlsMemoryFile::copy()
+{
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile();
+    file->ptr = ptr;
+    ptr->shared_count++;
+    return file;
+}
+
+SrsHlsPlaylistState::SrsHlsPlaylistState()
+{
+    msn = -1;
+    part = -1;
+    complete = -1;
+    timeout = 0;
+}
 
-SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w)
+SrsHlsPlaylistState::~SrsHlsPlaylistState()
+{
+}
+
+bool SrsHlsPlaylistState::ready(int msn, int part)
+{
+    // The whole segment is required.
+    if (part < 0) {
+        return complete >= msn;
+    }
+    
+    // The part of segment, or the segment is complete and next part is required.
+    return this->msn > msn || (this->msn == msn && this->part >= part);
+}
+
+SrsHlsMemoryStore* _srs_hls_memory = new SrsHlsMemoryStore();
+
+SrsHlsMemoryStore::SrsHlsMemoryStore()
+{
+    nn_bytes = 0;
+    cond = NULL;
+}
+
+SrsHlsMemoryStore::~SrsHlsMemoryStore()
+{
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        SrsHlsMemoryFile* file = it->second;
+        srs_freep(file);
+    }
+    files.clear();
+}
+
+void SrsHlsMemoryStore::update(string path, SrsHlsMemoryFile* file)
+{
+    remove(path);
+    
+    files[normalize(path)] = file;
+    nn_bytes += file->size();
+}
+
+void SrsHlsMemoryStore::remove(string path)
+{
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it = files.find(normalize(path));
+    if (it == files.end()) {
+        return;
+    }
+    
+    // The bytes are freed when all copies are freed.
+    SrsHlsMemoryFile* file = it->second;
+    nn_bytes -= file->size();
+    srs_freep(file);
+    
+    files.erase(it);
+}
+
+SrsHlsMemoryFile* SrsHlsMemoryStore::fetch(string path)
+{
+    if (files.empty()) {
+        return NULL;
+    }
+    
+    std::map<std::string, SrsHlsMemoryFile*>::iterator it = files.find(normalize(path));
+    if (it == files.end()) {
+        return NULL;
+    }
+    
+    return it->second->copy();
+}
+
+int SrsHlsMemoryStore::size()
+{
+    return (int)files.size();
+}
+
+int64_t SrsHlsMemoryStore::bytes()
+{
+    return nn_bytes;
+}
+
+void SrsHlsMemoryStore::update_state(string path, const SrsHlsPlaylistState& state)
+{
+    states[normalize(path)] = state;
+    
+    if (cond) {
+        srs_cond_broadcast(cond);
+    }
+}
+
+void SrsHlsMemoryStore::remove_state(string path)
+{
+    states.erase(normalize(path));
+    
+    if (cond) {
+        srs_cond_broadcast(cond);
+    }
+}
+
+bool SrsHlsMemoryStore::fetch_state(string path, SrsHlsPlaylistState& state)
+{
+    std::map<std::string, SrsHlsPlaylistState>::iterator it = states.find(normalize(path));
+    if (it == states.end()) {
+        return false;
+    }
+    
+    state = it->second;
+    return true;
+}
+
+bool SrsHlsMemoryStore::is_hint(string path)
+{
+    path = normalize(path);
+    
+    std::map<std::string, SrsHlsPlaylistState>::iterator it;
+    for (it = states.begin(); it != states.end(); ++it) {
+        if (normalize(it->second.hint) == path) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void SrsHlsMemoryStore::wait(srs_utime_t timeout)
+{
+    // Create when required, for ST maybe not initialized when construct.
+    if (!cond) {
+        cond = srs_cond_new();
+    }
+    
+    srs_cond_timedwait(cond, timeout);
+}
+
+string SrsHlsMemoryStore::normalize(string path)
+{
+    while (path.find("//") != string::npos) {
+        path = srs_string_replace(path, "//", "/");
+    }
+    
+    if (srs_string_starts_with(path, "./")) {
+        path = path.substr(2);
+    }
+    
+    return path;
+}
+
+SrsHlsMemoryWriter::SrsHlsMemoryWriter(SrsFileWriter* w)
+{
+    writer = w;
+    buffer = new SrsSimpleStream();
+}
+
+SrsHlsMemoryWriter::~SrsHlsMemoryWriter()
+{
+    srs_freep(buffer);
+}
+
+bool SrsHlsMemoryWriter::archived()
+{
+    return writer != NULL;
+}
+
+char* SrsHlsMemoryWriter::data()
+{
+    return buffer->bytes();
+}
+
+int SrsHlsMemoryWriter::size()
+{
+    return buffer->length();
+}
+
+srs_error_t SrsHlsMemoryWriter::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+    
+    buffer->append((const char*)buf, (int)size);
+    
+    if (writer) {
+        return writer->write(buf, size, nwrite);
+    }
+    
+    if (nwrite) {
+        *nwrite = size;
+    }
+    
+    return err;
+}
+
+SrsHlsPart::SrsHlsPart()
+{
+    index = 0;
+    duration = 0;
+    independent = false;
+}
+
+SrsHlsPart::~SrsHlsPart()
+{
+}
+
+SrsHlsTapWriter::SrsHlsTapWriter(ISrsStreamWriter* w, string* t)
+{
+    writer = w;
+    tap = t;
+}
+
+SrsHlsTapWriter::~SrsHlsTapWriter()
+{
+}
+
+srs_error_t SrsHlsTapWriter::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    tap->append((char*)buf, size);
+    return writer->write(buf, size, nwrite);
+}
+
+ISrsHlsTsHandler::ISrsHlsTsHandler()
+{
+}
+
+ISrsHlsTsHandler::~ISrsHlsTsHandler()
+{
+}
+
+SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w, SrsHlsMemoryWriter* m, string* tap)
 {
     sequence_no = 0;
+    checksum = false;
     writer = w;
-    tscw = new SrsTsContextWriter(writer, c, ac, vc);
+    memory = m;
+    archive = !memory || memory->archived();
+    in_memory = false;
+    part_offset = 0;
+    part_independent = false;
+    part_has_video = false;
+    
+    ISrsStreamWriter* sw = writer;
+    if (memory) {
+        sw = memory;
+    }
+    
+    tapw = NULL;
+    if (tap) {
+        sw = tapw = new SrsHlsTapWriter(sw, tap);
+    }
+    
+    tscw = new SrsTsContextWriter(sw, c, ac, vc);
 }
 
 SrsHlsSegment::~SrsHlsSegment()
 {
     srs_freep(tscw);
+    srs_freep(tapw);
+    srs_freep(memory);
+    
+    clear_parts();
+    
+    // The segment is expired or disposed, remove from memory store.
+    if (in_memory) {
+        _srs_hls_memory->remove(fullpath());
+    }
 }
 
 void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
@@ -82,6 +466,190 @@ void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
     fw->config_cipher(key, iv);
 }
 
+srs_error_t SrsHlsSegment::write_checksum()
+{
+    srs_error_t err = srs_success;
+    
+    string path = fullpath();
+    
+    SrsFileReader fr;
+    if ((err = fr.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+    
+    // The ts is just written, so it's in page cache and we read it fast.
+    char* buf = new char[SRS_HLS_CHECKSUM_BUFFER_SIZE];
+    SrsAutoFreeA(char, buf);
+    
+    uint32_t crc = 0;
+    for (int64_t left = fr.filesize(); left > 0;) {
+        ssize_t nread = 0;
+        if ((err = fr.read(buf, (size_t)srs_min(left, SRS_HLS_CHECKSUM_BUFFER_SIZE), &nread)) != srs_success) {
+            return srs_error_wrap(err, "read %s", path.c_str());
+        }
+        
+        crc = srs_crc32_ieee(buf, (int)nread, crc);
+        left -= nread;
+    }
+    
+    // Write to a temporary file then rename, so CDN never sees a partial sidecar.
+    char hex[16];
+    int nn_hex = snprintf(hex, sizeof(hex), "%08x\n", crc);
+    
+    string sidecar = path + ".crc32";
+    string tmp_file = sidecar + ".tmp";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((err = fw.open(tmp_file)) != srs_success) {
+            return srs_error_wrap(err, "open %s", tmp_file.c_str());
+        }
+        
+        if ((err = fw.write(hex, nn_hex, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write %s", tmp_file.c_str());
+        }
+    }
+    
+    if (_srs_disk_io->rename(tmp_file, sidecar) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FRAGMENT_RENAME, "rename %s to %s", tmp_file.c_str(), sidecar.c_str());
+    }
+    
+    checksum = true;
+    srs_info("hls: checksum %s crc32=%08x", sidecar.c_str(), crc);
+    
+    return err;
+}
+
+srs_utime_t SrsHlsSegment::part_duration(int64_t dts)
+{
+    srs_utime_t total = 0;
+    for (int i = 0; i < (int)parts.size(); i++) {
+        total += parts.at(i)->duration;
+    }
+    
+    // Use the dts of next frame as the end of part.
+    if (dts >= 0) {
+        append(dts);
+    }
+    
+    return srs_max(0, duration() - total);
+}
+
+void SrsHlsSegment::on_part_frame(bool video, bool keyframe)
+{
+    if (!video || part_has_video) {
+        return;
+    }
+    
+    part_has_video = true;
+    part_independent = keyframe;
+}
+
+srs_error_t SrsHlsSegment::close_part(int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    // The part is only in memory.
+    if (!memory || memory->size() <= part_offset) {
+        return err;
+    }
+    
+    SrsHlsPart* part = new SrsHlsPart();
+    part->index = (int)parts.size();
+    part->uri = part_uri(part->index);
+    part->fullpath = part_path(part->index);
+    part->duration = part_duration(dts);
+    part->independent = !part_has_video || part_independent;
+    parts.push_back(part);
+    
+    _srs_hls_memory->update(part->fullpath, new SrsHlsMemoryFile(memory->data() + part_offset, memory->size() - part_offset));
+    
+    // The next part starts from here.
+    part_offset = memory->size();
+    part_independent = false;
+    part_has_video = false;
+    
+    return err;
+}
+
+string SrsHlsSegment::part_uri(int index)
+{
+    string v = uri;
+    if (srs_string_ends_with(v, ".ts")) {
+        v = v.substr(0, v.length() - 3);
+    }
+    return v + ".part" + srs_int2str(index) + ".ts";
+}
+
+string SrsHlsSegment::part_path(int index)
+{
+    string v = fullpath();
+    if (srs_string_ends_with(v, ".ts")) {
+        v = v.substr(0, v.length() - 3);
+    }
+    return v + ".part" + srs_int2str(index) + ".ts";
+}
+
+void SrsHlsSegment::clear_parts()
+{
+    for (int i = 0; i < (int)parts.size(); i++) {
+        SrsHlsPart* part = parts.at(i);
+        _srs_hls_memory->remove(part->fullpath);
+        srs_freep(part);
+    }
+    parts.clear();
+}
+
+srs_error_t SrsHlsSegment::unlink_file()
+{
+    srs_error_t err = srs_success;
+    
+    // Not written to disk, removed from memory store when free.
+    if (!archive) {
+        return err;
+    }
+    
+    if (checksum) {
+        string sidecar = fullpath() + ".crc32";
+        if (_srs_disk_io->unlink(sidecar) < 0) {
+            srs_warn("hls: unlink checksum %s failed", sidecar.c_str());
+        }
+    }
+    
+    if ((err = SrsFragment::unlink_file()) != srs_success) {
+        return srs_error_wrap(err, "unlink ts");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsSegment::unlink_tmpfile()
+{
+    if (!archive) {
+        return srs_success;
+    }
+    
+    return SrsFragment::unlink_tmpfile();
+}
+
+srs_error_t SrsHlsSegment::rename()
+{
+    srs_error_t err = srs_success;
+    
+    if (archive && (err = SrsFragment::rename()) != srs_success) {
+        return srs_error_wrap(err, "rename");
+    }
+    
+    // Publish to memory store, and free the cache of writer.
+    if (memory) {
+        _srs_hls_memory->update(fullpath(), new SrsHlsMemoryFile(memory->data(), memory->size()));
+        in_memory = true;
+        srs_freep(memory);
+    }
+    
+    return err;
+}
+
 SrsDvrAsyncCallOnHls::SrsDvrAsyncCallOnHls(int c, SrsRequest* r, string p, string t, string m, string mu, int s, srs_utime_t d)
 {
     req = r->copy();
@@ -137,6 +705,11 @@ string SrsDvrAsyncCallOnHls::to_string()
     return "on_hls: " + path;
 }
 
+string SrsDvrAsyncCallOnHls::key()
+{
+    return "on_hls";
+}
+
 SrsDvrAsyncCallOnHlsNotify::SrsDvrAsyncCallOnHlsNotify(int c, SrsRequest* r, string u)
 {
     cid = c;
@@ -188,14 +761,88 @@ string SrsDvrAsyncCallOnHlsNotify::to_string()
     return "on_hls_notify: " + ts_url;
 }
 
+string SrsDvrAsyncCallOnHlsNotify::key()
+{
+    return "on_hls_notify";
+}
+
+SrsHlsPlaylist::SrsHlsPlaylist()
+{
+    offset = 0;
+}
+
+SrsHlsPlaylist::~SrsHlsPlaylist()
+{
+}
+
+void SrsHlsPlaylist::append(const string& entry)
+{
+    entries.append(entry);
+    sizes.push_back((int)entry.length());
+}
+
+void SrsHlsPlaylist::shift(int n)
+{
+    for (int i = 0; i < n && !sizes.empty(); i++) {
+        offset += sizes.front();
+        sizes.pop_front();
+    }
+    
+    // Compact when the removed entries are more than half, so the cost is amortized.
+    if (offset > 0 && offset >= (int)entries.length() / 2) {
+        entries.erase(0, offset);
+        offset = 0;
+    }
+}
+
+void SrsHlsPlaylist::clear()
+{
+    entries.clear();
+    offset = 0;
+    sizes.clear();
+}
+
+int SrsHlsPlaylist::size()
+{
+    return (int)sizes.size();
+}
+
+string SrsHlsPlaylist::dumps(int sequence_no, int target_duration)
+{
+    // #EXTM3U\n
+    // #EXT-X-VERSION:3\n
+    // #EXT-X-MEDIA-SEQUENCE:4294967295\n
+    // #EXT-X-TARGETDURATION:4294967295\n
+    std::stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:3" << SRS_CONSTS_LF;
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << sequence_no << SRS_CONSTS_LF;
+    ss << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+    
+    string content = ss.str();
+    content.reserve(content.length() + entries.length() - offset);
+    content.append(entries.data() + offset, entries.length() - offset);
+    
+    return content;
+}
+
 SrsHlsMuxer::SrsHlsMuxer()
 {
     req = NULL;
     hls_fragment = hls_window = 0;
+    hls_fast_start = 0;
+    nn_reaped = 0;
     hls_aof_ratio = 1.0;
     deviation_ts = 0;
     hls_cleanup = true;
     hls_wait_keyframe = true;
+    hls_checksum = false;
+    hls_memory = false;
+    hls_memory_archive = true;
+    hls_upload = false;
+    hls_ll = false;
+    hls_ll_part = 0;
+    hls_audio_aggregate = 0;
     previous_floor_ts = 0;
     accept_floor_ts = 0;
     hls_ts_floor = false;
@@ -204,9 +851,14 @@ SrsHlsMuxer::SrsHlsMuxer()
     current = NULL;
     hls_keys = false;
     hls_fragments_per_key = 0;
-    async = new SrsAsyncCallWorker();
+    writer = NULL;
+    async = new SrsAsyncCallWorker("hls");
     context = new SrsTsContext();
+    latest_vcodec = SrsVideoCodecIdForbidden;
+    ts_handler = NULL;
     segments = new SrsFragmentWindow();
+    playlist = new SrsHlsPlaylist();
+    ts_template = new SrsPathTemplate();
     
     memset(key, 0, 16);
     memset(iv, 0, 16);
@@ -219,6 +871,8 @@ SrsHlsMuxer::~SrsHlsMuxer()
     srs_freep(async);
     srs_freep(context);
     srs_freep(writer);
+    srs_freep(playlist);
+    srs_freep(ts_template);
 }
 
 void SrsHlsMuxer::dispose()
@@ -226,6 +880,7 @@ void SrsHlsMuxer::dispose()
     srs_error_t err = srs_success;
     
     segments->dispose();
+    playlist->clear();
     
     if (current) {
         if ((err = current->unlink_tmpfile()) != srs_success) {
@@ -235,18 +890,35 @@ void SrsHlsMuxer::dispose()
         srs_freep(current);
     }
     
-    if (unlink(m3u8.c_str()) < 0) {
+    if (hls_memory) {
+        _srs_hls_memory->remove(m3u8);
+        _srs_hls_memory->remove_state(m3u8);
+    }
+    
+    _srs_http_file_meta->invalidate(m3u8);
+    if ((!hls_memory || hls_memory_archive) && unlink(m3u8.c_str()) < 0) {
         srs_warn("dispose unlink path failed. file=%s", m3u8.c_str());
     }
     
     srs_trace("gracefully dispose hls %s", req? req->get_stream_url().c_str() : "");
 }
 
+void SrsHlsMuxer::set_ts_handler(ISrsHlsTsHandler* h)
+{
+    ts_handler = h;
+    ts_packets.clear();
+}
+
 int SrsHlsMuxer::sequence_no()
 {
     return _sequence_no;
 }
 
+void SrsHlsMuxer::set_sequence_no(int v)
+{
+    _sequence_no = v;
+}
+
 string SrsHlsMuxer::ts_url()
 {
     return current? current->uri:"";
@@ -275,11 +947,11 @@ srs_error_t SrsHlsMuxer::initialize()
 srs_error_t SrsHlsMuxer::on_publish(SrsRequest* req)
 {
     srs_error_t err = srs_success;
-
+    
     if ((err = async->start()) != srs_success) {
         return srs_error_wrap(err, "async start");
     }
-
+    
     return err;
 }
 
@@ -302,16 +974,26 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     hls_entry_prefix = entry_prefix;
     hls_path = path;
     hls_ts_file = ts_file;
+    ts_template->compile(ts_file, req->vhost, req->app, req->stream, _srs_config->get_utc_time());
     hls_fragment = fragment;
     hls_aof_ratio = aof_ratio;
     hls_ts_floor = ts_floor;
     hls_cleanup = cleanup;
     hls_wait_keyframe = wait_keyframe;
+    hls_checksum = _srs_config->get_hls_checksum(r->vhost);
+    hls_memory = _srs_config->get_hls_memory(r->vhost);
+    hls_memory_archive = _srs_config->get_hls_memory_archive(r->vhost);
+    hls_upload = _srs_uploader->hls_enabled(r->vhost);
+    hls_ll = _srs_config->get_hls_ll(r->vhost);
+    hls_ll_part = _srs_config->get_hls_ll_part(r->vhost);
+    hls_audio_aggregate = _srs_config->get_hls_audio_aggregate(r->vhost);
+    hls_fast_start = _srs_config->get_hls_fast_start(r->vhost);
+    nn_reaped = 0;
     previous_floor_ts = 0;
     accept_floor_ts = 0;
     hls_window = window;
     deviation_ts = 0;
-
+    
     hls_keys = keys;
     hls_fragments_per_key = fragments_per_key;
     hls_key_file = key_file;
@@ -330,7 +1012,7 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     if ((err = srs_create_dir_recursively(m3u8_dir)) != srs_success) {
         return srs_error_wrap(err, "create dir");
     }
-
+    
     if (hls_keys && (hls_path != hls_key_file_path)) {
         string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
         string key_url = hls_key_file_path + "/" + key_file;
@@ -339,13 +1021,43 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
             return srs_error_wrap(err, "create dir");
         }
     }
-
+    
+    // Upload the segments from memory, without writing and reading back the files,
+    // and the archive is the local copy.
+    if (hls_upload) {
+        hls_memory = true;
+        hls_memory_archive = _srs_config->get_vhost_upload_local_copy(r->vhost);
+    }
+    
+    // The ts in memory is not encrypted, so we disable it for hls_keys.
+    if (hls_memory && hls_keys) {
+        srs_warn("hls: disable hls_memory for hls_keys");
+        hls_memory = false;
+    }
+    
+    // The LL-HLS parts are only served from memory.
+    if (hls_ll && !hls_memory) {
+        srs_warn("hls: disable hls_ll for hls_memory is off");
+        hls_ll = false;
+    }
+    if (hls_ll && hls_ll_part <= 0) {
+        srs_warn("hls: disable hls_ll for invalid part %dms", srsu2msi(hls_ll_part));
+        hls_ll = false;
+    }
+    
     if(hls_keys) {
-        writer = new SrsEncFileWriter();
+        SrsEncFileWriter* fw = new SrsEncFileWriter();
+        fw->set_offload(_srs_config->get_hls_key_offload(r->vhost));
+        writer = fw;
     } else {
         writer = new SrsFileWriter();
     }
-
+    _srs_disk_io->attach(writer);
+    
+    // Packetize the ts in the disk io threads, only for the file writer without buffer.
+    context->set_offload(_srs_disk_io->mux_enabled());
+    context->set_pcr_interval(srsu2ms(_srs_config->get_hls_pcr_interval(r->vhost)) * 90);
+    
     return err;
 }
 
@@ -382,6 +1094,8 @@ srs_error_t SrsHlsMuxer::segment_open()
         std::string default_vcodec_str = _srs_config->get_hls_vcodec(req->vhost);
         if (default_vcodec_str == "h264") {
             default_vcodec = SrsVideoCodecIdAVC;
+        } else if (default_vcodec_str == "h265") {
+            default_vcodec = SrsVideoCodecIdHEVC;
         } else if (default_vcodec_str == "vn") {
             default_vcodec = SrsVideoCodecIdDisabled;
         } else {
@@ -389,17 +1103,25 @@ srs_error_t SrsHlsMuxer::segment_open()
         }
     }
     
-    // new segment.
-    current = new SrsHlsSegment(context, default_acodec, default_vcodec, writer);
+    // Use the codec of stream once got it.
+    if (default_vcodec != SrsVideoCodecIdDisabled && latest_vcodec != SrsVideoCodecIdForbidden) {
+        default_vcodec = latest_vcodec;
+    }
+    
+    // new segment, cache in memory when required.
+    SrsHlsMemoryWriter* memory = NULL;
+    if (hls_memory) {
+        memory = new SrsHlsMemoryWriter(hls_memory_archive? writer : NULL);
+    }
+    current = new SrsHlsSegment(context, default_acodec, default_vcodec, writer, memory, ts_handler? &ts_packets : NULL);
     current->sequence_no = _sequence_no++;
-
+    
     if ((err = write_hls_key()) != srs_success) {
         return srs_error_wrap(err, "write hls key");
     }
     
     // generate filename.
-    std::string ts_file = hls_ts_file;
-    ts_file = srs_path_build_stream(ts_file, req->vhost, req->app, req->stream);
+    int64_t ts_floor = -1;
     if (hls_ts_floor) {
         // accept the floor ts for the first piece.
         int64_t current_floor_ts = srs_update_system_time() / hls_fragment;
@@ -426,21 +1148,10 @@ srs_error_t SrsHlsMuxer::segment_open()
         previous_floor_ts = current_floor_ts;
         
         // we always ensure the piece is increase one by one.
-        std::stringstream ts_floor;
-        ts_floor << accept_floor_ts;
-        ts_file = srs_string_replace(ts_file, "[timestamp]", ts_floor.str());
-        
         // TODO: FIMXE: we must use the accept ts floor time to generate the hour variable.
-        ts_file = srs_path_build_timestamp(ts_file);
-    } else {
-        ts_file = srs_path_build_timestamp(ts_file);
-    }
-    if (true) {
-        std::stringstream ss;
-        ss << current->sequence_no;
-        ts_file = srs_string_replace(ts_file, "[seq]", ss.str());
+        ts_floor = accept_floor_ts;
     }
-    current->set_path(hls_path + "/" + ts_file);
+    current->set_path(hls_path + "/" + ts_template->render(current->sequence_no, ts_floor));
     
     // the ts url, relative or absolute url.
     // TODO: FIXME: Use url and path manager.
@@ -470,16 +1181,26 @@ srs_error_t SrsHlsMuxer::segment_open()
     
     // open temp ts file.
     std::string tmp_file = current->tmppath();
-    if ((err = current->writer->open(tmp_file)) != srs_success) {
+    if (current->archive && (err = current->writer->open(tmp_file)) != srs_success) {
         return srs_error_wrap(err, "open hls muxer");
     }
-
+    
     // reset the context for a new ts start.
     context->reset();
     
     return err;
 }
 
+void SrsHlsMuxer::set_latest_vcodec(SrsVideoCodecId v)
+{
+    latest_vcodec = v;
+    
+    // Switch the codec of current segment, the PAT/PMT is written before next frame.
+    if (current && current->tscw->video_codec() != SrsVideoCodecIdDisabled) {
+        current->tscw->set_video_codec(v);
+    }
+}
+
 srs_error_t SrsHlsMuxer::on_sequence_header()
 {
     srs_error_t err = srs_success;
@@ -503,8 +1224,24 @@ bool SrsHlsMuxer::is_segment_overflow()
     }
     
     // use N% deviation, to smoother.
-    srs_utime_t deviation = hls_ts_floor? SRS_HLS_FLOOR_REAP_PERCENT * deviation_ts * hls_fragment : 0;
-    return current->duration() >= hls_fragment + deviation;
+    srs_utime_t target = fragment();
+    srs_utime_t deviation = hls_ts_floor? SRS_HLS_FLOOR_REAP_PERCENT * deviation_ts * target : 0;
+    return current->duration() >= target + deviation;
+}
+
+srs_utime_t SrsHlsMuxer::fragment()
+{
+    if (!hls_fast_start || hls_fast_start >= hls_fragment) {
+        return hls_fragment;
+    }
+    
+    // Reap the first segments at the earliest keyframes, then grow to the hls_fragment,
+    // so the m3u8 is playable in seconds, for the players start 3 segments from the end.
+    srs_utime_t target = hls_fast_start;
+    for (int i = 0; i < nn_reaped && target < hls_fragment; i++) {
+        target *= 2;
+    }
+    return srs_min(target, hls_fragment);
 }
 
 bool SrsHlsMuxer::wait_keyframe()
@@ -522,14 +1259,47 @@ bool SrsHlsMuxer::is_segment_absolutely_overflow()
         return false;
     }
     
-    // use N% deviation, to smoother.
-    srs_utime_t deviation = hls_ts_floor? SRS_HLS_FLOOR_REAP_PERCENT * deviation_ts * hls_fragment : 0;
-    return current->duration() >= hls_aof_ratio * hls_fragment + deviation;
-}
-
-bool SrsHlsMuxer::pure_audio()
-{
-    return current && current->tscw && current->tscw->video_codec() == SrsVideoCodecIdDisabled;
+    // use N% deviation, to smoother.
+    srs_utime_t target = fragment();
+    srs_utime_t deviation = hls_ts_floor? SRS_HLS_FLOOR_REAP_PERCENT * deviation_ts * target : 0;
+    return current->duration() >= hls_aof_ratio * target + deviation;
+}
+
+bool SrsHlsMuxer::pure_audio()
+{
+    return current && current->tscw && current->tscw->video_codec() == SrsVideoCodecIdDisabled;
+}
+
+int64_t SrsHlsMuxer::audio_aggregate()
+{
+    if (hls_audio_aggregate > 0) {
+        return srsu2ms(hls_audio_aggregate) * 90;
+    }
+    return pure_audio()? SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE : 0;
+}
+
+srs_error_t SrsHlsMuxer::segment_part(int64_t dts, bool video, bool keyframe)
+{
+    srs_error_t err = srs_success;
+    
+    if (!hls_ll || !current) {
+        return err;
+    }
+    
+    // Cut the part before this frame, when part duration exceed the target.
+    if (current->part_duration(dts) >= hls_ll_part) {
+        if ((err = current->close_part(dts)) != srs_success) {
+            return srs_error_wrap(err, "close part");
+        }
+        
+        if ((err = refresh_ll_m3u8()) != srs_success) {
+            return srs_error_wrap(err, "refresh ll m3u8");
+        }
+    }
+    
+    current->on_part_frame(video, keyframe);
+    
+    return err;
 }
 
 srs_error_t SrsHlsMuxer::flush_audio(SrsTsMessageCache* cache)
@@ -553,10 +1323,13 @@ srs_error_t SrsHlsMuxer::flush_audio(SrsTsMessageCache* cache)
         return srs_error_wrap(err, "hls: write audio");
     }
     
+    int64_t timestamp = cache->audio->dts / 90;
+    
     // write success, clear and free the msg
     srs_freep(cache->audio);
+    cache->update_memory();
     
-    return err;
+    return on_ts_packets(timestamp, false);
 }
 
 srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
@@ -582,19 +1355,23 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
         return srs_error_wrap(err, "hls: write video");
     }
     
+    int64_t timestamp = cache->video->dts / 90;
+    bool is_key = cache->video->write_pcr;
+    
     // write success, clear and free the msg
     srs_freep(cache->video);
+    cache->update_memory();
     
-    return err;
+    return on_ts_packets(timestamp, is_key);
 }
 
 srs_error_t SrsHlsMuxer::segment_close()
 {
     srs_error_t err = do_segment_close();
-
+    
     // We always cleanup current segment.
     srs_freep(current);
-
+    
     return err;
 }
 
@@ -609,10 +1386,18 @@ srs_error_t SrsHlsMuxer::do_segment_close()
     
     // when close current segment, the current segment must not be NULL.
     srs_assert(current);
-
+    
+    // The overhead of ts, the PES header, stuffing and PSI, for the stream.
+    SrsStatistic::instance()->on_hls_bytes(req, context->es_bytes(), context->ts_bytes());
+    
     // We should always close the underlayer writer.
     if (current && current->writer) {
+        // Flush the cache at the boundary of segment, because close ignores the error.
+        err = current->writer->flush();
         current->writer->close();
+        if (err != srs_success) {
+            return srs_error_wrap(err, "flush segment");
+        }
     }
     
     // valid, add to segments if segment duration is ok
@@ -633,6 +1418,13 @@ srs_error_t SrsHlsMuxer::do_segment_close()
             return srs_error_wrap(err, "segment close");
         }
         
+        _srs_events->on_hls(req, current->fullpath(), current->uri, current->sequence_no, current->duration());
+        
+        // close the last part of segment, for LL-HLS.
+        if (hls_ll && (err = current->close_part(-1)) != srs_success) {
+            return srs_error_wrap(err, "close part");
+        }
+        
         // close the muxer of finished segment.
         srs_freep(current->tscw);
         
@@ -641,8 +1433,29 @@ srs_error_t SrsHlsMuxer::do_segment_close()
             return srs_error_wrap(err, "rename");
         }
         
+        // The checksum is optional for CDN, so we ignore any error.
+        if (hls_checksum && current->archive && (err = current->write_checksum()) != srs_success) {
+            srs_warn("hls: ignore checksum err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        // The upload is async, so we ignore any error.
+        if (hls_upload && (err = upload_segment(current)) != srs_success) {
+            srs_warn("hls: ignore upload err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
         segments->append(current);
+        playlist->append(segment_entry(current));
         current = NULL;
+        nn_reaped++;
+        
+        // keep the parts of last segments, about 3 target durations.
+        int expired = segments->size() - 1 - SRS_HLS_LL_SEGMENTS;
+        if (hls_ll && expired >= 0) {
+            SrsHlsSegment* segment = dynamic_cast<SrsHlsSegment*>(segments->at(expired));
+            segment->clear_parts();
+        }
     } else {
         // reuse current segment index.
         _sequence_no--;
@@ -656,98 +1469,460 @@ srs_error_t SrsHlsMuxer::do_segment_close()
         }
     }
     
-    // shrink the segments.
-    segments->shrink(hls_window);
+    // shrink the segments, and remove the entries of expired segments.
+    int nn_segments = segments->size();
+    segments->shrink(hls_window);
+    playlist->shift(nn_segments - segments->size());
+    
+    // refresh the m3u8, donot contains the removed ts
+    err = refresh_m3u8();
+    
+    // remove the ts file.
+    segments->clear_expired(hls_cleanup);
+    
+    // check ret of refresh m3u8
+    if (err != srs_success) {
+        return srs_error_wrap(err, "hls: refresh m3u8");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::upload_segment(SrsHlsSegment* segment)
+{
+    string key = SrsUploader::key_of(hls_path, segment->fullpath());
+    
+    if (hls_memory) {
+        SrsHlsMemoryFile* file = _srs_hls_memory->fetch(segment->fullpath());
+        if (file) {
+            return _srs_uploader->put(req, key, file, false);
+        }
+    }
+    
+    // The encrypted segment is only in file, which is removed by hls_cleanup.
+    return _srs_uploader->put_file(req, key, segment->fullpath(), false);
+}
+
+srs_error_t SrsHlsMuxer::write_hls_key()
+{
+    srs_error_t err = srs_success;
+    
+    if (hls_keys && current->sequence_no % hls_fragments_per_key == 0) {
+        if (RAND_bytes(key, 16) < 0) {
+            return srs_error_wrap(err, "rand key failed.");
+        }
+        if (RAND_bytes(iv, 16) < 0) {
+            return srs_error_wrap(err, "rand iv failed.");
+        }
+        
+        string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
+        key_file = srs_string_replace(key_file, "[seq]", srs_int2str(current->sequence_no));
+        string key_url = hls_key_file_path + "/" + key_file;
+        
+        SrsFileWriter fw;
+        if ((err = fw.open(key_url)) != srs_success) {
+            return srs_error_wrap(err, "open file %s", key_url.c_str());
+        }
+        
+        err = fw.write(key, 16, NULL);
+        fw.close();
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "write key");
+        }
+    }
+    
+    if (hls_keys) {
+        current->config_cipher(key, iv);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::refresh_m3u8()
+{
+    srs_error_t err = srs_success;
+    
+    // no segments, also no m3u8, return.
+    if (segments->empty()) {
+        return err;
+    }
+    
+    std::string temp_m3u8 = m3u8 + ".temp";
+    if ((err = _refresh_m3u8(temp_m3u8)) == srs_success) {
+        // the m3u8 is not written to disk, when hls in memory without archive.
+        bool archive = !hls_memory || hls_memory_archive;
+        if (archive && _srs_disk_io->rename(temp_m3u8, m3u8) < 0) {
+            err = srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename m3u8 file failed. %s => %s", temp_m3u8.c_str(), m3u8.c_str());
+        }
+        _srs_http_file_meta->invalidate(m3u8);
+    }
+    
+    // remove the temp file.
+    if (srs_path_exists(temp_m3u8)) {
+        if (unlink(temp_m3u8.c_str()) < 0) {
+            srs_warn("ignore remove m3u8 failed, %s", temp_m3u8.c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
+{
+    srs_error_t err = srs_success;
+    
+    // no segments, return.
+    if (segments->empty()) {
+        return err;
+    }
+    
+    // #EXT-X-MEDIA-SEQUENCE:4294967295\n
+    SrsHlsSegment* first = dynamic_cast<SrsHlsSegment*>(segments->first());
+    
+    // #EXT-X-TARGETDURATION:4294967295\n
+    /**
+     * @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 25
+     * The Media Playlist file MUST contain an EXT-X-TARGETDURATION tag.
+     * Its value MUST be equal to or greater than the EXTINF duration of any
+     * media segment that appears or will appear in the Playlist file,
+     * rounded to the nearest integer. Its value MUST NOT change. A
+     * typical target duration is 10 seconds.
+     */
+    // @see https://github.com/ossrs/srs/issues/304#issuecomment-74000081
+    srs_utime_t max_duration = segments->max_duration();
+    int target_duration = (int)ceil(srsu2msi(srs_max(max_duration, max_td)) / 1000.0);
+    
+    // the entries of segments are serialized when segment closed, only the header is generated.
+    srs_assert(playlist->size() == segments->size());
+    std::string content = playlist->dumps(first->sequence_no, target_duration);
+    
+    // Upload the m3u8 after its segments, for they are uploaded in order.
+    if (hls_upload) {
+        SrsHlsMemoryFile* file = new SrsHlsMemoryFile(content.data(), (int)content.length());
+        if ((err = _srs_uploader->put(req, SrsUploader::key_of(hls_path, m3u8), file, true)) != srs_success) {
+            srs_warn("hls: ignore upload m3u8 err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    // update the m3u8 in memory, which is always complete.
+    if (hls_memory) {
+        if (!hls_ll) {
+            SrsHlsMemoryFile* file = new SrsHlsMemoryFile(content.data(), (int)content.length());
+            file->compress();
+            _srs_hls_memory->update(m3u8, file);
+        } else if ((err = refresh_ll_m3u8()) != srs_success) {
+            return srs_error_wrap(err, "hls: refresh ll m3u8");
+        }
+        if (!hls_memory_archive) {
+            return err;
+        }
+    }
+    
+    // write m3u8 to writer.
+    SrsFileWriter writer;
+    _srs_disk_io->attach(&writer);
+    if ((err = writer.open(m3u8_file)) != srs_success) {
+        return srs_error_wrap(err, "hls: open m3u8 file %s", m3u8_file.c_str());
+    }
+    
+    if ((err = writer.write((char*)content.c_str(), (int)content.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "hls: write m3u8");
+    }
+    
+    return err;
+}
+
+string SrsHlsMuxer::segment_entry(SrsHlsSegment* segment)
+{
+    std::stringstream ss;
+    
+    if (segment->is_sequence_header()) {
+        // #EXT-X-DISCONTINUITY\n
+        ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+    }
+    
+    if(hls_keys && ((segment->sequence_no % hls_fragments_per_key) == 0)) {
+        char hexiv[33];
+        srs_data_to_hex(hexiv, segment->iv, 16);
+        hexiv[32] = '\0';
+        
+        string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
+        key_file = srs_string_replace(key_file, "[seq]", srs_int2str(segment->sequence_no));
+        
+        string key_path = key_file;
+        //if key_url is not set,only use the file name
+        if (!hls_key_url.empty()) {
+            key_path = hls_key_url + key_file;
+        }
+        
+        ss << "#EXT-X-KEY:METHOD=AES-128,URI=" << "\"" << key_path << "\",IV=0x" << hexiv << SRS_CONSTS_LF;
+    }
+    
+    // "#EXTINF:4294967295.208,\n"
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    ss << "#EXTINF:" << srsu2msi(segment->duration()) / 1000.0 << ", no desc" << SRS_CONSTS_LF;
+    
+    // {file name}\n
+    std::string seg_uri = segment->uri;
+    if (true) {
+        std::stringstream stemp;
+        stemp << srsu2msi(segment->duration());
+        seg_uri = srs_string_replace(seg_uri, "[duration]", stemp.str());
+    }
+    ss << seg_uri << SRS_CONSTS_LF;
+    
+    return ss.str();
+}
+
+srs_error_t SrsHlsMuxer::refresh_ll_m3u8()
+{
+    srs_error_t err = srs_success;
+    
+    // no segments and parts, also no m3u8.
+    if (segments->empty() && (!current || current->parts.empty())) {
+        return err;
+    }
+    
+    srs_utime_t max_duration = segments->max_duration();
+    int target_duration = (int)ceil(srsu2msi(srs_max(max_duration, max_td)) / 1000.0);
+    
+    std::stringstream ss;
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    
+    // The PART-HOLD-BACK must be at least twice the part target, we use 3.
+    double part_target = srsu2msi(hls_ll_part) / 1000.0;
+    ss << "#EXTM3U" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:6" << SRS_CONSTS_LF;
+    ss << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+    ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" << part_target * 3 << SRS_CONSTS_LF;
+    ss << "#EXT-X-PART-INF:PART-TARGET=" << part_target << SRS_CONSTS_LF;
+    
+    int first_sequence_no = current? current->sequence_no : 0;
+    if (!segments->empty()) {
+        first_sequence_no = dynamic_cast<SrsHlsSegment*>(segments->first())->sequence_no;
+    }
+    ss << "#EXT-X-MEDIA-SEQUENCE:" << first_sequence_no << SRS_CONSTS_LF;
+    
+    // write all segments, with parts of the last segments.
+    for (int i = 0; i < segments->size(); i++) {
+        SrsHlsSegment* segment = dynamic_cast<SrsHlsSegment*>(segments->at(i));
+        
+        if (segment->is_sequence_header()) {
+            ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+        }
+        
+        for (int j = 0; j < (int)segment->parts.size(); j++) {
+            SrsHlsPart* part = segment->parts.at(j);
+            ss << "#EXT-X-PART:DURATION=" << srsu2msi(part->duration) / 1000.0 << ",URI=\"" << part->uri << "\"";
+            if (part->independent) {
+                ss << ",INDEPENDENT=YES";
+            }
+            ss << SRS_CONSTS_LF;
+        }
+        
+        ss << "#EXTINF:" << srsu2msi(segment->duration()) / 1000.0 << ", no desc" << SRS_CONSTS_LF;
+        ss << srs_string_replace(segment->uri, "[duration]", srs_int2str(srsu2msi(segment->duration()))) << SRS_CONSTS_LF;
+    }
+    
+    // write the parts of current segment, and the hint of next part.
+    SrsHlsPlaylistState state;
+    state.complete = segments->empty()? -1 : dynamic_cast<SrsHlsSegment*>(segments->at(segments->size() - 1))->sequence_no;
+    state.msn = state.complete;
+    state.part = -1;
+    state.timeout = 3 * target_duration * SRS_UTIME_SECONDS;
+    
+    if (current) {
+        if (current->is_sequence_header()) {
+            ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+        }
+        
+        for (int j = 0; j < (int)current->parts.size(); j++) {
+            SrsHlsPart* part = current->parts.at(j);
+            ss << "#EXT-X-PART:DURATION=" << srsu2msi(part->duration) / 1000.0 << ",URI=\"" << part->uri << "\"";
+            if (part->independent) {
+                ss << ",INDEPENDENT=YES";
+            }
+            ss << SRS_CONSTS_LF;
+        }
+        
+        int next = (int)current->parts.size();
+        ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << current->part_uri(next) << "\"" << SRS_CONSTS_LF;
+        
+        if (next > 0) {
+            state.msn = current->sequence_no;
+            state.part = next - 1;
+        }
+        state.hint = current->part_path(next);
+    }
+    
+    std::string content = ss.str();
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile(content.data(), (int)content.length());
+    file->compress();
+    _srs_hls_memory->update(m3u8, file);
+    _srs_hls_memory->update_state(m3u8, state);
+    
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::on_ts_packets(int64_t timestamp, bool is_key)
+{
+    srs_error_t err = srs_success;
+    
+    if (ts_handler && !ts_packets.empty()) {
+        err = ts_handler->on_hls_ts(ts_packets, timestamp, is_key);
+    }
+    ts_packets.clear();
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "hls: share ts");
+    }
+    
+    return err;
+}
+
+SrsHlsVariant::SrsHlsVariant(SrsHlsVariantGroup* g, string s)
+{
+    group = g;
+    suffix = s;
+    bandwidth = 0;
+    active = false;
+    cursor = 0;
+}
+
+SrsHlsVariant::~SrsHlsVariant()
+{
+}
+
+SrsHlsVariantGroup::SrsHlsVariantGroup(string v, string m, string mu)
+{
+    vhost = v;
+    master = m;
+    master_url = mu;
+    cuts_base = 0;
+}
+
+SrsHlsVariantGroup::~SrsHlsVariantGroup()
+{
+    std::vector<SrsHlsVariant*>::iterator it;
+    for (it = variants.begin(); it != variants.end(); ++it) {
+        SrsHlsVariant* variant = *it;
+        srs_freep(variant);
+    }
+    variants.clear();
+}
+
+SrsHlsVariant* SrsHlsVariantGroup::fetch_or_create(string suffix)
+{
+    for (int i = 0; i < (int)variants.size(); i++) {
+        SrsHlsVariant* variant = variants.at(i);
+        if (variant->suffix == suffix) {
+            return variant;
+        }
+    }
+    
+    SrsHlsVariant* variant = new SrsHlsVariant(this, suffix);
+    variants.push_back(variant);
+    return variant;
+}
+
+srs_error_t SrsHlsVariantGroup::join(SrsHlsVariant* variant, string m3u8_url)
+{
+    srs_error_t err = srs_success;
     
-    // refresh the m3u8, donot contains the removed ts
-    err = refresh_m3u8();
+    variant->m3u8_url = m3u8_url;
+    variant->active = true;
     
-    // remove the ts file.
-    segments->clear_expired(hls_cleanup);
+    // Start from the segment of others, and cut at the next cut of group.
+    variant->cursor = cuts_base + (int)cuts.size();
     
-    // check ret of refresh m3u8
-    if (err != srs_success) {
-        return srs_error_wrap(err, "hls: refresh m3u8");
+    if ((err = refresh_master()) != srs_success) {
+        return srs_error_wrap(err, "refresh master");
     }
     
     return err;
 }
 
-srs_error_t SrsHlsMuxer::write_hls_key()
+srs_error_t SrsHlsVariantGroup::leave(SrsHlsVariant* variant)
 {
     srs_error_t err = srs_success;
     
-    if (hls_keys && current->sequence_no % hls_fragments_per_key == 0) {
-        if (RAND_bytes(key, 16) < 0) {
-            return srs_error_wrap(err, "rand key failed.");
-        }
-        if (RAND_bytes(iv, 16) < 0) {
-            return srs_error_wrap(err, "rand iv failed.");
-        }
-        
-        string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
-        key_file = srs_string_replace(key_file, "[seq]", srs_int2str(current->sequence_no));
-        string key_url = hls_key_file_path + "/" + key_file;
-        
-        SrsFileWriter fw;
-        if ((err = fw.open(key_url)) != srs_success) {
-            return srs_error_wrap(err, "open file %s", key_url.c_str());
-        }
-        
-        err = fw.write(key, 16, NULL);
-        fw.close();
-        
-        if (err != srs_success) {
-            return srs_error_wrap(err, "write key");
-        }
-    }
+    variant->active = false;
     
-    if (hls_keys) {
-        current->config_cipher(key, iv);
+    if ((err = refresh_master()) != srs_success) {
+        return srs_error_wrap(err, "refresh master");
     }
     
     return err;
 }
 
-srs_error_t SrsHlsMuxer::refresh_m3u8()
+bool SrsHlsVariantGroup::should_cut(SrsHlsVariant* variant, int64_t dts, srs_utime_t duration, bool overflow, bool absolutely)
 {
-    srs_error_t err = srs_success;
+    // The variant is too late, skip the cuts which are not kept.
+    if (variant->cursor < cuts_base) {
+        srs_warn("hls: variant %s skip cuts %d=>%d", variant->suffix.c_str(), variant->cursor, cuts_base);
+        variant->cursor = cuts_base;
+    }
     
-    // no segments, also no m3u8, return.
-    if (segments->empty()) {
-        return err;
+    // Lead a new cut, when no other variant cut this segment.
+    int end = cuts_base + (int)cuts.size();
+    if (variant->cursor >= end) {
+        return overflow;
     }
     
-    std::string temp_m3u8 = m3u8 + ".temp";
-    if ((err = _refresh_m3u8(temp_m3u8)) == srs_success) {
-        if (rename(temp_m3u8.c_str(), m3u8.c_str()) < 0) {
-            err = srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename m3u8 file failed. %s => %s", temp_m3u8.c_str(), m3u8.c_str());
-        }
+    // Follow the cut of others at the keyframe of the same timestamp, or cut later if the keyframe is not aligned.
+    // @remark Never cut a very small segment, when the variant is ahead of others.
+    int64_t cut = cuts.at(variant->cursor - cuts_base);
+    if (dts + SRS_HLS_VARIANT_DEVIATION >= cut) {
+        return duration >= 2 * SRS_AUTO_HLS_SEGMENT_MIN_DURATION;
     }
     
-    // remove the temp file.
-    if (srs_path_exists(temp_m3u8)) {
-        if (unlink(temp_m3u8.c_str()) < 0) {
-            srs_warn("ignore remove m3u8 failed, %s", temp_m3u8.c_str());
-        }
+    // The timestamp of variant is not aligned to others, cut it to keep the sequence.
+    if (absolutely) {
+        srs_warn("hls: variant %s not aligned, dts=%" PRId64 ", cut=%" PRId64, variant->suffix.c_str(), dts, cut);
+        return true;
     }
     
-    return err;
+    return false;
 }
 
-srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
+void SrsHlsVariantGroup::cut(SrsHlsVariant* variant, int64_t dts)
 {
-    srs_error_t err = srs_success;
+    if (variant->cursor < cuts_base) {
+        variant->cursor = cuts_base;
+    }
     
-    // no segments, return.
-    if (segments->empty()) {
-        return err;
+    // Lead a new cut, for others to follow.
+    int end = cuts_base + (int)cuts.size();
+    if (variant->cursor >= end) {
+        cuts.push_back(dts);
+        
+        if ((int)cuts.size() > SRS_HLS_VARIANT_CUTS) {
+            cuts.pop_front();
+            cuts_base++;
+        }
+        
+        variant->cursor = end + 1;
+        return;
     }
     
-    SrsFileWriter writer;
-    if ((err = writer.open(m3u8_file)) != srs_success) {
-        return srs_error_wrap(err, "hls: open m3u8 file %s", m3u8_file.c_str());
+    // Follow the last cut before the keyframe, to catch up the others when the variant is late.
+    int cursor = variant->cursor + 1;
+    while (cursor < end && dts + SRS_HLS_VARIANT_DEVIATION >= cuts.at(cursor - cuts_base)) {
+        cursor++;
     }
+    variant->cursor = cursor;
+}
+
+srs_error_t SrsHlsVariantGroup::refresh_master()
+{
+    srs_error_t err = srs_success;
+    
+    bool hls_memory = _srs_config->get_hls_memory(vhost);
+    bool archive = !hls_memory || _srs_config->get_hls_memory_archive(vhost);
     
     // #EXTM3U\n
     // #EXT-X-VERSION:3\n
@@ -755,83 +1930,159 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     ss << "#EXTM3U" << SRS_CONSTS_LF;
     ss << "#EXT-X-VERSION:3" << SRS_CONSTS_LF;
     
-    // #EXT-X-MEDIA-SEQUENCE:4294967295\n
-    SrsHlsSegment* first = dynamic_cast<SrsHlsSegment*>(segments->first());
-    ss << "#EXT-X-MEDIA-SEQUENCE:" << first->sequence_no << SRS_CONSTS_LF;
-    
-    // iterator shared for td generation and segemnts wrote.
-    std::vector<SrsHlsSegment*>::iterator it;
-    
-    // #EXT-X-TARGETDURATION:4294967295\n
-    /**
-     * @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 25
-     * The Media Playlist file MUST contain an EXT-X-TARGETDURATION tag.
-     * Its value MUST be equal to or greater than the EXTINF duration of any
-     * media segment that appears or will appear in the Playlist file,
-     * rounded to the nearest integer. Its value MUST NOT change. A
-     * typical target duration is 10 seconds.
-     */
-    // @see https://github.com/ossrs/srs/issues/304#issuecomment-74000081
-    srs_utime_t max_duration = segments->max_duration();
-    int target_duration = (int)ceil(srsu2msi(srs_max(max_duration, max_td)) / 1000.0);
-    
-    ss << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+    // The media playlist url is relative to master, or absolute when not in the same dir.
+    string master_dir = srs_path_dirname(master_url);
     
-    // write all segments
-    for (int i = 0; i < segments->size(); i++) {
-        SrsHlsSegment* segment = dynamic_cast<SrsHlsSegment*>(segments->at(i));
+    int nn_active = 0;
+    for (int i = 0; i < (int)variants.size(); i++) {
+        SrsHlsVariant* variant = variants.at(i);
+        if (!variant->active) {
+            continue;
+        }
+        nn_active++;
         
-        if (segment->is_sequence_header()) {
-            // #EXT-X-DISCONTINUITY\n
-            ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+        // #EXT-X-STREAM-INF:BANDWIDTH=500000,RESOLUTION=640x360\n
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << variant->bandwidth;
+        if (!variant->resolution.empty()) {
+            ss << ",RESOLUTION=" << variant->resolution;
         }
+        ss << SRS_CONSTS_LF;
         
-        if(hls_keys && ((segment->sequence_no % hls_fragments_per_key) == 0)) {
-            char hexiv[33];
-            srs_data_to_hex(hexiv, segment->iv, 16);
-            hexiv[32] = '\0';
-            
-            string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
-            key_file = srs_string_replace(key_file, "[seq]", srs_int2str(segment->sequence_no));
-            
-            string key_path = key_file;
-            //if key_url is not set,only use the file name
-            if (!hls_key_url.empty()) {
-                key_path = hls_key_url + key_file;
+        string url = variant->m3u8_url;
+        if (!master_dir.empty() && master_dir != "." && master_dir != "./") {
+            if (srs_string_starts_with(url, master_dir + "/")) {
+                url = url.substr(master_dir.length() + 1);
+            } else {
+                url = "/" + url;
             }
-            
-            ss << "#EXT-X-KEY:METHOD=AES-128,URI=" << "\"" << key_path << "\",IV=0x" << hexiv << SRS_CONSTS_LF;
         }
-        
-        // "#EXTINF:4294967295.208,\n"
-        ss.precision(3);
-        ss.setf(std::ios::fixed, std::ios::floatfield);
-        ss << "#EXTINF:" << srsu2msi(segment->duration()) / 1000.0 << ", no desc" << SRS_CONSTS_LF;
-        
-        // {file name}\n
-        std::string seg_uri = segment->uri;
-        if (true) {
-	        std::stringstream stemp;
-	        stemp << srsu2msi(segment->duration());
-	        seg_uri = srs_string_replace(seg_uri, "[duration]", stemp.str());
+        ss << url << SRS_CONSTS_LF;
+    }
+    
+    // Remove the master playlist when no rendition.
+    if (!nn_active) {
+        if (hls_memory) {
+            _srs_hls_memory->remove(master);
         }
-        //ss << segment->uri << SRS_CONSTS_LF;
-        ss << seg_uri << SRS_CONSTS_LF;
+        _srs_http_file_meta->invalidate(master);
+        if (archive && srs_path_exists(master) && unlink(master.c_str()) < 0) {
+            srs_warn("ignore remove master %s failed", master.c_str());
+        }
+        return err;
     }
     
-    // write m3u8 to writer.
-    std::string m3u8 = ss.str();
-    if ((err = writer.write((char*)m3u8.c_str(), (int)m3u8.length(), NULL)) != srs_success) {
-        return srs_error_wrap(err, "hls: write m3u8");
+    std::string content = ss.str();
+    
+    if (hls_memory) {
+        _srs_hls_memory->update(master, new SrsHlsMemoryFile(content.data(), (int)content.length()));
+    }
+    if (!archive) {
+        return err;
+    }
+    
+    if ((err = _srs_disk_io->create_dir(srs_path_dirname(master))) != srs_success) {
+        return srs_error_wrap(err, "create dir");
+    }
+    
+    // Write to temp file then rename, the player never gets a partial master.
+    std::string temp = master + ".temp";
+    if (true) {
+        SrsFileWriter writer;
+        _srs_disk_io->attach(&writer);
+        if ((err = writer.open(temp)) != srs_success) {
+            return srs_error_wrap(err, "hls: open master %s", temp.c_str());
+        }
+        if ((err = writer.write((char*)content.c_str(), (int)content.length(), NULL)) != srs_success) {
+            return srs_error_wrap(err, "hls: write master");
+        }
+    }
+    
+    int r0 = _srs_disk_io->rename(temp, master);
+    _srs_http_file_meta->invalidate(master);
+    if (r0 < 0) {
+        return srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename master %s => %s", temp.c_str(), master.c_str());
+    }
+    
+    return err;
+}
+
+SrsHlsVariantManager::SrsHlsVariantManager()
+{
+}
+
+SrsHlsVariantManager::~SrsHlsVariantManager()
+{
+    std::map<std::string, SrsHlsVariantGroup*>::iterator it;
+    for (it = groups.begin(); it != groups.end(); ++it) {
+        SrsHlsVariantGroup* group = it->second;
+        srs_freep(group);
+    }
+    groups.clear();
+}
+
+srs_error_t SrsHlsVariantManager::join(SrsRequest* req, string m3u8_url, SrsHlsVariant** pvariant)
+{
+    srs_error_t err = srs_success;
+    
+    *pvariant = NULL;
+    
+    // Find the rendition of stream, by the longest suffix, for example, _hd:1500000:1280x720
+    std::vector<std::string> args;
+    std::vector<std::string> renditions = _srs_config->get_hls_variants(req->vhost);
+    for (int i = 0; i < (int)renditions.size(); i++) {
+        std::vector<std::string> fields = srs_string_split(renditions.at(i), ":");
+        string suffix = fields.at(0);
+        if (suffix.empty() || req->stream.length() <= suffix.length() || !srs_string_ends_with(req->stream, suffix)) {
+            continue;
+        }
+        if (args.empty() || suffix.length() > args.at(0).length()) {
+            args = fields;
+        }
+    }
+    
+    if (args.empty()) {
+        return err;
+    }
+    
+    string suffix = args.at(0);
+    string stream = req->stream.substr(0, req->stream.length() - suffix.length());
+    
+    string key = req->vhost + "/" + req->app + "/" + stream;
+    SrsHlsVariantGroup* group = NULL;
+    if (groups.find(key) != groups.end()) {
+        group = groups[key];
+    } else {
+        // The master playlist, for example, [app]/[stream]_master.m3u8
+        string master_url = srs_path_build_stream(_srs_config->get_hls_m3u8_file(req->vhost), req->vhost, req->app, stream + "_master");
+        string master = _srs_config->get_hls_path(req->vhost) + "/" + master_url;
+        
+        group = new SrsHlsVariantGroup(req->vhost, master, master_url);
+        groups[key] = group;
+    }
+    
+    // Update the variant, for config maybe reloaded.
+    SrsHlsVariant* variant = group->fetch_or_create(suffix);
+    variant->bandwidth = (args.size() > 1)? ::atoi(args.at(1).c_str()) : 0;
+    variant->resolution = (args.size() > 2)? args.at(2) : "";
+    
+    if ((err = group->join(variant, m3u8_url)) != srs_success) {
+        return srs_error_wrap(err, "join %s", key.c_str());
     }
     
+    *pvariant = variant;
+    srs_trace("hls: variant %s join group %s, bandwidth=%d, resolution=%s, cursor=%d",
+        suffix.c_str(), key.c_str(), variant->bandwidth, variant->resolution.c_str(), variant->cursor);
+    
     return err;
 }
 
+SrsHlsVariantManager* _srs_hls_variants = new SrsHlsVariantManager();
+
 SrsHlsController::SrsHlsController()
 {
     tsmc = new SrsTsMessageCache();
     muxer = new SrsHlsMuxer();
+    variant = NULL;
 }
 
 SrsHlsController::~SrsHlsController()
@@ -874,6 +2125,16 @@ int SrsHlsController::deviation()
     return muxer->deviation();
 }
 
+void SrsHlsController::set_ts_handler(ISrsHlsTsHandler* h)
+{
+    muxer->set_ts_handler(h);
+}
+
+void SrsHlsController::set_memory(SrsMemoryStat* v)
+{
+    tsmc->set_memory(v);
+}
+
 srs_error_t SrsHlsController::on_publish(SrsRequest* req)
 {
     srs_error_t err = srs_success;
@@ -899,7 +2160,7 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
     bool ts_floor = _srs_config->get_hls_ts_floor(vhost);
     // the seconds to dispose the hls.
     srs_utime_t hls_dispose = _srs_config->get_hls_dispose(vhost);
-
+    
     bool hls_keys = _srs_config->get_hls_keys(vhost);
     int hls_fragments_per_key = _srs_config->get_hls_fragments_per_key(vhost);
     string hls_key_file =  _srs_config->get_hls_key_file(vhost);
@@ -908,7 +2169,7 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
     
     // TODO: FIXME: support load exists m3u8, to continue publish stream.
     // for the HLS donot requires the EXT-X-MEDIA-SEQUENCE be monotonically increase.
-
+    
     if ((err = muxer->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "muxer publish");
     }
@@ -919,13 +2180,22 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
         return srs_error_wrap(err, "hls: update config");
     }
     
+    // Join the variant group when stream is a rendition, to share the sequence of group.
+    string m3u8_url = srs_path_build_stream(m3u8_file, vhost, app, stream);
+    if ((err = _srs_hls_variants->join(req, m3u8_url, &variant)) != srs_success) {
+        return srs_error_wrap(err, "hls: join variant");
+    }
+    if (variant) {
+        muxer->set_sequence_no(variant->cursor);
+    }
+    
     if ((err = muxer->segment_open()) != srs_success) {
         return srs_error_wrap(err, "hls: segment open");
     }
-
+    
     // This config item is used in SrsHls, we just log its value here.
     bool hls_dts_directly = _srs_config->get_vhost_hls_dts_directly(req->vhost);
-
+    
     srs_trace("hls: win=%dms, frag=%dms, prefix=%s, path=%s, m3u8=%s, ts=%s, aof=%.2f, floor=%d, clean=%d, waitk=%d, dispose=%dms, dts_directly=%d",
         srsu2msi(hls_window), srsu2msi(hls_fragment), entry_prefix.c_str(), path.c_str(), m3u8_file.c_str(), ts_file.c_str(),
         hls_aof_ratio, ts_floor, cleanup, wait_keyframe, srsu2msi(hls_dispose), hls_dts_directly);
@@ -936,7 +2206,7 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
 srs_error_t SrsHlsController::on_unpublish()
 {
     srs_error_t err = srs_success;
-
+    
     if ((err = muxer->on_unpublish()) != srs_success) {
         return srs_error_wrap(err, "muxer unpublish");
     }
@@ -949,9 +2219,35 @@ srs_error_t SrsHlsController::on_unpublish()
         return srs_error_wrap(err, "hls: segment close");
     }
     
+    // Leave the variant group, remove it from master playlist.
+    if (variant) {
+        SrsHlsVariant* v = variant;
+        variant = NULL;
+        if ((err = v->group->leave(v)) != srs_success) {
+            return srs_error_wrap(err, "hls: leave variant");
+        }
+    }
+    
     return err;
 }
 
+srs_error_t SrsHlsController::on_republish()
+{
+    srs_error_t err = srs_success;
+    
+    // The audio of previous publisher belongs to current segment.
+    if ((err = muxer->flush_audio(tsmc)) != srs_success) {
+        return srs_error_wrap(err, "hls: flush audio");
+    }
+    
+    if ((err = reap_segment()) != srs_success) {
+        return srs_error_wrap(err, "hls: reap segment");
+    }
+    
+    // Write a discontinuity before the new segment.
+    return muxer->on_sequence_header();
+}
+
 srs_error_t SrsHlsController::on_sequence_header()
 {
     // TODO: support discontinuity for the same stream
@@ -981,17 +2277,29 @@ srs_error_t SrsHlsController::write_audio(SrsAudioFrame* frame, int64_t pts)
     // we use absolutely overflow of segment to make jwplayer/ffplay happy
     // @see https://github.com/ossrs/srs/issues/151#issuecomment-71155184
     if (tsmc->audio && muxer->is_segment_absolutely_overflow()) {
+        // the last part of segment ends at this frame, for LL-HLS.
+        if ((err = muxer->segment_part(pts / 90, false, false)) != srs_success) {
+            return srs_error_wrap(err, "hls: segment part");
+        }
+        
+        if (variant) {
+            variant->group->cut(variant, pts / 90);
+        }
+        
         if ((err = reap_segment()) != srs_success) {
             return srs_error_wrap(err, "hls: reap segment");
         }
     }
     
-    // for pure audio, aggregate some frame to one.
-    // TODO: FIXME: Check whether it's necessary.
-    if (muxer->pure_audio() && tsmc->audio) {
-        if (pts - tsmc->audio->start_pts < SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE) {
-            return err;
-        }
+    // aggregate some frames to one PES, to reduce the overhead of PES header and stuffing of ts,
+    // which is about 10% for the low bitrate audio frame by frame.
+    if (tsmc->audio && pts - tsmc->audio->start_pts < muxer->audio_aggregate()) {
+        return err;
+    }
+    
+    // cut the part for LL-HLS, only for pure audio, for the part is cut by video.
+    if (muxer->pure_audio() && (err = muxer->segment_part(pts / 90, false, false)) != srs_success) {
+        return srs_error_wrap(err, "hls: segment part");
     }
     
     // directly write the audio frame by frame to ts,
@@ -1009,24 +2317,49 @@ srs_error_t SrsHlsController::write_video(SrsVideoFrame* frame, int64_t dts)
 {
     srs_error_t err = srs_success;
     
+    // Use the codec of stream, for h.264 or h.265.
+    muxer->set_latest_vcodec(frame->vcodec()->id);
+    
     // write video to cache.
     if ((err = tsmc->cache_video(frame, dts)) != srs_success) {
         return srs_error_wrap(err, "hls: cache video");
     }
     
+    // cut the part for LL-HLS, before reap the segment,
+    // so the last part of segment ends at this frame.
+    bool keyframe = frame->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+    if ((err = muxer->segment_part(dts / 90, true, keyframe)) != srs_success) {
+        return srs_error_wrap(err, "hls: segment part");
+    }
+    
     // when segment overflow, reap if possible.
-    if (muxer->is_segment_overflow()) {
+    bool reap = false;
+    if (variant) {
+        // the rendition of variant group always reap at keyframe, aligned to the cut of group.
+        reap = keyframe && variant->group->should_cut(variant, dts / 90, muxer->duration(),
+            muxer->is_segment_overflow(), muxer->is_segment_absolutely_overflow());
+        if (reap) {
+            variant->group->cut(variant, dts / 90);
+        }
+    } else if (muxer->is_segment_overflow()) {
         // do reap ts if any of:
         //      a. wait keyframe and got keyframe.
         //      b. always reap when not wait keyframe.
-        if (!muxer->wait_keyframe() || frame->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
-            // reap the segment, which will also flush the video.
-            if ((err = reap_segment()) != srs_success) {
-                return srs_error_wrap(err, "hls: reap segment");
-            }
+        reap = !muxer->wait_keyframe() || keyframe;
+    }
+    
+    if (reap) {
+        // reap the segment, which will also flush the video.
+        if ((err = reap_segment()) != srs_success) {
+            return srs_error_wrap(err, "hls: reap segment");
         }
     }
     
+    // mark the first part of new segment if reaped, which starts with this frame.
+    if ((err = muxer->segment_part(dts / 90, true, keyframe)) != srs_success) {
+        return srs_error_wrap(err, "hls: segment part");
+    }
+    
     // flush video when got one
     if ((err = muxer->flush_video(tsmc)) != srs_success) {
         return srs_error_wrap(err, "hls: flush video");
@@ -1050,10 +2383,15 @@ srs_error_t SrsHlsController::reap_segment()
             srs_warn("close segment err %s", srs_error_desc(r0).c_str());
             srs_freep(r0);
         }
-
+        
         return srs_error_wrap(err, "hls: segment close");
     }
     
+    // the segment of variant share the sequence of group.
+    if (variant) {
+        muxer->set_sequence_no(variant->cursor);
+    }
+    
     // open new ts.
     if ((err = muxer->segment_open()) != srs_success) {
         return srs_error_wrap(err, "hls: segment open");
@@ -1083,6 +2421,7 @@ SrsHls::SrsHls()
     disposable = false;
     last_update_time = 0;
     hls_dts_directly = false;
+    ts_handler = NULL;
     
     previous_audio_dts = 0;
     aac_samples = 0;
@@ -1148,6 +2487,15 @@ srs_error_t SrsHls::cycle()
     return err;
 }
 
+bool SrsHls::pending()
+{
+    if (!req || !disposable) {
+        return false;
+    }
+    
+    return _srs_config->get_hls_dispose(req->vhost) > 0;
+}
+
 srs_error_t SrsHls::initialize(SrsOriginHub* h, SrsRequest* r)
 {
     srs_error_t err = srs_success;
@@ -1162,10 +2510,21 @@ srs_error_t SrsHls::initialize(SrsOriginHub* h, SrsRequest* r)
     return err;
 }
 
+void SrsHls::set_ts_handler(ISrsHlsTsHandler* h)
+{
+    ts_handler = h;
+    controller->set_ts_handler(h);
+}
+
+void SrsHls::set_memory(SrsMemoryStat* v)
+{
+    controller->set_memory(v);
+}
+
 srs_error_t SrsHls::on_publish()
 {
     srs_error_t err = srs_success;
-
+    
     // update the hls time, for hls_dispose.
     last_update_time = srs_get_system_time();
     
@@ -1181,7 +2540,7 @@ srs_error_t SrsHls::on_publish()
     if ((err = controller->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "hls: on publish");
     }
-
+    
     // If enabled, directly turn FLV timestamp to TS DTS.
     // @remark It'll be reloaded automatically, because the origin hub will republish while reloading.
     hls_dts_directly = _srs_config->get_vhost_hls_dts_directly(req->vhost);
@@ -1210,16 +2569,42 @@ void SrsHls::on_unpublish()
     }
     
     enabled = false;
+    
+    if (ts_handler) {
+        ts_handler->on_hls_unpublish();
+    }
 }
 
-srs_error_t SrsHls::on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* format)
+srs_error_t SrsHls::on_republish()
 {
     srs_error_t err = srs_success;
     
     if (!enabled) {
         return err;
     }
+    
+    // update the hls time, for hls_dispose.
+    last_update_time = srs_get_system_time();
+    
+    // The timestamp of new publisher restarts, so does the aac samples.
+    previous_audio_dts = 0;
+    aac_samples = 0;
+    
+    if ((err = controller->on_republish()) != srs_success) {
+        return srs_error_wrap(err, "hls: on republish");
+    }
+    
+    return err;
+}
 
+srs_error_t SrsHls::on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    if (!enabled) {
+        return err;
+    }
+    
     // Ignore if no format->acodec, it means the codec is not parsed, or unknown codec.
     // @issue https://github.com/ossrs/srs/issues/1506#issuecomment-562079474
     if (!format->acodec) {
@@ -1254,11 +2639,11 @@ srs_error_t SrsHls::on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* forma
         previous_audio_dts = audio->timestamp;
         aac_samples = 0;
     }
-
+    
     // The diff duration in ms between two FLV audio packets.
     int diff = ::abs((int)(audio->timestamp - previous_audio_dts));
     previous_audio_dts = audio->timestamp;
-
+    
     // Guess the number of samples for each AAC frame.
     // If samples is 1024, the sample-rate is 8000HZ, the diff should be 1024/8000s=128ms.
     // If samples is 1024, the sample-rate is 44100HZ, the diff should be 1024/44100s=23ms.
@@ -1280,7 +2665,7 @@ srs_error_t SrsHls::on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* forma
     // Recalc the DTS by the samples of AAC.
     aac_samples += nb_samples_per_frame;
     int64_t dts = 90000 * aac_samples / srs_flv_srates[format->acodec->sound_rate];
-
+    
     // If directly turn FLV timestamp, overwrite the guessed DTS.
     // @doc https://github.com/ossrs/srs/issues/1506#issuecomment-562063095
     if (hls_dts_directly) {
@@ -1301,13 +2686,13 @@ srs_error_t SrsHls::on_video(SrsSharedPtrMessage* shared_video, SrsFormat* forma
     if (!enabled) {
         return err;
     }
-
+    
     // Ignore if no format->vcodec, it means the codec is not parsed, or unknown codec.
     // @issue https://github.com/ossrs/srs/issues/1506#issuecomment-562079474
     if (!format->vcodec) {
         return err;
     }
-
+    
     // update the hls time, for hls_dispose.
     last_update_time = srs_get_system_time();
     
@@ -1322,7 +2707,7 @@ srs_error_t SrsHls::on_video(SrsSharedPtrMessage* shared_video, SrsFormat* forma
     }
     
     srs_assert(format->vcodec);
-    if (format->vcodec->id != SrsVideoCodecIdAVC) {
+    if (format->vcodec->id != SrsVideoCodecIdAVC && format->vcodec->id != SrsVideoCodecIdHEVC) {
         return err;
     }
     
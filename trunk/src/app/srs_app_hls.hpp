@@ -28,11 +28,14 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <deque>
 
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
 #include <srs_app_async_call.hpp>
 #include <srs_app_fragment.hpp>
+#include <srs_service_st.hpp>
 
 class SrsFormat;
 class SrsSharedPtrMessage;
@@ -47,8 +50,184 @@ class SrsFileWriter;
 class SrsSimpleStream;
 class SrsTsAacJitter;
 class SrsTsMessageCache;
+class SrsMemoryStat;
 class SrsHlsSegment;
 class SrsTsContext;
+class SrsHlsVariantGroup;
+class SrsPathTemplate;
+
+// The m3u8 or ts file in memory, the bytes are shared by all copies,
+// so the http server is able to serve it to many players without copy.
+class SrsHlsMemoryFile
+{
+private:
+    class SrsHlsMemoryPayload
+    {
+    public:
+        char* data;
+        int size;
+        // The reference count of copies, 0 for the only one.
+        int shared_count;
+        // The ETag of file, empty to response without it.
+        std::string etag;
+        // The gzip variant of playlist, empty if not compressed.
+        std::string gzip;
+    public:
+        SrsHlsMemoryPayload();
+        virtual ~SrsHlsMemoryPayload();
+    };
+private:
+    SrsHlsMemoryPayload* ptr;
+private:
+    SrsHlsMemoryFile();
+public:
+    // Create file with the bytes, which is copied.
+    SrsHlsMemoryFile(const char* data, int size);
+    virtual ~SrsHlsMemoryFile();
+public:
+    virtual char* data();
+    virtual int size();
+    virtual std::string etag();
+    virtual void set_etag(std::string v);
+    // Compress the playlist to the gzip variant, ignore if it's too small to save anything.
+    // @remark Compress once when the playlist is updated, before it's shared by copies.
+    virtual void compress();
+    // The gzip variant, empty if not compressed.
+    virtual const std::string& gzip();
+    // Copy the file, share the bytes.
+    virtual SrsHlsMemoryFile* copy();
+};
+
+// The state of LL-HLS playlist, for blocking playlist reload.
+class SrsHlsPlaylistState
+{
+public:
+    // The msn of current segment and the index of its last part, -1 for no part.
+    int msn;
+    int part;
+    // The msn of the last complete segment, -1 for none.
+    int complete;
+    // The max time to block the playlist request, 3 target durations.
+    srs_utime_t timeout;
+    // The full path of the preload hint part.
+    std::string hint;
+public:
+    SrsHlsPlaylistState();
+    virtual ~SrsHlsPlaylistState();
+public:
+    // Whether the playlist contains the part of msn, or the whole segment if part is -1.
+    virtual bool ready(int msn, int part);
+};
+
+// The store of hls files in memory, keyed by the file path.
+// The muxer updates the m3u8 and ts, and the http server serves them.
+class SrsHlsMemoryStore
+{
+private:
+    std::map<std::string, SrsHlsMemoryFile*> files;
+    int64_t nn_bytes;
+    // The state of LL-HLS playlists, and the cond to notify the blocking requests.
+    std::map<std::string, SrsHlsPlaylistState> states;
+    srs_cond_t cond;
+public:
+    SrsHlsMemoryStore();
+    virtual ~SrsHlsMemoryStore();
+public:
+    // Update the file of path, which takes the ownership of file.
+    virtual void update(std::string path, SrsHlsMemoryFile* file);
+    // Remove the file of path.
+    virtual void remove(std::string path);
+    // Fetch a copy of file, NULL if not found.
+    // @remark User must free the copy.
+    virtual SrsHlsMemoryFile* fetch(std::string path);
+    // The number of files and total bytes in store.
+    virtual int size();
+    virtual int64_t bytes();
+public:
+    // Update the state of LL-HLS playlist, and notify the blocking requests.
+    virtual void update_state(std::string path, const SrsHlsPlaylistState& state);
+    // Remove the state of playlist, when stream disposed.
+    virtual void remove_state(std::string path);
+    // Get the state of playlist, false if not LL-HLS.
+    virtual bool fetch_state(std::string path, SrsHlsPlaylistState& state);
+    // Whether the path is the preload hint part of any playlist.
+    virtual bool is_hint(std::string path);
+    // Wait for any playlist or file update, or timeout.
+    virtual void wait(srs_utime_t timeout);
+public:
+    // Normalize the path, for the hls_path and http dir may differ in "/".
+    static std::string normalize(std::string path);
+};
+
+// The global hls memory store.
+extern SrsHlsMemoryStore* _srs_hls_memory;
+
+// The writer to cache the ts in memory, and write to file when archive.
+class SrsHlsMemoryWriter : public ISrsStreamWriter
+{
+private:
+    // The file writer to archive, NULL to disable.
+    SrsFileWriter* writer;
+    SrsSimpleStream* buffer;
+public:
+    SrsHlsMemoryWriter(SrsFileWriter* w);
+    virtual ~SrsHlsMemoryWriter();
+public:
+    // Whether write to file.
+    virtual bool archived();
+    virtual char* data();
+    virtual int size();
+// Interface ISrsStreamWriter
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+};
+
+// The writer to copy the ts packets to a buffer, before writing to the underlayer writer.
+// @remark The packets are copied before encrypted.
+class SrsHlsTapWriter : public ISrsStreamWriter
+{
+private:
+    ISrsStreamWriter* writer;
+    std::string* tap;
+public:
+    SrsHlsTapWriter(ISrsStreamWriter* w, std::string* t);
+    virtual ~SrsHlsTapWriter();
+// Interface ISrsStreamWriter
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+};
+
+// The handler for the ts packets muxed by HLS, to share them with other outputs, such as HTTP-TS.
+class ISrsHlsTsHandler
+{
+public:
+    ISrsHlsTsHandler();
+    virtual ~ISrsHlsTsHandler();
+public:
+    // When muxed a frame to ts packets, which start with PAT/PMT for a new segment.
+    // @param timestamp The dts of frame in ms.
+    // @param is_key Whether the packets are a video keyframe.
+    virtual srs_error_t on_hls_ts(const std::string& packets, int64_t timestamp, bool is_key) = 0;
+    // When HLS stops muxing, the handler should mux the ts by itself.
+    virtual void on_hls_unpublish() = 0;
+};
+
+// The partial segment of LL-HLS, which is a range of the ts in memory.
+class SrsHlsPart
+{
+public:
+    // The index of part in segment.
+    int index;
+    // The uri in m3u8 and the full path of part.
+    std::string uri;
+    std::string fullpath;
+    srs_utime_t duration;
+    // Whether the part starts with a keyframe.
+    bool independent;
+public:
+    SrsHlsPart();
+    virtual ~SrsHlsPart();
+};
 
 // The wrapper of m3u8 segment from specification:
 //
@@ -69,11 +248,52 @@ public:
     unsigned char iv[16];
     // The full key path.
     std::string keypath;
+    // Whether the crc32 sidecar is written, to remove it with the ts.
+    bool checksum;
+    // The writer to cache the ts in memory, NULL if hls not in memory.
+    SrsHlsMemoryWriter* memory;
+    // The writer to copy the ts packets, NULL if not shared.
+    SrsHlsTapWriter* tapw;
+    // Whether the ts is written to disk.
+    bool archive;
+    // The partial segments for LL-HLS, published to memory store.
+    std::vector<SrsHlsPart*> parts;
+private:
+    // Whether the ts is published to memory store.
+    bool in_memory;
+    // The offset of current part in memory, and whether it starts with keyframe.
+    int part_offset;
+    bool part_independent;
+    bool part_has_video;
 public:
-    SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w);
+    // @param m The memory writer, NULL to write to disk only.
+    // @param tap The buffer to copy the ts packets to, NULL to disable.
+    // @remark The segment takes the ownership of memory writer.
+    SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w, SrsHlsMemoryWriter* m = NULL, std::string* tap = NULL);
     virtual ~SrsHlsSegment();
 public:
     void config_cipher(unsigned char* key,unsigned char* iv);
+    // Calc the crc32 of the ts file, write to the sidecar file, which is the ts path with .crc32.
+    // @remark The ts file must be closed and renamed.
+    virtual srs_error_t write_checksum();
+    // The duration of current part, to the frame at dts in ms.
+    virtual srs_utime_t part_duration(int64_t dts);
+    // Mark the frame of current part, the part is independent if starts with keyframe.
+    virtual void on_part_frame(bool video, bool keyframe);
+    // Close the current part, publish it to memory store.
+    // @param dts The dts in ms of next frame, -1 for the end of segment.
+    virtual srs_error_t close_part(int64_t dts);
+    // Get the uri and path of part with index.
+    virtual std::string part_uri(int index);
+    virtual std::string part_path(int index);
+    // Remove the parts from memory store, when part is too old.
+    virtual void clear_parts();
+// Interface SrsFragment
+public:
+    virtual srs_error_t unlink_file();
+    virtual srs_error_t unlink_tmpfile();
+    // Rename the temp file to final file, and publish to memory store when hls in memory.
+    virtual srs_error_t rename();
 };
 
 // The hls async call: on_hls
@@ -95,6 +315,7 @@ public:
 public:
     virtual srs_error_t call();
     virtual std::string to_string();
+    virtual std::string key();
 };
 
 // The hls async call: on_hls_notify
@@ -110,6 +331,31 @@ public:
 public:
     virtual srs_error_t call();
     virtual std::string to_string();
+    virtual std::string key();
+};
+
+// The incremental media playlist, which keeps the serialized entries of segments, so the muxer only appends
+// the new segment and removes the expired ones, without rebuilding the whole playlist for each segment.
+class SrsHlsPlaylist
+{
+private:
+    // The serialized entries of segments, the removed entries before offset are compacted lazily.
+    std::string entries;
+    int offset;
+    // The size in bytes of each entry in entries.
+    std::deque<int> sizes;
+public:
+    SrsHlsPlaylist();
+    virtual ~SrsHlsPlaylist();
+public:
+    // Append the entry of a new segment, for example, #EXTINF and uri lines.
+    virtual void append(const std::string& entry);
+    // Remove the first n entries, for the expired segments.
+    virtual void shift(int n);
+    virtual void clear();
+    virtual int size();
+    // Serialize the playlist, the header then all entries.
+    virtual std::string dumps(int sequence_no, int target_duration);
 };
 
 // Mux the HLS stream(m3u8 and ts files).
@@ -126,13 +372,29 @@ private:
     std::string hls_entry_prefix;
     std::string hls_path;
     std::string hls_ts_file;
+    // The compiled hls_ts_file, to render the path of each segment.
+    SrsPathTemplate* ts_template;
     bool hls_cleanup;
     bool hls_wait_keyframe;
+    bool hls_checksum;
+    bool hls_memory;
+    bool hls_memory_archive;
+    // Whether upload the segments and m3u8 to object storage.
+    bool hls_upload;
+    // For LL-HLS, whether enabled and the part target duration.
+    bool hls_ll;
+    srs_utime_t hls_ll_part;
+    // The max duration of audio frames in a PES, 0 for the default.
+    srs_utime_t hls_audio_aggregate;
     std::string m3u8_dir;
     double hls_aof_ratio;
     // TODO: FIXME: Use TBN 1000.
     srs_utime_t hls_fragment;
     srs_utime_t hls_window;
+    // The duration of first segment for fast start, doubled for each segment until hls_fragment, 0 to disable.
+    srs_utime_t hls_fast_start;
+    // The number of segments reaped since publish, to grow the segment for fast start.
+    int nn_reaped;
     SrsAsyncCallWorker* async;
 private:
     // Whether use floor algorithm for timestamp.
@@ -167,11 +429,18 @@ private:
 private:
     // The available cached segments in m3u8.
     SrsFragmentWindow* segments;
+    // The entries of segments in m3u8, updated with segments.
+    SrsHlsPlaylist* playlist;
     // The current writing segment.
     SrsHlsSegment* current;
     // The ts context, to keep cc continous between ts.
     // @see https://github.com/ossrs/srs/issues/375
     SrsTsContext* context;
+    // The video codec of stream, to open the segment, unless the video is disabled.
+    SrsVideoCodecId latest_vcodec;
+    // The handler to share the ts packets, and the packets of current flushing frame.
+    ISrsHlsTsHandler* ts_handler;
+    std::string ts_packets;
 public:
     SrsHlsMuxer();
     virtual ~SrsHlsMuxer();
@@ -179,9 +448,13 @@ public:
     virtual void dispose();
 public:
     virtual int sequence_no();
+    // Set the sequence number of next segment, for the variant to share the sequence of group.
+    virtual void set_sequence_no(int v);
     virtual std::string ts_url();
     virtual srs_utime_t duration();
     virtual int deviation();
+    // Set the handler to share the ts packets, which starts from the next segment.
+    virtual void set_ts_handler(ISrsHlsTsHandler* h);
 public:
     // Initialize the hls muxer.
     virtual srs_error_t initialize();
@@ -197,9 +470,13 @@ public:
     // Open a new segment(a new ts file)
     virtual srs_error_t segment_open();
     virtual srs_error_t on_sequence_header();
+    // Update the video codec of stream, for example, the HEVC which is passthrough.
+    virtual void set_latest_vcodec(SrsVideoCodecId v);
     // Whether segment overflow,
     // that is whether the current segment duration>=(the segment in config)
     virtual bool is_segment_overflow();
+    // The duration to reap the current segment, which is shorter for the first segments of fast start.
+    virtual srs_utime_t fragment();
     // Whether wait keyframe to reap the ts.
     virtual bool wait_keyframe();
     // Whether segment absolutely overflow, for pure audio to reap segment,
@@ -207,19 +484,111 @@ public:
     // @see https://github.com/ossrs/srs/issues/151#issuecomment-71155184
     virtual bool is_segment_absolutely_overflow();
 public:
+    // Cut the partial segment for LL-HLS, before the frame at dts in ms.
+    // @param video Whether the frame is video, the pure audio is always independent.
+    virtual srs_error_t segment_part(int64_t dts, bool video, bool keyframe);
     // Whether current hls muxer is pure audio mode.
     virtual bool pure_audio();
+    // The max duration in ts tbn of audio frames to aggregate in a PES, 0 to write frame by frame.
+    virtual int64_t audio_aggregate();
     virtual srs_error_t flush_audio(SrsTsMessageCache* cache);
     virtual srs_error_t flush_video(SrsTsMessageCache* cache);
     // Close segment(ts).
     virtual srs_error_t segment_close();
 private:
     virtual srs_error_t do_segment_close();
+    // Upload the closed segment, from memory if possible.
+    virtual srs_error_t upload_segment(SrsHlsSegment* segment);
     virtual srs_error_t write_hls_key();
     virtual srs_error_t refresh_m3u8();
     virtual srs_error_t _refresh_m3u8(std::string m3u8_file);
+    // Serialize the entry of segment in m3u8.
+    virtual std::string segment_entry(SrsHlsSegment* segment);
+    // Refresh the LL-HLS m3u8 in memory, with the parts.
+    virtual srs_error_t refresh_ll_m3u8();
+    // Deliver the ts packets of flushed frame to handler.
+    virtual srs_error_t on_ts_packets(int64_t timestamp, bool is_key);
 };
 
+// The rendition of a variant group, for example, the livestream_hd of group livestream,
+// which is generally transcoded from the same stream, by SrsEncoder or an external ffmpeg.
+class SrsHlsVariant
+{
+public:
+    SrsHlsVariantGroup* group;
+    // The suffix of stream, the stream name is the group name plus suffix.
+    std::string suffix;
+    // The BANDWIDTH and RESOLUTION, in the EXT-X-STREAM-INF of master playlist.
+    int bandwidth;
+    std::string resolution;
+    // The url of media playlist, relative to the hls path.
+    std::string m3u8_url;
+    // Whether the rendition is publishing.
+    bool active;
+    // The index of current segment in group, which is also the sequence number of segment.
+    int cursor;
+public:
+    SrsHlsVariant(SrsHlsVariantGroup* g, std::string s);
+    virtual ~SrsHlsVariant();
+};
+
+// The variant group of renditions, which aligns the segments of renditions and writes the master playlist.
+// The first rendition whose segment overflow cuts the segment at a keyframe, then the others cut their segments
+// at the keyframe of the same timestamp, and all segments of a cut share the same sequence number, so the
+// player is able to switch the renditions at segment boundary.
+// @remark The renditions must keep the timestamp of stream and the keyframe at the same time, for example, the
+//      ffmpeg transcodes the stream to all renditions by one process with -force_key_frames.
+class SrsHlsVariantGroup
+{
+private:
+    std::string vhost;
+    // The path and url of master playlist.
+    std::string master;
+    std::string master_url;
+    std::vector<SrsHlsVariant*> variants;
+    // The timestamp in ms of last cuts, the cut at index is where the segment index+1 starts.
+    std::deque<int64_t> cuts;
+    // The index of the first cut in cuts.
+    int cuts_base;
+public:
+    SrsHlsVariantGroup(std::string v, std::string m, std::string mu);
+    virtual ~SrsHlsVariantGroup();
+public:
+    // Get the variant of suffix, create it if not exists.
+    virtual SrsHlsVariant* fetch_or_create(std::string suffix);
+    // When the rendition publish or unpublish, update the master playlist.
+    virtual srs_error_t join(SrsHlsVariant* variant, std::string m3u8_url);
+    virtual srs_error_t leave(SrsHlsVariant* variant);
+public:
+    // Whether the variant should cut the segment at the keyframe of dts in ms.
+    // @param duration The duration of current segment of variant.
+    // @param overflow Whether the segment of variant is overflow, to lead a new cut.
+    // @param absolutely Whether the segment is absolutely overflow, to cut even it's not aligned.
+    virtual bool should_cut(SrsHlsVariant* variant, int64_t dts, srs_utime_t duration, bool overflow, bool absolutely);
+    // The variant cuts the segment at dts in ms, follow the cut of others or lead a new cut.
+    virtual void cut(SrsHlsVariant* variant, int64_t dts);
+private:
+    virtual srs_error_t refresh_master();
+};
+
+// The manager of hls variant groups, which is shared by all hls of vhosts.
+class SrsHlsVariantManager
+{
+private:
+    // The group of key vhost/app/stream.
+    std::map<std::string, SrsHlsVariantGroup*> groups;
+public:
+    SrsHlsVariantManager();
+    virtual ~SrsHlsVariantManager();
+public:
+    // Join the variant group, when the stream of request is a rendition in config hls_variants.
+    // @param m3u8_url The url of media playlist of rendition, relative to hls path.
+    // @param pvariant Output the variant of stream, NULL if not a rendition.
+    virtual srs_error_t join(SrsRequest* req, std::string m3u8_url, SrsHlsVariant** pvariant);
+};
+
+extern SrsHlsVariantManager* _srs_hls_variants;
+
 // The hls stream cache,
 // use to cache hls stream and flush to hls muxer.
 //
@@ -243,6 +612,8 @@ private:
     SrsHlsMuxer* muxer;
     // The TS cache
     SrsTsMessageCache* tsmc;
+    // The rendition of variant group, NULL if not a rendition.
+    SrsHlsVariant* variant;
 public:
     SrsHlsController();
     virtual ~SrsHlsController();
@@ -253,10 +624,15 @@ public:
     virtual std::string ts_url();
     virtual srs_utime_t duration();
     virtual int deviation();
+    virtual void set_ts_handler(ISrsHlsTsHandler* h);
+    // Report the bytes of ts cache to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
 public:
     // When publish or unpublish stream.
     virtual srs_error_t on_publish(SrsRequest* req);
     virtual srs_error_t on_unpublish();
+    // When the publisher reconnects in grace, reap the segment and start a new one with discontinuity.
+    virtual srs_error_t on_republish();
     // When get sequence header,
     // must write a #EXT-X-DISCONTINUITY to m3u8.
     // @see: hls-m3u8-draft-pantos-http-live-streaming-12.txt
@@ -297,15 +673,23 @@ private:
     SrsOriginHub* hub;
     SrsRtmpJitter* jitter;
     SrsPithyPrint* pprint;
+    // The handler to share the ts packets, NULL if not shared.
+    ISrsHlsTsHandler* ts_handler;
 public:
     SrsHls();
     virtual ~SrsHls();
 public:
     virtual void dispose();
     virtual srs_error_t cycle();
+    // Whether wait to dispose the hls in cycle.
+    virtual bool pending();
 public:
     // Initialize the hls by handler and source.
     virtual srs_error_t initialize(SrsOriginHub* h, SrsRequest* r);
+    // Set the handler to share the ts packets, NULL to disable.
+    virtual void set_ts_handler(ISrsHlsTsHandler* h);
+    // Report the bytes of ts cache to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
     // Publish stream event, continue to write the m3u8,
     // for the muxer object not destroyed.
     // @param fetch_sequence_header whether fetch sequence from source.
@@ -313,6 +697,8 @@ public:
     // The unpublish event, only close the muxer, donot destroy the
     // muxer, for when we continue to publish, the m3u8 will continue.
     virtual void on_unpublish();
+    // The publisher reconnects in grace, continue the m3u8 by a new segment with discontinuity.
+    virtual srs_error_t on_republish();
     // Mux the audio packets to ts.
     // @param shared_audio, directly ptr, copy it if need to save it.
     virtual srs_error_t on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* format);
@@ -28,6 +28,7 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_app_st.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 
 ISrsHourGlass::ISrsHourGlass()
 {
@@ -84,3 +85,281 @@ srs_error_t SrsHourGlass::cycle()
     
     return err;
 }
+
+ISrsTimerHandler::ISrsTimerHandler()
+{
+}
+
+ISrsTimerHandler::~ISrsTimerHandler()
+{
+}
+
+// The number of slots and shift bits for each level.
+#define SRS_TIMER_WHEEL_SLOTS(level) (1 << ((level)? SRS_TIMER_WHEEL_LN_BITS : SRS_TIMER_WHEEL_L0_BITS))
+#define SRS_TIMER_WHEEL_SHIFT(level) ((level)? SRS_TIMER_WHEEL_L0_BITS + ((level) - 1) * SRS_TIMER_WHEEL_LN_BITS : 0)
+
+SrsTimerWheel* _srs_timer = new SrsTimerWheel();
+
+SrsTimerWheel::SrsTimerWheel(srs_utime_t r)
+{
+    trd = NULL;
+    resolution = r;
+    tick = 0;
+    epoch = 0;
+    firing = NULL;
+    firing_removed = false;
+    
+    for (int i = 0; i < SRS_TIMER_WHEEL_LEVELS; i++) {
+        levels[i].resize(SRS_TIMER_WHEEL_SLOTS(i));
+    }
+}
+
+SrsTimerWheel::~SrsTimerWheel()
+{
+    srs_freep(trd);
+    
+    std::map<ISrsTimerHandler*, SrsTimerEntry*>::iterator it;
+    for (it = handlers.begin(); it != handlers.end(); ++it) {
+        SrsTimerEntry* entry = it->second;
+        remove(entry);
+        srs_freep(entry);
+    }
+    handlers.clear();
+}
+
+srs_error_t SrsTimerWheel::start()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("timer", this);
+    
+    tick = 0;
+    epoch = srs_update_monotonic_time();
+    
+    if ((err = trd->start()) != srs_success) {
+        srs_freep(trd);
+        return srs_error_wrap(err, "start timer");
+    }
+    
+    return err;
+}
+
+void SrsTimerWheel::subscribe(srs_utime_t interval, ISrsTimerHandler* handler)
+{
+    unsubscribe(handler);
+    
+    SrsTimerEntry* entry = new SrsTimerEntry();
+    entry->handler = handler;
+    entry->cond = NULL;
+    entry->slot = NULL;
+    entry->interval = srs_max(1, to_ticks(interval));
+    entry->expire = tick + entry->interval;
+    
+    add(entry);
+    handlers[handler] = entry;
+}
+
+void SrsTimerWheel::unsubscribe(ISrsTimerHandler* handler)
+{
+    std::map<ISrsTimerHandler*, SrsTimerEntry*>::iterator it = handlers.find(handler);
+    if (it == handlers.end()) {
+        return;
+    }
+    
+    SrsTimerEntry* entry = it->second;
+    handlers.erase(it);
+    
+    // Free it after the handler returned.
+    if (entry == firing) {
+        firing_removed = true;
+        return;
+    }
+    
+    remove(entry);
+    srs_freep(entry);
+}
+
+void SrsTimerWheel::usleep(srs_utime_t duration)
+{
+    if (!trd) {
+        srs_usleep(duration);
+        return;
+    }
+    
+    SrsTimerEntry entry;
+    entry.handler = NULL;
+    entry.slot = NULL;
+    entry.interval = 0;
+    entry.expire = tick + srs_max(1, to_ticks(duration));
+    entry.cond = srs_cond_new();
+    
+    add(&entry);
+    
+    // The cond is signaled when fired, or return when interrupted.
+    srs_cond_wait(entry.cond);
+    
+    remove(&entry);
+    srs_cond_destroy(entry.cond);
+}
+
+void SrsTimerWheel::advance(srs_utime_t now)
+{
+    // The clock goes back, continue from the current tick.
+    if (now < epoch + tick * resolution) {
+        epoch = now - tick * resolution;
+    }
+    
+    int64_t target = (now - epoch) / resolution;
+    
+    // The clock jumps too far, only tick for the max timer.
+    int64_t max = (int64_t)1 << SRS_TIMER_WHEEL_SHIFT(SRS_TIMER_WHEEL_LEVELS);
+    if (target - tick > max) {
+        epoch += (target - tick - max) * resolution;
+        target = tick + max;
+    }
+    
+    while (tick < target) {
+        tick++;
+        
+        // Move the timers to lower level when the lower level wraps.
+        for (int i = 1; i < SRS_TIMER_WHEEL_LEVELS; i++) {
+            if ((tick & ((1 << SRS_TIMER_WHEEL_SHIFT(i)) - 1)) != 0) {
+                break;
+            }
+            cascade(i);
+        }
+        
+        fire(levels[0][tick & (SRS_TIMER_WHEEL_SLOTS(0) - 1)]);
+    }
+}
+
+int SrsTimerWheel::size()
+{
+    int nn = 0;
+    for (int i = 0; i < SRS_TIMER_WHEEL_LEVELS; i++) {
+        for (int j = 0; j < (int)levels[i].size(); j++) {
+            nn += (int)levels[i][j].size();
+        }
+    }
+    return nn;
+}
+
+srs_error_t SrsTimerWheel::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "timer");
+        }
+        
+        advance(srs_update_monotonic_time());
+        
+        srs_usleep(resolution);
+    }
+    
+    return err;
+}
+
+void SrsTimerWheel::add(SrsTimerEntry* entry)
+{
+    // Never fire in current tick, which is already fired.
+    entry->expire = srs_max(entry->expire, tick + 1);
+    
+    int64_t delta = entry->expire - tick;
+    
+    int level = 0;
+    for (; level < SRS_TIMER_WHEEL_LEVELS - 1; level++) {
+        if (delta < ((int64_t)1 << SRS_TIMER_WHEEL_SHIFT(level + 1))) {
+            break;
+        }
+    }
+    
+    // Put the timer too far to the last slot of top level, which will be added again when cascade.
+    int64_t expire = entry->expire;
+    int64_t max = (int64_t)1 << SRS_TIMER_WHEEL_SHIFT(SRS_TIMER_WHEEL_LEVELS);
+    if (delta >= max) {
+        expire = tick + max - 1;
+    }
+    
+    int index = (int)((expire >> SRS_TIMER_WHEEL_SHIFT(level)) & (SRS_TIMER_WHEEL_SLOTS(level) - 1));
+    std::list<SrsTimerEntry*>* slot = &levels[level][index];
+    
+    entry->slot = slot;
+    entry->it = slot->insert(slot->end(), entry);
+}
+
+void SrsTimerWheel::remove(SrsTimerEntry* entry)
+{
+    if (entry->slot) {
+        entry->slot->erase(entry->it);
+        entry->slot = NULL;
+    }
+}
+
+void SrsTimerWheel::cascade(int level)
+{
+    int index = (int)((tick >> SRS_TIMER_WHEEL_SHIFT(level)) & (SRS_TIMER_WHEEL_SLOTS(level) - 1));
+    
+    std::list<SrsTimerEntry*> timers;
+    timers.splice(timers.end(), levels[level][index]);
+    
+    while (!timers.empty()) {
+        SrsTimerEntry* entry = timers.front();
+        timers.pop_front();
+        add(entry);
+    }
+}
+
+void SrsTimerWheel::fire(std::list<SrsTimerEntry*>& slot)
+{
+    if (slot.empty()) {
+        return;
+    }
+    
+    // Move out the expired timers, which may be removed by handler.
+    std::list<SrsTimerEntry*> timers;
+    timers.splice(timers.end(), slot);
+    
+    std::list<SrsTimerEntry*>::iterator it;
+    for (it = timers.begin(); it != timers.end(); ++it) {
+        (*it)->slot = &timers;
+    }
+    
+    while (!timers.empty()) {
+        SrsTimerEntry* entry = timers.front();
+        timers.pop_front();
+        entry->slot = NULL;
+        
+        // Wakeup the sleeper.
+        if (!entry->handler) {
+            srs_cond_signal(entry->cond);
+            continue;
+        }
+        
+        firing = entry;
+        firing_removed = false;
+        
+        srs_error_t err = entry->handler->on_timer(entry->interval * resolution);
+        if (err != srs_success) {
+            srs_warn("timer: ignore err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        firing = NULL;
+        
+        if (firing_removed) {
+            srs_freep(entry);
+            continue;
+        }
+        
+        entry->expire = tick + entry->interval;
+        add(entry);
+    }
+}
+
+int64_t SrsTimerWheel::to_ticks(srs_utime_t duration)
+{
+    return (duration + resolution - 1) / resolution;
+}
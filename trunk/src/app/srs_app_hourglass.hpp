@@ -27,6 +27,10 @@
 #include <srs_core.hpp>
 
 #include <map>
+#include <list>
+#include <vector>
+
+#include <srs_app_st.hpp>
 
 // The handler for the tick.
 class ISrsHourGlass
@@ -89,4 +93,94 @@ public:
     virtual srs_error_t cycle();
 };
 
+// The resolution of timer wheel, the timers are fired in ticks.
+#define SRS_TIMER_WHEEL_RESOLUTION (10 * SRS_UTIME_MILLISECONDS)
+// The bits of slots for each level of timer wheel, the level 0 is 256 ticks about 2.56s,
+// the level 1 is 64*256 ticks about 163s, the level 2 is 64*64*256 ticks about 2.9h.
+#define SRS_TIMER_WHEEL_L0_BITS 8
+#define SRS_TIMER_WHEEL_LN_BITS 6
+#define SRS_TIMER_WHEEL_LEVELS 3
+
+// The handler for the periodic timer of wheel.
+class ISrsTimerHandler
+{
+public:
+    ISrsTimerHandler();
+    virtual ~ISrsTimerHandler();
+public:
+    // When the timer is fired, in the coroutine of timer wheel.
+    // @remark The error is logged and ignored, the timer keeps ticking.
+    // @remark The handler should never block, because all timers are fired in one coroutine.
+    virtual srs_error_t on_timer(srs_utime_t interval) = 0;
+};
+
+// The timer in wheel, periodic for handler, or one-shot for sleeper.
+struct SrsTimerEntry
+{
+    // The tick to fire the timer.
+    int64_t expire;
+    // The interval in ticks, for periodic timer.
+    int64_t interval;
+    // The handler of periodic timer, NULL for sleeper.
+    ISrsTimerHandler* handler;
+    // The sleeper waits on this cond, NULL for periodic timer.
+    srs_cond_t cond;
+    // The slot which holds the timer, for removing in O(1).
+    std::list<SrsTimerEntry*>* slot;
+    std::list<SrsTimerEntry*>::iterator it;
+};
+
+// The hierarchical timer wheel, which use one coroutine to fire all timers, to
+// avoid each coroutine uses st_usleep(which is a sorted heap in ST) for periodic jobs.
+// The timer is added and removed in O(1), and fired in ticks of resolution.
+// Usage:
+//      _srs_timer->subscribe(3 * SRS_UTIME_SECONDS, handler); // called every 3s.
+//      _srs_timer->usleep(350 * SRS_UTIME_MILLISECONDS); // wait in cond.
+class SrsTimerWheel : public ISrsCoroutineHandler
+{
+private:
+    SrsCoroutine* trd;
+    srs_utime_t resolution;
+    // The current tick, and the time of tick 0.
+    int64_t tick;
+    srs_utime_t epoch;
+    // The slots for each level.
+    std::vector< std::list<SrsTimerEntry*> > levels[SRS_TIMER_WHEEL_LEVELS];
+    // The periodic timers, key is the handler.
+    std::map<ISrsTimerHandler*, SrsTimerEntry*> handlers;
+    // The timer is firing, and whether it's removed by its handler.
+    SrsTimerEntry* firing;
+    bool firing_removed;
+public:
+    SrsTimerWheel(srs_utime_t r = SRS_TIMER_WHEEL_RESOLUTION);
+    virtual ~SrsTimerWheel();
+public:
+    // Start the coroutine to fire timers.
+    virtual srs_error_t start();
+    // Subscribe the periodic timer in interval, each handler only has one timer.
+    virtual void subscribe(srs_utime_t interval, ISrsTimerHandler* handler);
+    virtual void unsubscribe(ISrsTimerHandler* handler);
+    // Sleep the current coroutine for duration, in the timer wheel.
+    // @remark Fallback to st_usleep if wheel not started. Return when interrupted.
+    virtual void usleep(srs_utime_t duration);
+public:
+    // Advance the wheel to the time, and fire the expired timers.
+    virtual void advance(srs_utime_t now);
+    // Get the number of timers in wheel.
+    virtual int size();
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual void add(SrsTimerEntry* entry);
+    virtual void remove(SrsTimerEntry* entry);
+    // Move the timers in slot of higher level to lower level.
+    virtual void cascade(int level);
+    virtual void fire(std::list<SrsTimerEntry*>& slot);
+    virtual int64_t to_ticks(srs_utime_t duration);
+};
+
+// The global timer wheel.
+extern SrsTimerWheel* _srs_timer;
+
 #endif
@@ -0,0 +1,1147 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_http2.hpp>
+
+#include <ctype.h>
+#include <string.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_protocol_io.hpp>
+#include <srs_protocol_stream.hpp>
+#include <srs_service_http_conn.hpp>
+#include <srs_app_utility.hpp>
+
+// Convert the name of field to canonical form, for example, user-agent to User-Agent,
+// because the names of HTTP/2 are in lower case, while our handlers get the canonical ones.
+static string srs_http2_canonical_key(const string& name)
+{
+    string key = name;
+    bool upper = true;
+    for (size_t i = 0; i < key.length(); i++) {
+        char c = key.at(i);
+        key[i] = upper? (char)toupper(c) : (char)tolower(c);
+        upper = (c == '-');
+    }
+    return key;
+}
+
+// Whether the field is connection-specific, which is not allowed by HTTP/2, see RFC7540 section 8.1.2.2.
+static bool srs_http2_is_connection_field(const string& name)
+{
+    return name == "connection" || name == "keep-alive" || name == "transfer-encoding"
+        || name == "upgrade" || name == "proxy-connection";
+}
+
+SrsHttp2PrefaceReader::SrsHttp2PrefaceReader(ISrsReader* r)
+{
+    reader = r;
+    pos = 0;
+}
+
+SrsHttp2PrefaceReader::~SrsHttp2PrefaceReader()
+{
+}
+
+srs_error_t SrsHttp2PrefaceReader::detect(bool& h2)
+{
+    srs_error_t err = srs_success;
+    
+    char buf[SRS_HTTP2_PREFACE_SIZE];
+    while (preface.length() < SRS_HTTP2_PREFACE_SIZE) {
+        ssize_t nread = 0;
+        if ((err = reader->read(buf, SRS_HTTP2_PREFACE_SIZE - preface.length(), &nread)) != srs_success) {
+            return srs_error_wrap(err, "read preface");
+        }
+        preface.append(buf, nread);
+        
+        if (memcmp(preface.data(), SRS_HTTP2_PREFACE, preface.length()) != 0) {
+            h2 = false;
+            return err;
+        }
+    }
+    
+    // The preface of HTTP/2 is consumed, never replay it.
+    preface.clear();
+    h2 = true;
+    
+    return err;
+}
+
+srs_error_t SrsHttp2PrefaceReader::read(void* buf, size_t size, ssize_t* nread)
+{
+    if (pos >= preface.length()) {
+        return reader->read(buf, size, nread);
+    }
+    
+    size_t nn = srs_min(size, preface.length() - pos);
+    memcpy(buf, preface.data() + pos, nn);
+    pos += nn;
+    
+    if (nread) {
+        *nread = nn;
+    }
+    
+    return srs_success;
+}
+
+SrsHttp2ResponseWriter::SrsHttp2ResponseWriter(SrsHttp2Stream* s)
+{
+    stream = s;
+    hdr = new SrsHttpHeader();
+    header_wrote = false;
+    status = SRS_CONSTS_HTTP_OK;
+    content_length = -1;
+    written = 0;
+    header_sent = false;
+    ended = false;
+}
+
+SrsHttp2ResponseWriter::~SrsHttp2ResponseWriter()
+{
+    srs_freep(hdr);
+}
+
+bool SrsHttp2ResponseWriter::is_ended()
+{
+    return ended;
+}
+
+srs_error_t SrsHttp2ResponseWriter::final_request()
+{
+    srs_error_t err = srs_success;
+    
+    if (!header_wrote) {
+        write_header(SRS_CONSTS_HTTP_OK);
+    }
+    
+    if (ended) {
+        return err;
+    }
+    
+    // The response without body, end the stream by HEADERS.
+    if (!header_sent) {
+        return send_header(NULL, 0, true);
+    }
+    
+    // End the stream by an empty DATA, for the response in chunked, which has no content length.
+    if ((err = stream->conn->send_data(stream, NULL, 0, true)) != srs_success) {
+        return srs_error_wrap(err, "final data");
+    }
+    ended = true;
+    
+    return err;
+}
+
+SrsHttpHeader* SrsHttp2ResponseWriter::header()
+{
+    return hdr;
+}
+
+srs_error_t SrsHttp2ResponseWriter::write(char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // write the header data in memory.
+    if (!header_wrote) {
+        if (hdr->content_type().empty()) {
+            hdr->set_content_type("text/plain; charset=utf-8");
+        }
+        if (hdr->content_length() == -1) {
+            hdr->set_content_length(size);
+        }
+        write_header(SRS_CONSTS_HTTP_OK);
+    }
+    
+    // check the bytes send and content length.
+    written += size;
+    if (content_length != -1 && written > content_length) {
+        return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%d, max=%d", (int)written, (int)content_length);
+    }
+    
+    // The response of HEAD has no body, but we keep the content length.
+    bool end = (content_length != -1 && written == content_length);
+    if (!data || size <= 0 || stream->method == "HEAD") {
+        return send_header(data, size, false);
+    }
+    
+    if ((err = send_header(data, size, false)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+    
+    // The bytes are sent as DATA frames without copy.
+    if ((err = stream->conn->send_data(stream, data, size, end)) != srs_success) {
+        return srs_error_wrap(err, "send data");
+    }
+    ended = end;
+    
+    return err;
+}
+
+srs_error_t SrsHttp2ResponseWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    // The HTTP/2 has no chunked encoding, each iov is sent as DATA frames.
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        nwrite += iov[i].iov_len;
+        if ((err = write((char*)iov[i].iov_base, (int)iov[i].iov_len)) != srs_success) {
+            return srs_error_wrap(err, "writev");
+        }
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
+    }
+    
+    return err;
+}
+
+void SrsHttp2ResponseWriter::write_header(int code)
+{
+    if (header_wrote) {
+        srs_warn("http2: multiple write_header calls, code=%d", code);
+        return;
+    }
+    
+    header_wrote = true;
+    status = code;
+    
+    // parse the content length from header.
+    content_length = hdr->content_length();
+    
+    // The 1xx, 204 and 304 response has no body.
+    if (content_length == -1 && !srs_go_http_body_allowd(code)) {
+        content_length = 0;
+    }
+}
+
+bool SrsHttp2ResponseWriter::sendfile_enabled()
+{
+    // Only for response with content length, then the stream is ended by the last DATA.
+    return stream->conn->sf && header_wrote && content_length != -1 && stream->method != "HEAD";
+}
+
+srs_error_t SrsHttp2ResponseWriter::sendfile(int fd, int64_t offset, int size)
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(sendfile_enabled());
+    
+    if ((err = send_header(NULL, 0, false)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+    
+    // check the bytes send and content length.
+    written += size;
+    if (written > content_length) {
+        return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%d, max=%d", (int)written, (int)content_length);
+    }
+    
+    if (size <= 0) {
+        return err;
+    }
+    
+    bool end = (written == content_length);
+    if ((err = stream->conn->send_file(stream, fd, offset, size, end)) != srs_success) {
+        return srs_error_wrap(err, "sendfile");
+    }
+    ended = end;
+    
+    return err;
+}
+
+srs_error_t SrsHttp2ResponseWriter::send_header(char* data, int size, bool end_stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (header_sent) {
+        return err;
+    }
+    header_sent = true;
+    
+    // detect content type
+    if (srs_go_http_body_allowd(status)) {
+        if (data && hdr->content_type().empty()) {
+            hdr->set_content_type(srs_go_http_detect(data, size));
+        }
+    }
+    
+    // set server if not set.
+    if (hdr->get("Server").empty()) {
+        hdr->set("Server", RTMP_SIG_SRS_SERVER);
+    }
+    
+    // The names are in lower case, and never the connection-specific fields.
+    vector<pair<string, string> > fields;
+    fields.push_back(make_pair(":status", srs_int2str(status)));
+    
+    const vector<pair<string, string> >& hfs = hdr->fields();
+    for (vector<pair<string, string> >::const_iterator it = hfs.begin(); it != hfs.end(); ++it) {
+        string name = it->first;
+        for (size_t i = 0; i < name.length(); i++) {
+            name[i] = (char)tolower(name.at(i));
+        }
+        
+        if (!srs_http2_is_connection_field(name)) {
+            fields.push_back(make_pair(name, it->second));
+        }
+    }
+    
+    if ((err = stream->conn->send_headers(stream, fields, end_stream)) != srs_success) {
+        return srs_error_wrap(err, "send headers");
+    }
+    ended = end_stream;
+    
+    return err;
+}
+
+SrsHttp2Stream::SrsHttp2Stream(SrsHttp2Conn* c, uint32_t sid, int64_t window)
+{
+    conn = c;
+    id = sid;
+    trd = NULL;
+    body_pos = 0;
+    send_window = window;
+    request_done = false;
+    response_done = false;
+    cycle_done = false;
+    reset = false;
+}
+
+SrsHttp2Stream::~SrsHttp2Stream()
+{
+    if (trd) {
+        trd->stop();
+    }
+    srs_freep(trd);
+}
+
+srs_error_t SrsHttp2Stream::on_headers(vector<pair<string, string> >& fields)
+{
+    string authority;
+    
+    for (vector<pair<string, string> >::iterator it = fields.begin(); it != fields.end(); ++it) {
+        const string& name = it->first;
+        const string& value = it->second;
+        
+        // The pseudo-header fields, see RFC7540 section 8.1.2.3.
+        if (!name.empty() && name.at(0) == ':') {
+            if (name == ":method") {
+                method = value;
+            } else if (name == ":path") {
+                path = value;
+            } else if (name == ":authority") {
+                authority = value;
+            } else if (name != ":scheme") {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "invalid pseudo header %s", name.c_str());
+            }
+            continue;
+        }
+        
+        // The cookie may be split to fields, see RFC7540 section 8.1.2.5.
+        string key = srs_http2_canonical_key(name);
+        string v = header.get(key);
+        if (!v.empty()) {
+            v += (key == "Cookie")? "; " : ", ";
+        }
+        header.set(key, v + value);
+    }
+    
+    if (method.empty() || path.empty()) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "no method or path");
+    }
+    
+    // The authority is the Host of HTTP/1.1, see RFC7540 section 8.1.2.3.
+    if (header.get("Host").empty() && !authority.empty()) {
+        header.set("Host", authority);
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsHttp2Stream::start()
+{
+    srs_error_t err = srs_success;
+    
+    // Use the context id of connection, to identify the requests by the logs of connection.
+    SrsSTCoroutine* st = new SrsSTCoroutine("http2", this, conn->trd->cid());
+    st->set_stack_size(SRS_PERF_STACK_CONN);
+    trd = st;
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start stream=%u", id);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Stream::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Reset the stream which is not completed, when error.
+    if (err != srs_success && !reset && !response_done) {
+        SrsHttp2ErrorCode code = SrsHttp2ErrorInternal;
+        if (srs_error_code(err) == ERROR_HTTP2_HTTP11_REQUIRED) {
+            code = SrsHttp2ErrorHttp11Required;
+        }
+        
+        srs_error_t r0 = conn->send_rst_stream(id, code);
+        srs_freep(r0);
+    }
+    
+    if (err != srs_success) {
+        srs_warn("HTTP2 stream=%u, %s", id, srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    // Free by connection, when got next frame.
+    cycle_done = true;
+    
+    return srs_success;
+}
+
+srs_error_t SrsHttp2Stream::read(void* buf, size_t size, ssize_t* nread)
+{
+    if (body_pos >= body.length()) {
+        return srs_error_new(ERROR_HTTP_REQUEST_EOF, "body EOF");
+    }
+    
+    size_t nn = srs_min(size, body.length() - body_pos);
+    memcpy(buf, body.data() + body_pos, nn);
+    body_pos += nn;
+    
+    if (nread) {
+        *nread = nn;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsHttp2Stream::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    // The body is in memory, read by the message from this stream.
+    SrsFastStream* fs = body.empty()? NULL : new SrsFastStream(SRS_HTTP_READ_CACHE_BYTES);
+    SrsAutoFree(SrsFastStream, fs);
+    
+    SrsHttpMessage msg(this, fs);
+    
+    // The HEAD is served as GET, but the body is dropped by writer.
+    uint8_t m = SRS_CONSTS_HTTP_GET;
+    bool allowed = true;
+    if (method == "POST") {
+        m = SRS_CONSTS_HTTP_POST;
+    } else if (method == "PUT") {
+        m = SRS_CONSTS_HTTP_PUT;
+    } else if (method == "DELETE") {
+        m = SRS_CONSTS_HTTP_DELETE;
+    } else if (method == "OPTIONS") {
+        m = SRS_CONSTS_HTTP_OPTIONS;
+    } else if (method != "GET" && method != "HEAD") {
+        allowed = false;
+    }
+    
+    msg.set_basic(m, 0, (int64_t)body.length());
+    msg.set_header(&header, true);
+    if ((err = msg.set_url(path, false)) != srs_success) {
+        return srs_error_wrap(err, "url %s", path.c_str());
+    }
+    msg.set_connection(conn);
+    
+    srs_trace("HTTP2 stream=%u %s %s, content-length=%d", id, method.c_str(), path.c_str(), (int)body.length());
+    
+    SrsHttp2ResponseWriter writer(this);
+    if (!allowed) {
+        err = srs_go_http_error(&writer, SRS_CONSTS_HTTP_MethodNotAllowed);
+    } else {
+        err = conn->handler->serve_http(&writer, &msg);
+    }
+    
+    if (err == srs_success && !writer.is_ended()) {
+        err = writer.final_request();
+    }
+    response_done = writer.is_ended();
+    
+    return err;
+}
+
+SrsHttp2Conn::SrsHttp2Conn(ISrsConnection* c, ISrsProtocolReadWriter* io, ISrsHttpServeMux* h, SrsCoroutine* t, int streams)
+{
+    owner = c;
+    skt = io;
+    sf = dynamic_cast<ISrsSendfileWriter*>(io);
+    handler = h;
+    trd = t;
+    buffer = new SrsFastStream(2 * (SRS_HTTP2_FRAME_HEADER_SIZE + SRS_HTTP2_DEFAULT_FRAME_SIZE));
+    hpack = new SrsHpackDecoder();
+    
+    lock = srs_mutex_new();
+    window_cond = srs_cond_new();
+    
+    max_streams = streams;
+    last_stream_id = 0;
+    send_window = SRS_HTTP2_DEFAULT_WINDOW;
+    peer_initial_window = SRS_HTTP2_DEFAULT_WINDOW;
+    peer_max_frame = SRS_HTTP2_DEFAULT_FRAME_SIZE;
+    goaway = false;
+    
+    continuation_id = 0;
+    continuation_flags = 0;
+}
+
+SrsHttp2Conn::~SrsHttp2Conn()
+{
+    // Interrupt all streams, then wait for them to quit, because they send frames by this connection.
+    std::map<uint32_t, SrsHttp2Stream*>::iterator it;
+    for (it = streams.begin(); it != streams.end(); ++it) {
+        SrsHttp2Stream* s = it->second;
+        if (s->trd) {
+            s->trd->interrupt();
+        }
+    }
+    for (it = streams.begin(); it != streams.end(); ++it) {
+        SrsHttp2Stream* s = it->second;
+        srs_freep(s);
+    }
+    streams.clear();
+    
+    srs_cond_destroy(window_cond);
+    srs_mutex_destroy(lock);
+    
+    srs_freep(buffer);
+    srs_freep(hpack);
+}
+
+string SrsHttp2Conn::remote_ip()
+{
+    return owner->remote_ip();
+}
+
+srs_error_t SrsHttp2Conn::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Notify client the last stream we processed, ignore any error.
+    if (err != srs_success) {
+        SrsHttp2ErrorCode code = SrsHttp2ErrorProtocol;
+        if (srs_error_code(err) == ERROR_HTTP2_HPACK) {
+            code = SrsHttp2ErrorCompression;
+        }
+        
+        srs_error_t r0 = send_goaway(code);
+        srs_freep(r0);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    srs_trace("HTTP2 client ip=%s, max_streams=%d", owner->remote_ip().c_str(), max_streams);
+    
+    // The SETTINGS is the connection preface of server.
+    char settings[6];
+    settings[0] = 0;
+    settings[1] = SrsHttp2SettingMaxConcurrentStreams;
+    settings[2] = (char)(max_streams >> 24);
+    settings[3] = (char)(max_streams >> 16);
+    settings[4] = (char)(max_streams >> 8);
+    settings[5] = (char)max_streams;
+    if ((err = send_frame(SrsHttp2FrameTypeSettings, 0, 0, settings, sizeof(settings))) != srs_success) {
+        return srs_error_wrap(err, "send settings");
+    }
+    
+    // Read the frames by interval, to check the coroutine and free the streams which are done.
+    skt->set_recv_timeout(SRS_HTTP2_TICK);
+    
+    srs_utime_t idle_starttime = srs_get_system_time();
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        cleanup();
+        
+        // Gracefully close, when client goaway and all streams are done.
+        if (goaway && streams.empty()) {
+            return err;
+        }
+        
+        SrsHttp2FrameHeader fh;
+        if ((err = buffer->grow(skt, SRS_HTTP2_FRAME_HEADER_SIZE)) == srs_success) {
+            fh.decode(buffer->bytes());
+            
+            // We never change the SETTINGS_MAX_FRAME_SIZE, see RFC7540 section 4.2.
+            if (fh.length > SRS_HTTP2_DEFAULT_FRAME_SIZE) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "frame size=%d", fh.length);
+            }
+            
+            err = buffer->grow(skt, SRS_HTTP2_FRAME_HEADER_SIZE + fh.length);
+        }
+        
+        // Ignore the timeout, the bytes of partial frame are kept in buffer.
+        if (err != srs_success) {
+            if (srs_error_code(err) != ERROR_SOCKET_TIMEOUT) {
+                return srs_error_wrap(err, "read frame");
+            }
+            srs_freep(err);
+            
+            // Close the idle connection, like the keep-alive of HTTP/1.1.
+            if (streams.empty() && srs_get_system_time() - idle_starttime > SRS_HTTP_RECV_TIMEOUT) {
+                srs_trace("HTTP2 client idle for %dms, last stream=%u", srsu2msi(SRS_HTTP_RECV_TIMEOUT), last_stream_id);
+                return send_goaway(SrsHttp2ErrorNo);
+            }
+            continue;
+        }
+        idle_starttime = srs_get_system_time();
+        
+        char* payload = buffer->read_slice(SRS_HTTP2_FRAME_HEADER_SIZE + fh.length) + SRS_HTTP2_FRAME_HEADER_SIZE;
+        if ((err = on_frame(&fh, payload)) != srs_success) {
+            return srs_error_wrap(err, "frame type=%d, stream=%u, size=%d", fh.type, fh.stream_id, fh.length);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::on_frame(SrsHttp2FrameHeader* fh, char* payload)
+{
+    srs_error_t err = srs_success;
+    
+    // The header block must be contiguous, see RFC7540 section 6.10.
+    if (continuation_id && (fh->type != SrsHttp2FrameTypeContinuation || fh->stream_id != continuation_id)) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "expect continuation of stream=%u", continuation_id);
+    }
+    
+    switch (fh->type) {
+        case SrsHttp2FrameTypeData:
+            return on_data(fh, payload);
+        case SrsHttp2FrameTypeHeaders:
+            return on_headers(fh, payload);
+        case SrsHttp2FrameTypeContinuation:
+            if (!continuation_id) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "unexpected continuation");
+            }
+            if (block.length() + fh->length > SRS_HTTP2_MAX_BODY) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "header block size=%d", (int)block.length() + fh->length);
+            }
+            block.append(payload, fh->length);
+            if ((fh->flags & SRS_HTTP2_FLAG_END_HEADERS) == 0) {
+                return err;
+            }
+            continuation_id = 0;
+            return on_header_block(fh->stream_id, continuation_flags);
+        case SrsHttp2FrameTypeSettings:
+            return on_settings(fh, payload);
+        case SrsHttp2FrameTypePing:
+            if (fh->length != 8) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "ping size=%d", fh->length);
+            }
+            if ((fh->flags & SRS_HTTP2_FLAG_ACK) == 0) {
+                return send_frame(SrsHttp2FrameTypePing, SRS_HTTP2_FLAG_ACK, 0, payload, fh->length);
+            }
+            return err;
+        case SrsHttp2FrameTypeGoaway:
+            goaway = true;
+            srs_trace("HTTP2 client goaway, streams=%d", (int)streams.size());
+            return err;
+        case SrsHttp2FrameTypeWindowUpdate:
+            return on_window_update(fh, payload);
+        case SrsHttp2FrameTypeRstStream:
+            return on_rst_stream(fh, payload);
+        case SrsHttp2FrameTypePushPromise:
+            return srs_error_new(ERROR_HTTP2_PROTOCOL, "client push");
+        default:
+            // Ignore the PRIORITY and unknown frames, see RFC7540 section 4.1.
+            return err;
+    }
+}
+
+srs_error_t SrsHttp2Conn::on_headers(SrsHttp2FrameHeader* fh, char* payload)
+{
+    srs_error_t err = srs_success;
+    
+    // The stream of client is odd, see RFC7540 section 5.1.1.
+    if (fh->stream_id == 0 || (fh->stream_id % 2) == 0) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "headers of stream=%u", fh->stream_id);
+    }
+    
+    char* p = payload;
+    int size = fh->length;
+    if ((err = unpad(fh, p, size)) != srs_success) {
+        return srs_error_wrap(err, "unpad");
+    }
+    
+    // Ignore the priority of stream.
+    if ((fh->flags & SRS_HTTP2_FLAG_PRIORITY) != 0) {
+        if (size < 5) {
+            return srs_error_new(ERROR_HTTP2_PROTOCOL, "priority size=%d", size);
+        }
+        p += 5;
+        size -= 5;
+    }
+    
+    block.assign(p, size);
+    
+    // Wait for the CONTINUATION frames.
+    if ((fh->flags & SRS_HTTP2_FLAG_END_HEADERS) == 0) {
+        continuation_id = fh->stream_id;
+        continuation_flags = fh->flags;
+        return err;
+    }
+    
+    return on_header_block(fh->stream_id, fh->flags);
+}
+
+srs_error_t SrsHttp2Conn::on_header_block(uint32_t id, uint8_t flags)
+{
+    srs_error_t err = srs_success;
+    
+    // Always decode the block, to keep the dynamic table in sync, even the stream is refused.
+    vector<pair<string, string> > fields;
+    if ((err = hpack->decode(block.data(), (int)block.length(), fields)) != srs_success) {
+        return srs_error_wrap(err, "hpack");
+    }
+    block.clear();
+    
+    bool end_stream = (flags & SRS_HTTP2_FLAG_END_STREAM) != 0;
+    
+    // The trailers of request, which ends the stream.
+    std::map<uint32_t, SrsHttp2Stream*>::iterator it = streams.find(id);
+    if (it != streams.end()) {
+        SrsHttp2Stream* s = it->second;
+        if (s->request_done) {
+            return send_rst_stream(id, SrsHttp2ErrorStreamClosed);
+        }
+        if (!end_stream) {
+            return err;
+        }
+        s->request_done = true;
+        return s->start();
+    }
+    
+    // The stream identifier must increase, see RFC7540 section 5.1.1.
+    if (id <= last_stream_id) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "stream=%u, last=%u", id, last_stream_id);
+    }
+    last_stream_id = id;
+    
+    if (goaway || (int)streams.size() >= max_streams) {
+        srs_warn("HTTP2 refuse stream=%u, streams=%d, goaway=%d", id, (int)streams.size(), goaway);
+        return send_rst_stream(id, SrsHttp2ErrorRefusedStream);
+    }
+    
+    SrsHttp2Stream* s = new SrsHttp2Stream(this, id, peer_initial_window);
+    if ((err = s->on_headers(fields)) != srs_success) {
+        srs_warn("HTTP2 reset stream=%u, %s", id, srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(s);
+        return send_rst_stream(id, SrsHttp2ErrorProtocol);
+    }
+    streams[id] = s;
+    
+    // Serve the request without body now, or wait for the DATA frames.
+    if (end_stream) {
+        s->request_done = true;
+        return s->start();
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::on_data(SrsHttp2FrameHeader* fh, char* payload)
+{
+    srs_error_t err = srs_success;
+    
+    if (fh->stream_id == 0) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "data of stream 0");
+    }
+    
+    // The DATA is consumed or dropped, so update the window of connection now.
+    if (fh->length > 0 && (err = send_window_update(0, fh->length)) != srs_success) {
+        return srs_error_wrap(err, "window update");
+    }
+    
+    char* p = payload;
+    int size = fh->length;
+    if ((err = unpad(fh, p, size)) != srs_success) {
+        return srs_error_wrap(err, "unpad");
+    }
+    
+    std::map<uint32_t, SrsHttp2Stream*>::iterator it = streams.find(fh->stream_id);
+    if (it == streams.end() || it->second->request_done) {
+        return send_rst_stream(fh->stream_id, SrsHttp2ErrorStreamClosed);
+    }
+    
+    SrsHttp2Stream* s = it->second;
+    if (s->body.length() + size > SRS_HTTP2_MAX_BODY) {
+        srs_warn("HTTP2 refuse stream=%u, body=%d", s->id, (int)s->body.length() + size);
+        s->reset = s->request_done = s->cycle_done = true;
+        return send_rst_stream(s->id, SrsHttp2ErrorRefusedStream);
+    }
+    s->body.append(p, size);
+    
+    if ((fh->flags & SRS_HTTP2_FLAG_END_STREAM) == 0) {
+        return send_window_update(s->id, fh->length);
+    }
+    
+    s->request_done = true;
+    return s->start();
+}
+
+srs_error_t SrsHttp2Conn::on_settings(SrsHttp2FrameHeader* fh, char* payload)
+{
+    srs_error_t err = srs_success;
+    
+    if (fh->stream_id != 0 || (fh->length % 6) != 0) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "settings stream=%u, size=%d", fh->stream_id, fh->length);
+    }
+    
+    if ((fh->flags & SRS_HTTP2_FLAG_ACK) != 0) {
+        return err;
+    }
+    
+    uint8_t* p = (uint8_t*)payload;
+    for (int i = 0; i < fh->length; i += 6, p += 6) {
+        int id = (p[0] << 8) | p[1];
+        uint32_t v = ((uint32_t)p[2] << 24) | (p[3] << 16) | (p[4] << 8) | p[5];
+        
+        if (id == SrsHttp2SettingInitialWindowSize) {
+            if (v > SRS_HTTP2_MAX_WINDOW) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "initial window=%u", v);
+            }
+            
+            // Apply the delta to the windows of all streams, see RFC7540 section 6.9.2.
+            int64_t delta = (int64_t)v - peer_initial_window;
+            std::map<uint32_t, SrsHttp2Stream*>::iterator it;
+            for (it = streams.begin(); it != streams.end(); ++it) {
+                it->second->send_window += delta;
+            }
+            peer_initial_window = (int)v;
+        } else if (id == SrsHttp2SettingMaxFrameSize) {
+            if (v < SRS_HTTP2_DEFAULT_FRAME_SIZE || v > SRS_HTTP2_MAX_FRAME_SIZE) {
+                return srs_error_new(ERROR_HTTP2_PROTOCOL, "max frame=%u", v);
+            }
+            peer_max_frame = (int)v;
+        }
+    }
+    
+    srs_cond_broadcast(window_cond);
+    
+    return send_frame(SrsHttp2FrameTypeSettings, SRS_HTTP2_FLAG_ACK, 0, NULL, 0);
+}
+
+srs_error_t SrsHttp2Conn::on_window_update(SrsHttp2FrameHeader* fh, char* payload)
+{
+    if (fh->length != 4) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "window update size=%d", fh->length);
+    }
+    
+    uint8_t* p = (uint8_t*)payload;
+    int increment = ((p[0] & 0x7f) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    
+    if (fh->stream_id == 0) {
+        send_window += increment;
+        if (!increment || send_window > SRS_HTTP2_MAX_WINDOW) {
+            return srs_error_new(ERROR_HTTP2_PROTOCOL, "window=%" PRId64 ", increment=%d", send_window, increment);
+        }
+    } else {
+        std::map<uint32_t, SrsHttp2Stream*>::iterator it = streams.find(fh->stream_id);
+        if (it != streams.end()) {
+            SrsHttp2Stream* s = it->second;
+            s->send_window += increment;
+            if (!increment || s->send_window > SRS_HTTP2_MAX_WINDOW) {
+                s->reset = true;
+                return send_rst_stream(s->id, SrsHttp2ErrorFlowControl);
+            }
+        }
+    }
+    
+    srs_cond_broadcast(window_cond);
+    
+    return srs_success;
+}
+
+srs_error_t SrsHttp2Conn::on_rst_stream(SrsHttp2FrameHeader* fh, char* payload)
+{
+    if (fh->length != 4) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "rst stream size=%d", fh->length);
+    }
+    
+    std::map<uint32_t, SrsHttp2Stream*>::iterator it = streams.find(fh->stream_id);
+    if (it == streams.end()) {
+        return srs_success;
+    }
+    
+    // Never interrupt the stream, which may be sending a frame, so it stops before next frame.
+    SrsHttp2Stream* s = it->second;
+    s->reset = true;
+    if (!s->trd) {
+        s->cycle_done = true;
+    }
+    srs_cond_broadcast(window_cond);
+    
+    return srs_success;
+}
+
+srs_error_t SrsHttp2Conn::unpad(SrsHttp2FrameHeader* fh, char*& payload, int& size)
+{
+    if ((fh->flags & SRS_HTTP2_FLAG_PADDED) == 0) {
+        return srs_success;
+    }
+    
+    if (size < 1 || (uint8_t)payload[0] >= size) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "padding size=%d", size);
+    }
+    
+    size -= 1 + (uint8_t)payload[0];
+    payload++;
+    
+    return srs_success;
+}
+
+void SrsHttp2Conn::cleanup()
+{
+    std::map<uint32_t, SrsHttp2Stream*>::iterator it;
+    for (it = streams.begin(); it != streams.end();) {
+        SrsHttp2Stream* s = it->second;
+        if (!s->cycle_done) {
+            ++it;
+            continue;
+        }
+        
+        streams.erase(it++);
+        srs_freep(s);
+    }
+}
+
+srs_error_t SrsHttp2Conn::send_frame(uint8_t type, uint8_t flags, uint32_t id, const char* payload, int size)
+{
+    srs_error_t err = srs_success;
+    
+    char header[SRS_HTTP2_FRAME_HEADER_SIZE];
+    SrsHttp2FrameHeader(size, type, flags, id).encode(header);
+    
+    iovec iovs[2];
+    iovs[0].iov_base = header;
+    iovs[0].iov_len = SRS_HTTP2_FRAME_HEADER_SIZE;
+    iovs[1].iov_base = (char*)payload;
+    iovs[1].iov_len = size;
+    
+    // The lock is interrupted when connection is closing.
+    if (srs_mutex_lock(lock) != 0) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "lock");
+    }
+    err = skt->writev(iovs, size > 0? 2 : 1, NULL);
+    srs_mutex_unlock(lock);
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write frame type=%d", type);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::send_headers(SrsHttp2Stream* s, vector<pair<string, string> >& fields, bool end_stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (s->reset) {
+        return srs_error_new(ERROR_HTTP2_PROTOCOL, "stream=%u reset", s->id);
+    }
+    
+    string hb;
+    srs_hpack_encode(fields, hb);
+    
+    // The HEADERS and CONTINUATION frames must be contiguous.
+    if (srs_mutex_lock(lock) != 0) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "lock");
+    }
+    
+    for (int pos = 0; err == srs_success && (pos == 0 || pos < (int)hb.length());) {
+        int size = srs_min((int)hb.length() - pos, peer_max_frame);
+        
+        uint8_t type = pos? SrsHttp2FrameTypeContinuation : SrsHttp2FrameTypeHeaders;
+        uint8_t flags = (pos == 0 && end_stream)? SRS_HTTP2_FLAG_END_STREAM : 0;
+        if (pos + size >= (int)hb.length()) {
+            flags |= SRS_HTTP2_FLAG_END_HEADERS;
+        }
+        
+        char header[SRS_HTTP2_FRAME_HEADER_SIZE];
+        SrsHttp2FrameHeader(size, type, flags, s->id).encode(header);
+        
+        iovec iovs[2];
+        iovs[0].iov_base = header;
+        iovs[0].iov_len = SRS_HTTP2_FRAME_HEADER_SIZE;
+        iovs[1].iov_base = (char*)hb.data() + pos;
+        iovs[1].iov_len = size;
+        
+        err = skt->writev(iovs, 2, NULL);
+        pos += size;
+        
+        if (pos >= (int)hb.length()) {
+            break;
+        }
+    }
+    
+    srs_mutex_unlock(lock);
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write headers");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::send_data(SrsHttp2Stream* s, char* data, int size, bool end_stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (size <= 0) {
+        if (s->reset) {
+            return srs_error_new(ERROR_HTTP2_PROTOCOL, "stream=%u reset", s->id);
+        }
+        return send_frame(SrsHttp2FrameTypeData, end_stream? SRS_HTTP2_FLAG_END_STREAM : 0, s->id, NULL, 0);
+    }
+    
+    // Send each frame in the lock, so the frames of streams are interleaved.
+    while (size > 0) {
+        int nn = 0;
+        if ((err = acquire(s, size, &nn)) != srs_success) {
+            return srs_error_wrap(err, "acquire");
+        }
+        
+        uint8_t flags = (nn == size && end_stream)? SRS_HTTP2_FLAG_END_STREAM : 0;
+        if ((err = send_frame(SrsHttp2FrameTypeData, flags, s->id, data, nn)) != srs_success) {
+            return srs_error_wrap(err, "write data");
+        }
+        
+        data += nn;
+        size -= nn;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::send_file(SrsHttp2Stream* s, int fd, int64_t offset, int size, bool end_stream)
+{
+    srs_error_t err = srs_success;
+    
+    off_t pos = (off_t)offset;
+    while (size > 0) {
+        int nn = 0;
+        if ((err = acquire(s, size, &nn)) != srs_success) {
+            return srs_error_wrap(err, "acquire");
+        }
+        
+        char header[SRS_HTTP2_FRAME_HEADER_SIZE];
+        uint8_t flags = (nn == size && end_stream)? SRS_HTTP2_FLAG_END_STREAM : 0;
+        SrsHttp2FrameHeader(nn, SrsHttp2FrameTypeData, flags, s->id).encode(header);
+        
+        // The payload of DATA is sent from file in kernel, after the frame header.
+        if (srs_mutex_lock(lock) != 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "lock");
+        }
+        if ((err = skt->write(header, SRS_HTTP2_FRAME_HEADER_SIZE, NULL)) == srs_success) {
+            err = sf->sendfile(fd, &pos, nn, NULL);
+        }
+        srs_mutex_unlock(lock);
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "sendfile offset=%d, size=%d", (int)pos, nn);
+        }
+        
+        size -= nn;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttp2Conn::send_rst_stream(uint32_t id, SrsHttp2ErrorCode code)
+{
+    char payload[4] = {0, 0, 0, (char)code};
+    return send_frame(SrsHttp2FrameTypeRstStream, 0, id, payload, sizeof(payload));
+}
+
+srs_error_t SrsHttp2Conn::send_window_update(uint32_t id, int increment)
+{
+    char payload[4];
+    payload[0] = (char)((increment >> 24) & 0x7f);
+    payload[1] = (char)(increment >> 16);
+    payload[2] = (char)(increment >> 8);
+    payload[3] = (char)increment;
+    return send_frame(SrsHttp2FrameTypeWindowUpdate, 0, id, payload, sizeof(payload));
+}
+
+srs_error_t SrsHttp2Conn::send_goaway(SrsHttp2ErrorCode code)
+{
+    char payload[8];
+    payload[0] = (char)((last_stream_id >> 24) & 0x7f);
+    payload[1] = (char)(last_stream_id >> 16);
+    payload[2] = (char)(last_stream_id >> 8);
+    payload[3] = (char)last_stream_id;
+    payload[4] = payload[5] = payload[6] = 0;
+    payload[7] = (char)code;
+    return send_frame(SrsHttp2FrameTypeGoaway, 0, 0, payload, sizeof(payload));
+}
+
+srs_error_t SrsHttp2Conn::acquire(SrsHttp2Stream* s, int want, int* pgot)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = s->trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        if (s->reset) {
+            return srs_error_new(ERROR_HTTP2_PROTOCOL, "stream=%u reset", s->id);
+        }
+        
+        int64_t available = srs_min(srs_min(send_window, s->send_window), (int64_t)peer_max_frame);
+        if (available > 0) {
+            int nn = (int)srs_min((int64_t)want, available);
+            send_window -= nn;
+            s->send_window -= nn;
+            *pgot = nn;
+            return err;
+        }
+        
+        // Wait for the WINDOW_UPDATE or SETTINGS of client.
+        srs_cond_wait(window_cond);
+    }
+    
+    return err;
+}
+
@@ -0,0 +1,231 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_HTTP2_HPP
+#define SRS_APP_HTTP2_HPP
+
+#include <srs_core.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <srs_http_stack.hpp>
+#include <srs_http2_stack.hpp>
+#include <srs_service_conn.hpp>
+#include <srs_service_st.hpp>
+#include <srs_app_st.hpp>
+
+class SrsFastStream;
+class SrsHpackDecoder;
+class SrsHttp2Conn;
+class SrsHttp2Stream;
+class ISrsProtocolReadWriter;
+class ISrsSendfileWriter;
+
+// The interval to check the coroutine and idle connection, when no frame.
+#define SRS_HTTP2_TICK (1 * SRS_UTIME_SECONDS)
+// The max size of request body, the HTTP/2 is for players, which seldom post body.
+#define SRS_HTTP2_MAX_BODY (64 * 1024)
+
+// The reader to detect the preface of HTTP/2, which replays the bytes for HTTP/1.1 when not HTTP/2.
+class SrsHttp2PrefaceReader : public ISrsReader
+{
+private:
+    ISrsReader* reader;
+    // The bytes read for detecting, to replay.
+    std::string preface;
+    size_t pos;
+public:
+    SrsHttp2PrefaceReader(ISrsReader* r);
+    virtual ~SrsHttp2PrefaceReader();
+public:
+    // Read until the preface is matched or not, which never blocks for the request of HTTP/1.1,
+    // because it stops at the first byte mismatched.
+    virtual srs_error_t detect(bool& h2);
+// Interface ISrsReader
+public:
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+};
+
+// The response writer of HTTP/2 stream, which sends the HEADERS and DATA frames.
+class SrsHttp2ResponseWriter : public ISrsHttpResponseWriter, public ISrsHttpSendfileWriter
+{
+private:
+    SrsHttp2Stream* stream;
+    SrsHttpHeader* hdr;
+    // Whether the header is logically written, and the status code.
+    bool header_wrote;
+    int status;
+    // The explicitly-declared Content-Length; or -1
+    int64_t content_length;
+    // The number of bytes written in body
+    int64_t written;
+    // Whether the HEADERS is sent.
+    bool header_sent;
+    // Whether the END_STREAM is sent.
+    bool ended;
+public:
+    SrsHttp2ResponseWriter(SrsHttp2Stream* s);
+    virtual ~SrsHttp2ResponseWriter();
+public:
+    // Whether the response is complete, that is, the END_STREAM is sent.
+    virtual bool is_ended();
+// Interface ISrsHttpResponseWriter
+public:
+    virtual srs_error_t final_request();
+    virtual SrsHttpHeader* header();
+    virtual srs_error_t write(char* data, int size);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+    virtual void write_header(int code);
+// Interface ISrsHttpSendfileWriter
+public:
+    virtual bool sendfile_enabled();
+    virtual srs_error_t sendfile(int fd, int64_t offset, int size);
+private:
+    virtual srs_error_t send_header(char* data, int size, bool end_stream);
+};
+
+// The stream of HTTP/2, that is a request and its response, served by a coroutine.
+class SrsHttp2Stream : public ISrsCoroutineHandler, public ISrsReader
+{
+    friend class SrsHttp2Conn;
+    friend class SrsHttp2ResponseWriter;
+private:
+    uint32_t id;
+    SrsHttp2Conn* conn;
+    SrsCoroutine* trd;
+private:
+    // The request, the pseudo-header fields and the header fields in canonical form.
+    std::string method;
+    std::string path;
+    SrsHttpHeader header;
+    // The body of request, read by the message.
+    std::string body;
+    size_t body_pos;
+private:
+    // The window to send DATA.
+    int64_t send_window;
+    // Whether the request is complete, by END_STREAM.
+    bool request_done;
+    // Whether the response is complete, by END_STREAM.
+    bool response_done;
+    // Whether the cycle is done, to free it.
+    bool cycle_done;
+    // Whether reset by client, then stop sending frames.
+    bool reset;
+public:
+    SrsHttp2Stream(SrsHttp2Conn* c, uint32_t sid, int64_t window);
+    virtual ~SrsHttp2Stream();
+public:
+    // Parse the fields of header block.
+    virtual srs_error_t on_headers(std::vector<std::pair<std::string, std::string> >& fields);
+    // Start the coroutine to serve the request.
+    virtual srs_error_t start();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+// Interface ISrsReader
+public:
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+private:
+    virtual srs_error_t do_cycle();
+};
+
+// The connection of HTTP/2, which multiplexes the requests as streams, and serves them by the
+// handler concurrently, for example, the playlist and segments of HLS and DASH, over a connection.
+// @remark The frames are sent by the coroutines of streams, serialized by a lock.
+// @see https://tools.ietf.org/html/rfc7540
+class SrsHttp2Conn : public ISrsConnection
+{
+    friend class SrsHttp2Stream;
+    friend class SrsHttp2ResponseWriter;
+private:
+    ISrsConnection* owner;
+    ISrsProtocolReadWriter* skt;
+    // The sendfile of skt, NULL if not supported.
+    ISrsSendfileWriter* sf;
+    ISrsHttpServeMux* handler;
+    // The coroutine of connection, which reads the frames.
+    SrsCoroutine* trd;
+    SrsFastStream* buffer;
+    SrsHpackDecoder* hpack;
+private:
+    // The lock to send a frame atomically, for the streams write concurrently.
+    srs_mutex_t lock;
+    // The cond to notify the streams, when window updated.
+    srs_cond_t window_cond;
+private:
+    // The max number of streams, concurrently.
+    int max_streams;
+    std::map<uint32_t, SrsHttp2Stream*> streams;
+    uint32_t last_stream_id;
+    // The window of connection to send DATA.
+    int64_t send_window;
+    // The settings of peer.
+    int peer_initial_window;
+    int peer_max_frame;
+    // Whether got the GOAWAY from client.
+    bool goaway;
+private:
+    // The header block of stream, when expecting the CONTINUATION.
+    uint32_t continuation_id;
+    uint8_t continuation_flags;
+    std::string block;
+public:
+    SrsHttp2Conn(ISrsConnection* c, ISrsProtocolReadWriter* io, ISrsHttpServeMux* h, SrsCoroutine* t, int streams);
+    virtual ~SrsHttp2Conn();
+// Interface ISrsConnection
+public:
+    virtual std::string remote_ip();
+public:
+    // Serve the frames, the preface of client must be read.
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t on_frame(SrsHttp2FrameHeader* fh, char* payload);
+    virtual srs_error_t on_headers(SrsHttp2FrameHeader* fh, char* payload);
+    virtual srs_error_t on_header_block(uint32_t id, uint8_t flags);
+    virtual srs_error_t on_data(SrsHttp2FrameHeader* fh, char* payload);
+    virtual srs_error_t on_settings(SrsHttp2FrameHeader* fh, char* payload);
+    virtual srs_error_t on_window_update(SrsHttp2FrameHeader* fh, char* payload);
+    virtual srs_error_t on_rst_stream(SrsHttp2FrameHeader* fh, char* payload);
+    // Strip the padding of DATA and HEADERS.
+    virtual srs_error_t unpad(SrsHttp2FrameHeader* fh, char*& payload, int& size);
+    // Free the streams which are done.
+    virtual void cleanup();
+private:
+    // Send a frame atomically.
+    virtual srs_error_t send_frame(uint8_t type, uint8_t flags, uint32_t id, const char* payload, int size);
+    virtual srs_error_t send_headers(SrsHttp2Stream* s, std::vector<std::pair<std::string, std::string> >& fields, bool end_stream);
+    virtual srs_error_t send_data(SrsHttp2Stream* s, char* data, int size, bool end_stream);
+    virtual srs_error_t send_file(SrsHttp2Stream* s, int fd, int64_t offset, int size, bool end_stream);
+    virtual srs_error_t send_rst_stream(uint32_t id, SrsHttp2ErrorCode code);
+    virtual srs_error_t send_window_update(uint32_t id, int increment);
+    virtual srs_error_t send_goaway(SrsHttp2ErrorCode code);
+    // Acquire the window to send DATA, wait when the window of connection or stream is exhausted.
+    virtual srs_error_t acquire(SrsHttp2Stream* s, int want, int* pgot);
+};
+
+#endif
+
@@ -31,6 +31,8 @@ using namespace std;
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_app_st.hpp>
+#include <srs_app_encoder.hpp>
+#include <srs_kernel_recorder.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_utility.hpp>
@@ -46,8 +48,18 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_async_call.hpp>
+#include <srs_app_http_static.hpp>
+#include <srs_service_dns.hpp>
+#include <srs_app_snapshot.hpp>
+#include <srs_app_upload.hpp>
+#include <srs_app_events.hpp>
+#include <srs_app_rtc.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_st.hpp>
 
-srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, string data)
+srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, const string& data)
 {
     srs_error_t err = srs_success;
     
@@ -96,7 +108,7 @@ srs_error_t srs_api_response_jsonp_code(ISrsHttpResponseWriter* w, string callba
     return srs_api_response_jsonp(w, callback, obj->dumps());
 }
 
-srs_error_t srs_api_response_json(ISrsHttpResponseWriter* w, string data)
+srs_error_t srs_api_response_json(ISrsHttpResponseWriter* w, const string& data)
 {
     srs_error_t err = srs_success;
     
@@ -132,7 +144,7 @@ srs_error_t srs_api_response_json_code(ISrsHttpResponseWriter* w, srs_error_t co
     return srs_api_response_json(w, obj->dumps());
 }
 
-srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string json)
+srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, const std::string& json)
 {
     // no jsonp, directly response.
     if (!r->is_jsonp()) {
@@ -253,6 +265,10 @@ srs_error_t SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
     urls->set("versions", SrsJsonAny::str("the version of SRS"));
     urls->set("summaries", SrsJsonAny::str("the summary(pid, argv, pwd, cpu, mem) of SRS"));
     urls->set("rusages", SrsJsonAny::str("the rusage of SRS"));
+    urls->set("disk_io", SrsJsonAny::str("the stat of disk io threads"));
+    urls->set("async_calls", SrsJsonAny::str("the queues, drops and timeouts of async calls, for http hooks"));
+    urls->set("file_cache", SrsJsonAny::str("the hit and miss of opened files cache of http static server"));
+    urls->set("uploads", SrsJsonAny::str("the uploads and failures of HLS/DVR files to object storage"));
     urls->set("self_proc_stats", SrsJsonAny::str("the self process stats"));
     urls->set("system_proc_stats", SrsJsonAny::str("the system process stats"));
     urls->set("meminfos", SrsJsonAny::str("the meminfo of system"));
@@ -264,6 +280,13 @@ srs_error_t SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
     urls->set("clients", SrsJsonAny::str("manage all clients or specified client, default query top 10 clients"));
     urls->set("raw", SrsJsonAny::str("raw api for srs, support CUID srs for instance the config"));
     urls->set("clusters", SrsJsonAny::str("origin cluster server API"));
+    urls->set("dns", SrsJsonAny::str("the cache and stat of dns resolver"));
+    urls->set("memory", SrsJsonAny::str("the memory held by subsystems, and the budget of each connection"));
+    urls->set("stacks", SrsJsonAny::str("the stack size and resident high-water of coroutines by role"));
+    urls->set("scheduler", SrsJsonAny::str("the delay of run queue and cpu of coroutines, by scheduler.profile"));
+    urls->set("profile", SrsJsonAny::str("sample the cpu for seconds=30 in hz=99, response the folded stacks for flame graph"));
+    urls->set("recorder", SrsJsonAny::str("dump the binary events of flight recorder, decoded by research/recorder/srs_recorder.py"));
+    urls->set("transcodes", SrsJsonAny::str("the utilization of slots and queue of transcode scheduler"));
     
     SrsJsonObject* tests = SrsJsonAny::object();
     obj->set("tests", tests);
@@ -373,6 +396,194 @@ srs_error_t SrsGoApiRusages::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     return srs_api_response(w, r, obj->dumps());
 }
 
+SrsGoApiDiskIo::SrsGoApiDiskIo()
+{
+}
+
+SrsGoApiDiskIo::~SrsGoApiDiskIo()
+{
+}
+
+srs_error_t SrsGoApiDiskIo::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    _srs_disk_io->dumps(data);
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiAsyncCalls::SrsGoApiAsyncCalls()
+{
+}
+
+SrsGoApiAsyncCalls::~SrsGoApiAsyncCalls()
+{
+}
+
+srs_error_t SrsGoApiAsyncCalls::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    SrsAsyncCallWorker::dumps(data);
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiFileCache::SrsGoApiFileCache()
+{
+}
+
+SrsGoApiFileCache::~SrsGoApiFileCache()
+{
+}
+
+srs_error_t SrsGoApiFileCache::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    _srs_http_file_cache->dumps(data);
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiUploads::SrsGoApiUploads()
+{
+}
+
+SrsGoApiUploads::~SrsGoApiUploads()
+{
+}
+
+srs_error_t SrsGoApiUploads::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    _srs_uploader->dumps(data);
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiEvents::SrsGoApiEvents()
+{
+}
+
+SrsGoApiEvents::~SrsGoApiEvents()
+{
+}
+
+srs_error_t SrsGoApiEvents::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
+    
+    _srs_events->subscribe();
+    srs_error_t err = do_serve_http(w, r);
+    _srs_events->unsubscribe();
+    
+    return err;
+}
+
+srs_error_t SrsGoApiEvents::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    bool sse = r->query_get("format") != "jsonl";
+    
+    // The types are joined by plus, for comma is a separator of query string, see srs_parse_query_string.
+    std::set<std::string> types;
+    std::vector<std::string> vs = srs_string_split(r->query_get("types"), "+");
+    for (int i = 0; i < (int)vs.size(); i++) {
+        if (!vs.at(i).empty()) {
+            types.insert(vs.at(i));
+        }
+    }
+    
+    // Resume from the last event id of EventSource, or the latest event.
+    std::string last = r->header()->get("Last-Event-ID");
+    if (last.empty()) {
+        last = r->query_get("last_event_id");
+    }
+    int64_t cursor = last.empty()? _srs_events->last_id() : ::atoll(last.c_str());
+    
+    // Without content length, the response is chunked.
+    SrsHttpHeader* h = w->header();
+    h->set_content_type(sse? "text/event-stream" : "application/x-ndjson");
+    h->set("Cache-Control", "no-cache");
+    
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    if ((err = w->write(NULL, 0)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+    
+    while (true) {
+        std::string data;
+        int64_t lost = 0;
+        cursor = _srs_events->fetch(cursor, types, sse, data, &lost);
+        
+        if (lost > 0) {
+            std::string event = "{\"type\":\"overflow\",\"lost\":" + srs_int2str(lost) + "}";
+            data = (sse? "event: overflow\ndata: " + event + "\n\n" : event + "\n") + data;
+        }
+        
+        if (!data.empty() && (err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+            return srs_error_wrap(err, "write events");
+        }
+        
+        // Wait for new events, or the heartbeat to detect the closed subscriber.
+        srs_utime_t starttime = srs_update_system_time();
+        if ((err = _srs_events->wait(SRS_EVENTS_HEARTBEAT)) != srs_success) {
+            return srs_error_wrap(err, "wait events");
+        }
+        
+        if (cursor == _srs_events->last_id() && srs_update_system_time() - starttime >= SRS_EVENTS_HEARTBEAT) {
+            std::string ping = sse? ": ping\n\n" : "\n";
+            if ((err = w->write((char*)ping.data(), (int)ping.length())) != srs_success) {
+                return srs_error_wrap(err, "write heartbeat");
+            }
+        }
+    }
+    
+    return err;
+}
+
 SrsGoApiSelfProcStats::SrsGoApiSelfProcStats()
 {
 }
@@ -691,27 +902,26 @@ srs_error_t SrsGoApiVhosts::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessag
         return srs_api_response_code(w, r, ERROR_RTMP_VHOST_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
     
     if (r->is_http_get()) {
         if (!vhost) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("vhosts", data);
+            jw.field("vhosts")->array_start();
             
-            if ((err = stat->dumps_vhosts(data)) != srs_success) {
+            if ((err = stat->dumps_vhosts(&jw)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            
+            jw.array_end();
         } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("vhost", data);;
+            jw.field("vhost");
             
-            if ((err = vhost->dumps(data)) != srs_success) {
+            if ((err = vhost->dumps(&jw)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
@@ -721,7 +931,9 @@ srs_error_t SrsGoApiVhosts::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessag
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    jw.object_end();
+    
+    return srs_api_response(w, r, jw.dumps());
 }
 
 SrsGoApiStreams::SrsGoApiStreams()
@@ -747,27 +959,26 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
     
     if (r->is_http_get()) {
         if (!stream) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("streams", data);
+            jw.field("streams")->array_start();
             
-            if ((err = stat->dumps_streams(data)) != srs_success) {
+            if ((err = stat->dumps_streams(&jw)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            
+            jw.array_end();
         } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("stream", data);;
+            jw.field("stream");
             
-            if ((err = stream->dumps(data)) != srs_success) {
+            if ((err = stream->dumps(&jw)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
@@ -777,7 +988,9 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    jw.object_end();
+    
+    return srs_api_response(w, r, jw.dumps());
 }
 
 SrsGoApiClients::SrsGoApiClients()
@@ -803,31 +1016,38 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.field("code")->integer(ERROR_SUCCESS);
+    jw.field("server")->integer(stat->server_id());
     
     if (r->is_http_get()) {
         if (!client) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("clients", data);
+            jw.field("clients")->array_start();
             
+            // The cursor is the id of last client of previous page, it's faster than start for large clients.
+            std::string rcursor = r->query_get("cursor");
             std::string rstart = r->query_get("start");
             std::string rcount = r->query_get("count");
+            int cursor = rcursor.empty()? -1 : srs_max(0, atoi(rcursor.c_str()));
             int start = srs_max(0, atoi(rstart.c_str()));
             int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_clients(data, start, count)) != srs_success) {
+            int next = -1;
+            if ((err = stat->dumps_clients(&jw, cursor, start, count, &next)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            
+            jw.array_end();
+            
+            if (next >= 0) {
+                jw.field("cursor")->integer(next);
+            }
         } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("client", data);;
+            jw.field("client");
             
-            if ((err = client->dumps(data)) != srs_success) {
+            if ((err = client->dumps(&jw)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
@@ -838,13 +1058,20 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
             return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
         }
         
+        // The client published in process maybe without connection, for example, the UDP caster.
+        if (!client->conn) {
+            return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
+        }
+        
         client->conn->expire();
         srs_warn("kickoff client id=%d ok", cid);
     } else {
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    jw.object_end();
+    
+    return srs_api_response(w, r, jw.dumps());
 }
 
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
@@ -1264,6 +1491,12 @@ SrsGoApiClusters::~SrsGoApiClusters()
 
 srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
+    // The event of stream pushed by co-worker.
+    string action = r->query_get("action");
+    if (!action.empty()) {
+        return serve_event(w, r, action);
+    }
+    
     SrsJsonObject* obj = SrsJsonAny::object();
     SrsAutoFree(SrsJsonObject, obj);
     
@@ -1276,6 +1509,7 @@ srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     string app = r->query_get("app");
     string stream = r->query_get("stream");
     string coworker = r->query_get("coworker");
+    bool peer = r->query_get("peer") == "1";
     data->set("query", SrsJsonAny::object()
               ->set("ip", SrsJsonAny::str(ip.c_str()))
               ->set("vhost", SrsJsonAny::str(vhost.c_str()))
@@ -1283,11 +1517,632 @@ srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
               ->set("stream", SrsJsonAny::str(stream.c_str())));
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
-    data->set("origin", coworkers->dumps(vhost, coworker, app, stream));
+    data->set("origin", coworkers->dumps(vhost, coworker, app, stream, peer));
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+srs_error_t SrsGoApiClusters::serve_event(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string action)
+{
+    string vhost = r->query_get("vhost");
+    string app = r->query_get("app");
+    string stream = r->query_get("stream");
+    int port = ::atoi(r->query_get("port").c_str());
+    srs_utime_t version = (srs_utime_t)::atoll(r->query_get("version").c_str());
+    
+    // Use the peer ip, if the co-worker doesn't specify the host.
+    string host = r->query_get("host");
+    SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
+    if (host.empty() && hr && hr->connection()) {
+        host = hr->connection()->remote_ip();
+    }
+    
+    if (vhost.empty() || stream.empty() || host.empty() || port <= 0) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    SrsCoWorkers* coworkers = SrsCoWorkers::instance();
+    if (action == "on_publish") {
+        coworkers->on_remote_publish(vhost, app, stream, host, port, version);
+    } else if (action == "on_unpublish") {
+        coworkers->on_remote_unpublish(vhost, app, stream, host, port, version);
+    } else {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    srs_trace("cluster: %s vhost=%s, app=%s, stream=%s, origin=%s:%d, version=%" PRId64,
+        action.c_str(), vhost.c_str(), app.c_str(), stream.c_str(), host.c_str(), port, version);
+    
+    return srs_api_response_code(w, r, ERROR_SUCCESS);
+}
+
+// The default idle duration of edge prefetch.
+#define SRS_EDGE_PREFETCH_IDLE (300 * SRS_UTIME_SECONDS)
+
+SrsGoApiPrefetch::SrsGoApiPrefetch(SrsServer* svr)
+{
+    server = svr;
+}
+
+SrsGoApiPrefetch::~SrsGoApiPrefetch()
+{
+}
+
+srs_error_t SrsGoApiPrefetch::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    string vhost = r->query_get("vhost");
+    string app = r->query_get("app");
+    string sidle = r->query_get("idle");
+    
+    vector<string> streams;
+    if (!r->query_get("stream").empty()) {
+        streams.push_back(r->query_get("stream"));
+    }
+    
+    // For POST, parse the list of streams from body.
+    if (r->is_http_post()) {
+        string body;
+        if ((err = r->body_read_all(body)) != srs_success) {
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
+        }
+        
+        SrsJsonAny* info = SrsJsonAny::loads(body);
+        SrsAutoFree(SrsJsonAny, info);
+        if (!info || !info->is_object()) {
+            return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+        }
+        
+        SrsJsonObject* o = info->to_object();
+        SrsJsonAny* prop = NULL;
+        if ((prop = o->ensure_property_string("vhost")) != NULL) {
+            vhost = prop->to_str();
+        }
+        if ((prop = o->ensure_property_string("app")) != NULL) {
+            app = prop->to_str();
+        }
+        if ((prop = o->ensure_property_integer("idle")) != NULL) {
+            sidle = srs_int2str(prop->to_integer());
+        }
+        if ((prop = o->ensure_property_array("streams")) != NULL) {
+            SrsJsonArray* arr = prop->to_array();
+            for (int i = 0; i < arr->count(); i++) {
+                if (arr->at(i)->is_string()) {
+                    streams.push_back(arr->at(i)->to_str());
+                }
+            }
+        }
+    }
+    
+    srs_utime_t idle = SRS_EDGE_PREFETCH_IDLE;
+    if (!sidle.empty()) {
+        idle = ::atoi(sidle.c_str()) * SRS_UTIME_SECONDS;
+    }
+    
+    // Resolve the vhost, which should be edge.
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(vhost.empty()? SRS_CONSTS_RTMP_DEFAULT_VHOST : vhost);
+    if (!parsed_vhost || !_srs_config->get_vhost_is_edge(parsed_vhost->arg0()) || app.empty()) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    vhost = parsed_vhost->arg0();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    
+    SrsJsonArray* data = SrsJsonAny::array();
+    obj->set("streams", data);
+    
+    for (int i = 0; i < (int)streams.size(); i++) {
+        string stream = streams.at(i);
+        if (stream.empty()) {
+            continue;
+        }
+        
+        SrsRequest req;
+        req.vhost = vhost;
+        req.host = (vhost == SRS_CONSTS_RTMP_DEFAULT_VHOST)? "127.0.0.1" : vhost;
+        req.app = app;
+        req.stream = stream;
+        req.schema = "rtmp";
+        req.port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        req.tcUrl = srs_generate_tc_url(req.host, req.vhost, req.app, req.port);
+        
+        SrsSource* source = NULL;
+        if ((err = _srs_sources->fetch_or_create(&req, server, &source)) != srs_success) {
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
+        }
+        
+        if ((err = source->on_edge_prefetch(idle)) != srs_success) {
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
+        }
+        
+        srs_trace("edge prefetch url=%s, idle=%dms", req.get_stream_url().c_str(), srsu2msi(idle));
+        data->append(SrsJsonAny::object()
+            ->set("url", SrsJsonAny::str(req.get_stream_url().c_str()))
+            ->set("remain_ms", SrsJsonAny::integer(srsu2ms(source->prefetch_remain()))));
+    }
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiRtcPlay::SrsGoApiRtcPlay(SrsServer* svr)
+{
+    server = svr;
+}
+
+SrsGoApiRtcPlay::~SrsGoApiRtcPlay()
+{
+}
+
+srs_error_t SrsGoApiRtcPlay::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtcServer* rtc = server->rtc_server();
+    if (!rtc) {
+        return srs_api_response_code(w, r, ERROR_RTC_DISABLED);
+    }
+    
+    if (!r->is_http_post()) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    string body;
+    if ((err = r->body_read_all(body)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    SrsJsonAny* info = SrsJsonAny::loads(body);
+    SrsAutoFree(SrsJsonAny, info);
+    if (!info || !info->is_object()) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    SrsJsonObject* o = info->to_object();
+    SrsJsonAny* streamurl = o->ensure_property_string("streamurl");
+    SrsJsonAny* offer = o->ensure_property_string("sdp");
+    if (!streamurl || !offer) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    // The stream url, for example, webrtc://host[:port]/app/stream?vhost=xxx
+    SrsRequest req;
+    srs_parse_rtmp_url(streamurl->to_str(), req.tcUrl, req.stream);
+    srs_discovery_tc_url(req.tcUrl, req.schema, req.host, req.vhost, req.app, req.stream, req.port, req.param);
+    req.ip = srs_get_original_ip(r);
+    SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
+    if (req.ip.empty() && hr && hr->connection()) {
+        req.ip = hr->connection()->remote_ip();
+    }
+    req.strip();
+    
+    // Apply the default vhost, like the RTMP client.
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req.vhost);
+    if (parsed_vhost) {
+        req.vhost = parsed_vhost->arg0();
+    }
+    
+    if (req.app.empty() || req.stream.empty()) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    if (!_srs_config->get_rtc_enabled(req.vhost)) {
+        return srs_api_response_code(w, r, ERROR_RTC_DISABLED);
+    }
+    
+    SrsSecurity security;
+    if ((err = security.check(SrsRtmpConnPlay, req.ip, &req)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_warn("rtc: reject %s, %s", req.get_stream_url().c_str(), srs_error_desc(err).c_str());
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    string answer, sid;
+    if ((err = rtc->create_session(&req, req.ip, offer->to_str(), answer, sid)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_warn("rtc: create session for %s, %s", req.get_stream_url().c_str(), srs_error_desc(err).c_str());
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    obj->set("sdp", SrsJsonAny::str(answer.c_str()));
+    obj->set("sessionid", SrsJsonAny::str(sid.c_str()));
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiSnapshots::SrsGoApiSnapshots()
+{
+    service = new SrsSnapshotService();
+}
+
+SrsGoApiSnapshots::~SrsGoApiSnapshots()
+{
+    srs_freep(service);
+}
+
+srs_error_t SrsGoApiSnapshots::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_snapshot_enabled()) {
+        return srs_api_response_code(w, r, ERROR_SNAPSHOT_DISABLED);
+    }
+    
+    string vhost = r->query_get("vhost");
+    string app = r->query_get("app");
+    string stream = r->query_get("stream");
+    string format = r->query_get("format");
+    
+    if (format.empty()) {
+        format = "flv";
+    }
+    if (app.empty() || stream.empty() || (format != "flv" && format != "jpg")) {
+        return srs_api_response_code(w, r, ERROR_REQUEST_DATA);
+    }
+    
+    string ffmpeg = _srs_config->get_snapshot_ffmpeg();
+    if (format == "jpg" && ffmpeg.empty()) {
+        return srs_api_response_code(w, r, ERROR_SNAPSHOT_DISABLED);
+    }
+    
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(vhost.empty()? SRS_CONSTS_RTMP_DEFAULT_VHOST : vhost);
+    if (!parsed_vhost) {
+        return srs_api_response_code(w, r, ERROR_RTMP_VHOST_NOT_FOUND);
+    }
+    
+    SrsRequest req;
+    req.vhost = parsed_vhost->arg0();
+    req.app = app;
+    req.stream = stream;
+    
+    SrsSource* source = _srs_sources->find(&req);
+    if (!source) {
+        return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
+    }
+    
+    SrsSnapshot* s = NULL;
+    if ((err = service->fetch(source, req.get_stream_url(), _srs_config->get_snapshot_interval(), &s)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    if (format == "jpg") {
+        int decoders = _srs_config->get_snapshot_decoders();
+        if ((err = service->decode(s, ffmpeg, decoders, _srs_config->get_snapshot_timeout())) != srs_success) {
+            srs_warn("snapshot %s ignore err %s", req.get_stream_url().c_str(), srs_error_desc(err).c_str());
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
+        }
+    }
+    
+    // Copy the data, for the snapshot maybe updated when writing.
+    string data = (format == "jpg")? s->jpeg : s->flv;
+    int64_t timestamp = (format == "jpg")? s->jpeg_timestamp : s->timestamp;
+    
+    SrsHttpHeader* h = w->header();
+    h->set_content_type(format == "jpg"? "image/jpeg" : "video/x-flv");
+    h->set_content_length(data.length());
+    h->set("X-Snapshot-Timestamp", srs_int2str(timestamp));
+    h->set("Cache-Control", "no-cache");
+    
+    if ((err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+        return srs_error_wrap(err, "write snapshot");
+    }
+    
+    return err;
+}
+
+SrsGoApiDns::SrsGoApiDns()
+{
+}
+
+SrsGoApiDns::~SrsGoApiDns()
+{
+}
+
+srs_error_t SrsGoApiDns::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    if ((err = SrsDnsResolver::instance()->dumps(data)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiMemory::SrsGoApiMemory(SrsServer* svr)
+{
+    server = svr;
+}
+
+SrsGoApiMemory::~SrsGoApiMemory()
+{
+}
+
+srs_error_t SrsGoApiMemory::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    int nn_conns = server->nb_conns();
+    data->set("rss", SrsJsonAny::integer(srs_get_self_rss()));
+    data->set("conns", SrsJsonAny::integer(nn_conns));
+    
+    int64_t alive = 0, reserved = 0, resident = 0;
+    SrsStackStats::instance()->memory(alive, reserved, resident);
+    
+    SrsJsonObject* stacks = SrsJsonAny::object();
+    data->set("stacks", stacks);
+    stacks->set("alive", SrsJsonAny::integer(alive));
+    stacks->set("reserved", SrsJsonAny::integer(reserved));
+    stacks->set("resident", SrsJsonAny::integer(resident));
+    
+    SrsMemoryStat* ms = srs_memory_global();
+    SrsJsonObject* subsystems = SrsJsonAny::object();
+    data->set("subsystems", subsystems);
+    for (int i = 0; i < SrsMemoryTypeMax; i++) {
+        subsystems->set(srs_memory_type2str((SrsMemoryType)i), SrsJsonAny::integer(ms->bytes[i]));
+    }
+    subsystems->set("total", SrsJsonAny::integer(ms->total()));
+    
+    // The budget of each connection, the gop, meta and hls caches are held by streams, so excluded.
+    int64_t recv = ms->bytes[SrsMemoryRecvBuffer] + ms->bytes[SrsMemoryPlayBuffer];
+    int64_t queue = ms->bytes[SrsMemoryQueue];
+    int64_t protocol = ms->bytes[SrsMemoryProtocolCache];
+    int64_t statistic = ms->bytes[SrsMemoryStatistic];
+    
+    SrsJsonObject* per_conn = SrsJsonAny::object();
+    data->set("per_conn", per_conn);
+    if (nn_conns > 0) {
+        per_conn->set("stack", SrsJsonAny::integer(resident / nn_conns));
+        per_conn->set("recv", SrsJsonAny::integer(recv / nn_conns));
+        per_conn->set("queue", SrsJsonAny::integer(queue / nn_conns));
+        per_conn->set("protocol", SrsJsonAny::integer(protocol / nn_conns));
+        per_conn->set("statistic", SrsJsonAny::integer(statistic / nn_conns));
+        per_conn->set("total", SrsJsonAny::integer((resident + recv + queue + protocol + statistic) / nn_conns));
+    }
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiStacks::SrsGoApiStacks()
+{
+}
+
+SrsGoApiStacks::~SrsGoApiStacks()
+{
+}
+
+srs_error_t SrsGoApiStacks::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    if ((err = SrsStackStats::instance()->dumps(data)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiScheduler::SrsGoApiScheduler()
+{
+}
+
+SrsGoApiScheduler::~SrsGoApiScheduler()
+{
+}
+
+srs_error_t SrsGoApiScheduler::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(SrsStatistic::instance()->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    if ((err = SrsSchedulerStats::instance()->dumps(data)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
     
     return srs_api_response(w, r, obj->dumps());
 }
 
+SrsGoApiProfile::SrsGoApiProfile()
+{
+}
+
+SrsGoApiProfile::~SrsGoApiProfile()
+{
+}
+
+srs_error_t SrsGoApiProfile::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
+    
+    std::string rseconds = r->query_get("seconds");
+    std::string rhz = r->query_get("hz");
+    int seconds = rseconds.empty()? 30 : ::atoi(rseconds.c_str());
+    int hz = rhz.empty()? 99 : ::atoi(rhz.c_str());
+    if (seconds <= 0 || seconds > 300) {
+        return srs_api_response_code(w, r, ERROR_SYSTEM_PROFILE);
+    }
+    
+    SrsCpuProfiler* profiler = SrsCpuProfiler::instance();
+    if ((err = profiler->start(hz)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_warn("profile: %s", srs_error_desc(err).c_str());
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    // Block this connection for sampling, other coroutines are not affected.
+    srs_usleep(seconds * SRS_UTIME_SECONDS);
+    profiler->stop();
+    
+    std::string data = profiler->dumps();
+    
+    SrsHttpHeader* h = w->header();
+    h->set_content_length(data.length());
+    h->set_content_type("text/plain");
+    
+    if ((err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+        return srs_error_wrap(err, "write profile");
+    }
+    
+    return err;
+}
+
+SrsGoApiRecorder::SrsGoApiRecorder()
+{
+}
+
+SrsGoApiRecorder::~SrsGoApiRecorder()
+{
+}
+
+srs_error_t SrsGoApiRecorder::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
+    
+    if (!_srs_recorder->enabled()) {
+        return srs_api_response_code(w, r, ERROR_SYSTEM_RECORDER);
+    }
+    
+    std::string data;
+    _srs_recorder->dumps(data);
+    
+    SrsHttpHeader* h = w->header();
+    h->set_content_length(data.length());
+    h->set_content_type("application/octet-stream");
+    
+    if ((err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+        return srs_error_wrap(err, "write recorder");
+    }
+    
+    return err;
+}
+
+SrsGoApiTranscodes::SrsGoApiTranscodes()
+{
+}
+
+SrsGoApiTranscodes::~SrsGoApiTranscodes()
+{
+}
+
+srs_error_t SrsGoApiTranscodes::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::integer(stat->server_id()));
+    
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+    
+    _srs_transcode_scheduler->dumps(data);
+    
+    return srs_api_response(w, r, obj->dumps());
+}
+
+SrsGoApiMetrics::SrsGoApiMetrics()
+{
+}
+
+SrsGoApiMetrics::~SrsGoApiMetrics()
+{
+}
+
+srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+    
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
+    
+    stringstream ss;
+    SrsStatistic::instance()->dumps_metrics(ss);
+    string data = ss.str();
+    
+    SrsHttpHeader* h = w->header();
+    h->set_content_length(data.length());
+    h->set_content_type("text/plain; version=0.0.4");
+    
+    if ((err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+        return srs_error_wrap(err, "write metrics");
+    }
+    
+    return err;
+}
+
 SrsGoApiError::SrsGoApiError()
 {
 }
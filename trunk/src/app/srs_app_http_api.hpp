@@ -31,6 +31,7 @@ class ISrsHttpMessage;
 class SrsHttpParser;
 class SrsHttpHandler;
 class SrsServer;
+class SrsSnapshotService;
 
 #include <srs_app_st.hpp>
 #include <srs_app_conn.hpp>
@@ -92,6 +93,54 @@ public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
+class SrsGoApiDiskIo : public ISrsHttpHandler
+{
+public:
+    SrsGoApiDiskIo();
+    virtual ~SrsGoApiDiskIo();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiAsyncCalls : public ISrsHttpHandler
+{
+public:
+    SrsGoApiAsyncCalls();
+    virtual ~SrsGoApiAsyncCalls();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiFileCache : public ISrsHttpHandler
+{
+public:
+    SrsGoApiFileCache();
+    virtual ~SrsGoApiFileCache();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiUploads : public ISrsHttpHandler
+{
+public:
+    SrsGoApiUploads();
+    virtual ~SrsGoApiUploads();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// Stream the lifecycle events of streams and clients, in server-sent events or JSON lines.
+class SrsGoApiEvents : public ISrsHttpHandler
+{
+public:
+    SrsGoApiEvents();
+    virtual ~SrsGoApiEvents();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    virtual srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
 class SrsGoApiSelfProcStats : public ISrsHttpHandler
 {
 public:
@@ -199,6 +248,132 @@ public:
     virtual ~SrsGoApiClusters();
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    // Serve the event of stream pushed by co-worker, on_publish or on_unpublish.
+    virtual srs_error_t serve_event(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string action);
+};
+
+// For edge, prefetch the streams from origin before players arrive, to fill the gop cache.
+// For example, prefetch a stream by GET:
+//      /api/v1/prefetch?vhost=__defaultVhost__&app=live&stream=s0&idle=300
+// Or a list of streams by POST:
+//      {"vhost":"__defaultVhost__", "app":"live", "streams":["s0","s1"], "idle":300}
+// @remark The idle is in seconds, default to 300s, and 0 to cancel the prefetch.
+class SrsGoApiPrefetch : public ISrsHttpHandler
+{
+private:
+    SrsServer* server;
+public:
+    SrsGoApiPrefetch(SrsServer* svr);
+    virtual ~SrsGoApiPrefetch();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The WebRTC player POSTs the SDP offer and stream url, to create a session and get the SDP answer,
+// for example, {"streamurl":"webrtc://host/app/stream", "sdp":"v=0..."}, @see rtc_server
+class SrsGoApiRtcPlay : public ISrsHttpHandler
+{
+private:
+    SrsServer* server;
+public:
+    SrsGoApiRtcPlay(SrsServer* svr);
+    virtual ~SrsGoApiRtcPlay();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The keyframe snapshot of stream, the FLV snippet or JPEG of the latest keyframe in gop cache.
+class SrsGoApiSnapshots : public ISrsHttpHandler
+{
+private:
+    SrsSnapshotService* service;
+public:
+    SrsGoApiSnapshots();
+    virtual ~SrsGoApiSnapshots();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiDns : public ISrsHttpHandler
+{
+public:
+    SrsGoApiDns();
+    virtual ~SrsGoApiDns();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The memory held by each subsystem, and the budget of each connection, which is the stacks of coroutines,
+// the recv buffers, the queues of consumers, the caches of RTMP protocol and the objects of statistic.
+class SrsGoApiMemory : public ISrsHttpHandler
+{
+private:
+    SrsServer* server;
+public:
+    SrsGoApiMemory(SrsServer* svr);
+    virtual ~SrsGoApiMemory();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiStacks : public ISrsHttpHandler
+{
+public:
+    SrsGoApiStacks();
+    virtual ~SrsGoApiStacks();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The profile of ST scheduler, the delay of run queue and cpu of coroutines.
+class SrsGoApiScheduler : public ISrsHttpHandler
+{
+public:
+    SrsGoApiScheduler();
+    virtual ~SrsGoApiScheduler();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The CPU profile by sampling, which blocks for the seconds, then responses the folded stacks for flame graph.
+class SrsGoApiProfile : public ISrsHttpHandler
+{
+public:
+    SrsGoApiProfile();
+    virtual ~SrsGoApiProfile();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// Dump the events of flight recorder in binary, @see SrsFlightRecorder
+class SrsGoApiRecorder : public ISrsHttpHandler
+{
+public:
+    SrsGoApiRecorder();
+    virtual ~SrsGoApiRecorder();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The utilization of slots and the queue of transcode scheduler.
+class SrsGoApiTranscodes : public ISrsHttpHandler
+{
+public:
+    SrsGoApiTranscodes();
+    virtual ~SrsGoApiTranscodes();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The metrics in text exposition format of prometheus, @see https://prometheus.io/docs/instrumenting/exposition_formats/
+class SrsGoApiMetrics : public ISrsHttpHandler
+{
+public:
+    SrsGoApiMetrics();
+    virtual ~SrsGoApiMetrics();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
 class SrsGoApiError : public ISrsHttpHandler
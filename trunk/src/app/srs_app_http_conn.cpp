@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <sstream>
 using namespace std;
@@ -58,10 +59,162 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_st.hpp>
+#include <srs_app_http2.hpp>
+#include <srs_kernel_stream.hpp>
+
+// The timeout to drop the bytes sent by client, when serving HTTP stream.
+#define SRS_HTTP_DRAIN_TIMEOUT (100 * SRS_UTIME_MILLISECONDS)
+
+SrsHttpPipelineWriter::SrsHttpPipelineWriter(SrsStSocket* s)
+{
+    skt = s;
+    corked = false;
+    queue = new SrsSimpleStream();
+    nn_flushes = 0;
+}
+
+SrsHttpPipelineWriter::~SrsHttpPipelineWriter()
+{
+    srs_freep(queue);
+}
+
+void SrsHttpPipelineWriter::cork()
+{
+    corked = true;
+}
+
+srs_error_t SrsHttpPipelineWriter::uncork()
+{
+    corked = false;
+    return flush();
+}
+
+srs_error_t SrsHttpPipelineWriter::flush()
+{
+    srs_error_t err = srs_success;
+    
+    int size = queue->length();
+    if (size <= 0) {
+        return err;
+    }
+    
+    // Clear the queue even when error, for the connection is closed.
+    err = skt->write(queue->bytes(), size, NULL);
+    queue->erase(size);
+    nn_flushes++;
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write %d bytes, flushes=%" PRId64, size, nn_flushes);
+    }
+    
+    return err;
+}
+
+void SrsHttpPipelineWriter::set_recv_timeout(srs_utime_t tm)
+{
+    skt->set_recv_timeout(tm);
+}
+
+srs_utime_t SrsHttpPipelineWriter::get_recv_timeout()
+{
+    return skt->get_recv_timeout();
+}
+
+srs_error_t SrsHttpPipelineWriter::read_fully(void* buf, size_t size, ssize_t* nread)
+{
+    return skt->read_fully(buf, size, nread);
+}
+
+srs_error_t SrsHttpPipelineWriter::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    return skt->readv(iov, iov_size, nread);
+}
+
+srs_error_t SrsHttpPipelineWriter::read(void* buf, size_t size, ssize_t* nread)
+{
+    return skt->read(buf, size, nread);
+}
+
+void SrsHttpPipelineWriter::set_send_timeout(srs_utime_t tm)
+{
+    skt->set_send_timeout(tm);
+}
+
+srs_utime_t SrsHttpPipelineWriter::get_send_timeout()
+{
+    return skt->get_send_timeout();
+}
+
+int64_t SrsHttpPipelineWriter::get_recv_bytes()
+{
+    return skt->get_recv_bytes();
+}
+
+int64_t SrsHttpPipelineWriter::get_send_bytes()
+{
+    return skt->get_send_bytes();
+}
+
+srs_error_t SrsHttpPipelineWriter::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = size;
+    return writev(&iov, 1, nwrite);
+}
+
+srs_error_t SrsHttpPipelineWriter::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+    
+    if (!corked) {
+        return skt->writev(iov, iov_size, nwrite);
+    }
+    
+    size_t size = 0;
+    for (int i = 0; i < iov_size; i++) {
+        size += iov[i].iov_len;
+    }
+    
+    // Send the queued responses first, when the queue is full.
+    if (queue->length() + size > SRS_HTTP_PIPELINE_BUFFER) {
+        if ((err = flush()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+    }
+    
+    // Directly send the large response, for example, the ts segment.
+    if (size > SRS_HTTP_PIPELINE_BUFFER) {
+        return skt->writev(iov, iov_size, nwrite);
+    }
+    
+    for (int i = 0; i < iov_size; i++) {
+        queue->append((const char*)iov[i].iov_base, (int)iov[i].iov_len);
+    }
+    
+    if (nwrite) {
+        *nwrite = size;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttpPipelineWriter::sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+    
+    // The header of response is queued, which must be sent before the file.
+    if ((err = flush()) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+    
+    return skt->sendfile(fd, offset, count, nwrite);
+}
 
 SrsHttpConn::SrsHttpConn(IConnectionManager* cm, srs_netfd_t fd, ISrsHttpServeMux* m, string cip) : SrsConnection(cm, fd, cip)
 {
     parser = new SrsHttpParser();
+    pipeline = new SrsHttpPipelineWriter(skt);
     cors = new SrsHttpCorsMux();
     http_mux = m;
 }
@@ -70,6 +223,7 @@ SrsHttpConn::~SrsHttpConn()
 {
     srs_freep(parser);
     srs_freep(cors);
+    srs_freep(pipeline);
 }
 
 void SrsHttpConn::remark(int64_t* in, int64_t* out)
@@ -99,6 +253,23 @@ srs_error_t SrsHttpConn::do_cycle()
         return srs_error_wrap(err, "init cors");
     }
     
+    // Detect the HTTP/2 by the preface of client, or replay the bytes to parse the HTTP/1.1 request.
+    SrsHttp2PrefaceReader preface(skt);
+    if (is_http2_enabled()) {
+        bool h2 = false;
+        if ((err = preface.detect(h2)) != srs_success) {
+            return srs_error_wrap(err, "detect http2");
+        }
+        
+        if (h2) {
+            SrsHttp2Conn conn(this, skt, cors, trd, _srs_config->get_http_stream_http2_max_streams());
+            if ((err = conn.cycle()) != srs_success) {
+                return srs_error_wrap(err, "http2");
+            }
+            return err;
+        }
+    }
+    
     // process http messages.
     for (int req_id = 0; (err = trd->pull()) == srs_success; req_id++) {
         // Try to receive a message from http.
@@ -106,7 +277,7 @@ srs_error_t SrsHttpConn::do_cycle()
 
         // get a http message
         ISrsHttpMessage* req = NULL;
-        if ((err = parser->parse_message(skt, &req)) != srs_success) {
+        if ((err = parser->parse_message(&preface, &req)) != srs_success) {
             break;
         }
         
@@ -128,12 +299,23 @@ srs_error_t SrsHttpConn::do_cycle()
             break;
         }
         
+        // Queue the response when the next request is already buffered, to send them in one write.
+        bool pipelined = req->is_keep_alive() && parser->pipelined();
+        if (pipelined) {
+            pipeline->cork();
+        }
+        
         // ok, handle http request.
-        SrsHttpResponseWriter writer(skt);
+        SrsHttpResponseWriter writer(pipeline);
         if ((err = process_request(&writer, req)) != srs_success) {
             break;
         }
         
+        // Send the queued responses, before waiting for the next request.
+        if (!pipelined && (err = pipeline->uncork()) != srs_success) {
+            break;
+        }
+        
         // donot keep alive, disconnect it.
         // @see https://github.com/ossrs/srs/issues/399
         if (!req->is_keep_alive()) {
@@ -141,6 +323,10 @@ srs_error_t SrsHttpConn::do_cycle()
         }
     }
     
+    // Send the queued responses, even when the last request failed.
+    srs_error_t r1 = pipeline->uncork();
+    srs_freep(r1);
+    
     srs_error_t r0 = srs_success;
     if ((r0 = on_disconnect(last_req)) != srs_success) {
         err = srs_error_wrap(err, "on disconnect %s", srs_error_desc(r0).c_str());
@@ -165,6 +351,11 @@ srs_error_t SrsHttpConn::process_request(ISrsHttpResponseWriter* w, ISrsHttpMess
     return err;
 }
 
+bool SrsHttpConn::is_http2_enabled()
+{
+    return false;
+}
+
 srs_error_t SrsHttpConn::on_disconnect(SrsRequest* req)
 {
     // TODO: FIXME: Implements it.
@@ -193,33 +384,24 @@ SrsResponseOnlyHttpConn::~SrsResponseOnlyHttpConn()
 {
 }
 
-srs_error_t SrsResponseOnlyHttpConn::pop_message(ISrsHttpMessage** preq)
+srs_error_t SrsResponseOnlyHttpConn::drain()
 {
     srs_error_t err = srs_success;
     
-    SrsStSocket skt;
-
-    if ((err = skt.initialize(stfd)) != srs_success) {
-        return srs_error_wrap(err, "init socket");
-    }
-
-    // Check user interrupt by interval.
-    skt.set_recv_timeout(3 * SRS_UTIME_SECONDS);
-
-    // drop all request body.
+    // Read by the socket of connection, which may be over TLS, only when readable.
+    // The readable TLS may be a partial record, so the read is bounded by a small timeout, to
+    // never block the serving loop.
+    skt->set_recv_timeout(SRS_HTTP_DRAIN_TIMEOUT);
+    
     char body[4096];
-    while (true) {
-        if ((err = trd->pull()) != srs_success) {
-            return srs_error_wrap(err, "timeout");
-        }
-
-        if ((err = skt.read(body, 4096, NULL)) != srs_success) {
-            // Because we use timeout to check trd state, so we should ignore any timeout.
+    while (skt->readable()) {
+        if ((err = skt->read(body, sizeof(body), NULL)) != srs_success) {
+            // Not an entire record yet, try again in next loop.
             if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
                 srs_freep(err);
-                continue;
+                return srs_success;
             }
-
+            
             return srs_error_wrap(err, "read response");
         }
     }
@@ -227,6 +409,36 @@ srs_error_t SrsResponseOnlyHttpConn::pop_message(ISrsHttpMessage** preq)
     return err;
 }
 
+ISrsProtocolReadWriter* SrsResponseOnlyHttpConn::hijack()
+{
+    // The queued responses must be sent before the hijacked writes.
+    srs_error_t err = pipeline->uncork();
+    if (err != srs_success) {
+        srs_warn("hijack: ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    return skt;
+}
+
+int SrsResponseOnlyHttpConn::dup_fd()
+{
+    // The TLS record is encrypted by the session of connection, which can not be written by others.
+    if (tls) {
+        return -1;
+    }
+    
+    // The queued responses must be sent before the writes of others.
+    srs_error_t err = pipeline->uncork();
+    if (err != srs_success) {
+        srs_warn("dup: ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return -1;
+    }
+    
+    return ::dup(srs_netfd_fileno(stfd));
+}
+
 srs_error_t SrsResponseOnlyHttpConn::on_got_http_message(ISrsHttpMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -249,6 +461,11 @@ srs_error_t SrsResponseOnlyHttpConn::on_got_http_message(ISrsHttpMessage* msg)
     return err;
 }
 
+bool SrsResponseOnlyHttpConn::is_http2_enabled()
+{
+    return _srs_config->get_http_stream_http2();
+}
+
 void SrsResponseOnlyHttpConn::expire()
 {
     SrsHttpConn::expire();
@@ -54,12 +54,58 @@ class SrsConnection;
 class SrsHttpMessage;
 class SrsHttpStreamServer;
 class SrsHttpStaticServer;
+class SrsSimpleStream;
+
+// The max bytes of responses to queue for pipelined requests, the larger response is sent directly.
+#define SRS_HTTP_PIPELINE_BUFFER (64 * 1024)
+
+// The writer for pipelined requests, which queues the responses when corked, and sends them in one
+// write when uncorked, for example, the small playlists of HLS requested by a CDN in pipeline.
+// @remark It's not corked by default, then it writes to socket directly.
+class SrsHttpPipelineWriter : public ISrsProtocolReadWriter, public ISrsSendfileWriter
+{
+private:
+    SrsStSocket* skt;
+    bool corked;
+    // The bytes of queued responses.
+    SrsSimpleStream* queue;
+    // The number of responses sent by the pipeline.
+    int64_t nn_flushes;
+public:
+    SrsHttpPipelineWriter(SrsStSocket* s);
+    virtual ~SrsHttpPipelineWriter();
+public:
+    // Queue the responses, until uncork.
+    virtual void cork();
+    // Send the queued responses, and write directly.
+    virtual srs_error_t uncork();
+private:
+    virtual srs_error_t flush();
+// Interface ISrsProtocolReadWriter
+public:
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual srs_utime_t get_recv_timeout();
+    virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread);
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+    virtual void set_send_timeout(srs_utime_t tm);
+    virtual srs_utime_t get_send_timeout();
+    virtual int64_t get_recv_bytes();
+    virtual int64_t get_send_bytes();
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+    virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsSendfileWriter
+public:
+    virtual srs_error_t sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite);
+};
 
 // The http connection which request the static or stream content.
 class SrsHttpConn : public SrsConnection
 {
 protected:
     SrsHttpParser* parser;
+    // The writer of responses, which queues the responses of pipelined requests.
+    SrsHttpPipelineWriter* pipeline;
     ISrsHttpServeMux* http_mux;
     SrsHttpCorsMux* cors;
 public:
@@ -75,6 +121,8 @@ protected:
     // for the static service or api, discard any body.
     // for the stream caster, for instance, http flv streaming, may discard the flv header or not.
     virtual srs_error_t on_got_http_message(ISrsHttpMessage* msg) = 0;
+    // Whether serve the client by HTTP/2, when got the preface.
+    virtual bool is_http2_enabled();
 private:
     virtual srs_error_t process_request(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
     // When the connection disconnect, call this method.
@@ -93,14 +141,20 @@ public:
     SrsResponseOnlyHttpConn(IConnectionManager* cm, srs_netfd_t fd, ISrsHttpServeMux* m, std::string cip);
     virtual ~SrsResponseOnlyHttpConn();
 public:
-    // Directly read a HTTP request message.
+    // Drop the bytes sent by client without blocking, and fail when client closed the FD.
     // It's exported for HTTP stream, such as HTTP FLV, only need to write to client when
-    // serving it, but we need to start a thread to read message to detect whether FD is closed.
+    // serving it, but we need to check in the serving loop whether FD is closed.
     // @see https://github.com/ossrs/srs/issues/636#issuecomment-298208427
     // @remark Should only used in HTTP-FLV streaming connection.
-    virtual srs_error_t pop_message(ISrsHttpMessage** preq);
+    virtual srs_error_t drain();
+    // Hijack the socket to write directly, for example, the frames of WebSocket after upgrade.
+    virtual ISrsProtocolReadWriter* hijack();
+    // Duplicate the fd of socket, for other thread to write directly, -1 if over TLS or failed.
+    virtual int dup_fd();
 public:
     virtual srs_error_t on_got_http_message(ISrsHttpMessage* msg);
+protected:
+    virtual bool is_http2_enabled();
 public:
     // Set connection to expired.
     virtual void expire();
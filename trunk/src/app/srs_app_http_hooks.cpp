@@ -38,6 +38,9 @@ using namespace std;
 #include <srs_app_http_conn.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_kernel_recorder.hpp>
 
 #define SRS_HTTP_RESPONSE_OK    SRS_XSTR(ERROR_SUCCESS)
 
@@ -57,6 +60,16 @@ SrsHttpHooks::~SrsHttpHooks()
 }
 
 srs_error_t SrsHttpHooks::on_connect(string url, SrsRequest* req)
+{
+    srs_utime_t ttl = _srs_config->get_vhost_http_hooks_cache_ttl(req->vhost);
+    if (ttl > 0) {
+        return SrsHttpHooksCache::instance()->call("on_connect", url, req, ttl, do_on_connect);
+    }
+    
+    return do_on_connect(url, req);
+}
+
+srs_error_t SrsHttpHooks::do_on_connect(string url, SrsRequest* req)
 {
     srs_error_t err = srs_success;
     
@@ -107,6 +120,18 @@ void SrsHttpHooks::on_close(string url, SrsRequest* req, int64_t send_bytes, int
     obj->set("recv_bytes", SrsJsonAny::integer(recv_bytes));
     
     std::string data = obj->dumps();
+    
+    // Post the events in batch, to reduce the callbacks to api server.
+    srs_utime_t interval = _srs_config->get_vhost_http_hooks_batch_interval(req->vhost);
+    if (interval > 0) {
+        if ((err = SrsHttpHooksBatch::instance()->append(url, data, interval)) != srs_success) {
+            srs_warn("http: ignore on_close batch failed, client_id=%d, url=%s, request=%s, err=%s",
+                client_id, url.c_str(), data.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        return;
+    }
+    
     std::string res;
     int status_code;
     
@@ -196,6 +221,16 @@ void SrsHttpHooks::on_unpublish(string url, SrsRequest* req)
 }
 
 srs_error_t SrsHttpHooks::on_play(string url, SrsRequest* req)
+{
+    srs_utime_t ttl = _srs_config->get_vhost_http_hooks_cache_ttl(req->vhost);
+    if (ttl > 0) {
+        return SrsHttpHooksCache::instance()->call("on_play", url, req, ttl, do_on_play);
+    }
+    
+    return do_on_play(url, req);
+}
+
+srs_error_t SrsHttpHooks::do_on_play(string url, SrsRequest* req)
 {
     srs_error_t err = srs_success;
     
@@ -247,6 +282,18 @@ void SrsHttpHooks::on_stop(string url, SrsRequest* req)
     obj->set("param", SrsJsonAny::str(req->param.c_str()));
     
     std::string data = obj->dumps();
+    
+    // Post the events in batch, to reduce the callbacks to api server.
+    srs_utime_t interval = _srs_config->get_vhost_http_hooks_batch_interval(req->vhost);
+    if (interval > 0) {
+        if ((err = SrsHttpHooksBatch::instance()->append(url, data, interval)) != srs_success) {
+            srs_warn("http: ignore on_stop batch failed, client_id=%d, url=%s, request=%s, err=%s",
+                client_id, url.c_str(), data.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        return;
+    }
+    
     std::string res;
     int status_code;
     
@@ -363,7 +410,7 @@ srs_error_t SrsHttpHooks::on_hls_notify(int cid, std::string url, SrsRequest* re
     url = srs_string_replace(url, "[ts_url]", ts_url);
     url = srs_string_replace(url, "[param]", req->param);
     
-    int64_t starttime = srsu2ms(srs_update_system_time());
+    int64_t starttime = srsu2ms(srs_update_monotonic_time());
     
     SrsHttpUri uri;
     if ((err = uri.initialize(url)) != srs_success) {
@@ -405,7 +452,7 @@ srs_error_t SrsHttpHooks::on_hls_notify(int cid, std::string url, SrsRequest* re
         nb_read += (int)nb_bytes;
     }
     
-    int spenttime = (int)(srsu2ms(srs_update_system_time()) - starttime);
+    int spenttime = (int)(srsu2ms(srs_update_monotonic_time()) - starttime);
     srs_trace("http hook on_hls_notify success. client_id=%d, url=%s, code=%d, spent=%dms, read=%dB, err=%s",
         client_id, url.c_str(), msg->status_code(), spenttime, nb_read, srs_error_desc(err).c_str());
     
@@ -469,7 +516,32 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
     return err;
 }
 
+srs_error_t SrsHttpHooks::notify_co_workers(string url)
+{
+    srs_error_t err = srs_success;
+    
+    std::string res;
+    int status_code;
+    
+    SrsHttpClient http;
+    if ((err = do_post(&http, url, "", status_code, res)) != srs_success) {
+        return srs_error_wrap(err, "http: post %s, status=%d, res=%s", url.c_str(), status_code, res.c_str());
+    }
+    
+    srs_info("http: cluster notify ok, url=%s, response=%s", url.c_str(), res.c_str());
+    
+    return err;
+}
+
 srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, string& res)
+{
+    srs_utime_t starttime = _srs_recorder->begin();
+    srs_error_t err = do_post_imp(hc, url, req, code, res);
+    _srs_recorder->end(SrsRecorderEventHook, starttime, srs_error_code(err));
+    return err;
+}
+
+srs_error_t SrsHttpHooks::do_post_imp(SrsHttpClient* hc, std::string url, std::string req, int& code, string& res)
 {
     srs_error_t err = srs_success;
     
@@ -478,6 +550,8 @@ srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::strin
         return srs_error_wrap(err, "http: post failed. url=%s", url.c_str());
     }
     
+    // Reuse the keep-alive connection to the callback server, the body is always read.
+    hc->set_pool(SrsHttpClientPool::instance());
     if ((err = hc->initialize(uri.get_host(), uri.get_port())) != srs_success) {
         return srs_error_wrap(err, "http: init client");
     }
@@ -537,3 +611,312 @@ srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::strin
     
     return err;
 }
+
+SrsHttpHooksCache* SrsHttpHooksCache::_instance = NULL;
+
+SrsHttpHooksCache::SrsHttpHooksCache()
+{
+    nn_hits = nn_coalesced = nn_misses = 0;
+}
+
+SrsHttpHooksCache::~SrsHttpHooksCache()
+{
+    std::map<std::string, SrsHttpHooksDecision*>::iterator it;
+    for (it = decisions.begin(); it != decisions.end(); ++it) {
+        SrsHttpHooksDecision* d = it->second;
+        srs_cond_destroy(d->cond);
+        srs_freep(d);
+    }
+    decisions.clear();
+}
+
+SrsHttpHooksCache* SrsHttpHooksCache::instance()
+{
+    if (!_instance) {
+        _instance = new SrsHttpHooksCache();
+    }
+    return _instance;
+}
+
+srs_error_t SrsHttpHooksCache::call(string action, string url, SrsRequest* req, srs_utime_t ttl, SrsHttpHooksHandler handler)
+{
+    srs_error_t err = srs_success;
+    
+    string key = key_of(action, url, req);
+    
+    SrsHttpHooksDecision* d = NULL;
+    std::map<std::string, SrsHttpHooksDecision*>::iterator it = decisions.find(key);
+    if (it != decisions.end()) {
+        d = it->second;
+    }
+    
+    // Wait for the in-flight callback of the same key, and share its decision.
+    if (d && d->pending) {
+        nn_coalesced++;
+        
+        d->nn_waiters++;
+        while (d->pending) {
+            if (srs_cond_wait(d->cond) != 0) {
+                d->nn_waiters--;
+                return srs_error_new(ERROR_HTTP_HOOKS_INTERRUPTED, "http: %s interrupted, key=%s", action.c_str(), key.c_str());
+            }
+        }
+        d->nn_waiters--;
+        
+        if (d->code != ERROR_SUCCESS) {
+            return srs_error_new(d->code, "http: %s coalesced, key=%s", action.c_str(), key.c_str());
+        }
+        srs_trace("http: %s coalesced ok, key=%s", action.c_str(), key.c_str());
+        return err;
+    }
+    
+    // Use the cached decision.
+    if (d && d->expire > srs_get_monotonic_time()) {
+        nn_hits++;
+        
+        if (d->code != ERROR_SUCCESS) {
+            return srs_error_new(d->code, "http: %s cached, key=%s", action.c_str(), key.c_str());
+        }
+        srs_trace("http: %s cached ok, key=%s", action.c_str(), key.c_str());
+        return err;
+    }
+    
+    if (!d) {
+        shrink();
+        
+        d = new SrsHttpHooksDecision();
+        d->nn_waiters = 0;
+        d->cond = srs_cond_new();
+        decisions[key] = d;
+    }
+    nn_misses++;
+    
+    // Callback the api server, the requests of same key will wait for it.
+    d->pending = true;
+    err = handler(url, req);
+    d->pending = false;
+    
+    d->code = srs_error_code(err);
+    d->expire = is_decision(err)? srs_get_monotonic_time() + ttl : 0;
+    srs_cond_broadcast(d->cond);
+    
+    return err;
+}
+
+string SrsHttpHooksCache::key_of(string action, string url, SrsRequest* req)
+{
+    // The param is in the format of ?k0=v0&k1=v1
+    string param = req->param;
+    if (!param.empty() && param.at(0) == '?') {
+        param = param.substr(1);
+    }
+    
+    std::map<std::string, std::string> query;
+    srs_parse_query_string(param, query);
+    
+    std::stringstream ss;
+    ss << action << "|" << url << "|" << req->ip << "|" << req->vhost
+        << "|" << req->app << "|" << req->stream << "|" << query["token"];
+    return ss.str();
+}
+
+int64_t SrsHttpHooksCache::hits()
+{
+    return nn_hits;
+}
+
+int64_t SrsHttpHooksCache::coalesced()
+{
+    return nn_coalesced;
+}
+
+int64_t SrsHttpHooksCache::misses()
+{
+    return nn_misses;
+}
+
+bool SrsHttpHooksCache::is_decision(srs_error_t err)
+{
+    int code = srs_error_code(err);
+    return code == ERROR_SUCCESS || code == ERROR_HTTP_STATUS_INVALID
+        || code == ERROR_HTTP_DATA_INVALID || code == ERROR_RESPONSE_CODE;
+}
+
+void SrsHttpHooksCache::shrink()
+{
+    if ((int)decisions.size() < SRS_HOOKS_CACHE_MAX) {
+        return;
+    }
+    
+    srs_utime_t now = srs_get_monotonic_time();
+    
+    std::map<std::string, SrsHttpHooksDecision*>::iterator it;
+    for (it = decisions.begin(); it != decisions.end();) {
+        SrsHttpHooksDecision* d = it->second;
+        
+        // The decision is in use.
+        if (d->pending || d->nn_waiters > 0 || d->expire > now) {
+            ++it;
+            continue;
+        }
+        
+        srs_cond_destroy(d->cond);
+        srs_freep(d);
+        decisions.erase(it++);
+    }
+}
+
+SrsHttpHooksBatch* SrsHttpHooksBatch::_instance = NULL;
+
+SrsHttpHooksBatch::SrsHttpHooksBatch()
+{
+    trd = NULL;
+    cond = srs_cond_new();
+}
+
+SrsHttpHooksBatch::~SrsHttpHooksBatch()
+{
+    srs_freep(trd);
+    
+    std::map<std::string, SrsHttpHooksEvents*>::iterator it;
+    for (it = queues.begin(); it != queues.end(); ++it) {
+        SrsHttpHooksEvents* q = it->second;
+        srs_freep(q);
+    }
+    queues.clear();
+    
+    srs_cond_destroy(cond);
+}
+
+SrsHttpHooksBatch* SrsHttpHooksBatch::instance()
+{
+    if (!_instance) {
+        _instance = new SrsHttpHooksBatch();
+    }
+    return _instance;
+}
+
+srs_error_t SrsHttpHooksBatch::append(string url, string data, srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+    
+    // Start the coroutine to post events when first used.
+    if (!trd) {
+        SrsSTCoroutine* st = new SrsSTCoroutine("hooks-batch", this);
+        st->set_stack_size(SRS_PERF_STACK_HOOKS);
+        trd = st;
+        if ((err = trd->start()) != srs_success) {
+            srs_freep(trd);
+            return srs_error_wrap(err, "start coroutine");
+        }
+    }
+    
+    SrsHttpHooksEvents* q = NULL;
+    std::map<std::string, SrsHttpHooksEvents*>::iterator it = queues.find(url);
+    if (it != queues.end()) {
+        q = it->second;
+    } else {
+        q = new SrsHttpHooksEvents();
+        q->flush_at = srs_get_monotonic_time() + interval;
+        queues[url] = q;
+    }
+    
+    q->events.push_back(data);
+    srs_cond_signal(cond);
+    
+    return err;
+}
+
+void SrsHttpHooksBatch::flush(bool force)
+{
+    srs_utime_t now = srs_get_monotonic_time();
+    
+    // Pick the events out, because the queues may change when posting.
+    std::vector<std::string> urls;
+    std::vector<SrsHttpHooksEvents*> picks;
+    
+    std::map<std::string, SrsHttpHooksEvents*>::iterator it;
+    for (it = queues.begin(); it != queues.end();) {
+        SrsHttpHooksEvents* q = it->second;
+        if (!force && q->flush_at > now) {
+            ++it;
+            continue;
+        }
+        
+        urls.push_back(it->first);
+        picks.push_back(q);
+        queues.erase(it++);
+    }
+    
+    for (int i = 0; i < (int)picks.size(); i++) {
+        SrsHttpHooksEvents* q = picks.at(i);
+        do_flush(urls.at(i), q->events);
+        srs_freep(q);
+    }
+}
+
+srs_error_t SrsHttpHooksBatch::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "hooks batch");
+        }
+        
+        if (queues.empty()) {
+            srs_cond_wait(cond);
+            continue;
+        }
+        
+        flush(false);
+        
+        // Wait for the earliest events to post, or new events.
+        srs_utime_t now = srs_get_monotonic_time();
+        srs_utime_t earliest = 0;
+        
+        std::map<std::string, SrsHttpHooksEvents*>::iterator it;
+        for (it = queues.begin(); it != queues.end(); ++it) {
+            SrsHttpHooksEvents* q = it->second;
+            if (!earliest || q->flush_at < earliest) {
+                earliest = q->flush_at;
+            }
+        }
+        
+        if (earliest > now) {
+            srs_usleep(earliest - now);
+        }
+    }
+    
+    return err;
+}
+
+void SrsHttpHooksBatch::do_flush(string url, std::vector<std::string>& events)
+{
+    srs_error_t err = srs_success;
+    
+    std::stringstream ss;
+    ss << "[";
+    for (int i = 0; i < (int)events.size(); i++) {
+        if (i > 0) {
+            ss << ",";
+        }
+        ss << events.at(i);
+    }
+    ss << "]";
+    
+    std::string data = ss.str();
+    std::string res;
+    int status_code = 0;
+    
+    SrsHttpClient http;
+    if ((err = SrsHttpHooks::do_post(&http, url, data, status_code, res)) != srs_success) {
+        int ret = srs_error_code(err);
+        srs_freep(err);
+        srs_warn("http: ignore batch failed, url=%s, events=%d, response=%s, code=%d, ret=%d",
+            url.c_str(), (int)events.size(), res.c_str(), status_code, ret);
+        return;
+    }
+    
+    srs_trace("http: batch ok, url=%s, events=%d, response=%s", url.c_str(), (int)events.size(), res.c_str());
+}
@@ -27,6 +27,10 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <vector>
+
+#include <srs_app_st.hpp>
 
 class SrsHttpUri;
 class SrsStSocket;
@@ -34,6 +38,9 @@ class SrsRequest;
 class SrsHttpParser;
 class SrsHttpClient;
 
+// The max number of decisions to cache, expired ones are removed when exceed it.
+#define SRS_HOOKS_CACHE_MAX 10000
+
 // the http hooks, http callback api,
 // for some event, such as on_connect, call
 // a http api(hooks).
@@ -96,8 +103,103 @@ public:
     static srs_error_t on_hls_notify(int cid, std::string url, SrsRequest* req, std::string ts_url, int nb_notify);
     // Discover co-workers for origin cluster.
     static srs_error_t discover_co_workers(std::string url, std::string& host, int& port);
+    // Notify co-workers the event of stream, for origin cluster.
+    static srs_error_t notify_co_workers(std::string url);
 private:
+    static srs_error_t do_on_connect(std::string url, SrsRequest* req);
+    static srs_error_t do_on_play(std::string url, SrsRequest* req);
+    // Post to the hook, and record to flight recorder when it takes long.
     static srs_error_t do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, std::string& res);
+    static srs_error_t do_post_imp(SrsHttpClient* hc, std::string url, std::string req, int& code, std::string& res);
+    friend class SrsHttpHooksBatch;
+};
+
+// The hook to call when the decision is not cached.
+typedef srs_error_t (*SrsHttpHooksHandler)(std::string url, SrsRequest* req);
+
+// The decision of on_connect or on_play responded by the api server.
+struct SrsHttpHooksDecision
+{
+    // Whether the callback is in flight, the requests of same key wait for it.
+    bool pending;
+    // The error code of callback, ERROR_SUCCESS to allow the client.
+    int code;
+    // The decision is valid before expire, 0 for not cached.
+    srs_utime_t expire;
+    // The number of requests waiting for the pending callback.
+    int nn_waiters;
+    srs_cond_t cond;
+};
+
+// The TTL cache for decisions of on_connect and on_play, keyed by (ip, vhost, app, stream, token),
+// and the concurrent requests of same key share one callback to api server, that is single-flight.
+// @remark Only the decision responded by api server is cached, never cache the network error.
+class SrsHttpHooksCache
+{
+private:
+    static SrsHttpHooksCache* _instance;
+private:
+    std::map<std::string, SrsHttpHooksDecision*> decisions;
+    int64_t nn_hits;
+    int64_t nn_coalesced;
+    int64_t nn_misses;
+public:
+    SrsHttpHooksCache();
+    virtual ~SrsHttpHooksCache();
+public:
+    static SrsHttpHooksCache* instance();
+public:
+    // Get the decision from cache, or callback by handler and cache it in ttl.
+    virtual srs_error_t call(std::string action, std::string url, SrsRequest* req, srs_utime_t ttl, SrsHttpHooksHandler handler);
+    // Build the cache key of request.
+    static std::string key_of(std::string action, std::string url, SrsRequest* req);
+public:
+    virtual int64_t hits();
+    virtual int64_t coalesced();
+    virtual int64_t misses();
+private:
+    // Whether the error is the decision of api server, not the network error.
+    virtual bool is_decision(srs_error_t err);
+    // Remove the expired decisions when too many.
+    virtual void shrink();
+};
+
+// The events of an api server to post in batch.
+struct SrsHttpHooksEvents
+{
+    // The json objects to post as a json array.
+    std::vector<std::string> events;
+    // When to post the events.
+    srs_utime_t flush_at;
+};
+
+// The batch for on_close and on_stop events, which post a json array
+// of events to the api server per interval.
+class SrsHttpHooksBatch : public ISrsCoroutineHandler
+{
+private:
+    static SrsHttpHooksBatch* _instance;
+private:
+    SrsCoroutine* trd;
+    srs_cond_t cond;
+    // The events to post, key is the url of api server.
+    std::map<std::string, SrsHttpHooksEvents*> queues;
+public:
+    SrsHttpHooksBatch();
+    virtual ~SrsHttpHooksBatch();
+public:
+    static SrsHttpHooksBatch* instance();
+public:
+    // Append an event in json to post to url, which is posted in interval.
+    virtual srs_error_t append(std::string url, std::string data, srs_utime_t interval);
+    // Post all events which are due to post.
+    // @param force Whether post all events now.
+    virtual void flush(bool force);
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual void do_flush(std::string url, std::vector<std::string>& events);
 };
 
 #endif
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_protocol_stream.hpp>
@@ -47,16 +48,2042 @@ using namespace std;
 #include <srs_kernel_aac.hpp>
 #include <srs_kernel_mp3.hpp>
 #include <srs_kernel_ts.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_buffer.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_dash.hpp>
+#include <srs_app_edge.hpp>
+#include <srs_kernel_balance.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_service_st.hpp>
+#include <srs_protocol_json.hpp>
 
-SrsVodStream::SrsVodStream(string root_dir) : SrsHttpFileServer(root_dir)
+// The max time to wait for the LL-HLS preload hint part.
+#define SRS_HLS_HINT_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The max time to serve a growing DASH segment, and the interval to check the file size.
+#define SRS_DASH_GROWING_TIMEOUT (60 * SRS_UTIME_SECONDS)
+#define SRS_DASH_GROWING_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+
+// The ttl of file meta, for the file changed by others, the playlist is updated frequently.
+#define SRS_HTTP_FILE_META_PLAYLIST_TTL (1 * SRS_UTIME_SECONDS)
+#define SRS_HTTP_FILE_META_SEGMENT_TTL (30 * SRS_UTIME_SECONDS)
+// The max number of file meta, all are dropped when exceed it.
+#define SRS_HTTP_FILE_META_MAX 8192
+
+// The buffer to read the cached file, when sendfile is disabled.
+#define SRS_HTTP_FILE_CACHE_BUFFER_SIZE (64 * 1024)
+
+// The timeout to fetch the hls file from origin for edge, and to wait for the fetching.
+#define SRS_HLS_PROXY_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The ttl of ts proxied from origin, which is immutable, so cached for the hls window.
+#define SRS_HLS_PROXY_SEGMENT_TTL (60 * SRS_UTIME_SECONDS)
+// The interval to cleanup the expired files proxied from origin.
+#define SRS_HLS_PROXY_CLEANUP_INTERVAL (1 * SRS_UTIME_SECONDS)
+
+// Get the mtime in us of file, to identify the file rewritten in the same second.
+int64_t srs_stat_mtime(struct stat& st)
+{
+#ifdef SRS_AUTO_OSX
+    return (int64_t)st.st_mtimespec.tv_sec * 1000000 + st.st_mtimespec.tv_nsec / 1000;
+#else
+    return (int64_t)st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+#endif
+}
+
+SrsFlvVodIndex::SrsFlvVodIndex()
+{
+    mtime = 0;
+    size = 0;
+    memset(header, 0, sizeof(header));
+    data_offset = 0;
+}
+
+SrsFlvVodIndex::~SrsFlvVodIndex()
+{
+}
+
+srs_error_t SrsFlvVodIndex::initialize(string fullpath, SrsFileReader* fs)
+{
+    srs_error_t err = srs_success;
+    
+    path = fullpath;
+    size = fs->filesize();
+    
+    SrsFlvVodStreamDecoder ffd;
+    if ((err = ffd.initialize(fs)) != srs_success) {
+        return srs_error_wrap(err, "init ffd");
+    }
+    
+    fs->seek2(0);
+    if ((err = ffd.read_header_ext(header)) != srs_success) {
+        return srs_error_wrap(err, "ffd read header");
+    }
+    
+    int64_t start = 0;
+    int sh_size = 0;
+    if ((err = ffd.read_sequence_header_summary(&start, &sh_size)) != srs_success) {
+        return srs_error_wrap(err, "ffd read sps");
+    }
+    if (sh_size <= 0) {
+        return srs_error_new(ERROR_HTTP_REMUX_SEQUENCE_HEADER, "no sequence, size=%d", sh_size);
+    }
+    
+    sh.resize(sh_size);
+    if ((err = fs->read(&sh[0], sh_size, NULL)) != srs_success) {
+        return srs_error_wrap(err, "fs read");
+    }
+    data_offset = start + sh_size;
+    
+    if ((err = ffd.read_keyframes(times, offsets)) != srs_success) {
+        return srs_error_wrap(err, "ffd read keyframes");
+    }
+    
+    return err;
+}
+
+bool SrsFlvVodIndex::match(int64_t fmtime, int64_t fsize)
+{
+    return mtime == fmtime && size == fsize;
+}
+
+int64_t SrsFlvVodIndex::seek(srs_utime_t starttime)
+{
+    int64_t ms = srsu2ms(starttime);
+    
+    // The first seek point after the starttime.
+    vector<int64_t>::iterator it = std::upper_bound(times.begin(), times.end(), ms);
+    if (it == times.begin()) {
+        return data_offset;
+    }
+    
+    return offsets.at(it - times.begin() - 1);
+}
+
+SrsFlvVodIndexCache::SrsFlvVodIndexCache(int max_files)
+{
+    capacity = max_files;
+}
+
+SrsFlvVodIndexCache::~SrsFlvVodIndexCache()
+{
+    std::list<SrsFlvVodIndex*>::iterator it;
+    for (it = lru.begin(); it != lru.end(); ++it) {
+        SrsFlvVodIndex* index = *it;
+        srs_freep(index);
+    }
+    lru.clear();
+    indexes.clear();
+}
+
+srs_error_t SrsFlvVodIndexCache::fetch(string fullpath, SrsFileReader* fs, SrsFlvVodIndex** pindex)
+{
+    srs_error_t err = srs_success;
+    
+    struct stat st;
+    if (::stat(fullpath.c_str(), &st) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_NOT_EXISTS, "stat %s", fullpath.c_str());
+    }
+    
+    std::map<std::string, std::list<SrsFlvVodIndex*>::iterator>::iterator it = indexes.find(fullpath);
+    if (it != indexes.end()) {
+        std::list<SrsFlvVodIndex*>::iterator lit = it->second;
+        SrsFlvVodIndex* index = *lit;
+        
+        // Hit, move to the front.
+        if (index->match((int64_t)st.st_mtime, fs->filesize())) {
+            lru.splice(lru.begin(), lru, lit);
+            *pindex = index;
+            return err;
+        }
+        
+        // The file is changed, drop the stale index.
+        lru.erase(lit);
+        indexes.erase(it);
+        srs_freep(index);
+    }
+    
+    SrsFlvVodIndex* index = new SrsFlvVodIndex();
+    if ((err = index->initialize(fullpath, fs)) != srs_success) {
+        srs_freep(index);
+        return srs_error_wrap(err, "build index of %s", fullpath.c_str());
+    }
+    index->mtime = (int64_t)st.st_mtime;
+    
+    lru.push_front(index);
+    indexes[fullpath] = lru.begin();
+    srs_trace("flv vod index %s, size=%" PRId64 ", keyframes=%d, cached=%d",
+        fullpath.c_str(), index->size, (int)index->times.size(), (int)lru.size());
+    
+    // Evict the least recently used index.
+    while ((int)lru.size() > capacity && lru.size() > 1) {
+        SrsFlvVodIndex* last = lru.back();
+        lru.pop_back();
+        indexes.erase(last->path);
+        srs_freep(last);
+    }
+    
+    *pindex = index;
+    return err;
+}
+
+int SrsFlvVodIndexCache::size()
+{
+    return (int)lru.size();
+}
+
+SrsHttpFileMeta::SrsHttpFileMeta()
+{
+    size = 0;
+    mtime = 0;
+    expired = 0;
+}
+
+SrsHttpFileMeta::~SrsHttpFileMeta()
+{
+}
+
+bool SrsHttpFileMeta::not_modified(ISrsHttpMessage* r)
+{
+    // The If-None-Match takes precedence over If-Modified-Since, see RFC7232 section 6.
+    string inm = r->header()->get("If-None-Match");
+    if (!inm.empty()) {
+        return inm == "*" || inm.find(etag) != string::npos;
+    }
+    
+    // Exact match like nginx, because we always response the same Last-Modified.
+    string ims = r->header()->get("If-Modified-Since");
+    return !ims.empty() && ims == last_modified;
+}
+
+SrsHttpFileMetaCache* _srs_http_file_meta = new SrsHttpFileMetaCache();
+
+SrsHttpFileMetaCache::SrsHttpFileMetaCache()
+{
+    max_age = 0;
+    nn_hits = 0;
+    nn_misses = 0;
+}
+
+SrsHttpFileMetaCache::~SrsHttpFileMetaCache()
+{
+}
+
+bool SrsHttpFileMetaCache::is_cacheable(string path)
+{
+    return srs_string_ends_with(path, ".m3u8") || srs_string_ends_with(path, ".ts")
+        || srs_string_ends_with(path, ".mpd") || srs_string_ends_with(path, ".m4s");
+}
+
+string SrsHttpFileMetaCache::cache_control(string path)
+{
+    if (max_age <= 0) {
+        return "";
+    }
+    
+    // The playlist is always changing, so the client must revalidate it by ETag.
+    if (srs_string_ends_with(path, ".m3u8") || srs_string_ends_with(path, ".mpd")) {
+        return "no-cache";
+    }
+    
+    // The segment is never changed once it's written.
+    char buf[64];
+    snprintf(buf, sizeof(buf), "public, max-age=%d, immutable", max_age);
+    return buf;
+}
+
+void SrsHttpFileMetaCache::set_max_age(int v)
+{
+    max_age = v;
+}
+
+bool SrsHttpFileMetaCache::fetch(string fullpath, SrsHttpFileMeta& meta)
+{
+    string path = SrsHlsMemoryStore::normalize(fullpath);
+    srs_utime_t now = srs_get_system_time();
+    
+    std::map<std::string, SrsHttpFileMeta>::iterator it = metas.find(path);
+    if (it != metas.end()) {
+        if (now < it->second.expired) {
+            nn_hits++;
+            meta = it->second;
+            return true;
+        }
+        metas.erase(it);
+    }
+    nn_misses++;
+    
+    struct stat st;
+    if (::stat(fullpath.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    
+    SrsHttpFileMeta v;
+    v.size = (int64_t)st.st_size;
+    v.mtime = srs_stat_mtime(st);
+    
+    if (true) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "\"%llx-%llx\"", (unsigned long long)v.mtime, (unsigned long long)v.size);
+        v.etag = buf;
+    }
+    
+    if (true) {
+        char buf[64];
+        struct tm tm;
+        time_t mtime = st.st_mtime;
+        if (gmtime_r(&mtime, &tm) && strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm) > 0) {
+            v.last_modified = buf;
+        }
+    }
+    
+    if (srs_string_ends_with(path, ".m3u8")) {
+        v.content_type = "application/vnd.apple.mpegurl";
+    } else if (srs_string_ends_with(path, ".ts")) {
+        v.content_type = "video/MP2T";
+    } else if (srs_string_ends_with(path, ".mpd")) {
+        v.content_type = "text/xml";
+    } else {
+        v.content_type = "video/iso.segment";
+    }
+    v.cache_control = cache_control(path);
+    
+    bool playlist = srs_string_ends_with(path, ".m3u8") || srs_string_ends_with(path, ".mpd");
+    v.expired = now + (playlist? SRS_HTTP_FILE_META_PLAYLIST_TTL : SRS_HTTP_FILE_META_SEGMENT_TTL);
+    
+    if ((int)metas.size() >= SRS_HTTP_FILE_META_MAX) {
+        metas.clear();
+    }
+    metas[path] = v;
+    
+    meta = v;
+    return true;
+}
+
+void SrsHttpFileMetaCache::invalidate(string path)
+{
+    if (!metas.empty()) {
+        metas.erase(SrsHlsMemoryStore::normalize(path));
+    }
+    _srs_http_file_cache->invalidate(path);
+}
+
+int SrsHttpFileMetaCache::size()
+{
+    return (int)metas.size();
+}
+
+SrsHttpOpenFile::SrsHttpOpenFile()
+{
+    fd = -1;
+    size = 0;
+    mtime = 0;
+    inode = 0;
+    content = NULL;
+    expired = 0;
+    refs = 0;
+    evicted = false;
+}
+
+SrsHttpOpenFile::~SrsHttpOpenFile()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    srs_freep(content);
+}
+
+SrsHttpFileCache* _srs_http_file_cache = new SrsHttpFileCache();
+
+SrsHttpFileCache::SrsHttpFileCache()
+{
+    max_files = 0;
+    valid = 1 * SRS_UTIME_SECONDS;
+    max_size = 0;
+    max_memory = 0;
+    nn_memory = 0;
+    nn_hits = nn_misses = nn_memory_hits = 0;
+    nn_validations = nn_changes = nn_evictions = 0;
+}
+
+SrsHttpFileCache::~SrsHttpFileCache()
+{
+    std::list<SrsHttpOpenFile*>::iterator it;
+    for (it = lru.begin(); it != lru.end(); ++it) {
+        SrsHttpOpenFile* file = *it;
+        srs_freep(file);
+    }
+    lru.clear();
+    files.clear();
+}
+
+void SrsHttpFileCache::set_limits(int max_files, srs_utime_t valid, int64_t max_size, int64_t max_memory)
+{
+    this->max_files = max_files;
+    this->valid = valid;
+    this->max_size = max_size;
+    this->max_memory = max_memory;
+    
+    while ((int)lru.size() > max_files) {
+        evict(--lru.end());
+    }
+}
+
+bool SrsHttpFileCache::enabled()
+{
+    return max_files > 0;
+}
+
+srs_error_t SrsHttpFileCache::open(string fullpath, SrsHttpOpenFile** pfile)
+{
+    srs_error_t err = srs_success;
+    
+    string path = SrsHlsMemoryStore::normalize(fullpath);
+    
+    std::map<std::string, std::list<SrsHttpOpenFile*>::iterator>::iterator it = files.find(path);
+    if (it != files.end()) {
+        SrsHttpOpenFile* file = *it->second;
+        
+        // Validate the file by stat, for the file changed or removed by others.
+        srs_utime_t now = srs_get_system_time();
+        bool changed = false;
+        if (now >= file->expired) {
+            nn_validations++;
+            
+            struct stat st;
+            if (::stat(fullpath.c_str(), &st) < 0 || (int64_t)st.st_ino != file->inode
+                || (int64_t)st.st_size != file->size || srs_stat_mtime(st) != file->mtime) {
+                changed = true;
+            } else {
+                file->expired = now + valid;
+            }
+        }
+        
+        if (!changed) {
+            nn_hits++;
+            if (file->content) {
+                nn_memory_hits++;
+            }
+            lru.splice(lru.begin(), lru, it->second);
+            file->refs++;
+            *pfile = file;
+            return err;
+        }
+        
+        nn_changes++;
+        evict(it->second);
+    }
+    nn_misses++;
+    
+    if ((err = do_open(fullpath, pfile)) != srs_success) {
+        return srs_error_wrap(err, "open %s", fullpath.c_str());
+    }
+    
+    return err;
+}
+
+void SrsHttpFileCache::release(SrsHttpOpenFile* file)
+{
+    file->refs--;
+    
+    if (file->evicted && file->refs <= 0) {
+        srs_freep(file);
+    }
+}
+
+void SrsHttpFileCache::invalidate(string path)
+{
+    if (files.empty()) {
+        return;
+    }
+    
+    std::map<std::string, std::list<SrsHttpOpenFile*>::iterator>::iterator it = files.find(SrsHlsMemoryStore::normalize(path));
+    if (it != files.end()) {
+        evict(it->second);
+    }
+}
+
+int SrsHttpFileCache::size()
+{
+    return (int)lru.size();
+}
+
+int64_t SrsHttpFileCache::memory()
+{
+    return nn_memory;
+}
+
+void SrsHttpFileCache::dumps(SrsJsonObject* obj)
+{
+    obj->set("enabled", SrsJsonAny::boolean(enabled()));
+    obj->set("max_files", SrsJsonAny::integer(max_files));
+    obj->set("valid_ms", SrsJsonAny::integer(srsu2ms(valid)));
+    obj->set("files", SrsJsonAny::integer(size()));
+    obj->set("max_memory", SrsJsonAny::integer(max_memory));
+    obj->set("memory", SrsJsonAny::integer(nn_memory));
+    obj->set("hits", SrsJsonAny::integer(nn_hits));
+    obj->set("misses", SrsJsonAny::integer(nn_misses));
+    obj->set("memory_hits", SrsJsonAny::integer(nn_memory_hits));
+    obj->set("validations", SrsJsonAny::integer(nn_validations));
+    obj->set("changes", SrsJsonAny::integer(nn_changes));
+    obj->set("evictions", SrsJsonAny::integer(nn_evictions));
+}
+
+srs_error_t SrsHttpFileCache::do_open(string fullpath, SrsHttpOpenFile** pfile)
+{
+    srs_error_t err = srs_success;
+    
+    *pfile = NULL;
+    
+    int fd = ::open(fullpath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return err;
+    }
+    
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return err;
+    }
+    
+    SrsHttpOpenFile* file = new SrsHttpOpenFile();
+    file->path = SrsHlsMemoryStore::normalize(fullpath);
+    file->fd = fd;
+    file->size = (int64_t)st.st_size;
+    file->mtime = srs_stat_mtime(st);
+    file->inode = (int64_t)st.st_ino;
+    file->expired = srs_get_system_time() + valid;
+    
+    // Read the small file to memory, and close it, so the fd is not used.
+    if (file->size <= max_size && nn_memory + file->size <= max_memory) {
+        char* buf = new char[srs_max(1, file->size)];
+        SrsAutoFreeA(char, buf);
+        
+        ssize_t nread = ::pread(fd, buf, (size_t)file->size, 0);
+        if (nread != (ssize_t)file->size) {
+            srs_freep(file);
+            return srs_error_new(ERROR_SYSTEM_FILE_READ, "read %d bytes, nread=%d", (int)st.st_size, (int)nread);
+        }
+        
+        file->content = new SrsHlsMemoryFile(buf, (int)file->size);
+        nn_memory += file->size;
+        
+        ::close(fd);
+        file->fd = -1;
+    }
+    
+    lru.push_front(file);
+    files[file->path] = lru.begin();
+    
+    // Evict the least recently used files.
+    while ((int)lru.size() > max_files && lru.size() > 1) {
+        evict(--lru.end());
+    }
+    
+    file->refs++;
+    *pfile = file;
+    
+    return err;
+}
+
+void SrsHttpFileCache::evict(std::list<SrsHttpOpenFile*>::iterator it)
+{
+    SrsHttpOpenFile* file = *it;
+    
+    nn_evictions++;
+    if (file->content) {
+        nn_memory -= file->size;
+    }
+    
+    files.erase(file->path);
+    lru.erase(it);
+    
+    // The file is freed when the last request releases it.
+    file->evicted = true;
+    if (file->refs <= 0) {
+        srs_freep(file);
+    }
+}
+
+SrsHlsProxyFile::SrsHlsProxyFile()
+{
+    file = NULL;
+    status = 0;
+    expired = 0;
+    fetching = false;
+    nn_waiting = 0;
+    cond = srs_cond_new();
+}
+
+SrsHlsProxyFile::~SrsHlsProxyFile()
+{
+    srs_freep(file);
+    srs_cond_destroy(cond);
+}
+
+SrsHlsProxyCache* _srs_hls_proxy = new SrsHlsProxyCache();
+
+SrsHlsProxyCache::SrsHlsProxyCache()
+{
+    nn_bytes = 0;
+    cleanup_at = 0;
+    nn_hits = 0;
+    nn_misses = 0;
+    nn_coalesced = 0;
+}
+
+SrsHlsProxyCache::~SrsHlsProxyCache()
+{
+    std::map<std::string, SrsHlsProxyFile*>::iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        SrsHlsProxyFile* pf = it->second;
+        srs_freep(pf);
+    }
+    files.clear();
+    
+    std::map<std::string, ISrsLoadBalancer*>::iterator it2;
+    for (it2 = lbs.begin(); it2 != lbs.end(); ++it2) {
+        ISrsLoadBalancer* lb = it2->second;
+        srs_freep(lb);
+    }
+    lbs.clear();
+}
+
+void SrsHlsProxyCache::update(string vhost)
+{
+    if (_srs_config->get_vhost_is_edge(vhost) && !_srs_config->get_vhost_edge_hls_origin(vhost).empty()) {
+        vhosts.insert(vhost);
+    } else {
+        vhosts.erase(vhost);
+    }
+}
+
+bool SrsHlsProxyCache::match(string host, string& vhost)
+{
+    if (vhosts.empty()) {
+        return false;
+    }
+    
+    SrsConfDirective* conf = _srs_config->get_vhost(host);
+    if (!conf || vhosts.find(conf->arg0()) == vhosts.end()) {
+        return false;
+    }
+    
+    vhost = conf->arg0();
+    return true;
+}
+
+srs_error_t SrsHlsProxyCache::fetch(string vhost, string upath, SrsHlsMemoryFile** pfile, int* pstatus)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t now = srs_get_system_time();
+    if (now >= cleanup_at) {
+        cleanup_at = now + SRS_HLS_PROXY_CLEANUP_INTERVAL;
+        cleanup(now);
+    }
+    
+    string key = vhost + upath;
+    SrsHlsProxyFile* pf = NULL;
+    
+    std::map<std::string, SrsHlsProxyFile*>::iterator it = files.find(key);
+    if (it != files.end()) {
+        pf = it->second;
+    } else {
+        pf = new SrsHlsProxyFile();
+        files[key] = pf;
+    }
+    
+    // Coalesce the request with the one fetching from origin, serve the stale file if any,
+    // or wait for the fetching.
+    if (pf->fetching) {
+        nn_coalesced++;
+        
+        if (!pf->status) {
+            pf->nn_waiting++;
+            srs_cond_timedwait(pf->cond, SRS_HLS_PROXY_TIMEOUT);
+            pf->nn_waiting--;
+        }
+        
+        if (!pf->status) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "wait %s timeout", key.c_str());
+        }
+    } else if (pf->status && now < pf->expired) {
+        nn_hits++;
+    } else {
+        nn_misses++;
+        
+        SrsHlsMemoryFile* file = NULL;
+        int status = 0;
+        
+        pf->fetching = true;
+        err = do_fetch(vhost, upath, &file, &status);
+        pf->fetching = false;
+        
+        // Response error for the origin is unavailable, which is also cached to protect the origin.
+        if (err != srs_success) {
+            srs_warn("hls proxy: fetch %s err %s", key.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            status = SRS_CONSTS_HTTP_BadGateway;
+        }
+        
+        if (pf->file) {
+            nn_bytes -= pf->file->size();
+        }
+        srs_freep(pf->file);
+        
+        pf->file = file;
+        pf->status = status;
+        if (file) {
+            nn_bytes += file->size();
+        }
+        
+        bool segment = status == SRS_CONSTS_HTTP_OK && srs_string_ends_with(upath, ".ts");
+        pf->expired = srs_get_system_time() + (segment? SRS_HLS_PROXY_SEGMENT_TTL : _srs_config->get_vhost_edge_hls_playlist_ttl(vhost));
+        
+        srs_cond_broadcast(pf->cond);
+    }
+    
+    *pstatus = pf->status;
+    *pfile = pf->file? pf->file->copy() : NULL;
+    
+    return err;
+}
+
+int SrsHlsProxyCache::size()
+{
+    return (int)files.size();
+}
+
+int64_t SrsHlsProxyCache::bytes()
+{
+    return nn_bytes;
+}
+
+srs_error_t SrsHlsProxyCache::do_fetch(string vhost, string upath, SrsHlsMemoryFile** pfile, int* pstatus)
+{
+    srs_error_t err = srs_success;
+    
+    ISrsLoadBalancer* lb = NULL;
+    if (true) {
+        std::map<std::string, ISrsLoadBalancer*>::iterator it = lbs.find(vhost);
+        if (it != lbs.end()) {
+            lb = it->second;
+        } else {
+            lb = lbs[vhost] = srs_edge_create_balancer(vhost);
+        }
+    }
+    
+    // Select the origin by the directory, so the m3u8 and ts of a stream are fetched from the same origin.
+    vector<string> origins = _srs_config->get_vhost_edge_hls_origin(vhost);
+    if (origins.empty()) {
+        return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s no hls origin", vhost.c_str());
+    }
+    
+    string server = lb->select(origins, srs_path_dirname(upath));
+    int port = SRS_DEFAULT_HTTP_PORT;
+    srs_parse_hostport(server, server, port);
+    
+    // The vhost of HTTP is specified by the Host header.
+    string host = _srs_config->get_vhost_edge_transform_vhost(vhost);
+    host = srs_string_replace(host, "[vhost]", vhost);
+    
+    SrsHttpClient hc;
+    hc.set_pool(SrsHttpClientPool::instance());
+    if ((err = hc.initialize(server, port, SRS_HLS_PROXY_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "init client");
+    }
+    if (host != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
+        hc.set_header("Host", host);
+    }
+    
+    ISrsHttpMessage* hr = NULL;
+    srs_utime_t starttime = srs_update_system_time();
+    if ((err = hc.get(upath, "", &hr)) != srs_success) {
+        lb->on_failure();
+        return srs_error_wrap(err, "get http://%s:%d%s", server.c_str(), port, upath.c_str());
+    }
+    SrsAutoFree(ISrsHttpMessage, hr);
+    
+    lb->on_success(srs_update_system_time() - starttime);
+    lb->on_close();
+    
+    // Always read the whole body, to reuse the transport.
+    string body;
+    if ((err = hr->body_read_all(body)) != srs_success) {
+        return srs_error_wrap(err, "read http://%s:%d%s", server.c_str(), port, upath.c_str());
+    }
+    
+    *pstatus = hr->status_code();
+    if (*pstatus == SRS_CONSTS_HTTP_OK) {
+        *pfile = new SrsHlsMemoryFile(body.data(), (int)body.length());
+    }
+    
+    return err;
+}
+
+void SrsHlsProxyCache::cleanup(srs_utime_t now)
+{
+    std::map<std::string, SrsHlsProxyFile*>::iterator it;
+    for (it = files.begin(); it != files.end();) {
+        SrsHlsProxyFile* pf = it->second;
+        
+        // Never free the file which is used by the fetching or waiting requests.
+        if (pf->fetching || pf->nn_waiting > 0 || now < pf->expired) {
+            ++it;
+            continue;
+        }
+        
+        if (pf->file) {
+            nn_bytes -= pf->file->size();
+        }
+        files.erase(it++);
+        srs_freep(pf);
+    }
+}
+
+// Write the flv tag to ts, ignore the codecs not supported by ts.
+srs_error_t srs_vod_hls_write_tag(SrsTsTransmuxer* tsmux, char type, int64_t timestamp, char* data, int size)
+{
+    if (size <= 0) {
+        return srs_success;
+    }
+    
+    if (type == SrsFrameTypeAudio) {
+        SrsAudioCodecId codec = (SrsAudioCodecId)((data[0] >> 4) & 0x0f);
+        if (codec == SrsAudioCodecIdAAC || codec == SrsAudioCodecIdMP3) {
+            return tsmux->write_audio(timestamp, data, size);
+        }
+    } else if (type == SrsFrameTypeVideo) {
+        SrsVideoCodecId codec = (SrsVideoCodecId)(data[0] & 0x0f);
+        if (codec == SrsVideoCodecIdAVC || codec == SrsVideoCodecIdHEVC) {
+            return tsmux->write_video(timestamp, data, size);
+        }
+    }
+    
+    return srs_success;
+}
+
+SrsVodHlsIndex::SrsVodHlsIndex()
+{
+    mtime = 0;
+    size = 0;
+    m3u8 = NULL;
+    fs = NULL;
+    dec = NULL;
+}
+
+SrsVodHlsIndex::~SrsVodHlsIndex()
+{
+    srs_freep(m3u8);
+    srs_freep(dec);
+    srs_freep(fs);
+}
+
+srs_error_t SrsVodHlsIndex::initialize(string fullpath, srs_utime_t fragment)
+{
+    srs_error_t err = srs_success;
+    
+    path = fullpath;
+    
+    if (srs_string_ends_with(fullpath, ".flv")) {
+        err = initialize_flv(fullpath, fragment);
+    } else {
+        err = initialize_mp4(fullpath, fragment);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "init %s", fullpath.c_str());
+    }
+    
+    if (times.size() < 2) {
+        return srs_error_new(ERROR_HTTP_REMUX_SEQUENCE_HEADER, "no segment of %s", fullpath.c_str());
+    }
+    
+    generate_m3u8();
+    
+    return err;
+}
+
+vector<int> SrsVodHlsIndex::cut(const vector<int64_t>& points, int64_t duration, srs_utime_t fragment)
+{
+    vector<int> starts;
+    
+    times.clear();
+    times.push_back(0);
+    starts.push_back(-1);
+    
+    int64_t fragment_ms = srsu2ms(fragment);
+    for (int i = 0; i < (int)points.size(); i++) {
+        int64_t start = points.at(i);
+        if (start - times.back() < fragment_ms || start >= duration) {
+            continue;
+        }
+        
+        times.push_back(start);
+        starts.push_back(i);
+    }
+    
+    // The end of the last segment.
+    times.push_back(srs_max(duration, times.back() + 1));
+    
+    return starts;
+}
+
+int SrsVodHlsIndex::nb_segments()
+{
+    return (int)times.size() - 1;
+}
+
+srs_error_t SrsVodHlsIndex::mux(int seq, ISrsStreamWriter* w)
+{
+    srs_error_t err = srs_success;
+    
+    if (seq < 0 || seq >= nb_segments()) {
+        return srs_error_new(ERROR_SYSTEM_FILE_NOT_EXISTS, "no segment %d of %d", seq, nb_segments());
+    }
+    
+    if (dec) {
+        err = mux_mp4(seq, w);
+    } else {
+        err = mux_flv(seq, w);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "mux segment %d of %s", seq, path.c_str());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodHlsIndex::initialize_flv(string fullpath, srs_utime_t fragment)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileReader reader;
+    if ((err = reader.open(fullpath)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    
+    SrsFlvVodIndex index;
+    if ((err = index.initialize(fullpath, &reader)) != srs_success) {
+        return srs_error_wrap(err, "flv index");
+    }
+    sh = index.sh;
+    size = index.size;
+    
+    // The duration is the timestamp of the last tag, by the previous tag size at the end of file.
+    int64_t duration = 0;
+    if (size >= index.data_offset + SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE) {
+        char buf[SRS_FLV_TAG_HEADER_SIZE];
+        
+        reader.seek2(size - SRS_FLV_PREVIOUS_TAG_SIZE);
+        if ((err = reader.read(buf, SRS_FLV_PREVIOUS_TAG_SIZE, NULL)) != srs_success) {
+            return srs_error_wrap(err, "read previous tag size");
+        }
+        
+        SrsBuffer stream(buf, SRS_FLV_PREVIOUS_TAG_SIZE);
+        int64_t offset = size - SRS_FLV_PREVIOUS_TAG_SIZE - stream.read_4bytes();
+        if (offset >= index.data_offset && offset + SRS_FLV_TAG_HEADER_SIZE <= size) {
+            reader.seek2(offset);
+            if ((err = reader.read(buf, SRS_FLV_TAG_HEADER_SIZE, NULL)) != srs_success) {
+                return srs_error_wrap(err, "read last tag");
+            }
+            
+            SrsBuffer tag(buf, SRS_FLV_TAG_HEADER_SIZE);
+            tag.skip(4);
+            duration = tag.read_3bytes();
+            duration |= (int64_t)tag.read_1bytes() << 24;
+        }
+    }
+    if (!index.times.empty()) {
+        duration = srs_max(duration, index.times.back());
+    }
+    
+    vector<int> starts = cut(index.times, duration, fragment);
+    for (int i = 0; i < (int)starts.size(); i++) {
+        int point = starts.at(i);
+        offsets.push_back(point < 0? index.data_offset : index.offsets.at(point));
+    }
+    offsets.push_back(size);
+    
+    return err;
+}
+
+srs_error_t SrsVodHlsIndex::initialize_mp4(string fullpath, srs_utime_t fragment)
+{
+    srs_error_t err = srs_success;
+    
+    fs = new SrsFileReader();
+    if ((err = fs->open(fullpath)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    size = fs->filesize();
+    
+    dec = new SrsMp4Decoder();
+    if ((err = dec->initialize(fs)) != srs_success) {
+        return srs_error_wrap(err, "mp4 demuxer");
+    }
+    
+    vector<int64_t> points;
+    int64_t duration = 0;
+    dec->read_keyframes(points, &duration);
+    
+    cut(points, duration, fragment);
+    
+    return err;
+}
+
+void SrsVodHlsIndex::generate_m3u8()
+{
+    int64_t max_duration = 0;
+    for (int i = 0; i < nb_segments(); i++) {
+        max_duration = srs_max(max_duration, times.at(i + 1) - times.at(i));
+    }
+    
+    stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF
+        << "#EXT-X-VERSION:3" << SRS_CONSTS_LF
+        << "#EXT-X-PLAYLIST-TYPE:VOD" << SRS_CONSTS_LF
+        << "#EXT-X-TARGETDURATION:" << (max_duration + 999) / 1000 << SRS_CONSTS_LF
+        << "#EXT-X-MEDIA-SEQUENCE:0" << SRS_CONSTS_LF;
+    
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    for (int i = 0; i < nb_segments(); i++) {
+        ss << "#EXTINF:" << (times.at(i + 1) - times.at(i)) / 1000.0 << ", no desc" << SRS_CONSTS_LF
+            << "seg-" << i << ".ts" << SRS_CONSTS_LF;
+    }
+    ss << "#EXT-X-ENDLIST" << SRS_CONSTS_LF;
+    
+    string content = ss.str();
+    srs_freep(m3u8);
+    m3u8 = new SrsHlsMemoryFile(content.data(), (int)content.length());
+}
+
+srs_error_t SrsVodHlsIndex::mux_flv(int seq, ISrsStreamWriter* w)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileReader reader;
+    if ((err = reader.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    
+    SrsTsTransmuxer tsmux;
+    if ((err = tsmux.initialize(w)) != srs_success) {
+        return srs_error_wrap(err, "init ts");
+    }
+    
+    // Each segment starts with the sequence headers, to decode it independently.
+    for (int pos = 0; pos + SRS_FLV_TAG_HEADER_SIZE <= (int)sh.size();) {
+        SrsBuffer stream(&sh[pos], SRS_FLV_TAG_HEADER_SIZE);
+        char type = stream.read_1bytes() & 0x1f;
+        int32_t data_size = stream.read_3bytes();
+        if (pos + SRS_FLV_TAG_HEADER_SIZE + data_size > (int)sh.size()) {
+            break;
+        }
+        
+        if ((err = srs_vod_hls_write_tag(&tsmux, type, times.at(seq), &sh[pos + SRS_FLV_TAG_HEADER_SIZE], data_size)) != srs_success) {
+            return srs_error_wrap(err, "write sequence header");
+        }
+        pos += SRS_FLV_TAG_HEADER_SIZE + data_size + SRS_FLV_PREVIOUS_TAG_SIZE;
+    }
+    
+    SrsFlvDecoder ffd;
+    if ((err = ffd.initialize(&reader)) != srs_success) {
+        return srs_error_wrap(err, "init flv decoder");
+    }
+    
+    reader.seek2(offsets.at(seq));
+    int64_t end = offsets.at(seq + 1);
+    
+    char pps[SRS_FLV_PREVIOUS_TAG_SIZE];
+    while (reader.tellg() + SRS_FLV_TAG_HEADER_SIZE <= end) {
+        char type = 0;
+        int32_t data_size = 0;
+        uint32_t timestamp = 0;
+        if ((err = ffd.read_tag_header(&type, &data_size, &timestamp)) != srs_success) {
+            return srs_error_wrap(err, "read tag header");
+        }
+        
+        char* data = new char[data_size];
+        SrsAutoFreeA(char, data);
+        if ((err = ffd.read_tag_data(data, data_size)) != srs_success) {
+            return srs_error_wrap(err, "read tag data");
+        }
+        if ((err = ffd.read_previous_tag_size(pps)) != srs_success) {
+            return srs_error_wrap(err, "read previous tag size");
+        }
+        
+        if ((err = srs_vod_hls_write_tag(&tsmux, type & 0x1f, timestamp, data, data_size)) != srs_success) {
+            return srs_error_wrap(err, "write tag");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodHlsIndex::mux_mp4(int seq, ISrsStreamWriter* w)
+{
+    srs_error_t err = srs_success;
+    
+    SrsTsTransmuxer tsmux;
+    if ((err = tsmux.initialize(w)) != srs_success) {
+        return srs_error_wrap(err, "init ts");
+    }
+    
+    // Never yield when muxing, so the demuxer is shared by requests.
+    int64_t start = times.at(seq);
+    int64_t end = times.at(seq + 1);
+    bool last = seq == nb_segments() - 1;
+    dec->seek((uint32_t)start);
+    
+    bool video_done = dec->vcodec == SrsVideoCodecIdForbidden;
+    bool audio_done = dec->acodec == SrsAudioCodecIdForbidden;
+    while (!video_done || !audio_done) {
+        SrsMp4HandlerType ht = SrsMp4HandlerTypeForbidden;
+        uint16_t ft = 0, ct = 0;
+        uint32_t dts = 0, pts = 0, nb_sample = 0;
+        uint8_t* sample = NULL;
+        if ((err = dec->read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SYSTEM_FILE_EOF) {
+                srs_freep(err);
+                break;
+            }
+            return srs_error_wrap(err, "read sample");
+        }
+        SrsAutoFreeA(uint8_t, sample);
+        
+        bool sh = (ht == SrsMp4HandlerTypeVIDE && ct == SrsVideoAvcFrameTraitSequenceHeader)
+            || (ht == SrsMp4HandlerTypeSOUN && ct == SrsAudioAacFrameTraitSequenceHeader);
+        if (sh) {
+            dts = pts = (uint32_t)start;
+        } else if (!last && dts >= end) {
+            if (ht == SrsMp4HandlerTypeVIDE) {
+                video_done = true;
+            } else {
+                audio_done = true;
+            }
+            continue;
+        }
+        
+        // Covert the sample to flv tag, see srs_mp4_to_flv_tag.
+        char* data = new char[nb_sample + 5];
+        SrsAutoFreeA(char, data);
+        SrsBuffer p(data, nb_sample + 5);
+        
+        char type = 0;
+        if (ht == SrsMp4HandlerTypeSOUN) {
+            type = SrsFrameTypeAudio;
+            // E.4.2.1 AUDIODATA, flv_v10_1.pdf, page 3
+            p.write_1bytes(uint8_t(dec->acodec << 4) | uint8_t(dec->sample_rate << 2) | uint8_t(dec->sound_bits << 1) | dec->channels);
+            if (dec->acodec == SrsAudioCodecIdAAC) {
+                p.write_1bytes(uint8_t(ct == (uint16_t)SrsAudioAacFrameTraitSequenceHeader? 0:1));
+            }
+        } else {
+            type = SrsFrameTypeVideo;
+            // E.4.3.1 VIDEODATA, flv_v10_1.pdf, page 5
+            p.write_1bytes(uint8_t(ft << 4) | uint8_t(dec->vcodec));
+            p.write_1bytes(uint8_t(ct == (uint16_t)SrsVideoAvcFrameTraitSequenceHeader? 0:1));
+            p.write_3bytes(pts - dts);
+        }
+        p.write_bytes((char*)sample, nb_sample);
+        
+        if ((err = srs_vod_hls_write_tag(&tsmux, type, dts, data, p.pos())) != srs_success) {
+            return srs_error_wrap(err, "write sample");
+        }
+    }
+    
+    return err;
+}
+
+// The max number of vod files to cache the index for hls.
+#define SRS_VOD_HLS_MAX_FILES 64
+
+SrsVodHlsCache* _srs_vod_hls = new SrsVodHlsCache();
+
+SrsVodHlsCache::SrsVodHlsCache()
+{
+    capacity = 0;
+    fragment = 10 * SRS_UTIME_SECONDS;
+    nn_bytes = 0;
+}
+
+SrsVodHlsCache::~SrsVodHlsCache()
+{
+    std::list<SrsVodHlsIndex*>::iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        SrsVodHlsIndex* index = *it;
+        srs_freep(index);
+    }
+    files.clear();
+    indexes.clear();
+    
+    std::list<std::pair<std::string, SrsHlsMemoryFile*> >::iterator sit;
+    for (sit = lru.begin(); sit != lru.end(); ++sit) {
+        srs_freep(sit->second);
+    }
+    lru.clear();
+    segments.clear();
+}
+
+void SrsVodHlsCache::set_capacity(int max_segments, srs_utime_t v)
+{
+    capacity = max_segments;
+    fragment = v;
+}
+
+bool SrsVodHlsCache::enabled()
+{
+    return capacity > 0;
+}
+
+bool SrsVodHlsCache::parse(string upath, string& file, string& name)
+{
+    size_t pos = upath.rfind("/");
+    if (pos == string::npos || pos == 0) {
+        return false;
+    }
+    
+    file = upath.substr(0, pos);
+    name = upath.substr(pos + 1);
+    if (!srs_string_ends_with(file, ".mp4") && !srs_string_ends_with(file, ".flv")) {
+        return false;
+    }
+    
+    if (name == "index.m3u8") {
+        return true;
+    }
+    
+    if (!srs_string_starts_with(name, "seg-") || !srs_string_ends_with(name, ".ts") || name.length() <= 7) {
+        return false;
+    }
+    
+    string seq = name.substr(4, name.length() - 7);
+    return seq.find_first_not_of("0123456789") == string::npos;
+}
+
+srs_error_t SrsVodHlsCache::fetch(string fullpath, string name, SrsHlsMemoryFile** pfile)
+{
+    srs_error_t err = srs_success;
+    
+    *pfile = NULL;
+    
+    SrsVodHlsIndex* index = NULL;
+    if ((err = fetch_index(fullpath, &index)) != srs_success) {
+        return srs_error_wrap(err, "vod hls index");
+    }
+    if (!index) {
+        return err;
+    }
+    
+    if (name == "index.m3u8") {
+        *pfile = index->m3u8->copy();
+        return err;
+    }
+    
+    string key = fullpath + "/" + name;
+    std::map<std::string, std::list<std::pair<std::string, SrsHlsMemoryFile*> >::iterator>::iterator it = segments.find(key);
+    if (it != segments.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        *pfile = it->second->second->copy();
+        return err;
+    }
+    
+    int seq = ::atoi(name.substr(4).c_str());
+    if (seq >= index->nb_segments()) {
+        return err;
+    }
+    
+    SrsHlsMemoryWriter writer(NULL);
+    if ((err = index->mux(seq, &writer)) != srs_success) {
+        return srs_error_wrap(err, "vod hls mux");
+    }
+    
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile(writer.data(), writer.size());
+    lru.push_front(std::make_pair(key, file));
+    segments[key] = lru.begin();
+    nn_bytes += file->size();
+    
+    // Evict the least recently used segments.
+    while ((int)lru.size() > capacity && lru.size() > 1) {
+        std::pair<std::string, SrsHlsMemoryFile*>& last = lru.back();
+        nn_bytes -= last.second->size();
+        segments.erase(last.first);
+        srs_freep(last.second);
+        lru.pop_back();
+    }
+    
+    *pfile = file->copy();
+    return err;
+}
+
+int SrsVodHlsCache::size()
+{
+    return (int)lru.size();
+}
+
+int64_t SrsVodHlsCache::bytes()
+{
+    return nn_bytes;
+}
+
+srs_error_t SrsVodHlsCache::fetch_index(string fullpath, SrsVodHlsIndex** pindex)
+{
+    srs_error_t err = srs_success;
+    
+    struct stat st;
+    if (::stat(fullpath.c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+        *pindex = NULL;
+        return err;
+    }
+    
+    std::map<std::string, std::list<SrsVodHlsIndex*>::iterator>::iterator it = indexes.find(fullpath);
+    if (it != indexes.end()) {
+        SrsVodHlsIndex* index = *it->second;
+        
+        // Hit, move to the front.
+        if (index->mtime == (int64_t)st.st_mtime && index->size == (int64_t)st.st_size) {
+            files.splice(files.begin(), files, it->second);
+            *pindex = index;
+            return err;
+        }
+        
+        // The file is changed, drop the stale index and segments.
+        evict(fullpath);
+    }
+    
+    SrsVodHlsIndex* index = new SrsVodHlsIndex();
+    if ((err = index->initialize(fullpath, fragment)) != srs_success) {
+        srs_freep(index);
+        return srs_error_wrap(err, "build vod hls of %s", fullpath.c_str());
+    }
+    index->mtime = (int64_t)st.st_mtime;
+    
+    files.push_front(index);
+    indexes[fullpath] = files.begin();
+    srs_trace("vod hls index %s, size=%" PRId64 ", segments=%d, duration=%" PRId64 "ms, files=%d",
+        fullpath.c_str(), index->size, index->nb_segments(), index->times.back(), (int)files.size());
+    
+    // Evict the least recently used index.
+    while ((int)files.size() > SRS_VOD_HLS_MAX_FILES) {
+        evict(files.back()->path);
+    }
+    
+    *pindex = index;
+    return err;
+}
+
+void SrsVodHlsCache::evict(string fullpath)
+{
+    std::map<std::string, std::list<SrsVodHlsIndex*>::iterator>::iterator it = indexes.find(fullpath);
+    if (it != indexes.end()) {
+        SrsVodHlsIndex* index = *it->second;
+        files.erase(it->second);
+        indexes.erase(it);
+        srs_freep(index);
+    }
+    
+    // The segments of file, keyed by the path of file and name.
+    string prefix = fullpath + "/";
+    std::map<std::string, std::list<std::pair<std::string, SrsHlsMemoryFile*> >::iterator>::iterator sit;
+    for (sit = segments.lower_bound(prefix); sit != segments.end() && srs_string_starts_with(sit->first, prefix);) {
+        std::list<std::pair<std::string, SrsHlsMemoryFile*> >::iterator lit = sit->second;
+        nn_bytes -= lit->second->size();
+        srs_freep(lit->second);
+        lru.erase(lit);
+        segments.erase(sit++);
+    }
+}
+
+// The max number of mp4 vod files to keep the moov loaded.
+#define SRS_VOD_MOOV_MAX_FILES 16
+
+SrsMp4VodFile::SrsMp4VodFile()
+{
+    mtime = 0;
+    size = 0;
+    trimmer = new SrsMp4MoovTrimmer();
+}
+
+SrsMp4VodFile::~SrsMp4VodFile()
+{
+    srs_freep(trimmer);
+}
+
+SrsMp4VodMoov::SrsMp4VodMoov()
+{
+    start = 0;
+    end = 0;
+}
+
+SrsMp4VodMoov::~SrsMp4VodMoov()
+{
+}
+
+SrsMp4VodMoovCache* _srs_vod_moov = new SrsMp4VodMoovCache();
+
+SrsMp4VodMoovCache::SrsMp4VodMoovCache()
+{
+    capacity = 0;
+    nn_bytes = 0;
+    nn_hits = 0;
+    nn_misses = 0;
+}
+
+SrsMp4VodMoovCache::~SrsMp4VodMoovCache()
+{
+    std::list<SrsMp4VodFile*>::iterator it;
+    for (it = files.begin(); it != files.end(); ++it) {
+        SrsMp4VodFile* file = *it;
+        srs_freep(file);
+    }
+    files.clear();
+    indexes.clear();
+    
+    std::list<SrsMp4VodMoov*>::iterator mit;
+    for (mit = lru.begin(); mit != lru.end(); ++mit) {
+        SrsMp4VodMoov* moov = *mit;
+        srs_freep(moov);
+    }
+    lru.clear();
+    moovs.clear();
+}
+
+void SrsMp4VodMoovCache::set_capacity(int v)
+{
+    capacity = v;
+}
+
+bool SrsMp4VodMoovCache::enabled()
+{
+    return capacity > 0;
+}
+
+srs_error_t SrsMp4VodMoovCache::fetch(string fullpath, SrsFileReader* fs, srs_utime_t starttime, SrsMp4VodMoov** pmoov)
+{
+    srs_error_t err = srs_success;
+    
+    *pmoov = NULL;
+    
+    // Without cache, load and trim the moov for each request.
+    SrsMp4VodFile* file = NULL;
+    SrsMp4MoovTrimmer* temporary = NULL;
+    if (!enabled()) {
+        temporary = new SrsMp4MoovTrimmer();
+    } else if ((err = fetch_file(fullpath, fs, &file)) != srs_success) {
+        return srs_error_wrap(err, "load moov");
+    }
+    SrsAutoFree(SrsMp4MoovTrimmer, temporary);
+    
+    if (temporary && (err = temporary->initialize(fs)) != srs_success) {
+        return srs_error_wrap(err, "load moov of %s", fullpath.c_str());
+    }
+    
+    SrsMp4MoovTrimmer* trimmer = file? file->trimmer : temporary;
+    uint32_t keyframe = trimmer->keyframe_at((uint32_t)srsu2ms(starttime));
+    
+    // The key of moov, the file is identified by its path, the changed file evicts all its moov.
+    string key = fullpath + "|" + srs_int2str(keyframe);
+    std::map<std::string, std::list<SrsMp4VodMoov*>::iterator>::iterator it = moovs.find(key);
+    if (it != moovs.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        nn_hits++;
+        
+        SrsMp4VodMoov* moov = *it->second;
+        SrsMp4VodMoov* copy = new SrsMp4VodMoov();
+        copy->key = moov->key;
+        copy->header = moov->header;
+        copy->start = moov->start;
+        copy->end = moov->end;
+        *pmoov = copy;
+        return err;
+    }
+    nn_misses++;
+    
+    SrsMp4VodMoov* moov = new SrsMp4VodMoov();
+    moov->key = key;
+    if ((err = trimmer->trim(keyframe, moov->header, &moov->start, &moov->end)) != srs_success) {
+        srs_freep(moov);
+        return srs_error_wrap(err, "trim moov of %s at %ums", fullpath.c_str(), keyframe);
+    }
+    
+    if (!enabled()) {
+        *pmoov = moov;
+        return err;
+    }
+    
+    lru.push_front(moov);
+    moovs[key] = lru.begin();
+    nn_bytes += (int64_t)moov->header.size();
+    
+    // Evict the least recently used moov.
+    while ((int)lru.size() > capacity && lru.size() > 1) {
+        SrsMp4VodMoov* last = lru.back();
+        nn_bytes -= (int64_t)last->header.size();
+        moovs.erase(last->key);
+        srs_freep(last);
+        lru.pop_back();
+    }
+    
+    SrsMp4VodMoov* copy = new SrsMp4VodMoov();
+    copy->key = moov->key;
+    copy->header = moov->header;
+    copy->start = moov->start;
+    copy->end = moov->end;
+    *pmoov = copy;
+    
+    return err;
+}
+
+int SrsMp4VodMoovCache::size()
+{
+    return (int)lru.size();
+}
+
+int64_t SrsMp4VodMoovCache::bytes()
+{
+    return nn_bytes;
+}
+
+int64_t SrsMp4VodMoovCache::hits()
+{
+    return nn_hits;
+}
+
+int64_t SrsMp4VodMoovCache::misses()
+{
+    return nn_misses;
+}
+
+srs_error_t SrsMp4VodMoovCache::fetch_file(string fullpath, SrsFileReader* fs, SrsMp4VodFile** pfile)
+{
+    srs_error_t err = srs_success;
+    
+    int64_t mtime = 0;
+    struct stat st;
+    if (::stat(fullpath.c_str(), &st) == 0) {
+        mtime = (int64_t)st.st_mtime;
+    }
+    
+    std::map<std::string, std::list<SrsMp4VodFile*>::iterator>::iterator it = indexes.find(fullpath);
+    if (it != indexes.end()) {
+        SrsMp4VodFile* file = *it->second;
+        
+        // Hit, move to the front.
+        if (file->mtime == mtime && file->size == fs->filesize()) {
+            files.splice(files.begin(), files, it->second);
+            *pfile = file;
+            return err;
+        }
+        
+        // The file is changed, drop the stale moov.
+        files.erase(it->second);
+        indexes.erase(it);
+        srs_freep(file);
+        
+        string prefix = fullpath + "|";
+        std::map<std::string, std::list<SrsMp4VodMoov*>::iterator>::iterator mit;
+        for (mit = moovs.lower_bound(prefix); mit != moovs.end() && srs_string_starts_with(mit->first, prefix);) {
+            SrsMp4VodMoov* moov = *mit->second;
+            nn_bytes -= (int64_t)moov->header.size();
+            lru.erase(mit->second);
+            moovs.erase(mit++);
+            srs_freep(moov);
+        }
+    }
+    
+    SrsMp4VodFile* file = new SrsMp4VodFile();
+    if ((err = file->trimmer->initialize(fs)) != srs_success) {
+        srs_freep(file);
+        return srs_error_wrap(err, "load moov of %s", fullpath.c_str());
+    }
+    file->path = fullpath;
+    file->mtime = mtime;
+    file->size = fs->filesize();
+    
+    files.push_front(file);
+    indexes[fullpath] = files.begin();
+    
+    // Evict the least recently used file, its moov are still cached.
+    while ((int)files.size() > SRS_VOD_MOOV_MAX_FILES) {
+        SrsMp4VodFile* last = files.back();
+        indexes.erase(last->path);
+        srs_freep(last);
+        files.pop_back();
+    }
+    
+    *pfile = file;
+    return err;
+}
+
+SrsVodStream::SrsVodStream(string root_dir, SrsFlvVodIndexCache* c) : SrsHttpFileServer(root_dir)
+{
+    cache = c;
+}
+
+SrsVodStream::~SrsVodStream()
+{
+}
+
+srs_error_t SrsVodStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_assert(entry);
+    
+    // The live hls in memory, for example, the m3u8 and ts in window.
+    string upath = r->path();
+    if (srs_string_ends_with(upath, ".m3u8") || srs_string_ends_with(upath, ".ts")) {
+        // The pull-through HLS of edge, never mux the HLS.
+        string vhost;
+        if (_srs_hls_proxy->match(r->host(), vhost)) {
+            return serve_proxy_file(w, r, vhost);
+        }
+        
+        // The hls of mp4 or flv vod file, packaged on the fly.
+        string vod, name;
+        if (_srs_vod_hls->enabled() && SrsVodHlsCache::parse(upath, vod, name)) {
+            return serve_vod_hls(w, r, vod, name);
+        }
+        
+        string fullpath = srs_http_fs_fullpath(dir, entry->pattern, upath);
+        
+        // The LL-HLS blocking playlist reload.
+        SrsHlsPlaylistState state;
+        if (!r->query_get("_HLS_msn").empty() && _srs_hls_memory->fetch_state(fullpath, state)) {
+            return serve_blocking_playlist(w, r, fullpath);
+        }
+        
+        SrsHlsMemoryFile* file = _srs_hls_memory->fetch(fullpath);
+        if (file) {
+            SrsAutoFree(SrsHlsMemoryFile, file);
+            return serve_memory_file(w, r, fullpath, file);
+        }
+        
+        // The LL-HLS preload hint part, which is not ready.
+        if (_srs_hls_memory->is_hint(fullpath)) {
+            return serve_hint_part(w, r, fullpath);
+        }
+    }
+    
+    // The low-latency DASH segment, which is written chunk by chunk.
+    if (srs_string_ends_with(upath, ".m4s")) {
+        string fullpath = srs_http_fs_fullpath(dir, entry->pattern, upath);
+        if (_srs_dash_growing->is_growing(fullpath)) {
+            return serve_growing_segment(w, r, fullpath);
+        }
+    }
+    
+    // The live DASH MPD in memory, which is rarely changed, so revalidated by ETag.
+    if (srs_string_ends_with(upath, ".mpd")) {
+        string fullpath = srs_http_fs_fullpath(dir, entry->pattern, upath);
+        SrsHlsMemoryFile* file = _srs_hls_memory->fetch(fullpath);
+        if (file) {
+            SrsAutoFree(SrsHlsMemoryFile, file);
+            return serve_memory_file(w, r, fullpath, file);
+        }
+    }
+    
+    // The hls and dash files on disk, the not exists file is handled as normal file.
+    if (SrsHttpFileMetaCache::is_cacheable(upath)) {
+        string fullpath = srs_http_fs_fullpath(dir, entry->pattern, upath);
+        
+        SrsHttpFileMeta meta;
+        if (_srs_http_file_meta->fetch(fullpath, meta)) {
+            return serve_cached_file(w, r, fullpath, meta);
+        }
+    }
+    
+    return SrsHttpFileServer::serve_http(w, r);
+}
+
+srs_error_t SrsVodStream::serve_memory_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, SrsHlsMemoryFile* file)
+{
+    srs_error_t err = srs_success;
+    
+    string cc = _srs_http_file_meta->cache_control(fullpath);
+    if (!cc.empty()) {
+        w->header()->set("Cache-Control", cc);
+    }
+    
+    // The playlist is compressed once when updated, send the gzip variant if the client accepts it.
+    const string& gzip = file->gzip();
+    bool gzipped = !gzip.empty() && srs_http_accept_encoding(r->header()->get("Accept-Encoding"), "gzip");
+    if (!gzip.empty()) {
+        w->header()->set("Vary", "Accept-Encoding");
+    }
+    
+    // The client or CDN has the same file, see SrsHttpFileMeta::not_modified.
+    // The variants are different entities, so the ETag of gzip one is suffixed, see RFC7232.
+    string etag = file->etag();
+    if (gzipped && srs_string_ends_with(etag, "\"")) {
+        etag = etag.substr(0, etag.length() - 1) + "-gzip\"";
+    }
+    if (!etag.empty()) {
+        w->header()->set("ETag", etag);
+        
+        string inm = r->header()->get("If-None-Match");
+        if (!inm.empty() && (inm == "*" || inm.find(etag) != string::npos)) {
+            w->write_header(SRS_CONSTS_HTTP_NotModified);
+            
+            if ((err = w->final_request()) != srs_success) {
+                return srs_error_wrap(err, "final request");
+            }
+            return err;
+        }
+    }
+    
+    char* data = file->data();
+    int size = file->size();
+    if (gzipped) {
+        data = (char*)gzip.data();
+        size = (int)gzip.length();
+        w->header()->set("Content-Encoding", "gzip");
+    }
+    
+    w->header()->set_content_length(size);
+    if (srs_string_ends_with(fullpath, ".m3u8")) {
+        w->header()->set_content_type("application/vnd.apple.mpegurl");
+    } else if (srs_string_ends_with(fullpath, ".mpd")) {
+        w->header()->set_content_type("application/dash+xml");
+    } else {
+        w->header()->set_content_type("video/MP2T");
+    }
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    // The bytes are shared, which is alive until the file is freed.
+    if ((err = w->write(data, size)) != srs_success) {
+        return srs_error_wrap(err, "write memory file=%s size=%d", fullpath.c_str(), size);
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodStream::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_http_file_cache->enabled()) {
+        return SrsHttpFileServer::serve_file(w, r, fullpath);
+    }
+    
+    SrsHttpOpenFile* file = NULL;
+    if ((err = _srs_http_file_cache->open(fullpath, &file)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    if (!file) {
+        return SrsHttpNotFoundHandler().serve_http(w, r);
+    }
+    
+    w->header()->set_content_length(file->size);
+    w->header()->set_content_type(srs_http_fs_mime(fullpath));
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    err = send_open_file(w, file);
+    _srs_http_file_cache->release(file);
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "send file=%s", fullpath.c_str());
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodStream::send_open_file(ISrsHttpResponseWriter* w, SrsHttpOpenFile* file)
 {
+    srs_error_t err = srs_success;
+    
+    // The bytes are alive until the file is released.
+    if (file->content) {
+        return w->write(file->content->data(), file->content->size());
+    }
+    
+    // Send the file in kernel, which never changes the position of the shared fd.
+    ISrsHttpSendfileWriter* sw = dynamic_cast<ISrsHttpSendfileWriter*>(w);
+    if (sw && sw->sendfile_enabled()) {
+        return sw->sendfile(file->fd, 0, (int)file->size);
+    }
+    
+    char* buf = new char[SRS_HTTP_FILE_CACHE_BUFFER_SIZE];
+    SrsAutoFreeA(char, buf);
+    
+    int64_t offset = 0;
+    while (offset < file->size) {
+        int max_read = (int)srs_min(file->size - offset, (int64_t)SRS_HTTP_FILE_CACHE_BUFFER_SIZE);
+        ssize_t nread = ::pread(file->fd, buf, max_read, offset);
+        if (nread <= 0) {
+            return srs_error_new(ERROR_SYSTEM_FILE_READ, "pread offset=%d, size=%d", (int)offset, max_read);
+        }
+        
+        offset += nread;
+        if ((err = w->write(buf, (int)nread)) != srs_success) {
+            return srs_error_wrap(err, "write bytes=%d, offset=%d", (int)nread, (int)offset);
+        }
+    }
+    
+    return err;
 }
 
-SrsVodStream::~SrsVodStream()
+srs_error_t SrsVodStream::serve_vod_hls(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string file, string name)
+{
+    srs_error_t err = srs_success;
+    
+    string fullpath = srs_http_fs_fullpath(dir, entry->pattern, file);
+    
+    SrsHlsMemoryFile* hls = NULL;
+    if ((err = _srs_vod_hls->fetch(fullpath, name, &hls)) != srs_success) {
+        return srs_error_wrap(err, "vod hls");
+    }
+    SrsAutoFree(SrsHlsMemoryFile, hls);
+    
+    if (!hls) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_NotFound);
+    }
+    
+    return serve_memory_file(w, r, fullpath + "/" + name, hls);
+}
+
+srs_error_t SrsVodStream::serve_proxy_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string vhost)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHlsMemoryFile* file = NULL;
+    int status = 0;
+    if ((err = _srs_hls_proxy->fetch(vhost, r->path(), &file, &status)) != srs_success) {
+        return srs_error_wrap(err, "hls proxy");
+    }
+    SrsAutoFree(SrsHlsMemoryFile, file);
+    
+    if (!file) {
+        return srs_go_http_error(w, status);
+    }
+    
+    return serve_memory_file(w, r, r->path(), file);
+}
+
+srs_error_t SrsVodStream::serve_cached_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, SrsHttpFileMeta& meta)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpHeader* h = w->header();
+    if (!meta.cache_control.empty()) {
+        h->set("Cache-Control", meta.cache_control);
+    }
+    
+    // The client or CDN has the same file, response without stat or open it.
+    if (meta.not_modified(r)) {
+        h->set("ETag", meta.etag);
+        h->set("Last-Modified", meta.last_modified);
+        w->write_header(SRS_CONSTS_HTTP_NotModified);
+        
+        if ((err = w->final_request()) != srs_success) {
+            return srs_error_wrap(err, "final request");
+        }
+        return err;
+    }
+    
+    if (_srs_http_file_cache->enabled()) {
+        return serve_cached_open_file(w, r, fullpath, meta);
+    }
+    
+    SrsFileReader* fs = fs_factory->create_file_reader();
+    SrsAutoFree(SrsFileReader, fs);
+    
+    // The file is removed after cached, for example, the segment out of window.
+    if ((err = fs->open(fullpath)) != srs_success) {
+        srs_freep(err);
+        _srs_http_file_meta->invalidate(fullpath);
+        return SrsHttpNotFoundHandler().serve_http(w, r);
+    }
+    
+    // The file is changed by others, drop the stale meta and response without validators.
+    int64_t size = fs->filesize();
+    if (size == meta.size) {
+        h->set("ETag", meta.etag);
+        h->set("Last-Modified", meta.last_modified);
+    } else {
+        _srs_http_file_meta->invalidate(fullpath);
+    }
+    
+    h->set_content_length(size);
+    h->set_content_type(meta.content_type);
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    if ((err = copy(w, fs, r, (int)size)) != srs_success) {
+        return srs_error_wrap(err, "copy file=%s size=%d", fullpath.c_str(), (int)size);
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodStream::serve_cached_open_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, SrsHttpFileMeta& meta)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpOpenFile* file = NULL;
+    if ((err = _srs_http_file_cache->open(fullpath, &file)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    
+    // The file is removed after cached, for example, the segment out of window.
+    if (!file) {
+        _srs_http_file_meta->invalidate(fullpath);
+        return SrsHttpNotFoundHandler().serve_http(w, r);
+    }
+    
+    // The file is changed by others, drop the stale meta and response without validators.
+    SrsHttpHeader* h = w->header();
+    if (file->size == meta.size && file->mtime == meta.mtime) {
+        h->set("ETag", meta.etag);
+        h->set("Last-Modified", meta.last_modified);
+    } else {
+        _srs_http_file_meta->invalidate(fullpath);
+    }
+    
+    h->set_content_length(file->size);
+    h->set_content_type(meta.content_type);
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    err = send_open_file(w, file);
+    _srs_http_file_cache->release(file);
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "send file=%s", fullpath.c_str());
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsVodStream::serve_blocking_playlist(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
+{
+    int msn = ::atoi(r->query_get("_HLS_msn").c_str());
+    
+    // The _HLS_part requires _HLS_msn, -1 for the whole segment.
+    int part = -1;
+    if (!r->query_get("_HLS_part").empty()) {
+        part = ::atoi(r->query_get("_HLS_part").c_str());
+    }
+    
+    srs_utime_t starttime = srs_update_monotonic_time();
+    for (;;) {
+        // The stream is disposed, response the playlist if any.
+        SrsHlsPlaylistState state;
+        if (!_srs_hls_memory->fetch_state(fullpath, state)) {
+            break;
+        }
+        
+        // The msn is too far in the future, see LL-HLS 6.2.5.2.
+        if (msn > state.msn + 2) {
+            return srs_go_http_error(w, SRS_CONSTS_HTTP_BadRequest);
+        }
+        
+        if (state.ready(msn, part)) {
+            break;
+        }
+        
+        srs_utime_t elapsed = srs_update_monotonic_time() - starttime;
+        if (elapsed >= state.timeout) {
+            return srs_go_http_error(w, SRS_CONSTS_HTTP_ServiceUnavailable);
+        }
+        
+        _srs_hls_memory->wait(state.timeout - elapsed);
+    }
+    
+    SrsHlsMemoryFile* file = _srs_hls_memory->fetch(fullpath);
+    if (!file) {
+        return SrsHttpNotFoundHandler().serve_http(w, r);
+    }
+    SrsAutoFree(SrsHlsMemoryFile, file);
+    
+    return serve_memory_file(w, r, fullpath, file);
+}
+
+srs_error_t SrsVodStream::serve_hint_part(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
+{
+    srs_utime_t starttime = srs_update_monotonic_time();
+    for (;;) {
+        SrsHlsMemoryFile* file = _srs_hls_memory->fetch(fullpath);
+        if (file) {
+            SrsAutoFree(SrsHlsMemoryFile, file);
+            return serve_memory_file(w, r, fullpath, file);
+        }
+        
+        // Only wait when it's still the hint of any playlist.
+        if (!_srs_hls_memory->is_hint(fullpath)) {
+            break;
+        }
+        
+        srs_utime_t elapsed = srs_update_monotonic_time() - starttime;
+        if (elapsed >= SRS_HLS_HINT_TIMEOUT) {
+            break;
+        }
+        
+        _srs_hls_memory->wait(SRS_HLS_HINT_TIMEOUT - elapsed);
+    }
+    
+    return SrsHttpNotFoundHandler().serve_http(w, r);
+}
+
+srs_error_t SrsVodStream::serve_growing_segment(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
+    srs_error_t err = srs_success;
+    
+    SrsFileReader* fs = fs_factory->create_file_reader();
+    SrsAutoFree(SrsFileReader, fs);
+    
+    if ((err = fs->open(fullpath)) != srs_success) {
+        srs_freep(err);
+        return SrsHttpNotFoundHandler().serve_http(w, r);
+    }
+    
+    // The size is unknown, so response in chunked encoding.
+    w->header()->set_content_type("video/iso.segment");
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    srs_utime_t starttime = srs_update_monotonic_time();
+    for (;;) {
+        // Check the state before the size, so all bytes are sent when segment is complete.
+        bool growing = _srs_dash_growing->is_growing(fullpath);
+        
+        int64_t left = fs->filesize() - fs->tellg();
+        if (left > 0 && (err = copy(w, fs, r, (int)left)) != srs_success) {
+            return srs_error_wrap(err, "copy file=%s size=%d", fullpath.c_str(), (int)left);
+        }
+        
+        if (!growing) {
+            break;
+        }
+        
+        if (srs_update_monotonic_time() - starttime >= SRS_DASH_GROWING_TIMEOUT) {
+            srs_warn("DASH: serve growing %s timeout, offset=%" PRId64, fullpath.c_str(), fs->tellg());
+            break;
+        }
+        
+        // Wait for next chunk, or check the size by interval in case of missing notify.
+        _srs_dash_growing->wait(SRS_DASH_GROWING_INTERVAL);
+    }
+    
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+    
+    return err;
 }
 
 srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int offset)
@@ -76,6 +2103,19 @@ srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
             fullpath.c_str(), fs->filesize(), offset);
     }
     
+    // Use the cached headers, never parse the file again.
+    if (cache) {
+        SrsFlvVodIndex* index = NULL;
+        if ((err = cache->fetch(fullpath, fs, &index)) != srs_success) {
+            return srs_error_wrap(err, "fetch index");
+        }
+        
+        // Copy the headers, for the index maybe evicted when response.
+        string flv_header(index->header, sizeof(index->header));
+        string sh = index->sh;
+        return do_serve_flv_stream(w, r, fs, fullpath, flv_header, sh, offset);
+    }
+    
     SrsFlvVodStreamDecoder ffd;
     
     // open fast decoder
@@ -92,7 +2132,6 @@ srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
     }
     
     // save sequence header, send later
-    char* sh_data = NULL;
     int sh_size = 0;
     
     if (true) {
@@ -105,31 +2144,71 @@ srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
             return srs_error_new(ERROR_HTTP_REMUX_SEQUENCE_HEADER, "no sequence, size=%d", sh_size);
         }
     }
-    sh_data = new char[sh_size];
-    SrsAutoFreeA(char, sh_data);
-    if ((err = fs->read(sh_data, sh_size, NULL)) != srs_success) {
+    string sh(sh_size, 0);
+    if ((err = fs->read(&sh[0], sh_size, NULL)) != srs_success) {
         return srs_error_wrap(err, "fs read");
     }
     
+    return do_serve_flv_stream(w, r, fs, fullpath, string(flv_header, sizeof(flv_header)), sh, offset);
+}
+
+srs_error_t SrsVodStream::serve_flv_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t starttime)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileReader* fs = fs_factory->create_file_reader();
+    SrsAutoFree(SrsFileReader, fs);
+    
+    // open flv file
+    if ((err = fs->open(fullpath)) != srs_success) {
+        return srs_error_wrap(err, "open file");
+    }
+    
+    // Without cache, build a temporary index for this request.
+    SrsFlvVodIndex tmp;
+    SrsFlvVodIndex* index = &tmp;
+    if (cache) {
+        if ((err = cache->fetch(fullpath, fs, &index)) != srs_success) {
+            return srs_error_wrap(err, "fetch index");
+        }
+    } else if ((err = tmp.initialize(fullpath, fs)) != srs_success) {
+        return srs_error_wrap(err, "build index");
+    }
+    
+    int64_t offset = index->seek(starttime);
+    
+    // Copy the headers, for the index maybe evicted when response.
+    string flv_header(index->header, sizeof(index->header));
+    string sh = index->sh;
+    return do_serve_flv_stream(w, r, fs, fullpath, flv_header, sh, offset);
+}
+
+srs_error_t SrsVodStream::do_serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsFileReader* fs, string fullpath, string flv_header, string sh, int64_t offset)
+{
+    srs_error_t err = srs_success;
+    
     // seek to data offset
     int64_t left = fs->filesize() - offset;
     
     // write http header for ts.
-    w->header()->set_content_length((int)(sizeof(flv_header) + sh_size + left));
+    w->header()->set_content_length((int)(flv_header.size() + sh.size() + left));
     w->header()->set_content_type("video/x-flv");
     w->write_header(SRS_CONSTS_HTTP_OK);
     
     // write flv header and sequence header.
-    if ((err = w->write(flv_header, sizeof(flv_header))) != srs_success) {
+    if ((err = w->write((char*)flv_header.data(), (int)flv_header.size())) != srs_success) {
         return srs_error_wrap(err, "write flv header");
     }
-    if (sh_size > 0 && (err = w->write(sh_data, sh_size)) != srs_success) {
+    if (!sh.empty() && (err = w->write((char*)sh.data(), (int)sh.size())) != srs_success) {
         return srs_error_wrap(err, "write sequence");
     }
     
     // write body.
-    if ((err = ffd.seek2(offset)) != srs_success) {
-        return srs_error_wrap(err, "ffd seek");
+    if (offset >= fs->filesize()) {
+        return srs_error_new(ERROR_SYSTEM_FILE_EOF, "flv seek overflow file, size=%d, offset=%d", (int)fs->filesize(), (int)offset);
+    }
+    if (fs->seek2(offset) < 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_SEEK, "flv seek error, size=%d, offset=%d", (int)fs->filesize(), (int)offset);
     }
     
     // send data
@@ -190,22 +2269,106 @@ srs_error_t SrsVodStream::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
     return err;
 }
 
+srs_error_t SrsVodStream::serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t starttime)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFileReader* fs = fs_factory->create_file_reader();
+    SrsAutoFree(SrsFileReader, fs);
+    
+    if ((err = fs->open(fullpath)) != srs_success) {
+        return srs_error_wrap(err, "fs open");
+    }
+    
+    SrsMp4VodMoov* moov = NULL;
+    if ((err = _srs_vod_moov->fetch(fullpath, fs, starttime, &moov)) != srs_success) {
+        return srs_error_wrap(err, "mp4 seek to %dms", srsu2msi(starttime));
+    }
+    SrsAutoFree(SrsMp4VodMoov, moov);
+    
+    if (moov->end > fs->filesize() || moov->start > moov->end) {
+        return srs_error_new(ERROR_HTTP_REMUX_OFFSET_OVERFLOW, "http mp4 seek %s overflow. size=%" PRId64 ", range=%" PRId64 "-%" PRId64,
+            fullpath.c_str(), fs->filesize(), moov->start, moov->end);
+    }
+    
+    // The trimmed mp4 is a new document, so response the whole of it.
+    int64_t left = moov->end - moov->start;
+    w->header()->set_content_length((int64_t)moov->header.size() + left);
+    w->header()->set_content_type("video/mp4");
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    if ((err = w->write((char*)moov->header.data(), (int)moov->header.size())) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+    
+    fs->seek2(moov->start);
+    
+    if ((err = copy(w, fs, r, (int)left)) != srs_success) {
+        return srs_error_wrap(err, "read mp4=%s size=%" PRId64, fullpath.c_str(), left);
+    }
+    
+    return err;
+}
+
 SrsHttpStaticServer::SrsHttpStaticServer(SrsServer* svr)
 {
     server = svr;
+    cache = NULL;
+    
+    mux.hijack(this);
     _srs_config->subscribe(this);
 }
 
 SrsHttpStaticServer::~SrsHttpStaticServer()
 {
+    mux.unhijack(this);
     _srs_config->unsubscribe(this);
+    srs_freep(cache);
 }
 
 srs_error_t SrsHttpStaticServer::initialize()
 {
     srs_error_t err = srs_success;
     
+    // The keyframe index cache for flv vod stream, shared by all vhosts.
+    int max_files = _srs_config->get_http_stream_vod_index_cache();
+    if (max_files > 0 && !cache) {
+        cache = new SrsFlvVodIndexCache(max_files);
+        srs_trace("http: flv vod index cache max_files=%d", max_files);
+    }
+    
+    // The Cache-Control of hls and dash files, shared by all vhosts.
+    int max_age = _srs_config->get_http_stream_segment_max_age();
+    _srs_http_file_meta->set_max_age(max_age);
+    
+    // The cache of opened files, shared by all vhosts.
+    int max_fds = _srs_config->get_http_stream_file_cache_fds();
+    srs_utime_t valid = _srs_config->get_http_stream_file_cache_valid();
+    int64_t max_size = (int64_t)_srs_config->get_http_stream_file_cache_max_size() * 1024;
+    int64_t max_memory = (int64_t)_srs_config->get_http_stream_file_cache_memory() * 1024 * 1024;
+    _srs_http_file_cache->set_limits(max_fds, valid, max_size, max_memory);
+    if (max_fds > 0) {
+        srs_trace("http: file cache max_fds=%d, valid=%dms, max_size=%" PRId64 ", memory=%" PRId64,
+            max_fds, srsu2msi(valid), max_size, max_memory);
+    }
+    
+    // The vod hls packaged on the fly, shared by all vhosts.
+    int max_segments = _srs_config->get_http_stream_vod_hls_cache();
+    srs_utime_t fragment = _srs_config->get_http_stream_vod_hls_fragment();
+    _srs_vod_hls->set_capacity(max_segments, fragment);
+    if (max_segments > 0) {
+        srs_trace("http: vod hls cache max_segments=%d, fragment=%dms", max_segments, srsu2msi(fragment));
+    }
+    
+    // The trimmed moov for mp4 pseudo-streaming, shared by all vhosts.
+    int max_moovs = _srs_config->get_http_stream_vod_moov_cache();
+    _srs_vod_moov->set_capacity(max_moovs);
+    if (max_moovs > 0) {
+        srs_trace("http: vod moov cache max_moovs=%d", max_moovs);
+    }
+    
     bool default_root_exists = false;
+    bool lazy = _srs_config->get_http_stream_lazy_mount();
     
     // http static file and flv vod stream mount for each vhost.
     SrsConfDirective* root = _srs_config->get_root();
@@ -218,6 +2381,17 @@ srs_error_t SrsHttpStaticServer::initialize()
         
         string pmount;
         string vhost = conf->arg0();
+        
+        // For the pull-through HLS of edge vhost.
+        _srs_hls_proxy->update(vhost);
+        
+        // For the mount of vhost, we find the vhost by the host of request, so mount it when used.
+        std::string mount = lazy? vhost_mount(vhost) : "";
+        if (!mount.empty() && mount.at(0) != '/') {
+            lazy_vhosts.insert(vhost);
+            continue;
+        }
+        
         if ((err = mount_vhost(vhost, pmount)) != srs_success) {
             return srs_error_wrap(err, "mount vhost");
         }
@@ -232,12 +2406,16 @@ srs_error_t SrsHttpStaticServer::initialize()
     if (!default_root_exists) {
         // add root
         std::string dir = _srs_config->get_http_stream_dir();
-        if ((err = mux.handle("/", new SrsVodStream(dir))) != srs_success) {
+        if ((err = mux.handle("/", new SrsVodStream(dir, cache))) != srs_success) {
             return srs_error_wrap(err, "mount root dir=%s", dir.c_str());
         }
         srs_trace("http: root mount to %s", dir.c_str());
     }
     
+    if (!lazy_vhosts.empty()) {
+        srs_trace("http: lazy mount %d vhosts", (int)lazy_vhosts.size());
+    }
+    
     return err;
 }
 
@@ -245,22 +2423,41 @@ srs_error_t SrsHttpStaticServer::mount_vhost(string vhost, string& pmount)
 {
     srs_error_t err = srs_success;
     
+    std::string mount = vhost_mount(vhost);
+    if (mount.empty()) {
+        return err;
+    }
+    
+    std::string dir = _srs_config->get_vhost_http_dir(vhost);
+    dir = srs_string_replace(dir, "[vhost]", vhost);
+    
+    // mount the http of vhost.
+    if ((err = mux.handle(mount, new SrsVodStream(dir, cache))) != srs_success) {
+        return srs_error_wrap(err, "mux handle");
+    }
+    srs_trace("http: vhost=%s mount to %s at %s", vhost.c_str(), mount.c_str(), dir.c_str());
+    
+    pmount = mount;
+    
+    return err;
+}
+
+string SrsHttpStaticServer::vhost_mount(string vhost)
+{
     // when vhost disabled, ignore.
     if (!_srs_config->get_vhost_enabled(vhost)) {
-        return err;
+        return "";
     }
     
     // when vhost http_static disabled, ignore.
     if (!_srs_config->get_vhost_http_enabled(vhost)) {
-        return err;
+        return "";
     }
     
     std::string mount = _srs_config->get_vhost_http_mount(vhost);
-    std::string dir = _srs_config->get_vhost_http_dir(vhost);
     
     // replace the vhost variable
     mount = srs_string_replace(mount, "[vhost]", vhost);
-    dir = srs_string_replace(dir, "[vhost]", vhost);
     
     // remove the default vhost mount
     mount = srs_string_replace(mount, SRS_CONSTS_RTMP_DEFAULT_VHOST"/", "/");
@@ -270,21 +2467,41 @@ srs_error_t SrsHttpStaticServer::mount_vhost(string vhost, string& pmount)
         mount += "/";
     }
     
-    // mount the http of vhost.
-    if ((err = mux.handle(mount, new SrsVodStream(dir))) != srs_success) {
-        return srs_error_wrap(err, "mux handle");
+    return mount;
+}
+
+srs_error_t SrsHttpStaticServer::hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph)
+{
+    srs_error_t err = srs_success;
+    
+    if (lazy_vhosts.empty()) {
+        return err;
     }
-    srs_trace("http: vhost=%s mount to %s at %s", vhost.c_str(), mount.c_str(), dir.c_str());
     
-    pmount = mount;
+    std::set<std::string>::iterator it = lazy_vhosts.find(request->host());
+    if (it == lazy_vhosts.end()) {
+        return err;
+    }
     
-    return err;
+    // Mount the vhost for the first request, then find the handler again, which never hijacks
+    // again for the vhost is mounted.
+    std::string vhost = *it;
+    lazy_vhosts.erase(it);
+    
+    string pmount;
+    if ((err = mount_vhost(vhost, pmount)) != srs_success) {
+        return srs_error_wrap(err, "lazy mount vhost %s", vhost.c_str());
+    }
+    
+    return mux.find_handler(request, ph);
 }
 
 srs_error_t SrsHttpStaticServer::on_reload_vhost_added(string vhost)
 {
     srs_error_t err = srs_success;
     
+    _srs_hls_proxy->update(vhost);
+    
     string pmount;
     if ((err = mount_vhost(vhost, pmount)) != srs_success) {
         return srs_error_wrap(err, "mount vhost");
@@ -26,28 +26,473 @@
 
 #include <srs_core.hpp>
 
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+
 #include <srs_app_http_conn.hpp>
 
+class SrsFileReader;
+class SrsHlsMemoryFile;
+class ISrsLoadBalancer;
+class ISrsStreamWriter;
+class SrsMp4Decoder;
+class SrsMp4MoovTrimmer;
+class SrsJsonObject;
+
+// The keyframe index of a flv vod file, which maps the keyframe time to the file offset,
+// and keeps the flv header and sequence header, so the vod stream is served without
+// parsing the file again.
+class SrsFlvVodIndex
+{
+public:
+    std::string path;
+    // The mtime and size of file, to identify whether the file is changed.
+    int64_t mtime;
+    int64_t size;
+    // The flv header, 9bytes header and 4bytes previous tag size.
+    char header[13];
+    // The sequence header tags, (tag header)+(tag body)+(4bytes previous tag size).
+    std::string sh;
+    // The offset of the first tag after sequence header.
+    int64_t data_offset;
+    // The seek points, the timestamp in ms and its offset of tag header.
+    std::vector<int64_t> times;
+    std::vector<int64_t> offsets;
+public:
+    SrsFlvVodIndex();
+    virtual ~SrsFlvVodIndex();
+public:
+    // Build the index from the opened file.
+    virtual srs_error_t initialize(std::string fullpath, SrsFileReader* fs);
+    // Whether the index is built for the current file.
+    virtual bool match(int64_t fmtime, int64_t fsize);
+    // Get the offset of the seek point at or before the starttime.
+    virtual int64_t seek(srs_utime_t starttime);
+};
+
+// The LRU cache of flv vod index, keyed by the file path.
+class SrsFlvVodIndexCache
+{
+private:
+    int capacity;
+    // The most recently used index is at the front.
+    std::list<SrsFlvVodIndex*> lru;
+    std::map<std::string, std::list<SrsFlvVodIndex*>::iterator> indexes;
+public:
+    SrsFlvVodIndexCache(int max_files);
+    virtual ~SrsFlvVodIndexCache();
+public:
+    // Fetch the index of file, build it when not cached or file changed.
+    // @param fs The opened reader of file, which position is changed when build index.
+    // @param pindex Output the cached index, user should never free it.
+    // @remark The index might be freed when evict from cache, so never use it after yield.
+    virtual srs_error_t fetch(std::string fullpath, SrsFileReader* fs, SrsFlvVodIndex** pindex);
+    // The number of cached index.
+    virtual int size();
+};
+
+// The metadata of hls or dash file on disk, to serve the conditional request without stat the file.
+class SrsHttpFileMeta
+{
+public:
+    int64_t size;
+    // The mtime in us, to identify the file rewritten in the same second.
+    int64_t mtime;
+    // The prebuilt response headers.
+    std::string etag;
+    std::string last_modified;
+    std::string content_type;
+    // Empty to not response the Cache-Control.
+    std::string cache_control;
+    // The meta is expired after this time, to detect the file changed by others.
+    srs_utime_t expired;
+public:
+    SrsHttpFileMeta();
+    virtual ~SrsHttpFileMeta();
+public:
+    // Whether the conditional request matches the file, by If-None-Match or If-Modified-Since.
+    virtual bool not_modified(ISrsHttpMessage* r);
+};
+
+// The cache of hls and dash file meta, keyed by the normalized file path.
+// The muxer invalidates the meta when it writes or removes the file, and the meta is also expired
+// by a short ttl, for the file changed by others.
+class SrsHttpFileMetaCache
+{
+private:
+    std::map<std::string, SrsHttpFileMeta> metas;
+    // The max-age in seconds for the immutable segments, 0 to not response the Cache-Control.
+    int max_age;
+    int64_t nn_hits;
+    int64_t nn_misses;
+public:
+    SrsHttpFileMetaCache();
+    virtual ~SrsHttpFileMetaCache();
+public:
+    // Whether the file is served with the meta cache, that is, the m3u8, ts, mpd and m4s.
+    static bool is_cacheable(std::string path);
+    // Get the Cache-Control of file, "no-cache" for playlists and max-age for segments.
+    virtual std::string cache_control(std::string path);
+    virtual void set_max_age(int v);
+    // Fetch the meta of file, stat the file when not cached or expired.
+    // @return false if file not exists.
+    virtual bool fetch(std::string fullpath, SrsHttpFileMeta& meta);
+    // Drop the meta of file, when the file is written or removed.
+    virtual void invalidate(std::string path);
+    // The number of cached meta.
+    virtual int size();
+};
+
+// The global meta cache of hls and dash files.
+extern SrsHttpFileMetaCache* _srs_http_file_meta;
+
+// The opened file in cache, shared by the concurrent requests.
+class SrsHttpOpenFile
+{
+public:
+    std::string path;
+    // The fd of file, -1 if the file is cached in memory.
+    int fd;
+    // The size, mtime in us and inode of file, to identify whether the file is changed.
+    int64_t size;
+    int64_t mtime;
+    int64_t inode;
+    // The content of small file, NULL if not cached in memory.
+    SrsHlsMemoryFile* content;
+    // The file is validated by stat after this time.
+    srs_utime_t expired;
+    // The number of requests using the file, which is closed when evicted and not used.
+    int refs;
+    bool evicted;
+public:
+    SrsHttpOpenFile();
+    virtual ~SrsHttpOpenFile();
+};
+
+// The LRU cache of opened files for the http static server, keyed by the normalized file path,
+// and the small files are also cached in memory, so the hot files are served without open, stat
+// and read the file for each request.
+class SrsHttpFileCache
+{
+private:
+    // The max number of files, 0 to disable.
+    int max_files;
+    // The period to validate the file by stat.
+    srs_utime_t valid;
+    // The max size of file and the max total bytes to cache in memory.
+    int64_t max_size;
+    int64_t max_memory;
+private:
+    // The most recently used file is at the front.
+    std::list<SrsHttpOpenFile*> lru;
+    std::map<std::string, std::list<SrsHttpOpenFile*>::iterator> files;
+    int64_t nn_memory;
+    int64_t nn_hits;
+    int64_t nn_misses;
+    int64_t nn_memory_hits;
+    int64_t nn_validations;
+    int64_t nn_changes;
+    int64_t nn_evictions;
+public:
+    SrsHttpFileCache();
+    virtual ~SrsHttpFileCache();
+public:
+    virtual void set_limits(int max_files, srs_utime_t valid, int64_t max_size, int64_t max_memory);
+    virtual bool enabled();
+    // Open the file, or use the cached one.
+    // @param pfile Output the opened file, NULL if not exists, user must release it.
+    virtual srs_error_t open(std::string fullpath, SrsHttpOpenFile** pfile);
+    // Release the file opened by cache.
+    virtual void release(SrsHttpOpenFile* file);
+    // Drop the file, when it's written or removed.
+    virtual void invalidate(std::string path);
+    // The number of cached files, and bytes in memory.
+    virtual int size();
+    virtual int64_t memory();
+    virtual void dumps(SrsJsonObject* obj);
+private:
+    virtual srs_error_t do_open(std::string fullpath, SrsHttpOpenFile** pfile);
+    virtual void evict(std::list<SrsHttpOpenFile*>::iterator it);
+};
+
+// The global cache of opened files for http static server.
+extern SrsHttpFileCache* _srs_http_file_cache;
+
+// The hls file proxied from origin, shared by the concurrent requests of the same file.
+class SrsHlsProxyFile
+{
+public:
+    // The file from origin, NULL if origin responses error.
+    SrsHlsMemoryFile* file;
+    // The status of origin response, 0 if never fetched.
+    int status;
+    // The file is expired after this time, and fetched from origin again.
+    srs_utime_t expired;
+    // Whether fetching the file from origin, the other requests wait for it.
+    bool fetching;
+    // The number of requests waiting for the fetching.
+    int nn_waiting;
+    srs_cond_t cond;
+public:
+    SrsHlsProxyFile();
+    virtual ~SrsHlsProxyFile();
+};
+
+// The pull-through HLS of edge, the m3u8 and ts are proxied to origin and cached in memory, keyed by
+// the vhost and path. For the concurrent requests of the same file, only one request is sent to origin.
+class SrsHlsProxyCache
+{
+private:
+    std::map<std::string, SrsHlsProxyFile*> files;
+    // The edge vhosts which proxy the HLS to origin.
+    std::set<std::string> vhosts;
+    // The load balancer of origins, for each vhost.
+    std::map<std::string, ISrsLoadBalancer*> lbs;
+    int64_t nn_bytes;
+    // The time to cleanup the expired files.
+    srs_utime_t cleanup_at;
+    int64_t nn_hits;
+    int64_t nn_misses;
+    int64_t nn_coalesced;
+public:
+    SrsHlsProxyCache();
+    virtual ~SrsHlsProxyCache();
+public:
+    // Enable or disable the proxy of vhost by config, when mount the vhost.
+    virtual void update(std::string vhost);
+    // Match the vhost of request host, which proxies the HLS to origin.
+    // @return false if not proxy, without looking up the config for the vhost not edge.
+    virtual bool match(std::string host, std::string& vhost);
+    // Fetch the file of path, from origin when not cached or expired.
+    // @param pfile Output a copy of file, NULL if origin responses error.
+    // @param pstatus Output the status of origin response.
+    // @remark User must free the file.
+    virtual srs_error_t fetch(std::string vhost, std::string upath, SrsHlsMemoryFile** pfile, int* pstatus);
+    // The number of files and total bytes in cache.
+    virtual int size();
+    virtual int64_t bytes();
+private:
+    virtual srs_error_t do_fetch(std::string vhost, std::string upath, SrsHlsMemoryFile** pfile, int* pstatus);
+    virtual void cleanup(srs_utime_t now);
+};
+
+// The global cache of HLS proxied from origin for edge.
+extern SrsHlsProxyCache* _srs_hls_proxy;
+
+// The segments of a mp4 or flv vod file, for the hls packaged on the fly, which are cut at the
+// seek points(keyframes) by the fragment, and muxed to ts when requested.
+class SrsVodHlsIndex
+{
+public:
+    std::string path;
+    // The mtime and size of file, to identify whether the file is changed.
+    int64_t mtime;
+    int64_t size;
+    // The start time in ms of segments, and the duration of file as the end of the last one.
+    std::vector<int64_t> times;
+    // For flv, the offset of the first tag of segments, and the size of file as the end of the last one.
+    std::vector<int64_t> offsets;
+    // For flv, the sequence header tags, (tag header)+(tag body)+(4bytes previous tag size).
+    std::string sh;
+    // The m3u8 of segments, generated when build the index.
+    SrsHlsMemoryFile* m3u8;
+private:
+    // For mp4, the opened file and demuxer, because the moov is too large to parse for each segment.
+    SrsFileReader* fs;
+    SrsMp4Decoder* dec;
+public:
+    SrsVodHlsIndex();
+    virtual ~SrsVodHlsIndex();
+public:
+    // Build the index of file, which is mp4 or flv by the extension.
+    virtual srs_error_t initialize(std::string fullpath, srs_utime_t fragment);
+    // Cut the segments at the seek points, each segment is not shorter than the fragment except the last one.
+    // @param points The seek points in ms, the first segment always starts at 0.
+    // @return The index of seek point of each segment, -1 for the start of file.
+    virtual std::vector<int> cut(const std::vector<int64_t>& points, int64_t duration, srs_utime_t fragment);
+    // The number of segments.
+    virtual int nb_segments();
+    // Mux the segment to ts.
+    virtual srs_error_t mux(int seq, ISrsStreamWriter* w);
+private:
+    virtual srs_error_t initialize_flv(std::string fullpath, srs_utime_t fragment);
+    virtual srs_error_t initialize_mp4(std::string fullpath, srs_utime_t fragment);
+    virtual void generate_m3u8();
+    virtual srs_error_t mux_flv(int seq, ISrsStreamWriter* w);
+    virtual srs_error_t mux_mp4(int seq, ISrsStreamWriter* w);
+};
+
+// The hls of mp4 and flv vod files packaged on the fly, for example, file.mp4/index.m3u8
+// and file.mp4/seg-0.ts, the index of files and the hot segments are cached by LRU.
+class SrsVodHlsCache
+{
+private:
+    // The max number of segments, 0 to disable.
+    int capacity;
+    srs_utime_t fragment;
+    // The most recently used index is at the front.
+    std::list<SrsVodHlsIndex*> files;
+    std::map<std::string, std::list<SrsVodHlsIndex*>::iterator> indexes;
+    // The most recently used segment is at the front, keyed by the path of file and the seq.
+    std::list<std::pair<std::string, SrsHlsMemoryFile*> > lru;
+    std::map<std::string, std::list<std::pair<std::string, SrsHlsMemoryFile*> >::iterator> segments;
+    int64_t nn_bytes;
+public:
+    SrsVodHlsCache();
+    virtual ~SrsVodHlsCache();
+public:
+    // Set the max number of segments, and the duration of segment.
+    virtual void set_capacity(int max_segments, srs_utime_t fragment);
+    virtual bool enabled();
+    // Parse the request path, for example, /vod/file.mp4/seg-0.ts, to the file /vod/file.mp4
+    // and the name seg-0.ts, where the name is index.m3u8 or seg-N.ts.
+    // @return false if not vod hls.
+    static bool parse(std::string upath, std::string& file, std::string& name);
+    // Fetch the m3u8 or segment of vod file, package it when not cached or file changed.
+    // @param pfile Output a copy of file, NULL if not found, user must free it.
+    virtual srs_error_t fetch(std::string fullpath, std::string name, SrsHlsMemoryFile** pfile);
+    // The number of cached segments and their total bytes.
+    virtual int size();
+    virtual int64_t bytes();
+private:
+    virtual srs_error_t fetch_index(std::string fullpath, SrsVodHlsIndex** pindex);
+    virtual void evict(std::string fullpath);
+};
+
+// The global cache of vod hls packaged on the fly.
+extern SrsVodHlsCache* _srs_vod_hls;
+
+// The mp4 vod file with the moov loaded, to trim the moov for each start time.
+class SrsMp4VodFile
+{
+public:
+    std::string path;
+    // The mtime and size of file, to identify whether the file is changed.
+    int64_t mtime;
+    int64_t size;
+    SrsMp4MoovTrimmer* trimmer;
+public:
+    SrsMp4VodFile();
+    virtual ~SrsMp4VodFile();
+};
+
+// The trimmed moov of mp4 vod file, to start at a keyframe.
+class SrsMp4VodMoov
+{
+public:
+    // The key of file and keyframe, @see SrsMp4VodMoovCache
+    std::string key;
+    // The ftyp, trimmed moov and mdat header, to send before the samples.
+    std::string header;
+    // The range of samples in file [start, end), to send after the header.
+    int64_t start;
+    int64_t end;
+public:
+    SrsMp4VodMoov();
+    virtual ~SrsMp4VodMoov();
+};
+
+// The pseudo-streaming of mp4 vod files, for example, x.mp4?start=60, the trimmed moov is cached by LRU,
+// keyed by the file and the keyframe to start, and the moov of the hot files are kept loaded, so the seek
+// is served in one round trip, without parsing the moov for each request.
+class SrsMp4VodMoovCache
+{
+private:
+    // The max number of trimmed moov, 0 to disable.
+    int capacity;
+    // The most recently used file is at the front.
+    std::list<SrsMp4VodFile*> files;
+    std::map<std::string, std::list<SrsMp4VodFile*>::iterator> indexes;
+    // The most recently used moov is at the front.
+    std::list<SrsMp4VodMoov*> lru;
+    std::map<std::string, std::list<SrsMp4VodMoov*>::iterator> moovs;
+    int64_t nn_bytes;
+    int64_t nn_hits;
+    int64_t nn_misses;
+public:
+    SrsMp4VodMoovCache();
+    virtual ~SrsMp4VodMoovCache();
+public:
+    // Set the max number of trimmed moov, 0 to disable.
+    virtual void set_capacity(int v);
+    virtual bool enabled();
+    // Fetch the trimmed moov of file, to start at the keyframe at or before the starttime.
+    // @param fs The opened reader of file, to load the moov when not cached or file changed.
+    // @param pmoov Output a copy of moov, user must free it.
+    virtual srs_error_t fetch(std::string fullpath, SrsFileReader* fs, srs_utime_t starttime, SrsMp4VodMoov** pmoov);
+    // The number of cached moov and their total bytes.
+    virtual int size();
+    virtual int64_t bytes();
+    virtual int64_t hits();
+    virtual int64_t misses();
+private:
+    virtual srs_error_t fetch_file(std::string fullpath, SrsFileReader* fs, SrsMp4VodFile** pfile);
+};
+
+// The global cache of trimmed moov for mp4 pseudo-streaming.
+extern SrsMp4VodMoovCache* _srs_vod_moov;
+
 // The flv vod stream supports flv?start=offset-bytes.
 // For example, http://server/file.flv?start=10240
 // server will write flv header and sequence header,
 // then seek(10240) and response flv tag data.
+// It also supports flv?starttime=seconds, which seeks to the keyframe before it,
+// and mp4?start=seconds, which responses the moov trimmed to start at the keyframe before it.
 class SrsVodStream : public SrsHttpFileServer
 {
+private:
+    // The index cache, owned by the static server, NULL to disable.
+    SrsFlvVodIndexCache* cache;
 public:
-    SrsVodStream(std::string root_dir);
+    SrsVodStream(std::string root_dir, SrsFlvVodIndexCache* c = NULL);
     virtual ~SrsVodStream();
+// Interface ISrsHttpHandler
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    // Serve the live hls in memory, without disk io.
+    virtual srs_error_t serve_memory_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, SrsHlsMemoryFile* file);
+    // Serve the static file by the cache of opened files.
+    virtual srs_error_t serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+    // Response the content of file opened by cache, in memory or by sendfile.
+    virtual srs_error_t send_open_file(ISrsHttpResponseWriter* w, SrsHttpOpenFile* file);
+    // Serve the vod hls of mp4 or flv file, packaged on the fly.
+    virtual srs_error_t serve_vod_hls(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string file, std::string name);
+    // For edge, serve the m3u8 or ts proxied from origin.
+    virtual srs_error_t serve_proxy_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string vhost);
+    // Serve the hls or dash file on disk with the cached meta, response 304 without stat for conditional request.
+    virtual srs_error_t serve_cached_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, SrsHttpFileMeta& meta);
+    virtual srs_error_t serve_cached_open_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, SrsHttpFileMeta& meta);
+    // For LL-HLS, hold the playlist request until the part is ready, by _HLS_msn and _HLS_part.
+    virtual srs_error_t serve_blocking_playlist(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+    // For LL-HLS, hold the request of the preload hint part until it's ready.
+    virtual srs_error_t serve_hint_part(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+    // For low-latency DASH, serve the growing segment in chunked encoding, until it's complete.
+    virtual srs_error_t serve_growing_segment(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
 protected:
     virtual srs_error_t serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
+    virtual srs_error_t serve_flv_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t starttime);
+private:
+    // Response the flv header, sequence header, and the tags from offset to end of file.
+    virtual srs_error_t do_serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsFileReader* fs, std::string fullpath,
+        std::string flv_header, std::string sh, int64_t offset);
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
+protected:
+    virtual srs_error_t serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t starttime);
 };
 
 // The http static server instance,
 // serve http static file and flv/mp4 vod stream.
-class SrsHttpStaticServer : virtual public ISrsReloadHandler
+class SrsHttpStaticServer : virtual public ISrsReloadHandler, public ISrsHttpMatchHijacker
 {
 private:
     SrsServer* server;
+    SrsFlvVodIndexCache* cache;
+    // The vhosts to mount when the first request, by config lazy_mount.
+    std::set<std::string> lazy_vhosts;
 public:
     SrsHttpServeMux mux;
 public:
@@ -57,6 +502,11 @@ public:
     virtual srs_error_t initialize();
 private:
     virtual srs_error_t mount_vhost(std::string vhost, std::string& pmount);
+    // Get the mount of vhost, empty if not mount.
+    virtual std::string vhost_mount(std::string vhost);
+// Interface ISrsHttpMatchHijacker
+public:
+    virtual srs_error_t hijack(ISrsHttpMessage* request, ISrsHttpHandler** ph);
 // Interface ISrsReloadHandler.
 public:
     virtual srs_error_t on_reload_vhost_added(std::string vhost);
@@ -23,7 +23,15 @@
 
 #include <srs_app_http_stream.hpp>
 
-#define SRS_STREAM_CACHE_CYCLE (30 * SRS_UTIME_SECONDS)
+
+// When error, the shared live stream sleep for a while and retry.
+#define SRS_LIVE_SHARED_CIMS (3 * SRS_UTIME_SECONDS)
+// The max chunks of shared live stream, about 60s for 25fps video with 44.1kHz AAC.
+#define SRS_LIVE_SHARED_MAX_CHUNKS 4096
+// For pure audio, the interval in ms of key chunk, to write PAT/PMT for new player to start.
+#define SRS_TS_SHARED_AUDIO_KEY_INTERVAL 1000
+// The default interval in ms of key chunk for AAC and MP3, when no fast cache.
+#define SRS_AUDIO_SHARED_KEY_INTERVAL 1000
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -31,6 +39,7 @@
 #include <stdlib.h>
 
 #include <sstream>
+#include <map>
 using namespace std;
 
 #include <srs_protocol_stream.hpp>
@@ -49,105 +58,190 @@ using namespace std;
 #include <srs_kernel_aac.hpp>
 #include <srs_kernel_mp3.hpp>
 #include <srs_kernel_ts.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_codec.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_hourglass.hpp>
 #include <srs_app_recv_thread.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_app_overload.hpp>
+#include <srs_kernel_balance.hpp>
+#include <srs_app_abr.hpp>
+#include <srs_app_fanout.hpp>
+#include <srs_app_security.hpp>
+
+// The servers to redirect the players rejected by admission control, selected by round robin.
+static SrsLbRoundRobin _srs_admission_lb;
+
 
-SrsBufferCache::SrsBufferCache(SrsSource* s, SrsRequest* r)
+SrsLiveSharedStream::SrsLiveSharedStream(string n, SrsSource* s, SrsRequest* r)
 {
     req = r->copy()->as_http();
     source = s;
-    queue = new SrsMessageQueue(true);
-    trd = new SrsSTCoroutine("http-stream", this);
+    name = n;
+    trd = new SrsSTCoroutine(name, this);
+    nn_players = 0;
+    max_chunks = SRS_LIVE_SHARED_MAX_CHUNKS;
     
-    // TODO: FIXME: support reload.
-    fast_cache = _srs_config->get_vhost_http_remux_fast_cache(req->vhost);
+    base = 0;
+    key = -1;
+    header = NULL;
 }
 
-SrsBufferCache::~SrsBufferCache()
+SrsLiveSharedStream::~SrsLiveSharedStream()
 {
     srs_freep(trd);
     
-    srs_freep(queue);
+    std::deque<SrsSharedPtrMessage*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    chunks.clear();
+    
+    srs_freep(header);
     srs_freep(req);
 }
 
-srs_error_t SrsBufferCache::update(SrsSource* s, SrsRequest* r)
+srs_error_t SrsLiveSharedStream::update(SrsSource* s, SrsRequest* r)
 {
     srs_freep(req);
-    req = r->copy();
+    req = r->copy()->as_http();
     source = s;
     
     return srs_success;
 }
 
-srs_error_t SrsBufferCache::start()
+srs_error_t SrsLiveSharedStream::attach()
 {
     srs_error_t err = srs_success;
     
+    if (nn_players > 0) {
+        nn_players++;
+        return err;
+    }
+    
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "corotine");
     }
+    nn_players++;
     
     return err;
 }
 
-srs_error_t SrsBufferCache::dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter)
+void SrsLiveSharedStream::detach()
 {
-    srs_error_t err = srs_success;
+    if (nn_players <= 0 || --nn_players > 0) {
+        return;
+    }
     
-    if (fast_cache <= 0) {
-        return err;
+    // Stop the coroutine, which frees the consumer, so the edge stops pulling the stream.
+    srs_freep(trd);
+    trd = new SrsSTCoroutine(name, this);
+    
+    // Free the chunks, the sequence continues for the next player.
+    base += (int64_t)chunks.size();
+    key = -1;
+    
+    std::deque<SrsSharedPtrMessage*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
     }
+    chunks.clear();
     
-    // the jitter is get from SrsSource, which means the time_jitter of vhost.
-    if ((err = queue->dump_packets(consumer, false, jitter)) != srs_success) {
-        return srs_error_wrap(err, "dump packets");
+    srs_trace("%s: stop for no player, url=%s", name.c_str(), req->get_stream_url().c_str());
+}
+
+bool SrsLiveSharedStream::attached()
+{
+    return nn_players > 0;
+}
+
+void SrsLiveSharedStream::fetch(int64_t& cursor, SrsSharedPtrMessage** msgs, int max, int& count)
+{
+    count = 0;
+    
+    // Start from the latest key chunk, for new player or the chunks are dropped.
+    if (cursor < 0 || cursor < base) {
+        cursor = key;
+        
+        // The player starts from the header, such as the init of fMP4.
+        if (cursor >= 0 && header && max > 0) {
+            msgs[count++] = header->copy();
+        }
     }
     
-    srs_trace("http: dump cache %d msgs, duration=%dms, cache=%dms",
-        queue->size(), srsu2msi(queue->duration()), srsu2msi(fast_cache));
+    if (cursor < 0) {
+        return;
+    }
+    
+    int64_t end = base + (int64_t)chunks.size();
+    for (; count < max && cursor < end; cursor++) {
+        msgs[count++] = chunks[cursor - base]->copy();
+    }
+}
+
+SrsSharedPtrMessage* SrsLiveSharedStream::at(int64_t sequence)
+{
+    if (sequence < base || sequence >= base + (int64_t)chunks.size()) {
+        return NULL;
+    }
+    
+    return chunks[sequence - base]->copy();
+}
+
+srs_error_t SrsLiveSharedStream::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "live shared");
+        }
+        
+        if ((err = do_cycle()) != srs_success) {
+            // Quit without retry when stopped, for example, the last player detached.
+            if (srs_error_code(err) == ERROR_THREAD_INTERRUPED) {
+                return srs_error_wrap(err, "live shared");
+            }
+            
+            srs_warn("LiveShared: Ignore error, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        srs_usleep(SRS_LIVE_SHARED_CIMS);
+    }
     
     return err;
 }
 
-srs_error_t SrsBufferCache::cycle()
+srs_error_t SrsLiveSharedStream::do_cycle()
 {
     srs_error_t err = srs_success;
     
-    // TODO: FIXME: support reload.
-    if (fast_cache <= 0) {
-        srs_usleep(SRS_STREAM_CACHE_CYCLE);
-        return err;
+    // Always use a new muxer, the next muxed chunk is a key chunk.
+    if ((err = reset()) != srs_success) {
+        return srs_error_wrap(err, "reset muxer");
     }
     
-    // the stream cache will create consumer to cache stream,
-    // which will trigger to fetch stream from origin for edge.
+    // The consumer will trigger to fetch stream from origin for edge.
     SrsConsumer* consumer = NULL;
-    if ((err = source->create_consumer(NULL, consumer, false, false, true)) != srs_success) {
+    if ((err = source->create_consumer(NULL, consumer, true, true, true)) != srs_success) {
         return srs_error_wrap(err, "create consumer");
     }
     SrsAutoFree(SrsConsumer, consumer);
     
-    SrsPithyPrint* pprint = SrsPithyPrint::create_http_stream_cache();
-    SrsAutoFree(SrsPithyPrint, pprint);
-    
     SrsMessageArray msgs(SRS_PERF_MW_MSGS);
     
-    // set the queue size, which used for max cache.
-    // TODO: FIXME: support reload.
-    queue->set_queue_size(fast_cache);
-    
     while (true) {
         if ((err = trd->pull()) != srs_success) {
-            return srs_error_wrap(err, "buffer cache");
+            return srs_error_wrap(err, "live shared");
         }
         
-        pprint->elapse();
-        
         // get messages from consumer.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
         int count = 0;
@@ -156,29 +250,521 @@ srs_error_t SrsBufferCache::cycle()
         }
         
         if (count <= 0) {
-            srs_info("http: sleep %dms for no msg", srsu2msi(SRS_CONSTS_RTMP_PULSE));
             // directly use sleep, donot use consumer wait.
-            srs_usleep(SRS_CONSTS_RTMP_PULSE);
-            
-            // ignore when nothing got.
+            _srs_timer->usleep(SRS_CONSTS_RTMP_PULSE);
             continue;
         }
         
-        if (pprint->can_print()) {
-            srs_trace("-> " SRS_CONSTS_LOG_HTTP_STREAM_CACHE " http: got %d msgs, age=%d, min=%d, mw=%d",
-                      count, pprint->age(), SRS_PERF_MW_MIN_MSGS, srsu2msi(SRS_CONSTS_RTMP_PULSE));
-        }
-        
-        // free the messages.
         for (int i = 0; i < count; i++) {
             SrsSharedPtrMessage* msg = msgs.msgs[i];
-            queue->enqueue(msg);
+            if (err == srs_success) {
+                err = mux(msg);
+            }
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "mux");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLiveSharedStream::append(const string& data, int64_t timestamp, bool is_key)
+{
+    srs_error_t err = srs_success;
+    
+    char* payload = new char[data.length()];
+    memcpy(payload, data.data(), data.length());
+    
+    SrsSharedPtrMessage* shared = new SrsSharedPtrMessage();
+    if ((err = shared->create(NULL, payload, (int)data.length())) != srs_success) {
+        srs_freep(shared);
+        return srs_error_wrap(err, "create shared");
+    }
+    shared->timestamp = timestamp;
+    
+    // For new key chunk, drop the GOP before the previous key chunk.
+    if (is_key) {
+        while (key >= 0 && base < key) {
+            SrsSharedPtrMessage* m = chunks.front();
+            srs_freep(m);
+            chunks.pop_front();
+            base++;
+        }
+        key = base + (int64_t)chunks.size();
+    }
+    
+    chunks.push_back(shared);
+    
+    // For very large GOP, drop the oldest chunks.
+    while ((int)chunks.size() > max_chunks) {
+        SrsSharedPtrMessage* m = chunks.front();
+        srs_freep(m);
+        chunks.pop_front();
+        base++;
+    }
+    if (key < base) {
+        key = -1;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLiveSharedStream::set_header(const string& data)
+{
+    srs_error_t err = srs_success;
+    
+    if (data.empty()) {
+        srs_freep(header);
+        return err;
+    }
+    
+    char* payload = new char[data.length()];
+    memcpy(payload, data.data(), data.length());
+    
+    SrsSharedPtrMessage* shared = new SrsSharedPtrMessage();
+    if ((err = shared->create(NULL, payload, (int)data.length())) != srs_success) {
+        srs_freep(shared);
+        return srs_error_wrap(err, "create shared");
+    }
+    
+    srs_freep(header);
+    header = shared;
+    
+    return err;
+}
+
+int64_t SrsLiveSharedStream::next_sequence()
+{
+    return base + (int64_t)chunks.size();
+}
+
+SrsTsSharedStream::SrsTsSharedStream(SrsSource* s, SrsRequest* r) : SrsLiveSharedStream("http-ts-shared", s, r)
+{
+    enc = NULL;
+    has_video = false;
+    last_key_timestamp = -1;
+    hls_shared = false;
+    
+    source->set_hls_ts_handler(this);
+}
+
+SrsTsSharedStream::~SrsTsSharedStream()
+{
+    source->set_hls_ts_handler(NULL);
+    srs_freep(enc);
+}
+
+// The pool of shared TS streams, key is the source.
+static std::map<SrsSource*, SrsTsSharedStream*> _srs_ts_shared_streams;
+
+SrsTsSharedStream* SrsTsSharedStream::fetch_or_create(SrsSource* s, SrsRequest* r)
+{
+    std::map<SrsSource*, SrsTsSharedStream*>::iterator it = _srs_ts_shared_streams.find(s);
+    if (it != _srs_ts_shared_streams.end()) {
+        return it->second;
+    }
+    
+    SrsTsSharedStream* tss = new SrsTsSharedStream(s, r);
+    _srs_ts_shared_streams[s] = tss;
+    return tss;
+}
+
+void SrsTsSharedStream::destroy(SrsSource* s)
+{
+    std::map<SrsSource*, SrsTsSharedStream*>::iterator it = _srs_ts_shared_streams.find(s);
+    if (it == _srs_ts_shared_streams.end()) {
+        return;
+    }
+    
+    SrsTsSharedStream* tss = it->second;
+    _srs_ts_shared_streams.erase(it);
+    srs_freep(tss);
+}
+
+srs_error_t SrsTsSharedStream::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    packets.append((char*)buf, size);
+    
+    if (nwrite) {
+        *nwrite = size;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsTsSharedStream::reset()
+{
+    srs_error_t err = srs_success;
+    
+    // Always use a new muxer, the next muxed frame starts with PAT/PMT.
+    srs_freep(enc);
+    enc = new SrsTsTransmuxer();
+    if ((err = enc->initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsSharedStream::on_hls_ts(const string& data, int64_t timestamp, bool is_key)
+{
+    srs_error_t err = srs_success;
+    
+    // Never keep the chunks for no player, switch to HLS again at the next segment.
+    if (!attached()) {
+        on_hls_unpublish();
+        return err;
+    }
+    
+    // The PAT/PMT at the start of HLS segment.
+    size_t nn_psi = 0;
+    while (nn_psi + SRS_TS_PACKET_SIZE <= data.length()) {
+        const uint8_t* p = (const uint8_t*)data.data() + nn_psi;
+        int pid = ((p[1] & 0x1f) << 8) | p[2];
+        if (pid != SrsTsPidPAT && pid != TS_PMT_PID) {
+            break;
+        }
+        nn_psi += SRS_TS_PACKET_SIZE;
+    }
+    
+    // Switch to HLS at the start of segment, so the players get the PAT/PMT of HLS.
+    if (!hls_shared) {
+        if (nn_psi == 0) {
+            return err;
+        }
+        hls_shared = true;
+        srs_trace("TS shared: use the ts of hls, url=%s", req->get_stream_url().c_str());
+    }
+    
+    // The new player starts from the latest key chunk, after the PAT/PMT of segment.
+    if (nn_psi > 0 && (err = set_header(data.substr(0, nn_psi))) != srs_success) {
+        return srs_error_wrap(err, "set header");
+    }
+    
+    // For pure audio, there is a key chunk for each interval.
+    if (is_key) {
+        has_video = true;
+    } else if (!has_video) {
+        is_key = last_key_timestamp < 0 || timestamp - last_key_timestamp >= SRS_TS_SHARED_AUDIO_KEY_INTERVAL;
+    }
+    if (is_key) {
+        last_key_timestamp = timestamp;
+    }
+    
+    return append(data, timestamp, is_key);
+}
+
+void SrsTsSharedStream::on_hls_unpublish()
+{
+    if (!hls_shared) {
+        return;
+    }
+    
+    // Mux by itself, the next key chunk starts with PAT/PMT again.
+    hls_shared = false;
+    last_key_timestamp = -1;
+    
+    srs_error_t err = set_header("");
+    srs_freep(err);
+    
+    srs_trace("TS shared: stop using the ts of hls, url=%s", req->get_stream_url().c_str());
+}
+
+srs_error_t SrsTsSharedStream::mux(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // The HLS is muxing the TS packets for us.
+    if (hls_shared) {
+        return err;
+    }
+    
+    // The key chunk starts with PAT/PMT, for new player to start from.
+    bool is_key = false;
+    if (msg->is_video()) {
+        if (SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            has_video = true;
+            is_key = true;
+        }
+    } else if (msg->is_audio()) {
+        if (!has_video && !SrsFlvAudio::sh(msg->payload, msg->size)) {
+            is_key = last_key_timestamp < 0 || msg->timestamp - last_key_timestamp >= SRS_TS_SHARED_AUDIO_KEY_INTERVAL;
+        }
+    } else {
+        return err;
+    }
+    
+    if (is_key) {
+        enc->reset();
+        last_key_timestamp = msg->timestamp;
+    }
+    
+    packets.clear();
+    if (msg->is_audio()) {
+        err = enc->write_audio(msg->timestamp, msg->payload, msg->size);
+    } else {
+        err = enc->write_video(msg->timestamp, msg->payload, msg->size);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write av");
+    }
+    
+    // Ignore the sequence header, which generates no TS packet.
+    if (packets.empty()) {
+        return err;
+    }
+    
+    return append(packets, msg->timestamp, is_key);
+}
+
+SrsLiveSharedPlayer::SrsLiveSharedPlayer()
+{
+    shared = NULL;
+}
+
+SrsLiveSharedPlayer::~SrsLiveSharedPlayer()
+{
+    if (shared) {
+        shared->detach();
+    }
+}
+
+srs_error_t SrsLiveSharedPlayer::attach(SrsLiveSharedStream* s)
+{
+    srs_error_t err = srs_success;
+    
+    if (!s || shared) {
+        return err;
+    }
+    
+    if ((err = s->attach()) != srs_success) {
+        return srs_error_wrap(err, "attach");
+    }
+    shared = s;
+    
+    return err;
+}
+
+SrsMp4SharedStream::SrsMp4SharedStream(SrsSource* s, SrsRequest* r) : SrsLiveSharedStream("http-mp4-shared", s, r)
+{
+    enc = NULL;
+}
+
+SrsMp4SharedStream::~SrsMp4SharedStream()
+{
+    srs_freep(enc);
+}
+
+srs_error_t SrsMp4SharedStream::write(void* buf, size_t size, ssize_t* nwrite)
+{
+    packets.append((char*)buf, size);
+    
+    if (nwrite) {
+        *nwrite = size;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsMp4SharedStream::writev(const iovec* iov, int iovcnt, ssize_t* nwrite)
+{
+    ssize_t nn = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        packets.append((char*)iov[i].iov_base, iov[i].iov_len);
+        nn += iov[i].iov_len;
+    }
+    
+    if (nwrite) {
+        *nwrite = nn;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsMp4SharedStream::reset()
+{
+    srs_error_t err = srs_success;
+    
+    // Always use a new muxer, which writes the init before the first fragment.
+    srs_freep(enc);
+    enc = new SrsMp4StreamEncoder(_srs_config->get_vhost_http_remux_mp4_fragment(req->vhost));
+    if ((err = enc->initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4SharedStream::mux(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    int inits = enc->inits();
+    
+    packets.clear();
+    if (msg->is_audio()) {
+        err = enc->write_audio(msg->timestamp, msg->payload, msg->size);
+    } else if (msg->is_video()) {
+        err = enc->write_video(msg->timestamp, msg->payload, msg->size);
+    } else {
+        return err;
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write av");
+    }
+    
+    // Only the cached sample, no fragment is flushed.
+    if (packets.empty()) {
+        return err;
+    }
+    
+    // The init is the header for new player, and also sent to the playing players when codec changed,
+    // while the first init is only sent to the new players as header.
+    if (inits != enc->inits()) {
+        if (inits > 0 && (err = append(packets, msg->timestamp, false)) != srs_success) {
+            return srs_error_wrap(err, "append init");
+        }
+        return set_header(packets);
+    }
+    
+    return append(packets, msg->timestamp, enc->key_fragment());
+}
+
+SrsAudioSharedStream::SrsAudioSharedStream(SrsSource* s, SrsRequest* r, bool v)
+    : SrsLiveSharedStream(v? "http-mp3-shared" : "http-aac-shared", s, r)
+{
+    is_mp3 = v;
+    aac = NULL;
+    mp3 = NULL;
+    last_key_timestamp = -1;
+    
+    // TODO: FIXME: support reload.
+    key_interval = srsu2ms(_srs_config->get_vhost_http_remux_fast_cache(req->vhost));
+    if (key_interval <= 0) {
+        key_interval = SRS_AUDIO_SHARED_KEY_INTERVAL;
+    }
+}
+
+SrsAudioSharedStream::~SrsAudioSharedStream()
+{
+    srs_freep(aac);
+    srs_freep(mp3);
+}
+
+srs_error_t SrsAudioSharedStream::open(std::string /*file*/)
+{
+    return srs_success;
+}
+
+void SrsAudioSharedStream::close()
+{
+}
+
+bool SrsAudioSharedStream::is_open()
+{
+    return true;
+}
+
+int64_t SrsAudioSharedStream::tellg()
+{
+    return 0;
+}
+
+srs_error_t SrsAudioSharedStream::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    packets.append((char*)buf, count);
+    
+    if (pnwrite) {
+        *pnwrite = count;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsAudioSharedStream::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    ssize_t nn = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        packets.append((char*)iov[i].iov_base, iov[i].iov_len);
+        nn += iov[i].iov_len;
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nn;
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsAudioSharedStream::reset()
+{
+    srs_error_t err = srs_success;
+    
+    last_key_timestamp = -1;
+    
+    if (!is_mp3) {
+        srs_freep(aac);
+        aac = new SrsAacTransmuxer();
+        if ((err = aac->initialize(this)) != srs_success) {
+            return srs_error_wrap(err, "init aac");
         }
+        return err;
+    }
+    
+    // The ID3 of MP3 is the header for new listener.
+    srs_freep(mp3);
+    mp3 = new SrsMp3Transmuxer();
+    if ((err = mp3->initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "init mp3");
+    }
+    
+    packets.clear();
+    if ((err = mp3->write_header()) != srs_success) {
+        return srs_error_wrap(err, "write id3");
+    }
+    
+    if ((err = set_header(packets)) != srs_success) {
+        return srs_error_wrap(err, "set header");
     }
     
     return err;
 }
 
+srs_error_t SrsAudioSharedStream::mux(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (!msg->is_audio()) {
+        return err;
+    }
+    
+    packets.clear();
+    if (is_mp3) {
+        err = mp3->write_audio(msg->timestamp, msg->payload, msg->size);
+    } else {
+        err = aac->write_audio(msg->timestamp, msg->payload, msg->size);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write audio");
+    }
+    
+    // Ignore the sequence header, which generates no frame.
+    if (packets.empty()) {
+        return err;
+    }
+    
+    // Each frame is standalone, so there is a key chunk for each interval, for new listener to start from.
+    bool is_key = last_key_timestamp < 0 || msg->timestamp - last_key_timestamp >= key_interval;
+    if (is_key) {
+        last_key_timestamp = msg->timestamp;
+    }
+    
+    return append(packets, msg->timestamp, is_key);
+}
+
 ISrsBufferEncoder::ISrsBufferEncoder()
 {
 }
@@ -197,7 +783,7 @@ SrsTsStreamEncoder::~SrsTsStreamEncoder()
     srs_freep(enc);
 }
 
-srs_error_t SrsTsStreamEncoder::initialize(SrsFileWriter* w, SrsBufferCache* /*c*/)
+srs_error_t SrsTsStreamEncoder::initialize(SrsFileWriter* w)
 {
     srs_error_t err = srs_success;
     
@@ -224,26 +810,14 @@ srs_error_t SrsTsStreamEncoder::write_video(int64_t timestamp, char* data, int s
     srs_error_t err = srs_success;
     
     if ((err = enc->write_video(timestamp, data, size)) != srs_success) {
-        return srs_error_wrap(err, "write video");
-    }
-    
-    return err;
-}
-
-srs_error_t SrsTsStreamEncoder::write_metadata(int64_t /*timestamp*/, char* /*data*/, int /*size*/)
-{
-    return srs_success;
-}
-
-bool SrsTsStreamEncoder::has_cache()
-{
-    // for ts stream, use gop cache of SrsSource is ok.
-    return false;
+        return srs_error_wrap(err, "write video");
+    }
+    
+    return err;
 }
 
-srs_error_t SrsTsStreamEncoder::dump_cache(SrsConsumer* /*consumer*/, SrsRtmpJitterAlgorithm /*jitter*/)
+srs_error_t SrsTsStreamEncoder::write_metadata(int64_t /*timestamp*/, char* /*data*/, int /*size*/)
 {
-    // for ts stream, ignore cache.
     return srs_success;
 }
 
@@ -258,7 +832,7 @@ SrsFlvStreamEncoder::~SrsFlvStreamEncoder()
     srs_freep(enc);
 }
 
-srs_error_t SrsFlvStreamEncoder::initialize(SrsFileWriter* w, SrsBufferCache* /*c*/)
+srs_error_t SrsFlvStreamEncoder::initialize(SrsFileWriter* w)
 {
     srs_error_t err = srs_success;
     
@@ -302,18 +876,6 @@ srs_error_t SrsFlvStreamEncoder::write_metadata(int64_t timestamp, char* data, i
     return enc->write_metadata(SrsFrameTypeScript, data, size);
 }
 
-bool SrsFlvStreamEncoder::has_cache()
-{
-    // for flv stream, use gop cache of SrsSource is ok.
-    return false;
-}
-
-srs_error_t SrsFlvStreamEncoder::dump_cache(SrsConsumer* /*consumer*/, SrsRtmpJitterAlgorithm /*jitter*/)
-{
-    // for flv stream, ignore cache.
-    return srs_success;
-}
-
 srs_error_t SrsFlvStreamEncoder::write_tags(SrsSharedPtrMessage** msgs, int count)
 {
     srs_error_t err = srs_success;
@@ -365,7 +927,6 @@ srs_error_t SrsFlvStreamEncoder::write_header(bool has_video, bool has_audio)
 SrsAacStreamEncoder::SrsAacStreamEncoder()
 {
     enc = new SrsAacTransmuxer();
-    cache = NULL;
 }
 
 SrsAacStreamEncoder::~SrsAacStreamEncoder()
@@ -373,12 +934,10 @@ SrsAacStreamEncoder::~SrsAacStreamEncoder()
     srs_freep(enc);
 }
 
-srs_error_t SrsAacStreamEncoder::initialize(SrsFileWriter* w, SrsBufferCache* c)
+srs_error_t SrsAacStreamEncoder::initialize(SrsFileWriter* w)
 {
     srs_error_t err = srs_success;
     
-    cache = c;
-    
     if ((err = enc->initialize(w)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
@@ -403,21 +962,9 @@ srs_error_t SrsAacStreamEncoder::write_metadata(int64_t /*timestamp*/, char* /*d
     return srs_success;
 }
 
-bool SrsAacStreamEncoder::has_cache()
-{
-    return true;
-}
-
-srs_error_t SrsAacStreamEncoder::dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter)
-{
-    srs_assert(cache);
-    return cache->dump_cache(consumer, jitter);
-}
-
 SrsMp3StreamEncoder::SrsMp3StreamEncoder()
 {
     enc = new SrsMp3Transmuxer();
-    cache = NULL;
 }
 
 SrsMp3StreamEncoder::~SrsMp3StreamEncoder()
@@ -425,12 +972,10 @@ SrsMp3StreamEncoder::~SrsMp3StreamEncoder()
     srs_freep(enc);
 }
 
-srs_error_t SrsMp3StreamEncoder::initialize(SrsFileWriter* w, SrsBufferCache* c)
+srs_error_t SrsMp3StreamEncoder::initialize(SrsFileWriter* w)
 {
     srs_error_t err = srs_success;
     
-    cache = c;
-    
     if ((err = enc->initialize(w)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
@@ -459,15 +1004,167 @@ srs_error_t SrsMp3StreamEncoder::write_metadata(int64_t /*timestamp*/, char* /*d
     return srs_success;
 }
 
-bool SrsMp3StreamEncoder::has_cache()
+SrsMp4StreamEncoder::SrsMp4StreamEncoder(srs_utime_t f)
 {
-    return true;
+    writer = NULL;
+    format = new SrsFormat();
+    enc = new SrsMp4FragmentEncoder();
+    fragment = f;
+    vtid = atid = 0;
+    init_dirty = true;
+    nb_inits = 0;
+    key = flushed_key = false;
+}
+
+SrsMp4StreamEncoder::~SrsMp4StreamEncoder()
+{
+    srs_freep(enc);
+    srs_freep(format);
+}
+
+srs_error_t SrsMp4StreamEncoder::initialize(ISrsWriter* w)
+{
+    srs_error_t err = srs_success;
+    
+    writer = w;
+    
+    if ((err = format->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init format");
+    }
+    
+    return err;
+}
+
+int SrsMp4StreamEncoder::inits()
+{
+    return nb_inits;
+}
+
+bool SrsMp4StreamEncoder::key_fragment()
+{
+    return flushed_key;
+}
+
+srs_error_t SrsMp4StreamEncoder::initialize(SrsFileWriter* w)
+{
+    return initialize((ISrsWriter*)w);
+}
+
+srs_error_t SrsMp4StreamEncoder::write_audio(int64_t timestamp, char* data, int size)
+{
+    // TODO: FIXME: Support other audio codecs.
+    if (!SrsFlvAudio::aac(data, size)) {
+        return srs_success;
+    }
+    return write_sample(false, timestamp, data, size);
+}
+
+srs_error_t SrsMp4StreamEncoder::write_video(int64_t timestamp, char* data, int size)
+{
+    // TODO: FIXME: Support other video codecs.
+    if (!SrsFlvVideo::h264(data, size) && !SrsFlvVideo::hevc(data, size)) {
+        return srs_success;
+    }
+    return write_sample(true, timestamp, data, size);
+}
+
+srs_error_t SrsMp4StreamEncoder::write_metadata(int64_t /*timestamp*/, char* /*data*/, int /*size*/)
+{
+    return srs_success;
+}
+
+srs_error_t SrsMp4StreamEncoder::write_sample(bool video, int64_t timestamp, char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if (video) {
+        err = format->on_video(timestamp, data, size);
+    } else {
+        err = format->on_audio(timestamp, data, size);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "demux %s", video? "video" : "audio");
+    }
+    
+    // The samples before the sequence header belong to the previous init, and we
+    // write a new init before the next sample, when the track or codec changed.
+    bool sh = video? format->is_avc_sequence_header() : format->is_aac_sequence_header();
+    if (sh) {
+        if (!enc->empty() && (err = flush()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        init_dirty = true;
+        return err;
+    }
+    
+    if (!format->raw || format->nb_raw <= 0) {
+        return err;
+    }
+    
+    if (init_dirty) {
+        vtid = (format->vcodec && !format->vcodec->avc_extra_data.empty())? 1 : 0;
+        atid = (format->acodec && !format->acodec->aac_extra_data.empty())? 2 : 0;
+        
+        // Ignore the samples without sequence header.
+        if (!vtid && !atid) {
+            return err;
+        }
+        
+        SrsMp4M2tsInitEncoder init;
+        if ((err = init.initialize(writer)) != srs_success) {
+            return srs_error_wrap(err, "init");
+        }
+        if ((err = init.write(format, (int)vtid, (int)atid)) != srs_success) {
+            return srs_error_wrap(err, "write init");
+        }
+        
+        if ((err = enc->initialize(writer, vtid, atid)) != srs_success) {
+            return srs_error_wrap(err, "init fragment");
+        }
+        
+        init_dirty = false;
+        nb_inits++;
+    }
+    
+    // Always start a fragment from keyframe, or when the duration exceeds the fragment.
+    bool keyframe = video && format->video->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+    if (!enc->empty()) {
+        bool overflow = fragment > 0 && enc->duration() * SRS_UTIME_MILLISECONDS >= fragment;
+        if ((keyframe || overflow) && (err = flush()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+    }
+    
+    // For pure audio, player can start from any fragment.
+    if (enc->empty()) {
+        key = vtid? keyframe : true;
+    }
+    
+    uint32_t dts = (uint32_t)timestamp;
+    if (video) {
+        uint32_t pts = dts + (uint32_t)format->video->cts;
+        err = enc->write_sample(SrsMp4HandlerTypeVIDE, format->video->frame_type, dts, pts, (uint8_t*)format->raw, (uint32_t)format->nb_raw);
+    } else {
+        err = enc->write_sample(SrsMp4HandlerTypeSOUN, 0x00, dts, dts, (uint8_t*)format->raw, (uint32_t)format->nb_raw);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+    
+    return err;
 }
 
-srs_error_t SrsMp3StreamEncoder::dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter)
+srs_error_t SrsMp4StreamEncoder::flush()
 {
-    srs_assert(cache);
-    return cache->dump_cache(consumer, jitter);
+    srs_error_t err = srs_success;
+    
+    flushed_key = key;
+    
+    if ((err = enc->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush fragment");
+    }
+    
+    return err;
 }
 
 SrsBufferWriter::SrsBufferWriter(ISrsHttpResponseWriter* w)
@@ -511,32 +1208,171 @@ srs_error_t SrsBufferWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwri
     return writer->writev(iov, iovcnt, pnwrite);
 }
 
-SrsLiveStream::SrsLiveStream(SrsSource* s, SrsRequest* r, SrsBufferCache* c)
+SrsWebSocketWriter::SrsWebSocketWriter(ISrsProtocolReadWriter* io)
+{
+    skt = io;
+    iovss_cache = NULL;
+    nb_iovss_cache = 0;
+}
+
+SrsWebSocketWriter::~SrsWebSocketWriter()
+{
+    srs_freepa(iovss_cache);
+}
+
+srs_error_t SrsWebSocketWriter::open(std::string /*file*/)
+{
+    return srs_success;
+}
+
+void SrsWebSocketWriter::close()
+{
+}
+
+bool SrsWebSocketWriter::is_open()
+{
+    return true;
+}
+
+int64_t SrsWebSocketWriter::tellg()
+{
+    return 0;
+}
+
+srs_error_t SrsWebSocketWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = count;
+    return writev(&iov, 1, pnwrite);
+}
+
+srs_error_t SrsWebSocketWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    if (iovcnt <= 0) {
+        return err;
+    }
+    
+    int nb_iovss = 1 + iovcnt;
+    iovec* iovss = iovss_cache;
+    if (nb_iovss_cache < nb_iovss) {
+        srs_freepa(iovss_cache);
+        nb_iovss_cache = nb_iovss;
+        iovss = iovss_cache = new iovec[nb_iovss];
+    }
+    
+    // The frame body, all iovs without copy.
+    int64_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        iovss[1+i] = iov[i];
+        size += iov[i].iov_len;
+    }
+    
+    // The frame header.
+    iovss[0].iov_base = header;
+    iovss[0].iov_len = srs_websocket_frame_header(header, SRS_WEBSOCKET_OPCODE_BINARY, size);
+    
+    if ((err = srs_write_large_iovs(skt, iovss, nb_iovss)) != srs_success) {
+        return srs_error_wrap(err, "write frame");
+    }
+    
+    if (pnwrite) {
+        *pnwrite = size;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsWebSocketWriter::write_close(int code)
+{
+    char frame[4];
+    srs_websocket_frame_header(frame, SRS_WEBSOCKET_OPCODE_CLOSE, 2);
+    frame[2] = (char)(code >> 8);
+    frame[3] = (char)code;
+    
+    return skt->write(frame, sizeof(frame), NULL);
+}
+
+string srs_http_token_ip(SrsHttpMessage* r)
+{
+    ISrsConnection* conn = r->connection();
+    return conn? conn->remote_ip() : "";
+}
+
+SrsLiveStream::SrsLiveStream(SrsSource* s, SrsRequest* r)
 {
     source = s;
-    cache = c;
+    mss = NULL;
+    audio = NULL;
     req = r->copy()->as_http();
 }
 
 SrsLiveStream::~SrsLiveStream()
 {
+    srs_freep(mss);
+    srs_freep(audio);
     srs_freep(req);
 }
 
 srs_error_t SrsLiveStream::update(SrsSource* s, SrsRequest* r)
 {
+    srs_error_t err = srs_success;
+    
     source = s;
     
     srs_freep(req);
     req = r->copy()->as_http();
     
-    return srs_success;
+    if (mss && (err = mss->update(s, r)) != srs_success) {
+        return srs_error_wrap(err, "update mp4 shared");
+    }
+    
+    if (audio && (err = audio->update(s, r)) != srs_success) {
+        return srs_error_wrap(err, "update audio shared");
+    }
+    
+    return err;
 }
 
 srs_error_t SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     srs_error_t err = srs_success;
     
+    // The live stream reads the socket to detect the close of client, which requires HTTP/1.1.
+    SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
+    if (!hr || !dynamic_cast<SrsResponseOnlyHttpConn*>(hr->connection())) {
+        return srs_error_new(ERROR_HTTP2_HTTP11_REQUIRED, "live stream over http2");
+    }
+    
+    // Reject or redirect the player when overload.
+    if (_srs_overload->reject_play()) {
+        _srs_overload->on_reject();
+        return serve_admission_reject(w, r);
+    }
+    
+    // Reject or redirect the player when the egress of server exceeds the budget.
+    if (_srs_config->get_admission_enabled()) {
+        SrsStatistic* stat = SrsStatistic::instance();
+        if (!stat->admit_play(req, _srs_config->get_admission_max_kbps(), _srs_config->get_vhost_egress_share(req->vhost))) {
+            return serve_admission_reject(w, r);
+        }
+    }
+    
+    // Verify the token in process, before any http hooks.
+    if (true) {
+        SrsRequest* nreq = hr->to_request(req->vhost);
+        SrsAutoFree(SrsRequest, nreq);
+        
+        SrsSecurity security;
+        if ((err = security.check_token(SrsRtmpConnPlay, srs_http_token_ip(hr), nreq)) != srs_success) {
+            srs_warn("http: reject play, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            return srs_go_http_error(w, SRS_CONSTS_HTTP_Forbidden);
+        }
+    }
+    
     if ((err = http_hooks_on_play(r)) != srs_success) {
         return srs_error_wrap(err, "http hook");
     }
@@ -548,6 +1384,21 @@ srs_error_t SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage
     return err;
 }
 
+srs_error_t SrsLiveStream::serve_admission_reject(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    vector<string> servers = _srs_config->get_admission_http_redirect();
+    if (servers.empty()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_ServiceUnavailable);
+    }
+    
+    // The redirect handler appends the query to location.
+    string location = "http://" + _srs_admission_lb.select(servers) + r->path();
+    srs_trace("http: redirect by admission, location=%s", location.c_str());
+    
+    SrsHttpRedirectHandler redirect(location, SRS_CONSTS_HTTP_Found);
+    return redirect.serve_http(w, r);
+}
+
 srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     srs_error_t err = srs_success;
@@ -572,17 +1423,65 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
         w->header()->set_content_type("video/MP2T");
         enc_desc = "TS";
         enc = new SrsTsStreamEncoder();
+    } else if (srs_string_ends_with(entry->pattern, ".mp4")) {
+        w->header()->set_content_type("video/mp4");
+        enc_desc = "MP4";
+        enc = new SrsMp4StreamEncoder(_srs_config->get_vhost_http_remux_mp4_fragment(req->vhost));
     } else {
         return srs_error_new(ERROR_HTTP_LIVE_STREAM_EXT, "invalid pattern=%s", entry->pattern.c_str());
     }
     SrsAutoFree(ISrsBufferEncoder, enc);
 
-    // Enter chunked mode, because we didn't set the content-length.
-    w->write_header(SRS_CONSTS_HTTP_OK);
+    // For WebSocket-FLV, response the upgrade, then write the FLV stream in frames to the hijacked socket.
+    bool websocket = enc_desc == "FLV" && srs_http_is_websocket(r);
+    if (websocket) {
+        w->header()->del("Content-Type");
+        w->header()->set("Upgrade", "websocket");
+        w->header()->set("Connection", "Upgrade");
+        w->header()->set("Sec-WebSocket-Accept", srs_websocket_accept(r->header()->get("Sec-WebSocket-Key")));
+        w->write_header(SRS_CONSTS_HTTP_SwitchingProtocols);
+        
+        if ((err = w->write(NULL, 0)) != srs_success) {
+            return srs_error_wrap(err, "websocket upgrade");
+        }
+        enc_desc = "WS-FLV";
+    } else {
+        // Enter chunked mode, because we didn't set the content-length.
+        w->write_header(SRS_CONSTS_HTTP_OK);
+    }
+    
+    // For time shift, the player starts from the past by param timeshift in seconds, @see SrsTimeShift
+    // @remark The audio stream such as mp3 is always live, which is shared by all listeners.
+    srs_utime_t shift = 0;
+    if (enc_desc != "AAC" && enc_desc != "MP3") {
+        shift = ::atoi(r->query_get("timeshift").c_str()) * SRS_UTIME_SECONDS;
+    }
+    
+    // For TS, MP4, AAC and MP3, all players write the chunks shared by the muxer of stream,
+    // except the shifted player, which mux its own stream.
+    SrsLiveSharedStream* shared = NULL;
+    int64_t cursor = -1;
+    if (shift <= 0 && dynamic_cast<SrsTsStreamEncoder*>(enc)) {
+        shared = SrsTsSharedStream::fetch_or_create(source, req);
+    } else if (shift <= 0 && dynamic_cast<SrsMp4StreamEncoder*>(enc)) {
+        if (!mss) {
+            mss = new SrsMp4SharedStream(source, req);
+        }
+        shared = mss;
+    } else if (enc_desc == "AAC" || enc_desc == "MP3") {
+        if (!audio) {
+            audio = new SrsAudioSharedStream(source, req, enc_desc == "MP3");
+        }
+        shared = audio;
+    }
+    SrsLiveSharedPlayer player;
+    if ((err = player.attach(shared)) != srs_success) {
+        return srs_error_wrap(err, "start %s shared", enc_desc.c_str());
+    }
     
-    // create consumer of souce, ignore gop cache, use the audio gop cache.
+    // create consumer of souce, start from the gop cache, which also keeps the audio window of pure audio stream.
     SrsConsumer* consumer = NULL;
-    if ((err = source->create_consumer(NULL, consumer, true, true, !enc->has_cache())) != srs_success) {
+    if (!shared && (err = source->create_consumer(NULL, consumer, true, true, true, shift)) != srs_success) {
         return srs_error_wrap(err, "create consumer");
     }
     SrsAutoFree(SrsConsumer, consumer);
@@ -593,7 +1492,7 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     
     SrsMessageArray msgs(SRS_PERF_MW_MSGS);
 
-    // Use receive thread to accept the close event to avoid FD leak.
+    // Drain the connection in the serving loop to accept the close event to avoid FD leak.
     // @see https://github.com/ossrs/srs/issues/636#issuecomment-298208427
     SrsHttpMessage* hr = dynamic_cast<SrsHttpMessage*>(r);
     SrsResponseOnlyHttpConn* hc = dynamic_cast<SrsResponseOnlyHttpConn*>(hr->connection());
@@ -603,21 +1502,32 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     if ((err = stat->on_client(_srs_context->get_id(), req, hc, SrsRtmpConnPlay)) != srs_success) {
         return srs_error_wrap(err, "stat on client");
     }
+    SrsStatisticHandle stat_handle = stat->find_handle(_srs_context->get_id());
     
     // the memory writer.
     SrsBufferWriter writer(w);
-    if ((err = enc->initialize(&writer, cache)) != srs_success) {
+    SrsWebSocketWriter wsw(hc->hijack());
+    // The shared stream writes the header such as ID3 of MP3, so never initialize the encoder.
+    if (!shared && (err = enc->initialize(websocket? (SrsFileWriter*)&wsw : &writer)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
     
-    // if gop cache enabled for encoder, dump to consumer.
-    if (enc->has_cache()) {
-        if ((err = enc->dump_cache(consumer, source->jitter())) != srs_success) {
-            return srs_error_wrap(err, "encoder dump cache");
+    SrsFlvStreamEncoder* ffe = dynamic_cast<SrsFlvStreamEncoder*>(enc);
+    
+    // Switch the consumer between the renditions by the delivery rate, only for FLV except the time shift player.
+    SrsAbrSwitcher* abr = NULL;
+    if (ffe && shift <= 0) {
+        abr = new SrsAbrSwitcher(NULL, req);
+        if (!abr->initialize(source)) {
+            srs_freep(abr);
         }
     }
+    SrsAutoFree(SrsAbrSwitcher, abr);
     
-    SrsFlvStreamEncoder* ffe = dynamic_cast<SrsFlvStreamEncoder*>(enc);
+    // Hand over the FLV player to fanout thread when the gop cache is sent, except the WebSocket, ABR and time shift player.
+    bool fanout = ffe && !websocket && !abr && shift <= 0 && _srs_fanout->enabled();
+    // The timestamp of last message sent by player, to continue by the fanout thread.
+    int64_t last_time = -1;
     
     // Set the socket options for transport.
     bool tcp_nodelay = _srs_config->get_tcp_nodelay(req->vhost);
@@ -631,52 +1541,101 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     if ((err = hc->set_socket_buffer(mw_sleep)) != srs_success) {
         return srs_error_wrap(err, "set mw_sleep %" PRId64, mw_sleep);
     }
-
-    SrsHttpRecvThread* trd = new SrsHttpRecvThread(hc);
-    SrsAutoFree(SrsHttpRecvThread, trd);
     
-    if ((err = trd->start()) != srs_success) {
-        return srs_error_wrap(err, "start recv thread");
+    if ((err = hc->set_tcp_congestion(_srs_config->get_tcp_congestion(req->vhost))) != srs_success) {
+        srs_warn("ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
     }
-    
-    srs_trace("FLV %s, encoder=%s, nodelay=%d, mw_sleep=%dms, cache=%d, msgs=%d",
+    // keep the backlog in the queue of consumer, where the slow consumer drops frames.
+    if ((err = hc->set_notsent_lowat(_srs_config->get_play_notsent_lowat(req->vhost))) != srs_success) {
+        srs_warn("ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    double pacing_factor = _srs_config->get_pacing_factor(req->vhost);
+
+    srs_trace("FLV %s, encoder=%s, nodelay=%d, mw_sleep=%dms, shared=%d, msgs=%d",
         entry->pattern.c_str(), enc_desc.c_str(), tcp_nodelay, srsu2msi(mw_sleep),
-        enc->has_cache(), msgs.max);
+        shared != NULL, msgs.max);
 
+    // Whether the time to first frame is stat.
+    bool ttff_done = false;
+    // Yield to the publishers for each slice of bytes, for example, when dump the GOP cache.
+    SrsCoroutineSlice slice(_srs_config->get_scheduler_slice());
+    
     // TODO: free and erase the disabled entry after all related connections is closed.
     // TODO: FXIME: Support timeout for player, quit infinite-loop.
     while (entry->enabled) {
-        // Whether client closed the FD.
-        if ((err = trd->pull()) != srs_success) {
-            return srs_error_wrap(err, "recv thread");
+        // Whether client closed the FD, checked in the serving coroutine without blocking.
+        if ((err = hc->drain()) != srs_success) {
+            return srs_error_wrap(err, "client closed");
         }
 
         pprint->elapse();
+        
+        // Switch the rendition at its keyframe.
+        bool switched = false;
+        if (abr && (err = abr->cycle(consumer, switched)) != srs_success) {
+            return srs_error_wrap(err, "abr");
+        }
 
         // get messages from consumer.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
         int count = 0;
-        if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
+        if (shared) {
+            shared->fetch(cursor, msgs.msgs, msgs.max, count);
+        } else if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
             return srs_error_wrap(err, "consumer dump packets");
         }
         
         if (count <= 0) {
+            // Hand over when the consumer is drained, fall back to serve it by coroutine for TLS.
+            int fd = fanout? hc->dup_fd() : -1;
+            if (fd >= 0) {
+                srs_freep(consumer);
+                return serve_fanout(fd, last_time);
+            }
+            fanout = false;
+            
             // Directly use sleep, donot use consumer wait, because we couldn't awake consumer.
-            srs_usleep(mw_sleep);
+            _srs_timer->usleep(mw_sleep);
             // ignore when nothing got.
             continue;
         }
         
+        // Continue the timestamp of player, after switched to another rendition.
+        if (abr) {
+            abr->rebase(msgs.msgs, count);
+        }
+        
         if (pprint->can_print()) {
             srs_trace("-> " SRS_CONSTS_LOG_HTTP_STREAM " http: got %d msgs, age=%d, min=%d, mw=%d",
                 count, pprint->age(), SRS_PERF_MW_MIN_MSGS, srsu2msi(mw_sleep));
         }
         
+        if (!ttff_done) {
+            ttff_done = stat->on_client_frames(stat_handle, msgs.msgs, count);
+        }
+        stat->on_client_markers(stat_handle, msgs.msgs, count);
+        
+        int64_t nn_bytes = 0;
+        for (int i = 0; i < count; i++) {
+            nn_bytes += msgs.msgs[i]->size;
+            if (msgs.msgs[i]->is_av()) {
+                last_time = msgs.msgs[i]->timestamp;
+            }
+        }
+        
         // sendout all messages.
-        if (ffe) {
-            err = ffe->write_tags(msgs.msgs, count);
-        } else {
-            err = streaming_send_messages(enc, msgs.msgs, count);
+        srs_utime_t send_starttime = srs_update_monotonic_time();
+        if (true) {
+            SrsCpuScope cpu_scope(source->cpu_stat(), SrsCpuSend);
+            if (ffe) {
+                err = ffe->write_tags(msgs.msgs, count);
+            } else if (shared) {
+                err = streaming_send_shared(w, msgs.msgs, count);
+            } else {
+                err = streaming_send_messages(enc, msgs.msgs, count);
+            }
         }
 
         // free the messages.
@@ -689,13 +1648,74 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
         if (err != srs_success) {
             return srs_error_wrap(err, "send messages");
         }
+        stat->on_send_latency(stat_handle, srs_update_monotonic_time() - send_starttime);
+        
+        srs_utime_t stall_time = 0;
+        int64_t nn_stalls = 0;
+        hc->stalls(&stall_time, &nn_stalls);
+        // The player of shared stream has no queue of its own, so only the stalls are reported.
+        stat->on_client_delays(stat_handle, consumer? consumer->delay() : 0, stall_time, nn_stalls);
+        slice.consume(nn_bytes);
+        
+        // pace the sending by the bitrate of stream.
+        if ((err = hc->update_pacing(pacing_factor)) != srs_success) {
+            srs_warn("ignore pacing err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
     }
 
+    // Close the WebSocket normally, to notify the player the stream is over.
+    if (websocket && (err = wsw.write_close(1000)) != srs_success) {
+        srs_warn("ignore websocket close err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
     // Here, the entry is disabled by encoder un-publishing or reloading,
     // so we must return a io.EOF error to disconnect the client, or the client will never quit.
     return srs_error_new(ERROR_HTTP_STREAM_EOF, "Stream EOF");
 }
 
+srs_error_t SrsLiveStream::serve_fanout(int fd, int64_t last_time)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFanoutPlayer* player = NULL;
+    if ((err = _srs_fanout->handover(source, req, fd, last_time, &player)) != srs_success) {
+        return srs_error_wrap(err, "fanout handover");
+    }
+    
+    srs_trace("FLV %s, handover to fanout, last=%" PRId64, entry->pattern.c_str(), last_time);
+    
+    // Remove the player from thread when the stream is over or the connection is disposed,
+    // and it's freed only when removed, for the thread never touches it then.
+    bool interrupted = false;
+    while (!player->removed) {
+        if (!player->removing && (player->closed || !entry->enabled || interrupted)) {
+            _srs_fanout->remove(player);
+        }
+        
+        if (srs_cond_timedwait(player->cond, SRS_FANOUT_CHECK_INTERVAL) != 0 && errno == EINTR) {
+            interrupted = true;
+        }
+    }
+    
+    bool closed = player->closed;
+    int error = player->error;
+    int64_t nn_bytes = player->nn_bytes;
+    int nn_skips = player->nn_skips;
+    _srs_fanout->release(player);
+    
+    if (closed && error) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "fanout write, errno=%d, bytes=%" PRId64 ", skips=%d", error, nn_bytes, nn_skips);
+    }
+    if (closed) {
+        return srs_error_new(ERROR_SOCKET_READ, "fanout closed, bytes=%" PRId64 ", skips=%d", nn_bytes, nn_skips);
+    }
+    
+    // The stream is over, or the connection is disposed.
+    return srs_error_new(ERROR_HTTP_STREAM_EOF, "Stream EOF, bytes=%" PRId64 ", skips=%d", nn_bytes, nn_skips);
+}
+
 srs_error_t SrsLiveStream::http_hooks_on_play(ISrsHttpMessage* r)
 {
     srs_error_t err = srs_success;
@@ -792,12 +1812,31 @@ srs_error_t SrsLiveStream::streaming_send_messages(ISrsBufferEncoder* enc, SrsSh
     return err;
 }
 
+srs_error_t SrsLiveStream::streaming_send_shared(ISrsHttpResponseWriter* w, SrsSharedPtrMessage** msgs, int nb_msgs)
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(nb_msgs <= SRS_PERF_MW_MSGS);
+    iovec iovs[SRS_PERF_MW_MSGS];
+    
+    for (int i = 0; i < nb_msgs; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        iovs[i].iov_base = msg->payload;
+        iovs[i].iov_len = msg->size;
+    }
+    
+    if ((err = w->writev(iovs, nb_msgs, NULL)) != srs_success) {
+        return srs_error_wrap(err, "send shared");
+    }
+    
+    return err;
+}
+
 SrsLiveEntry::SrsLiveEntry(std::string m)
 {
     mount = m;
     
     stream = NULL;
-    cache = NULL;
     
     req = NULL;
     source = NULL;
@@ -807,6 +1846,7 @@ SrsLiveEntry::SrsLiveEntry(std::string m)
     _is_ts = (ext == ".ts");
     _is_mp3 = (ext == ".mp3");
     _is_aac = (ext == ".aac");
+    _is_mp4 = (ext == ".mp4");
 }
 
 SrsLiveEntry::~SrsLiveEntry()
@@ -834,6 +1874,11 @@ bool SrsLiveEntry::is_mp3()
     return _is_mp3;
 }
 
+bool SrsLiveEntry::is_mp4()
+{
+    return _is_mp4;
+}
+
 SrsHttpStreamServer::SrsHttpStreamServer(SrsServer* svr)
 {
     server = svr;
@@ -856,7 +1901,7 @@ SrsHttpStreamServer::~SrsHttpStreamServer()
         tflvs.clear();
     }
     if (true) {
-        std::map<std::string, SrsLiveEntry*>::iterator it;
+        std::map<SrsStreamKey*, SrsLiveEntry*>::iterator it;
         for (it = sflvs.begin(); it != sflvs.end(); ++it) {
             SrsLiveEntry* entry = it->second;
             srs_freep(entry);
@@ -883,11 +1928,12 @@ srs_error_t SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
     srs_error_t err = srs_success;
     
     // the id to identify stream.
-    std::string sid = r->get_stream_url();
+    SrsStreamKey* sid = r->get_stream_key();
     SrsLiveEntry* entry = NULL;
     
     // create stream from template when not found.
-    if (sflvs.find(sid) == sflvs.end()) {
+    std::map<SrsStreamKey*, SrsLiveEntry*>::iterator it = sflvs.find(sid);
+    if (it == sflvs.end()) {
         if (tflvs.find(r->vhost) == tflvs.end()) {
             return err;
         }
@@ -908,8 +1954,7 @@ srs_error_t SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
 
         entry->source = s;
         entry->req = r->copy()->as_http();
-        entry->cache = new SrsBufferCache(s, r);
-        entry->stream = new SrsLiveStream(s, r, entry->cache);
+        entry->stream = new SrsLiveStream(s, r);
         
         // TODO: FIXME: maybe refine the logic of http remux service.
         // if user push streams followed:
@@ -929,18 +1974,13 @@ srs_error_t SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
         // for the thread will cause thread switch context.
         // @see https://github.com/ossrs/srs/issues/404
         if ((err = mux.handle(mount, entry->stream)) != srs_success) {
-            return srs_error_wrap(err, "http: mount flv stream for vhost=%s failed", sid.c_str());
+            return srs_error_wrap(err, "http: mount flv stream for vhost=%s failed", sid->url.c_str());
         }
         
-        // start http stream cache thread
-        if ((err = entry->cache->start()) != srs_success) {
-            return srs_error_wrap(err, "http: start stream cache failed");
-        }
-        srs_trace("http: mount flv stream for sid=%s, mount=%s", sid.c_str(), mount.c_str());
+        srs_trace("http: mount flv stream for sid=%s, mount=%s", sid->url.c_str(), mount.c_str());
     } else {
-        entry = sflvs[sid];
+        entry = it->second;
         entry->stream->update(s, r);
-        entry->cache->update(s, r);
     }
     
     if (entry->stream) {
@@ -953,13 +1993,15 @@ srs_error_t SrsHttpStreamServer::http_mount(SrsSource* s, SrsRequest* r)
 
 void SrsHttpStreamServer::http_unmount(SrsSource* s, SrsRequest* r)
 {
-    std::string sid = r->get_stream_url();
+    // The stream is never mounted when the key is not interned.
+    SrsStreamKey* sid = r->get_stream_key(false);
     
-    if (sflvs.find(sid) == sflvs.end()) {
+    std::map<SrsStreamKey*, SrsLiveEntry*>::iterator it = sflvs.find(sid);
+    if (!sid || it == sflvs.end()) {
         return;
     }
     
-    SrsLiveEntry* entry = sflvs[sid];
+    SrsLiveEntry* entry = it->second;
     entry->stream->entry->enabled = false;
 }
 
@@ -991,7 +2033,7 @@ srs_error_t SrsHttpStreamServer::on_reload_vhost_http_remux_updated(string vhost
 
     // Update all streams for exists vhost.
     // TODO: FIMXE: If url changed, needs more things to deal with.
-    std::map<std::string, SrsLiveEntry*>::iterator it;
+    std::map<SrsStreamKey*, SrsLiveEntry*>::iterator it;
     for (it = sflvs.begin(); it != sflvs.end(); ++it) {
         SrsLiveEntry* entry = it->second;
         if (!entry || !entry->req || !entry->source) {
@@ -1026,7 +2068,7 @@ srs_error_t SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandle
         return err;
     }
     
-    // only hijack for http streaming, http-flv/ts/mp3/aac.
+    // only hijack for http streaming, http-flv/ts/mp3/aac/mp4.
     std::string ext = request->ext();
     if (ext.empty()) {
         return err;
@@ -1071,6 +2113,10 @@ srs_error_t SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandle
             if (ext != ".aac") {
                 return err;
             }
+        } else if (entry->is_mp4()) {
+            if (ext != ".mp4") {
+                return err;
+            }
         } else {
             return err;
         }
@@ -1096,11 +2142,12 @@ srs_error_t SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandle
     SrsRequest* r = hreq->to_request(vhost->arg0());
     SrsAutoFree(SrsRequest, r);
     
-    std::string sid = r->get_stream_url();
+    SrsStreamKey* sid = r->get_stream_key();
     // check whether the http remux is enabled,
     // for example, user disable the http flv then reload.
-    if (sflvs.find(sid) != sflvs.end()) {
-        SrsLiveEntry* s_entry = sflvs[sid];
+    std::map<SrsStreamKey*, SrsLiveEntry*>::iterator it = sflvs.find(sid);
+    if (it != sflvs.end()) {
+        SrsLiveEntry* s_entry = it->second;
         if (!s_entry->stream->entry->enabled) {
             // only when the http entry is disabled, check the config whether http flv disable,
             // for the http flv edge use hijack to trigger the edge ingester, we always mount it
@@ -1124,8 +2171,8 @@ srs_error_t SrsHttpStreamServer::hijack(ISrsHttpMessage* request, ISrsHttpHandle
     
     // use the handler if exists.
     if (ph) {
-        if (sflvs.find(sid) != sflvs.end()) {
-            entry = sflvs[sid];
+        if ((it = sflvs.find(sid)) != sflvs.end()) {
+            entry = it->second;
             *ph = entry->stream;
         }
     }
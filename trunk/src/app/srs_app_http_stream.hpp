@@ -26,33 +26,181 @@
 
 #include <srs_core.hpp>
 
+#include <deque>
+
 #include <srs_app_http_conn.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_kernel_io.hpp>
 
 class SrsAacTransmuxer;
 class SrsMp3Transmuxer;
 class SrsFlvTransmuxer;
 class SrsTsTransmuxer;
+class SrsFormat;
+class SrsStreamKey;
+class SrsMp4FragmentEncoder;
+class SrsMp4StreamEncoder;
+class SrsHttpMessage;
+
+// Get the ip to verify the token of HTTP player, which is the remote ip of connection, never the
+// X-Forwarded-For or X-Real-IP, for the client is able to forge these headers.
+extern std::string srs_http_token_ip(SrsHttpMessage* r);
 
-// A cache for HTTP Live Streaming encoder, to make android(weixin) happy.
-class SrsBufferCache : public ISrsCoroutineHandler
+// The shared live stream, to mux the RTMP stream once for all HTTP players of a format,
+// where each player writes the shared chunks, instead of muxing by itself.
+class SrsLiveSharedStream : public ISrsCoroutineHandler
 {
-private:
-    srs_utime_t fast_cache;
-private:
-    SrsMessageQueue* queue;
+protected:
     SrsSource* source;
     SrsRequest* req;
+    // The max number of chunks, the oldest chunks are dropped for very large GOP.
+    int max_chunks;
+private:
+    // The name of coroutine, which is created again when restart.
+    std::string name;
     SrsCoroutine* trd;
-public:
-    SrsBufferCache(SrsSource* s, SrsRequest* r);
-    virtual ~SrsBufferCache();
+    // The number of players attached, the muxer stops when the last one detached.
+    int nn_players;
+private:
+    // The sequence of the first chunk.
+    int64_t base;
+    // The sequence of the latest key chunk, which the player can start from, -1 if no key chunk.
+    int64_t key;
+    // The muxed chunks of stream, use copy() to share it.
+    std::deque<SrsSharedPtrMessage*> chunks;
+    // The header for new player to write before the key chunk, NULL if no header.
+    SrsSharedPtrMessage* header;
+public:
+    SrsLiveSharedStream(std::string name, SrsSource* s, SrsRequest* r);
+    virtual ~SrsLiveSharedStream();
     virtual srs_error_t update(SrsSource* s, SrsRequest* r);
 public:
-    virtual srs_error_t start();
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter);
+    // Attach a player, and start to mux the stream for the first player.
+    virtual srs_error_t attach();
+    // Detach a player, and stop to mux for the last player, which frees the consumer and chunks.
+    virtual void detach();
+    // Whether any player is attached.
+    virtual bool attached();
+    // Fetch the shared chunks from cursor, and update the cursor for the next fetch.
+    // @param cursor The sequence of chunk to fetch, -1 to start from the latest key chunk.
+    //       It's also reset to the latest key chunk, when the chunks it requires are dropped.
+    // @remark User must free the msgs, which are copied from the chunks.
+    virtual void fetch(int64_t& cursor, SrsSharedPtrMessage** msgs, int max, int& count);
+    // Fetch a copy of the chunk by sequence, NULL if dropped or not muxed yet.
+    virtual SrsSharedPtrMessage* at(int64_t sequence);
 // Interface ISrsEndlessThreadHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+protected:
+    // Create a new muxer, when (re)start to consume the source.
+    virtual srs_error_t reset() = 0;
+    // Mux the message, and append the muxed data as chunk if any.
+    virtual srs_error_t mux(SrsSharedPtrMessage* msg) = 0;
+    // Append a chunk copied from data, the key chunk drops the GOP before the previous key chunk.
+    virtual srs_error_t append(const std::string& data, int64_t timestamp, bool is_key);
+    // Update the header, copied from data, empty to remove it.
+    virtual srs_error_t set_header(const std::string& data);
+    // The sequence of the next chunk to append.
+    virtual int64_t next_sequence();
+};
+
+// The shared TS stream, to mux the RTMP stream to TS once for all HTTP TS players.
+// When HLS is publishing, it uses the TS packets of HLS in place of muxing again, @see ISrsHlsTsHandler
+class SrsTsSharedStream : public SrsLiveSharedStream, public ISrsStreamWriter, public ISrsHlsTsHandler
+{
+private:
+    SrsTsTransmuxer* enc;
+    // The TS packets of current muxing message.
+    std::string packets;
+    // Whether got video, for pure audio, there is a key chunk for each interval.
+    bool has_video;
+    int64_t last_key_timestamp;
+    // Whether use the TS packets of HLS, and the PAT/PMT of HLS is the header for new player.
+    bool hls_shared;
+public:
+    SrsTsSharedStream(SrsSource* s, SrsRequest* r);
+    virtual ~SrsTsSharedStream();
+public:
+    // Fetch the shared TS stream of source, or create a new one, which lives as long as the source,
+    // so all TS players of source share the same muxer, such as the HTTP-TS and SRT players.
+    static SrsTsSharedStream* fetch_or_create(SrsSource* s, SrsRequest* r);
+    // Free the shared TS stream of source, when the source is cleaned up.
+    static void destroy(SrsSource* s);
+// Interface ISrsStreamWriter.
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+// Interface ISrsHlsTsHandler.
+public:
+    virtual srs_error_t on_hls_ts(const std::string& packets, int64_t timestamp, bool is_key);
+    virtual void on_hls_unpublish();
+protected:
+    virtual srs_error_t reset();
+    virtual srs_error_t mux(SrsSharedPtrMessage* msg);
+};
+
+// The player of shared stream, which detaches from the shared stream when freed, like SrsAutoFree.
+class SrsLiveSharedPlayer
+{
+private:
+    SrsLiveSharedStream* shared;
+public:
+    SrsLiveSharedPlayer();
+    virtual ~SrsLiveSharedPlayer();
+public:
+    // Attach to the shared stream, ignore if NULL.
+    virtual srs_error_t attach(SrsLiveSharedStream* s);
+};
+
+// The shared fMP4 stream, to mux the RTMP stream to fragments once for all HTTP MP4 players,
+// where the init(ftyp+moov) is the header, and each fragment(moof+mdat) is a chunk.
+class SrsMp4SharedStream : public SrsLiveSharedStream, public ISrsWriter
+{
+private:
+    SrsMp4StreamEncoder* enc;
+    // The bytes of current muxing message.
+    std::string packets;
+public:
+    SrsMp4SharedStream(SrsSource* s, SrsRequest* r);
+    virtual ~SrsMp4SharedStream();
+// Interface ISrsWriter.
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* nwrite);
+protected:
+    virtual srs_error_t reset();
+    virtual srs_error_t mux(SrsSharedPtrMessage* msg);
+};
+
+// The shared audio stream, to mux the RTMP audio to AAC(ADTS) or MP3 frames once for all HTTP audio
+// players, so a listener of radio only holds a cursor of the shared frames, without a consumer.
+class SrsAudioSharedStream : public SrsLiveSharedStream, public SrsFileWriter
+{
+private:
+    bool is_mp3;
+    SrsAacTransmuxer* aac;
+    SrsMp3Transmuxer* mp3;
+    // The bytes of current muxing message.
+    std::string packets;
+    // The interval in ms of key chunk for new listener to start from, @see SrsConfig::get_vhost_http_remux_fast_cache
+    int64_t key_interval;
+    int64_t last_key_timestamp;
+public:
+    // @param v Whether mux to MP3, otherwise AAC.
+    SrsAudioSharedStream(SrsSource* s, SrsRequest* r, bool v);
+    virtual ~SrsAudioSharedStream();
+// Interface SrsFileWriter.
+public:
+    virtual srs_error_t open(std::string file);
+    virtual void close();
+    virtual bool is_open();
+    virtual int64_t tellg();
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+protected:
+    virtual srs_error_t reset();
+    virtual srs_error_t mux(SrsSharedPtrMessage* msg);
 };
 
 // The encoder to transmux RTMP stream.
@@ -62,21 +210,13 @@ public:
     ISrsBufferEncoder();
     virtual ~ISrsBufferEncoder();
 public:
-    // Initialize the encoder with file writer(to http response) and stream cache.
+    // Initialize the encoder with file writer(to http response).
     // @param w the writer to write to http response.
-    // @param c the stream cache for audio stream fast startup.
-    virtual srs_error_t initialize(SrsFileWriter* w, SrsBufferCache* c) = 0;
+    virtual srs_error_t initialize(SrsFileWriter* w) = 0;
     // Write rtmp video/audio/metadata.
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size) = 0;
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size) = 0;
     virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size) = 0;
-public:
-    // For some stream, for example, mp3 and aac, the audio stream,
-    // we use large gop cache in encoder, for the gop cache of SrsSource is ignore audio.
-    // @return true to use gop cache of encoder; otherwise, use SrsSource.
-    virtual bool has_cache() = 0;
-    // Dumps the cache of encoder to consumer.
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter) = 0;
 };
 
 // Transmux RTMP to HTTP Live Streaming.
@@ -89,13 +229,10 @@ public:
     SrsFlvStreamEncoder();
     virtual ~SrsFlvStreamEncoder();
 public:
-    virtual srs_error_t initialize(SrsFileWriter* w, SrsBufferCache* c);
+    virtual srs_error_t initialize(SrsFileWriter* w);
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size);
-public:
-    virtual bool has_cache();
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter);
 public:
     // Write the tags in a time.
     virtual srs_error_t write_tags(SrsSharedPtrMessage** msgs, int count);
@@ -112,13 +249,10 @@ public:
     SrsTsStreamEncoder();
     virtual ~SrsTsStreamEncoder();
 public:
-    virtual srs_error_t initialize(SrsFileWriter* w, SrsBufferCache* c);
+    virtual srs_error_t initialize(SrsFileWriter* w);
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size);
-public:
-    virtual bool has_cache();
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter);
 };
 
 // Transmux RTMP with AAC stream to HTTP AAC Streaming.
@@ -126,18 +260,14 @@ class SrsAacStreamEncoder : public ISrsBufferEncoder
 {
 private:
     SrsAacTransmuxer* enc;
-    SrsBufferCache* cache;
 public:
     SrsAacStreamEncoder();
     virtual ~SrsAacStreamEncoder();
 public:
-    virtual srs_error_t initialize(SrsFileWriter* w, SrsBufferCache* c);
+    virtual srs_error_t initialize(SrsFileWriter* w);
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size);
-public:
-    virtual bool has_cache();
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter);
 };
 
 // Transmux RTMP with MP3 stream to HTTP MP3 Streaming.
@@ -145,18 +275,14 @@ class SrsMp3StreamEncoder : public ISrsBufferEncoder
 {
 private:
     SrsMp3Transmuxer* enc;
-    SrsBufferCache* cache;
 public:
     SrsMp3StreamEncoder();
     virtual ~SrsMp3StreamEncoder();
 public:
-    virtual srs_error_t initialize(SrsFileWriter* w, SrsBufferCache* c);
+    virtual srs_error_t initialize(SrsFileWriter* w);
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size);
-public:
-    virtual bool has_cache();
-    virtual srs_error_t dump_cache(SrsConsumer* consumer, SrsRtmpJitterAlgorithm jitter);
 };
 
 // Write stream to http response direclty.
@@ -178,24 +304,100 @@ public:
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
 };
 
+// Write stream to the socket hijacked from http response, in WebSocket binary frames,
+// where each write or writev is a frame, so the tags muxed in a time are framed only once.
+class SrsWebSocketWriter : public SrsFileWriter
+{
+private:
+    ISrsProtocolReadWriter* skt;
+    char header[SRS_WEBSOCKET_FRAME_HEADER_MAX];
+    iovec* iovss_cache;
+    int nb_iovss_cache;
+public:
+    SrsWebSocketWriter(ISrsProtocolReadWriter* io);
+    virtual ~SrsWebSocketWriter();
+public:
+    virtual srs_error_t open(std::string file);
+    virtual void close();
+public:
+    virtual bool is_open();
+    virtual int64_t tellg();
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
+public:
+    // Write the close frame with status code, for example, 1000 for normal closure.
+    virtual srs_error_t write_close(int code);
+};
+
+// Transmux RTMP to HTTP fMP4 Streaming, the init(ftyp+moov) followed by fragments(moof+mdat),
+// which starts a fragment for each keyframe, or when the duration exceeds the fragment.
+// @remark Only H.264 and AAC are supported, other codecs are ignored.
+class SrsMp4StreamEncoder : public ISrsBufferEncoder
+{
+private:
+    ISrsWriter* writer;
+    SrsFormat* format;
+    SrsMp4FragmentEncoder* enc;
+    // The duration of fragment, 0 to start a fragment for each GOP.
+    srs_utime_t fragment;
+    // The track id of video and audio in init, 0 if no such track.
+    uint32_t vtid;
+    uint32_t atid;
+    // Whether the init should be written, for the sequence header changed.
+    bool init_dirty;
+    // The number of init written.
+    int nb_inits;
+    // Whether the current fragment, and the last flushed fragment, starts with keyframe.
+    bool key;
+    bool flushed_key;
+public:
+    SrsMp4StreamEncoder(srs_utime_t f);
+    virtual ~SrsMp4StreamEncoder();
+public:
+    // Initialize the encoder with any writer, for the shared stream to cache the chunks.
+    virtual srs_error_t initialize(ISrsWriter* w);
+    // The number of init written, to identify the init written by the last call.
+    virtual int inits();
+    // Whether the last flushed fragment starts with keyframe, so player can start from it.
+    virtual bool key_fragment();
+// Interface ISrsBufferEncoder.
+public:
+    virtual srs_error_t initialize(SrsFileWriter* w);
+    virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
+    virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
+    virtual srs_error_t write_metadata(int64_t timestamp, char* data, int size);
+private:
+    virtual srs_error_t write_sample(bool video, int64_t timestamp, char* data, int size);
+    virtual srs_error_t flush();
+};
+
 // HTTP Live Streaming, to transmux RTMP to HTTP FLV or other format.
 class SrsLiveStream : public ISrsHttpHandler
 {
 private:
     SrsRequest* req;
     SrsSource* source;
-    SrsBufferCache* cache;
+    // The shared fMP4 stream for all MP4 players, created when the first MP4 player arrives.
+    SrsMp4SharedStream* mss;
+    // The shared AAC or MP3 stream for all audio players, created when the first audio player arrives.
+    SrsAudioSharedStream* audio;
 public:
-    SrsLiveStream(SrsSource* s, SrsRequest* r, SrsBufferCache* c);
+    SrsLiveStream(SrsSource* s, SrsRequest* r);
     virtual ~SrsLiveStream();
     virtual srs_error_t update(SrsSource* s, SrsRequest* r);
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 private:
+    // Redirect the player rejected by admission control, or response 503 if no server to redirect.
+    virtual srs_error_t serve_admission_reject(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
     virtual srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+    // Hand over the socket to fanout thread, and wait until the player is closed or the stream is over.
+    virtual srs_error_t serve_fanout(int fd, int64_t last_time);
     virtual srs_error_t http_hooks_on_play(ISrsHttpMessage* r);
     virtual void http_hooks_on_stop(ISrsHttpMessage* r);
     virtual srs_error_t streaming_send_messages(ISrsBufferEncoder* enc, SrsSharedPtrMessage** msgs, int nb_msgs);
+    virtual srs_error_t streaming_send_shared(ISrsHttpResponseWriter* w, SrsSharedPtrMessage** msgs, int nb_msgs);
 };
 
 // The Live Entry, to handle HTTP Live Streaming.
@@ -206,6 +408,7 @@ private:
     bool _is_ts;
     bool _is_aac;
     bool _is_mp3;
+    bool _is_mp4;
 public:
     // We will free the request.
     SrsRequest* req;
@@ -217,7 +420,6 @@ public:
     std::string mount;
     
     SrsLiveStream* stream;
-    SrsBufferCache* cache;
     
     SrsLiveEntry(std::string m);
     virtual ~SrsLiveEntry();
@@ -226,9 +428,10 @@ public:
     bool is_ts();
     bool is_mp3();
     bool is_aac();
+    bool is_mp4();
 };
 
-// The HTTP Live Streaming Server, to serve FLV/TS/MP3/AAC stream.
+// The HTTP Live Streaming Server, to serve FLV/TS/MP3/AAC/MP4 stream.
 // TODO: Support multiple stream.
 class SrsHttpStreamServer : virtual public ISrsReloadHandler
 , virtual public ISrsHttpMatchHijacker
@@ -239,8 +442,8 @@ public:
     SrsHttpServeMux mux;
     // The http live streaming template, to create streams.
     std::map<std::string, SrsLiveEntry*> tflvs;
-    // The http live streaming streams, crote by template.
-    std::map<std::string, SrsLiveEntry*> sflvs;
+    // The http live streaming streams, crote by template, keyed by the interned key of stream.
+    std::map<SrsStreamKey*, SrsLiveEntry*> sflvs;
 public:
     SrsHttpStreamServer(SrsServer* svr);
     virtual ~SrsHttpStreamServer();
@@ -34,6 +34,16 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_app_ingest_native.hpp>
+#include <srs_app_rtsp_pull.hpp>
+
+ISrsIngesterTask::ISrsIngesterTask()
+{
+}
+
+ISrsIngesterTask::~ISrsIngesterTask()
+{
+}
 
 SrsIngesterFFMPEG::SrsIngesterFFMPEG()
 {
@@ -102,10 +112,12 @@ void SrsIngesterFFMPEG::fast_kill()
     ffmpeg->fast_kill();
 }
 
-SrsIngester::SrsIngester()
+SrsIngester::SrsIngester(ISrsSourceHandler* h)
 {
     _srs_config->subscribe(this);
     
+    handler = h;
+    
     expired = false;
     disposed = false;
     
@@ -127,10 +139,10 @@ void SrsIngester::dispose()
         return;
     }
     disposed = true;
-
+    
     // first, use fast stop to notice all FFMPEG to quit gracefully.
     fast_stop();
-
+    
     srs_usleep(100 * SRS_UTIME_MILLISECONDS);
     
     // then, use fast kill to ensure FFMPEG quit.
@@ -168,9 +180,9 @@ void SrsIngester::stop()
 
 void SrsIngester::fast_stop()
 {
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    std::vector<ISrsIngesterTask*>::iterator it;
     for (it = ingesters.begin(); it != ingesters.end(); ++it) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
         ingester->fast_stop();
     }
     
@@ -181,12 +193,12 @@ void SrsIngester::fast_stop()
 
 void SrsIngester::fast_kill()
 {
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    std::vector<ISrsIngesterTask*>::iterator it;
     for (it = ingesters.begin(); it != ingesters.end(); ++it) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
         ingester->fast_kill();
     }
-
+    
     if (!ingesters.empty()) {
         srs_trace("fast kill all ingesters ok.");
     }
@@ -206,13 +218,21 @@ srs_error_t SrsIngester::cycle()
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "ingester");
         }
-
+        
         if ((err = do_cycle()) != srs_success) {
             srs_warn("Ingester: Ignore error, %s", srs_error_desc(err).c_str());
             srs_freep(err);
         }
-
-        srs_usleep(SRS_AUTO_INGESTER_CIMS);
+        
+        // Wakeup to start the deferred ingester ASAP.
+        srs_utime_t interval = SRS_AUTO_INGESTER_CIMS;
+        srs_utime_t now = srs_get_system_time();
+        std::map<ISrsIngesterTask*, srs_utime_t>::iterator it;
+        for (it = deferred.begin(); it != deferred.end(); ++it) {
+            interval = srs_max(0, srs_min(interval, it->second - now));
+        }
+        
+        srs_usleep(interval);
     }
     
     return err;
@@ -237,9 +257,19 @@ srs_error_t SrsIngester::do_cycle()
     }
     
     // cycle exists ingesters.
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    srs_utime_t now = srs_get_system_time();
+    std::vector<ISrsIngesterTask*>::iterator it;
     for (it = ingesters.begin(); it != ingesters.end(); ++it) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
+        
+        // ignore the deferred ingester, until the time to start.
+        std::map<ISrsIngesterTask*, srs_utime_t>::iterator dit = deferred.find(ingester);
+        if (dit != deferred.end()) {
+            if (now < dit->second) {
+                continue;
+            }
+            deferred.erase(dit);
+        }
         
         // start all ffmpegs.
         if ((err = ingester->start()) != srs_success) {
@@ -260,14 +290,29 @@ srs_error_t SrsIngester::do_cycle()
 
 void SrsIngester::clear_engines()
 {
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    std::vector<ISrsIngesterTask*>::iterator it;
     
     for (it = ingesters.begin(); it != ingesters.end(); ++it) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
         srs_freep(ingester);
     }
     
     ingesters.clear();
+    deferred.clear();
+}
+
+void SrsIngester::append(ISrsIngesterTask* ingester)
+{
+    ingesters.push_back(ingester);
+    
+    srs_utime_t jitter = _srs_config->get_ingest_start_jitter();
+    if (jitter <= 0) {
+        return;
+    }
+    
+    srs_utime_t delay = (srs_utime_t)(rand() % srsu2ms(jitter)) * SRS_UTIME_MILLISECONDS;
+    deferred[ingester] = srs_get_system_time() + delay;
+    srs_trace("ingest %s start after %dms", ingester->uri().c_str(), srsu2msi(delay));
 }
 
 srs_error_t SrsIngester::parse()
@@ -318,14 +363,29 @@ srs_error_t SrsIngester::parse_engines(SrsConfDirective* vhost, SrsConfDirective
         return err;
     }
     
+    // get all engines.
+    std::vector<SrsConfDirective*> engines = _srs_config->get_transcode_engines(ingest);
+    
+    // For hls, http_ts, rtsp and playout, ingest in process by native ingesters, without ffmpeg.
+    std::string input_type = _srs_config->get_ingest_input_type(ingest);
+    if (srs_config_ingest_is_hls(input_type) || srs_config_ingest_is_http_ts(input_type)
+        || srs_config_ingest_is_rtsp(input_type) || srs_config_ingest_is_playout(input_type)) {
+        if (engines.empty()) {
+            return parse_native(vhost, ingest, NULL);
+        }
+        for (int i = 0; i < (int)engines.size(); i++) {
+            if ((err = parse_native(vhost, ingest, engines[i])) != srs_success) {
+                return srs_error_wrap(err, "parse native");
+            }
+        }
+        return err;
+    }
+    
     std::string ffmpeg_bin = _srs_config->get_ingest_ffmpeg(ingest);
     if (ffmpeg_bin.empty()) {
         return srs_error_new(ERROR_ENCODER_PARSE, "parse ffmpeg");
     }
     
-    // get all engines.
-    std::vector<SrsConfDirective*> engines = _srs_config->get_transcode_engines(ingest);
-    
     // create ingesters without engines.
     if (engines.empty()) {
         SrsFFMPEG* ffmpeg = new SrsFFMPEG(ffmpeg_bin);
@@ -340,7 +400,7 @@ srs_error_t SrsIngester::parse_engines(SrsConfDirective* vhost, SrsConfDirective
             return srs_error_wrap(err, "init ingester");
         }
         
-        ingesters.push_back(ingester);
+        append(ingester);
         return err;
     }
     
@@ -359,7 +419,7 @@ srs_error_t SrsIngester::parse_engines(SrsConfDirective* vhost, SrsConfDirective
             return srs_error_wrap(err, "init ingester");
         }
         
-        ingesters.push_back(ingester);
+        append(ingester);
     }
     
     return err;
@@ -412,13 +472,13 @@ srs_error_t SrsIngester::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsConfDirective*
         log_file += stream;
         log_file += ".log";
     }
-
+    
     std::string log_level = _srs_config->get_ff_log_level();
     if (!log_level.empty()) {
         ffmpeg->append_iparam("-loglevel");
         ffmpeg->append_iparam(log_level);
     }
-
+    
     // input
     std::string input_type = _srs_config->get_ingest_input_type(ingest);
     if (input_type.empty()) {
@@ -475,6 +535,67 @@ srs_error_t SrsIngester::initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsConfDirective*
     return err;
 }
 
+srs_error_t SrsIngester::parse_native(SrsConfDirective* vhost, SrsConfDirective* ingest, SrsConfDirective* engine)
+{
+    srs_error_t err = srs_success;
+    
+    // Only copy for native ingester, which never transcodes.
+    std::string vcodec = _srs_config->get_engine_vcodec(engine);
+    std::string acodec = _srs_config->get_engine_acodec(engine);
+    if (engine && _srs_config->get_engine_enabled(engine)) {
+        if ((!vcodec.empty() && vcodec != "copy") || (!acodec.empty() && acodec != "copy")) {
+            return srs_error_new(ERROR_ENCODER_INPUT_TYPE, "native ingest=%s only support copy, vcodec=%s, acodec=%s",
+                ingest->arg0().c_str(), vcodec.c_str(), acodec.c_str());
+        }
+    }
+    
+    std::string output = _srs_config->get_engine_output(engine);
+    output = srs_string_replace(output, "[vhost]", vhost->arg0());
+    output = srs_path_build_timestamp(output);
+    if (output.empty()) {
+        return srs_error_new(ERROR_ENCODER_NO_OUTPUT, "empty output url, ingest=%s", ingest->arg0().c_str());
+    }
+    
+    // find the app and stream in rtmp url, the vhost is the owner of ingest.
+    std::string app, stream;
+    if (true) {
+        int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        std::string tcUrl, schema, host, vhost2, param;
+        srs_parse_rtmp_url(output, tcUrl, stream);
+        srs_discovery_tc_url(tcUrl, schema, host, vhost2, app, stream, port, param);
+    }
+    
+    std::string input_url = _srs_config->get_ingest_input_url(ingest);
+    if (input_url.empty()) {
+        return srs_error_new(ERROR_ENCODER_NO_INPUT, "empty intput url, ingest=%s", ingest->arg0().c_str());
+    }
+    
+    SrsIngesterNative* ingester = new SrsIngesterNative(handler);
+    if ((err = ingester->initialize(vhost->arg0(), ingest->arg0(), app, stream)) != srs_success) {
+        srs_freep(ingester);
+        return srs_error_wrap(err, "init native ingester");
+    }
+    
+    std::string input_type = _srs_config->get_ingest_input_type(ingest);
+    if (srs_config_ingest_is_rtsp(input_type)) {
+        bool tcp = _srs_config->get_ingest_input_rtsp_tcp(ingest);
+        ingester->set_puller(new SrsRtspPuller(handler, ingester->request(), input_url, tcp));
+    } else if (srs_config_ingest_is_playout(input_type)) {
+        bool loop = _srs_config->get_ingest_input_loop(ingest);
+        ingester->set_puller(new SrsFilePuller(handler, ingester->request(), input_url, loop));
+    } else {
+        bool is_hls = srs_config_ingest_is_hls(input_type);
+        int prefetch = _srs_config->get_ingest_input_prefetch(ingest);
+        ingester->set_puller(new SrsTsPuller(handler, ingester->request(), input_url, is_hls, prefetch));
+    }
+    
+    append(ingester);
+    srs_trace("parse success, native ingest=%s, vhost=%s, input=%s, output=%s/%s", ingest->arg0().c_str(),
+        vhost->arg0().c_str(), input_url.c_str(), app.c_str(), stream.c_str());
+    
+    return err;
+}
+
 void SrsIngester::show_ingest_log_message()
 {
     pprint->elapse();
@@ -485,7 +606,7 @@ void SrsIngester::show_ingest_log_message()
     
     // random choose one ingester to report.
     int index = rand() % (int)ingesters.size();
-    SrsIngesterFFMPEG* ingester = ingesters.at(index);
+    ISrsIngesterTask* ingester = ingesters.at(index);
     
     // reportable
     if (pprint->can_print()) {
@@ -498,10 +619,10 @@ srs_error_t SrsIngester::on_reload_vhost_removed(string vhost)
 {
     srs_error_t err = srs_success;
     
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    std::vector<ISrsIngesterTask*>::iterator it;
     
     for (it = ingesters.begin(); it != ingesters.end();) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
         
         if (!ingester->equals(vhost)) {
             ++it;
@@ -513,6 +634,7 @@ srs_error_t SrsIngester::on_reload_vhost_removed(string vhost)
         
         srs_trace("reload stop ingester, vhost=%s, id=%s", vhost.c_str(), ingester->uri().c_str());
         
+        deferred.erase(ingester);
         srs_freep(ingester);
         
         // remove the item from ingesters.
@@ -540,10 +662,10 @@ srs_error_t SrsIngester::on_reload_ingest_removed(string vhost, string ingest_id
 {
     srs_error_t err = srs_success;
     
-    std::vector<SrsIngesterFFMPEG*>::iterator it;
+    std::vector<ISrsIngesterTask*>::iterator it;
     
     for (it = ingesters.begin(); it != ingesters.end();) {
-        SrsIngesterFFMPEG* ingester = *it;
+        ISrsIngesterTask* ingester = *it;
         
         if (!ingester->equals(vhost, ingest_id)) {
             ++it;
@@ -555,6 +677,7 @@ srs_error_t SrsIngester::on_reload_ingest_removed(string vhost, string ingest_id
         
         srs_trace("reload stop ingester, vhost=%s, id=%s", vhost.c_str(), ingester->uri().c_str());
         
+        deferred.erase(ingester);
         srs_freep(ingester);
         
         // remove the item from ingesters.
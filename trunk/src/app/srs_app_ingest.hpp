@@ -27,6 +27,7 @@
 #include <srs_core.hpp>
 
 #include <vector>
+#include <map>
 
 #include <srs_app_thread.hpp>
 #include <srs_app_reload.hpp>
@@ -34,9 +35,34 @@
 class SrsFFMPEG;
 class SrsConfDirective;
 class SrsPithyPrint;
+class ISrsSourceHandler;
+
+// The task of ingester, by a ffmpeg process, or native in process.
+class ISrsIngesterTask
+{
+public:
+    ISrsIngesterTask();
+    virtual ~ISrsIngesterTask();
+public:
+    // The ingest uri, [vhost]/[ingest id]
+    virtual std::string uri() = 0;
+    // The alive in srs_utime_t.
+    virtual srs_utime_t alive() = 0;
+    virtual bool equals(std::string v, std::string i) = 0;
+    virtual bool equals(std::string v) = 0;
+public:
+    // Start the task, ignore when already started.
+    virtual srs_error_t start() = 0;
+    virtual void stop() = 0;
+    // Check the task, which is restarted by start when terminated.
+    virtual srs_error_t cycle() = 0;
+    // @see SrsFFMPEG.fast_stop().
+    virtual void fast_stop() = 0;
+    virtual void fast_kill() = 0;
+};
 
 // Ingester ffmpeg object.
-class SrsIngesterFFMPEG
+class SrsIngesterFFMPEG : public ISrsIngesterTask
 {
 private:
     std::string vhost;
@@ -69,7 +95,11 @@ public:
 class SrsIngester : public ISrsCoroutineHandler, public ISrsReloadHandler
 {
 private:
-    std::vector<SrsIngesterFFMPEG*> ingesters;
+    std::vector<ISrsIngesterTask*> ingesters;
+    // The deferred ingesters to start after the time, by the jitter of config.
+    std::map<ISrsIngesterTask*, srs_utime_t> deferred;
+    // The handler for the native ingesters to publish to source.
+    ISrsSourceHandler* handler;
 private:
     SrsCoroutine* trd;
     SrsPithyPrint* pprint;
@@ -79,7 +109,7 @@ private:
     // Whether already disposed.
     bool disposed;
 public:
-    SrsIngester();
+    SrsIngester(ISrsSourceHandler* h);
     virtual ~SrsIngester();
 public:
     virtual void dispose();
@@ -98,10 +128,13 @@ private:
     virtual srs_error_t do_cycle();
 private:
     virtual void clear_engines();
+    // Append the ingester, which starts after a random delay in jitter.
+    virtual void append(ISrsIngesterTask* ingester);
     virtual srs_error_t parse();
     virtual srs_error_t parse_ingesters(SrsConfDirective* vhost);
     virtual srs_error_t parse_engines(SrsConfDirective* vhost, SrsConfDirective* ingest);
     virtual srs_error_t initialize_ffmpeg(SrsFFMPEG* ffmpeg, SrsConfDirective* vhost, SrsConfDirective* ingest, SrsConfDirective* engine);
+    virtual srs_error_t parse_native(SrsConfDirective* vhost, SrsConfDirective* ingest, SrsConfDirective* engine);
     virtual void show_ingest_log_message();
 // Interface ISrsReloadHandler.
 public:
@@ -0,0 +1,1560 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_ingest_native.hpp>
+
+#include <stdlib.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_raw_avc.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_service_utility.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_pithy_print.hpp>
+#include <srs_app_hourglass.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_mp4.hpp>
+
+// The interval to retry when pull failed.
+#define SRS_INGEST_NATIVE_CIMS (3 * SRS_UTIME_SECONDS)
+// The timeout to fetch the playlist or segment.
+#define SRS_INGEST_NATIVE_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The hold window in ms for HTTP-TS, to sort the audio and video messages.
+#define SRS_INGEST_NATIVE_HOLD 300
+// The max gap for realtime pacing, reset the base when exceed it.
+#define SRS_INGEST_NATIVE_MAX_GAP (3 * SRS_UTIME_SECONDS)
+// The gap in ms between the last frame of file and the first frame of next loop, about a frame.
+#define SRS_INGEST_PLAYOUT_LOOP_GAP 40
+
+// Fetch the url by HTTP GET, the body must be read all for the transport to be reused.
+static srs_error_t srs_ingest_http_get(string url, string& body)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpUri uri;
+    if ((err = uri.initialize(url)) != srs_success) {
+        return srs_error_wrap(err, "parse url=%s", url.c_str());
+    }
+    
+    SrsHttpClient client;
+    client.set_pool(SrsHttpClientPool::instance());
+    if ((err = client.initialize(uri.get_host(), uri.get_port(), SRS_INGEST_NATIVE_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "http: init client");
+    }
+    
+    string path = uri.get_path();
+    if (!uri.get_query().empty()) {
+        path += "?" + uri.get_query();
+    }
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = client.get(path, "", &msg)) != srs_success) {
+        return srs_error_wrap(err, "http: get %s", url.c_str());
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    if ((err = msg->body_read_all(body)) != srs_success) {
+        return srs_error_wrap(err, "http: read body");
+    }
+    
+    if (msg->status_code() != SRS_CONSTS_HTTP_OK) {
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "http: status=%d, url=%s", msg->status_code(), url.c_str());
+    }
+    
+    return err;
+}
+
+string srs_hls_resolve_url(string base, string url)
+{
+    if (srs_string_is_http(url)) {
+        return url;
+    }
+    
+    // Ignore the query of base url.
+    size_t pos = string::npos;
+    if ((pos = base.find("?")) != string::npos) {
+        base = base.substr(0, pos);
+    }
+    
+    // For absolute path, use the schema and host of base url.
+    if (srs_string_starts_with(url, "/")) {
+        if ((pos = base.find("://")) != string::npos && (pos = base.find("/", pos + 3)) != string::npos) {
+            base = base.substr(0, pos);
+        }
+        return base + url;
+    }
+    
+    return srs_path_dirname(base) + "/" + url;
+}
+
+ISrsIngestPuller::ISrsIngestPuller()
+{
+}
+
+ISrsIngestPuller::~ISrsIngestPuller()
+{
+}
+
+SrsM3u8Segment::SrsM3u8Segment()
+{
+    sequence = 0;
+    duration = 0;
+    fetching = false;
+    fetched = false;
+    failed = false;
+}
+
+SrsM3u8Segment::~SrsM3u8Segment()
+{
+}
+
+SrsM3u8Playlist::SrsM3u8Playlist()
+{
+    target_duration = 0;
+    media_sequence = 0;
+    endlist = false;
+}
+
+SrsM3u8Playlist::~SrsM3u8Playlist()
+{
+    std::vector<SrsM3u8Segment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        SrsM3u8Segment* seg = *it;
+        srs_freep(seg);
+    }
+    segments.clear();
+}
+
+srs_error_t SrsM3u8Playlist::parse(string url, string body)
+{
+    srs_error_t err = srs_success;
+    
+    if (!srs_string_starts_with(body, "#EXTM3U")) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hls: no #EXTM3U, url=%s", url.c_str());
+    }
+    
+    // The duration of segment, parsed from EXTINF, -1 if not in EXTINF.
+    double duration = -1;
+    bool stream_inf = false;
+    vector<string> lines = srs_string_split(body, "\n");
+    for (int i = 0; i < (int)lines.size(); i++) {
+        string line = srs_string_trim_start(srs_string_trim_end(lines.at(i), " \r"), " ");
+        if (line.empty()) {
+            continue;
+        }
+        
+        // #EXT-X-TARGETDURATION:12
+        if (srs_string_starts_with(line, "#EXT-X-TARGETDURATION:")) {
+            target_duration = ::atof(line.substr(string("#EXT-X-TARGETDURATION:").length()).c_str());
+            continue;
+        }
+        
+        // #EXT-X-MEDIA-SEQUENCE:5
+        if (srs_string_starts_with(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            media_sequence = ::atoll(line.substr(string("#EXT-X-MEDIA-SEQUENCE:").length()).c_str());
+            continue;
+        }
+        
+        // #EXT-X-ENDLIST
+        if (line == "#EXT-X-ENDLIST") {
+            endlist = true;
+            continue;
+        }
+        
+        // #EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=73207,CODECS="mp4a.40.2"
+        if (srs_string_starts_with(line, "#EXT-X-STREAM-INF:")) {
+            stream_inf = true;
+            continue;
+        }
+        
+        // #EXTINF:11.401,
+        if (srs_string_starts_with(line, "#EXTINF:")) {
+            duration = ::atof(line.substr(string("#EXTINF:").length()).c_str());
+            continue;
+        }
+        
+        // Ignore other tags.
+        if (srs_string_starts_with(line, "#")) {
+            continue;
+        }
+        
+        // The url of the first variant, we use it as the media playlist.
+        if (stream_inf) {
+            variant = srs_hls_resolve_url(url, line);
+            return err;
+        }
+        
+        // The url of segment, which must follow the EXTINF.
+        if (duration < 0) {
+            continue;
+        }
+        
+        SrsM3u8Segment* seg = new SrsM3u8Segment();
+        seg->sequence = media_sequence + (int64_t)segments.size();
+        seg->url = srs_hls_resolve_url(url, line);
+        seg->duration = duration;
+        segments.push_back(seg);
+        
+        duration = -1;
+    }
+    
+    return err;
+}
+
+SrsTsSourceBridge::SrsTsSourceBridge()
+{
+    publisher = NULL;
+    context = new SrsTsContext();
+    buffer = new SrsSimpleStream();
+    
+    avc = new SrsRawH264Stream();
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = false;
+    
+    aac = new SrsRawAacStream();
+    
+    trd = NULL;
+    base_clock = 0;
+    base_dts = 0;
+}
+
+SrsTsSourceBridge::~SrsTsSourceBridge()
+{
+    std::multimap<int64_t, SrsCommonMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsCommonMessage* msg = it->second;
+        srs_freep(msg);
+    }
+    msgs.clear();
+    
+    srs_freep(context);
+    srs_freep(buffer);
+    srs_freep(avc);
+    srs_freep(aac);
+}
+
+void SrsTsSourceBridge::set_publisher(ISrsPublisher* p)
+{
+    publisher = p;
+}
+
+void SrsTsSourceBridge::set_realtime(SrsCoroutine* t)
+{
+    trd = t;
+    base_clock = 0;
+}
+
+srs_error_t SrsTsSourceBridge::on_data(char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // Decode the packets in data directly, when no partial packet is buffered.
+    if (!buffer->length()) {
+        int consumed = decode(data, size);
+        if (consumed < size) {
+            buffer->append(data + consumed, size - consumed);
+        }
+        return err;
+    }
+    
+    buffer->append(data, size);
+    
+    int consumed = decode(buffer->bytes(), buffer->length());
+    if (consumed > 0) {
+        buffer->erase(consumed);
+    }
+    
+    return err;
+}
+
+int SrsTsSourceBridge::decode(char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // find the sync byte of mpegts.
+    int pos = 0;
+    while (pos < size && data[pos] != 0x47) {
+        pos++;
+    }
+    
+    // use stream to parse ts packet.
+    int nb_packet = (size - pos) / SRS_TS_PACKET_SIZE;
+    for (int i = 0; i < nb_packet; i++) {
+        char* p = data + pos + (i * SRS_TS_PACKET_SIZE);
+        
+        SrsBuffer stream(p, SRS_TS_PACKET_SIZE);
+        
+        // process each ts packet
+        if ((err = context->decode(&stream, this)) != srs_success) {
+            srs_warn("ingest: parse ts packet err=%s", srs_error_desc(err).c_str());
+            srs_error_reset(err);
+            continue;
+        }
+    }
+    
+    return pos + nb_packet * SRS_TS_PACKET_SIZE;
+}
+
+srs_error_t SrsTsSourceBridge::flush(int64_t hold)
+{
+    srs_error_t err = srs_success;
+    
+    if (msgs.empty()) {
+        return err;
+    }
+    
+    int64_t newest = msgs.rbegin()->first;
+    while (!msgs.empty()) {
+        std::multimap<int64_t, SrsCommonMessage*>::iterator it = msgs.begin();
+        if (it->first > newest - hold) {
+            break;
+        }
+        
+        int64_t dts = it->first;
+        SrsCommonMessage* msg = it->second;
+        msgs.erase(it);
+        
+        if ((err = pace(dts)) != srs_success) {
+            srs_freep(msg);
+            return srs_error_wrap(err, "pace");
+        }
+        
+        if ((err = publish(msg)) != srs_success) {
+            return srs_error_wrap(err, "publish");
+        }
+    }
+    
+    return err;
+}
+
+int SrsTsSourceBridge::nb_queued()
+{
+    return (int)msgs.size();
+}
+
+srs_error_t SrsTsSourceBridge::on_ts_message(SrsTsMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // When the audio SID is private stream 1, we use common audio.
+    // @see https://github.com/ossrs/srs/issues/740
+    if (msg->channel->apply == SrsTsPidApplyAudio && msg->sid == SrsTsPESStreamIdPrivateStream1) {
+        msg->sid = SrsTsPESStreamIdAudioCommon;
+    }
+    
+    // Ignore the other streams, for example, the ID3 timed metadata of HLS.
+    if (msg->stream_number() != 0) {
+        return err;
+    }
+    if (msg->channel->stream != SrsTsStreamVideoH264 && msg->channel->stream != SrsTsStreamAudioAAC) {
+        srs_info("ingest: ignore ts stream codec=%d", msg->channel->stream);
+        return err;
+    }
+    
+    // parse the stream.
+    SrsBuffer avs(msg->payload->bytes(), msg->payload->length());
+    
+    if (msg->channel->stream == SrsTsStreamVideoH264) {
+        if ((err = on_ts_video(msg, &avs)) != srs_success) {
+            return srs_error_wrap(err, "ts: consume video");
+        }
+    }
+    if (msg->channel->stream == SrsTsStreamAudioAAC) {
+        if ((err = on_ts_audio(msg, &avs)) != srs_success) {
+            return srs_error_wrap(err, "ts: consume audio");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsSourceBridge::on_ts_video(SrsTsMessage* msg, SrsBuffer* avs)
+{
+    srs_error_t err = srs_success;
+    
+    // ts tbn to flv tbn.
+    uint32_t dts = (uint32_t)(msg->dts / 90);
+    uint32_t pts = (uint32_t)(msg->pts / 90);
+    
+    // All NALUs of a PES is a frame, which is a FLV message.
+    std::string ibp;
+    SrsVideoAvcFrameType frame_type = SrsVideoAvcFrameTypeInterFrame;
+    
+    while (!avs->empty()) {
+        char* frame = NULL;
+        int frame_size = 0;
+        if ((err = avc->annexb_demux(avs, &frame, &frame_size)) != srs_success) {
+            return srs_error_wrap(err, "demux annexb");
+        }
+        
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // 5bits, 7.3.1 NAL unit syntax,
+        // ISO_IEC_14496-10-AVC-2003.pdf, page 44.
+        //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
+        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
+        
+        // ignore the nalu type aud(9)
+        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+            continue;
+        }
+        
+        // for sps
+        if (avc->is_sps(frame, frame_size)) {
+            std::string sps;
+            if ((err = avc->sps_demux(frame, frame_size, sps)) != srs_success) {
+                return srs_error_wrap(err, "demux sps");
+            }
+            
+            if (h264_sps != sps) {
+                h264_sps_changed = true;
+                h264_sps = sps;
+            }
+            continue;
+        }
+        
+        // for pps
+        if (avc->is_pps(frame, frame_size)) {
+            std::string pps;
+            if ((err = avc->pps_demux(frame, frame_size, pps)) != srs_success) {
+                return srs_error_wrap(err, "demux pps");
+            }
+            
+            if (h264_pps != pps) {
+                h264_pps_changed = true;
+                h264_pps = pps;
+            }
+            continue;
+        }
+        
+        // for IDR frame, the frame is keyframe.
+        if (nal_unit_type == SrsAvcNaluTypeIDR) {
+            frame_type = SrsVideoAvcFrameTypeKeyFrame;
+        }
+        
+        std::string nalu;
+        if ((err = avc->mux_ipb_frame(frame, frame_size, nalu)) != srs_success) {
+            return srs_error_wrap(err, "mux frame");
+        }
+        ibp.append(nalu);
+    }
+    
+    // The sps or pps changed, update the sequence header before the frame.
+    if ((err = write_h264_sps_pps(dts, pts)) != srs_success) {
+        return srs_error_wrap(err, "write sps/pps");
+    }
+    
+    // when sps or pps not sent, ignore the packet.
+    // @see https://github.com/ossrs/srs/issues/203
+    if (ibp.empty() || !h264_sps_pps_sent) {
+        return err;
+    }
+    
+    int8_t avc_packet_type = SrsVideoAvcFrameTraitNALU;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((err = avc->mux_avc2flv(ibp, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != srs_success) {
+        return srs_error_wrap(err, "mux avc to flv");
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    return queue_packet(SrsFrameTypeVideo, dts, flv, nb_flv);
+}
+
+srs_error_t SrsTsSourceBridge::write_h264_sps_pps(uint32_t dts, uint32_t pts)
+{
+    srs_error_t err = srs_success;
+    
+    // Wait for both sps and pps, and update the sequence header when any changed.
+    if (!h264_sps_changed && !h264_pps_changed) {
+        return err;
+    }
+    if (h264_sps.empty() || h264_pps.empty()) {
+        return err;
+    }
+    
+    // h264 raw to h264 packet.
+    std::string sh;
+    if ((err = avc->mux_sequence_header(h264_sps, h264_pps, dts, pts, sh)) != srs_success) {
+        return srs_error_wrap(err, "mux sequence header");
+    }
+    
+    // h264 packet to flv packet.
+    int8_t frame_type = SrsVideoAvcFrameTypeKeyFrame;
+    int8_t avc_packet_type = SrsVideoAvcFrameTraitSequenceHeader;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((err = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != srs_success) {
+        return srs_error_wrap(err, "avc to flv");
+    }
+    
+    if ((err = queue_packet(SrsFrameTypeVideo, dts, flv, nb_flv)) != srs_success) {
+        return srs_error_wrap(err, "queue packet");
+    }
+    
+    // reset sps and pps.
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = true;
+    
+    return err;
+}
+
+srs_error_t SrsTsSourceBridge::on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs)
+{
+    srs_error_t err = srs_success;
+    
+    // ts tbn to flv tbn.
+    uint32_t dts = (uint32_t)(msg->dts / 90);
+    
+    // send each frame, each AAC frame is 1024 samples after the previous one.
+    for (int nb_frames = 0; !avs->empty();) {
+        char* frame = NULL;
+        int frame_size = 0;
+        SrsRawAacStreamCodec codec;
+        if ((err = aac->adts_demux(avs, &frame, &frame_size, codec)) != srs_success) {
+            return srs_error_wrap(err, "demux adts");
+        }
+        
+        // ignore invalid frame,
+        //  * atleast 1bytes for aac to decode the data.
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        int sample_rate = 44100;
+        if (codec.sampling_frequency_index >= 0 && codec.sampling_frequency_index < 12) {
+            sample_rate = srs_aac_srates[(int)codec.sampling_frequency_index];
+        }
+        uint32_t timestamp = dts + (uint32_t)(nb_frames++ * 1024 * 1000 / sample_rate);
+        
+        // generate sh.
+        if (aac_specific_config.empty()) {
+            std::string sh;
+            if ((err = aac->mux_sequence_header(&codec, sh)) != srs_success) {
+                return srs_error_wrap(err, "mux sequence header");
+            }
+            aac_specific_config = sh;
+            
+            codec.aac_packet_type = 0;
+            
+            char* data = NULL;
+            int size = 0;
+            if ((err = aac->mux_aac2flv((char*)sh.data(), (int)sh.length(), &codec, timestamp, &data, &size)) != srs_success) {
+                return srs_error_wrap(err, "mux aac to flv");
+            }
+            if ((err = queue_packet(SrsFrameTypeAudio, timestamp, data, size)) != srs_success) {
+                return srs_error_wrap(err, "queue packet");
+            }
+        }
+        
+        // audio raw data.
+        codec.aac_packet_type = 1;
+        
+        char* data = NULL;
+        int size = 0;
+        if ((err = aac->mux_aac2flv(frame, frame_size, &codec, timestamp, &data, &size)) != srs_success) {
+            return srs_error_wrap(err, "mux aac to flv");
+        }
+        if ((err = queue_packet(SrsFrameTypeAudio, timestamp, data, size)) != srs_success) {
+            return srs_error_wrap(err, "queue packet");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsSourceBridge::queue_packet(char type, uint32_t timestamp, char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    SrsCommonMessage* msg = NULL;
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, &msg)) != srs_success) {
+        return srs_error_wrap(err, "create message");
+    }
+    
+    // The message with the same dts is in the order of insertion.
+    msgs.insert(std::make_pair((int64_t)timestamp, msg));
+    
+    return err;
+}
+
+srs_error_t SrsTsSourceBridge::pace(int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    if (!trd) {
+        return err;
+    }
+    
+    srs_utime_t now = srs_update_system_time();
+    srs_utime_t deadline = base_clock + (dts - base_dts) * SRS_UTIME_MILLISECONDS;
+    
+    // Reset the base when start, or timestamp jumps, or we are too late.
+    if (!base_clock || dts < base_dts || deadline > now + SRS_INGEST_NATIVE_MAX_GAP || deadline < now - SRS_INGEST_NATIVE_MAX_GAP) {
+        base_clock = now;
+        base_dts = dts;
+        return err;
+    }
+    
+    while (now < deadline) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        srs_usleep(srs_min(deadline - now, 100 * SRS_UTIME_MILLISECONDS));
+        now = srs_update_system_time();
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsSourceBridge::publish(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    SrsAutoFree(SrsCommonMessage, msg);
+    
+    // Drop the message when no publisher, for example, in utest.
+    if (!publisher) {
+        return err;
+    }
+    
+    if ((err = publisher->on_message(msg)) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    return err;
+}
+
+SrsTsPuller::SrsTsPuller(ISrsSourceHandler* h, SrsRequest* r, string i, bool hls, int p)
+{
+    handler = h;
+    req = r;
+    input = i;
+    is_hls = hls;
+    prefetch = srs_max(1, p);
+    
+    trd = NULL;
+    publisher = new SrsLocalPublisher(h);
+    publisher->set_request(r);
+    bridge = new SrsTsSourceBridge();
+    pprint = SrsPithyPrint::create_ingester();
+    
+    wanted = srs_cond_new();
+    ready = srs_cond_new();
+    
+    reset();
+}
+
+SrsTsPuller::~SrsTsPuller()
+{
+    stop();
+    
+    srs_freep(bridge);
+    srs_freep(publisher);
+    srs_freep(pprint);
+    
+    srs_cond_destroy(wanted);
+    srs_cond_destroy(ready);
+}
+
+srs_error_t SrsTsPuller::start()
+{
+    srs_error_t err = srs_success;
+    
+    // Ignore when started, the coroutine retries when failed.
+    if (trd) {
+        return err;
+    }
+    
+    SrsSTCoroutine* st = new SrsSTCoroutine("ingest-native", this, _srs_context->get_id());
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+void SrsTsPuller::stop()
+{
+    if (trd) {
+        trd->stop();
+    }
+    srs_freep(trd);
+    
+    // The fetchers are stopped by coroutine, we free them for the coroutine is never started.
+    std::vector<SrsHlsFetcher*>::iterator it;
+    for (it = fetchers.begin(); it != fetchers.end(); ++it) {
+        SrsHlsFetcher* fetcher = *it;
+        srs_freep(fetcher);
+    }
+    fetchers.clear();
+    
+    reset();
+}
+
+void SrsTsPuller::interrupt()
+{
+    if (trd) {
+        trd->interrupt();
+    }
+}
+
+srs_error_t SrsTsPuller::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = do_cycle()) != srs_success) {
+            srs_warn("ingest: native ignore error, url=%s, %s", input.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "ingest native");
+        }
+        
+        srs_usleep(SRS_INGEST_NATIVE_CIMS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsPuller::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    srs_trace("ingest: native publish %s, input=%s, hls=%d, prefetch=%d", req->get_stream_url().c_str(),
+        input.c_str(), is_hls, prefetch);
+    
+    // Renew the bridge for each publish, to reset the TS context and codec.
+    srs_freep(bridge);
+    bridge = new SrsTsSourceBridge();
+    bridge->set_publisher(publisher);
+    
+    if (is_hls) {
+        err = pull_hls();
+    } else {
+        err = pull_http_ts();
+    }
+    
+    publisher->unpublish();
+    
+    return err;
+}
+
+srs_error_t SrsTsPuller::pull_hls()
+{
+    srs_error_t err = srs_success;
+    
+    reset();
+    bridge->set_realtime(trd);
+    
+    for (int i = 0; i < prefetch; i++) {
+        SrsHlsFetcher* fetcher = new SrsHlsFetcher(this);
+        fetchers.push_back(fetcher);
+        
+        if ((err = fetcher->start()) != srs_success) {
+            break;
+        }
+    }
+    
+    if (err == srs_success) {
+        err = consume_hls();
+    }
+    
+    // Stop all fetchers before free the segments.
+    std::vector<SrsHlsFetcher*>::iterator it;
+    for (it = fetchers.begin(); it != fetchers.end(); ++it) {
+        SrsHlsFetcher* fetcher = *it;
+        fetcher->stop();
+        srs_freep(fetcher);
+    }
+    fetchers.clear();
+    
+    reset();
+    
+    return err;
+}
+
+srs_error_t SrsTsPuller::consume_hls()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        // Publish the fetched segments in sequence, skip the failed one.
+        while (!segments.empty()) {
+            SrsM3u8Segment* seg = segments.front();
+            if (!seg->fetched && !seg->failed) {
+                break;
+            }
+            
+            // Remove it from queue, for the fetchers may queue more segments when we are pacing.
+            segments.erase(segments.begin());
+            SrsAutoFree(SrsM3u8Segment, seg);
+            
+            if (seg->failed) {
+                srs_warn("ingest: native skip segment seq=%" PRId64 ", url=%s", seg->sequence, seg->url.c_str());
+                continue;
+            }
+            
+            pprint->elapse();
+            if (pprint->can_print()) {
+                srs_trace("ingest: native %s seq=%" PRId64 ", duration=%.2f, size=%d, queue=%d",
+                    req->get_stream_url().c_str(), seg->sequence, seg->duration, (int)seg->body.length(), (int)segments.size());
+            }
+            
+            if ((err = bridge->on_data((char*)seg->body.data(), (int)seg->body.length())) != srs_success) {
+                return srs_error_wrap(err, "demux segment");
+            }
+            
+            if ((err = bridge->flush(0)) != srs_success) {
+                return srs_error_wrap(err, "flush segment");
+            }
+        }
+        
+        // The VOD or finished live stream is done.
+        if (endlist && segments.empty()) {
+            srs_trace("ingest: native %s finished, input=%s", req->get_stream_url().c_str(), input.c_str());
+            return err;
+        }
+        
+        srs_cond_timedwait(ready, 100 * SRS_UTIME_MILLISECONDS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsPuller::pull_http_ts()
+{
+    srs_error_t err = srs_success;
+    
+    bridge->set_realtime(NULL);
+    
+    SrsHttpUri uri;
+    if ((err = uri.initialize(input)) != srs_success) {
+        return srs_error_wrap(err, "parse url=%s", input.c_str());
+    }
+    
+    // The live stream never ends, so we never use the pool.
+    SrsHttpClient client;
+    if ((err = client.initialize(uri.get_host(), uri.get_port(), SRS_INGEST_NATIVE_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "http: init client");
+    }
+    
+    string path = uri.get_path();
+    if (!uri.get_query().empty()) {
+        path += "?" + uri.get_query();
+    }
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = client.get(path, "", &msg)) != srs_success) {
+        return srs_error_wrap(err, "http: get %s", input.c_str());
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    if (msg->status_code() != SRS_CONSTS_HTTP_OK) {
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "http: status=%d, url=%s", msg->status_code(), input.c_str());
+    }
+    
+    int nb_buf = 64 * SRS_TS_PACKET_SIZE;
+    char* buf = new char[nb_buf];
+    SrsAutoFreeA(char, buf);
+    
+    ISrsHttpResponseReader* br = msg->body_reader();
+    while (!br->eof()) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        ssize_t nread = 0;
+        if ((err = br->read(buf, nb_buf, &nread)) != srs_success) {
+            return srs_error_wrap(err, "read body");
+        }
+        
+        if ((err = bridge->on_data(buf, (int)nread)) != srs_success) {
+            return srs_error_wrap(err, "demux");
+        }
+        
+        if ((err = bridge->flush(SRS_INGEST_NATIVE_HOLD)) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("ingest: native %s, input=%s, queue=%d", req->get_stream_url().c_str(), input.c_str(), bridge->nb_queued());
+        }
+    }
+    
+    return bridge->flush(0);
+}
+
+void SrsTsPuller::reset()
+{
+    std::vector<SrsM3u8Segment*>::iterator it;
+    for (it = segments.begin(); it != segments.end(); ++it) {
+        SrsM3u8Segment* seg = *it;
+        srs_freep(seg);
+    }
+    segments.clear();
+    
+    m3u8 = input;
+    target_duration = 0;
+    endlist = false;
+    refreshing = false;
+    next_refresh = 0;
+    next_sequence = -1;
+}
+
+srs_error_t SrsTsPuller::refresh()
+{
+    srs_error_t err = srs_success;
+    
+    string body;
+    if ((err = srs_ingest_http_get(m3u8, body)) != srs_success) {
+        return srs_error_wrap(err, "fetch m3u8");
+    }
+    
+    SrsM3u8Playlist playlist;
+    if ((err = playlist.parse(m3u8, body)) != srs_success) {
+        return srs_error_wrap(err, "parse m3u8");
+    }
+    
+    // For master playlist, refresh the variant now.
+    if (!playlist.variant.empty()) {
+        srs_trace("ingest: native use variant %s of %s", playlist.variant.c_str(), m3u8.c_str());
+        m3u8 = playlist.variant;
+        next_refresh = 0;
+        return err;
+    }
+    
+    // Refresh the live playlist by half of target duration.
+    target_duration = playlist.target_duration;
+    endlist = playlist.endlist;
+    next_refresh = srs_get_system_time() + srs_max(500 * SRS_UTIME_MILLISECONDS, (srs_utime_t)(target_duration * SRS_UTIME_SECONDS / 2));
+    
+    if (playlist.segments.empty()) {
+        return err;
+    }
+    
+    int64_t first = playlist.segments.front()->sequence;
+    int64_t last = playlist.segments.back()->sequence;
+    
+    if (next_sequence < 0) {
+        // For live stream, start from the last segment, to reduce the latency.
+        next_sequence = endlist? first : last;
+    } else if (next_sequence > last + 1) {
+        srs_warn("ingest: native sequence reset, next=%" PRId64 ", playlist=[%" PRId64 ", %" PRId64 "]", next_sequence, first, last);
+        next_sequence = last;
+    } else if (next_sequence < first) {
+        srs_warn("ingest: native skip segments, next=%" PRId64 ", playlist=[%" PRId64 ", %" PRId64 "]", next_sequence, first, last);
+        next_sequence = first;
+    }
+    
+    bool queued = false;
+    for (int i = 0; i < (int)playlist.segments.size(); i++) {
+        SrsM3u8Segment* seg = playlist.segments.at(i);
+        if (seg->sequence < next_sequence) {
+            continue;
+        }
+        
+        // Move the segment to queue.
+        playlist.segments[i] = NULL;
+        segments.push_back(seg);
+        next_sequence = seg->sequence + 1;
+        queued = true;
+    }
+    
+    if (queued) {
+        srs_cond_broadcast(wanted);
+    }
+    
+    return err;
+}
+
+SrsM3u8Segment* SrsTsPuller::pick()
+{
+    // Only prefetch some segments, to limit the memory for VOD.
+    for (int i = 0; i < (int)segments.size() && i < prefetch; i++) {
+        SrsM3u8Segment* seg = segments.at(i);
+        if (!seg->fetching && !seg->fetched && !seg->failed) {
+            return seg;
+        }
+    }
+    return NULL;
+}
+
+SrsHlsFetcher::SrsHlsFetcher(SrsTsPuller* p)
+{
+    puller = p;
+    SrsSTCoroutine* st = new SrsSTCoroutine("ingest-fetch", this, _srs_context->get_id());
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
+}
+
+SrsHlsFetcher::~SrsHlsFetcher()
+{
+    srs_freep(trd);
+}
+
+srs_error_t SrsHlsFetcher::start()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+void SrsHlsFetcher::stop()
+{
+    trd->stop();
+}
+
+void SrsHlsFetcher::interrupt()
+{
+    trd->interrupt();
+}
+
+srs_error_t SrsHlsFetcher::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Wakeup the puller, which may wait for the segment.
+    srs_cond_signal(puller->ready);
+    
+    return err;
+}
+
+srs_error_t SrsHlsFetcher::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        // Refresh the playlist when it's due, only one fetcher refresh it.
+        if (!puller->refreshing && !puller->endlist && srs_get_system_time() >= puller->next_refresh) {
+            puller->refreshing = true;
+            err = puller->refresh();
+            puller->refreshing = false;
+            
+            if (err != srs_success) {
+                srs_warn("ingest: native refresh %s err %s", puller->m3u8.c_str(), srs_error_desc(err).c_str());
+                srs_freep(err);
+                puller->next_refresh = srs_get_system_time() + SRS_UTIME_SECONDS;
+            }
+            continue;
+        }
+        
+        SrsM3u8Segment* seg = puller->pick();
+        if (!seg) {
+            srs_cond_timedwait(puller->wanted, 100 * SRS_UTIME_MILLISECONDS);
+            continue;
+        }
+        
+        seg->fetching = true;
+        err = srs_ingest_http_get(seg->url, seg->body);
+        seg->fetching = false;
+        
+        if (err != srs_success) {
+            srs_warn("ingest: native fetch %s err %s", seg->url.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            seg->failed = true;
+        } else {
+            seg->fetched = true;
+        }
+        
+        srs_cond_signal(puller->ready);
+    }
+    
+    return err;
+}
+
+SrsFilePuller::SrsFilePuller(ISrsSourceHandler* h, SrsRequest* r, string i, bool l)
+{
+    handler = h;
+    req = r;
+    input = i;
+    loop = l;
+    
+    trd = NULL;
+    publisher = new SrsLocalPublisher(h);
+    publisher->set_request(r);
+    pprint = NULL;
+    
+    offset = 0;
+    start_dts = -1;
+    last_dts = -1;
+    nb_frames = 0;
+    nb_loops = 0;
+    base_clock = 0;
+    base_dts = 0;
+}
+
+SrsFilePuller::~SrsFilePuller()
+{
+    stop();
+    
+    srs_freep(publisher);
+    srs_freep(pprint);
+}
+
+srs_error_t SrsFilePuller::start()
+{
+    srs_error_t err = srs_success;
+    
+    // Ignore when started, the coroutine retries when failed.
+    if (trd) {
+        return err;
+    }
+    
+    SrsSTCoroutine* st = new SrsSTCoroutine("ingest-playout", this, _srs_context->get_id());
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+void SrsFilePuller::stop()
+{
+    if (trd) {
+        trd->stop();
+    }
+    srs_freep(trd);
+}
+
+void SrsFilePuller::interrupt()
+{
+    if (trd) {
+        trd->interrupt();
+    }
+}
+
+srs_error_t SrsFilePuller::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = do_cycle()) != srs_success) {
+            srs_warn("ingest: playout ignore error, file=%s, %s", input.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "ingest playout");
+        }
+        
+        srs_usleep(SRS_INGEST_NATIVE_CIMS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    srs_trace("ingest: playout publish %s, file=%s, loop=%d", req->get_stream_url().c_str(), input.c_str(), loop);
+    
+    // Each publish starts from timestamp 0.
+    srs_freep(pprint);
+    pprint = SrsPithyPrint::create_ingester();
+    offset = 0;
+    last_dts = -1;
+    base_clock = 0;
+    
+    for (nb_loops = 0; err == srs_success; nb_loops++) {
+        if ((err = trd->pull()) != srs_success) {
+            err = srs_error_wrap(err, "pull");
+            break;
+        }
+        
+        SrsFileReader fr;
+        if ((err = fr.open(input)) != srs_success) {
+            err = srs_error_wrap(err, "open %s", input.c_str());
+            break;
+        }
+        
+        if ((err = play(&fr)) != srs_success) {
+            err = srs_error_wrap(err, "play %s", input.c_str());
+            break;
+        }
+        
+        if (!loop) {
+            srs_trace("ingest: playout %s finished, file=%s", req->get_stream_url().c_str(), input.c_str());
+            break;
+        }
+    }
+    
+    publisher->unpublish();
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::play(SrsFileReader* fr)
+{
+    srs_error_t err = srs_success;
+    
+    // Continue the timestamp of previous loop.
+    offset = (last_dts >= 0)? last_dts + SRS_INGEST_PLAYOUT_LOOP_GAP : 0;
+    start_dts = -1;
+    nb_frames = 0;
+    
+    if (srs_string_ends_with(input, ".mp4")) {
+        err = play_mp4(fr);
+    } else {
+        err = play_flv(fr);
+    }
+    
+    if (err != srs_success) {
+        return err;
+    }
+    
+    // Never loop the file without any frame, which is busy.
+    if (!nb_frames) {
+        return srs_error_new(ERROR_SYSTEM_FILE_EOF, "no frame");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::play_flv(SrsFileReader* fr)
+{
+    srs_error_t err = srs_success;
+    
+    SrsFlvDecoder dec;
+    if ((err = dec.initialize(fr)) != srs_success) {
+        return srs_error_wrap(err, "init flv decoder");
+    }
+    
+    char header[9];
+    if ((err = dec.read_header(header)) != srs_success) {
+        return srs_error_wrap(err, "read header");
+    }
+    
+    char pps[4];
+    if ((err = dec.read_previous_tag_size(pps)) != srs_success) {
+        return srs_error_wrap(err, "read pts");
+    }
+    
+    while (true) {
+        char type = 0;
+        int32_t size = 0;
+        uint32_t time = 0;
+        if ((err = dec.read_tag_header(&type, &size, &time)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SYSTEM_FILE_EOF) {
+                srs_freep(err);
+                break;
+            }
+            return srs_error_wrap(err, "read tag header");
+        }
+        
+        char* data = new char[size];
+        if ((err = dec.read_tag_data(data, size)) != srs_success) {
+            srs_freepa(data);
+            return srs_error_wrap(err, "read tag data");
+        }
+        
+        if ((err = dec.read_previous_tag_size(pps)) != srs_success) {
+            srs_freepa(data);
+            return srs_error_wrap(err, "read pts");
+        }
+        
+        if ((err = on_tag(type, time, data, size)) != srs_success) {
+            return srs_error_wrap(err, "on tag");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::play_mp4(SrsFileReader* fr)
+{
+    srs_error_t err = srs_success;
+    
+    SrsMp4Decoder dec;
+    if ((err = dec.initialize(fr)) != srs_success) {
+        return srs_error_wrap(err, "init mp4 decoder");
+    }
+    
+    while (true) {
+        SrsMp4HandlerType ht = SrsMp4HandlerTypeForbidden;
+        uint16_t ft = 0, ct = 0;
+        uint32_t dts = 0, pts = 0, nb_sample = 0;
+        uint8_t* sample = NULL;
+        if ((err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SYSTEM_FILE_EOF) {
+                srs_freep(err);
+                break;
+            }
+            return srs_error_wrap(err, "read sample");
+        }
+        SrsAutoFreeA(uint8_t, sample);
+        
+        // Covert the sample to flv tag, see srs_mp4_to_flv_tag.
+        char* data = new char[nb_sample + 5];
+        SrsBuffer p(data, nb_sample + 5);
+        
+        char type = 0;
+        if (ht == SrsMp4HandlerTypeSOUN) {
+            type = SrsFrameTypeAudio;
+            // E.4.2.1 AUDIODATA, flv_v10_1.pdf, page 3
+            p.write_1bytes(uint8_t(dec.acodec << 4) | uint8_t(dec.sample_rate << 2) | uint8_t(dec.sound_bits << 1) | dec.channels);
+            if (dec.acodec == SrsAudioCodecIdAAC) {
+                p.write_1bytes(uint8_t(ct == (uint16_t)SrsAudioAacFrameTraitSequenceHeader? 0:1));
+            }
+        } else {
+            type = SrsFrameTypeVideo;
+            // E.4.3.1 VIDEODATA, flv_v10_1.pdf, page 5
+            p.write_1bytes(uint8_t(ft << 4) | uint8_t(dec.vcodec));
+            p.write_1bytes(uint8_t(ct == (uint16_t)SrsVideoAvcFrameTraitSequenceHeader? 0:1));
+            p.write_3bytes(pts - dts);
+        }
+        p.write_bytes((char*)sample, nb_sample);
+        
+        if ((err = on_tag(type, dts, data, p.pos())) != srs_success) {
+            return srs_error_wrap(err, "on sample");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::on_tag(char type, uint32_t timestamp, char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // The file starts from the first audio or video, the metadata before it is at the start.
+    bool av = (type == SrsFrameTypeAudio || type == SrsFrameTypeVideo);
+    if (av && start_dts < 0) {
+        start_dts = timestamp;
+    }
+    int64_t dts = offset + ((start_dts < 0)? 0 : srs_max(0, (int64_t)timestamp - start_dts));
+    
+    SrsCommonMessage* msg = NULL;
+    if ((err = srs_rtmp_create_msg(type, (uint32_t)dts, data, size, 1, &msg)) != srs_success) {
+        return srs_error_wrap(err, "create message");
+    }
+    
+    // Pace the audio and video, the metadata is published immediately.
+    if (av) {
+        if ((err = pace(dts)) != srs_success) {
+            srs_freep(msg);
+            return srs_error_wrap(err, "pace");
+        }
+        
+        last_dts = srs_max(last_dts, dts);
+        nb_frames++;
+    }
+    
+    if ((err = publish(msg)) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    // The pithy print is created when publish, NULL when play without coroutine, for example, in utest.
+    if (!pprint) {
+        return err;
+    }
+    
+    pprint->elapse();
+    if (pprint->can_print()) {
+        srs_trace("ingest: playout %s, file=%s, time=%" PRId64 "ms, frames=%d, loops=%d", req->get_stream_url().c_str(),
+            input.c_str(), dts, nb_frames, nb_loops);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::pace(int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    if (!trd) {
+        return err;
+    }
+    
+    srs_utime_t now = srs_update_system_time();
+    srs_utime_t deadline = base_clock + (dts - base_dts) * SRS_UTIME_MILLISECONDS;
+    
+    // Reset the base when start, or timestamp jumps, or we are too late.
+    if (!base_clock || dts < base_dts || deadline > now + SRS_INGEST_NATIVE_MAX_GAP || deadline < now - SRS_INGEST_NATIVE_MAX_GAP) {
+        base_clock = now;
+        base_dts = dts;
+        return err;
+    }
+    
+    while (now < deadline) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        // Sleep in the timer wheel, for there are hundreds of playout channels.
+        _srs_timer->usleep(srs_min(deadline - now, 100 * SRS_UTIME_MILLISECONDS));
+        now = srs_update_system_time();
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFilePuller::publish(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    SrsAutoFree(SrsCommonMessage, msg);
+    
+    if ((err = publisher->on_message(msg)) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    return err;
+}
+
+SrsIngesterNative::SrsIngesterNative(ISrsSourceHandler* h)
+{
+    handler = h;
+    req = NULL;
+    puller = NULL;
+    starttime = 0;
+}
+
+SrsIngesterNative::~SrsIngesterNative()
+{
+    srs_freep(puller);
+    srs_freep(req);
+}
+
+srs_error_t SrsIngesterNative::initialize(string v, string i, string app, string stream)
+{
+    srs_error_t err = srs_success;
+    
+    vhost = v;
+    id = i;
+    starttime = srs_get_system_time();
+    
+    // The request to publish to source, the vhost is the owner of ingest.
+    srs_freep(req);
+    req = new SrsRequest();
+    req->vhost = vhost;
+    req->host = (vhost == SRS_CONSTS_RTMP_DEFAULT_VHOST)? "127.0.0.1" : vhost;
+    req->app = app;
+    req->stream = stream;
+    req->schema = "rtmp";
+    req->port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    req->tcUrl = srs_generate_tc_url(req->host, req->vhost, req->app, req->port);
+    
+    return err;
+}
+
+SrsRequest* SrsIngesterNative::request()
+{
+    return req;
+}
+
+void SrsIngesterNative::set_puller(ISrsIngestPuller* p)
+{
+    srs_freep(puller);
+    puller = p;
+}
+
+string SrsIngesterNative::uri()
+{
+    return vhost + "/" + id;
+}
+
+srs_utime_t SrsIngesterNative::alive()
+{
+    return srs_get_system_time() - starttime;
+}
+
+bool SrsIngesterNative::equals(string v)
+{
+    return vhost == v;
+}
+
+bool SrsIngesterNative::equals(string v, string i)
+{
+    return vhost == v && id == i;
+}
+
+srs_error_t SrsIngesterNative::start()
+{
+    return puller->start();
+}
+
+void SrsIngesterNative::stop()
+{
+    puller->stop();
+}
+
+srs_error_t SrsIngesterNative::cycle()
+{
+    // The puller retries by itself.
+    return srs_success;
+}
+
+void SrsIngesterNative::fast_stop()
+{
+    puller->interrupt();
+}
+
+void SrsIngesterNative::fast_kill()
+{
+    puller->stop();
+}
+
@@ -0,0 +1,325 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_INGEST_NATIVE_HPP
+#define SRS_APP_INGEST_NATIVE_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <srs_app_st.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_app_ingest.hpp>
+
+class SrsSource;
+class ISrsPublisher;
+class SrsLocalPublisher;
+class SrsRequest;
+class ISrsSourceHandler;
+class SrsSimpleStream;
+class SrsRawH264Stream;
+class SrsRawAacStream;
+struct SrsRawAacStreamCodec;
+class SrsCommonMessage;
+class SrsPithyPrint;
+class SrsBuffer;
+class SrsHlsFetcher;
+class SrsFileReader;
+
+// The puller to pull stream in process, and publish to source, which retries by itself.
+class ISrsIngestPuller
+{
+public:
+    ISrsIngestPuller();
+    virtual ~ISrsIngestPuller();
+public:
+    virtual srs_error_t start() = 0;
+    virtual void stop() = 0;
+    virtual void interrupt() = 0;
+};
+
+// Resolve the url in playlist, which is absolute, or relative to the base url.
+extern std::string srs_hls_resolve_url(std::string base, std::string url);
+
+// The segment of HLS playlist, to ingest.
+class SrsM3u8Segment
+{
+public:
+    int64_t sequence;
+    // The absolute url of segment.
+    std::string url;
+    double duration;
+    // The body of segment, fetched by fetcher.
+    std::string body;
+    bool fetching;
+    bool fetched;
+    bool failed;
+public:
+    SrsM3u8Segment();
+    virtual ~SrsM3u8Segment();
+};
+
+// The HLS playlist to ingest, the m3u8 file.
+class SrsM3u8Playlist
+{
+public:
+    // The EXT-X-TARGETDURATION in seconds.
+    double target_duration;
+    // The EXT-X-MEDIA-SEQUENCE, the sequence of first segment.
+    int64_t media_sequence;
+    // Whether EXT-X-ENDLIST, the playlist is VOD or finished.
+    bool endlist;
+    // The absolute url of variant playlist, from EXT-X-STREAM-INF, empty if media playlist.
+    std::string variant;
+    std::vector<SrsM3u8Segment*> segments;
+public:
+    SrsM3u8Playlist();
+    virtual ~SrsM3u8Playlist();
+public:
+    // Parse the playlist body, which is fetched from url.
+    virtual srs_error_t parse(std::string url, std::string body);
+};
+
+// The bridge to demux the TS packets and publish to source, without RTMP client.
+// @remark The messages are sorted by dts, because the audio of TS is muxed in PES
+//      which contains many frames.
+class SrsTsSourceBridge : public ISrsTsHandler
+{
+private:
+    ISrsPublisher* publisher;
+    SrsTsContext* context;
+    // The buffer for partial TS packets.
+    SrsSimpleStream* buffer;
+private:
+    SrsRawH264Stream* avc;
+    std::string h264_sps;
+    std::string h264_pps;
+    bool h264_sps_changed;
+    bool h264_pps_changed;
+    bool h264_sps_pps_sent;
+private:
+    SrsRawAacStream* aac;
+    std::string aac_specific_config;
+private:
+    // The key: dts in ms, value: msg.
+    std::multimap<int64_t, SrsCommonMessage*> msgs;
+    // The coroutine to pace the messages in realtime, NULL to publish as fast as possible.
+    SrsCoroutine* trd;
+    srs_utime_t base_clock;
+    int64_t base_dts;
+public:
+    SrsTsSourceBridge();
+    virtual ~SrsTsSourceBridge();
+public:
+    // Set the publisher to consume the messages, which is not owned by bridge.
+    virtual void set_publisher(ISrsPublisher* p);
+    // Pace the messages by timestamp, by sleeping in coroutine t.
+    virtual void set_realtime(SrsCoroutine* t);
+    // Demux the TS data, which is not required to be aligned to TS packet.
+    // @remark The packets are decoded in place, only the partial packet is buffered.
+    virtual srs_error_t on_data(char* data, int size);
+    // Publish the sorted messages, except the messages in the hold window in ms.
+    virtual srs_error_t flush(int64_t hold);
+    virtual int nb_queued();
+// Interface ISrsTsHandler
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* msg);
+private:
+    // Decode the TS packets in data from the sync byte, return the bytes consumed.
+    virtual int decode(char* data, int size);
+    virtual srs_error_t on_ts_video(SrsTsMessage* msg, SrsBuffer* avs);
+    virtual srs_error_t write_h264_sps_pps(uint32_t dts, uint32_t pts);
+    virtual srs_error_t on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs);
+    virtual srs_error_t queue_packet(char type, uint32_t timestamp, char* data, int size);
+    virtual srs_error_t pace(int64_t dts);
+protected:
+    // Publish the message by publisher, and free it.
+    virtual srs_error_t publish(SrsCommonMessage* msg);
+};
+
+// The puller to pull HLS or HTTP-TS stream, and publish to source in process.
+class SrsTsPuller : public ISrsCoroutineHandler, public ISrsIngestPuller
+{
+    friend class SrsHlsFetcher;
+private:
+    ISrsSourceHandler* handler;
+    SrsRequest* req;
+    std::string input;
+    bool is_hls;
+    int prefetch;
+private:
+    SrsCoroutine* trd;
+    SrsLocalPublisher* publisher;
+    SrsTsSourceBridge* bridge;
+    SrsPithyPrint* pprint;
+private:
+    // The fetchers to refresh the playlist and fetch segments in parallel.
+    std::vector<SrsHlsFetcher*> fetchers;
+    // The resolved url of media playlist.
+    std::string m3u8;
+    double target_duration;
+    bool endlist;
+    bool refreshing;
+    srs_utime_t next_refresh;
+    // The next sequence to fetch, -1 if the playlist is never parsed.
+    int64_t next_sequence;
+    // The segments to fetch and publish, in sequence.
+    std::vector<SrsM3u8Segment*> segments;
+    // Signaled when segment is queued, or fetched.
+    srs_cond_t wanted;
+    srs_cond_t ready;
+public:
+    SrsTsPuller(ISrsSourceHandler* h, SrsRequest* r, std::string i, bool hls, int p);
+    virtual ~SrsTsPuller();
+// Interface ISrsIngestPuller
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    virtual void interrupt();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t pull_hls();
+    virtual srs_error_t consume_hls();
+    virtual srs_error_t pull_http_ts();
+    virtual void reset();
+private:
+    // Refresh the playlist and queue the new segments, by fetchers.
+    virtual srs_error_t refresh();
+    // Pick a segment to fetch, NULL if no segment.
+    virtual SrsM3u8Segment* pick();
+};
+
+// The fetcher of HLS, to refresh the playlist or fetch a segment.
+class SrsHlsFetcher : public ISrsCoroutineHandler
+{
+private:
+    SrsTsPuller* puller;
+    SrsCoroutine* trd;
+public:
+    SrsHlsFetcher(SrsTsPuller* p);
+    virtual ~SrsHlsFetcher();
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    virtual void interrupt();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+};
+
+// The puller to read the local FLV or MP4 file, and publish to source in process, paced by timestamp,
+// like ffmpeg -re -stream_loop, for the 24/7 playout channels without the process and RTMP loopback.
+// @remark The timestamp continues when loop, so the players never see the timestamp jump back.
+class SrsFilePuller : public ISrsCoroutineHandler, public ISrsIngestPuller
+{
+private:
+    ISrsSourceHandler* handler;
+    SrsRequest* req;
+    std::string input;
+    bool loop;
+private:
+    SrsCoroutine* trd;
+    SrsLocalPublisher* publisher;
+    SrsPithyPrint* pprint;
+private:
+    // The offset in ms of current loop, to rebase the timestamp in file.
+    int64_t offset;
+    // The timestamp of the first audio or video in file of current loop, -1 if not read.
+    int64_t start_dts;
+    // The max timestamp in ms published, to start the next loop after it.
+    int64_t last_dts;
+    // The number of frames published in current loop, and the number of loops.
+    int nb_frames;
+    int nb_loops;
+    srs_utime_t base_clock;
+    int64_t base_dts;
+public:
+    SrsFilePuller(ISrsSourceHandler* h, SrsRequest* r, std::string i, bool l);
+    virtual ~SrsFilePuller();
+// Interface ISrsIngestPuller
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    virtual void interrupt();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    // Read the file once, from the first tag or sample, then continue the timestamp for next loop.
+    virtual srs_error_t play(SrsFileReader* fr);
+    virtual srs_error_t play_flv(SrsFileReader* fr);
+    virtual srs_error_t play_mp4(SrsFileReader* fr);
+    // Rebase the timestamp, pace and publish the tag, the data is owned by message.
+    virtual srs_error_t on_tag(char type, uint32_t timestamp, char* data, int size);
+    virtual srs_error_t pace(int64_t dts);
+protected:
+    // Publish the message by publisher, and free it.
+    virtual srs_error_t publish(SrsCommonMessage* msg);
+};
+
+// The ingester to pull HLS, HTTP-TS, RTSP or local file in process, without ffmpeg.
+// @remark Only copy, that is, never transcode the stream.
+class SrsIngesterNative : public ISrsIngesterTask
+{
+private:
+    std::string vhost;
+    std::string id;
+    SrsRequest* req;
+    ISrsIngestPuller* puller;
+    ISrsSourceHandler* handler;
+    srs_utime_t starttime;
+public:
+    SrsIngesterNative(ISrsSourceHandler* h);
+    virtual ~SrsIngesterNative();
+public:
+    // Initialize the request to publish, then user should set the puller.
+    virtual srs_error_t initialize(std::string v, std::string i, std::string app, std::string stream);
+    // The request of stream to publish, which is owned by ingester.
+    virtual SrsRequest* request();
+    // Set the puller, which is owned by ingester.
+    virtual void set_puller(ISrsIngestPuller* p);
+// Interface ISrsIngesterTask
+public:
+    virtual std::string uri();
+    virtual srs_utime_t alive();
+    virtual bool equals(std::string v, std::string i);
+    virtual bool equals(std::string v);
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+    virtual srs_error_t cycle();
+    virtual void fast_stop();
+    virtual void fast_kill();
+};
+
+#endif
+
@@ -39,6 +39,7 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_app_server.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_kernel_utility.hpp>
 
 // set the max packet size.
 #define SRS_UDP_MAX_PACKET_SIZE 65535
@@ -59,6 +60,31 @@ srs_error_t ISrsUdpHandler::on_stfd_change(srs_netfd_t /*fd*/)
     return srs_success;
 }
 
+srs_error_t ISrsUdpHandler::on_udp_packets(SrsUdpPacket** pkts, int nn_pkts)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < nn_pkts; i++) {
+        SrsUdpPacket* pkt = pkts[i];
+        if ((err = on_udp_packet((const sockaddr*)&pkt->from, pkt->fromlen, pkt->buf, pkt->nb_buf)) != srs_success) {
+            return srs_error_wrap(err, "handle packet %d bytes", pkt->nb_buf);
+        }
+    }
+    
+    return err;
+}
+
+SrsUdpPacket::SrsUdpPacket()
+{
+    fromlen = 0;
+    buf = NULL;
+    nb_buf = 0;
+}
+
+SrsUdpPacket::~SrsUdpPacket()
+{
+}
+
 ISrsTcpHandler::ISrsTcpHandler()
 {
 }
@@ -73,9 +99,16 @@ SrsUdpListener::SrsUdpListener(ISrsUdpHandler* h, string i, int p)
     ip = i;
     port = p;
     lfd = NULL;
+    inherited = -1;
     
+    nn_pkts = 1;
     nb_buf = SRS_UDP_MAX_PACKET_SIZE;
-    buf = new char[nb_buf];
+    buf = NULL;
+    pkts = NULL;
+#ifdef SRS_PERF_UDP_RECVMMSG
+    msgs = NULL;
+    iovs = NULL;
+#endif
     
     trd = new SrsDummyCoroutine();
 }
@@ -84,7 +117,21 @@ SrsUdpListener::~SrsUdpListener()
 {
     srs_freep(trd);
     srs_close_stfd(lfd);
+    
+    if (inherited >= 0) {
+        ::close(inherited);
+    }
     srs_freepa(buf);
+    
+    for (int i = 0; pkts && i < nn_pkts; i++) {
+        srs_freep(pkts[i]);
+    }
+    srs_freepa(pkts);
+    
+#ifdef SRS_PERF_UDP_RECVMMSG
+    srs_freepa(msgs);
+    srs_freepa(iovs);
+#endif
 }
 
 int SrsUdpListener::fd()
@@ -97,16 +144,57 @@ srs_netfd_t SrsUdpListener::stfd()
     return lfd;
 }
 
+void SrsUdpListener::inherit(int fd)
+{
+    inherited = fd;
+}
+
+void SrsUdpListener::set_batch(int v)
+{
+    srs_assert(!buf && v > 0);
+#ifdef SRS_PERF_UDP_RECVMMSG
+    nn_pkts = v;
+#endif
+}
+
 srs_error_t SrsUdpListener::listen()
 {
     srs_error_t err = srs_success;
-
-    if ((err = srs_udp_listen(ip, port, &lfd)) != srs_success) {
+    
+    if (inherited >= 0) {
+        if ((lfd = srs_netfd_open_socket(inherited)) == NULL) {
+            return srs_error_new(ERROR_ST_OPEN_SOCKET, "open inherited fd=%d", inherited);
+        }
+        inherited = -1;
+    } else if ((err = srs_udp_listen(ip, port, &lfd)) != srs_success) {
         return srs_error_wrap(err, "listen %s:%d", ip.c_str(), port);
     }
     
+    // The packet arena, each packet has its own buffer.
+    if (!buf) {
+        buf = new char[nb_buf * nn_pkts];
+        pkts = new SrsUdpPacket*[nn_pkts];
+        for (int i = 0; i < nn_pkts; i++) {
+            pkts[i] = new SrsUdpPacket();
+        }
+        
+#ifdef SRS_PERF_UDP_RECVMMSG
+        msgs = new mmsghdr[nn_pkts];
+        iovs = new iovec[nn_pkts];
+        memset(msgs, 0, sizeof(mmsghdr) * nn_pkts);
+        for (int i = 0; i < nn_pkts; i++) {
+            iovs[i].iov_base = buf + i * nb_buf;
+            iovs[i].iov_len = nb_buf;
+            msgs[i].msg_hdr.msg_iov = iovs + i;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+    
     srs_freep(trd);
-    trd = new SrsSTCoroutine("udp", this);
+    SrsSTCoroutine* st = new SrsSTCoroutine("udp", this);
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "start thread");
     }
@@ -122,16 +210,14 @@ srs_error_t SrsUdpListener::cycle()
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "udp listener");
         }
-
-        int nread = 0;
-        sockaddr_storage from;
-        int nb_from = sizeof(from);
-        if ((nread = srs_recvfrom(lfd, buf, nb_buf, (sockaddr*)&from, &nb_from, SRS_UTIME_NO_TIMEOUT)) <= 0) {
-            return srs_error_new(ERROR_SOCKET_READ, "udp read, nread=%d", nread);
+        
+        int nn = 0;
+        if ((err = recv_packets(nn)) != srs_success) {
+            return srs_error_wrap(err, "recv packets");
         }
         
-        if ((err = handler->on_udp_packet((const sockaddr*)&from, nb_from, buf, nread)) != srs_success) {
-            return srs_error_wrap(err, "handle packet %d bytes", nread);
+        if ((err = handler->on_udp_packets(pkts, nn)) != srs_success) {
+            return srs_error_wrap(err, "handle %d packets", nn);
         }
         
         if (SrsUdpPacketRecvCycleInterval > 0) {
@@ -142,13 +228,48 @@ srs_error_t SrsUdpListener::cycle()
     return err;
 }
 
+srs_error_t SrsUdpListener::recv_packets(int& nn)
+{
+    srs_error_t err = srs_success;
+    
+#ifdef SRS_PERF_UDP_RECVMMSG
+    for (int i = 0; i < nn_pkts; i++) {
+        msgs[i].msg_hdr.msg_name = &pkts[i]->from;
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    }
+    
+    if ((nn = srs_recvmmsg(lfd, msgs, nn_pkts, SRS_UTIME_NO_TIMEOUT)) <= 0) {
+        return srs_error_new(ERROR_SOCKET_READ, "udp read, nn=%d", nn);
+    }
+    
+    for (int i = 0; i < nn; i++) {
+        SrsUdpPacket* pkt = pkts[i];
+        pkt->fromlen = (int)msgs[i].msg_hdr.msg_namelen;
+        pkt->buf = buf + i * nb_buf;
+        pkt->nb_buf = (int)msgs[i].msg_len;
+    }
+#else
+    SrsUdpPacket* pkt = pkts[0];
+    pkt->buf = buf;
+    pkt->fromlen = sizeof(sockaddr_storage);
+    if ((pkt->nb_buf = srs_recvfrom(lfd, buf, nb_buf, (sockaddr*)&pkt->from, &pkt->fromlen, SRS_UTIME_NO_TIMEOUT)) <= 0) {
+        return srs_error_new(ERROR_SOCKET_READ, "udp read, nread=%d", pkt->nb_buf);
+    }
+    nn = 1;
+#endif
+    
+    return err;
+}
+
 SrsTcpListener::SrsTcpListener(ISrsTcpHandler* h, string i, int p)
 {
     handler = h;
     ip = i;
     port = p;
-
+    
     lfd = NULL;
+    inherited = -1;
+    batch = 1;
     
     trd = new SrsDummyCoroutine();
 }
@@ -157,6 +278,10 @@ SrsTcpListener::~SrsTcpListener()
 {
     srs_freep(trd);
     srs_close_stfd(lfd);
+    
+    if (inherited >= 0) {
+        ::close(inherited);
+    }
 }
 
 int SrsTcpListener::fd()
@@ -164,11 +289,26 @@ int SrsTcpListener::fd()
     return srs_netfd_fileno(lfd);;
 }
 
+void SrsTcpListener::inherit(int fd)
+{
+    inherited = fd;
+}
+
+void SrsTcpListener::set_batch(int v)
+{
+    batch = srs_max(1, v);
+}
+
 srs_error_t SrsTcpListener::listen()
 {
     srs_error_t err = srs_success;
-
-    if ((err = srs_tcp_listen(ip, port, &lfd)) != srs_success) {
+    
+    if (inherited >= 0) {
+        if ((lfd = srs_netfd_open_socket(inherited)) == NULL) {
+            return srs_error_new(ERROR_ST_OPEN_SOCKET, "open inherited fd=%d", inherited);
+        }
+        inherited = -1;
+    } else if ((err = srs_tcp_listen(ip, port, &lfd)) != srs_success) {
         return srs_error_wrap(err, "listen at %s:%d", ip.c_str(), port);
     }
     
@@ -195,12 +335,42 @@ srs_error_t SrsTcpListener::cycle()
             return srs_error_new(ERROR_SOCKET_ACCEPT, "accept at fd=%d", srs_netfd_fileno(lfd));
         }
         
-	    if ((err = srs_fd_closeexec(srs_netfd_fileno(fd))) != srs_success) {
-	        return srs_error_wrap(err, "set closeexec");
-	    }
+        // Drain the backlog without waiting, to dispatch the clients in a batch, so the backlog
+        // never overflows when lots of clients reconnect.
+        std::vector<srs_netfd_t> fds;
+        fds.push_back(fd);
+        while ((int)fds.size() < batch && (fd = srs_accept(lfd, NULL, NULL, 0)) != NULL) {
+            fds.push_back(fd);
+        }
+        
+        if ((err = do_dispatch(fds)) != srs_success) {
+            return srs_error_wrap(err, "dispatch %d clients", (int)fds.size());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTcpListener::do_dispatch(vector<srs_netfd_t>& fds)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < (int)fds.size(); i++) {
+        srs_netfd_t fd = fds[i];
+        
+        if ((err = srs_fd_closeexec(srs_netfd_fileno(fd))) != srs_success) {
+            err = srs_error_wrap(err, "set closeexec fd=%d", srs_netfd_fileno(fd));
+            srs_close_stfd(fd);
+        } else if ((err = handler->on_tcp_client(fd)) != srs_success) {
+            err = srs_error_wrap(err, "handle fd=%d", srs_netfd_fileno(fd));
+        }
         
-        if ((err = handler->on_tcp_client(fd)) != srs_success) {
-            return srs_error_wrap(err, "handle fd=%d", srs_netfd_fileno(fd));
+        // Close the clients not dispatched, never leak them.
+        if (err != srs_success) {
+            for (int j = i + 1; j < (int)fds.size(); j++) {
+                srs_close_stfd(fds[j]);
+            }
+            return err;
         }
     }
     
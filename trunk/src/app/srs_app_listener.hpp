@@ -27,11 +27,29 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
+
+#include <sys/socket.h>
 
 #include <srs_app_st.hpp>
 #include <srs_app_thread.hpp>
 
 struct sockaddr;
+struct mmsghdr;
+struct iovec;
+
+// The udp packet received by listener, the buf is in the packet arena of listener.
+class SrsUdpPacket
+{
+public:
+    sockaddr_storage from;
+    int fromlen;
+    char* buf;
+    int nb_buf;
+public:
+    SrsUdpPacket();
+    virtual ~SrsUdpPacket();
+};
 
 // The udp packet handler.
 class ISrsUdpHandler
@@ -52,6 +70,10 @@ public:
     // @param nb_buf, the size of udp packet bytes.
     // @remark user should never use the buf, for it's a shared memory bytes.
     virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf) = 0;
+    // When udp listener got a batch of udp packets, in the order of received.
+    // @remark The default implementation calls on_udp_packet for each packet.
+    // @remark user should never use the packets, for they are in the shared arena.
+    virtual srs_error_t on_udp_packets(SrsUdpPacket** pkts, int nn_pkts);
 };
 
 // The tcp connection handler.
@@ -72,23 +94,41 @@ private:
     srs_netfd_t lfd;
     SrsCoroutine* trd;
 private:
+    // The arena of packets, each packet has a buffer of nb_buf bytes.
     char* buf;
     int nb_buf;
+    SrsUdpPacket** pkts;
+    int nn_pkts;
+#ifdef SRS_PERF_UDP_RECVMMSG
+    mmsghdr* msgs;
+    iovec* iovs;
+#endif
 private:
     ISrsUdpHandler* handler;
     std::string ip;
     int port;
+    // The fd inherited from old process, -1 to bind the port.
+    int inherited;
 public:
     SrsUdpListener(ISrsUdpHandler* h, std::string i, int p);
     virtual ~SrsUdpListener();
 public:
     virtual int fd();
     virtual srs_netfd_t stfd();
+    // Listen at the fd inherited from old process for gracefully upgrade, rather than bind.
+    // @remark User must set it before listen, and the fd is owned by listener.
+    virtual void inherit(int fd);
+    // Set the max number of packets to receive in a syscall, default to 1.
+    // @remark User must set it before listen, and it's ignored if not SRS_PERF_UDP_RECVMMSG.
+    virtual void set_batch(int v);
 public:
     virtual srs_error_t listen();
 // Interface ISrsReusableThreadHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    // Receive a batch of packets, return the number of packets.
+    virtual srs_error_t recv_packets(int& nn);
 };
 
 // Bind and listen tcp port, use handler to process the client.
@@ -101,16 +141,27 @@ private:
     ISrsTcpHandler* handler;
     std::string ip;
     int port;
+    // The fd inherited from old process, -1 to bind the port.
+    int inherited;
+    // The max number of clients to accept in a batch.
+    int batch;
 public:
     SrsTcpListener(ISrsTcpHandler* h, std::string i, int p);
     virtual ~SrsTcpListener();
 public:
     virtual int fd();
+    // Listen at the fd inherited from old process for gracefully upgrade, rather than bind.
+    // @remark User must set it before listen, and the fd is owned by listener.
+    virtual void inherit(int fd);
+    // Accept at most v clients without waiting, then dispatch them to handler, default to 1.
+    virtual void set_batch(int v);
 public:
     virtual srs_error_t listen();
 // Interface ISrsReusableThreadHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_dispatch(std::vector<srs_netfd_t>& fds);
 };
 
 #endif
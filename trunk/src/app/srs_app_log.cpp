@@ -24,10 +24,12 @@
 #include <srs_app_log.hpp>
 
 #include <stdarg.h>
+#include <signal.h>
 #include <sys/time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -44,6 +46,226 @@
 // reserved for the end of log data, it must be strlen(LOG_TAIL)
 #define LOG_TAIL_SIZE 1
 
+SrsAsyncLogWriter::SrsAsyncLogWriter()
+{
+    started = false;
+    quit = false;
+    data = NULL;
+    capacity = 0;
+    head = tail = 0;
+    fd = pending_fd = -1;
+    drop_notice = true;
+    nn_pending_drops = nn_drops = drop_bytes = 0;
+    nn_batches = nn_bytes = 0;
+}
+
+SrsAsyncLogWriter::~SrsAsyncLogWriter()
+{
+    stop();
+    
+    if (pending_fd > 0) {
+        ::close(pending_fd);
+    }
+    if (fd > 0) {
+        ::close(fd);
+    }
+    
+    srs_freepa(data);
+}
+
+srs_error_t SrsAsyncLogWriter::start(int size)
+{
+    srs_error_t err = srs_success;
+    
+    capacity = srs_max(LOG_MAX_SIZE, size);
+    data = new char[capacity];
+    
+    int r0 = 0;
+    if ((r0 = pthread_create(&tid, NULL, SrsAsyncLogWriter::pfn, this)) != 0) {
+        return srs_error_new(ERROR_SYSTEM_LOG_THREAD, "create thread, r0=%d", r0);
+    }
+    started = true;
+    
+    return err;
+}
+
+void SrsAsyncLogWriter::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    quit = true;
+    __sync_synchronize();
+    
+    pthread_join(tid, NULL);
+    started = false;
+    
+    // The thread is quit, it's ok to print the stat to the fd.
+    if (fd > 0 && drop_notice && nn_drops > 0) {
+        char buf[256];
+        int size = snprintf(buf, sizeof(buf), "[log] async writer quit, batches=%" PRId64 ", bytes=%" PRId64
+            ", drop %" PRId64 " logs, %" PRId64 " bytes\n", nn_batches, nn_bytes, nn_drops, drop_bytes);
+        ::write(fd, buf, srs_min(size, (int)sizeof(buf) - 1));
+    }
+}
+
+void SrsAsyncLogWriter::set_fd(int v)
+{
+    int prev = __sync_lock_test_and_set(&pending_fd, v);
+    
+    // The previous fd is not taken by writer thread, close it.
+    if (prev > 0) {
+        ::close(prev);
+    }
+}
+
+void SrsAsyncLogWriter::set_drop_notice(bool v)
+{
+    drop_notice = v;
+}
+
+void SrsAsyncLogWriter::write(const char* str_log, int size)
+{
+    // Write the notice of drops before the log, so it's in the same position of the lost logs.
+    if (drop_notice && nn_pending_drops > 0) {
+        char buf[256];
+        int nn = snprintf(buf, sizeof(buf), "[log] drop %" PRId64 " logs for ring is full, total drop %" PRId64
+            " logs, %" PRId64 " bytes\n", nn_pending_drops, nn_drops, drop_bytes);
+        if (!push(buf, srs_min(nn, (int)sizeof(buf) - 1))) {
+            nn_pending_drops++;
+            nn_drops++;
+            drop_bytes += size;
+            return;
+        }
+        nn_pending_drops = 0;
+    }
+    
+    if (!push(str_log, size)) {
+        nn_pending_drops++;
+        nn_drops++;
+        drop_bytes += size;
+    }
+}
+
+int64_t SrsAsyncLogWriter::drops()
+{
+    return nn_drops;
+}
+
+bool SrsAsyncLogWriter::push(const char* buf, int size)
+{
+    uint64_t h = head;
+    // Read the tail after the data is consumed by writer thread.
+    __sync_synchronize();
+    uint64_t t = tail;
+    
+    if (h - t + size > (uint64_t)capacity) {
+        return false;
+    }
+    
+    int pos = (int)(h % capacity);
+    int nn = srs_min(size, capacity - pos);
+    memcpy(data + pos, buf, nn);
+    if (nn < size) {
+        memcpy(data, buf + nn, size - nn);
+    }
+    
+    // Publish the head after the data is copied.
+    __sync_synchronize();
+    head = h + size;
+    
+    return true;
+}
+
+void* SrsAsyncLogWriter::pfn(void* arg)
+{
+    // The signals are always handled by the ST thread.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    SrsAsyncLogWriter* p = (SrsAsyncLogWriter*)arg;
+    p->cycle();
+    
+    return NULL;
+}
+
+void SrsAsyncLogWriter::cycle()
+{
+    while (true) {
+        bool stopping = quit;
+        __sync_synchronize();
+        
+        // Quit until all logs are written.
+        int nn = flush();
+        if (stopping && nn == 0) {
+            return;
+        }
+        
+        // Wait for more logs to write in batch, unless the ring is almost full.
+        if (!stopping && nn < capacity / 2) {
+            usleep(SRS_LOG_ASYNC_INTERVAL);
+        }
+    }
+}
+
+int SrsAsyncLogWriter::flush()
+{
+    // Take the new fd, for log rotate or reload.
+    int v = __sync_lock_test_and_set(&pending_fd, -1);
+    if (v > 0) {
+        if (fd > 0) {
+            ::close(fd);
+        }
+        fd = v;
+    }
+    
+    uint64_t t = tail;
+    uint64_t h = head;
+    // Read the data after the head is published by producer.
+    __sync_synchronize();
+    
+    if (h == t) {
+        return 0;
+    }
+    
+    // The data in ring is at most 2 parts, when it's wrapped.
+    int size = (int)(h - t);
+    int pos = (int)(t % capacity);
+    
+    iovec iovs[2];
+    int nn_iovs = 1;
+    iovs[0].iov_base = data + pos;
+    iovs[0].iov_len = srs_min(size, capacity - pos);
+    if ((int)iovs[0].iov_len < size) {
+        iovs[1].iov_base = data;
+        iovs[1].iov_len = size - iovs[0].iov_len;
+        nn_iovs = 2;
+    }
+    
+    // Drop the logs when failed, because we can't log in writer thread.
+    int nn = size;
+    if (fd > 0) {
+        ssize_t r0 = 0;
+        while ((r0 = ::writev(fd, iovs, nn_iovs)) < 0 && errno == EINTR) {
+        }
+        // Consume the written bytes for partial write, the left is written in next batch.
+        if (r0 > 0) {
+            nn = (int)r0;
+        }
+    }
+    
+    nn_batches++;
+    nn_bytes += nn;
+    
+    // Release the space after the data is consumed.
+    __sync_synchronize();
+    tail = t + nn;
+    
+    return nn;
+}
+
 SrsFastLog::SrsFastLog()
 {
     level = SrsLogLevelTrace;
@@ -52,12 +274,19 @@ SrsFastLog::SrsFastLog()
     fd = -1;
     log_to_file_tank = false;
     utc = false;
+    writer = NULL;
 }
 
 SrsFastLog::~SrsFastLog()
 {
     srs_freepa(log_data);
     
+    // The fd is owned by writer, which closes it.
+    if (writer) {
+        srs_freep(writer);
+        fd = -1;
+    }
+    
     if (fd > 0) {
         ::close(fd);
         fd = -1;
@@ -83,9 +312,7 @@ srs_error_t SrsFastLog::initialize()
 
 void SrsFastLog::reopen()
 {
-    if (fd > 0) {
-        ::close(fd);
-    }
+    close_log_file();
     
     if (!log_to_file_tank) {
         return;
@@ -200,6 +427,32 @@ void SrsFastLog::error(const char* tag, int context_id, const char* fmt, ...)
     write_log(fd, log_data, size, SrsLogLevelError);
 }
 
+srs_error_t SrsFastLog::start_async()
+{
+    srs_error_t err = srs_success;
+    
+    if (writer || !_srs_config || !_srs_config->get_log_async()) {
+        return err;
+    }
+    
+    int size = _srs_config->get_log_async_size();
+    
+    writer = new SrsAsyncLogWriter();
+    if ((err = writer->start(size * 1024)) != srs_success) {
+        srs_freep(writer);
+        return srs_error_wrap(err, "start writer");
+    }
+    
+    // Hand the opened log file over to writer.
+    if (fd > 0) {
+        writer->set_fd(fd);
+    }
+    
+    srs_trace("log: start async writer, ring=%dKB", size);
+    
+    return err;
+}
+
 srs_error_t SrsFastLog::on_reload_utc_time()
 {
     utc = _srs_config->get_utc_time();
@@ -226,9 +479,7 @@ srs_error_t SrsFastLog::on_reload_log_tank()
         return err;
     }
     
-    if (fd > 0) {
-        ::close(fd);
-    }
+    close_log_file();
     open_log_file();
     
     return err;
@@ -259,9 +510,7 @@ srs_error_t SrsFastLog::on_reload_log_file()
         return err;
     }
     
-    if (fd > 0) {
-        ::close(fd);
-    }
+    close_log_file();
     open_log_file();
     
     return err;
@@ -301,9 +550,13 @@ void SrsFastLog::write_log(int& fd, char *str_log, int size, int level)
         open_log_file();
     }
     
-    // write log to file.
+    // write log to file, by the writer thread if async.
     if (fd > 0) {
-        ::write(fd, str_log, size);
+        if (writer) {
+            writer->write(str_log, size);
+        } else {
+            ::write(fd, str_log, size);
+        }
     }
 }
 
@@ -323,5 +576,18 @@ void SrsFastLog::open_log_file()
         O_RDWR | O_CREAT | O_APPEND,
         S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH
     );
+    
+    if (writer && fd > 0) {
+        writer->set_fd(fd);
+    }
+}
+
+void SrsFastLog::close_log_file()
+{
+    // The fd is owned by writer, which closes it when the new fd is set.
+    if (fd > 0 && !writer) {
+        ::close(fd);
+    }
+    fd = -1;
 }
 
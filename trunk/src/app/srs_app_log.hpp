@@ -29,9 +29,72 @@
 #include <string.h>
 #include <string>
 
+#include <pthread.h>
+
 #include <srs_app_reload.hpp>
 #include <srs_service_log.hpp>
 
+// The interval for the async log thread to poll the ring when it's empty.
+#define SRS_LOG_ASYNC_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+
+// The async log writer, a lock-free ring of single producer, the ST thread, and single consumer,
+// the writer thread, which flushes the logs to file by writev in batch, so the ST thread never
+// blocks at the log disk. The log is dropped when ring is full, and the drops are accounted and
+// written as a notice line before the next log.
+// @remark The writer thread is an OS thread, so it can never use any ST API or write log.
+class SrsAsyncLogWriter
+{
+private:
+    pthread_t tid;
+    bool started;
+    volatile bool quit;
+private:
+    char* data;
+    int capacity;
+    // The total bytes written to ring by producer and read by consumer, the position of ring is
+    // the bytes modulo capacity.
+    volatile uint64_t head;
+    volatile uint64_t tail;
+    // The fd to write, owned by writer thread. A new fd is handed over by the pending fd,
+    // then the writer thread closes the previous fd.
+    int fd;
+    volatile int pending_fd;
+    // Whether write the notice of drops, disable it for binary logs.
+    bool drop_notice;
+private:
+    // The drops since last notice, written by producer when the ring is available.
+    int64_t nn_pending_drops;
+    // The total number of dropped logs and bytes.
+    int64_t nn_drops;
+    int64_t drop_bytes;
+    // The total batches and bytes written by writer thread.
+    int64_t nn_batches;
+    int64_t nn_bytes;
+public:
+    SrsAsyncLogWriter();
+    virtual ~SrsAsyncLogWriter();
+public:
+    // Start the writer thread, with the ring size in bytes.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start(int size);
+    // Stop the writer thread, after all logs in ring are written.
+    virtual void stop();
+    // Hand the fd over to writer thread, which closes the previous fd.
+    virtual void set_fd(int v);
+    virtual void set_drop_notice(bool v);
+    // Copy the log to ring, drop it if ring is full.
+    virtual void write(const char* str_log, int size);
+    // The total number of dropped logs.
+    virtual int64_t drops();
+private:
+    // Copy to ring, return false if no space.
+    virtual bool push(const char* buf, int size);
+    static void* pfn(void* arg);
+    virtual void cycle();
+    // Write the logs in ring once, return the bytes consumed.
+    virtual int flush();
+};
+
 // Use memory/disk cache and donot flush when write log.
 // it's ok to use it without config, which will log to console, and default trace level.
 // when you want to use different level, override this classs, set the protected _level.
@@ -48,6 +111,8 @@ private:
     bool log_to_file_tank;
     // Whether use utc time.
     bool utc;
+    // The async writer, NULL to write log in ST thread.
+    SrsAsyncLogWriter* writer;
 public:
     SrsFastLog();
     virtual ~SrsFastLog();
@@ -60,6 +125,10 @@ public:
     virtual void trace(const char* tag, int context_id, const char* fmt, ...);
     virtual void warn(const char* tag, int context_id, const char* fmt, ...);
     virtual void error(const char* tag, int context_id, const char* fmt, ...);
+public:
+    // Start the async writer thread if srs_log_async is on.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start_async();
 // Interface ISrsReloadHandler.
 public:
     virtual srs_error_t on_reload_utc_time();
@@ -69,6 +138,7 @@ public:
 private:
     virtual void write_log(int& fd, char* str_log, int size, int level);
     virtual void open_log_file();
+    virtual void close_log_file();
 };
 
 #endif
@@ -28,6 +28,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_app_config.hpp>
@@ -49,109 +50,119 @@ using namespace std;
 #include <srs_raw_avc.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_rtmp_conn.hpp>
-#include <srs_protocol_utility.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_ingest_native.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_app_capture.hpp>
+
+// The hold window in ms, to sort the audio and video messages of program.
+#define SRS_MPEGTS_UDP_HOLD 300
+// The interval to check the idle programs.
+#define SRS_MPEGTS_UDP_CIMS (1 * SRS_UTIME_SECONDS)
 
-SrsMpegtsQueue::SrsMpegtsQueue()
+SrsMpegtsProgram::SrsMpegtsProgram(int n, ISrsSourceHandler* h)
 {
-    nb_audios = nb_videos = 0;
+    number = n;
+    publisher = new SrsLocalPublisher(h);
+    bridge = NULL;
+    last_message = srs_get_system_time();
 }
 
-SrsMpegtsQueue::~SrsMpegtsQueue()
+SrsMpegtsProgram::~SrsMpegtsProgram()
 {
-    std::map<int64_t, SrsSharedPtrMessage*>::iterator it;
-    for (it = msgs.begin(); it != msgs.end(); ++it) {
-        SrsSharedPtrMessage* msg = it->second;
-        srs_freep(msg);
-    }
-    msgs.clear();
+    unpublish();
+    srs_freep(publisher);
 }
 
-srs_error_t SrsMpegtsQueue::push(SrsSharedPtrMessage* msg)
+srs_error_t SrsMpegtsProgram::initialize(string output)
 {
     srs_error_t err = srs_success;
     
-    // TODO: FIXME: use right way.
-    for (int i = 0; i < 10; i++) {
-        if (msgs.find(msg->timestamp) == msgs.end()) {
-            break;
-        }
-        
-        // adjust the ts, add 1ms.
-        msg->timestamp += 1;
-        
-        if (i >= 5) {
-            srs_warn("mpegts: free the msg for dts exists, dts=%" PRId64, msg->timestamp);
-            srs_freep(msg);
-            return err;
-        }
-    }
+    output = srs_string_replace(output, "[program]", srs_int2str(number));
     
-    if (msg->is_audio()) {
-        nb_audios++;
+    if ((err = publisher->initialize(output, "")) != srs_success) {
+        return srs_error_wrap(err, "program=%d", number);
     }
     
-    if (msg->is_video()) {
-        nb_videos++;
+    // Each program is a client of statistic, identified by a new id.
+    int cid = _srs_context->get_id();
+    publisher->set_client(_srs_context->generate_id(), NULL);
+    _srs_context->set_id(cid);
+    
+    return err;
+}
+
+SrsRequest* SrsMpegtsProgram::request()
+{
+    return publisher->request();
+}
+
+bool SrsMpegtsProgram::published()
+{
+    return publisher->published();
+}
+
+srs_error_t SrsMpegtsProgram::publish()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish");
     }
     
-    msgs[msg->timestamp] = msg;
+    last_message = srs_get_system_time();
+    
+    // Renew the bridge for each publish, to reset the codec.
+    srs_freep(bridge);
+    bridge = new SrsTsSourceBridge();
+    bridge->set_publisher(publisher);
     
     return err;
 }
 
-SrsSharedPtrMessage* SrsMpegtsQueue::dequeue()
+void SrsMpegtsProgram::unpublish()
 {
-    // got 2+ videos and audios, ok to dequeue.
-    bool av_ok = nb_videos >= 2 && nb_audios >= 2;
-    // 100 videos about 30s, while 300 audios about 30s
-    bool av_overflow = nb_videos > 100 || nb_audios > 300;
+    if (!publisher->published()) {
+        return;
+    }
     
-    if (av_ok || av_overflow) {
-        std::map<int64_t, SrsSharedPtrMessage*>::iterator it = msgs.begin();
-        SrsSharedPtrMessage* msg = it->second;
-        msgs.erase(it);
-        
-        if (msg->is_audio()) {
-            nb_audios--;
-        }
-        
-        if (msg->is_video()) {
-            nb_videos--;
-        }
-        
-        return msg;
+    // Publish the queued messages before unpublish.
+    srs_error_t err = bridge->flush(0);
+    if (err != srs_success) {
+        srs_warn("mpegts: ignore flush err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
     }
     
-    return NULL;
+    publisher->unpublish();
+    srs_freep(bridge);
 }
 
-SrsMpegtsOverUdp::SrsMpegtsOverUdp(SrsConfDirective* c)
+SrsMpegtsOverUdp::SrsMpegtsOverUdp(ISrsSourceHandler* h, SrsConfDirective* c)
 {
+    handler = h;
     context = new SrsTsContext();
     buffer = new SrsSimpleStream();
     output = _srs_config->get_stream_caster_output(c);
+    multiple_programs = srs_string_contains(output, "[program]");
+    capture_path = _srs_config->get_stream_caster_capture(c);
+    capture = NULL;
     
-    sdk = NULL;
-    
-    avc = new SrsRawH264Stream();
-    aac = new SrsRawAacStream();
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = false;
-    queue = new SrsMpegtsQueue();
+    trd = NULL;
     pprint = SrsPithyPrint::create_caster();
 }
 
 SrsMpegtsOverUdp::~SrsMpegtsOverUdp()
 {
-    close();
+    srs_freep(trd);
+    unpublish_idle(true);
     
     srs_freep(buffer);
     srs_freep(context);
-    srs_freep(avc);
-    srs_freep(aac);
-    srs_freep(queue);
     srs_freep(pprint);
+    srs_freep(capture);
 }
 
 srs_error_t SrsMpegtsOverUdp::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
@@ -167,6 +178,8 @@ srs_error_t SrsMpegtsOverUdp::on_udp_packet(const sockaddr* from, const int from
     std::string peer_ip = std::string(address_string);
     int peer_port = atoi(port_string);
     
+    on_capture(buf, nb_buf);
+    
     // append to buffer.
     buffer->append(buf, nb_buf);
     
@@ -177,6 +190,48 @@ srs_error_t SrsMpegtsOverUdp::on_udp_packet(const sockaddr* from, const int from
     return err;
 }
 
+srs_error_t SrsMpegtsOverUdp::on_udp_packets(SrsUdpPacket** pkts, int nn_pkts)
+{
+    if (nn_pkts <= 0) {
+        return srs_success;
+    }
+    
+    // Append all packets except the last one, which is handled as a normal packet,
+    // so the ts packets of the whole batch are parsed in a time.
+    for (int i = 0; i < nn_pkts - 1; i++) {
+        on_capture(pkts[i]->buf, pkts[i]->nb_buf);
+        buffer->append(pkts[i]->buf, pkts[i]->nb_buf);
+    }
+    
+    SrsUdpPacket* pkt = pkts[nn_pkts - 1];
+    return on_udp_packet((const sockaddr*)&pkt->from, pkt->fromlen, pkt->buf, pkt->nb_buf);
+}
+
+void SrsMpegtsOverUdp::on_capture(char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    if (capture_path.empty()) {
+        return;
+    }
+    
+    if (!capture) {
+        capture = new SrsCaptureWriter(SrsCaptureTypeMpegts);
+        err = capture->open(srs_path_build_timestamp(capture_path));
+    }
+    
+    if (err == srs_success) {
+        err = capture->write(srs_update_system_time(), buf, nb_buf);
+    }
+    
+    if (err != srs_success) {
+        srs_warn("udp: stop capture for err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(capture);
+        capture_path = "";
+    }
+}
+
 srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int nb_buf)
 {
     srs_error_t err = srs_success;
@@ -251,6 +306,28 @@ srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int
         buffer->erase(nb_packet * SRS_TS_PACKET_SIZE);
     }
     
+    // Publish the sorted messages of each program.
+    std::map<int, SrsMpegtsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end(); ++it) {
+        SrsMpegtsProgram* program = it->second;
+        if ((err = program->bridge->flush(SRS_MPEGTS_UDP_HOLD)) != srs_success) {
+            srs_warn("mpegts: unpublish %s for err %s", program->request()->get_stream_url().c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            program->unpublish();
+        }
+    }
+    
+    // Erase the programs failed to publish.
+    for (it = programs.begin(); it != programs.end();) {
+        SrsMpegtsProgram* program = it->second;
+        if (program->published()) {
+            ++it;
+            continue;
+        }
+        srs_freep(program);
+        programs.erase(it++);
+    }
+    
     return err;
 }
 
@@ -304,336 +381,553 @@ srs_error_t SrsMpegtsOverUdp::on_ts_message(SrsTsMessage* msg)
                   msg->is_audio()? "A":msg->is_video()? "V":"N", msg->stream_number());
     }
     
-    // When the audio SID is private stream 1, we use common audio.
-    // @see https://github.com/ossrs/srs/issues/740
-    if (msg->channel->apply == SrsTsPidApplyAudio && msg->sid == SrsTsPESStreamIdPrivateStream1) {
-        msg->sid = SrsTsPESStreamIdAudioCommon;
+    // The program of PID, which is parsed from PMT.
+    int number = msg->channel->program;
+    
+    SrsMpegtsProgram* program = NULL;
+    if ((err = fetch_or_publish(number, &program)) != srs_success) {
+        return srs_error_wrap(err, "ts: publish program %d", number);
     }
     
-    // when not audio/video, or not adts/annexb format, donot support.
-    if (msg->stream_number() != 0) {
-        return srs_error_new(ERROR_STREAM_CASTER_TS_ES, "ts: unsupported stream format, sid=%#x(%s-%d)",
-            msg->sid, msg->is_audio()? "A":msg->is_video()? "V":"N", msg->stream_number());
+    // Drop the message of program, which is not published.
+    if (!program) {
+        return err;
     }
+    program->last_message = srs_get_system_time();
     
-    // check supported codec
-    if (msg->channel->stream != SrsTsStreamVideoH264 && msg->channel->stream != SrsTsStreamAudioAAC) {
-        return srs_error_new(ERROR_STREAM_CASTER_TS_CODEC, "ts: unsupported stream codec=%d", msg->channel->stream);
+    if ((err = program->bridge->on_ts_message(msg)) != srs_success) {
+        return srs_error_wrap(err, "ts: consume program %d", number);
     }
     
-    // parse the stream.
-    SrsBuffer avs(msg->payload->bytes(), msg->payload->length());
+    return err;
+}
+
+srs_error_t SrsMpegtsOverUdp::cycle()
+{
+    srs_error_t err = srs_success;
     
-    // publish audio or video.
-    if (msg->channel->stream == SrsTsStreamVideoH264) {
-        if ((err = on_ts_video(msg, &avs)) != srs_success) {
-            return srs_error_wrap(err, "ts: consume video");
-        }
-    }
-    if (msg->channel->stream == SrsTsStreamAudioAAC) {
-        if ((err = on_ts_audio(msg, &avs)) != srs_success) {
-            return srs_error_wrap(err, "ts: consume audio");
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "mpegts");
         }
+        
+        srs_usleep(SRS_MPEGTS_UDP_CIMS);
+        
+        unpublish_idle(false);
     }
     
-    // TODO: FIXME: implements it.
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::on_ts_video(SrsTsMessage* msg, SrsBuffer* avs)
+srs_error_t SrsMpegtsOverUdp::fetch_or_publish(int number, SrsMpegtsProgram** pprogram)
 {
     srs_error_t err = srs_success;
     
-    // ensure rtmp connected.
-    if ((err = connect()) != srs_success) {
-        return srs_error_wrap(err, "connect");
+    std::map<int, SrsMpegtsProgram*>::iterator it = programs.find(number);
+    if (it != programs.end()) {
+        *pprogram = it->second;
+        return err;
     }
     
-    // ts tbn to flv tbn.
-    uint32_t dts = (uint32_t)(msg->dts / 90);
-    uint32_t pts = (uint32_t)(msg->dts / 90);
+    // Only publish the first program, when all programs are published to the same stream.
+    if (!multiple_programs && !programs.empty()) {
+        if ((ignored[number]++ % 1000) == 0) {
+            srs_warn("mpegts: ignore program=%d, dropped=%" PRId64 ", please use [program] in output %s", number, ignored[number], output.c_str());
+        }
+        return err;
+    }
     
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        if ((err = avc->annexb_demux(avs, &frame, &frame_size)) != srs_success) {
-            return srs_error_wrap(err, "demux annexb");
+    // The coroutine to unpublish the idle programs, start when first program published.
+    if (!trd) {
+        SrsSTCoroutine* st = new SrsSTCoroutine("mpegts", this, _srs_context->get_id());
+        st->set_priority(SrsCoroutinePriorityHigh);
+        trd = st;
+        if ((err = trd->start()) != srs_success) {
+            srs_freep(trd);
+            return srs_error_wrap(err, "start coroutine");
         }
+    }
+    
+    SrsMpegtsProgram* program = new SrsMpegtsProgram(number, handler);
+    if ((err = program->initialize(output)) != srs_success) {
+        srs_freep(program);
+        return srs_error_wrap(err, "init program");
+    }
+    
+    if ((err = program->publish()) != srs_success) {
+        srs_freep(program);
+        return srs_error_wrap(err, "publish");
+    }
+    
+    programs[number] = program;
+    *pprogram = program;
+    srs_trace("mpegts: publish program=%d to %s, programs=%d", number, program->request()->get_stream_url().c_str(), (int)programs.size());
+    
+    return err;
+}
+
+void SrsMpegtsOverUdp::unpublish_idle(bool force)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    std::map<int, SrsMpegtsProgram*>::iterator it;
+    for (it = programs.begin(); it != programs.end();) {
+        SrsMpegtsProgram* program = it->second;
         
-        // 5bits, 7.3.1 NAL unit syntax,
-        // ISO_IEC_14496-10-AVC-2003.pdf, page 44.
-        //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
-        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
-        
-        // ignore the nalu type sps(7), pps(8), aud(9)
-        if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+        // Like the RTMP publisher, timeout when no message for publish_normal_timeout.
+        srs_utime_t timeout = _srs_config->get_publish_normal_timeout(program->request()->vhost);
+        if (!force && now - program->last_message < timeout) {
+            ++it;
             continue;
         }
         
-        // for sps
-        if (avc->is_sps(frame, frame_size)) {
-            std::string sps;
-            if ((err = avc->sps_demux(frame, frame_size, sps)) != srs_success) {
-                return srs_error_wrap(err, "demux sps");
-            }
-            
-            if (h264_sps == sps) {
-                continue;
-            }
-            h264_sps_changed = true;
-            h264_sps = sps;
-            
-            if ((err = write_h264_sps_pps(dts, pts)) != srs_success) {
-                return srs_error_wrap(err, "write sps/pps");
-            }
-            continue;
-        }
+        srs_trace("mpegts: unpublish program=%d, %s, idle=%dms", program->number, program->request()->get_stream_url().c_str(),
+            srsu2msi(now - program->last_message));
+        srs_freep(program);
+        programs.erase(it++);
+    }
+}
+
+
+// The max gap of PCR to restart the schedule.
+#define SRS_MULTICAST_PCR_MAX_GAP (1 * SRS_UTIME_SECONDS)
+// The tolerance to send the datagram ahead of schedule, for the precision of timer.
+#define SRS_MULTICAST_PACE_TOLERANCE (2 * SRS_UTIME_MILLISECONDS)
+// The interval to fetch the chunks when no chunk.
+#define SRS_MULTICAST_FETCH_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+
+SrsTsPcrPacer::SrsTsPcrPacer(srs_utime_t d)
+{
+    delay = d;
+    base_pcr = -1;
+    base_time = 0;
+    last_pcr = -1;
+    last_due = 0;
+    bytes = 0;
+    rate = 0;
+}
+
+SrsTsPcrPacer::~SrsTsPcrPacer()
+{
+}
+
+srs_utime_t SrsTsPcrPacer::schedule(int64_t pcr, int size, srs_utime_t now)
+{
+    // Send the datagrams before the first PCR immediately, such as the PAT and PMT.
+    if (pcr < 0 && base_pcr < 0) {
+        return now;
+    }
+    
+    if (pcr >= 0) {
+        // Convert the 90kHz PCR to us.
+        int64_t v = pcr * 100 / 9;
+        srs_utime_t due = base_time + (v - base_pcr);
         
-        // for pps
-        if (avc->is_pps(frame, frame_size)) {
-            std::string pps;
-            if ((err = avc->pps_demux(frame, frame_size, pps)) != srs_success) {
-                return srs_error_wrap(err, "demux pps");
-            }
-            
-            if (h264_pps == pps) {
-                continue;
-            }
-            h264_pps_changed = true;
-            h264_pps = pps;
-            
-            if ((err = write_h264_sps_pps(dts, pts)) != srs_success) {
-                return srs_error_wrap(err, "write sps/pps");
-            }
-            continue;
+        // Restart when PCR jumps, for example, republish.
+        if (base_pcr < 0 || v < last_pcr || v - last_pcr > SRS_MULTICAST_PCR_MAX_GAP) {
+            base_pcr = v;
+            base_time = now + delay;
+            rate = 0;
+            due = base_time;
+        } else if (v > last_pcr) {
+            rate = (double)bytes / (v - last_pcr);
         }
         
-        // ibp frame.
-        // TODO: FIXME: we should group all frames to a rtmp/flv message from one ts message.
-        srs_info("mpegts: demux avc ibp frame size=%d, dts=%d", frame_size, dts);
-        if ((err = write_h264_ipb_frame(frame, frame_size, dts, pts)) != srs_success) {
-            return srs_error_wrap(err, "write frame");
+        // When the stream arrives later than delay, postpone the schedule, so the delay grows
+        // to the jitter of stream, and the datagrams are still paced.
+        if (due < now) {
+            base_time += now - due;
+            due = now;
         }
+        
+        last_pcr = v;
+        last_due = due;
+        bytes = size;
+        return due;
     }
     
-    return err;
+    srs_utime_t due = last_due;
+    if (rate > 0) {
+        due += (srs_utime_t)(bytes / rate);
+    }
+    bytes += size;
+    
+    return due;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_h264_sps_pps(uint32_t dts, uint32_t pts)
+SrsMpegtsMulticast::SrsMpegtsMulticast(SrsSource* s, SrsRequest* r, string o)
 {
-    srs_error_t err = srs_success;
+    source = s;
+    req = r->copy();
+    output = o;
+    trd = new SrsSTCoroutine("multicast", this);
+    stfd = NULL;
+    pacer = new SrsTsPcrPacer(_srs_config->get_vhost_multicast_delay(req->vhost));
+    pcr_pid = -1;
+    
+    rtp = srs_string_starts_with(output, "rtp://");
+    sequence = 0;
+    ssrc = (uint32_t)rand();
+    
+    nn_batch = 0;
+    iovs = new iovec[SRS_PERF_UDP_BATCH * 2];
+    headers = new char[SRS_PERF_UDP_BATCH * SRS_MULTICAST_RTP_HEADER];
+#ifdef SRS_PERF_UDP_SENDMMSG
+    hdrs = new mmsghdr[SRS_PERF_UDP_BATCH];
+    memset(hdrs, 0, sizeof(mmsghdr) * SRS_PERF_UDP_BATCH);
+#else
+    hdrs = NULL;
+#endif
     
-    // TODO: FIMXE: there exists bug, see following comments.
-    // when sps or pps changed, update the sequence header,
-    // for the pps maybe not changed while sps changed.
-    // so, we must check when each video ts message frame parsed.
-    if (!h264_sps_changed || !h264_pps_changed) {
-        return err;
-    }
+    nn_datagrams = 0;
+    nn_bytes = 0;
+}
+
+SrsMpegtsMulticast::~SrsMpegtsMulticast()
+{
+    srs_freep(trd);
+    srs_close_stfd(stfd);
+    srs_freep(pacer);
+    
+    srs_freepa(iovs);
+    srs_freepa(headers);
+#ifdef SRS_PERF_UDP_SENDMMSG
+    srs_freepa(hdrs);
+#endif
     
-    // h264 raw to h264 packet.
-    std::string sh;
-    if ((err = avc->mux_sequence_header(h264_sps, h264_pps, dts, pts, sh)) != srs_success) {
-        return srs_error_wrap(err, "mux sequence header");
-    }
+    srs_freep(req);
+}
+
+srs_error_t SrsMpegtsMulticast::start()
+{
+    srs_error_t err = srs_success;
     
-    // h264 packet to flv packet.
-    int8_t frame_type = SrsVideoAvcFrameTypeKeyFrame;
-    int8_t avc_packet_type = SrsVideoAvcFrameTraitSequenceHeader;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((err = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != srs_success) {
-        return srs_error_wrap(err, "avc to flv");
+    if ((err = open_socket()) != srs_success) {
+        return srs_error_wrap(err, "open %s", output.c_str());
     }
     
-    // the timestamp in rtmp message header is dts.
-    uint32_t timestamp = dts;
-    if ((err = rtmp_write_packet(SrsFrameTypeVideo, timestamp, flv, nb_flv)) != srs_success) {
-        return srs_error_wrap(err, "write packet");
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
     }
     
-    // reset sps and pps.
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = true;
-    
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_h264_ipb_frame(char* frame, int frame_size, uint32_t dts, uint32_t pts)
+srs_error_t SrsMpegtsMulticast::open_socket()
 {
     srs_error_t err = srs_success;
     
-    // when sps or pps not sent, ignore the packet.
-    // @see https://github.com/ossrs/srs/issues/203
-    if (!h264_sps_pps_sent) {
-        return srs_error_new(ERROR_H264_DROP_BEFORE_SPS_PPS, "drop sps/pps");
+    // The output is udp://group:port or rtp://group:port.
+    size_t pos = output.find("://");
+    if (pos == string::npos || (!rtp && !srs_string_starts_with(output, "udp://"))) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid output %s", output.c_str());
     }
     
-    // 5bits, 7.3.1 NAL unit syntax,
-    // ISO_IEC_14496-10-AVC-2003.pdf, page 44.
-    //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
-    SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(frame[0] & 0x1f);
+    string group;
+    int port = 0;
+    srs_parse_hostport(output.substr(pos + 3), group, port);
+    
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (port <= 0 || inet_pton(AF_INET, group.c_str(), &addr.sin_addr) <= 0) {
+        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "invalid group %s, port=%d", group.c_str(), port);
+    }
     
-    // for IDR frame, the frame is keyframe.
-    SrsVideoAvcFrameType frame_type = SrsVideoAvcFrameTypeInterFrame;
-    if (nal_unit_type == SrsAvcNaluTypeIDR) {
-        frame_type = SrsVideoAvcFrameTypeKeyFrame;
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        return srs_error_new(ERROR_SOCKET_CREATE, "create socket");
     }
     
-    std::string ibp;
-    if ((err = avc->mux_ipb_frame(frame, frame_size, ibp)) != srs_success) {
-        return srs_error_wrap(err, "mux frame");
+    int ttl = _srs_config->get_vhost_multicast_ttl(req->vhost);
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == -1) {
+        ::close(fd);
+        return srs_error_new(ERROR_SOCKET_MULTICAST, "set ttl=%d", ttl);
     }
     
-    int8_t avc_packet_type = SrsVideoAvcFrameTraitNALU;
-    char* flv = NULL;
-    int nb_flv = 0;
-    if ((err = avc->mux_avc2flv(ibp, frame_type, avc_packet_type, dts, pts, &flv, &nb_flv)) != srs_success) {
-        return srs_error_wrap(err, "mux avc to flv");
+    string ip = _srs_config->get_vhost_multicast_interface(req->vhost);
+    if (!ip.empty() && ip != "0.0.0.0") {
+        in_addr local;
+        if (inet_pton(AF_INET, ip.c_str(), &local) <= 0 || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &local, sizeof(local)) == -1) {
+            ::close(fd);
+            return srs_error_new(ERROR_SOCKET_MULTICAST, "set interface %s", ip.c_str());
+        }
+    }
+    
+    // Connect to group, so the datagrams are sent without address.
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+        ::close(fd);
+        return srs_error_new(ERROR_SOCKET_CONNECT, "connect %s:%d", group.c_str(), port);
+    }
+    
+    if ((stfd = srs_netfd_open_socket(fd)) == NULL) {
+        ::close(fd);
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "open socket");
+    }
+    
+    srs_trace("multicast: %s to %s, rtp=%d, ttl=%d, interface=%s", req->get_stream_url().c_str(), output.c_str(),
+        rtp, ttl, ip.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsMpegtsMulticast::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    srs_trace("multicast: stop %s, datagrams=%" PRId64 ", bytes=%" PRId64, req->get_stream_url().c_str(),
+        nn_datagrams, nn_bytes);
+    
+    // It's normal to be interrupted when unpublish.
+    if (err != srs_success && srs_error_code(err) != ERROR_THREAD_INTERRUPED) {
+        srs_warn("multicast: ignore error, %s", srs_error_desc(err).c_str());
     }
+    srs_freep(err);
     
-    // the timestamp in rtmp message header is dts.
-    uint32_t timestamp = dts;
-    return rtmp_write_packet(SrsFrameTypeVideo, timestamp, flv, nb_flv);
+    return srs_success;
 }
 
-srs_error_t SrsMpegtsOverUdp::on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs)
+srs_error_t SrsMpegtsMulticast::do_cycle()
 {
     srs_error_t err = srs_success;
     
-    // ensure rtmp connected.
-    if ((err = connect()) != srs_success) {
-        return srs_error_wrap(err, "connect");
+    // Like the HTTP-TS and SRT players, write the TS chunks shared by the muxer of source.
+    SrsTsSharedStream* shared = SrsTsSharedStream::fetch_or_create(source, req);
+    SrsLiveSharedPlayer player;
+    if ((err = player.attach(shared)) != srs_success) {
+        return srs_error_wrap(err, "start ts shared");
     }
     
-    // ts tbn to flv tbn.
-    uint32_t dts = (uint32_t)(msg->dts / 90);
+    SrsPithyPrint* pprint = SrsPithyPrint::create_caster();
+    SrsAutoFree(SrsPithyPrint, pprint);
     
-    // send each frame.
-    while (!avs->empty()) {
-        char* frame = NULL;
-        int frame_size = 0;
-        SrsRawAacStreamCodec codec;
-        if ((err = aac->adts_demux(avs, &frame, &frame_size, codec)) != srs_success) {
-            return srs_error_wrap(err, "demux adts");
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    
+    int64_t cursor = -1;
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "multicast");
         }
         
-        // ignore invalid frame,
-        //  * atleast 1bytes for aac to decode the data.
-        if (frame_size <= 0) {
+        int count = 0;
+        shared->fetch(cursor, msgs.msgs, msgs.max, count);
+        if (count <= 0) {
+            srs_usleep(SRS_MULTICAST_FETCH_INTERVAL);
             continue;
         }
-        srs_info("mpegts: demux aac frame size=%d, dts=%d", frame_size, dts);
         
-        // generate sh.
-        if (aac_specific_config.empty()) {
-            std::string sh;
-            if ((err = aac->mux_sequence_header(&codec, sh)) != srs_success) {
-                return srs_error_wrap(err, "mux sequence header");
-            }
-            aac_specific_config = sh;
-            
-            codec.aac_packet_type = 0;
-            
-            if ((err = write_audio_raw_frame((char*)sh.data(), (int)sh.length(), &codec, dts)) != srs_success) {
-                return srs_error_wrap(err, "write raw audio frame");
-            }
+        err = send_chunks(msgs.msgs, count);
+        
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "send");
         }
         
-        // audio raw data.
-        codec.aac_packet_type = 1;
-        if ((err = write_audio_raw_frame(frame, frame_size, &codec, dts)) != srs_success) {
-            return srs_error_wrap(err, "write audio raw frame");
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> multicast %s to %s, datagrams=%" PRId64 ", bytes=%" PRId64, req->get_stream_url().c_str(),
+                output.c_str(), nn_datagrams, nn_bytes);
         }
     }
     
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts)
+srs_error_t SrsMpegtsMulticast::send_chunks(SrsSharedPtrMessage** msgs, int count)
 {
     srs_error_t err = srs_success;
     
-    char* data = NULL;
-    int size = 0;
-    if ((err = aac->mux_aac2flv(frame, frame_size, codec, dts, &data, &size)) != srs_success) {
-        return srs_error_wrap(err, "mux aac to flv");
+    static const int size = SRS_MULTICAST_TS_PACKETS * SRS_TS_PACKET_SIZE;
+    
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        
+        for (int pos = 0; pos < msg->size; pos += size) {
+            char* p = msg->payload + pos;
+            int nn = srs_min(size, msg->size - pos);
+            
+            // Schedule the datagram by the first PCR, or the DTS of PES on the PCR PID, because the
+            // PCR is not in each frame, for example, only in the keyframe of video.
+            int64_t clock = -1;
+            for (int j = 0; clock < 0 && j + SRS_TS_PACKET_SIZE <= nn; j += SRS_TS_PACKET_SIZE) {
+                char* pkt = p + j;
+                int pid = ((pkt[1] & 0x1f) << 8) | (uint8_t)pkt[2];
+                
+                if ((clock = srs_ts_packet_pcr(pkt)) >= 0) {
+                    pcr_pid = pid;
+                } else if (pid == pcr_pid) {
+                    clock = srs_ts_packet_dts(pkt);
+                }
+            }
+            
+            srs_utime_t now = srs_update_system_time();
+            srs_utime_t due = pacer->schedule(clock, nn, now);
+            
+            // Send the batch before waiting, so the datagrams are not delayed.
+            if (due > now + SRS_MULTICAST_PACE_TOLERANCE) {
+                if ((err = flush()) != srs_success) {
+                    return srs_error_wrap(err, "flush");
+                }
+                srs_usleep(due - now);
+            }
+            
+            append(p, nn);
+            
+            if (nn_batch >= SRS_PERF_UDP_BATCH && (err = flush()) != srs_success) {
+                return srs_error_wrap(err, "flush");
+            }
+        }
+    }
+    
+    // The batch refers to the chunks, which are freed after sent.
+    if ((err = flush()) != srs_success) {
+        return srs_error_wrap(err, "flush");
     }
     
-    return rtmp_write_packet(SrsFrameTypeAudio, dts, data, size);
+    return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, char* data, int size)
+void SrsMpegtsMulticast::append(char* data, int size)
 {
-    srs_error_t err = srs_success;
+    iovec* iov = iovs + nn_batch * 2;
     
-    if ((err = connect()) != srs_success) {
-        return srs_error_wrap(err, "connect");
+    iov[0].iov_base = headers + nn_batch * SRS_MULTICAST_RTP_HEADER;
+    iov[0].iov_len = 0;
+    iov[1].iov_base = data;
+    iov[1].iov_len = size;
+    
+    // The RTP header for MP2T, see RFC2250, where the timestamp is in 90kHz.
+    if (rtp) {
+        uint32_t timestamp = (uint32_t)(srs_get_system_time() * 9 / 100);
+        
+        uint8_t* p = (uint8_t*)iov[0].iov_base;
+        *p++ = 0x80;
+        *p++ = 33;
+        *p++ = (uint8_t)(sequence >> 8);
+        *p++ = (uint8_t)sequence;
+        *p++ = (uint8_t)(timestamp >> 24);
+        *p++ = (uint8_t)(timestamp >> 16);
+        *p++ = (uint8_t)(timestamp >> 8);
+        *p++ = (uint8_t)timestamp;
+        *p++ = (uint8_t)(ssrc >> 24);
+        *p++ = (uint8_t)(ssrc >> 16);
+        *p++ = (uint8_t)(ssrc >> 8);
+        *p++ = (uint8_t)ssrc;
+        
+        iov[0].iov_len = SRS_MULTICAST_RTP_HEADER;
+        sequence++;
     }
     
-    SrsSharedPtrMessage* msg = NULL;
+    nn_batch++;
+    nn_bytes += size;
+}
+
+srs_error_t SrsMpegtsMulticast::flush()
+{
+    srs_error_t err = srs_success;
     
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
-        return srs_error_wrap(err, "create message");
+    if (nn_batch <= 0) {
+        return err;
     }
-    srs_assert(msg);
     
-    // push msg to queue.
-    if ((err = queue->push(msg)) != srs_success) {
-        return srs_error_wrap(err, "push to queue");
+#ifdef SRS_PERF_UDP_SENDMMSG
+    for (int i = 0; i < nn_batch; i++) {
+        hdrs[i].msg_hdr.msg_iov = iovs + i * 2;
+        hdrs[i].msg_hdr.msg_iovlen = 2;
     }
     
-    // for all ready msg, dequeue and send out.
-    for (;;) {
-        if ((msg = queue->dequeue()) == NULL) {
-            break;
-        }
-        
-        if (pprint->can_print()) {
-            srs_trace("mpegts: send msg %s age=%d, dts=%" PRId64 ", size=%d",
-                      msg->is_audio()? "A":msg->is_video()? "V":"N", pprint->age(), msg->timestamp, msg->size);
+    for (int pos = 0; pos < nn_batch;) {
+        int r0 = srs_sendmmsg(stfd, hdrs + pos, nn_batch - pos, SRS_UTIME_NO_TIMEOUT);
+        if (r0 <= 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendmmsg %d datagrams", nn_batch - pos);
         }
-        
-        // send out encoded msg.
-        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
-            close();
-            return srs_error_wrap(err, "send messages");
+        pos += r0;
+    }
+#else
+    SrsStSocket skt;
+    if ((err = skt.initialize(stfd)) != srs_success) {
+        return srs_error_wrap(err, "init socket");
+    }
+    
+    for (int i = 0; i < nn_batch; i++) {
+        if ((err = skt.writev(iovs + i * 2, 2, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write datagram");
         }
     }
+#endif
+    
+    nn_datagrams += nn_batch;
+    nn_batch = 0;
     
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::connect()
+SrsMpegtsMulticasts* SrsMpegtsMulticasts::_instance = NULL;
+
+SrsMpegtsMulticasts::SrsMpegtsMulticasts()
+{
+}
+
+SrsMpegtsMulticasts::~SrsMpegtsMulticasts()
+{
+    map<string, SrsMpegtsMulticast*>::iterator it;
+    for (it = multicasts.begin(); it != multicasts.end(); ++it) {
+        SrsMpegtsMulticast* multicast = it->second;
+        srs_freep(multicast);
+    }
+    multicasts.clear();
+}
+
+SrsMpegtsMulticasts* SrsMpegtsMulticasts::instance()
+{
+    if (!_instance) {
+        _instance = new SrsMpegtsMulticasts();
+    }
+    return _instance;
+}
+
+srs_error_t SrsMpegtsMulticasts::on_publish(SrsSource* s, SrsRequest* r)
 {
     srs_error_t err = srs_success;
     
-    // Ignore when connected.
-    if (sdk) {
+    if (!_srs_config->get_vhost_multicast_enabled(r->vhost)) {
         return err;
     }
     
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
-    
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
+    string output = _srs_config->get_vhost_multicast_channel(r->vhost, r->app + "/" + r->stream);
+    if (output.empty()) {
+        return err;
     }
     
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
-        return srs_error_wrap(err, "publish");
+    // Restart the multicast, for the output may be changed by reload.
+    on_unpublish(s, r);
+    
+    // Never reject the publisher, for the multicast is an output like forward.
+    SrsMpegtsMulticast* multicast = new SrsMpegtsMulticast(s, r, output);
+    if ((err = multicast->start()) != srs_success) {
+        srs_warn("multicast: ignore %s, %s", r->get_stream_url().c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(multicast);
+        return err;
     }
+    multicasts[r->get_stream_url()] = multicast;
     
     return err;
 }
 
-void SrsMpegtsOverUdp::close()
+void SrsMpegtsMulticasts::on_unpublish(SrsSource* /*s*/, SrsRequest* r)
 {
-    srs_freep(sdk);
+    map<string, SrsMpegtsMulticast*>::iterator it = multicasts.find(r->get_stream_url());
+    if (it == multicasts.end()) {
+        return;
+    }
+    
+    SrsMpegtsMulticast* multicast = it->second;
+    multicasts.erase(it);
+    srs_freep(multicast);
 }
-
@@ -27,91 +27,192 @@
 #include <srs_core.hpp>
 
 struct sockaddr;
+struct mmsghdr;
 #include <string>
 #include <map>
+#include <vector>
 
 class SrsBuffer;
 class SrsTsContext;
 class SrsConfDirective;
 class SrsSimpleStream;
-class SrsRtmpClient;
-class SrsStSocket;
 class SrsRequest;
-class SrsRawH264Stream;
-class SrsSharedPtrMessage;
-class SrsRawAacStream;
-struct SrsRawAacStreamCodec;
+class SrsLocalPublisher;
+class ISrsSourceHandler;
+class SrsTsSourceBridge;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class SrsSource;
+class SrsSharedPtrMessage;
+class SrsCaptureWriter;
 
 #include <srs_app_st.hpp>
 #include <srs_kernel_ts.hpp>
 #include <srs_app_listener.hpp>
 
-// The queue for mpegts over udp to send packets.
-// For the aac in mpegts contains many flv packets in a pes packet,
-// we must recalc the timestamp.
-class SrsMpegtsQueue
+// The program of mpegts over udp, which is published to its own source.
+class SrsMpegtsProgram
 {
-private:
-    // The key: dts, value: msg.
-    std::map<int64_t, SrsSharedPtrMessage*> msgs;
-    int nb_audios;
-    int nb_videos;
 public:
-    SrsMpegtsQueue();
-    virtual ~SrsMpegtsQueue();
+    // The program_number in PAT.
+    int number;
+    // The publisher of program, to publish to source in process.
+    SrsLocalPublisher* publisher;
+    // The bridge to demux the ES of program, and publish to source.
+    SrsTsSourceBridge* bridge;
+    // The time of last ts message, to unpublish when idle.
+    srs_utime_t last_message;
+public:
+    SrsMpegtsProgram(int n, ISrsSourceHandler* h);
+    virtual ~SrsMpegtsProgram();
 public:
-    virtual srs_error_t push(SrsSharedPtrMessage* msg);
-    virtual SrsSharedPtrMessage* dequeue();
+    // Parse the request from output url, where the [program] is replaced by number.
+    virtual srs_error_t initialize(std::string output);
+    virtual SrsRequest* request();
+    virtual bool published();
+    virtual srs_error_t publish();
+    virtual void unpublish();
 };
 
-// The mpegts over udp stream caster.
-class SrsMpegtsOverUdp : virtual public ISrsTsHandler, virtual public ISrsUdpHandler
+// The mpegts over udp stream caster, which demuxes all programs of MPTS(Multiple Program
+// Transport Stream), and each program is published to its own source without RTMP.
+// @remark When the output without [program], only the first program is published.
+class SrsMpegtsOverUdp : virtual public ISrsTsHandler, virtual public ISrsUdpHandler, virtual public ISrsCoroutineHandler
 {
 private:
+    ISrsSourceHandler* handler;
     SrsTsContext* context;
     SrsSimpleStream* buffer;
     std::string output;
+    // Whether the programs are published to different streams, by [program] of output.
+    bool multiple_programs;
+    // The path to capture the datagrams for replay, empty if disabled.
+    std::string capture_path;
+    // The capture file, opened by the first datagram.
+    SrsCaptureWriter* capture;
 private:
-    SrsSimpleRtmpClient* sdk;
-private:
-    SrsRawH264Stream* avc;
-    std::string h264_sps;
-    bool h264_sps_changed;
-    std::string h264_pps;
-    bool h264_pps_changed;
-    bool h264_sps_pps_sent;
-private:
-    SrsRawAacStream* aac;
-    std::string aac_specific_config;
-private:
-    SrsMpegtsQueue* queue;
+    // The key: program_number, value: the published program.
+    std::map<int, SrsMpegtsProgram*> programs;
+    // The key: program_number, value: the number of dropped messages.
+    std::map<int, int64_t> ignored;
+    // The coroutine to unpublish the idle programs.
+    SrsCoroutine* trd;
     SrsPithyPrint* pprint;
 public:
-    SrsMpegtsOverUdp(SrsConfDirective* c);
+    SrsMpegtsOverUdp(ISrsSourceHandler* h, SrsConfDirective* c);
     virtual ~SrsMpegtsOverUdp();
 // Interface ISrsUdpHandler
 public:
     virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
+    virtual srs_error_t on_udp_packets(SrsUdpPacket** pkts, int nn_pkts);
 private:
     virtual srs_error_t on_udp_bytes(std::string host, int port, char* buf, int nb_buf);
+    // Capture the datagram, stop to capture if error.
+    virtual void on_capture(char* buf, int nb_buf);
 // Interface ISrsTsHandler
 public:
     virtual srs_error_t on_ts_message(SrsTsMessage* msg);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
 private:
-    virtual srs_error_t on_ts_video(SrsTsMessage* msg, SrsBuffer* avs);
-    virtual srs_error_t write_h264_sps_pps(uint32_t dts, uint32_t pts);
-    virtual srs_error_t write_h264_ipb_frame(char* frame, int frame_size, uint32_t dts, uint32_t pts);
-    virtual srs_error_t on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs);
-    virtual srs_error_t write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts);
+    // Fetch the program, or publish a new one, NULL if the program is ignored.
+    virtual srs_error_t fetch_or_publish(int number, SrsMpegtsProgram** pprogram);
+    // Unpublish the programs without messages for timeout, all programs if force.
+    virtual void unpublish_idle(bool force);
+};
+
+// The TS packets in a datagram of multicast, 7*188 is 1316 bytes, fits the MTU of ethernet.
+#define SRS_MULTICAST_TS_PACKETS 7
+// The size of RTP header, without CSRC and extension.
+#define SRS_MULTICAST_RTP_HEADER 12
+
+// The pacer of TS by PCR, which schedules the datagram with PCR at the time of PCR plus delay,
+// and spreads the datagrams between PCRs by the bitrate of the last interval.
+class SrsTsPcrPacer
+{
 private:
-    virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
+    srs_utime_t delay;
+    // The PCR in us and the time it's scheduled to, as base of schedule, -1 if no PCR.
+    int64_t base_pcr;
+    srs_utime_t base_time;
+    // The last PCR in us, and the time it's scheduled to.
+    int64_t last_pcr;
+    srs_utime_t last_due;
+    // The bytes since last PCR.
+    int64_t bytes;
+    // The bytes per us of the last PCR interval, 0 if unknown.
+    double rate;
+public:
+    SrsTsPcrPacer(srs_utime_t d);
+    virtual ~SrsTsPcrPacer();
+public:
+    // Schedule a datagram, return the time to send it.
+    // @param pcr The clock in 90kHz of datagram, the PCR or the DTS on PCR PID, -1 if no clock.
+    // @remark The schedule restarts when PCR is discontinuous, for example, republish, and it's
+    //       postponed when the stream is later than the delay.
+    virtual srs_utime_t schedule(int64_t pcr, int size, srs_utime_t now);
+};
+
+// The multicast of a stream, which sends the TS chunks of the shared TS muxer to the group
+// over UDP or RTP, paced by PCR, and in batch by sendmmsg.
+class SrsMpegtsMulticast : public ISrsCoroutineHandler
+{
+private:
+    SrsSource* source;
+    SrsRequest* req;
+    SrsCoroutine* trd;
+    std::string output;
+    srs_netfd_t stfd;
+    SrsTsPcrPacer* pacer;
+    // The PID which carries the PCR, -1 if no PCR.
+    int pcr_pid;
+private:
+    // The RTP header of datagrams, if output is RTP.
+    bool rtp;
+    uint16_t sequence;
+    uint32_t ssrc;
+    // The datagrams of batch, which refer to the chunks, and the RTP headers.
+    int nn_batch;
+    iovec* iovs;
+    mmsghdr* hdrs;
+    char* headers;
+    int64_t nn_datagrams;
+    int64_t nn_bytes;
+public:
+    SrsMpegtsMulticast(SrsSource* s, SrsRequest* r, std::string o);
+    virtual ~SrsMpegtsMulticast();
+public:
+    // Open the socket to group and start to send.
+    virtual srs_error_t start();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
 private:
-    // Connect to RTMP server.
-    virtual srs_error_t connect();
-    // Close the connection to RTMP server.
-    virtual void close();
+    virtual srs_error_t open_socket();
+    virtual srs_error_t do_cycle();
+    // Send the chunks, the datagram is delayed until the scheduled time by PCR.
+    virtual srs_error_t send_chunks(SrsSharedPtrMessage** msgs, int count);
+    // Append a datagram to batch, which refers to data until flush.
+    virtual void append(char* data, int size);
+    virtual srs_error_t flush();
+};
+
+// The multicasts of streams, which starts the multicast when stream is published.
+class SrsMpegtsMulticasts
+{
+private:
+    static SrsMpegtsMulticasts* _instance;
+private:
+    // The key is the url of stream.
+    std::map<std::string, SrsMpegtsMulticast*> multicasts;
+private:
+    SrsMpegtsMulticasts();
+    virtual ~SrsMpegtsMulticasts();
+public:
+    static SrsMpegtsMulticasts* instance();
+public:
+    virtual srs_error_t on_publish(SrsSource* s, SrsRequest* r);
+    virtual void on_unpublish(SrsSource* s, SrsRequest* r);
 };
 
 #endif
@@ -0,0 +1,190 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_overload.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_protocol_json.hpp>
+
+string srs_overload_level2str(SrsOverloadLevel level)
+{
+    switch (level) {
+        case SrsOverloadLevelNormal: return "normal";
+        case SrsOverloadLevelRejectPlay: return "reject_play";
+        case SrsOverloadLevelPauseLowPriority: return "pause_low_priority";
+        case SrsOverloadLevelDropFrames: return "drop_frames";
+        default: return "unknown";
+    }
+}
+
+SrsOverloadController* _srs_overload = new SrsOverloadController();
+
+SrsOverloadController::SrsOverloadController()
+{
+    enabled = false;
+    max_lag = 0;
+    max_cpu = 0;
+    ratio = 0;
+    
+    level = SrsOverloadLevelNormal;
+    lag = 0;
+    last_probe = 0;
+    nn_probes = 0;
+    cpu = 0;
+    pressure = 0;
+    nn_calms = 0;
+    nn_changes = 0;
+    nn_rejects = 0;
+}
+
+SrsOverloadController::~SrsOverloadController()
+{
+    if (enabled) {
+        _srs_timer->unsubscribe(this);
+    }
+}
+
+srs_error_t SrsOverloadController::initialize()
+{
+    srs_error_t err = srs_success;
+    
+    enabled = _srs_config->get_overload_enabled();
+    max_lag = _srs_config->get_overload_max_lag();
+    max_cpu = _srs_config->get_overload_max_cpu();
+    ratio = _srs_config->get_overload_drop_ratio();
+    
+    if (!enabled) {
+        return err;
+    }
+    
+    if (max_lag <= 0 || max_cpu <= 0) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "overload max_lag=%dms, max_cpu=%d", srsu2msi(max_lag), max_cpu);
+    }
+    
+    _srs_timer->subscribe(SRS_OVERLOAD_PROBE_INTERVAL, this);
+    srs_trace("overload max_lag=%dms, max_cpu=%d%%, drop_ratio=%.2f", srsu2msi(max_lag), max_cpu, ratio);
+    
+    return err;
+}
+
+SrsOverloadLevel SrsOverloadController::current()
+{
+    return level;
+}
+
+bool SrsOverloadController::reject_play()
+{
+    return level >= SrsOverloadLevelRejectPlay;
+}
+
+void SrsOverloadController::on_reject()
+{
+    nn_rejects++;
+}
+
+bool SrsOverloadController::pause_dvr_hls(bool low_priority)
+{
+    return low_priority && level >= SrsOverloadLevelPauseLowPriority;
+}
+
+double SrsOverloadController::drop_ratio(double v)
+{
+    if (level < SrsOverloadLevelDropFrames || ratio <= 0) {
+        return v;
+    }
+    
+    return (v > 0)? srs_min(v, ratio) : ratio;
+}
+
+void SrsOverloadController::dumps(SrsJsonObject* obj)
+{
+    obj->set("enabled", SrsJsonAny::boolean(enabled));
+    obj->set("level", SrsJsonAny::integer(level));
+    obj->set("state", SrsJsonAny::str(srs_overload_level2str(level).c_str()));
+    obj->set("lag_ms", SrsJsonAny::integer(srsu2ms(lag)));
+    obj->set("cpu_percent", SrsJsonAny::integer(cpu));
+    obj->set("pressure", SrsJsonAny::number(pressure));
+    obj->set("changes", SrsJsonAny::integer(nn_changes));
+    obj->set("rejects", SrsJsonAny::integer(nn_rejects));
+}
+
+void SrsOverloadController::evaluate(srs_utime_t v, int c)
+{
+    lag = v;
+    cpu = c;
+    pressure = srs_max((double)lag / max_lag, (double)cpu / max_cpu);
+    
+    SrsOverloadLevel previous = level;
+    
+    // Raise the tier for each evaluation under pressure, and lower it when calm for a while,
+    // to avoid the tier flapping around the threshold.
+    if (pressure >= 1.0) {
+        nn_calms = 0;
+        if (level < SrsOverloadLevelDropFrames) {
+            level = (SrsOverloadLevel)(level + 1);
+        }
+    } else if (pressure < 0.8 && level > SrsOverloadLevelNormal) {
+        if (++nn_calms >= SRS_OVERLOAD_COOLDOWN) {
+            nn_calms = 0;
+            level = (SrsOverloadLevel)(level - 1);
+        }
+    } else {
+        nn_calms = 0;
+    }
+    
+    if (level != previous) {
+        nn_changes++;
+        srs_trace("overload %s=>%s, lag=%dms, cpu=%d%%, pressure=%.2f, rejects=%" PRId64, srs_overload_level2str(previous).c_str(),
+            srs_overload_level2str(level).c_str(), srsu2msi(lag), cpu, pressure, nn_rejects);
+    }
+}
+
+srs_error_t SrsOverloadController::on_timer(srs_utime_t interval)
+{
+    srs_utime_t now = srs_update_monotonic_time();
+    
+    // The timer is fired later than interval, when the scheduler lags.
+    if (last_probe > 0) {
+        srs_utime_t delay = srs_max(0, now - last_probe - interval);
+        lag = (lag * 3 + delay) / 4;
+    }
+    last_probe = now;
+    
+    if (++nn_probes < SRS_OVERLOAD_EVALUATE_PROBES) {
+        return srs_success;
+    }
+    nn_probes = 0;
+    
+    // The CPU is sampled by server every 3s.
+    SrsProcSelfStat* u = srs_get_self_proc_stat();
+    evaluate(lag, u->ok? (int)(u->percent * 100) : 0);
+    
+    return srs_success;
+}
+
@@ -0,0 +1,107 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_OVERLOAD_HPP
+#define SRS_APP_OVERLOAD_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+#include <srs_app_hourglass.hpp>
+
+class SrsJsonObject;
+
+// The interval to probe the lag of scheduler, by the timer.
+#define SRS_OVERLOAD_PROBE_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+// The number of probes to evaluate the pressure, that is, about 1s.
+#define SRS_OVERLOAD_EVALUATE_PROBES 10
+// The number of calm evaluations to lower the tier, that is, about 5s.
+#define SRS_OVERLOAD_COOLDOWN 5
+
+// The tiers of overload, and each tier also applies the actions of lower tiers.
+enum SrsOverloadLevel
+{
+    SrsOverloadLevelNormal = 0,
+    // Reject the new players.
+    SrsOverloadLevelRejectPlay = 1,
+    // Pause the HLS and DVR of low priority vhosts.
+    SrsOverloadLevelPauseLowPriority = 2,
+    // Drop the video frames of slow consumers.
+    SrsOverloadLevelDropFrames = 3,
+};
+extern std::string srs_overload_level2str(SrsOverloadLevel level);
+
+// The overload controller, which watches the lag of ST scheduler and the CPU of process,
+// and sheds the load in tiers, so the streams degrade by priority rather than together.
+// The lag is the delay of timer to fire, because all coroutines share one thread, lots of
+// ready coroutines or a hogging one delay the timer.
+class SrsOverloadController : public ISrsTimerHandler
+{
+private:
+    bool enabled;
+    srs_utime_t max_lag;
+    int max_cpu;
+    double ratio;
+private:
+    SrsOverloadLevel level;
+    // The smoothed lag of scheduler, and the time of last probe.
+    srs_utime_t lag;
+    srs_utime_t last_probe;
+    int nn_probes;
+    // The CPU percent of process, and the pressure of last evaluation.
+    int cpu;
+    double pressure;
+    // The number of calm evaluations, to lower the tier.
+    int nn_calms;
+    int64_t nn_changes;
+    int64_t nn_rejects;
+public:
+    SrsOverloadController();
+    virtual ~SrsOverloadController();
+public:
+    // Initialize by config, and start to probe by timer if enabled.
+    virtual srs_error_t initialize();
+    virtual SrsOverloadLevel current();
+    // Whether reject the new players, then user should call on_reject.
+    virtual bool reject_play();
+    virtual void on_reject();
+    // Whether pause the HLS and DVR, for the vhost of priority.
+    virtual bool pause_dvr_hls(bool low_priority);
+    // Get the drop ratio of slow consumers, by the drop ratio of vhost v.
+    virtual double drop_ratio(double v);
+    // Dumps the state to json.
+    virtual void dumps(SrsJsonObject* obj);
+public:
+    // Evaluate the pressure by the lag of scheduler and the CPU percent, then change the tier.
+    virtual void evaluate(srs_utime_t lag, int cpu);
+// Interface ISrsTimerHandler
+public:
+    virtual srs_error_t on_timer(srs_utime_t interval);
+};
+
+// The global overload controller.
+extern SrsOverloadController* _srs_overload;
+
+#endif
+
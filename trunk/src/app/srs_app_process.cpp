@@ -29,6 +29,11 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sched.h>
+#include <pthread.h>
+#include <string.h>
+#include <errno.h>
 
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
@@ -141,31 +146,177 @@ srs_error_t SrsProcess::initialize(string binary, vector<string> argv)
     return err;
 }
 
-srs_error_t srs_redirect_output(string from_file, int to_fd)
+// The context to spawn the child process, all fields are prepared by parent, because the child
+// shares the memory of parent when spawn by vfork-like clone, so it must never allocate memory or
+// use stdio, only the async-signal-safe syscalls are allowed.
+struct SrsProcessSpawn
+{
+    const char* bin;
+    char** argv;
+    const char* stdout_file;
+    const char* stderr_file;
+    // The header to log to stdout, the pid of child is written between prefix and suffix.
+    const char* prefix;
+    const char* suffix;
+    // The signal mask of parent, restored in child before exec.
+    sigset_t mask;
+    // Set by child when spawn failed, only visible to parent for the clone launcher.
+    int error;
+    int sys_errno;
+};
+
+// Write the string to fd, in child process.
+static void srs_process_write(int fd, const char* str)
+{
+    size_t size = strlen(str);
+    while (size > 0) {
+        ssize_t nn = ::write(fd, str, size);
+        if (nn <= 0) {
+            return;
+        }
+        str += nn;
+        size -= nn;
+    }
+}
+
+// Redirect the fd to file, in child process.
+static int srs_process_redirect(const char* from_file, int to_fd)
 {
-    srs_error_t err = srs_success;
-    
     // use default output.
-    if (from_file.empty()) {
-        return err;
+    if (!from_file || !from_file[0]) {
+        return ERROR_SUCCESS;
     }
     
-    // redirect the fd to file.
-    int fd = -1;
     int flags = O_CREAT|O_RDWR|O_APPEND;
     mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
     
-    if ((fd = ::open(from_file.c_str(), flags, mode)) < 0) {
-        return srs_error_new(ERROR_FORK_OPEN_LOG, "open process %d %s failed", to_fd, from_file.c_str());
+    int fd = ::open(from_file, flags, mode);
+    if (fd < 0) {
+        return ERROR_FORK_OPEN_LOG;
     }
     
-    if (dup2(fd, to_fd) < 0) {
-        return srs_error_new(ERROR_FORK_DUP2_LOG, "dup2 process %d failed", to_fd);
+    if (fd != to_fd) {
+        if (dup2(fd, to_fd) < 0) {
+            ::close(fd);
+            return ERROR_FORK_DUP2_LOG;
+        }
+        ::close(fd);
     }
     
-    ::close(fd);
+    return ERROR_SUCCESS;
+}
+
+// The entry of child process, never return when success.
+static int srs_process_child(void* arg)
+{
+    SrsProcessSpawn* ctx = (SrsProcessSpawn*)arg;
     
-    return err;
+    // Reset the handlers of parent, which are not safe to run in child, for example, the signal
+    // would be written to the shared pipe of parent.
+    struct sigaction sa;
+    for (int i = 1; i < _NSIG; i++) {
+        if (sigaction(i, NULL, &sa) < 0 || sa.sa_handler == SIG_IGN || sa.sa_handler == SIG_DFL) {
+            continue;
+        }
+        sa.sa_handler = SIG_DFL;
+        sa.sa_flags = 0;
+        sigaction(i, &sa, NULL);
+    }
+    
+    // ignore the SIGINT and SIGTERM
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+    
+    // The parent blocks all signals when spawn, restore it.
+    sigprocmask(SIG_SETMASK, &ctx->mask, NULL);
+    
+    // for the stdout, ignore when not specified.
+    // redirect stdout to file if possible.
+    if ((ctx->error = srs_process_redirect(ctx->stdout_file, STDOUT_FILENO)) != ERROR_SUCCESS) {
+        ctx->sys_errno = errno;
+        _exit(-1);
+    }
+    
+    // for the stderr, ignore when not specified.
+    // redirect stderr to file if possible.
+    if ((ctx->error = srs_process_redirect(ctx->stderr_file, STDERR_FILENO)) != ERROR_SUCCESS) {
+        ctx->sys_errno = errno;
+        _exit(-1);
+    }
+    
+    // No stdin for process, @bug https://github.com/ossrs/srs/issues/1592
+    if ((ctx->error = srs_process_redirect("/dev/null", STDIN_FILENO)) != ERROR_SUCCESS) {
+        ctx->sys_errno = errno;
+        _exit(-1);
+    }
+    
+    // should never close the fd 3+, for it myabe used.
+    // for fd should close at exec, use fnctl to set it.
+    
+    // log basic info to stdout.
+    if (true) {
+        char pid[16];
+        char* p = pid + sizeof(pid) - 1;
+        *p = 0;
+        int v = getpid();
+        do {
+            *--p = '0' + (v % 10);
+            v /= 10;
+        } while (v > 0);
+        
+        srs_process_write(STDOUT_FILENO, ctx->prefix);
+        srs_process_write(STDOUT_FILENO, p);
+        srs_process_write(STDOUT_FILENO, ctx->suffix);
+    }
+    
+    // use execv to start the program.
+    execv(ctx->bin, ctx->argv);
+    
+    ctx->error = ERROR_ENCODER_FORK;
+    ctx->sys_errno = errno;
+    srs_process_write(STDERR_FILENO, "fork process failed, execv ");
+    srs_process_write(STDERR_FILENO, ctx->bin);
+    srs_process_write(STDERR_FILENO, "\n");
+    _exit(-1);
+    
+    return -1;
+}
+
+// Spawn the child process, return the pid or -1 when failed.
+// For linux, use clone(CLONE_VM|CLONE_VFORK) which never copies the page tables of parent, so it
+// costs almost the same for a server with GB of RSS, while fork stalls for tens of ms. The parent
+// is suspended until the child exec or exit, that's ok for ST which is single thread.
+// For other OS, use fork.
+static pid_t srs_process_spawn(SrsProcessSpawn* ctx)
+{
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &ctx->mask);
+    
+#ifdef __linux__
+    // The stack for child, which only runs to exec.
+    const size_t stack_size = 64 * 1024;
+    void* stack = mmap(NULL, stack_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        pthread_sigmask(SIG_SETMASK, &ctx->mask, NULL);
+        return -1;
+    }
+    
+    pid_t pid = clone(srs_process_child, (char*)stack + stack_size, CLONE_VM|CLONE_VFORK|SIGCHLD, ctx);
+    
+    munmap(stack, stack_size);
+#else
+    pid_t pid = fork();
+    if (pid == 0) {
+        srs_process_child(ctx);
+    }
+#endif
+    
+    int sys_errno = errno;
+    pthread_sigmask(SIG_SETMASK, &ctx->mask, NULL);
+    errno = sys_errno;
+    
+    return pid;
 }
 
 srs_error_t SrsProcess::start()
@@ -183,81 +334,50 @@ srs_error_t SrsProcess::start()
     int cid = _srs_context->get_id();
     int ppid = getpid();
     
-    // TODO: fork or vfork?
-    if ((pid = fork()) < 0) {
-        return srs_error_new(ERROR_ENCODER_FORK, "vfork process failed, cli=%s", cli.c_str());
+    // Prepare all for child, which never allocates memory.
+    std::vector<char*> argv;
+    for (int i = 0; i < (int)params.size(); i++) {
+        argv.push_back((char*)params[i].c_str());
     }
+    argv.push_back(NULL);
     
-    // for osx(lldb) to debug the child process.
-    // user can use "lldb -p <pid>" to resume the parent or child process.
-    //kill(0, SIGSTOP);
+    std::string prefix = "\nprocess ppid=" + srs_int2str(ppid) + ", cid=" + srs_int2str(cid) + ", pid=";
+    std::string suffix = ", in=" + srs_int2str(STDIN_FILENO) + ", out=" + srs_int2str(STDOUT_FILENO)
+        + ", err=" + srs_int2str(STDERR_FILENO) + "\n"
+        + "process binary=" + bin + ", cli: " + cli + "\n"
+        + "process actual cli: " + actual_cli + "\n";
     
-    // child process: ffmpeg encoder engine.
-    if (pid == 0) {
-        // ignore the SIGINT and SIGTERM
-        signal(SIGINT, SIG_IGN);
-        signal(SIGTERM, SIG_IGN);
-
-        // for the stdout, ignore when not specified.
-        // redirect stdout to file if possible.
-        if ((err = srs_redirect_output(stdout_file, STDOUT_FILENO)) != srs_success) {
-            return srs_error_wrap(err, "redirect output");
-        }
-        
-        // for the stderr, ignore when not specified.
-        // redirect stderr to file if possible.
-        if ((err = srs_redirect_output(stderr_file, STDERR_FILENO)) != srs_success) {
-            return srs_error_wrap(err, "redirect output");
-        }
-
-        // No stdin for process, @bug https://github.com/ossrs/srs/issues/1592
-        if ((err = srs_redirect_output("/dev/null", STDIN_FILENO)) != srs_success) {
-            return srs_error_wrap(err, "redirect input");
-        }
-
-        // should never close the fd 3+, for it myabe used.
-        // for fd should close at exec, use fnctl to set it.
-        
-        // log basic info to stderr.
-        if (true) {
-            fprintf(stdout, "\n");
-            fprintf(stdout, "process ppid=%d, cid=%d, pid=%d, in=%d, out=%d, err=%d\n",
-                ppid, cid, getpid(), STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO);
-            fprintf(stdout, "process binary=%s, cli: %s\n", bin.c_str(), cli.c_str());
-            fprintf(stdout, "process actual cli: %s\n", actual_cli.c_str());
-        }
-        
-        // memory leak in child process, it's ok.
-        char** argv = new char*[params.size() + 1];
-        for (int i = 0; i < (int)params.size(); i++) {
-            std::string& p = params[i];
-            
-            // memory leak in child process, it's ok.
-            char* v = new char[p.length() + 1];
-            argv[i] = strcpy(v, p.data());
-        }
-        argv[params.size()] = NULL;
-        
-        // use execv to start the program.
-        int r0 = execv(bin.c_str(), argv);
-        if (r0 < 0) {
-            fprintf(stderr, "fork process failed, errno=%d(%s)", errno, strerror(errno));
-        }
-        exit(r0);
+    SrsProcessSpawn ctx;
+    ctx.bin = bin.c_str();
+    ctx.argv = &argv[0];
+    ctx.stdout_file = stdout_file.c_str();
+    ctx.stderr_file = stderr_file.c_str();
+    ctx.prefix = prefix.c_str();
+    ctx.suffix = suffix.c_str();
+    ctx.error = ERROR_SUCCESS;
+    ctx.sys_errno = 0;
+    
+    if ((pid = srs_process_spawn(&ctx)) < 0) {
+        return srs_error_new(ERROR_ENCODER_FORK, "vfork process failed, cli=%s", cli.c_str());
     }
     
-    // parent.
-    if (pid > 0) {
-        // Wait for a while for process to really started.
-        // @see https://github.com/ossrs/srs/issues/1634#issuecomment-597568840
-        srs_usleep(10 * SRS_UTIME_MILLISECONDS);
-
-        is_started = true;
-        srs_trace("fored process, pid=%d, bin=%s, stdout=%s, stderr=%s, argv=%s",
-                  pid, bin.c_str(), stdout_file.c_str(), stderr_file.c_str(), actual_cli.c_str());
-        return err;
+    // The child shares memory with parent for clone, so we got the error when spawn failed.
+    if (ctx.error != ERROR_SUCCESS) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        pid = -1;
+        return srs_error_new(ctx.error, "spawn process failed, errno=%d(%s), cli=%s",
+            ctx.sys_errno, strerror(ctx.sys_errno), cli.c_str());
     }
     
+    // Wait for a while for process to really started.
+    // @see https://github.com/ossrs/srs/issues/1634#issuecomment-597568840
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+    
+    is_started = true;
+    srs_trace("fored process, pid=%d, bin=%s, stdout=%s, stderr=%s, argv=%s",
+              pid, bin.c_str(), stdout_file.c_str(), stderr_file.c_str(), actual_cli.c_str());
+    
     return err;
 }
 
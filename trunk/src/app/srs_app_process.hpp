@@ -42,6 +42,8 @@
 //      if ((ret = process->cycle()) != ERROR_SUCCESS) { return ret; }
 //      process->fast_stop();
 //      process->stop();
+// @remark For linux, the process is spawned by clone(CLONE_VM|CLONE_VFORK), which never copies the
+//      page tables of SRS, so it's fast even when SRS has a large RSS.
 class SrsProcess
 {
 private:
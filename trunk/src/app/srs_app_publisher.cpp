@@ -0,0 +1,353 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <srs_app_publisher.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_protocol_amf0.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_forward.hpp>
+
+ISrsPublisher::ISrsPublisher()
+{
+}
+
+ISrsPublisher::~ISrsPublisher()
+{
+}
+
+SrsLocalPublisher::SrsLocalPublisher(ISrsSourceHandler* h)
+{
+    handler = h;
+    req = NULL;
+    conn = NULL;
+    cid = -1;
+    edge = false;
+    source = NULL;
+}
+
+SrsLocalPublisher::~SrsLocalPublisher()
+{
+    unpublish();
+    srs_freep(req);
+}
+
+srs_error_t SrsLocalPublisher::initialize(string url, string ip)
+{
+    srs_error_t err = srs_success;
+    
+    std::string tcUrl, stream;
+    srs_parse_rtmp_url(url, tcUrl, stream);
+    
+    srs_freep(req);
+    req = new SrsRequest();
+    req->ip = ip;
+    req->port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    srs_discovery_tc_url(tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
+    req->stream = stream;
+    req->tcUrl = tcUrl;
+    req->strip();
+    // The local publisher is never relayed by sibling worker or replicated by origin.
+    req->param = srs_worker_strip_relay_param(req->param);
+    req->param = srs_standby_strip_replica_param(req->param);
+    
+    if (req->app.empty() || req->stream.empty()) {
+        return srs_error_new(ERROR_RTMP_STREAM_NAME_EMPTY, "invalid url %s", url.c_str());
+    }
+    
+    // Apply the default vhost, like the RTMP publisher.
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req->vhost);
+    if (parsed_vhost) {
+        req->vhost = parsed_vhost->arg0();
+    }
+    
+    return err;
+}
+
+void SrsLocalPublisher::set_request(SrsRequest* r)
+{
+    srs_freep(req);
+    req = r->copy();
+    req->param = srs_worker_strip_relay_param(req->param);
+    req->param = srs_standby_strip_replica_param(req->param);
+}
+
+void SrsLocalPublisher::set_client(int id, SrsConnection* c)
+{
+    cid = id;
+    conn = c;
+}
+
+SrsRequest* SrsLocalPublisher::request()
+{
+    return req;
+}
+
+bool SrsLocalPublisher::published()
+{
+    return source != NULL;
+}
+
+srs_error_t SrsLocalPublisher::publish()
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(req);
+    
+    if (source) {
+        return err;
+    }
+    
+    if (cid < 0) {
+        cid = _srs_context->get_id();
+    }
+    
+    // The source id is the current context id, which should be the id of client.
+    int previous = _srs_context->set_id(cid);
+    err = do_publish();
+    _srs_context->set_id(previous);
+    
+    return err;
+}
+
+void SrsLocalPublisher::unpublish()
+{
+    if (!source) {
+        return;
+    }
+    
+    SrsSource* s = source;
+    source = NULL;
+    
+    // The unpublish maybe in other context, for example, the idle checker of UDP caster.
+    int previous = _srs_context->set_id(cid);
+    
+    if (edge) {
+        s->on_edge_proxy_unpublish();
+    } else {
+        s->on_unpublish();
+    }
+    
+    http_hooks_on_unpublish();
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    stat->on_disconnect(cid);
+    
+    _srs_context->set_id(previous);
+}
+
+srs_error_t SrsLocalPublisher::on_message(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // Drop the message util published, for example, in utest.
+    if (!source) {
+        return err;
+    }
+    
+    // for edge, directly proxy message to origin.
+    if (edge) {
+        if ((err = source->on_edge_proxy_publish(msg)) != srs_success) {
+            return srs_error_wrap(err, "proxy publish");
+        }
+        return err;
+    }
+    
+    if (msg->header.is_audio()) {
+        if ((err = source->on_audio(msg)) != srs_success) {
+            return srs_error_wrap(err, "source consume audio");
+        }
+        return err;
+    }
+    
+    if (msg->header.is_video()) {
+        if ((err = source->on_video(msg)) != srs_success) {
+            return srs_error_wrap(err, "source consume video");
+        }
+        return err;
+    }
+    
+    if (msg->header.is_amf0_data()) {
+        return on_meta_data(msg);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLocalPublisher::do_publish()
+{
+    srs_error_t err = srs_success;
+    
+    // The ingesters, without client ip, are trusted like the RTMP publisher over loopback.
+    if (!req->ip.empty()) {
+        SrsSecurity security;
+        if ((err = security.check(SrsRtmpConnFMLEPublish, req->ip, req)) != srs_success) {
+            return srs_error_wrap(err, "security check");
+        }
+    }
+    
+    edge = _srs_config->get_vhost_is_edge(req->vhost);
+    
+    SrsSource* s = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, handler, &s)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(cid, req, conn, SrsRtmpConnFMLEPublish)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+    
+    if ((err = http_hooks_on_publish()) != srs_success) {
+        stat->on_disconnect(cid);
+        return srs_error_wrap(err, "http hook");
+    }
+    
+    if (!s->can_publish(edge)) {
+        http_hooks_on_unpublish();
+        stat->on_disconnect(cid);
+        return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "stream %s is busy", req->get_stream_url().c_str());
+    }
+    
+    // when edge, ignore the publish event, directly proxy it.
+    if (edge) {
+        err = s->on_edge_start_publish();
+    } else {
+        err = s->on_publish();
+    }
+    
+    if (err != srs_success) {
+        http_hooks_on_unpublish();
+        stat->on_disconnect(cid);
+        return srs_error_wrap(err, "source publish");
+    }
+    
+    source = s;
+    
+    return err;
+}
+
+srs_error_t SrsLocalPublisher::on_meta_data(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (!msg->payload || msg->size <= 0) {
+        return err;
+    }
+    
+    SrsBuffer stream(msg->payload, msg->size);
+    
+    // Ignore the data message except the onMetaData, like the RTMP publisher.
+    std::string name;
+    if ((err = srs_amf0_read_string(&stream, name)) != srs_success) {
+        return srs_error_wrap(err, "decode data name");
+    }
+    if (name != SRS_CONSTS_RTMP_SET_DATAFRAME && name != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+    
+    stream.skip(-1 * stream.pos());
+    
+    SrsOnMetaDataPacket* metadata = new SrsOnMetaDataPacket();
+    SrsAutoFree(SrsOnMetaDataPacket, metadata);
+    
+    if ((err = metadata->decode(&stream)) != srs_success) {
+        return srs_error_wrap(err, "decode metadata");
+    }
+    
+    if ((err = source->on_meta_data(msg, metadata)) != srs_success) {
+        return srs_error_wrap(err, "source consume metadata");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLocalPublisher::http_hooks_on_publish()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return err;
+    }
+    
+    // Copy the hooks, because the config maybe reloaded when calling the hooks.
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_publish(req->vhost);
+        
+        if (!conf) {
+            return err;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = SrsHttpHooks::on_publish(url, req)) != srs_success) {
+            return srs_error_wrap(err, "on_publish %s", url.c_str());
+        }
+    }
+    
+    return err;
+}
+
+void SrsLocalPublisher::http_hooks_on_unpublish()
+{
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return;
+    }
+    
+    // Copy the hooks, because the config maybe reloaded when calling the hooks.
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_unpublish(req->vhost);
+        
+        if (!conf) {
+            return;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_unpublish(url, req);
+    }
+}
+
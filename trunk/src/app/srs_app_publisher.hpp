@@ -0,0 +1,92 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SRS_APP_PUBLISHER_HPP
+#define SRS_APP_PUBLISHER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+class SrsSource;
+class SrsRequest;
+class SrsConnection;
+class SrsCommonMessage;
+class ISrsSourceHandler;
+
+// The publisher to publish stream to source.
+class ISrsPublisher
+{
+public:
+    ISrsPublisher();
+    virtual ~ISrsPublisher();
+public:
+    virtual srs_error_t publish() = 0;
+    virtual void unpublish() = 0;
+    // Consume the audio, video or metadata message, the msg is never freed by publisher.
+    virtual srs_error_t on_message(SrsCommonMessage* msg) = 0;
+};
+
+// The publisher in process, for casters and ingesters to publish to source directly,
+// without the RTMP loopback of SrsSimpleRtmpClient. Like the RTMP publisher, it checks
+// the security, notifies the http hooks and reports the client to statistic.
+class SrsLocalPublisher : public ISrsPublisher
+{
+private:
+    ISrsSourceHandler* handler;
+    SrsRequest* req;
+    // The connection of client, NULL if no connection, for example, the UDP caster.
+    SrsConnection* conn;
+    // The id of client in statistic, which is the source id when publish.
+    int cid;
+    bool edge;
+    SrsSource* source;
+public:
+    SrsLocalPublisher(ISrsSourceHandler* h);
+    virtual ~SrsLocalPublisher();
+public:
+    // Initialize the request by url, for example, rtmp://127.0.0.1/live/livestream
+    // @param ip The ip of client, for the security check and hooks, empty to ignore the security.
+    virtual srs_error_t initialize(std::string url, std::string ip);
+    // Set the request to publish, which is copied.
+    virtual void set_request(SrsRequest* r);
+    // Set the client of statistic, the id is the current context id when publish if not set.
+    virtual void set_client(int id, SrsConnection* c);
+    virtual SrsRequest* request();
+    // Whether published, and the source is available.
+    virtual bool published();
+// Interface ISrsPublisher
+public:
+    virtual srs_error_t publish();
+    virtual void unpublish();
+    virtual srs_error_t on_message(SrsCommonMessage* msg);
+private:
+    virtual srs_error_t do_publish();
+    virtual srs_error_t on_meta_data(SrsCommonMessage* msg);
+    virtual srs_error_t http_hooks_on_publish();
+    virtual void http_hooks_on_unpublish();
+};
+
+#endif
+
@@ -32,6 +32,7 @@
 #include <srs_app_config.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_http_conn.hpp>
+#include <srs_app_hourglass.hpp>
 #include <srs_core_autofree.hpp>
 
 #include <sys/socket.h>
@@ -56,12 +57,24 @@ ISrsMessagePumper::~ISrsMessagePumper()
 {
 }
 
-SrsRecvThread::SrsRecvThread(ISrsMessagePumper* p, SrsRtmpServer* r, srs_utime_t tm, int parent_cid)
+void ISrsMessagePumper::on_batch_start()
+{
+}
+
+void ISrsMessagePumper::on_batch_end()
+{
+}
+
+SrsRecvThread::SrsRecvThread(ISrsMessagePumper* p, SrsRtmpServer* r, srs_utime_t tm, int parent_cid, string n, int ss)
 {
     rtmp = r;
     pumper = p;
     timeout = tm;
     _parent_cid = parent_cid;
+    role = n;
+    stack_size = ss;
+    batch = 0;
+    priority = SrsCoroutinePriorityNormal;
     trd = new SrsDummyCoroutine();
 }
 
@@ -75,12 +88,25 @@ int SrsRecvThread::cid()
     return trd->cid();
 }
 
+void SrsRecvThread::set_batch(int v)
+{
+    batch = v;
+}
+
+void SrsRecvThread::set_priority(SrsCoroutinePriority v)
+{
+    priority = v;
+}
+
 srs_error_t SrsRecvThread::start()
 {
     srs_error_t err = srs_success;
     
     srs_freep(trd);
-    trd = new SrsSTCoroutine("recv", this, _parent_cid);
+    SrsSTCoroutine* st = new SrsSTCoroutine(role, this, _parent_cid);
+    st->set_stack_size(stack_size);
+    st->set_priority(priority);
+    trd = st;
     
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "recv thread");
@@ -128,6 +154,9 @@ srs_error_t SrsRecvThread::do_cycle()
 {
     srs_error_t err = srs_success;
     
+    // The messages of batch, resize when batch changed.
+    std::vector<SrsCommonMessage*> msgs;
+    
     while (true) {
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "recv thread");
@@ -135,15 +164,23 @@ srs_error_t SrsRecvThread::do_cycle()
         
         // When the pumper is interrupted, wait then retry.
         if (pumper->interrupted()) {
-            srs_usleep(timeout);
+            _srs_timer->usleep(timeout);
             continue;
         }
         
-        SrsCommonMessage* msg = NULL;
-        
         // Process the received message.
-        if ((err = rtmp->recv_message(&msg)) == srs_success) {
-            err = pumper->consume(msg);
+        if (batch > 1) {
+            msgs.resize(batch);
+            
+            int count = 0;
+            if ((err = rtmp->recv_messages(&msgs[0], batch, count)) == srs_success) {
+                err = consume_batch(&msgs[0], count);
+            }
+        } else {
+            SrsCommonMessage* msg = NULL;
+            if ((err = rtmp->recv_message(&msg)) == srs_success) {
+                err = pumper->consume(msg);
+            }
         }
         
         if (err != srs_success) {
@@ -160,125 +197,38 @@ srs_error_t SrsRecvThread::do_cycle()
     return err;
 }
 
-SrsQueueRecvThread::SrsQueueRecvThread(SrsConsumer* consumer, SrsRtmpServer* rtmp_sdk, srs_utime_t tm, int parent_cid)
-	: trd(this, rtmp_sdk, tm, parent_cid)
-{
-    _consumer = consumer;
-    rtmp = rtmp_sdk;
-    recv_error = srs_success;
-}
-
-SrsQueueRecvThread::~SrsQueueRecvThread()
-{
-    stop();
-    
-    // clear all messages.
-    std::vector<SrsCommonMessage*>::iterator it;
-    for (it = queue.begin(); it != queue.end(); ++it) {
-        SrsCommonMessage* msg = *it;
-        srs_freep(msg);
-    }
-    queue.clear();
-    
-    srs_freep(recv_error);
-}
-
-srs_error_t SrsQueueRecvThread::start()
+srs_error_t SrsRecvThread::consume_batch(SrsCommonMessage** msgs, int count)
 {
     srs_error_t err = srs_success;
     
-    if ((err = trd.start()) != srs_success) {
-        return srs_error_wrap(err, "queue recv thread");
-    }
-    
-    return err;
-}
-
-void SrsQueueRecvThread::stop()
-{
-    trd.stop();
-}
-
-bool SrsQueueRecvThread::empty()
-{
-    return queue.empty();
-}
-
-int SrsQueueRecvThread::size()
-{
-    return (int)queue.size();
-}
-
-SrsCommonMessage* SrsQueueRecvThread::pump()
-{
-    srs_assert(!queue.empty());
-    
-    SrsCommonMessage* msg = *queue.begin();
+    pumper->on_batch_start();
     
-    queue.erase(queue.begin());
-    
-    return msg;
-}
-
-srs_error_t SrsQueueRecvThread::error_code()
-{
-    return srs_error_copy(recv_error);
-}
-
-srs_error_t SrsQueueRecvThread::consume(SrsCommonMessage* msg)
-{
-    // put into queue, the send thread will get and process it,
-    // @see SrsRtmpConn::process_play_control_msg
-    queue.push_back(msg);
-#ifdef SRS_PERF_QUEUE_COND_WAIT
-    if (_consumer) {
-        _consumer->wakeup();
+    for (int i = 0; i < count; i++) {
+        SrsCommonMessage* msg = msgs[i];
+        
+        // Free the left messages when error.
+        if (err != srs_success) {
+            srs_freep(msg);
+            continue;
+        }
+        
+        err = pumper->consume(msg);
     }
-#endif
-    return srs_success;
-}
-
-bool SrsQueueRecvThread::interrupted()
-{
-    // we only recv one message and then process it,
-    // for the message may cause the thread to stop,
-    // when stop, the thread is freed, so the messages
-    // are dropped.
-    return !empty();
-}
-
-void SrsQueueRecvThread::interrupt(srs_error_t err)
-{
-    srs_freep(recv_error);
-    recv_error = srs_error_copy(err);
     
-#ifdef SRS_PERF_QUEUE_COND_WAIT
-    if (_consumer) {
-        _consumer->wakeup();
-    }
-#endif
-}
-
-void SrsQueueRecvThread::on_start()
-{
-    // disable the protocol auto response,
-    // for the isolate recv thread should never send any messages.
-    rtmp->set_auto_response(false);
-}
-
-void SrsQueueRecvThread::on_stop()
-{
-    // enable the protocol auto response,
-    // for the isolate recv thread terminated.
-    rtmp->set_auto_response(true);
+    pumper->on_batch_end();
+    
+    return err;
 }
 
 SrsPublishRecvThread::SrsPublishRecvThread(SrsRtmpServer* rtmp_sdk, SrsRequest* _req,
 	int mr_sock_fd, srs_utime_t tm, SrsRtmpConn* conn, SrsSource* source, int parent_cid)
-    : trd(this, rtmp_sdk, tm, parent_cid)
+    : trd(this, rtmp_sdk, tm, parent_cid, "publish-recv", SRS_PERF_STACK_PUBLISH_RECV)
 {
     rtmp = rtmp_sdk;
     
+    // The publisher runs before the players, which yield by slice.
+    trd.set_priority(SrsCoroutinePriorityHigh);
+    
     _conn = conn;
     _source = source;
     
@@ -298,6 +248,9 @@ SrsPublishRecvThread::SrsPublishRecvThread(SrsRtmpServer* rtmp_sdk, SrsRequest*
     
     realtime = _srs_config->get_realtime_enabled(req->vhost);
     
+    batch = _srs_config->get_publish_batch(req->vhost);
+    trd.set_batch(batch);
+    
     _srs_config->subscribe(this);
 }
 
@@ -356,7 +309,7 @@ srs_error_t SrsPublishRecvThread::start()
     }
     
     ncid = cid = trd.cid();
-
+    
     return err;
 }
 
@@ -450,6 +403,16 @@ void SrsPublishRecvThread::on_stop()
 #endif
 }
 
+void SrsPublishRecvThread::on_batch_start()
+{
+    _source->on_batch_start();
+}
+
+void SrsPublishRecvThread::on_batch_end()
+{
+    _source->on_batch_end();
+}
+
 #ifdef SRS_PERF_MERGED_READ
 void SrsPublishRecvThread::on_read(ssize_t nread)
 {
@@ -510,6 +473,14 @@ srs_error_t SrsPublishRecvThread::on_reload_vhost_publish(string vhost)
     mr = mr_enabled;
     mr_sleep = sleep_v;
     
+    // update the batch, which is applied for next recv.
+    int batch_v = _srs_config->get_publish_batch(req->vhost);
+    if (batch != batch_v) {
+        srs_trace("publish batch changed %d=>%d", batch, batch_v);
+        batch = batch_v;
+        trd.set_batch(batch);
+    }
+    
     return err;
 }
 
@@ -561,47 +532,3 @@ void SrsPublishRecvThread::set_socket_buffer(srs_utime_t sleep_v)
     
     rtmp->set_recv_buffer(nb_rbuf);
 }
-
-SrsHttpRecvThread::SrsHttpRecvThread(SrsResponseOnlyHttpConn* c)
-{
-    conn = c;
-    trd = new SrsSTCoroutine("http-receive", this, _srs_context->get_id());
-}
-
-SrsHttpRecvThread::~SrsHttpRecvThread()
-{
-    srs_freep(trd);
-}
-
-srs_error_t SrsHttpRecvThread::start()
-{
-    srs_error_t err = srs_success;
-    
-    if ((err = trd->start()) != srs_success) {
-        return srs_error_wrap(err, "http recv thread");
-    }
-    
-    return err;
-}
-
-srs_error_t SrsHttpRecvThread::pull()
-{
-    return trd->pull();
-}
-
-srs_error_t SrsHttpRecvThread::cycle()
-{
-    srs_error_t err = srs_success;
-    
-    while ((err = trd->pull()) == srs_success) {
-        ISrsHttpMessage* req = NULL;
-        SrsAutoFree(ISrsHttpMessage, req);
-        
-        if ((err = conn->pop_message(&req)) != srs_success) {
-            return srs_error_wrap(err, "pop message");
-        }
-    }
-    
-    return err;
-}
-
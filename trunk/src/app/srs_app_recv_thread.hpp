@@ -40,7 +40,6 @@ class SrsSource;
 class SrsRequest;
 class SrsConsumer;
 class SrsHttpConn;
-class SrsResponseOnlyHttpConn;
 
 // The message consumer which consume a message.
 class ISrsMessageConsumer
@@ -71,6 +70,10 @@ public:
     virtual void on_start() = 0;
     // When stop the pumper.
     virtual void on_stop() = 0;
+    // When start and end to consume a batch of messages.
+    // @remark The default implementation is empty.
+    virtual void on_batch_start();
+    virtual void on_batch_end();
 };
 
 // The recv thread, use message handler to handle each received message.
@@ -83,13 +86,25 @@ protected:
     int _parent_cid;
     // The recv timeout in srs_utime_t.
     srs_utime_t timeout;
+    // The role of coroutine, and the size of stack in bytes for this role.
+    std::string role;
+    int stack_size;
+    // The max number of messages to recv in a batch, 0 or 1 to recv one by one.
+    int batch;
+    SrsCoroutinePriority priority;
 public:
     // Constructor.
     // @param tm The receive timeout in srs_utime_t.
-    SrsRecvThread(ISrsMessagePumper* p, SrsRtmpServer* r, srs_utime_t tm, int parent_cid);
+    // @param n The role name of coroutine, to stat the stacks, @see SrsStackStats.
+    // @param ss The stack size in bytes, 0 to use the default.
+    SrsRecvThread(ISrsMessagePumper* p, SrsRtmpServer* r, srs_utime_t tm, int parent_cid, std::string n = "recv", int ss = 0);
     virtual ~SrsRecvThread();
 public:
     virtual int cid();
+    // Set the max number of messages to recv in a batch.
+    virtual void set_batch(int v);
+    // Set the priority of coroutine, before start it.
+    virtual void set_priority(SrsCoroutinePriority v);
 public:
     virtual srs_error_t start();
     virtual void stop();
@@ -99,40 +114,8 @@ public:
     virtual srs_error_t cycle();
 private:
     virtual srs_error_t do_cycle();
-};
-
-// The recv thread used to replace the timeout recv,
-// which hurt performance for the epoll_ctrl is frequently used.
-// @see: SrsRtmpConn::playing
-// @see: https://github.com/ossrs/srs/issues/217
-class SrsQueueRecvThread : public ISrsMessagePumper
-{
-private:
-    std::vector<SrsCommonMessage*> queue;
-    SrsRecvThread trd;
-    SrsRtmpServer* rtmp;
-    // The recv thread error code.
-    srs_error_t recv_error;
-    SrsConsumer* _consumer;
-public:
-	// TODO: FIXME: Refine timeout in time unit.
-    SrsQueueRecvThread(SrsConsumer* consumer, SrsRtmpServer* rtmp_sdk, srs_utime_t tm, int parent_cid);
-    virtual ~SrsQueueRecvThread();
-public:
-    virtual srs_error_t start();
-    virtual void stop();
-public:
-    virtual bool empty();
-    virtual int size();
-    virtual SrsCommonMessage* pump();
-    virtual srs_error_t error_code();
-// Interface ISrsMessagePumper
-public:
-    virtual srs_error_t consume(SrsCommonMessage* msg);
-    virtual bool interrupted();
-    virtual void interrupt(srs_error_t err);
-    virtual void on_start();
-    virtual void on_stop();
+    // Consume the batch of messages, and free all messages.
+    virtual srs_error_t consume_batch(SrsCommonMessage** msgs, int count);
 };
 
 // The publish recv thread got message and callback the source method to process message.
@@ -150,6 +133,8 @@ private:
     int64_t _nb_msgs;
     // The video frames we got.
     uint64_t video_frames;
+    // The max number of messages to parse in a batch.
+    int batch;
     // For mr(merged read),
     // @see https://github.com/ossrs/srs/issues/241
     bool mr;
@@ -191,6 +176,8 @@ public:
     virtual void interrupt(srs_error_t err);
     virtual void on_start();
     virtual void on_stop();
+    virtual void on_batch_start();
+    virtual void on_batch_end();
 // Interface IMergeReadHandler
 public:
 #ifdef SRS_PERF_MERGED_READ
@@ -204,26 +191,5 @@ private:
     virtual void set_socket_buffer(srs_utime_t sleep_v);
 };
 
-// The HTTP receive thread, try to read messages util EOF.
-// For example, the HTTP FLV serving thread will use the receive thread to break
-// when client closed the request, to avoid FD leak.
-// @see https://github.com/ossrs/srs/issues/636#issuecomment-298208427
-class SrsHttpRecvThread : public ISrsCoroutineHandler
-{
-private:
-    SrsResponseOnlyHttpConn* conn;
-    SrsCoroutine* trd;
-public:
-    SrsHttpRecvThread(SrsResponseOnlyHttpConn* c);
-    virtual ~SrsHttpRecvThread();
-public:
-    virtual srs_error_t start();
-public:
-    virtual srs_error_t pull();
-// Interface ISrsOneCycleThreadHandler
-public:
-    virtual srs_error_t cycle();
-};
-
 #endif
 
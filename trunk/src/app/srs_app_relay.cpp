@@ -0,0 +1,928 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_relay.hpp>
+
+#include <netdb.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_pithy_print.hpp>
+#include <srs_app_http_hooks.hpp>
+
+// The ip and port of address, for example, 192.168.1.10:1935
+static string srs_relay_peer_id(const sockaddr* from, int fromlen)
+{
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    if (getnameinfo(from, fromlen, host, sizeof(host), serv, sizeof(serv), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        return "";
+    }
+    return string(host) + ":" + serv;
+}
+
+// The random token, for the challenge of path, empty if failed, which never equals.
+static string srs_relay_random_token()
+{
+    char token[SRS_RELAY_TOKEN_SIZE];
+    if (RAND_bytes((unsigned char*)token, sizeof(token)) != 1) {
+        return "";
+    }
+    return string(token, sizeof(token));
+}
+
+static bool srs_relay_token_equals(const string& a, const string& b)
+{
+    return !a.empty() && a.length() == b.length() && CRYPTO_memcmp(a.data(), b.data(), a.length()) == 0;
+}
+
+string srs_relay_mac(const string& secret, const char* data, int size)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int nn_digest = 0;
+    if (!HMAC(EVP_sha256(), secret.data(), (int)secret.length(), (const unsigned char*)data, size, digest, &nn_digest)) {
+        return "";
+    }
+    return string((char*)digest, SRS_RELAY_MAC_SIZE);
+}
+
+srs_error_t srs_relay_sign(const string& secret, char* buf, int& size)
+{
+    string mac = srs_relay_mac(secret, buf, size);
+    if (mac.empty()) {
+        return srs_error_new(ERROR_RELAY_AUTH, "hmac %d bytes", size);
+    }
+    
+    memcpy(buf + size, mac.data(), SRS_RELAY_MAC_SIZE);
+    size += SRS_RELAY_MAC_SIZE;
+    
+    return srs_success;
+}
+
+srs_error_t srs_relay_verify(const string& secret, char* buf, int& size)
+{
+    if (size <= SRS_RELAY_MAC_SIZE) {
+        return srs_error_new(ERROR_RELAY_AUTH, "requires mac only %d bytes", size);
+    }
+    
+    string mac = srs_relay_mac(secret, buf, size - SRS_RELAY_MAC_SIZE);
+    if (mac.empty() || CRYPTO_memcmp(mac.data(), buf + size - SRS_RELAY_MAC_SIZE, SRS_RELAY_MAC_SIZE) != 0) {
+        return srs_error_new(ERROR_RELAY_AUTH, "invalid mac of %d bytes", size);
+    }
+    size -= SRS_RELAY_MAC_SIZE;
+    
+    return srs_success;
+}
+
+SrsRelaySession::SrsRelaySession(SrsRelayServer* s, ISrsSourceHandler* h, uint32_t cid, const sockaddr* from, int fromlen)
+{
+    server = s;
+    handler = h;
+    trd = new SrsDummyCoroutine();
+    req = NULL;
+    conn_id = cid;
+    
+    memcpy(&peer, from, fromlen);
+    peer_len = fromlen;
+    candidate_len = 0;
+    challenge_at = 0;
+    
+    string peer_id = srs_relay_peer_id(from, fromlen);
+    ip = peer_id.substr(0, peer_id.rfind(":"));
+    
+    alive_time = srs_get_system_time();
+    sender = new SrsRelaySender(cid);
+    nn_migrations = 0;
+    played = false;
+}
+
+SrsRelaySession::~SrsRelaySession()
+{
+    srs_freep(trd);
+    srs_freep(sender);
+    srs_freep(req);
+}
+
+srs_error_t SrsRelaySession::initialize(string url)
+{
+    srs_error_t err = srs_success;
+    
+    req = new SrsRequest();
+    srs_parse_rtmp_url(url, req->tcUrl, req->stream);
+    srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
+    req->ip = ip;
+    req->strip();
+    
+    // Apply the default vhost, like the RTMP client.
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req->vhost);
+    if (parsed_vhost) {
+        req->vhost = parsed_vhost->arg0();
+    }
+    
+    if (req->app.empty() || req->stream.empty()) {
+        return srs_error_new(ERROR_RELAY_REJECTED, "invalid url %s", url.c_str());
+    }
+    
+    SrsSecurity security;
+    if ((err = security.check(SrsRtmpConnPlay, ip, req)) != srs_success) {
+        return srs_error_wrap(err, "security check");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRelaySession::start()
+{
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("relay", this);
+    return trd->start();
+}
+
+string SrsRelaySession::remote_ip()
+{
+    return ip;
+}
+
+bool SrsRelaySession::on_packet(const sockaddr* from, int fromlen)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    if (fromlen == peer_len && memcmp(&peer, from, fromlen) == 0) {
+        alive_time = now;
+        return true;
+    }
+    
+    // The edge migrates to another address, but the packet maybe replayed by others, so challenge the new
+    // address, and migrate when it echoes, the session is identified by the connection id.
+    bool same = fromlen == candidate_len && memcmp(&candidate, from, fromlen) == 0;
+    if (same && now - challenge_at < SRS_RELAY_CONNECT_INTERVAL) {
+        return false;
+    }
+    
+    if (!same) {
+        memcpy(&candidate, from, fromlen);
+        candidate_len = fromlen;
+        challenge = srs_relay_random_token();
+    }
+    challenge_at = now;
+    
+    SrsRelayPacket pkt;
+    pkt.type = SrsRelayPacketChallenge;
+    pkt.conn_id = conn_id;
+    pkt.token = challenge;
+    server->send_packet(from, fromlen, &pkt);
+    
+    return false;
+}
+
+void SrsRelaySession::on_response(const sockaddr* from, int fromlen, string token)
+{
+    if (fromlen != candidate_len || memcmp(&candidate, from, fromlen) != 0) {
+        return;
+    }
+    if (!srs_relay_token_equals(challenge, token)) {
+        return;
+    }
+    
+    memcpy(&peer, from, fromlen);
+    peer_len = fromlen;
+    candidate_len = 0;
+    challenge = "";
+    alive_time = srs_get_system_time();
+    
+    nn_migrations++;
+    srs_trace("relay: session %u migrate to %s, migrations=%d", conn_id, srs_relay_peer_id(from, fromlen).c_str(), nn_migrations);
+}
+
+srs_error_t SrsRelaySession::on_ack(SrsRelayPacket* ack)
+{
+    vector<string> pkts;
+    sender->on_ack(ack, srs_update_monotonic_time(), pkts);
+    return send_packets(pkts);
+}
+
+void SrsRelaySession::on_close(int code)
+{
+    srs_trace("relay: session %u closed by edge, code=%d", conn_id, code);
+    trd->interrupt();
+}
+
+srs_error_t SrsRelaySession::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Notify the edge to reconnect, except it closed the session.
+    if (!srs_is_client_gracefully_close(err)) {
+        server->reply((const sockaddr*)&peer, peer_len, conn_id, SrsRelayPacketClose, srs_error_code(err));
+    }
+    
+    if (played) {
+        http_hooks_on_stop();
+    }
+    
+    // Free the session by manager.
+    server->remove(this);
+    
+    // The session is interrupted when the edge closes it.
+    int code = srs_error_code(err);
+    if (srs_is_client_gracefully_close(err) || code == ERROR_SOCKET_TIMEOUT || code == ERROR_THREAD_INTERRUPED) {
+        srs_warn("relay client %s disconnect, %s", ip.c_str(), srs_error_desc(err).c_str());
+    } else if (err != srs_success) {
+        srs_error("relay serve client %s, %s", ip.c_str(), srs_error_desc(err).c_str());
+    }
+    srs_freep(err);
+    
+    return srs_success;
+}
+
+srs_error_t SrsRelaySession::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    // Notify the hooks like the RTMP player, which maybe rejects the edge.
+    if ((err = http_hooks_on_play()) != srs_success) {
+        return srs_error_wrap(err, "on_play");
+    }
+    played = true;
+    
+    SrsSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, handler, &source)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+    
+    SrsConsumer* consumer = NULL;
+    if ((err = source->create_consumer(NULL, consumer)) != srs_success) {
+        return srs_error_wrap(err, "create consumer");
+    }
+    SrsAutoFree(SrsConsumer, consumer);
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(_srs_context->get_id(), req, NULL, SrsRtmpConnPlay)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+    
+    // The edge retransmits the connect, until it got the accept or the data.
+    server->reply((const sockaddr*)&peer, peer_len, conn_id, SrsRelayPacketAccept, ERROR_SUCCESS);
+    srs_trace("relay client ip=%s, session=%u, %s", ip.c_str(), conn_id, req->get_stream_url().c_str());
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_rtmp_play();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    srs_utime_t sent_at = srs_update_monotonic_time();
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            break;
+        }
+        
+        if (srs_get_system_time() - alive_time > SRS_RELAY_SESSION_TIMEOUT) {
+            err = srs_error_new(ERROR_SOCKET_TIMEOUT, "no packet for %dms", srsu2msi(SRS_RELAY_SESSION_TIMEOUT));
+            break;
+        }
+        
+        int count = 0;
+        if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
+            err = srs_error_wrap(err, "dump packets");
+            break;
+        }
+        
+        vector<string> pkts;
+        srs_utime_t now = srs_update_monotonic_time();
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            if (err == srs_success) {
+                err = sender->on_message(msg, now, pkts);
+            }
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            err = srs_error_wrap(err, "send");
+            break;
+        }
+        
+        // Probe the lost frames, or keep alive.
+        sender->on_timer(now, pkts);
+        if (!pkts.empty()) {
+            sent_at = now;
+        } else if (now - sent_at > SRS_RELAY_PING_INTERVAL) {
+            sent_at = now;
+            server->reply((const sockaddr*)&peer, peer_len, conn_id, SrsRelayPacketPing, ERROR_SUCCESS);
+        }
+        
+        if ((err = send_packets(pkts)) != srs_success) {
+            err = srs_error_wrap(err, "send");
+            break;
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> relay play %s, packets=%" PRId64 ", retransmits=%" PRId64 ", abandoned=%" PRId64 ", inflight=%d, srtt=%dms, migrations=%d",
+                req->get_stream_url().c_str(), sender->nn_packets, sender->nn_retransmits, sender->nn_abandoned,
+                sender->nn_inflight(), srsu2msi(sender->get_srtt()), nn_migrations);
+        }
+        
+        if (count < msgs.max) {
+            srs_usleep(SRS_RELAY_TIMER_INTERVAL);
+        }
+    }
+    
+    stat->on_disconnect(_srs_context->get_id());
+    
+    return err;
+}
+
+srs_error_t SrsRelaySession::send_packets(vector<string>& pkts)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < (int)pkts.size(); i++) {
+        string& pkt = pkts.at(i);
+        if ((err = server->sendto((const sockaddr*)&peer, peer_len, pkt.data(), (int)pkt.length())) != srs_success) {
+            return srs_error_wrap(err, "send packet");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRelaySession::http_hooks_on_play()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return err;
+    }
+    
+    // Copy the hooks, because the config maybe reloaded when calling the hooks.
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_play(req->vhost);
+        
+        if (!conf) {
+            return err;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = SrsHttpHooks::on_play(url, req)) != srs_success) {
+            return srs_error_wrap(err, "relay on_play %s", url.c_str());
+        }
+    }
+    
+    return err;
+}
+
+void SrsRelaySession::http_hooks_on_stop()
+{
+    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        return;
+    }
+    
+    // Copy the hooks, because the config maybe reloaded when calling the hooks.
+    vector<string> hooks;
+    
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_stop(req->vhost);
+        
+        if (!conf) {
+            return;
+        }
+        
+        hooks = conf->args;
+    }
+    
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_stop(url, req);
+    }
+}
+
+SrsRelayServer::SrsRelayServer(ISrsSourceHandler* h)
+{
+    handler = h;
+    listener = NULL;
+    manager = new SrsCoroutineManager();
+}
+
+SrsRelayServer::~SrsRelayServer()
+{
+    srs_freep(listener);
+    
+    // The session removes itself when freed, so free the swapped sessions.
+    std::map<uint32_t, SrsRelaySession*> copy;
+    copy.swap(sessions);
+    
+    std::map<uint32_t, SrsRelaySession*>::iterator it;
+    for (it = copy.begin(); it != copy.end(); ++it) {
+        SrsRelaySession* session = it->second;
+        srs_freep(session);
+    }
+    
+    srs_freep(manager);
+}
+
+srs_error_t SrsRelayServer::listen(string ip, int port)
+{
+    srs_error_t err = srs_success;
+    
+    // The relay is only for the edges, which share the secret with origin.
+    secret = _srs_config->get_relay_server_secret();
+    if (secret.empty()) {
+        return srs_error_new(ERROR_RELAY_AUTH, "no relay_server.secret");
+    }
+    
+    srs_freep(listener);
+    listener = new SrsUdpListener(this, ip, port);
+    // All edges send the ACK to the port, receive them in batch.
+    listener->set_batch(SRS_PERF_UDP_BATCH);
+    
+    if ((err = listener->listen()) != srs_success) {
+        return srs_error_wrap(err, "listen %s:%d", ip.c_str(), port);
+    }
+    
+    if ((err = manager->start()) != srs_success) {
+        return srs_error_wrap(err, "start manager");
+    }
+    
+    srs_trace("relay: listen at udp://%s:%d", ip.c_str(), port);
+    
+    return err;
+}
+
+srs_error_t SrsRelayServer::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    // Drop the packet not from edges silently, never reply to the spoofed address.
+    int size = nb_buf;
+    if ((err = srs_relay_verify(secret, buf, size)) != srs_success) {
+        srs_info("relay: drop packet of %s, %s", srs_relay_peer_id(from, fromlen).c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        return srs_success;
+    }
+    
+    SrsRelayPacket pkt;
+    if ((err = pkt.decode(buf, size)) != srs_success) {
+        srs_warn("relay: ignore packet of %s, %s", srs_relay_peer_id(from, fromlen).c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        return srs_success;
+    }
+    
+    std::map<uint32_t, SrsRelaySession*>::iterator it = sessions.find(pkt.conn_id);
+    
+    // Create the session for connect, or accept again for the connect retransmitted.
+    if (pkt.type == SrsRelayPacketConnect) {
+        if (it != sessions.end()) {
+            if (it->second->on_packet(from, fromlen)) {
+                reply(from, fromlen, pkt.conn_id, SrsRelayPacketAccept, ERROR_SUCCESS);
+            }
+            return err;
+        }
+        
+        // Validate the address of edge by the cookie, before any state or stream for it, for the connect
+        // maybe replayed from a spoofed address, the retry is smaller than connect, so never amplifies.
+        if (!verify_cookie(from, fromlen, pkt.conn_id, pkt.token)) {
+            SrsRelayPacket retry;
+            retry.type = SrsRelayPacketRetry;
+            retry.conn_id = pkt.conn_id;
+            retry.token = cookie(from, fromlen, pkt.conn_id, srs_get_system_time() / SRS_RELAY_COOKIE_PERIOD);
+            send_packet(from, fromlen, &retry);
+            return err;
+        }
+        
+        SrsRelaySession* session = new SrsRelaySession(this, handler, pkt.conn_id, from, fromlen);
+        if ((err = session->initialize(pkt.url)) != srs_success) {
+            srs_warn("relay: reject %s of %s, %s", pkt.url.c_str(), srs_relay_peer_id(from, fromlen).c_str(), srs_error_desc(err).c_str());
+            reply(from, fromlen, pkt.conn_id, SrsRelayPacketAccept, srs_error_code(err));
+            srs_freep(err);
+            srs_freep(session);
+            return srs_success;
+        }
+        
+        sessions[pkt.conn_id] = session;
+        if ((err = session->start()) != srs_success) {
+            srs_warn("relay: start session %u, %s", pkt.conn_id, srs_error_desc(err).c_str());
+            srs_freep(err);
+            remove(session);
+        }
+        return srs_success;
+    }
+    
+    // The session is closed, notify the edge to reconnect.
+    if (it == sessions.end()) {
+        if (pkt.type != SrsRelayPacketClose) {
+            reply(from, fromlen, pkt.conn_id, SrsRelayPacketClose, ERROR_RELAY_CLOSED);
+        }
+        return err;
+    }
+    
+    SrsRelaySession* session = it->second;
+    if (pkt.type == SrsRelayPacketResponse) {
+        session->on_response(from, fromlen, pkt.token);
+        return err;
+    }
+    session->on_packet(from, fromlen);
+    
+    if (pkt.type == SrsRelayPacketAck) {
+        err = session->on_ack(&pkt);
+    } else if (pkt.type == SrsRelayPacketClose) {
+        session->on_close(pkt.code);
+    }
+    
+    // Close the session when failed, and never break the listener.
+    if (err != srs_success) {
+        srs_warn("relay: close session %u, %s", pkt.conn_id, srs_error_desc(err).c_str());
+        srs_freep(err);
+        session->trd->interrupt();
+    }
+    
+    return srs_success;
+}
+
+void SrsRelayServer::remove(ISrsConnection* c)
+{
+    SrsRelaySession* session = dynamic_cast<SrsRelaySession*>(c);
+    
+    // Ignore the session freed by server, when dispose.
+    std::map<uint32_t, SrsRelaySession*>::iterator it = sessions.find(session->conn_id);
+    if (it == sessions.end() || it->second != session) {
+        return;
+    }
+    sessions.erase(it);
+    
+    manager->remove(c);
+}
+
+srs_error_t SrsRelayServer::sendto(const sockaddr* to, int tolen, const char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    char buf[SRS_RELAY_MAX_PACKET + SRS_RELAY_MAC_SIZE];
+    if (size > SRS_RELAY_MAX_PACKET) {
+        return srs_error_new(ERROR_RELAY_DECODE, "packet %d exceed %d bytes", size, SRS_RELAY_MAX_PACKET);
+    }
+    memcpy(buf, data, size);
+    
+    if ((err = srs_relay_sign(secret, buf, size)) != srs_success) {
+        return srs_error_wrap(err, "sign");
+    }
+    
+    if (srs_sendto(listener->stfd(), buf, size, to, tolen, SRS_UTIME_NO_TIMEOUT) <= 0) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "sendto %d bytes", size);
+    }
+    return err;
+}
+
+void SrsRelayServer::reply(const sockaddr* to, int tolen, uint32_t conn_id, SrsRelayPacketType type, int code)
+{
+    SrsRelayPacket pkt;
+    pkt.type = type;
+    pkt.conn_id = conn_id;
+    pkt.code = (uint16_t)code;
+    send_packet(to, tolen, &pkt);
+}
+
+void SrsRelayServer::send_packet(const sockaddr* to, int tolen, SrsRelayPacket* pkt)
+{
+    char buf[SRS_RELAY_MAX_PACKET];
+    SrsBuffer stream(buf, sizeof(buf));
+    srs_error_t err = pkt->encode(&stream);
+    if (err == srs_success) {
+        err = sendto(to, tolen, buf, stream.pos());
+    }
+    srs_freep(err);
+}
+
+string SrsRelayServer::cookie(const sockaddr* from, int fromlen, uint32_t conn_id, int64_t period)
+{
+    string v = srs_relay_peer_id(from, fromlen) + "/" + srs_int2str(conn_id) + "/" + srs_int2str(period);
+    return srs_relay_mac(secret, v.data(), (int)v.length());
+}
+
+bool SrsRelayServer::verify_cookie(const sockaddr* from, int fromlen, uint32_t conn_id, string token)
+{
+    int64_t period = srs_get_system_time() / SRS_RELAY_COOKIE_PERIOD;
+    return srs_relay_token_equals(cookie(from, fromlen, conn_id, period), token)
+        || srs_relay_token_equals(cookie(from, fromlen, conn_id, period - 1), token);
+}
+
+SrsRelayClient::SrsRelayClient(string h, int p, string u)
+{
+    host = h;
+    port = p;
+    url = u;
+    stfd = NULL;
+    conn_id = 0;
+    secret = _srs_config->get_relay_server_secret();
+    receiver = new SrsRelayReceiver();
+    timeout = SRS_RELAY_SESSION_TIMEOUT;
+    recv_at = ping_at = migrate_at = 0;
+    nn_migrations = 0;
+}
+
+SrsRelayClient::~SrsRelayClient()
+{
+    close();
+    srs_freep(receiver);
+}
+
+srs_error_t SrsRelayClient::connect(srs_utime_t tm)
+{
+    srs_error_t err = srs_success;
+    
+    if (secret.empty()) {
+        return srs_error_new(ERROR_RELAY_AUTH, "no relay_server.secret");
+    }
+    
+    if ((err = srs_udp_connect(host, port, tm, &stfd)) != srs_success) {
+        return srs_error_wrap(err, "connect %s:%d", host.c_str(), port);
+    }
+    
+    // The connection id must be unpredictable and unique among edges, so never use the seeded rand.
+    while (!conn_id) {
+        if (RAND_bytes((unsigned char*)&conn_id, sizeof(conn_id)) != 1) {
+            return srs_error_new(ERROR_RELAY_AUTH, "random connection id");
+        }
+    }
+    
+    // Retransmit the connect, until the accept, or the data when the accept is lost.
+    bool accepted = false;
+    srs_utime_t starttime = srs_update_monotonic_time();
+    while (!accepted) {
+        srs_utime_t now = srs_update_monotonic_time();
+        if (now - starttime > tm) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "connect %s:%d timeout %dms", host.c_str(), port, srsu2msi(tm));
+        }
+        
+        send_connect();
+        
+        srs_utime_t deadline = now + SRS_RELAY_CONNECT_INTERVAL;
+        while (!accepted && (now = srs_update_monotonic_time()) < deadline) {
+            char buf[SRS_RELAY_MAX_PACKET + SRS_RELAY_MAC_SIZE];
+            int nn = srs_recvfrom(stfd, buf, sizeof(buf), NULL, NULL, deadline - now);
+            if (nn <= 0) {
+                // Wait for the origin to be available, for example, the port is unreachable.
+                if (nn == 0 || errno != ETIME) {
+                    srs_usleep(deadline - now);
+                }
+                break;
+            }
+            
+            if ((err = on_packet(buf, nn, now, &accepted)) != srs_success) {
+                return srs_error_wrap(err, "connect %s:%d", host.c_str(), port);
+            }
+        }
+    }
+    
+    recv_at = ping_at = migrate_at = srs_update_monotonic_time();
+    srs_trace("relay: connected to %s:%d, session=%u, url=%s", host.c_str(), port, conn_id, url.c_str());
+    
+    return err;
+}
+
+srs_error_t SrsRelayClient::recv_message(SrsCommonMessage** pmsg)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        srs_utime_t now = srs_update_monotonic_time();
+        
+        if (receiver->should_ack(now)) {
+            SrsRelayPacket ack;
+            ack.conn_id = conn_id;
+            receiver->ack(&ack);
+            send_packet(&ack);
+            ping_at = now;
+        }
+        
+        if ((err = receiver->fetch(pmsg)) != srs_success) {
+            return srs_error_wrap(err, "fetch message");
+        }
+        if (*pmsg) {
+            return err;
+        }
+        
+        if (now - recv_at > timeout) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "no packet for %dms", srsu2msi(timeout));
+        }
+        
+        // Maybe the NAT of edge is rebinding, or the network of edge changed, probe by a new socket.
+        if (now - recv_at > SRS_RELAY_MIGRATE_TIMEOUT && now - migrate_at > SRS_RELAY_MIGRATE_TIMEOUT) {
+            if ((err = migrate()) != srs_success) {
+                return srs_error_wrap(err, "migrate");
+            }
+        } else if (now - ping_at > SRS_RELAY_PING_INTERVAL) {
+            SrsRelayPacket ping;
+            ping.conn_id = conn_id;
+            send_packet(&ping);
+            ping_at = now;
+        }
+        
+        // Wait for packets, or the deadline of ACK.
+        srs_utime_t wait = SRS_RELAY_CONNECT_INTERVAL;
+        if (receiver->ack_deadline() > 0) {
+            wait = srs_max(receiver->ack_deadline() - now, SRS_UTIME_MILLISECONDS);
+        }
+        
+        char buf[SRS_RELAY_MAX_PACKET + SRS_RELAY_MAC_SIZE];
+        int nn = srs_recvfrom(stfd, buf, sizeof(buf), NULL, NULL, wait);
+        if (nn <= 0) {
+            if (nn == 0 || errno != ETIME) {
+                srs_usleep(SRS_RELAY_TIMER_INTERVAL);
+            }
+            continue;
+        }
+        
+        // Already accepted, ignore the retry of connect.
+        bool accepted = true;
+        if ((err = on_packet(buf, nn, srs_update_monotonic_time(), &accepted)) != srs_success) {
+            return srs_error_wrap(err, "on packet");
+        }
+    }
+    
+    return err;
+}
+
+void SrsRelayClient::close()
+{
+    if (!stfd) {
+        return;
+    }
+    
+    if (conn_id) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketClose;
+        pkt.conn_id = conn_id;
+        send_packet(&pkt);
+    }
+    
+    srs_close_stfd(stfd);
+}
+
+void SrsRelayClient::set_recv_timeout(srs_utime_t tm)
+{
+    timeout = tm;
+}
+
+void SrsRelayClient::kbps_sample(const char* label, int64_t age)
+{
+    srs_trace("<- %s time=%" PRId64 ", packets=%" PRId64 ", duplicated=%" PRId64 ", skipped=%" PRId64 ", migrations=%d",
+        label, age, receiver->nn_packets, receiver->nn_duplicated, receiver->nn_skipped, nn_migrations);
+}
+
+srs_error_t SrsRelayClient::migrate()
+{
+    srs_error_t err = srs_success;
+    
+    srs_close_stfd(stfd);
+    if ((err = srs_udp_connect(host, port, timeout, &stfd)) != srs_success) {
+        return srs_error_wrap(err, "connect %s:%d", host.c_str(), port);
+    }
+    
+    srs_utime_t now = srs_update_monotonic_time();
+    migrate_at = ping_at = now;
+    nn_migrations++;
+    srs_warn("relay: session %u migrate, no packet for %dms, migrations=%d", conn_id, srsu2msi(now - recv_at), nn_migrations);
+    
+    SrsRelayPacket ping;
+    ping.conn_id = conn_id;
+    send_packet(&ping);
+    
+    return err;
+}
+
+srs_error_t SrsRelayClient::on_packet(char* data, int size, srs_utime_t now, bool* accepted)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_relay_verify(secret, data, size)) != srs_success) {
+        srs_warn("relay: drop packet, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return srs_success;
+    }
+    
+    SrsRelayPacket pkt;
+    if ((err = pkt.decode(data, size)) != srs_success) {
+        srs_warn("relay: ignore packet, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return srs_success;
+    }
+    
+    if (pkt.conn_id != conn_id) {
+        return err;
+    }
+    recv_at = now;
+    
+    // Connect again with the cookie, which proves the address of edge.
+    if (pkt.type == SrsRelayPacketRetry) {
+        if (!*accepted) {
+            cookie = pkt.token;
+            send_connect();
+        }
+        return err;
+    }
+    
+    // Echo the challenge, for the origin to migrate the session to the new socket.
+    if (pkt.type == SrsRelayPacketChallenge) {
+        SrsRelayPacket response;
+        response.type = SrsRelayPacketResponse;
+        response.conn_id = conn_id;
+        response.token = pkt.token;
+        send_packet(&response);
+        return err;
+    }
+    
+    if (pkt.type == SrsRelayPacketAccept) {
+        if (pkt.code != ERROR_SUCCESS) {
+            return srs_error_new(ERROR_RELAY_REJECTED, "rejected by origin, code=%d", pkt.code);
+        }
+        *accepted = true;
+    } else if (pkt.type == SrsRelayPacketData) {
+        *accepted = true;
+        if ((err = receiver->on_data(&pkt, now)) != srs_success) {
+            return srs_error_wrap(err, "on data");
+        }
+    } else if (pkt.type == SrsRelayPacketClose) {
+        return srs_error_new(ERROR_RELAY_CLOSED, "closed by origin, code=%d", pkt.code);
+    }
+    
+    return err;
+}
+
+void SrsRelayClient::send_connect()
+{
+    SrsRelayPacket pkt;
+    pkt.type = SrsRelayPacketConnect;
+    pkt.conn_id = conn_id;
+    pkt.url = url;
+    pkt.token = cookie;
+    send_packet(&pkt);
+}
+
+void SrsRelayClient::send_packet(SrsRelayPacket* pkt)
+{
+    char buf[SRS_RELAY_MAX_PACKET + SRS_RELAY_MAC_SIZE];
+    SrsBuffer stream(buf, SRS_RELAY_MAX_PACKET);
+    
+    srs_error_t err = pkt->encode(&stream);
+    
+    int size = stream.pos();
+    if (err == srs_success) {
+        err = srs_relay_sign(secret, buf, size);
+    }
+    
+    if (err != srs_success) {
+        srs_warn("relay: ignore encode, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return;
+    }
+    
+    // Ignore the error, for example, the port of origin is unreachable, the packet is retransmitted.
+    srs_sendto(stfd, buf, size, NULL, 0, SRS_UTIME_NO_TIMEOUT);
+}
+
@@ -0,0 +1,195 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_RELAY_HPP
+#define SRS_APP_RELAY_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <sys/socket.h>
+
+#include <srs_app_st.hpp>
+#include <srs_app_listener.hpp>
+#include <srs_service_conn.hpp>
+#include <srs_relay_stack.hpp>
+
+class SrsRequest;
+class SrsRelayServer;
+class SrsRelaySender;
+class SrsRelayReceiver;
+class SrsCommonMessage;
+class SrsUdpListener;
+class SrsCoroutineManager;
+class ISrsSourceHandler;
+
+// The interval of timer of session, to send messages and probe the lost frames.
+#define SRS_RELAY_TIMER_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+// The timeout for session without any packet from edge.
+#define SRS_RELAY_SESSION_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The interval of ping when there is nothing to send.
+#define SRS_RELAY_PING_INTERVAL (1 * SRS_UTIME_SECONDS)
+// The interval to retransmit the connect, before origin accepts it.
+#define SRS_RELAY_CONNECT_INTERVAL (200 * SRS_UTIME_MILLISECONDS)
+// The edge migrates to a new socket, when nothing received for it, which survives the NAT rebinding.
+#define SRS_RELAY_MIGRATE_TIMEOUT (2 * SRS_UTIME_SECONDS)
+// The cookie of connect is valid in the current and previous period.
+#define SRS_RELAY_COOKIE_PERIOD (10 * SRS_UTIME_SECONDS)
+
+// The session of edge in origin, which plays the stream by consumer and sends the messages by relay sender.
+class SrsRelaySession : virtual public ISrsConnection, virtual public ISrsCoroutineHandler
+{
+    friend class SrsRelayServer;
+private:
+    SrsRelayServer* server;
+    ISrsSourceHandler* handler;
+    SrsCoroutine* trd;
+    SrsRequest* req;
+    uint32_t conn_id;
+    std::string ip;
+    // The address of edge, updated when edge migrates and the new path is validated.
+    sockaddr_storage peer;
+    int peer_len;
+    // The new address of edge to validate, by the challenge echoed from it.
+    sockaddr_storage candidate;
+    int candidate_len;
+    std::string challenge;
+    srs_utime_t challenge_at;
+    srs_utime_t alive_time;
+    SrsRelaySender* sender;
+    int nn_migrations;
+    // Whether the on_play hooks are notified, to notify the on_stop hooks.
+    bool played;
+public:
+    SrsRelaySession(SrsRelayServer* s, ISrsSourceHandler* h, uint32_t cid, const sockaddr* from, int fromlen);
+    virtual ~SrsRelaySession();
+public:
+    // Parse the url of stream to play, and check the security of edge.
+    virtual srs_error_t initialize(std::string url);
+    virtual srs_error_t start();
+    // Interface ISrsConnection.
+public:
+    virtual std::string remote_ip();
+public:
+    // When got packet from edge, which is dispatched by server.
+    // @return Whether the packet is from the validated address, or the challenge is sent to the new one.
+    virtual bool on_packet(const sockaddr* from, int fromlen);
+    // When the new address of edge echoes the challenge, migrate to it.
+    virtual void on_response(const sockaddr* from, int fromlen, std::string token);
+    virtual srs_error_t on_ack(SrsRelayPacket* ack);
+    virtual void on_close(int code);
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t send_packets(std::vector<std::string>& pkts);
+    virtual srs_error_t http_hooks_on_play();
+    virtual void http_hooks_on_stop();
+};
+
+// The relay server over UDP of origin, which serves the edges pull by protocol udp, @see relay_server.
+// The packets are dispatched to sessions by the connection id, not the address of edge.
+// @remark The packets without the MAC of secret are dropped, and the connect requires the cookie.
+class SrsRelayServer : virtual public ISrsUdpHandler, virtual public IConnectionManager
+{
+private:
+    ISrsSourceHandler* handler;
+    // The shared secret with edges, @see relay_server.secret
+    std::string secret;
+    SrsUdpListener* listener;
+    SrsCoroutineManager* manager;
+    std::map<uint32_t, SrsRelaySession*> sessions;
+public:
+    SrsRelayServer(ISrsSourceHandler* h);
+    virtual ~SrsRelayServer();
+public:
+    virtual srs_error_t listen(std::string ip, int port);
+// Interface ISrsUdpHandler.
+public:
+    virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
+// Interface IConnectionManager.
+public:
+    virtual void remove(ISrsConnection* c);
+public:
+    // Sign and send the encoded packet.
+    virtual srs_error_t sendto(const sockaddr* to, int tolen, const char* data, int size);
+    // Send the packet without frames, ignore any error for it's retransmitted by peer.
+    virtual void reply(const sockaddr* to, int tolen, uint32_t conn_id, SrsRelayPacketType type, int code);
+    virtual void send_packet(const sockaddr* to, int tolen, SrsRelayPacket* pkt);
+private:
+    // The cookie of edge address and connection id, in the period of time.
+    virtual std::string cookie(const sockaddr* from, int fromlen, uint32_t conn_id, int64_t period);
+    virtual bool verify_cookie(const sockaddr* from, int fromlen, uint32_t conn_id, std::string token);
+};
+
+// The relay client over UDP of edge, to pull the stream from the relay server of origin.
+class SrsRelayClient
+{
+private:
+    std::string host;
+    int port;
+    std::string url;
+    srs_netfd_t stfd;
+    uint32_t conn_id;
+    // The shared secret with origin, and the cookie from origin for connect.
+    std::string secret;
+    std::string cookie;
+    SrsRelayReceiver* receiver;
+    srs_utime_t timeout;
+    // When the last packet is received, and the last packet without frames is sent.
+    srs_utime_t recv_at;
+    srs_utime_t ping_at;
+    srs_utime_t migrate_at;
+    int nn_migrations;
+public:
+    // @param u The RTMP url of stream to play, @see srs_generate_rtmp_url
+    SrsRelayClient(std::string h, int p, std::string u);
+    virtual ~SrsRelayClient();
+public:
+    // Connect to origin, and wait for the connect to be accepted.
+    virtual srs_error_t connect(srs_utime_t tm);
+    virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual void close();
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void kbps_sample(const char* label, int64_t age);
+private:
+    // Open a new socket to origin, the origin updates the address of session by the ping.
+    virtual srs_error_t migrate();
+    virtual srs_error_t on_packet(char* data, int size, srs_utime_t now, bool* accepted);
+    virtual void send_connect();
+    virtual void send_packet(SrsRelayPacket* pkt);
+};
+
+// The truncated HMAC-SHA256 of data by the shared secret, which is SRS_RELAY_MAC_SIZE bytes.
+extern std::string srs_relay_mac(const std::string& secret, const char* data, int size);
+// Append the MAC to the packet, the buf must have SRS_RELAY_MAC_SIZE bytes after the packet.
+extern srs_error_t srs_relay_sign(const std::string& secret, char* buf, int& size);
+// Verify and strip the MAC of packet.
+extern srs_error_t srs_relay_verify(const std::string& secret, char* buf, int& size);
+
+#endif
+
@@ -0,0 +1,1109 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_rtc.hpp>
+
+#include <netdb.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+using namespace std;
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+#include <openssl/ec.h>
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_rtc_stack.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_service_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_thread.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_pithy_print.hpp>
+
+// Get the description of last error of OpenSSL.
+static string srs_rtc_ssl_error()
+{
+    unsigned long code = ERR_peek_last_error();
+    if (!code) {
+        return "";
+    }
+    
+    char buf[256];
+    ERR_error_string_n(code, buf, sizeof(buf));
+    return buf;
+}
+
+// Generate the random string of ICE credentials, @see https://tools.ietf.org/html/rfc5245#section-15.4
+static string srs_rtc_random_str(int len)
+{
+    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    
+    vector<uint8_t> bytes(len);
+    if (RAND_bytes(&bytes[0], len) != 1) {
+        srs_random_generate((char*)&bytes[0], len);
+    }
+    
+    string str;
+    for (int i = 0; i < len; i++) {
+        str.push_back(chars[bytes[i] % 62]);
+    }
+    return str;
+}
+
+// Get the id of peer address, for example, 192.168.1.10:50000
+static string srs_rtc_peer_id(const sockaddr* from, int fromlen)
+{
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    if (getnameinfo(from, fromlen, host, sizeof(host), serv, sizeof(serv), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        return "";
+    }
+    return string(host) + ":" + serv;
+}
+
+// The certificate of player is self-signed, which is verified by the fingerprint in SDP.
+static int srs_rtc_verify_callback(int /*preverify_ok*/, X509_STORE_CTX* /*ctx*/)
+{
+    return 1;
+}
+
+// Get the sha-256 fingerprint of certificate, for example, AB:CD:...:EF
+static string srs_rtc_fingerprint(X509* cert)
+{
+    uint8_t md[EVP_MAX_MD_SIZE];
+    unsigned int nb_md = 0;
+    if (X509_digest(cert, EVP_sha256(), md, &nb_md) != 1) {
+        return "";
+    }
+    
+    string fingerprint;
+    for (unsigned int i = 0; i < nb_md; i++) {
+        char hex[4];
+        snprintf(hex, sizeof(hex), (i == 0)? "%02X" : ":%02X", md[i]);
+        fingerprint += hex;
+    }
+    return fingerprint;
+}
+
+SrsRtcCertificate::SrsRtcCertificate()
+{
+    ctx = NULL;
+}
+
+SrsRtcCertificate::~SrsRtcCertificate()
+{
+    if (ctx) {
+        SSL_CTX_free(ctx);
+    }
+}
+
+srs_error_t SrsRtcCertificate::initialize()
+{
+    srs_error_t err = srs_success;
+    
+    // The ECDSA P-256 key, which is much faster than RSA to generate and handshake.
+    EVP_PKEY* pkey = NULL;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    pkey = EVP_EC_gen("prime256v1");
+#else
+    EC_KEY* eckey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    if (eckey && EC_KEY_generate_key(eckey) == 1) {
+        EC_KEY_set_asn1_flag(eckey, OPENSSL_EC_NAMED_CURVE);
+        pkey = EVP_PKEY_new();
+        if (pkey && EVP_PKEY_assign_EC_KEY(pkey, eckey) == 1) {
+            eckey = NULL;
+        }
+    }
+    if (eckey) {
+        EC_KEY_free(eckey);
+    }
+#endif
+    if (!pkey) {
+        return srs_error_new(ERROR_RTC_DTLS, "generate key, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    X509* x509 = X509_new();
+    if (true) {
+        uint32_t serial = 0;
+        srs_random_generate((char*)&serial, sizeof(serial));
+        
+        X509_set_version(x509, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(x509), serial & 0x7fffffff);
+        X509_gmtime_adj(X509_getm_notBefore(x509), -24 * 3600);
+        X509_gmtime_adj(X509_getm_notAfter(x509), 365 * 24 * 3600);
+        X509_set_pubkey(x509, pkey);
+        
+        X509_NAME* name = X509_get_subject_name(x509);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const uint8_t*)RTMP_SIG_SRS_KEY, -1, -1, 0);
+        X509_set_issuer_name(x509, name);
+    }
+    
+    if (!X509_sign(x509, pkey, EVP_sha256())) {
+        err = srs_error_new(ERROR_RTC_DTLS, "sign certificate, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    if (err == srs_success && (ctx = SSL_CTX_new(DTLS_server_method())) == NULL) {
+        err = srs_error_new(ERROR_RTC_DTLS, "create context, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    if (err == srs_success && (SSL_CTX_use_certificate(ctx, x509) != 1 || SSL_CTX_use_PrivateKey(ctx, pkey) != 1)) {
+        err = srs_error_new(ERROR_RTC_DTLS, "use certificate, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    // The profile of SRTP, @see https://tools.ietf.org/html/rfc5764#section-4.1.2
+    // @remark It returns 0 on success.
+    if (err == srs_success && SSL_CTX_set_tlsext_use_srtp(ctx, "SRTP_AES128_CM_SHA1_80") != 0) {
+        err = srs_error_new(ERROR_RTC_DTLS, "use srtp, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    if (err == srs_success) {
+        // Request the certificate of player, to verify by the fingerprint in SDP.
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, srs_rtc_verify_callback);
+        SSL_CTX_set_read_ahead(ctx, 1);
+        fingerprint = srs_rtc_fingerprint(x509);
+    }
+    
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    
+    return err;
+}
+
+SSL_CTX* SrsRtcCertificate::context()
+{
+    return ctx;
+}
+
+string SrsRtcCertificate::get_fingerprint()
+{
+    return fingerprint;
+}
+
+// The BIO to collect the DTLS packets to send, @see SrsRtcDtls
+static BIO_METHOD* _srs_rtc_bio_method = NULL;
+
+static int srs_rtc_bio_create(BIO* bio)
+{
+    BIO_set_init(bio, 1);
+    return 1;
+}
+
+SrsRtcDtls::SrsRtcDtls()
+{
+    ssl = NULL;
+    bio_in = NULL;
+    bio_out = NULL;
+    done = false;
+}
+
+SrsRtcDtls::~SrsRtcDtls()
+{
+    // The BIOs are freed by SSL.
+    if (ssl) {
+        SSL_free(ssl);
+    }
+}
+
+srs_error_t SrsRtcDtls::initialize(SrsRtcCertificate* cert, string fingerprint)
+{
+    srs_error_t err = srs_success;
+    
+    peer_fingerprint = fingerprint;
+    
+    if (!_srs_rtc_bio_method) {
+        _srs_rtc_bio_method = BIO_meth_new(BIO_TYPE_SOURCE_SINK, "srs-dtls");
+        BIO_meth_set_create(_srs_rtc_bio_method, srs_rtc_bio_create);
+        BIO_meth_set_write(_srs_rtc_bio_method, on_bio_write);
+        BIO_meth_set_ctrl(_srs_rtc_bio_method, on_bio_ctrl);
+    }
+    
+    if ((ssl = SSL_new(cert->context())) == NULL) {
+        return srs_error_new(ERROR_RTC_DTLS, "create ssl, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    if ((bio_in = BIO_new(BIO_s_mem())) == NULL) {
+        return srs_error_new(ERROR_RTC_DTLS, "create bio");
+    }
+    if ((bio_out = BIO_new(_srs_rtc_bio_method)) == NULL) {
+        BIO_free(bio_in);
+        return srs_error_new(ERROR_RTC_DTLS, "create bio");
+    }
+    BIO_set_data(bio_out, this);
+    SSL_set_bio(ssl, bio_in, bio_out);
+    
+    // The flight is fragmented to packets by the MTU, rather than to query it.
+    SSL_set_options(ssl, SSL_OP_NO_QUERY_MTU);
+    SSL_set_mtu(ssl, SRS_RTP_MAX_PAYLOAD);
+    SSL_set_accept_state(ssl);
+    
+    return err;
+}
+
+srs_error_t SrsRtcDtls::on_dtls(const char* data, int size, bool& handshake_done)
+{
+    srs_error_t err = srs_success;
+    
+    handshake_done = false;
+    
+    if (BIO_write(bio_in, data, size) <= 0) {
+        return srs_error_new(ERROR_RTC_DTLS, "write bio");
+    }
+    
+    if (!done) {
+        ERR_clear_error();
+        int r0 = SSL_do_handshake(ssl);
+        int r1 = SSL_get_error(ssl, r0);
+        
+        if (r0 != 1) {
+            if (r1 != SSL_ERROR_WANT_READ && r1 != SSL_ERROR_WANT_WRITE) {
+                return srs_error_new(ERROR_RTC_DTLS, "handshake r0=%d, r1=%d, %s", r0, r1, srs_rtc_ssl_error().c_str());
+            }
+            return err;
+        }
+        
+        if ((err = on_handshake_done()) != srs_success) {
+            return srs_error_wrap(err, "handshake done");
+        }
+        
+        done = handshake_done = true;
+        return err;
+    }
+    
+    // Drain the packets after handshake, for example, the retransmitted flight or alert of player,
+    // and the SSL retransmits the last flight if required.
+    char buf[SRS_RTP_MAX_PACKET];
+    int r0 = SSL_read(ssl, buf, sizeof(buf));
+    int r1 = SSL_get_error(ssl, r0);
+    if (r0 <= 0 && r1 == SSL_ERROR_ZERO_RETURN) {
+        return srs_error_new(ERROR_RTC_DTLS, "closed by peer");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtcDtls::on_timer()
+{
+    if (!done && DTLSv1_handle_timeout(ssl) < 0) {
+        return srs_error_new(ERROR_RTC_DTLS, "handle timeout, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    return srs_success;
+}
+
+void SrsRtcDtls::fetch(vector<string>& pkts)
+{
+    pkts.swap(packets);
+    packets.clear();
+}
+
+bool SrsRtcDtls::is_done()
+{
+    return done;
+}
+
+srs_error_t SrsRtcDtls::on_handshake_done()
+{
+    srs_error_t err = srs_success;
+    
+    SRTP_PROTECTION_PROFILE* profile = SSL_get_selected_srtp_profile(ssl);
+    if (!profile || profile->id != SRTP_AES128_CM_SHA1_80) {
+        return srs_error_new(ERROR_RTC_DTLS, "no srtp profile");
+    }
+    
+    // Verify the certificate of player, by the fingerprint in SDP offer.
+    X509* cert = SSL_get_peer_certificate(ssl);
+    if (!cert) {
+        return srs_error_new(ERROR_RTC_DTLS, "no peer certificate");
+    }
+    string fingerprint = srs_rtc_fingerprint(cert);
+    X509_free(cert);
+    
+    if (strcasecmp(fingerprint.c_str(), peer_fingerprint.c_str()) != 0) {
+        return srs_error_new(ERROR_RTC_DTLS, "fingerprint mismatch, %s", fingerprint.c_str());
+    }
+    
+    // The keying material is client key, server key, client salt and server salt,
+    // @see https://tools.ietf.org/html/rfc5764#section-4.2
+    const int nn = (SRS_SRTP_MASTER_KEY + SRS_SRTP_MASTER_SALT) * 2;
+    uint8_t material[nn];
+    static const char* label = "EXTRACTOR-dtls_srtp";
+    if (SSL_export_keying_material(ssl, material, nn, label, strlen(label), NULL, 0, 0) != 1) {
+        return srs_error_new(ERROR_RTC_DTLS, "export keying material, %s", srs_rtc_ssl_error().c_str());
+    }
+    
+    char* p = (char*)material;
+    client_key = string(p, SRS_SRTP_MASTER_KEY) + string(p + SRS_SRTP_MASTER_KEY * 2, SRS_SRTP_MASTER_SALT);
+    server_key = string(p + SRS_SRTP_MASTER_KEY, SRS_SRTP_MASTER_KEY)
+        + string(p + SRS_SRTP_MASTER_KEY * 2 + SRS_SRTP_MASTER_SALT, SRS_SRTP_MASTER_SALT);
+    
+    return err;
+}
+
+int SrsRtcDtls::on_bio_write(BIO* bio, const char* data, int size)
+{
+    SrsRtcDtls* dtls = (SrsRtcDtls*)BIO_get_data(bio);
+    dtls->packets.push_back(string(data, size));
+    return size;
+}
+
+long SrsRtcDtls::on_bio_ctrl(BIO* /*bio*/, int cmd, long /*num*/, void* /*ptr*/)
+{
+    switch (cmd) {
+        case BIO_CTRL_FLUSH:
+            return 1;
+        case BIO_CTRL_DGRAM_QUERY_MTU:
+        case BIO_CTRL_DGRAM_GET_FALLBACK_MTU:
+            return SRS_RTP_MAX_PAYLOAD;
+        default:
+            return 0;
+    }
+}
+
+SrsRtpSharedStream::SrsRtpSharedStream(SrsSource* s, SrsRequest* r) : SrsLiveSharedStream("rtc-shared", s, r)
+{
+    format = NULL;
+    packetizer = NULL;
+    
+    // Each chunk is a RTP packet, so keep more chunks for the GOP.
+    max_chunks = SRS_RTP_SHARED_MAX_CHUNKS;
+}
+
+SrsRtpSharedStream::~SrsRtpSharedStream()
+{
+    srs_freep(format);
+    srs_freep(packetizer);
+}
+
+// The pool of shared RTP streams, key is the source.
+static std::map<SrsSource*, SrsRtpSharedStream*> _srs_rtp_shared_streams;
+
+SrsRtpSharedStream* SrsRtpSharedStream::fetch_or_create(SrsSource* s, SrsRequest* r)
+{
+    std::map<SrsSource*, SrsRtpSharedStream*>::iterator it = _srs_rtp_shared_streams.find(s);
+    if (it != _srs_rtp_shared_streams.end()) {
+        return it->second;
+    }
+    
+    SrsRtpSharedStream* rss = new SrsRtpSharedStream(s, r);
+    _srs_rtp_shared_streams[s] = rss;
+    return rss;
+}
+
+srs_error_t SrsRtpSharedStream::reset()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(format);
+    format = new SrsFormat();
+    if ((err = format->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init format");
+    }
+    
+    srs_freep(packetizer);
+    packetizer = new SrsRtpH264Packetizer(SRS_RTC_SHARED_PT, SRS_RTC_SHARED_SSRC);
+    
+    return err;
+}
+
+srs_error_t SrsRtpSharedStream::mux(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (!msg->is_video()) {
+        return err;
+    }
+    
+    if ((err = format->on_video(msg->timestamp, msg->payload, msg->size)) != srs_success) {
+        return srs_error_wrap(err, "format video");
+    }
+    
+    // Ignore the sequence header, and the codecs except H.264.
+    SrsVideoFrame* frame = format->video;
+    if (!frame || !format->vcodec || format->vcodec->id != SrsVideoCodecIdAVC || format->is_avc_sequence_header()) {
+        return err;
+    }
+    if (frame->nb_samples <= 0) {
+        return err;
+    }
+    
+    uint32_t timestamp = (uint32_t)((msg->timestamp + frame->cts) * 90);
+    bool is_key = frame->has_idr;
+    
+    packets.clear();
+    if (is_key) {
+        SrsVideoCodecConfig* c = format->vcodec;
+        packetizer->packetize_sps_pps(timestamp, c->sequenceParameterSetNALUnit, c->pictureParameterSetNALUnit, packets);
+    }
+    packetizer->packetize(timestamp, frame->samples, frame->nb_samples, packets);
+    
+    // The sequence of RTP is the sequence of chunk, which continues after the muxer is reset.
+    for (int i = 0; i < (int)packets.size(); i++) {
+        string& packet = packets.at(i);
+        uint16_t sequence = (uint16_t)next_sequence();
+        packet[2] = (char)(sequence >> 8);
+        packet[3] = (char)sequence;
+        
+        if ((err = append(packet, msg->timestamp, is_key && i == 0)) != srs_success) {
+            return srs_error_wrap(err, "append rtp");
+        }
+    }
+    
+    return err;
+}
+
+SrsRtcSession::SrsRtcSession(SrsRtcServer* s, ISrsSourceHandler* h, SrsRequest* r, string cip)
+{
+    server = s;
+    handler = h;
+    req = r->copy();
+    ip = cip;
+    trd = new SrsSTCoroutine("rtc", this);
+    state = SrsRtcSessionWaitStun;
+    create_time = alive_time = srs_get_system_time();
+    
+    memset(&peer, 0, sizeof(peer));
+    peer_len = 0;
+    dtls = new SrsRtcDtls();
+    srtp_send = new SrsSrtp();
+    srtp_recv = new SrsSrtp();
+    
+    payload_type = 0;
+    nack = true;
+    cursor = -1;
+    first = -1;
+    stream = NULL;
+    
+    nn_packets = 0;
+    nn_nacks = 0;
+    nn_retransmits = 0;
+    nn_plis = 0;
+}
+
+SrsRtcSession::~SrsRtcSession()
+{
+    trd->interrupt();
+    srs_freep(trd);
+    
+    srs_freep(dtls);
+    srs_freep(srtp_send);
+    srs_freep(srtp_recv);
+    srs_freep(req);
+}
+
+srs_error_t SrsRtcSession::initialize(SrsRtcCertificate* cert, SrsRtcSdp* offer, SrsRtcSdp* answer, string candidate, int port)
+{
+    srs_error_t err = srs_success;
+    
+    if (offer->ice_ufrag.empty() || offer->ice_pwd.empty()) {
+        return srs_error_new(ERROR_RTC_SDP, "no ice credentials");
+    }
+    if (offer->fingerprint_algo != "sha-256" || offer->fingerprint.empty()) {
+        return srs_error_new(ERROR_RTC_SDP, "invalid fingerprint %s", offer->fingerprint_algo.c_str());
+    }
+    
+    remote_ufrag = offer->ice_ufrag;
+    local_ufrag = srs_rtc_random_str(8);
+    local_pwd = srs_rtc_random_str(32);
+    nack = _srs_config->get_rtc_nack_enabled(req->vhost);
+    
+    if ((err = dtls->initialize(cert, offer->fingerprint)) != srs_success) {
+        return srs_error_wrap(err, "init dtls");
+    }
+    
+    // The server is ICE-lite and the passive DTLS role, @see https://tools.ietf.org/html/rfc8842
+    answer->session_id = srs_int2str(srs_get_system_time());
+    answer->ice_lite = true;
+    answer->ice_ufrag = local_ufrag;
+    answer->ice_pwd = local_pwd;
+    answer->fingerprint_algo = "sha-256";
+    answer->fingerprint = cert->get_fingerprint();
+    answer->setup = "passive";
+    answer->msid_semantic = "WMS " RTMP_SIG_SRS_KEY;
+    answer->candidates.push_back("1 udp 2130706431 " + candidate + " " + srs_int2str(port) + " typ host");
+    
+    // Accept the first video of H.264, and reject the others such as audio.
+    bool accepted = false;
+    for (int i = 0; i < (int)offer->medias.size(); i++) {
+        SrsRtcSdpMedia& media = offer->medias.at(i);
+        
+        SrsRtcSdpMedia m;
+        m.type = media.type;
+        m.protocol = media.protocol;
+        m.mid = media.mid;
+        
+        int pt = (!accepted && media.type == "video" && media.port)? media.find_h264() : -1;
+        if (pt < 0) {
+            if (!media.payload_types.empty()) {
+                m.payload_types.push_back(media.payload_types.at(0));
+            }
+            answer->medias.push_back(m);
+            continue;
+        }
+        
+        accepted = true;
+        payload_type = (uint8_t)pt;
+        
+        m.port = 9;
+        m.direction = "sendonly";
+        m.rtcp_mux = true;
+        m.payload_types.push_back(pt);
+        m.rtpmaps[pt] = media.rtpmaps[pt];
+        m.fmtps[pt] = media.fmtps[pt];
+        if (nack) {
+            m.rtcp_fbs[pt].push_back("nack");
+        }
+        m.rtcp_fbs[pt].push_back("nack pli");
+        m.ssrc = SRS_RTC_SHARED_SSRC;
+        m.cname = RTMP_SIG_SRS_KEY;
+        m.msid = RTMP_SIG_SRS_KEY " video";
+        answer->medias.push_back(m);
+    }
+    
+    if (!accepted) {
+        return srs_error_new(ERROR_RTC_SDP, "no H.264 video");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtcSession::start()
+{
+    return trd->start();
+}
+
+string SrsRtcSession::get_local_ufrag()
+{
+    return local_ufrag;
+}
+
+string SrsRtcSession::get_peer_id()
+{
+    return peer_id;
+}
+
+string SrsRtcSession::remote_ip()
+{
+    return ip;
+}
+
+srs_error_t SrsRtcSession::on_stun(const sockaddr* from, int fromlen, SrsStunPacket* stun)
+{
+    srs_error_t err = srs_success;
+    
+    alive_time = srs_get_system_time();
+    
+    // Response the binding request, with the address of player, @see https://tools.ietf.org/html/rfc8445#section-7.3
+    SrsStunPacket res;
+    res.message_type = SrsStunBindingSuccessResponse;
+    res.transaction_id = stun->transaction_id;
+    if (from->sa_family == AF_INET) {
+        const sockaddr_in* addr = (const sockaddr_in*)from;
+        res.mapped_address = ntohl(addr->sin_addr.s_addr);
+        res.mapped_port = ntohs(addr->sin_port);
+    } else if (from->sa_family == AF_INET6) {
+        const sockaddr_in6* addr = (const sockaddr_in6*)from;
+        if (IN6_IS_ADDR_V4MAPPED(&addr->sin6_addr)) {
+            const uint8_t* p = addr->sin6_addr.s6_addr + 12;
+            res.mapped_address = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        }
+        res.mapped_port = ntohs(addr->sin6_port);
+    }
+    
+    char buf[SRS_RTP_MAX_PACKET];
+    SrsBuffer stream(buf, sizeof(buf));
+    if ((err = res.encode(local_pwd, &stream)) != srs_success) {
+        return srs_error_wrap(err, "encode stun");
+    }
+    
+    if ((err = server->sendto(from, fromlen, buf, stream.pos())) != srs_success) {
+        return srs_error_wrap(err, "send stun");
+    }
+    
+    // Send to the first address of player, then the nominated one, by USE-CANDIDATE of the controlling agent.
+    if (state == SrsRtcSessionWaitStun || stun->use_candidate) {
+        string id = srs_rtc_peer_id(from, fromlen);
+        if (id != peer_id) {
+            memcpy(&peer, from, fromlen);
+            peer_len = fromlen;
+            peer_id = id;
+            srs_trace("rtc: session %s select peer %s, nominated=%d", local_ufrag.c_str(), peer_id.c_str(), stun->use_candidate);
+        }
+    }
+    server->on_peer(this, srs_rtc_peer_id(from, fromlen));
+    
+    if (state == SrsRtcSessionWaitStun) {
+        state = SrsRtcSessionDtls;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtcSession::on_dtls(const char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    alive_time = srs_get_system_time();
+    
+    bool done = false;
+    err = dtls->on_dtls(data, size, done);
+    
+    // Send the flight, even when failed, for it might be the alert.
+    flush_dtls();
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "dtls");
+    }
+    
+    if (!done) {
+        return err;
+    }
+    
+    if ((err = srtp_send->initialize(dtls->server_key.data(), dtls->server_key.data() + SRS_SRTP_MASTER_KEY)) != srs_success) {
+        return srs_error_wrap(err, "init srtp send");
+    }
+    if ((err = srtp_recv->initialize(dtls->client_key.data(), dtls->client_key.data() + SRS_SRTP_MASTER_KEY)) != srs_success) {
+        return srs_error_wrap(err, "init srtp recv");
+    }
+    
+    state = SrsRtcSessionPlaying;
+    srs_trace("rtc: session %s dtls done, peer=%s, cost=%dms", local_ufrag.c_str(), peer_id.c_str(),
+        srsu2msi(srs_get_system_time() - create_time));
+    
+    return err;
+}
+
+srs_error_t SrsRtcSession::on_rtcp(char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srtp_recv->unprotect_rtcp(data, &size)) != srs_success) {
+        return srs_error_wrap(err, "unprotect rtcp");
+    }
+    
+    alive_time = srs_get_system_time();
+    
+    SrsRtcpFeedback feedback;
+    if ((err = feedback.decode(data, size)) != srs_success) {
+        return srs_error_wrap(err, "decode rtcp");
+    }
+    
+    // The keyframe is requested to the publisher, so the player recovers at the next GOP.
+    if (feedback.keyframe) {
+        nn_plis++;
+    }
+    
+    if (!nack || cursor < 0 || feedback.nacks.empty()) {
+        return err;
+    }
+    
+    // Retransmit the lost packets, which are still in the shared stream.
+    int64_t last = cursor - 1;
+    for (int i = 0; i < (int)feedback.nacks.size(); i++) {
+        int64_t sequence = last - (uint16_t)((uint16_t)last - feedback.nacks.at(i));
+        nn_nacks++;
+        
+        if (sequence < first) {
+            continue;
+        }
+        
+        SrsSharedPtrMessage* msg = stream->at(sequence);
+        if (!msg) {
+            continue;
+        }
+        
+        err = send_rtp(sequence, msg);
+        srs_freep(msg);
+        if (err != srs_success) {
+            return srs_error_wrap(err, "retransmit %" PRId64, sequence);
+        }
+        nn_retransmits++;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtcSession::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Free the session by manager.
+    server->remove(this);
+    
+    if (srs_is_client_gracefully_close(err) || srs_error_code(err) == ERROR_RTC_SESSION_TIMEOUT) {
+        srs_warn("rtc client %s disconnect, %s", ip.c_str(), srs_error_desc(err).c_str());
+    } else if (err != srs_success) {
+        srs_error("rtc serve client %s, %s", ip.c_str(), srs_error_desc(err).c_str());
+    }
+    srs_freep(err);
+    
+    return srs_success;
+}
+
+srs_error_t SrsRtcSession::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    srs_trace("rtc client ip=%s, session=%s, %s, pt=%d, nack=%d", ip.c_str(), local_ufrag.c_str(),
+        req->get_stream_url().c_str(), payload_type, nack);
+    
+    // Wait for the ICE and DTLS, which are driven by the packets of player.
+    while (state != SrsRtcSessionPlaying) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "rtc session");
+        }
+        
+        if (srs_get_system_time() - create_time > SRS_RTC_HANDSHAKE_TIMEOUT) {
+            return srs_error_new(ERROR_RTC_SESSION_TIMEOUT, "handshake timeout, state=%d", state);
+        }
+        
+        // Retransmit the flight of DTLS, when the player never responses.
+        if (state == SrsRtcSessionDtls) {
+            if ((err = dtls->on_timer()) != srs_success) {
+                return srs_error_wrap(err, "dtls timer");
+            }
+            flush_dtls();
+        }
+        
+        srs_usleep(SRS_RTC_SEND_INTERVAL);
+    }
+    
+    return playing();
+}
+
+srs_error_t SrsRtcSession::playing()
+{
+    srs_error_t err = srs_success;
+    
+    SrsSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, handler, &source)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+    
+    // All WebRTC players send the RTP packets shared by the packetizer of source.
+    stream = SrsRtpSharedStream::fetch_or_create(source, req);
+    SrsLiveSharedPlayer player;
+    if ((err = player.attach(stream)) != srs_success) {
+        return srs_error_wrap(err, "start rtp shared");
+    }
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(_srs_context->get_id(), req, NULL, SrsRtmpConnPlay)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_caster();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            break;
+        }
+        
+        if (srs_get_system_time() - alive_time > SRS_RTC_SESSION_TIMEOUT) {
+            err = srs_error_new(ERROR_RTC_SESSION_TIMEOUT, "no packet for %dms", srsu2msi(SRS_RTC_SESSION_TIMEOUT));
+            break;
+        }
+        
+        int count = 0;
+        stream->fetch(cursor, msgs.msgs, msgs.max, count);
+        
+        int64_t sequence = cursor - count;
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            if (err == srs_success) {
+                err = send_rtp(sequence + i, msg);
+            }
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            err = srs_error_wrap(err, "send");
+            break;
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> rtc play %s, packets=%" PRId64 ", nacks=%" PRId64 ", retransmits=%" PRId64 ", plis=%" PRId64,
+                req->get_stream_url().c_str(), nn_packets, nn_nacks, nn_retransmits, nn_plis);
+        }
+        
+        if (count < msgs.max) {
+            srs_usleep(SRS_RTC_SEND_INTERVAL);
+        }
+    }
+    
+    stat->on_disconnect(_srs_context->get_id());
+    
+    return err;
+}
+
+void SrsRtcSession::flush_dtls()
+{
+    vector<string> pkts;
+    dtls->fetch(pkts);
+    
+    for (int i = 0; i < (int)pkts.size(); i++) {
+        string& pkt = pkts.at(i);
+        srs_error_t err = send_packet((char*)pkt.data(), (int)pkt.length());
+        srs_freep(err);
+    }
+}
+
+srs_error_t SrsRtcSession::send_rtp(int64_t sequence, SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    char buf[SRS_RTP_MAX_PACKET];
+    if (msg->size < SRS_RTP_HEADER || msg->size + SRS_SRTP_AUTH_TAG > (int)sizeof(buf)) {
+        return err;
+    }
+    memcpy(buf, msg->payload, msg->size);
+    
+    // Use the payload type negotiated with player, keep the marker.
+    buf[1] = (char)((buf[1] & 0x80) | (payload_type & 0x7f));
+    
+    // The player starts from the ROC 0, @see https://tools.ietf.org/html/rfc3711#section-3.3.1
+    if (first < 0) {
+        first = sequence;
+    }
+    uint32_t roc = (uint32_t)((sequence >> 16) - (first >> 16));
+    
+    int size = msg->size;
+    if ((err = srtp_send->protect_rtp(buf, &size, roc)) != srs_success) {
+        return srs_error_wrap(err, "protect rtp");
+    }
+    
+    nn_packets++;
+    
+    return send_packet(buf, size);
+}
+
+srs_error_t SrsRtcSession::send_packet(char* data, int size)
+{
+    if (!peer_len) {
+        return srs_error_new(ERROR_RTC_STUN, "no peer");
+    }
+    return server->sendto((const sockaddr*)&peer, peer_len, data, size);
+}
+
+SrsRtcServer::SrsRtcServer(ISrsSourceHandler* h)
+{
+    handler = h;
+    listener = NULL;
+    manager = new SrsCoroutineManager();
+    cert = new SrsRtcCertificate();
+    port = 0;
+}
+
+SrsRtcServer::~SrsRtcServer()
+{
+    srs_freep(listener);
+    
+    // The session removes itself when freed, so free the swapped sessions.
+    std::vector<SrsRtcSession*> copy;
+    copy.swap(sessions);
+    ufrags.clear();
+    peers.clear();
+    
+    std::vector<SrsRtcSession*>::iterator it;
+    for (it = copy.begin(); it != copy.end(); ++it) {
+        SrsRtcSession* session = *it;
+        srs_freep(session);
+    }
+    
+    srs_freep(manager);
+    srs_freep(cert);
+}
+
+srs_error_t SrsRtcServer::listen(string ip, int p)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = cert->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init certificate");
+    }
+    
+    port = p;
+    candidate = _srs_config->get_rtc_server_candidate();
+    if (candidate == "*") {
+        candidate = srs_get_public_internet_address();
+    }
+    
+    srs_freep(listener);
+    listener = new SrsUdpListener(this, ip, port);
+    // All players send the RTCP and STUN to the port, receive them in batch.
+    listener->set_batch(SRS_PERF_UDP_BATCH);
+    
+    if ((err = listener->listen()) != srs_success) {
+        return srs_error_wrap(err, "listen %s:%d", ip.c_str(), port);
+    }
+    
+    if ((err = manager->start()) != srs_success) {
+        return srs_error_wrap(err, "start manager");
+    }
+    
+    srs_trace("rtc: listen at udp://%s:%d, candidate=%s, fingerprint=%s", ip.c_str(), port, candidate.c_str(),
+        cert->get_fingerprint().c_str());
+    
+    return err;
+}
+
+srs_error_t SrsRtcServer::create_session(SrsRequest* r, string ip, string offer, string& answer, string& sid)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtcSdp sdp_offer;
+    if ((err = sdp_offer.parse(offer)) != srs_success) {
+        return srs_error_wrap(err, "parse offer");
+    }
+    
+    SrsRtcSession* session = new SrsRtcSession(this, handler, r, ip);
+    
+    SrsRtcSdp sdp_answer;
+    if ((err = session->initialize(cert, &sdp_offer, &sdp_answer, candidate, port)) != srs_success) {
+        srs_freep(session);
+        return srs_error_wrap(err, "init session");
+    }
+    
+    sessions.push_back(session);
+    ufrags[session->get_local_ufrag()] = session;
+    
+    if ((err = session->start()) != srs_success) {
+        remove(session);
+        return srs_error_wrap(err, "start session");
+    }
+    
+    answer = sdp_answer.encode();
+    sid = session->get_local_ufrag() + ":" + sdp_offer.ice_ufrag;
+    
+    return err;
+}
+
+srs_error_t SrsRtcServer::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtcSession* session = NULL;
+    
+    // The STUN is dispatched by the ufrag of server, for the address of player is unknown.
+    if (srs_is_stun(buf, nb_buf)) {
+        SrsStunPacket stun;
+        if ((err = stun.decode(buf, nb_buf)) != srs_success) {
+            srs_warn("rtc: ignore stun of %s, %s", srs_rtc_peer_id(from, fromlen).c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            return srs_success;
+        }
+        if (stun.message_type != SrsStunBindingRequest) {
+            return err;
+        }
+        
+        std::map<std::string, SrsRtcSession*>::iterator it = ufrags.find(stun.local_ufrag());
+        if (it == ufrags.end()) {
+            return err;
+        }
+        session = it->second;
+        
+        if (!stun.verify(buf, nb_buf, session->local_pwd)) {
+            srs_warn("rtc: ignore stun of %s, verify failed", srs_rtc_peer_id(from, fromlen).c_str());
+            return err;
+        }
+        
+        err = session->on_stun(from, fromlen, &stun);
+    } else {
+        std::map<std::string, SrsRtcSession*>::iterator it = peers.find(srs_rtc_peer_id(from, fromlen));
+        if (it == peers.end()) {
+            return err;
+        }
+        session = it->second;
+        
+        if (srs_is_dtls(buf, nb_buf)) {
+            err = session->on_dtls(buf, nb_buf);
+        } else if (srs_is_rtp_or_rtcp(buf, nb_buf) && srs_is_rtcp(buf, nb_buf) && session->state == SrsRtcSessionPlaying) {
+            err = session->on_rtcp(buf, nb_buf);
+        }
+    }
+    
+    // Close the session when failed, and never break the listener.
+    if (err != srs_success) {
+        srs_warn("rtc: close session %s, %s", session->local_ufrag.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        session->trd->interrupt();
+    }
+    
+    return srs_success;
+}
+
+void SrsRtcServer::remove(ISrsConnection* c)
+{
+    SrsRtcSession* session = dynamic_cast<SrsRtcSession*>(c);
+    
+    // Ignore the session freed by server, when dispose.
+    std::vector<SrsRtcSession*>::iterator it = std::find(sessions.begin(), sessions.end(), session);
+    if (it == sessions.end()) {
+        return;
+    }
+    sessions.erase(it);
+    
+    ufrags.erase(session->get_local_ufrag());
+    for (std::map<std::string, SrsRtcSession*>::iterator it2 = peers.begin(); it2 != peers.end();) {
+        if (it2->second == session) {
+            peers.erase(it2++);
+        } else {
+            ++it2;
+        }
+    }
+    
+    manager->remove(c);
+}
+
+void SrsRtcServer::on_peer(SrsRtcSession* session, string peer_id)
+{
+    if (!peer_id.empty()) {
+        peers[peer_id] = session;
+    }
+}
+
+srs_error_t SrsRtcServer::sendto(const sockaddr* to, int tolen, char* data, int size)
+{
+    if (srs_sendto(listener->stfd(), data, size, to, tolen, SRS_UTIME_NO_TIMEOUT) <= 0) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "sendto %d bytes", size);
+    }
+    return srs_success;
+}
+
@@ -0,0 +1,268 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_RTC_HPP
+#define SRS_APP_RTC_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <srs_app_st.hpp>
+#include <srs_app_listener.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_service_conn.hpp>
+
+class SrsSource;
+class SrsRequest;
+class SrsFormat;
+class SrsSrtp;
+class SrsStunPacket;
+class SrsRtcSdp;
+class SrsRtpH264Packetizer;
+class SrsRtcServer;
+class SrsUdpListener;
+class SrsCoroutineManager;
+class ISrsSourceHandler;
+
+// The types of OpenSSL, to avoid including the headers.
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+typedef struct bio_st BIO;
+
+// The max number of RTP packets of shared stream, for the GOP of large bitrate.
+#define SRS_RTP_SHARED_MAX_CHUNKS 16384
+// The interval to fetch the RTP packets of shared stream.
+#define SRS_RTC_SEND_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+// The timeout for session without any STUN or RTCP from player, the browser sends STUN each 2.5s.
+#define SRS_RTC_SESSION_TIMEOUT (30 * SRS_UTIME_SECONDS)
+// The timeout for session to complete the ICE and DTLS, after the answer is created.
+#define SRS_RTC_HANDSHAKE_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The payload type and SSRC of shared RTP stream, the payload type is rewritten for each player.
+#define SRS_RTC_SHARED_PT 102
+#define SRS_RTC_SHARED_SSRC 0x53525301
+
+// The self-signed certificate and DTLS context of server, shared by all sessions,
+// whose fingerprint is in the SDP answer, for the player to verify the DTLS peer.
+class SrsRtcCertificate
+{
+private:
+    SSL_CTX* ctx;
+    // The fingerprint of certificate, for example, AB:CD:...:EF
+    std::string fingerprint;
+public:
+    SrsRtcCertificate();
+    virtual ~SrsRtcCertificate();
+public:
+    // Generate the ECDSA P-256 certificate, and create the DTLS context of SRTP.
+    virtual srs_error_t initialize();
+    virtual SSL_CTX* context();
+    // The sha-256 fingerprint of certificate.
+    virtual std::string get_fingerprint();
+};
+
+// The DTLS server of session, to export the keying material of SRTP, @see https://tools.ietf.org/html/rfc5764
+// The DTLS packets are fed by the UDP server, and the packets to send are collected by the BIO of datagram,
+// so each DTLS packet is a UDP packet, which is never fragmented even though the flight is large.
+class SrsRtcDtls
+{
+private:
+    SSL* ssl;
+    BIO* bio_in;
+    BIO* bio_out;
+    // Whether the handshake is done, and the SRTP keys are exported.
+    bool done;
+    // The DTLS packets to send.
+    std::vector<std::string> packets;
+    // The sha-256 fingerprint of player, in the SDP offer.
+    std::string peer_fingerprint;
+public:
+    // The SRTP master key and salt, the server sends by server key and receives by client key.
+    std::string client_key;
+    std::string server_key;
+public:
+    SrsRtcDtls();
+    virtual ~SrsRtcDtls();
+public:
+    virtual srs_error_t initialize(SrsRtcCertificate* cert, std::string fingerprint);
+    // Feed the DTLS packet from player.
+    // @param done Whether the handshake is done by this packet.
+    virtual srs_error_t on_dtls(const char* data, int size, bool& done);
+    // Retransmit the flight when the timer of DTLS is expired.
+    virtual srs_error_t on_timer();
+    // Fetch the DTLS packets to send.
+    virtual void fetch(std::vector<std::string>& pkts);
+    virtual bool is_done();
+private:
+    virtual srs_error_t on_handshake_done();
+    static int on_bio_write(BIO* bio, const char* data, int size);
+    static long on_bio_ctrl(BIO* bio, int cmd, long num, void* ptr);
+};
+
+// The shared RTP stream, to packetize the H.264 of RTMP stream once for all WebRTC players,
+// where each RTP packet is a chunk, and the sequence of chunk is also the RTP sequence,
+// so the lost packet can be retransmitted by the chunk, @see SrsRtcSession::on_rtcp
+// The key chunk is the STAP-A of SPS and PPS before the IDR, for new player to start from.
+// @remark The audio is ignored, for WebRTC requires Opus while RTMP is AAC generally.
+class SrsRtpSharedStream : public SrsLiveSharedStream
+{
+private:
+    SrsFormat* format;
+    SrsRtpH264Packetizer* packetizer;
+    std::vector<std::string> packets;
+public:
+    SrsRtpSharedStream(SrsSource* s, SrsRequest* r);
+    virtual ~SrsRtpSharedStream();
+public:
+    // Fetch the shared RTP stream of source, or create a new one, which lives as long as the source.
+    static SrsRtpSharedStream* fetch_or_create(SrsSource* s, SrsRequest* r);
+protected:
+    virtual srs_error_t reset();
+    virtual srs_error_t mux(SrsSharedPtrMessage* msg);
+};
+
+// The state of WebRTC session.
+enum SrsRtcSessionState
+{
+    // Wait for the STUN binding request of player.
+    SrsRtcSessionWaitStun = 0,
+    // The ICE is connected, wait for the DTLS handshake.
+    SrsRtcSessionDtls,
+    // Sending the RTP packets over SRTP.
+    SrsRtcSessionPlaying,
+};
+
+// The WebRTC session of a player, created by the SDP offer, which plays the shared RTP stream
+// over ICE-lite, DTLS-SRTP and retransmits the lost packets by NACK.
+// @see https://tools.ietf.org/html/rfc8825
+class SrsRtcSession : virtual public ISrsConnection, virtual public ISrsCoroutineHandler
+{
+    friend class SrsRtcServer;
+private:
+    SrsRtcServer* server;
+    ISrsSourceHandler* handler;
+    SrsCoroutine* trd;
+    SrsRequest* req;
+    std::string ip;
+    SrsRtcSessionState state;
+    srs_utime_t create_time;
+    srs_utime_t alive_time;
+private:
+    // The ICE credentials of server and player.
+    std::string local_ufrag;
+    std::string local_pwd;
+    std::string remote_ufrag;
+    // The address of player, selected by the STUN binding request.
+    sockaddr_storage peer;
+    int peer_len;
+    std::string peer_id;
+    SrsRtcDtls* dtls;
+    // The SRTP to send RTP and to receive RTCP.
+    SrsSrtp* srtp_send;
+    SrsSrtp* srtp_recv;
+private:
+    // The payload type of H.264 negotiated with player.
+    uint8_t payload_type;
+    // Whether retransmit by NACK.
+    bool nack;
+    // The sequence of next chunk to send, and the first chunk sent to player, -1 if not started.
+    int64_t cursor;
+    int64_t first;
+    SrsRtpSharedStream* stream;
+    // The statistics of session.
+    int64_t nn_packets;
+    int64_t nn_nacks;
+    int64_t nn_retransmits;
+    int64_t nn_plis;
+public:
+    SrsRtcSession(SrsRtcServer* s, ISrsSourceHandler* h, SrsRequest* r, std::string cip);
+    virtual ~SrsRtcSession();
+public:
+    // Negotiate the SDP answer by the offer of player.
+    // @param candidate The ip of server for the candidate.
+    // @param port The UDP port of server for the candidate.
+    virtual srs_error_t initialize(SrsRtcCertificate* cert, SrsRtcSdp* offer, SrsRtcSdp* answer, std::string candidate, int port);
+    virtual srs_error_t start();
+    virtual std::string get_local_ufrag();
+    virtual std::string get_peer_id();
+// Interface ISrsConnection.
+public:
+    virtual std::string remote_ip();
+public:
+    // When got STUN, DTLS or SRTCP packet from player, which is dispatched by server.
+    virtual srs_error_t on_stun(const sockaddr* from, int fromlen, SrsStunPacket* stun);
+    virtual srs_error_t on_dtls(const char* data, int size);
+    virtual srs_error_t on_rtcp(char* data, int size);
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t playing();
+    // Send the DTLS packets, ignore the error for the DTLS retransmits.
+    virtual void flush_dtls();
+    // Send the RTP packet of chunk over SRTP.
+    virtual srs_error_t send_rtp(int64_t sequence, SrsSharedPtrMessage* msg);
+    virtual srs_error_t send_packet(char* data, int size);
+};
+
+// The WebRTC server, which listens at a UDP port for all sessions, and dispatches the packets
+// to session by the ufrag of STUN, or the address of player for DTLS and SRTCP.
+class SrsRtcServer : virtual public ISrsUdpHandler, virtual public IConnectionManager
+{
+    friend class SrsRtcSession;
+private:
+    ISrsSourceHandler* handler;
+    SrsUdpListener* listener;
+    SrsCoroutineManager* manager;
+    SrsRtcCertificate* cert;
+    std::string candidate;
+    int port;
+    // The sessions, and the index by local ufrag and address of player.
+    std::vector<SrsRtcSession*> sessions;
+    std::map<std::string, SrsRtcSession*> ufrags;
+    std::map<std::string, SrsRtcSession*> peers;
+public:
+    SrsRtcServer(ISrsSourceHandler* h);
+    virtual ~SrsRtcServer();
+public:
+    // Listen at the port, and start to serve the sessions.
+    virtual srs_error_t listen(std::string ip, int port);
+    // Create a session for the player by SDP offer, and response the SDP answer.
+    // @param r The request of stream, which is copied by session.
+    virtual srs_error_t create_session(SrsRequest* r, std::string ip, std::string offer, std::string& answer, std::string& sid);
+// Interface ISrsUdpHandler.
+public:
+    virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
+// Interface IConnectionManager.
+public:
+    virtual void remove(ISrsConnection* c);
+private:
+    virtual void on_peer(SrsRtcSession* session, std::string peer_id);
+    virtual srs_error_t sendto(const sockaddr* to, int tolen, char* data, int size);
+};
+
+#endif
+
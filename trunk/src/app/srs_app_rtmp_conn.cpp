@@ -29,6 +29,7 @@
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
+#include <errno.h>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -44,6 +45,7 @@ using namespace std;
 #include <srs_app_bandwidth.hpp>
 #include <srs_app_st.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_app_coworkers.hpp>
 #include <srs_app_edge.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_rtmp_msg_array.hpp>
@@ -53,8 +55,15 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_app_security.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_hourglass.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_forward.hpp>
+#include <srs_app_overload.hpp>
+#include <srs_kernel_balance.hpp>
+#include <srs_app_abr.hpp>
+#include <srs_app_capture.hpp>
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -68,8 +77,11 @@ using namespace std;
 // if timeout, close the connection.
 #define SRS_PAUSED_RECV_TIMEOUT (3 * SRS_UTIME_MINUTES)
 
-// when edge timeout, retry next.
-#define SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT (3 * SRS_UTIME_SECONDS)
+// when standby take over the replica, the timeout to wait for replica to quit.
+#define SRS_STANDBY_TAKEOVER_TIMEOUT (3 * SRS_UTIME_SECONDS)
+
+// The servers to redirect the players rejected by admission control, selected by round robin.
+static SrsLbRoundRobin _srs_admission_lb;
 
 SrsSimpleRtmpClient::SrsSimpleRtmpClient(string u, srs_utime_t ctm, srs_utime_t stm) : SrsBasicRtmpClient(u, ctm, stm)
 {
@@ -90,6 +102,210 @@ srs_error_t SrsSimpleRtmpClient::connect_app()
     return do_connect_app(local_ip, debug_srs_upnode);
 }
 
+SrsRtmpRaceCandidate::SrsRtmpRaceCandidate(string s, string url, srs_utime_t ctm, srs_utime_t stm, srs_cond_t c)
+{
+    server = s;
+    sdk = new SrsSimpleRtmpClient(url, ctm, stm);
+    done = false;
+    result = srs_success;
+    rtt = 0;
+    trd = new SrsDummyCoroutine();
+    signal = c;
+}
+
+SrsRtmpRaceCandidate::~SrsRtmpRaceCandidate()
+{
+    stop();
+    srs_freep(trd);
+    srs_freep(sdk);
+    srs_freep(result);
+}
+
+srs_error_t SrsRtmpRaceCandidate::start()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("race", this, _srs_context->get_id());
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    return err;
+}
+
+void SrsRtmpRaceCandidate::stop()
+{
+    trd->stop();
+}
+
+srs_error_t SrsRtmpRaceCandidate::cycle()
+{
+    srs_utime_t starttime = srs_update_monotonic_time();
+    result = sdk->connect();
+    rtt = srs_update_monotonic_time() - starttime;
+    
+    done = true;
+    srs_cond_signal(signal);
+    
+    return srs_success;
+}
+
+SrsRtmpConnectRacer::SrsRtmpConnectRacer(SrsLbServerStats* s, srs_utime_t delay)
+{
+    stats = s;
+    stagger = delay;
+    signal = srs_cond_new();
+}
+
+SrsRtmpConnectRacer::~SrsRtmpConnectRacer()
+{
+    cancel();
+    srs_cond_destroy(signal);
+}
+
+void SrsRtmpConnectRacer::add(string server, string url, srs_utime_t ctm, srs_utime_t stm)
+{
+    candidates.push_back(new SrsRtmpRaceCandidate(server, url, ctm, stm, signal));
+}
+
+srs_error_t SrsRtmpConnectRacer::race(SrsSimpleRtmpClient** psdk, string& server, srs_utime_t& rtt)
+{
+    srs_error_t err = srs_success;
+    
+    if (candidates.empty()) {
+        return srs_error_new(ERROR_ST_CONNECT, "no server");
+    }
+    
+    // Try the servers failed recently at last, keep the rank of others.
+    srs_utime_t now = srs_get_system_time();
+    std::vector<SrsRtmpRaceCandidate*> healthy, down;
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        SrsRtmpRaceCandidate* c = candidates.at(i);
+        if (stats->fetch(c->server)->is_healthy(now)) {
+            healthy.push_back(c);
+        } else {
+            down.push_back(c);
+        }
+    }
+    candidates = healthy;
+    candidates.insert(candidates.end(), down.begin(), down.end());
+    
+    int started = 0, failed = 0;
+    srs_utime_t next_start = 0;
+    SrsRtmpRaceCandidate* winner = NULL;
+    
+    while (!winner) {
+        // Start the next one when the stagger delay elapsed, or all started ones failed.
+        now = srs_update_monotonic_time();
+        if (started < (int)candidates.size() && (now >= next_start || failed == started)) {
+            if ((err = candidates.at(started++)->start()) != srs_success) {
+                return srs_error_wrap(err, "start race");
+            }
+            next_start = now + stagger;
+        }
+        
+        for (int i = failed; i < started && !winner; i++) {
+            SrsRtmpRaceCandidate* c = candidates.at(i);
+            if (!c->done) {
+                continue;
+            }
+            
+            if (c->result == srs_success) {
+                winner = c;
+                break;
+            }
+            
+            // Keep the failed ones before the running ones, so the failed ones are counted once.
+            candidates.erase(candidates.begin() + i);
+            candidates.insert(candidates.begin() + failed++, c);
+            stats->fetch(c->server)->on_failure(srs_get_system_time());
+            srs_warn("race: %s failed, %s", c->server.c_str(), srs_error_desc(c->result).c_str());
+        }
+        
+        if (winner) {
+            break;
+        }
+        
+        // All servers failed, return the error of the last one.
+        if (failed == (int)candidates.size()) {
+            SrsRtmpRaceCandidate* c = candidates.at(failed - 1);
+            err = c->result;
+            c->result = srs_success;
+            return srs_error_wrap(err, "race %d servers", failed);
+        }
+        
+        // Wait for any one done, or the stagger delay to start the next one.
+        if (failed < started) {
+            srs_utime_t timeout = SRS_UTIME_NO_TIMEOUT;
+            if (started < (int)candidates.size()) {
+                timeout = srs_max(0, next_start - now);
+            }
+            if (srs_cond_timedwait(signal, timeout) != 0 && errno == EINTR) {
+                return srs_error_new(ERROR_ST_CONNECT, "race interrupted");
+            }
+        }
+    }
+    
+    stats->fetch(winner->server)->on_success(winner->rtt);
+    
+    *psdk = winner->sdk;
+    winner->sdk = NULL;
+    server = winner->server;
+    rtt = winner->rtt;
+    
+    srs_trace("race: %s wins in %dms, started=%d, failed=%d, servers=%d", server.c_str(), srsu2msi(rtt),
+        started, failed, (int)candidates.size());
+    
+    // Cancel the others which are connecting.
+    cancel();
+    
+    return err;
+}
+
+void SrsRtmpConnectRacer::cancel()
+{
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        SrsRtmpRaceCandidate* c = candidates.at(i);
+        srs_freep(c);
+    }
+    candidates.clear();
+}
+
+SrsMuxRtmpClient::SrsMuxRtmpClient(string u, srs_utime_t ctm, srs_utime_t stm) : SrsSimpleRtmpClient(u, ctm, stm)
+{
+}
+
+SrsMuxRtmpClient::~SrsMuxRtmpClient()
+{
+}
+
+srs_error_t SrsMuxRtmpClient::connect_app()
+{
+    if (req->args == NULL) {
+        req->args = SrsAmf0Any::object();
+    }
+    
+    // Ask the origin to serve the streams in mux mode, @see SrsRtmpConn::mux_service_cycle
+    req->args->set("srs_mux", SrsAmf0Any::number(1));
+    
+    return SrsSimpleRtmpClient::connect_app();
+}
+
+SrsRtmpMuxStream::SrsRtmpMuxStream(int sid, SrsRequest* r)
+{
+    stream_id = sid;
+    req = r;
+    consumer = NULL;
+}
+
+SrsRtmpMuxStream::~SrsRtmpMuxStream()
+{
+    srs_freep(consumer);
+    srs_freep(req);
+}
+
 SrsClientInfo::SrsClientInfo()
 {
     edge = false;
@@ -108,7 +324,14 @@ SrsRtmpConn::SrsRtmpConn(SrsServer* svr, srs_netfd_t c, string cip) : SrsConnect
 {
     server = svr;
     
-    rtmp = new SrsRtmpServer(skt);
+    // Capture the bytes from the handshake, for the vhost of client is unknown now.
+    capture = NULL;
+    if (_srs_config->get_publish_capture_any()) {
+        capture = new SrsCaptureReadWriter(skt);
+        rtmp = new SrsRtmpServer(capture);
+    } else {
+        rtmp = new SrsRtmpServer(skt);
+    }
     refer = new SrsRefer();
     bandwidth = new SrsBandwidth();
     security = new SrsSecurity();
@@ -117,10 +340,16 @@ SrsRtmpConn::SrsRtmpConn(SrsServer* svr, srs_netfd_t c, string cip) : SrsConnect
     
     mw_sleep = SRS_PERF_MW_SLEEP;
     mw_enabled = false;
+    mw_adaptive = NULL;
+    abr = NULL;
     realtime = SRS_PERF_MIN_LATENCY_ENABLED;
     send_min_interval = 0;
     tcp_nodelay = false;
     info = new SrsClientInfo();
+    vhost_snapshot = NULL;
+    mux_stream_id = 0;
+    stat_handle = 0;
+    worker_relay = false;
     
     _srs_config->subscribe(this);
 }
@@ -129,11 +358,21 @@ SrsRtmpConn::~SrsRtmpConn()
 {
     _srs_config->unsubscribe(this);
     
+    std::map<int, SrsRtmpMuxStream*>::iterator it;
+    for (it = mux_streams.begin(); it != mux_streams.end(); ++it) {
+        SrsRtmpMuxStream* ms = it->second;
+        srs_freep(ms);
+    }
+    mux_streams.clear();
+    
     srs_freep(info);
     srs_freep(rtmp);
+    srs_freep(capture);
     srs_freep(refer);
     srs_freep(bandwidth);
     srs_freep(security);
+    srs_freep(mw_adaptive);
+    srs_freep(abr);
 }
 
 void SrsRtmpConn::dispose()
@@ -146,6 +385,11 @@ void SrsRtmpConn::dispose()
     }
 }
 
+void SrsRtmpConn::set_worker_relay()
+{
+    worker_relay = true;
+}
+
 // TODO: return detail message when error for client.
 srs_error_t SrsRtmpConn::do_cycle()
 {
@@ -256,9 +500,12 @@ srs_error_t SrsRtmpConn::on_reload_vhost_play(string vhost)
         return err;
     }
     
+    // The vhost maybe added, which fallback to default vhost before.
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    
     // send_min_interval
     if (true) {
-        srs_utime_t v = _srs_config->get_send_min_interval(vhost);
+        srs_utime_t v = vhost_snapshot->send_min_interval;
         if (v != send_min_interval) {
             srs_trace("apply smi %d=>%d ms", srsu2msi(send_min_interval), srsu2msi(v));
             send_min_interval = v;
@@ -278,6 +525,7 @@ srs_error_t SrsRtmpConn::on_reload_vhost_tcp_nodelay(string vhost)
         return err;
     }
     
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
     set_sock_options();
     
     return err;
@@ -293,10 +541,16 @@ srs_error_t SrsRtmpConn::on_reload_vhost_realtime(string vhost)
         return err;
     }
     
-    bool realtime_enabled = _srs_config->get_realtime_enabled(req->vhost);
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    
+    bool realtime_enabled = vhost_snapshot->realtime;
     if (realtime_enabled != realtime) {
         srs_trace("realtime changed %d=>%d", realtime, realtime_enabled);
         realtime = realtime_enabled;
+        
+        if (mw_adaptive) {
+            mw_adaptive->initialize(mw_sleep, realtime);
+        }
     }
     
     return err;
@@ -338,6 +592,9 @@ srs_error_t SrsRtmpConn::service_cycle()
     
     SrsRequest* req = info->req;
     
+    // Send the responses of connect app by one writev, to reduce the time to first frame.
+    rtmp->cork();
+    
     int out_ack_size = _srs_config->get_out_ack_size(req->vhost);
     if (out_ack_size && (err = rtmp->set_window_ack_size(out_ack_size)) != srs_success) {
         return srs_error_wrap(err, "rtmp: set out window ack size");
@@ -357,6 +614,9 @@ srs_error_t SrsRtmpConn::service_cycle()
     
     // do bandwidth test if connect to the vhost which is for bandwidth check.
     if (_srs_config->get_bw_check_enabled(req->vhost)) {
+        if ((err = rtmp->uncork()) != srs_success) {
+            return srs_error_wrap(err, "rtmp: uncork");
+        }
         if ((err = bandwidth->bandwidth_check(rtmp, skt, req, local_ip)) != srs_success) {
             return srs_error_wrap(err, "rtmp: bandwidth check");
         }
@@ -380,6 +640,15 @@ srs_error_t SrsRtmpConn::service_cycle()
         return srs_error_wrap(err, "rtmp: on bw down");
     }
     
+    if ((err = rtmp->uncork()) != srs_success) {
+        return srs_error_wrap(err, "rtmp: uncork");
+    }
+    
+    // The edge of mux protocol plays many streams in this connection, @see SrsMuxRtmpClient
+    if (req->args && req->args->ensure_property_number("srs_mux")) {
+        return mux_service_cycle();
+    }
+    
     while (true) {
         if ((err = trd->pull()) != srs_success) {
             return srs_error_wrap(err, "rtmp: thread quit");
@@ -451,6 +720,7 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
     if (parsed_vhost) {
         req->vhost = parsed_vhost->arg0();
     }
+    strip_untrusted_marks(req);
 
     if (req->schema.empty() || req->vhost.empty() || req->port == 0 || req->app.empty()) {
         return srs_error_new(ERROR_RTMP_REQ_TCURL, "discovery tcUrl failed, tcUrl=%s, schema=%s, vhost=%s, port=%d, app=%s",
@@ -500,13 +770,38 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
     }
     srs_assert(source != NULL);
     
+    // Report the recv buffer of connection to the memory of stream, by role.
+    if (srs_client_type_is_publish(info->type)) {
+        rtmp->set_memory(source->memory_stat(), SrsMemoryRecvBuffer);
+    } else {
+        // The player only reads control messages, so shrink the buffer grew by the connect.
+        rtmp->shrink_recv_buffer();
+        rtmp->set_memory(source->memory_stat(), SrsMemoryPlayBuffer);
+    }
+    
+    // Capture the publisher for replay, or drop the cached bytes of others.
+    if (capture) {
+        string path = _srs_config->get_publish_capture(req->vhost);
+        if (!path.empty() && srs_client_type_is_publish(info->type)) {
+            path = srs_path_build_stream(path, req->vhost, req->app, req->stream);
+            path = srs_path_build_timestamp(path);
+            if ((err = capture->start(path)) != srs_success) {
+                srs_warn("rtmp: ignore capture err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+            }
+        } else {
+            capture->stop();
+        }
+    }
+    
     // update the statistic when source disconveried.
     SrsStatistic* stat = SrsStatistic::instance();
     if ((err = stat->on_client(_srs_context->get_id(), req, this, info->type)) != srs_success) {
         return srs_error_wrap(err, "rtmp: stat client");
     }
+    stat_handle = stat->find_handle(_srs_context->get_id());
     
-    bool enabled_cache = _srs_config->get_gop_cache(req->vhost);
+    bool enabled_cache = vhost_snapshot->gop_cache;
     srs_trace("source url=%s, ip=%s, cache=%d, is_edge=%d, source_id=%d/%d",
         req->get_stream_url().c_str(), ip.c_str(), enabled_cache, info->edge, source->source_id(), source->pre_source_id());
     source->set_cache(enabled_cache);
@@ -517,12 +812,12 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
             if ((err = rtmp->start_play(info->res->stream_id)) != srs_success) {
                 return srs_error_wrap(err, "rtmp: start play");
             }
-            if ((err = http_hooks_on_play()) != srs_success) {
+            if ((err = http_hooks_on_play(req)) != srs_success) {
                 return srs_error_wrap(err, "rtmp: callback on play");
             }
             
             err = playing(source);
-            http_hooks_on_stop();
+            http_hooks_on_stop(req);
             
             return err;
         }
@@ -555,6 +850,255 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
     return err;
 }
 
+void SrsRtmpConn::strip_untrusted_marks(SrsRequest* req)
+{
+    // The sibling worker already stripped the marks it never trusts.
+    if (worker_relay && _srs_worker_index >= 0) {
+        return;
+    }
+    
+    // The relay mark skips the hooks, forward, HLS and DVR, so only trust it from the relay listener of worker.
+    req->param = srs_worker_strip_relay_param(req->param);
+    
+    // The replica mark also takes over the stream, so only trust it from the standby peers.
+    if (srs_standby_is_replica(req) && !srs_standby_is_peer(req->vhost, ip)) {
+        req->param = srs_standby_strip_replica_param(req->param);
+    }
+}
+
+srs_error_t SrsRtmpConn::mux_service_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* req = info->req;
+    
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req->vhost);
+    if (parsed_vhost) {
+        req->vhost = parsed_vhost->arg0();
+    }
+    
+    if ((err = check_vhost(true)) != srs_success) {
+        return srs_error_wrap(err, "check vhost");
+    }
+    
+    info->type = SrsRtmpConnPlay;
+    mw_sleep = vhost_snapshot->mw_sleep;
+    
+    // The connection only reads the commands of edge.
+    rtmp->shrink_recv_buffer();
+    set_sock_options();
+    
+    srs_trace("rtmp: serve mux edge, vhost=%s, app=%s, mw_sleep=%dms", req->vhost.c_str(), req->app.c_str(), srsu2msi(mw_sleep));
+    
+    err = do_mux_playing();
+    
+    while (!mux_streams.empty()) {
+        mux_close(mux_streams.begin()->first);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtmpConn::do_mux_playing()
+{
+    srs_error_t err = srs_success;
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "rtmp: thread quit");
+        }
+        
+        // Process the commands of edge, never block for the peer, and quit when peer closed.
+        if (skt->readable() && (err = rtmp->read_available()) != srs_success) {
+            return srs_error_wrap(err, "read available");
+        }
+        
+        while (true) {
+            SrsCommonMessage* msg = NULL;
+            if ((err = rtmp->recv_buffered_message(&msg)) != srs_success) {
+                return srs_error_wrap(err, "recv message");
+            }
+            
+            if (!msg) {
+                break;
+            }
+            
+            if ((err = mux_process_msg(msg)) != srs_success) {
+                return srs_error_wrap(err, "mux message");
+            }
+        }
+        
+        // Deliver the streams in turn, at most a merged-write of messages for each stream, so a stream
+        // is never starved by others, and the messages over the queue of consumer are dropped by itself.
+        bool more = false;
+        std::map<int, SrsRtmpMuxStream*>::iterator it;
+        for (it = mux_streams.begin(); it != mux_streams.end(); ++it) {
+            SrsRtmpMuxStream* stream = it->second;
+            
+            int count = 0;
+            if ((err = stream->consumer->dump_packets(&msgs, count)) != srs_success) {
+                return srs_error_wrap(err, "rtmp: consumer dump packets");
+            }
+            
+            if (count <= 0) {
+                continue;
+            }
+            more = more || count >= msgs.max;
+            
+            if ((err = rtmp->send_and_free_messages(msgs.msgs, count, stream->stream_id)) != srs_success) {
+                return srs_error_wrap(err, "rtmp: send %d messages", count);
+            }
+        }
+        
+        if (!more) {
+            srs_usleep(mw_sleep);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtmpConn::mux_process_msg(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    SrsAutoFree(SrsCommonMessage, msg);
+    
+    if (!msg->header.is_amf0_command() && !msg->header.is_amf3_command()) {
+        return err;
+    }
+    
+    SrsPacket* pkt = NULL;
+    if ((err = rtmp->decode_message(msg, &pkt)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: decode message");
+    }
+    SrsAutoFree(SrsPacket, pkt);
+    
+    SrsCreateStreamPacket* create = dynamic_cast<SrsCreateStreamPacket*>(pkt);
+    if (create) {
+        SrsCreateStreamResPacket* res = new SrsCreateStreamResPacket(create->transaction_id, ++mux_stream_id);
+        if ((err = rtmp->send_and_free_packet(res, 0)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: send create stream response");
+        }
+        return err;
+    }
+    
+    // The failure of stream is responsed to the edge, without closing the connection.
+    SrsPlayPacket* play = dynamic_cast<SrsPlayPacket*>(pkt);
+    if (play) {
+        int stream_id = msg->header.stream_id;
+        if ((err = mux_play(stream_id, play->stream_name)) == srs_success) {
+            return err;
+        }
+        
+        srs_warn("rtmp: mux play %s failed, stream_id=%d, %s", play->stream_name.c_str(), stream_id, srs_error_desc(err).c_str());
+        
+        SrsOnStatusCallPacket* res = new SrsOnStatusCallPacket();
+        res->data->set(StatusLevel, SrsAmf0Any::str(StatusLevelError));
+        res->data->set(StatusCode, SrsAmf0Any::str(StatusCodeStreamFailed));
+        res->data->set(StatusDescription, SrsAmf0Any::str(srs_error_desc(err).c_str()));
+        srs_freep(err);
+        
+        if ((err = rtmp->send_and_free_packet(res, stream_id)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: send play failed");
+        }
+        return err;
+    }
+    
+    SrsCloseStreamPacket* close = dynamic_cast<SrsCloseStreamPacket*>(pkt);
+    if (close) {
+        mux_close(msg->header.stream_id);
+        return err;
+    }
+    
+    SrsCallPacket* call = dynamic_cast<SrsCallPacket*>(pkt);
+    if (call && call->transaction_id > 0) {
+        SrsCallResPacket* res = new SrsCallResPacket(call->transaction_id);
+        res->command_object = SrsAmf0Any::null();
+        res->response = SrsAmf0Any::null();
+        if ((err = rtmp->send_and_free_packet(res, 0)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: send packets");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtmpConn::mux_play(int stream_id, string stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (mux_streams.find(stream_id) != mux_streams.end()) {
+        return srs_error_new(ERROR_RTMP_EDGE_MUX, "stream_id=%d is playing", stream_id);
+    }
+    
+    SrsRequest* req = info->req->copy();
+    SrsRtmpMuxStream* ms = new SrsRtmpMuxStream(stream_id, req);
+    SrsAutoFree(SrsRtmpMuxStream, ms);
+    
+    req->stream = stream;
+    srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
+    req->strip();
+    
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req->vhost);
+    if (parsed_vhost) {
+        req->vhost = parsed_vhost->arg0();
+    }
+    strip_untrusted_marks(req);
+    
+    if (req->stream.empty()) {
+        return srs_error_new(ERROR_RTMP_STREAM_NAME_EMPTY, "rtmp: empty stream");
+    }
+    
+    if ((err = security->check(SrsRtmpConnPlay, ip, req)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: security check");
+    }
+    
+    SrsSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, server, &source)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: fetch source");
+    }
+    source->set_cache(_srs_config->get_gop_cache(req->vhost));
+    
+    if ((err = source->create_consumer(this, ms->consumer, true, true, true)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: create consumer");
+    }
+    
+    if ((err = rtmp->start_play(stream_id)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: start play");
+    }
+    
+    if ((err = http_hooks_on_play(req)) != srs_success) {
+        return srs_error_wrap(err, "rtmp: callback on play");
+    }
+    
+    srs_trace("rtmp: mux play url=%s, stream_id=%d, streams=%d, source_id=%d", req->get_stream_url().c_str(), stream_id,
+        (int)mux_streams.size() + 1, source->source_id());
+    
+    mux_streams[stream_id] = ms;
+    ms = NULL;
+    
+    return err;
+}
+
+void SrsRtmpConn::mux_close(int stream_id)
+{
+    std::map<int, SrsRtmpMuxStream*>::iterator it = mux_streams.find(stream_id);
+    if (it == mux_streams.end()) {
+        return;
+    }
+    
+    SrsRtmpMuxStream* ms = it->second;
+    mux_streams.erase(it);
+    
+    srs_trace("rtmp: mux close url=%s, stream_id=%d, streams=%d", ms->req->get_stream_url().c_str(), stream_id, (int)mux_streams.size());
+    
+    http_hooks_on_stop(ms->req);
+    srs_freep(ms);
+}
+
 srs_error_t SrsRtmpConn::check_vhost(bool try_default_vhost)
 {
     srs_error_t err = srs_success;
@@ -575,6 +1119,7 @@ srs_error_t SrsRtmpConn::check_vhost(bool try_default_vhost)
         srs_trace("vhost change from %s to %s", req->vhost.c_str(), vhost->arg0().c_str());
         req->vhost = vhost->arg0();
     }
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
     
     if (_srs_config->get_refer_enabled(req->vhost)) {
         if ((err = refer->check(req->pageUrl, _srs_config->get_refer_all(req->vhost))) != srs_success) {
@@ -604,6 +1149,21 @@ srs_error_t SrsRtmpConn::playing(SrsSource* source)
     // When origin cluster enabled, try to redirect to the origin which is active.
     // A active origin is a server which is delivering stream.
     if (!info->edge && _srs_config->get_vhost_origin_cluster(req->vhost) && source->inactive()) {
+        // Use the location pushed by co-workers, to avoid the HTTP query.
+        string rhost; int rport = 0;
+        if (SrsCoWorkers::instance()->find_remote(req->vhost, req->app, req->stream, rhost, rport)) {
+            string rurl = srs_generate_rtmp_url(rhost, rport, req->host, req->vhost, req->app, req->stream, req->param);
+            srs_trace("rtmp: redirect in cluster by cache, from=%s:%d, target=%s:%d, rurl=%s",
+                req->host.c_str(), req->port, rhost.c_str(), rport, rurl.c_str());
+            
+            bool accepted = false;
+            if ((err = rtmp->redirect(req, rurl, accepted)) != srs_success) {
+                srs_error_reset(err);
+            } else {
+                return srs_error_new(ERROR_CONTROL_REDIRECT, "redirected");
+            }
+        }
+        
         vector<string> coworkers = _srs_config->get_vhost_coworkers(req->vhost);
         for (int i = 0; i < (int)coworkers.size(); i++) {
             // TODO: FIXME: User may config the server itself as coworker, we must identify and ignore it.
@@ -641,40 +1201,75 @@ srs_error_t SrsRtmpConn::playing(SrsSource* source)
         return srs_error_new(ERROR_OCLUSTER_REDIRECT, "no origin");
     }
     
+    // Reject or redirect the player when the egress of server exceeds the budget.
+    if ((err = admission_check()) != srs_success) {
+        return srs_error_wrap(err, "rtmp: admission");
+    }
+    
     // Set the socket options for transport.
     set_sock_options();
     
-    // Create a consumer of source.
+    // For time shift, the player starts from the past by param timeshift in seconds, @see SrsTimeShift
+    // For resume, the player continues from where it was disconnected by param resume token.
+    srs_utime_t shift = 0;
+    string resume;
+    if (!req->param.empty()) {
+        map<string, string> query;
+        srs_parse_query_string(srs_string_trim_start(req->param, "?"), query);
+        shift = ::atoi(query["timeshift"].c_str()) * SRS_UTIME_SECONDS;
+        resume = query["resume"];
+    }
+    srs_utime_t resume_grace = _srs_config->get_vhost_play_resume(req->vhost);
+    if (resume_grace <= 0 || shift > 0) {
+        resume = "";
+    }
+    
+    // Resume the consumer parked by the previous connection of player, or create a consumer of source.
     SrsConsumer* consumer = NULL;
-    if ((err = source->create_consumer(this, consumer)) != srs_success) {
+    if (!resume.empty()) {
+        consumer = source->resume_consumer(resume, this);
+    }
+    bool resumed = consumer != NULL;
+    if (!resumed && (err = source->create_consumer(this, consumer, true, true, true, shift)) != srs_success) {
         return srs_error_wrap(err, "rtmp: create consumer");
     }
     SrsAutoFree(SrsConsumer, consumer);
     
-    // Use receiving thread to receive packets from peer.
-    // @see: https://github.com/ossrs/srs/issues/217
-    SrsQueueRecvThread trd(consumer, rtmp, SRS_PERF_MW_SLEEP, _srs_context->get_id());
+    // It's a new session for the resumed player, so send the metadata and sequence headers before the stream
+    // it missed, while the gop cache is never dumped.
+    if (resumed) {
+        vector<SrsSharedPtrMessage*> headers;
+        source->headers(headers);
+        if (!headers.empty() && (err = rtmp->send_and_free_messages(&headers[0], (int)headers.size(), info->res->stream_id)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: send headers");
+        }
+        srs_trace("rtmp: resume consumer, token=%s, grace=%dms", resume.c_str(), srsu2msi(resume_grace));
+    }
     
-    if ((err = trd.start()) != srs_success) {
-        return srs_error_wrap(err, "rtmp: start receive thread");
+    // Switch the consumer between the renditions by the delivery rate, except the time shift or resumed player.
+    srs_freep(abr);
+    if (resume.empty() && shift <= 0) {
+        abr = new SrsAbrSwitcher(this, req);
+        if (!abr->initialize(source)) {
+            srs_freep(abr);
+        }
     }
     
-    // Deliver packets to peer.
+    // Deliver packets to peer, and receive the control messages in the same coroutine.
     wakable = consumer;
-    err = do_playing(source, consumer, &trd);
+    err = do_playing(source, consumer);
     wakable = NULL;
     
-    trd.stop();
-    
-    // Drop all packets in receiving thread.
-    if (!trd.empty()) {
-        srs_warn("drop the received %d messages", trd.size());
+    // Park the consumer for the player to resume it in the grace duration, which is owned by source.
+    if (!resume.empty()) {
+        source->park_consumer(resume, consumer, resume_grace);
+        consumer = NULL;
     }
     
     return err;
 }
 
-srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, SrsQueueRecvThread* rtrd)
+srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer*& consumer)
 {
     srs_error_t err = srs_success;
     
@@ -688,19 +1283,46 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
     
     SrsMessageArray msgs(SRS_PERF_MW_MSGS);
     bool user_specified_duration_to_stop = (req->duration > 0);
+    // Whether the time to first frame is stat.
+    bool ttff_done = false;
     int64_t starttime = -1;
+    // Yield to the publishers for each slice of bytes, for example, when dump the GOP cache.
+    SrsCoroutineSlice slice(_srs_config->get_scheduler_slice());
     
     // setup the realtime.
-    realtime = _srs_config->get_realtime_enabled(req->vhost);
+    realtime = vhost_snapshot->realtime;
     // setup the mw config.
     // when mw_sleep changed, resize the socket send buffer.
     mw_enabled = true;
-    change_mw_sleep(_srs_config->get_mw_sleep(req->vhost));
+    change_mw_sleep(vhost_snapshot->mw_sleep);
+    // setup the adaptive mw, which tunes the wait in [min, mw_sleep].
+    srs_freep(mw_adaptive);
+    if (vhost_snapshot->mw_adaptive) {
+        mw_adaptive = new SrsMwAdaptive();
+        mw_adaptive->initialize(mw_sleep, realtime);
+    }
     // initialize the send_min_interval
-    send_min_interval = _srs_config->get_send_min_interval(req->vhost);
+    send_min_interval = vhost_snapshot->send_min_interval;
+    // pack the audio and video of a merged-write to aggregate message.
+    consumer->set_aggregate(vhost_snapshot->mw_aggregate);
+    // setup the congestion control and pacing of transport.
+    if ((err = set_tcp_congestion(vhost_snapshot->tcp_congestion)) != srs_success) {
+        srs_warn("ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    // keep the backlog in the queue of consumer, where the slow consumer drops frames.
+    if ((err = set_notsent_lowat(vhost_snapshot->notsent_lowat)) != srs_success) {
+        srs_warn("ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    // send the large video payloads without copy.
+    if (vhost_snapshot->zerocopy > 0 && (err = rtmp->set_zerocopy(vhost_snapshot->zerocopy)) != srs_success) {
+        srs_warn("ignore err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
     
-    srs_trace("start play smi=%dms, mw_sleep=%d, mw_enabled=%d, realtime=%d, tcp_nodelay=%d",
-        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_enabled, realtime, tcp_nodelay);
+    srs_trace("start play smi=%dms, mw_sleep=%d, mw_enabled=%d, mw_adaptive=%d, realtime=%d, tcp_nodelay=%d",
+        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_enabled, (mw_adaptive != NULL), realtime, tcp_nodelay);
     
     while (true) {
         // when source is set to expired, disconnect it.
@@ -711,31 +1333,36 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
         // collect elapse for pithy print.
         pprint->elapse();
 
-        // to use isolate thread to recv, can improve about 33% performance.
-        // @see: https://github.com/ossrs/srs/issues/196
-        // @see: https://github.com/ossrs/srs/issues/217
-        while (!rtrd->empty()) {
-            SrsCommonMessage* msg = rtrd->pump();
-            if ((err = process_play_control_msg(consumer, msg)) != srs_success) {
-                return srs_error_wrap(err, "rtmp: play control message");
-            }
+        // Process the control messages, and quit when peer closed, without a receiving coroutine.
+        if ((err = recv_play_control_msgs(consumer)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: play control messages");
         }
         
-        // quit when recv thread error.
-        if ((err = rtrd->error_code()) != srs_success) {
-            return srs_error_wrap(err, "rtmp: recv thread");
+        // Switch the rendition at its keyframe, then apply the settings of player to the new consumer.
+        if (abr) {
+            bool switched = false;
+            if ((err = abr->cycle(consumer, switched)) != srs_success) {
+                return srs_error_wrap(err, "rtmp: abr");
+            }
+            if (switched) {
+                consumer->set_aggregate(vhost_snapshot->mw_aggregate);
+                wakable = consumer;
+            }
         }
         
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-        // wait for message to incoming.
+        // wait for message to incoming, at most a pulse for checking the peer.
         // @see https://github.com/ossrs/srs/issues/251
         // @see https://github.com/ossrs/srs/issues/257
-        if (realtime) {
+        if (mw_adaptive) {
+            // for adaptive mw, wait in the window of current bitrate.
+            consumer->wait(mw_adaptive->min_msgs(), mw_adaptive->sleep(), SRS_CONSTS_RTMP_PULSE);
+        } else if (realtime) {
             // for realtime, min required msgs is 0, send when got one+ msgs.
-            consumer->wait(0, mw_sleep);
+            consumer->wait(0, mw_sleep, SRS_CONSTS_RTMP_PULSE);
         } else {
             // for no-realtime, got some msgs then send.
-            consumer->wait(SRS_PERF_MW_MIN_MSGS, mw_sleep);
+            consumer->wait(SRS_PERF_MW_MIN_MSGS, mw_sleep, SRS_CONSTS_RTMP_PULSE);
         }
 #endif
         
@@ -752,17 +1379,23 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
             kbps->sample();
             srs_trace("-> " SRS_CONSTS_LOG_PLAY " time=%d, msgs=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mw=%d",
                 (int)pprint->age(), count, kbps->get_send_kbps(), kbps->get_send_kbps_30s(), kbps->get_send_kbps_5m(),
-                kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(), srsu2msi(mw_sleep));
+                kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(),
+                srsu2msi(mw_adaptive? mw_adaptive->sleep() : mw_sleep));
         }
         
         if (count <= 0) {
 #ifndef SRS_PERF_QUEUE_COND_WAIT
-            srs_usleep(mw_sleep);
+            _srs_timer->usleep(mw_adaptive? mw_adaptive->sleep() : mw_sleep);
 #endif
             // ignore when nothing got.
             continue;
         }
         
+        // Continue the timestamp of player, after switched to another rendition.
+        if (abr) {
+            abr->rebase(msgs.msgs, count);
+        }
+        
         // only when user specifies the duration,
         // we start to collect the durations for each message.
         if (user_specified_duration_to_stop) {
@@ -779,10 +1412,48 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
             }
         }
         
+        if (!ttff_done) {
+            ttff_done = SrsStatistic::instance()->on_client_frames(stat_handle, msgs.msgs, count);
+        }
+        SrsStatistic::instance()->on_client_markers(stat_handle, msgs.msgs, count);
+        
+        int64_t nn_bytes = 0;
+        for (int i = 0; i < count; i++) {
+            nn_bytes += msgs.msgs[i]->size;
+        }
+        
         // sendout messages, all messages are freed by send_and_free_messages().
         // no need to assert msg, for the rtmp will assert it.
-        if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
-            return srs_error_wrap(err, "rtmp: send %d messages", count);
+        srs_utime_t send_starttime = srs_update_monotonic_time();
+        if (true) {
+            SrsCpuScope cpu_scope(source->cpu_stat(), SrsCpuSend);
+            if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
+                return srs_error_wrap(err, "rtmp: send %d messages", count);
+            }
+        }
+        SrsStatistic::instance()->on_send_latency(stat_handle, srs_update_monotonic_time() - send_starttime);
+        
+        srs_utime_t stall_time = 0;
+        int64_t nn_stalls = 0;
+        stalls(&stall_time, &nn_stalls);
+        SrsStatistic::instance()->on_client_delays(stat_handle, consumer->delay(), stall_time, nn_stalls);
+        slice.consume(nn_bytes);
+        
+        // pace the sending by the bitrate of stream.
+        if ((err = update_pacing(vhost_snapshot->pacing_factor)) != srs_success) {
+            srs_warn("ignore pacing err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        // update the adaptive mw by the bitrate and the socket send buffer.
+        if (mw_adaptive && mw_adaptive->sample(srs_get_monotonic_time(), skt->get_send_bytes())) {
+            int unsent = 0, sndbuf = 0;
+            if ((err = get_send_queue(&unsent, &sndbuf)) != srs_success) {
+                srs_warn("ignore send queue err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+            } else {
+                mw_adaptive->on_send_queue(unsent, sndbuf);
+            }
         }
         
         // if duration specified, and exceed it, stop play live.
@@ -795,7 +1466,7 @@ srs_error_t SrsRtmpConn::do_playing(SrsSource* source, SrsConsumer* consumer, Sr
         
         // apply the minimal interval for delivery stream in srs_utime_t.
         if (send_min_interval > 0) {
-            srs_usleep(send_min_interval);
+            _srs_timer->usleep(send_min_interval);
         }
     }
     
@@ -862,8 +1533,8 @@ srs_error_t SrsRtmpConn::do_publishing(SrsSource* source, SrsPublishRecvThread*
     set_sock_options();
     
     if (true) {
-        bool mr = _srs_config->get_mr_enabled(req->vhost);
-        srs_utime_t mr_sleep = _srs_config->get_mr_sleep(req->vhost);
+        bool mr = vhost_snapshot->mr_enabled;
+        srs_utime_t mr_sleep = vhost_snapshot->mr_sleep;
         srs_trace("start publish mr=%d/%d, p1stpt=%d, pnt=%d, tcp_nodelay=%d",
             mr, srsu2msi(mr_sleep), srsu2msi(publish_1stpkt_timeout), srsu2msi(publish_normal_timeout), tcp_nodelay);
     }
@@ -901,16 +1572,19 @@ srs_error_t SrsRtmpConn::do_publishing(SrsSource* source, SrsPublishRecvThread*
         // Update the stat for video fps.
         // @remark https://github.com/ossrs/srs/issues/851
         SrsStatistic* stat = SrsStatistic::instance();
-        if ((err = stat->on_video_frames(req, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
+        if ((err = stat->on_video_frames(stat_handle, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
             return srs_error_wrap(err, "rtmp: stat video frames");
         }
         nb_frames = rtrd->nb_video_frames();
+        
+        // Update the stat for chunks not in the chunk stream cache.
+        stat->on_chunk_stream_misses(stat_handle, rtmp->get_chunk_stream_misses());
 
         // reportable
         if (pprint->can_print()) {
             kbps->sample();
-            bool mr = _srs_config->get_mr_enabled(req->vhost);
-            srs_utime_t mr_sleep = _srs_config->get_mr_sleep(req->vhost);
+            bool mr = vhost_snapshot->mr_enabled;
+            srs_utime_t mr_sleep = vhost_snapshot->mr_sleep;
             srs_trace("<- " SRS_CONSTS_LOG_CLIENT_PUBLISH " time=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mr=%d/%d, p1stpt=%d, pnt=%d",
                 (int)pprint->age(), kbps->get_send_kbps(), kbps->get_send_kbps_30s(), kbps->get_send_kbps_5m(),
                 kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(), mr, srsu2msi(mr_sleep),
@@ -921,12 +1595,58 @@ srs_error_t SrsRtmpConn::do_publishing(SrsSource* source, SrsPublishRecvThread*
     return err;
 }
 
+srs_error_t SrsRtmpConn::admission_check()
+{
+    srs_error_t err = srs_success;
+    
+    SrsRequest* req = info->req;
+    
+    // Reject the new players when overload, before the egress budget.
+    bool overload = _srs_overload->reject_play();
+    if (overload) {
+        _srs_overload->on_reject();
+    } else if (!_srs_config->get_admission_enabled()) {
+        return err;
+    } else {
+        SrsStatistic* stat = SrsStatistic::instance();
+        if (stat->admit_play(req, _srs_config->get_admission_max_kbps(), _srs_config->get_vhost_egress_share(req->vhost))) {
+            return err;
+        }
+    }
+    
+    vector<string> servers = _srs_config->get_admission_rtmp_redirect();
+    if (!servers.empty()) {
+        string host; int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+        srs_parse_hostport(_srs_admission_lb.select(servers), host, port);
+        
+        string rurl = srs_generate_rtmp_url(host, port, req->host, req->vhost, req->app, req->stream, req->param);
+        srs_trace("rtmp: redirect by admission, rurl=%s", rurl.c_str());
+        
+        bool accepted = false;
+        if ((err = rtmp->redirect(req, rurl, accepted)) != srs_success) {
+            srs_error_reset(err);
+        } else {
+            return srs_error_new(ERROR_CONTROL_REDIRECT, "redirected");
+        }
+    }
+    
+    return srs_error_new(ERROR_ADMISSION_REJECTED, overload? "server overload" : "egress exceeds budget");
+}
+
 srs_error_t SrsRtmpConn::acquire_publish(SrsSource* source)
 {
     srs_error_t err = srs_success;
     
     SrsRequest* req = info->req;
     
+    // For standby origin, the publisher takes over the stream replicated from the origin, which maybe down
+    // and the replica is not closed yet.
+    if (!info->edge && !srs_standby_is_replica(req) && source->is_replica()) {
+        if ((err = takeover_replica(source)) != srs_success) {
+            return srs_error_wrap(err, "rtmp: take over replica");
+        }
+    }
+    
     if (!source->can_publish(info->edge)) {
         return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtmp: stream %s is busy", req->get_stream_url().c_str());
     }
@@ -945,6 +1665,30 @@ srs_error_t SrsRtmpConn::acquire_publish(SrsSource* source)
     return err;
 }
 
+srs_error_t SrsRtmpConn::takeover_replica(SrsSource* source)
+{
+    srs_error_t err = srs_success;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsStatisticClient* client = stat->find_client(source->source_id());
+    if (!client || !client->conn) {
+        return err;
+    }
+    
+    srs_trace("standby kickoff replica id=%d, url=%s", client->id, info->req->get_stream_url().c_str());
+    client->conn->expire();
+    
+    srs_utime_t starttime = srs_get_monotonic_time();
+    while (source->is_replica() && srs_get_monotonic_time() - starttime < SRS_STANDBY_TAKEOVER_TIMEOUT) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "rtmp: thread quit");
+        }
+        srs_usleep(100 * SRS_UTIME_MILLISECONDS);
+    }
+    
+    return err;
+}
+
 void SrsRtmpConn::release_publish(SrsSource* source)
 {
     // when edge, notice edge to change state.
@@ -1053,6 +1797,35 @@ srs_error_t SrsRtmpConn::process_publish_message(SrsSource* source, SrsCommonMes
     return err;
 }
 
+srs_error_t SrsRtmpConn::recv_play_control_msgs(SrsConsumer* consumer)
+{
+    srs_error_t err = srs_success;
+    
+    // Read the bytes only when peer sent something, so the playing never blocks by the peer,
+    // and it fails when peer closed.
+    if (skt->readable() && (err = rtmp->read_available()) != srs_success) {
+        return srs_error_wrap(err, "read available");
+    }
+    
+    // Process all entire messages in buffer, the partial message is kept in chunk stream.
+    while (true) {
+        SrsCommonMessage* msg = NULL;
+        if ((err = rtmp->recv_buffered_message(&msg)) != srs_success) {
+            return srs_error_wrap(err, "recv message");
+        }
+        
+        if (!msg) {
+            break;
+        }
+        
+        if ((err = process_play_control_msg(consumer, msg)) != srs_success) {
+            return srs_error_wrap(err, "play control message");
+        }
+    }
+    
+    return err;
+}
+
 srs_error_t SrsRtmpConn::process_play_control_msg(SrsConsumer* consumer, SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -1126,9 +1899,7 @@ void SrsRtmpConn::change_mw_sleep(srs_utime_t sleep_v)
 
 void SrsRtmpConn::set_sock_options()
 {
-    SrsRequest* req = info->req;
-    
-    bool nvalue = _srs_config->get_tcp_nodelay(req->vhost);
+    bool nvalue = vhost_snapshot->tcp_nodelay;
     if (nvalue != tcp_nodelay) {
         tcp_nodelay = nvalue;
         
@@ -1142,63 +1913,11 @@ void SrsRtmpConn::set_sock_options()
 
 srs_error_t SrsRtmpConn::check_edge_token_traverse_auth()
 {
-    srs_error_t err = srs_success;
-    
     SrsRequest* req = info->req;
     srs_assert(req);
     
-    vector<string> args = _srs_config->get_vhost_edge_origin(req->vhost)->args;
-    if (args.empty()) {
-        return err;
-    }
-    
-    for (int i = 0; i < (int)args.size(); i++) {
-        string hostport = args.at(i);
-        
-        // select the origin.
-        string server;
-        int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
-        srs_parse_hostport(hostport, server, port);
-        
-        SrsTcpClient* transport = new SrsTcpClient(server, port, SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT);
-        SrsAutoFree(SrsTcpClient, transport);
-        
-        if ((err = transport->connect()) != srs_success) {
-            srs_warn("Illegal edge token, tcUrl=%s, %s", req->tcUrl.c_str(), srs_error_desc(err).c_str());
-            srs_freep(err);
-            continue;
-        }
-        
-        SrsRtmpClient* client = new SrsRtmpClient(transport);
-        SrsAutoFree(SrsRtmpClient, client);
-        return do_token_traverse_auth(client);
-    }
-    
-    return srs_error_new(ERROR_EDGE_PORT_INVALID, "rtmp: Illegal edge token, server=%d", (int)args.size());
-}
-
-srs_error_t SrsRtmpConn::do_token_traverse_auth(SrsRtmpClient* client)
-{
-    srs_error_t err = srs_success;
-    
-    SrsRequest* req = info->req;
-    srs_assert(client);
-    
-    client->set_recv_timeout(SRS_CONSTS_RTMP_TIMEOUT);
-    client->set_send_timeout(SRS_CONSTS_RTMP_TIMEOUT);
-    
-    if ((err = client->handshake()) != srs_success) {
-        return srs_error_wrap(err, "rtmp: handshake");
-    }
-    
-    // for token tranverse, always take the debug info(which carries token).
-    SrsServerInfo si;
-    if ((err = client->connect_app(req->app, req->tcUrl, req, true, &si)) != srs_success) {
-        return srs_error_wrap(err, "rtmp: connect tcUrl");
-    }
-    
-    srs_trace("edge token auth ok, tcUrl=%s", req->tcUrl.c_str());
-    return err;
+    srs_utime_t ttl = _srs_config->get_vhost_edge_token_traverse_ttl(req->vhost);
+    return _srs_edge_tokens->verify(req, ttl);
 }
 
 srs_error_t SrsRtmpConn::on_disconnect()
@@ -1286,6 +2005,11 @@ srs_error_t SrsRtmpConn::http_hooks_on_publish()
         return err;
     }
     
+    // The worker or origin accepting the publisher already notified the hooks.
+    if (srs_worker_is_relay(req) || srs_standby_is_replica(req)) {
+        return err;
+    }
+    
     // the http hooks will cause context switch,
     // so we must copy all hooks for the on_connect may freed.
     // @see https://github.com/ossrs/srs/issues/475
@@ -1319,6 +2043,11 @@ void SrsRtmpConn::http_hooks_on_unpublish()
         return;
     }
     
+    // The worker or origin accepting the publisher already notified the hooks.
+    if (srs_worker_is_relay(req) || srs_standby_is_replica(req)) {
+        return;
+    }
+    
     // the http hooks will cause context switch,
     // so we must copy all hooks for the on_connect may freed.
     // @see https://github.com/ossrs/srs/issues/475
@@ -1340,12 +2069,10 @@ void SrsRtmpConn::http_hooks_on_unpublish()
     }
 }
 
-srs_error_t SrsRtmpConn::http_hooks_on_play()
+srs_error_t SrsRtmpConn::http_hooks_on_play(SrsRequest* req)
 {
     srs_error_t err = srs_success;
     
-    SrsRequest* req = info->req;
-    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return err;
     }
@@ -1375,10 +2102,8 @@ srs_error_t SrsRtmpConn::http_hooks_on_play()
     return err;
 }
 
-void SrsRtmpConn::http_hooks_on_stop()
+void SrsRtmpConn::http_hooks_on_stop(SrsRequest* req)
 {
-    SrsRequest* req = info->req;
-    
     if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
         return;
     }
@@ -27,16 +27,20 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <vector>
 
 #include <srs_app_st.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_reload.hpp>
 #include <srs_rtmp_stack.hpp>
 #include <srs_service_rtmp_conn.hpp>
+#include <srs_app_statistic.hpp>
 
 class SrsServer;
 class SrsRtmpServer;
 class SrsRequest;
+class SrsVhostSnapshot;
 class SrsResponse;
 class SrsSource;
 class SrsRefer;
@@ -46,14 +50,15 @@ class SrsStSocket;
 class SrsHttpHooks;
 class SrsBandwidth;
 class SrsKbps;
-class SrsRtmpClient;
 class SrsSharedPtrMessage;
-class SrsQueueRecvThread;
 class SrsPublishRecvThread;
 class SrsSecurity;
 class ISrsWakable;
 class SrsCommonMessage;
 class SrsPacket;
+class SrsAbrSwitcher;
+class SrsCaptureReadWriter;
+class SrsLbServerStats;
 
 // The simple rtmp client for SRS.
 class SrsSimpleRtmpClient : public SrsBasicRtmpClient
@@ -65,6 +70,79 @@ protected:
     virtual srs_error_t connect_app();
 };
 
+// The candidate of connect race, which connects to a server in a coroutine.
+class SrsRtmpRaceCandidate : public ISrsCoroutineHandler
+{
+public:
+    std::string server;
+    SrsSimpleRtmpClient* sdk;
+    // Whether the connect is done, and its result and the time to connect.
+    bool done;
+    srs_error_t result;
+    srs_utime_t rtt;
+private:
+    SrsCoroutine* trd;
+    // To notify the racer when done.
+    srs_cond_t signal;
+public:
+    SrsRtmpRaceCandidate(std::string s, std::string url, srs_utime_t ctm, srs_utime_t stm, srs_cond_t c);
+    virtual ~SrsRtmpRaceCandidate();
+public:
+    virtual srs_error_t start();
+    virtual void stop();
+// Interface ISrsReusableThread2Handler
+public:
+    virtual srs_error_t cycle();
+};
+
+// Connect to the servers in race like the happy eyeballs of RFC 8305, to start connecting the next server
+// when the previous ones are not connected in the stagger delay, or failed. The first connected one wins
+// and others are cancelled, so a blackholed server never delays the user for the whole connect timeout.
+// The servers failed recently are tried at last, by the stat of servers which is shared by all racers.
+class SrsRtmpConnectRacer
+{
+private:
+    SrsLbServerStats* stats;
+    srs_utime_t stagger;
+    srs_cond_t signal;
+    std::vector<SrsRtmpRaceCandidate*> candidates;
+public:
+    SrsRtmpConnectRacer(SrsLbServerStats* s, srs_utime_t delay);
+    virtual ~SrsRtmpConnectRacer();
+public:
+    // Add the server to race, in the order of rank, for example, the selected one first.
+    virtual void add(std::string server, std::string url, srs_utime_t ctm, srs_utime_t stm);
+    // Race to connect the servers.
+    // @param psdk Output the connected client of winner, user should free it.
+    // @param server Output the server of winner.
+    // @param rtt Output the time to connect the winner.
+    virtual srs_error_t race(SrsSimpleRtmpClient** psdk, std::string& server, srs_utime_t& rtt);
+private:
+    virtual void cancel();
+};
+
+// The RTMP client of edge in mux protocol, which asks the origin to serve many streams in the connection.
+class SrsMuxRtmpClient : public SrsSimpleRtmpClient
+{
+public:
+    SrsMuxRtmpClient(std::string u, srs_utime_t ctm, srs_utime_t stm);
+    virtual ~SrsMuxRtmpClient();
+protected:
+    virtual srs_error_t connect_app();
+};
+
+// The stream played by the edge of mux protocol, in a message stream id of the connection.
+class SrsRtmpMuxStream
+{
+public:
+    int stream_id;
+    SrsRequest* req;
+    SrsConsumer* consumer;
+public:
+    SrsRtmpMuxStream(int sid, SrsRequest* r);
+    virtual ~SrsRtmpMuxStream();
+};
+
 // Some information of client.
 class SrsClientInfo
 {
@@ -104,6 +182,12 @@ private:
     srs_utime_t mw_sleep;
     // The MR(merged-write) only enabled for play.
     int mw_enabled;
+    // The adaptive MW(merged-write) window for play, NULL if disabled.
+    SrsMwAdaptive* mw_adaptive;
+    // The server-side ABR to switch the consumer between renditions, NULL if disabled.
+    SrsAbrSwitcher* abr;
+    // The capture of the bytes from publisher, NULL if no vhost captures.
+    SrsCaptureReadWriter* capture;
     // For realtime
     // @see https://github.com/ossrs/srs/issues/257
     bool realtime;
@@ -117,11 +201,22 @@ private:
     bool tcp_nodelay;
     // About the rtmp client.
     SrsClientInfo* info;
+    // The resolved settings of vhost, owned by config.
+    SrsVhostSnapshot* vhost_snapshot;
+    // The streams played by the edge of mux protocol, key is the message stream id.
+    std::map<int, SrsRtmpMuxStream*> mux_streams;
+    int mux_stream_id;
+    // The handle of client in statistic, to update the stat without lookup.
+    SrsStatisticHandle stat_handle;
+    // Whether accepted by the relay listener of worker, the only one trusts the relay mark.
+    bool worker_relay;
 public:
     SrsRtmpConn(SrsServer* svr, srs_netfd_t c, std::string cip);
     virtual ~SrsRtmpConn();
 public:
     virtual void dispose();
+    // Mark the connection is relayed from sibling worker.
+    virtual void set_worker_relay();
 protected:
     virtual srs_error_t do_cycle();
 // Interface ISrsReloadHandler
@@ -139,21 +234,35 @@ private:
     virtual srs_error_t service_cycle();
     // The stream(play/publish) service cycle, identify client first.
     virtual srs_error_t stream_service_cycle();
+    // Strip the internal marks of param, which are never trusted from client.
+    virtual void strip_untrusted_marks(SrsRequest* req);
+    // Serve the edge of mux protocol, which plays many streams in this connection.
+    virtual srs_error_t mux_service_cycle();
+    virtual srs_error_t do_mux_playing();
+    virtual srs_error_t mux_process_msg(SrsCommonMessage* msg);
+    virtual srs_error_t mux_play(int stream_id, std::string stream);
+    virtual void mux_close(int stream_id);
     virtual srs_error_t check_vhost(bool try_default_vhost);
     virtual srs_error_t playing(SrsSource* source);
-    virtual srs_error_t do_playing(SrsSource* source, SrsConsumer* consumer, SrsQueueRecvThread* trd);
+    // @param consumer The consumer of player, which is replaced when ABR switches the rendition.
+    virtual srs_error_t do_playing(SrsSource* source, SrsConsumer*& consumer);
     virtual srs_error_t publishing(SrsSource* source);
     virtual srs_error_t do_publishing(SrsSource* source, SrsPublishRecvThread* trd);
+    // Check the player by the admission control of egress.
+    virtual srs_error_t admission_check();
     virtual srs_error_t acquire_publish(SrsSource* source);
+    // Kickoff the replica of stream, for standby origin to accept the publisher.
+    virtual srs_error_t takeover_replica(SrsSource* source);
     virtual void release_publish(SrsSource* source);
     virtual srs_error_t handle_publish_message(SrsSource* source, SrsCommonMessage* msg);
     virtual srs_error_t process_publish_message(SrsSource* source, SrsCommonMessage* msg);
+    // Receive and process the control messages of player, such as pause, never block for the peer.
+    virtual srs_error_t recv_play_control_msgs(SrsConsumer* consumer);
     virtual srs_error_t process_play_control_msg(SrsConsumer* consumer, SrsCommonMessage* msg);
     virtual void change_mw_sleep(srs_utime_t sleep_v);
     virtual void set_sock_options();
 private:
     virtual srs_error_t check_edge_token_traverse_auth();
-    virtual srs_error_t do_token_traverse_auth(SrsRtmpClient* client);
 private:
     // When the connection disconnect, call this method.
     // e.g. log msg of connection and report to other system.
@@ -163,8 +272,8 @@ private:
     virtual void http_hooks_on_close();
     virtual srs_error_t http_hooks_on_publish();
     virtual void http_hooks_on_unpublish();
-    virtual srs_error_t http_hooks_on_play();
-    virtual void http_hooks_on_stop();
+    virtual srs_error_t http_hooks_on_play(SrsRequest* req);
+    virtual void http_hooks_on_stop(SrsRequest* req);
 };
 
 #endif
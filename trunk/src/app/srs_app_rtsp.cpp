@@ -43,23 +43,126 @@ using namespace std;
 #include <srs_kernel_codec.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_format.hpp>
 
-SrsRtpConn::SrsRtpConn(SrsRtspConn* r, int p, int sid)
+SrsRtpReorder::SrsRtpReorder(int d)
+{
+    depth = d;
+    ssrc = 0;
+    started = false;
+    next = 0;
+    nn_lost = 0;
+    nn_late = 0;
+}
+
+SrsRtpReorder::~SrsRtpReorder()
+{
+    clear();
+}
+
+void SrsRtpReorder::push(SrsRtpPacket* pkt)
+{
+    // Restart when the source changed.
+    if (started && pkt->ssrc != ssrc) {
+        srs_warn("rtp: ssrc changed %#x=>%#x, drop %d packets", ssrc, pkt->ssrc, (int)pkts.size());
+        clear();
+    }
+    
+    if (!started) {
+        started = true;
+        ssrc = pkt->ssrc;
+        next = pkt->sequence_number;
+    }
+    
+    // The extended sequence number, the distance to next is in [-32768, 32767].
+    int64_t seq = next + (int16_t)(pkt->sequence_number - (uint16_t)next);
+    
+    // Drop the late or duplicated packet.
+    if (seq < next || pkts.find(seq) != pkts.end()) {
+        nn_late++;
+        srs_freep(pkt);
+        return;
+    }
+    
+    pkts[seq] = pkt;
+}
+
+SrsRtpPacket* SrsRtpReorder::pop(bool* plost)
+{
+    *plost = false;
+    
+    if (pkts.empty()) {
+        return NULL;
+    }
+    
+    std::map<int64_t, SrsRtpPacket*>::iterator it = pkts.begin();
+    int64_t seq = it->first;
+    
+    // Wait for the lost packet, util the buffer is full.
+    if (seq != next) {
+        if ((int)pkts.size() <= depth) {
+            return NULL;
+        }
+        
+        *plost = true;
+        nn_lost += seq - next;
+    }
+    
+    SrsRtpPacket* pkt = it->second;
+    pkts.erase(it);
+    next = seq + 1;
+    
+    return pkt;
+}
+
+int SrsRtpReorder::size()
+{
+    return (int)pkts.size();
+}
+
+int64_t SrsRtpReorder::lost()
+{
+    return nn_lost;
+}
+
+int64_t SrsRtpReorder::late()
+{
+    return nn_late;
+}
+
+void SrsRtpReorder::clear()
+{
+    std::map<int64_t, SrsRtpPacket*>::iterator it;
+    for (it = pkts.begin(); it != pkts.end(); ++it) {
+        SrsRtpPacket* pkt = it->second;
+        srs_freep(pkt);
+    }
+    pkts.clear();
+    
+    started = false;
+}
+
+SrsRtpConn::SrsRtpConn(SrsRtspConn* r, int p, int sid, int depth)
 {
     rtsp = r;
     _port = p;
     stream_id = sid;
     // TODO: support listen at <[ip:]port>
     listener = new SrsUdpListener(this, srs_any_address_for_listener(), p);
+    // The camera sends lots of packets, receive them in batch.
+    listener->set_batch(SRS_PERF_UDP_BATCH);
+    reorder = new SrsRtpReorder(depth);
     cache = new SrsRtpPacket();
+    corrupt = false;
     pprint = SrsPithyPrint::create_caster();
 }
 
 SrsRtpConn::~SrsRtpConn()
 {
     srs_freep(listener);
+    srs_freep(reorder);
     srs_freep(cache);
     srs_freep(pprint);
 }
@@ -83,42 +186,92 @@ srs_error_t SrsRtpConn::on_udp_packet(const sockaddr* from, const int fromlen, c
     if (true) {
         SrsBuffer stream(buf, nb_buf);
         
-        SrsRtpPacket pkt;
-        if ((err = pkt.decode(&stream)) != srs_success) {
+        SrsRtpPacket* pkt = new SrsRtpPacket();
+        if ((err = pkt->decode(&stream)) != srs_success) {
+            srs_freep(pkt);
             return srs_error_wrap(err, "decode");
         }
         
-        if (pkt.chunked) {
-            if (!cache) {
-                cache = new SrsRtpPacket();
-            }
-            cache->copy(&pkt);
-            cache->payload->append(pkt.payload->bytes(), pkt.payload->length());
-            if (!cache->completed && pprint->can_print()) {
-                srs_trace("<- " SRS_CONSTS_LOG_STREAM_CASTER " rtsp: rtp chunked %dB, age=%d, vt=%d/%u, sts=%u/%#x/%#x, paylod=%dB",
-                          nb_buf, pprint->age(), cache->version, cache->payload_type, cache->sequence_number, cache->timestamp, cache->ssrc,
-                          cache->payload->length()
-                          );
-                return err;
+        reorder->push(pkt);
+    }
+    
+    // Consume the packets in sequence.
+    while (true) {
+        bool lost = false;
+        SrsRtpPacket* pkt = reorder->pop(&lost);
+        if (!pkt) {
+            break;
+        }
+        
+        SrsAutoFree(SrsRtpPacket, pkt);
+        if ((err = on_rtp_packet(pkt, lost)) != srs_success) {
+            return srs_error_wrap(err, "on rtp");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtpConn::on_rtp_packet(SrsRtpPacket* pkt, bool lost)
+{
+    srs_error_t err = srs_success;
+    
+    // The chunks of NALU is corrupt when lost.
+    if (lost && cache->payload->length() > 0) {
+        corrupt = true;
+    }
+    
+    if (pkt->chunked) {
+        // Reassemble in the cache, which starts from the first chunk.
+        if (pkt->chunk_start) {
+            cache->payload->erase(cache->payload->length());
+            corrupt = false;
+        } else if (cache->payload->length() == 0) {
+            corrupt = true;
+        }
+        
+        cache->copy(pkt);
+        cache->payload->append(pkt->payload->bytes(), pkt->payload->length());
+        
+        if (!cache->completed) {
+            if (pprint->can_print()) {
+                srs_trace("<- " SRS_CONSTS_LOG_STREAM_CASTER " rtsp: rtp chunked, age=%d, vt=%d/%u, sts=%u/%#x/%#x, paylod=%dB",
+                    pprint->age(), cache->version, cache->payload_type, cache->sequence_number, cache->timestamp, cache->ssrc,
+                    cache->payload->length());
             }
-        } else {
-            srs_freep(cache);
-            cache = new SrsRtpPacket();
-            cache->reap(&pkt);
+            return err;
         }
+        
+        // Drop the corrupt NALU, and reuse the buffer of cache.
+        if (corrupt) {
+            srs_warn("rtsp: drop corrupt NALU #%d %dB, ts=%u, lost=%" PRId64, stream_id, cache->payload->length(),
+                cache->timestamp, reorder->lost());
+            cache->payload->erase(cache->payload->length());
+            corrupt = false;
+            return err;
+        }
+        
+        pkt = cache;
     }
     
     if (pprint->can_print()) {
-        srs_trace("<- " SRS_CONSTS_LOG_STREAM_CASTER " rtsp: rtp #%d %dB, age=%d, vt=%d/%u, sts=%u/%u/%#x, paylod=%dB, chunked=%d",
-                  stream_id, nb_buf, pprint->age(), cache->version, cache->payload_type, cache->sequence_number, cache->timestamp, cache->ssrc,
-                  cache->payload->length(), cache->chunked
-                  );
+        srs_trace("<- " SRS_CONSTS_LOG_STREAM_CASTER " rtsp: rtp #%d, age=%d, vt=%d/%u, sts=%u/%u/%#x, paylod=%dB, chunked=%d, lost=%" PRId64 ", late=%" PRId64,
+            stream_id, pprint->age(), pkt->version, pkt->payload_type, pkt->sequence_number, pkt->timestamp, pkt->ssrc,
+            pkt->payload->length(), pkt->chunked, reorder->lost(), reorder->late());
     }
     
-    // always free it.
-    SrsAutoFree(SrsRtpPacket, cache);
+    err = rtsp->on_rtp_packet(pkt, stream_id);
+    
+    // Reuse the buffer of cache for next NALU, which may be reaped by audio.
+    if (pkt == cache) {
+        if (cache->payload) {
+            cache->payload->erase(cache->payload->length());
+        } else {
+            cache->payload = new SrsSimpleStream();
+        }
+    }
     
-    if ((err = rtsp->on_rtp_packet(cache, stream_id)) != srs_success) {
+    if (err != srs_success) {
         return srs_error_wrap(err, "process rtp packet");
     }
     
@@ -175,7 +328,7 @@ srs_error_t SrsRtspJitter::correct(int64_t& ts)
     return err;
 }
 
-SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o)
+SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o, ISrsSourceHandler* h)
 {
     output_template = o;
     
@@ -187,10 +340,11 @@ SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o)
     stfd = fd;
     skt = new SrsStSocket();
     rtsp = new SrsRtspStack(skt);
-    trd = new SrsSTCoroutine("rtsp", this);
+    SrsSTCoroutine* st = new SrsSTCoroutine("rtsp", this);
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
     
-    req = NULL;
-    sdk = NULL;
+    publisher = new SrsLocalPublisher(h);
     vjitter = new SrsRtspJitter();
     ajitter = new SrsRtspJitter();
     
@@ -213,8 +367,7 @@ SrsRtspConn::~SrsRtspConn()
     srs_freep(skt);
     srs_freep(rtsp);
     
-    srs_freep(sdk);
-    srs_freep(req);
+    srs_freep(publisher);
     
     srs_freep(vjitter);
     srs_freep(ajitter);
@@ -242,12 +395,15 @@ srs_error_t SrsRtspConn::do_cycle()
     srs_error_t err = srs_success;
     
     // retrieve ip of client.
-    std::string ip = srs_get_peer_ip(srs_netfd_fileno(stfd));
+    ip = srs_get_peer_ip(srs_netfd_fileno(stfd));
     if (ip.empty() && !_srs_config->empty_ip_ok()) {
         srs_warn("empty ip for fd=%d", srs_netfd_fileno(stfd));
     }
     srs_trace("rtsp: serve %s", ip.c_str());
     
+    // The RTP packets are received by other coroutines, so use the id of connection for statistic.
+    publisher->set_client(_srs_context->get_id(), NULL);
+    
     // consume all rtsp messages.
     while (true) {
         if ((err = trd->pull()) != srs_success) {
@@ -308,10 +464,10 @@ srs_error_t SrsRtspConn::do_cycle()
             SrsRtpConn* rtp = NULL;
             if (req->stream_id == video_id) {
                 srs_freep(video_rtp);
-                rtp = video_rtp = new SrsRtpConn(this, lpm, video_id);
+                rtp = video_rtp = new SrsRtpConn(this, lpm, video_id, caster->rtp_reorder_depth());
             } else {
                 srs_freep(audio_rtp);
-                rtp = audio_rtp = new SrsRtpConn(this, lpm, audio_id);
+                rtp = audio_rtp = new SrsRtpConn(this, lpm, audio_id, caster->rtp_reorder_depth());
             }
             if ((err = rtp->listen()) != srs_success) {
                 return srs_error_wrap(err, "rtp listen");
@@ -418,6 +574,12 @@ srs_error_t SrsRtspConn::on_rtp_video(SrsRtpPacket* pkt, int64_t dts, int64_t pt
     int length = pkt->payload->length();
     uint32_t fdts = (uint32_t)(dts / 90);
     uint32_t fpts = (uint32_t)(pts / 90);
+    
+    // The STAP-A, aggregation of NALUs, @see rfc6184 5.7.1.
+    if (length > 0 && (bytes[0] & 0x1f) == 24) {
+        return on_rtp_video_stap(bytes + 1, length - 1, fdts, fpts);
+    }
+    
     if ((err = write_h264_ipb_frame(bytes, length, fdts, fpts)) != srs_success) {
         return srs_error_wrap(err, "write ibp frame");
     }
@@ -425,6 +587,27 @@ srs_error_t SrsRtspConn::on_rtp_video(SrsRtpPacket* pkt, int64_t dts, int64_t pt
     return err;
 }
 
+srs_error_t SrsRtspConn::on_rtp_video_stap(char* bytes, int length, uint32_t dts, uint32_t pts)
+{
+    srs_error_t err = srs_success;
+    
+    // Each NALU is 16bits size in network order, then the NALU.
+    SrsBuffer stream(bytes, length);
+    while (stream.require(2)) {
+        int size = (uint16_t)stream.read_2bytes();
+        if (size <= 0 || !stream.require(size)) {
+            return srs_error_new(ERROR_RTP_TYPE96_CORRUPT, "stap-a requires %d only %d bytes", size, stream.left());
+        }
+        
+        if ((err = write_h264_ipb_frame(stream.data() + stream.pos(), size, dts, pts)) != srs_success) {
+            return srs_error_wrap(err, "write ibp frame");
+        }
+        stream.skip(size);
+    }
+    
+    return err;
+}
+
 srs_error_t SrsRtspConn::on_rtp_audio(SrsRtpPacket* pkt, int64_t dts)
 {
     srs_error_t err = srs_success;
@@ -612,15 +795,16 @@ srs_error_t SrsRtspConn::rtmp_write_packet(char type, uint32_t timestamp, char*
         return srs_error_wrap(err, "connect");
     }
     
-    SrsSharedPtrMessage* msg = NULL;
+    SrsCommonMessage* msg = NULL;
     
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, &msg)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
     srs_assert(msg);
+    SrsAutoFree(SrsCommonMessage, msg);
     
-    // send out encoded msg.
-    if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+    // publish the encoded msg to source.
+    if ((err = publisher->on_message(msg)) != srs_success) {
         close();
         return srs_error_wrap(err, "write message");
     }
@@ -632,38 +816,27 @@ srs_error_t SrsRtspConn::connect()
 {
     srs_error_t err = srs_success;
     
-    // Ignore when connected.
-    if (sdk) {
+    // Ignore when published.
+    if (publisher->published()) {
         return err;
     }
     
-    // generate rtmp url to connect to.
-    std::string url;
-    if (!req) {
-        std::string schema, host, vhost, app, param;
-        int port;
-        srs_discovery_tc_url(rtsp_tcUrl, schema, host, vhost, app, rtsp_stream, port, param);
-
-        // generate output by template.
-        std::string output = output_template;
-        output = srs_string_replace(output, "[app]", app);
-        output = srs_string_replace(output, "[stream]", rtsp_stream);
-    }
+    // generate output by template.
+    std::string schema, host, vhost, app, param;
+    int port;
+    srs_discovery_tc_url(rtsp_tcUrl, schema, host, vhost, app, rtsp_stream, port, param);
     
-    // connect host.
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(url, cto, sto);
+    std::string output = output_template;
+    output = srs_string_replace(output, "[app]", app);
+    output = srs_string_replace(output, "[stream]", rtsp_stream);
     
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
+    if ((err = publisher->initialize(output, ip)) != srs_success) {
+        return srs_error_wrap(err, "init publisher");
     }
     
-    // publish.
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
-        return srs_error_wrap(err, "publish %s failed", url.c_str());
+    // publish to source in process.
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish %s failed", output.c_str());
     }
     
     return write_sequence_header();
@@ -671,15 +844,17 @@ srs_error_t SrsRtspConn::connect()
 
 void SrsRtspConn::close()
 {
-    srs_freep(sdk);
+    publisher->unpublish();
 }
 
-SrsRtspCaster::SrsRtspCaster(SrsConfDirective* c)
+SrsRtspCaster::SrsRtspCaster(ISrsSourceHandler* h, SrsConfDirective* c)
 {
+    handler = h;
     // TODO: FIXME: support reload.
     output = _srs_config->get_stream_caster_output(c);
     local_port_min = _srs_config->get_stream_caster_rtp_port_min(c);
     local_port_max = _srs_config->get_stream_caster_rtp_port_max(c);
+    reorder_depth = _srs_config->get_stream_caster_rtp_reorder_depth(c);
 }
 
 SrsRtspCaster::~SrsRtspCaster()
@@ -719,11 +894,16 @@ void SrsRtspCaster::free_port(int lpmin, int lpmax)
     srs_trace("rtsp: free rtp port=%d-%d", lpmin, lpmax);
 }
 
+int SrsRtspCaster::rtp_reorder_depth()
+{
+    return reorder_depth;
+}
+
 srs_error_t SrsRtspCaster::on_tcp_client(srs_netfd_t stfd)
 {
     srs_error_t err = srs_success;
     
-    SrsRtspConn* conn = new SrsRtspConn(this, stfd, output);
+    SrsRtspConn* conn = new SrsRtspConn(this, stfd, output, handler);
     
     if ((err = conn->serve()) != srs_success) {
         srs_freep(conn);
@@ -50,7 +50,41 @@ class SrsSharedPtrMessage;
 class SrsAudioFrame;
 class SrsSimpleStream;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class ISrsSourceHandler;
+class SrsLocalPublisher;
+
+// The reorder buffer for RTP packets of a SSRC, because the UDP packets maybe out of order.
+// The packets are delivered in sequence, and the lost ones are skipped when buffer is full.
+class SrsRtpReorder
+{
+private:
+    // The max number of packets to wait for the lost one.
+    int depth;
+    uint32_t ssrc;
+    bool started;
+    // The extended sequence number of next packet to deliver.
+    int64_t next;
+    // The key: extended sequence number, value: packet.
+    std::map<int64_t, SrsRtpPacket*> pkts;
+private:
+    int64_t nn_lost;
+    int64_t nn_late;
+public:
+    SrsRtpReorder(int d);
+    virtual ~SrsRtpReorder();
+public:
+    // Push the packet, which is owned by reorder, and it's freed when late or duplicated.
+    virtual void push(SrsRtpPacket* pkt);
+    // Pop the next packet in sequence, NULL if no packet is ready.
+    // @param plost Output whether there are packets lost before it.
+    // @remark User must free the packet.
+    virtual SrsRtpPacket* pop(bool* plost);
+    virtual int size();
+    virtual int64_t lost();
+    virtual int64_t late();
+private:
+    virtual void clear();
+};
 
 // A rtp connection which transport a stream.
 class SrsRtpConn: public ISrsUdpHandler
@@ -59,11 +93,15 @@ private:
     SrsPithyPrint* pprint;
     SrsUdpListener* listener;
     SrsRtspConn* rtsp;
+    SrsRtpReorder* reorder;
+    // The chunked packet to reassemble the NALU, reused for each NALU.
     SrsRtpPacket* cache;
+    // Whether the chunks of cache is corrupt, for some packets are lost.
+    bool corrupt;
     int stream_id;
     int _port;
 public:
-    SrsRtpConn(SrsRtspConn* r, int p, int sid);
+    SrsRtpConn(SrsRtspConn* r, int p, int sid, int depth);
     virtual ~SrsRtpConn();
 public:
     virtual int port();
@@ -71,6 +109,8 @@ public:
 // Interface ISrsUdpHandler
 public:
     virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
+private:
+    virtual srs_error_t on_rtp_packet(SrsRtpPacket* pkt, bool lost);
 };
 
 // The audio cache, audio is grouped by frames.
@@ -124,9 +164,10 @@ private:
     SrsRtspStack* rtsp;
     SrsRtspCaster* caster;
     SrsCoroutine* trd;
+    std::string ip;
 private:
-    SrsRequest* req;
-    SrsSimpleRtmpClient* sdk;
+    // The publisher to publish stream to source in process.
+    SrsLocalPublisher* publisher;
     SrsRtspJitter* vjitter;
     SrsRtspJitter* ajitter;
 private:
@@ -139,7 +180,7 @@ private:
     std::string aac_specific_config;
     SrsRtspAudioCache* acache;
 public:
-    SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o);
+    SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o, ISrsSourceHandler* h);
     virtual ~SrsRtspConn();
 public:
     virtual srs_error_t serve();
@@ -153,6 +194,7 @@ public:
     virtual srs_error_t cycle();
 private:
     virtual srs_error_t on_rtp_video(SrsRtpPacket* pkt, int64_t dts, int64_t pts);
+    virtual srs_error_t on_rtp_video_stap(char* bytes, int length, uint32_t dts, uint32_t pts);
     virtual srs_error_t on_rtp_audio(SrsRtpPacket* pkt, int64_t dts);
     virtual srs_error_t kickoff_audio_cache(SrsRtpPacket* pkt, int64_t dts);
 private:
@@ -162,9 +204,9 @@ private:
     virtual srs_error_t write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts);
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Publish to source, when got the first packet.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Unpublish the source.
     virtual void close();
 };
 
@@ -172,15 +214,17 @@ private:
 class SrsRtspCaster : public ISrsTcpHandler
 {
 private:
+    ISrsSourceHandler* handler;
     std::string output;
     int local_port_min;
     int local_port_max;
+    int reorder_depth;
     // The key: port, value: whether used.
     std::map<int, bool> used_ports;
 private:
     std::vector<SrsRtspConn*> clients;
 public:
-    SrsRtspCaster(SrsConfDirective* c);
+    SrsRtspCaster(ISrsSourceHandler* h, SrsConfDirective* c);
     virtual ~SrsRtspCaster();
 public:
     // Alloc a rtp port from local ports pool.
@@ -188,6 +232,8 @@ public:
     virtual srs_error_t alloc_port(int* pport);
     // Free the alloced rtp port.
     virtual void free_port(int lpmin, int lpmax);
+    // The depth of reorder buffer for rtp packets.
+    virtual int rtp_reorder_depth();
 // Interface ISrsTcpHandler
 public:
     virtual srs_error_t on_tcp_client(srs_netfd_t stfd);
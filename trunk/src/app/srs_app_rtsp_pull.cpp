@@ -0,0 +1,1437 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_rtsp_pull.hpp>
+
+#include <stdlib.h>
+#include <strings.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <openssl/evp.h>
+#include <openssl/md5.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtsp_stack.hpp>
+#include <srs_raw_avc.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_service_st.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_rtsp.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_app_pithy_print.hpp>
+#include <srs_core_autofree.hpp>
+
+// The default port of rtsp.
+#define SRS_RTSP_PULL_DEFAULT_PORT 554
+// The interval in srs_utime_t to retry when pull failed.
+#define SRS_RTSP_PULL_CIMS (3 * SRS_UTIME_SECONDS)
+// The interval in srs_utime_t to check the RTP packets of UDP.
+#define SRS_RTSP_PULL_CHECK (1 * SRS_UTIME_SECONDS)
+// The default timeout in seconds of session, to send keepalive in half of it.
+#define SRS_RTSP_PULL_SESSION_TIMEOUT 60
+
+srs_error_t srs_rtsp_parse_url(string url, string& pure, string& user, string& pass, string& host, int& port)
+{
+    srs_error_t err = srs_success;
+    
+    const string schema = "rtsp://";
+    if (!srs_string_starts_with(url, schema)) {
+        return srs_error_new(ERROR_HTTP_PARSE_URI, "invalid rtsp url %s", url.c_str());
+    }
+    
+    // The authority is [user:pass@]host[:port], then the path.
+    string authority = url.substr(schema.length());
+    string path;
+    size_t pos = authority.find("/");
+    if (pos != string::npos) {
+        path = authority.substr(pos);
+        authority = authority.substr(0, pos);
+    }
+    
+    user = pass = "";
+    if ((pos = authority.rfind("@")) != string::npos) {
+        string userinfo = authority.substr(0, pos);
+        authority = authority.substr(pos + 1);
+        
+        user = userinfo;
+        if ((pos = userinfo.find(":")) != string::npos) {
+            user = userinfo.substr(0, pos);
+            pass = userinfo.substr(pos + 1);
+        }
+    }
+    
+    host = authority;
+    port = SRS_RTSP_PULL_DEFAULT_PORT;
+    if ((pos = authority.rfind(":")) != string::npos) {
+        host = authority.substr(0, pos);
+        port = ::atoi(authority.substr(pos + 1).c_str());
+    }
+    
+    if (host.empty() || port <= 0) {
+        return srs_error_new(ERROR_HTTP_PARSE_URI, "invalid rtsp url %s, host=%s, port=%d", url.c_str(), host.c_str(), port);
+    }
+    
+    pure = schema + authority + path;
+    
+    return err;
+}
+
+string srs_rtsp_resolve_control(string base, string control)
+{
+    if (control.empty() || control == "*") {
+        return base;
+    }
+    
+    if (srs_string_starts_with(control, "rtsp://")) {
+        return control;
+    }
+    
+    if (!srs_string_ends_with(base, "/")) {
+        base += "/";
+    }
+    
+    return base + control;
+}
+
+// Calculate the MD5 of data, in lowercase hex.
+static string srs_rtsp_md5(string data)
+{
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned int nn_digest = 0;
+    EVP_Digest(data.data(), data.length(), digest, &nn_digest, EVP_md5(), NULL);
+    
+    char hex[MD5_DIGEST_LENGTH * 2 + 1];
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+    
+    return string(hex, MD5_DIGEST_LENGTH * 2);
+}
+
+// Get the param of WWW-Authenticate, for example, realm="Camera", nonce="abc"
+static string srs_rtsp_auth_param(string authenticate, string key)
+{
+    size_t pos = string::npos;
+    string token = authenticate;
+    
+    while (!token.empty()) {
+        if ((pos = token.find(key + "=")) == string::npos) {
+            break;
+        }
+        
+        // Ignore the key which is suffix of other key, for example, the nonce of cnonce.
+        if (pos > 0 && token.at(pos - 1) != ' ' && token.at(pos - 1) != ',') {
+            token = token.substr(pos + key.length());
+            continue;
+        }
+        
+        string value = token.substr(pos + key.length() + 1);
+        if (!value.empty() && value.at(0) == '"') {
+            value = value.substr(1);
+            if ((pos = value.find("\"")) != string::npos) {
+                value = value.substr(0, pos);
+            }
+        } else if ((pos = value.find(",")) != string::npos) {
+            value = value.substr(0, pos);
+        }
+        
+        return value;
+    }
+    
+    return "";
+}
+
+string srs_rtsp_authorization(string authenticate, string user, string pass, string method, string uri)
+{
+    if (srs_string_starts_with(authenticate, "Basic")) {
+        string plaintext = user + ":" + pass;
+        
+        string cipher;
+        cipher.resize(4 * ((plaintext.length() + 2) / 3) + 1);
+        int nn_cipher = EVP_EncodeBlock((unsigned char*)cipher.data(), (const unsigned char*)plaintext.data(), (int)plaintext.length());
+        cipher.resize(srs_max(0, nn_cipher));
+        
+        return "Basic " + cipher;
+    }
+    
+    if (!srs_string_starts_with(authenticate, "Digest")) {
+        return "";
+    }
+    
+    // 3.2.2 The Authorization Request Header, @see rfc2617-1999-http-auth.pdf, page 11
+    string realm = srs_rtsp_auth_param(authenticate, "realm");
+    string nonce = srs_rtsp_auth_param(authenticate, "nonce");
+    string opaque = srs_rtsp_auth_param(authenticate, "opaque");
+    string qop = srs_rtsp_auth_param(authenticate, "qop");
+    
+    string ha1 = srs_rtsp_md5(user + ":" + realm + ":" + pass);
+    string ha2 = srs_rtsp_md5(method + ":" + uri);
+    
+    std::stringstream ss;
+    ss << "Digest username=\"" << user << "\", realm=\"" << realm << "\", nonce=\"" << nonce << "\", uri=\"" << uri << "\"";
+    
+    // Only support qop auth, and the nc is always 1, which is accepted by most cameras.
+    if (qop.find("auth") != string::npos) {
+        string nc = "00000001";
+        string cnonce = srs_rtsp_md5(nonce + ":" + srs_int2str(srs_get_system_time())).substr(0, 16);
+        string response = srs_rtsp_md5(ha1 + ":" + nonce + ":" + nc + ":" + cnonce + ":auth:" + ha2);
+        ss << ", response=\"" << response << "\", qop=auth, nc=" << nc << ", cnonce=\"" << cnonce << "\"";
+    } else {
+        string response = srs_rtsp_md5(ha1 + ":" + nonce + ":" + ha2);
+        ss << ", response=\"" << response << "\"";
+    }
+    
+    if (!opaque.empty()) {
+        ss << ", opaque=\"" << opaque << "\"";
+    }
+    
+    return ss.str();
+}
+
+// Get the raw address of peer, the IPv4 mapped IPv6 address is converted to IPv4.
+static string srs_rtsp_raw_ip(const sockaddr* from, int* pport)
+{
+    if (from->sa_family == AF_INET) {
+        const sockaddr_in* addr = (const sockaddr_in*)from;
+        *pport = ntohs(addr->sin_port);
+        return string((const char*)&addr->sin_addr, 4);
+    }
+    
+    if (from->sa_family == AF_INET6) {
+        const sockaddr_in6* addr = (const sockaddr_in6*)from;
+        *pport = ntohs(addr->sin6_port);
+        if (IN6_IS_ADDR_V4MAPPED(&addr->sin6_addr)) {
+            return string((const char*)&addr->sin6_addr + 12, 4);
+        }
+        return string((const char*)&addr->sin6_addr, 16);
+    }
+    
+    *pport = 0;
+    return "";
+}
+
+// Read the bits from bytes, in network order.
+static uint32_t srs_rtsp_read_bits(uint8_t* p, int offset, int nn_bits)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < nn_bits; i++) {
+        int bit = offset + i;
+        v = (v << 1) | ((p[bit / 8] >> (7 - bit % 8)) & 0x01);
+    }
+    return v;
+}
+
+SrsRtspPullTrack::SrsRtspPullTrack(SrsRtspPuller* p, bool video, int depth)
+{
+    puller = p;
+    is_video = video;
+    payload_type = -1;
+    clock_rate = video? 90000 : 44100;
+    channel = -1;
+    has_ssrc = false;
+    ssrc = 0;
+    peer_port = 0;
+    size_length = 13;
+    index_length = 3;
+    
+    reorder = new SrsRtpReorder(depth);
+    corrupt = false;
+    started = false;
+    previous = 0;
+    ticks = 0;
+    base = 0;
+    
+    nn_packets = 0;
+    last_packet = 0;
+}
+
+SrsRtspPullTrack::~SrsRtspPullTrack()
+{
+    srs_freep(reorder);
+}
+
+srs_error_t SrsRtspPullTrack::on_rtp(char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    if (true) {
+        SrsBuffer stream(buf, nb_buf);
+        
+        SrsRtpPacket* pkt = new SrsRtpPacket();
+        if ((err = pkt->decode_raw(&stream)) != srs_success) {
+            srs_freep(pkt);
+            return srs_error_wrap(err, "decode");
+        }
+        
+        // Ignore the packets of other payload types, for example, the comfort noise.
+        if (payload_type >= 0 && pkt->payload_type != payload_type) {
+            srs_freep(pkt);
+            return err;
+        }
+        
+        nn_packets++;
+        last_packet = srs_get_system_time();
+        
+        // The interleaved packets are in order, so they are delivered immediately.
+        reorder->push(pkt);
+    }
+    
+    // Consume the packets in sequence.
+    while (true) {
+        bool lost = false;
+        SrsRtpPacket* pkt = reorder->pop(&lost);
+        if (!pkt) {
+            break;
+        }
+        
+        SrsAutoFree(SrsRtpPacket, pkt);
+        if ((err = on_rtp_packet(pkt, lost)) != srs_success) {
+            return srs_error_wrap(err, "on rtp");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPullTrack::on_rtp_packet(SrsRtpPacket* pkt, bool lost)
+{
+    int64_t dts = timestamp(pkt->timestamp);
+    
+    if (is_video) {
+        return on_h264(pkt, lost, dts);
+    }
+    return on_aac(pkt, dts);
+}
+
+srs_error_t SrsRtspPullTrack::on_h264(SrsRtpPacket* pkt, bool lost, int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    char* p = pkt->payload->bytes();
+    int size = pkt->payload->length();
+    if (size < 1) {
+        return err;
+    }
+    
+    // 5.2. Common Structure of the RTP Payload Format, @see rfc6184-2011-h264-rtp.pdf, page 13
+    uint8_t nalu_type = p[0] & 0x1f;
+    
+    if (nalu_type >= 1 && nalu_type <= 23) {
+        // Single NAL Unit Packet.
+        if ((err = puller->on_video_nalu(p, size, dts)) != srs_success) {
+            return srs_error_wrap(err, "single nalu");
+        }
+    } else if (nalu_type == 24) {
+        // 5.7.1. Single-Time Aggregation Packet (STAP-A), the NALUs with 2bytes size.
+        for (int pos = 1; pos + 2 <= size;) {
+            int nn_nalu = ((uint8_t)p[pos] << 8) | (uint8_t)p[pos + 1];
+            pos += 2;
+            if (nn_nalu <= 0 || pos + nn_nalu > size) {
+                break;
+            }
+            if ((err = puller->on_video_nalu(p + pos, nn_nalu, dts)) != srs_success) {
+                return srs_error_wrap(err, "stap-a nalu");
+            }
+            pos += nn_nalu;
+        }
+    } else if (nalu_type == 28 && size >= 2) {
+        // 5.8. Fragmentation Units (FU-A), the FU indicator, FU header, then FU payload.
+        bool start = (p[1] & 0x80) == 0x80;
+        bool end = (p[1] & 0x40) == 0x40;
+        
+        if (start) {
+            fua.assign(1, (char)((p[0] & 0xe0) | (p[1] & 0x1f)));
+            corrupt = false;
+        } else if (lost || fua.empty()) {
+            corrupt = true;
+        }
+        
+        if (!corrupt) {
+            fua.append(p + 2, size - 2);
+        }
+        
+        if (end) {
+            // Drop the corrupt NALU, the decoder will recover from next keyframe.
+            if (corrupt) {
+                srs_warn("rtsp: drop corrupt NALU %dB, ts=%u, lost=%" PRId64, (int)fua.length(), pkt->timestamp, reorder->lost());
+            } else if ((err = puller->on_video_nalu((char*)fua.data(), (int)fua.length(), dts)) != srs_success) {
+                return srs_error_wrap(err, "fu-a nalu");
+            }
+            fua.clear();
+            corrupt = false;
+        }
+    }
+    
+    // The marker is set for the last packet of frame.
+    if (pkt->marker) {
+        if ((err = puller->flush_video()) != srs_success) {
+            return srs_error_wrap(err, "flush video");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPullTrack::on_aac(SrsRtpPacket* pkt, int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    uint8_t* p = (uint8_t*)pkt->payload->bytes();
+    int size = pkt->payload->length();
+    
+    // 3.2.1. The AU Header Section, @see rfc3640-2003-mpeg4-rtp.pdf, page 13
+    // The AU-headers-length is 16 bits in bits, then AU-headers, each is size + index.
+    int nn_au_header = size_length + index_length;
+    if (size < 2 || nn_au_header <= 0) {
+        return err;
+    }
+    
+    int nn_headers_bits = (p[0] << 8) | p[1];
+    int nn_headers_bytes = (nn_headers_bits + 7) / 8;
+    if (2 + nn_headers_bytes > size) {
+        return err;
+    }
+    
+    // The frames follow the headers, each AAC frame is 1024 samples.
+    int pos = 2 + nn_headers_bytes;
+    for (int i = 0; i < nn_headers_bits / nn_au_header; i++) {
+        int nn_frame = (int)srs_rtsp_read_bits(p + 2, i * nn_au_header, size_length);
+        if (nn_frame <= 0 || pos + nn_frame > size) {
+            break;
+        }
+        
+        int64_t timestamp = dts + (int64_t)i * 1024 * 1000 / clock_rate;
+        if ((err = puller->on_audio_frame((char*)p + pos, nn_frame, timestamp)) != srs_success) {
+            return srs_error_wrap(err, "audio frame");
+        }
+        pos += nn_frame;
+    }
+    
+    return err;
+}
+
+int64_t SrsRtspPullTrack::timestamp(uint32_t ts)
+{
+    // The base is the time of first packet since play, to sync the tracks.
+    if (!started) {
+        started = true;
+        previous = ts;
+        ticks = 0;
+        base = srsu2ms(srs_get_system_time() - puller->start_time);
+    }
+    
+    // The delta is signed, for the timestamp wraps.
+    ticks += (int32_t)(ts - previous);
+    previous = ts;
+    
+    return base + ticks * 1000 / clock_rate;
+}
+
+// The handler to drop the RTCP packets.
+class SrsRtcpSink : public ISrsUdpHandler
+{
+public:
+    SrsRtcpSink() {
+    }
+    virtual ~SrsRtcpSink() {
+    }
+public:
+    virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf) {
+        return srs_success;
+    }
+};
+
+SrsRtpMux::SrsRtpMux(int p)
+{
+    port = p;
+    listened = false;
+    sink = new SrsRtcpSink();
+    
+    // The cameras send lots of packets, receive them in batch.
+    rtp = new SrsUdpListener(this, srs_any_address_for_listener(), p);
+    rtp->set_batch(SRS_PERF_UDP_BATCH);
+    rtcp = new SrsUdpListener(sink, srs_any_address_for_listener(), p + 1);
+    
+    nn_tracks = 0;
+    nn_dropped = 0;
+}
+
+SrsRtpMux::~SrsRtpMux()
+{
+    srs_freep(rtp);
+    srs_freep(rtcp);
+    srs_freep(sink);
+}
+
+int SrsRtpMux::rtp_port()
+{
+    return port;
+}
+
+int SrsRtpMux::size()
+{
+    return nn_tracks;
+}
+
+srs_error_t SrsRtpMux::listen()
+{
+    srs_error_t err = srs_success;
+    
+    if (listened) {
+        return err;
+    }
+    
+    if ((err = rtp->listen()) != srs_success) {
+        return srs_error_wrap(err, "listen rtp port=%d", port);
+    }
+    
+    if ((err = rtcp->listen()) != srs_success) {
+        return srs_error_wrap(err, "listen rtcp port=%d", port + 1);
+    }
+    
+    listened = true;
+    srs_trace("rtsp: shared rtp port=%d, rtcp=%d", port, port + 1);
+    
+    return err;
+}
+
+void SrsRtpMux::add(SrsRtspPullTrack* track)
+{
+    if (track->has_ssrc) {
+        ssrcs.insert(std::make_pair(track->ssrc, track));
+    } else {
+        peers.insert(std::make_pair(track->peer_ip, track));
+    }
+    nn_tracks++;
+}
+
+void SrsRtpMux::remove(SrsRtspPullTrack* track)
+{
+    bool found = false;
+    
+    std::multimap<uint32_t, SrsRtspPullTrack*>::iterator it;
+    for (it = ssrcs.lower_bound(track->ssrc); it != ssrcs.upper_bound(track->ssrc); ++it) {
+        if (it->second == track) {
+            ssrcs.erase(it);
+            found = true;
+            break;
+        }
+    }
+    
+    std::multimap<std::string, SrsRtspPullTrack*>::iterator it2;
+    for (it2 = peers.lower_bound(track->peer_ip); !found && it2 != peers.upper_bound(track->peer_ip); ++it2) {
+        if (it2->second == track) {
+            peers.erase(it2);
+            found = true;
+            break;
+        }
+    }
+    
+    if (found) {
+        nn_tracks--;
+    }
+}
+
+srs_error_t SrsRtpMux::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    // Atleast 12bytes header, and the version is 2.
+    if (nb_buf < 12 || ((uint8_t)buf[0] >> 6) != 2) {
+        nn_dropped++;
+        return err;
+    }
+    
+    uint8_t* p = (uint8_t*)buf;
+    int pt = p[1] & 0x7f;
+    uint32_t ssrc = ((uint32_t)p[8] << 24) | ((uint32_t)p[9] << 16) | ((uint32_t)p[10] << 8) | p[11];
+    
+    SrsRtspPullTrack* track = find(from, ssrc, pt);
+    if (!track) {
+        if ((nn_dropped++ % 1000) == 0) {
+            srs_warn("rtsp: port=%d drop unknown rtp ssrc=%#x, pt=%d, dropped=%" PRId64, port, ssrc, pt, nn_dropped);
+        }
+        return err;
+    }
+    
+    // Ignore the error of packet, which should never affect other tracks.
+    if ((err = track->on_rtp(buf, nb_buf)) != srs_success) {
+        srs_warn("rtsp: ignore rtp ssrc=%#x, %s", ssrc, srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    return err;
+}
+
+SrsRtspPullTrack* SrsRtpMux::find(const sockaddr* from, uint32_t ssrc, int pt)
+{
+    int from_port = 0;
+    std::string ip = srs_rtsp_raw_ip(from, &from_port);
+    
+    // Generally, the SSRC is unique, but we check the address for collision.
+    std::multimap<uint32_t, SrsRtspPullTrack*>::iterator it;
+    for (it = ssrcs.lower_bound(ssrc); it != ssrcs.end() && it->first == ssrc; ++it) {
+        SrsRtspPullTrack* track = it->second;
+        if (track->peer_ip.empty() || track->peer_ip == ip) {
+            return track;
+        }
+    }
+    
+    // Learn the SSRC by the address and payload type, because the video and audio are
+    // from the same address, maybe without the server port.
+    std::multimap<std::string, SrsRtspPullTrack*>::iterator it2;
+    for (it2 = peers.lower_bound(ip); it2 != peers.end() && it2->first == ip; ++it2) {
+        SrsRtspPullTrack* track = it2->second;
+        if (track->payload_type != pt) {
+            continue;
+        }
+        if (track->peer_port && track->peer_port != from_port) {
+            continue;
+        }
+        
+        peers.erase(it2);
+        learn(track, ssrc);
+        return track;
+    }
+    
+    return NULL;
+}
+
+void SrsRtpMux::learn(SrsRtspPullTrack* track, uint32_t ssrc)
+{
+    track->has_ssrc = true;
+    track->ssrc = ssrc;
+    ssrcs.insert(std::make_pair(ssrc, track));
+    
+    srs_trace("rtsp: port=%d learn ssrc=%#x, pt=%d, control=%s", port, ssrc, track->payload_type, track->control.c_str());
+}
+
+SrsRtpMuxPool* SrsRtpMuxPool::_instance = NULL;
+
+SrsRtpMuxPool::SrsRtpMuxPool()
+{
+    initialized = false;
+}
+
+SrsRtpMuxPool::~SrsRtpMuxPool()
+{
+    std::vector<SrsRtpMux*>::iterator it;
+    for (it = muxes.begin(); it != muxes.end(); ++it) {
+        SrsRtpMux* mux = *it;
+        srs_freep(mux);
+    }
+    muxes.clear();
+}
+
+SrsRtpMuxPool* SrsRtpMuxPool::instance()
+{
+    if (!_instance) {
+        _instance = new SrsRtpMuxPool();
+    }
+    return _instance;
+}
+
+srs_error_t SrsRtpMuxPool::fetch(SrsRtpMux** pmux)
+{
+    srs_error_t err = srs_success;
+    
+    // Each mux uses a pair of ports, for RTP and RTCP.
+    if (!initialized) {
+        initialized = true;
+        
+        int port_min = _srs_config->get_rtsp_client_rtp_port_min();
+        int port_max = _srs_config->get_rtsp_client_rtp_port_max();
+        for (int port = port_min; port + 1 < port_max; port += 2) {
+            muxes.push_back(new SrsRtpMux(port));
+        }
+    }
+    
+    SrsRtpMux* mux = NULL;
+    std::vector<SrsRtpMux*>::iterator it;
+    for (it = muxes.begin(); it != muxes.end(); ++it) {
+        SrsRtpMux* m = *it;
+        if (!mux || m->size() < mux->size()) {
+            mux = m;
+        }
+    }
+    
+    if (!mux) {
+        return srs_error_new(ERROR_STREAM_CASTER_PORT, "no rtp port");
+    }
+    
+    if ((err = mux->listen()) != srs_success) {
+        return srs_error_wrap(err, "listen");
+    }
+    
+    *pmux = mux;
+    
+    return err;
+}
+
+SrsRtspPuller::SrsRtspPuller(ISrsSourceHandler* h, SrsRequest* r, string i, bool t)
+{
+    handler = h;
+    req = r;
+    input = i;
+    tcp = prefer_tcp = t;
+    
+    trd = NULL;
+    pprint = SrsPithyPrint::create_ingester();
+    transport = NULL;
+    rtsp = NULL;
+    mux = NULL;
+    
+    cseq = 0;
+    keepalive = 0;
+    start_time = 0;
+    
+    publisher = new SrsLocalPublisher(h);
+    publisher->set_request(r);
+    avc = new SrsRawH264Stream();
+    aac = new SrsRawAacStream();
+    acodec = new SrsRawAacStreamCodec();
+    
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = false;
+    ibp_keyframe = false;
+    ibp_dts = 0;
+    aac_specific_config_sent = false;
+}
+
+SrsRtspPuller::~SrsRtspPuller()
+{
+    stop();
+    
+    srs_freep(publisher);
+    srs_freep(pprint);
+    srs_freep(avc);
+    srs_freep(aac);
+    srs_freep(acodec);
+}
+
+srs_error_t SrsRtspPuller::start()
+{
+    srs_error_t err = srs_success;
+    
+    // Ignore when started, the coroutine retries when failed.
+    if (trd) {
+        return err;
+    }
+    
+    SrsSTCoroutine* st = new SrsSTCoroutine("ingest-rtsp", this, _srs_context->get_id());
+    st->set_priority(SrsCoroutinePriorityHigh);
+    trd = st;
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+void SrsRtspPuller::stop()
+{
+    if (trd) {
+        trd->stop();
+    }
+    srs_freep(trd);
+    
+    close();
+}
+
+void SrsRtspPuller::interrupt()
+{
+    if (trd) {
+        trd->interrupt();
+    }
+}
+
+srs_error_t SrsRtspPuller::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = do_cycle()) != srs_success) {
+            srs_warn("ingest: rtsp ignore error, url=%s, tcp=%d, %s", input.c_str(), tcp, srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "ingest rtsp");
+        }
+        
+        srs_usleep(SRS_RTSP_PULL_CIMS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    // Fallback to interleaved TCP when SETUP over UDP failed, for example, 461 Unsupported Transport.
+    if ((err = connect()) != srs_success && !tcp && srs_error_code(err) == ERROR_RTSP_RESPONSE_STATUS) {
+        srs_warn("ingest: rtsp fallback to tcp, url=%s, %s", input.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        
+        tcp = true;
+        err = connect();
+    }
+    
+    if (err != srs_success) {
+        close();
+        return srs_error_wrap(err, "connect");
+    }
+    
+    // The packets over UDP are dropped util the source is published.
+    if ((err = publisher->publish()) != srs_success) {
+        close();
+        return srs_error_wrap(err, "publish");
+    }
+    srs_trace("ingest: rtsp publish %s, input=%s, tcp=%d/%d, tracks=%d, port=%d", req->get_stream_url().c_str(),
+        url.c_str(), tcp, prefer_tcp, (int)tracks.size(), (mux? mux->rtp_port() : 0));
+    
+    if (tcp) {
+        err = pull_tcp();
+    } else {
+        err = pull_udp();
+    }
+    
+    // Fallback to interleaved TCP when no RTP packets over UDP, for example, blocked by NAT.
+    // @remark Never retry UDP after fallback, for the same network.
+    if (!tcp && srs_error_code(err) == ERROR_RTSP_PULL_RTP_TIMEOUT) {
+        bool got_packets = false;
+        for (int i = 0; i < (int)tracks.size(); i++) {
+            got_packets = got_packets || tracks[i]->nn_packets > 0;
+        }
+        if (!got_packets) {
+            srs_warn("ingest: rtsp no udp packets, fallback to tcp, url=%s", url.c_str());
+            tcp = true;
+        }
+    }
+    
+    publisher->unpublish();
+    close();
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::connect()
+{
+    srs_error_t err = srs_success;
+    
+    close();
+    
+    string host;
+    int port = 0;
+    if ((err = srs_rtsp_parse_url(input, url, user, pass, host, port)) != srs_success) {
+        return srs_error_wrap(err, "parse url");
+    }
+    
+    srs_utime_t timeout = _srs_config->get_rtsp_client_timeout();
+    transport = new SrsTcpClient(host, port, timeout);
+    if ((err = transport->connect()) != srs_success) {
+        return srs_error_wrap(err, "connect %s:%d", host.c_str(), port);
+    }
+    rtsp = new SrsRtspStack(transport);
+    
+    if ((err = describe()) != srs_success) {
+        return srs_error_wrap(err, "describe");
+    }
+    
+    // The address of server, to learn the SSRC when not specified by SETUP.
+    string peer_ip;
+    if (true) {
+        int family = AF_UNSPEC;
+        string ip = srs_dns_resolve(host, family);
+        
+        char raw[16];
+        if (family == AF_INET && inet_pton(AF_INET, ip.c_str(), raw) == 1) {
+            peer_ip = string(raw, 4);
+        } else if (family == AF_INET6 && inet_pton(AF_INET6, ip.c_str(), raw) == 1) {
+            peer_ip = string(raw, 16);
+        }
+    }
+    
+    if (!tcp && (err = SrsRtpMuxPool::instance()->fetch(&mux)) != srs_success) {
+        return srs_error_wrap(err, "fetch rtp port");
+    }
+    
+    for (int i = 0; i < (int)tracks.size(); i++) {
+        SrsRtspPullTrack* track = tracks[i];
+        track->peer_ip = peer_ip;
+        if (tcp) {
+            track->channel = i * 2;
+        }
+        
+        if ((err = setup(track)) != srs_success) {
+            return srs_error_wrap(err, "setup %s", track->control.c_str());
+        }
+        
+        if (mux) {
+            mux->add(track);
+        }
+    }
+    
+    if ((err = play()) != srs_success) {
+        return srs_error_wrap(err, "play");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::describe()
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtspRequest* r = new SrsRtspRequest();
+    SrsAutoFree(SrsRtspRequest, r);
+    r->method = SRS_METHOD_DESCRIBE;
+    r->uri = url;
+    r->accept = "application/sdp";
+    
+    SrsRtspResponse* res = NULL;
+    if ((err = request(r, &res)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    SrsAutoFree(SrsRtspResponse, res);
+    
+    SrsRtspSdp* sdp = res->sdp;
+    if (!sdp) {
+        return srs_error_new(ERROR_RTSP_PULL_NO_TRACK, "no sdp, content-type=%s", res->content_type.c_str());
+    }
+    
+    base = res->content_base.empty()? url : res->content_base;
+    
+    // Reset the codec for each session, the sps/pps in sdp maybe changed.
+    h264_sps = h264_pps = aac_specific_config = "";
+    h264_sps_changed = h264_pps_changed = h264_sps_pps_sent = false;
+    aac_specific_config_sent = false;
+    ibp.clear();
+    
+    int depth = _srs_config->get_rtsp_client_rtp_reorder_depth();
+    
+    if (sdp->video_codec == "H264") {
+        SrsRtspPullTrack* track = new SrsRtspPullTrack(this, true, depth);
+        track->control = srs_rtsp_resolve_control(base, sdp->video_control);
+        track->payload_type = ::atoi(sdp->video_transport_format.c_str());
+        track->clock_rate = srs_max(1, ::atoi(sdp->video_sample_rate.c_str()));
+        tracks.push_back(track);
+        
+        h264_sps = sdp->video_sps;
+        h264_pps = sdp->video_pps;
+        h264_sps_changed = h264_pps_changed = true;
+    } else if (!sdp->video_codec.empty()) {
+        srs_warn("ingest: rtsp ignore video codec %s, url=%s", sdp->video_codec.c_str(), url.c_str());
+    }
+    
+    if (!strcasecmp(sdp->audio_codec.c_str(), "MPEG4-GENERIC") && !sdp->audio_sh.empty()) {
+        SrsRtspPullTrack* track = new SrsRtspPullTrack(this, false, depth);
+        track->control = srs_rtsp_resolve_control(base, sdp->audio_control);
+        track->payload_type = ::atoi(sdp->audio_transport_format.c_str());
+        track->clock_rate = srs_max(1, ::atoi(sdp->audio_sample_rate.c_str()));
+        if (!sdp->audio_size_length.empty()) {
+            track->size_length = ::atoi(sdp->audio_size_length.c_str());
+        }
+        if (!sdp->audio_index_length.empty()) {
+            track->index_length = ::atoi(sdp->audio_index_length.c_str());
+        }
+        tracks.push_back(track);
+        
+        aac_specific_config = sdp->audio_sh;
+        acodec->sound_format = SrsAudioCodecIdAAC;
+        acodec->sound_rate = SrsAudioSampleRate44100;
+        acodec->sound_size = SrsAudioSampleBits16bit;
+        acodec->sound_type = (::atoi(sdp->audio_channel.c_str()) == 1)? SrsAudioChannelsMono : SrsAudioChannelsStereo;
+    } else if (!sdp->audio_codec.empty()) {
+        srs_warn("ingest: rtsp ignore audio codec %s, url=%s", sdp->audio_codec.c_str(), url.c_str());
+    }
+    
+    if (tracks.empty()) {
+        return srs_error_new(ERROR_RTSP_PULL_NO_TRACK, "no track, video=%s, audio=%s",
+            sdp->video_codec.c_str(), sdp->audio_codec.c_str());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::setup(SrsRtspPullTrack* track)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtspRequest* r = new SrsRtspRequest();
+    SrsAutoFree(SrsRtspRequest, r);
+    r->method = SRS_METHOD_SETUP;
+    r->uri = track->control;
+    r->session = session;
+    
+    r->transport = new SrsRtspTransport();
+    r->transport->transport = "RTP";
+    r->transport->profile = "AVP";
+    r->transport->cast_type = "unicast";
+    if (tcp) {
+        r->transport->lower_transport = "TCP";
+        r->transport->interleaved_min = track->channel;
+        r->transport->interleaved_max = track->channel + 1;
+    } else {
+        r->transport->client_port_min = mux->rtp_port();
+        r->transport->client_port_max = mux->rtp_port() + 1;
+    }
+    
+    SrsRtspResponse* res = NULL;
+    if ((err = request(r, &res)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    SrsAutoFree(SrsRtspResponse, res);
+    
+    // The session is id[;timeout=60], send keepalive in half of timeout.
+    if (session.empty()) {
+        session = res->session;
+        
+        int timeout = SRS_RTSP_PULL_SESSION_TIMEOUT;
+        size_t pos = session.find(";");
+        if (pos != string::npos) {
+            string params = session.substr(pos + 1);
+            session = session.substr(0, pos);
+            if ((pos = params.find("timeout=")) != string::npos) {
+                timeout = srs_max(2, ::atoi(params.substr(pos + 8).c_str()));
+            }
+        }
+        keepalive = timeout * SRS_UTIME_SECONDS / 2;
+    }
+    
+    SrsRtspTransport* t = res->transport;
+    if (t && tcp && t->interleaved_min >= 0) {
+        track->channel = t->interleaved_min;
+    }
+    if (t && !tcp) {
+        track->peer_port = t->server_port_min;
+        if (!t->ssrc.empty()) {
+            track->has_ssrc = true;
+            track->ssrc = (uint32_t)::strtoul(t->ssrc.c_str(), NULL, 16);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::play()
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtspRequest* r = new SrsRtspRequest();
+    SrsAutoFree(SrsRtspRequest, r);
+    r->method = SRS_METHOD_PLAY;
+    r->uri = base;
+    r->session = session;
+    r->range = "npt=0.000-";
+    
+    // The timestamp of tracks start from play.
+    start_time = srs_get_system_time();
+    
+    SrsRtspResponse* res = NULL;
+    if ((err = request(r, &res)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    srs_freep(res);
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::pull_udp()
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t timeout = _srs_config->get_rtsp_client_timeout();
+    srs_utime_t last_keepalive = srs_get_system_time();
+    
+    // The RTP packets are received by mux, we only read the responses of keepalive.
+    transport->set_recv_timeout(SRS_RTSP_PULL_CHECK);
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        SrsRtspResponse* res = NULL;
+        if ((err = rtsp->recv_response(&res)) != srs_success) {
+            if (srs_error_code(err) != ERROR_SOCKET_TIMEOUT) {
+                return srs_error_wrap(err, "recv response");
+            }
+            srs_freep(err);
+        }
+        srs_freep(res);
+        
+        // Whether there is any packet in timeout.
+        srs_utime_t now = srs_get_system_time();
+        srs_utime_t last_packet = start_time;
+        for (int i = 0; i < (int)tracks.size(); i++) {
+            last_packet = srs_max(last_packet, tracks[i]->last_packet);
+        }
+        if (now - last_packet > timeout) {
+            return srs_error_new(ERROR_RTSP_PULL_RTP_TIMEOUT, "no rtp in %dms", srsu2msi(now - last_packet));
+        }
+        
+        if (now - last_keepalive > keepalive) {
+            last_keepalive = now;
+            if ((err = do_keepalive()) != srs_success) {
+                return srs_error_wrap(err, "keepalive");
+            }
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> " SRS_CONSTS_LOG_INGESTER " time=%dms, rtsp udp port=%d, tracks=%d, packets=%" PRId64 ", %s",
+                srsu2msi(pprint->age()), mux->rtp_port(), (int)tracks.size(), tracks[0]->nn_packets, url.c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::pull_tcp()
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t last_keepalive = srs_get_system_time();
+    transport->set_recv_timeout(_srs_config->get_rtsp_client_timeout());
+    
+    std::string data;
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+        
+        int channel = -1;
+        SrsRtspResponse* res = NULL;
+        if ((err = rtsp->recv_interleaved(&channel, data, &res)) != srs_success) {
+            return srs_error_wrap(err, "recv interleaved");
+        }
+        srs_freep(res);
+        
+        // Ignore the RTCP, whose channel is RTP channel + 1.
+        for (int i = 0; channel >= 0 && i < (int)tracks.size(); i++) {
+            SrsRtspPullTrack* track = tracks[i];
+            if (track->channel != channel) {
+                continue;
+            }
+            
+            if ((err = track->on_rtp((char*)data.data(), (int)data.length())) != srs_success) {
+                srs_warn("rtsp: ignore rtp channel=%d, %s", channel, srs_error_desc(err).c_str());
+                srs_freep(err);
+            }
+            break;
+        }
+        
+        srs_utime_t now = srs_get_system_time();
+        if (now - last_keepalive > keepalive) {
+            last_keepalive = now;
+            if ((err = do_keepalive()) != srs_success) {
+                return srs_error_wrap(err, "keepalive");
+            }
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> " SRS_CONSTS_LOG_INGESTER " time=%dms, rtsp tcp tracks=%d, packets=%" PRId64 ", %s",
+                srsu2msi(pprint->age()), (int)tracks.size(), tracks[0]->nn_packets, url.c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::do_keepalive()
+{
+    srs_error_t err = srs_success;
+    
+    // Any request refresh the session, and the response is ignored by pull.
+    SrsRtspRequest* r = new SrsRtspRequest();
+    SrsAutoFree(SrsRtspRequest, r);
+    r->method = SRS_METHOD_OPTIONS;
+    r->uri = url;
+    r->session = session;
+    r->seq = ++cseq;
+    if (!authenticate.empty()) {
+        r->authorization = srs_rtsp_authorization(authenticate, user, pass, r->method, r->uri);
+    }
+    
+    if ((err = rtsp->send_request(r)) != srs_success) {
+        return srs_error_wrap(err, "send request");
+    }
+    
+    return err;
+}
+
+void SrsRtspPuller::close()
+{
+    std::vector<SrsRtspPullTrack*>::iterator it;
+    for (it = tracks.begin(); it != tracks.end(); ++it) {
+        SrsRtspPullTrack* track = *it;
+        if (mux) {
+            mux->remove(track);
+        }
+        srs_freep(track);
+    }
+    tracks.clear();
+    mux = NULL;
+    
+    srs_freep(rtsp);
+    srs_freep(transport);
+    session = "";
+}
+
+srs_error_t SrsRtspPuller::request(SrsRtspRequest* r, SrsRtspResponse** pres)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < 2; i++) {
+        r->seq = ++cseq;
+        if (!authenticate.empty()) {
+            r->authorization = srs_rtsp_authorization(authenticate, user, pass, r->method, r->uri);
+        }
+        
+        if ((err = rtsp->send_request(r)) != srs_success) {
+            return srs_error_wrap(err, "send %s", r->method.c_str());
+        }
+        
+        SrsRtspResponse* res = NULL;
+        if ((err = rtsp->recv_response(&res)) != srs_success) {
+            return srs_error_wrap(err, "recv %s", r->method.c_str());
+        }
+        
+        if (res->status == SRS_CONSTS_RTSP_OK) {
+            *pres = res;
+            return err;
+        }
+        
+        // Retry once with the authorization, the nonce maybe changed.
+        int status = res->status;
+        bool retry = status == SRS_CONSTS_RTSP_Unauthorized && i == 0 && !user.empty() && !res->www_authenticate.empty();
+        if (retry) {
+            authenticate = res->www_authenticate;
+        }
+        srs_freep(res);
+        
+        if (!retry) {
+            return srs_error_new(ERROR_RTSP_RESPONSE_STATUS, "%s %s status=%d", r->method.c_str(), r->uri.c_str(), status);
+        }
+    }
+    
+    return srs_error_new(ERROR_RTSP_RESPONSE_STATUS, "%s %s unauthorized", r->method.c_str(), r->uri.c_str());
+}
+
+srs_error_t SrsRtspPuller::on_video_nalu(char* nalu, int size, int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    // The frame is done when timestamp changed, for the marker maybe lost.
+    if (!ibp.empty() && dts != ibp_dts) {
+        if ((err = flush_video()) != srs_success) {
+            return srs_error_wrap(err, "flush video");
+        }
+    }
+    ibp_dts = dts;
+    
+    // 5bits, 7.3.1 NAL unit syntax,
+    // ISO_IEC_14496-10-AVC-2003.pdf, page 44.
+    //  7: SPS, 8: PPS, 5: I Frame, 1: P Frame
+    SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(nalu[0] & 0x1f);
+    
+    // ignore the nalu type aud(9)
+    if (nal_unit_type == SrsAvcNaluTypeAccessUnitDelimiter) {
+        return err;
+    }
+    
+    if (nal_unit_type == SrsAvcNaluTypeSPS) {
+        if (h264_sps.length() != (size_t)size || memcmp(h264_sps.data(), nalu, size)) {
+            h264_sps.assign(nalu, size);
+            h264_sps_changed = true;
+        }
+        return err;
+    }
+    
+    if (nal_unit_type == SrsAvcNaluTypePPS) {
+        if (h264_pps.length() != (size_t)size || memcmp(h264_pps.data(), nalu, size)) {
+            h264_pps.assign(nalu, size);
+            h264_pps_changed = true;
+        }
+        return err;
+    }
+    
+    // for IDR frame, the frame is keyframe.
+    if (nal_unit_type == SrsAvcNaluTypeIDR) {
+        ibp_keyframe = true;
+    }
+    
+    // 5.3.4.2.1 Syntax, ISO_IEC_14496-15-AVC-format-2012.pdf, page 16
+    // The 4bytes size of NALU, then the NALU, appended to the frame without copy.
+    char header[4];
+    SrsBuffer stream(header, 4);
+    stream.write_4bytes(size);
+    ibp.append(header, 4);
+    ibp.append(nalu, size);
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::flush_video()
+{
+    srs_error_t err = srs_success;
+    
+    if (ibp.empty()) {
+        return err;
+    }
+    
+    uint32_t dts = (uint32_t)ibp_dts;
+    
+    // The sps or pps changed, update the sequence header before the frame.
+    if ((err = write_h264_sps_pps(dts)) != srs_success) {
+        return srs_error_wrap(err, "write sps/pps");
+    }
+    
+    // when sps or pps not sent, ignore the packet.
+    // @see https://github.com/ossrs/srs/issues/203
+    if (!h264_sps_pps_sent) {
+        ibp.clear();
+        ibp_keyframe = false;
+        return err;
+    }
+    
+    SrsVideoAvcFrameType frame_type = ibp_keyframe? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+    int8_t avc_packet_type = SrsVideoAvcFrameTraitNALU;
+    char* flv = NULL;
+    int nb_flv = 0;
+    err = avc->mux_avc2flv(ibp, frame_type, avc_packet_type, dts, dts, &flv, &nb_flv);
+    
+    ibp.clear();
+    ibp_keyframe = false;
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "mux avc to flv");
+    }
+    
+    return publish(SrsFrameTypeVideo, dts, flv, nb_flv);
+}
+
+srs_error_t SrsRtspPuller::write_h264_sps_pps(uint32_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    // Wait for both sps and pps, and update the sequence header when any changed.
+    if (!h264_sps_changed && !h264_pps_changed) {
+        return err;
+    }
+    if (h264_sps.empty() || h264_pps.empty()) {
+        return err;
+    }
+    
+    // h264 raw to h264 packet.
+    std::string sh;
+    if ((err = avc->mux_sequence_header(h264_sps, h264_pps, dts, dts, sh)) != srs_success) {
+        return srs_error_wrap(err, "mux sequence header");
+    }
+    
+    // h264 packet to flv packet.
+    int8_t frame_type = SrsVideoAvcFrameTypeKeyFrame;
+    int8_t avc_packet_type = SrsVideoAvcFrameTraitSequenceHeader;
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((err = avc->mux_avc2flv(sh, frame_type, avc_packet_type, dts, dts, &flv, &nb_flv)) != srs_success) {
+        return srs_error_wrap(err, "avc to flv");
+    }
+    
+    if ((err = publish(SrsFrameTypeVideo, dts, flv, nb_flv)) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    // reset sps and pps.
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = true;
+    
+    return err;
+}
+
+srs_error_t SrsRtspPuller::on_audio_frame(char* frame, int size, int64_t dts)
+{
+    srs_error_t err = srs_success;
+    
+    uint32_t timestamp = (uint32_t)dts;
+    
+    // The sequence header is the AudioSpecificConfig in sdp.
+    if (!aac_specific_config_sent) {
+        acodec->aac_packet_type = 0;
+        
+        char* data = NULL;
+        int nb_data = 0;
+        if ((err = aac->mux_aac2flv((char*)aac_specific_config.data(), (int)aac_specific_config.length(), acodec, timestamp, &data, &nb_data)) != srs_success) {
+            return srs_error_wrap(err, "mux aac to flv");
+        }
+        if ((err = publish(SrsFrameTypeAudio, timestamp, data, nb_data)) != srs_success) {
+            return srs_error_wrap(err, "publish");
+        }
+        aac_specific_config_sent = true;
+    }
+    
+    // audio raw data.
+    acodec->aac_packet_type = 1;
+    
+    char* data = NULL;
+    int nb_data = 0;
+    if ((err = aac->mux_aac2flv(frame, size, acodec, timestamp, &data, &nb_data)) != srs_success) {
+        return srs_error_wrap(err, "mux aac to flv");
+    }
+    
+    return publish(SrsFrameTypeAudio, timestamp, data, nb_data);
+}
+
+srs_error_t SrsRtspPuller::publish(char type, uint32_t timestamp, char* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    SrsCommonMessage* msg = NULL;
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, &msg)) != srs_success) {
+        return srs_error_wrap(err, "create message");
+    }
+    SrsAutoFree(SrsCommonMessage, msg);
+    
+    // The message is dropped when not published, for example, in utest.
+    if ((err = publisher->on_message(msg)) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    return err;
+}
+
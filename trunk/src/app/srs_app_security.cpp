@@ -23,10 +23,434 @@
 
 #include <srs_app_security.hpp>
 
+#include <string.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+
+#include <map>
+using namespace std;
+
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_utility.hpp>
 #include <srs_app_config.hpp>
 
-using namespace std;
+// The bit of address at pos, from the most significant bit.
+#define SRS_CIDR_BIT(addr, pos) (((addr)[(pos) >> 3] >> (7 - ((pos) & 7))) & 0x01)
+
+bool srs_parse_cidr(const string& ip, uint8_t* addr, int& bits, int& prefix)
+{
+    string host = ip;
+    prefix = -1;
+    
+    size_t pos = ip.find("/");
+    if (pos != string::npos) {
+        host = ip.substr(0, pos);
+        
+        string mask = ip.substr(pos + 1);
+        if (mask.empty() || mask.length() > 3 || mask.find_first_not_of("0123456789") != string::npos) {
+            return false;
+        }
+        prefix = ::atoi(mask.c_str());
+    }
+    
+    if (host.find(":") == string::npos) {
+        if (inet_pton(AF_INET, host.c_str(), addr) != 1) {
+            return false;
+        }
+        bits = 32;
+    } else {
+        if (inet_pton(AF_INET6, host.c_str(), addr) != 1) {
+            return false;
+        }
+        bits = 128;
+        
+        // For IPv4-mapped IPv6 address, ::ffff:a.b.c.d, convert to IPv4.
+        static uint8_t mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        if (memcmp(addr, mapped, sizeof(mapped)) == 0 && (prefix < 0 || prefix >= 96)) {
+            memmove(addr, addr + 12, 4);
+            bits = 32;
+            prefix = (prefix < 0)? -1 : prefix - 96;
+        }
+    }
+    
+    if (prefix < 0) {
+        prefix = bits;
+    }
+    
+    return prefix <= bits;
+}
+
+// Decode the base64url without padding of JWT.
+static srs_error_t srs_base64url_decode(string cipher, string& plaintext)
+{
+    for (int i = 0; i < (int)cipher.length(); i++) {
+        char& ch = cipher.at(i);
+        if (ch == '-') {
+            ch = '+';
+        } else if (ch == '_') {
+            ch = '/';
+        } else if (ch == '+' || ch == '/' || ch == '=') {
+            return srs_error_new(ERROR_BASE64_DECODE, "invalid char %c", ch);
+        }
+    }
+    
+    if (cipher.length() % 4 == 1) {
+        return srs_error_new(ERROR_BASE64_DECODE, "invalid length %d", (int)cipher.length());
+    }
+    cipher.append((4 - cipher.length() % 4) % 4, '=');
+    
+    return srs_av_base64_decode(cipher, plaintext);
+}
+
+// Decode the base64url of JWT to the JSON object, user must free it.
+static srs_error_t srs_token_decode_object(string cipher, SrsJsonObject*& obj)
+{
+    srs_error_t err = srs_success;
+    
+    string plaintext;
+    if ((err = srs_base64url_decode(cipher, plaintext)) != srs_success) {
+        return srs_error_wrap(err, "decode");
+    }
+    
+    SrsJsonAny* any = SrsJsonAny::loads(plaintext);
+    if (!any || !any->is_object()) {
+        srs_freep(any);
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "not object");
+    }
+    
+    obj = any->to_object();
+    return err;
+}
+
+srs_error_t srs_verify_token(string token, const vector<string>& keys, SrsRtmpConnType type, string ip, SrsRequest* req, int64_t now)
+{
+    srs_error_t err = srs_success;
+    
+    size_t pos = token.find(".");
+    size_t pos2 = (pos == string::npos)? pos : token.find(".", pos + 1);
+    if (pos2 == string::npos || token.find(".", pos2 + 1) != string::npos) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "invalid token");
+    }
+    
+    // Verify the signature first, never parse the JSON of an unsigned token.
+    string signature;
+    if ((err = srs_base64url_decode(token.substr(pos2 + 1), signature)) != srs_success) {
+        return srs_error_wrap(err, "signature");
+    }
+    
+    bool verified = false;
+    for (int i = 0; i < (int)keys.size() && !verified; i++) {
+        const string& key = keys.at(i);
+        
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int nn_digest = 0;
+        if (!HMAC(EVP_sha256(), key.data(), (int)key.length(), (const unsigned char*)token.data(), pos2, digest, &nn_digest)) {
+            return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "hmac");
+        }
+        
+        verified = (signature.length() == nn_digest && CRYPTO_memcmp(signature.data(), digest, nn_digest) == 0);
+    }
+    if (!verified) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "signature not match %d keys", (int)keys.size());
+    }
+    
+    SrsJsonObject* header = NULL;
+    if ((err = srs_token_decode_object(token.substr(0, pos), header)) != srs_success) {
+        return srs_error_wrap(err, "header");
+    }
+    SrsAutoFree(SrsJsonObject, header);
+    
+    SrsJsonAny* prop = header->get_property("alg");
+    if (!prop || !prop->is_string() || prop->to_str() != "HS256") {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "alg not HS256");
+    }
+    
+    SrsJsonObject* claims = NULL;
+    if ((err = srs_token_decode_object(token.substr(pos + 1, pos2 - pos - 1), claims)) != srs_success) {
+        return srs_error_wrap(err, "payload");
+    }
+    SrsAutoFree(SrsJsonObject, claims);
+    
+    if ((prop = claims->get_property("exp")) == NULL || (!prop->is_integer() && !prop->is_number())) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "no exp");
+    }
+    int64_t exp = prop->is_integer()? prop->to_integer() : (int64_t)prop->to_number();
+    if (exp <= now) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "expired %" PRId64 "s", now - exp);
+    }
+    
+    if ((prop = claims->get_property("stream")) != NULL) {
+        string stream = req->app + "/" + req->stream;
+        if (!prop->is_string() || prop->to_str() != stream) {
+            return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "not for stream %s", stream.c_str());
+        }
+    }
+    
+    if ((prop = claims->get_property("action")) != NULL) {
+        string action = (type == SrsRtmpConnPlay)? "play" : "publish";
+        if (!prop->is_string() || prop->to_str() != action) {
+            return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "not for %s", action.c_str());
+        }
+    }
+    
+    if ((prop = claims->get_property("ip")) != NULL) {
+        if (!prop->is_string() || prop->to_str() != ip) {
+            return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "not for ip %s", ip.c_str());
+        }
+    }
+    
+    return err;
+}
+
+SrsCidrNode::SrsCidrNode()
+{
+    memset(prefix, 0, sizeof(prefix));
+    nb_prefix = 0;
+    children[0] = children[1] = NULL;
+}
+
+SrsCidrNode::~SrsCidrNode()
+{
+    srs_freep(children[0]);
+    srs_freep(children[1]);
+}
+
+// Whether the first n bits of a and b are equal.
+static bool srs_cidr_equals(const uint8_t* a, const uint8_t* b, int n)
+{
+    int nb_bytes = n >> 3;
+    if (nb_bytes > 0 && memcmp(a, b, nb_bytes) != 0) {
+        return false;
+    }
+    
+    int left = n & 7;
+    if (left == 0) {
+        return true;
+    }
+    
+    uint8_t mask = (uint8_t)(0xff << (8 - left));
+    return (a[nb_bytes] & mask) == (b[nb_bytes] & mask);
+}
+
+// The length of common prefix of a and b, at most n bits.
+static int srs_cidr_common(const uint8_t* a, const uint8_t* b, int n)
+{
+    int i = 0;
+    while (i < n && (i & 7) == 0 && i + 8 <= n && a[i >> 3] == b[i >> 3]) {
+        i += 8;
+    }
+    while (i < n && SRS_CIDR_BIT(a, i) == SRS_CIDR_BIT(b, i)) {
+        i++;
+    }
+    return i;
+}
+
+// Create the node of the first n bits of addr.
+static SrsCidrNode* srs_cidr_create(const uint8_t* addr, int n)
+{
+    SrsCidrNode* node = new SrsCidrNode();
+    node->nb_prefix = n;
+    
+    memcpy(node->prefix, addr, (n + 7) >> 3);
+    if ((n & 7) != 0) {
+        node->prefix[n >> 3] &= (uint8_t)(0xff << (8 - (n & 7)));
+    }
+    
+    return node;
+}
+
+SrsCidrTrie::SrsCidrTrie(int b)
+{
+    bits = b;
+    root = new SrsCidrNode();
+}
+
+SrsCidrTrie::~SrsCidrTrie()
+{
+    srs_freep(root);
+}
+
+void SrsCidrTrie::insert(const uint8_t* addr, int prefix, string rule)
+{
+    srs_assert(prefix >= 0 && prefix <= bits);
+    
+    SrsCidrNode* node = root;
+    while (true) {
+        // The rule ends at this node, keep the first one.
+        if (node->nb_prefix == prefix) {
+            if (node->rule.empty()) {
+                node->rule = rule;
+            }
+            return;
+        }
+        
+        int bit = SRS_CIDR_BIT(addr, node->nb_prefix);
+        SrsCidrNode* child = node->children[bit];
+        
+        if (!child) {
+            child = srs_cidr_create(addr, prefix);
+            child->rule = rule;
+            node->children[bit] = child;
+            return;
+        }
+        
+        int common = srs_cidr_common(child->prefix, addr, srs_min(child->nb_prefix, prefix));
+        if (common == child->nb_prefix) {
+            node = child;
+            continue;
+        }
+        
+        // Split the child by the common prefix.
+        SrsCidrNode* parent = srs_cidr_create(addr, common);
+        parent->children[SRS_CIDR_BIT(child->prefix, common)] = child;
+        node->children[bit] = parent;
+        
+        if (common == prefix) {
+            parent->rule = rule;
+        } else {
+            SrsCidrNode* leaf = srs_cidr_create(addr, prefix);
+            leaf->rule = rule;
+            parent->children[SRS_CIDR_BIT(addr, common)] = leaf;
+        }
+        return;
+    }
+}
+
+const string* SrsCidrTrie::match(const uint8_t* addr)
+{
+    SrsCidrNode* node = root;
+    while (node && srs_cidr_equals(node->prefix, addr, node->nb_prefix)) {
+        // Any prefix matches, so the shortest one is enough.
+        if (!node->rule.empty()) {
+            return &node->rule;
+        }
+        if (node->nb_prefix >= bits) {
+            break;
+        }
+        node = node->children[SRS_CIDR_BIT(addr, node->nb_prefix)];
+    }
+    
+    return NULL;
+}
+
+SrsCidrSet::SrsCidrSet()
+{
+    all = false;
+    ipv4 = new SrsCidrTrie(32);
+    ipv6 = new SrsCidrTrie(128);
+}
+
+SrsCidrSet::~SrsCidrSet()
+{
+    srs_freep(ipv4);
+    srs_freep(ipv6);
+}
+
+void SrsCidrSet::add(string rule)
+{
+    if (rule == "all") {
+        all = true;
+        return;
+    }
+    
+    uint8_t addr[16];
+    int bits = 0, prefix = 0;
+    if (!srs_parse_cidr(rule, addr, bits, prefix)) {
+        others.insert(rule);
+        return;
+    }
+    
+    if (bits == 32) {
+        ipv4->insert(addr, prefix, rule);
+    } else {
+        ipv6->insert(addr, prefix, rule);
+    }
+}
+
+const string* SrsCidrSet::match(const string& ip)
+{
+    static string ALL = "all";
+    if (all) {
+        return &ALL;
+    }
+    
+    if (!others.empty()) {
+        std::set<std::string>::iterator it = others.find(ip);
+        if (it != others.end()) {
+            return &(*it);
+        }
+    }
+    
+    // For the address of client, the CIDR is not allowed.
+    uint8_t addr[16];
+    int bits = 0, prefix = 0;
+    if (ip.find("/") != string::npos || !srs_parse_cidr(ip, addr, bits, prefix)) {
+        return NULL;
+    }
+    
+    return (bits == 32)? ipv4->match(addr) : ipv6->match(addr);
+}
+
+SrsSecurityRules::SrsSecurityRules()
+{
+    available = false;
+    nb_allows = nb_denies = 0;
+    allow_play = allow_publish = deny_play = deny_publish = NULL;
+}
+
+SrsSecurityRules::~SrsSecurityRules()
+{
+    srs_freep(allow_play);
+    srs_freep(allow_publish);
+    srs_freep(deny_play);
+    srs_freep(deny_publish);
+}
+
+void SrsSecurityRules::compile(SrsConfDirective* rules)
+{
+    srs_freep(allow_play);
+    srs_freep(allow_publish);
+    srs_freep(deny_play);
+    srs_freep(deny_publish);
+    
+    allow_play = new SrsCidrSet();
+    allow_publish = new SrsCidrSet();
+    deny_play = new SrsCidrSet();
+    deny_publish = new SrsCidrSet();
+    
+    available = (rules != NULL);
+    nb_allows = nb_denies = 0;
+    
+    for (int i = 0; rules && i < (int)rules->directives.size(); i++) {
+        SrsConfDirective* rule = rules->at(i);
+        
+        SrsCidrSet* play = NULL;
+        SrsCidrSet* publish = NULL;
+        if (rule->name == "allow") {
+            nb_allows++;
+            play = allow_play;
+            publish = allow_publish;
+        } else if (rule->name == "deny") {
+            nb_denies++;
+            play = deny_play;
+            publish = deny_publish;
+        } else {
+            continue;
+        }
+        
+        if (rule->arg0() == "play") {
+            play->add(rule->arg1());
+        } else if (rule->arg0() == "publish") {
+            publish->add(rule->arg1());
+        }
+    }
+}
 
 SrsSecurity::SrsSecurity()
 {
@@ -39,25 +463,72 @@ SrsSecurity::~SrsSecurity()
 srs_error_t SrsSecurity::check(SrsRtmpConnType type, string ip, SrsRequest* req)
 {
     srs_error_t err = srs_success;
-
+    
+    if ((err = check_token(type, ip, req)) != srs_success) {
+        return srs_error_wrap(err, "token");
+    }
+    
+    // The rules are compiled when load or reload config.
+    SrsVhostSnapshot* snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    
     // allow all if security disabled.
-    if (!_srs_config->get_security_enabled(req->vhost)) {
+    if (!snapshot->security_enabled) {
         return err; // OK
     }
-
-    // rules to apply
-    SrsConfDirective* rules = _srs_config->get_security_rules(req->vhost);
-    return do_check(rules, type, ip, req);
+    
+    return check_rules(snapshot->security, type, ip);
 }
 
-srs_error_t SrsSecurity::do_check(SrsConfDirective* rules, SrsRtmpConnType type, string ip, SrsRequest* req)
+srs_error_t SrsSecurity::check_token(SrsRtmpConnType type, string ip, SrsRequest* req)
 {
     srs_error_t err = srs_success;
+    
+    SrsVhostSnapshot* snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    if (!snapshot->token_enabled) {
+        return err;
+    }
+    
+    bool required = (type == SrsRtmpConnPlay)? snapshot->token_play : snapshot->token_publish;
+    if (!required) {
+        return err;
+    }
+    
+    string param = req->param;
+    if (srs_string_starts_with(param, "?")) {
+        param = param.substr(1);
+    }
+    
+    map<string, string> query;
+    srs_parse_query_string(param, query);
+    
+    map<string, string>::iterator it = query.find("token");
+    if (it == query.end() || it->second.empty()) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_TOKEN, "no token for %s", ip.c_str());
+    }
+    
+    int64_t now = srs_get_system_time() / SRS_UTIME_SECONDS;
+    if ((err = srs_verify_token(it->second, snapshot->token_keys, type, ip, req, now)) != srs_success) {
+        return srs_error_wrap(err, "for %s", ip.c_str());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSecurity::do_check(SrsConfDirective* rules, SrsRtmpConnType type, string ip, SrsRequest* /*req*/)
+{
+    SrsSecurityRules compiled;
+    compiled.compile(rules);
+    return check_rules(&compiled, type, ip);
+}
 
-    if (!rules) {
+srs_error_t SrsSecurity::check_rules(SrsSecurityRules* rules, SrsRtmpConnType type, string ip)
+{
+    srs_error_t err = srs_success;
+    
+    if (!rules->available) {
         return srs_error_new(ERROR_SYSTEM_SECURITY, "default deny for %s", ip.c_str());
     }
-
+    
     // deny if matches deny strategy.
     if ((err = deny_check(rules, type, ip)) != srs_success) {
         return srs_error_wrap(err, "for %s", ip.c_str());
@@ -67,89 +538,58 @@ srs_error_t SrsSecurity::do_check(SrsConfDirective* rules, SrsRtmpConnType type,
     if ((err = allow_check(rules, type, ip)) != srs_success) {
         return srs_error_wrap(err, "for %s", ip.c_str());
     }
-
+    
     return err;
 }
 
-srs_error_t SrsSecurity::allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+srs_error_t SrsSecurity::allow_check(SrsSecurityRules* rules, SrsRtmpConnType type, std::string ip)
 {
-    int allow_rules = 0;
-    int deny_rules = 0;
-
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
-
-        if (rule->name != "allow") {
-            if (rule->name == "deny") {
-                deny_rules++;
+    switch (type) {
+        case SrsRtmpConnPlay:
+            if (rules->allow_play->match(ip)) {
+                return srs_success; // OK
             }
-            continue;
-        }
-        allow_rules++;
-
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_success; // OK
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-            case SrsRtmpConnHaivisionPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_success; // OK
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
+            break;
+        case SrsRtmpConnFMLEPublish:
+        case SrsRtmpConnFlashPublish:
+        case SrsRtmpConnHaivisionPublish:
+            if (rules->allow_publish->match(ip)) {
+                return srs_success; // OK
+            }
+            break;
+        case SrsRtmpConnUnknown:
+        default:
+            break;
     }
-
+    
+    int allow_rules = rules->nb_allows;
+    int deny_rules = rules->nb_denies;
     if (allow_rules > 0 || (deny_rules + allow_rules) == 0) {
         return srs_error_new(ERROR_SYSTEM_SECURITY_ALLOW, "not allowed by any of %d/%d rules", allow_rules, deny_rules);
     }
     return srs_success; // OK
 }
 
-srs_error_t SrsSecurity::deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip)
+srs_error_t SrsSecurity::deny_check(SrsSecurityRules* rules, SrsRtmpConnType type, std::string ip)
 {
-    for (int i = 0; i < (int)rules->directives.size(); i++) {
-        SrsConfDirective* rule = rules->at(i);
-        
-        if (rule->name != "deny") {
-            continue;
-        }
-        
-        switch (type) {
-            case SrsRtmpConnPlay:
-                if (rule->arg0() != "play") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rule->arg1().c_str());
-                }
-                break;
-            case SrsRtmpConnFMLEPublish:
-            case SrsRtmpConnFlashPublish:
-            case SrsRtmpConnHaivisionPublish:
-                if (rule->arg0() != "publish") {
-                    break;
-                }
-                if (rule->arg1() == "all" || rule->arg1() == ip) {
-                    return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rule->arg1().c_str());
-                }
-                break;
-            case SrsRtmpConnUnknown:
-            default:
-                break;
-        }
+    const string* rule = NULL;
+    
+    switch (type) {
+        case SrsRtmpConnPlay:
+            rule = rules->deny_play->match(ip);
+            break;
+        case SrsRtmpConnFMLEPublish:
+        case SrsRtmpConnFlashPublish:
+        case SrsRtmpConnHaivisionPublish:
+            rule = rules->deny_publish->match(ip);
+            break;
+        case SrsRtmpConnUnknown:
+        default:
+            break;
+    }
+    
+    if (rule) {
+        return srs_error_new(ERROR_SYSTEM_SECURITY_DENY, "deny by rule<%s>", rule->c_str());
     }
     
     return srs_success; // OK
@@ -27,11 +27,106 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <set>
+#include <vector>
 
 #include <srs_rtmp_stack.hpp>
 
 class SrsConfDirective;
 
+// Parse the IP or CIDR, for example, 10.0.0.1, 10.0.0.0/8 or 2001:db8::/32
+// @param addr The output address, 4 bytes for IPv4, 16 bytes for IPv6.
+// @param bits The output number of bits of address, 32 for IPv4, 128 for IPv6.
+// @param prefix The output length of prefix, the bits of address if no CIDR mask.
+// @return Whether the ip is a valid IP or CIDR.
+// @remark The IPv4-mapped IPv6 address, such as ::ffff:10.0.0.1, is parsed as IPv4.
+extern bool srs_parse_cidr(const std::string& ip, uint8_t* addr, int& bits, int& prefix);
+
+// Verify the signed token of client in process, which is a JWT(RFC 7519) signed by HS256, for example,
+//      rtmp://vhost/live/livestream?token=eyJhbGciOiJIUzI1NiJ9.eyJleHAiOjE2MDAwMDAwMDB9.xxx
+// The claims of payload:
+//      exp: Required, the expire time in seconds of UTC.
+//      stream: Optional, the app/stream which the token is for.
+//      action: Optional, play or publish.
+//      ip: Optional, the ip of client which the token is bound to.
+// @param keys The HMAC keys, the token signed by any of them is valid, to rotate the keys.
+// @param now The current time in seconds of UTC.
+extern srs_error_t srs_verify_token(std::string token, const std::vector<std::string>& keys,
+    SrsRtmpConnType type, std::string ip, SrsRequest* req, int64_t now);
+
+// The node of radix trie, whose prefix is the bits of address from root.
+class SrsCidrNode
+{
+public:
+    uint8_t prefix[16];
+    int nb_prefix;
+    // The rule which ends at this node, empty if not.
+    std::string rule;
+    SrsCidrNode* children[2];
+public:
+    SrsCidrNode();
+    virtual ~SrsCidrNode();
+};
+
+// The radix trie of CIDR, to match the address in O(bits) for many prefixes.
+// @remark The path is compressed, so the nodes is about twice of rules, not rules*bits.
+class SrsCidrTrie
+{
+private:
+    int bits;
+    SrsCidrNode* root;
+public:
+    // @param b The bits of address, 32 for IPv4 and 128 for IPv6.
+    SrsCidrTrie(int b);
+    virtual ~SrsCidrTrie();
+public:
+    // Insert the prefix of addr, the bits after prefix is ignored.
+    virtual void insert(const uint8_t* addr, int prefix, std::string rule);
+    // Match any prefix of addr, return the rule, or NULL if not matched.
+    virtual const std::string* match(const uint8_t* addr);
+};
+
+// The set of all, IP and CIDR of rules, to match the client.
+class SrsCidrSet
+{
+private:
+    bool all;
+    SrsCidrTrie* ipv4;
+    SrsCidrTrie* ipv6;
+    // The rules which is not IP, exactly match the string.
+    std::set<std::string> others;
+public:
+    SrsCidrSet();
+    virtual ~SrsCidrSet();
+public:
+    // Add the rule, which is all, IP, CIDR, or others to match exactly.
+    virtual void add(std::string rule);
+    // Match the ip of client, return the rule, or NULL if not matched.
+    virtual const std::string* match(const std::string& ip);
+};
+
+// The security rules of vhost compiled to tries, when load or reload config.
+// @see SrsVhostSnapshot
+class SrsSecurityRules
+{
+public:
+    // Whether there is security directive, default deny if not.
+    bool available;
+    // The number of allow and deny rules.
+    int nb_allows;
+    int nb_denies;
+    SrsCidrSet* allow_play;
+    SrsCidrSet* allow_publish;
+    SrsCidrSet* deny_play;
+    SrsCidrSet* deny_publish;
+public:
+    SrsSecurityRules();
+    virtual ~SrsSecurityRules();
+public:
+    // Compile the rules of the security directive, NULL if no security directive.
+    virtual void compile(SrsConfDirective* rules);
+};
+
 // The security apply on vhost.
 // @see https://github.com/ossrs/srs/issues/211
 class SrsSecurity
@@ -45,10 +140,13 @@ public:
     // @param ip the ip address of client.
     // @param req the request object of client.
     virtual srs_error_t check(SrsRtmpConnType type, std::string ip, SrsRequest* req);
+    // Verify the token in the param of request, if token of vhost enabled, before any http hooks.
+    virtual srs_error_t check_token(SrsRtmpConnType type, std::string ip, SrsRequest* req);
 private:
     virtual srs_error_t do_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip, SrsRequest* req);
-    virtual srs_error_t allow_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
-    virtual srs_error_t deny_check(SrsConfDirective* rules, SrsRtmpConnType type, std::string ip);
+    virtual srs_error_t check_rules(SrsSecurityRules* rules, SrsRtmpConnType type, std::string ip);
+    virtual srs_error_t allow_check(SrsSecurityRules* rules, SrsRtmpConnType type, std::string ip);
+    virtual srs_error_t deny_check(SrsSecurityRules* rules, SrsRtmpConnType type, std::string ip);
 };
 
 #endif
@@ -54,6 +54,21 @@ using namespace std;
 #include <srs_kernel_consts.hpp>
 #include <srs_app_thread.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_srt.hpp>
+#include <srs_app_rtc.hpp>
+#include <srs_app_relay.hpp>
+#include <srs_app_disk_io.hpp>
+#include <srs_app_fanout.hpp>
+#include <srs_app_log.hpp>
+#include <srs_app_access_log.hpp>
+#include <srs_app_hourglass.hpp>
+#include <srs_rtmp_handshake.hpp>
+#include <srs_kernel_recorder.hpp>
+#include <srs_app_encoder.hpp>
+#include <srs_app_upgrade.hpp>
+#include <srs_app_overload.hpp>
+#include <srs_app_api_thread.hpp>
 
 // system interval in srs_utime_t,
 // all resolution times should be times togother,
@@ -111,6 +126,12 @@ std::string srs_listener_type2string(SrsListenerType type)
             return "RTSP";
         case SrsListenerFlv:
             return "HTTP-FLV";
+        case SrsListenerRtmps:
+            return "RTMPS";
+        case SrsListenerHttps:
+            return "HTTPS-Server";
+        case SrsListenerWorkerRelay:
+            return "RTMP-Relay";
         default:
             return "UNKONWN";
     }
@@ -132,6 +153,12 @@ SrsListenerType SrsListener::listen_type()
     return type;
 }
 
+string SrsListener::endpoint()
+{
+    string schema = (type == SrsListenerMpegTsOverUdp)? "udp" : "tcp";
+    return schema + "://" + ip + ":" + srs_int2str(port);
+}
+
 SrsBufferListener::SrsBufferListener(SrsServer* svr, SrsListenerType t) : SrsListener(svr, t)
 {
     listener = NULL;
@@ -142,6 +169,11 @@ SrsBufferListener::~SrsBufferListener()
     srs_freep(listener);
 }
 
+int SrsBufferListener::fd()
+{
+    return listener? listener->fd() : -1;
+}
+
 srs_error_t SrsBufferListener::listen(string i, int p)
 {
     srs_error_t err = srs_success;
@@ -151,11 +183,23 @@ srs_error_t SrsBufferListener::listen(string i, int p)
     
     srs_freep(listener);
     listener = new SrsTcpListener(this, ip, port);
+    listener->inherit(_srs_upgrade->fetch(endpoint()));
+    listener->set_batch(_srs_config->get_accept_batch());
     
     if ((err = listener->listen()) != srs_success) {
         return srs_error_wrap(err, "buffered tcp listen");
     }
     
+    int defer = _srs_config->get_accept_defer();
+    if (defer > 0 && (err = srs_fd_defer_accept(listener->fd(), defer)) != srs_success) {
+        return srs_error_wrap(err, "defer accept");
+    }
+    
+    int fastopen = _srs_config->get_accept_fastopen();
+    if (fastopen > 0 && (err = srs_fd_fastopen(listener->fd(), fastopen)) != srs_success) {
+        return srs_error_wrap(err, "fastopen");
+    }
+    
     string v = srs_listener_type2string(type);
     srs_trace("%s listen at tcp://%s:%d, fd=%d", v.c_str(), ip.c_str(), port, listener->fd());
     
@@ -181,7 +225,7 @@ SrsRtspListener::SrsRtspListener(SrsServer* svr, SrsListenerType t, SrsConfDirec
     // we just assert here for unknown stream caster.
     srs_assert(type == SrsListenerRtsp);
     if (type == SrsListenerRtsp) {
-        caster = new SrsRtspCaster(c);
+        caster = new SrsRtspCaster(svr, c);
     }
 }
 
@@ -191,6 +235,11 @@ SrsRtspListener::~SrsRtspListener()
     srs_freep(listener);
 }
 
+int SrsRtspListener::fd()
+{
+    return listener? listener->fd() : -1;
+}
+
 srs_error_t SrsRtspListener::listen(string i, int p)
 {
     srs_error_t err = srs_success;
@@ -204,6 +253,7 @@ srs_error_t SrsRtspListener::listen(string i, int p)
     
     srs_freep(listener);
     listener = new SrsTcpListener(this, ip, port);
+    listener->inherit(_srs_upgrade->fetch(endpoint()));
     
     if ((err = listener->listen()) != srs_success) {
         return srs_error_wrap(err, "rtsp listen %s:%d", ip.c_str(), port);
@@ -234,7 +284,7 @@ SrsHttpFlvListener::SrsHttpFlvListener(SrsServer* svr, SrsListenerType t, SrsCon
     // we just assert here for unknown stream caster.
     srs_assert(type == SrsListenerFlv);
     if (type == SrsListenerFlv) {
-        caster = new SrsAppCasterFlv(c);
+        caster = new SrsAppCasterFlv(svr, c);
     }
 }
 
@@ -244,6 +294,11 @@ SrsHttpFlvListener::~SrsHttpFlvListener()
     srs_freep(listener);
 }
 
+int SrsHttpFlvListener::fd()
+{
+    return listener? listener->fd() : -1;
+}
+
 srs_error_t SrsHttpFlvListener::listen(string i, int p)
 {
     srs_error_t err = srs_success;
@@ -261,6 +316,7 @@ srs_error_t SrsHttpFlvListener::listen(string i, int p)
     
     srs_freep(listener);
     listener = new SrsTcpListener(this, ip, port);
+    listener->inherit(_srs_upgrade->fetch(endpoint()));
     
     if ((err = listener->listen()) != srs_success) {
         return srs_error_wrap(err, "listen");
@@ -294,6 +350,11 @@ SrsUdpStreamListener::~SrsUdpStreamListener()
     srs_freep(listener);
 }
 
+int SrsUdpStreamListener::fd()
+{
+    return listener? listener->fd() : -1;
+}
+
 srs_error_t SrsUdpStreamListener::listen(string i, int p)
 {
     srs_error_t err = srs_success;
@@ -307,6 +368,10 @@ srs_error_t SrsUdpStreamListener::listen(string i, int p)
     
     srs_freep(listener);
     listener = new SrsUdpListener(caster, ip, port);
+    listener->inherit(_srs_upgrade->fetch(endpoint()));
+    
+    // The stream caster, for example, mpegts over udp, receives lots of packets.
+    listener->set_batch(SRS_PERF_UDP_BATCH);
     
     if ((err = listener->listen()) != srs_success) {
         return srs_error_wrap(err, "listen %s:%d", ip.c_str(), port);
@@ -329,7 +394,7 @@ SrsUdpCasterListener::SrsUdpCasterListener(SrsServer* svr, SrsListenerType t, Sr
     // we just assert here for unknown stream caster.
     srs_assert(type == SrsListenerMpegTsOverUdp);
     if (type == SrsListenerMpegTsOverUdp) {
-        caster = new SrsMpegtsOverUdp(c);
+        caster = new SrsMpegtsOverUdp(svr, c);
     }
 }
 
@@ -415,8 +480,19 @@ srs_error_t SrsSignalManager::start()
     sa.sa_flags = 0;
     sigaction(SRS_SIGNAL_REOPEN_LOG, &sa, NULL);
     
-    srs_trace("signal installed, reload=%d, reopen=%d, fast_quit=%d, grace_quit=%d",
-              SRS_SIGNAL_RELOAD, SRS_SIGNAL_REOPEN_LOG, SRS_SIGNAL_FAST_QUIT, SRS_SIGNAL_GRACEFULLY_QUIT);
+    sa.sa_handler = SrsSignalManager::sig_catcher;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SRS_SIGNAL_DUMP_RECORDER, &sa, NULL);
+    
+    sa.sa_handler = SrsSignalManager::sig_catcher;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SRS_SIGNAL_UPGRADE, &sa, NULL);
+    
+    srs_trace("signal installed, reload=%d, reopen=%d, fast_quit=%d, grace_quit=%d, recorder=%d, upgrade=%d",
+              SRS_SIGNAL_RELOAD, SRS_SIGNAL_REOPEN_LOG, SRS_SIGNAL_FAST_QUIT, SRS_SIGNAL_GRACEFULLY_QUIT,
+              SRS_SIGNAL_DUMP_RECORDER, SRS_SIGNAL_UPGRADE);
     
     if ((err = trd->start()) != srs_success) {
         return srs_error_wrap(err, "signal manager");
@@ -620,6 +696,8 @@ SrsServer::SrsServer()
     signal_gmc_stop = false;
     signal_fast_quit = false;
     signal_gracefully_quit = false;
+    signal_upgrade = false;
+    upgraded = false;
     pid_fd = -1;
     
     signal_manager = new SrsSignalManager(this);
@@ -627,6 +705,14 @@ SrsServer::SrsServer()
     
     handler = NULL;
     ppid = ::getppid();
+    tls = NULL;
+    srt = NULL;
+    rtc = NULL;
+    relay = NULL;
+    
+    accept_window = 0;
+    nn_window_accepts = 0;
+    nn_window_rejects = 0;
     
     // donot new object in constructor,
     // for some global instance is not ready now,
@@ -634,7 +720,7 @@ SrsServer::SrsServer()
     http_api_mux = new SrsHttpServeMux();
     http_server = new SrsHttpServer(this);
     http_heartbeat = new SrsHttpHeartbeat();
-    ingester = new SrsIngester();
+    ingester = new SrsIngester(this);
 }
 
 SrsServer::~SrsServer()
@@ -660,11 +746,13 @@ void SrsServer::destroy()
     
     srs_freep(signal_manager);
     srs_freep(conn_manager);
+    srs_freep(tls);
 }
 
 void SrsServer::dispose()
 {
     _srs_config->unsubscribe(this);
+    _srs_timer->unsubscribe(this);
     
     // prevent fresh clients.
     close_listeners(SrsListenerRtmpStream);
@@ -673,6 +761,15 @@ void SrsServer::dispose()
     close_listeners(SrsListenerMpegTsOverUdp);
     close_listeners(SrsListenerRtsp);
     close_listeners(SrsListenerFlv);
+    close_listeners(SrsListenerRtmps);
+    close_listeners(SrsListenerHttps);
+    close_listeners(SrsListenerWorkerRelay);
+    _srs_api_thread->stop();
+#ifdef SRS_AUTO_SRT
+    srs_freep(srt);
+#endif
+    srs_freep(rtc);
+    srs_freep(relay);
     
     // Fast stop to notify FFMPEG to quit, wait for a while then fast kill.
     ingester->dispose();
@@ -691,9 +788,11 @@ void SrsServer::gracefully_dispose()
 {
     _srs_config->unsubscribe(this);
 
-    // Always wait for a while to start.
-    srs_usleep(_srs_config->get_grace_start_wait());
-    srs_trace("start wait for %dms", srsu2msi(_srs_config->get_grace_start_wait()));
+    // Always wait for a while to start, except upgraded, for the new process already accepts clients.
+    if (!upgraded) {
+        srs_usleep(_srs_config->get_grace_start_wait());
+        srs_trace("start wait for %dms", srsu2msi(_srs_config->get_grace_start_wait()));
+    }
 
     // prevent fresh clients.
     close_listeners(SrsListenerRtmpStream);
@@ -702,22 +801,39 @@ void SrsServer::gracefully_dispose()
     close_listeners(SrsListenerMpegTsOverUdp);
     close_listeners(SrsListenerRtsp);
     close_listeners(SrsListenerFlv);
+    close_listeners(SrsListenerRtmps);
+    close_listeners(SrsListenerHttps);
+    close_listeners(SrsListenerWorkerRelay);
+#ifdef SRS_AUTO_SRT
+    srs_freep(srt);
+#endif
+    srs_freep(rtc);
+    srs_freep(relay);
     srs_trace("listeners closed");
 
     // Fast stop to notify FFMPEG to quit, wait for a while then fast kill.
     ingester->stop();
     srs_trace("ingesters stopped");
 
-    // Wait for connections to quit.
+    // Wait for connections to quit, or drain timeout.
     // While gracefully quiting, user can requires SRS to fast quit.
+    srs_utime_t drain_timeout = _srs_config->get_grace_drain_timeout();
+    srs_utime_t starttime = srs_update_system_time();
     int wait_step = 1;
     while (!conns.empty() && !signal_fast_quit) {
         for (int i = 0; i < wait_step && !conns.empty() && !signal_fast_quit; i++) {
             srs_usleep(1000 * SRS_UTIME_MILLISECONDS);
+            _srs_upgrade->reap();
         }
 
         wait_step = (wait_step * 2) % 33;
         srs_trace("wait for %d conns to quit", conns.size());
+        
+        // The cache time is not updated by server cycle, so update it.
+        if (drain_timeout > 0 && srs_update_system_time() - starttime > drain_timeout) {
+            srs_warn("drain timeout %dms, drop %d conns", srsu2msi(drain_timeout), conns.size());
+            break;
+        }
     }
 
     // dispose the source for hls and dvr.
@@ -758,6 +874,16 @@ srs_error_t SrsServer::initialize(ISrsServerCycle* ch)
         return srs_error_wrap(err, "http server initialize");
     }
     
+    // Before fork workers, so the keys of session tickets are shared by workers.
+    if (_srs_config->get_tls_enabled()) {
+        tls = new SrsTlsContext();
+        tls->set_h2(_srs_config->get_http_stream_http2());
+        if ((err = tls->initialize(_srs_config->get_tls_certificate(), _srs_config->get_tls_key(), _srs_config->get_tls_ktls(),
+            _srs_config->get_tls_session_tickets(), _srs_config->get_tls_ticket_key(), _srs_config->get_tls_session_timeout())) != srs_success) {
+            return srs_error_wrap(err, "tls initialize");
+        }
+    }
+    
     return err;
 }
 
@@ -765,22 +891,146 @@ srs_error_t SrsServer::initialize_st()
 {
     srs_error_t err = srs_success;
     
+    // Use io_uring for ST, the ST is built with io_uring if the kernel header supports it.
+    if (_srs_config->get_io_uring_enabled()) {
+        if ((err = srs_st_set_io_uring(_srs_config->get_io_uring_entries(), _srs_config->get_io_uring_write())) != srs_success) {
+            srs_warn("ignore io_uring, err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
     // init st
     if ((err = srs_st_init()) != srs_success) {
         return srs_error_wrap(err, "initialize st failed");
     }
     
+    // The callbacks of ST are reset by st_init, so profile the scheduler after it.
+    if ((err = SrsSchedulerStats::instance()->initialize(_srs_config->get_scheduler_profile())) != srs_success) {
+        return srs_error_wrap(err, "scheduler profile");
+    }
+    
+    if (_srs_config->get_flight_recorder_enabled()) {
+        int events = _srs_config->get_flight_recorder_events();
+        if ((err = _srs_recorder->initialize(events, _srs_config->get_flight_recorder_threshold())) != srs_success) {
+            return srs_error_wrap(err, "flight recorder");
+        }
+    }
+    
+    _srs_transcode_scheduler->initialize();
+    
     // set current log id.
     _srs_context->generate_id();
     
+    // For worker, the parent is the master process.
+    if (_srs_worker_index >= 0) {
+        ppid = ::getppid();
+    }
+    
     // check asprocess.
     bool asprocess = _srs_config->get_asprocess();
     if (asprocess && ppid == 1) {
         return srs_error_new(ERROR_SYSTEM_ASSERT_FAILED, "ppid=%d illegal for asprocess", ppid);
     }
     
-    srs_trace("server main cid=%d, pid=%d, ppid=%d, asprocess=%d",
-        _srs_context->get_id(), ::getpid(), ppid, asprocess);
+    srs_trace("server main cid=%d, pid=%d, ppid=%d, asprocess=%d, worker=%d",
+        _srs_context->get_id(), ::getpid(), ppid, asprocess, _srs_worker_index);
+    
+    // The disk io threads must start after fork, for daemon and workers.
+    if ((err = _srs_disk_io->start()) != srs_success) {
+        return srs_error_wrap(err, "disk io");
+    }
+    
+    // The fanout threads must start after fork, for daemon and workers.
+    if ((err = _srs_fanout->start()) != srs_success) {
+        return srs_error_wrap(err, "fanout");
+    }
+    
+    // The /proc collector thread must start after fork, for daemon and workers.
+    SrsConfDirective* disk = _srs_config->get_stats_disk_device();
+    _srs_proc_collector->set_disk_devices(disk ? disk->args : vector<string>());
+    if ((err = _srs_proc_collector->start()) != srs_success) {
+        return srs_error_wrap(err, "proc collector");
+    }
+    
+    // The async log thread must start after fork, for daemon and workers.
+    SrsFastLog* log = dynamic_cast<SrsFastLog*>(_srs_log);
+    if (log && (err = log->start_async()) != srs_success) {
+        return srs_error_wrap(err, "async log");
+    }
+    
+    if ((err = _srs_access_log->start()) != srs_success) {
+        return srs_error_wrap(err, "access log");
+    }
+    
+    // The control plane of API thread must start after fork, for daemon and workers.
+    if ((err = _srs_api_thread->start(this)) != srs_success) {
+        return srs_error_wrap(err, "api thread");
+    }
+    
+    // The timer wheel for periodic jobs and sleepers.
+    if ((err = _srs_timer->start()) != srs_success) {
+        return srs_error_wrap(err, "timer");
+    }
+    
+    // The DH key pool for complex handshake, refilled by timer.
+    int dh_pool = _srs_config->get_handshake_dh_pool();
+    _srs_dh_pool->set_capacity(dh_pool);
+    if (dh_pool > 0) {
+        _srs_timer->subscribe(SRS_PERF_DH_POOL_INTERVAL, this);
+    }
+    
+    // The overload controller, probe the lag of scheduler by timer.
+    if ((err = _srs_overload->initialize()) != srs_success) {
+        return srs_error_wrap(err, "overload");
+    }
+    
+    // Bind cpu after the threads of disk io and log started, which should not share the cpu of ST.
+    if ((err = initialize_affinity()) != srs_success) {
+        return srs_error_wrap(err, "affinity");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsServer::initialize_affinity()
+{
+    srs_error_t err = srs_success;
+    
+    vector<int> cpus;
+    if ((err = srs_parse_cpus(_srs_config->get_affinity_cpus(), cpus)) != srs_success) {
+        return srs_error_wrap(err, "parse cpus");
+    }
+    
+    // The node of cpu, -1 to not bind the memory.
+    int cpu = -1, node = -1;
+    if (!cpus.empty()) {
+        cpu = cpus.at(srs_max(0, _srs_worker_index) % (int)cpus.size());
+        if ((err = srs_bind_cpu(cpu, &node)) != srs_success) {
+            return srs_error_wrap(err, "bind cpu");
+        }
+    }
+    if (!_srs_config->get_memory_numa()) {
+        node = -1;
+    }
+    
+    string huge_pages = _srs_config->get_memory_huge_pages();
+    if (huge_pages != "off" || node >= 0) {
+        SrsMemoryHugePages hp = SrsMemoryHugePagesNone;
+        if (huge_pages == "transparent") {
+            hp = SrsMemoryHugePagesTransparent;
+        } else if (huge_pages == "explicit") {
+            hp = SrsMemoryHugePagesExplicit;
+        }
+        
+        int r0 = srs_pool_enable_arena(hp, node);
+        if (r0 != 0) {
+            return srs_error_new(ERROR_SYSTEM_ARENA, "arena huge_pages=%s, node=%d, errno=%d", huge_pages.c_str(), node, r0);
+        }
+    }
+    
+    if (cpu >= 0 || huge_pages != "off") {
+        srs_trace("affinity cpu=%d, node=%d, huge_pages=%s, worker=%d", cpu, node, huge_pages.c_str(), _srs_worker_index);
+    }
     
     return err;
 }
@@ -869,10 +1119,26 @@ srs_error_t SrsServer::listen()
         return srs_error_wrap(err, "http stream listen");
     }
     
+    if ((err = listen_tls()) != srs_success) {
+        return srs_error_wrap(err, "tls listen");
+    }
+    
     if ((err = listen_stream_caster()) != srs_success) {
         return srs_error_wrap(err, "stream caster listen");
     }
     
+    if ((err = listen_srt()) != srs_success) {
+        return srs_error_wrap(err, "srt listen");
+    }
+    
+    if ((err = listen_rtc()) != srs_success) {
+        return srs_error_wrap(err, "rtc listen");
+    }
+    
+    if ((err = listen_relay()) != srs_success) {
+        return srs_error_wrap(err, "relay listen");
+    }
+    
     if ((err = conn_manager->start()) != srs_success) {
         return srs_error_wrap(err, "connection manager");
     }
@@ -922,6 +1188,21 @@ srs_error_t SrsServer::http_handle()
     if ((err = http_api_mux->handle("/api/v1/meminfos", new SrsGoApiMemInfos())) != srs_success) {
         return srs_error_wrap(err, "handle meminfos");
     }
+    if ((err = http_api_mux->handle("/api/v1/disk_io", new SrsGoApiDiskIo())) != srs_success) {
+        return srs_error_wrap(err, "handle disk io");
+    }
+    if ((err = http_api_mux->handle("/api/v1/async_calls", new SrsGoApiAsyncCalls())) != srs_success) {
+        return srs_error_wrap(err, "handle async calls");
+    }
+    if ((err = http_api_mux->handle("/api/v1/file_cache", new SrsGoApiFileCache())) != srs_success) {
+        return srs_error_wrap(err, "handle file cache");
+    }
+    if ((err = http_api_mux->handle("/api/v1/uploads", new SrsGoApiUploads())) != srs_success) {
+        return srs_error_wrap(err, "handle uploads");
+    }
+    if ((err = http_api_mux->handle("/api/v1/events", new SrsGoApiEvents())) != srs_success) {
+        return srs_error_wrap(err, "handle events");
+    }
     if ((err = http_api_mux->handle("/api/v1/authors", new SrsGoApiAuthors())) != srs_success) {
         return srs_error_wrap(err, "handle authors");
     }
@@ -943,6 +1224,39 @@ srs_error_t SrsServer::http_handle()
     if ((err = http_api_mux->handle("/api/v1/clusters", new SrsGoApiClusters())) != srs_success) {
         return srs_error_wrap(err, "handle raw");
     }
+    if ((err = http_api_mux->handle("/api/v1/prefetch", new SrsGoApiPrefetch(this))) != srs_success) {
+        return srs_error_wrap(err, "handle prefetch");
+    }
+    if ((err = http_api_mux->handle("/rtc/v1/play/", new SrsGoApiRtcPlay(this))) != srs_success) {
+        return srs_error_wrap(err, "handle rtc play");
+    }
+    if ((err = http_api_mux->handle("/api/v1/snapshots", new SrsGoApiSnapshots())) != srs_success) {
+        return srs_error_wrap(err, "handle snapshots");
+    }
+    if ((err = http_api_mux->handle("/api/v1/dns", new SrsGoApiDns())) != srs_success) {
+        return srs_error_wrap(err, "handle dns");
+    }
+    if ((err = http_api_mux->handle("/api/v1/memory", new SrsGoApiMemory(this))) != srs_success) {
+        return srs_error_wrap(err, "handle memory");
+    }
+    if ((err = http_api_mux->handle("/api/v1/stacks", new SrsGoApiStacks())) != srs_success) {
+        return srs_error_wrap(err, "handle stacks");
+    }
+    if ((err = http_api_mux->handle("/api/v1/scheduler", new SrsGoApiScheduler())) != srs_success) {
+        return srs_error_wrap(err, "handle scheduler");
+    }
+    if ((err = http_api_mux->handle("/api/v1/profile", new SrsGoApiProfile())) != srs_success) {
+        return srs_error_wrap(err, "handle profile");
+    }
+    if ((err = http_api_mux->handle("/api/v1/recorder", new SrsGoApiRecorder())) != srs_success) {
+        return srs_error_wrap(err, "handle recorder");
+    }
+    if ((err = http_api_mux->handle("/api/v1/transcodes", new SrsGoApiTranscodes())) != srs_success) {
+        return srs_error_wrap(err, "handle transcodes");
+    }
+    if ((err = http_api_mux->handle("/metrics", new SrsGoApiMetrics())) != srs_success) {
+        return srs_error_wrap(err, "handle metrics");
+    }
     
     // test the request info.
     if ((err = http_api_mux->handle("/api/v1/tests/requests", new SrsGoApiRequests())) != srs_success) {
@@ -1025,6 +1339,7 @@ srs_error_t SrsServer::cycle()
     srs_trace("srs terminated");
     
     // for valgrind to detect.
+    srs_freep(_srs_access_log);
     srs_freep(_srs_config);
     srs_freep(_srs_log);
 
@@ -1045,6 +1360,7 @@ void SrsServer::on_signal(int signo)
 #ifndef SRS_AUTO_GPERF_MC
     if (signo == SRS_SIGNAL_REOPEN_LOG) {
         _srs_log->reopen();
+        _srs_access_log->reopen();
         srs_warn("reopen log file, signo=%d", signo);
         return;
     }
@@ -1063,6 +1379,24 @@ void SrsServer::on_signal(int signo)
         return;
     }
     
+    if (signo == SRS_SIGNAL_DUMP_RECORDER) {
+        dump_recorder();
+        return;
+    }
+    
+    if (signo == SRS_SIGNAL_UPGRADE) {
+        // The workers share the ports by SO_REUSEPORT, which is not supported to upgrade.
+        if (_srs_worker_index >= 0 || _srs_config->get_workers_enabled()) {
+            srs_warn("ignore upgrade for workers, signo=%d", signo);
+            return;
+        }
+        if (!signal_gracefully_quit) {
+            srs_trace("sig=%d, user start gracefully upgrade", signo);
+            signal_upgrade = true;
+        }
+        return;
+    }
+    
     if (signo == SIGINT) {
 #ifdef SRS_AUTO_GPERF_MC
         srs_trace("gmc is on, main cycle will terminate normally, signo=%d", signo);
@@ -1094,6 +1428,67 @@ void SrsServer::on_signal(int signo)
     }
 }
 
+srs_error_t SrsServer::upgrade()
+{
+    srs_error_t err = srs_success;
+    
+    std::vector<std::string> endpoints;
+    std::vector<int> fds;
+    
+    std::vector<SrsListener*>::iterator it;
+    for (it = listeners.begin(); it != listeners.end(); ++it) {
+        SrsListener* listener = *it;
+        if (listener->fd() >= 0) {
+            endpoints.push_back(listener->endpoint());
+            fds.push_back(listener->fd());
+        }
+    }
+    
+    // Release the lock of pid file, for new process to acquire it.
+    if (pid_fd > 0) {
+        ::close(pid_fd);
+        pid_fd = -1;
+    }
+    
+    if ((err = _srs_upgrade->upgrade(endpoints, fds)) != srs_success) {
+        srs_error_t r0 = acquire_pid_file();
+        if (r0 != srs_success) {
+            srs_warn("reacquire pid file, %s", srs_error_desc(r0).c_str());
+            srs_freep(r0);
+        }
+        return srs_error_wrap(err, "upgrade %d listeners", (int)fds.size());
+    }
+    
+    srs_trace("upgraded, %d listeners passed to new process", (int)fds.size());
+    upgraded = true;
+    signal_gracefully_quit = true;
+    
+    return err;
+}
+
+void SrsServer::dump_recorder()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_recorder->enabled()) {
+        srs_warn("ignore dump for recorder disabled");
+        return;
+    }
+    
+    // Each worker dumps to its own file.
+    std::string path = _srs_config->get_flight_recorder_file();
+    if (_srs_worker_index >= 0) {
+        path += "." + srs_int2str(_srs_worker_index);
+    }
+    
+    if ((err = _srs_recorder->save(path)) != srs_success) {
+        srs_warn("dump recorder, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return;
+    }
+    srs_trace("dump recorder to %s", path.c_str());
+}
+
 srs_error_t SrsServer::do_cycle()
 {
     srs_error_t err = srs_success;
@@ -1162,6 +1557,16 @@ srs_error_t SrsServer::do_cycle()
                 srs_trace("persistence config to file success.");
             }
             
+            // Start the new process, which inherits the listeners, then gracefully quit.
+            if (signal_upgrade) {
+                signal_upgrade = false;
+                
+                if ((err = upgrade()) != srs_success) {
+                    srs_warn("upgrade failed, keep serving, %s", srs_error_desc(err).c_str());
+                    srs_freep(err);
+                }
+            }
+            
             // do reload the config.
             if (signal_reload) {
                 signal_reload = false;
@@ -1188,25 +1593,32 @@ srs_error_t SrsServer::do_cycle()
                 srs_info("update resource info, rss.");
                 srs_update_system_rusage();
             }
-            if ((i % SRS_SYS_CPU_STAT_RESOLUTION_TIMES) == 0) {
-                srs_info("update cpu info, cpu usage.");
-                srs_update_proc_stat();
-            }
-            if ((i % SRS_SYS_DISK_STAT_RESOLUTION_TIMES) == 0) {
-                srs_info("update disk info, disk iops.");
-                srs_update_disk_stat();
-            }
-            if ((i % SRS_SYS_MEMINFO_RESOLUTION_TIMES) == 0) {
-                srs_info("update memory info, usage/free.");
-                srs_update_meminfo();
-            }
-            if ((i % SRS_SYS_PLATFORM_INFO_RESOLUTION_TIMES) == 0) {
-                srs_info("update platform info, uptime/load.");
-                srs_update_platform_info();
-            }
-            if ((i % SRS_SYS_NETWORK_DEVICE_RESOLUTION_TIMES) == 0) {
-                srs_info("update network devices info.");
-                srs_update_network_devices();
+            if (_srs_proc_collector->is_started()) {
+                // The /proc is sampled by the collector thread, we only apply the latest snapshot.
+                SrsConfDirective* disk = _srs_config->get_stats_disk_device();
+                _srs_proc_collector->set_disk_devices(disk ? disk->args : vector<string>());
+                _srs_proc_collector->apply();
+            } else {
+                if ((i % SRS_SYS_CPU_STAT_RESOLUTION_TIMES) == 0) {
+                    srs_info("update cpu info, cpu usage.");
+                    srs_update_proc_stat();
+                }
+                if ((i % SRS_SYS_DISK_STAT_RESOLUTION_TIMES) == 0) {
+                    srs_info("update disk info, disk iops.");
+                    srs_update_disk_stat();
+                }
+                if ((i % SRS_SYS_MEMINFO_RESOLUTION_TIMES) == 0) {
+                    srs_info("update memory info, usage/free.");
+                    srs_update_meminfo();
+                }
+                if ((i % SRS_SYS_PLATFORM_INFO_RESOLUTION_TIMES) == 0) {
+                    srs_info("update platform info, uptime/load.");
+                    srs_update_platform_info();
+                }
+                if ((i % SRS_SYS_NETWORK_DEVICE_RESOLUTION_TIMES) == 0) {
+                    srs_info("update network devices info.");
+                    srs_update_network_devices();
+                }
             }
             if ((i % SRS_SYS_NETWORK_RTMP_SERVER_RESOLUTION_TIMES) == 0) {
                 srs_info("update network server kbps info.");
@@ -1235,6 +1647,7 @@ srs_error_t SrsServer::listen_rtmp()
     srs_assert((int)ip_ports.size() > 0);
     
     close_listeners(SrsListenerRtmpStream);
+    close_listeners(SrsListenerWorkerRelay);
     
     for (int i = 0; i < (int)ip_ports.size(); i++) {
         SrsListener* listener = new SrsBufferListener(this, SrsListenerRtmpStream);
@@ -1248,6 +1661,19 @@ srs_error_t SrsServer::listen_rtmp()
         }
     }
     
+    // The relay port of worker, for sibling workers to relay stream to.
+    if (_srs_worker_index >= 0) {
+        SrsListener* listener = new SrsBufferListener(this, SrsListenerWorkerRelay);
+        listeners.push_back(listener);
+        
+        int port; string ip;
+        srs_parse_endpoint(srs_worker_relay_endpoint(_srs_worker_index), ip, port);
+        
+        if ((err = listener->listen(ip, port)) != srs_success) {
+            return srs_error_wrap(err, "worker relay listen %s:%d", ip.c_str(), port);
+        }
+    }
+    
     return err;
 }
 
@@ -1297,6 +1723,125 @@ srs_error_t SrsServer::listen_http_stream()
     return err;
 }
 
+srs_error_t SrsServer::listen_tls()
+{
+    srs_error_t err = srs_success;
+    
+    close_listeners(SrsListenerRtmps);
+    close_listeners(SrsListenerHttps);
+    if (!tls) {
+        return err;
+    }
+    
+    std::string ep = _srs_config->get_tls_rtmps();
+    if (!ep.empty()) {
+        SrsListener* listener = new SrsBufferListener(this, SrsListenerRtmps);
+        listeners.push_back(listener);
+        
+        std::string ip;
+        int port;
+        srs_parse_endpoint(ep, ip, port);
+        
+        if ((err = listener->listen(ip, port)) != srs_success) {
+            return srs_error_wrap(err, "rtmps listen %s:%d", ip.c_str(), port);
+        }
+    }
+    
+    ep = _srs_config->get_tls_https();
+    if (!ep.empty() && !_srs_config->get_http_stream_enabled()) {
+        srs_warn("ignore https %s for http server disabled", ep.c_str());
+    } else if (!ep.empty()) {
+        SrsListener* listener = new SrsBufferListener(this, SrsListenerHttps);
+        listeners.push_back(listener);
+        
+        std::string ip;
+        int port;
+        srs_parse_endpoint(ep, ip, port);
+        
+        if ((err = listener->listen(ip, port)) != srs_success) {
+            return srs_error_wrap(err, "https listen %s:%d", ip.c_str(), port);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsServer::listen_srt()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_srt_enabled()) {
+        return err;
+    }
+    
+#ifdef SRS_AUTO_SRT
+    // The SRT socket is not shared by workers, so only the first worker serves SRT.
+    if (_srs_worker_index > 0) {
+        return err;
+    }
+    
+    srs_freep(srt);
+    srt = new SrsSrtServer(this);
+    
+    int port = _srs_config->get_srt_listen();
+    if ((err = srt->listen(srs_any_address_for_listener(), port)) != srs_success) {
+        return srs_error_wrap(err, "srt listen %d", port);
+    }
+#else
+    srs_warn("ignore srt_server for SRT is disabled, see --with-srt");
+#endif
+    
+    return err;
+}
+
+srs_error_t SrsServer::listen_rtc()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_rtc_server_enabled()) {
+        return err;
+    }
+    
+    // The UDP port is not shared by workers, so only the first worker serves WebRTC.
+    if (_srs_worker_index > 0) {
+        return err;
+    }
+    
+    srs_freep(rtc);
+    rtc = new SrsRtcServer(this);
+    
+    int port = _srs_config->get_rtc_server_listen();
+    if ((err = rtc->listen(srs_any_address_for_listener(), port)) != srs_success) {
+        return srs_error_wrap(err, "rtc listen %d", port);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsServer::listen_relay()
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_relay_server_enabled()) {
+        return err;
+    }
+    
+    // The UDP port is not shared by workers, so only the first worker serves the edges over UDP.
+    if (_srs_worker_index > 0) {
+        return err;
+    }
+    
+    srs_freep(relay);
+    relay = new SrsRelayServer(this);
+    
+    int port = _srs_config->get_relay_server_listen();
+    if ((err = relay->listen(srs_any_address_for_listener(), port)) != srs_success) {
+        return srs_error_wrap(err, "relay listen %d", port);
+    }
+    
+    return err;
+}
+
 srs_error_t SrsServer::listen_stream_caster()
 {
     srs_error_t err = srs_success;
@@ -1358,22 +1903,22 @@ void SrsServer::close_listeners(SrsListenerType type)
     }
 }
 
+SrsRtcServer* SrsServer::rtc_server()
+{
+    return rtc;
+}
+
+int SrsServer::nb_conns()
+{
+    return (int)conns.size();
+}
+
 void SrsServer::resample_kbps()
 {
     SrsStatistic* stat = SrsStatistic::instance();
     
-    // collect delta from all clients.
-    for (std::vector<SrsConnection*>::iterator it = conns.begin(); it != conns.end(); ++it) {
-        SrsConnection* conn = *it;
-        
-        // add delta of connection to server kbps.,
-        // for next sample() of server kbps can get the stat.
-        stat->kbps_add_delta(conn);
-    }
-    
+    // collect delta from all clients and sample the kbps, get the stat.
     // TODO: FXME: support all other connections.
-    
-    // sample the kbps, get the stat.
     SrsKbps* kbps = stat->kbps_sample();
     
     srs_update_rtmp_server((int)conns.size(), kbps);
@@ -1383,11 +1928,19 @@ srs_error_t SrsServer::accept_client(SrsListenerType type, srs_netfd_t stfd)
 {
     srs_error_t err = srs_success;
     
+    // Reject the client before any work when overload, to drain the backlog fast.
+    if (!accept_allowed()) {
+        srs_close_stfd(stfd);
+        return err;
+    }
+    
     SrsConnection* conn = NULL;
     
     if ((err = fd2conn(type, stfd, &conn)) != srs_success) {
+        // The client is never served, close it to avoid fd leak when overload.
+        srs_close_stfd(stfd);
         if (srs_error_code(err) == ERROR_SOCKET_GET_PEER_IP && _srs_config->empty_ip_ok()) {
-            srs_close_stfd(stfd); srs_error_reset(err);
+            srs_error_reset(err);
             return srs_success;
         }
         return srs_error_wrap(err, "fd2conn");
@@ -1395,6 +1948,7 @@ srs_error_t SrsServer::accept_client(SrsListenerType type, srs_netfd_t stfd)
     srs_assert(conn);
     
     // directly enqueue, the cycle thread will remove the client.
+    conn->set_slot((int)conns.size());
     conns.push_back(conn);
     
     // cycle will start process thread and when finished remove the client.
@@ -1406,21 +1960,38 @@ srs_error_t SrsServer::accept_client(SrsListenerType type, srs_netfd_t stfd)
     return err;
 }
 
+bool SrsServer::accept_allowed()
+{
+    int rate = _srs_config->get_accept_rate();
+    if (rate <= 0) {
+        return true;
+    }
+    
+    srs_utime_t now = srs_update_monotonic_time();
+    if (now - accept_window >= SRS_UTIME_SECONDS) {
+        if (nn_window_rejects > 0) {
+            srs_warn("accept rate=%d, accepted=%d, rejected=%d", rate, nn_window_accepts, nn_window_rejects);
+        }
+        accept_window = now;
+        nn_window_accepts = nn_window_rejects = 0;
+    }
+    
+    if (nn_window_accepts >= rate) {
+        nn_window_rejects++;
+        return false;
+    }
+    
+    nn_window_accepts++;
+    return true;
+}
+
 srs_error_t SrsServer::fd2conn(SrsListenerType type, srs_netfd_t stfd, SrsConnection** pconn)
 {
     srs_error_t err = srs_success;
     
     int fd = srs_netfd_fileno(stfd);
-    string ip = srs_get_peer_ip(fd);
     
-    // for some keep alive application, for example, the keepalived,
-    // will send some tcp packet which we cann't got the ip,
-    // we just ignore it.
-    if (ip.empty()) {
-        return srs_error_new(ERROR_SOCKET_GET_PEER_IP, "ignore empty ip, fd=%d", fd);
-    }
-    
-    // check connection limitation.
+    // check connection limitation, before any work for the client.
     int max_connections = _srs_config->get_max_connections();
     if (handler && (err = handler->on_accept_client(max_connections, (int)conns.size())) != srs_success) {
         return srs_error_wrap(err, "drop client fd=%d, max=%d, cur=%d for err: %s",
@@ -1432,6 +2003,15 @@ srs_error_t SrsServer::fd2conn(SrsListenerType type, srs_netfd_t stfd, SrsConnec
             fd, max_connections, (int)conns.size());
     }
     
+    string ip = srs_get_peer_ip(fd);
+    
+    // for some keep alive application, for example, the keepalived,
+    // will send some tcp packet which we cann't got the ip,
+    // we just ignore it.
+    if (ip.empty()) {
+        return srs_error_new(ERROR_SOCKET_GET_PEER_IP, "ignore empty ip, fd=%d", fd);
+    }
+    
     // avoid fd leak when fork.
     // @see https://github.com/ossrs/srs/issues/518
     if (true) {
@@ -1451,6 +2031,16 @@ srs_error_t SrsServer::fd2conn(SrsListenerType type, srs_netfd_t stfd, SrsConnec
         *pconn = new SrsHttpApi(this, stfd, http_api_mux, ip);
     } else if (type == SrsListenerHttpStream) {
         *pconn = new SrsResponseOnlyHttpConn(this, stfd, http_server, ip);
+    } else if (type == SrsListenerRtmps) {
+        *pconn = new SrsRtmpConn(this, stfd, ip);
+        (*pconn)->set_tls(tls);
+    } else if (type == SrsListenerHttps) {
+        *pconn = new SrsResponseOnlyHttpConn(this, stfd, http_server, ip);
+        (*pconn)->set_tls(tls);
+    } else if (type == SrsListenerWorkerRelay && _srs_worker_index >= 0) {
+        SrsRtmpConn* conn = new SrsRtmpConn(this, stfd, ip);
+        conn->set_worker_relay();
+        *pconn = conn;
     } else {
         srs_warn("close for no service handler. fd=%d, ip=%s", fd, ip.c_str());
         srs_close_stfd(stfd);
@@ -1463,20 +2053,24 @@ srs_error_t SrsServer::fd2conn(SrsListenerType type, srs_netfd_t stfd, SrsConnec
 void SrsServer::remove(ISrsConnection* c)
 {
     SrsConnection* conn = dynamic_cast<SrsConnection*>(c);
-    std::vector<SrsConnection*>::iterator it = std::find(conns.begin(), conns.end(), conn);
+    int slot = conn->get_slot();
     
     // removed by destroy, ignore.
-    if (it == conns.end()) {
+    if (slot < 0 || slot >= (int)conns.size() || conns[slot] != conn) {
         srs_warn("server moved connection, ignore.");
         return;
     }
     
-    conns.erase(it);
+    // Move the last connection to the slot, to remove in O(1) for lots of clients leaving.
+    SrsConnection* last = conns.back();
+    conns[slot] = last;
+    last->set_slot(slot);
+    conns.pop_back();
+    conn->set_slot(-1);
     
     srs_info("conn removed. conns=%d", (int)conns.size());
     
     SrsStatistic* stat = SrsStatistic::instance();
-    stat->kbps_add_delta(conn);
     stat->on_disconnect(conn->srs_id());
     
     // use manager to free it async.
@@ -1602,6 +2196,11 @@ srs_error_t SrsServer::on_publish(SrsSource* s, SrsRequest* r)
         return srs_error_wrap(err, "coworkers");
     }
     
+    SrsMpegtsMulticasts* multicasts = SrsMpegtsMulticasts::instance();
+    if ((err = multicasts->on_publish(s, r)) != srs_success) {
+        return srs_error_wrap(err, "multicast");
+    }
+    
     return err;
 }
 
@@ -1611,5 +2210,18 @@ void SrsServer::on_unpublish(SrsSource* s, SrsRequest* r)
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
     coworkers->on_unpublish(s, r);
+    
+    SrsMpegtsMulticasts* multicasts = SrsMpegtsMulticasts::instance();
+    multicasts->on_unpublish(s, r);
 }
 
+srs_error_t SrsServer::on_timer(srs_utime_t /*interval*/)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = _srs_dh_pool->refill(SRS_PERF_DH_POOL_REFILL)) != srs_success) {
+        return srs_error_wrap(err, "refill dh pool");
+    }
+    
+    return err;
+}
@@ -36,6 +36,7 @@
 #include <srs_app_listener.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_service_st.hpp>
+#include <srs_app_hourglass.hpp>
 
 class SrsServer;
 class SrsConnection;
@@ -51,6 +52,10 @@ class SrsUdpListener;
 class SrsTcpListener;
 class SrsAppCasterFlv;
 class SrsCoroutineManager;
+class SrsTlsContext;
+class SrsSrtServer;
+class SrsRtcServer;
+class SrsRelayServer;
 
 // The listener type for server to identify the connection,
 // that is, use different type to process the connection.
@@ -68,6 +73,12 @@ enum SrsListenerType
     SrsListenerRtsp = 4,
     // TCP stream, FLV stream over HTTP.
     SrsListenerFlv = 5,
+    // RTMP client over TLS.
+    SrsListenerRtmps = 6,
+    // HTTP stream over TLS, HDS/HLS/DASH
+    SrsListenerHttps = 7,
+    // RTMP stream relayed from sibling worker, internal only.
+    SrsListenerWorkerRelay = 8,
 };
 
 // A common tcp listener, for RTMP/HTTP server.
@@ -85,6 +96,10 @@ public:
 public:
     virtual SrsListenerType listen_type();
     virtual srs_error_t listen(std::string i, int p) = 0;
+    // The endpoint to identify the listener for gracefully upgrade, for example, tcp://0.0.0.0:1935
+    virtual std::string endpoint();
+    // The fd of listener, -1 if not listened.
+    virtual int fd() = 0;
 };
 
 // A buffered TCP listener.
@@ -97,6 +112,7 @@ public:
     virtual ~SrsBufferListener();
 public:
     virtual srs_error_t listen(std::string ip, int port);
+    virtual int fd();
 // Interface ISrsTcpHandler
 public:
     virtual srs_error_t on_tcp_client(srs_netfd_t stfd);
@@ -113,6 +129,7 @@ public:
     virtual ~SrsRtspListener();
 public:
     virtual srs_error_t listen(std::string i, int p);
+    virtual int fd();
 // Interface ISrsTcpHandler
 public:
     virtual srs_error_t on_tcp_client(srs_netfd_t stfd);
@@ -129,6 +146,7 @@ public:
     virtual ~SrsHttpFlvListener();
 public:
     virtual srs_error_t listen(std::string i, int p);
+    virtual int fd();
 // Interface ISrsTcpHandler
 public:
     virtual srs_error_t on_tcp_client(srs_netfd_t stfd);
@@ -145,6 +163,7 @@ public:
     virtual ~SrsUdpStreamListener();
 public:
     virtual srs_error_t listen(std::string i, int p);
+    virtual int fd();
 };
 
 // A UDP listener, for udp stream caster server.
@@ -219,6 +238,7 @@ public:
 
 // SRS RTMP server, initialize and listen, start connection service thread, destroy client.
 class SrsServer : virtual public ISrsReloadHandler, virtual public ISrsSourceHandler, virtual public IConnectionManager
+    , virtual public ISrsTimerHandler
 {
 private:
     // TODO: FIXME: rename to http_api
@@ -227,6 +247,14 @@ private:
     SrsHttpHeartbeat* http_heartbeat;
     SrsIngester* ingester;
     SrsCoroutineManager* conn_manager;
+    // The TLS context of RTMPS and HTTPS, NULL if disabled.
+    SrsTlsContext* tls;
+    // The SRT server, NULL if disabled.
+    SrsSrtServer* srt;
+    // The WebRTC server, NULL if disabled.
+    SrsRtcServer* rtc;
+    // The relay server over UDP, NULL if disabled.
+    SrsRelayServer* relay;
 private:
     // The pid file fd, lock the file write when server is running.
     // @remark the init.d script should cleanup the pid file, when stop service,
@@ -247,8 +275,15 @@ private:
     bool signal_gmc_stop;
     bool signal_fast_quit;
     bool signal_gracefully_quit;
+    bool signal_upgrade;
+    // Whether the listeners are passed to the new process, then gracefully quit.
+    bool upgraded;
     // Parent pid for asprocess.
     int ppid;
+    // The window of accept rate, and the number of clients accepted and rejected in window.
+    srs_utime_t accept_window;
+    int nn_window_accepts;
+    int nn_window_rejects;
 public:
     SrsServer();
     virtual ~SrsServer();
@@ -276,6 +311,9 @@ public:
     virtual srs_error_t http_handle();
     virtual srs_error_t ingest();
     virtual srs_error_t cycle();
+private:
+    // Bind the thread of ST to cpu, and back the pool of messages by huge pages of the NUMA node.
+    virtual srs_error_t initialize_affinity();
 // server utilities.
 public:
     // The callback for signal manager got a signal.
@@ -286,12 +324,18 @@ public:
     //      SRS_SIGNAL_GRACEFULLY_QUIT, the SIGQUIT, do careful dispose then quit.
     //      SRS_SIGNAL_REOPEN_LOG, the SIGUSR1, reopen the log file.
     //      SRS_SIGNAL_RELOAD, the SIGHUP, reload the config.
+    //      SRS_SIGNAL_UPGRADE, the SIGURG, pass listeners to new process then gracefully quit.
     //      SRS_SIGNAL_PERSISTENCE_CONFIG, application level signal, persistence config to file.
     // @remark, for SIGINT:
     //       no gmc, fast quit, do essential dispose then quit.
     //       for gmc, set the variable signal_gmc_stop, the cycle will return and cleanup for gmc.
     // @remark, maybe the HTTP RAW API will trigger the on_signal() also.
     virtual void on_signal(int signo);
+private:
+    // Dump the events of flight recorder to file, for signal.
+    virtual void dump_recorder();
+    // Exec the new binary which inherits the listeners, if success, gracefully quit.
+    virtual srs_error_t upgrade();
 private:
     // The server thread main cycle,
     // update the global static data, for instance, the current time,
@@ -301,6 +345,10 @@ private:
     virtual srs_error_t listen_rtmp();
     virtual srs_error_t listen_http_api();
     virtual srs_error_t listen_http_stream();
+    virtual srs_error_t listen_tls();
+    virtual srs_error_t listen_srt();
+    virtual srs_error_t listen_rtc();
+    virtual srs_error_t listen_relay();
     virtual srs_error_t listen_stream_caster();
     // Close the listeners for specified type,
     // Remove the listen object from manager.
@@ -309,12 +357,18 @@ private:
     virtual void resample_kbps();
 // For internal only
 public:
+    // The WebRTC server, NULL if disabled.
+    virtual SrsRtcServer* rtc_server();
+    // Get the number of connections, including the HTTP API connections.
+    virtual int nb_conns();
     // When listener got a fd, notice server to accept it.
     // @param type, the client type, used to create concrete connection,
     //       for instance RTMP connection to serve client.
     // @param stfd, the client fd in st boxed, the underlayer fd.
     virtual srs_error_t accept_client(SrsListenerType type, srs_netfd_t stfd);
 private:
+    // Whether accept the client, false when exceed the accept rate.
+    virtual bool accept_allowed();
     virtual srs_error_t fd2conn(SrsListenerType type, srs_netfd_t stfd, SrsConnection** pconn);
 // Interface IConnectionManager
 public:
@@ -337,6 +391,10 @@ public:
 public:
     virtual srs_error_t on_publish(SrsSource* s, SrsRequest* r);
     virtual void on_unpublish(SrsSource* s, SrsRequest* r);
+// Interface ISrsTimerHandler
+public:
+    // Refill the DH key pool of handshake.
+    virtual srs_error_t on_timer(srs_utime_t interval);
 };
 
 #endif
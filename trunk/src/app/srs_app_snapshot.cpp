@@ -0,0 +1,342 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_snapshot.hpp>
+
+#include <unistd.h>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_process.hpp>
+#include <srs_app_utility.hpp>
+
+// The temporary files for ffmpeg to decode.
+#define SRS_SNAPSHOT_TMP_DIR "./objs"
+
+// Write the FLV to memory.
+class SrsSnapshotWriter : public ISrsWriter
+{
+private:
+    string* buf;
+public:
+    SrsSnapshotWriter(string* v) {
+        buf = v;
+    }
+    virtual ~SrsSnapshotWriter() {
+    }
+public:
+    virtual srs_error_t write(void* data, size_t size, ssize_t* nwrite) {
+        buf->append((char*)data, size);
+        if (nwrite) {
+            *nwrite = size;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t writev(const iovec* iov, int iov_size, ssize_t* nwrite) {
+        ssize_t nn = 0;
+        for (int i = 0; i < iov_size; i++) {
+            buf->append((char*)iov[i].iov_base, iov[i].iov_len);
+            nn += iov[i].iov_len;
+        }
+        if (nwrite) {
+            *nwrite = nn;
+        }
+        return srs_success;
+    }
+};
+
+srs_error_t srs_snapshot_encode_flv(vector<SrsSharedPtrMessage*>& msgs, string& flv)
+{
+    srs_error_t err = srs_success;
+    
+    bool has_video = false, has_audio = false;
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs.at(i);
+        has_video |= msg->is_video();
+        has_audio |= msg->is_audio();
+        msg->timestamp = 0;
+    }
+    
+    flv.clear();
+    SrsSnapshotWriter writer(&flv);
+    
+    SrsFlvTransmuxer enc;
+    if ((err = enc.initialize(&writer)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    if ((err = enc.write_header(has_video, has_audio)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+    
+    if (!msgs.empty() && (err = enc.write_tags(&msgs[0], (int)msgs.size())) != srs_success) {
+        return srs_error_wrap(err, "write tags");
+    }
+    
+    return err;
+}
+
+SrsSnapshot::SrsSnapshot()
+{
+    timestamp = -1;
+    updated_at = 0;
+    jpeg_timestamp = -1;
+    decoding = false;
+    decoded = srs_cond_new();
+    nn_refs = 0;
+}
+
+SrsSnapshot::~SrsSnapshot()
+{
+    srs_cond_destroy(decoded);
+}
+
+SrsSnapshotService::SrsSnapshotService()
+{
+    nn_decoders = 0;
+    decoder_released = srs_cond_new();
+    nn_decodes = 0;
+}
+
+SrsSnapshotService::~SrsSnapshotService()
+{
+    std::map<string, SrsSnapshot*>::iterator it;
+    for (it = snapshots.begin(); it != snapshots.end(); ++it) {
+        SrsSnapshot* s = it->second;
+        srs_freep(s);
+    }
+    snapshots.clear();
+    
+    srs_cond_destroy(decoder_released);
+}
+
+srs_error_t SrsSnapshotService::fetch(SrsSource* source, string url, srs_utime_t interval, SrsSnapshot** ps)
+{
+    srs_error_t err = srs_success;
+    
+    sweep(interval);
+    
+    SrsSnapshot* s = NULL;
+    std::map<string, SrsSnapshot*>::iterator it = snapshots.find(url);
+    if (it != snapshots.end()) {
+        s = it->second;
+    }
+    
+    // Serve from cache in the interval.
+    srs_utime_t now = srs_get_system_time();
+    if (s && now - s->updated_at < interval) {
+        *ps = s;
+        return err;
+    }
+    
+    vector<SrsSharedPtrMessage*> msgs;
+    err = source->snapshot(msgs);
+    
+    // The keyframe is the last one, get its timestamp before encoding, which resets it.
+    int64_t timestamp = msgs.empty()? -1 : msgs.back()->timestamp;
+    
+    string flv;
+    if (err == srs_success) {
+        err = srs_snapshot_encode_flv(msgs, flv);
+    }
+    
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs.at(i);
+        srs_freep(msg);
+    }
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "snapshot %s", url.c_str());
+    }
+    
+    if (!s) {
+        s = new SrsSnapshot();
+        snapshots[url] = s;
+    }
+    
+    s->timestamp = timestamp;
+    s->flv = flv;
+    s->updated_at = now;
+    
+    *ps = s;
+    return err;
+}
+
+srs_error_t SrsSnapshotService::decode(SrsSnapshot* s, string ffmpeg, int decoders, srs_utime_t timeout)
+{
+    srs_error_t err = srs_success;
+    
+    s->nn_refs++;
+    err = do_decode(s, ffmpeg, decoders, srs_get_system_time() + timeout);
+    s->nn_refs--;
+    
+    return err;
+}
+
+srs_error_t SrsSnapshotService::do_decode(SrsSnapshot* s, string ffmpeg, int decoders, srs_utime_t deadline)
+{
+    srs_error_t err = srs_success;
+    
+    // Wait for the decoding one, which is decoded from the same or an older keyframe.
+    while (s->decoding) {
+        srs_utime_t now = srs_get_system_time();
+        if (now >= deadline || srs_cond_timedwait(s->decoded, deadline - now) != 0) {
+            return srs_error_new(ERROR_SNAPSHOT_DECODE, "wait for decoding timeout");
+        }
+    }
+    
+    // Reuse the jpeg of the same keyframe.
+    if (!s->jpeg.empty() && s->jpeg_timestamp == s->timestamp) {
+        return err;
+    }
+    
+    s->decoding = true;
+    
+    // Wait for a decoder.
+    while (nn_decoders >= decoders) {
+        srs_utime_t now = srs_get_system_time();
+        if (now >= deadline || srs_cond_timedwait(decoder_released, deadline - now) != 0) {
+            s->decoding = false;
+            srs_cond_broadcast(s->decoded);
+            return srs_error_new(ERROR_SNAPSHOT_DECODE, "wait for decoder timeout, decoders=%d", nn_decoders);
+        }
+    }
+    
+    // The snapshot maybe updated when decoding, so we copy it.
+    int64_t timestamp = s->timestamp;
+    string flv = s->flv;
+    
+    string jpeg;
+    nn_decoders++;
+    err = do_decode_jpeg(ffmpeg, flv, deadline, jpeg);
+    nn_decoders--;
+    srs_cond_signal(decoder_released);
+    
+    if (err == srs_success) {
+        s->jpeg = jpeg;
+        s->jpeg_timestamp = timestamp;
+    }
+    
+    s->decoding = false;
+    srs_cond_broadcast(s->decoded);
+    
+    return err;
+}
+
+srs_error_t SrsSnapshotService::do_decode_jpeg(string ffmpeg, const string& flv, srs_utime_t deadline, string& jpeg)
+{
+    srs_error_t err = srs_success;
+    
+    std::stringstream ss;
+    ss << SRS_SNAPSHOT_TMP_DIR << "/snapshot-" << getpid() << "-" << nn_decodes++;
+    string input = ss.str() + ".flv";
+    string output = ss.str() + ".jpg";
+    
+    if (true) {
+        SrsFileWriter fw;
+        if ((err = fw.open(input)) != srs_success) {
+            return srs_error_wrap(err, "open %s", input.c_str());
+        }
+        if ((err = fw.write((void*)flv.data(), flv.length(), NULL)) != srs_success) {
+            ::unlink(input.c_str());
+            return srs_error_wrap(err, "write %s", input.c_str());
+        }
+    }
+    
+    vector<string> argv;
+    argv.push_back(ffmpeg);
+    argv.push_back("-y");
+    argv.push_back("-i");
+    argv.push_back(input);
+    argv.push_back("-frames:v");
+    argv.push_back("1");
+    argv.push_back("-f");
+    argv.push_back("image2");
+    argv.push_back(output);
+    argv.push_back("1>/dev/null");
+    argv.push_back("2>/dev/null");
+    
+    SrsProcess process;
+    if ((err = process.initialize(ffmpeg, argv)) == srs_success) {
+        err = process.start();
+    }
+    
+    // Wait for ffmpeg to quit, or kill it when timeout.
+    while (err == srs_success && process.started()) {
+        if (srs_get_system_time() >= deadline) {
+            process.stop();
+            err = srs_error_new(ERROR_SNAPSHOT_DECODE, "ffmpeg timeout");
+            break;
+        }
+        
+        srs_usleep(20 * SRS_UTIME_MILLISECONDS);
+        err = process.cycle();
+    }
+    
+    if (err == srs_success) {
+        SrsFileReader fr;
+        if ((err = fr.open(output)) == srs_success) {
+            jpeg.resize(fr.filesize());
+            if (!jpeg.empty()) {
+                err = fr.read((void*)jpeg.data(), jpeg.length(), NULL);
+            }
+        }
+        if (err == srs_success && jpeg.empty()) {
+            err = srs_error_new(ERROR_SNAPSHOT_DECODE, "empty jpeg");
+        }
+    }
+    
+    ::unlink(input.c_str());
+    ::unlink(output.c_str());
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "decode by %s", ffmpeg.c_str());
+    }
+    
+    return err;
+}
+
+void SrsSnapshotService::sweep(srs_utime_t interval)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    std::map<string, SrsSnapshot*>::iterator it;
+    for (it = snapshots.begin(); it != snapshots.end();) {
+        SrsSnapshot* s = it->second;
+        if (s->nn_refs > 0 || now - s->updated_at < interval + SRS_SNAPSHOT_EXPIRE) {
+            ++it;
+            continue;
+        }
+        
+        srs_freep(s);
+        snapshots.erase(it++);
+    }
+}
+
@@ -0,0 +1,99 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_SNAPSHOT_HPP
+#define SRS_APP_SNAPSHOT_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <srs_app_st.hpp>
+
+class SrsSource;
+class SrsSharedPtrMessage;
+
+// The snapshots not requested for this duration are removed.
+#define SRS_SNAPSHOT_EXPIRE (30 * SRS_UTIME_SECONDS)
+
+// Encode the messages to a FLV snippet, the timestamps are reset to 0, so it's a standalone file.
+extern srs_error_t srs_snapshot_encode_flv(std::vector<SrsSharedPtrMessage*>& msgs, std::string& flv);
+
+// The keyframe snapshot of stream, that is the FLV snippet of metadata, sequence headers and the
+// latest keyframe in gop cache, and the JPEG decoded from it on demand.
+class SrsSnapshot
+{
+public:
+    // The timestamp in ms of keyframe.
+    int64_t timestamp;
+    // When the FLV snippet generated, it's regenerated after interval.
+    srs_utime_t updated_at;
+    // The FLV snippet.
+    std::string flv;
+    // The JPEG decoded from FLV, empty if not decoded.
+    std::string jpeg;
+    // The timestamp in ms of keyframe which JPEG is decoded from.
+    int64_t jpeg_timestamp;
+    // Whether the JPEG is decoding, others wait for it rather than start another decoder.
+    bool decoding;
+    srs_cond_t decoded;
+    // The number of coroutines waiting on it, never free it when in use.
+    int nn_refs;
+public:
+    SrsSnapshot();
+    virtual ~SrsSnapshot();
+};
+
+// The service to snapshot streams, cached for interval per stream, so the thumbnails of lots of
+// streams are generated on demand, rather than a ffmpeg decoding each stream continuously.
+class SrsSnapshotService
+{
+private:
+    std::map<std::string, SrsSnapshot*> snapshots;
+    // The number of running decoders.
+    int nn_decoders;
+    srs_cond_t decoder_released;
+    // The sequence to name the temporary files.
+    int64_t nn_decodes;
+public:
+    SrsSnapshotService();
+    virtual ~SrsSnapshotService();
+public:
+    // Fetch the snapshot of source by url, regenerate it from gop cache when expired.
+    // @remark The snapshot is owned by service and updated by fetch, so copy the data before any yield.
+    virtual srs_error_t fetch(SrsSource* source, std::string url, srs_utime_t interval, SrsSnapshot** ps);
+    // Decode the JPEG of snapshot by ffmpeg, reuse it if decoded from the same keyframe.
+    // @param decoders The max number of running decoders, others wait for them.
+    // @param timeout The timeout to decode, including waiting for a decoder.
+    virtual srs_error_t decode(SrsSnapshot* s, std::string ffmpeg, int decoders, srs_utime_t timeout);
+private:
+    virtual srs_error_t do_decode(SrsSnapshot* s, std::string ffmpeg, int decoders, srs_utime_t deadline);
+    virtual srs_error_t do_decode_jpeg(std::string ffmpeg, const std::string& flv, srs_utime_t deadline, std::string& jpeg);
+    // Remove the snapshots not requested for a while.
+    virtual void sweep(srs_utime_t interval);
+};
+
+#endif
+
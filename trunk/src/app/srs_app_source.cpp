@@ -44,11 +44,17 @@ using namespace std;
 #include <srs_rtmp_msg_array.hpp>
 #include <srs_app_hds.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_hourglass.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_ng_exec.hpp>
 #include <srs_app_dash.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_conn.hpp>
+#include <srs_app_overload.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_kernel_recorder.hpp>
 
 #define CONST_MAX_JITTER_MS         250
 #define CONST_MAX_JITTER_MS_NEG         -250
@@ -64,6 +70,9 @@ using namespace std;
 // the time to cleanup source.
 #define SRS_SOURCE_CLEANUP (30 * SRS_UTIME_SECONDS)
 
+// the time to hold the state of replica, for the publisher to take over it.
+#define SRS_STANDBY_REPLICA_HOLD (10 * SRS_UTIME_SECONDS)
+
 int srs_time_jitter_string2int(std::string time_jitter)
 {
     if (time_jitter == "full") {
@@ -75,6 +84,88 @@ int srs_time_jitter_string2int(std::string time_jitter)
     }
 }
 
+srs_error_t srs_aggregate_messages(SrsSharedPtrMessage** msgs, int& count)
+{
+    srs_error_t err = srs_success;
+    
+    // The packed messages, never more than count.
+    int nn_msgs = 0;
+    
+    for (int i = 0; i < count;) {
+        // Find the continuous audio and video messages in [i, j),
+        // each is a FLV tag in aggregate, which is 11B header, the payload and 4B previous tag size.
+        int j = i;
+        int size = 0;
+        for (; j < count && msgs[j]->is_av(); j++) {
+            int tag_size = 11 + msgs[j]->size + 4;
+            if (size + tag_size > 0xFFFFFF) {
+                break;
+            }
+            size += tag_size;
+        }
+        
+        // Ignore the other message, or only one audio or video.
+        if (j - i < 2) {
+            j = srs_max(j, i + 1);
+            for (; i < j; i++) {
+                msgs[nn_msgs++] = msgs[i];
+            }
+            continue;
+        }
+        
+        SrsSharedPtrMessage* first = msgs[i];
+        
+        SrsCommonMessage o;
+        o.header.message_type = RTMP_MSG_AggregateMessage;
+        o.header.payload_length = size;
+        o.header.timestamp = first->timestamp;
+        o.header.stream_id = first->stream_id;
+        o.header.perfer_cid = RTMP_CID_Video;
+        o.create_payload(size);
+        o.size = size;
+        
+        // The timestamp in aggregate is absolute, the player uses the delta to the timestamp of message.
+        SrsBuffer stream(o.payload, o.size);
+        for (; i < j; i++) {
+            SrsSharedPtrMessage* msg = msgs[i];
+            
+            stream.write_1bytes(msg->is_audio()? RTMP_MSG_AudioMessage : RTMP_MSG_VideoMessage);
+            stream.write_3bytes(msg->size);
+            stream.write_3bytes((int32_t)(msg->timestamp & 0xFFFFFF));
+            stream.write_1bytes((int8_t)((msg->timestamp >> 24) & 0x7F));
+            stream.write_3bytes(0);
+            stream.write_bytes(msg->payload, msg->size);
+            stream.write_4bytes(11 + msg->size);
+            
+            srs_freep(msg);
+            msgs[i] = NULL;
+        }
+        
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        if ((err = msg->create(&o)) != srs_success) {
+            srs_freep(msg);
+            // Free the left messages, which are not sent.
+            for (int k = 0; k < nn_msgs; k++) {
+                srs_freep(msgs[k]);
+            }
+            for (; i < count; i++) {
+                srs_freep(msgs[i]);
+            }
+            count = 0;
+            return srs_error_wrap(err, "create aggregate");
+        }
+        msgs[nn_msgs++] = msg;
+    }
+    
+    // Reset the slots which are moved.
+    for (int i = nn_msgs; i < count; i++) {
+        msgs[i] = NULL;
+    }
+    count = nn_msgs;
+    
+    return err;
+}
+
 SrsRtmpJitter::SrsRtmpJitter()
 {
     last_pkt_correct_time = -1;
@@ -128,6 +219,18 @@ srs_error_t SrsRtmpJitter::correct(SrsSharedPtrMessage* msg, SrsRtmpJitterAlgori
      *     and enforce the time monotonically.
      */
     int64_t time = msg->timestamp;
+    msg->timestamp = correct_by(time, delta_of(time));
+    
+    return err;
+}
+
+int64_t SrsRtmpJitter::get_time()
+{
+    return last_pkt_correct_time;
+}
+
+int64_t SrsRtmpJitter::delta_of(int64_t time)
+{
     int64_t delta = time - last_pkt_time;
     
     // if jitter detected, reset the delta.
@@ -137,112 +240,161 @@ srs_error_t SrsRtmpJitter::correct(SrsSharedPtrMessage* msg, SrsRtmpJitterAlgori
         delta = DEFAULT_FRAME_TIME_MS;
     }
     
+    return delta;
+}
+
+int64_t SrsRtmpJitter::correct_by(int64_t time, int64_t delta)
+{
     last_pkt_correct_time = srs_max(0, last_pkt_correct_time + delta);
-    
-    msg->timestamp = last_pkt_correct_time;
     last_pkt_time = time;
     
-    return err;
+    return last_pkt_correct_time;
 }
 
-int64_t SrsRtmpJitter::get_time()
+bool SrsRtmpJitter::in_step(SrsRtmpJitter* o)
 {
-    return last_pkt_correct_time;
+    return last_pkt_time == o->last_pkt_time;
 }
 
-#ifdef SRS_PERF_QUEUE_FAST_VECTOR
-SrsFastVector::SrsFastVector()
+// The initial capacity of message ring, must be power of 2.
+#define SRS_MESSAGE_RING_CAPACITY 8
+
+SrsMessageRing::SrsMessageRing() : memory(SrsMemoryQueue)
 {
-    count = 0;
-    nb_msgs = 8;
-    msgs = new SrsSharedPtrMessage*[nb_msgs];
+    capacity = SRS_MESSAGE_RING_CAPACITY;
+    mask = capacity - 1;
+    msgs = new SrsSharedPtrMessage*[capacity];
+    head = tail = 0;
+    keyframe = -1;
 }
 
-SrsFastVector::~SrsFastVector()
+SrsMessageRing::~SrsMessageRing()
 {
     free();
     srs_freepa(msgs);
 }
 
-int SrsFastVector::size()
-{
-    return count;
-}
-
-int SrsFastVector::begin()
+void SrsMessageRing::set_memory(SrsMemoryStat* v)
 {
-    return 0;
+    memory.set_stat(v);
 }
 
-int SrsFastVector::end()
+int SrsMessageRing::size()
 {
-    return count;
+    return (int)(tail - head);
 }
 
-SrsSharedPtrMessage** SrsFastVector::data()
+bool SrsMessageRing::empty()
 {
-    return msgs;
+    return tail == head;
 }
 
-SrsSharedPtrMessage* SrsFastVector::at(int index)
+SrsSharedPtrMessage* SrsMessageRing::at(int index)
 {
-    srs_assert(index < count);
-    return msgs[index];
+    srs_assert(index >= 0 && index < size());
+    return msgs[(head + index) & mask];
 }
 
-void SrsFastVector::clear()
+int SrsMessageRing::last_keyframe()
 {
-    count = 0;
+    if (keyframe < head) {
+        return -1;
+    }
+    return (int)(keyframe - head);
 }
 
-void SrsFastVector::erase(int _begin, int _end)
+void SrsMessageRing::push_back(SrsSharedPtrMessage* msg)
 {
-    srs_assert(_begin < _end);
+    if (tail - head >= capacity) {
+        grow();
+    }
     
-    // move all erased to previous.
-    for (int i = 0; i < count - _end; i++) {
-        msgs[_begin + i] = msgs[_end + i];
+    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+        keyframe = tail;
     }
     
-    // update the count.
-    count -= _end - _begin;
+    msgs[tail & mask] = msg;
+    memory.add(msg->size);
+    
+    // Publish the slot before the sequence, for the consumer in other thread.
+    __sync_synchronize();
+    tail = tail + 1;
 }
 
-void SrsFastVector::push_back(SrsSharedPtrMessage* msg)
+int SrsMessageRing::pop_front(SrsSharedPtrMessage** pmsgs, int max)
 {
-    // increase vector.
-    if (count >= nb_msgs) {
-        int size = srs_max(SRS_PERF_MW_MSGS * 8, nb_msgs * 2);
-        SrsSharedPtrMessage** buf = new SrsSharedPtrMessage*[size];
-        for (int i = 0; i < nb_msgs; i++) {
-            buf[i] = msgs[i];
-        }
-        srs_info("fast vector incrase %d=>%d", nb_msgs, size);
-        
-        // use new array.
-        srs_freepa(msgs);
-        msgs = buf;
-        nb_msgs = size;
+    int count = srs_min(max, size());
+    
+    int64_t nb_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs[(head + i) & mask];
+        nb_bytes += msg->size;
+        pmsgs[i] = msg;
     }
+    memory.add(-nb_bytes);
+    
+    // Release the slots after read, for the producer in other thread.
+    __sync_synchronize();
+    head = head + count;
     
-    msgs[count++] = msg;
+    return count;
 }
 
-void SrsFastVector::free()
+void SrsMessageRing::erase_front(int count)
 {
+    srs_assert(count <= size());
+    
+    int64_t nb_bytes = 0;
     for (int i = 0; i < count; i++) {
-        SrsSharedPtrMessage* msg = msgs[i];
+        SrsSharedPtrMessage* msg = msgs[(head + i) & mask];
+        nb_bytes += msg->size;
         srs_freep(msg);
     }
-    count = 0;
+    memory.add(-nb_bytes);
+    head = head + count;
+}
+
+void SrsMessageRing::clear()
+{
+    head = tail;
+    keyframe = -1;
+    memory.update(0);
+}
+
+void SrsMessageRing::free()
+{
+    erase_front(size());
+    keyframe = -1;
+}
+
+void SrsMessageRing::grow()
+{
+    int size = srs_max(SRS_PERF_MW_MSGS * 8, capacity * 2);
+    SrsSharedPtrMessage** buf = new SrsSharedPtrMessage*[size];
+    
+    // Keep the slot of sequence, which is (sequence & mask).
+    int64_t nmask = size - 1;
+    for (int64_t i = head; i < tail; i++) {
+        buf[i & nmask] = msgs[i & mask];
+    }
+    srs_info("message ring incrase %d=>%d", capacity, size);
+    
+    srs_freepa(msgs);
+    msgs = buf;
+    capacity = size;
+    mask = nmask;
 }
-#endif
 
 SrsMessageQueue::SrsMessageQueue(bool ignore_shrink)
 {
     _ignore_shrink = ignore_shrink;
     max_queue_size = 0;
     av_start_time = av_end_time = -1;
+    nb_drops = 0;
+    drop_ratio = 0;
+    drop_video = false;
+    nb_frame_drops = 0;
+    dump_delay = 0;
 }
 
 SrsMessageQueue::~SrsMessageQueue()
@@ -265,10 +417,46 @@ void SrsMessageQueue::set_queue_size(srs_utime_t queue_size)
 	max_queue_size = queue_size;
 }
 
+int64_t SrsMessageQueue::drops()
+{
+    return nb_drops;
+}
+
+void SrsMessageQueue::set_drop_ratio(double v)
+{
+    drop_ratio = v;
+}
+
+int64_t SrsMessageQueue::frame_drops()
+{
+    return nb_frame_drops;
+}
+
+srs_utime_t SrsMessageQueue::delay()
+{
+    return dump_delay;
+}
+
+void SrsMessageQueue::set_memory(SrsMemoryStat* v)
+{
+    msgs.set_memory(v);
+}
+
 srs_error_t SrsMessageQueue::enqueue(SrsSharedPtrMessage* msg, bool* is_overflow)
 {
     srs_error_t err = srs_success;
     
+    // Drop the video frames for slow consumer, before the queue is full.
+    if (drop_ratio > 0 && msg->is_video() && should_drop(msg)) {
+        srs_freep(msg);
+        nb_frame_drops++;
+        
+        if (is_overflow) {
+            *is_overflow = true;
+        }
+        return err;
+    }
+    
     if (msg->is_av()) {
         if (av_start_time == -1) {
             av_start_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
@@ -301,27 +489,14 @@ srs_error_t SrsMessageQueue::dump_packets(int max_count, SrsSharedPtrMessage** p
     }
     
     srs_assert(max_count > 0);
-    count = srs_min(max_count, nb_msgs);
+    count = msgs.pop_front(pmsgs, max_count);
     
-    SrsSharedPtrMessage** omsgs = msgs.data();
-    for (int i = 0; i < count; i++) {
-        pmsgs[i] = omsgs[i];
-    }
+    // The delay of the oldest message, which is sent after all the messages before the newest one.
+    dump_delay = srs_max(0, av_end_time - av_start_time);
     
-    SrsSharedPtrMessage* last = omsgs[count - 1];
+    SrsSharedPtrMessage* last = pmsgs[count - 1];
     av_start_time = srs_utime_t(last->timestamp * SRS_UTIME_MILLISECONDS);
     
-    if (count >= nb_msgs) {
-        // the pmsgs is big enough and clear msgs at most time.
-        msgs.clear();
-    } else {
-        // erase some vector elements may cause memory copy,
-        // maybe can use more efficient vector.swap to avoid copy.
-        // @remark for the pmsgs is big enough, for instance, SRS_PERF_MW_MSGS 128,
-        //      the rtmp play client will get 128msgs once, so this branch rarely execute.
-        msgs.erase(msgs.begin(), msgs.begin() + count);
-    }
-    
     return err;
 }
 
@@ -334,9 +509,8 @@ srs_error_t SrsMessageQueue::dump_packets(SrsConsumer* consumer, bool atc, SrsRt
         return err;
     }
     
-    SrsSharedPtrMessage** omsgs = msgs.data();
     for (int i = 0; i < nb_msgs; i++) {
-        SrsSharedPtrMessage* msg = omsgs[i];
+        SrsSharedPtrMessage* msg = msgs.at(i);
         if ((err = consumer->enqueue(msg, atc, ag)) != srs_success) {
             return srs_error_wrap(err, "consume message");
         }
@@ -345,16 +519,66 @@ srs_error_t SrsMessageQueue::dump_packets(SrsConsumer* consumer, bool atc, SrsRt
     return err;
 }
 
+bool SrsMessageQueue::should_drop(SrsSharedPtrMessage* msg)
+{
+    // Never drop the keyframe and sequence header, which stops dropping the video.
+    if (SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+        drop_video = false;
+        return false;
+    }
+    
+    if (drop_video) {
+        return true;
+    }
+    
+    if (av_start_time == -1) {
+        return false;
+    }
+    
+    srs_utime_t duration = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS) - av_start_time;
+    srs_utime_t start = srs_utime_t(max_queue_size * drop_ratio);
+    
+    // Drop the video until next keyframe, but keep the audio.
+    if (duration > start + (max_queue_size - start) / 2) {
+        drop_video = true;
+        if (!_ignore_shrink) {
+            srs_trace("drop video for slow consumer, duration=%dms, max=%dms", srsu2msi(duration), srsu2msi(max_queue_size));
+        }
+        return true;
+    }
+    
+    return duration > start && SrsFlvVideo::disposable(msg->payload, msg->size);
+}
+
 void SrsMessageQueue::shrink()
 {
     SrsSharedPtrMessage* video_sh = NULL;
     SrsSharedPtrMessage* audio_sh = NULL;
     int msgs_size = (int)msgs.size();
     
-    // remove all msg
-    // igone the sequence header
-    for (int i = 0; i < (int)msgs.size(); i++) {
+    // Keep the last gop, or remove all msgs if no keyframe or the gop is too large.
+    int nb_remove = msgs.last_keyframe();
+    for (int i = 0; i < nb_remove; i++) {
         SrsSharedPtrMessage* msg = msgs.at(i);
+        if (!msg->is_video() || !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            if (!msg->is_audio() || !SrsFlvAudio::sh(msg->payload, msg->size)) {
+                break;
+            }
+        }
+        // Only sequence headers before the keyframe, the gop is too large.
+        if (i == nb_remove - 1) {
+            nb_remove = 0;
+        }
+    }
+    if (nb_remove <= 0) {
+        nb_remove = msgs_size;
+    }
+    
+    // remove the msgs before the last keyframe,
+    // igone the sequence header
+    for (int i = 0; i < nb_remove; i++) {
+        SrsSharedPtrMessage* msg = NULL;
+        msgs.pop_front(&msg, 1);
         
         if (msg->is_video() && SrsFlvVideo::sh(msg->payload, msg->size)) {
             srs_freep(video_sh);
@@ -368,20 +592,39 @@ void SrsMessageQueue::shrink()
         }
         
         srs_freep(msg);
+        nb_drops++;
     }
-    msgs.clear();
     
     // update av_start_time
-    av_start_time = av_end_time;
+    if (msgs.empty()) {
+        av_start_time = av_end_time;
+    } else {
+        av_start_time = srs_utime_t(msgs.at(0)->timestamp * SRS_UTIME_MILLISECONDS);
+    }
+    
+    // The sequence headers should be the first messages, so move the left msgs after them.
+    int nb_left = msgs.size();
+    SrsSharedPtrMessage** left = NULL;
+    if (nb_left > 0 && (video_sh || audio_sh)) {
+        left = new SrsSharedPtrMessage*[nb_left];
+        msgs.pop_front(left, nb_left);
+    }
+    SrsAutoFreeA(SrsSharedPtrMessage*, left);
+    
     //push_back secquence header and update timestamp
     if (video_sh) {
-        video_sh->timestamp = srsu2ms(av_end_time);
+        video_sh->timestamp = srsu2ms(av_start_time);
         msgs.push_back(video_sh);
     }
     if (audio_sh) {
-        audio_sh->timestamp = srsu2ms(av_end_time);
+        audio_sh->timestamp = srsu2ms(av_start_time);
         msgs.push_back(audio_sh);
     }
+    for (int i = 0; left && i < nb_left; i++) {
+        msgs.push_back(left[i]);
+    }
+    
+    _srs_recorder->record(SrsRecorderEventQueueShrink, 0, msgs_size - (int)msgs.size());
     
     if (!_ignore_shrink) {
         srs_trace("shrinking, size=%d, removed=%d, max=%dms", (int)msgs.size(), msgs_size - (int)msgs.size(), srsu2msi(max_queue_size));
@@ -390,18 +633,7 @@ void SrsMessageQueue::shrink()
 
 void SrsMessageQueue::clear()
 {
-#ifndef SRS_PERF_QUEUE_FAST_VECTOR
-    std::vector<SrsSharedPtrMessage*>::iterator it;
-    
-    for (it = msgs.begin(); it != msgs.end(); ++it) {
-        SrsSharedPtrMessage* msg = *it;
-        srs_freep(msg);
-    }
-#else
     msgs.free();
-#endif
-    
-    msgs.clear();
     
     av_start_time = av_end_time = -1;
 }
@@ -422,6 +654,12 @@ SrsConsumer::SrsConsumer(SrsSource* s, SrsConnection* c)
     jitter = new SrsRtmpJitter();
     queue = new SrsMessageQueue();
     should_update_source_id = false;
+    nb_drops = 0;
+    drop_ratio = 0;
+    aggregate = false;
+    slot = -1;
+    timeshift = 0;
+    timeshift_cursor = 0;
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     mw_wait = srs_cond_new();
@@ -442,11 +680,22 @@ SrsConsumer::~SrsConsumer()
 #endif
 }
 
+void SrsConsumer::set_aggregate(bool v)
+{
+    aggregate = v;
+}
+
 void SrsConsumer::set_queue_size(srs_utime_t queue_size)
 {
     queue->set_queue_size(queue_size);
 }
 
+void SrsConsumer::set_drop_ratio(double v)
+{
+    drop_ratio = v;
+    queue->set_drop_ratio(v);
+}
+
 void SrsConsumer::update_source_id()
 {
     should_update_source_id = true;
@@ -457,6 +706,16 @@ int64_t SrsConsumer::get_time()
     return jitter->get_time();
 }
 
+srs_utime_t SrsConsumer::duration()
+{
+    return queue->duration();
+}
+
+srs_utime_t SrsConsumer::delay()
+{
+    return queue->delay();
+}
+
 srs_error_t SrsConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsRtmpJitterAlgorithm ag)
 {
     srs_error_t err = srs_success;
@@ -469,33 +728,68 @@ srs_error_t SrsConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsR
         }
     }
     
-    if ((err = queue->enqueue(msg, NULL)) != srs_success) {
+    return enqueue_corrected(msg);
+}
+
+srs_error_t SrsConsumer::enqueue_corrected(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // Drop more frames for slow consumer when overload.
+    if (msg->is_video()) {
+        queue->set_drop_ratio(_srs_overload->drop_ratio(drop_ratio));
+    }
+    
+    bool is_overflow = false;
+    if ((err = queue->enqueue(msg, &is_overflow)) != srs_success) {
         return srs_error_wrap(err, "enqueue message");
     }
     
+    // Report the dropped messages when overflow, for metrics.
+    if (is_overflow) {
+        SrsStatistic* stat = SrsStatistic::instance();
+        
+        int64_t v = queue->drops() + queue->frame_drops();
+        stat->on_queue_drops(source->req, (int)(v - nb_drops));
+        nb_drops = v;
+        
+        if (conn) {
+            stat->on_client_drops(conn->srs_id(), queue->drops(), queue->frame_drops());
+        }
+    }
+    
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    // fire the mw when msgs is enough.
-    if (mw_waiting) {
-        srs_utime_t duration = queue->duration();
-        bool match_min_msgs = queue->size() > mw_min_msgs;
-        
-        // For ATC, maybe the SH timestamp bigger than A/V packet,
-        // when encoder republish or overflow.
-        // @see https://github.com/ossrs/srs/pull/749
-        if (atc && duration < 0) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
+    // fire the mw when msgs is enough, or when the batch of source end.
+    if (!source->batching) {
+        update_wait(source->atc);
+    }
+#endif
+    
+    return err;
+}
+
+srs_error_t SrsConsumer::enqueue_timeshift(SrsTimeShift* ts, bool atc, SrsRtmpJitterAlgorithm ag)
+{
+    srs_error_t err = srs_success;
+    
+    // Resume from the next keyframe, when the messages of cursor are dropped.
+    if (timeshift_cursor < ts->begin()) {
+        int64_t seq = ts->next_keyframe(ts->begin());
+        srs_warn("timeshift: cursor %" PRId64 " dropped, resume at %" PRId64, timeshift_cursor, seq);
+        timeshift_cursor = seq;
+    }
+    
+    int64_t deadline = ts->last_timestamp() - srsu2ms(timeshift);
+    for (; timeshift_cursor < ts->end(); timeshift_cursor++) {
+        SrsSharedPtrMessage* msg = ts->at(timeshift_cursor);
+        if (msg->timestamp > deadline) {
+            break;
         }
         
-        // when duration ok, signal to flush.
-        if (match_min_msgs && duration > mw_duration) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
+        if ((err = enqueue(msg, atc, ag)) != srs_success) {
+            return srs_error_wrap(err, "timeshift");
         }
     }
-#endif
     
     return err;
 }
@@ -529,14 +823,18 @@ srs_error_t SrsConsumer::dump_packets(SrsMessageArray* msgs, int& count)
         return srs_error_wrap(err, "dump packets");
     }
     
+    if (aggregate && count > 1 && (err = srs_aggregate_messages(msgs->msgs, count)) != srs_success) {
+        return srs_error_wrap(err, "aggregate packets");
+    }
+    
     return err;
 }
 
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-void SrsConsumer::wait(int nb_msgs, srs_utime_t msgs_duration)
+void SrsConsumer::wait(int nb_msgs, srs_utime_t msgs_duration, srs_utime_t timeout)
 {
     if (paused) {
-        srs_usleep(SRS_CONSTS_RTMP_PULSE);
+        _srs_timer->usleep(timeout);
         return;
     }
     
@@ -555,7 +853,34 @@ void SrsConsumer::wait(int nb_msgs, srs_utime_t msgs_duration)
     mw_waiting = true;
     
     // use cond block wait for high performance mode.
-    srs_cond_wait(mw_wait);
+    srs_cond_timedwait(mw_wait, timeout);
+    mw_waiting = false;
+}
+
+void SrsConsumer::update_wait(bool atc)
+{
+    if (!mw_waiting) {
+        return;
+    }
+    
+    srs_utime_t duration = queue->duration();
+    bool match_min_msgs = queue->size() > mw_min_msgs;
+    
+    // For ATC, maybe the SH timestamp bigger than A/V packet,
+    // when encoder republish or overflow.
+    // @see https://github.com/ossrs/srs/pull/749
+    if (atc && duration < 0) {
+        srs_cond_signal(mw_wait);
+        mw_waiting = false;
+        return;
+    }
+    
+    // when duration ok, signal to flush.
+    if (match_min_msgs && duration > mw_duration) {
+        srs_cond_signal(mw_wait);
+        mw_waiting = false;
+        return;
+    }
 }
 #endif
 
@@ -579,11 +904,17 @@ void SrsConsumer::wakeup()
 #endif
 }
 
-SrsGopCache::SrsGopCache()
+SrsGopCache::SrsGopCache() : memory(SrsMemoryGopCache)
 {
     cached_video_count = 0;
     enable_gop_cache = true;
     audio_after_last_video_count = 0;
+    cached_size = 0;
+    overflow = false;
+    max_duration = 0;
+    max_size = 0;
+    fast_start = 0;
+    audio_duration = 0;
 }
 
 SrsGopCache::~SrsGopCache()
@@ -611,6 +942,27 @@ bool SrsGopCache::enabled()
     return enable_gop_cache;
 }
 
+void SrsGopCache::set_limits(srs_utime_t duration, int64_t size, srs_utime_t start)
+{
+    max_duration = duration;
+    max_size = size;
+    fast_start = start;
+}
+
+void SrsGopCache::set_audio_duration(srs_utime_t v)
+{
+    audio_duration = v;
+    
+    if (audio_duration <= 0 && pure_audio()) {
+        clear();
+    }
+}
+
+void SrsGopCache::set_memory(SrsMemoryStat* v)
+{
+    memory.set_stat(v);
+}
+
 srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
 {
     srs_error_t err = srs_success;
@@ -624,8 +976,8 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     
     // got video, update the video count if acceptable
     if (msg->is_video()) {
-        // drop video when not h.264
-        if (!SrsFlvVideo::h264(msg->payload, msg->size)) {
+        // drop video when not h.264 or h.265
+        if (!SrsFlvVideo::h264(msg->payload, msg->size) && !SrsFlvVideo::hevc(msg->payload, msg->size)) {
             return err;
         }
         
@@ -633,8 +985,11 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
         audio_after_last_video_count = 0;
     }
     
-    // no acceptable video or pure audio, disable the cache.
+    // no acceptable video or pure audio, only cache the audio in window, or disable the cache.
     if (pure_audio()) {
+        if (audio_duration > 0 && msg->is_audio()) {
+            cache_audio(msg);
+        }
         return err;
     }
     
@@ -651,15 +1006,53 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     }
     
     // clear gop cache when got key frame
-    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size)) {
-        clear();
+    bool keyframe = msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    if (keyframe) {
+        overflow = false;
         
-        // curent msg is video frame, so we set to 1.
-        cached_video_count = 1;
+        // Only cache the last gop, or drop the messages before the first keyframe.
+        if (max_duration <= 0 || keyframes.empty()) {
+            clear();
+            
+            // curent msg is video frame, so we set to 1.
+            cached_video_count = 1;
+        }
+    }
+    
+    // ignore the left messages of gop which is too large.
+    if (overflow) {
+        return err;
     }
     
     // cache the frame.
     gop_cache.push_back(msg->copy());
+    cached_size += msg->size;
+    memory.update(cached_size);
+    
+    if (keyframe) {
+        keyframes.push_back((int)gop_cache.size() - 1);
+        
+        // Drop the old gops, which is out of the duration.
+        while (keyframes.size() > 1) {
+            SrsSharedPtrMessage* oldest = gop_cache[keyframes[1]];
+            if (msg->timestamp - oldest->timestamp < srsu2ms(max_duration)) {
+                break;
+            }
+            shrink();
+        }
+    }
+    
+    // Drop the old gops until the size is ok, or clear the last gop which is too large.
+    while (max_size > 0 && cached_size > max_size) {
+        if (keyframes.size() > 1) {
+            shrink();
+            continue;
+        }
+        
+        srs_warn("clear gop cache for size %d exceed max %d", (int)cached_size, (int)max_size);
+        clear();
+        overflow = true;
+    }
     
     return err;
 }
@@ -672,6 +1065,10 @@ void SrsGopCache::clear()
         srs_freep(msg);
     }
     gop_cache.clear();
+    keyframes.clear();
+    cached_size = 0;
+    memory.update(0);
+    overflow = false;
     
     cached_video_count = 0;
     audio_after_last_video_count = 0;
@@ -681,14 +1078,14 @@ srs_error_t SrsGopCache::dump(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgo
 {
     srs_error_t err = srs_success;
     
-    std::vector<SrsSharedPtrMessage*>::iterator it;
-    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
-        SrsSharedPtrMessage* msg = *it;
+    int start = dump_start();
+    for (int i = start; i < (int)gop_cache.size(); i++) {
+        SrsSharedPtrMessage* msg = gop_cache[i];
         if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
             return srs_error_wrap(err, "enqueue message");
         }
     }
-    srs_trace("dispatch cached gop success. count=%d, duration=%d", (int)gop_cache.size(), consumer->get_time());
+    srs_trace("dispatch cached gop success. count=%d, start=%d, duration=%d", (int)gop_cache.size() - start, start, consumer->get_time());
     
     return err;
 }
@@ -698,21 +1095,274 @@ bool SrsGopCache::empty()
     return gop_cache.empty();
 }
 
-srs_utime_t SrsGopCache::start_time()
+srs_utime_t SrsGopCache::start_time()
+{
+    if (empty()) {
+        return 0;
+    }
+    
+    SrsSharedPtrMessage* msg = gop_cache[dump_start()];
+    srs_assert(msg);
+    
+    return srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+}
+
+bool SrsGopCache::pure_audio()
+{
+    return cached_video_count == 0;
+}
+
+SrsSharedPtrMessage* SrsGopCache::last_keyframe()
+{
+    if (keyframes.empty()) {
+        return NULL;
+    }
+    
+    return gop_cache[keyframes.back()];
+}
+
+void SrsGopCache::cache_audio(SrsSharedPtrMessage* msg)
+{
+    gop_cache.push_back(msg->copy());
+    cached_size += msg->size;
+    
+    // Drop the audio out of the window, or exceed the max size.
+    int nb_remove = 0;
+    for (; nb_remove < (int)gop_cache.size() - 1; nb_remove++) {
+        SrsSharedPtrMessage* oldest = gop_cache[nb_remove];
+        if (msg->timestamp - oldest->timestamp < srsu2ms(audio_duration) && (max_size <= 0 || cached_size <= max_size)) {
+            break;
+        }
+        cached_size -= oldest->size;
+        srs_freep(oldest);
+    }
+    if (nb_remove > 0) {
+        gop_cache.erase(gop_cache.begin(), gop_cache.begin() + nb_remove);
+    }
+    
+    memory.update(cached_size);
+}
+
+void SrsGopCache::shrink()
+{
+    srs_assert(keyframes.size() > 1);
+    
+    int nb_remove = keyframes[1];
+    for (int i = 0; i < nb_remove; i++) {
+        SrsSharedPtrMessage* msg = gop_cache[i];
+        cached_size -= msg->size;
+        srs_freep(msg);
+    }
+    gop_cache.erase(gop_cache.begin(), gop_cache.begin() + nb_remove);
+    memory.update(cached_size);
+    
+    keyframes.erase(keyframes.begin());
+    for (int i = 0; i < (int)keyframes.size(); i++) {
+        keyframes[i] -= nb_remove;
+    }
+}
+
+int SrsGopCache::dump_start()
+{
+    if (fast_start <= 0 || keyframes.empty()) {
+        return 0;
+    }
+    
+    // The first keyframe in the duration to the last message.
+    int64_t last = gop_cache.back()->timestamp;
+    for (int i = 0; i < (int)keyframes.size(); i++) {
+        SrsSharedPtrMessage* msg = gop_cache[keyframes[i]];
+        if (last - msg->timestamp <= srsu2ms(fast_start)) {
+            return keyframes[i];
+        }
+    }
+    
+    return keyframes.back();
+}
+
+SrsTimeShift::SrsTimeShift()
+{
+    base = 0;
+    cached_size = 0;
+    max_duration = 0;
+    max_size = 0;
+}
+
+SrsTimeShift::~SrsTimeShift()
+{
+    clear();
+}
+
+void SrsTimeShift::set_limits(srs_utime_t duration, int64_t size)
+{
+    max_duration = duration;
+    max_size = size;
+    
+    if (max_duration <= 0) {
+        clear();
+    }
+}
+
+bool SrsTimeShift::enabled()
+{
+    return max_duration > 0;
+}
+
+srs_utime_t SrsTimeShift::duration()
+{
+    return max_duration;
+}
+
+srs_error_t SrsTimeShift::cache(SrsSharedPtrMessage* shared_msg)
+{
+    srs_error_t err = srs_success;
+    
+    if (max_duration <= 0) {
+        return err;
+    }
+    
+    SrsSharedPtrMessage* msg = shared_msg->copy();
+    msgs.push_back(msg);
+    cached_size += msg->size;
+    
+    if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+        keyframes.push_back(end() - 1);
+    }
+    
+    // Drop the old messages, to keep the oldest keyframe at least duration earlier than the latest message.
+    int64_t last = msg->timestamp;
+    while (!msgs.empty()) {
+        // For pure audio stream without keyframe, drop message by message.
+        if (keyframes.empty()) {
+            if (last - msgs.front()->timestamp <= srsu2ms(max_duration)) {
+                break;
+            }
+        } else if (keyframes.front() == base) {
+            if (keyframes.size() < 2 || last - at(keyframes[1])->timestamp < srsu2ms(max_duration)) {
+                break;
+            }
+        }
+        shrink();
+    }
+    
+    // Drop the old gops until the size is ok, or clear the last gop which is too large.
+    while (max_size > 0 && cached_size > max_size) {
+        bool gops = keyframes.size() > 1 || (!keyframes.empty() && keyframes.front() > base);
+        if (gops || (keyframes.empty() && msgs.size() > 1)) {
+            shrink();
+            continue;
+        }
+        
+        srs_warn("clear time shift for size %d exceed max %d", (int)cached_size, (int)max_size);
+        clear();
+    }
+    
+    return err;
+}
+
+void SrsTimeShift::clear()
+{
+    std::deque<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    
+    // Keep the sequence increasing, so the cursor of consumer is dropped and resumed.
+    base += (int64_t)msgs.size();
+    msgs.clear();
+    keyframes.clear();
+    cached_size = 0;
+}
+
+int64_t SrsTimeShift::begin()
+{
+    return base;
+}
+
+int64_t SrsTimeShift::end()
+{
+    return base + (int64_t)msgs.size();
+}
+
+SrsSharedPtrMessage* SrsTimeShift::at(int64_t seq)
+{
+    srs_assert(seq >= begin() && seq < end());
+    return msgs[(size_t)(seq - base)];
+}
+
+int64_t SrsTimeShift::last_timestamp()
+{
+    return msgs.empty()? 0 : msgs.back()->timestamp;
+}
+
+int64_t SrsTimeShift::seek(srs_utime_t shift)
+{
+    if (msgs.empty()) {
+        return end();
+    }
+    
+    int64_t target = last_timestamp() - srsu2ms(shift);
+    
+    // For pure audio stream, start from the first message in the shift.
+    if (keyframes.empty()) {
+        for (int64_t seq = begin(); seq < end(); seq++) {
+            if (at(seq)->timestamp >= target) {
+                return seq;
+            }
+        }
+        return end() - 1;
+    }
+    
+    std::deque<int64_t>::reverse_iterator it;
+    for (it = keyframes.rbegin(); it != keyframes.rend(); ++it) {
+        if (at(*it)->timestamp <= target) {
+            return *it;
+        }
+    }
+    return keyframes.front();
+}
+
+int64_t SrsTimeShift::next_keyframe(int64_t seq)
 {
-    if (empty()) {
-        return 0;
+    if (keyframes.empty()) {
+        return srs_max(seq, begin());
     }
     
-    SrsSharedPtrMessage* msg = gop_cache[0];
-    srs_assert(msg);
-    
-    return srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+    std::deque<int64_t>::iterator it;
+    for (it = keyframes.begin(); it != keyframes.end(); ++it) {
+        if (*it >= seq) {
+            return *it;
+        }
+    }
+    return end();
 }
 
-bool SrsGopCache::pure_audio()
+void SrsTimeShift::shrink()
 {
-    return cached_video_count == 0;
+    if (msgs.empty()) {
+        return;
+    }
+    
+    // Remove the messages before the first keyframe, or the oldest gop.
+    int64_t until = base + 1;
+    if (!keyframes.empty() && keyframes.front() > base) {
+        until = keyframes.front();
+    } else if (keyframes.size() > 1) {
+        keyframes.pop_front();
+        until = keyframes.front();
+    } else if (!keyframes.empty()) {
+        keyframes.pop_front();
+        until = end();
+    }
+    
+    while (base < until && !msgs.empty()) {
+        SrsSharedPtrMessage* msg = msgs.front();
+        cached_size -= msg->size;
+        srs_freep(msg);
+        msgs.pop_front();
+        base++;
+    }
 }
 
 ISrsSourceHandler::ISrsSourceHandler()
@@ -744,41 +1394,36 @@ bool srs_hls_can_continue(int ret, SrsSharedPtrMessage* sh, SrsSharedPtrMessage*
 
 SrsMixQueue::SrsMixQueue()
 {
-    nb_videos = 0;
-    nb_audios = 0;
+    videos = new SrsMessageRing();
+    audios = new SrsMessageRing();
 }
 
 SrsMixQueue::~SrsMixQueue()
 {
-    clear();
+    srs_freep(videos);
+    srs_freep(audios);
 }
 
 void SrsMixQueue::clear()
 {
-    std::multimap<int64_t, SrsSharedPtrMessage*>::iterator it;
-    for (it = msgs.begin(); it != msgs.end(); ++it) {
-        SrsSharedPtrMessage* msg = it->second;
-        srs_freep(msg);
-    }
-    msgs.clear();
-    
-    nb_videos = 0;
-    nb_audios = 0;
+    videos->free();
+    audios->free();
 }
 
 void SrsMixQueue::push(SrsSharedPtrMessage* msg)
 {
-    msgs.insert(std::make_pair(msg->timestamp, msg));
-    
     if (msg->is_video()) {
-        nb_videos++;
+        videos->push_back(msg);
     } else {
-        nb_audios++;
+        audios->push_back(msg);
     }
 }
 
 SrsSharedPtrMessage* SrsMixQueue::pop()
 {
+    int nb_videos = videos->size();
+    int nb_audios = audios->size();
+    
     bool mix_ok = false;
     
     // pure video
@@ -800,17 +1445,15 @@ SrsSharedPtrMessage* SrsMixQueue::pop()
         return NULL;
     }
     
-    // pop the first msg.
-    std::multimap<int64_t, SrsSharedPtrMessage*>::iterator it = msgs.begin();
-    SrsSharedPtrMessage* msg = it->second;
-    msgs.erase(it);
-    
-    if (msg->is_video()) {
-        nb_videos--;
-    } else {
-        nb_audios--;
+    // pop the earlier one of the fronts, the audio first for the same timestamp.
+    SrsMessageRing* ring = audios;
+    if (nb_audios == 0 || (nb_videos > 0 && videos->at(0)->timestamp < audios->at(0)->timestamp)) {
+        ring = videos;
     }
     
+    SrsSharedPtrMessage* msg = NULL;
+    ring->pop_front(&msg, 1);
+    
     return msg;
 }
 
@@ -819,16 +1462,21 @@ SrsOriginHub::SrsOriginHub()
     source = NULL;
     req = NULL;
     is_active = false;
-    
-    hls = new SrsHls();
-    dash = new SrsDash();
-    dvr = new SrsDvr();
-    encoder = new SrsEncoder();
+    is_relay = false;
+    is_replica = false;
+    is_paused = false;
+    
+    hls = NULL;
+    dash = NULL;
+    dvr = NULL;
+    encoder = NULL;
 #ifdef SRS_AUTO_HDS
-    hds = new SrsHds();
+    hds = NULL;
 #endif
-    ng_exec = new SrsNgExec();
+    ng_exec = NULL;
     format = new SrsRtmpFormat();
+    forward_ring = new SrsForwardRing();
+    hls_ts_handler = NULL;
     
     _srs_config->subscribe(this);
 }
@@ -845,6 +1493,7 @@ SrsOriginHub::~SrsOriginHub()
         }
         forwarders.clear();
     }
+    srs_freep(forward_ring);
     srs_freep(ng_exec);
     
     srs_freep(format);
@@ -864,28 +1513,22 @@ srs_error_t SrsOriginHub::initialize(SrsSource* s, SrsRequest* r)
     req = r;
     source = s;
     
+    forward_ring->set_memory(source->memory);
+    
     if ((err = format->initialize()) != srs_success) {
         return srs_error_wrap(err, "format initialize");
     }
     
-    if ((err = hls->initialize(this, req)) != srs_success) {
-        return srs_error_wrap(err, "hls initialize");
-    }
-    
-    if ((err = dash->initialize(this, req)) != srs_success) {
-        return srs_error_wrap(err, "dash initialize");
-    }
-    
-    if ((err = dvr->initialize(this, req)) != srs_success) {
-        return srs_error_wrap(err, "dvr initialize");
-    }
+    // The components such as hls are created when publishing, if enabled.
     
     return err;
 }
 
 void SrsOriginHub::dispose()
 {
-    hls->dispose();
+    if (hls) {
+        hls->dispose();
+    }
     
     // TODO: Support dispose DASH.
 }
@@ -894,7 +1537,7 @@ srs_error_t SrsOriginHub::cycle()
 {
     srs_error_t err = srs_success;
     
-    if ((err = hls->cycle()) != srs_success) {
+    if (hls && (err = hls->cycle()) != srs_success) {
         return srs_error_wrap(err, "hls cycle");
     }
     
@@ -903,11 +1546,21 @@ srs_error_t SrsOriginHub::cycle()
     return err;
 }
 
+bool SrsOriginHub::pending()
+{
+    return hls && hls->pending();
+}
+
 bool SrsOriginHub::active()
 {
     return is_active;
 }
 
+bool SrsOriginHub::replica()
+{
+    return is_replica;
+}
+
 srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, SrsOnMetaDataPacket* packet)
 {
     srs_error_t err = srs_success;
@@ -916,18 +1569,12 @@ srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, Srs
         return srs_error_wrap(err, "Format parse metadata");
     }
     
-    // copy to all forwarders
-    if (true) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_meta_data(shared_metadata)) != srs_success) {
-                return srs_error_wrap(err, "Forwarder consume metadata");
-            }
-        }
+    // copy to all forwarders, by the shared ring.
+    if (!forwarders.empty() && (err = forward_ring->enqueue(shared_metadata)) != srs_success) {
+        return srs_error_wrap(err, "Forwarder consume metadata");
     }
     
-    if ((err = dvr->on_meta_data(shared_metadata)) != srs_success) {
+    if (dvr && (err = dvr->on_meta_data(shared_metadata)) != srs_success) {
         return srs_error_wrap(err, "DVR consume metadata");
     }
     
@@ -966,7 +1613,14 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
                   srs_flv_srates[c->sound_rate]);
     }
     
-    if ((err = hls->on_audio(msg, format)) != srs_success) {
+    if ((err = check_overload()) != srs_success) {
+        return srs_error_wrap(err, "overload");
+    }
+    
+    // Account the cycles of muxers to each of them, then back to the dispatch.
+    SrsCpuScope cpu_scope(source->cpu_stat(), SrsCpuHls);
+    
+    if (hls && (err = hls->on_audio(msg, format)) != srs_success) {
         // apply the error strategy for hls.
         // @see https://github.com/ossrs/srs/issues/264
         std::string hls_error_strategy = _srs_config->get_hls_on_error(req->vhost);
@@ -985,35 +1639,32 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
         }
     }
     
-    if ((err = dash->on_audio(msg, format)) != srs_success) {
+    cpu_scope.switch_to(SrsCpuDash);
+    if (dash && (err = dash->on_audio(msg, format)) != srs_success) {
         srs_warn("dash: ignore audio error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dash->on_unpublish();
     }
     
-    if ((err = dvr->on_audio(msg, format)) != srs_success) {
+    cpu_scope.switch_to(SrsCpuDvr);
+    if (dvr && (err = dvr->on_audio(msg, format)) != srs_success) {
         srs_warn("dvr: ignore audio error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dvr->on_unpublish();
     }
+    cpu_scope.switch_to(SrsCpuDispatch);
     
 #ifdef SRS_AUTO_HDS
-    if ((err = hds->on_audio(msg)) != srs_success) {
+    if (hds && (err = hds->on_audio(msg)) != srs_success) {
         srs_warn("hds: ignore audio error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         hds->on_unpublish();
     }
 #endif
     
-    // copy to all forwarders.
-    if (true) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_audio(msg)) != srs_success) {
-                return srs_error_wrap(err, "forward: audio");
-            }
-        }
+    // copy to all forwarders, by the shared ring.
+    if (!forwarders.empty() && (err = forward_ring->enqueue(msg)) != srs_success) {
+        return srs_error_wrap(err, "forward: audio");
     }
     
     return err;
@@ -1043,7 +1694,7 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
         
         // when got video stream info.
         SrsStatistic* stat = SrsStatistic::instance();
-        if ((err = stat->on_video_info(req, SrsVideoCodecIdAVC, c->avc_profile, c->avc_level, c->width, c->height)) != srs_success) {
+        if ((err = stat->on_video_info(req, c->id, c->avc_profile, c->avc_level, c->width, c->height)) != srs_success) {
             return srs_error_wrap(err, "stat video");
         }
         
@@ -1052,14 +1703,21 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
                   srs_avc_level2str(c->avc_level).c_str(), c->width, c->height,
                   c->video_data_rate / 1000, c->frame_rate, c->duration);
     }
-
+    
     // Ignore video data when no sps/pps
     // @bug https://github.com/ossrs/srs/issues/703#issuecomment-578393155
     if (format->vcodec && !format->vcodec->is_avc_codec_ok()) {
         return err;
     }
     
-    if ((err = hls->on_video(msg, format)) != srs_success) {
+    if ((err = check_overload()) != srs_success) {
+        return srs_error_wrap(err, "overload");
+    }
+    
+    // Account the cycles of muxers to each of them, then back to the dispatch.
+    SrsCpuScope cpu_scope(source->cpu_stat(), SrsCpuHls);
+    
+    if (hls && (err = hls->on_video(msg, format)) != srs_success) {
         // apply the error strategy for hls.
         // @see https://github.com/ossrs/srs/issues/264
         std::string hls_error_strategy = _srs_config->get_hls_on_error(req->vhost);
@@ -1078,35 +1736,32 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
         }
     }
     
-    if ((err = dash->on_video(msg, format)) != srs_success) {
+    cpu_scope.switch_to(SrsCpuDash);
+    if (dash && (err = dash->on_video(msg, format)) != srs_success) {
         srs_warn("dash: ignore video error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dash->on_unpublish();
     }
     
-    if ((err = dvr->on_video(msg, format)) != srs_success) {
+    cpu_scope.switch_to(SrsCpuDvr);
+    if (dvr && (err = dvr->on_video(msg, format)) != srs_success) {
         srs_warn("dvr: ignore video error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         dvr->on_unpublish();
     }
+    cpu_scope.switch_to(SrsCpuDispatch);
     
 #ifdef SRS_AUTO_HDS
-    if ((err = hds->on_video(msg)) != srs_success) {
+    if (hds && (err = hds->on_video(msg)) != srs_success) {
         srs_warn("hds: ignore video error %s", srs_error_desc(err).c_str());
         srs_error_reset(err);
         hds->on_unpublish();
     }
 #endif
     
-    // copy to all forwarders.
-    if (!forwarders.empty()) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_video(msg)) != srs_success) {
-                return srs_error_wrap(err, "forward video");
-            }
-        }
+    // copy to all forwarders, by the shared ring.
+    if (!forwarders.empty() && (err = forward_ring->enqueue(msg)) != srs_success) {
+        return srs_error_wrap(err, "forward video");
     }
     
     return err;
@@ -1116,37 +1771,66 @@ srs_error_t SrsOriginHub::on_publish()
 {
     srs_error_t err = srs_success;
     
+    // The stream relayed from sibling worker, only deliver to the players of this worker,
+    // the worker accepting the publisher does forward/hls/dvr and others.
+    is_relay = srs_worker_is_relay(req);
+    is_replica = !is_relay && srs_standby_is_replica(req);
+    is_paused = false;
+    update_format_demux();
+    if (is_relay) {
+        is_active = true;
+        return err;
+    }
+    
+    // The stream replicated from another origin, only deliver to the players and sibling workers,
+    // the origin accepting the publisher does forward/hls/dvr and others.
+    if (is_replica) {
+        if ((err = create_forwarders()) != srs_success) {
+            return srs_error_wrap(err, "create relays");
+        }
+        is_active = true;
+        return err;
+    }
+    
     // create forwarders
     if ((err = create_forwarders()) != srs_success) {
         return srs_error_wrap(err, "create forwarders");
     }
     
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    
     // TODO: FIXME: use initialize to set req.
-    if ((err = encoder->on_publish(req)) != srs_success) {
+    if (encoder && (err = encoder->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "encoder publish");
     }
     
-    if ((err = hls->on_publish()) != srs_success) {
-        return srs_error_wrap(err, "hls publish");
+    if (hls) {
+        if ((err = hls->on_publish()) != srs_success) {
+            return srs_error_wrap(err, "hls publish");
+        }
+        // Cycle the source to dispose the hls when timeout.
+        _srs_sources->schedule(source);
     }
     
-    if ((err = dash->on_publish()) != srs_success) {
+    if (dash && (err = dash->on_publish()) != srs_success) {
         return srs_error_wrap(err, "dash publish");
     }
     
-    if ((err = dvr->on_publish()) != srs_success) {
+    if (dvr && (err = dvr->on_publish()) != srs_success) {
         return srs_error_wrap(err, "dvr publish");
     }
     
     // TODO: FIXME: use initialize to set req.
 #ifdef SRS_AUTO_HDS
-    if ((err = hds->on_publish(req)) != srs_success) {
+    if (hds && (err = hds->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "hds publish");
     }
 #endif
     
     // TODO: FIXME: use initialize to set req.
-    if ((err = ng_exec->on_publish(req)) != srs_success) {
+    if (ng_exec && (err = ng_exec->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "exec publish");
     }
     
@@ -1158,20 +1842,59 @@ srs_error_t SrsOriginHub::on_publish()
 void SrsOriginHub::on_unpublish()
 {
     is_active = false;
+    is_paused = false;
+    
+    if (is_relay) {
+        is_relay = false;
+        return;
+    }
     
     // destroy all forwarders
     destroy_forwarders();
     
-    encoder->on_unpublish();
-    hls->on_unpublish();
-    dash->on_unpublish();
-    dvr->on_unpublish();
+    if (is_replica) {
+        is_replica = false;
+        return;
+    }
+    
+    if (encoder) {
+        encoder->on_unpublish();
+    }
+    if (hls) {
+        hls->on_unpublish();
+    }
+    if (dash) {
+        dash->on_unpublish();
+    }
+    if (dvr) {
+        dvr->on_unpublish();
+    }
     
 #ifdef SRS_AUTO_HDS
-    hds->on_unpublish();
+    if (hds) {
+        hds->on_unpublish();
+    }
 #endif
     
-    ng_exec->on_unpublish();
+    if (ng_exec) {
+        ng_exec->on_unpublish();
+    }
+}
+
+srs_error_t SrsOriginHub::on_republish()
+{
+    srs_error_t err = srs_success;
+    
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    // The forwarders, dvr and others correct the timestamp by jitter, only the HLS should start a new segment.
+    if (hls && (err = hls->on_republish()) != srs_success) {
+        return srs_error_wrap(err, "hls republish");
+    }
+    
+    return err;
 }
 
 srs_error_t SrsOriginHub::on_forwarder_start(SrsForwarder* forwarder)
@@ -1183,15 +1906,15 @@ srs_error_t SrsOriginHub::on_forwarder_start(SrsForwarder* forwarder)
     SrsSharedPtrMessage* cache_sh_audio = source->meta->ash();
     
     // feed the forwarder the metadata/sequence header,
-    // when reload to enable the forwarder.
-    if (cache_metadata && (err = forwarder->on_meta_data(cache_metadata)) != srs_success) {
-        return srs_error_wrap(err, "forward metadata");
+    // when reload to enable the forwarder, or reconnect to server.
+    if (cache_metadata) {
+        forwarder->on_sequence_header(cache_metadata);
     }
-    if (cache_sh_video && (err = forwarder->on_video(cache_sh_video)) != srs_success) {
-        return srs_error_wrap(err, "forward video sh");
+    if (cache_sh_video) {
+        forwarder->on_sequence_header(cache_sh_video);
     }
-    if (cache_sh_audio && (err = forwarder->on_audio(cache_sh_audio)) != srs_success) {
-        return srs_error_wrap(err, "forward audio sh");
+    if (cache_sh_audio) {
+        forwarder->on_sequence_header(cache_sh_audio);
     }
     
     return err;
@@ -1201,6 +1924,10 @@ srs_error_t SrsOriginHub::on_dvr_request_sh()
 {
     srs_error_t err = srs_success;
     
+    if (!dvr) {
+        return err;
+    }
+    
     SrsSharedPtrMessage* cache_metadata = source->meta->data();
     SrsSharedPtrMessage* cache_sh_video = source->meta->vsh();
     SrsSharedPtrMessage* cache_sh_audio = source->meta->ash();
@@ -1227,6 +1954,15 @@ srs_error_t SrsOriginHub::on_dvr_request_sh()
     return err;
 }
 
+void SrsOriginHub::set_hls_ts_handler(ISrsHlsTsHandler* h)
+{
+    hls_ts_handler = h;
+    
+    if (hls) {
+        hls->set_ts_handler(h);
+    }
+}
+
 srs_error_t SrsOriginHub::on_reload_vhost_forward(string vhost)
 {
     srs_error_t err = srs_success;
@@ -1262,10 +1998,20 @@ srs_error_t SrsOriginHub::on_reload_vhost_dash(string vhost)
         return err;
     }
     
-    dash->on_unpublish();
+    if (dash) {
+        dash->on_unpublish();
+    }
+    update_format_demux();
     
-    // Don't start DASH when source is not active.
-    if (!is_active) {
+    // Don't start DASH when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!dash) {
         return err;
     }
     
@@ -1306,16 +2052,27 @@ srs_error_t SrsOriginHub::on_reload_vhost_hls(string vhost)
     
     // TODO: FIXME: maybe should ignore when publish already stopped?
     
-    hls->on_unpublish();
+    if (hls) {
+        hls->on_unpublish();
+    }
+    update_format_demux();
     
-    // Don't start HLS when source is not active.
-    if (!is_active) {
+    // Don't start HLS when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!hls) {
         return err;
     }
     
     if ((err = hls->on_publish()) != srs_success) {
         return srs_error_wrap(err, "hls publish failed");
     }
+    _srs_sources->schedule(source);
     srs_trace("vhost %s hls reload success", vhost.c_str());
     
     // when publish, don't need to fetch sequence header, which is old and maybe corrupt.
@@ -1357,10 +2114,19 @@ srs_error_t SrsOriginHub::on_reload_vhost_hds(string vhost)
     // TODO: FIXME: maybe should ignore when publish already stopped?
     
 #ifdef SRS_AUTO_HDS
-    hds->on_unpublish();
+    if (hds) {
+        hds->on_unpublish();
+    }
     
-    // Don't start HDS when source is not active.
-    if (!is_active) {
+    // Don't start HDS when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!hds) {
         return err;
     }
     
@@ -1384,10 +2150,20 @@ srs_error_t SrsOriginHub::on_reload_vhost_dvr(string vhost)
     // TODO: FIXME: maybe should ignore when publish already stopped?
     
     // cleanup dvr
-    dvr->on_unpublish();
+    if (dvr) {
+        dvr->on_unpublish();
+    }
+    update_format_demux();
     
-    // Don't start DVR when source is not active.
-    if (!is_active) {
+    // Don't start DVR when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!dvr) {
         return err;
     }
     
@@ -1420,10 +2196,19 @@ srs_error_t SrsOriginHub::on_reload_vhost_transcode(string vhost)
     
     // TODO: FIXME: maybe should ignore when publish already stopped?
     
-    encoder->on_unpublish();
+    if (encoder) {
+        encoder->on_unpublish();
+    }
     
-    // Don't start transcode when source is not active.
-    if (!is_active) {
+    // Don't start transcode when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!encoder) {
         return err;
     }
     
@@ -1445,10 +2230,19 @@ srs_error_t SrsOriginHub::on_reload_vhost_exec(string vhost)
     
     // TODO: FIXME: maybe should ignore when publish already stopped?
     
-    ng_exec->on_unpublish();
+    if (ng_exec) {
+        ng_exec->on_unpublish();
+    }
     
-    // Don't start exec when source is not active.
-    if (!is_active) {
+    // Don't start exec when source is not active, or relayed from sibling worker.
+    if (!is_active || is_relay || is_replica) {
+        return err;
+    }
+    
+    if ((err = create_components()) != srs_success) {
+        return srs_error_wrap(err, "create components");
+    }
+    if (!ng_exec) {
         return err;
     }
     
@@ -1464,6 +2258,36 @@ srs_error_t SrsOriginHub::create_forwarders()
 {
     srs_error_t err = srs_success;
     
+    // The stream relayed from sibling worker, which already forwards it.
+    if (is_relay) {
+        return err;
+    }
+    
+    // Relay to all sibling workers, for stream to play from any worker.
+    if (_srs_worker_index >= 0) {
+        int count = _srs_config->get_workers_count();
+        for (int i = 0; i < count; i++) {
+            if (i != _srs_worker_index) {
+                if ((err = create_forwarder(srs_worker_relay_endpoint(i), true, false)) != srs_success) {
+                    return srs_error_wrap(err, "relay to worker %d", i);
+                }
+            }
+        }
+    }
+    
+    // The stream replicated from another origin, which already forwards and replicates it.
+    if (is_replica) {
+        return err;
+    }
+    
+    // Replicate to the standby origins, for edges to failover to them.
+    std::vector<std::string> standby = _srs_config->get_vhost_standby(req->vhost);
+    for (int i = 0; i < (int)standby.size(); i++) {
+        if ((err = create_forwarder(standby.at(i), false, true)) != srs_success) {
+            return srs_error_wrap(err, "replicate to standby %s", standby.at(i).c_str());
+        }
+    }
+    
     if (!_srs_config->get_forward_enabled(req->vhost)) {
         return err;
     }
@@ -1472,21 +2296,32 @@ srs_error_t SrsOriginHub::create_forwarders()
     for (int i = 0; conf && i < (int)conf->args.size(); i++) {
         std::string forward_server = conf->args.at(i);
         
-        SrsForwarder* forwarder = new SrsForwarder(this);
-        forwarders.push_back(forwarder);
-        
-        // initialize the forwarder with request.
-        if ((err = forwarder->initialize(req, forward_server)) != srs_success) {
-            return srs_error_wrap(err, "init forwarder");
+        if ((err = create_forwarder(forward_server, false, false)) != srs_success) {
+            return srs_error_wrap(err, "forward");
         }
+    }
+    
+    return err;
+}
 
-        srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
-        forwarder->set_queue_size(queue_size);
-        
-        if ((err = forwarder->on_publish()) != srs_success) {
-            return srs_error_wrap(err, "start forwarder failed, vhost=%s, app=%s, stream=%s, forward-to=%s",
-                req->vhost.c_str(), req->app.c_str(), req->stream.c_str(), forward_server.c_str());
-        }
+srs_error_t SrsOriginHub::create_forwarder(std::string forward_server, bool relay, bool replica)
+{
+    srs_error_t err = srs_success;
+    
+    SrsForwarder* forwarder = new SrsForwarder(this, forward_ring);
+    forwarders.push_back(forwarder);
+    
+    // initialize the forwarder with request.
+    if ((err = forwarder->initialize(req, forward_server, relay, replica)) != srs_success) {
+        return srs_error_wrap(err, "init forwarder");
+    }
+    
+    srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    forward_ring->set_queue_size(queue_size);
+    
+    if ((err = forwarder->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "start forwarder failed, vhost=%s, app=%s, stream=%s, forward-to=%s",
+            req->vhost.c_str(), req->app.c_str(), req->stream.c_str(), forward_server.c_str());
     }
     
     return err;
@@ -1503,7 +2338,104 @@ void SrsOriginHub::destroy_forwarders()
     forwarders.clear();
 }
 
-SrsMetaCache::SrsMetaCache()
+srs_error_t SrsOriginHub::create_components()
+{
+    srs_error_t err = srs_success;
+    
+    if (!hls && _srs_config->get_hls_enabled(req->vhost)) {
+        hls = new SrsHls();
+        hls->set_memory(source->memory);
+        hls->set_ts_handler(hls_ts_handler);
+        if ((err = hls->initialize(this, req)) != srs_success) {
+            return srs_error_wrap(err, "hls initialize");
+        }
+    }
+    
+    if (!dash && _srs_config->get_dash_enabled(req->vhost)) {
+        dash = new SrsDash();
+        if ((err = dash->initialize(this, req)) != srs_success) {
+            return srs_error_wrap(err, "dash initialize");
+        }
+    }
+    
+    if (!dvr && _srs_config->get_dvr_enabled(req->vhost)) {
+        dvr = new SrsDvr();
+        if ((err = dvr->initialize(this, req)) != srs_success) {
+            return srs_error_wrap(err, "dvr initialize");
+        }
+    }
+    
+    if (!encoder && transcode_configured()) {
+        encoder = new SrsEncoder();
+    }
+    
+#ifdef SRS_AUTO_HDS
+    if (!hds && _srs_config->get_hds_enabled(req->vhost)) {
+        hds = new SrsHds();
+    }
+#endif
+    
+    if (!ng_exec && _srs_config->get_exec_enabled(req->vhost)) {
+        ng_exec = new SrsNgExec();
+    }
+    
+    return err;
+}
+
+bool SrsOriginHub::transcode_configured()
+{
+    std::string scope = req->app + "/" + req->stream;
+    return _srs_config->get_transcode(req->vhost, "") || _srs_config->get_transcode(req->vhost, req->app)
+        || _srs_config->get_transcode(req->vhost, scope);
+}
+
+void SrsOriginHub::update_format_demux()
+{
+    // The stream relayed from sibling worker or replicated from origin is only delivered to players, so never demux it.
+    bool v = !is_relay && !is_replica && (_srs_config->get_hls_enabled(req->vhost) || _srs_config->get_dash_enabled(req->vhost)
+        || _srs_config->get_dvr_enabled(req->vhost));
+    
+    if (v != format->demux_samples) {
+        srs_trace("format demux samples %d=>%d, url=%s", format->demux_samples, v, req->get_stream_url().c_str());
+    }
+    format->demux_samples = v;
+}
+
+srs_error_t SrsOriginHub::check_overload()
+{
+    srs_error_t err = srs_success;
+    
+    bool low_priority = source->vhost_snapshot && source->vhost_snapshot->low_priority;
+    bool pause = is_active && !is_relay && !is_replica && _srs_overload->pause_dvr_hls(low_priority);
+    if (pause == is_paused) {
+        return err;
+    }
+    is_paused = pause;
+    
+    if (pause) {
+        srs_trace("overload pause hls and dvr, url=%s", req->get_stream_url().c_str());
+        if (hls) {
+            hls->on_unpublish();
+        }
+        if (dvr) {
+            dvr->on_unpublish();
+        }
+        return err;
+    }
+    
+    // Restart the HLS and DVR as reload, with the cached sequence header.
+    srs_trace("overload resume hls and dvr, url=%s", req->get_stream_url().c_str());
+    if ((err = on_reload_vhost_hls(req->vhost)) != srs_success) {
+        return srs_error_wrap(err, "resume hls");
+    }
+    if ((err = on_reload_vhost_dvr(req->vhost)) != srs_success) {
+        return srs_error_wrap(err, "resume dvr");
+    }
+    
+    return err;
+}
+
+SrsMetaCache::SrsMetaCache() : memory(SrsMemoryMetaCache)
 {
     meta = video = audio = NULL;
     previous_video = previous_audio = NULL;
@@ -1521,6 +2453,7 @@ void SrsMetaCache::dispose()
     clear();
     srs_freep(previous_video);
     srs_freep(previous_audio);
+    update_memory();
 }
 
 void SrsMetaCache::clear()
@@ -1528,6 +2461,37 @@ void SrsMetaCache::clear()
     srs_freep(meta);
     srs_freep(video);
     srs_freep(audio);
+    update_memory();
+}
+
+void SrsMetaCache::set_memory(SrsMemoryStat* v)
+{
+    memory.set_stat(v);
+}
+
+void SrsMetaCache::update_memory()
+{
+    int64_t nb_bytes = 0;
+    
+    if (meta) {
+        nb_bytes += meta->size;
+    }
+    if (video) {
+        nb_bytes += video->size;
+    }
+    if (audio) {
+        nb_bytes += audio->size;
+    }
+    
+    // The previous sequence header is a copy of current one, except it's changed.
+    if (previous_video && (!video || previous_video->payload != video->payload)) {
+        nb_bytes += previous_video->size;
+    }
+    if (previous_audio && (!audio || previous_audio->payload != audio->payload)) {
+        nb_bytes += previous_audio->size;
+    }
+    
+    memory.update(nb_bytes);
 }
 
 SrsSharedPtrMessage* SrsMetaCache::data()
@@ -1592,12 +2556,14 @@ void SrsMetaCache::update_previous_vsh()
 {
     srs_freep(previous_video);
     previous_video = video? video->copy() : NULL;
+    update_memory();
 }
 
 void SrsMetaCache::update_previous_ash()
 {
     srs_freep(previous_audio);
     previous_audio = audio? audio->copy() : NULL;
+    update_memory();
 }
 
 srs_error_t SrsMetaCache::update_data(SrsMessageHeader* header, SrsOnMetaDataPacket* metadata, bool& updated)
@@ -1631,7 +2597,7 @@ srs_error_t SrsMetaCache::update_data(SrsMessageHeader* header, SrsOnMetaDataPac
     
     // add server info to metadata
     metadata->metadata->set("server", SrsAmf0Any::str(RTMP_SIG_SRS_SERVER));
-
+    
     // version, for example, 1.0.0
     // add version to metadata, please donot remove it, for debug.
     metadata->metadata->set("server_version", SrsAmf0Any::str(RTMP_SIG_SRS_VERSION));
@@ -1658,6 +2624,7 @@ srs_error_t SrsMetaCache::update_data(SrsMessageHeader* header, SrsOnMetaDataPac
     if ((err = meta->create(header, payload, size)) != srs_success) {
         return srs_error_wrap(err, "create metadata");
     }
+    update_memory();
     
     return err;
 }
@@ -1683,6 +2650,7 @@ SrsSourceManager* _srs_sources = new SrsSourceManager();
 SrsSourceManager::SrsSourceManager()
 {
     lock = NULL;
+    nn_sources = 0;
 }
 
 SrsSourceManager::~SrsSourceManager()
@@ -1693,12 +2661,12 @@ SrsSourceManager::~SrsSourceManager()
 srs_error_t SrsSourceManager::fetch_or_create(SrsRequest* r, ISrsSourceHandler* h, SrsSource** pps)
 {
     srs_error_t err = srs_success;
-
+    
     // Lazy create lock, because ST is not ready in SrsSourceManager constructor.
     if (!lock) {
         lock = srs_mutex_new();
     }
-
+    
     // Use lock to protect coroutine switch.
     // @bug https://github.com/ossrs/srs/issues/1230
     SrsLocker(lock);
@@ -1709,18 +2677,19 @@ srs_error_t SrsSourceManager::fetch_or_create(SrsRequest* r, ISrsSourceHandler*
         return err;
     }
     
-    string stream_url = r->get_stream_url();
-    string vhost = r->vhost;
+    SrsStreamKey* key = r->get_stream_key();
+    std::map<SrsStreamKey*, SrsSource*>& sources = shard(key);
     
     // should always not exists for create a source.
-    srs_assert (pool.find(stream_url) == pool.end());
+    srs_assert (sources.find(key) == sources.end());
     
     source = new SrsSource();
     if ((err = source->initialize(r, h)) != srs_success) {
-        return srs_error_wrap(err, "init source %s", r->get_stream_url().c_str());
+        return srs_error_wrap(err, "init source %s", key->url.c_str());
     }
     
-    pool[stream_url] = source;
+    sources[key] = source;
+    nn_sources++;
     
     *pps = source;
     
@@ -1729,15 +2698,11 @@ srs_error_t SrsSourceManager::fetch_or_create(SrsRequest* r, ISrsSourceHandler*
 
 SrsSource* SrsSourceManager::fetch(SrsRequest* r)
 {
-    SrsSource* source = NULL;
-    
-    string stream_url = r->get_stream_url();
-    if (pool.find(stream_url) == pool.end()) {
+    SrsSource* source = find(r);
+    if (!source) {
         return NULL;
     }
     
-    source = pool[stream_url];
-    
     // we always update the request of resource,
     // for origin auth is on, the token in request maybe invalid,
     // and we only need to update the token of request, it's simple.
@@ -1746,12 +2711,51 @@ SrsSource* SrsSourceManager::fetch(SrsRequest* r)
     return source;
 }
 
+SrsSource* SrsSourceManager::find(SrsRequest* r)
+{
+    // The source never exists when the key is not interned.
+    SrsStreamKey* key = r->get_stream_key(false);
+    if (!key) {
+        return NULL;
+    }
+    
+    std::map<SrsStreamKey*, SrsSource*>& sources = shard(key);
+    std::map<SrsStreamKey*, SrsSource*>::iterator it = sources.find(key);
+    if (it == sources.end()) {
+        return NULL;
+    }
+    
+    return it->second;
+}
+
+std::map<SrsStreamKey*, SrsSource*>& SrsSourceManager::shard(SrsStreamKey* key)
+{
+    return pool[key->hash % SRS_SOURCE_POOL_SHARDS];
+}
+
+int SrsSourceManager::size()
+{
+    return nn_sources;
+}
+
+void SrsSourceManager::schedule(SrsSource* s)
+{
+    pending.insert(s);
+}
+
+void SrsSourceManager::unschedule(SrsSource* s)
+{
+    pending.erase(s);
+}
+
 void SrsSourceManager::dispose()
 {
-    std::map<std::string, SrsSource*>::iterator it;
-    for (it = pool.begin(); it != pool.end(); ++it) {
-        SrsSource* source = it->second;
-        source->dispose();
+    for (int i = 0; i < SRS_SOURCE_POOL_SHARDS; i++) {
+        std::map<SrsStreamKey*, SrsSource*>::iterator it;
+        for (it = pool[i].begin(); it != pool[i].end(); ++it) {
+            SrsSource* source = it->second;
+            source->dispose();
+        }
     }
     return;
 }
@@ -1769,38 +2773,26 @@ srs_error_t SrsSourceManager::do_cycle()
 {
     srs_error_t err = srs_success;
     
-    std::map<std::string, SrsSource*>::iterator it;
-    for (it = pool.begin(); it != pool.end();) {
-        SrsSource* source = it->second;
+    // Copy the pending sources, which maybe scheduled again in cycle.
+    std::vector<SrsSource*> sources(pending.begin(), pending.end());
+    
+    std::vector<SrsSource*>::iterator it;
+    for (it = sources.begin(); it != sources.end(); ++it) {
+        SrsSource* source = *it;
         
         // Do cycle source to cleanup components, such as hls dispose.
         if ((err = source->cycle()) != srs_success) {
             return srs_error_wrap(err, "source=%d/%d cycle", source->source_id(), source->pre_source_id());
         }
         
+        // Never cycle the idle source, until it's scheduled again.
+        if (!source->pending()) {
+            pending.erase(source);
+        }
+        
         // TODO: FIXME: support source cleanup.
         // @see https://github.com/ossrs/srs/issues/713
         // @see https://github.com/ossrs/srs/issues/714
-#if 0
-        // When source expired, remove it.
-        if (source->expired()) {
-            int cid = source->source_id();
-            if (cid == -1 && source->pre_source_id() > 0) {
-                cid = source->pre_source_id();
-            }
-            if (cid > 0) {
-                _srs_context->set_id(cid);
-            }
-            srs_trace("cleanup die source, total=%d", (int)pool.size());
-            
-            srs_freep(source);
-            pool.erase(it++);
-        } else {
-            ++it;
-        }
-#else
-        ++it;
-#endif
     }
     
     return err;
@@ -1808,17 +2800,22 @@ srs_error_t SrsSourceManager::do_cycle()
 
 void SrsSourceManager::destroy()
 {
-    std::map<std::string, SrsSource*>::iterator it;
-    for (it = pool.begin(); it != pool.end(); ++it) {
-        SrsSource* source = it->second;
-        srs_freep(source);
+    for (int i = 0; i < SRS_SOURCE_POOL_SHARDS; i++) {
+        std::map<SrsStreamKey*, SrsSource*>::iterator it;
+        for (it = pool[i].begin(); it != pool[i].end(); ++it) {
+            SrsSource* source = it->second;
+            srs_freep(source);
+        }
+        pool[i].clear();
     }
-    pool.clear();
+    nn_sources = 0;
+    pending.clear();
 }
 
 SrsSource::SrsSource()
 {
     req = NULL;
+    vhost_snapshot = NULL;
     jitter_algorithm = SrsRtmpJitterAlgorithmOFF;
     mix_correct = false;
     mix_queue = new SrsMixQueue();
@@ -1826,15 +2823,24 @@ SrsSource::SrsSource()
     _can_publish = true;
     _pre_source_id = _source_id = 0;
     die_at = 0;
+    prefetch_until = 0;
+    replica_hold_until = 0;
+    grace_until = 0;
+    batching = false;
+    shared_jitter = new SrsRtmpJitter();
+    memory = NULL;
+    cpu = NULL;
     
     play_edge = new SrsPlayEdge();
     publish_edge = new SrsPublishEdge();
     gop_cache = new SrsGopCache();
+    timeshift = new SrsTimeShift();
     hub = new SrsOriginHub();
     meta = new SrsMetaCache();
     
     is_monotonically_increase = false;
     last_packet_time = 0;
+    last_marker_time = 0;
     
     _srs_config->subscribe(this);
     atc = false;
@@ -1843,6 +2849,17 @@ SrsSource::SrsSource()
 SrsSource::~SrsSource()
 {
     _srs_config->unsubscribe(this);
+    _srs_sources->unschedule(this);
+    
+    // The shared TS stream lives as long as the source.
+    SrsTsSharedStream::destroy(this);
+    
+    std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> >::iterator it;
+    for (it = parked.begin(); it != parked.end(); ++it) {
+        SrsConsumer* consumer = it->second.first;
+        srs_freep(consumer);
+    }
+    parked.clear();
     
     // never free the consumers,
     // for all consumers are auto free.
@@ -1855,6 +2872,8 @@ SrsSource::~SrsSource()
     srs_freep(play_edge);
     srs_freep(publish_edge);
     srs_freep(gop_cache);
+    srs_freep(timeshift);
+    srs_freep(shared_jitter);
     
     srs_freep(req);
 }
@@ -1864,6 +2883,7 @@ void SrsSource::dispose()
     hub->dispose();
     meta->dispose();
     gop_cache->dispose();
+    timeshift->clear();
 }
 
 srs_error_t SrsSource::cycle()
@@ -1873,9 +2893,53 @@ srs_error_t SrsSource::cycle()
         return srs_error_wrap(err, "hub cycle");
     }
     
+    // For edge prefetch, stop ingesting when idle without players.
+    if (prefetch_until > 0 && srs_get_monotonic_time() > prefetch_until) {
+        prefetch_until = 0;
+        srs_trace("edge prefetch idle, consumers=%d", (int)consumers.size());
+        
+        if (consumers.empty()) {
+            play_edge->on_all_client_stop();
+            die_at = srs_get_monotonic_time();
+        }
+    }
+    
+    // For standby origin, drop the state of replica when no publisher takes it over.
+    if (replica_hold_until > 0 && srs_get_monotonic_time() > replica_hold_until) {
+        replica_hold_until = 0;
+        gop_cache->clear();
+        srs_trace("standby drop replica, consumers=%d", (int)consumers.size());
+    }
+    
+    // Unpublish the stream when the publisher not reconnect in grace.
+    if (grace_until > 0 && srs_get_monotonic_time() > grace_until) {
+        grace_until = 0;
+        srs_trace("publisher reconnect timeout, consumers=%d", (int)consumers.size());
+        do_unpublish();
+    }
+    
+    // Free the parked consumers which are not resumed in time.
+    srs_utime_t now = srs_get_monotonic_time();
+    std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> >::iterator it;
+    for (it = parked.begin(); it != parked.end();) {
+        if (now < it->second.second) {
+            ++it;
+            continue;
+        }
+        
+        SrsConsumer* consumer = it->second.first;
+        parked.erase(it++);
+        srs_freep(consumer);
+    }
+    
     return srs_success;
 }
 
+bool SrsSource::pending()
+{
+    return hub->pending() || prefetch_until > 0 || replica_hold_until > 0 || grace_until > 0 || !parked.empty();
+}
+
 bool SrsSource::expired()
 {
     // unknown state?
@@ -1893,7 +2957,12 @@ bool SrsSource::expired()
         return false;
     }
     
-    srs_utime_t now = srs_get_system_time();
+    // prefetching for edge?
+    if (prefetch_until > 0) {
+        return false;
+    }
+    
+    srs_utime_t now = srs_get_monotonic_time();
     if (now > die_at + SRS_SOURCE_CLEANUP) {
         return true;
     }
@@ -1910,7 +2979,13 @@ srs_error_t SrsSource::initialize(SrsRequest* r, ISrsSourceHandler* h)
     
     handler = h;
     req = r->copy();
-    atc = _srs_config->get_atc(req->vhost);
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    atc = vhost_snapshot->atc;
+    
+    memory = SrsStatistic::instance()->fetch_memory(req);
+    cpu = SrsStatistic::instance()->fetch_cpu(req);
+    gop_cache->set_memory(memory);
+    meta->set_memory(memory);
     
     if ((err = hub->initialize(this, req)) != srs_success) {
         return srs_error_wrap(err, "hub");
@@ -1923,11 +2998,16 @@ srs_error_t SrsSource::initialize(SrsRequest* r, ISrsSourceHandler* h)
         return srs_error_wrap(err, "edge(publish)");
     }
     
-    srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    srs_utime_t queue_size = vhost_snapshot->queue_length;
     publish_edge->set_queue_size(queue_size);
     
-    jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
-    mix_correct = _srs_config->get_mix_correct(req->vhost);
+    jitter_algorithm = (SrsRtmpJitterAlgorithm)vhost_snapshot->time_jitter;
+    mix_correct = vhost_snapshot->mix_correct;
+    
+    gop_cache->set_limits(vhost_snapshot->gop_cache_max_duration, vhost_snapshot->gop_cache_max_size,
+        vhost_snapshot->gop_cache_fast_start);
+    gop_cache->set_audio_duration(vhost_snapshot->http_remux_fast_cache);
+    timeshift->set_limits(vhost_snapshot->time_shift, vhost_snapshot->time_shift_max_size);
     
     return err;
 }
@@ -1940,12 +3020,15 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
         return err;
     }
     
+    // The vhost maybe added, which fallback to default vhost before.
+    vhost_snapshot = _srs_config->get_vhost_snapshot(req->vhost);
+    
     // time_jitter
-    jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
+    jitter_algorithm = (SrsRtmpJitterAlgorithm)vhost_snapshot->time_jitter;
     
     // mix_correct
     if (true) {
-        bool v = _srs_config->get_mix_correct(req->vhost);
+        bool v = vhost_snapshot->mix_correct;
         
         // when changed, clear the mix queue.
         if (v != mix_correct) {
@@ -1956,7 +3039,7 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
     
     // atc changed.
     if (true) {
-        bool v = _srs_config->get_atc(vhost);
+        bool v = vhost_snapshot->atc;
         
         if (v != atc) {
             srs_warn("vhost %s atc changed to %d, connected client may corrupt.", vhost.c_str(), v);
@@ -1967,18 +3050,32 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
     
     // gop cache changed.
     if (true) {
-        bool v = _srs_config->get_gop_cache(vhost);
+        bool v = vhost_snapshot->gop_cache;
         
         if (v != gop_cache->enabled()) {
             string url = req->get_stream_url();
             srs_trace("vhost %s gop_cache changed to %d, source url=%s", vhost.c_str(), v, url.c_str());
             gop_cache->set(v);
         }
+        
+        gop_cache->set_limits(vhost_snapshot->gop_cache_max_duration, vhost_snapshot->gop_cache_max_size,
+            vhost_snapshot->gop_cache_fast_start);
+        gop_cache->set_audio_duration(vhost_snapshot->http_remux_fast_cache);
+    }
+    
+    // time shift changed.
+    if (true) {
+        timeshift->set_limits(vhost_snapshot->time_shift, vhost_snapshot->time_shift_max_size);
+        
+        // The shifted consumers play the live stream when disabled.
+        for (int i = 0; !timeshift->enabled() && i < (int)consumers.size(); i++) {
+            consumers.at(i)->timeshift = 0;
+        }
     }
     
     // queue length
     if (true) {
-        srs_utime_t v = _srs_config->get_queue_length(req->vhost);
+        srs_utime_t v = vhost_snapshot->queue_length;
         
         if (true) {
             std::vector<SrsConsumer*>::iterator it;
@@ -1986,6 +3083,7 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
             for (it = consumers.begin(); it != consumers.end(); ++it) {
                 SrsConsumer* consumer = *it;
                 consumer->set_queue_size(v);
+                consumer->set_drop_ratio(vhost_snapshot->drop_ratio);
             }
             
             srs_trace("consumers reload queue size success.");
@@ -1995,12 +3093,7 @@ srs_error_t SrsSource::on_reload_vhost_play(string vhost)
         // TODO: FIXME: support queue size.
 #if 0
         if (true) {
-            std::vector<SrsForwarder*>::iterator it;
-            
-            for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-                SrsForwarder* forwarder = *it;
-                forwarder->set_queue_size(v);
-            }
+            forward_ring->set_queue_size(v);
             
             srs_trace("forwarders reload queue size success.");
         }
@@ -2022,7 +3115,7 @@ srs_error_t SrsSource::on_source_id_changed(int id)
     if (_source_id == id) {
         return err;
     }
-
+    
     if (!_pre_source_id) {
         _pre_source_id = id;
     }
@@ -2058,6 +3151,21 @@ void SrsSource::update_auth(SrsRequest* r)
     req->update_auth(r);
 }
 
+void SrsSource::set_hls_ts_handler(ISrsHlsTsHandler* h)
+{
+    hub->set_hls_ts_handler(h);
+}
+
+SrsMemoryStat* SrsSource::memory_stat()
+{
+    return memory;
+}
+
+SrsCpuStat* SrsSource::cpu_stat()
+{
+    return cpu;
+}
+
 bool SrsSource::can_publish(bool is_edge)
 {
     if (is_edge) {
@@ -2067,14 +3175,19 @@ bool SrsSource::can_publish(bool is_edge)
     return _can_publish;
 }
 
+bool SrsSource::is_replica()
+{
+    return !_can_publish && hub->replica();
+}
+
 srs_error_t SrsSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket* metadata)
 {
     srs_error_t err = srs_success;
     
     // if allow atc_auto and bravo-atc detected, open atc for vhost.
     SrsAmf0Any* prop = NULL;
-    atc = _srs_config->get_atc(req->vhost);
-    if (_srs_config->get_atc_auto(req->vhost)) {
+    atc = vhost_snapshot->atc;
+    if (vhost_snapshot->atc_auto) {
         if ((prop = metadata->metadata->get_property("bravo_atc")) != NULL) {
             if (prop->is_string() && prop->to_str() == "true") {
                 atc = true;
@@ -2093,20 +3206,14 @@ srs_error_t SrsSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket*
     
     // when already got metadata, drop when reduce sequence header.
     bool drop_for_reduce = false;
-    if (meta->data() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (meta->data() && vhost_snapshot->reduce_sequence_header) {
         drop_for_reduce = true;
         srs_warn("drop for reduce sh metadata, size=%d", msg->size);
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        std::vector<SrsConsumer*>::iterator it;
-        for (it = consumers.begin(); it != consumers.end(); ++it) {
-            SrsConsumer* consumer = *it;
-            if ((err = consumer->enqueue(meta->data(), atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume metadata");
-            }
-        }
+    if (!drop_for_reduce && (err = fanout(meta->data())) != srs_success) {
+        return srs_error_wrap(err, "consume metadata");
     }
     
     // Copy to hub to all utilities.
@@ -2162,12 +3269,14 @@ srs_error_t SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
 {
     srs_error_t err = srs_success;
     
+    SrsCpuScope cpu_scope(cpu, SrsCpuDispatch);
+    
     bool is_aac_sequence_header = SrsFlvAudio::sh(msg->payload, msg->size);
     bool is_sequence_header = is_aac_sequence_header;
     
     // whether consumer should drop for the duplicated sequence header.
     bool drop_for_reduce = false;
-    if (is_sequence_header && meta->previous_ash() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (is_sequence_header && meta->previous_ash() && vhost_snapshot->reduce_sequence_header) {
         if (meta->previous_ash()->size == msg->size) {
             drop_for_reduce = srs_bytes_equals(meta->previous_ash()->payload, msg->payload, msg->size);
             srs_warn("drop for reduce sh audio, size=%d", msg->size);
@@ -2175,13 +3284,8 @@ srs_error_t SrsSource::on_audio_imp(SrsSharedPtrMessage* msg)
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume message");
-            }
-        }
+    if (!drop_for_reduce && (err = fanout(msg)) != srs_success) {
+        return srs_error_wrap(err, "consume message");
     }
     
     // Copy to hub to all utilities.
@@ -2246,6 +3350,22 @@ srs_error_t SrsSource::on_video(SrsCommonMessage* shared_video)
         return err;
     }
     
+    // Measure the ingest latency by the marker from upstream, or mark the video at interval.
+    if (SrsFlvVideo::h264(shared_video->payload, shared_video->size)) {
+        int64_t timestamp = 0;
+        if (SrsFlvVideo::marker(shared_video->payload, shared_video->size, &timestamp)) {
+            SrsStatistic::instance()->on_ingest_latency(req, srs_update_system_time() - timestamp);
+        } else if (vhost_snapshot->latency_marker > 0 && srs_get_monotonic_time() - last_marker_time >= vhost_snapshot->latency_marker) {
+            char* data = NULL;
+            int size = 0;
+            if (SrsFlvVideo::mark(shared_video->payload, shared_video->size, srs_update_system_time(), &data, &size)) {
+                shared_video->header.payload_length = size;
+                shared_video->create(&shared_video->header, data, size);
+                last_marker_time = srs_get_monotonic_time();
+            }
+        }
+    }
+    
     // convert shared_video to msg, user should not use shared_video again.
     // the payload is transfer to msg, and set to NULL in shared_video.
     SrsSharedPtrMessage msg;
@@ -2282,11 +3402,13 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
 {
     srs_error_t err = srs_success;
     
+    SrsCpuScope cpu_scope(cpu, SrsCpuDispatch);
+    
     bool is_sequence_header = SrsFlvVideo::sh(msg->payload, msg->size);
     
     // whether consumer should drop for the duplicated sequence header.
     bool drop_for_reduce = false;
-    if (is_sequence_header && meta->previous_vsh() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (is_sequence_header && meta->previous_vsh() && vhost_snapshot->reduce_sequence_header) {
         if (meta->previous_vsh()->size == msg->size) {
             drop_for_reduce = srs_bytes_equals(meta->previous_vsh()->payload, msg->payload, msg->size);
             srs_warn("drop for reduce sh video, size=%d", msg->size);
@@ -2305,13 +3427,8 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     }
     
     // copy to all consumer
-    if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume video");
-            }
-        }
+    if (!drop_for_reduce && (err = fanout(msg)) != srs_success) {
+        return srs_error_wrap(err, "consume video");
     }
     
     // when sequence header, donot push to gop cache and adjust the timestamp.
@@ -2337,6 +3454,67 @@ srs_error_t SrsSource::on_video_imp(SrsSharedPtrMessage* msg)
     return err;
 }
 
+srs_error_t SrsSource::fanout(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // Cache to time shift buffer before delivery, for the shifted consumers to read from it.
+    if ((err = timeshift->cache(msg)) != srs_success) {
+        return srs_error_wrap(err, "timeshift");
+    }
+    
+    // For atc or jitter off, the timestamp is never changed, so all consumers share the message.
+    if (atc || jitter_algorithm == SrsRtmpJitterAlgorithmOFF) {
+        for (int i = 0; i < (int)consumers.size(); i++) {
+            SrsConsumer* consumer = consumers.at(i);
+            if (consumer->timeshift > 0) {
+                err = consumer->enqueue_timeshift(timeshift, atc, jitter_algorithm);
+            } else {
+                err = consumer->enqueue_corrected(msg->copy());
+            }
+            if (err != srs_success) {
+                return srs_error_wrap(err, "enqueue");
+            }
+        }
+        return err;
+    }
+    
+    // For the full algorithm, get the delta once for the consumers in step with source,
+    // while the consumers just started such as dumped the gop cache, correct by themselves.
+    bool shared = jitter_algorithm == SrsRtmpJitterAlgorithmFULL && msg->is_av();
+    int64_t delta = shared ? shared_jitter->delta_of(msg->timestamp) : 0;
+    
+    for (int i = 0; i < (int)consumers.size(); i++) {
+        SrsConsumer* consumer = consumers.at(i);
+        
+        if (consumer->timeshift > 0) {
+            if ((err = consumer->enqueue_timeshift(timeshift, atc, jitter_algorithm)) != srs_success) {
+                return srs_error_wrap(err, "enqueue");
+            }
+            continue;
+        }
+        
+        if (!shared || !consumer->jitter->in_step(shared_jitter)) {
+            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
+                return srs_error_wrap(err, "enqueue");
+            }
+            continue;
+        }
+        
+        SrsSharedPtrMessage* copy = msg->copy();
+        copy->timestamp = consumer->jitter->correct_by(msg->timestamp, delta);
+        if ((err = consumer->enqueue_corrected(copy)) != srs_success) {
+            return srs_error_wrap(err, "enqueue");
+        }
+    }
+    
+    if (shared) {
+        shared_jitter->correct_by(msg->timestamp, delta);
+    }
+    
+    return err;
+}
+
 srs_error_t SrsSource::on_aggregate(SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -2403,7 +3581,7 @@ srs_error_t SrsSource::on_aggregate(SrsCommonMessage* msg)
         
         if (data_size > 0) {
             o.size = data_size;
-            o.payload = new char[o.size];
+            o.create_payload(o.size);
             stream->read_bytes(o.payload, o.size);
         }
         
@@ -2427,6 +3605,25 @@ srs_error_t SrsSource::on_aggregate(SrsCommonMessage* msg)
     return err;
 }
 
+void SrsSource::on_batch_start()
+{
+    batching = true;
+}
+
+void SrsSource::on_batch_end()
+{
+    batching = false;
+    
+#ifdef SRS_PERF_QUEUE_COND_WAIT
+    // Signal the consumers once for the whole batch.
+    std::vector<SrsConsumer*>::iterator it;
+    for (it = consumers.begin(); it != consumers.end(); ++it) {
+        SrsConsumer* consumer = *it;
+        consumer->update_wait(atc);
+    }
+#endif
+}
+
 srs_error_t SrsSource::on_publish()
 {
     srs_error_t err = srs_success;
@@ -2436,6 +3633,27 @@ srs_error_t SrsSource::on_publish()
     
     _can_publish = false;
     
+    // The publisher reconnects in grace, keep the source id for consumers, and continue the muxers.
+    if (grace_until > 0) {
+        grace_until = 0;
+        srs_trace("publisher reconnect in grace, source_id=%d, consumers=%d", _source_id, (int)consumers.size());
+        
+        // Drop the state of previous publisher, whose timestamp is not continuous with the new one.
+        mix_queue->clear();
+        gop_cache->clear();
+        is_monotonically_increase = true;
+        last_packet_time = 0;
+        
+        if ((err = hub->on_republish()) != srs_success) {
+            return srs_error_wrap(err, "hub republish");
+        }
+        
+        SrsStatistic* stat = SrsStatistic::instance();
+        stat->on_stream_publish(req, _srs_context->get_id());
+        
+        return err;
+    }
+    
     // whatever, the publish thread is the source or edge source,
     // save its id to srouce id.
     if ((err = on_source_id_changed(_srs_context->get_id())) != srs_success) {
@@ -2444,10 +3662,16 @@ srs_error_t SrsSource::on_publish()
     
     // reset the mix queue.
     mix_queue->clear();
-
+    
     // Reset the metadata cache, to make VLC happy when disable/enable stream.
     // @see https://github.com/ossrs/srs/issues/1630#issuecomment-597979448
-    meta->clear();
+    // @remark Keep the state when take over the replica, for the players to play the GOP cache without wait.
+    if (replica_hold_until > 0) {
+        srs_trace("standby take over replica, consumers=%d, gop=%d", (int)consumers.size(), !gop_cache->empty());
+        replica_hold_until = 0;
+    } else {
+        meta->clear();
+    }
     
     // detect the monotonically again.
     is_monotonically_increase = true;
@@ -2476,19 +3700,46 @@ void SrsSource::on_unpublish()
         return;
     }
     
+    // For publisher reconnect, keep the consumers, source id and muxers in grace, unpublish when timeout.
+    // @remark The replica is held by standby origin, never wait for it.
+    srs_utime_t grace = vhost_snapshot->reconnect_grace;
+    if (grace > 0 && !hub->replica()) {
+        grace_until = srs_get_monotonic_time() + grace;
+        _can_publish = true;
+        _srs_sources->schedule(this);
+        
+        srs_trace("wait publisher reconnect in %dms, consumers=%d", srsu2msi(grace), (int)consumers.size());
+        return;
+    }
+    
+    do_unpublish();
+}
+
+void SrsSource::do_unpublish()
+{
+    // For standby origin, hold the state of replica, for the publisher to take over it when
+    // the origin is down, and the edges to play the GOP cache without a keyframe wait.
+    if (hub->replica()) {
+        replica_hold_until = srs_get_monotonic_time() + SRS_STANDBY_REPLICA_HOLD;
+        _srs_sources->schedule(this);
+    }
+    
     // Notify the hub about the unpublish event.
     hub->on_unpublish();
     
     // only clear the gop cache,
     // donot clear the sequence header, for it maybe not changed,
     // when drop dup sequence header, drop the metadata also.
-    gop_cache->clear();
-
+    if (replica_hold_until == 0) {
+        gop_cache->clear();
+    }
+    timeshift->clear();
+    
     // Reset the metadata cache, to make VLC happy when disable/enable stream.
     // @see https://github.com/ossrs/srs/issues/1630#issuecomment-597979448
     meta->update_previous_vsh();
     meta->update_previous_ash();
-
+    
     srs_trace("cleanup when unpublish");
     
     _can_publish = true;
@@ -2505,48 +3756,68 @@ void SrsSource::on_unpublish()
     
     // no consumer, stream is die.
     if (consumers.empty()) {
-        die_at = srs_get_system_time();
+        die_at = srs_get_monotonic_time();
     }
 }
 
-srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds, bool dm, bool dg)
+srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds, bool dm, bool dg, srs_utime_t shift)
 {
     srs_error_t err = srs_success;
     
     consumer = new SrsConsumer(this, conn);
+    consumer->queue->set_memory(memory);
+    consumer->slot = (int)consumers.size();
     consumers.push_back(consumer);
-
-    srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    
+    srs_utime_t queue_size = vhost_snapshot->queue_length;
     consumer->set_queue_size(queue_size);
-
+    consumer->set_drop_ratio(vhost_snapshot->drop_ratio);
+    
+    // For time shift, play from the buffer in place of the gop cache, which is limited by the buffer duration.
+    bool shifted = shift > 0 && hub->active() && timeshift->enabled() && timeshift->begin() < timeshift->end();
+    if (shifted) {
+        consumer->timeshift = srs_min(shift, timeshift->duration());
+        consumer->timeshift_cursor = timeshift->seek(consumer->timeshift);
+    } else if (shift > 0) {
+        srs_warn("timeshift: ignore shift=%dms, active=%d, duration=%dms", srsu2msi(shift), hub->active(), srsu2msi(timeshift->duration()));
+    }
+    
     // if atc, update the sequence header to gop cache time.
-    if (atc && !gop_cache->empty()) {
+    if (atc && (shifted || !gop_cache->empty())) {
+        int64_t start = shifted? timeshift->at(consumer->timeshift_cursor)->timestamp : srsu2ms(gop_cache->start_time());
         if (meta->data()) {
-            meta->data()->timestamp = srsu2ms(gop_cache->start_time());
+            meta->data()->timestamp = start;
         }
         if (meta->vsh()) {
-            meta->vsh()->timestamp = srsu2ms(gop_cache->start_time());
+            meta->vsh()->timestamp = start;
         }
         if (meta->ash()) {
-            meta->ash()->timestamp = srsu2ms(gop_cache->start_time());
+            meta->ash()->timestamp = start;
         }
     }
-
+    
     // If stream is publishing, dumps the sequence header and gop cache.
     if (hub->active()) {
         // Copy metadata and sequence header to consumer.
         if ((err = meta->dumps(consumer, atc, jitter_algorithm, dm, ds)) != srs_success) {
             return srs_error_wrap(err, "meta dumps");
         }
-
+        
         // copy gop cache to client.
-        if (dg && (err = gop_cache->dump(consumer, atc, jitter_algorithm)) != srs_success) {
+        if (!shifted && dg && (err = gop_cache->dump(consumer, atc, jitter_algorithm)) != srs_success) {
             return srs_error_wrap(err, "gop cache dumps");
         }
+        
+        // Copy the time shift buffer to client, until the shift earlier than the latest message.
+        if (shifted && (err = consumer->enqueue_timeshift(timeshift, atc, jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "timeshift dumps");
+        }
     }
-
+    
     // print status.
-    if (dg) {
+    if (shifted) {
+        srs_trace("create consumer, active=%d, queue_size=%dms, timeshift=%dms, jitter=%d", hub->active(), srsu2msi(queue_size), srsu2msi(consumer->timeshift), jitter_algorithm);
+    } else if (dg) {
         srs_trace("create consumer, active=%d, queue_size=%.2f, jitter=%d", hub->active(), queue_size, jitter_algorithm);
     } else {
         srs_trace("create consumer, active=%d, ignore gop cache, jitter=%d", hub->active(), jitter_algorithm);
@@ -2565,15 +3836,88 @@ srs_error_t SrsSource::create_consumer(SrsConnection* conn, SrsConsumer*& consum
 
 void SrsSource::on_consumer_destroy(SrsConsumer* consumer)
 {
-    std::vector<SrsConsumer*>::iterator it;
-    it = std::find(consumers.begin(), consumers.end(), consumer);
-    if (it != consumers.end()) {
-        consumers.erase(it);
+    // Move the last consumer to the slot, to remove in O(1) for lots of players leaving.
+    int slot = consumer->slot;
+    if (slot >= 0 && slot < (int)consumers.size() && consumers[slot] == consumer) {
+        SrsConsumer* last = consumers.back();
+        consumers[slot] = last;
+        last->slot = slot;
+        consumers.pop_back();
+        consumer->slot = -1;
     }
     
     if (consumers.empty()) {
-        play_edge->on_all_client_stop();
-        die_at = srs_get_system_time();
+        // Keep ingesting for edge prefetch, stop it in cycle when idle.
+        if (prefetch_until == 0) {
+            play_edge->on_all_client_stop();
+        }
+        die_at = srs_get_monotonic_time();
+    }
+}
+
+void SrsSource::park_consumer(string token, SrsConsumer* consumer, srs_utime_t duration)
+{
+    // Free the previous consumer of the same token, which is not resumed.
+    std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> >::iterator it = parked.find(token);
+    if (it != parked.end()) {
+        SrsConsumer* previous = it->second.first;
+        parked.erase(it);
+        srs_freep(previous);
+    }
+    
+    // Free the consumer which is going to expire first, when too many parked.
+    if ((int)parked.size() >= SRS_SOURCE_PARKED_MAX) {
+        std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> >::iterator oldest = parked.begin();
+        for (it = parked.begin(); it != parked.end(); ++it) {
+            if (it->second.second < oldest->second.second) {
+                oldest = it;
+            }
+        }
+        
+        SrsConsumer* previous = oldest->second.first;
+        srs_warn("park drop token=%s, parked=%d", oldest->first.c_str(), (int)parked.size());
+        parked.erase(oldest);
+        srs_freep(previous);
+    }
+    
+    consumer->conn = NULL;
+    parked[token] = std::make_pair(consumer, srs_get_monotonic_time() + duration);
+    
+    // Schedule the source, to free the consumer when expired.
+    _srs_sources->schedule(this);
+}
+
+SrsConsumer* SrsSource::resume_consumer(string token, SrsConnection* conn)
+{
+    std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> >::iterator it = parked.find(token);
+    if (it == parked.end()) {
+        return NULL;
+    }
+    
+    SrsConsumer* consumer = it->second.first;
+    srs_utime_t expire = it->second.second;
+    parked.erase(it);
+    
+    // The cycle of source might not free it yet, so check the expire again.
+    if (srs_get_monotonic_time() >= expire) {
+        srs_freep(consumer);
+        return NULL;
+    }
+    
+    consumer->conn = conn;
+    return consumer;
+}
+
+void SrsSource::headers(vector<SrsSharedPtrMessage*>& msgs)
+{
+    if (meta->data()) {
+        msgs.push_back(meta->data()->copy());
+    }
+    if (meta->vsh()) {
+        msgs.push_back(meta->vsh()->copy());
+    }
+    if (meta->ash()) {
+        msgs.push_back(meta->ash()->copy());
     }
 }
 
@@ -2603,6 +3947,56 @@ void SrsSource::on_edge_proxy_unpublish()
     publish_edge->on_proxy_unpublish();
 }
 
+srs_error_t SrsSource::on_edge_prefetch(srs_utime_t idle)
+{
+    srs_error_t err = srs_success;
+    
+    if (!_srs_config->get_vhost_is_edge(req->vhost)) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "prefetch for non-edge vhost %s", req->vhost.c_str());
+    }
+    
+    // Cancel the prefetch, stop ingesting if no players.
+    if (idle <= 0) {
+        if (prefetch_until > 0) {
+            prefetch_until = srs_get_monotonic_time();
+        }
+        return err;
+    }
+    
+    prefetch_until = srs_get_monotonic_time() + idle;
+    _srs_sources->schedule(this);
+    
+    // Start ingest, which is ignored if already started by players.
+    if ((err = play_edge->on_client_play()) != srs_success) {
+        return srs_error_wrap(err, "play edge");
+    }
+    
+    return err;
+}
+
+srs_utime_t SrsSource::prefetch_remain()
+{
+    if (prefetch_until == 0) {
+        return 0;
+    }
+    return srs_max(0, prefetch_until - srs_get_monotonic_time());
+}
+
+srs_error_t SrsSource::snapshot(vector<SrsSharedPtrMessage*>& msgs)
+{
+    srs_error_t err = srs_success;
+    
+    SrsSharedPtrMessage* keyframe = gop_cache->last_keyframe();
+    if (!keyframe) {
+        return srs_error_new(ERROR_SNAPSHOT_NO_KEYFRAME, "no keyframe, gop_cache=%d", gop_cache->enabled());
+    }
+    
+    headers(msgs);
+    msgs.push_back(keyframe->copy());
+    
+    return err;
+}
+
 string SrsSource::get_curr_origin()
 {
     return play_edge->get_curr_origin();
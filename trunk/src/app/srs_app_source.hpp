@@ -27,17 +27,24 @@
 #include <srs_core.hpp>
 
 #include <map>
+#include <set>
+#include <deque>
 #include <vector>
 #include <string>
 
 #include <srs_app_st.hpp>
 #include <srs_app_reload.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_core_mem_watch.hpp>
 #include <srs_service_st.hpp>
 
+// The max parked consumers of a source, each keeps a queue of stream, so the tokens never grow for ever.
+#define SRS_SOURCE_PARKED_MAX 64
+
 class SrsFormat;
 class SrsRtmpFormat;
 class SrsConsumer;
+class SrsTimeShift;
 class SrsPlayEdge;
 class SrsPublishEdge;
 class SrsSource;
@@ -45,7 +52,10 @@ class SrsCommonMessage;
 class SrsOnMetaDataPacket;
 class SrsSharedPtrMessage;
 class SrsForwarder;
+class SrsForwardRing;
 class SrsRequest;
+class SrsStreamKey;
+class SrsVhostSnapshot;
 class SrsStSocket;
 class SrsRtmpServer;
 class SrsEdgeProxyContext;
@@ -54,6 +64,7 @@ class SrsNgExec;
 class SrsConnection;
 class SrsMessageHeader;
 class SrsHls;
+class ISrsHlsTsHandler;
 class SrsDvr;
 class SrsDash;
 class SrsEncoder;
@@ -74,6 +85,11 @@ enum SrsRtmpJitterAlgorithm
 };
 int srs_time_jitter_string2int(std::string time_jitter);
 
+// Pack the continuous audio and video messages to RTMP aggregate messages, in place of msgs.
+// @param count the count of msgs, input and output param.
+// @remark The packed messages are freed, and the other messages are kept as is.
+srs_error_t srs_aggregate_messages(SrsSharedPtrMessage** msgs, int& count);
+
 // Time jitter detect and correct, to ensure the rtmp stream is monotonically.
 class SrsRtmpJitter
 {
@@ -89,35 +105,68 @@ public:
     virtual srs_error_t correct(SrsSharedPtrMessage* msg, SrsRtmpJitterAlgorithm ag);
     // Get current client time, the last packet time.
     virtual int64_t get_time();
+public:
+    // For the full algorithm, the delta of timestamp only depends on the last packet time, so the source gets the
+    // delta once for all consumers in step, and each consumer applies it to its corrected time, as an offset.
+    // Get the delta of timestamp of packet, for the full algorithm.
+    virtual int64_t delta_of(int64_t time);
+    // Correct the timestamp of packet by delta, return the corrected time, for the full algorithm.
+    virtual int64_t correct_by(int64_t time, int64_t delta);
+    // Whether in the same last packet time as the other jitter, which gets the same delta.
+    virtual bool in_step(SrsRtmpJitter* o);
 };
 
-#ifdef SRS_PERF_QUEUE_FAST_VECTOR
-// To alloc and increase fixed space, fast remove and insert for msgs sender.
-// @see https://github.com/ossrs/srs/issues/251
-class SrsFastVector
+// The ring of messages, O(1) to enqueue and dequeue, without memmove when dequeue from front.
+// It also indexes the last video keyframe, to shrink the queue to the last gop without walking.
+// @remark The sequence is increasing and never wraps, the slot of message is (sequence & mask).
+// @remark For a ring which never grows, the push_back by producer and the pop_front by consumer
+//      are safe across threads, because the sequences are published after the slot is ready.
+//      However, the bytes are reported to the memory stat by plain counters, only accurate in one thread.
+class SrsMessageRing
 {
 private:
     SrsSharedPtrMessage** msgs;
-    int nb_msgs;
-    int count;
-public:
-    SrsFastVector();
-    virtual ~SrsFastVector();
-public:
+    // The capacity of ring, always power of 2.
+    int capacity;
+    int64_t mask;
+    // The sequence of the first and next message.
+    volatile int64_t head;
+    volatile int64_t tail;
+    // The sequence of the last video keyframe, -1 if none.
+    int64_t keyframe;
+    // The payload bytes of messages in ring.
+    SrsMemoryUsage memory;
+public:
+    SrsMessageRing();
+    virtual ~SrsMessageRing();
+public:
+    // Report the bytes of messages to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
     virtual int size();
-    virtual int begin();
-    virtual int end();
-    virtual SrsSharedPtrMessage** data();
+    virtual bool empty();
+    // Get the message of the index from the front.
     virtual SrsSharedPtrMessage* at(int index);
-    virtual void clear();
-    virtual void erase(int _begin, int _end);
+    // Get the index from the front of last video keyframe, -1 if none.
+    virtual int last_keyframe();
+    // Append the message, grows the ring if full.
     virtual void push_back(SrsSharedPtrMessage* msg);
+    // Remove and get the messages from the front, user should free them.
+    // @return The number of messages in pmsgs, at most max.
+    virtual int pop_front(SrsSharedPtrMessage** pmsgs, int max);
+    // Remove and free count messages from the front.
+    virtual void erase_front(int count);
+    // Remove the messages without free them.
+    virtual void clear();
+    // Free and remove all messages.
     virtual void free();
+private:
+    virtual void grow();
 };
-#endif
 
 // The message queue for the consumer(client), forwarder.
 // We limit the size in seconds, drop old messages(the whole gop) if full.
+// For slow consumer, it drops the non-reference frames first, then the video until next keyframe,
+// before the queue is full, @see set_drop_ratio().
 class SrsMessageQueue
 {
 private:
@@ -129,11 +178,17 @@ private:
     bool _ignore_shrink;
     // The max queue size, shrink if exceed it.
     srs_utime_t max_queue_size;
-#ifdef SRS_PERF_QUEUE_FAST_VECTOR
-    SrsFastVector msgs;
-#else
-    std::vector<SrsSharedPtrMessage*> msgs;
-#endif
+    SrsMessageRing msgs;
+    // The total messages dropped when shrink.
+    int64_t nb_drops;
+    // The ratio of max queue size to drop frames for slow consumer, 0 to disable.
+    double drop_ratio;
+    // Whether dropping the video frames until next keyframe.
+    bool drop_video;
+    // The total video frames dropped for slow consumer.
+    int64_t nb_frame_drops;
+    // The queue delay of the oldest message of last dump, in the time of stream.
+    srs_utime_t dump_delay;
 public:
     SrsMessageQueue(bool ignore_shrink = false);
     virtual ~SrsMessageQueue();
@@ -145,6 +200,19 @@ public:
     // Set the queue size
     // @param queue_size the queue size in srs_utime_t.
     virtual void set_queue_size(srs_utime_t queue_size);
+    // Get the total messages dropped by shrink, except the sequence headers.
+    virtual int64_t drops();
+    // Set the ratio of queue size to drop frames for slow consumer, 0 to disable.
+    // When exceed the ratio, drop the non-reference frames, and when exceed the half between
+    // the ratio and the queue size, drop the video frames until next keyframe, while keep audio.
+    virtual void set_drop_ratio(double v);
+    // Get the total video frames dropped for slow consumer.
+    virtual int64_t frame_drops();
+    // Get the queue delay of last dump, that is how long the oldest message waits in queue,
+    // measured by the time of stream, so the consumer never stamps each message.
+    virtual srs_utime_t delay();
+    // Report the bytes of queue to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
 public:
     // Enqueue the message, the timestamp always monotonically.
     // @param msg, the msg to enqueue, user never free it whatever the return code.
@@ -159,7 +227,9 @@ public:
     // @remark the atc/tba/tbv/ag are same to SrsConsumer.enqueue().
     virtual srs_error_t dump_packets(SrsConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm ag);
 private:
-    // Remove a gop from the front.
+    // Whether drop the video frame for slow consumer.
+    virtual bool should_drop(SrsSharedPtrMessage* msg);
+    // Remove the messages before the last video keyframe, keep the sequence headers.
     // if no iframe found, clear it.
     virtual void shrink();
 public:
@@ -184,6 +254,8 @@ public:
 // The consumer for SrsSource, that is a play client.
 class SrsConsumer : public ISrsWakable
 {
+    // For source to apply the shared delta of jitter to consumers.
+    friend class SrsSource;
 private:
     SrsRtmpJitter* jitter;
     SrsSource* source;
@@ -193,6 +265,18 @@ private:
     bool paused;
     // when source id changed, notice all consumers
     bool should_update_source_id;
+    // The dropped messages of queue, which is reported to stat.
+    int64_t nb_drops;
+    // The ratio of queue size to drop frames, by config of vhost.
+    double drop_ratio;
+    // Whether pack the audio and video of a dump to aggregate message, for RTMP player.
+    bool aggregate;
+    // The index of consumer in source, to remove it in O(1), -1 if not attached.
+    int slot;
+    // The shift duration to play from time shift buffer, 0 for live.
+    srs_utime_t timeshift;
+    // The sequence of next message to read from time shift buffer.
+    int64_t timeshift_cursor;
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     // The cond wait for mw.
     // @see https://github.com/ossrs/srs/issues/251
@@ -207,16 +291,30 @@ public:
 public:
     // Set the size of queue.
     virtual void set_queue_size(srs_utime_t queue_size);
+    // Set the ratio of queue size to drop frames for slow consumer.
+    virtual void set_drop_ratio(double v);
     // when source id changed, notice client to print.
     virtual void update_source_id();
+    // Set whether pack the audio and video messages to aggregate message when dump packets.
+    // @remark Only for RTMP player, the other players such as HTTP-FLV always use the raw messages.
+    virtual void set_aggregate(bool v);
 public:
     // Get current client time, the last packet time.
     virtual int64_t get_time();
+    // Get the duration of queue, which grows when the delivery is slower than the stream.
+    virtual srs_utime_t duration();
+    // Get the queue delay of last dump, @see SrsMessageQueue::delay
+    virtual srs_utime_t delay();
     // Enqueue an shared ptr message.
     // @param shared_msg, directly ptr, copy it if need to save it.
     // @param whether atc, donot use jitter correct if true.
     // @param ag the algorithm of time jitter.
     virtual srs_error_t enqueue(SrsSharedPtrMessage* shared_msg, bool atc, SrsRtmpJitterAlgorithm ag);
+    // Enqueue the message which is already corrected, for the source to apply the shared delta of jitter.
+    // @param msg, the message to enqueue, which is owned by consumer.
+    virtual srs_error_t enqueue_corrected(SrsSharedPtrMessage* msg);
+    // Enqueue the messages from time shift buffer, which are shift earlier than the latest one.
+    virtual srs_error_t enqueue_timeshift(SrsTimeShift* ts, bool atc, SrsRtmpJitterAlgorithm ag);
     // Get packets in consumer queue.
     // @param msgs the msgs array to dump packets to send.
     // @param count the count in array, intput and output param.
@@ -226,7 +324,11 @@ public:
     // wait for messages incomming, atleast nb_msgs and in duration.
     // @param nb_msgs the messages count to wait.
     // @param msgs_duration the messages duration to wait.
-    virtual void wait(int nb_msgs, srs_utime_t msgs_duration);
+    // @param timeout the max time to wait, for the player to check the peer in the same coroutine.
+    virtual void wait(int nb_msgs, srs_utime_t msgs_duration, srs_utime_t timeout);
+    // Signal the waiting consumer when got enough messages.
+    // @param whether atc, to signal when timestamp is reversed.
+    virtual void update_wait(bool atc);
 #endif
     // when client send the pause message.
     virtual srs_error_t on_play_client_pause(bool is_pause);
@@ -263,6 +365,22 @@ private:
     int audio_after_last_video_count;
     // cached gop.
     std::vector<SrsSharedPtrMessage*> gop_cache;
+    // The index in gop_cache of keyframes, the first one is the start of the oldest gop.
+    std::vector<int> keyframes;
+    // The bytes of payload in cache.
+    int64_t cached_size;
+    // Report the cached size to the memory stat.
+    SrsMemoryUsage memory;
+    // Whether the last gop exceed the max size, ignore messages until the next keyframe.
+    bool overflow;
+    // The max duration of gops to cache, 0 to only cache the last gop.
+    srs_utime_t max_duration;
+    // The max size of cache, 0 for no limit.
+    int64_t max_size;
+    // Dump from the first keyframe in the duration, 0 to dump all.
+    srs_utime_t fast_start;
+    // The duration of audio to cache for pure audio stream, 0 to disable the cache for it.
+    srs_utime_t audio_duration;
 public:
     SrsGopCache();
     virtual ~SrsGopCache();
@@ -272,6 +390,13 @@ public:
     // To enable or disable the gop cache.
     virtual void set(bool v);
     virtual bool enabled();
+    // Set the limits of gop cache, @see SrsConfig::get_gop_cache_max_duration
+    virtual void set_limits(srs_utime_t duration, int64_t size, srs_utime_t start);
+    // Set the window of pure audio stream, for the HTTP audio stream to fast start,
+    // @see SrsConfig::get_vhost_http_remux_fast_cache
+    virtual void set_audio_duration(srs_utime_t v);
+    // Report the bytes of cache to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
     // only for h264 codec
     // 1. cache the gop when got h264 video packet.
     // 2. clear gop when got keyframe.
@@ -290,6 +415,66 @@ public:
     // whether current stream is pure audio,
     // when no video in gop cache, the stream is pure audio right now.
     virtual bool pure_audio();
+    // Get the latest keyframe in cache, NULL if no keyframe.
+    // @remark The message is owned by cache, copy it if need to save it.
+    virtual SrsSharedPtrMessage* last_keyframe();
+private:
+    // Cache the audio of pure audio stream, and drop the audio which is out of the window.
+    virtual void cache_audio(SrsSharedPtrMessage* msg);
+    // Remove the oldest gop, the cache should have more than one gop.
+    virtual void shrink();
+    // Get the index of message to dump from.
+    virtual int dump_start();
+};
+
+// The time shift buffer, a rewindable live window of source, for the player to start from a point in the past,
+// by the param timeshift in seconds, for instance, rtmp://host/live/livestream?timeshift=300
+// @remark The player reads the buffer by a cursor, delayed the specified duration from the latest message,
+//      so it's paced by the publisher like the live consumer, @see SrsConsumer::enqueue_timeshift
+// @remark The sequence of message is increasing and never wraps, the slot of message is (sequence - base).
+class SrsTimeShift
+{
+private:
+    // The cached messages, including the sequence headers and metadata.
+    std::deque<SrsSharedPtrMessage*> msgs;
+    // The sequence of the first message in buffer.
+    int64_t base;
+    // The sequences of video keyframes in buffer, to seek and shrink by gop.
+    std::deque<int64_t> keyframes;
+    // The bytes of payload in buffer.
+    int64_t cached_size;
+    // The max duration of buffer, 0 to disable it.
+    srs_utime_t max_duration;
+    // The max size of buffer, 0 for no limit.
+    int64_t max_size;
+public:
+    SrsTimeShift();
+    virtual ~SrsTimeShift();
+public:
+    // Set the limits of buffer, @see SrsConfig::get_time_shift
+    virtual void set_limits(srs_utime_t duration, int64_t size);
+    virtual bool enabled();
+    virtual srs_utime_t duration();
+    // Cache the message, and drop the old gops which are out of the duration.
+    // @param shared_msg, directly ptr, copy it if need to save it.
+    virtual srs_error_t cache(SrsSharedPtrMessage* shared_msg);
+    virtual void clear();
+public:
+    // The sequence of the first message, and the sequence after the last message.
+    virtual int64_t begin();
+    virtual int64_t end();
+    // Get the message at sequence, which should be in [begin, end).
+    virtual SrsSharedPtrMessage* at(int64_t seq);
+    // Get the timestamp in ms of the latest message, 0 if empty.
+    virtual int64_t last_timestamp();
+    // Seek to the last keyframe which is shift earlier than the latest message, or the first keyframe if none.
+    // @return the sequence to start, end() if empty.
+    virtual int64_t seek(srs_utime_t shift);
+    // Get the sequence of the first keyframe not less than seq, to resume the cursor which is dropped.
+    virtual int64_t next_keyframe(int64_t seq);
+private:
+    // Remove the first message, or the oldest gop.
+    virtual void shrink();
 };
 
 // The handler to handle the event of srs source.
@@ -308,12 +493,13 @@ public:
 };
 
 // The mix queue to correct the timestamp for mix_correct algorithm.
+// The audio and video are queued in their own ring, which is in order of arrival,
+// and popped by a two-way merge of the fronts, so it's O(1) to push and pop.
 class SrsMixQueue
 {
 private:
-    uint32_t nb_videos;
-    uint32_t nb_audios;
-    std::multimap<int64_t, SrsSharedPtrMessage*> msgs;
+    SrsMessageRing* videos;
+    SrsMessageRing* audios;
 public:
     SrsMixQueue();
     virtual ~SrsMixQueue();
@@ -332,9 +518,18 @@ private:
     SrsSource* source;
     SrsRequest* req;
     bool is_active;
+    // Whether the stream is relayed from sibling worker.
+    bool is_relay;
+    // Whether the stream is replicated from another origin, as the standby of it.
+    bool is_replica;
+    // Whether the HLS and DVR are paused by overload.
+    bool is_paused;
 private:
     // The format, codec information.
     SrsRtmpFormat* format;
+    // The components below are created when the vhost enables them, NULL if never enabled,
+    // so the sources on vhost without them never allocate them, and skip them for each frame.
+    // @remark The component is kept when disabled by reload, which is disabled by itself.
     // hls handler.
     SrsHls* hls;
     // The DASH encoder.
@@ -351,6 +546,10 @@ private:
     SrsNgExec* ng_exec;
     // To forward stream to other servers
     std::vector<SrsForwarder*> forwarders;
+    // The ring shared by all forwarders.
+    SrsForwardRing* forward_ring;
+    // The handler of HLS to share ts packets, set to hls when it's created.
+    ISrsHlsTsHandler* hls_ts_handler;
 public:
     SrsOriginHub();
     virtual ~SrsOriginHub();
@@ -364,8 +563,12 @@ public:
     // Cycle the hub, process some regular events,
     // For example, dispose hls in cycle.
     virtual srs_error_t cycle();
+    // Whether the hub has regular events to process in cycle.
+    virtual bool pending();
     // Whether the stream hub is active, or stream is publishing.
     virtual bool active();
+    // Whether the stream is replicated from another origin.
+    virtual bool replica();
 public:
     // When got a parsed metadata.
     virtual srs_error_t on_meta_data(SrsSharedPtrMessage* shared_metadata, SrsOnMetaDataPacket* packet);
@@ -378,12 +581,16 @@ public:
     virtual srs_error_t on_publish();
     // When stop publish stream.
     virtual void on_unpublish();
+    // When the publisher reconnects in grace, continue the muxers for the new publisher.
+    virtual srs_error_t on_republish();
 // Internal callback.
 public:
     // For the SrsForwarder to callback to request the sequence headers.
     virtual srs_error_t on_forwarder_start(SrsForwarder* forwarder);
     // For the SrsDvr to callback to request the sequence headers.
     virtual srs_error_t on_dvr_request_sh();
+    // For the HTTP-TS to share the ts packets of HLS, NULL to disable.
+    virtual void set_hls_ts_handler(ISrsHlsTsHandler* h);
 // Interface ISrsReloadHandler
 public:
     virtual srs_error_t on_reload_vhost_forward(std::string vhost);
@@ -395,7 +602,16 @@ public:
     virtual srs_error_t on_reload_vhost_exec(std::string vhost);
 private:
     virtual srs_error_t create_forwarders();
+    virtual srs_error_t create_forwarder(std::string forward_server, bool relay, bool replica);
     virtual void destroy_forwarders();
+    // Create the components which are enabled by vhost, and not created yet.
+    virtual srs_error_t create_components();
+    // Whether any transcode engines are configured for the stream, in scope of vhost, app or stream.
+    virtual bool transcode_configured();
+    // Demux the samples of format only when the muxers such as hls/dash/dvr consume them.
+    virtual void update_format_demux();
+    // Pause or resume the HLS and DVR by overload, for low priority vhost.
+    virtual srs_error_t check_overload();
 };
 
 // Each stream have optional meta(sps/pps in sequence header and metadata).
@@ -414,6 +630,8 @@ private:
     // The format for sequence header.
     SrsRtmpFormat* vformat;
     SrsRtmpFormat* aformat;
+    // Report the bytes of metadata and sequence headers to the memory stat.
+    SrsMemoryUsage memory;
 public:
     SrsMetaCache();
     virtual ~SrsMetaCache();
@@ -422,6 +640,10 @@ public:
     virtual void dispose();
     // For each publishing, clear the metadata cache.
     virtual void clear();
+    // Report the bytes of cache to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
+private:
+    virtual void update_memory();
 public:
     // Get the cached metadata.
     virtual SrsSharedPtrMessage* data();
@@ -452,11 +674,19 @@ public:
 };
 
 // The source manager to create and refresh all stream sources.
+// The number of shards of source pool, to keep the maps shallow for huge number of streams.
+#define SRS_SOURCE_POOL_SHARDS 64
+
 class SrsSourceManager
 {
 private:
     srs_mutex_t lock;
-    std::map<std::string, SrsSource*> pool;
+    // The sources, keyed by the interned key of stream, sharded by the hash of key.
+    std::map<SrsStreamKey*, SrsSource*> pool[SRS_SOURCE_POOL_SHARDS];
+    int nn_sources;
+    // The sources with pending work to cycle, for example, hls dispose and edge prefetch,
+    // so the idle sources are never visited in cycle.
+    std::set<SrsSource*> pending;
 public:
     SrsSourceManager();
     virtual ~SrsSourceManager();
@@ -466,12 +696,22 @@ public:
     // @param h the event handler for source.
     // @param pps the matched source, if success never be NULL.
     virtual srs_error_t fetch_or_create(SrsRequest* r, ISrsSourceHandler* h, SrsSource** pps);
+    // Find the exists source, NULL when not exists, never update the request of source.
+    virtual SrsSource* find(SrsRequest* r);
 private:
     // Get the exists source, NULL when not exists.
     // update the request and return the exists source.
     virtual SrsSource* fetch(SrsRequest* r);
+    virtual std::map<SrsStreamKey*, SrsSource*>& shard(SrsStreamKey* key);
 public:
-    // dispose and cycle all sources.
+    // The number of sources.
+    virtual int size();
+    // Schedule the source to cycle, until it has no pending work.
+    virtual void schedule(SrsSource* s);
+    // Never cycle the source, for example, it's freed.
+    virtual void unschedule(SrsSource* s);
+public:
+    // dispose all sources, and cycle the pending sources.
     virtual void dispose();
     virtual srs_error_t cycle();
 private:
@@ -489,6 +729,7 @@ extern SrsSourceManager* _srs_sources;
 class SrsSource : public ISrsReloadHandler
 {
     friend class SrsOriginHub;
+    friend class SrsConsumer;
 private:
     // For publish, it's the publish client id.
     // For edge, it's the edge ingest id.
@@ -499,8 +740,13 @@ private:
     int _pre_source_id;
     // deep copy of client request.
     SrsRequest* req;
+    // The resolved settings of vhost, owned by config.
+    SrsVhostSnapshot* vhost_snapshot;
     // To delivery stream to clients.
     std::vector<SrsConsumer*> consumers;
+    // The consumers of disconnected players, for them to resume by token, key is the token.
+    // @remark The parked consumers are still in consumers, and owned by source.
+    std::map<std::string, std::pair<SrsConsumer*, srs_utime_t> > parked;
     // The time jitter algorithm for vhost.
     SrsRtmpJitterAlgorithm jitter_algorithm;
     // For play, whether use interlaced/mixed algorithm to correct timestamp.
@@ -516,6 +762,8 @@ private:
     bool is_monotonically_increase;
     // The time of the packet we just got.
     int64_t last_packet_time;
+    // The monotonic time when marked the video by timestamp for latency.
+    srs_utime_t last_marker_time;
     // The event handler.
     ISrsSourceHandler* handler;
     // The edge control service
@@ -523,6 +771,8 @@ private:
     SrsPublishEdge* publish_edge;
     // The gop cache for client fast startup.
     SrsGopCache* gop_cache;
+    // The time shift buffer for client to play from the past.
+    SrsTimeShift* timeshift;
     // The hub for origin server.
     SrsOriginHub* hub;
     // The metadata cache.
@@ -533,12 +783,29 @@ private:
     // The last die time, when all consumers quit and no publisher,
     // We will remove the source when source die.
     srs_utime_t die_at;
+    // For edge, keep ingesting from origin without players until the time, 0 if not prefetch.
+    srs_utime_t prefetch_until;
+    // For standby origin, keep the GOP cache of replica until the time, for publisher to take over it,
+    // 0 if not holding the replica.
+    srs_utime_t replica_hold_until;
+    // For publisher reconnect, keep the consumers and muxers until the time, 0 if not in grace.
+    srs_utime_t grace_until;
+    // Whether in a batch of messages, the consumers are signaled when batch end.
+    bool batching;
+    // The jitter of source, to get the delta of timestamp once for the consumers in step.
+    SrsRtmpJitter* shared_jitter;
+    // The memory held by source, owned by the statistic.
+    SrsMemoryStat* memory;
+    // The CPU cost of source and its players, owned by the statistic.
+    SrsCpuStat* cpu;
 public:
     SrsSource();
     virtual ~SrsSource();
 public:
     virtual void dispose();
     virtual srs_error_t cycle();
+    // Whether the source has pending work to cycle, see SrsSourceManager::schedule.
+    virtual bool pending();
     // Remove source when expired.
     virtual bool expired();
 public:
@@ -558,8 +825,18 @@ public:
     virtual bool inactive();
     // Update the authentication information in request.
     virtual void update_auth(SrsRequest* r);
+    // For the HTTP-TS to share the ts packets of HLS, NULL to disable.
+    virtual void set_hls_ts_handler(ISrsHlsTsHandler* h);
+    // Get the memory stat of source, for the connections to report the bytes they hold.
+    // @return The stat, NULL if not initialized.
+    virtual SrsMemoryStat* memory_stat();
+    // Get the CPU stat of source, for the players to account the cycles to send.
+    // @return The stat, NULL if not initialized.
+    virtual SrsCpuStat* cpu_stat();
 public:
     virtual bool can_publish(bool is_edge);
+    // Whether the stream is published by the replica of another origin, which the publisher could take over.
+    virtual bool is_replica();
     virtual srs_error_t on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPacket* metadata);
 public:
     virtual srs_error_t on_audio(SrsCommonMessage* audio);
@@ -569,21 +846,41 @@ public:
     virtual srs_error_t on_video(SrsCommonMessage* video);
 private:
     virtual srs_error_t on_video_imp(SrsSharedPtrMessage* video);
+    // Copy the message to all consumers, get the delta of jitter once for the consumers in step.
+    virtual srs_error_t fanout(SrsSharedPtrMessage* msg);
 public:
     virtual srs_error_t on_aggregate(SrsCommonMessage* msg);
+    // When start and end a batch of messages from publisher,
+    // to signal the consumers once for each batch.
+    virtual void on_batch_start();
+    virtual void on_batch_end();
     // Publish stream event notify.
     // @param _req the request from client, the source will deep copy it,
     //         for when reload the request of client maybe invalid.
     virtual srs_error_t on_publish();
     virtual void on_unpublish();
+private:
+    virtual void do_unpublish();
 public:
     // Create consumer and dumps packets in cache.
     // @param consumer, output the create consumer.
     // @param ds, whether dumps the sequence header.
     // @param dm, whether dumps the metadata.
     // @param dg, whether dumps the gop cache.
-    virtual srs_error_t create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds = true, bool dm = true, bool dg = true);
+    // @param shift, the duration to play from time shift buffer, 0 for live.
+    virtual srs_error_t create_consumer(SrsConnection* conn, SrsConsumer*& consumer, bool ds = true, bool dm = true, bool dg = true, srs_utime_t shift = 0);
     virtual void on_consumer_destroy(SrsConsumer* consumer);
+    // Park the consumer of disconnected player, which keeps receiving stream, for the player to resume it
+    // by the token in the duration, or it's freed, @see SrsConfig::get_vhost_play_resume
+    // @remark The consumer is owned by source when parked.
+    // @remark The consumer to expire first is freed when too many parked, @see SRS_SOURCE_PARKED_MAX
+    virtual void park_consumer(std::string token, SrsConsumer* consumer, srs_utime_t duration);
+    // Take the parked consumer by token, NULL if not found or expired.
+    // @remark The consumer is owned by user, who should free it.
+    virtual SrsConsumer* resume_consumer(std::string token, SrsConnection* conn);
+    // Get the copies of metadata and sequence headers, which are ignored if not available.
+    // @remark User must free the messages.
+    virtual void headers(std::vector<SrsSharedPtrMessage*>& msgs);
     virtual void set_cache(bool enabled);
     virtual SrsRtmpJitterAlgorithm jitter();
 public:
@@ -593,6 +890,17 @@ public:
     virtual srs_error_t on_edge_proxy_publish(SrsCommonMessage* msg);
     // For edge, proxy stop publish
     virtual void on_edge_proxy_unpublish();
+    // For edge, start to ingest from origin and fill the gop cache before players arrive,
+    // and stop it when idle for the duration without players.
+    // @param idle The duration to keep ingesting without players, 0 to cancel the prefetch.
+    virtual srs_error_t on_edge_prefetch(srs_utime_t idle);
+    // For edge, get the remain duration of prefetch, 0 if not prefetch.
+    virtual srs_utime_t prefetch_remain();
+public:
+    // Get the snapshot of stream, the copies of metadata, sequence headers and the latest keyframe in gop cache,
+    // the metadata and sequence headers are ignored when not available.
+    // @remark User must free the messages.
+    virtual srs_error_t snapshot(std::vector<SrsSharedPtrMessage*>& msgs);
 public:
     virtual std::string get_curr_origin();
 };
@@ -0,0 +1,871 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_srt.hpp>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+
+// Parse the k=v pairs separated by flag, for example, the r=live/livestream,m=publish
+// @remark It's also called by the thread of SRT, so never use the static variables.
+static void srs_srt_parse_kvs(string s, string flag, map<string, string>& kvs)
+{
+    vector<string> pairs = srs_string_split(s, flag);
+    for (int i = 0; i < (int)pairs.size(); i++) {
+        const string& kv = pairs.at(i);
+        size_t pos = kv.find("=");
+        if (pos == string::npos) {
+            kvs[kv] = "";
+        } else {
+            kvs[kv.substr(0, pos)] = kv.substr(pos + 1);
+        }
+    }
+}
+
+SrsSrtStreamId::SrsSrtStreamId()
+{
+    latency = 0;
+}
+
+SrsSrtStreamId::~SrsSrtStreamId()
+{
+}
+
+srs_error_t SrsSrtStreamId::parse(string sid, string default_app)
+{
+    srs_error_t err = srs_success;
+    
+    string path;
+    map<string, string> query;
+    
+    if (srs_string_starts_with(sid, "#!::")) {
+        srs_srt_parse_kvs(sid.substr(4), ",", query);
+        path = query["r"];
+        vhost = query["h"];
+    } else {
+        size_t pos = sid.find("?");
+        path = sid.substr(0, pos);
+        if (pos != string::npos) {
+            srs_srt_parse_kvs(sid.substr(pos + 1), "&", query);
+        }
+    }
+    
+    if (vhost.empty()) {
+        vhost = query["vhost"];
+    }
+    if (vhost.empty()) {
+        vhost = SRS_CONSTS_RTMP_DEFAULT_VHOST;
+    }
+    
+    path = srs_string_trim_start(path, "/");
+    size_t pos = path.rfind("/");
+    if (pos == string::npos) {
+        app = default_app;
+        stream = path;
+    } else {
+        app = path.substr(0, pos);
+        stream = path.substr(pos + 1);
+    }
+    if (app.empty() || stream.empty()) {
+        return srs_error_new(ERROR_SRT_STREAMID, "no stream of streamid=%s", sid.c_str());
+    }
+    
+    mode = query["m"];
+    if (mode.empty() || mode == "play") {
+        mode = "request";
+    }
+    if (mode != "request" && mode != "publish") {
+        return srs_error_new(ERROR_SRT_STREAMID, "invalid mode=%s of streamid=%s", mode.c_str(), sid.c_str());
+    }
+    
+    latency = srs_max(0, ::atoi(query["latency"].c_str()));
+    
+    // Keep the other params, such as the token for http hooks.
+    param = "";
+    for (map<string, string>::iterator it = query.begin(); it != query.end(); ++it) {
+        const string& k = it->first;
+        if (k.empty() || k == "r" || k == "h" || k == "m" || k == "vhost" || k == "latency") {
+            continue;
+        }
+        param += (param.empty()? "?" : "&") + k + "=" + it->second;
+    }
+    
+    return err;
+}
+
+bool SrsSrtStreamId::is_publish()
+{
+    return mode == "publish";
+}
+
+SrsRequest* SrsSrtStreamId::to_request(string ip)
+{
+    SrsRequest* req = new SrsRequest();
+    
+    req->ip = ip;
+    req->schema = "srt";
+    req->vhost = vhost;
+    req->host = (vhost == SRS_CONSTS_RTMP_DEFAULT_VHOST)? "127.0.0.1" : vhost;
+    req->port = SRS_CONSTS_RTMP_DEFAULT_PORT;
+    req->app = app;
+    req->stream = stream;
+    req->param = param;
+    req->tcUrl = srs_generate_tc_url(req->host, req->vhost, req->app, req->port);
+    
+    return req;
+}
+
+#ifdef SRS_AUTO_SRT
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <sstream>
+
+#include <srs_core_autofree.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_thread.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_ingest_native.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_pithy_print.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_core_performance.hpp>
+
+// The interval to poll the SRT sockets, when there is no event.
+#define SRS_SRT_POLL_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+// The max events to poll one time.
+#define SRS_SRT_POLL_EVENTS 1024
+// The hold window in ms of bridge, to sort the messages by dts, because the audio of TS is muxed in PES.
+#define SRS_SRT_HOLD 300
+// The max size of SRT message.
+#define SRS_SRT_MAX_PAYLOAD 1456
+// The backlog of listener, for the pending handshakes.
+#define SRS_SRT_LISTEN_BACKLOG 512
+
+SrsSrtPoller::SrsSrtPoller()
+{
+    srt_epoller = -1;
+    trd = new SrsSTCoroutine("srt-poller", this);
+    events.resize(SRS_SRT_POLL_EVENTS);
+}
+
+SrsSrtPoller::~SrsSrtPoller()
+{
+    srs_freep(trd);
+    
+    if (srt_epoller >= 0) {
+        srt_epoll_release(srt_epoller);
+    }
+}
+
+srs_error_t SrsSrtPoller::initialize()
+{
+    srs_error_t err = srs_success;
+    
+    if ((srt_epoller = srt_epoll_create()) < 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "epoll create, %s", srt_getlasterror_str());
+    }
+    
+    // Poll without any socket, for the clients come and go.
+    srt_epoll_set(srt_epoller, SRT_EPOLL_ENABLE_EMPTY);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start poller");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSrtPoller::add(SrsSrtSocket* skt)
+{
+    int events = SRT_EPOLL_IN | SRT_EPOLL_OUT | SRT_EPOLL_ERR | SRT_EPOLL_ET;
+    if (srt_epoll_add_usock(srt_epoller, skt->fd(), &events) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "epoll add fd=%d, %s", skt->fd(), srt_getlasterror_str());
+    }
+    
+    sockets[skt->fd()] = skt;
+    
+    return srs_success;
+}
+
+void SrsSrtPoller::remove(SrsSrtSocket* skt)
+{
+    srt_epoll_remove_usock(srt_epoller, skt->fd());
+    sockets.erase(skt->fd());
+}
+
+srs_error_t SrsSrtPoller::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "srt poller");
+        }
+        
+        // Never block the ST thread, poll the events which are ready.
+        int nn = srt_epoll_uwait(srt_epoller, &events[0], (int)events.size(), 0);
+        
+        for (int i = 0; i < nn; i++) {
+            SRT_EPOLL_EVENT& ev = events[i];
+            
+            std::map<SRTSOCKET, SrsSrtSocket*>::iterator it = sockets.find(ev.fd);
+            if (it != sockets.end()) {
+                it->second->notify(ev.events);
+            }
+        }
+        
+        // Yield to the notified coroutines, and sleep for a while if idle.
+        srs_usleep(nn > 0? 0 : SRS_SRT_POLL_INTERVAL);
+    }
+    
+    return err;
+}
+
+SrsSrtSocket::SrsSrtSocket(SrsSrtPoller* p, SRTSOCKET fd)
+{
+    poller = p;
+    srtfd = fd;
+    read_cond = srs_cond_new();
+    write_cond = srs_cond_new();
+    broken = false;
+    rtm = stm = SRS_UTIME_NO_TIMEOUT;
+    rbytes = sbytes = 0;
+}
+
+SrsSrtSocket::~SrsSrtSocket()
+{
+    poller->remove(this);
+    srt_close(srtfd);
+    
+    srs_cond_destroy(read_cond);
+    srs_cond_destroy(write_cond);
+}
+
+srs_error_t SrsSrtSocket::initialize()
+{
+    srs_error_t err = srs_success;
+    
+    // Never block the ST thread, the coroutine waits for the event of poller.
+    bool sync = false;
+    srt_setsockflag(srtfd, SRTO_RCVSYN, &sync, sizeof(sync));
+    srt_setsockflag(srtfd, SRTO_SNDSYN, &sync, sizeof(sync));
+    
+    if ((err = poller->add(this)) != srs_success) {
+        return srs_error_wrap(err, "poll fd=%d", srtfd);
+    }
+    
+    return err;
+}
+
+SRTSOCKET SrsSrtSocket::fd()
+{
+    return srtfd;
+}
+
+void SrsSrtSocket::set_recv_timeout(srs_utime_t tm)
+{
+    rtm = tm;
+}
+
+void SrsSrtSocket::set_send_timeout(srs_utime_t tm)
+{
+    stm = tm;
+}
+
+int64_t SrsSrtSocket::get_recv_bytes()
+{
+    return rbytes;
+}
+
+int64_t SrsSrtSocket::get_send_bytes()
+{
+    return sbytes;
+}
+
+srs_error_t SrsSrtSocket::accept(SRTSOCKET* pfd, string& ip)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        sockaddr_storage addr;
+        int addrlen = sizeof(addr);
+        
+        SRTSOCKET fd = srt_accept(srtfd, (sockaddr*)&addr, &addrlen);
+        if (fd != SRT_INVALID_SOCK) {
+            char host[NI_MAXHOST];
+            if (getnameinfo((sockaddr*)&addr, addrlen, host, sizeof(host), NULL, 0, NI_NUMERICHOST) == 0) {
+                ip = host;
+            }
+            
+            *pfd = fd;
+            return err;
+        }
+        
+        if (srt_getlasterror(NULL) != SRT_EASYNCRCV) {
+            return srs_error_new(ERROR_SRT_SOCKET, "accept, %s", srt_getlasterror_str());
+        }
+        
+        if ((err = wait(read_cond, SRS_UTIME_NO_TIMEOUT)) != srs_success) {
+            return srs_error_wrap(err, "wait client");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSrtSocket::recvmsg(char* buf, int size, int* nread)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        int nn = srt_recvmsg(srtfd, buf, size);
+        if (nn > 0) {
+            rbytes += nn;
+            *nread = nn;
+            return err;
+        }
+        
+        if (nn < 0 && srt_getlasterror(NULL) != SRT_EASYNCRCV) {
+            return srs_error_new(ERROR_SRT_IO, "recvmsg, %s", srt_getlasterror_str());
+        }
+        
+        if ((err = wait(read_cond, rtm)) != srs_success) {
+            return srs_error_wrap(err, "wait readable");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSrtSocket::sendmsg(char* buf, int size)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        int nn = srt_sendmsg(srtfd, buf, size, -1, true);
+        if (nn > 0) {
+            sbytes += nn;
+            return err;
+        }
+        
+        if (nn < 0 && srt_getlasterror(NULL) != SRT_EASYNCSND) {
+            return srs_error_new(ERROR_SRT_IO, "sendmsg, %s", srt_getlasterror_str());
+        }
+        
+        if ((err = wait(write_cond, stm)) != srs_success) {
+            return srs_error_wrap(err, "wait writable");
+        }
+    }
+    
+    return err;
+}
+
+string SrsSrtSocket::summary()
+{
+    SRT_TRACEBSTATS stats;
+    if (srt_bstats(srtfd, &stats, 0) != 0) {
+        return "";
+    }
+    
+    stringstream ss;
+    ss << "rtt=" << stats.msRTT << "ms, bw=" << stats.mbpsBandwidth << "mbps"
+        << ", lost=" << stats.pktRcvLossTotal << "/" << stats.pktSndLossTotal
+        << ", retrans=" << stats.pktRetransTotal << ", drop=" << stats.pktRcvDropTotal << "/" << stats.pktSndDropTotal;
+    return ss.str();
+}
+
+void SrsSrtSocket::notify(int events)
+{
+    if ((events & SRT_EPOLL_ERR) != 0) {
+        broken = true;
+    }
+    
+    if ((events & (SRT_EPOLL_IN | SRT_EPOLL_ERR)) != 0) {
+        srs_cond_signal(read_cond);
+    }
+    if ((events & (SRT_EPOLL_OUT | SRT_EPOLL_ERR)) != 0) {
+        srs_cond_signal(write_cond);
+    }
+}
+
+srs_error_t SrsSrtSocket::wait(srs_cond_t cond, srs_utime_t tm)
+{
+    if (broken) {
+        return srs_error_new(ERROR_SRT_IO, "broken fd=%d, state=%d", srtfd, (int)srt_getsockstate(srtfd));
+    }
+    
+    if (srs_cond_timedwait(cond, tm) != 0) {
+        if (errno == ETIME) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "timeout %d ms", srsu2msi(tm));
+        }
+        return srs_error_new(ERROR_SRT_IO, "interrupted");
+    }
+    
+    return srs_success;
+}
+
+SrsSrtConn::SrsSrtConn(SrsSrtServer* s, ISrsSourceHandler* h, SrsSrtSocket* c, string cip)
+{
+    server = s;
+    handler = h;
+    skt = c;
+    ip = cip;
+    req = NULL;
+    trd = new SrsSTCoroutine("srt", this);
+}
+
+SrsSrtConn::~SrsSrtConn()
+{
+    trd->interrupt();
+    srs_freep(trd);
+    
+    srs_freep(skt);
+    srs_freep(req);
+}
+
+srs_error_t SrsSrtConn::start()
+{
+    return trd->start();
+}
+
+string SrsSrtConn::remote_ip()
+{
+    return ip;
+}
+
+srs_error_t SrsSrtConn::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    // Free the connection by manager.
+    server->remove(this);
+    
+    if (srs_is_client_gracefully_close(err)) {
+        srs_warn("srt client %s disconnect, %s", ip.c_str(), srs_error_desc(err).c_str());
+    } else if (err != srs_success) {
+        srs_error("srt serve client %s, %s", ip.c_str(), srs_error_desc(err).c_str());
+    }
+    srs_freep(err);
+    
+    return srs_success;
+}
+
+srs_error_t SrsSrtConn::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    char buf[512];
+    int size = sizeof(buf);
+    if (srt_getsockflag(skt->fd(), SRTO_STREAMID, buf, &size) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "get streamid, %s", srt_getlasterror_str());
+    }
+    string streamid(buf, size);
+    
+    SrsSrtStreamId sid;
+    if ((err = sid.parse(streamid, _srs_config->get_srt_default_app())) != srs_success) {
+        return srs_error_wrap(err, "parse streamid");
+    }
+    
+    req = sid.to_request(ip);
+    
+    // Apply the default vhost, like the RTMP client.
+    SrsConfDirective* parsed_vhost = _srs_config->get_vhost(req->vhost);
+    if (parsed_vhost) {
+        req->vhost = parsed_vhost->arg0();
+    }
+    
+    srs_trace("srt client ip=%s, streamid=%s, %s %s, latency=%dms", ip.c_str(), streamid.c_str(),
+        sid.mode.c_str(), req->get_stream_url().c_str(), sid.latency);
+    
+    if (sid.is_publish()) {
+        return publishing();
+    }
+    return playing();
+}
+
+srs_error_t SrsSrtConn::publishing()
+{
+    srs_error_t err = srs_success;
+    
+    SrsLocalPublisher* publisher = new SrsLocalPublisher(handler);
+    SrsAutoFree(SrsLocalPublisher, publisher);
+    
+    publisher->set_request(req);
+    publisher->set_client(_srs_context->get_id(), NULL);
+    
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish");
+    }
+    
+    SrsTsSourceBridge* bridge = new SrsTsSourceBridge();
+    SrsAutoFree(SrsTsSourceBridge, bridge);
+    bridge->set_publisher(publisher);
+    
+    err = do_publishing(bridge);
+    
+    // Publish the messages in the hold window.
+    srs_error_t r0 = bridge->flush(0);
+    srs_freep(r0);
+    
+    publisher->unpublish();
+    
+    return err;
+}
+
+srs_error_t SrsSrtConn::do_publishing(SrsTsSourceBridge* bridge)
+{
+    srs_error_t err = srs_success;
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_caster();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    char buf[SRS_SRT_MAX_PAYLOAD];
+    skt->set_recv_timeout(_srs_config->get_publish_1stpkt_timeout(req->vhost));
+    
+    for (int64_t nn_msgs = 0; true; nn_msgs++) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "srt publish");
+        }
+        
+        int nread = 0;
+        if ((err = skt->recvmsg(buf, sizeof(buf), &nread)) != srs_success) {
+            return srs_error_wrap(err, "recv");
+        }
+        
+        if (nn_msgs == 0) {
+            skt->set_recv_timeout(_srs_config->get_publish_normal_timeout(req->vhost));
+        }
+        
+        if ((err = bridge->on_data(buf, nread)) != srs_success) {
+            return srs_error_wrap(err, "demux");
+        }
+        
+        if ((err = bridge->flush(SRS_SRT_HOLD)) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("<- SRT publish %s, msgs=%" PRId64 ", recv=%" PRId64 ", queue=%d, %s", req->get_stream_url().c_str(),
+                nn_msgs, skt->get_recv_bytes(), bridge->nb_queued(), skt->summary().c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSrtConn::playing()
+{
+    srs_error_t err = srs_success;
+    
+    SrsSecurity security;
+    if ((err = security.check(SrsRtmpConnPlay, ip, req)) != srs_success) {
+        return srs_error_wrap(err, "security check");
+    }
+    
+    SrsSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, handler, &source)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+    
+    // All SRT players, like the HTTP-TS players, write the TS chunks shared by the muxer of source.
+    SrsTsSharedStream* shared = SrsTsSharedStream::fetch_or_create(source, req);
+    SrsLiveSharedPlayer player;
+    if ((err = player.attach(shared)) != srs_success) {
+        return srs_error_wrap(err, "start ts shared");
+    }
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(_srs_context->get_id(), req, NULL, SrsRtmpConnPlay)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_caster();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    int payload_size = _srs_config->get_srt_payload_size();
+    srs_utime_t mw_sleep = _srs_config->get_mw_sleep(req->vhost);
+    skt->set_send_timeout(_srs_config->get_srt_peer_idle_timeout());
+    
+    int64_t cursor = -1;
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            break;
+        }
+        
+        int count = 0;
+        shared->fetch(cursor, msgs.msgs, msgs.max, count);
+        if (count <= 0) {
+            srs_usleep(mw_sleep);
+            continue;
+        }
+        
+        // Send the TS packets in messages of payload size, each message is N*188 bytes.
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            for (int pos = 0; err == srs_success && pos < msg->size; pos += payload_size) {
+                err = skt->sendmsg(msg->payload + pos, srs_min(payload_size, msg->size - pos));
+            }
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            err = srs_error_wrap(err, "send");
+            break;
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print()) {
+            srs_trace("-> SRT play %s, send=%" PRId64 ", %s", req->get_stream_url().c_str(),
+                skt->get_send_bytes(), skt->summary().c_str());
+        }
+    }
+    
+    stat->on_disconnect(_srs_context->get_id());
+    
+    return err;
+}
+
+SrsSrtServer::SrsSrtServer(ISrsSourceHandler* h)
+{
+    handler = h;
+    poller = new SrsSrtPoller();
+    listener = NULL;
+    trd = new SrsSTCoroutine("srt-server", this);
+    manager = new SrsCoroutineManager();
+    
+    defaults.latency = 0;
+    defaults.tlpktdrop = true;
+}
+
+SrsSrtServer::~SrsSrtServer()
+{
+    srs_freep(trd);
+    
+    // The connection removes itself when freed, so free the swapped connections.
+    std::vector<SrsSrtConn*> copy;
+    copy.swap(conns);
+    
+    std::vector<SrsSrtConn*>::iterator it;
+    for (it = copy.begin(); it != copy.end(); ++it) {
+        SrsSrtConn* conn = *it;
+        srs_freep(conn);
+    }
+    
+    srs_freep(manager);
+    srs_freep(listener);
+    srs_freep(poller);
+    
+    srt_cleanup();
+}
+
+srs_error_t SrsSrtServer::listen(string ip, int port)
+{
+    srs_error_t err = srs_success;
+    
+    // Snapshot the options of vhosts, for the listen callback in the thread of SRT.
+    defaults.latency = _srs_config->get_srt_latency();
+    defaults.tlpktdrop = true;
+    default_app = _srs_config->get_srt_default_app();
+    
+    std::vector<SrsConfDirective*> vs;
+    _srs_config->get_vhosts(vs);
+    for (int i = 0; i < (int)vs.size(); i++) {
+        string vhost = vs.at(i)->arg0();
+        SrsSrtOptions& opts = vhosts[vhost];
+        opts.latency = _srs_config->get_vhost_srt_latency(vhost);
+        opts.tlpktdrop = _srs_config->get_vhost_srt_tlpktdrop(vhost);
+    }
+    
+    if (srt_startup() < 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "startup, %s", srt_getlasterror_str());
+    }
+    
+    if ((err = poller->initialize()) != srs_success) {
+        return srs_error_wrap(err, "poller");
+    }
+    
+    if ((err = manager->start()) != srs_success) {
+        return srs_error_wrap(err, "manager");
+    }
+    
+    SRTSOCKET fd = srt_create_socket();
+    if (fd == SRT_INVALID_SOCK) {
+        return srs_error_new(ERROR_SRT_SOCKET, "create socket, %s", srt_getlasterror_str());
+    }
+    listener = new SrsSrtSocket(poller, fd);
+    
+    // The options of listener are inherited by the accepted sockets.
+    SRT_TRANSTYPE tt = SRTT_LIVE;
+    int64_t maxbw = _srs_config->get_srt_maxbw();
+    int payload_size = _srs_config->get_srt_payload_size();
+    int peer_idle_timeout = srsu2msi(_srs_config->get_srt_peer_idle_timeout());
+    if (srt_setsockflag(fd, SRTO_TRANSTYPE, &tt, sizeof(tt)) != 0
+        || srt_setsockflag(fd, SRTO_LATENCY, &defaults.latency, sizeof(defaults.latency)) != 0
+        || srt_setsockflag(fd, SRTO_MAXBW, &maxbw, sizeof(maxbw)) != 0
+        || srt_setsockflag(fd, SRTO_PAYLOADSIZE, &payload_size, sizeof(payload_size)) != 0
+        || srt_setsockflag(fd, SRTO_PEERIDLETIMEO, &peer_idle_timeout, sizeof(peer_idle_timeout)) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "set options, %s", srt_getlasterror_str());
+    }
+    
+    if ((err = listener->initialize()) != srs_success) {
+        return srs_error_wrap(err, "listener");
+    }
+    
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_PASSIVE;
+    
+    addrinfo* r = NULL;
+    if (getaddrinfo(ip.c_str(), srs_int2str(port).c_str(), &hints, &r) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "getaddrinfo %s:%d", ip.c_str(), port);
+    }
+    
+    int r0 = srt_bind(fd, r->ai_addr, (int)r->ai_addrlen);
+    freeaddrinfo(r);
+    if (r0 != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "bind %s:%d, %s", ip.c_str(), port, srt_getlasterror_str());
+    }
+    
+    if (srt_listen_callback(fd, on_srt_listen, this) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "listen callback, %s", srt_getlasterror_str());
+    }
+    
+    if (srt_listen(fd, SRS_SRT_LISTEN_BACKLOG) != 0) {
+        return srs_error_new(ERROR_SRT_SOCKET, "listen %s:%d, %s", ip.c_str(), port, srt_getlasterror_str());
+    }
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start");
+    }
+    
+    srs_trace("SRT listen at udp://%s:%d, latency=%dms, maxbw=%" PRId64 ", payload=%d, vhosts=%d",
+        ip.c_str(), port, defaults.latency, maxbw, payload_size, (int)vhosts.size());
+    
+    return err;
+}
+
+int SrsSrtServer::on_srt_listen(void* opaque, SRTSOCKET ns, int hsversion, const struct sockaddr* peeraddr, const char* streamid)
+{
+    SrsSrtServer* server = (SrsSrtServer*)opaque;
+    return server->on_srt_client(ns, streamid);
+}
+
+int SrsSrtServer::on_srt_client(SRTSOCKET ns, const char* streamid)
+{
+    // @remark Never log or access the config here, because it's in the thread of SRT.
+    SrsSrtStreamId sid;
+    srs_error_t err = sid.parse(streamid? streamid : "", default_app);
+    if (err != srs_success) {
+        srs_freep(err);
+        return -1;
+    }
+    
+    SrsSrtOptions opts = defaults;
+    std::map<std::string, SrsSrtOptions>::iterator it = vhosts.find(sid.vhost);
+    if (it == vhosts.end()) {
+        it = vhosts.find(SRS_CONSTS_RTMP_DEFAULT_VHOST);
+    }
+    if (it != vhosts.end()) {
+        opts = it->second;
+    }
+    if (sid.latency > 0) {
+        opts.latency = sid.latency;
+    }
+    
+    if (srt_setsockflag(ns, SRTO_LATENCY, &opts.latency, sizeof(opts.latency)) != 0
+        || srt_setsockflag(ns, SRTO_TLPKTDROP, &opts.tlpktdrop, sizeof(opts.tlpktdrop)) != 0) {
+        return -1;
+    }
+    
+    return 0;
+}
+
+srs_error_t SrsSrtServer::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "srt server");
+        }
+        
+        SRTSOCKET fd = SRT_INVALID_SOCK;
+        string ip;
+        if ((err = listener->accept(&fd, ip)) != srs_success) {
+            return srs_error_wrap(err, "accept");
+        }
+        
+        SrsSrtSocket* skt = new SrsSrtSocket(poller, fd);
+        if ((err = skt->initialize()) != srs_success) {
+            srs_freep(skt);
+            srs_warn("ignore srt client %s, %s", ip.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            continue;
+        }
+        
+        SrsSrtConn* conn = new SrsSrtConn(this, handler, skt, ip);
+        conns.push_back(conn);
+        
+        if ((err = conn->start()) != srs_success) {
+            return srs_error_wrap(err, "start srt client");
+        }
+    }
+    
+    return err;
+}
+
+void SrsSrtServer::remove(ISrsConnection* c)
+{
+    SrsSrtConn* conn = dynamic_cast<SrsSrtConn*>(c);
+    
+    // Ignore the connection freed by server, when dispose.
+    std::vector<SrsSrtConn*>::iterator it = std::find(conns.begin(), conns.end(), conn);
+    if (it == conns.end()) {
+        return;
+    }
+    conns.erase(it);
+    
+    manager->remove(c);
+}
+
+#endif
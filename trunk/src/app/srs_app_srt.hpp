@@ -0,0 +1,214 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_SRT_HPP
+#define SRS_APP_SRT_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+class SrsRequest;
+
+// The streamid of SRT client, to identify the stream to publish or play, in the access control syntax:
+//      #!::h=vhost,r=app/stream,m=publish,latency=300
+// or the simple syntax of url path:
+//      app/stream?vhost=vhost&m=publish&latency=300
+// @see https://github.com/Haivision/srt/blob/master/docs/features/access-control.md
+class SrsSrtStreamId
+{
+public:
+    std::string vhost;
+    std::string app;
+    std::string stream;
+    // The other params, for example, the token for http hooks, in the format of ?k=v&k=v
+    std::string param;
+    // The mode is publish or request(play).
+    std::string mode;
+    // The latency in ms of stream, 0 to use the config.
+    int latency;
+public:
+    SrsSrtStreamId();
+    virtual ~SrsSrtStreamId();
+public:
+    // Parse the streamid, where the default_app is used for stream without app.
+    virtual srs_error_t parse(std::string sid, std::string default_app);
+    virtual bool is_publish();
+    // Create the request of stream, from the client ip.
+    virtual SrsRequest* to_request(std::string ip);
+};
+
+#ifdef SRS_AUTO_SRT
+
+#include <map>
+#include <vector>
+
+#include <srt/srt.h>
+
+#include <srs_app_st.hpp>
+#include <srs_service_conn.hpp>
+
+class SrsSrtServer;
+class SrsSrtSocket;
+class SrsLocalPublisher;
+class SrsTsSourceBridge;
+class ISrsSourceHandler;
+class SrsCoroutineManager;
+
+// The poller of SRT sockets, to integrate SRT with ST by the epoll of SRT.
+// Because the SRT socket is not a fd of system, it polls all sockets by a coroutine, and
+// notifies the coroutines of socket waiting for the event.
+class SrsSrtPoller : public ISrsCoroutineHandler
+{
+private:
+    int srt_epoller;
+    SrsCoroutine* trd;
+    std::map<SRTSOCKET, SrsSrtSocket*> sockets;
+    std::vector<SRT_EPOLL_EVENT> events;
+public:
+    SrsSrtPoller();
+    virtual ~SrsSrtPoller();
+public:
+    virtual srs_error_t initialize();
+    // Add the socket to poll, for the edge triggered event of IN, OUT and ERR.
+    virtual srs_error_t add(SrsSrtSocket* skt);
+    virtual void remove(SrsSrtSocket* skt);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+// The SRT socket in non-blocking mode, which reads or writes like the ST socket,
+// that is, the coroutine waits for the event notified by poller.
+class SrsSrtSocket
+{
+private:
+    SRTSOCKET srtfd;
+    SrsSrtPoller* poller;
+    srs_cond_t read_cond;
+    srs_cond_t write_cond;
+    // Whether the socket is broken, notified by the ERR event.
+    bool broken;
+    srs_utime_t rtm;
+    srs_utime_t stm;
+    int64_t rbytes;
+    int64_t sbytes;
+public:
+    // The socket is owned and closed by this object.
+    SrsSrtSocket(SrsSrtPoller* p, SRTSOCKET fd);
+    virtual ~SrsSrtSocket();
+public:
+    virtual srs_error_t initialize();
+    virtual SRTSOCKET fd();
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void set_send_timeout(srs_utime_t tm);
+    virtual int64_t get_recv_bytes();
+    virtual int64_t get_send_bytes();
+public:
+    // Accept a client, for the listen socket.
+    virtual srs_error_t accept(SRTSOCKET* pfd, std::string& ip);
+    // Receive a message, which is N*188 bytes TS packets.
+    virtual srs_error_t recvmsg(char* buf, int size, int* nread);
+    // Send a message, which is at most the payload size.
+    virtual srs_error_t sendmsg(char* buf, int size);
+    // Get the stat of link, such as the lost and retransmitted packets.
+    virtual std::string summary();
+public:
+    // Notify the events by poller.
+    virtual void notify(int events);
+private:
+    virtual srs_error_t wait(srs_cond_t cond, srs_utime_t tm);
+};
+
+// The SRT client, to publish MPEG-TS to source, or play the shared TS stream of source.
+class SrsSrtConn : virtual public ISrsConnection, virtual public ISrsCoroutineHandler
+{
+private:
+    SrsSrtServer* server;
+    ISrsSourceHandler* handler;
+    SrsSrtSocket* skt;
+    SrsCoroutine* trd;
+    std::string ip;
+    SrsRequest* req;
+public:
+    SrsSrtConn(SrsSrtServer* s, ISrsSourceHandler* h, SrsSrtSocket* c, std::string cip);
+    virtual ~SrsSrtConn();
+public:
+    virtual srs_error_t start();
+// Interface ISrsConnection.
+public:
+    virtual std::string remote_ip();
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t publishing();
+    virtual srs_error_t do_publishing(SrsTsSourceBridge* bridge);
+    virtual srs_error_t playing();
+};
+
+// The options of SRT link, which are negotiated in handshake.
+struct SrsSrtOptions
+{
+    int latency;
+    bool tlpktdrop;
+};
+
+// The SRT server, to listen and accept the SRT clients.
+class SrsSrtServer : virtual public ISrsCoroutineHandler, virtual public IConnectionManager
+{
+private:
+    ISrsSourceHandler* handler;
+    SrsSrtPoller* poller;
+    SrsSrtSocket* listener;
+    SrsCoroutine* trd;
+    SrsCoroutineManager* manager;
+    std::vector<SrsSrtConn*> conns;
+private:
+    // The options of vhosts, key is the vhost. Because the listen callback is called by the
+    // thread of SRT, it's a snapshot of config when listen, which is read only.
+    std::map<std::string, SrsSrtOptions> vhosts;
+    SrsSrtOptions defaults;
+    std::string default_app;
+public:
+    SrsSrtServer(ISrsSourceHandler* h);
+    virtual ~SrsSrtServer();
+public:
+    // Listen at the port, and start to accept clients.
+    virtual srs_error_t listen(std::string ip, int port);
+private:
+    // Apply the options of stream before handshake, by the streamid, in the thread of SRT.
+    static int on_srt_listen(void* opaque, SRTSOCKET ns, int hsversion, const struct sockaddr* peeraddr, const char* streamid);
+    virtual int on_srt_client(SRTSOCKET ns, const char* streamid);
+// Interface ISrsCoroutineHandler.
+public:
+    virtual srs_error_t cycle();
+// Interface IConnectionManager.
+public:
+    virtual void remove(ISrsConnection* c);
+};
+
+#endif
+
+#endif
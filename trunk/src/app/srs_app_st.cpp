@@ -24,13 +24,31 @@
 #include <srs_app_st.hpp>
 
 #include <st.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <ucontext.h>
+#include <cxxabi.h>
+#include <stdlib.h>
 #include <string>
+#include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_recorder.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_log.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_service_log.hpp>
+
+// The default stack size of ST, @see ST_DEFAULT_STACK_SIZE of st/common.h
+#define SRS_ST_DEFAULT_STACK_SIZE (64 * 1024)
 
 ISrsCoroutineHandler::ISrsCoroutineHandler()
 {
@@ -79,6 +97,20 @@ int SrsDummyCoroutine::cid()
     return 0;
 }
 
+// The number of alive coroutines of high priority, and the yields of players.
+static int _srs_nn_highs = 0;
+static int64_t _srs_nn_yields = 0;
+
+int srs_coroutine_nb_highs()
+{
+    return _srs_nn_highs;
+}
+
+int64_t srs_coroutine_nb_yields()
+{
+    return _srs_nn_yields;
+}
+
 _ST_THREAD_CREATE_PFN _pfn_st_thread_create = (_ST_THREAD_CREATE_PFN)st_thread_create;
 
 SrsSTCoroutine::SrsSTCoroutine(string n, ISrsCoroutineHandler* h, int cid)
@@ -89,6 +121,10 @@ SrsSTCoroutine::SrsSTCoroutine(string n, ISrsCoroutineHandler* h, int cid)
     trd = NULL;
     trd_err = srs_success;
     started = interrupted = disposed = cycle_done = false;
+    running = false;
+    priority = SrsCoroutinePriorityNormal;
+    stack_size = 0;
+    stack_top = NULL;
 }
 
 SrsSTCoroutine::~SrsSTCoroutine()
@@ -116,7 +152,7 @@ srs_error_t SrsSTCoroutine::start()
         return err;
     }
     
-    if ((trd = (srs_thread_t)_pfn_st_thread_create(pfn, this, 1, 0)) == NULL) {
+    if ((trd = (srs_thread_t)_pfn_st_thread_create(pfn, this, 1, stack_size)) == NULL) {
         err = srs_error_new(ERROR_ST_CREATE_CYCLE_THREAD, "create failed");
         
         srs_freep(trd_err);
@@ -185,6 +221,64 @@ int SrsSTCoroutine::cid()
     return context;
 }
 
+void SrsSTCoroutine::set_stack_size(int v)
+{
+    stack_size = v;
+}
+
+int SrsSTCoroutine::get_stack_size()
+{
+    int page = (int)sysconf(_SC_PAGESIZE);
+    int size = stack_size? stack_size : SRS_ST_DEFAULT_STACK_SIZE;
+    return (size + page - 1) / page * page;
+}
+
+int SrsSTCoroutine::stack_resident()
+{
+    if (!stack_top) {
+        return 0;
+    }
+    
+    int page = (int)sysconf(_SC_PAGESIZE);
+    int size = get_stack_size();
+    int nn_pages = size / page;
+    
+    // Check the pages from the bottom, the first resident page is the high-water, because
+    // the stack grows down and the pages under it are never touched.
+    unsigned char vec[256];
+    char* bottom = stack_top - size;
+    for (int i = 0; i < nn_pages; i += (int)sizeof(vec)) {
+        int nn = srs_min(nn_pages - i, (int)sizeof(vec));
+#ifndef SRS_AUTO_OSX
+        if (mincore(bottom + i * page, nn * page, vec) != 0) {
+#else
+        if (mincore(bottom + i * page, nn * page, (char*)vec) != 0) {
+#endif
+            return 0;
+        }
+        for (int j = 0; j < nn; j++) {
+            if (vec[j] & 0x01) {
+                return size - (i + j) * page;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+void SrsSTCoroutine::set_priority(SrsCoroutinePriority v)
+{
+    if (running && priority != v) {
+        _srs_nn_highs += (v == SrsCoroutinePriorityHigh)? 1 : -1;
+    }
+    priority = v;
+}
+
+SrsCoroutinePriority SrsSTCoroutine::get_priority()
+{
+    return priority;
+}
+
 srs_error_t SrsSTCoroutine::cycle()
 {
     if (_srs_context) {
@@ -195,7 +289,10 @@ srs_error_t SrsSTCoroutine::cycle()
         }
     }
     
+    SrsSchedulerStats::instance()->on_start(name, context);
     srs_error_t err = handler->cycle();
+    SrsSchedulerStats::instance()->on_stop();
+    
     if (err != srs_success) {
         return srs_error_wrap(err, "coroutine cycle");
     }
@@ -209,8 +306,25 @@ srs_error_t SrsSTCoroutine::cycle()
 void* SrsSTCoroutine::pfn(void* arg)
 {
     SrsSTCoroutine* p = (SrsSTCoroutine*)arg;
+    
+    // The thread object of ST is at the top of stack, so we are at the top page of stack.
+    int page = (int)sysconf(_SC_PAGESIZE);
+    p->stack_top = (char*)(((uint64_t)&p + page - 1) / page * page);
+    SrsStackStats::instance()->on_start(p->name, p);
 
+    p->running = true;
+    if (p->priority == SrsCoroutinePriorityHigh) {
+        _srs_nn_highs++;
+    }
+    
     srs_error_t err = p->cycle();
+    
+    if (p->priority == SrsCoroutinePriorityHigh) {
+        _srs_nn_highs--;
+    }
+    p->running = false;
+    
+    SrsStackStats::instance()->on_stop(p->name, p);
 
     // Set the err for function pull to fetch it.
     // @see https://github.com/ossrs/srs/pull/1304#issuecomment-480484151
@@ -223,3 +337,877 @@ void* SrsSTCoroutine::pfn(void* arg)
     return (void*)err;
 }
 
+
+SrsCoroutineSlice::SrsCoroutineSlice(int64_t v)
+{
+    budget = v;
+    used = 0;
+}
+
+SrsCoroutineSlice::~SrsCoroutineSlice()
+{
+}
+
+bool SrsCoroutineSlice::consume(int64_t nbytes)
+{
+    if (budget <= 0) {
+        return false;
+    }
+    
+    used += nbytes;
+    if (used < budget) {
+        return false;
+    }
+    used = 0;
+    
+    // Never yield when no publisher, to avoid the useless switch.
+    if (_srs_nn_highs <= 0) {
+        return false;
+    }
+    
+    // Ignore the interrupt, which is checked by the pull of player.
+    _srs_nn_yields++;
+    srs_usleep(0);
+    
+    return true;
+}
+
+SrsStackStats* SrsStackStats::_instance = NULL;
+
+SrsStackStats::SrsStackStats()
+{
+}
+
+SrsStackStats::~SrsStackStats()
+{
+    std::map<std::string, SrsStackStat*>::iterator it;
+    for (it = roles.begin(); it != roles.end(); ++it) {
+        SrsStackStat* stat = it->second;
+        srs_freep(stat);
+    }
+    roles.clear();
+}
+
+SrsStackStats* SrsStackStats::instance()
+{
+    if (!_instance) {
+        _instance = new SrsStackStats();
+    }
+    return _instance;
+}
+
+void SrsStackStats::on_start(string role, SrsSTCoroutine* trd)
+{
+    SrsStackStat* stat = fetch(role);
+    
+    stat->size = trd->get_stack_size();
+    stat->nn_total++;
+    stat->alives.insert(trd);
+}
+
+void SrsStackStats::on_stop(string role, SrsSTCoroutine* trd)
+{
+    SrsStackStat* stat = fetch(role);
+    
+    stat->high_water = srs_max(stat->high_water, trd->stack_resident());
+    stat->alives.erase(trd);
+}
+
+srs_error_t SrsStackStats::dumps(SrsJsonObject* obj)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonArray* arr = SrsJsonAny::array();
+    obj->set("stacks", arr);
+    
+    std::map<std::string, SrsStackStat*>::iterator it;
+    for (it = roles.begin(); it != roles.end(); ++it) {
+        SrsStackStat* stat = it->second;
+        
+        // Update the high-water by the alive coroutines.
+        int64_t resident = 0;
+        std::set<SrsSTCoroutine*>::iterator it2;
+        for (it2 = stat->alives.begin(); it2 != stat->alives.end(); ++it2) {
+            int v = (*it2)->stack_resident();
+            stat->high_water = srs_max(stat->high_water, v);
+            resident += v;
+        }
+        
+        SrsJsonObject* role = SrsJsonAny::object();
+        arr->append(role);
+        
+        role->set("role", SrsJsonAny::str(it->first.c_str()));
+        role->set("size", SrsJsonAny::integer(stat->size));
+        role->set("alive", SrsJsonAny::integer((int64_t)stat->alives.size()));
+        role->set("total", SrsJsonAny::integer(stat->nn_total));
+        role->set("resident", SrsJsonAny::integer(resident));
+        role->set("high_water", SrsJsonAny::integer(stat->high_water));
+    }
+    
+    return err;
+}
+
+void SrsStackStats::memory(int64_t& alive, int64_t& reserved, int64_t& resident)
+{
+    alive = reserved = resident = 0;
+    
+    std::map<std::string, SrsStackStat*>::iterator it;
+    for (it = roles.begin(); it != roles.end(); ++it) {
+        SrsStackStat* stat = it->second;
+        
+        std::set<SrsSTCoroutine*>::iterator it2;
+        for (it2 = stat->alives.begin(); it2 != stat->alives.end(); ++it2) {
+            SrsSTCoroutine* trd = *it2;
+            alive++;
+            reserved += trd->get_stack_size();
+            resident += trd->stack_resident();
+        }
+    }
+}
+
+SrsStackStat* SrsStackStats::fetch(string role)
+{
+    std::map<std::string, SrsStackStat*>::iterator it = roles.find(role);
+    if (it != roles.end()) {
+        return it->second;
+    }
+    
+    SrsStackStat* stat = new SrsStackStat();
+    stat->size = 0;
+    stat->nn_total = 0;
+    stat->high_water = 0;
+    roles[role] = stat;
+    
+    return stat;
+}
+
+// The upper bounds of buckets of the delay of run queue, the last bucket is for the others.
+static srs_utime_t _srs_sched_delay_bounds[SRS_SCHED_DELAY_BUCKETS - 1] = {
+    100, 1 * SRS_UTIME_MILLISECONDS, 5 * SRS_UTIME_MILLISECONDS, 10 * SRS_UTIME_MILLISECONDS,
+    50 * SRS_UTIME_MILLISECONDS, 100 * SRS_UTIME_MILLISECONDS, 500 * SRS_UTIME_MILLISECONDS,
+};
+
+static bool srs_coroutine_profile_cpu_greater(SrsCoroutineProfile* a, SrsCoroutineProfile* b)
+{
+    return a->cpu > b->cpu;
+}
+
+const char* srs_cpu_type2str(SrsCpuType type)
+{
+    switch (type) {
+        case SrsCpuDispatch: return "dispatch";
+        case SrsCpuHls: return "hls";
+        case SrsCpuDash: return "dash";
+        case SrsCpuDvr: return "dvr";
+        case SrsCpuSend: return "send";
+        default: return "unknown";
+    }
+}
+
+int64_t srs_cpu_cycles()
+{
+#if defined(__x86_64__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (int64_t)(((uint64_t)hi << 32) | lo);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+SrsCpuStat::SrsCpuStat()
+{
+    for (int i = 0; i < SrsCpuTypeMax; i++) {
+        cycles[i] = rates[i] = sampled[i] = 0;
+    }
+    sample_at = 0;
+}
+
+SrsCpuStat::~SrsCpuStat()
+{
+}
+
+void SrsCpuStat::sample(srs_utime_t now)
+{
+    srs_utime_t elapsed = now - sample_at;
+    if (sample_at > 0 && elapsed <= 0) {
+        return;
+    }
+    
+    for (int i = 0; i < SrsCpuTypeMax; i++) {
+        rates[i] = sample_at? (cycles[i] - sampled[i]) * SRS_UTIME_SECONDS / elapsed : 0;
+        sampled[i] = cycles[i];
+    }
+    sample_at = now;
+}
+
+int64_t SrsCpuStat::total_rate()
+{
+    int64_t v = 0;
+    for (int i = 0; i < SrsCpuTypeMax; i++) {
+        v += rates[i];
+    }
+    return v;
+}
+
+// The current account of the running coroutine, and the cycles when it starts.
+static SrsCpuStat* _srs_cpu_stat = NULL;
+static SrsCpuType _srs_cpu_type = SrsCpuDispatch;
+static int64_t _srs_cpu_start = 0;
+
+SrsCpuScope::SrsCpuScope(SrsCpuStat* stat, SrsCpuType type)
+{
+    parent_stat = _srs_cpu_stat;
+    parent_type = _srs_cpu_type;
+    
+    if (stat) {
+        account(stat, type);
+    }
+}
+
+SrsCpuScope::~SrsCpuScope()
+{
+    account(parent_stat, parent_type);
+}
+
+void SrsCpuScope::switch_to(SrsCpuType type)
+{
+    if (_srs_cpu_stat) {
+        account(_srs_cpu_stat, type);
+    }
+}
+
+void SrsCpuScope::on_switch_out()
+{
+    account(NULL, SrsCpuDispatch);
+}
+
+void SrsCpuScope::account(SrsCpuStat* stat, SrsCpuType type)
+{
+    int64_t now = (stat || _srs_cpu_stat)? srs_cpu_cycles() : 0;
+    
+    if (_srs_cpu_stat) {
+        _srs_cpu_stat->cycles[_srs_cpu_type] += now - _srs_cpu_start;
+    }
+    
+    _srs_cpu_stat = stat;
+    _srs_cpu_type = type;
+    _srs_cpu_start = now;
+}
+
+SrsSchedulerStats* SrsSchedulerStats::_instance = NULL;
+
+SrsSchedulerStats::SrsSchedulerStats()
+{
+    enabled = false;
+    key = -1;
+    last = 0;
+    nn_switches = 0;
+    others = 0;
+    
+    memset(delays, 0, sizeof(delays));
+    nn_delays = 0;
+    delay_sum = max_delay = 0;
+}
+
+SrsSchedulerStats::~SrsSchedulerStats()
+{
+    std::set<SrsCoroutineProfile*>::iterator it;
+    for (it = alives.begin(); it != alives.end(); ++it) {
+        SrsCoroutineProfile* profile = *it;
+        srs_freep(profile);
+    }
+    alives.clear();
+    
+    std::map<std::string, SrsCoroutineRoleProfile*>::iterator it2;
+    for (it2 = roles.begin(); it2 != roles.end(); ++it2) {
+        SrsCoroutineRoleProfile* role = it2->second;
+        srs_freep(role);
+    }
+    roles.clear();
+}
+
+SrsSchedulerStats* SrsSchedulerStats::instance()
+{
+    if (!_instance) {
+        _instance = new SrsSchedulerStats();
+    }
+    return _instance;
+}
+
+srs_error_t SrsSchedulerStats::initialize(bool v)
+{
+    srs_error_t err = srs_success;
+    
+    // Always stop the CPU accounting of streams when coroutine switches out.
+    st_set_switch_in_cb(SrsSchedulerStats::switch_in);
+    st_set_switch_out_cb(SrsSchedulerStats::switch_out);
+    
+    if (!v || enabled) {
+        return err;
+    }
+    
+    if (st_key_create(&key, NULL) != 0) {
+        return srs_error_new(ERROR_ST_INITIALIZE, "create key");
+    }
+    
+    st_set_runq_stamp(1);
+    
+    enabled = true;
+    last = srs_update_monotonic_time();
+    srs_trace("scheduler: enable profile, key=%d", key);
+    
+    return err;
+}
+
+void SrsSchedulerStats::on_start(string role, int cid)
+{
+    if (!enabled) {
+        return;
+    }
+    
+    SrsCoroutineProfile* profile = new SrsCoroutineProfile();
+    profile->role = role;
+    profile->cid = cid;
+    profile->cpu = 0;
+    profile->nn_switches = 0;
+    profile->max_slice = 0;
+    
+    alives.insert(profile);
+    st_thread_setspecific(key, profile);
+    
+    SrsCoroutineRoleProfile* stat = fetch(role);
+    stat->nn_total++;
+    stat->alive++;
+}
+
+void SrsSchedulerStats::on_stop()
+{
+    if (!enabled) {
+        return;
+    }
+    
+    SrsCoroutineProfile* profile = (SrsCoroutineProfile*)st_thread_getspecific(key);
+    if (!profile) {
+        return;
+    }
+    
+    // Account the current slice, for the coroutine never switches out after stopped.
+    srs_utime_t now = srs_update_monotonic_time();
+    if (last > 0 && now > last) {
+        profile->cpu += now - last;
+    }
+    last = now;
+    
+    SrsCoroutineRoleProfile* stat = fetch(profile->role);
+    stat->alive--;
+    stat->cpu += profile->cpu;
+    stat->nn_switches += profile->nn_switches;
+    
+    st_thread_setspecific(key, NULL);
+    alives.erase(profile);
+    srs_freep(profile);
+}
+
+srs_error_t SrsSchedulerStats::dumps(SrsJsonObject* obj)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonObject* sched = SrsJsonAny::object();
+    obj->set("scheduler", sched);
+    
+    sched->set("enabled", SrsJsonAny::boolean(enabled));
+    sched->set("switches", SrsJsonAny::integer(nn_switches));
+    sched->set("others_ms", SrsJsonAny::integer(srsu2ms(others)));
+    sched->set("highs", SrsJsonAny::integer(_srs_nn_highs));
+    sched->set("yields", SrsJsonAny::integer(_srs_nn_yields));
+    
+    SrsJsonObject* runq = SrsJsonAny::object();
+    sched->set("runq", runq);
+    
+    runq->set("count", SrsJsonAny::integer(nn_delays));
+    runq->set("avg_us", SrsJsonAny::integer(nn_delays? delay_sum / nn_delays : 0));
+    runq->set("max_us", SrsJsonAny::integer(max_delay));
+    
+    SrsJsonArray* buckets = SrsJsonAny::array();
+    runq->set("buckets", buckets);
+    for (int i = 0; i < SRS_SCHED_DELAY_BUCKETS; i++) {
+        SrsJsonObject* bucket = SrsJsonAny::object();
+        buckets->append(bucket);
+        
+        bucket->set("le_us", SrsJsonAny::integer(i < SRS_SCHED_DELAY_BUCKETS - 1? _srs_sched_delay_bounds[i] : -1));
+        bucket->set("count", SrsJsonAny::integer(delays[i]));
+    }
+    
+    srs_utime_t now = srs_get_monotonic_time();
+    SrsJsonArray* arr = SrsJsonAny::array();
+    sched->set("slices", arr);
+    for (int i = 0; i < (int)slices.size(); i++) {
+        SrsSchedulerSlice& slice = slices.at(i);
+        
+        SrsJsonObject* item = SrsJsonAny::object();
+        arr->append(item);
+        
+        item->set("duration_us", SrsJsonAny::integer(slice.duration));
+        item->set("cid", SrsJsonAny::integer(slice.cid));
+        item->set("role", SrsJsonAny::str(slice.role.c_str()));
+        item->set("ago_ms", SrsJsonAny::integer(srsu2ms(now - slice.at)));
+    }
+    
+    // The alive coroutines, to get the cpu of roles and the top coroutines.
+    std::vector<SrsCoroutineProfile*> profiles(alives.begin(), alives.end());
+    std::map<std::string, SrsCoroutineRoleProfile> actives;
+    for (int i = 0; i < (int)profiles.size(); i++) {
+        SrsCoroutineProfile* profile = profiles.at(i);
+        SrsCoroutineRoleProfile& active = actives[profile->role];
+        active.cpu += profile->cpu;
+        active.nn_switches += profile->nn_switches;
+    }
+    
+    arr = SrsJsonAny::array();
+    sched->set("roles", arr);
+    std::map<std::string, SrsCoroutineRoleProfile*>::iterator it;
+    for (it = roles.begin(); it != roles.end(); ++it) {
+        SrsCoroutineRoleProfile* stat = it->second;
+        SrsCoroutineRoleProfile& active = actives[it->first];
+        
+        SrsJsonObject* role = SrsJsonAny::object();
+        arr->append(role);
+        
+        role->set("role", SrsJsonAny::str(it->first.c_str()));
+        role->set("alive", SrsJsonAny::integer(stat->alive));
+        role->set("total", SrsJsonAny::integer(stat->nn_total));
+        role->set("cpu_ms", SrsJsonAny::integer(srsu2ms(stat->cpu + active.cpu)));
+        role->set("switches", SrsJsonAny::integer(stat->nn_switches + active.nn_switches));
+    }
+    
+    int nn = srs_min(SRS_SCHED_TOP_COROUTINES, (int)profiles.size());
+    std::partial_sort(profiles.begin(), profiles.begin() + nn, profiles.end(), srs_coroutine_profile_cpu_greater);
+    
+    arr = SrsJsonAny::array();
+    sched->set("coroutines", arr);
+    for (int i = 0; i < nn; i++) {
+        SrsCoroutineProfile* profile = profiles.at(i);
+        
+        SrsJsonObject* item = SrsJsonAny::object();
+        arr->append(item);
+        
+        item->set("cid", SrsJsonAny::integer(profile->cid));
+        item->set("role", SrsJsonAny::str(profile->role.c_str()));
+        item->set("cpu_ms", SrsJsonAny::integer(srsu2ms(profile->cpu)));
+        item->set("switches", SrsJsonAny::integer(profile->nn_switches));
+        item->set("max_slice_us", SrsJsonAny::integer(profile->max_slice));
+    }
+    
+    return err;
+}
+
+void SrsSchedulerStats::on_switch_in(srs_utime_t now, srs_utime_t runq_at)
+{
+    last = now;
+    nn_switches++;
+    
+    if (runq_at > 0 && now >= runq_at) {
+        srs_utime_t delay = now - runq_at;
+        
+        int i = 0;
+        while (i < SRS_SCHED_DELAY_BUCKETS - 1 && delay >= _srs_sched_delay_bounds[i]) {
+            i++;
+        }
+        delays[i]++;
+        
+        nn_delays++;
+        delay_sum += delay;
+        max_delay = srs_max(max_delay, delay);
+    }
+    
+    SrsCoroutineProfile* profile = (SrsCoroutineProfile*)st_thread_getspecific(key);
+    if (profile) {
+        profile->nn_switches++;
+    }
+}
+
+void SrsSchedulerStats::on_switch_out(srs_utime_t now)
+{
+    if (last <= 0 || now < last) {
+        return;
+    }
+    
+    srs_utime_t slice = now - last;
+    last = now;
+    
+    SrsCoroutineProfile* profile = (SrsCoroutineProfile*)st_thread_getspecific(key);
+    if (profile) {
+        profile->cpu += slice;
+        profile->max_slice = srs_max(profile->max_slice, slice);
+    } else {
+        others += slice;
+    }
+    
+    if ((int)slices.size() < SRS_SCHED_SLOW_SLICES || slice > slices.back().duration) {
+        on_slow_slice(slice, profile? profile->role : "others", now);
+    }
+    
+    if (slice >= _srs_recorder->threshold()) {
+        _srs_recorder->record(SrsRecorderEventSlice, slice, 0);
+    }
+}
+
+void SrsSchedulerStats::switch_in()
+{
+    SrsSchedulerStats* stats = SrsSchedulerStats::instance();
+    if (stats->enabled) {
+        stats->on_switch_in(srs_update_monotonic_time(), st_thread_runq_at(st_thread_self()));
+    }
+}
+
+void SrsSchedulerStats::switch_out()
+{
+    SrsCpuScope::on_switch_out();
+    
+    SrsSchedulerStats* stats = SrsSchedulerStats::instance();
+    if (stats->enabled) {
+        stats->on_switch_out(srs_update_monotonic_time());
+    }
+}
+
+void SrsSchedulerStats::on_slow_slice(srs_utime_t duration, string role, srs_utime_t now)
+{
+    SrsSchedulerSlice slice;
+    slice.duration = duration;
+    slice.cid = _srs_context? _srs_context->get_id() : 0;
+    slice.role = role;
+    slice.at = now;
+    
+    // Insert to the sorted slices, and remove the shortest one if exceed.
+    std::vector<SrsSchedulerSlice>::iterator it = slices.begin();
+    while (it != slices.end() && it->duration >= duration) {
+        ++it;
+    }
+    slices.insert(it, slice);
+    
+    if ((int)slices.size() > SRS_SCHED_SLOW_SLICES) {
+        slices.pop_back();
+    }
+}
+
+SrsCoroutineRoleProfile* SrsSchedulerStats::fetch(string role)
+{
+    std::map<std::string, SrsCoroutineRoleProfile*>::iterator it = roles.find(role);
+    if (it != roles.end()) {
+        return it->second;
+    }
+    
+    SrsCoroutineRoleProfile* stat = new SrsCoroutineRoleProfile();
+    stat->nn_total = 0;
+    stat->alive = 0;
+    stat->cpu = 0;
+    stat->nn_switches = 0;
+    roles[role] = stat;
+    
+    return stat;
+}
+
+SrsCpuProfiler* SrsCpuProfiler::_instance = NULL;
+
+SrsCpuProfiler::SrsCpuProfiler()
+{
+    running = false;
+    hz = 0;
+    tid = pthread_self();
+    samples = NULL;
+    nn_samples = nn_drops = nn_others = 0;
+    stack_bottom = stack_top = NULL;
+}
+
+SrsCpuProfiler::~SrsCpuProfiler()
+{
+    stop();
+    srs_freepa(samples);
+}
+
+SrsCpuProfiler* SrsCpuProfiler::instance()
+{
+    if (!_instance) {
+        _instance = new SrsCpuProfiler();
+    }
+    return _instance;
+}
+
+srs_error_t SrsCpuProfiler::start(int v)
+{
+    srs_error_t err = srs_success;
+
+#ifdef SRS_AUTO_GPERF_CP
+    return srs_error_new(ERROR_SYSTEM_PROFILE, "conflict with gperf cpu profile");
+#endif
+#if !defined(__linux__) || (!defined(__x86_64__) && !defined(__aarch64__))
+    return srs_error_new(ERROR_SYSTEM_PROFILE, "only for linux x86_64 or aarch64");
+#endif
+
+    if (running) {
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "profile is running");
+    }
+    if (v <= 0 || v > 1000) {
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "invalid hz=%d", v);
+    }
+
+    if (!samples) {
+        samples = new SrsCpuSample[SRS_PROFILE_TABLE_SIZE];
+    }
+    memset(samples, 0, sizeof(SrsCpuSample) * SRS_PROFILE_TABLE_SIZE);
+    nn_samples = nn_drops = nn_others = 0;
+    hz = v;
+    tid = pthread_self();
+
+#ifdef __linux__
+    // The stack of primordial thread, which is not allocated by ST.
+    pthread_attr_t attr;
+    if (pthread_getattr_np(tid, &attr) != 0) {
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "get attr");
+    }
+
+    void* addr = NULL;
+    size_t size = 0;
+    int r0 = pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    if (r0 != 0) {
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "get stack");
+    }
+    stack_bottom = (char*)addr;
+    stack_top = (char*)addr + size;
+#endif
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = SrsCpuProfiler::on_signal;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) < 0) {
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "sigaction");
+    }
+
+    running = true;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = (1000000 / hz) / 1000000;
+    timer.it_interval.tv_usec = (1000000 / hz) % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) < 0) {
+        stop();
+        return srs_error_new(ERROR_SYSTEM_PROFILE, "setitimer hz=%d", hz);
+    }
+
+    srs_trace("cpu profile start, hz=%d", hz);
+
+    return err;
+}
+
+void SrsCpuProfiler::stop()
+{
+    if (!running) {
+        return;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    // Ignore the signal which is pending, because the default action of SIGPROF terminates the process.
+    signal(SIGPROF, SIG_IGN);
+    running = false;
+
+    srs_trace("cpu profile stop, hz=%d, samples=%" PRId64 ", drops=%" PRId64 ", others=%" PRId64,
+        hz, nn_samples, nn_drops, nn_others);
+}
+
+bool SrsCpuProfiler::is_running()
+{
+    return running;
+}
+
+int64_t SrsCpuProfiler::nb_samples()
+{
+    return nn_samples;
+}
+
+// Resolve the symbol of address, for example, SrsServer::cycle()
+static string srs_profile_symbol(void* addr)
+{
+    char** symbols = backtrace_symbols(&addr, 1);
+    string symbol = (symbols && symbols[0])? symbols[0] : "";
+    free(symbols);
+
+    // The symbol is like ./objs/srs(_ZN9SrsServer5cycleEv+0x1a) [0x4a2b3c]
+    size_t start = symbol.find('(');
+    size_t end = symbol.find_first_of("+)", start);
+    if (start != string::npos && end != string::npos && end > start + 1) {
+        string name = symbol.substr(start + 1, end - start - 1);
+
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name.c_str(), NULL, NULL, &status);
+        if (demangled && status == 0) {
+            name = demangled;
+        }
+        free(demangled);
+        return name;
+    }
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%p", addr);
+    return buf;
+}
+
+std::string SrsCpuProfiler::dumps()
+{
+    // Never dumps when running, because the table is changed by signal handler.
+    if (running || !samples) {
+        return "";
+    }
+
+    SrsThreadContext* ctx = dynamic_cast<SrsThreadContext*>(_srs_context);
+
+    std::map<void*, std::string> symbols;
+    std::stringstream ss;
+
+    for (int i = 0; i < SRS_PROFILE_TABLE_SIZE; i++) {
+        SrsCpuSample* p = &samples[i];
+        if (!p->count) {
+            continue;
+        }
+
+        // The coroutine is the root frame, use the id of context if it's still alive.
+        int cid = ctx? ctx->find_id(p->thread) : 0;
+        if (cid) {
+            ss << "coroutine-" << cid;
+        } else {
+            ss << "st-" << p->thread;
+        }
+
+        // The frames is from the leaf, so reverse it.
+        for (int j = p->depth - 1; j >= 0; j--) {
+            void* addr = p->frames[j];
+            std::map<void*, std::string>::iterator it = symbols.find(addr);
+            if (it == symbols.end()) {
+                it = symbols.insert(std::make_pair(addr, srs_profile_symbol(addr))).first;
+            }
+            ss << ";" << it->second;
+        }
+
+        ss << " " << p->count << "\n";
+    }
+
+    return ss.str();
+}
+
+void SrsCpuProfiler::on_signal(int /*signo*/, siginfo_t* /*info*/, void* uc)
+{
+    int se = errno;
+
+    if (_instance) {
+        _instance->sample((ucontext_t*)uc);
+    }
+
+    errno = se;
+}
+
+void SrsCpuProfiler::sample(ucontext_t* uc)
+{
+    if (!running || !samples) {
+        return;
+    }
+
+    // The table is not thread-safe, so only sample the thread of ST.
+    if (!pthread_equal(pthread_self(), tid)) {
+        nn_others++;
+        return;
+    }
+
+    // Never use the backtrace of libgcc, which crashes at the bottom of coroutine stack, because the first frame
+    // of coroutine is faked by ST without unwind info. We walk the frame pointers in the stack of
+    // coroutine, so it's safe even if the frame pointer is garbage, for the function without it.
+    void* frames[SRS_PROFILE_MAX_DEPTH];
+    int depth = 0;
+
+    uintptr_t pc = 0, fp = 0, sp = 0;
+#if defined(__linux__) && defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(__linux__) && defined(__aarch64__)
+    pc = (uintptr_t)uc->uc_mcontext.pc;
+    fp = (uintptr_t)uc->uc_mcontext.regs[29];
+    sp = (uintptr_t)uc->uc_mcontext.sp;
+#endif
+    frames[depth++] = (void*)pc;
+
+    void* thread = st_thread_self();
+
+    // The stack of coroutine, or the primordial thread.
+    char* bottom = NULL;
+    char* top = NULL;
+    if (st_thread_stack((st_thread_t)thread, &bottom, &top) != 0) {
+        bottom = stack_bottom;
+        top = stack_top;
+    }
+
+    // Ignore the frames if sp is not in stack, for example, the stack is switching.
+    if (sp >= (uintptr_t)bottom && sp < (uintptr_t)top) {
+        uintptr_t lo = sp;
+        while (depth < SRS_PROFILE_MAX_DEPTH) {
+            if (fp < lo || fp + 2 * sizeof(void*) > (uintptr_t)top || (fp & (sizeof(void*) - 1)) != 0) {
+                break;
+            }
+
+            // The frame is [saved fp, return address].
+            uintptr_t* p = (uintptr_t*)fp;
+            if (!p[1]) {
+                break;
+            }
+            frames[depth++] = (void*)p[1];
+
+            // The stack grows down, so the caller frame must be higher.
+            lo = fp + 2 * sizeof(void*);
+            fp = p[0];
+        }
+    }
+
+    add(thread, frames, depth);
+}
+
+void SrsCpuProfiler::add(void* thread, void** frames, int depth)
+{
+    // The FNV-1a hash of stack and coroutine.
+    uint32_t hash = 2166136261u;
+    for (int i = -1; i < depth; i++) {
+        uintptr_t v = (uintptr_t)((i < 0)? thread : frames[i]);
+        for (int j = 0; j < (int)sizeof(v); j++) {
+            hash = (hash ^ (uint8_t)(v >> (j * 8))) * 16777619u;
+        }
+    }
+
+    // Find the stack by linear probing, limited to a few slots when table is nearly full.
+    for (int i = 0; i < 16; i++) {
+        SrsCpuSample* p = &samples[(hash + i) % SRS_PROFILE_TABLE_SIZE];
+
+        if (!p->count) {
+            p->hash = hash;
+            p->thread = thread;
+            p->depth = depth;
+            memcpy(p->frames, frames, sizeof(void*) * depth);
+            p->count = 1;
+            nn_samples++;
+            return;
+        }
+
+        if (p->hash == hash && p->thread == thread && p->depth == depth && !memcmp(p->frames, frames, sizeof(void*) * depth)) {
+            p->count++;
+            nn_samples++;
+            return;
+        }
+    }
+
+    nn_drops++;
+}
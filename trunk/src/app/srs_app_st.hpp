@@ -28,9 +28,19 @@
 
 #include <string>
 
+#include <pthread.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <map>
+#include <set>
+#include <vector>
+
 #include <srs_service_st.hpp>
 #include <srs_protocol_io.hpp>
 
+class SrsJsonObject;
+class SrsSTCoroutine;
+
 // Each ST-coroutine must implements this interface,
 // to do the cycle job and handle some events.
 //
@@ -98,6 +108,19 @@ public:
     virtual int cid();
 };
 
+// The priority of coroutine, the high ones are publishers and ingesters, which should run before
+// the players, or the publisher starves when lots of players dump the GOP cache.
+enum SrsCoroutinePriority
+{
+    SrsCoroutinePriorityNormal = 0,
+    SrsCoroutinePriorityHigh = 1,
+};
+
+// Get the number of alive coroutines of high priority.
+extern int srs_coroutine_nb_highs();
+// Get the number of yields of players to the coroutines of high priority.
+extern int64_t srs_coroutine_nb_yields();
+
 // For utest to mock the thread create.
 typedef void* (*_ST_THREAD_CREATE_PFN)(void *(*start)(void *arg), void *arg, int joinable, int stack_size);
 extern _ST_THREAD_CREATE_PFN _pfn_st_thread_create;
@@ -129,6 +152,15 @@ private:
     bool disposed;
     // Cycle done, no need to interrupt it.
     bool cycle_done;
+    // Whether the cycle is running, in the stack of coroutine.
+    bool running;
+    SrsCoroutinePriority priority;
+private:
+    // The size of stack in bytes, 0 to use the default of ST.
+    int stack_size;
+    // The top of stack, the stack is [stack_top - stack_size, stack_top), the thread object
+    // of ST is at the top page, and the page below the bottom is the guard page.
+    char* stack_top;
 public:
     // Create a thread with name n and handler h.
     // @remark User can specify a cid for thread to use, or we will allocate a new one.
@@ -155,10 +187,300 @@ public:
     virtual srs_error_t pull();
     // Get the context id of thread.
     virtual int cid();
+public:
+    // Set the size of stack in bytes, for coroutine of specified role, before start it.
+    // @remark The stacks are pooled by ST and reused by size, so use some fixed sizes.
+    virtual void set_stack_size(int v);
+    // Get the size of stack in bytes.
+    virtual int get_stack_size();
+    // Get the bytes of stack which is resident in memory, that is the high-water of stack,
+    // for the pages of stack are never released by ST.
+    virtual int stack_resident();
+    // Set the priority of coroutine, which can be changed when running.
+    virtual void set_priority(SrsCoroutinePriority v);
+    virtual SrsCoroutinePriority get_priority();
 private:
     virtual srs_error_t cycle();
     static void* pfn(void* arg);
 };
 
-#endif
+// The slice of bytes for player to write, then yield to the coroutines of high priority. For example:
+//      SrsCoroutineSlice slice(64 * 1024);
+//      while (true) {
+//          // Write some messages in size bytes.
+//          slice.consume(size);
+//      }
+// @remark The player yields by sleep 0, so it runs after the run queue is empty and the publishers, which
+//      are ready by the events of IO, are scheduled.
+class SrsCoroutineSlice
+{
+private:
+    int64_t budget;
+    int64_t used;
+public:
+    // Create the slice of v bytes, 0 to never yield.
+    SrsCoroutineSlice(int64_t v);
+    virtual ~SrsCoroutineSlice();
+public:
+    // Consume the bytes written, and yield when exceed the slice and there are coroutines of high priority.
+    // @return Whether yield.
+    virtual bool consume(int64_t nbytes);
+};
+
+// The stat of stacks for coroutines of a role, which is the name of coroutine.
+struct SrsStackStat
+{
+    // The size of stack in bytes.
+    int size;
+    // The number of coroutines created, and the alive ones.
+    int64_t nn_total;
+    std::set<SrsSTCoroutine*> alives;
+    // The max resident bytes of stack of coroutines.
+    int high_water;
+};
+
+// The stat of stacks for all roles, to tune the size of stack for each role.
+class SrsStackStats
+{
+private:
+    static SrsStackStats* _instance;
+private:
+    std::map<std::string, SrsStackStat*> roles;
+public:
+    SrsStackStats();
+    virtual ~SrsStackStats();
+public:
+    static SrsStackStats* instance();
+public:
+    // When coroutine started and in its stack.
+    virtual void on_start(std::string role, SrsSTCoroutine* trd);
+    // When coroutine is about to terminate and still in its stack.
+    virtual void on_stop(std::string role, SrsSTCoroutine* trd);
+    // Dumps the stat of stacks to json.
+    virtual srs_error_t dumps(SrsJsonObject* obj);
+    // Get the number of alive coroutines, and the bytes of their stacks, reserved and resident.
+    virtual void memory(int64_t& alive, int64_t& reserved, int64_t& resident);
+private:
+    virtual SrsStackStat* fetch(std::string role);
+};
+
+// The number of buckets of histogram for the delay of run queue.
+#define SRS_SCHED_DELAY_BUCKETS 8
+// The number of longest slices to keep.
+#define SRS_SCHED_SLOW_SLICES 10
+// The number of coroutines to dump, which consume the most cpu.
+#define SRS_SCHED_TOP_COROUTINES 20
 
+// The profile of a coroutine, the cpu is the wall time of slices it runs without yielding.
+struct SrsCoroutineProfile
+{
+    std::string role;
+    int cid;
+    srs_utime_t cpu;
+    int64_t nn_switches;
+    srs_utime_t max_slice;
+};
+
+// The profile of coroutines of a role, which folds the terminated ones.
+struct SrsCoroutineRoleProfile
+{
+    int64_t nn_total;
+    int alive;
+    srs_utime_t cpu;
+    int64_t nn_switches;
+};
+
+// The longest slice a coroutine runs without yielding.
+struct SrsSchedulerSlice
+{
+    srs_utime_t duration;
+    int cid;
+    std::string role;
+    // The monotonic time when slice is done.
+    srs_utime_t at;
+};
+
+// The profile of ST scheduler, by the switch callbacks of ST, to find which coroutine hogs the thread.
+// The delay of run queue is from the time coroutine is ready, to the time it is switched in.
+// @remark It's OK to work with the gperf, which profiles the function by signal.
+class SrsSchedulerStats
+{
+private:
+    static SrsSchedulerStats* _instance;
+private:
+    bool enabled;
+    // The key of ST thread specific data, for the profile of coroutine.
+    int key;
+    // The monotonic time when last coroutine switched in.
+    srs_utime_t last;
+    int64_t nn_switches;
+    // The cpu of coroutines without profile, for example, the primordial thread.
+    srs_utime_t others;
+private:
+    // The histogram of delay of run queue.
+    int64_t delays[SRS_SCHED_DELAY_BUCKETS];
+    int64_t nn_delays;
+    srs_utime_t delay_sum;
+    srs_utime_t max_delay;
+private:
+    // The longest slices, sorted by duration desc.
+    std::vector<SrsSchedulerSlice> slices;
+    std::set<SrsCoroutineProfile*> alives;
+    std::map<std::string, SrsCoroutineRoleProfile*> roles;
+public:
+    SrsSchedulerStats();
+    virtual ~SrsSchedulerStats();
+public:
+    static SrsSchedulerStats* instance();
+public:
+    // Enable the profile by the switch callbacks of ST.
+    // @remark Must be called after ST is initialized, only the coroutines started after it are profiled.
+    virtual srs_error_t initialize(bool v);
+    // When coroutine started and stopped, in its stack.
+    virtual void on_start(std::string role, int cid);
+    virtual void on_stop();
+    // Dumps the profile of scheduler to json.
+    virtual srs_error_t dumps(SrsJsonObject* obj);
+public:
+    // When coroutine is switched in or out, by ST.
+    virtual void on_switch_in(srs_utime_t now, srs_utime_t runq_at);
+    virtual void on_switch_out(srs_utime_t now);
+private:
+    static void switch_in();
+    static void switch_out();
+    virtual void on_slow_slice(srs_utime_t duration, std::string role, srs_utime_t now);
+    virtual SrsCoroutineRoleProfile* fetch(std::string role);
+};
+
+// The component which costs CPU on behalf of a stream.
+enum SrsCpuType
+{
+    // The source dispatches the messages, for example, parse the format, cache the gop and enqueue to consumers.
+    SrsCpuDispatch = 0,
+    SrsCpuHls,
+    SrsCpuDash,
+    SrsCpuDvr,
+    // The players send the messages, for example, mux and write to socket.
+    SrsCpuSend,
+    SrsCpuTypeMax
+};
+
+// Get the name of CPU component, for example, "hls".
+extern const char* srs_cpu_type2str(SrsCpuType type);
+
+// Get the cycles of CPU, by the TSC for x86_64, or the monotonic time in ns for others.
+extern int64_t srs_cpu_cycles();
+
+// The CPU cost of a stream, in cycles for each component.
+class SrsCpuStat
+{
+public:
+    int64_t cycles[SrsCpuTypeMax];
+    // The cycles per second of each component, between the last two samples.
+    int64_t rates[SrsCpuTypeMax];
+private:
+    // The cycles and time of last sample.
+    int64_t sampled[SrsCpuTypeMax];
+    srs_utime_t sample_at;
+public:
+    SrsCpuStat();
+    virtual ~SrsCpuStat();
+public:
+    // Sample the cycles per second of components.
+    virtual void sample(srs_utime_t now);
+    // Get the sum of cycles per second of all components.
+    virtual int64_t total_rate();
+};
+
+// Account the CPU cycles of current coroutine in the scope, to the component of stream.
+// The cost is exclusive, that is, the outer scope is paused when a nested one starts, so for example,
+// the HLS muxing in the dispatching of source is only accounted to HLS.
+// @remark The accounting stops when coroutine switches out, so the wait of IO is never accounted.
+// @remark The stat must never be freed, see SrsStatistic::fetch_cpu.
+class SrsCpuScope
+{
+private:
+    // The account of outer scope, to restore when this scope ends.
+    SrsCpuStat* parent_stat;
+    SrsCpuType parent_type;
+public:
+    // @param stat The stat of stream, ignore if NULL.
+    SrsCpuScope(SrsCpuStat* stat, SrsCpuType type);
+    virtual ~SrsCpuScope();
+public:
+    // Account the following cycles to another component of the stream.
+    virtual void switch_to(SrsCpuType type);
+public:
+    // Account the cycles to current account, and stop it, when coroutine switches out.
+    static void on_switch_out();
+private:
+    static void account(SrsCpuStat* stat, SrsCpuType type);
+};
+
+// The max depth of stack for each sample of CPU profile.
+#define SRS_PROFILE_MAX_DEPTH 32
+// The size of table to aggregate the stacks, the sample is dropped if table is full.
+#define SRS_PROFILE_TABLE_SIZE 4096
+
+// The aggregated stack of CPU profile.
+struct SrsCpuSample
+{
+    uint32_t hash;
+    int64_t count;
+    // The ST coroutine which is interrupted by signal.
+    void* thread;
+    int depth;
+    void* frames[SRS_PROFILE_MAX_DEPTH];
+};
+
+// The sampling profiler of CPU, by the signal SIGPROF of timer, without special build or restart.
+// It aggregates the stacks in a fixed-size table in signal handler, then dumps it in folded stacks for flame graph,
+// where the ST coroutine is the root frame. For example:
+//      SrsCpuProfiler::instance()->start(99);
+//      srs_usleep(30 * SRS_UTIME_SECONDS);
+//      SrsCpuProfiler::instance()->stop();
+//      std::string folded = SrsCpuProfiler::instance()->dumps();
+// @remark It conflicts with the CPU profile of gperf, which also uses the SIGPROF.
+// @remark Only samples the primordial thread, which runs the ST, the other threads are counted as others.
+// @remark The stack is walked by frame pointers, so the function without it, for example, in ST and libc, loses
+//      its caller in the stack.
+class SrsCpuProfiler
+{
+private:
+    static SrsCpuProfiler* _instance;
+private:
+    bool running;
+    int hz;
+    // The thread to sample, which runs ST.
+    pthread_t tid;
+    SrsCpuSample* samples;
+    int64_t nn_samples;
+    // The samples dropped for table is full.
+    int64_t nn_drops;
+    // The samples in other threads, not sampled.
+    int64_t nn_others;
+    // The stack of primordial thread.
+    char* stack_bottom;
+    char* stack_top;
+public:
+    SrsCpuProfiler();
+    virtual ~SrsCpuProfiler();
+public:
+    static SrsCpuProfiler* instance();
+public:
+    // Start to sample the CPU in hz, the previous samples are discarded.
+    virtual srs_error_t start(int v);
+    // Stop the sampling, the samples are kept for dumps.
+    virtual void stop();
+    virtual bool is_running();
+    virtual int64_t nb_samples();
+    // Dumps the samples in folded stacks, one stack per line, for example:
+    //      coroutine-107;_st_thread_main;SrsSTCoroutine::pfn(void*);... 13
+    virtual std::string dumps();
+private:
+    static void on_signal(int signo, siginfo_t* info, void* uc);
+    void sample(ucontext_t* uc);
+    void add(void* thread, void** frames, int depth);
+};
+
+#endif
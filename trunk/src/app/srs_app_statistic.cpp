@@ -25,6 +25,7 @@
 
 #include <unistd.h>
 #include <sstream>
+#include <iomanip>
 using namespace std;
 
 #include <srs_rtmp_stack.hpp>
@@ -32,8 +33,15 @@ using namespace std;
 #include <srs_protocol_kbps.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_config.hpp>
+#include <srs_app_access_log.hpp>
+#include <srs_app_events.hpp>
+#include <srs_app_edge.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_amf0.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_core_mem_watch.hpp>
+#include <srs_service_st.hpp>
+#include <srs_app_st.hpp>
 
 int64_t srs_gvid = 0;
 
@@ -45,6 +53,131 @@ int64_t srs_generate_id()
     return srs_gvid++;
 }
 
+// The upper bounds of histogram buckets, the last one is +Inf.
+static srs_utime_t srs_stat_histogram_bounds[SRS_STAT_HISTOGRAM_BUCKETS - 1] = {
+    1 * SRS_UTIME_MILLISECONDS, 5 * SRS_UTIME_MILLISECONDS, 10 * SRS_UTIME_MILLISECONDS,
+    50 * SRS_UTIME_MILLISECONDS, 100 * SRS_UTIME_MILLISECONDS, 500 * SRS_UTIME_MILLISECONDS,
+    1000 * SRS_UTIME_MILLISECONDS, 5000 * SRS_UTIME_MILLISECONDS
+};
+
+// Escape the value of label, @see https://prometheus.io/docs/instrumenting/exposition_formats/
+string srs_metrics_escape(string v)
+{
+    string r;
+    for (int i = 0; i < (int)v.length(); i++) {
+        char ch = v.at(i);
+        if (ch == '\\' || ch == '"') {
+            r += '\\';
+        } else if (ch == '\n') {
+            r += "\\n";
+            continue;
+        }
+        r += ch;
+    }
+    return r;
+}
+
+// Write the HELP and TYPE of metric family.
+void srs_metrics_family(stringstream& ss, string name, string type, string help)
+{
+    ss << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " " << type << "\n";
+}
+
+SrsStatisticHistogram::SrsStatisticHistogram()
+{
+    for (int i = 0; i < SRS_STAT_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = 0;
+    }
+    count = 0;
+    sum = 0;
+}
+
+SrsStatisticHistogram::~SrsStatisticHistogram()
+{
+}
+
+void SrsStatisticHistogram::observe(srs_utime_t v)
+{
+    int i = 0;
+    for (; i < SRS_STAT_HISTOGRAM_BUCKETS - 1; i++) {
+        if (v <= srs_stat_histogram_bounds[i]) {
+            break;
+        }
+    }
+    
+    buckets[i]++;
+    count++;
+    sum += v;
+}
+
+srs_utime_t SrsStatisticHistogram::percentile(double p)
+{
+    if (!count) {
+        return 0;
+    }
+    
+    // The rank of value, which is the first one when p is 0.
+    int64_t rank = srs_max(1, (int64_t)(p * count + 0.5));
+    
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_STAT_HISTOGRAM_BUCKETS - 1; i++) {
+        nn += buckets[i];
+        if (nn >= rank) {
+            return srs_stat_histogram_bounds[i];
+        }
+    }
+    
+    return srs_stat_histogram_bounds[SRS_STAT_HISTOGRAM_BUCKETS - 2];
+}
+
+void SrsStatisticHistogram::dumps(stringstream& ss, string name, string labels)
+{
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_STAT_HISTOGRAM_BUCKETS; i++) {
+        nn += buckets[i];
+        
+        ss << name << "_bucket{" << labels << ",le=\"";
+        if (i < SRS_STAT_HISTOGRAM_BUCKETS - 1) {
+            ss << srs_stat_histogram_bounds[i] / 1000000.0;
+        } else {
+            ss << "+Inf";
+        }
+        ss << "\"} " << nn << "\n";
+    }
+    
+    ss << name << "_sum{" << labels << "} " << sum / 1000000.0 << "\n"
+       << name << "_count{" << labels << "} " << count << "\n";
+}
+
+SrsStatisticEgress::SrsStatisticEgress()
+{
+    bytes = 0;
+    time = 0;
+    kbps = 0;
+    reserved = 0;
+}
+
+SrsStatisticEgress::~SrsStatisticEgress()
+{
+}
+
+void SrsStatisticEgress::sample(int64_t send_bytes, srs_utime_t now)
+{
+    if (time > 0 && now > time) {
+        kbps = (int)((send_bytes - bytes) * 8 / srsu2ms(now - time));
+    }
+    
+    bytes = send_bytes;
+    time = now;
+    reserved = 0;
+}
+
+bool SrsStatisticEgress::exceed(int bitrate, int budget)
+{
+    return budget > 0 && kbps + reserved + bitrate > budget;
+}
+
 SrsStatisticVhost::SrsStatisticVhost()
 {
     id = srs_generate_id();
@@ -55,15 +188,19 @@ SrsStatisticVhost::SrsStatisticVhost()
     
     nb_clients = 0;
     nb_streams = 0;
+    
+    usage = new SrsMemoryUsage(SrsMemoryStatistic);
+    usage->add(sizeof(SrsStatisticVhost) + sizeof(SrsWallClock) + sizeof(SrsKbps));
 }
 
 SrsStatisticVhost::~SrsStatisticVhost()
 {
     srs_freep(kbps);
     srs_freep(clk);
+    srs_freep(usage);
 }
 
-srs_error_t SrsStatisticVhost::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticVhost::dumps(SrsJsonWriter* jw)
 {
     srs_error_t err = srs_success;
     
@@ -71,27 +208,28 @@ srs_error_t SrsStatisticVhost::dumps(SrsJsonObject* obj)
     bool hls_enabled = _srs_config->get_hls_enabled(vhost);
     bool enabled = _srs_config->get_vhost_enabled(vhost);
     
-    obj->set("id", SrsJsonAny::integer(id));
-    obj->set("name", SrsJsonAny::str(vhost.c_str()));
-    obj->set("enabled", SrsJsonAny::boolean(enabled));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("streams", SrsJsonAny::integer(nb_streams));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
-    
-    SrsJsonObject* hls = SrsJsonAny::object();
-    obj->set("hls", hls);
-    
-    hls->set("enabled", SrsJsonAny::boolean(hls_enabled));
+    jw->object_start();
+    jw->field("id")->integer(id);
+    jw->field("name")->str(vhost);
+    jw->field("enabled")->boolean(enabled);
+    jw->field("clients")->integer(nb_clients);
+    jw->field("streams")->integer(nb_streams);
+    jw->field("send_bytes")->integer(kbps->get_send_bytes());
+    jw->field("recv_bytes")->integer(kbps->get_recv_bytes());
+    
+    jw->field("kbps")->object_start();
+    jw->field("recv_30s")->integer(kbps->get_recv_kbps_30s());
+    jw->field("send_30s")->integer(kbps->get_send_kbps_30s());
+    jw->object_end();
+    
+    jw->field("hls")->object_start();
+    jw->field("enabled")->boolean(hls_enabled);
     if (hls_enabled) {
-        hls->set("fragment", SrsJsonAny::number(srsu2msi(_srs_config->get_hls_fragment(vhost))/1000.0));
+        jw->field("fragment")->number(srsu2msi(_srs_config->get_hls_fragment(vhost))/1000.0);
     }
+    jw->object_end();
+    
+    jw->object_end();
     
     return err;
 }
@@ -100,6 +238,7 @@ SrsStatisticStream::SrsStatisticStream()
 {
     id = srs_generate_id();
     vhost = NULL;
+    key = NULL;
     active = false;
     connection_cid = -1;
     
@@ -122,65 +261,137 @@ SrsStatisticStream::SrsStatisticStream()
     
     nb_clients = 0;
     nb_frames = 0;
+    nb_drops = 0;
+    send_latency = new SrsStatisticHistogram();
+    queue_delay = new SrsStatisticHistogram();
+    stall_time = 0;
+    nn_stalls = 0;
+    ttff = new SrsStatisticHistogram();
+    edge_ttff = -1;
+    ingest_latency = new SrsStatisticHistogram();
+    play_latency = new SrsStatisticHistogram();
+    memory = NULL;
+    cpu = NULL;
+    hls_es_bytes = hls_ts_bytes = 0;
+    
+    usage = new SrsMemoryUsage(SrsMemoryStatistic);
+    usage->add(sizeof(SrsStatisticStream) + sizeof(SrsWallClock) + sizeof(SrsKbps) + 5 * sizeof(SrsStatisticHistogram));
 }
 
 SrsStatisticStream::~SrsStatisticStream()
 {
+    srs_freep(usage);
+    srs_freep(send_latency);
+    srs_freep(queue_delay);
+    srs_freep(ttff);
+    srs_freep(ingest_latency);
+    srs_freep(play_latency);
     srs_freep(kbps);
     srs_freep(clk);
 }
 
-srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticStream::dumps(SrsJsonWriter* jw)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::integer(id));
-    obj->set("name", SrsJsonAny::str(stream.c_str()));
-    obj->set("vhost", SrsJsonAny::integer(vhost->id));
-    obj->set("app", SrsJsonAny::str(app.c_str()));
-    obj->set("live_ms", SrsJsonAny::integer(srsu2ms(srs_get_system_time())));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("frames", SrsJsonAny::integer(nb_frames));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
+    jw->object_start();
+    jw->field("id")->integer(id);
+    jw->field("name")->str(stream);
+    jw->field("vhost")->integer(vhost->id);
+    jw->field("app")->str(app);
+    jw->field("live_ms")->integer(srsu2ms(srs_get_system_time()));
+    jw->field("clients")->integer(nb_clients);
+    jw->field("frames")->integer(nb_frames);
+    jw->field("send_bytes")->integer(kbps->get_send_bytes());
+    jw->field("recv_bytes")->integer(kbps->get_recv_bytes());
+    
+    jw->field("kbps")->object_start();
+    jw->field("recv_30s")->integer(kbps->get_recv_kbps_30s());
+    jw->field("send_30s")->integer(kbps->get_send_kbps_30s());
+    jw->object_end();
+    
+    jw->field("publish")->object_start();
+    jw->field("active")->boolean(active);
+    jw->field("cid")->integer(connection_cid);
+    jw->object_end();
+    
+    jw->field("ttff")->object_start();
+    jw->field("edge_ms")->integer(edge_ttff < 0? -1 : srsu2ms(edge_ttff));
+    jw->field("count")->integer(ttff->count);
+    jw->field("avg_ms")->integer(ttff->count? srsu2ms(ttff->sum / ttff->count) : 0);
+    jw->object_end();
+    
+    jw->field("latency")->object_start();
+    jw->field("ingest")->object_start();
+    jw->field("count")->integer(ingest_latency->count);
+    jw->field("avg_ms")->integer(ingest_latency->count? srsu2ms(ingest_latency->sum / ingest_latency->count) : 0);
+    jw->object_end();
+    jw->field("play")->object_start();
+    jw->field("count")->integer(play_latency->count);
+    jw->field("avg_ms")->integer(play_latency->count? srsu2ms(play_latency->sum / play_latency->count) : 0);
+    jw->object_end();
+    jw->object_end();
+    
+    jw->field("delay")->object_start();
+    jw->field("queue_p50_ms")->integer(srsu2ms(queue_delay->percentile(0.5)));
+    jw->field("queue_p99_ms")->integer(srsu2ms(queue_delay->percentile(0.99)));
+    jw->field("stall_ms")->integer(srsu2ms(stall_time));
+    jw->field("stalls")->integer(nn_stalls);
+    jw->field("drops")->integer(nb_drops);
+    jw->object_end();
+    
+    if (hls_ts_bytes > 0) {
+        jw->field("hls")->object_start();
+        jw->field("es_bytes")->integer(hls_es_bytes);
+        jw->field("ts_bytes")->integer(hls_ts_bytes);
+        jw->field("overhead")->number(100.0 * (hls_ts_bytes - hls_es_bytes) / hls_ts_bytes);
+        jw->object_end();
+    }
     
-    SrsJsonObject* publish = SrsJsonAny::object();
-    obj->set("publish", publish);
+    if (memory) {
+        jw->field("memory")->object_start();
+        for (int i = 0; i < SrsMemoryTypeMax; i++) {
+            jw->field(srs_memory_type2str((SrsMemoryType)i))->integer(memory->bytes[i]);
+        }
+        jw->field("total")->integer(memory->total());
+        jw->object_end();
+    }
     
-    publish->set("active", SrsJsonAny::boolean(active));
-    publish->set("cid", SrsJsonAny::integer(connection_cid));
+    // The cycles per second of each component, for the capacity planning.
+    if (cpu) {
+        jw->field("cpu")->object_start();
+        for (int i = 0; i < SrsCpuTypeMax; i++) {
+            jw->field(srs_cpu_type2str((SrsCpuType)i))->integer(cpu->rates[i]);
+        }
+        jw->field("total")->integer(cpu->total_rate());
+        jw->object_end();
+    }
     
     if (!has_video) {
-        obj->set("video", SrsJsonAny::null());
+        jw->field("video")->null();
     } else {
-        SrsJsonObject* video = SrsJsonAny::object();
-        obj->set("video", video);
-        
-        video->set("codec", SrsJsonAny::str(srs_video_codec_id2str(vcodec).c_str()));
-        video->set("profile", SrsJsonAny::str(srs_avc_profile2str(avc_profile).c_str()));
-        video->set("level", SrsJsonAny::str(srs_avc_level2str(avc_level).c_str()));
-        video->set("width", SrsJsonAny::integer(width));
-        video->set("height", SrsJsonAny::integer(height));
+        jw->field("video")->object_start();
+        jw->field("codec")->str(srs_video_codec_id2str(vcodec));
+        jw->field("profile")->str(srs_avc_profile2str(avc_profile));
+        jw->field("level")->str(srs_avc_level2str(avc_level));
+        jw->field("width")->integer(width);
+        jw->field("height")->integer(height);
+        jw->object_end();
     }
     
     if (!has_audio) {
-        obj->set("audio", SrsJsonAny::null());
+        jw->field("audio")->null();
     } else {
-        SrsJsonObject* audio = SrsJsonAny::object();
-        obj->set("audio", audio);
-        
-        audio->set("codec", SrsJsonAny::str(srs_audio_codec_id2str(acodec).c_str()));
-        audio->set("sample_rate", SrsJsonAny::integer(srs_flv_srates[asample_rate]));
-        audio->set("channel", SrsJsonAny::integer(asound_type + 1));
-        audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
+        jw->field("audio")->object_start();
+        jw->field("codec")->str(srs_audio_codec_id2str(acodec));
+        jw->field("sample_rate")->integer(srs_flv_srates[asample_rate]);
+        jw->field("channel")->integer(asound_type + 1);
+        jw->field("profile")->str(srs_aac_object2str(aac_object));
+        jw->object_end();
     }
     
+    jw->object_end();
+    
     return err;
 }
 
@@ -208,28 +419,56 @@ SrsStatisticClient::SrsStatisticClient()
     conn = NULL;
     req = NULL;
     type = SrsRtmpConnUnknown;
-    create = srs_get_system_time();
+    create = srs_get_monotonic_time();
+    nb_cs_misses = 0;
+    nb_drops = 0;
+    nb_frame_drops = 0;
+    ttff = -1;
+    queue_delay = new SrsStatisticHistogram();
+    stall_time = 0;
+    nn_stalls = 0;
+    recv_bytes = 0;
+    send_bytes = 0;
+    slot = -1;
+    
+    usage = new SrsMemoryUsage(SrsMemoryStatistic);
+    usage->add(sizeof(SrsStatisticClient) + sizeof(SrsStatisticHistogram) + sizeof(SrsRequest));
 }
 
 SrsStatisticClient::~SrsStatisticClient()
 {
+    srs_freep(queue_delay);
+    srs_freep(usage);
 }
 
-srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticClient::dumps(SrsJsonWriter* jw)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::integer(id));
-    obj->set("vhost", SrsJsonAny::integer(stream->vhost->id));
-    obj->set("stream", SrsJsonAny::integer(stream->id));
-    obj->set("ip", SrsJsonAny::str(req->ip.c_str()));
-    obj->set("pageUrl", SrsJsonAny::str(req->pageUrl.c_str()));
-    obj->set("swfUrl", SrsJsonAny::str(req->swfUrl.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(req->tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
-    obj->set("type", SrsJsonAny::str(srs_client_type_string(type).c_str()));
-    obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
-    obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
+    jw->object_start();
+    jw->field("id")->integer(id);
+    jw->field("vhost")->integer(stream->vhost->id);
+    jw->field("stream")->integer(stream->id);
+    jw->field("ip")->str(req->ip);
+    jw->field("pageUrl")->str(req->pageUrl);
+    jw->field("swfUrl")->str(req->swfUrl);
+    jw->field("tcUrl")->str(req->tcUrl);
+    jw->field("url")->str(req->get_stream_url());
+    jw->field("type")->str(srs_client_type_string(type));
+    jw->field("publish")->boolean(srs_client_type_is_publish(type));
+    jw->field("alive")->number(srsu2ms(srs_get_monotonic_time() - create) / 1000.0);
+    jw->field("cs_misses")->integer(nb_cs_misses);
+    jw->field("drops")->integer(nb_drops);
+    jw->field("frame_drops")->integer(nb_frame_drops);
+    jw->field("ttff_ms")->integer(ttff < 0? -1 : srsu2ms(ttff));
+    
+    jw->field("delay")->object_start();
+    jw->field("queue_p50_ms")->integer(srsu2ms(queue_delay->percentile(0.5)));
+    jw->field("queue_p99_ms")->integer(srsu2ms(queue_delay->percentile(0.99)));
+    jw->field("stall_ms")->integer(srsu2ms(stall_time));
+    jw->field("stalls")->integer(nn_stalls);
+    jw->object_end();
+    jw->object_end();
     
     return err;
 }
@@ -243,6 +482,8 @@ SrsStatistic::SrsStatistic()
     clk = new SrsWallClock();
     kbps = new SrsKbps(clk);
     kbps->set_io(NULL, NULL);
+    
+    nb_admission_rejects = 0;
 }
 
 SrsStatistic::~SrsStatistic()
@@ -271,6 +512,20 @@ SrsStatistic::~SrsStatistic()
             srs_freep(client);
         }
     }
+    if (true) {
+        std::map<SrsStreamKey*, SrsMemoryStat*>::iterator it;
+        for (it = memories.begin(); it != memories.end(); it++) {
+            SrsMemoryStat* memory = it->second;
+            srs_freep(memory);
+        }
+    }
+    if (true) {
+        std::map<SrsStreamKey*, SrsCpuStat*>::iterator it;
+        for (it = cpus.begin(); it != cpus.end(); it++) {
+            SrsCpuStat* cpu = it->second;
+            srs_freep(cpu);
+        }
+    }
     
     vhosts.clear();
     rvhosts.clear();
@@ -317,6 +572,20 @@ SrsStatisticStream* SrsStatistic::find_stream(int sid)
     return NULL;
 }
 
+SrsStatisticStream* SrsStatistic::find_stream_by_url(string url)
+{
+    SrsStreamKey* key = SrsStreamKey::find(url);
+    if (!key) {
+        return NULL;
+    }
+    
+    std::map<SrsStreamKey*, SrsStatisticStream*>::iterator it;
+    if ((it = rstreams.find(key)) != rstreams.end()) {
+        return it->second;
+    }
+    return NULL;
+}
+
 SrsStatisticClient* SrsStatistic::find_client(int cid)
 {
     std::map<int, SrsStatisticClient*>::iterator it;
@@ -326,12 +595,36 @@ SrsStatisticClient* SrsStatistic::find_client(int cid)
     return NULL;
 }
 
+SrsStatisticHandle SrsStatistic::find_handle(int cid)
+{
+    SrsStatisticClient* client = find_client(cid);
+    if (!client) {
+        return 0;
+    }
+    
+    SrsStatisticSlot& slot = slots[client->slot];
+    return ((uint64_t)slot.generation << 32) | (uint32_t)client->slot;
+}
+
+SrsStatisticClient* SrsStatistic::resolve(SrsStatisticHandle handle)
+{
+    uint32_t index = (uint32_t)handle;
+    if (index >= slots.size()) {
+        return NULL;
+    }
+    
+    SrsStatisticSlot& slot = slots[index];
+    if (slot.generation != (uint32_t)(handle >> 32)) {
+        return NULL;
+    }
+    return slot.client;
+}
+
 srs_error_t SrsStatistic::on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile, SrsAvcLevel avc_level, int width, int height)
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
+    SrsStatisticStream* stream = create_stream(req);
     
     stream->has_video = true;
     stream->vcodec = vcodec;
@@ -348,8 +641,7 @@ srs_error_t SrsStatistic::on_audio_info(SrsRequest* req, SrsAudioCodecId acodec,
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
+    SrsStatisticStream* stream = create_stream(req);
     
     stream->has_audio = true;
     stream->acodec = acodec;
@@ -360,32 +652,42 @@ srs_error_t SrsStatistic::on_audio_info(SrsRequest* req, SrsAudioCodecId acodec,
     return err;
 }
 
-srs_error_t SrsStatistic::on_video_frames(SrsRequest* req, int nb_frames)
+srs_error_t SrsStatistic::on_video_frames(SrsStatisticHandle handle, int nb_frames)
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
-    
-    stream->nb_frames += nb_frames;
+    SrsStatisticClient* client = resolve(handle);
+    if (client) {
+        client->stream->nb_frames += nb_frames;
+    }
     
     return err;
 }
 
+void SrsStatistic::on_chunk_stream_misses(SrsStatisticHandle handle, int64_t nb_misses)
+{
+    SrsStatisticClient* client = resolve(handle);
+    if (client) {
+        client->nb_cs_misses = nb_misses;
+    }
+}
+
 void SrsStatistic::on_stream_publish(SrsRequest* req, int cid)
 {
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
+    SrsStatisticStream* stream = create_stream(req);
     
     stream->publish(cid);
+    
+    _srs_events->on_publish(req, cid);
 }
 
 void SrsStatistic::on_stream_close(SrsRequest* req)
 {
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
+    SrsStatisticStream* stream = create_stream(req);
     stream->close();
     
+    _srs_events->on_unpublish(req);
+    
     // TODO: FIXME: Should fix https://github.com/ossrs/srs/issues/803
     if (true) {
         std::map<int64_t, SrsStatisticStream*>::iterator it;
@@ -396,35 +698,81 @@ void SrsStatistic::on_stream_close(SrsRequest* req)
     
     // TODO: FIXME: Should fix https://github.com/ossrs/srs/issues/803
     if (true) {
-        std::map<std::string, SrsStatisticStream*>::iterator it;
-        if ((it=rstreams.find(stream->url)) != rstreams.end()) {
+        std::map<SrsStreamKey*, SrsStatisticStream*>::iterator it;
+        if ((it=rstreams.find(stream->key)) != rstreams.end()) {
             rstreams.erase(it);
         }
     }
 }
 
+SrsMemoryStat* SrsStatistic::fetch_memory(SrsRequest* req)
+{
+    SrsStreamKey* key = req->get_stream_key();
+    
+    std::map<SrsStreamKey*, SrsMemoryStat*>::iterator it = memories.find(key);
+    if (it != memories.end()) {
+        return it->second;
+    }
+    
+    SrsMemoryStat* memory = new SrsMemoryStat();
+    memories[key] = memory;
+    return memory;
+}
+
+SrsCpuStat* SrsStatistic::fetch_cpu(SrsRequest* req)
+{
+    SrsStreamKey* key = req->get_stream_key();
+    
+    std::map<SrsStreamKey*, SrsCpuStat*>::iterator it = cpus.find(key);
+    if (it != cpus.end()) {
+        return it->second;
+    }
+    
+    SrsCpuStat* cpu = new SrsCpuStat();
+    cpus[key] = cpu;
+    return cpu;
+}
+
 srs_error_t SrsStatistic::on_client(int id, SrsRequest* req, SrsConnection* conn, SrsRtmpConnType type)
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
+    SrsStatisticStream* stream = create_stream(req);
+    SrsStatisticVhost* vhost = stream->vhost;
     
     // create client if not exists
-    SrsStatisticClient* client = NULL;
-    if (clients.find(id) == clients.end()) {
+    SrsStatisticClient* client = find_client(id);
+    if (!client) {
         client = new SrsStatisticClient();
         client->id = id;
         client->stream = stream;
         clients[id] = client;
-    } else {
-        client = clients[id];
+        
+        // Reuse the free slot, or grow the table.
+        if (free_slots.empty()) {
+            SrsStatisticSlot slot;
+            slot.client = NULL;
+            slot.generation = 0;
+            free_slots.push_back((int)slots.size());
+            slots.push_back(slot);
+        }
+        client->slot = free_slots.back();
+        free_slots.pop_back();
+        
+        SrsStatisticSlot& slot = slots[client->slot];
+        slot.client = client;
+        slot.generation++;
     }
     
     // got client.
+    bool fresh = !client->req;
     client->conn = conn;
     client->req = req;
     client->type = type;
+    
+    if (fresh) {
+        _srs_events->on_connect(id, req, type);
+    }
     stream->nb_clients++;
     vhost->nb_clients++;
     
@@ -442,6 +790,21 @@ void SrsStatistic::on_disconnect(int id)
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
     
+    // Collect the bytes since last aggregation, before the conn is freed.
+    kbps_add_delta(client);
+    
+    // Write the record of session, with the total bytes.
+    _srs_access_log->on_session(client);
+    if (client->req) {
+        _srs_events->on_close(id, client->req, client->type, client->send_bytes, client->recv_bytes);
+    }
+    
+    // Free the slot, and the handles of client are stale.
+    SrsStatisticSlot& slot = slots[client->slot];
+    slot.client = NULL;
+    slot.generation++;
+    free_slots.push_back(client->slot);
+    
     srs_freep(client);
     clients.erase(it);
     
@@ -449,34 +812,170 @@ void SrsStatistic::on_disconnect(int id)
     vhost->nb_clients--;
 }
 
-void SrsStatistic::kbps_add_delta(SrsConnection* conn)
+void SrsStatistic::on_queue_drops(SrsRequest* req, int nb_msgs)
+{
+    SrsStatisticStream* stream = create_stream(req);
+    
+    stream->nb_drops += nb_msgs;
+}
+
+void SrsStatistic::on_client_drops(int id, int64_t nb_drops, int64_t nb_frame_drops)
 {
-    int id = conn->srs_id();
-    if (clients.find(id) == clients.end()) {
+    std::map<int, SrsStatisticClient*>::iterator it = clients.find(id);
+    if (it == clients.end()) {
         return;
     }
     
-    SrsStatisticClient* client = clients[id];
+    SrsStatisticClient* client = it->second;
+    client->nb_drops = nb_drops;
+    client->nb_frame_drops = nb_frame_drops;
+}
+
+void SrsStatistic::on_send_latency(SrsStatisticHandle handle, srs_utime_t elapsed)
+{
+    SrsStatisticClient* client = resolve(handle);
+    if (client) {
+        client->stream->send_latency->observe(elapsed);
+    }
+}
+
+void SrsStatistic::on_client_delays(SrsStatisticHandle handle, srs_utime_t delay, srs_utime_t stall_time, int64_t nn_stalls)
+{
+    SrsStatisticClient* client = resolve(handle);
+    if (!client) {
+        return;
+    }
+    
+    SrsStatisticStream* stream = client->stream;
+    client->queue_delay->observe(delay);
+    stream->queue_delay->observe(delay);
+    
+    // The stalls of conn is total, so aggregate the delta to stream.
+    stream->stall_time += stall_time - client->stall_time;
+    stream->nn_stalls += nn_stalls - client->nn_stalls;
+    client->stall_time = stall_time;
+    client->nn_stalls = nn_stalls;
+}
+
+bool SrsStatistic::on_client_frames(SrsStatisticHandle handle, SrsSharedPtrMessage** msgs, int count)
+{
+    SrsStatisticClient* client = resolve(handle);
+    if (!client || client->ttff >= 0) {
+        return true;
+    }
     
-    // resample the kbps to collect the delta.
-    int64_t in, out;
-    conn->remark(&in, &out);
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        if (msg->is_video() && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            client->ttff = srs_get_monotonic_time() - client->create;
+            client->stream->ttff->observe(client->ttff);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void SrsStatistic::on_edge_ttff(SrsRequest* req, srs_utime_t elapsed)
+{
+    SrsStatisticStream* stream = create_stream(req);
+    
+    stream->edge_ttff = elapsed;
+}
+
+void SrsStatistic::on_hls_bytes(SrsRequest* req, int64_t es_bytes, int64_t ts_bytes)
+{
+    SrsStatisticStream* stream = create_stream(req);
+    
+    stream->hls_es_bytes = es_bytes;
+    stream->hls_ts_bytes = ts_bytes;
+}
+
+void SrsStatistic::on_ingest_latency(SrsRequest* req, srs_utime_t latency)
+{
+    SrsStatisticStream* stream = create_stream(req);
+    
+    // The clocks of servers maybe not synced.
+    stream->ingest_latency->observe(srs_max(0, latency));
+}
+
+void SrsStatistic::on_client_markers(SrsStatisticHandle handle, SrsSharedPtrMessage** msgs, int count)
+{
+    SrsStatisticClient* client = NULL;
+    srs_utime_t now = 0;
+    
+    for (int i = 0; i < count; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        
+        int64_t timestamp = 0;
+        if (!msg->is_video() || !SrsFlvVideo::marker(msg->payload, msg->size, &timestamp)) {
+            continue;
+        }
+        
+        if (!client) {
+            if ((client = resolve(handle)) == NULL) {
+                return;
+            }
+            now = srs_update_system_time();
+        }
+        
+        client->stream->play_latency->observe(srs_max(0, now - timestamp));
+    }
+}
+
+void SrsStatistic::kbps_add_delta(SrsStatisticClient* client)
+{
+    if (!client->conn) {
+        return;
+    }
+    
+    int64_t in = 0, out = 0;
+    client->conn->counters(&in, &out);
+    
+    int64_t delta_in = in - client->recv_bytes;
+    int64_t delta_out = out - client->send_bytes;
+    client->recv_bytes = in;
+    client->send_bytes = out;
     
     // add delta of connection to kbps.
     // for next sample() of server kbps can get the stat.
-    kbps->add_delta(in, out);
-    client->stream->kbps->add_delta(in, out);
-    client->stream->vhost->kbps->add_delta(in, out);
+    kbps->add_delta(delta_in, delta_out);
+    client->stream->kbps->add_delta(delta_in, delta_out);
+    client->stream->vhost->kbps->add_delta(delta_in, delta_out);
+}
+
+int SrsStatistic::get_client_stream_kbps(int id)
+{
+    SrsStatisticClient* client = find_client(id);
+    if (!client || !client->stream) {
+        return 0;
+    }
+    
+    // Use the larger one, because the 30s average is 0 for new stream.
+    SrsKbps* kbps = client->stream->kbps;
+    return srs_max(kbps->get_recv_kbps(), kbps->get_recv_kbps_30s());
 }
 
 SrsKbps* SrsStatistic::kbps_sample()
 {
+    srs_utime_t now = clk->now();
+    
+    // Collect the delta bytes of all clients, by the counters which need no sampling.
+    for (int i = 0; i < (int)slots.size(); i++) {
+        SrsStatisticClient* client = slots[i].client;
+        if (client) {
+            kbps_add_delta(client);
+        }
+    }
+    
     kbps->sample();
+    egress.sample(kbps->get_send_bytes(), now);
     if (true) {
         std::map<int64_t, SrsStatisticVhost*>::iterator it;
         for (it = vhosts.begin(); it != vhosts.end(); it++) {
             SrsStatisticVhost* vhost = it->second;
             vhost->kbps->sample();
+            vhost->egress.sample(vhost->kbps->get_send_bytes(), now);
         }
     }
     if (true) {
@@ -486,16 +985,51 @@ SrsKbps* SrsStatistic::kbps_sample()
             stream->kbps->sample();
         }
     }
+    if (true) {
+        std::map<SrsStreamKey*, SrsCpuStat*>::iterator it;
+        for (it = cpus.begin(); it != cpus.end(); it++) {
+            it->second->sample(now);
+        }
+    }
     
     return kbps;
 }
 
+bool SrsStatistic::admit_play(SrsRequest* req, int max_kbps, int share)
+{
+    SrsStatisticStream* stream = create_stream(req);
+    SrsStatisticVhost* vhost = stream->vhost;
+    
+    // The bitrate of stream, by the publisher for origin, or by the players for edge.
+    SrsKbps* skbps = stream->kbps;
+    int bitrate = srs_max(skbps->get_recv_kbps(), skbps->get_recv_kbps_30s());
+    if (bitrate <= 0 && stream->nb_clients > 0) {
+        bitrate = skbps->get_send_kbps_30s() / stream->nb_clients;
+    }
+    if (bitrate <= 0) {
+        bitrate = SRS_STAT_ADMISSION_BITRATE;
+    }
+    
+    int vhost_budget = (int)((int64_t)max_kbps * share / 100);
+    if (egress.exceed(bitrate, max_kbps) || vhost->egress.exceed(bitrate, vhost_budget)) {
+        nb_admission_rejects++;
+        srs_warn("admission reject %s, bitrate=%d, server=%d+%d/%d, vhost=%d+%d/%d", stream->url.c_str(), bitrate,
+            egress.kbps, egress.reserved, max_kbps, vhost->egress.kbps, vhost->egress.reserved, vhost_budget);
+        return false;
+    }
+    
+    egress.reserved += bitrate;
+    vhost->egress.reserved += bitrate;
+    
+    return true;
+}
+
 int64_t SrsStatistic::server_id()
 {
     return _server_id;
 }
 
-srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
+srs_error_t SrsStatistic::dumps_vhosts(SrsJsonWriter* jw)
 {
     srs_error_t err = srs_success;
     
@@ -503,10 +1037,7 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     for (it = vhosts.begin(); it != vhosts.end(); it++) {
         SrsStatisticVhost* vhost = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = vhost->dumps(obj)) != srs_success) {
+        if ((err = vhost->dumps(jw)) != srs_success) {
             return srs_error_wrap(err, "dump vhost");
         }
     }
@@ -514,7 +1045,7 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr)
+srs_error_t SrsStatistic::dumps_streams(SrsJsonWriter* jw)
 {
     srs_error_t err = srs_success;
     
@@ -522,10 +1053,7 @@ srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr)
     for (it = streams.begin(); it != streams.end(); it++) {
         SrsStatisticStream* stream = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = stream->dumps(obj)) != srs_success) {
+        if ((err = stream->dumps(jw)) != srs_success) {
             return srs_error_wrap(err, "dump stream");
         }
     }
@@ -533,66 +1061,209 @@ srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_clients(SrsJsonWriter* jw, int cursor, int start, int count, int* pnext)
 {
     srs_error_t err = srs_success;
     
-    std::map<int, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
-            continue;
+    *pnext = -1;
+    
+    // The clients are sorted by id, so we seek to the client after cursor in O(logN),
+    // rather than walk from the beginning for each page.
+    std::map<int, SrsStatisticClient*>::iterator it;
+    if (cursor >= 0) {
+        it = clients.upper_bound(cursor);
+    } else {
+        it = clients.begin();
+        for (int i = 0; i < start && it != clients.end(); i++) {
+            it++;
         }
-        
+    }
+    
+    for (int i = 0; i < count && it != clients.end(); it++, i++) {
         SrsStatisticClient* client = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = client->dumps(obj)) != srs_success) {
+        if ((err = client->dumps(jw)) != srs_success) {
             return srs_error_wrap(err, "dump client");
         }
+        
+        *pnext = client->id;
+    }
+    
+    // No more clients, the cursor is done.
+    if (it == clients.end()) {
+        *pnext = -1;
     }
     
     return err;
 }
 
-SrsStatisticVhost* SrsStatistic::create_vhost(SrsRequest* req)
+void SrsStatistic::dumps_metrics(stringstream& ss)
 {
-    SrsStatisticVhost* vhost = NULL;
+    ss << std::setprecision(6);
+    
+    // The streams to dump, ignore the inactive streams without clients.
+    std::vector<SrsStatisticStream*> active_streams;
+    std::vector<std::string> labels;
+    for (std::map<int64_t, SrsStatisticStream*>::iterator it = streams.begin(); it != streams.end(); it++) {
+        SrsStatisticStream* stream = it->second;
+        if (!stream->active && stream->nb_clients <= 0) {
+            continue;
+        }
+        
+        active_streams.push_back(stream);
+        labels.push_back("vhost=\"" + srs_metrics_escape(stream->vhost->vhost) + "\",app=\""
+            + srs_metrics_escape(stream->app) + "\",stream=\"" + srs_metrics_escape(stream->stream) + "\"");
+    }
+    
+    srs_metrics_family(ss, "srs_clients", "gauge", "The number of clients.");
+    ss << "srs_clients " << clients.size() << "\n";
+    
+    srs_metrics_family(ss, "srs_streams", "gauge", "The number of streams.");
+    ss << "srs_streams " << active_streams.size() << "\n";
+    
+    srs_metrics_family(ss, "srs_recv_bytes_total", "counter", "The bytes received by server.");
+    ss << "srs_recv_bytes_total " << kbps->get_recv_bytes() << "\n";
+    
+    srs_metrics_family(ss, "srs_send_bytes_total", "counter", "The bytes sent by server.");
+    ss << "srs_send_bytes_total " << kbps->get_send_bytes() << "\n";
+    
+    srs_metrics_family(ss, "srs_egress_kbps", "gauge", "The egress kbps of server, for admission control.");
+    ss << "srs_egress_kbps " << egress.kbps << "\n";
+    
+    srs_metrics_family(ss, "srs_admission_rejects_total", "counter", "The players rejected by admission control.");
+    ss << "srs_admission_rejects_total " << nb_admission_rejects << "\n";
+    
+    srs_metrics_family(ss, "srs_access_log_records_total", "counter", "The session records of access log.");
+    ss << "srs_access_log_records_total{result=\"written\"} " << _srs_access_log->records() << "\n";
+    ss << "srs_access_log_records_total{result=\"sampled\"} " << _srs_access_log->sampled() << "\n";
+    ss << "srs_access_log_records_total{result=\"limited\"} " << _srs_access_log->limited() << "\n";
+    ss << "srs_access_log_records_total{result=\"dropped\"} " << _srs_access_log->drops() << "\n";
+    
+    srs_metrics_family(ss, "srs_zerocopy_bytes_total", "counter", "The bytes sent by MSG_ZEROCOPY of players.");
+    ss << "srs_zerocopy_bytes_total{result=\"zerocopy\"} " << _srs_zerocopy->zerocopy_bytes << "\n";
+    ss << "srs_zerocopy_bytes_total{result=\"copied\"} " << _srs_zerocopy->copied_bytes << "\n";
+    ss << "srs_zerocopy_bytes_total{result=\"fallback\"} " << _srs_zerocopy->fallback_bytes << "\n";
+    
+    srs_metrics_family(ss, "srs_edge_token_traverse_total", "counter", "The token traverse of edge clients.");
+    ss << "srs_edge_token_traverse_total{result=\"hit\"} " << _srs_edge_tokens->hits() << "\n";
+    ss << "srs_edge_token_traverse_total{result=\"coalesced\"} " << _srs_edge_tokens->coalesced() << "\n";
+    ss << "srs_edge_token_traverse_total{result=\"miss\"} " << _srs_edge_tokens->misses() << "\n";
+    ss << "srs_edge_token_traverse_total{result=\"failed\"} " << _srs_edge_tokens->failures() << "\n";
+    
+    srs_metrics_family(ss, "srs_events_total", "counter", "The lifecycle events of streams and clients.");
+    ss << "srs_events_total " << _srs_events->events() << "\n";
+    
+    srs_metrics_family(ss, "srs_events_overflows_total", "counter", "The times of subscriber lost events for too slow.");
+    ss << "srs_events_overflows_total " << _srs_events->overflows() << "\n";
+    
+    srs_metrics_family(ss, "srs_events_subscribers", "gauge", "The number of subscribers of events.");
+    ss << "srs_events_subscribers " << _srs_events->subscribers() << "\n";
     
+    srs_metrics_family(ss, "srs_vhost_clients", "gauge", "The number of clients of vhost.");
+    for (std::map<int64_t, SrsStatisticVhost*>::iterator it = vhosts.begin(); it != vhosts.end(); it++) {
+        SrsStatisticVhost* vhost = it->second;
+        ss << "srs_vhost_clients{vhost=\"" << srs_metrics_escape(vhost->vhost) << "\"} " << vhost->nb_clients << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_clients", "gauge", "The number of clients of stream.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_clients{" << labels[i] << "} " << active_streams[i]->nb_clients << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_recv_bytes_total", "counter", "The bytes received of stream.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_recv_bytes_total{" << labels[i] << "} " << active_streams[i]->kbps->get_recv_bytes() << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_send_bytes_total", "counter", "The bytes sent of stream.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_send_bytes_total{" << labels[i] << "} " << active_streams[i]->kbps->get_send_bytes() << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_frames_total", "counter", "The video frames of stream.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_frames_total{" << labels[i] << "} " << active_streams[i]->nb_frames << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_drops_total", "counter", "The messages dropped by queue of consumers.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_drops_total{" << labels[i] << "} " << active_streams[i]->nb_drops << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_send_latency_seconds", "histogram", "The elapsed time to send messages to players.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        active_streams[i]->send_latency->dumps(ss, "srs_stream_send_latency_seconds", labels[i]);
+    }
+    
+    srs_metrics_family(ss, "srs_stream_queue_delay_seconds", "histogram", "The delay of messages in queue of players.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        active_streams[i]->queue_delay->dumps(ss, "srs_stream_queue_delay_seconds", labels[i]);
+    }
+    
+    srs_metrics_family(ss, "srs_stream_stall_seconds_total", "counter", "The time of players blocked to write the socket.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        ss << "srs_stream_stall_seconds_total{" << labels[i] << "} " << active_streams[i]->stall_time / 1000000.0 << "\n";
+    }
+    
+    srs_metrics_family(ss, "srs_stream_ttff_seconds", "histogram", "The time to first frame of players.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        active_streams[i]->ttff->dumps(ss, "srs_stream_ttff_seconds", labels[i]);
+    }
+    
+    srs_metrics_family(ss, "srs_stream_ingest_latency_seconds", "histogram", "The latency of video marked by timestamp, when got from upstream.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        active_streams[i]->ingest_latency->dumps(ss, "srs_stream_ingest_latency_seconds", labels[i]);
+    }
+    
+    srs_metrics_family(ss, "srs_stream_play_latency_seconds", "histogram", "The latency of video marked by timestamp, when sent to players.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        active_streams[i]->play_latency->dumps(ss, "srs_stream_play_latency_seconds", labels[i]);
+    }
+    
+    srs_metrics_family(ss, "srs_stream_edge_ttff_seconds", "gauge", "The time to first frame pulled from origin, for edge.");
+    for (int i = 0; i < (int)active_streams.size(); i++) {
+        if (active_streams[i]->edge_ttff >= 0) {
+            ss << "srs_stream_edge_ttff_seconds{" << labels[i] << "} " << active_streams[i]->edge_ttff / 1000000.0 << "\n";
+        }
+    }
+}
+
+SrsStatisticVhost* SrsStatistic::create_vhost(SrsRequest* req)
+{
     // create vhost if not exists.
-    if (rvhosts.find(req->vhost) == rvhosts.end()) {
-        vhost = new SrsStatisticVhost();
-        vhost->vhost = req->vhost;
-        rvhosts[req->vhost] = vhost;
-        vhosts[vhost->id] = vhost;
-        return vhost;
+    std::map<string, SrsStatisticVhost*>::iterator it = rvhosts.find(req->vhost);
+    if (it != rvhosts.end()) {
+        return it->second;
     }
     
-    vhost = rvhosts[req->vhost];
+    SrsStatisticVhost* vhost = new SrsStatisticVhost();
+    vhost->vhost = req->vhost;
+    rvhosts[req->vhost] = vhost;
+    vhosts[vhost->id] = vhost;
     
     return vhost;
 }
 
-SrsStatisticStream* SrsStatistic::create_stream(SrsStatisticVhost* vhost, SrsRequest* req)
+SrsStatisticStream* SrsStatistic::create_stream(SrsRequest* req)
 {
-    std::string url = req->get_stream_url();
+    SrsStreamKey* key = req->get_stream_key();
     
-    SrsStatisticStream* stream = NULL;
-    
-    // create stream if not exists.
-    if (rstreams.find(url) == rstreams.end()) {
-        stream = new SrsStatisticStream();
-        stream->vhost = vhost;
-        stream->stream = req->stream;
-        stream->app = req->app;
-        stream->url = url;
-        rstreams[url] = stream;
-        streams[stream->id] = stream;
-        return stream;
+    // create stream if not exists, the vhost is only required for new stream.
+    std::map<SrsStreamKey*, SrsStatisticStream*>::iterator it = rstreams.find(key);
+    if (it != rstreams.end()) {
+        return it->second;
     }
     
-    stream = rstreams[url];
+    SrsStatisticStream* stream = new SrsStatisticStream();
+    stream->vhost = create_vhost(req);
+    stream->stream = req->stream;
+    stream->app = req->app;
+    stream->url = key->url;
+    stream->key = key;
+    stream->memory = fetch_memory(req);
+    stream->cpu = fetch_cpu(req);
+    rstreams[key] = stream;
+    streams[stream->id] = stream;
     
     return stream;
 }
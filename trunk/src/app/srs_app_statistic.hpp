@@ -28,6 +28,7 @@
 
 #include <map>
 #include <string>
+#include <sstream>
 #include <vector>
 
 #include <srs_kernel_codec.hpp>
@@ -36,9 +37,66 @@
 class SrsKbps;
 class SrsWallClock;
 class SrsRequest;
+class SrsStreamKey;
 class SrsConnection;
-class SrsJsonObject;
-class SrsJsonArray;
+class SrsJsonWriter;
+class SrsSharedPtrMessage;
+class SrsMemoryStat;
+class SrsMemoryUsage;
+class SrsCpuStat;
+
+// The buckets of histogram, the last one is +Inf.
+#define SRS_STAT_HISTOGRAM_BUCKETS 9
+
+// The bitrate in kbps of stream for admission control when unknown, for example, the first player of edge.
+#define SRS_STAT_ADMISSION_BITRATE 1000
+
+// The handle of client in the slot table of statistic, held by the connection to update the stat
+// without lookup, where the high 32 bits is the generation of slot, and the low 32 bits is the slot.
+// @remark The handle is stale when the client disconnects, because the generation of slot changes.
+typedef uint64_t SrsStatisticHandle;
+
+// The histogram in fixed buckets, updated incrementally, for the metrics in text exposition format.
+struct SrsStatisticHistogram
+{
+public:
+    // The count of each bucket, not cumulative.
+    int64_t buckets[SRS_STAT_HISTOGRAM_BUCKETS];
+    int64_t count;
+    srs_utime_t sum;
+public:
+    SrsStatisticHistogram();
+    virtual ~SrsStatisticHistogram();
+public:
+    // Observe a value, which is put to the first bucket not less than it.
+    virtual void observe(srs_utime_t v);
+    // Get the percentile in [0, 1], which is the upper bound of bucket, so it's no less than the value.
+    // @remark The largest bound is used for the last bucket, and 0 if no value.
+    virtual srs_utime_t percentile(double p);
+    // Dumps the histogram of name with labels in text exposition format, in seconds.
+    virtual void dumps(std::stringstream& ss, std::string name, std::string labels);
+};
+
+// The egress of server or vhost, for the admission control of players.
+struct SrsStatisticEgress
+{
+public:
+    // The send bytes and time of last sample.
+    int64_t bytes;
+    srs_utime_t time;
+    // The send kbps between the last two samples.
+    int kbps;
+    // The bitrate in kbps reserved for the players admitted after the last sample.
+    int reserved;
+public:
+    SrsStatisticEgress();
+    virtual ~SrsStatisticEgress();
+public:
+    // Sample the egress by the total send bytes, and reset the reserved.
+    virtual void sample(int64_t send_bytes, srs_utime_t now);
+    // Whether exceed the budget in kbps when admit a player of bitrate, 0 budget for no limit.
+    virtual bool exceed(int bitrate, int budget);
+};
 
 struct SrsStatisticVhost
 {
@@ -51,11 +109,15 @@ public:
     // The vhost total kbps.
     SrsKbps* kbps;
     SrsWallClock* clk;
+    // The egress of players of vhost.
+    SrsStatisticEgress egress;
+    // The bytes of this object, reported to the memory stat.
+    SrsMemoryUsage* usage;
 public:
     SrsStatisticVhost();
     virtual ~SrsStatisticVhost();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* jw);
 };
 
 struct SrsStatisticStream
@@ -66,10 +128,37 @@ public:
     std::string app;
     std::string stream;
     std::string url;
+    // The interned key of stream url.
+    SrsStreamKey* key;
     bool active;
     int connection_cid;
     int nb_clients;
     uint64_t nb_frames;
+    // The messages dropped by the queue of consumers, when overflow.
+    int64_t nb_drops;
+    // The elapsed time to send out the messages, for play clients.
+    SrsStatisticHistogram* send_latency;
+    // The queue delay of players, and the total time and number of stalls to write to players.
+    SrsStatisticHistogram* queue_delay;
+    srs_utime_t stall_time;
+    int64_t nn_stalls;
+    // The time to first frame of play clients, from the client connected to the first video frame sent.
+    SrsStatisticHistogram* ttff;
+    // For edge, the time to first frame pulled from origin, since the edge starts to ingest, -1 if none.
+    srs_utime_t edge_ttff;
+    // The latency from the video marked by timestamp, to the source got it from upstream.
+    SrsStatisticHistogram* ingest_latency;
+    // The latency from the video marked by timestamp, to the message sent to play clients.
+    SrsStatisticHistogram* play_latency;
+    // The memory held by the source of stream, owned by the statistic.
+    SrsMemoryStat* memory;
+    // The CPU cost of stream, owned by the statistic.
+    SrsCpuStat* cpu;
+    // The bytes of media payload and ts packets of hls, for the overhead of ts.
+    int64_t hls_es_bytes;
+    int64_t hls_ts_bytes;
+    // The bytes of this object, reported to the memory stat.
+    SrsMemoryUsage* usage;
 public:
     // The stream total kbps.
     SrsKbps* kbps;
@@ -98,7 +187,7 @@ public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* jw);
 public:
     // Publish the stream.
     virtual void publish(int cid);
@@ -115,11 +204,38 @@ public:
     SrsRtmpConnType type;
     int id;
     srs_utime_t create;
+    // The number of chunks whose cid is not in the chunk stream cache.
+    int64_t nb_cs_misses;
+    // The messages dropped by player queue, and the video frames dropped for slow consumer.
+    int64_t nb_drops;
+    int64_t nb_frame_drops;
+    // The time to first frame for player, -1 if no video frame sent.
+    srs_utime_t ttff;
+    // The queue delay of player, that is how long the messages wait in queue before sent.
+    SrsStatisticHistogram* queue_delay;
+    // The total time and number of stalls to write, that player is slower than the stream.
+    srs_utime_t stall_time;
+    int64_t nn_stalls;
+    // The total bytes of conn when aggregated last time, to get the delta by the counters of conn.
+    int64_t recv_bytes;
+    int64_t send_bytes;
+    // The index in the slot table of clients.
+    int slot;
+    // The bytes of this object and its request, reported to the memory stat.
+    SrsMemoryUsage* usage;
 public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* jw);
+};
+
+// The slot of client table, reused by the clients.
+struct SrsStatisticSlot
+{
+    SrsStatisticClient* client;
+    // Increased when the slot is allocated or freed, so the stale handle never resolves.
+    uint32_t generation;
 };
 
 class SrsStatistic
@@ -137,15 +253,29 @@ private:
 private:
     // The key: stream id, value: stream Object.
     std::map<int64_t, SrsStatisticStream*> streams;
-    // The key: stream url, value: stream Object.
+    // The key: interned key of stream url, value: stream Object.
     // @remark a fast index for streams.
-    std::map<std::string, SrsStatisticStream*> rstreams;
+    std::map<SrsStreamKey*, SrsStatisticStream*> rstreams;
+    // The key: interned key of stream url, value: the memory stat of stream.
+    // @remark Never removed, because the source is never freed before server quit.
+    std::map<SrsStreamKey*, SrsMemoryStat*> memories;
+    // The key: interned key of stream url, value: the CPU stat of stream.
+    // @remark Never removed, because the coroutines may still account to it.
+    std::map<SrsStreamKey*, SrsCpuStat*> cpus;
 private:
     // The key: client id, value: stream object.
+    // @remark The index of id for API, sorted to dump clients by pages.
     std::map<int, SrsStatisticClient*> clients;
+    // The slot table of clients, to update the client by handle in O(1), and aggregate the bytes
+    // of all clients in one pass. The free slots are reused by new clients.
+    std::vector<SrsStatisticSlot> slots;
+    std::vector<int> free_slots;
     // The server total kbps.
     SrsKbps* kbps;
     SrsWallClock* clk;
+    // The egress of server, and the number of players rejected by admission control.
+    SrsStatisticEgress egress;
+    int64_t nb_admission_rejects;
 private:
     SrsStatistic();
     virtual ~SrsStatistic();
@@ -155,7 +285,13 @@ public:
     virtual SrsStatisticVhost* find_vhost(int vid);
     virtual SrsStatisticVhost* find_vhost(std::string name);
     virtual SrsStatisticStream* find_stream(int sid);
+    virtual SrsStatisticStream* find_stream_by_url(std::string url);
     virtual SrsStatisticClient* find_client(int cid);
+    // Get the handle of client, for the connection to update the stat in O(1), 0 if not found.
+    virtual SrsStatisticHandle find_handle(int cid);
+private:
+    // Resolve the handle to client, NULL if stale.
+    virtual SrsStatisticClient* resolve(SrsStatisticHandle handle);
 public:
     // When got video info for stream.
     virtual srs_error_t on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile,
@@ -163,15 +299,24 @@ public:
     // When got audio info for stream.
     virtual srs_error_t on_audio_info(SrsRequest* req, SrsAudioCodecId acodec, SrsAudioSampleRate asample_rate,
         SrsAudioChannels asound_type, SrsAacObjectType aac_object);
-    // When got videos, update the frames.
+    // When publisher got videos, update the frames of its stream.
     // We only stat the total number of video frames.
-    virtual srs_error_t on_video_frames(SrsRequest* req, int nb_frames);
+    // @param handle, the handle of publisher client.
+    virtual srs_error_t on_video_frames(SrsStatisticHandle handle, int nb_frames);
+    // When got chunks of publisher not in the chunk stream cache.
+    // @param handle, the handle of client.
+    // @param nb_misses, the total number of misses of client.
+    virtual void on_chunk_stream_misses(SrsStatisticHandle handle, int64_t nb_misses);
     // When publish stream.
     // @param req the request object of publish connection.
     // @param cid the cid of publish connection.
     virtual void on_stream_publish(SrsRequest* req, int cid);
     // When close stream.
     virtual void on_stream_close(SrsRequest* req);
+    // Fetch or create the memory stat of stream, for the source to report the bytes it holds.
+    virtual SrsMemoryStat* fetch_memory(SrsRequest* req);
+    // Fetch or create the CPU stat of stream, for the source and players to account the cycles.
+    virtual SrsCpuStat* fetch_cpu(SrsRequest* req);
 public:
     // When got a client to publish/play stream,
     // @param id, the client srs id.
@@ -184,28 +329,64 @@ public:
     //      only got the request object, so the client specified by id maybe not
     //      exists in stat.
     virtual void on_disconnect(int id);
-    // Sample the kbps, add delta bytes of conn.
-    // Use kbps_sample() to get all result of kbps stat.
-    // TODO: FIXME: the add delta must use ISrsKbpsDelta interface instead.
-    virtual void kbps_add_delta(SrsConnection* conn);
-    // Calc the result for all kbps.
+    // Get the bitrate of stream which the client publish or play, in kbps.
+    // @return The recv kbps of stream, or 0 if client not found.
+    virtual int get_client_stream_kbps(int id);
+    // When consumer of stream drops messages, for queue overflow.
+    virtual void on_queue_drops(SrsRequest* req, int nb_msgs);
+    // When the queue of player drops messages, the total drops of shrink and adaptive frame dropping.
+    virtual void on_client_drops(int id, int64_t nb_drops, int64_t nb_frame_drops);
+    // When client sent messages out, the elapsed time of send.
+    virtual void on_send_latency(SrsStatisticHandle handle, srs_utime_t elapsed);
+    // When client sent messages out, the queue delay of messages, and the total stalls of conn to write.
+    // @param delay The queue delay of the dump, @see SrsConsumer::delay
+    // @param stall_time The total stall time of conn, @see SrsConnection::stalls
+    virtual void on_client_delays(SrsStatisticHandle handle, srs_utime_t delay, srs_utime_t stall_time, int64_t nn_stalls);
+    // When client is about to send the messages, stat the time to first frame.
+    // @return Whether the ttff is done, so the caller never need to call it again.
+    virtual bool on_client_frames(SrsStatisticHandle handle, SrsSharedPtrMessage** msgs, int count);
+    // When edge got the first video frame from origin, the elapsed time since start to ingest.
+    virtual void on_edge_ttff(SrsRequest* req, srs_utime_t elapsed);
+    // When source got the video marked by timestamp from upstream, the latency to the marker.
+    virtual void on_ingest_latency(SrsRequest* req, srs_utime_t latency);
+    // When hls segment closed, with the total bytes of media payload and ts packets of the stream.
+    virtual void on_hls_bytes(SrsRequest* req, int64_t es_bytes, int64_t ts_bytes);
+    // When client is about to send the messages, stat the latency of videos marked by timestamp.
+    virtual void on_client_markers(SrsStatisticHandle handle, SrsSharedPtrMessage** msgs, int count);
+    // Aggregate the delta bytes of all clients to the streams, vhosts and server, by the plain counters
+    // of conns in one pass, then calc the result for all kbps.
     // @return the server kbps.
     virtual SrsKbps* kbps_sample();
+private:
+    // Add the delta bytes of client, since last aggregation, to its stream, vhost and server.
+    virtual void kbps_add_delta(SrsStatisticClient* client);
+public:
+    // Whether admit the new player of stream, by the egress of server and vhost against the budget,
+    // and reserve the bitrate of stream for the player until next sample.
+    // @param max_kbps The egress budget of server, 0 for no limit.
+    // @param share The percent of budget for the vhost, 0 for no limit.
+    virtual bool admit_play(SrsRequest* req, int max_kbps, int share);
 public:
     // Get the server id, used to identify the server.
     // For example, when restart, the server id must changed.
     virtual int64_t server_id();
-    // Dumps the vhosts to amf0 array.
-    virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
-    // Dumps the streams to amf0 array.
-    virtual srs_error_t dumps_streams(SrsJsonArray* arr);
-    // Dumps the clients to amf0 array
-    // @param start the start index, from 0.
+    // Dumps the vhosts as elements of json array, to the writer.
+    virtual srs_error_t dumps_vhosts(SrsJsonWriter* jw);
+    // Dumps the streams as elements of json array, to the writer.
+    virtual srs_error_t dumps_streams(SrsJsonWriter* jw);
+    // Dumps the clients as elements of json array, to the writer.
+    // @param cursor the id of last client of previous page, -1 to use start instead.
+    // @param start the start index, from 0, ignored if cursor is specified.
     // @param count the max count of clients to dump.
-    virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    // @param pnext output the cursor for next page, -1 if no more clients.
+    virtual srs_error_t dumps_clients(SrsJsonWriter* jw, int cursor, int start, int count, int* pnext);
+    // Dumps the metrics in text exposition format of prometheus,
+    // from the counters kept incrementally, without building json objects.
+    virtual void dumps_metrics(std::stringstream& ss);
 private:
     virtual SrsStatisticVhost* create_vhost(SrsRequest* req);
-    virtual SrsStatisticStream* create_stream(SrsStatisticVhost* vhost, SrsRequest* req);
+    // Fetch or create the stream, and its vhost, by the interned key of stream.
+    virtual SrsStatisticStream* create_stream(SrsRequest* req);
 };
 
 #endif
@@ -79,9 +79,9 @@ void SrsCoroutineManager::remove(ISrsConnection* c)
 void SrsCoroutineManager::clear()
 {
     // To prevent thread switch when delete connection,
-    // we copy all connections then free one by one.
-    vector<ISrsConnection*> copy = conns;
-    conns.clear();
+    // we swap all connections out then free one by one.
+    vector<ISrsConnection*> copy;
+    copy.swap(conns);
     
     vector<ISrsConnection*>::iterator it;
     for (it = copy.begin(); it != copy.end(); ++it) {
@@ -0,0 +1,356 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <srs_app_upgrade.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <signal.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+
+SrsGracefulUpgrade* _srs_upgrade = new SrsGracefulUpgrade();
+
+// The max wait for the new process to listen, for example, to load config and start.
+#define SRS_UPGRADE_READY_TIMEOUT (30 * SRS_UTIME_SECONDS)
+
+// The record of a listener passed over unix socket, with the fd by SCM_RIGHTS.
+// The record with empty endpoint and no fd, is the end of listeners.
+struct SrsUpgradeRecord
+{
+    char endpoint[128];
+};
+
+// The ack of new process, when all listeners are ready.
+#define SRS_UPGRADE_READY 'R'
+
+SrsGracefulUpgrade::SrsGracefulUpgrade()
+{
+    channel = -1;
+    pid = -1;
+}
+
+SrsGracefulUpgrade::~SrsGracefulUpgrade()
+{
+    map<string, int>::iterator it;
+    for (it = fds.begin(); it != fds.end(); ++it) {
+        ::close(it->second);
+    }
+    fds.clear();
+    
+    if (channel >= 0) {
+        ::close(channel);
+    }
+}
+
+void SrsGracefulUpgrade::set_argv(int argc, char** argv)
+{
+    args.clear();
+    for (int i = 0; i < argc; i++) {
+        args.push_back(argv[i]);
+    }
+    
+    // The relative binary and config is resolved by the startup cwd, before chdir to work_dir.
+    char buf[1024];
+    if (::getcwd(buf, sizeof(buf))) {
+        cwd = buf;
+    }
+}
+
+bool SrsGracefulUpgrade::upgrading()
+{
+    return channel >= 0 || ::getenv(SRS_UPGRADE_FD_ENV) != NULL;
+}
+
+srs_error_t SrsGracefulUpgrade::inherit()
+{
+    srs_error_t err = srs_success;
+    
+    char* v = ::getenv(SRS_UPGRADE_FD_ENV);
+    if (!v) {
+        return err;
+    }
+    
+    // Never pass to the child processes, for example, the ffmpeg.
+    channel = ::atoi(v);
+    ::unsetenv(SRS_UPGRADE_FD_ENV);
+    
+    if ((err = srs_fd_closeexec(channel)) != srs_success) {
+        return srs_error_wrap(err, "closeexec channel=%d", channel);
+    }
+    
+    while (true) {
+        SrsUpgradeRecord record;
+        
+        char cbuf[CMSG_SPACE(sizeof(int))];
+        iovec iov;
+        iov.iov_base = &record;
+        iov.iov_len = sizeof(record);
+        
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+        
+        ssize_t nn = ::recvmsg(channel, &msg, 0);
+        if (nn < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nn != (ssize_t)sizeof(record)) {
+            return srs_error_new(ERROR_SYSTEM_UPGRADE, "recv listener, nn=%d", (int)nn);
+        }
+        
+        record.endpoint[sizeof(record.endpoint) - 1] = 0;
+        string endpoint = record.endpoint;
+        if (endpoint.empty()) {
+            break;
+        }
+        
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            return srs_error_new(ERROR_SYSTEM_UPGRADE, "no fd for %s", endpoint.c_str());
+        }
+        
+        int fd = -1;
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        
+        // The received fd is not closeexec.
+        if ((err = srs_fd_closeexec(fd)) != srs_success) {
+            ::close(fd);
+            return srs_error_wrap(err, "closeexec fd=%d", fd);
+        }
+        
+        if (fds.find(endpoint) != fds.end()) {
+            ::close(fds[endpoint]);
+        }
+        fds[endpoint] = fd;
+    }
+    
+    srs_trace("upgrade inherit %d listeners from channel=%d", (int)fds.size(), channel);
+    
+    return err;
+}
+
+int SrsGracefulUpgrade::fetch(string endpoint)
+{
+    map<string, int>::iterator it = fds.find(endpoint);
+    if (it == fds.end()) {
+        return -1;
+    }
+    
+    int fd = it->second;
+    fds.erase(it);
+    
+    srs_trace("upgrade listen at inherited %s, fd=%d", endpoint.c_str(), fd);
+    return fd;
+}
+
+srs_error_t SrsGracefulUpgrade::ready()
+{
+    srs_error_t err = srs_success;
+    
+    if (channel < 0) {
+        return err;
+    }
+    
+    // The listeners which are not used, for example, the port is changed by config.
+    map<string, int>::iterator it;
+    for (it = fds.begin(); it != fds.end(); ++it) {
+        srs_warn("upgrade close unused %s, fd=%d", it->first.c_str(), it->second);
+        ::close(it->second);
+    }
+    fds.clear();
+    
+    char ack = SRS_UPGRADE_READY;
+    ssize_t nn = ::write(channel, &ack, 1);
+    
+    ::close(channel);
+    channel = -1;
+    
+    if (nn != 1) {
+        return srs_error_new(ERROR_SYSTEM_UPGRADE, "notify ready");
+    }
+    
+    srs_trace("upgrade ready, notify old process to stop accepting");
+    
+    return err;
+}
+
+srs_error_t SrsGracefulUpgrade::upgrade(vector<string>& endpoints, vector<int>& lfds)
+{
+    srs_error_t err = srs_success;
+    
+    if (args.empty()) {
+        return srs_error_new(ERROR_SYSTEM_UPGRADE, "no argv");
+    }
+    
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        return srs_error_new(ERROR_SYSTEM_UPGRADE, "socketpair");
+    }
+    
+    pid_t child = ::fork();
+    if (child < 0) {
+        ::close(sv[0]);
+        ::close(sv[1]);
+        return srs_error_new(ERROR_SYSTEM_UPGRADE, "fork");
+    }
+    
+    // The new process, the listeners and connections are closed by exec for closeexec.
+    if (child == 0) {
+        ::close(sv[0]);
+        exec_child(sv[1]);
+        ::_exit(-1);
+    }
+    
+    ::close(sv[1]);
+    pid = child;
+    srs_trace("upgrade exec %s, pid=%d, listeners=%d", args[0].c_str(), child, (int)lfds.size());
+    
+    if ((err = srs_fd_closeexec(sv[0])) != srs_success) {
+        ::close(sv[0]);
+        return srs_error_wrap(err, "closeexec");
+    }
+    
+    // The socket buffer is enough for listeners, so never block.
+    if ((err = send_listeners(sv[0], endpoints, lfds)) != srs_success) {
+        ::close(sv[0]);
+        return srs_error_wrap(err, "send listeners");
+    }
+    
+    srs_netfd_t stfd = srs_netfd_open_socket(sv[0]);
+    if (!stfd) {
+        ::close(sv[0]);
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "open channel");
+    }
+    
+    err = wait_ready(stfd);
+    srs_close_stfd(stfd);
+    
+    // Never run two servers, for example, the new process hangs when loading config.
+    if (err != srs_success) {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, NULL, 0);
+        pid = -1;
+        return srs_error_wrap(err, "wait ready");
+    }
+    
+    return err;
+}
+
+void SrsGracefulUpgrade::reap()
+{
+    if (pid <= 0) {
+        return;
+    }
+    
+    int status = 0;
+    if (::waitpid(pid, &status, WNOHANG) == pid) {
+        srs_trace("upgrade reap pid=%d, status=%d", pid, status);
+        pid = -1;
+    }
+}
+
+void SrsGracefulUpgrade::exec_child(int fd)
+{
+    ::setenv(SRS_UPGRADE_FD_ENV, srs_int2str(fd).c_str(), 1);
+    
+    if (!cwd.empty() && ::chdir(cwd.c_str()) == -1) {
+        return;
+    }
+    
+    vector<char*> argv;
+    for (int i = 0; i < (int)args.size(); i++) {
+        argv.push_back((char*)args[i].c_str());
+    }
+    argv.push_back(NULL);
+    
+    ::execv(argv[0], &argv[0]);
+}
+
+srs_error_t SrsGracefulUpgrade::send_listeners(int fd, vector<string>& endpoints, vector<int>& lfds)
+{
+    srs_error_t err = srs_success;
+    
+    // The listeners, and the empty record without fd as the end.
+    for (int i = 0; i <= (int)lfds.size(); i++) {
+        SrsUpgradeRecord record;
+        memset(&record, 0, sizeof(record));
+        
+        iovec iov;
+        iov.iov_base = &record;
+        iov.iov_len = sizeof(record);
+        
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        
+        char cbuf[CMSG_SPACE(sizeof(int))];
+        if (i < (int)lfds.size()) {
+            int lfd = lfds[i];
+            snprintf(record.endpoint, sizeof(record.endpoint), "%s", endpoints[i].c_str());
+            
+            msg.msg_control = cbuf;
+            msg.msg_controllen = sizeof(cbuf);
+            
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &lfd, sizeof(int));
+        }
+        
+        if (::sendmsg(fd, &msg, 0) != (ssize_t)sizeof(record)) {
+            return srs_error_new(ERROR_SYSTEM_UPGRADE, "send %s", record.endpoint);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsGracefulUpgrade::wait_ready(srs_netfd_t stfd)
+{
+    srs_error_t err = srs_success;
+    
+    // Closed when the new process failed, for example, the config is invalid.
+    char ack = 0;
+    ssize_t nn = srs_read(stfd, &ack, 1, SRS_UPGRADE_READY_TIMEOUT);
+    if (nn != 1 || ack != SRS_UPGRADE_READY) {
+        return srs_error_new(ERROR_SYSTEM_UPGRADE, "new process failed, nn=%d", (int)nn);
+    }
+    
+    return err;
+}
+
@@ -0,0 +1,97 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SRS_APP_UPGRADE_HPP
+#define SRS_APP_UPGRADE_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <sys/types.h>
+
+#include <srs_service_st.hpp>
+
+// The environment of the unix socket fd, to pass the listeners to the new process.
+#define SRS_UPGRADE_FD_ENV "SRS_UPGRADE_FD"
+
+// For gracefully upgrade, the old process execs the new binary and passes its listeners to it
+// over a unix socket, then stops accepting and drains the connections, while the new process
+// accepts immediately on the same sockets, so the clients never see the listeners closed.
+// @remark Not supported for multiple workers, which share the listen port by SO_REUSEPORT.
+class SrsGracefulUpgrade
+{
+private:
+    // The argv of process, to exec the new binary by the same command line.
+    std::vector<std::string> args;
+    // The cwd of startup, to exec the new binary in.
+    std::string cwd;
+    // For new process, the unix socket to the old process, -1 if not upgrade.
+    int channel;
+    // For new process, the inherited listeners, the key is the endpoint, for example,
+    // tcp://0.0.0.0:1935, the value is the fd.
+    std::map<std::string, int> fds;
+    // For old process, the pid of new process, which never daemonizes, so it's the pid to kill when
+    // fail to upgrade, or to reap when it exits before the old process.
+    pid_t pid;
+public:
+    SrsGracefulUpgrade();
+    virtual ~SrsGracefulUpgrade();
+public:
+    // Save the argv of process, which should be called in main.
+    virtual void set_argv(int argc, char** argv);
+// For the new process.
+public:
+    // Whether started by upgrade, which never daemonizes, because the old process already did it,
+    // and it must keep the pid which the old process waits on.
+    virtual bool upgrading();
+    // Receive the listeners from old process, if started by upgrade.
+    // @remark Ignore if SRS_UPGRADE_FD is not set, that is, not started by upgrade.
+    virtual srs_error_t inherit();
+    // Fetch the inherited fd of listener, -1 if not found. The fd is owned by caller.
+    virtual int fetch(std::string endpoint);
+    // Notify the old process to stop accepting, when all listeners are ready.
+    // @remark The left inherited fds are closed, for example, the listen port is removed.
+    virtual srs_error_t ready();
+// For the old process.
+public:
+    // Exec the new binary and pass the listeners to it, then wait for it to be ready.
+    // @param endpoints The endpoint of each listener, for example, tcp://0.0.0.0:1935
+    // @param lfds The fd of each listener.
+    // @remark User should release the pid file before upgrade, for new process to acquire it.
+    virtual srs_error_t upgrade(std::vector<std::string>& endpoints, std::vector<int>& lfds);
+    // Reap the new process, if it exits while the old process is draining.
+    virtual void reap();
+private:
+    virtual void exec_child(int fd);
+    virtual srs_error_t send_listeners(int fd, std::vector<std::string>& endpoints, std::vector<int>& lfds);
+    virtual srs_error_t wait_ready(srs_netfd_t stfd);
+};
+
+extern SrsGracefulUpgrade* _srs_upgrade;
+
+#endif
+
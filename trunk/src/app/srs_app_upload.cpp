@@ -0,0 +1,634 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_upload.hpp>
+
+#include <unistd.h>
+#include <time.h>
+#include <sstream>
+using namespace std;
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_hls.hpp>
+
+// Convert the data to hex in lowercase, which is required by AWS SigV4.
+static string srs_upload_hex(const char* data, int size)
+{
+    static const char* table = "0123456789abcdef";
+    
+    string v;
+    v.reserve(size * 2);
+    for (int i = 0; i < size; i++) {
+        uint8_t c = (uint8_t)data[i];
+        v.push_back(table[c >> 4]);
+        v.push_back(table[c & 0x0f]);
+    }
+    return v;
+}
+
+SrsS3Signer::SrsS3Signer(string ak, string sk, string r)
+{
+    access_key = ak;
+    secret_key = sk;
+    region = r;
+}
+
+SrsS3Signer::~SrsS3Signer()
+{
+}
+
+string SrsS3Signer::sign(string method, string path, string query, map<string, string>& headers, string payload)
+{
+    string date = headers["x-amz-date"];
+    string day = date.substr(0, 8);
+    
+    // The canonical headers are sorted by name, for the map is ordered.
+    std::stringstream canonical_headers;
+    std::stringstream signed_headers;
+    for (map<string, string>::iterator it = headers.begin(); it != headers.end(); ++it) {
+        canonical_headers << it->first << ":" << srs_string_trim_start(srs_string_trim_end(it->second, " "), " ") << "\n";
+        signed_headers << (it == headers.begin()? "" : ";") << it->first;
+    }
+    
+    std::stringstream creq;
+    creq << method << "\n" << path << "\n" << query << "\n"
+        << canonical_headers.str() << "\n" << signed_headers.str() << "\n" << payload;
+    string canonical = creq.str();
+    
+    string scope = day + "/" + region + "/s3/aws4_request";
+    string sts = "AWS4-HMAC-SHA256\n" + date + "\n" + scope + "\n" + sha256(canonical.data(), (int)canonical.length());
+    
+    string key = hmac_sha256("AWS4" + secret_key, day);
+    key = hmac_sha256(key, region);
+    key = hmac_sha256(key, "s3");
+    key = hmac_sha256(key, "aws4_request");
+    
+    string signature = hmac_sha256(key, sts);
+    signature = srs_upload_hex(signature.data(), (int)signature.length());
+    
+    return "AWS4-HMAC-SHA256 Credential=" + access_key + "/" + scope
+        + ",SignedHeaders=" + signed_headers.str() + ",Signature=" + signature;
+}
+
+string SrsS3Signer::sha256(const char* data, int size)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int nn_digest = 0;
+    if (EVP_Digest(data, size, digest, &nn_digest, EVP_sha256(), NULL) != 1) {
+        return "";
+    }
+    return srs_upload_hex((const char*)digest, (int)nn_digest);
+}
+
+string SrsS3Signer::hmac_sha256(string key, string data)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int nn_digest = 0;
+    if (!HMAC(EVP_sha256(), key.data(), (int)key.length(), (const unsigned char*)data.data(), data.length(), digest, &nn_digest)) {
+        return "";
+    }
+    return string((const char*)digest, nn_digest);
+}
+
+string SrsS3Signer::amz_date(time_t t)
+{
+    struct tm tm;
+    if (!gmtime_r(&t, &tm)) {
+        return "";
+    }
+    
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y%m%dT%H%M%SZ", &tm);
+    return buf;
+}
+
+string SrsS3Signer::uri_encode(string v, bool slash)
+{
+    static const char* table = "0123456789ABCDEF";
+    
+    string r;
+    for (int i = 0; i < (int)v.length(); i++) {
+        uint8_t c = (uint8_t)v.at(i);
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+            || c == '-' || c == '_' || c == '.' || c == '~' || (slash && c == '/')) {
+            r.push_back(c);
+            continue;
+        }
+        r.push_back('%');
+        r.push_back(table[c >> 4]);
+        r.push_back(table[c & 0x0f]);
+    }
+    return r;
+}
+
+SrsUploadTarget::SrsUploadTarget()
+{
+    port = SRS_CONSTS_HTTP_DEFAULT_PORT;
+    retries = 0;
+    part_size = 0;
+}
+
+SrsUploadTarget::~SrsUploadTarget()
+{
+}
+
+srs_error_t SrsUploadTarget::initialize(string endpoint)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpUri uri;
+    if ((err = uri.initialize(endpoint)) != srs_success) {
+        return srs_error_wrap(err, "parse endpoint %s", endpoint.c_str());
+    }
+    
+    host = uri.get_host();
+    port = uri.get_port();
+    bucket = srs_string_trim_end(srs_string_trim_start(uri.get_path(), "/"), "/");
+    
+    if (host.empty() || bucket.empty()) {
+        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid endpoint %s, should be http://host:port/bucket", endpoint.c_str());
+    }
+    
+    return err;
+}
+
+SrsUploadTask::SrsUploadTask()
+{
+    file = NULL;
+    unlink = false;
+    coalesce = false;
+}
+
+SrsUploadTask::~SrsUploadTask()
+{
+    srs_freep(file);
+}
+
+SrsUploadLane::SrsUploadLane(SrsUploader* u)
+{
+    uploader = u;
+    trd = new SrsDummyCoroutine();
+    cond = srs_cond_new();
+}
+
+SrsUploadLane::~SrsUploadLane()
+{
+    srs_freep(trd);
+    
+    std::list<SrsUploadTask*>::iterator it;
+    for (it = tasks.begin(); it != tasks.end(); ++it) {
+        SrsUploadTask* task = *it;
+        srs_freep(task);
+    }
+    tasks.clear();
+    
+    srs_cond_destroy(cond);
+}
+
+srs_error_t SrsUploadLane::start()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("upload", this);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    return err;
+}
+
+bool SrsUploadLane::push(SrsUploadTask* task, bool* pcoalesced)
+{
+    *pcoalesced = false;
+    
+    // Replace the pending playlist, and append the new one after the pending segments, to keep the order.
+    if (task->coalesce) {
+        std::list<SrsUploadTask*>::iterator it;
+        for (it = tasks.begin(); it != tasks.end(); ++it) {
+            SrsUploadTask* pending = *it;
+            if (pending->coalesce && pending->key == task->key) {
+                srs_freep(pending);
+                tasks.erase(it);
+                *pcoalesced = true;
+                break;
+            }
+        }
+    }
+    
+    if (tasks.size() >= SRS_UPLOAD_MAX_PENDING) {
+        return false;
+    }
+    
+    tasks.push_back(task);
+    srs_cond_signal(cond);
+    
+    return true;
+}
+
+int SrsUploadLane::size()
+{
+    return (int)tasks.size();
+}
+
+srs_error_t SrsUploadLane::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "upload lane");
+        }
+        
+        if (tasks.empty()) {
+            srs_cond_wait(cond);
+            continue;
+        }
+        
+        // Remove the task before upload, for the pending tasks may be coalesced when uploading.
+        SrsUploadTask* task = tasks.front();
+        tasks.pop_front();
+        SrsAutoFree(SrsUploadTask, task);
+        
+        uploader->upload(task);
+    }
+    
+    return err;
+}
+
+SrsUploader* _srs_uploader = new SrsUploader();
+
+SrsUploader::SrsUploader()
+{
+    nn_uploads = 0;
+    nn_bytes = 0;
+    nn_parts = 0;
+    nn_failures = 0;
+    nn_retries = 0;
+    nn_dropped = 0;
+    nn_coalesced = 0;
+}
+
+SrsUploader::~SrsUploader()
+{
+    std::vector<SrsUploadLane*>::iterator it;
+    for (it = lanes.begin(); it != lanes.end(); ++it) {
+        SrsUploadLane* lane = *it;
+        srs_freep(lane);
+    }
+    lanes.clear();
+}
+
+bool SrsUploader::hls_enabled(string vhost)
+{
+    return _srs_config->get_vhost_upload_enabled(vhost) && _srs_config->get_vhost_upload_hls(vhost);
+}
+
+bool SrsUploader::dvr_enabled(string vhost)
+{
+    return _srs_config->get_vhost_upload_enabled(vhost) && _srs_config->get_vhost_upload_dvr(vhost);
+}
+
+srs_error_t SrsUploader::put(SrsRequest* req, string key, SrsHlsMemoryFile* file, bool playlist)
+{
+    SrsUploadTask* task = new SrsUploadTask();
+    task->key = key;
+    task->file = file;
+    task->coalesce = playlist;
+    
+    return enqueue(req, task);
+}
+
+srs_error_t SrsUploader::put_file(SrsRequest* req, string key, string path, bool unlink)
+{
+    SrsUploadTask* task = new SrsUploadTask();
+    task->key = key;
+    task->path = path;
+    task->unlink = unlink;
+    
+    return enqueue(req, task);
+}
+
+void SrsUploader::dumps(SrsJsonObject* obj)
+{
+    int pending = 0;
+    for (int i = 0; i < (int)lanes.size(); i++) {
+        pending += lanes.at(i)->size();
+    }
+    
+    obj->set("uploads", SrsJsonAny::integer(nn_uploads));
+    obj->set("bytes", SrsJsonAny::integer(nn_bytes));
+    obj->set("parts", SrsJsonAny::integer(nn_parts));
+    obj->set("failures", SrsJsonAny::integer(nn_failures));
+    obj->set("retries", SrsJsonAny::integer(nn_retries));
+    obj->set("dropped", SrsJsonAny::integer(nn_dropped));
+    obj->set("coalesced", SrsJsonAny::integer(nn_coalesced));
+    obj->set("pending", SrsJsonAny::integer(pending));
+}
+
+string SrsUploader::key_of(string root, string fullpath)
+{
+    string key = fullpath;
+    
+    root = srs_string_trim_end(root, "/");
+    if (!root.empty() && srs_string_starts_with(key, root + "/")) {
+        key = key.substr(root.length());
+    }
+    
+    if (srs_string_starts_with(key, "./")) {
+        key = key.substr(2);
+    }
+    
+    return srs_string_trim_start(key, "/");
+}
+
+srs_error_t SrsUploader::enqueue(SrsRequest* req, SrsUploadTask* task)
+{
+    srs_error_t err = srs_success;
+    
+    string vhost = req->vhost;
+    if ((err = task->target.initialize(_srs_config->get_vhost_upload_endpoint(vhost))) != srs_success) {
+        srs_freep(task);
+        return srs_error_wrap(err, "upload target");
+    }
+    task->target.access_key = _srs_config->get_vhost_upload_access_key(vhost);
+    task->target.secret_key = _srs_config->get_vhost_upload_secret_key(vhost);
+    task->target.region = _srs_config->get_vhost_upload_region(vhost);
+    task->target.retries = _srs_config->get_vhost_upload_retries(vhost);
+    task->target.part_size = _srs_config->get_vhost_upload_part_size(vhost);
+    
+    // Start the lanes when the first task arrives.
+    if (lanes.empty()) {
+        for (int i = 0; i < SRS_UPLOAD_LANES; i++) {
+            SrsUploadLane* lane = new SrsUploadLane(this);
+            lanes.push_back(lane);
+            
+            if ((err = lane->start()) != srs_success) {
+                srs_freep(task);
+                return srs_error_wrap(err, "start lane");
+            }
+        }
+    }
+    
+    // The tasks of a stream always go to the same lane, to upload in order.
+    string url = req->get_stream_url();
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < (int)url.length(); i++) {
+        hash = (hash ^ (uint8_t)url.at(i)) * 16777619u;
+    }
+    SrsUploadLane* lane = lanes.at(hash % lanes.size());
+    
+    string key = task->key;
+    bool coalesced = false;
+    if (!lane->push(task, &coalesced)) {
+        nn_dropped++;
+        srs_freep(task);
+        return srs_error_new(ERROR_SYSTEM_IO_INVALID, "upload queue full, drop %s", key.c_str());
+    }
+    
+    if (coalesced) {
+        nn_coalesced++;
+    }
+    
+    return err;
+}
+
+void SrsUploader::upload(SrsUploadTask* task)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = srs_update_system_time();
+    if ((err = do_upload(task)) != srs_success) {
+        nn_failures++;
+        srs_warn("upload: ignore %s to %s:%d/%s err %s", task->key.c_str(), task->target.host.c_str(), task->target.port,
+            task->target.bucket.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        return;
+    }
+    
+    nn_uploads++;
+    srs_trace("upload: %s done, cost=%dms", task->key.c_str(), srsu2msi(srs_update_system_time() - starttime));
+    
+    if (task->unlink && ::unlink(task->path.c_str()) < 0) {
+        srs_warn("upload: ignore unlink %s failed", task->path.c_str());
+    }
+}
+
+srs_error_t SrsUploader::do_upload(SrsUploadTask* task)
+{
+    srs_error_t err = srs_success;
+    
+    // Upload the bytes in memory by a single PUT.
+    if (task->file) {
+        string body(task->file->data(), task->file->size());
+        if ((err = request(task, "PUT", "", body, NULL, NULL)) != srs_success) {
+            return srs_error_wrap(err, "put object");
+        }
+        nn_bytes += body.length();
+        return err;
+    }
+    
+    SrsFileReader fr;
+    if ((err = fr.open(task->path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", task->path.c_str());
+    }
+    
+    // Upload the large file by multipart, to limit the memory to a part.
+    if (fr.filesize() > task->target.part_size) {
+        return upload_multipart(task, &fr);
+    }
+    
+    string body;
+    body.resize(fr.filesize());
+    if (!body.empty() && (err = fr.read((void*)body.data(), body.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "read %s", task->path.c_str());
+    }
+    
+    if ((err = request(task, "PUT", "", body, NULL, NULL)) != srs_success) {
+        return srs_error_wrap(err, "put object");
+    }
+    nn_bytes += body.length();
+    
+    return err;
+}
+
+srs_error_t SrsUploader::upload_multipart(SrsUploadTask* task, SrsFileReader* fr)
+{
+    srs_error_t err = srs_success;
+    
+    // Initiate the multipart upload, the response is XML with the UploadId.
+    // @see https://docs.aws.amazon.com/AmazonS3/latest/API/API_CreateMultipartUpload.html
+    string res;
+    if ((err = request(task, "POST", "uploads=", "", NULL, &res)) != srs_success) {
+        return srs_error_wrap(err, "create multipart");
+    }
+    
+    size_t pos = res.find("<UploadId>");
+    size_t end = res.find("</UploadId>");
+    if (pos == string::npos || end == string::npos || end <= pos) {
+        return srs_error_new(ERROR_UPLOAD_RESPONSE_INVALID, "no UploadId in %s", res.c_str());
+    }
+    string upload_id = res.substr(pos + 10, end - pos - 10);
+    string id = SrsS3Signer::uri_encode(upload_id, false);
+    
+    std::stringstream parts;
+    int64_t left = fr->filesize();
+    for (int number = 1; left > 0; number++) {
+        string body;
+        body.resize(srs_min(left, (int64_t)task->target.part_size));
+        if ((err = fr->read((void*)body.data(), body.length(), NULL)) != srs_success) {
+            return srs_error_wrap(err, "read %s", task->path.c_str());
+        }
+        left -= body.length();
+        
+        string etag;
+        string query = "partNumber=" + srs_int2str(number) + "&uploadId=" + id;
+        if ((err = request(task, "PUT", query, body, &etag, NULL)) != srs_success) {
+            return srs_error_wrap(err, "upload part %d", number);
+        }
+        nn_parts++;
+        nn_bytes += body.length();
+        
+        parts << "<Part><PartNumber>" << number << "</PartNumber><ETag>" << etag << "</ETag></Part>";
+    }
+    
+    // Complete the upload, the incomplete uploads should be aborted by the lifecycle rules of bucket.
+    // @see https://docs.aws.amazon.com/AmazonS3/latest/API/API_CompleteMultipartUpload.html
+    string body = "<CompleteMultipartUpload>" + parts.str() + "</CompleteMultipartUpload>";
+    if ((err = request(task, "POST", "uploadId=" + id, body, NULL, &res)) != srs_success) {
+        return srs_error_wrap(err, "complete multipart");
+    }
+    
+    // The error maybe returned in a 200 OK response.
+    if (res.find("<Error>") != string::npos) {
+        return srs_error_new(ERROR_UPLOAD_RESPONSE_INVALID, "complete multipart %s", res.c_str());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsUploader::request(SrsUploadTask* task, string method, string query, const string& body, string* petag, string* presponse)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; ; i++) {
+        if ((err = do_request(task, method, query, body, petag, presponse)) == srs_success) {
+            break;
+        }
+        
+        if (i >= task->target.retries) {
+            return srs_error_wrap(err, "retried %d", i);
+        }
+        
+        nn_retries++;
+        srs_warn("upload: retry %d %s %s, err %s", i + 1, method.c_str(), task->key.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        
+        // Backoff 1s, 2s, 4s, and so on, at most 30s.
+        srs_usleep(srs_min(1 << i, 30) * SRS_UTIME_SECONDS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsUploader::do_request(SrsUploadTask* task, string method, string query, const string& body, string* petag, string* presponse)
+{
+    srs_error_t err = srs_success;
+    
+    SrsUploadTarget& t = task->target;
+    string path = "/" + SrsS3Signer::uri_encode(t.bucket, false) + "/" + SrsS3Signer::uri_encode(task->key, true);
+    
+    // The host must be the same as the Host header of HTTP client.
+    string host = t.host;
+    if (t.port != SRS_CONSTS_HTTP_DEFAULT_PORT) {
+        host += ":" + srs_int2str(t.port);
+    }
+    
+    map<string, string> headers;
+    headers["host"] = host;
+    headers["x-amz-content-sha256"] = SrsS3Signer::sha256(body.data(), (int)body.length());
+    headers["x-amz-date"] = SrsS3Signer::amz_date(::time(NULL));
+    
+    SrsS3Signer signer(t.access_key, t.secret_key, t.region);
+    string authorization = signer.sign(method, path, query, headers, headers["x-amz-content-sha256"]);
+    
+    SrsHttpClient hc;
+    hc.set_pool(SrsHttpClientPool::instance());
+    if ((err = hc.initialize(t.host, t.port, SRS_UPLOAD_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "http: init client");
+    }
+    
+    hc.set_header("X-Amz-Content-Sha256", headers["x-amz-content-sha256"]);
+    hc.set_header("X-Amz-Date", headers["x-amz-date"]);
+    hc.set_header("Authorization", authorization);
+    hc.set_header("Content-Type", srs_http_fs_mime(task->key));
+    
+    if (!query.empty()) {
+        path += "?" + query;
+    }
+    
+    ISrsHttpMessage* msg = NULL;
+    if (method == "PUT") {
+        err = hc.put(path, body, &msg);
+    } else {
+        err = hc.post(path, body, &msg);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "http: %s %s", method.c_str(), path.c_str());
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    // Always read the whole response, to reuse the connection.
+    string res;
+    if ((err = msg->body_read_all(res)) != srs_success) {
+        return srs_error_wrap(err, "http: read response");
+    }
+    
+    int code = msg->status_code();
+    if (code < SRS_CONSTS_HTTP_OK || code >= 300) {
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "http: %s %s status=%d, res=%s", method.c_str(), path.c_str(), code, res.c_str());
+    }
+    
+    if (petag) {
+        *petag = msg->header()->get("ETag");
+    }
+    if (presponse) {
+        *presponse = res;
+    }
+    
+    return err;
+}
+
@@ -0,0 +1,194 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_UPLOAD_HPP
+#define SRS_APP_UPLOAD_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include <srs_app_st.hpp>
+
+class SrsRequest;
+class SrsJsonObject;
+class SrsHlsMemoryFile;
+class SrsUploader;
+class SrsFileReader;
+
+// The number of coroutines to upload, each stream is uploaded by one of them in order.
+#define SRS_UPLOAD_LANES 4
+// The max number of pending tasks of each coroutine, the new task is dropped if exceed.
+#define SRS_UPLOAD_MAX_PENDING 256
+// The timeout for each request to the object storage.
+#define SRS_UPLOAD_TIMEOUT (30 * SRS_UTIME_SECONDS)
+
+// The AWS Signature Version 4, to sign the request to S3 compatible object storage.
+// @see https://docs.aws.amazon.com/AmazonS3/latest/API/sig-v4-header-based-auth.html
+class SrsS3Signer
+{
+private:
+    std::string access_key;
+    std::string secret_key;
+    std::string region;
+public:
+    SrsS3Signer(std::string ak, std::string sk, std::string r);
+    virtual ~SrsS3Signer();
+public:
+    // Sign the request, return the value of the Authorization header.
+    // @param path The encoded path of request, for example, /bucket/live/livestream-0.ts
+    // @param query The canonical query, sorted by name, for example, partNumber=1&uploadId=xxx
+    // @param headers The headers to sign, the name in lowercase, must contain the host and x-amz-date.
+    // @param payload The hex of SHA256 of payload.
+    virtual std::string sign(std::string method, std::string path, std::string query,
+        std::map<std::string, std::string>& headers, std::string payload);
+public:
+    // The hex of SHA256 of data.
+    static std::string sha256(const char* data, int size);
+    // The raw bytes of HMAC-SHA256 of data.
+    static std::string hmac_sha256(std::string key, std::string data);
+    // The ISO8601 basic time of x-amz-date, for example, 20130524T000000Z
+    static std::string amz_date(time_t t);
+    // Encode the value in RFC3986, keep the slash for path.
+    static std::string uri_encode(std::string v, bool slash);
+};
+
+// The bucket to upload to, resolved from the config of vhost.
+class SrsUploadTarget
+{
+public:
+    std::string host;
+    int port;
+    std::string bucket;
+    std::string access_key;
+    std::string secret_key;
+    std::string region;
+    int retries;
+    int part_size;
+public:
+    SrsUploadTarget();
+    virtual ~SrsUploadTarget();
+public:
+    // Parse the endpoint, for example, http://127.0.0.1:9000/bucket
+    virtual srs_error_t initialize(std::string endpoint);
+};
+
+// The task to upload an object, from the bytes in memory or a file.
+class SrsUploadTask
+{
+public:
+    SrsUploadTarget target;
+    // The object key in bucket, for example, live/livestream-0.ts
+    std::string key;
+    // The bytes to upload, NULL to upload the file of path.
+    SrsHlsMemoryFile* file;
+    std::string path;
+    // Whether remove the file after uploaded.
+    bool unlink;
+    // Whether replace the pending task of the same key, for playlist.
+    bool coalesce;
+public:
+    SrsUploadTask();
+    virtual ~SrsUploadTask();
+};
+
+// The coroutine to upload the tasks in order, so the m3u8 is always uploaded after its segments.
+class SrsUploadLane : public ISrsCoroutineHandler
+{
+private:
+    SrsUploader* uploader;
+    SrsCoroutine* trd;
+    srs_cond_t cond;
+    // The pending tasks, not including the uploading one.
+    std::list<SrsUploadTask*> tasks;
+public:
+    SrsUploadLane(SrsUploader* u);
+    virtual ~SrsUploadLane();
+public:
+    virtual srs_error_t start();
+    // Append the task, which takes the ownership of task.
+    // @return Whether the task is accepted, false if the lane is full.
+    virtual bool push(SrsUploadTask* task, bool* pcoalesced);
+    virtual int size();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+// The uploader of HLS and DVR files to S3 compatible object storage, by the async coroutines
+// over the keep-alive connections of HTTP client pool.
+// @remark The file larger than part_size is uploaded by multipart upload.
+class SrsUploader
+{
+private:
+    std::vector<SrsUploadLane*> lanes;
+private:
+    // Statistics.
+    int64_t nn_uploads;
+    int64_t nn_bytes;
+    int64_t nn_parts;
+    int64_t nn_failures;
+    int64_t nn_retries;
+    int64_t nn_dropped;
+    int64_t nn_coalesced;
+public:
+    SrsUploader();
+    virtual ~SrsUploader();
+public:
+    // Whether upload the HLS or DVR of vhost.
+    virtual bool hls_enabled(std::string vhost);
+    virtual bool dvr_enabled(std::string vhost);
+    // Upload the bytes of file, for the HLS segment and m3u8 in memory.
+    // @param key The object key, see key_of.
+    // @param playlist Whether the file is a playlist, the pending one of the same key is replaced.
+    // @remark The uploader takes the ownership of file.
+    virtual srs_error_t put(SrsRequest* req, std::string key, SrsHlsMemoryFile* file, bool playlist);
+    // Upload the file of path, remove it after uploaded if unlink.
+    virtual srs_error_t put_file(SrsRequest* req, std::string key, std::string path, bool unlink);
+    virtual void dumps(SrsJsonObject* obj);
+public:
+    // Get the object key of fullpath, the path relative to the root dir.
+    static std::string key_of(std::string root, std::string fullpath);
+private:
+    virtual srs_error_t enqueue(SrsRequest* req, SrsUploadTask* task);
+public:
+    // Upload the task, called by lane.
+    virtual void upload(SrsUploadTask* task);
+private:
+    virtual srs_error_t do_upload(SrsUploadTask* task);
+    virtual srs_error_t upload_multipart(SrsUploadTask* task, SrsFileReader* fr);
+    // Send the request with retries, read the whole response.
+    virtual srs_error_t request(SrsUploadTask* task, std::string method, std::string query, const std::string& body,
+        std::string* petag, std::string* presponse);
+    virtual srs_error_t do_request(SrsUploadTask* task, std::string method, std::string query, const std::string& body,
+        std::string* petag, std::string* presponse);
+};
+
+// The global uploader.
+extern SrsUploader* _srs_uploader;
+
+#endif
+
@@ -35,13 +35,20 @@
 #include <sys/time.h>
 #include <math.h>
 #include <map>
+#include <algorithm>
+#include <fcntl.h>
+#include <errno.h>
 #ifdef SRS_AUTO_OSX
 #include <sys/sysctl.h>
+#else
+#include <sched.h>
+#include <sys/syscall.h>
 #endif
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_app_config.hpp>
+#include <srs_app_overload.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_protocol_kbps.hpp>
@@ -49,6 +56,7 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_core_mem_watch.hpp>
 
 // the longest time to wait for a process to quit.
 #define SRS_PROCESS_QUIT_TIMEOUT_MS 1000
@@ -155,6 +163,128 @@ string srs_path_build_timestamp(string template_path)
     return path;
 }
 
+SrsPathTemplate::SrsPathTemplate()
+{
+    has_time = false;
+    utc = false;
+}
+
+SrsPathTemplate::~SrsPathTemplate()
+{
+}
+
+void SrsPathTemplate::compile(string tmpl, string vhost, string app, string stream, bool v)
+{
+    tokens.clear();
+    literals.clear();
+    has_time = false;
+    utc = v;
+    
+    static const char* names[] = {"[2006]", "[01]", "[02]", "[15]", "[04]", "[05]", "[999]", "[timestamp]", "[seq]"};
+    static const SrsPathToken types[] = {SrsPathTokenYear, SrsPathTokenMonth, SrsPathTokenDay, SrsPathTokenHour,
+        SrsPathTokenMinute, SrsPathTokenSecond, SrsPathTokenMillisecond, SrsPathTokenTimestamp, SrsPathTokenSeq};
+    
+    size_t pos = 0;
+    while (pos < tmpl.length()) {
+        size_t start = tmpl.find('[', pos);
+        size_t end = (start == string::npos)? string::npos : tmpl.find(']', start);
+        if (end == string::npos) {
+            append(SrsPathTokenLiteral, tmpl.substr(pos));
+            break;
+        }
+        
+        if (start > pos) {
+            append(SrsPathTokenLiteral, tmpl.substr(pos, start - pos));
+        }
+        pos = end + 1;
+        
+        string name = tmpl.substr(start, pos - start);
+        if (name == "[vhost]") {
+            append(SrsPathTokenLiteral, vhost);
+        } else if (name == "[app]") {
+            append(SrsPathTokenLiteral, app);
+        } else if (name == "[stream]") {
+            append(SrsPathTokenLiteral, stream);
+        } else {
+            SrsPathToken token = SrsPathTokenLiteral;
+            for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+                if (name == names[i]) {
+                    token = types[i];
+                    break;
+                }
+            }
+            
+            // Keep the unknown variable as it is.
+            append(token, token == SrsPathTokenLiteral? name : "");
+            has_time = has_time || (token != SrsPathTokenLiteral && token != SrsPathTokenSeq);
+        }
+    }
+}
+
+const string& SrsPathTemplate::render(int64_t seq, int64_t timestamp)
+{
+    path.clear();
+    
+    timeval tv;
+    tv.tv_sec = tv.tv_usec = 0;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    
+    // Never read the clock, if there is no variable of time.
+    if (has_time && gettimeofday(&tv, NULL) == 0) {
+        if (utc) {
+            gmtime_r(&tv.tv_sec, &tm);
+        } else {
+            localtime_r(&tv.tv_sec, &tm);
+        }
+    }
+    
+    char buf[32];
+    for (int i = 0; i < (int)tokens.size(); i++) {
+        SrsPathToken token = tokens[i];
+        
+        int nb = 0;
+        switch (token) {
+            case SrsPathTokenLiteral: path.append(literals[i]); continue;
+            case SrsPathTokenYear: nb = snprintf(buf, sizeof(buf), "%04d", 1900 + tm.tm_year); break;
+            case SrsPathTokenMonth: nb = snprintf(buf, sizeof(buf), "%02d", 1 + tm.tm_mon); break;
+            case SrsPathTokenDay: nb = snprintf(buf, sizeof(buf), "%02d", tm.tm_mday); break;
+            case SrsPathTokenHour: nb = snprintf(buf, sizeof(buf), "%02d", tm.tm_hour); break;
+            case SrsPathTokenMinute: nb = snprintf(buf, sizeof(buf), "%02d", tm.tm_min); break;
+            case SrsPathTokenSecond: nb = snprintf(buf, sizeof(buf), "%02d", tm.tm_sec); break;
+            case SrsPathTokenMillisecond: nb = snprintf(buf, sizeof(buf), "%03d", (int)(tv.tv_usec / 1000)); break;
+            case SrsPathTokenTimestamp:
+                if (timestamp < 0) {
+                    timestamp = ((int64_t)tv.tv_sec) * 1000 + (int64_t)tv.tv_usec / 1000;
+                }
+                nb = snprintf(buf, sizeof(buf), "%" PRId64, timestamp);
+                break;
+            case SrsPathTokenSeq:
+                if (seq < 0) {
+                    path.append("[seq]");
+                    continue;
+                }
+                nb = snprintf(buf, sizeof(buf), "%" PRId64, seq);
+                break;
+        }
+        path.append(buf, nb);
+    }
+    
+    return path;
+}
+
+void SrsPathTemplate::append(SrsPathToken token, string literal)
+{
+    // Merge the continuous literals, so the stream fields are never rendered again.
+    if (token == SrsPathTokenLiteral && !tokens.empty() && tokens.back() == SrsPathTokenLiteral) {
+        literals.back().append(literal);
+        return;
+    }
+    
+    tokens.push_back(token);
+    literals.push_back(literal);
+}
+
 srs_error_t srs_kill_forced(int& pid)
 {
     srs_error_t err = srs_success;
@@ -240,8 +370,27 @@ void srs_update_system_rusage()
     _srs_system_rusage.ok = true;
 }
 
-static SrsProcSelfStat _srs_system_cpu_self_stat;
-static SrsProcSystemStat _srs_system_cpu_system_stat;
+// The snapshot of system stat for API, updated by ST thread.
+static SrsProcSnapshot _srs_proc_snapshot;
+// The sampler of ST thread, when the collector thread is not started.
+static SrsProcSampler* _srs_proc_sampler = NULL;
+
+static SrsProcSampler* srs_get_proc_sampler()
+{
+    if (!_srs_proc_sampler) {
+        _srs_proc_sampler = new SrsProcSampler();
+    }
+    return _srs_proc_sampler;
+}
+
+static void srs_get_disk_devices(vector<string>& devices)
+{
+    // if disabled, ignore all devices.
+    SrsConfDirective* conf = _srs_config->get_stats_disk_device();
+    if (conf) {
+        devices = conf->args;
+    }
+}
 
 SrsProcSelfStat::SrsProcSelfStat()
 {
@@ -319,111 +468,584 @@ int64_t SrsProcSystemStat::total()
 
 SrsProcSelfStat* srs_get_self_proc_stat()
 {
-    return &_srs_system_cpu_self_stat;
+    return &_srs_proc_snapshot.self;
+}
+
+int64_t srs_get_self_rss()
+{
+#ifndef SRS_AUTO_OSX
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f == NULL) {
+        return 0;
+    }
+    
+    long size = 0;
+    long resident = 0;
+    int nn = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    
+    if (nn != 2) {
+        return 0;
+    }
+    return (int64_t)resident * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
 }
 
 SrsProcSystemStat* srs_get_system_proc_stat()
 {
-    return &_srs_system_cpu_system_stat;
+    return &_srs_proc_snapshot.system;
 }
 
-bool get_proc_system_stat(SrsProcSystemStat& r)
+void srs_update_proc_stat()
 {
-#ifndef SRS_AUTO_OSX
-    FILE* f = fopen("/proc/stat", "r");
-    if (f == NULL) {
-        srs_warn("open system cpu stat failed, ignore");
-        return false;
+    srs_get_proc_sampler()->update_proc_stat(_srs_proc_snapshot);
+}
+
+SrsDiskStat::SrsDiskStat()
+{
+    ok = false;
+    sample_time = 0;
+    in_KBps = out_KBps = 0;
+    busy = 0;
+    
+    pgpgin = 0;
+    pgpgout = 0;
+    
+    rd_ios = rd_merges = 0;
+    rd_sectors = 0;
+    rd_ticks = 0;
+    
+    wr_ios = wr_merges = 0;
+    wr_sectors = 0;
+    wr_ticks = nb_current = ticks = aveq = 0;
+}
+
+SrsDiskStat* srs_get_disk_stat()
+{
+    return &_srs_proc_snapshot.disk;
+}
+
+void srs_update_disk_stat()
+{
+    vector<string> devices;
+    srs_get_disk_devices(devices);
+    
+    srs_get_proc_sampler()->update_disk_stat(_srs_proc_snapshot, devices);
+}
+
+SrsMemInfo::SrsMemInfo()
+{
+    ok = false;
+    sample_time = 0;
+    
+    percent_ram = 0;
+    percent_swap = 0;
+    
+    MemActive = 0;
+    RealInUse = 0;
+    NotInUse = 0;
+    MemTotal = 0;
+    MemFree = 0;
+    Buffers = 0;
+    Cached = 0;
+    SwapTotal = 0;
+    SwapFree = 0;
+}
+
+SrsMemInfo* srs_get_meminfo()
+{
+    return &_srs_proc_snapshot.meminfo;
+}
+
+void srs_update_meminfo()
+{
+    srs_get_proc_sampler()->update_meminfo(_srs_proc_snapshot);
+}
+
+SrsCpuInfo::SrsCpuInfo()
+{
+    ok = false;
+    
+    nb_processors = 0;
+    nb_processors_online = 0;
+}
+
+SrsCpuInfo* srs_get_cpuinfo()
+{
+    static SrsCpuInfo* cpu = NULL;
+    if (cpu != NULL) {
+        return cpu;
+    }
+    
+    // initialize cpu info.
+    cpu = new SrsCpuInfo();
+    cpu->ok = true;
+    cpu->nb_processors = (int)sysconf(_SC_NPROCESSORS_CONF);
+    cpu->nb_processors_online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    
+    return cpu;
+}
+
+SrsPlatformInfo::SrsPlatformInfo()
+{
+    ok = false;
+    
+    srs_startup_time = 0;
+    
+    os_uptime = 0;
+    os_ilde_time = 0;
+    
+    load_one_minutes = 0;
+    load_five_minutes = 0;
+    load_fifteen_minutes = 0;
+}
+
+SrsPlatformInfo* srs_get_platform_info()
+{
+    return &_srs_proc_snapshot.platform;
+}
+
+void srs_update_platform_info()
+{
+    SrsPlatformInfo& r = _srs_proc_snapshot.platform;
+    r.srs_startup_time = srsu2ms(srs_get_system_startup_time());
+
+    srs_get_proc_sampler()->update_platform_info(_srs_proc_snapshot);
+}
+
+SrsNetworkDevices::SrsNetworkDevices()
+{
+    ok = false;
+    
+    memset(name, 0, sizeof(name));
+    sample_time = 0;
+    
+    rbytes = 0;
+    rpackets = 0;
+    rerrs = 0;
+    rdrop = 0;
+    rfifo = 0;
+    rframe = 0;
+    rcompressed = 0;
+    rmulticast = 0;
+    
+    sbytes = 0;
+    spackets = 0;
+    serrs = 0;
+    sdrop = 0;
+    sfifo = 0;
+    scolls = 0;
+    scarrier = 0;
+    scompressed = 0;
+}
+
+SrsNetworkDevices* srs_get_network_devices()
+{
+    return _srs_proc_snapshot.devices;
+}
+
+int srs_get_network_devices_count()
+{
+    return _srs_proc_snapshot.nb_devices;
+}
+
+void srs_update_network_devices()
+{
+    srs_get_proc_sampler()->update_network_devices(_srs_proc_snapshot);
+}
+
+SrsProcFile::SrsProcFile(string p, int s)
+{
+    path = p;
+    fd = -1;
+    size = s;
+    buf = new char[size];
+}
+
+SrsProcFile::~SrsProcFile()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    srs_freepa(buf);
+}
+
+const char* SrsProcFile::read()
+{
+    if (fd < 0 && (fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC)) < 0) {
+        return NULL;
     }
     
-    static char buf[1024];
-    while (fgets(buf, sizeof(buf), f)) {
-        if (strncmp(buf, "cpu ", 4) != 0) {
+    // The /proc file is generated when read from offset 0, which may need several reads.
+    int nn = 0;
+    while (nn < size - 1) {
+        ssize_t nread = ::pread(fd, buf + nn, size - 1 - nn, nn);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread < 0) {
+            ::close(fd);
+            fd = -1;
+            return NULL;
+        }
+        if (nread == 0) {
+            break;
+        }
+        nn += (int)nread;
+    }
+    
+    buf[nn] = 0;
+    return buf;
+}
+
+// Skip the spaces in line, never skip the end of line.
+static const char* srs_proc_skip_spaces(const char* p)
+{
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+// Get the start of next line, or NULL if no more line.
+static const char* srs_proc_next_line(const char* p)
+{
+    p = strchr(p, '\n');
+    return (p && p[1]) ? p + 1 : NULL;
+}
+
+// Parse the integer after spaces, and move p to the end of it.
+static int64_t srs_proc_parse_int(const char*& p)
+{
+    p = srs_proc_skip_spaces(p);
+    
+    bool negative = (*p == '-');
+    if (negative) {
+        p++;
+    }
+    
+    uint64_t v = 0;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+    }
+    
+    return negative ? -(int64_t)v : (int64_t)v;
+}
+
+static uint64_t srs_proc_parse_uint(const char*& p)
+{
+    p = srs_proc_skip_spaces(p);
+    
+    uint64_t v = 0;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+    }
+    
+    return v;
+}
+
+static double srs_proc_parse_double(const char*& p)
+{
+    double v = (double)srs_proc_parse_uint(p);
+    
+    if (*p == '.') {
+        p++;
+        for (double scale = 0.1; *p >= '0' && *p <= '9'; scale /= 10) {
+            v += (*p++ - '0') * scale;
+        }
+    }
+    
+    return v;
+}
+
+// Parse the name after spaces to buf of size, which ends by space or delimiter.
+static void srs_proc_parse_name(const char*& p, char delimiter, char* name, int size)
+{
+    p = srs_proc_skip_spaces(p);
+    
+    int nn = 0;
+    while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != delimiter) {
+        if (nn < size - 1) {
+            name[nn++] = *p;
+        }
+        p++;
+    }
+    name[nn] = 0;
+}
+
+bool srs_parse_proc_system_stat(const char* data, SrsProcSystemStat& r)
+{
+    for (const char* p = data; p; p = srs_proc_next_line(p)) {
+        if (strncmp(p, "cpu ", 4) != 0) {
             continue;
         }
         
         // @see: read_stat_cpu() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L88
         // @remark, ignore the filed 10 cpu_guest_nice
-        sscanf(buf + 5, "%llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
-               &r.user,
-               &r.nice,
-               &r.sys,
-               &r.idle,
-               &r.iowait,
-               &r.irq,
-               &r.softirq,
-               &r.steal,
-               &r.guest);
+        p += 4;
+        r.user = srs_proc_parse_uint(p);
+        r.nice = srs_proc_parse_uint(p);
+        r.sys = srs_proc_parse_uint(p);
+        r.idle = srs_proc_parse_uint(p);
+        r.iowait = srs_proc_parse_uint(p);
+        r.irq = srs_proc_parse_uint(p);
+        r.softirq = srs_proc_parse_uint(p);
+        r.steal = srs_proc_parse_uint(p);
+        r.guest = srs_proc_parse_uint(p);
         
-        break;
+        return true;
     }
     
-    fclose(f);
-#endif
+    return false;
+}
 
-    r.ok = true;
+bool srs_parse_proc_self_stat(const char* data, SrsProcSelfStat& r)
+{
+    const char* p = data;
+    r.pid = (int)srs_proc_parse_int(p);
+    
+    // The comm is in parentheses, which may contains spaces, so it ends at the last parenthesis.
+    p = srs_proc_skip_spaces(p);
+    const char* end = strrchr(p, ')');
+    if (*p != '(' || !end) {
+        return false;
+    }
+    
+    int nn = srs_min((int)(end - p + 1), (int)sizeof(r.comm) - 1);
+    memcpy(r.comm, p, nn);
+    r.comm[nn] = 0;
+    
+    p = srs_proc_skip_spaces(end + 1);
+    r.state = *p ? *p++ : '0';
+    
+    r.ppid = (int)srs_proc_parse_int(p);
+    r.pgrp = (int)srs_proc_parse_int(p);
+    r.session = (int)srs_proc_parse_int(p);
+    r.tty_nr = (int)srs_proc_parse_int(p);
+    r.tpgid = (int)srs_proc_parse_int(p);
+    r.flags = (unsigned int)srs_proc_parse_uint(p);
+    r.minflt = (unsigned long)srs_proc_parse_uint(p);
+    r.cminflt = (unsigned long)srs_proc_parse_uint(p);
+    r.majflt = (unsigned long)srs_proc_parse_uint(p);
+    r.cmajflt = (unsigned long)srs_proc_parse_uint(p);
+    r.utime = (unsigned long)srs_proc_parse_uint(p);
+    r.stime = (unsigned long)srs_proc_parse_uint(p);
+    r.cutime = (long)srs_proc_parse_int(p);
+    r.cstime = (long)srs_proc_parse_int(p);
+    r.priority = (long)srs_proc_parse_int(p);
+    r.nice = (long)srs_proc_parse_int(p);
+    r.num_threads = (long)srs_proc_parse_int(p);
+    r.itrealvalue = (long)srs_proc_parse_int(p);
+    r.starttime = (long long)srs_proc_parse_uint(p);
+    r.vsize = (unsigned long)srs_proc_parse_uint(p);
+    r.rss = (long)srs_proc_parse_int(p);
+    r.rsslim = (unsigned long)srs_proc_parse_uint(p);
+    r.startcode = (unsigned long)srs_proc_parse_uint(p);
+    r.endcode = (unsigned long)srs_proc_parse_uint(p);
+    r.startstack = (unsigned long)srs_proc_parse_uint(p);
+    r.kstkesp = (unsigned long)srs_proc_parse_uint(p);
+    r.kstkeip = (unsigned long)srs_proc_parse_uint(p);
+    r.signal = (unsigned long)srs_proc_parse_uint(p);
+    r.blocked = (unsigned long)srs_proc_parse_uint(p);
+    r.sigignore = (unsigned long)srs_proc_parse_uint(p);
+    r.sigcatch = (unsigned long)srs_proc_parse_uint(p);
+    r.wchan = (unsigned long)srs_proc_parse_uint(p);
+    r.nswap = (unsigned long)srs_proc_parse_uint(p);
+    r.cnswap = (unsigned long)srs_proc_parse_uint(p);
+    r.exit_signal = (int)srs_proc_parse_int(p);
+    r.processor = (int)srs_proc_parse_int(p);
+    r.rt_priority = (unsigned int)srs_proc_parse_uint(p);
+    r.policy = (unsigned int)srs_proc_parse_uint(p);
+    r.delayacct_blkio_ticks = (unsigned long long)srs_proc_parse_uint(p);
+    r.guest_time = (unsigned long)srs_proc_parse_uint(p);
+    r.cguest_time = (long)srs_proc_parse_int(p);
     
     return true;
 }
 
-bool get_proc_self_stat(SrsProcSelfStat& r)
+void srs_parse_proc_vmstat(const char* data, SrsDiskStat& r)
 {
-#ifndef SRS_AUTO_OSX
-    FILE* f = fopen("/proc/self/stat", "r");
-    if (f == NULL) {
-        srs_warn("open self cpu stat failed, ignore");
-        return false;
+    for (const char* p = data; p; p = srs_proc_next_line(p)) {
+        // @see: read_vmstat_paging() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L495
+        if (strncmp(p, "pgpgin ", 7) == 0) {
+            p += 7;
+            r.pgpgin = (unsigned long)srs_proc_parse_uint(p);
+        } else if (strncmp(p, "pgpgout ", 8) == 0) {
+            p += 8;
+            r.pgpgout = (unsigned long)srs_proc_parse_uint(p);
+        }
+    }
+}
+
+void srs_parse_proc_diskstats(const char* data, const vector<string>& devices, SrsDiskStat& r)
+{
+    for (const char* p = data; p; p = srs_proc_next_line(p)) {
+        char name[32];
+        srs_proc_parse_uint(p); // major
+        srs_proc_parse_uint(p); // minor
+        srs_proc_parse_name(p, 0, name, sizeof(name));
+        
+        if (std::find(devices.begin(), devices.end(), string(name)) == devices.end()) {
+            continue;
+        }
+        
+        r.rd_ios += (unsigned int)srs_proc_parse_uint(p);
+        r.rd_merges += (unsigned int)srs_proc_parse_uint(p);
+        r.rd_sectors += (unsigned long long)srs_proc_parse_uint(p);
+        r.rd_ticks += (unsigned int)srs_proc_parse_uint(p);
+        r.wr_ios += (unsigned int)srs_proc_parse_uint(p);
+        r.wr_merges += (unsigned int)srs_proc_parse_uint(p);
+        r.wr_sectors += (unsigned long long)srs_proc_parse_uint(p);
+        r.wr_ticks += (unsigned int)srs_proc_parse_uint(p);
+        r.nb_current += (unsigned int)srs_proc_parse_uint(p);
+        r.ticks += (unsigned int)srs_proc_parse_uint(p);
+        r.aveq += (unsigned int)srs_proc_parse_uint(p);
+    }
+}
+
+void srs_parse_proc_meminfo(const char* data, SrsMemInfo& r)
+{
+    for (const char* p = data; p; p = srs_proc_next_line(p)) {
+        // @see: read_meminfo() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L227
+        unsigned long* pv = NULL;
+        if (strncmp(p, "MemTotal:", 9) == 0) {
+            pv = &r.MemTotal;
+        } else if (strncmp(p, "MemFree:", 8) == 0) {
+            pv = &r.MemFree;
+        } else if (strncmp(p, "Buffers:", 8) == 0) {
+            pv = &r.Buffers;
+        } else if (strncmp(p, "Cached:", 7) == 0) {
+            pv = &r.Cached;
+        } else if (strncmp(p, "SwapTotal:", 10) == 0) {
+            pv = &r.SwapTotal;
+        } else if (strncmp(p, "SwapFree:", 9) == 0) {
+            pv = &r.SwapFree;
+        }
+        
+        if (pv) {
+            p = strchr(p, ':') + 1;
+            *pv = (unsigned long)srs_proc_parse_uint(p);
+        }
     }
+}
+
+void srs_parse_proc_uptime(const char* data, SrsPlatformInfo& r)
+{
+    const char* p = data;
+    r.os_uptime = srs_proc_parse_double(p);
+    r.os_ilde_time = srs_proc_parse_double(p);
+}
+
+void srs_parse_proc_loadavg(const char* data, SrsPlatformInfo& r)
+{
+    // @see: read_loadavg() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L402
+    // @remark, we use our algorithm, not sysstat.
+    const char* p = data;
+    r.load_one_minutes = srs_proc_parse_double(p);
+    r.load_five_minutes = srs_proc_parse_double(p);
+    r.load_fifteen_minutes = srs_proc_parse_double(p);
+}
+
+int srs_parse_proc_net_dev(const char* data, SrsNetworkDevices* devices, int max)
+{
+    // ignore title.
+    const char* p = srs_proc_next_line(data);
+    p = p ? srs_proc_next_line(p) : NULL;
     
-    fscanf(f, "%d %32s %c %d %d %d %d "
-           "%d %u %lu %lu %lu %lu "
-           "%lu %lu %ld %ld %ld %ld "
-           "%ld %ld %llu %lu %ld "
-           "%lu %lu %lu %lu %lu "
-           "%lu %lu %lu %lu %lu "
-           "%lu %lu %lu %d %d "
-           "%u %u %llu "
-           "%lu %ld",
-           &r.pid, r.comm, &r.state, &r.ppid, &r.pgrp, &r.session, &r.tty_nr,
-           &r.tpgid, &r.flags, &r.minflt, &r.cminflt, &r.majflt, &r.cmajflt,
-           &r.utime, &r.stime, &r.cutime, &r.cstime, &r.priority, &r.nice,
-           &r.num_threads, &r.itrealvalue, &r.starttime, &r.vsize, &r.rss,
-           &r.rsslim, &r.startcode, &r.endcode, &r.startstack, &r.kstkesp,
-           &r.kstkeip, &r.signal, &r.blocked, &r.sigignore, &r.sigcatch,
-           &r.wchan, &r.nswap, &r.cnswap, &r.exit_signal, &r.processor,
-           &r.rt_priority, &r.policy, &r.delayacct_blkio_ticks,
-           &r.guest_time, &r.cguest_time);
+    int nn = 0;
+    for (; p && nn < max; p = srs_proc_next_line(p)) {
+        SrsNetworkDevices& r = devices[nn++];
+        
+        // @see: read_net_dev() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L786
+        // @remark, we use our algorithm, not sysstat.
+        srs_proc_parse_name(p, ':', r.name, sizeof(r.name));
+        if ((p = strchr(p, ':')) == NULL) {
+            nn--;
+            break;
+        }
+        p++;
+        
+        r.rbytes = (unsigned long long)srs_proc_parse_uint(p);
+        r.rpackets = (unsigned long)srs_proc_parse_uint(p);
+        r.rerrs = (unsigned long)srs_proc_parse_uint(p);
+        r.rdrop = (unsigned long)srs_proc_parse_uint(p);
+        r.rfifo = (unsigned long)srs_proc_parse_uint(p);
+        r.rframe = (unsigned long)srs_proc_parse_uint(p);
+        r.rcompressed = (unsigned long)srs_proc_parse_uint(p);
+        r.rmulticast = (unsigned long)srs_proc_parse_uint(p);
+        r.sbytes = (unsigned long long)srs_proc_parse_uint(p);
+        r.spackets = (unsigned long)srs_proc_parse_uint(p);
+        r.serrs = (unsigned long)srs_proc_parse_uint(p);
+        r.sdrop = (unsigned long)srs_proc_parse_uint(p);
+        r.sfifo = (unsigned long)srs_proc_parse_uint(p);
+        r.scolls = (unsigned long)srs_proc_parse_uint(p);
+        r.scarrier = (unsigned long)srs_proc_parse_uint(p);
+        r.scompressed = (unsigned long)srs_proc_parse_uint(p);
+    }
     
-    fclose(f);
-#endif
+    return nn;
+}
 
-    r.ok = true;
-    
-    return true;
+SrsProcSnapshot::SrsProcSnapshot()
+{
+    nb_devices = -1;
 }
 
-void srs_update_proc_stat()
+// The time in ms, never use the cached time of ST, for the sampler may run in other thread.
+static int64_t srs_proc_now_ms()
 {
-    // @see: http://stackoverflow.com/questions/7298646/calculating-user-nice-sys-idle-iowait-irq-and-sirq-from-proc-stat/7298711
-    // @see https://github.com/ossrs/srs/issues/397
-    static int user_hz = 0;
-    if (user_hz <= 0) {
-        user_hz = (int)sysconf(_SC_CLK_TCK);
-        srs_info("USER_HZ=%d", user_hz);
-        srs_assert(user_hz > 0);
+    timeval now;
+    if (gettimeofday(&now, NULL) < 0) {
+        return 0;
     }
-    
+    return now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+SrsProcSampler::SrsProcSampler()
+{
+    // @see https://github.com/ossrs/srs/issues/397
+    user_hz = (int)sysconf(_SC_CLK_TCK);
+    
+    stat = new SrsProcFile("/proc/stat");
+    self_stat = new SrsProcFile("/proc/self/stat");
+    vmstat = new SrsProcFile("/proc/vmstat");
+    diskstats = new SrsProcFile("/proc/diskstats");
+    meminfo = new SrsProcFile("/proc/meminfo");
+    uptime = new SrsProcFile("/proc/uptime", 128);
+    loadavg = new SrsProcFile("/proc/loadavg", 128);
+    net_dev = new SrsProcFile("/proc/net/dev");
+}
+
+SrsProcSampler::~SrsProcSampler()
+{
+    srs_freep(stat);
+    srs_freep(self_stat);
+    srs_freep(vmstat);
+    srs_freep(diskstats);
+    srs_freep(meminfo);
+    srs_freep(uptime);
+    srs_freep(loadavg);
+    srs_freep(net_dev);
+}
+
+void SrsProcSampler::update_proc_stat(SrsProcSnapshot& snapshot)
+{
+    // @see: http://stackoverflow.com/questions/7298646/calculating-user-nice-sys-idle-iowait-irq-and-sirq-from-proc-stat/7298711
     // system cpu stat
     if (true) {
         SrsProcSystemStat r;
-        if (!get_proc_system_stat(r)) {
+        const char* data = stat->read();
+        if (!data || !srs_parse_proc_system_stat(data, r)) {
             return;
         }
         
-        r.sample_time = srsu2ms(srs_get_system_time());
+        r.ok = true;
+        r.sample_time = srs_proc_now_ms();
         
         // calc usage in percent
-        SrsProcSystemStat& o = _srs_system_cpu_system_stat;
+        SrsProcSystemStat& o = snapshot.system;
         
         // @see: http://blog.csdn.net/nineday/article/details/1928847
         // @see: http://stackoverflow.com/questions/16011677/calculating-cpu-usage-using-proc-files
@@ -436,187 +1058,62 @@ void srs_update_proc_stat()
         }
         
         // upate cache.
-        _srs_system_cpu_system_stat = r;
+        snapshot.system = r;
     }
     
     // self cpu stat
     if (true) {
         SrsProcSelfStat r;
-        if (!get_proc_self_stat(r)) {
+        const char* data = self_stat->read();
+        if (!data || !srs_parse_proc_self_stat(data, r)) {
             return;
         }
         
-        r.sample_time = srsu2ms(srs_get_system_time());
+        r.ok = true;
+        r.sample_time = srs_proc_now_ms();
         
         // calc usage in percent
-        SrsProcSelfStat& o = _srs_system_cpu_self_stat;
+        SrsProcSelfStat& o = snapshot.self;
         
         // @see: http://stackoverflow.com/questions/16011677/calculating-cpu-usage-using-proc-files
         int64_t total = r.sample_time - o.sample_time;
         int64_t usage = (r.utime + r.stime) - (o.utime + o.stime);
-        if (total > 0) {
+        if (total > 0 && user_hz > 0) {
             r.percent = (float)(usage * 1000 / (double)total / user_hz);
         }
         
         // upate cache.
-        _srs_system_cpu_self_stat = r;
+        snapshot.self = r;
     }
 }
 
-SrsDiskStat::SrsDiskStat()
-{
-    ok = false;
-    sample_time = 0;
-    in_KBps = out_KBps = 0;
-    busy = 0;
-    
-    pgpgin = 0;
-    pgpgout = 0;
-    
-    rd_ios = rd_merges = 0;
-    rd_sectors = 0;
-    rd_ticks = 0;
-    
-    wr_ios = wr_merges = 0;
-    wr_sectors = 0;
-    wr_ticks = nb_current = ticks = aveq = 0;
-}
-
-static SrsDiskStat _srs_disk_stat;
-
-SrsDiskStat* srs_get_disk_stat()
-{
-    return &_srs_disk_stat;
-}
-
-bool srs_get_disk_vmstat_stat(SrsDiskStat& r)
+void SrsProcSampler::update_disk_stat(SrsProcSnapshot& snapshot, const vector<string>& devices)
 {
-#ifndef SRS_AUTO_OSX
-    FILE* f = fopen("/proc/vmstat", "r");
-    if (f == NULL) {
-        srs_warn("open vmstat failed, ignore");
-        return false;
-    }
-    
-    r.sample_time = srsu2ms(srs_get_system_time());
-    
-    static char buf[1024];
-    while (fgets(buf, sizeof(buf), f)) {
-        // @see: read_vmstat_paging() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L495
-        if (strncmp(buf, "pgpgin ", 7) == 0) {
-            sscanf(buf + 7, "%lu\n", &r.pgpgin);
-        } else if (strncmp(buf, "pgpgout ", 8) == 0) {
-            sscanf(buf + 8, "%lu\n", &r.pgpgout);
-        }
-    }
-    
-    fclose(f);
-#endif
-
-    r.ok = true;
+    SrsDiskStat r;
+    r.sample_time = srs_proc_now_ms();
     
-    return true;
-}
-
-bool srs_get_disk_diskstats_stat(SrsDiskStat& r)
-{
-    r.ok = true;
-    r.sample_time = srsu2ms(srs_get_system_time());
-
-#ifndef SRS_AUTO_OSX
-    // if disabled, ignore all devices.
-    SrsConfDirective* conf = _srs_config->get_stats_disk_device();
-    if (conf == NULL) {
-        return true;
-    }
-
-    FILE* f = fopen("/proc/diskstats", "r");
-    if (f == NULL) {
-        srs_warn("open vmstat failed, ignore");
-        return false;
+    const char* data = vmstat->read();
+    if (!data) {
+        return;
     }
+    srs_parse_proc_vmstat(data, r);
     
-    static char buf[1024];
-    while (fgets(buf, sizeof(buf), f)) {
-        unsigned int major = 0;
-        unsigned int minor = 0;
-        static char name[32];
-        unsigned int rd_ios = 0;
-        unsigned int rd_merges = 0;
-        unsigned long long rd_sectors = 0;
-        unsigned int rd_ticks = 0;
-        unsigned int wr_ios = 0;
-        unsigned int wr_merges = 0;
-        unsigned long long wr_sectors = 0;
-        unsigned int wr_ticks = 0;
-        unsigned int nb_current = 0;
-        unsigned int ticks = 0;
-        unsigned int aveq = 0;
-        memset(name, 0, sizeof(name));
-        
-        sscanf(buf, "%4d %4d %31s %u %u %llu %u %u %u %llu %u %u %u %u",
-               &major,
-               &minor,
-               name,
-               &rd_ios,
-               &rd_merges,
-               &rd_sectors,
-               &rd_ticks,
-               &wr_ios,
-               &wr_merges,
-               &wr_sectors,
-               &wr_ticks,
-               &nb_current,
-               &ticks,
-               &aveq);
-        
-        for (int i = 0; i < (int)conf->args.size(); i++) {
-            string name_ok = conf->args.at(i);
-            
-            if (strcmp(name_ok.c_str(), name) != 0) {
-                continue;
-            }
-            
-            r.rd_ios += rd_ios;
-            r.rd_merges += rd_merges;
-            r.rd_sectors += rd_sectors;
-            r.rd_ticks += rd_ticks;
-            r.wr_ios += wr_ios;
-            r.wr_merges += wr_merges;
-            r.wr_sectors += wr_sectors;
-            r.wr_ticks += wr_ticks;
-            r.nb_current += nb_current;
-            r.ticks += ticks;
-            r.aveq += aveq;
-            
-            break;
+    if (!devices.empty()) {
+        if ((data = diskstats->read()) == NULL) {
+            return;
         }
+        srs_parse_proc_diskstats(data, devices, r);
     }
     
-    fclose(f);
-#endif
-
-    r.ok = true;
-    
-    return true;
-}
-
-void srs_update_disk_stat()
-{
-    SrsDiskStat r;
-    if (!srs_get_disk_vmstat_stat(r)) {
-        return;
-    }
-    if (!srs_get_disk_diskstats_stat(r)) {
-        return;
-    }
-    if (!get_proc_system_stat(r.cpu)) {
+    if ((data = stat->read()) == NULL || !srs_parse_proc_system_stat(data, r.cpu)) {
         return;
     }
+    r.cpu.ok = true;
+    r.ok = true;
     
-    SrsDiskStat& o = _srs_disk_stat;
+    SrsDiskStat& o = snapshot.disk;
     if (!o.ok) {
-        _srs_disk_stat = r;
+        snapshot.disk = r;
         return;
     }
     
@@ -650,72 +1147,24 @@ void srs_update_disk_stat()
             unsigned int ticks = r.ticks - o.ticks;
             
             // busy in [0, 1], where 0.1532 means 15.32%
-            r.busy = (float)(ticks / delta_ms);
-        }
-    }
-    
-    _srs_disk_stat = r;
-}
-
-SrsMemInfo::SrsMemInfo()
-{
-    ok = false;
-    sample_time = 0;
-    
-    percent_ram = 0;
-    percent_swap = 0;
-    
-    MemActive = 0;
-    RealInUse = 0;
-    NotInUse = 0;
-    MemTotal = 0;
-    MemFree = 0;
-    Buffers = 0;
-    Cached = 0;
-    SwapTotal = 0;
-    SwapFree = 0;
-}
-
-static SrsMemInfo _srs_system_meminfo;
-
-SrsMemInfo* srs_get_meminfo()
-{
-    return &_srs_system_meminfo;
+            r.busy = (float)(ticks / delta_ms);
+        }
+    }
+    
+    snapshot.disk = r;
 }
 
-void srs_update_meminfo()
+void SrsProcSampler::update_meminfo(SrsProcSnapshot& snapshot)
 {
-    SrsMemInfo& r = _srs_system_meminfo;
-
-#ifndef SRS_AUTO_OSX
-    FILE* f = fopen("/proc/meminfo", "r");
-    if (f == NULL) {
-        srs_warn("open meminfo failed, ignore");
-        return;
-    }
+    SrsMemInfo& r = snapshot.meminfo;
     
-    static char buf[1024];
-    while (fgets(buf, sizeof(buf), f)) {
-        // @see: read_meminfo() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L227
-        if (strncmp(buf, "MemTotal:", 9) == 0) {
-            sscanf(buf + 9, "%lu", &r.MemTotal);
-        } else if (strncmp(buf, "MemFree:", 8) == 0) {
-            sscanf(buf + 8, "%lu", &r.MemFree);
-        } else if (strncmp(buf, "Buffers:", 8) == 0) {
-            sscanf(buf + 8, "%lu", &r.Buffers);
-        } else if (strncmp(buf, "Cached:", 7) == 0) {
-            sscanf(buf + 7, "%lu", &r.Cached);
-        } else if (strncmp(buf, "SwapTotal:", 10) == 0) {
-            sscanf(buf + 10, "%lu", &r.SwapTotal);
-        } else if (strncmp(buf, "SwapFree:", 9) == 0) {
-            sscanf(buf + 9, "%lu", &r.SwapFree);
-        }
+    const char* data = meminfo->read();
+    if (!data) {
+        return;
     }
+    srs_parse_proc_meminfo(data, r);
     
-    fclose(f);
-#endif
-
-    r.sample_time = srsu2ms(srs_get_system_time());
+    r.sample_time = srs_proc_now_ms();
     r.MemActive = r.MemTotal - r.MemFree;
     r.RealInUse = r.MemActive - r.Buffers - r.Cached;
     r.NotInUse = r.MemTotal - r.RealInUse;
@@ -730,118 +1179,51 @@ void srs_update_meminfo()
     r.ok = true;
 }
 
-SrsCpuInfo::SrsCpuInfo()
-{
-    ok = false;
-    
-    nb_processors = 0;
-    nb_processors_online = 0;
-}
-
-SrsCpuInfo* srs_get_cpuinfo()
-{
-    static SrsCpuInfo* cpu = NULL;
-    if (cpu != NULL) {
-        return cpu;
-    }
-    
-    // initialize cpu info.
-    cpu = new SrsCpuInfo();
-    cpu->ok = true;
-    cpu->nb_processors = (int)sysconf(_SC_NPROCESSORS_CONF);
-    cpu->nb_processors_online = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    
-    return cpu;
-}
-
-SrsPlatformInfo::SrsPlatformInfo()
-{
-    ok = false;
-    
-    srs_startup_time = 0;
-    
-    os_uptime = 0;
-    os_ilde_time = 0;
-    
-    load_one_minutes = 0;
-    load_five_minutes = 0;
-    load_fifteen_minutes = 0;
-}
-
-static SrsPlatformInfo _srs_system_platform_info;
-
-SrsPlatformInfo* srs_get_platform_info()
-{
-    return &_srs_system_platform_info;
-}
-
-void srs_update_platform_info()
+void SrsProcSampler::update_platform_info(SrsProcSnapshot& snapshot)
 {
-    SrsPlatformInfo& r = _srs_system_platform_info;
-    
-    r.srs_startup_time = srsu2ms(srs_get_system_startup_time());
+    SrsPlatformInfo& r = snapshot.platform;
 
 #ifndef SRS_AUTO_OSX
-    if (true) {
-        FILE* f = fopen("/proc/uptime", "r");
-        if (f == NULL) {
-            srs_warn("open uptime failed, ignore");
-            return;
-        }
-        
-        fscanf(f, "%lf %lf\n", &r.os_uptime, &r.os_ilde_time);
-        
-        fclose(f);
+    const char* data = uptime->read();
+    if (!data) {
+        return;
     }
+    srs_parse_proc_uptime(data, r);
     
-    if (true) {
-        FILE* f = fopen("/proc/loadavg", "r");
-        if (f == NULL) {
-            srs_warn("open loadavg failed, ignore");
-            return;
-        }
-        
-        // @see: read_loadavg() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L402
-        // @remark, we use our algorithm, not sysstat.
-        fscanf(f, "%lf %lf %lf\n",
-               &r.load_one_minutes,
-               &r.load_five_minutes,
-               &r.load_fifteen_minutes);
-        
-        fclose(f);
+    if ((data = loadavg->read()) == NULL) {
+        return;
     }
+    srs_parse_proc_loadavg(data, r);
 #else
     // man 3 sysctl
     if (true) {
         struct timeval tv;
         size_t len = sizeof(timeval);
-
+        
         int mib[2];
         mib[0] = CTL_KERN;
         mib[1] = KERN_BOOTTIME;
         if (sysctl(mib, 2, &tv, &len, NULL, 0) < 0) {
-            srs_warn("sysctl boottime failed, ignore");
             return;
         }
-
+        
         time_t bsec = tv.tv_sec;
         time_t csec = ::time(NULL);
         r.os_uptime = difftime(csec, bsec);
     }
-
+    
     // man 3 sysctl
     if (true) {
         struct loadavg la;
-        size_t len = sizeof(loadavg);
-
+        size_t len = sizeof(struct loadavg);
+        
         int mib[2];
         mib[0] = CTL_VM;
         mib[1] = VM_LOADAVG;
         if (sysctl(mib, 2, &la, &len, NULL, 0) < 0) {
-            srs_warn("sysctl loadavg failed, ignore");
             return;
         }
-
+        
         r.load_one_minutes = (double)la.ldavg[0] / la.fscale;
         r.load_five_minutes = (double)la.ldavg[1] / la.fscale;
         r.load_fifteen_minutes = (double)la.ldavg[2] / la.fscale;
@@ -851,86 +1233,178 @@ void srs_update_platform_info()
     r.ok = true;
 }
 
-SrsNetworkDevices::SrsNetworkDevices()
+void SrsProcSampler::update_network_devices(SrsProcSnapshot& snapshot)
 {
-    ok = false;
+    const char* data = net_dev->read();
+    if (!data) {
+        return;
+    }
     
-    memset(name, 0, sizeof(name));
-    sample_time = 0;
+    int nn = srs_parse_proc_net_dev(data, snapshot.devices, MAX_NETWORK_DEVICES_COUNT);
+    if (nn <= 0) {
+        return;
+    }
     
-    rbytes = 0;
-    rpackets = 0;
-    rerrs = 0;
-    rdrop = 0;
-    rfifo = 0;
-    rframe = 0;
-    rcompressed = 0;
-    rmulticast = 0;
+    int64_t now = srs_proc_now_ms();
+    for (int i = 0; i < nn; i++) {
+        SrsNetworkDevices& r = snapshot.devices[i];
+        r.sample_time = now;
+        r.ok = true;
+    }
+    snapshot.nb_devices = nn;
+}
+
+SrsProcCollector* _srs_proc_collector = new SrsProcCollector();
+
+SrsProcCollector::SrsProcCollector()
+{
+    started = false;
+    quit = false;
+    latest = NULL;
+    nn_samples = 0;
+    nn_applies = 0;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+SrsProcCollector::~SrsProcCollector()
+{
+    stop();
     
-    sbytes = 0;
-    spackets = 0;
-    serrs = 0;
-    sdrop = 0;
-    sfifo = 0;
-    scolls = 0;
-    scarrier = 0;
-    scompressed = 0;
+    srs_freep(latest);
+    
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+srs_error_t SrsProcCollector::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (started) {
+        return err;
+    }
+    
+    // Initialize the cpu info, which is used by thread.
+    srs_get_cpuinfo();
+    
+    int r0 = 0;
+    if ((r0 = pthread_create(&tid, NULL, SrsProcCollector::pfn, this)) != 0) {
+        return srs_error_new(ERROR_SYSTEM_PROC_THREAD, "create thread, r0=%d", r0);
+    }
+    started = true;
+    
+    srs_trace("proc collector started, interval=%dms, disks=%d", srsu2msi(SRS_PROC_SAMPLE_INTERVAL), (int)devices.size());
+    
+    return err;
 }
 
-#define MAX_NETWORK_DEVICES_COUNT 16
-static SrsNetworkDevices _srs_system_network_devices[MAX_NETWORK_DEVICES_COUNT];
-static int _nb_srs_system_network_devices = -1;
+void SrsProcCollector::stop()
+{
+    if (!started) {
+        return;
+    }
+    
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+    
+    pthread_join(tid, NULL);
+    started = false;
+}
 
-SrsNetworkDevices* srs_get_network_devices()
+bool SrsProcCollector::is_started()
 {
-    return _srs_system_network_devices;
+    return started;
 }
 
-int srs_get_network_devices_count()
+void SrsProcCollector::set_disk_devices(const vector<string>& v)
 {
-    return _nb_srs_system_network_devices;
+    pthread_mutex_lock(&lock);
+    devices = v;
+    pthread_mutex_unlock(&lock);
 }
 
-void srs_update_network_devices()
+bool SrsProcCollector::apply()
 {
-#ifndef SRS_AUTO_OSX
-    if (true) {
-        FILE* f = fopen("/proc/net/dev", "r");
-        if (f == NULL) {
-            srs_warn("open proc network devices failed, ignore");
-            return;
-        }
+    SrsProcSnapshot* r = NULL;
+    
+    pthread_mutex_lock(&lock);
+    r = latest;
+    latest = NULL;
+    pthread_mutex_unlock(&lock);
+    
+    if (!r) {
+        return false;
+    }
+    
+    _srs_proc_snapshot = *r;
+    _srs_proc_snapshot.platform.srs_startup_time = srsu2ms(srs_get_system_startup_time());
+    srs_freep(r);
+    
+    nn_applies++;
+    srs_info("proc collector apply, samples=%" PRId64 ", applies=%" PRId64, nn_samples, nn_applies);
+    
+    return true;
+}
+
+void* SrsProcCollector::pfn(void* arg)
+{
+    // The signals are always handled by the ST thread.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    
+    SrsProcCollector* p = (SrsProcCollector*)arg;
+    p->cycle();
+    
+    return NULL;
+}
+
+void SrsProcCollector::cycle()
+{
+    SrsProcSampler sampler;
+    SrsProcSnapshot prev;
+    
+    while (true) {
+        vector<string> disks;
+        pthread_mutex_lock(&lock);
+        disks = devices;
+        pthread_mutex_unlock(&lock);
         
-        // ignore title.
-        static char buf[1024];
-        fgets(buf, sizeof(buf), f);
-        fgets(buf, sizeof(buf), f);
+        // Sample to a new snapshot, which is immutable once published.
+        SrsProcSnapshot* r = new SrsProcSnapshot(prev);
+        sampler.update_proc_stat(*r);
+        sampler.update_disk_stat(*r, disks);
+        sampler.update_meminfo(*r);
+        sampler.update_platform_info(*r);
+        sampler.update_network_devices(*r);
+        prev = *r;
         
-        for (int i = 0; i < MAX_NETWORK_DEVICES_COUNT; i++) {
-            if (!fgets(buf, sizeof(buf), f)) {
-                break;
-            }
-            
-            SrsNetworkDevices& r = _srs_system_network_devices[i];
-            
-            // @see: read_net_dev() from https://github.com/sysstat/sysstat/blob/master/rd_stats.c#L786
-            // @remark, we use our algorithm, not sysstat.
-            char fname[7];
-            sscanf(buf, "%6[^:]:%llu %lu %lu %lu %lu %lu %lu %lu %llu %lu %lu %lu %lu %lu %lu %lu\n",
-                   fname, &r.rbytes, &r.rpackets, &r.rerrs, &r.rdrop, &r.rfifo, &r.rframe, &r.rcompressed, &r.rmulticast,
-                   &r.sbytes, &r.spackets, &r.serrs, &r.sdrop, &r.sfifo, &r.scolls, &r.scarrier, &r.scompressed);
-            
-            sscanf(fname, "%s", r.name);
-            _nb_srs_system_network_devices = i + 1;
-            srs_info("scan network device ifname=%s, total=%d", r.name, _nb_srs_system_network_devices);
-            
-            r.sample_time = srsu2ms(srs_get_system_time());
-            r.ok = true;
+        timeval now;
+        gettimeofday(&now, NULL);
+        int64_t deadline = now.tv_sec * SRS_UTIME_SECONDS + now.tv_usec + SRS_PROC_SAMPLE_INTERVAL;
+        
+        timespec ts;
+        ts.tv_sec = deadline / SRS_UTIME_SECONDS;
+        ts.tv_nsec = (deadline % SRS_UTIME_SECONDS) * 1000;
+        
+        pthread_mutex_lock(&lock);
+        // Drop the snapshot which is not applied.
+        srs_freep(latest);
+        latest = r;
+        nn_samples++;
+        
+        while (!quit && pthread_cond_timedwait(&cond, &lock, &ts) != ETIMEDOUT) {
         }
+        bool stopped = quit;
+        pthread_mutex_unlock(&lock);
         
-        fclose(f);
+        if (stopped) {
+            return;
+        }
     }
-#endif
 }
 
 SrsNetworkRtmpServer::SrsNetworkRtmpServer()
@@ -1081,6 +1555,79 @@ void srs_update_rtmp_server(int nb_conn, SrsKbps* kbps)
     }
 }
 
+SrsStartupPhases* _srs_startup = new SrsStartupPhases();
+
+SrsStartupPhases::SrsStartupPhases()
+{
+    starttime = last = 0;
+    done = false;
+}
+
+SrsStartupPhases::~SrsStartupPhases()
+{
+}
+
+void SrsStartupPhases::start()
+{
+    // @remark The system time is not updated before the cycle of server, so we must update it.
+    starttime = last = srs_update_system_time();
+    done = false;
+    names.clear();
+    elapses.clear();
+}
+
+void SrsStartupPhases::on_phase(string name)
+{
+    if (done) {
+        return;
+    }
+    
+    srs_utime_t now = srs_update_system_time();
+    names.push_back(name);
+    elapses.push_back(now - last);
+    last = now;
+}
+
+void SrsStartupPhases::on_ready()
+{
+    if (done) {
+        return;
+    }
+    done = true;
+    
+    srs_trace("startup ready in %dms, %s", srsu2msi(last - starttime), summary().c_str());
+}
+
+srs_utime_t SrsStartupPhases::total()
+{
+    if (done) {
+        return last - starttime;
+    }
+    return srs_update_system_time() - starttime;
+}
+
+string SrsStartupPhases::summary()
+{
+    stringstream ss;
+    for (int i = 0; i < (int)names.size(); i++) {
+        ss << (i? ", " : "") << names[i] << "=" << srsu2msi(elapses[i]) << "ms";
+    }
+    return ss.str();
+}
+
+void SrsStartupPhases::dumps(SrsJsonObject* obj)
+{
+    obj->set("ready", SrsJsonAny::boolean(done));
+    obj->set("total_ms", SrsJsonAny::integer(srsu2ms(total())));
+    
+    SrsJsonObject* phases = SrsJsonAny::object();
+    obj->set("phases", phases);
+    
+    for (int i = 0; i < (int)names.size(); i++) {
+        phases->set(names[i], SrsJsonAny::integer(srsu2ms(elapses[i])));
+    }
+}
+
 string srs_get_local_ip(int fd)
 {
     // discovery client information
@@ -1148,6 +1695,70 @@ bool srs_is_boolean(string str)
     return str == "true" || str == "false";
 }
 
+srs_error_t srs_parse_cpus(string cpus, vector<int>& list)
+{
+    srs_error_t err = srs_success;
+    
+    vector<string> ranges = srs_string_split(cpus, ",");
+    for (int i = 0; i < (int)ranges.size(); i++) {
+        string range = srs_string_trim_start(srs_string_trim_end(ranges.at(i), " "), " ");
+        if (range.empty()) {
+            continue;
+        }
+        
+        size_t pos = range.find("-");
+        string first = range.substr(0, pos);
+        string last = (pos == string::npos)? first : range.substr(pos + 1);
+        if (first.empty() || last.empty() || first.find_first_not_of("0123456789") != string::npos
+            || last.find_first_not_of("0123456789") != string::npos) {
+            return srs_error_new(ERROR_SYSTEM_AFFINITY, "invalid cpus %s", range.c_str());
+        }
+        
+        int from = ::atoi(first.c_str());
+        int to = ::atoi(last.c_str());
+        if (from > to) {
+            return srs_error_new(ERROR_SYSTEM_AFFINITY, "invalid cpus %s", range.c_str());
+        }
+        for (int cpu = from; cpu <= to; cpu++) {
+            list.push_back(cpu);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t srs_bind_cpu(int cpu, int* pnode)
+{
+    srs_error_t err = srs_success;
+    
+    *pnode = -1;
+    
+#ifndef SRS_AUTO_OSX
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return srs_error_new(ERROR_SYSTEM_AFFINITY, "invalid cpu %d", cpu);
+    }
+    
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (::sched_setaffinity(0, sizeof(set), &set) == -1) {
+        return srs_error_new(ERROR_SYSTEM_AFFINITY, "bind cpu %d", cpu);
+    }
+    
+    // The thread is migrated to the cpu when bind, so the node is the node of cpu.
+#ifdef SYS_getcpu
+    unsigned int c = 0, node = 0;
+    if (::syscall(SYS_getcpu, &c, &node, NULL) == 0 && (int)c == cpu) {
+        *pnode = (int)node;
+    }
+#endif
+#else
+    return srs_error_new(ERROR_SYSTEM_AFFINITY, "not support affinity");
+#endif
+    
+    return err;
+}
+
 void srs_api_dump_summaries(SrsJsonObject* obj)
 {
     SrsRusage* r = srs_get_system_rusage();
@@ -1221,6 +1832,14 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     self->set("cpu_percent", SrsJsonAny::number(u->percent));
     self->set("srs_uptime", SrsJsonAny::integer(srs_uptime));
     
+    SrsJsonObject* startup = SrsJsonAny::object();
+    self->set("startup", startup);
+    _srs_startup->dumps(startup);
+    
+    SrsJsonObject* overload = SrsJsonAny::object();
+    self->set("overload", overload);
+    _srs_overload->dumps(overload);
+    
     // system
     SrsJsonObject* sys = SrsJsonAny::object();
     data->set("system", sys);
@@ -1257,5 +1876,15 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     sys->set("conn_sys_tw", SrsJsonAny::integer(nrs->nb_conn_sys_tw));
     sys->set("conn_sys_udp", SrsJsonAny::integer(nrs->nb_conn_sys_udp));
     sys->set("conn_srs", SrsJsonAny::integer(nrs->nb_conn_srs));
+    
+    // The memory held by each subsystem of server.
+    SrsMemoryStat* ms = srs_memory_global();
+    SrsJsonObject* memory = SrsJsonAny::object();
+    data->set("memory", memory);
+    
+    for (int i = 0; i < SrsMemoryTypeMax; i++) {
+        memory->set(srs_memory_type2str((SrsMemoryType)i), SrsJsonAny::integer(ms->bytes[i]));
+    }
+    memory->set("total", SrsJsonAny::integer(ms->total()));
 }
 
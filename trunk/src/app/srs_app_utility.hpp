@@ -33,6 +33,8 @@
 #include <arpa/inet.h>
 #include <sys/resource.h>
 
+#include <pthread.h>
+
 #include <srs_app_st.hpp>
 #include <srs_kernel_log.hpp>
 #include <srs_service_utility.hpp>
@@ -64,6 +66,51 @@ extern std::string srs_path_build_stream(std::string template_path, std::string
 // @return the replaced path.
 extern std::string srs_path_build_timestamp(std::string template_path);
 
+// The token of compiled path template.
+enum SrsPathToken
+{
+    SrsPathTokenLiteral = 0,
+    SrsPathTokenYear,
+    SrsPathTokenMonth,
+    SrsPathTokenDay,
+    SrsPathTokenHour,
+    SrsPathTokenMinute,
+    SrsPathTokenSecond,
+    SrsPathTokenMillisecond,
+    SrsPathTokenTimestamp,
+    SrsPathTokenSeq
+};
+
+// The path template compiled once, for the file opened for each segment, such as HLS ts, DVR and DASH,
+// where the [vhost], [app] and [stream] are substituted when compile, and the variables of time and [seq]
+// are rendered to a reused buffer, see srs_path_build_stream and srs_path_build_timestamp.
+class SrsPathTemplate
+{
+private:
+    // The tokens and the literal for each, empty when it's a variable.
+    std::vector<SrsPathToken> tokens;
+    std::vector<std::string> literals;
+    // Whether there is any variable of time, to ignore the clock when render.
+    bool has_time;
+    bool utc;
+    // The buffer of rendered path.
+    std::string path;
+public:
+    SrsPathTemplate();
+    virtual ~SrsPathTemplate();
+public:
+    // Compile the template, substitute the variables of stream.
+    // @param utc Whether use the UTC time, or the local time.
+    virtual void compile(std::string tmpl, std::string vhost, std::string app, std::string stream, bool utc);
+    // Render the path by the current time.
+    // @param seq The [seq] variable, ignore if negative.
+    // @param timestamp Use it for the [timestamp] variable if not negative, for example, the floor ts of HLS.
+    // @remark The returned path is reused by next render.
+    virtual const std::string& render(int64_t seq = -1, int64_t timestamp = -1);
+private:
+    virtual void append(SrsPathToken token, std::string literal);
+};
+
 // Kill the pid by SIGINT, then wait to quit,
 // Kill the pid by SIGKILL again when exceed the timeout.
 // @param pid the pid to kill. ignore for -1. set to -1 when killed.
@@ -341,6 +388,8 @@ extern SrsProcSelfStat* srs_get_self_proc_stat();
 extern SrsProcSystemStat* srs_get_system_proc_stat();
 // The daemon st-thread will update it.
 extern void srs_update_proc_stat();
+// Get the resident bytes of current process right now, from /proc/self/statm, 0 if failed.
+extern int64_t srs_get_self_rss();
 
 // Stat disk iops
 // @see: http://stackoverflow.com/questions/4458183/how-the-util-of-iostat-is-computed
@@ -584,6 +633,9 @@ public:
 };
 
 // Get network devices info, use cache to avoid performance problem.
+// The max number of network devices to sample.
+#define MAX_NETWORK_DEVICES_COUNT 16
+
 extern SrsNetworkDevices* srs_get_network_devices();
 extern int srs_get_network_devices_count();
 // The daemon st-thread will update it.
@@ -632,6 +684,156 @@ extern SrsNetworkRtmpServer* srs_get_network_rtmp_server();
 // The daemon st-thread will update it.
 extern void srs_update_rtmp_server(int nb_conn, SrsKbps* kbps);
 
+// The default size of buffer to read a /proc file, the content beyond it is ignored.
+#define SRS_PROC_FILE_BUFFER 16384
+// The interval for the collector thread to sample the /proc.
+#define SRS_PROC_SAMPLE_INTERVAL (3 * SRS_UTIME_SECONDS)
+
+// The /proc file, which keeps the fd open, and reads the whole file by pread to a fixed buffer,
+// so the sampling never opens file, allocates memory or uses stdio.
+// @remark The fd is reopened at next read when read failed.
+class SrsProcFile
+{
+private:
+    std::string path;
+    int fd;
+    char* buf;
+    int size;
+public:
+    SrsProcFile(std::string p, int s = SRS_PROC_FILE_BUFFER);
+    virtual ~SrsProcFile();
+public:
+    // Read the whole file, return the NULL-terminated content, or NULL when failed.
+    virtual const char* read();
+};
+
+// Parse the content of /proc files, without stdio.
+extern bool srs_parse_proc_system_stat(const char* data, SrsProcSystemStat& r);
+extern bool srs_parse_proc_self_stat(const char* data, SrsProcSelfStat& r);
+extern void srs_parse_proc_vmstat(const char* data, SrsDiskStat& r);
+// Accumulate the stat of the disk devices in diskstats.
+extern void srs_parse_proc_diskstats(const char* data, const std::vector<std::string>& devices, SrsDiskStat& r);
+extern void srs_parse_proc_meminfo(const char* data, SrsMemInfo& r);
+extern void srs_parse_proc_uptime(const char* data, SrsPlatformInfo& r);
+extern void srs_parse_proc_loadavg(const char* data, SrsPlatformInfo& r);
+// Parse the network devices to the array of max size, return the number of devices.
+extern int srs_parse_proc_net_dev(const char* data, SrsNetworkDevices* devices, int max);
+
+// The snapshot of system stat, sampled from /proc.
+class SrsProcSnapshot
+{
+public:
+    SrsProcSelfStat self;
+    SrsProcSystemStat system;
+    SrsDiskStat disk;
+    SrsMemInfo meminfo;
+    SrsPlatformInfo platform;
+    SrsNetworkDevices devices[MAX_NETWORK_DEVICES_COUNT];
+    // The number of network devices, -1 if never sampled.
+    int nb_devices;
+public:
+    SrsProcSnapshot();
+};
+
+// The sampler of /proc, which keeps the files open. Each update samples the /proc to snapshot,
+// where the usage is calculated by the previous values in snapshot.
+// @remark A sampler should be used by only one thread.
+class SrsProcSampler
+{
+private:
+    int user_hz;
+    SrsProcFile* stat;
+    SrsProcFile* self_stat;
+    SrsProcFile* vmstat;
+    SrsProcFile* diskstats;
+    SrsProcFile* meminfo;
+    SrsProcFile* uptime;
+    SrsProcFile* loadavg;
+    SrsProcFile* net_dev;
+public:
+    SrsProcSampler();
+    virtual ~SrsProcSampler();
+public:
+    virtual void update_proc_stat(SrsProcSnapshot& r);
+    // Update the disk stat, only accumulate the devices in diskstats, ignore all if empty.
+    virtual void update_disk_stat(SrsProcSnapshot& r, const std::vector<std::string>& devices);
+    virtual void update_meminfo(SrsProcSnapshot& r);
+    virtual void update_platform_info(SrsProcSnapshot& r);
+    virtual void update_network_devices(SrsProcSnapshot& r);
+};
+
+// The collector of system stat, samples the /proc in an OS thread, then publishes an immutable
+// snapshot, which is applied to the stat of API by the ST thread, so the server cycle never
+// blocks at the /proc.
+// @remark The collector thread is an OS thread, so it can never use any ST API or write log.
+class SrsProcCollector
+{
+private:
+    pthread_t tid;
+    bool started;
+    bool quit;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // The latest snapshot published by thread, NULL if applied, protected by lock.
+    SrsProcSnapshot* latest;
+    // The disk devices to sample, protected by lock.
+    std::vector<std::string> devices;
+private:
+    // The number of snapshots published and applied.
+    int64_t nn_samples;
+    int64_t nn_applies;
+public:
+    SrsProcCollector();
+    virtual ~SrsProcCollector();
+public:
+    // Start the collector thread.
+    // @remark Must start after fork, because the threads are not forked.
+    virtual srs_error_t start();
+    virtual void stop();
+    virtual bool is_started();
+    // Set the disk devices to sample, ignore all if empty.
+    virtual void set_disk_devices(const std::vector<std::string>& v);
+    // Apply the latest snapshot to the stat of API, return false if no new snapshot.
+    // @remark Only for the ST thread.
+    virtual bool apply();
+private:
+    static void* pfn(void* arg);
+    virtual void cycle();
+};
+
+// The collector of system stat.
+extern SrsProcCollector* _srs_proc_collector;
+
+// The timing of startup phases, to find out which phase is slow for large config.
+class SrsStartupPhases
+{
+private:
+    srs_utime_t starttime;
+    srs_utime_t last;
+    bool done;
+    // The name and elapsed time of each phase, in order.
+    std::vector<std::string> names;
+    std::vector<srs_utime_t> elapses;
+public:
+    SrsStartupPhases();
+    virtual ~SrsStartupPhases();
+public:
+    // Start to measure, the time of process start.
+    virtual void start();
+    // Mark the phase as done, which elapses since the previous phase.
+    virtual void on_phase(std::string name);
+    // Mark the startup as done, the server is ready to serve, and log the phases.
+    virtual void on_ready();
+    // The total elapsed time of startup, to now when not ready.
+    virtual srs_utime_t total();
+    // The summary of phases, for example, "config=5ms, listen=0ms".
+    virtual std::string summary();
+    virtual void dumps(SrsJsonObject* obj);
+};
+
+// The startup phases of server.
+extern SrsStartupPhases* _srs_startup;
+
 // Get local or peer ip.
 // Where local ip is the server ip which client connected.
 extern std::string srs_get_local_ip(int fd);
@@ -646,6 +848,12 @@ extern std::string srs_get_peer_ip(int fd);
 //      otherwise, false.
 extern bool srs_is_boolean(std::string str);
 
+// Parse the list of cpus, for example, "0-3,8" is 0,1,2,3,8.
+extern srs_error_t srs_parse_cpus(std::string cpus, std::vector<int>& list);
+// Bind current thread to the cpu, and get the NUMA node of cpu, -1 if unknown.
+// @remark The threads created after it inherit the affinity.
+extern srs_error_t srs_bind_cpu(int cpu, int* pnode);
+
 // Dump summaries for /api/v1/summaries.
 extern void srs_api_dump_summaries(SrsJsonObject* obj);
 
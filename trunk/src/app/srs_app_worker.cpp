@@ -0,0 +1,233 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_app_worker.hpp>
+
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/wait.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_app_config.hpp>
+
+int _srs_worker_index = -1;
+
+// The mark in stream param, for stream relayed from sibling worker.
+#define SRS_WORKER_RELAY_MARK "srs_worker_relay"
+
+// When worker crash, wait for a while then respawn it.
+#define SRS_WORKER_RESPAWN_INTERVAL (1 * SRS_UTIME_SECONDS)
+
+// The signal received by master, 0 if none.
+volatile sig_atomic_t _srs_worker_signo = 0;
+
+void srs_worker_master_signal(int signo)
+{
+    _srs_worker_signo = signo;
+}
+
+// The signals master care about, forward to all workers.
+static int _srs_worker_signals[] = {
+    SRS_SIGNAL_RELOAD, SRS_SIGNAL_REOPEN_LOG, SRS_SIGNAL_FAST_QUIT, SRS_SIGNAL_GRACEFULLY_QUIT, SIGINT,
+    SRS_SIGNAL_DUMP_RECORDER
+};
+
+SrsWorkerMaster::SrsWorkerMaster()
+{
+    quiting = false;
+}
+
+SrsWorkerMaster::~SrsWorkerMaster()
+{
+}
+
+srs_error_t SrsWorkerMaster::run()
+{
+    srs_error_t err = srs_success;
+    
+    int count = _srs_config->get_workers_count();
+    pids.resize(count, -1);
+    
+    for (int i = 0; i < count; i++) {
+        bool is_worker = false;
+        if ((err = spawn(i, is_worker)) != srs_success) {
+            notify(SRS_SIGNAL_FAST_QUIT);
+            return srs_error_wrap(err, "spawn worker %d", i);
+        }
+        
+        if (is_worker) {
+            return err;
+        }
+    }
+    
+    // The master never use ST, so use the system signal handler.
+    for (int i = 0; i < (int)(sizeof(_srs_worker_signals) / sizeof(int)); i++) {
+        struct sigaction sa;
+        sa.sa_handler = srs_worker_master_signal;
+        sigemptyset(&sa.sa_mask);
+        // Never restart, for waitpid to be interrupted.
+        sa.sa_flags = 0;
+        sigaction(_srs_worker_signals[i], &sa, NULL);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    
+    srs_trace("master pid=%d, workers=%d, relay=%s", ::getpid(), count, srs_worker_relay_endpoint(0).c_str());
+    
+    bool is_worker = false;
+    if ((err = supervise(is_worker)) != srs_success) {
+        return srs_error_wrap(err, "supervise");
+    }
+    
+    // A respawned worker, continue to serve.
+    if (is_worker) {
+        return err;
+    }
+    
+    srs_trace("master pid=%d quit, all workers exited", ::getpid());
+    exit(0);
+    
+    return err;
+}
+
+srs_error_t SrsWorkerMaster::spawn(int index, bool& is_worker)
+{
+    pid_t pid = fork();
+    
+    if (pid < 0) {
+        return srs_error_new(ERROR_SYSTEM_WORKER_FORK, "fork worker %d", index);
+    }
+    
+    // The worker, reset the signal handlers for ST to take over.
+    if (pid == 0) {
+        for (int i = 0; i < (int)(sizeof(_srs_worker_signals) / sizeof(int)); i++) {
+            signal(_srs_worker_signals[i], SIG_DFL);
+        }
+        
+        _srs_worker_index = index;
+        is_worker = true;
+        return srs_success;
+    }
+    
+    pids[index] = pid;
+    srs_trace("master fork worker %d, pid=%d", index, pid);
+    
+    return srs_success;
+}
+
+void SrsWorkerMaster::notify(int signo)
+{
+    for (int i = 0; i < (int)pids.size(); i++) {
+        if (pids[i] > 0) {
+            ::kill(pids[i], signo);
+        }
+    }
+}
+
+srs_error_t SrsWorkerMaster::supervise(bool& is_worker)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        int status = 0;
+        pid_t pid = ::waitpid(-1, &status, 0);
+        
+        // Interrupted by signal, forward it to workers.
+        if (pid < 0 && errno == EINTR) {
+            int signo = _srs_worker_signo;
+            _srs_worker_signo = 0;
+            
+            if (signo == SRS_SIGNAL_FAST_QUIT || signo == SRS_SIGNAL_GRACEFULLY_QUIT || signo == SIGINT) {
+                quiting = true;
+            }
+            
+            if (signo) {
+                srs_trace("master forward signal=%d to workers, quiting=%d", signo, quiting);
+                notify(signo);
+            }
+            continue;
+        }
+        
+        // No more children.
+        if (pid < 0) {
+            return err;
+        }
+        
+        int index = -1;
+        for (int i = 0; i < (int)pids.size(); i++) {
+            if (pids[i] == pid) {
+                index = i;
+                pids[i] = -1;
+            }
+        }
+        
+        if (index < 0 || quiting) {
+            continue;
+        }
+        
+        srs_warn("master worker %d pid=%d exited, status=%d, respawn it", index, pid, status);
+        ::usleep(SRS_WORKER_RESPAWN_INTERVAL);
+        
+        if ((err = spawn(index, is_worker)) != srs_success) {
+            srs_warn("master ignore respawn error %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        if (is_worker) {
+            return err;
+        }
+    }
+    
+    return err;
+}
+
+string srs_worker_relay_endpoint(int index)
+{
+    int port = _srs_config->get_workers_relay_port() + index;
+    return string(SRS_CONSTS_LOCALHOST) + ":" + srs_int2str(port);
+}
+
+string srs_worker_relay_param(string param)
+{
+    if (param.empty()) {
+        return "?" SRS_WORKER_RELAY_MARK "=" + srs_int2str(_srs_worker_index);
+    }
+    return param + "&" SRS_WORKER_RELAY_MARK "=" + srs_int2str(_srs_worker_index);
+}
+
+bool srs_worker_is_relay(SrsRequest* req)
+{
+    return req && srs_string_contains(req->param, SRS_WORKER_RELAY_MARK "=");
+}
+
+string srs_worker_strip_relay_param(string param)
+{
+    return srs_query_remove(param, SRS_WORKER_RELAY_MARK);
+}
+
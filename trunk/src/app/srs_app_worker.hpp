@@ -0,0 +1,77 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_APP_WORKER_HPP
+#define SRS_APP_WORKER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+class SrsRequest;
+
+// The index of current worker process, start from 0.
+// It's -1 when not in worker mode, or in the master process.
+extern int _srs_worker_index;
+
+// The master of multiple worker processes, which share the listen ports by SO_REUSEPORT.
+// The master is not an ST process, it must fork workers before initialize ST,
+// because the epoll fd of ST can not be shared between processes.
+class SrsWorkerMaster
+{
+private:
+    // The pid of each worker, -1 if exited.
+    std::vector<pid_t> pids;
+    // Whether master is quiting, never respawn the exited workers.
+    bool quiting;
+public:
+    SrsWorkerMaster();
+    virtual ~SrsWorkerMaster();
+public:
+    // Fork the workers and supervise them.
+    // @remark Only return in the worker process, the master process exits when all workers quit.
+    virtual srs_error_t run();
+private:
+    // Fork the worker by index, return whether current process is the worker.
+    virtual srs_error_t spawn(int index, bool& is_worker);
+    // Forward the signal to all workers.
+    virtual void notify(int signo);
+    // Wait for signals and children, return whether current process is a new worker.
+    virtual srs_error_t supervise(bool& is_worker);
+};
+
+// Get the relay endpoint of worker, 127.0.0.1:(relay_port+index).
+extern std::string srs_worker_relay_endpoint(int index);
+// Append the relay mark to the stream param, for the relay is sent to sibling worker.
+extern std::string srs_worker_relay_param(std::string param);
+// Whether the request is relayed from sibling worker, which should never relay again.
+// @remark The mark is only trusted when accepted by the relay listener, see srs_worker_strip_relay_param.
+extern bool srs_worker_is_relay(SrsRequest* req);
+// Strip the relay mark from the stream param, for the client never relayed by sibling worker.
+extern std::string srs_worker_strip_relay_param(std::string param);
+
+#endif
+
@@ -23,6 +23,339 @@
 
 #include <srs_core_mem_watch.hpp>
 
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/mman.h>
+#ifndef SRS_AUTO_OSX
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <srs_core_performance.hpp>
+
+// The smallest size class, each class is double of previous one.
+#define SRS_MEMORY_POOL_MIN_BLOCK 32
+// The max cached bytes for each size class.
+#define SRS_MEMORY_POOL_MAX_CACHED (4 * 1024 * 1024)
+// The size class of block allocated by malloc directly.
+#define SRS_MEMORY_POOL_NO_CLASS -1
+
+// The policy of mbind, @see numaif.h
+#define SRS_MPOL_PREFERRED 1
+
+// The header of pooled block, aligned to 16 bytes for user data.
+struct SrsMemoryPoolHeader
+{
+    // The size class of block when allocated.
+    int index;
+    // Whether the block is carved from arena, which is never freed to system.
+    int arena;
+    union {
+        // The next free block when in freelist.
+        SrsMemoryPoolHeader* next;
+        int64_t align;
+    };
+};
+
+// The freelist and stat of each size class, for current thread.
+static __thread SrsMemoryPoolHeader* _srs_pool_free[SRS_MEMORY_POOL_CLASSES];
+static __thread SrsMemoryPoolStat _srs_pool_stats[SRS_MEMORY_POOL_CLASSES];
+
+// The arena of current thread, the blocks are carved from [pos, end) of current chunk.
+static __thread bool _srs_arena_enabled = false;
+static __thread int _srs_arena_huge_pages = SrsMemoryHugePagesNone;
+static __thread int _srs_arena_node = -1;
+static __thread char* _srs_arena_pos = NULL;
+static __thread char* _srs_arena_end = NULL;
+static __thread int64_t _srs_arena_bytes = 0;
+
+// Map a chunk of arena, which is aligned to the huge page.
+static char* srs_arena_map_chunk()
+{
+    void* p = MAP_FAILED;
+    
+#if !defined(SRS_AUTO_OSX) && defined(MAP_HUGETLB)
+    if (_srs_arena_huge_pages == SrsMemoryHugePagesExplicit) {
+        p = ::mmap(NULL, SRS_MEMORY_ARENA_CHUNK, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    }
+#endif
+    
+    // Map the double size and trim it, to align to the huge page, or the kernel never uses huge page for it.
+    if (p == MAP_FAILED) {
+        char* raw = (char*)::mmap(NULL, SRS_MEMORY_ARENA_CHUNK * 2, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (raw == (char*)MAP_FAILED) {
+            return NULL;
+        }
+        
+        char* aligned = (char*)(((uint64_t)raw + SRS_MEMORY_ARENA_CHUNK - 1) / SRS_MEMORY_ARENA_CHUNK * SRS_MEMORY_ARENA_CHUNK);
+        if (aligned > raw) {
+            ::munmap(raw, aligned - raw);
+        }
+        if (raw + SRS_MEMORY_ARENA_CHUNK * 2 > aligned + SRS_MEMORY_ARENA_CHUNK) {
+            ::munmap(aligned + SRS_MEMORY_ARENA_CHUNK, raw + SRS_MEMORY_ARENA_CHUNK * 2 - aligned - SRS_MEMORY_ARENA_CHUNK);
+        }
+        p = aligned;
+        
+#if !defined(SRS_AUTO_OSX) && defined(MADV_HUGEPAGE)
+        // Ignore the error, for the kernel maybe not support transparent huge pages.
+        if (_srs_arena_huge_pages != SrsMemoryHugePagesNone) {
+            ::madvise(p, SRS_MEMORY_ARENA_CHUNK, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    
+#if !defined(SRS_AUTO_OSX) && defined(SYS_mbind)
+    // Bind the chunk before touching it, so the pages are allocated on the node. We prefer rather than bind
+    // the node, to fallback to other nodes when the node is out of memory.
+    if (_srs_arena_node >= 0 && _srs_arena_node < 64) {
+        unsigned long mask = 1UL << _srs_arena_node;
+        ::syscall(SYS_mbind, p, SRS_MEMORY_ARENA_CHUNK, SRS_MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+    }
+#endif
+    
+    _srs_arena_bytes += SRS_MEMORY_ARENA_CHUNK;
+    return (char*)p;
+}
+
+// Carve a block of size bytes from arena, NULL if failed.
+static SrsMemoryPoolHeader* srs_arena_alloc(size_t size)
+{
+    // The tail of chunk, which is smaller than the block, is dropped.
+    if (!_srs_arena_pos || _srs_arena_pos + size > _srs_arena_end) {
+        char* chunk = srs_arena_map_chunk();
+        if (!chunk) {
+            return NULL;
+        }
+        _srs_arena_pos = chunk;
+        _srs_arena_end = chunk + SRS_MEMORY_ARENA_CHUNK;
+    }
+    
+    SrsMemoryPoolHeader* h = (SrsMemoryPoolHeader*)_srs_arena_pos;
+    _srs_arena_pos += size;
+    h->arena = 1;
+    return h;
+}
+
+static int srs_pool_class(size_t size)
+{
+    size_t block = SRS_MEMORY_POOL_MIN_BLOCK;
+    for (int i = 0; i < SRS_MEMORY_POOL_CLASSES; i++, block <<= 1) {
+        if (size <= block) {
+            return i;
+        }
+    }
+    return SRS_MEMORY_POOL_NO_CLASS;
+}
+
+void* srs_pool_alloc(size_t size)
+{
+    int index = srs_pool_class(size);
+    SrsMemoryPoolHeader* h = NULL;
+    
+    if (index == SRS_MEMORY_POOL_NO_CLASS) {
+        h = (SrsMemoryPoolHeader*)::malloc(sizeof(SrsMemoryPoolHeader) + size);
+        srs_assert(h);
+        h->index = index;
+        h->arena = 0;
+        return h + 1;
+    }
+    
+    SrsMemoryPoolStat* stat = &_srs_pool_stats[index];
+    stat->nn_alloc++;
+    
+    if ((h = _srs_pool_free[index]) != NULL) {
+        _srs_pool_free[index] = h->next;
+        stat->nn_reuse++;
+        stat->nn_cached--;
+    } else {
+        size_t block = sizeof(SrsMemoryPoolHeader) + (SRS_MEMORY_POOL_MIN_BLOCK << index);
+        if (!_srs_arena_enabled || (h = srs_arena_alloc(block)) == NULL) {
+            h = (SrsMemoryPoolHeader*)::malloc(block);
+            srs_assert(h);
+            h->arena = 0;
+        }
+    }
+    
+    h->index = index;
+    return h + 1;
+}
+
+void srs_pool_free(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    
+    SrsMemoryPoolHeader* h = (SrsMemoryPoolHeader*)ptr - 1;
+    int index = h->index;
+    
+    if (index == SRS_MEMORY_POOL_NO_CLASS) {
+        ::free(h);
+        return;
+    }
+    
+    srs_assert(index >= 0 && index < SRS_MEMORY_POOL_CLASSES);
+    SrsMemoryPoolStat* stat = &_srs_pool_stats[index];
+    stat->nn_free++;
+    
+    // The block of arena is always recycled, even it's freed by other thread.
+    if (h->arena) {
+        h->next = _srs_pool_free[index];
+        _srs_pool_free[index] = h;
+        stat->nn_recycle++;
+        stat->nn_cached++;
+        return;
+    }
+    
+#ifdef SRS_PERF_MEMORY_POOL
+    // Recycle the block, until the freelist is full.
+    if ((int64_t)(stat->nn_cached + 1) * (SRS_MEMORY_POOL_MIN_BLOCK << index) <= SRS_MEMORY_POOL_MAX_CACHED) {
+        h->next = _srs_pool_free[index];
+        _srs_pool_free[index] = h;
+        stat->nn_recycle++;
+        stat->nn_cached++;
+        return;
+    }
+#endif
+    
+    ::free(h);
+}
+
+SrsMemoryPoolStat* srs_pool_stat(int index)
+{
+    if (index < 0 || index >= SRS_MEMORY_POOL_CLASSES) {
+        return NULL;
+    }
+    
+    SrsMemoryPoolStat* stat = &_srs_pool_stats[index];
+    stat->block_size = SRS_MEMORY_POOL_MIN_BLOCK << index;
+    return stat;
+}
+
+int srs_pool_enable_arena(SrsMemoryHugePages huge_pages, int node)
+{
+    _srs_arena_enabled = true;
+    _srs_arena_huge_pages = huge_pages;
+    _srs_arena_node = node;
+    
+    // Map the first chunk, to check whether the arena works.
+    char* chunk = srs_arena_map_chunk();
+    if (!chunk) {
+        _srs_arena_enabled = false;
+        return errno;
+    }
+    _srs_arena_pos = chunk;
+    _srs_arena_end = chunk + SRS_MEMORY_ARENA_CHUNK;
+    
+    return 0;
+}
+
+int64_t srs_pool_arena_bytes()
+{
+    return _srs_arena_bytes;
+}
+
+const char* srs_memory_type2str(SrsMemoryType type)
+{
+    switch (type) {
+        case SrsMemoryGopCache: return "gop";
+        case SrsMemoryMetaCache: return "meta";
+        case SrsMemoryQueue: return "queue";
+        case SrsMemoryHlsCache: return "hls";
+        case SrsMemoryRecvBuffer: return "recv";
+        case SrsMemoryPlayBuffer: return "play_recv";
+        case SrsMemoryProtocolCache: return "protocol";
+        case SrsMemoryStatistic: return "statistic";
+        default: return "unknown";
+    }
+}
+
+SrsMemoryStat::SrsMemoryStat()
+{
+    for (int i = 0; i < SrsMemoryTypeMax; i++) {
+        bytes[i] = 0;
+    }
+}
+
+SrsMemoryStat::~SrsMemoryStat()
+{
+}
+
+int64_t SrsMemoryStat::total()
+{
+    int64_t v = 0;
+    for (int i = 0; i < SrsMemoryTypeMax; i++) {
+        v += bytes[i];
+    }
+    return v;
+}
+
+SrsMemoryStat* srs_memory_global()
+{
+    static SrsMemoryStat* stat = new SrsMemoryStat();
+    return stat;
+}
+
+SrsMemoryUsage::SrsMemoryUsage(SrsMemoryType t)
+{
+    type = t;
+    bytes = 0;
+    stat = NULL;
+}
+
+SrsMemoryUsage::~SrsMemoryUsage()
+{
+    update(0);
+}
+
+void SrsMemoryUsage::set_stat(SrsMemoryStat* v)
+{
+    if (stat == v) {
+        return;
+    }
+    
+    if (stat) {
+        stat->bytes[type] -= bytes;
+    }
+    if ((stat = v) != NULL) {
+        stat->bytes[type] += bytes;
+    }
+}
+
+void SrsMemoryUsage::set_type(SrsMemoryType t)
+{
+    if (type == t) {
+        return;
+    }
+    
+    int64_t v = bytes;
+    update(0);
+    type = t;
+    update(v);
+}
+
+void SrsMemoryUsage::add(int64_t delta)
+{
+    bytes += delta;
+    
+    srs_memory_global()->bytes[type] += delta;
+    if (stat) {
+        stat->bytes[type] += delta;
+    }
+}
+
+void SrsMemoryUsage::update(int64_t v)
+{
+    if (v != bytes) {
+        add(v - bytes);
+    }
+}
+
+int64_t SrsMemoryUsage::get()
+{
+    return bytes;
+}
+
 #ifdef SRS_AUTO_MEM_WATCH
 
 #include <map>
@@ -79,6 +412,13 @@ void srs_memory_report()
     }
     
     printf("%d objects leak %dKB.\n", (int)_srs_ptrs.size(), total / 1024);
+    
+    printf("srs memory pool report:\n");
+    for (int i = 0; i < SRS_MEMORY_POOL_CLASSES; i++) {
+        SrsMemoryPoolStat* stat = srs_pool_stat(i);
+        printf("    %dB: alloc=%" PRId64 ", reuse=%" PRId64 ", free=%" PRId64 ", recycle=%" PRId64 ", cached=%d\n",
+            stat->block_size, stat->nn_alloc, stat->nn_reuse, stat->nn_free, stat->nn_recycle, stat->nn_cached);
+    }
     printf("@remark use script to cleanup for memory watch: ./etc/init.d/srs stop\n");
 }
 
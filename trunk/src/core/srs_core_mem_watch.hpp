@@ -26,6 +26,124 @@
 
 #include <srs_core.hpp>
 
+// The stat of the memory pool, for each size class.
+struct SrsMemoryPoolStat
+{
+    // The bytes of block, excluding the pool header.
+    int block_size;
+    // The total number of alloc, and hit the freelist.
+    int64_t nn_alloc;
+    int64_t nn_reuse;
+    // The total number of free, and recycle to the freelist.
+    int64_t nn_free;
+    int64_t nn_recycle;
+    // The number of blocks in the freelist.
+    int nn_cached;
+};
+
+// The number of size classes of pool, from 32B to 64KB.
+#define SRS_MEMORY_POOL_CLASSES 12
+
+// Alloc memory from the size-classed pool of current thread, which must be freed by srs_pool_free.
+// @remark The block larger than the max class is allocated by malloc, and never cached.
+extern void* srs_pool_alloc(size_t size);
+// Free the memory allocated by srs_pool_alloc, recycle to the freelist of current thread.
+extern void srs_pool_free(void* ptr);
+// Get the stat of pool for current thread, the index is the size class.
+// @return The stat, or NULL if index out of range.
+extern SrsMemoryPoolStat* srs_pool_stat(int index);
+
+// The huge pages to back the arena of pool.
+enum SrsMemoryHugePages
+{
+    // The normal pages.
+    SrsMemoryHugePagesNone = 0,
+    // The transparent huge pages, by madvise.
+    SrsMemoryHugePagesTransparent,
+    // The explicit huge pages, by MAP_HUGETLB, which requires the reserved pages of vm.nr_hugepages,
+    // and fallback to transparent when no reserved page.
+    SrsMemoryHugePagesExplicit,
+};
+
+// The size of chunk of arena, which is a huge page of 2MB.
+#define SRS_MEMORY_ARENA_CHUNK (2 * 1024 * 1024)
+
+// Enable the arena of pool for current thread, to carve the blocks from the chunks, which are backed by huge pages
+// and bound to NUMA node, to reduce the TLB misses and the remote memory access for large GOP cache.
+// @param node The NUMA node to bind, -1 to not bind.
+// @remark The blocks of arena are never freed to system, but always recycled to the freelist.
+// @remark The block larger than the max class is still allocated by malloc.
+// @return 0 if success, or the errno.
+extern int srs_pool_enable_arena(SrsMemoryHugePages huge_pages, int node);
+// Get the bytes of chunks of arena for current thread.
+extern int64_t srs_pool_arena_bytes();
+
+// The subsystem which holds memory, for accounting.
+enum SrsMemoryType
+{
+    // The gop cache of source.
+    SrsMemoryGopCache = 0,
+    // The metadata and sequence headers of source.
+    SrsMemoryMetaCache,
+    // The queue of consumers.
+    SrsMemoryQueue,
+    // The ts message cache of HLS.
+    SrsMemoryHlsCache,
+    // The receive buffer of connections, except players.
+    SrsMemoryRecvBuffer,
+    // The receive buffer of players, which only read control messages.
+    SrsMemoryPlayBuffer,
+    // The caches of RTMP protocol, the iovs and c0c3 headers to send, and the chunk streams to receive.
+    SrsMemoryProtocolCache,
+    // The objects of statistic, such as the clients and streams.
+    SrsMemoryStatistic,
+    SrsMemoryTypeMax,
+};
+
+// Get the name of memory type, for example, "gop".
+extern const char* srs_memory_type2str(SrsMemoryType type);
+
+// The bytes held by each subsystem, for a stream or the whole server.
+class SrsMemoryStat
+{
+public:
+    int64_t bytes[SrsMemoryTypeMax];
+public:
+    SrsMemoryStat();
+    virtual ~SrsMemoryStat();
+public:
+    // Get the sum of bytes of all subsystems.
+    virtual int64_t total();
+};
+
+// Get the stat of the whole server, never NULL.
+extern SrsMemoryStat* srs_memory_global();
+
+// The bytes held by an object, which reports to the global stat and the stat of its stream.
+// @remark It only updates some counters, so it's ok to update for each message.
+class SrsMemoryUsage
+{
+private:
+    SrsMemoryType type;
+    int64_t bytes;
+    // The stat of stream, NULL if not attached.
+    SrsMemoryStat* stat;
+public:
+    SrsMemoryUsage(SrsMemoryType t);
+    virtual ~SrsMemoryUsage();
+public:
+    // Attach to the stat of stream, the bytes are moved from the previous one.
+    // @remark The stat must be alive while attached, please set to NULL to detach.
+    virtual void set_stat(SrsMemoryStat* v);
+    // Change the type, the bytes are moved from the previous type.
+    virtual void set_type(SrsMemoryType t);
+    // Increase or decrease the bytes.
+    virtual void add(int64_t delta);
+    // Update the bytes to the specified value.
+    virtual void update(int64_t v);
+    virtual int64_t get();
+};
+
 #ifdef SRS_AUTO_MEM_WATCH
 
 #warning "MemoryWatch is deprecated."
@@ -112,10 +112,11 @@
  */
 #undef SRS_PERF_MW_SO_RCVBUF
 /**
- * whether enable the fast vector for qeueue.
- * @see https://github.com/ossrs/srs/issues/251
+ * whether recycle the messages and payloads to the size-classed freelist,
+ * to avoid malloc and free for each message when ingest and fanout.
+ * @remark When disabled, the pool still alloc by malloc, but never cache the block.
  */
-#define SRS_PERF_QUEUE_FAST_VECTOR
+#define SRS_PERF_MEMORY_POOL
 /**
  * whether use cond wait to send messages.
  * @remark this improve performance for large connectios.
@@ -135,6 +136,16 @@
  */
 #define SRS_PERF_MIN_LATENCY_ENABLED false
 
+/**
+ * the adaptive MW(merged-write) of play connection, @see SrsMwAdaptive.
+ * the window is scaled by the send bitrate, from SRS_PERF_MW_ADAPTIVE_MIN,
+ * to the mw_latency of vhost when bitrate >= SRS_PERF_MW_ADAPTIVE_KBPS.
+ * @remark the bitrate is sampled in SRS_PERF_MW_ADAPTIVE_INTERVAL.
+ */
+#define SRS_PERF_MW_ADAPTIVE_MIN (20 * SRS_UTIME_MILLISECONDS)
+#define SRS_PERF_MW_ADAPTIVE_KBPS 4000
+#define SRS_PERF_MW_ADAPTIVE_INTERVAL (1 * SRS_UTIME_SECONDS)
+
 /**
  * how many chunk stream to cache, [0, N].
  * to imporove about 10% performance when chunk size small, and 5% for large chunk.
@@ -143,6 +154,34 @@
  */
 #define SRS_PERF_CHUNK_STREAM_CACHE 16
 
+/**
+ * the min bytes of chunk body to read directly into the payload of message,
+ * by readv to the payload and the free space of buffer for the next chunk header,
+ * to avoid copy the large chunk body from the buffer to payload.
+ * @remark for small chunk, we grow the buffer then copy, which merges more chunks in a syscall.
+ * @remark 0 to disable the direct read.
+ */
+#define SRS_PERF_CHUNK_DIRECT_READ 4096
+
+/**
+ * the recv buffer of RTMP starts from the min size, and doubles when a read fills it,
+ * util the max size, so the buffer of players which only read control messages keep small,
+ * while the buffer of publishers grow to the max size.
+ * @remark the buffer of player is shrinked to the min size when the role is identified.
+ * @remark the merged read of publisher may set the buffer larger than the max size.
+ */
+#define SRS_PERF_RECV_BUFFER_MIN 4096
+#define SRS_PERF_RECV_BUFFER_MAX 131072
+
+/**
+ * the DH key pool of complex handshake, which is refilled by the timer in interval,
+ * and generate at most SRS_PERF_DH_POOL_REFILL keys each time, about 0.6ms for each key,
+ * to avoid blocking the other coroutines for a long time.
+ * @remark the size of pool is configured by handshake.dh_pool.
+ */
+#define SRS_PERF_DH_POOL_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+#define SRS_PERF_DH_POOL_REFILL 16
+
 /**
  * the gop cache and play cache queue.
  */
@@ -177,6 +216,51 @@
     #undef SRS_PERF_SO_SNDBUF_SIZE
 #endif
 
+/**
+ * whether receive multiple udp packets in a syscall by recvmmsg, only for linux.
+ * for example, the mpegts over udp ingest of 50Mbps is about 35k packets/s.
+ * @remark the max number of packets in a batch is SRS_PERF_UDP_BATCH.
+ */
+#ifndef SRS_AUTO_OSX
+    #define SRS_PERF_UDP_RECVMMSG
+#endif
+#define SRS_PERF_UDP_BATCH 16
+
+/**
+ * whether send multiple udp packets in a syscall by sendmmsg, only for linux.
+ * for example, the multicast of mpegts sends a batch of datagrams when paced.
+ * @remark the max number of packets in a batch is SRS_PERF_UDP_BATCH.
+ */
+#ifndef SRS_AUTO_OSX
+    #define SRS_PERF_UDP_SENDMMSG
+#endif
+
+/**
+ * whether use the cpu instructions to calc the crc32 IEEE, detect the cpu at runtime,
+ * PCLMULQDQ for x86_64 and CRC32 for ARMv8, fallback to the slicing-by-8 table.
+ * @remark the crc32 of mpegts is always table driven, for the PSI is very small.
+ */
+#define SRS_PERF_CRC32_SIMD
+
+/**
+ * whether use SSE2 for x86_64 or NEON for ARMv8 to scan the annexb start code,
+ * which skips 16 bytes without zero once, to demux the h.264 of UDP TS, RTSP and raw stream.
+ */
+#define SRS_PERF_ANNEXB_SIMD
+
+/**
+ * the stack size in bytes of coroutines by role, 0 to use the default 64KB of ST.
+ * the stacks are pooled by ST and reused for the same size, so never use too many sizes,
+ * and the page below each stack is a guard page to crash on overflow.
+ * @remark the resident high-water of stacks by role is at the http api /api/v1/stacks.
+ */
+// the connection runs the handshake, hooks and the play loop, about 12KB is used.
+#define SRS_PERF_STACK_CONN (64 * 1024)
+// the recv thread of publisher runs the source, such as hls, dvr and forwarder.
+#define SRS_PERF_STACK_PUBLISH_RECV (64 * 1024)
+// the worker to post the batched events of http hooks, about 12KB is used.
+#define SRS_PERF_STACK_HOOKS (32 * 1024)
+
 /**
  * whether ensure glibc memory check.
  */
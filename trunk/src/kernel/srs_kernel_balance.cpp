@@ -23,8 +23,31 @@
 
 #include <srs_kernel_balance.hpp>
 
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
 using namespace std;
 
+#include <srs_kernel_utility.hpp>
+
+// The number of virtual nodes of each server on the hash ring.
+#define SRS_LB_VIRTUAL_NODES 64
+// The bounded load factor, the load of server should not exceed factor*average.
+#define SRS_LB_LOAD_FACTOR 1.25
+// Prefer the next server, if the rtt of selected server is larger than factor*rtt of next one.
+#define SRS_LB_RTT_FACTOR 3
+// The server is down for failures*backoff, but not exceed the max failures.
+#define SRS_LB_BACKOFF (3 * SRS_UTIME_SECONDS)
+#define SRS_LB_MAX_BACKOFF_FAILURES 10
+
+ISrsLoadBalancer::ISrsLoadBalancer()
+{
+}
+
+ISrsLoadBalancer::~ISrsLoadBalancer()
+{
+}
+
 SrsLbRoundRobin::SrsLbRoundRobin()
 {
     index = -1;
@@ -55,3 +78,252 @@ string SrsLbRoundRobin::select(const vector<string>& servers)
     return elem;
 }
 
+
+string SrsLbRoundRobin::select(const vector<string>& servers, const string& /*key*/)
+{
+    return select(servers);
+}
+
+void SrsLbRoundRobin::on_success(srs_utime_t /*rtt*/)
+{
+}
+
+void SrsLbRoundRobin::on_failure()
+{
+}
+
+void SrsLbRoundRobin::on_close()
+{
+}
+
+void SrsLbRoundRobin::on_winner(const string& server)
+{
+    elem = server;
+}
+
+SrsLbServerStat::SrsLbServerStat(string s)
+{
+    server = s;
+    load = 0;
+    failures = 0;
+    down_until = 0;
+    srtt = 0;
+}
+
+SrsLbServerStat::~SrsLbServerStat()
+{
+}
+
+bool SrsLbServerStat::is_healthy(srs_utime_t now)
+{
+    return failures == 0 || now >= down_until;
+}
+
+void SrsLbServerStat::on_success(srs_utime_t rtt)
+{
+    failures = 0;
+    down_until = 0;
+    
+    // Smooth the rtt like TCP, srtt = 7/8*srtt + 1/8*rtt.
+    srtt = srtt? (7 * srtt + rtt) / 8 : rtt;
+}
+
+void SrsLbServerStat::on_failure(srs_utime_t now)
+{
+    failures++;
+    down_until = now + srs_min(failures, SRS_LB_MAX_BACKOFF_FAILURES) * SRS_LB_BACKOFF;
+}
+
+SrsLbServerStats::SrsLbServerStats()
+{
+}
+
+SrsLbServerStats::~SrsLbServerStats()
+{
+    std::map<std::string, SrsLbServerStat*>::iterator it;
+    for (it = stats.begin(); it != stats.end(); ++it) {
+        SrsLbServerStat* stat = it->second;
+        srs_freep(stat);
+    }
+    stats.clear();
+}
+
+SrsLbServerStat* SrsLbServerStats::fetch(const string& server)
+{
+    std::map<std::string, SrsLbServerStat*>::iterator it = stats.find(server);
+    if (it != stats.end()) {
+        return it->second;
+    }
+    
+    SrsLbServerStat* stat = new SrsLbServerStat(server);
+    stats[server] = stat;
+    return stat;
+}
+
+SrsLbConsistentHash::SrsLbConsistentHash(SrsLbServerStats* s)
+{
+    stats = s;
+    loaded = false;
+}
+
+SrsLbConsistentHash::~SrsLbConsistentHash()
+{
+    on_close();
+}
+
+string SrsLbConsistentHash::selected()
+{
+    return elem;
+}
+
+string SrsLbConsistentHash::select(const vector<string>& servers, const string& key)
+{
+    srs_assert(!servers.empty());
+    
+    // Release the load of previous selected server.
+    on_close();
+    
+    build_ring(servers);
+    vector<SrsLbServerStat*> cands = candidates(key);
+    
+    srs_utime_t now = srs_get_system_time();
+    
+    // The bound of load, by the total load and healthy servers.
+    int total = 0, healthy = 0;
+    for (int i = 0; i < (int)cands.size(); i++) {
+        SrsLbServerStat* stat = cands.at(i);
+        total += stat->load;
+        if (stat->is_healthy(now)) {
+            healthy++;
+        }
+    }
+    int bound = (int)ceil(SRS_LB_LOAD_FACTOR * (total + 1) / srs_max(1, healthy));
+    
+    // Walk the ring, pick the first two healthy servers which are not overloaded.
+    SrsLbServerStat* first = NULL;
+    SrsLbServerStat* second = NULL;
+    for (int i = 0; i < (int)cands.size() && !second; i++) {
+        SrsLbServerStat* stat = cands.at(i);
+        if (!stat->is_healthy(now) || stat->load >= bound) {
+            continue;
+        }
+        
+        if (!first) {
+            first = stat;
+        } else {
+            second = stat;
+        }
+    }
+    
+    // Prefer the next one, when the rtt of first is much larger.
+    SrsLbServerStat* picked = first;
+    if (first && second && first->srtt > 0 && second->srtt > 0 && first->srtt > SRS_LB_RTT_FACTOR * second->srtt) {
+        picked = second;
+    }
+    
+    // All servers are down, try the one which recovers first.
+    if (!picked) {
+        picked = cands.at(0);
+        for (int i = 1; i < (int)cands.size(); i++) {
+            SrsLbServerStat* stat = cands.at(i);
+            if (stat->down_until < picked->down_until) {
+                picked = stat;
+            }
+        }
+    }
+    
+    elem = picked->server;
+    return elem;
+}
+
+void SrsLbConsistentHash::on_success(srs_utime_t rtt)
+{
+    if (elem.empty()) {
+        return;
+    }
+    
+    SrsLbServerStat* stat = stats->fetch(elem);
+    stat->on_success(rtt);
+    
+    if (!loaded) {
+        stat->load++;
+        loaded = true;
+    }
+}
+
+void SrsLbConsistentHash::on_failure()
+{
+    if (elem.empty()) {
+        return;
+    }
+    
+    SrsLbServerStat* stat = stats->fetch(elem);
+    stat->on_failure(srs_get_system_time());
+}
+
+void SrsLbConsistentHash::on_close()
+{
+    if (elem.empty() || !loaded) {
+        return;
+    }
+    
+    SrsLbServerStat* stat = stats->fetch(elem);
+    stat->load--;
+    loaded = false;
+}
+
+void SrsLbConsistentHash::on_winner(const string& server)
+{
+    // Move the load to the winner.
+    on_close();
+    elem = server;
+    
+    stats->fetch(elem)->load++;
+    loaded = true;
+}
+
+void SrsLbConsistentHash::build_ring(const vector<string>& s)
+{
+    if (servers == s && !ring.empty()) {
+        return;
+    }
+    
+    servers = s;
+    ring.clear();
+    
+    for (int i = 0; i < (int)servers.size(); i++) {
+        for (int j = 0; j < SRS_LB_VIRTUAL_NODES; j++) {
+            char node[16];
+            int nb = snprintf(node, sizeof(node), "#%d", j);
+            
+            string vnode = servers.at(i) + string(node, nb);
+            uint32_t point = srs_crc32_ieee(vnode.data(), (int)vnode.length());
+            ring.push_back(std::make_pair(point, i));
+        }
+    }
+    
+    std::sort(ring.begin(), ring.end());
+}
+
+vector<SrsLbServerStat*> SrsLbConsistentHash::candidates(const string& key)
+{
+    vector<SrsLbServerStat*> cands;
+    
+    uint32_t point = srs_crc32_ieee(key.data(), (int)key.length());
+    vector<pair<uint32_t, int> >::iterator it = std::lower_bound(ring.begin(), ring.end(), std::make_pair(point, 0));
+    
+    vector<bool> picked(servers.size(), false);
+    for (int i = 0; i < (int)ring.size() && cands.size() < servers.size(); i++, ++it) {
+        if (it == ring.end()) {
+            it = ring.begin();
+        }
+        
+        int index = it->second;
+        if (!picked[index]) {
+            picked[index] = true;
+            cands.push_back(stats->fetch(servers.at(index)));
+        }
+    }
+    
+    return cands;
+}
@@ -28,12 +28,38 @@
 
 #include <vector>
 #include <string>
+#include <map>
+
+/**
+ * The load balancer to select a server from multiple servers, and the feedback of the selected server,
+ * used for edge pull, edge push and other multiple server feature.
+ */
+class ISrsLoadBalancer
+{
+public:
+    ISrsLoadBalancer();
+    virtual ~ISrsLoadBalancer();
+public:
+    // Get the current selected server.
+    virtual std::string selected() = 0;
+    // Select a server for the key, for example, the stream url.
+    virtual std::string select(const std::vector<std::string>& servers, const std::string& key) = 0;
+public:
+    // The selected server is connected, and the rtt is the time to connect it.
+    virtual void on_success(srs_utime_t rtt) = 0;
+    // Failed to connect the selected server.
+    virtual void on_failure() = 0;
+    // The connection to selected server is closed.
+    virtual void on_close() = 0;
+    // The server wins the connect race and replaces the selected one, whose stat is updated by the racer.
+    virtual void on_winner(const std::string& server) = 0;
+};
 
 /**
  * the round-robin load balance algorithm,
  * used for edge pull and other multiple server feature.
  */
-class SrsLbRoundRobin
+class SrsLbRoundRobin : public ISrsLoadBalancer
 {
 private:
     // current selected index.
@@ -49,7 +75,84 @@ public:
     virtual uint32_t current();
     virtual std::string selected();
     virtual std::string select(const std::vector<std::string>& servers);
+// Interface ISrsLoadBalancer
+public:
+    // Ignore the key, always select the next server.
+    virtual std::string select(const std::vector<std::string>& servers, const std::string& key);
+    virtual void on_success(srs_utime_t rtt);
+    virtual void on_failure();
+    virtual void on_close();
+    virtual void on_winner(const std::string& server);
 };
 
-#endif
+// The state of a server for load balance, shared by all balancers.
+class SrsLbServerStat
+{
+public:
+    std::string server;
+    // The number of connections to this server, by balancers.
+    int load;
+    // The continuous failures to connect this server, reset when success.
+    int failures;
+    // The server is down until this time, because of failures.
+    srs_utime_t down_until;
+    // The smoothed rtt to connect this server, 0 if unknown.
+    srs_utime_t srtt;
+public:
+    SrsLbServerStat(std::string s);
+    virtual ~SrsLbServerStat();
+public:
+    virtual bool is_healthy(srs_utime_t now);
+    virtual void on_success(srs_utime_t rtt);
+    virtual void on_failure(srs_utime_t now);
+};
 
+// The stat of servers, shared by all balancers of a kind, for example, the origins of edge.
+class SrsLbServerStats
+{
+private:
+    std::map<std::string, SrsLbServerStat*> stats;
+public:
+    SrsLbServerStats();
+    virtual ~SrsLbServerStats();
+public:
+    // Fetch the stat of server, create it if not exists.
+    virtual SrsLbServerStat* fetch(const std::string& server);
+};
+
+/**
+ * The consistent hash with bounded loads, to select the same server for the same key,
+ * so the stream is pulled from the same origin by all edges, and the cache of origin is shared.
+ * When the server is down or overloaded, fallback to the next server on the hash ring,
+ * and prefer the faster one if the rtt is much smaller.
+ * @see https://arxiv.org/abs/1608.01350
+ */
+class SrsLbConsistentHash : public ISrsLoadBalancer
+{
+private:
+    SrsLbServerStats* stats;
+    // The servers of the hash ring, rebuild when changed.
+    std::vector<std::string> servers;
+    // The hash ring, the point and the index of server, sorted by point.
+    std::vector<std::pair<uint32_t, int> > ring;
+    // Current selected server, and whether its load is counted.
+    std::string elem;
+    bool loaded;
+public:
+    SrsLbConsistentHash(SrsLbServerStats* s);
+    virtual ~SrsLbConsistentHash();
+// Interface ISrsLoadBalancer
+public:
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers, const std::string& key);
+    virtual void on_success(srs_utime_t rtt);
+    virtual void on_failure();
+    virtual void on_close();
+    virtual void on_winner(const std::string& server);
+private:
+    virtual void build_ring(const std::vector<std::string>& servers);
+    // Get the candidates at ring, from the point of key, each server only once.
+    virtual std::vector<SrsLbServerStat*> candidates(const std::string& key);
+};
+
+#endif
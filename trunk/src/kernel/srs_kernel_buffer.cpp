@@ -79,6 +79,11 @@ int SrsBuffer::left()
     return nb_bytes - (int)(p - bytes);
 }
 
+char* SrsBuffer::head()
+{
+    return p;
+}
+
 bool SrsBuffer::empty()
 {
     return !bytes || (p >= bytes + nb_bytes);
@@ -111,57 +116,28 @@ int16_t SrsBuffer::read_2bytes()
 {
     srs_assert(require(2));
     
-    int16_t value;
-    char* pp = (char*)&value;
-    pp[1] = *p++;
-    pp[0] = *p++;
-    
-    return value;
+    return srs_read_be<int16_t>(p);
 }
 
 int32_t SrsBuffer::read_3bytes()
 {
     srs_assert(require(3));
     
-    int32_t value = 0x00;
-    char* pp = (char*)&value;
-    pp[2] = *p++;
-    pp[1] = *p++;
-    pp[0] = *p++;
-    
-    return value;
+    return srs_read_be24(p);
 }
 
 int32_t SrsBuffer::read_4bytes()
 {
     srs_assert(require(4));
     
-    int32_t value;
-    char* pp = (char*)&value;
-    pp[3] = *p++;
-    pp[2] = *p++;
-    pp[1] = *p++;
-    pp[0] = *p++;
-    
-    return value;
+    return srs_read_be<int32_t>(p);
 }
 
 int64_t SrsBuffer::read_8bytes()
 {
     srs_assert(require(8));
     
-    int64_t value;
-    char* pp = (char*)&value;
-    pp[7] = *p++;
-    pp[6] = *p++;
-    pp[5] = *p++;
-    pp[4] = *p++;
-    pp[3] = *p++;
-    pp[2] = *p++;
-    pp[1] = *p++;
-    pp[0] = *p++;
-    
-    return value;
+    return srs_read_be<int64_t>(p);
 }
 
 string SrsBuffer::read_string(int len)
@@ -196,45 +172,28 @@ void SrsBuffer::write_2bytes(int16_t value)
 {
     srs_assert(require(2));
     
-    char* pp = (char*)&value;
-    *p++ = pp[1];
-    *p++ = pp[0];
+    srs_write_be<int16_t>(p, value);
 }
 
 void SrsBuffer::write_4bytes(int32_t value)
 {
     srs_assert(require(4));
     
-    char* pp = (char*)&value;
-    *p++ = pp[3];
-    *p++ = pp[2];
-    *p++ = pp[1];
-    *p++ = pp[0];
+    srs_write_be<int32_t>(p, value);
 }
 
 void SrsBuffer::write_3bytes(int32_t value)
 {
     srs_assert(require(3));
     
-    char* pp = (char*)&value;
-    *p++ = pp[2];
-    *p++ = pp[1];
-    *p++ = pp[0];
+    srs_write_be24(p, value);
 }
 
 void SrsBuffer::write_8bytes(int64_t value)
 {
     srs_assert(require(8));
     
-    char* pp = (char*)&value;
-    *p++ = pp[7];
-    *p++ = pp[6];
-    *p++ = pp[5];
-    *p++ = pp[4];
-    *p++ = pp[3];
-    *p++ = pp[2];
-    *p++ = pp[1];
-    *p++ = pp[0];
+    srs_write_be<int64_t>(p, value);
 }
 
 void SrsBuffer::write_string(string value)
@@ -255,31 +214,73 @@ void SrsBuffer::write_bytes(char* data, int size)
 
 SrsBitBuffer::SrsBitBuffer(SrsBuffer* b)
 {
-    cb = 0;
-    cb_left = 0;
     stream = b;
+    bytes = (uint8_t*)b->head();
+    nb_bytes = b->left();
+    pos = 0;
 }
 
 SrsBitBuffer::~SrsBitBuffer()
 {
 }
 
-bool SrsBitBuffer::empty() {
-    if (cb_left) {
-        return false;
+bool SrsBitBuffer::empty()
+{
+    return pos >= nb_bytes * 8;
+}
+
+int8_t SrsBitBuffer::read_bit()
+{
+    srs_assert(!empty());
+    
+    return (int8_t)read_bits(1);
+}
+
+int SrsBitBuffer::left_bits()
+{
+    return nb_bytes * 8 - pos;
+}
+
+uint32_t SrsBitBuffer::peek_32bits()
+{
+    int offset = pos / 8;
+    int nb = nb_bytes - offset;
+    
+    // Load 8 bytes as a word, so there are 57+ bits after the shift of the bits read in byte.
+    uint64_t v = 0;
+    if (nb >= 8) {
+        char* p = (char*)bytes + offset;
+        v = srs_read_be<uint64_t>(p);
+    } else {
+        for (int i = 0; i < nb; i++) {
+            v |= (uint64_t)bytes[offset + i] << (56 - 8 * i);
+        }
     }
-    return stream->empty();
+    
+    return (uint32_t)((v << (pos % 8)) >> 32);
 }
 
-int8_t SrsBitBuffer::read_bit() {
-    if (!cb_left) {
-        srs_assert(!stream->empty());
-        cb = stream->read_1bytes();
-        cb_left = 8;
+uint32_t SrsBitBuffer::read_bits(int n)
+{
+    srs_assert(n >= 0 && n <= 32);
+    
+    if (n == 0) {
+        return 0;
     }
     
-    int8_t v = (cb >> (cb_left - 1)) & 0x01;
-    cb_left--;
+    uint32_t v = peek_32bits() >> (32 - n);
+    skip_bits(n);
+    
     return v;
 }
 
+void SrsBitBuffer::skip_bits(int n)
+{
+    srs_assert(n >= 0 && n <= left_bits());
+    
+    // Consume the bytes of stream, including the byte partially read.
+    int consumed = (pos + 7) / 8;
+    pos += n;
+    stream->skip((pos + 7) / 8 - consumed);
+}
+
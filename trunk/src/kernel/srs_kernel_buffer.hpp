@@ -27,10 +27,77 @@
 #include <srs_core.hpp>
 
 #include <sys/types.h>
+#include <string.h>
 #include <string>
 
 class SrsBuffer;
 
+// The byte order swapper specialized by the size of type, to build the big-endian codec.
+// @remark The SrsBuffer always assert the little-endian system, so we always swap the bytes.
+template<int N>
+struct SrsBytesOrder
+{
+};
+
+template<>
+struct SrsBytesOrder<1>
+{
+    static inline uint8_t swap(uint8_t v) { return v; }
+};
+
+template<>
+struct SrsBytesOrder<2>
+{
+    static inline uint16_t swap(uint16_t v) { return __builtin_bswap16(v); }
+};
+
+template<>
+struct SrsBytesOrder<4>
+{
+    static inline uint32_t swap(uint32_t v) { return __builtin_bswap32(v); }
+};
+
+template<>
+struct SrsBytesOrder<8>
+{
+    static inline uint64_t swap(uint64_t v) { return __builtin_bswap64(v); }
+};
+
+// The unchecked big-endian codec, to write or read the integer at p and move p forward.
+// @remark User must check the space of the whole block once, for example, by SrsBuffer::require, then
+//      write the fields by p=SrsBuffer::head() and SrsBuffer::skip the written bytes.
+template<typename T>
+inline void srs_write_be(char*& p, T v)
+{
+    v = (T)SrsBytesOrder<sizeof(T)>::swap(v);
+    memcpy(p, &v, sizeof(T));
+    p += sizeof(T);
+}
+
+template<typename T>
+inline T srs_read_be(char*& p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return (T)SrsBytesOrder<sizeof(T)>::swap(v);
+}
+
+// The 3bytes integer, for example, the FLV tag header and RTMP chunk header.
+inline void srs_write_be24(char*& p, uint32_t v)
+{
+    *p++ = (char)(v >> 16);
+    *p++ = (char)(v >> 8);
+    *p++ = (char)v;
+}
+
+inline int32_t srs_read_be24(char*& p)
+{
+    uint8_t* b = (uint8_t*)p;
+    p += 3;
+    return (int32_t)((b[0] << 16) | (b[1] << 8) | b[2]);
+}
+
 /**
  * the srs codec, to code and decode object with bytes:
  *      code: to encode/serialize object to bytes in buffer,
@@ -83,6 +150,8 @@ public:
  * convert basic types to bytes,
  * build basic types from bytes.
  * @remark the buffer never mange the bytes, user must manage it.
+ * @remark The integer accessors are not virtual, for they are used in the hot paths, please use the
+ *      srs_write_be and srs_read_be for a block of fields, which only checks the space once.
  */
 class SrsBuffer
 {
@@ -117,6 +186,8 @@ public:
     virtual int pos();
     // Left bytes in buffer, total size() minus the current pos().
     virtual int left();
+    // The current bytes, that is data() plus pos(), to write or read a block by srs_write_be or srs_read_be.
+    virtual char* head();
     /**
      * whether stream is empty.
      * if empty, user should never read or write.
@@ -127,7 +198,7 @@ public:
      * @return true if stream can read/write specified required_size bytes.
      * @remark assert required_size positive.
      */
-    virtual bool require(int required_size);
+    bool require(int required_size);
     // to change stream.
 public:
     /**
@@ -141,23 +212,23 @@ public:
     /**
      * get 1bytes char from stream.
      */
-    virtual int8_t read_1bytes();
+    int8_t read_1bytes();
     /**
      * get 2bytes int from stream.
      */
-    virtual int16_t read_2bytes();
+    int16_t read_2bytes();
     /**
      * get 3bytes int from stream.
      */
-    virtual int32_t read_3bytes();
+    int32_t read_3bytes();
     /**
      * get 4bytes int from stream.
      */
-    virtual int32_t read_4bytes();
+    int32_t read_4bytes();
     /**
      * get 8bytes int from stream.
      */
-    virtual int64_t read_8bytes();
+    int64_t read_8bytes();
     /**
      * get string from stream, length specifies by param len.
      */
@@ -170,23 +241,23 @@ public:
     /**
      * write 1bytes char to stream.
      */
-    virtual void write_1bytes(int8_t value);
+    void write_1bytes(int8_t value);
     /**
      * write 2bytes int to stream.
      */
-    virtual void write_2bytes(int16_t value);
+    void write_2bytes(int16_t value);
     /**
      * write 4bytes int to stream.
      */
-    virtual void write_4bytes(int32_t value);
+    void write_4bytes(int32_t value);
     /**
      * write 3bytes int to stream.
      */
-    virtual void write_3bytes(int32_t value);
+    void write_3bytes(int32_t value);
     /**
      * write 8bytes int to stream.
      */
-    virtual void write_8bytes(int64_t value);
+    void write_8bytes(int64_t value);
     /**
      * write string to stream
      */
@@ -200,19 +271,33 @@ public:
 /**
  * the bit stream, base on SrsBuffer,
  * for exmaple, the h.264 avc stream is bit stream.
+ * @remark The bits are read by word, from the left bytes of stream when created, and the byte of stream is
+ *      consumed when the first bit of it is read.
  */
 class SrsBitBuffer
 {
 private:
-    int8_t cb;
-    uint8_t cb_left;
     SrsBuffer* stream;
+    // The bytes to read bits from.
+    uint8_t* bytes;
+    int nb_bytes;
+    // The position in bits.
+    int pos;
 public:
     SrsBitBuffer(SrsBuffer* b);
     virtual ~SrsBitBuffer();
 public:
     virtual bool empty();
     virtual int8_t read_bit();
+    // The number of left bits.
+    virtual int left_bits();
+    // Get the next 32 bits without moving, the bits out of stream are zero.
+    virtual uint32_t peek_32bits();
+    // Read n bits, n in [0, 32].
+    // @remark User must ensure the left_bits() is enough.
+    virtual uint32_t read_bits(int n);
+    // Skip n bits, user must ensure the left_bits() is enough.
+    virtual void skip_bits(int n);
 };
 
 #endif
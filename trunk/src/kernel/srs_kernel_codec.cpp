@@ -123,8 +123,8 @@ bool SrsFlvVideo::keyframe(char* data, int size)
 
 bool SrsFlvVideo::sh(char* data, int size)
 {
-    // sequence header only for h264
-    if (!h264(data, size)) {
+    // sequence header only for h264 or hevc
+    if (!h264(data, size) && !hevc(data, size)) {
         return false;
     }
     
@@ -155,6 +155,166 @@ bool SrsFlvVideo::h264(char* data, int size)
     return codec_id == SrsVideoCodecIdAVC;
 }
 
+bool SrsFlvVideo::hevc(char* data, int size)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    char codec_id = data[0];
+    codec_id = codec_id & 0x0F;
+    
+    return codec_id == SrsVideoCodecIdHEVC;
+}
+
+bool SrsFlvVideo::disposable(char* data, int size)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    char frame_type = data[0];
+    frame_type = (frame_type >> 4) & 0x0F;
+    
+    if (frame_type == SrsVideoAvcFrameTypeDisposableInterFrame) {
+        return true;
+    }
+    
+    // Only h264 inter frame of NALUs, 5bytes header.
+    if (frame_type != SrsVideoAvcFrameTypeInterFrame || !h264(data, size) || size < 5) {
+        return false;
+    }
+    if (data[1] != SrsVideoAvcFrameTraitNALU) {
+        return false;
+    }
+    
+    // Check the nal_ref_idc of slices, ignore other NALUs such as SEI and AUD.
+    bool has_slice = false;
+    for (int pos = 5; pos < size;) {
+        if (pos + 5 > size) {
+            return false;
+        }
+        
+        uint8_t* p = (uint8_t*)data + pos;
+        int nb_nalu = (int)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+        if (nb_nalu <= 0 || nb_nalu > size - pos - 4) {
+            return false;
+        }
+        
+        SrsAvcNaluType nalu_type = (SrsAvcNaluType)(p[4] & 0x1f);
+        if (nalu_type == SrsAvcNaluTypeNonIDR || nalu_type == SrsAvcNaluTypeIDR) {
+            if ((p[4] & 0x60) != 0) {
+                return false;
+            }
+            has_slice = true;
+        }
+        
+        pos += 4 + nb_nalu;
+    }
+    
+    return has_slice;
+}
+
+// The uuid of SEI user data unregistered for the timestamp marker, without zero bytes,
+// so that the payload never need the emulation prevention bytes.
+static const char* srs_flv_video_marker_uuid = "srs-latency-mark";
+
+bool SrsFlvVideo::mark(char* data, int size, int64_t timestamp, char** pdata, int* psize)
+{
+    // Only h264 frame of NALUs, 5bytes header.
+    if (!h264(data, size) || size < 5 || data[1] != SrsVideoAvcFrameTraitNALU) {
+        return false;
+    }
+    
+    int64_t v = 0;
+    if (marker(data, size, &v)) {
+        return false;
+    }
+    
+    // Check the length of NALUs, for the marker is inserted in 4bytes length.
+    for (int pos = 5; pos < size;) {
+        if (pos + 4 > size) {
+            return false;
+        }
+        
+        uint8_t* p = (uint8_t*)data + pos;
+        int nb_nalu = (int)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+        if (nb_nalu <= 0 || nb_nalu > size - pos - 4) {
+            return false;
+        }
+        
+        pos += 4 + nb_nalu;
+    }
+    
+    int nb_data = size + SRS_FLV_VIDEO_MARKER_SIZE;
+    char* buf = new char[nb_data];
+    memcpy(buf, data, 5);
+    
+    // The NALU of SEI: length(4B), nal_unit_type(1B), payload_type(1B), payload_size(1B),
+    // uuid(16B), timestamp in hex(16B), rbsp_trailing_bits(1B).
+    char* p = buf + 5;
+    uint32_t nb_nalu = SRS_FLV_VIDEO_MARKER_SIZE - 4;
+    *p++ = (char)(nb_nalu >> 24);
+    *p++ = (char)(nb_nalu >> 16);
+    *p++ = (char)(nb_nalu >> 8);
+    *p++ = (char)nb_nalu;
+    *p++ = (char)SrsAvcNaluTypeSEI;
+    *p++ = 0x05;
+    *p++ = 32;
+    memcpy(p, srs_flv_video_marker_uuid, 16);
+    p += 16;
+    
+    static const char* hex = "0123456789abcdef";
+    for (int i = 15; i >= 0; i--) {
+        p[i] = hex[timestamp & 0x0f];
+        timestamp >>= 4;
+    }
+    p += 16;
+    *p++ = (char)0x80;
+    
+    memcpy(p, data + 5, size - 5);
+    
+    *pdata = buf;
+    *psize = nb_data;
+    
+    return true;
+}
+
+bool SrsFlvVideo::marker(char* data, int size, int64_t* ptimestamp)
+{
+    if (!h264(data, size) || size < 5 + SRS_FLV_VIDEO_MARKER_SIZE || data[1] != SrsVideoAvcFrameTraitNALU) {
+        return false;
+    }
+    
+    uint8_t* p = (uint8_t*)data + 5;
+    if (p[0] != 0 || p[1] != 0 || p[2] != 0 || p[3] != SRS_FLV_VIDEO_MARKER_SIZE - 4) {
+        return false;
+    }
+    if ((p[4] & 0x1f) != SrsAvcNaluTypeSEI || p[5] != 0x05 || p[6] != 32) {
+        return false;
+    }
+    if (memcmp(p + 7, srs_flv_video_marker_uuid, 16) != 0) {
+        return false;
+    }
+    
+    int64_t v = 0;
+    for (int i = 0; i < 16; i++) {
+        char ch = (char)p[23 + i];
+        if (ch >= '0' && ch <= '9') {
+            v = (v << 4) | (ch - '0');
+        } else if (ch >= 'a' && ch <= 'f') {
+            v = (v << 4) | (ch - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+    
+    *ptimestamp = v;
+    return true;
+}
+
 bool SrsFlvVideo::acceptable(char* data, int size)
 {
     // 1bytes required.
@@ -170,7 +330,7 @@ bool SrsFlvVideo::acceptable(char* data, int size)
         return false;
     }
     
-    if (codec_id < 2 || codec_id > 7) {
+    if ((codec_id < 2 || codec_id > 7) && codec_id != SrsVideoCodecIdHEVC) {
         return false;
     }
     
@@ -430,12 +590,16 @@ SrsFrame::SrsFrame()
 {
     codec = NULL;
     nb_samples = 0;
+    samples = inline_samples;
+    overflow_samples = NULL;
+    nb_overflow_samples = 0;
     dts = 0;
     cts = 0;
 }
 
 SrsFrame::~SrsFrame()
 {
+    srs_freepa(overflow_samples);
 }
 
 srs_error_t SrsFrame::initialize(SrsCodecConfig* c)
@@ -455,6 +619,20 @@ srs_error_t SrsFrame::add_sample(char* bytes, int size)
         return srs_error_new(ERROR_HLS_DECODE_ERROR, "Frame samples overflow");
     }
     
+    // Move to a larger overflow cache when the current cache is full, and never back to the inline cache.
+    int capacity = (samples == inline_samples)? SrsInlineNbSamples : nb_overflow_samples;
+    if (nb_samples >= capacity) {
+        int nn = srs_min(SrsMaxNbSamples, capacity * 2);
+        SrsSample* p = new SrsSample[nn];
+        for (int i = 0; i < nb_samples; i++) {
+            p[i] = samples[i];
+        }
+        
+        srs_freepa(overflow_samples);
+        samples = overflow_samples = p;
+        nb_overflow_samples = nn;
+    }
+    
     SrsSample* sample = &samples[nb_samples++];
     sample->bytes = bytes;
     sample->size = size;
@@ -496,6 +674,21 @@ srs_error_t SrsVideoFrame::add_sample(char* bytes, int size)
         return srs_error_wrap(err, "add frame");
     }
     
+    // For HEVC, the IRAP is the keyframe, and the VPS is the parameter set as SPS/PPS.
+    SrsVideoCodecConfig* c = vcodec();
+    if (c && c->id == SrsVideoCodecIdHEVC) {
+        SrsHevcNaluType nal_unit_type = SrsHevcNaluTypeParse(bytes[0]);
+        
+        if (nal_unit_type >= SrsHevcNaluTypeCodedSliceBlaWlp && nal_unit_type <= SrsHevcNaluTypeReservedIrap23) {
+            has_idr = true;
+        } else if (nal_unit_type >= SrsHevcNaluTypeVps && nal_unit_type <= SrsHevcNaluTypePps) {
+            has_sps_pps = true;
+        } else if (nal_unit_type == SrsHevcNaluTypeAccessUnitDelimiter) {
+            has_aud = true;
+        }
+        return err;
+    }
+    
     // for video, parse the nalu type, set the IDR flag.
     SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(bytes[0] & 0x1f);
     
@@ -526,8 +719,10 @@ SrsFormat::SrsFormat()
     audio = NULL;
     video = NULL;
     avc_parse_sps = true;
+    demux_samples = true;
     raw = NULL;
     nb_raw = 0;
+    parsed_sh_codec = SrsVideoCodecIdReserved;
 }
 
 SrsFormat::~SrsFormat()
@@ -607,7 +802,7 @@ srs_error_t SrsFormat::on_video(int64_t timestamp, char* data, int size)
     SrsVideoCodecId codec_id = (SrsVideoCodecId)(frame_type & 0x0f);
     
     // TODO: Support other codecs.
-    if (codec_id != SrsVideoCodecIdAVC) {
+    if (codec_id != SrsVideoCodecIdAVC && codec_id != SrsVideoCodecIdHEVC) {
         return err;
     }
     
@@ -677,9 +872,9 @@ srs_error_t SrsFormat::video_avc_demux(SrsBuffer* stream, int64_t timestamp)
         return err;
     }
     
-    // only support h.264/avc
-    if (codec_id != SrsVideoCodecIdAVC) {
-        return srs_error_new(ERROR_HLS_DECODE_ERROR, "avc only support video h.264/avc, actual=%d", codec_id);
+    // only support h.264/avc and h.265/hevc
+    if (codec_id != SrsVideoCodecIdAVC && codec_id != SrsVideoCodecIdHEVC) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "avc only support video h.264/avc or h.265/hevc, actual=%d", codec_id);
     }
     vcodec->id = codec_id;
     
@@ -698,13 +893,28 @@ srs_error_t SrsFormat::video_avc_demux(SrsBuffer* stream, int64_t timestamp)
     raw = stream->data() + stream->pos();
     nb_raw = stream->size() - stream->pos();
     
-    if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
+    // The same sequence header costs a memcmp, rather than parsing the SPS/PPS again.
+    if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader && parsed_sh_codec == codec_id && nb_raw > 0
+        && nb_raw == (int)vcodec->avc_extra_data.size() && !memcmp(raw, &vcodec->avc_extra_data[0], nb_raw)) {
+        return err;
+    }
+    
+    if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader && codec_id == SrsVideoCodecIdHEVC) {
+        parsed_sh_codec = SrsVideoCodecIdReserved;
+        if ((err = hevc_demux_hvcc(stream)) != srs_success) {
+            return srs_error_wrap(err, "demux hvcC");
+        }
+        parsed_sh_codec = codec_id;
+    } else if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
+        parsed_sh_codec = SrsVideoCodecIdReserved;
         // TODO: FIXME: Maybe we should ignore any error for parsing sps/pps.
         if ((err = avc_demux_sps_pps(stream)) != srs_success) {
             return srs_error_wrap(err, "demux SPS/PPS");
         }
+        parsed_sh_codec = codec_id;
     } else if (avc_packet_type == SrsVideoAvcFrameTraitNALU){
-        if ((err = video_nalu_demux(stream)) != srs_success) {
+        // Skip the NALUs when nobody consumes the samples, the raw data is still available.
+        if (demux_samples && (err = video_nalu_demux(stream)) != srs_success) {
             return srs_error_wrap(err, "demux NALU");
         }
     } else {
@@ -1025,6 +1235,185 @@ srs_error_t SrsFormat::avc_demux_sps_rbsp(char* rbsp, int nb_rbsp)
     return err;
 }
 
+srs_error_t SrsFormat::hevc_demux_hvcc(SrsBuffer* stream)
+{
+    // HEVCDecoderConfigurationRecord, the whole record is the extra data as avcC.
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2017.pdf, page 77.
+    int avc_extra_size = stream->size() - stream->pos();
+    if (avc_extra_size > 0) {
+        char *copy_stream_from = stream->data() + stream->pos();
+        vcodec->avc_extra_data = std::vector<char>(copy_stream_from, copy_stream_from + avc_extra_size);
+    }
+    
+    vcodec->videoParameterSetNALUnit.clear();
+    vcodec->sequenceParameterSetNALUnit.clear();
+    vcodec->pictureParameterSetNALUnit.clear();
+    
+    // The fixed 23bytes header, from configurationVersion to numOfArrays.
+    if (!stream->require(23)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode sequence header");
+    }
+    // configurationVersion, general_profile_space(2), general_tier_flag(1), general_profile_idc(5),
+    // general_profile_compatibility_flags(32), general_constraint_indicator_flags(48), general_level_idc(8),
+    // min_spatial_segmentation_idc(16), parallelismType(8), chromaFormat(8), bitDepthLumaMinus8(8),
+    // bitDepthChromaMinus8(8), avgFrameRate(16)
+    stream->skip(1 + 1 + 4 + 6 + 1 + 2 + 1 + 1 + 1 + 1 + 2);
+    
+    // constantFrameRate(2), numTemporalLayers(3), temporalIdNested(1), lengthSizeMinusOne(2)
+    vcodec->NAL_unit_length = stream->read_1bytes() & 0x03;
+    if (vcodec->NAL_unit_length == 2) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc lengthSizeMinusOne should never be 2");
+    }
+    
+    // The arrays of VPS, SPS, PPS and SEI, we only use the first one of each parameter set.
+    int numOfArrays = (uint8_t)stream->read_1bytes();
+    for (int i = 0; i < numOfArrays; i++) {
+        if (!stream->require(3)) {
+            return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode array");
+        }
+        // array_completeness(1), reserved(1), NAL_unit_type(6)
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)(stream->read_1bytes() & 0x3f);
+        int numNalus = stream->read_2bytes();
+        
+        std::vector<char>* ps = NULL;
+        if (nal_unit_type == SrsHevcNaluTypeVps) {
+            ps = &vcodec->videoParameterSetNALUnit;
+        } else if (nal_unit_type == SrsHevcNaluTypeSps) {
+            ps = &vcodec->sequenceParameterSetNALUnit;
+        } else if (nal_unit_type == SrsHevcNaluTypePps) {
+            ps = &vcodec->pictureParameterSetNALUnit;
+        }
+        
+        for (int j = 0; j < numNalus; j++) {
+            if (!stream->require(2)) {
+                return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode nalu size");
+            }
+            int nalUnitLength = stream->read_2bytes();
+            if (!stream->require(nalUnitLength)) {
+                return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode nalu data");
+            }
+            
+            if (ps && ps->empty() && nalUnitLength > 0) {
+                ps->resize(nalUnitLength);
+                stream->read_bytes(&(*ps)[0], nalUnitLength);
+            } else {
+                stream->skip(nalUnitLength);
+            }
+        }
+    }
+    
+    if (vcodec->sequenceParameterSetNALUnit.empty()) {
+        return srs_success;
+    }
+    
+    // decode the rbsp from sps, drop the emulation prevention byte 03 of XX 00 00 03 XX.
+    std::vector<char>& sps = vcodec->sequenceParameterSetNALUnit;
+    std::vector<char> rbsp(sps.size());
+    
+    int nb_rbsp = 0, nb_zeros = 0;
+    for (int i = 0; i < (int)sps.size(); i++) {
+        if (nb_zeros >= 2 && sps[i] == 3) {
+            nb_zeros = 0;
+            continue;
+        }
+        rbsp[nb_rbsp++] = sps[i];
+        nb_zeros = (sps[i] == 0)? nb_zeros + 1 : 0;
+    }
+    
+    return hevc_demux_sps_rbsp(&rbsp[0], nb_rbsp);
+}
+
+// Skip n bits of the bit buffer.
+static srs_error_t srs_hevc_skip_bits(SrsBitBuffer* bs, int n)
+{
+    srs_error_t err = srs_success;
+    
+    if (bs->left_bits() < n) {
+        return srs_error_new(ERROR_AVC_NALU_UEV, "skip %d bits, only %d bits", n, bs->left_bits());
+    }
+    bs->skip_bits(n);
+    
+    return err;
+}
+
+srs_error_t SrsFormat::hevc_demux_sps_rbsp(char* rbsp, int nb_rbsp)
+{
+    srs_error_t err = srs_success;
+    
+    // we donot parse the detail of sps.
+    // @see https://github.com/ossrs/srs/issues/474
+    if (!avc_parse_sps) {
+        return err;
+    }
+    
+    SrsBuffer stream(rbsp, nb_rbsp);
+    
+    // The 2bytes NALU header, sps_video_parameter_set_id(4), sps_max_sub_layers_minus1(3), sps_temporal_id_nesting_flag(1),
+    // then the general profile and level of profile_tier_level, 12bytes.
+    // 7.3.2.2.1 General sequence parameter set RBSP syntax, T-REC-H.265-201802-S!!PDF-E.pdf, page 33.
+    if (!stream.require(2 + 1 + 12)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps shall atleast 15bytes");
+    }
+    stream.skip(2);
+    int sps_max_sub_layers_minus1 = (stream.read_1bytes() >> 1) & 0x07;
+    stream.skip(12);
+    
+    SrsBitBuffer bs(&stream);
+    
+    // The sub layers of profile_tier_level.
+    // 7.3.3 Profile, tier and level syntax, T-REC-H.265-201802-S!!PDF-E.pdf, page 35.
+    int8_t sub_layer_profile_present_flag[8] = {0};
+    int8_t sub_layer_level_present_flag[8] = {0};
+    for (int i = 0; i < sps_max_sub_layers_minus1; i++) {
+        if ((err = srs_avc_nalu_read_bit(&bs, sub_layer_profile_present_flag[i])) != srs_success) {
+            return srs_error_wrap(err, "read sub_layer_profile_present_flag");
+        }
+        if ((err = srs_avc_nalu_read_bit(&bs, sub_layer_level_present_flag[i])) != srs_success) {
+            return srs_error_wrap(err, "read sub_layer_level_present_flag");
+        }
+    }
+    if (sps_max_sub_layers_minus1 > 0 && (err = srs_hevc_skip_bits(&bs, 2 * (8 - sps_max_sub_layers_minus1))) != srs_success) {
+        return srs_error_wrap(err, "read reserved_zero_2bits");
+    }
+    for (int i = 0; i < sps_max_sub_layers_minus1; i++) {
+        int nb_bits = (sub_layer_profile_present_flag[i]? 88 : 0) + (sub_layer_level_present_flag[i]? 8 : 0);
+        if ((err = srs_hevc_skip_bits(&bs, nb_bits)) != srs_success) {
+            return srs_error_wrap(err, "read sub layer %d", i);
+        }
+    }
+    
+    int32_t sps_seq_parameter_set_id = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, sps_seq_parameter_set_id)) != srs_success) {
+        return srs_error_wrap(err, "read sps_seq_parameter_set_id");
+    }
+    
+    int32_t chroma_format_idc = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, chroma_format_idc)) != srs_success) {
+        return srs_error_wrap(err, "read chroma_format_idc");
+    }
+    if (chroma_format_idc == 3) {
+        int8_t separate_colour_plane_flag = -1;
+        if ((err = srs_avc_nalu_read_bit(&bs, separate_colour_plane_flag)) != srs_success) {
+            return srs_error_wrap(err, "read separate_colour_plane_flag");
+        }
+    }
+    
+    int32_t pic_width_in_luma_samples = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, pic_width_in_luma_samples)) != srs_success) {
+        return srs_error_wrap(err, "read pic_width_in_luma_samples");
+    }
+    
+    int32_t pic_height_in_luma_samples = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, pic_height_in_luma_samples)) != srs_success) {
+        return srs_error_wrap(err, "read pic_height_in_luma_samples");
+    }
+    
+    vcodec->width = (int)pic_width_in_luma_samples;
+    vcodec->height = (int)pic_height_in_luma_samples;
+    
+    return err;
+}
+
 // LCOV_EXCL_STOP
 
 srs_error_t SrsFormat::video_nalu_demux(SrsBuffer* stream)
@@ -1112,15 +1501,8 @@ srs_error_t SrsFormat::avc_demux_annexb_format(SrsBuffer* stream)
         char* p = stream->data() + stream->pos();
         
         // get the last matched NALU
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            
-            stream->skip(1);
-        }
-        
-        char* pp = stream->data() + stream->pos();
+        char* pp = srs_avc_find_annexb(p, stream->data() + stream->size());
+        stream->skip((int)(pp - p));
         
         // skip the empty.
         if (pp - p <= 0) {
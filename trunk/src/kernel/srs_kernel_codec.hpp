@@ -238,6 +238,9 @@ enum SrsFrameType
     SrsFrameTypeScript = 18,
 };
 
+// The size of timestamp marker NALU with the 4bytes length, the SEI of user data unregistered.
+#define SRS_FLV_VIDEO_MARKER_SIZE 40
+
 /**
  * Fast tough the codec of FLV video.
  * @doc video_file_format_spec_v10_1.pdf, page 78, E.4.3 Video Tags
@@ -262,6 +265,29 @@ public:
      * check codec h264.
      */
     static bool h264(char* data, int size);
+    /**
+     * check codec hevc, the FLV codec id 12.
+     */
+    static bool hevc(char* data, int size);
+    /**
+     * check whether non-reference frame, which is dropped without breaking the decoding,
+     * that is the disposable inter frame, or the h264 frame whose slices are all nal_ref_idc 0.
+     * @remark Assume the NALU length is 4 bytes for h264, return false if failed to parse.
+     */
+    static bool disposable(char* data, int size);
+    /**
+     * mark the h264 frame of NALUs by a timestamp in SEI of user data unregistered, which is inserted
+     * as the first NALU, and copied through the origin and edges, to measure the latency end-to-end.
+     * @param pdata output the payload of marked frame, user must free it by srs_freepa.
+     * @return false if not a h264 frame of NALUs, or already marked.
+     * @remark Assume the NALU length is 4 bytes for h264, return false if failed to parse.
+     */
+    static bool mark(char* data, int size, int64_t timestamp, char** pdata, int* psize);
+    /**
+     * parse the timestamp of marker, which must be the first NALU of h264 frame.
+     * @return true if got a marker.
+     */
+    static bool marker(char* data, int size, int64_t* ptimestamp);
     /**
      * check the video RTMP/flv header info,
      * @return true if video RTMP/flv header is ok.
@@ -309,6 +335,9 @@ extern int srs_aac_srates[];
 
 // The max number of NALUs in a video, or aac frame in audio packet.
 #define SrsMaxNbSamples 256
+// The number of samples in the frame object, for most frames have few NALUs,
+// while the frame with more samples uses the overflow cache.
+#define SrsInlineNbSamples 8
 
 /**
  * The audio sample size in bits.
@@ -395,6 +424,29 @@ enum SrsAvcNaluType
 };
 std::string srs_avc_nalu2str(SrsAvcNaluType nalu_type);
 
+/**
+ * Table 7-1 - NAL unit type codes and NAL unit type classes, T-REC-H.265-201802-S!!PDF-E.pdf, page 86.
+ * The nal_unit_type is the 6bits after the forbidden_zero_bit of the 2bytes NALU header.
+ */
+enum SrsHevcNaluType
+{
+    SrsHevcNaluTypeCodedSliceTrailN = 0,
+    SrsHevcNaluTypeCodedSliceTrailR = 1,
+    // The IRAP(Intra Random Access Point) pictures, from BLA_W_LP to RSV_IRAP_VCL23.
+    SrsHevcNaluTypeCodedSliceBlaWlp = 16,
+    SrsHevcNaluTypeCodedSliceIdrWradl = 19,
+    SrsHevcNaluTypeCodedSliceIdrNlp = 20,
+    SrsHevcNaluTypeCodedSliceCra = 21,
+    SrsHevcNaluTypeReservedIrap23 = 23,
+    SrsHevcNaluTypeVps = 32,
+    SrsHevcNaluTypeSps = 33,
+    SrsHevcNaluTypePps = 34,
+    SrsHevcNaluTypeAccessUnitDelimiter = 35,
+    SrsHevcNaluTypeSeiPrefix = 39,
+};
+// Parse the nal_unit_type from the first byte of HEVC NALU.
+#define SrsHevcNaluTypeParse(code) (SrsHevcNaluType)(((code) >> 1) & 0x3f)
+
 /**
  * the avc payload format, must be ibmf or annexb format.
  * we guess by annexb first, then ibmf for the first time,
@@ -506,6 +558,7 @@ std::string srs_avc_level2str(SrsAvcLevel level);
  * It's the whole AAC raw data for AAC.
  * @remark Neither SPS/PPS or ASC is sample unit, it's codec sequence header.
  */
+// @remark Never inherit it, which is not virtual to keep it compact in the cache of frame.
 class SrsSample
 {
 public:
@@ -515,7 +568,7 @@ public:
     char* bytes;
 public:
     SrsSample();
-    virtual ~SrsSample();
+    ~SrsSample();
 };
 
 /**
@@ -610,6 +663,8 @@ public:
     int8_t NAL_unit_length;
     std::vector<char> sequenceParameterSetNALUnit;
     std::vector<char> pictureParameterSetNALUnit;
+    // For HEVC, the VPS, while the SPS and PPS are stored as AVC.
+    std::vector<char> videoParameterSetNALUnit;
 public:
     // the avc payload format.
     SrsAvcPayloadFormat payload_format;
@@ -635,11 +690,22 @@ public:
     SrsCodecConfig* codec;
     // The actual parsed number of samples.
     int nb_samples;
-    // The sampels cache.
-    SrsSample samples[SrsMaxNbSamples];
+    // The samples, point to the inline cache, or the overflow cache when more than inline.
+    SrsSample* samples;
+private:
+    // The inline cache of samples, in the frame object.
+    SrsSample inline_samples[SrsInlineNbSamples];
+    // The overflow cache of samples, which is kept and reused for the next frames.
+    SrsSample* overflow_samples;
+    int nb_overflow_samples;
 public:
     SrsFrame();
     virtual ~SrsFrame();
+private:
+    // No implementation - copy is unsupported, for the samples may point to the inline cache.
+    SrsFrame(const SrsFrame&);
+    // No implementation - assignment is unsupported.
+    SrsFrame& operator=(const SrsFrame&);
 public:
     // Initialize the frame, to parse sampels.
     virtual srs_error_t initialize(SrsCodecConfig* c);
@@ -707,6 +773,13 @@ public:
     // for sequence header, whether parse the h.264 sps.
     // TODO: FIXME: Refine it.
     bool avc_parse_sps;
+    // Whether demux the NALUs of video to samples, while the sequence header and frame type are always parsed.
+    // @remark Disable it when no muxer consumes the samples, for instance, the edge without hls/dash/dvr.
+    bool demux_samples;
+private:
+    // The codec of the sequence header parsed ok, whose bytes are the avc_extra_data of vcodec, to skip the
+    // same sequence header, which some encoders repeat on every keyframe. Reserved if not parsed.
+    SrsVideoCodecId parsed_sh_codec;
 public:
     SrsFormat();
     virtual ~SrsFormat();
@@ -735,6 +808,9 @@ private:
     virtual srs_error_t avc_demux_sps_pps(SrsBuffer* stream);
     virtual srs_error_t avc_demux_sps();
     virtual srs_error_t avc_demux_sps_rbsp(char* rbsp, int nb_rbsp);
+    // Demux the HEVCDecoderConfigurationRecord, the hvcC of HEVC sequence header.
+    virtual srs_error_t hevc_demux_hvcc(SrsBuffer* stream);
+    virtual srs_error_t hevc_demux_sps_rbsp(char* rbsp, int nb_rbsp);
 private:
     // Parse the H.264 NALUs.
     virtual srs_error_t video_nalu_demux(SrsBuffer* stream);
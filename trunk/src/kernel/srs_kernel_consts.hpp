@@ -58,6 +58,10 @@
 #define SRS_CONSTS_RTMP_MIN_CHUNK_SIZE 128
 #define SRS_CONSTS_RTMP_MAX_CHUNK_SIZE 65536
 
+// 5.3.1.1. Chunk Basic Header
+// Chunk stream IDs 64-65599 can be encoded in the 3-byte version.
+#define SRS_CONSTS_RTMP_MAX_CID 65599
+
 
 // The following is the timeout for rtmp protocol,
 // to avoid death connection.
@@ -124,10 +128,13 @@
 #define SRS_SIGNAL_RELOAD SIGHUP
 // Reopen the log file.
 #define SRS_SIGNAL_REOPEN_LOG SIGUSR1
-// For gracefully upgrade, start new SRS and gracefully quit old one.
+// For gracefully upgrade, start new SRS with the listeners, and gracefully quit old one.
+// @remark The SIGUSR2 is used by flight recorder, and the SIGURG is never raised for SRS never
+//       set the owner of socket, and it's ignored by default, so it's safe for old binary.
 // @see https://github.com/ossrs/srs/issues/1579
-// TODO: Not implemented.
-#define SRS_SIGNAL_UPGRADE SIGUSR2
+#define SRS_SIGNAL_UPGRADE SIGURG
+// Dump the events of flight recorder to file.
+#define SRS_SIGNAL_DUMP_RECORDER SIGUSR2
 // The signal for srs to fast quit, do essential dispose then exit.
 #define SRS_SIGNAL_FAST_QUIT SIGTERM
 // The signal for srs to gracefully quit, do carefully dispose then exit.
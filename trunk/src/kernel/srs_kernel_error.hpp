@@ -118,6 +118,33 @@
 #define ERROR_SOCKET_SETREUSEADDR           1079
 #define ERROR_SOCKET_SETCLOSEEXEC           1080
 #define ERROR_SOCKET_ACCEPT                 1081
+#define ERROR_SYSTEM_WORKER_FORK            1082
+#define ERROR_SYSTEM_DISK_IO_THREAD         1083
+#define ERROR_SOCKET_CONGESTION             1084
+#define ERROR_SOCKET_PACING                 1085
+#define ERROR_SYSTEM_LOG_THREAD             1086
+#define ERROR_SYSTEM_PROFILE                1087
+#define ERROR_SYSTEM_RECORDER               1088
+#define ERROR_SOCKET_WOULD_BLOCK            1089
+#define ERROR_SOCKET_NONBLOCK               1090
+#define ERROR_SYSTEM_UPGRADE                1091
+#define ERROR_SYSTEM_AFFINITY               1092
+#define ERROR_SYSTEM_ARENA                  1093
+#define ERROR_TLS_CONTEXT                   1094
+#define ERROR_TLS_HANDSHAKE                 1095
+#define ERROR_SRT_SOCKET                    1096
+#define ERROR_SRT_IO                        1097
+#define ERROR_SRT_STREAMID                  1098
+#define ERROR_SOCKET_MULTICAST              1099
+#define ERROR_SYSTEM_PROC_THREAD            1100
+#define ERROR_SNAPSHOT_NO_KEYFRAME          1101
+#define ERROR_SNAPSHOT_DECODE               1102
+#define ERROR_SNAPSHOT_DISABLED             1103
+#define ERROR_SOCKET_ZEROCOPY               1104
+#define ERROR_SYSTEM_API_THREAD             1105
+#define ERROR_SYSTEM_FANOUT_THREAD          1106
+#define ERROR_SOCKET_LOWAT                  1107
+#define ERROR_SYSTEM_SECURITY_TOKEN         1108
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -178,6 +205,9 @@
 #define ERROR_RTMP_MESSAGE_CREATE           2053
 #define ERROR_RTMP_PROXY_EXCEED             2054
 #define ERROR_RTMP_CREATE_STREAM_DEPTH      2055
+#define ERROR_RTSP_RESPONSE_STATUS          2056
+#define ERROR_RTSP_INTERLEAVED_CORRUPT      2057
+#define ERROR_RTMP_EDGE_MUX                 2058
 //
 // The system control message,
 // It's not an error, but special control logic.
@@ -287,6 +317,8 @@
 #define ERROR_INOTIFY_CREATE                3092
 #define ERROR_INOTIFY_OPENFD                3093
 #define ERROR_INOTIFY_WATCH                 3094
+#define ERROR_ADMISSION_REJECTED            3095
+#define ERROR_EDGE_TOKEN_TRAVERSE           3096
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
@@ -324,6 +356,26 @@
 #define ERROR_HTTP_302_INVALID              4038
 #define ERROR_BASE64_DECODE                 4039
 #define ERROR_HTTP_STREAM_EOF               4040
+#define ERROR_HTTP_CLIENT_POOL_FULL         4041
+#define ERROR_HTTP_HOOKS_INTERRUPTED        4042
+#define ERROR_RTSP_PULL_NO_TRACK            4043
+#define ERROR_RTSP_PULL_RTP_TIMEOUT         4044
+#define ERROR_HTTP2_PROTOCOL                4045
+#define ERROR_HTTP2_HPACK                   4046
+#define ERROR_HTTP2_HTTP11_REQUIRED         4047
+#define ERROR_UPLOAD_RESPONSE_INVALID       4048
+#define ERROR_RTC_STUN                      4049
+#define ERROR_RTC_SRTP                      4050
+#define ERROR_RTC_SDP                       4051
+#define ERROR_RTC_DTLS                      4052
+#define ERROR_RTC_RTCP                      4053
+#define ERROR_RTC_DISABLED                  4054
+#define ERROR_RTC_SESSION_TIMEOUT           4055
+#define ERROR_RELAY_DECODE                  4056
+#define ERROR_RELAY_REJECTED                4057
+#define ERROR_RELAY_CLOSED                  4058
+#define ERROR_RELAY_CONGESTED               4059
+#define ERROR_RELAY_AUTH                    4060
 
 ///////////////////////////////////////////////////////
 // HTTP API error.
@@ -30,11 +30,15 @@
 #endif
 
 #include <fcntl.h>
+#include <stdlib.h>
 #include <sstream>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_recorder.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
 
 // For utest to mock it.
 srs_open_t _srs_open_fn = ::open;
@@ -43,14 +47,53 @@ srs_read_t _srs_read_fn = ::read;
 srs_lseek_t _srs_lseek_fn = ::lseek;
 srs_close_t _srs_close_fn = ::close;
 
+// The size of buffer for async io, submit to io when full.
+#define SRS_FILE_ASYNC_BUFFER_SIZE 65536
+// The alignment of buffer, size and offset for O_DIRECT.
+#define SRS_FILE_DIRECT_ALIGN 4096
+
+ISrsFileFilter::ISrsFileFilter()
+{
+}
+
+ISrsFileFilter::~ISrsFileFilter()
+{
+}
+
+ISrsFileProducer::ISrsFileProducer()
+{
+}
+
+ISrsFileProducer::~ISrsFileProducer()
+{
+}
+
+ISrsAsyncFileIO::ISrsAsyncFileIO()
+{
+}
+
+ISrsAsyncFileIO::~ISrsAsyncFileIO()
+{
+}
+
 SrsFileWriter::SrsFileWriter()
 {
     fd = -1;
+    aio = NULL;
+    afilter = NULL;
+    abuf = NULL;
+    nb_abuf = 0;
+    apos = asize = 0;
+    wbuf = NULL;
+    nb_wbuf = 0;
+    block_size = 0;
+    direct = false;
 }
 
 SrsFileWriter::~SrsFileWriter()
 {
     close();
+    srs_freepa(abuf);
 }
 
 srs_error_t SrsFileWriter::open(string p)
@@ -64,11 +107,22 @@ srs_error_t SrsFileWriter::open(string p)
     int flags = O_CREAT|O_WRONLY|O_TRUNC;
     mode_t mode = S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH;
     
-    if ((fd = _srs_open_fn(p.c_str(), flags, mode)) < 0) {
+#ifdef O_DIRECT
+    // Fall back to the page cache, if the file system does not support O_DIRECT, such as tmpfs.
+    if (direct && !aio && block_size > 0) {
+        if ((fd = _srs_open_fn(p.c_str(), flags|O_DIRECT, mode)) < 0) {
+            srs_warn("open file %s without O_DIRECT", p.c_str());
+            direct = false;
+        }
+    }
+#endif
+    
+    if (fd < 0 && (fd = _srs_open_fn(p.c_str(), flags, mode)) < 0) {
         return srs_error_new(ERROR_SYSTEM_FILE_OPENE, "open file %s failed", p.c_str());
     }
     
     path = p;
+    apos = asize = 0;
     
     return err;
 }
@@ -89,6 +143,10 @@ srs_error_t SrsFileWriter::open_append(string p)
     }
     
     path = p;
+    apos = asize = (int64_t)_srs_lseek_fn(fd, 0, SEEK_END);
+    
+    // The end of file is not aligned, so never append by O_DIRECT.
+    direct = false;
     
     return err;
 }
@@ -99,6 +157,29 @@ void SrsFileWriter::close()
         return;
     }
     
+    if (aio) {
+        srs_error_t err = flush_async();
+        if (err == srs_success) {
+            err = aio->submit_close(fd);
+        }
+        if (err != srs_success) {
+            srs_warn("close file %s failed, %s", path.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        fd = -1;
+        return;
+    }
+    
+    srs_error_t err = flush_buffer();
+    if (err != srs_success) {
+        srs_warn("flush file %s failed, %s", path.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    // Free the cache, it's allocated again when write.
+    ::free(wbuf);
+    wbuf = NULL;
+    
     if (_srs_close_fn(fd) < 0) {
         srs_warn("close file %s failed", path.c_str());
     }
@@ -107,26 +188,151 @@ void SrsFileWriter::close()
     return;
 }
 
-bool SrsFileWriter::is_open()
+void SrsFileWriter::set_async(ISrsAsyncFileIO* v)
 {
-    return fd > 0;
+    srs_assert(fd < 0);
+    aio = v;
 }
 
-void SrsFileWriter::seek2(int64_t offset)
+bool SrsFileWriter::set_filter(ISrsFileFilter* v)
 {
-    off_t r0 = _srs_lseek_fn(fd, (off_t)offset, SEEK_SET);
-    srs_assert(r0 != -1);
+    if (!aio) {
+        return false;
+    }
+    
+    // Flush the cache, which is written without the filter.
+    if (fd > 0 && v != afilter) {
+        srs_error_t err = flush_async();
+        if (err != srs_success) {
+            srs_warn("flush file %s failed, %s", path.c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+    
+    afilter = v;
+    return true;
 }
 
-int64_t SrsFileWriter::tellg()
+void SrsFileWriter::set_buffer(int size, bool d)
 {
-    return (int64_t)_srs_lseek_fn(fd, 0, SEEK_CUR);
+    srs_assert(fd < 0);
+    
+    block_size = srs_max(0, size);
+    direct = d && block_size > 0;
+    
+    // For O_DIRECT, the block must be aligned, and only the tail of file is written unaligned.
+    if (direct) {
+        block_size = (block_size + SRS_FILE_DIRECT_ALIGN - 1) / SRS_FILE_DIRECT_ALIGN * SRS_FILE_DIRECT_ALIGN;
+    }
 }
 
-srs_error_t SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+srs_error_t SrsFileWriter::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if (fd < 0) {
+        return err;
+    }
+    
+    if (aio) {
+        return flush_async();
+    }
+    
+    return flush_buffer();
+}
+
+srs_error_t SrsFileWriter::flush_async()
+{
+    srs_error_t err = srs_success;
+    
+    if (nb_abuf <= 0) {
+        return err;
+    }
+    
+    // The io takes the buffer, and we will allocate another one.
+    char* buf = abuf;
+    int size = nb_abuf;
+    abuf = NULL;
+    nb_abuf = 0;
+    
+    if ((err = aio->submit_write(fd, buf, size, apos - size, afilter)) != srs_success) {
+        return srs_error_wrap(err, "write %s", path.c_str());
+    }
+    
+    return err;
+}
+
+bool SrsFileWriter::can_produce()
+{
+    return aio != NULL;
+}
+
+srs_error_t SrsFileWriter::write_produce(ISrsFileProducer* producer, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // For sync io, generate the data in place.
+    if (!aio) {
+        char* buf = new char[size];
+        SrsAutoFreeA(char, buf);
+        
+        producer->produce(buf, size);
+        srs_freep(producer);
+        
+        return write(buf, size, NULL);
+    }
+    
+    // Keep the writes in order, the cache is submitted before the produced data.
+    if ((err = flush_async()) != srs_success) {
+        srs_freep(producer);
+        return srs_error_wrap(err, "flush");
+    }
+    
+    if ((err = aio->submit_produce(fd, producer, size, apos, afilter)) != srs_success) {
+        return srs_error_wrap(err, "produce %s", path.c_str());
+    }
+    
+    apos += size;
+    if (apos > asize) {
+        asize = apos;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFileWriter::flush_buffer()
 {
     srs_error_t err = srs_success;
     
+    if (nb_wbuf <= 0) {
+        return err;
+    }
+    
+    // The unaligned block, for example, the tail of file, is written by page cache.
+    if (direct && (nb_wbuf % SRS_FILE_DIRECT_ALIGN) != 0) {
+        disable_direct();
+    }
+    
+    int size = nb_wbuf;
+    nb_wbuf = 0;
+    
+    for (int offset = 0; offset < size;) {
+        ssize_t nwrite = 0;
+        if ((err = do_write(wbuf + offset, size - offset, &nwrite)) != srs_success) {
+            return srs_error_wrap(err, "flush %d/%d bytes", offset, size);
+        }
+        offset += (int)nwrite;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFileWriter::do_write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = _srs_recorder->begin();
+    
     ssize_t nwrite;
     // TODO: FIXME: use st_write.
 #ifdef _WIN32
@@ -137,6 +343,8 @@ srs_error_t SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
         return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "write to file %s failed", path.c_str());
     }
     
+    _srs_recorder->end(SrsRecorderEventFileIO, starttime, (int)nwrite);
+    
     if (pnwrite != NULL) {
         *pnwrite = nwrite;
     }
@@ -144,6 +352,125 @@ srs_error_t SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
     return err;
 }
 
+void SrsFileWriter::disable_direct()
+{
+    direct = false;
+    
+#ifdef O_DIRECT
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags != -1 && (flags & O_DIRECT) != 0) {
+        ::fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+}
+
+bool SrsFileWriter::is_open()
+{
+    return fd > 0;
+}
+
+void SrsFileWriter::seek2(int64_t offset)
+{
+    srs_error_t err = lseek((off_t)offset, SEEK_SET, NULL);
+    srs_assert(err == srs_success);
+}
+
+int64_t SrsFileWriter::tellg()
+{
+    if (aio) {
+        return apos;
+    }
+    
+    return (int64_t)_srs_lseek_fn(fd, 0, SEEK_CUR) + nb_wbuf;
+}
+
+srs_error_t SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    if (aio) {
+        int size = block_size > 0? block_size : SRS_FILE_ASYNC_BUFFER_SIZE;
+        
+        // Large block, submit it directly.
+        if (nb_abuf + count > (size_t)size) {
+            if ((err = flush_async()) != srs_success) {
+                return srs_error_wrap(err, "flush");
+            }
+        }
+        if (count > (size_t)size) {
+            char* data = new char[count];
+            memcpy(data, buf, count);
+            if ((err = aio->submit_write(fd, data, (int)count, apos, afilter)) != srs_success) {
+                return srs_error_wrap(err, "write %s", path.c_str());
+            }
+        } else {
+            if (!abuf) {
+                abuf = new char[size];
+            }
+            memcpy(abuf + nb_abuf, buf, count);
+            nb_abuf += (int)count;
+        }
+        
+        apos += count;
+        if (apos > asize) {
+            asize = apos;
+        }
+        
+        if (pnwrite != NULL) {
+            *pnwrite = count;
+        }
+        return err;
+    }
+    
+    if (block_size <= 0) {
+        return do_write(buf, count, pnwrite);
+    }
+    
+    // Large block, write it directly if not O_DIRECT, which requires the aligned buffer.
+    if (!direct && count >= (size_t)block_size) {
+        if ((err = flush_buffer()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        return do_write(buf, count, pnwrite);
+    }
+    
+    if (!wbuf) {
+        void* p = NULL;
+#ifdef _WIN32
+        p = ::malloc(block_size);
+#else
+        if (::posix_memalign(&p, SRS_FILE_DIRECT_ALIGN, block_size) != 0) {
+            p = NULL;
+        }
+#endif
+        if (!p) {
+            return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "alloc %d bytes for %s", block_size, path.c_str());
+        }
+        wbuf = (char*)p;
+    }
+    
+    // Copy to the cache and write when full, so the block of O_DIRECT is always aligned.
+    char* p = (char*)buf;
+    size_t left = count;
+    while (left > 0) {
+        int size = (int)srs_min((size_t)(block_size - nb_wbuf), left);
+        memcpy(wbuf + nb_wbuf, p, size);
+        nb_wbuf += size;
+        p += size;
+        left -= size;
+        
+        if (nb_wbuf >= block_size && (err = flush_buffer()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+    }
+    
+    if (pnwrite != NULL) {
+        *pnwrite = count;
+    }
+    
+    return err;
+}
+
 srs_error_t SrsFileWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
@@ -167,16 +494,50 @@ srs_error_t SrsFileWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite
 
 srs_error_t SrsFileWriter::lseek(off_t offset, int whence, off_t* seeked)
 {
+    srs_error_t err = srs_success;
+    
+    // For async io, we only need to update the logical position.
+    if (aio) {
+        if ((err = flush_async()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+        
+        int64_t pos = offset;
+        if (whence == SEEK_CUR) {
+            pos += apos;
+        } else if (whence == SEEK_END) {
+            pos += asize;
+        }
+        if (pos < 0) {
+            return srs_error_new(ERROR_SYSTEM_FILE_SEEK, "seek file to %d", (int)pos);
+        }
+        
+        apos = pos;
+        if (seeked) {
+            *seeked = (off_t)pos;
+        }
+        return err;
+    }
+    
+    if ((err = flush_buffer()) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+    
     off_t sk = _srs_lseek_fn(fd, offset, whence);
     if (sk < 0) {
         return srs_error_new(ERROR_SYSTEM_FILE_SEEK, "seek file");
     }
     
+    // Write the following blocks by page cache, because the offset is unaligned.
+    if (direct && (sk % SRS_FILE_DIRECT_ALIGN) != 0) {
+        disable_direct();
+    }
+    
     if (seeked) {
         *seeked = sk;
     }
     
-    return srs_success;
+    return err;
 }
 
 ISrsFileReaderFactory::ISrsFileReaderFactory()
@@ -267,6 +628,11 @@ int64_t SrsFileReader::filesize()
     return size;
 }
 
+int SrsFileReader::get_fd()
+{
+    return fd;
+}
+
 srs_error_t SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
 {
     srs_error_t err = srs_success;
@@ -37,6 +37,48 @@
 
 class SrsFileReader;
 
+// The filter to transform the data before written to file, for example, to encrypt it.
+// @remark For async io, it's called by the io thread, so it should never use any ST API.
+class ISrsFileFilter
+{
+public:
+    ISrsFileFilter();
+    virtual ~ISrsFileFilter();
+public:
+    // Transform size bytes of buf in place, return 0 for success, or the errno.
+    virtual int filter(char* buf, int size) = 0;
+};
+
+// The producer of data to write, to generate the data in the io thread, for example, to packetize the ts.
+// @remark For async io, it's called by the io thread, so it should never use any ST API.
+class ISrsFileProducer
+{
+public:
+    ISrsFileProducer();
+    virtual ~ISrsFileProducer();
+public:
+    // Generate exactly size bytes to buf, the size is the one when submitted.
+    virtual void produce(char* buf, int size) = 0;
+};
+
+// The async file io, to write file in other threads, so the disk never blocks the caller.
+// @remark The writes of a fd are done in order, and the write error is returned by the next call of fd.
+class ISrsAsyncFileIO
+{
+public:
+    ISrsAsyncFileIO();
+    virtual ~ISrsAsyncFileIO();
+public:
+    // Write size bytes of buf at offset of fd, the io takes the ownership of buf, and free it by delete[].
+    // @param filter If not NULL, the io applies it to buf before write, in order of writes of fd.
+    virtual srs_error_t submit_write(int fd, char* buf, int size, int64_t offset, ISrsFileFilter* filter) = 0;
+    // Write size bytes generated by producer at offset of fd, the io takes the ownership of producer.
+    // @param filter If not NULL, the io applies it to the generated data before write.
+    virtual srs_error_t submit_produce(int fd, ISrsFileProducer* producer, int size, int64_t offset, ISrsFileFilter* filter) = 0;
+    // Wait for all writes of fd done, then close the fd.
+    virtual srs_error_t submit_close(int fd) = 0;
+};
+
 /**
  * file writer, to write to file.
  */
@@ -45,6 +87,25 @@ class SrsFileWriter : public ISrsWriteSeeker
 private:
     std::string path;
     int fd;
+private:
+    // The async io, NULL to write in current thread.
+    ISrsAsyncFileIO* aio;
+    // For async io, the filter applied by the io thread, NULL to write as is.
+    ISrsFileFilter* afilter;
+    // For async io, the data is cached then submit in large block.
+    char* abuf;
+    int nb_abuf;
+    // For async io, the logical position and size of file.
+    int64_t apos;
+    int64_t asize;
+private:
+    // For sync io, the data is cached then written in large block, NULL to write directly.
+    char* wbuf;
+    int nb_wbuf;
+    // The size of block to write, for both sync and async io.
+    int block_size;
+    // For sync io, whether write the block with O_DIRECT, which is cleared when write the unaligned tail.
+    bool direct;
 public:
     SrsFileWriter();
     virtual ~SrsFileWriter();
@@ -64,6 +125,37 @@ public:
      * @remark user can reopen again.
      */
     virtual void close();
+    /**
+     * write the file by async io, NULL to write in current thread.
+     * @remark user must set it before open.
+     */
+    virtual void set_async(ISrsAsyncFileIO* v);
+    /**
+     * set the filter to transform the data in the thread of async io.
+     * @return whether the filter is accepted, false if not async io.
+     * @remark the filter must be valid until the file is closed.
+     */
+    virtual bool set_filter(ISrsFileFilter* v);
+    /**
+     * cache the writes and write in block of size bytes, 0 to write directly.
+     * @param d whether write the block by O_DIRECT, only for sync io, ignored if not supported.
+     * @remark user must set it before open.
+     */
+    virtual void set_buffer(int size, bool d);
+    /**
+     * write the cached data to file, for example, at the boundary of segment.
+     * @remark the cache is always flushed when seek or close.
+     */
+    virtual srs_error_t flush();
+    // Whether the data could be generated in the io thread, by write_produce.
+    virtual bool can_produce();
+    // Write size bytes generated by producer, in the io thread if async, the writer takes the ownership of producer.
+    virtual srs_error_t write_produce(ISrsFileProducer* producer, int size);
+private:
+    virtual srs_error_t flush_async();
+    virtual srs_error_t flush_buffer();
+    virtual srs_error_t do_write(void* buf, size_t count, ssize_t* pnwrite);
+    virtual void disable_direct();
 public:
     virtual bool is_open();
     virtual void seek2(int64_t offset);
@@ -114,6 +206,8 @@ public:
     virtual void skip(int64_t size);
     virtual int64_t seek2(int64_t offset);
     virtual int64_t filesize();
+    // Get the fd of file, -1 if not open or not a system file.
+    virtual int get_fd();
 // Interface ISrsReadSeeker
 public:
     virtual srs_error_t read(void* buf, size_t count, ssize_t* pnread);
@@ -157,6 +157,7 @@ SrsCommonMessage::SrsCommonMessage()
 {
     payload = NULL;
     size = 0;
+    pooled = false;
 }
 
 SrsCommonMessage::~SrsCommonMessage()
@@ -164,14 +165,33 @@ SrsCommonMessage::~SrsCommonMessage()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    if (pooled) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
+}
+
+void* SrsCommonMessage::operator new(size_t size)
+{
+    return srs_pool_alloc(size);
+}
+
+void SrsCommonMessage::operator delete(void* ptr)
+{
+    srs_pool_free(ptr);
 }
 
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freepa(payload);
+    if (pooled) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
     
-    payload = new char[size];
+    payload = (char*)srs_pool_alloc(size);
+    pooled = true;
     srs_verbose("create payload for RTMP message. size=%d", size);
     
 #ifdef SRS_AUTO_MEM_WATCH
@@ -179,14 +199,35 @@ void SrsCommonMessage::create_payload(int size)
 #endif
 }
 
+char* SrsCommonMessage::detach_payload()
+{
+    char* data = payload;
+    
+    if (pooled && payload) {
+        data = new char[size];
+        memcpy(data, payload, size);
+        srs_pool_free(payload);
+    }
+    
+    payload = NULL;
+    pooled = false;
+    
+    return data;
+}
+
 srs_error_t SrsCommonMessage::create(SrsMessageHeader* pheader, char* body, int size)
 {
     // drop previous payload.
-    srs_freepa(payload);
+    if (pooled) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
     
     this->header = *pheader;
     this->payload = body;
     this->size = size;
+    this->pooled = false;
     
     return srs_success;
 }
@@ -204,6 +245,13 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::SrsSharedPtrPayload()
     payload = NULL;
     size = 0;
     shared_count = 0;
+    pooled = false;
+    
+    flv_cached = false;
+    nb_c0 = nb_c3 = 0;
+    chunk_stream_id = 0;
+    chunk_timestamp = 0;
+    flv_timestamp = 0;
 }
 
 SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
@@ -211,7 +259,21 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 #ifdef SRS_AUTO_MEM_WATCH
     srs_memory_unwatch(payload);
 #endif
-    srs_freepa(payload);
+    if (pooled) {
+        srs_pool_free(payload);
+    } else {
+        srs_freepa(payload);
+    }
+}
+
+void* SrsSharedPtrMessage::SrsSharedPtrPayload::operator new(size_t size)
+{
+    return srs_pool_alloc(size);
+}
+
+void SrsSharedPtrMessage::SrsSharedPtrPayload::operator delete(void* ptr)
+{
+    srs_pool_free(ptr);
 }
 
 SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0), payload(NULL)
@@ -219,6 +281,16 @@ SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0)
     ptr = NULL;
 }
 
+void* SrsSharedPtrMessage::operator new(size_t size)
+{
+    return srs_pool_alloc(size);
+}
+
+void SrsSharedPtrMessage::operator delete(void* ptr)
+{
+    srs_pool_free(ptr);
+}
+
 SrsSharedPtrMessage::~SrsSharedPtrMessage()
 {
     if (ptr) {
@@ -237,12 +309,14 @@ srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
     if ((err = create(&msg->header, msg->payload, msg->size)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
+    ptr->pooled = msg->pooled;
     
     // to prevent double free of payload:
     // initialize already attach the payload of msg,
     // detach the payload to transfer the owner to shared ptr.
     msg->payload = NULL;
     msg->size = 0;
+    msg->pooled = false;
     
     return err;
 }
@@ -332,6 +406,59 @@ int SrsSharedPtrMessage::chunk_header(char* cache, int nb_cache, bool c0)
     }
 }
 
+bool SrsSharedPtrMessage::cached_chunk_header(char** pc0, int* pnb_c0, char** pc3, int* pnb_c3)
+{
+    srs_assert(ptr);
+    
+    // Generate the headers for the first time.
+    if (!ptr->nb_c0) {
+        char* p = ptr->chunk_headers;
+        int nb_cache = (int)sizeof(ptr->chunk_headers);
+        
+        int nb_c0 = chunk_header(p, nb_cache, true);
+        int nb_c3 = chunk_header(p + nb_c0, nb_cache - nb_c0, false);
+        if (nb_c0 <= 0 || nb_c3 <= 0) {
+            return false;
+        }
+        
+        ptr->nb_c0 = nb_c0;
+        ptr->nb_c3 = nb_c3;
+        ptr->chunk_timestamp = timestamp;
+        ptr->chunk_stream_id = stream_id;
+    }
+    
+    if (ptr->chunk_timestamp != timestamp || ptr->chunk_stream_id != stream_id) {
+        return false;
+    }
+    
+    *pc0 = ptr->chunk_headers;
+    *pnb_c0 = ptr->nb_c0;
+    *pc3 = ptr->chunk_headers + ptr->nb_c0;
+    *pnb_c3 = ptr->nb_c3;
+    
+    return true;
+}
+
+char* SrsSharedPtrMessage::cached_flv_tag(bool* pfresh)
+{
+    srs_assert(ptr);
+    
+    *pfresh = !ptr->flv_cached;
+    
+    if (!ptr->flv_cached) {
+        ptr->flv_cached = true;
+        ptr->flv_timestamp = timestamp;
+        return ptr->flv_tag;
+    }
+    
+    // The script data tag is always written with timestamp 0.
+    if (is_av() && ptr->flv_timestamp != timestamp) {
+        return NULL;
+    }
+    
+    return ptr->flv_tag;
+}
+
 SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
 {
     srs_assert(ptr);
@@ -509,24 +636,32 @@ srs_error_t SrsFlvTransmuxer::write_tags(SrsSharedPtrMessage** msgs, int count)
     for (int i = 0; i < count; i++) {
         SrsSharedPtrMessage* msg = msgs[i];
         
-        // cache all flv header.
-        if (msg->is_audio()) {
-            cache_audio(msg->timestamp, msg->payload, msg->size, cache);
-        } else if (msg->is_video()) {
-            cache_video(msg->timestamp, msg->payload, msg->size, cache);
-        } else {
-            cache_metadata(SrsFrameTypeScript, msg->payload, msg->size, cache);
-        }
+        // Use the tag header shared by all consumers, or generate it in our cache.
+        bool fresh = false;
+        char* shared = msg->cached_flv_tag(&fresh);
+        char* header = shared? shared : cache;
+        char* pre_size = shared? shared + SRS_FLV_TAG_HEADER_SIZE : pts;
         
-        // cache all pts.
-        cache_pts(SRS_FLV_TAG_HEADER_SIZE + msg->size, pts);
+        if (!shared || fresh) {
+            // cache all flv header.
+            if (msg->is_audio()) {
+                cache_audio(msg->timestamp, msg->payload, msg->size, header);
+            } else if (msg->is_video()) {
+                cache_video(msg->timestamp, msg->payload, msg->size, header);
+            } else {
+                cache_metadata(SrsFrameTypeScript, msg->payload, msg->size, header);
+            }
+            
+            // cache all pts.
+            cache_pts(SRS_FLV_TAG_HEADER_SIZE + msg->size, pre_size);
+        }
         
         // all ioves.
-        iovs[0].iov_base = cache;
+        iovs[0].iov_base = header;
         iovs[0].iov_len = SRS_FLV_TAG_HEADER_SIZE;
         iovs[1].iov_base = msg->payload;
         iovs[1].iov_len = msg->size;
-        iovs[2].iov_base = pts;
+        iovs[2].iov_base = pre_size;
         iovs[2].iov_len = SRS_FLV_PREVIOUS_TAG_SIZE;
         
         // move next.
@@ -555,15 +690,15 @@ void SrsFlvTransmuxer::cache_metadata(char type, char* data, int size, char* cac
      (char)0x00, (char)0x00, (char)0x00, // StreamID UI24 Always 0.
      };*/
     
-    SrsBuffer* tag_stream = new SrsBuffer(cache, 11);
-    SrsAutoFree(SrsBuffer, tag_stream);
+    // The cache is SRS_FLV_TAG_HEADER_SIZE bytes, write it without checking.
+    char* p = cache;
     
     // write data size.
-    tag_stream->write_1bytes(type);
-    tag_stream->write_3bytes(size);
-    tag_stream->write_3bytes(0x00);
-    tag_stream->write_1bytes(0x00);
-    tag_stream->write_3bytes(0x00);
+    *p++ = type;
+    srs_write_be24(p, size);
+    srs_write_be24(p, 0x00);
+    *p++ = 0x00;
+    srs_write_be24(p, 0x00);
 }
 
 void SrsFlvTransmuxer::cache_audio(int64_t timestamp, char* data, int size, char* cache)
@@ -581,16 +716,16 @@ void SrsFlvTransmuxer::cache_audio(int64_t timestamp, char* data, int size, char
      (char)0x00, (char)0x00, (char)0x00, // StreamID UI24 Always 0.
      };*/
     
-    SrsBuffer* tag_stream = new SrsBuffer(cache, 11);
-    SrsAutoFree(SrsBuffer, tag_stream);
+    // The cache is SRS_FLV_TAG_HEADER_SIZE bytes, write it without checking.
+    char* p = cache;
     
     // write data size.
-    tag_stream->write_1bytes(SrsFrameTypeAudio);
-    tag_stream->write_3bytes(size);
-    tag_stream->write_3bytes((int32_t)timestamp);
+    *p++ = SrsFrameTypeAudio;
+    srs_write_be24(p, size);
+    srs_write_be24(p, (uint32_t)timestamp);
     // default to little-endian
-    tag_stream->write_1bytes((timestamp >> 24) & 0xFF);
-    tag_stream->write_3bytes(0x00);
+    *p++ = (timestamp >> 24) & 0xFF;
+    srs_write_be24(p, 0x00);
 }
 
 void SrsFlvTransmuxer::cache_video(int64_t timestamp, char* data, int size, char* cache)
@@ -608,23 +743,22 @@ void SrsFlvTransmuxer::cache_video(int64_t timestamp, char* data, int size, char
      (char)0x00, (char)0x00, (char)0x00, // StreamID UI24 Always 0.
      };*/
     
-    SrsBuffer* tag_stream = new SrsBuffer(cache, 11);
-    SrsAutoFree(SrsBuffer, tag_stream);
+    // The cache is SRS_FLV_TAG_HEADER_SIZE bytes, write it without checking.
+    char* p = cache;
     
     // write data size.
-    tag_stream->write_1bytes(SrsFrameTypeVideo);
-    tag_stream->write_3bytes(size);
-    tag_stream->write_3bytes((int32_t)timestamp);
+    *p++ = SrsFrameTypeVideo;
+    srs_write_be24(p, size);
+    srs_write_be24(p, (uint32_t)timestamp);
     // default to little-endian
-    tag_stream->write_1bytes((timestamp >> 24) & 0xFF);
-    tag_stream->write_3bytes(0x00);
+    *p++ = (timestamp >> 24) & 0xFF;
+    srs_write_be24(p, 0x00);
 }
 
 void SrsFlvTransmuxer::cache_pts(int size, char* cache)
 {
-    SrsBuffer* tag_stream = new SrsBuffer(cache, 11);
-    SrsAutoFree(SrsBuffer, tag_stream);
-    tag_stream->write_4bytes(size);
+    char* p = cache;
+    srs_write_be<int32_t>(p, size);
 }
 
 srs_error_t SrsFlvTransmuxer::write_tag(char* header, int header_size, char* tag, int tag_size)
@@ -894,6 +1028,58 @@ srs_error_t SrsFlvVodStreamDecoder::read_sequence_header_summary(int64_t* pstart
     return err;
 }
 
+srs_error_t SrsFlvVodStreamDecoder::read_keyframes(vector<int64_t>& times, vector<int64_t>& offsets)
+{
+    srs_error_t err = srs_success;
+    
+    // The tag header, and two bytes of tag body for codec and frame type.
+    char tag_header[SRS_FLV_TAG_HEADER_SIZE + 2];
+    
+    bool has_video = false;
+    int64_t last_audio = -1;
+    
+    int64_t filesize = reader->filesize();
+    while (reader->tellg() + (int64_t)sizeof(tag_header) <= filesize) {
+        int64_t offset = reader->tellg();
+        if ((err = reader->read(tag_header, sizeof(tag_header), NULL)) != srs_success) {
+            return srs_error_wrap(err, "read tag header");
+        }
+        
+        SrsBuffer stream(tag_header, sizeof(tag_header));
+        int8_t tag_type = stream.read_1bytes() & 0x1f;
+        int32_t data_size = stream.read_3bytes();
+        int32_t timestamp = stream.read_3bytes();
+        timestamp |= (uint32_t)stream.read_1bytes() << 24;
+        stream.skip(3);
+        
+        if (tag_type == SrsFrameTypeVideo && data_size >= 2) {
+            char* p = tag_header + SRS_FLV_TAG_HEADER_SIZE;
+            bool sh = SrsFlvVideo::sh(p, 2);
+            if (!has_video) {
+                has_video = true;
+                times.clear();
+                offsets.clear();
+            }
+            if (!sh && SrsFlvVideo::keyframe(p, 2)) {
+                times.push_back(timestamp);
+                offsets.push_back(offset);
+            }
+        } else if (tag_type == SrsFrameTypeAudio && !has_video) {
+            if (last_audio < 0 || timestamp - last_audio >= 1000) {
+                last_audio = timestamp;
+                times.push_back(timestamp);
+                offsets.push_back(offset);
+            }
+        }
+        
+        // Skip the left body and the previous tag size.
+        int64_t left = (int64_t)data_size - 2 + SRS_FLV_PREVIOUS_TAG_SIZE;
+        reader->skip(left);
+    }
+    
+    return err;
+}
+
 srs_error_t SrsFlvVodStreamDecoder::seek2(int64_t offset)
 {
     srs_error_t err = srs_success;
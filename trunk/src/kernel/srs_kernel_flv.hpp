@@ -27,12 +27,15 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
 
 // For srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <sys/uio.h>
 #endif
 
+#include <srs_kernel_consts.hpp>
+
 class SrsBuffer;
 class ISrsWriter;
 class ISrsReader;
@@ -216,12 +219,23 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+private:
+    // Whether the payload is allocated by create_payload from the pool.
+    bool pooled;
+    friend class SrsSharedPtrMessage;
 public:
     SrsCommonMessage();
     virtual ~SrsCommonMessage();
 public:
-    // Alloc the payload to specified size of bytes.
+    // Alloc and free the message from the pool, @see srs_pool_alloc.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+public:
+    // Alloc the payload to specified size of bytes, from the pool.
     virtual void create_payload(int size);
+    // Detach the payload from message, which user should free by srs_freepa.
+    // @remark Copy the payload if allocated from the pool.
+    virtual char* detach_payload();
 public:
     // Create common message,
     // from the header and body.
@@ -249,7 +263,8 @@ public:
     int perfer_cid;
 public:
     SrsSharedMessageHeader();
-    virtual ~SrsSharedMessageHeader();
+    // @remark Never inherit from it, so no vptr in the header of each shared payload.
+    ~SrsSharedMessageHeader();
 };
 
 // The shared ptr message.
@@ -258,6 +273,10 @@ public:
 //
 // Create first object by constructor and create(),
 // use copy if need reference count message.
+//
+// The copy is created for each consumer of each frame, so it's a plain handle of 32 bytes without vptr,
+// the timestamp and stream id of consumer, and the pointer to the shared payload. The methods are not
+// virtual, because it's never inherited, so the calls for each consumer are direct.
 class SrsSharedPtrMessage
 {
 // 4.1. Message Header
@@ -286,59 +305,94 @@ public:
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
 private:
+    // The shared payload, the hot fields read by each consumer are in the first cache line,
+    // that is, the payload, size, refcount and header, while the caches for sending are after them.
     class SrsSharedPtrPayload
     {
     public:
-        // The shared message header.
-        // @see https://github.com/ossrs/srs/issues/251
-        SrsSharedMessageHeader header;
         // The actual shared payload.
         char* payload;
         // The size of payload.
         int size;
         // The reference count
         int shared_count;
+        // The shared message header.
+        // @see https://github.com/ossrs/srs/issues/251
+        SrsSharedMessageHeader header;
+        // Whether the payload is allocated from the pool.
+        bool pooled;
+        // The state of caches below, the size of chunk headers is 0 if not cached,
+        // and the timestamp and stream id which the caches are generated for.
+        bool flv_cached;
+        int nb_c0;
+        int nb_c3;
+        int32_t chunk_stream_id;
+        int64_t chunk_timestamp;
+        int64_t flv_timestamp;
+        // The cached chunk headers, the c0 header for the first chunk and c3 for others,
+        // which is shared by all consumers with the same timestamp and stream id.
+        // @remark Never change it once cached, because it's referenced by the iovs of sending.
+        char chunk_headers[SRS_CONSTS_RTMP_MAX_FMT0_HEADER_SIZE + SRS_CONSTS_RTMP_MAX_FMT3_HEADER_SIZE];
+        // The cached FLV tag header and previous tag size, which is shared by all FLV consumers
+        // with the same timestamp, for example, the metadata and sequence headers when viewers join.
+        // @remark Never change it once cached, because it's referenced by the iovs of sending.
+        char flv_tag[SRS_FLV_TAG_HEADER_SIZE + SRS_FLV_PREVIOUS_TAG_SIZE];
     public:
         SrsSharedPtrPayload();
-        virtual ~SrsSharedPtrPayload();
+        ~SrsSharedPtrPayload();
+    public:
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr);
     };
     SrsSharedPtrPayload* ptr;
 public:
     SrsSharedPtrMessage();
-    virtual ~SrsSharedPtrMessage();
+    ~SrsSharedPtrMessage();
+public:
+    // Alloc and free the message from the pool, for each consumer copy it.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
 public:
     // Create shared ptr message,
     // copy header, manage the payload of msg,
     // set the payload to NULL to prevent double free.
     // @remark payload of msg set to NULL if success.
     // @remark User should free the msg.
-    virtual srs_error_t create(SrsCommonMessage* msg);
+    srs_error_t create(SrsCommonMessage* msg);
     // Create shared ptr message,
     // from the header and payload.
     // @remark user should never free the payload.
     // @param pheader, the header to copy to the message. NULL to ignore.
-    virtual srs_error_t create(SrsMessageHeader* pheader, char* payload, int size);
+    srs_error_t create(SrsMessageHeader* pheader, char* payload, int size);
     // Get current reference count.
     // when this object created, count set to 0.
     // if copy() this object, count increase 1.
     // if this or copy deleted, free payload when count is 0, or count--.
     // @remark, assert object is created.
-    virtual int count();
+    int count();
     // check perfer cid and stream id.
     // @return whether stream id already set.
-    virtual bool check(int stream_id);
+    bool check(int stream_id);
 public:
-    virtual bool is_av();
-    virtual bool is_audio();
-    virtual bool is_video();
+    bool is_av();
+    bool is_audio();
+    bool is_video();
 public:
     // generate the chunk header to cache.
     // @return the size of header.
-    virtual int chunk_header(char* cache, int nb_cache, bool c0);
+    int chunk_header(char* cache, int nb_cache, bool c0);
+    // Get the cached chunk headers, generate it for the first time.
+    // @return Whether the cached headers are available, false if cached for another timestamp or stream id,
+    //      for example, the timestamp of copy is corrected by jitter, then user should generate the headers.
+    bool cached_chunk_header(char** pc0, int* pnb_c0, char** pc3, int* pnb_c3);
+    // Get the cache of FLV tag header and previous tag size, which is SRS_FLV_TAG_HEADER_SIZE+SRS_FLV_PREVIOUS_TAG_SIZE bytes.
+    // @param pfresh Whether the cache is fresh, then user must generate it before use.
+    // @return The cache, or NULL if cached for another timestamp, then user should generate the tag.
+    char* cached_flv_tag(bool* pfresh);
 public:
     // copy current shared ptr message, use ref-count.
     // @remark, assert object is created.
-    virtual SrsSharedPtrMessage* copy();
+    SrsSharedPtrMessage* copy();
 };
 
 // Transmux RTMP packets to FLV stream.
@@ -456,6 +510,12 @@ public:
     // @remark we think the first audio/video is sequence header.
     // @remark assert pstart/psize not NULL.
     virtual srs_error_t read_sequence_header_summary(int64_t* pstart, int* psize);
+    // Scan the tags from current position to the end of file, and collect the seek points,
+    // that is, the offset of the tag header and its timestamp in ms.
+    // @remark For file with video, every video keyframe is a seek point; for pure audio file,
+    //      we pick an audio tag about every second.
+    // @remark Only the tag header and the first two bytes of body are read, others are skipped.
+    virtual srs_error_t read_keyframes(std::vector<int64_t>& times, std::vector<int64_t>& offsets);
 public:
     // For start offset, seed to this position and response flv stream.
     virtual srs_error_t seek2(int64_t offset);
@@ -34,6 +34,7 @@
 #include <string.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
 #define SRS_MP4_EOF_SIZE 0
@@ -41,6 +42,9 @@ using namespace std;
 
 #define SRS_MP4_BUF_SIZE 4096
 
+// The max samples to reserve for a track, about 8 hours of 60fps.
+#define SRS_MP4_MAX_RESERVE_SAMPLES (uint32_t)(2 * 1024 * 1024)
+
 srs_error_t srs_mp4_write_box(ISrsWriter* writer, ISrsCodec* box)
 {
     srs_error_t err = srs_success;
@@ -353,6 +357,8 @@ srs_error_t SrsMp4Box::discovery(SrsBuffer* buf, SrsMp4Box** ppbox)
         case SrsMp4BoxTypeSTSZ: box = new SrsMp4SampleSizeBox(); break;
         case SrsMp4BoxTypeAVC1: box = new SrsMp4VisualSampleEntry(); break;
         case SrsMp4BoxTypeAVCC: box = new SrsMp4AvccBox(); break;
+        case SrsMp4BoxTypeHVC1: box = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHVC1); break;
+        case SrsMp4BoxTypeHVCC: box = new SrsMp4HvcCBox(); break;
         case SrsMp4BoxTypeMP4A: box = new SrsMp4AudioSampleEntry(); break;
         case SrsMp4BoxTypeESDS: box = new SrsMp4EsdsBox(); break;
         case SrsMp4BoxTypeUDTA: box = new SrsMp4UserDataBox(); break;
@@ -498,15 +504,18 @@ srs_error_t SrsMp4Box::encode_header(SrsBuffer* buf)
         return srs_error_new(ERROR_MP4_BOX_REQUIRE_SPACE, "requires %d only %d bytes", size, buf->left());
     }
     
-    buf->write_4bytes(smallsize);
+    char* p = buf->head();
+    srs_write_be<uint32_t>(p, smallsize);
     if (smallsize == SRS_MP4_USE_LARGE_SIZE) {
-        buf->write_8bytes(largesize);
+        srs_write_be<uint64_t>(p, largesize);
     }
-    buf->write_4bytes(type);
+    srs_write_be<uint32_t>(p, type);
     
     if (type == SrsMp4BoxTypeUUID) {
-        buf->write_bytes(&usertype[0], 16);
+        memcpy(p, &usertype[0], 16);
+        p += 16;
     }
+    buf->skip((int)(p - buf->head()));
     
     int lrsz = nb_header() - SrsMp4Box::nb_header();
     if (!buf->require(lrsz)) {
@@ -597,8 +606,10 @@ srs_error_t SrsMp4FullBox::encode_header(SrsBuffer* buf)
         return srs_error_new(ERROR_MP4_BOX_REQUIRE_SPACE, "full box requires 4 only %d bytes", buf->left());
     }
     
-    buf->write_1bytes(version);
-    buf->write_3bytes(flags);
+    char* p = buf->head();
+    srs_write_be<uint8_t>(p, version);
+    srs_write_be24(p, flags);
+    buf->skip(4);
     
     return err;
 }
@@ -779,6 +790,26 @@ void SrsMp4MovieFragmentBox::set_traf(SrsMp4TrackFragmentBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieFragmentBox::add_traf(SrsMp4TrackFragmentBox* v)
+{
+    boxes.push_back(v);
+}
+
+vector<SrsMp4TrackFragmentBox*> SrsMp4MovieFragmentBox::trafs()
+{
+    vector<SrsMp4TrackFragmentBox*> v;
+    
+    vector<SrsMp4Box*>::iterator it;
+    for (it = boxes.begin(); it != boxes.end(); ++it) {
+        SrsMp4Box* box = *it;
+        if (box->type == SrsMp4BoxTypeTRAF) {
+            v.push_back(dynamic_cast<SrsMp4TrackFragmentBox*>(box));
+        }
+    }
+    
+    return v;
+}
+
 SrsMp4MovieFragmentHeaderBox::SrsMp4MovieFragmentHeaderBox()
 {
     type = SrsMp4BoxTypeMFHD;
@@ -1095,24 +1126,25 @@ srs_error_t SrsMp4TrunEntry::encode(SrsBuffer* buf)
 {
     srs_error_t err = srs_success;
     
+    // The space of entries is checked by the header of trun box.
+    char* p = buf->head();
     if ((owner->flags&SrsMp4TrunFlagsSampleDuration) == SrsMp4TrunFlagsSampleDuration) {
-        buf->write_4bytes(sample_duration);
+        srs_write_be<uint32_t>(p, sample_duration);
     }
     if ((owner->flags&SrsMp4TrunFlagsSampleSize) == SrsMp4TrunFlagsSampleSize) {
-        buf->write_4bytes(sample_size);
+        srs_write_be<uint32_t>(p, sample_size);
     }
     if ((owner->flags&SrsMp4TrunFlagsSampleFlag) == SrsMp4TrunFlagsSampleFlag) {
-        buf->write_4bytes(sample_flags);
+        srs_write_be<uint32_t>(p, sample_flags);
     }
     if ((owner->flags&SrsMp4TrunFlagsSampleCtsOffset) == SrsMp4TrunFlagsSampleCtsOffset) {
         if (!owner->version) {
-            uint32_t v = (uint32_t)sample_composition_time_offset;
-            buf->write_4bytes(v);
+            srs_write_be<uint32_t>(p, (uint32_t)sample_composition_time_offset);
         } else {
-            int32_t v = (int32_t)sample_composition_time_offset;
-            buf->write_4bytes(v);
+            srs_write_be<int32_t>(p, (int32_t)sample_composition_time_offset);
         }
     }
+    buf->skip((int)(p - buf->head()));
     
     return err;
 }
@@ -1499,6 +1531,21 @@ int SrsMp4MovieBox::nb_soun_tracks()
     return nb_tracks;
 }
 
+void SrsMp4MovieBox::retain_traks(SrsMp4TrackBox* vide, SrsMp4TrackBox* soun)
+{
+    vector<SrsMp4Box*>::iterator it;
+    for (it = boxes.begin(); it != boxes.end();) {
+        SrsMp4Box* box = *it;
+        
+        if (box->type == SrsMp4BoxTypeTRAK && box != vide && box != soun) {
+            it = boxes.erase(it);
+            srs_freep(box);
+        } else {
+            ++it;
+        }
+    }
+}
+
 int SrsMp4MovieBox::nb_header()
 {
     return SrsMp4Box::nb_header();
@@ -1667,6 +1714,11 @@ void SrsMp4MovieExtendsBox::set_trex(SrsMp4TrackExtendsBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieExtendsBox::add_trex(SrsMp4TrackExtendsBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4TrackExtendsBox::SrsMp4TrackExtendsBox()
 {
     type = SrsMp4BoxTypeTREX;
@@ -1814,6 +1866,7 @@ SrsVideoCodecId SrsMp4TrackBox::vide_codec()
     SrsMp4SampleEntry* entry = box->entrie_at(0);
     switch(entry->type) {
         case SrsMp4BoxTypeAVC1: return SrsVideoCodecIdAVC;
+        case SrsMp4BoxTypeHVC1: return SrsVideoCodecIdHEVC;
         default: return SrsVideoCodecIdForbidden;
     }
 }
@@ -3007,9 +3060,9 @@ stringstream& SrsMp4SampleEntry::dumps_detail(stringstream& ss, SrsMp4DumpContex
     return ss;
 }
 
-SrsMp4VisualSampleEntry::SrsMp4VisualSampleEntry() : width(0), height(0)
+SrsMp4VisualSampleEntry::SrsMp4VisualSampleEntry(SrsMp4BoxType boxType) : width(0), height(0)
 {
-    type = SrsMp4BoxTypeAVC1;
+    type = boxType;
     
     pre_defined0 = 0;
     reserved0 = 0;
@@ -3039,6 +3092,18 @@ void SrsMp4VisualSampleEntry::set_avcC(SrsMp4AvccBox* v)
     boxes.push_back(v);
 }
 
+SrsMp4HvcCBox* SrsMp4VisualSampleEntry::hvcC()
+{
+    SrsMp4Box* box = get(SrsMp4BoxTypeHVCC);
+    return dynamic_cast<SrsMp4HvcCBox*>(box);
+}
+
+void SrsMp4VisualSampleEntry::set_hvcC(SrsMp4HvcCBox* v)
+{
+    remove(SrsMp4BoxTypeHVCC);
+    boxes.push_back(v);
+}
+
 int SrsMp4VisualSampleEntry::nb_header()
 {
     return SrsMp4SampleEntry::nb_header()+2+2+12+2+2+4+4+4+2+32+2+2;
@@ -3158,6 +3223,62 @@ stringstream& SrsMp4AvccBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc
     return ss;
 }
 
+SrsMp4HvcCBox::SrsMp4HvcCBox()
+{
+    type = SrsMp4BoxTypeHVCC;
+}
+
+SrsMp4HvcCBox::~SrsMp4HvcCBox()
+{
+}
+
+int SrsMp4HvcCBox::nb_header()
+{
+    return SrsMp4Box::nb_header() + (int)hevc_config.size();
+}
+
+srs_error_t SrsMp4HvcCBox::encode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4Box::encode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode header");
+    }
+    
+    if (!hevc_config.empty()) {
+        buf->write_bytes(&hevc_config[0], (int)hevc_config.size());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4HvcCBox::decode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4Box::decode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "decode header");
+    }
+    
+    int nb_config = left_space(buf);
+    if (nb_config) {
+        hevc_config.resize(nb_config);
+        buf->read_bytes(&hevc_config[0], nb_config);
+    }
+    
+    return err;
+}
+
+stringstream& SrsMp4HvcCBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc)
+{
+    SrsMp4Box::dumps_detail(ss, dc);
+    
+    ss << ", HEVC Config: " << (int)hevc_config.size() << "B" << endl;
+    srs_mp4_padding(ss, dc.indent());
+    srs_mp4_print_bytes(ss, (const char*)&hevc_config[0], (int)hevc_config.size(), dc.indent());
+    return ss;
+}
+
 SrsMp4AudioSampleEntry::SrsMp4AudioSampleEntry() : samplerate(0)
 {
     type = SrsMp4BoxTypeMP4A;
@@ -5174,6 +5295,336 @@ srs_error_t SrsMp4SampleManager::load_trak(map<uint64_t, SrsMp4Sample*>& tses, S
     return err;
 }
 
+SrsMp4TrackSamples::SrsMp4TrackSamples(SrsFrameType t)
+{
+    type = t;
+    tbn = 0;
+    adjust = 0;
+}
+
+SrsMp4TrackSamples::~SrsMp4TrackSamples()
+{
+}
+
+srs_error_t SrsMp4TrackSamples::load(SrsMp4MediaHeaderBox* mdhd, SrsMp4ChunkOffsetBox* stco, SrsMp4SampleSizeBox* stsz,
+    SrsMp4Sample2ChunkBox* stsc, SrsMp4DecodingTime2SampleBox* stts, SrsMp4CompositionTime2SampleBox* ctts,
+    SrsMp4SyncSampleBox* stss)
+{
+    srs_error_t err = srs_success;
+    
+    tbn = mdhd->timescale;
+    
+    // Samples per chunk.
+    stsc->initialize_counter();
+    
+    // DTS box.
+    if ((err = stts->initialize_counter()) != srs_success) {
+        return srs_error_wrap(err, "stts init counter");
+    }
+    
+    // CTS/PTS box.
+    if (ctts && (err = ctts->initialize_counter()) != srs_success) {
+        return srs_error_wrap(err, "ctts init counter");
+    }
+    
+    // Reserve for the declared samples, which is limited by the stsz box size in general.
+    uint32_t nn_reserve = srs_min(stsz->sample_count, SRS_MP4_MAX_RESERVE_SAMPLES);
+    offsets.reserve(nn_reserve);
+    sizes.reserve(nn_reserve);
+    dtses.reserve(nn_reserve);
+    ctses.reserve(nn_reserve);
+    if (type == SrsFrameTypeVideo) {
+        keyframes.reserve(nn_reserve);
+    }
+    
+    // The stss is in ascending order, so we use a cursor rather than search for each sample.
+    uint32_t stss_cursor = 0;
+    
+    uint32_t index = 0;
+    uint64_t dts = 0;
+    bool sorted = true;
+    
+    // For each chunk offset.
+    for (uint32_t ci = 0; ci < stco->entry_count; ci++) {
+        // The sample offset relative in chunk.
+        uint32_t sample_relative_offset = 0;
+        
+        // Find how many samples from stsc.
+        SrsMp4StscEntry* stsc_entry = stsc->on_chunk(ci);
+        for (uint32_t i = 0; i < stsc_entry->samples_per_chunk; i++, index++) {
+            uint64_t offset = stco->entries[ci] + sample_relative_offset;
+            
+            uint32_t sample_size = 0;
+            if ((err = stsz->get_sample_size(index, &sample_size)) != srs_success) {
+                return srs_error_wrap(err, "stsz get sample size");
+            }
+            sample_relative_offset += sample_size;
+            
+            SrsMp4SttsEntry* stts_entry = NULL;
+            if ((err = stts->on_sample(index, &stts_entry)) != srs_success) {
+                return srs_error_wrap(err, "stts on sample");
+            }
+            if (index > 0) {
+                dts += stts_entry->sample_delta;
+            }
+            
+            SrsMp4CttsEntry* ctts_entry = NULL;
+            if (ctts && (err = ctts->on_sample(index, &ctts_entry)) != srs_success) {
+                return srs_error_wrap(err, "ctts on sample");
+            }
+            
+            if (type == SrsFrameTypeVideo) {
+                bool keyframe = !stss;
+                if (stss) {
+                    while (stss_cursor < stss->entry_count && stss->sample_numbers[stss_cursor] < index + 1) {
+                        stss_cursor++;
+                    }
+                    keyframe = stss_cursor < stss->entry_count && stss->sample_numbers[stss_cursor] == index + 1;
+                }
+                keyframes.push_back(keyframe);
+            }
+            
+            if (!offsets.empty() && offset < offsets.back()) {
+                sorted = false;
+            }
+            
+            offsets.push_back(offset);
+            sizes.push_back(sample_size);
+            dtses.push_back(dts);
+            ctses.push_back(ctts_entry? ctts_entry->sample_offset : 0);
+        }
+    }
+    
+    // Check total samples.
+    if (index > 0 && index != stsz->sample_count) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "illegal samples count, expect=%d, actual=%d", stsz->sample_count, index);
+    }
+    
+    if (!sorted) {
+        sort();
+    }
+    
+    return err;
+}
+
+uint32_t SrsMp4TrackSamples::size()
+{
+    return (uint32_t)offsets.size();
+}
+
+uint32_t SrsMp4TrackSamples::dts_ms(uint32_t index)
+{
+    return (uint32_t)(dtses[index] * 1000 / tbn) + adjust;
+}
+
+uint32_t SrsMp4TrackSamples::lower_bound(uint32_t ms)
+{
+    // The dts is monotonically increase in a track.
+    uint32_t lo = 0, hi = size();
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (dts_ms(mid) < ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Compare the samples by offset, to sort the samples.
+class SrsMp4OffsetLess
+{
+private:
+    std::vector<uint64_t>& offsets;
+public:
+    SrsMp4OffsetLess(std::vector<uint64_t>& v) : offsets(v) {
+    }
+    bool operator()(uint32_t a, uint32_t b) const {
+        return offsets[a] < offsets[b];
+    }
+};
+
+void SrsMp4TrackSamples::sort()
+{
+    std::vector<uint32_t> order(offsets.size());
+    for (uint32_t i = 0; i < (uint32_t)order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), SrsMp4OffsetLess(offsets));
+    
+    std::vector<uint64_t> o2(order.size()), d2(order.size());
+    std::vector<uint32_t> s2(order.size());
+    std::vector<int64_t> c2(order.size());
+    std::vector<bool> k2(keyframes.empty()? 0 : order.size());
+    for (uint32_t i = 0; i < (uint32_t)order.size(); i++) {
+        uint32_t j = order[i];
+        o2[i] = offsets[j];
+        s2[i] = sizes[j];
+        d2[i] = dtses[j];
+        c2[i] = ctses[j];
+        if (!keyframes.empty()) {
+            k2[i] = keyframes[j];
+        }
+    }
+    
+    offsets.swap(o2);
+    sizes.swap(s2);
+    dtses.swap(d2);
+    ctses.swap(c2);
+    keyframes.swap(k2);
+}
+
+SrsMp4SampleIndex::SrsMp4SampleIndex()
+{
+    vide = soun = NULL;
+    vide_cursor = soun_cursor = 0;
+}
+
+SrsMp4SampleIndex::~SrsMp4SampleIndex()
+{
+    srs_freep(vide);
+    srs_freep(soun);
+}
+
+srs_error_t SrsMp4SampleIndex::load(SrsMp4MovieBox* moov)
+{
+    srs_error_t err = srs_success;
+    
+    SrsMp4TrackBox* trak = moov->video();
+    if (trak) {
+        SrsMp4MediaHeaderBox* mdhd = trak->mdhd();
+        SrsMp4ChunkOffsetBox* stco = trak->stco();
+        SrsMp4SampleSizeBox* stsz = trak->stsz();
+        SrsMp4Sample2ChunkBox* stsc = trak->stsc();
+        SrsMp4DecodingTime2SampleBox* stts = trak->stts();
+        
+        if (!mdhd || !stco || !stsz || !stsc || !stts) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_TRACK, "illegal track, empty mdhd/stco/stsz/stsc/stts, type=%d", trak->track_type());
+        }
+        
+        // The ctts and stss is optional.
+        srs_freep(vide);
+        vide = new SrsMp4TrackSamples(SrsFrameTypeVideo);
+        if ((err = vide->load(mdhd, stco, stsz, stsc, stts, trak->ctts(), trak->stss())) != srs_success) {
+            return srs_error_wrap(err, "load vide track");
+        }
+    }
+    
+    trak = moov->audio();
+    if (trak) {
+        SrsMp4MediaHeaderBox* mdhd = trak->mdhd();
+        SrsMp4ChunkOffsetBox* stco = trak->stco();
+        SrsMp4SampleSizeBox* stsz = trak->stsz();
+        SrsMp4Sample2ChunkBox* stsc = trak->stsc();
+        SrsMp4DecodingTime2SampleBox* stts = trak->stts();
+        
+        if (!mdhd || !stco || !stsz || !stsc || !stts) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_TRACK, "illegal track, empty mdhd/stco/stsz/stsc/stts, type=%d", trak->track_type());
+        }
+        
+        srs_freep(soun);
+        soun = new SrsMp4TrackSamples(SrsFrameTypeAudio);
+        if ((err = soun->load(mdhd, stco, stsz, stsc, stts, NULL, NULL)) != srs_success) {
+            return srs_error_wrap(err, "load soun track");
+        }
+    }
+    
+    // Adjust the sequence diff, the same to SrsMp4SampleManager.
+    int32_t maxp = 0;
+    int32_t maxn = 0;
+    if (vide && soun) {
+        bool pvideo = false;
+        uint32_t vi = 0, si = 0, pvi = 0;
+        for (SrsMp4TrackSamples* track = pick(vi, si); track; track = pick(vi, si)) {
+            if (track == vide) {
+                pvideo = true;
+                pvi = vi++;
+            } else {
+                if (pvideo) {
+                    int32_t diff = soun->dts_ms(si) - vide->dts_ms(pvi);
+                    if (diff > 0) {
+                        maxp = srs_max(maxp, diff);
+                    } else {
+                        maxn = srs_min(maxn, diff);
+                    }
+                    pvideo = false;
+                }
+                si++;
+            }
+        }
+    }
+    
+    // Adjust when one of maxp and maxn is zero,
+    // that means we can adjust by add maxn or sub maxp,
+    // notice that maxn is negative and maxp is positive.
+    if (soun && maxp * maxn == 0 && maxp + maxn != 0) {
+        soun->adjust = 0 - maxp - maxn;
+    }
+    
+    return err;
+}
+
+bool SrsMp4SampleIndex::next(SrsMp4Sample* sample)
+{
+    SrsMp4TrackSamples* track = pick(vide_cursor, soun_cursor);
+    if (!track) {
+        return false;
+    }
+    
+    uint32_t index = (track == vide)? vide_cursor++ : soun_cursor++;
+    
+    sample->type = track->type;
+    sample->index = index;
+    sample->tbn = track->tbn;
+    sample->adjust = track->adjust;
+    sample->offset = track->offsets[index];
+    sample->nb_data = track->sizes[index];
+    sample->dts = track->dtses[index];
+    sample->pts = track->dtses[index] + track->ctses[index];
+    
+    if (track->type == SrsFrameTypeVideo) {
+        sample->frame_type = track->keyframes[index]? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+    } else {
+        sample->frame_type = SrsVideoAvcFrameTypeForbidden;
+    }
+    
+    return true;
+}
+
+void SrsMp4SampleIndex::seek(uint32_t ms)
+{
+    vide_cursor = vide? vide->lower_bound(ms) : 0;
+    soun_cursor = soun? soun->lower_bound(ms) : 0;
+}
+
+uint32_t SrsMp4SampleIndex::size()
+{
+    return (vide? vide->size() : 0) + (soun? soun->size() : 0);
+}
+
+SrsMp4TrackSamples* SrsMp4SampleIndex::video()
+{
+    return vide;
+}
+
+SrsMp4TrackSamples* SrsMp4SampleIndex::audio()
+{
+    return soun;
+}
+
+SrsMp4TrackSamples* SrsMp4SampleIndex::pick(uint32_t vi, uint32_t si)
+{
+    bool has_vide = vide && vi < vide->size();
+    bool has_soun = soun && si < soun->size();
+    
+    if (has_vide && has_soun) {
+        return (vide->offsets[vi] <= soun->offsets[si])? vide : soun;
+    }
+    
+    return has_vide? vide : (has_soun? soun : NULL);
+}
+
 SrsMp4BoxReader::SrsMp4BoxReader()
 {
     rsio = NULL;
@@ -5283,9 +5734,8 @@ SrsMp4Decoder::SrsMp4Decoder()
     sample_rate = SrsAudioSampleRateForbidden;
     sound_bits = SrsAudioSampleBitsForbidden;
     channels = SrsAudioChannelsForbidden;
-    samples = new SrsMp4SampleManager();
+    samples = new SrsMp4SampleIndex();
     br = new SrsMp4BoxReader();
-    current_index = 0;
     current_offset = 0;
 }
 
@@ -5387,8 +5837,9 @@ srs_error_t SrsMp4Decoder::read_sample(SrsMp4HandlerType* pht, uint16_t* pft, ui
         return err;
     }
     
-    SrsMp4Sample* ps = samples->at(current_index++);
-    if (!ps) {
+    SrsMp4Sample sp;
+    SrsMp4Sample* ps = &sp;
+    if (!samples->next(ps)) {
         return srs_error_new(ERROR_SYSTEM_FILE_EOF, "EOF");
     }
     
@@ -5425,18 +5876,59 @@ srs_error_t SrsMp4Decoder::read_sample(SrsMp4HandlerType* pht, uint16_t* pft, ui
     return err;
 }
 
-srs_error_t SrsMp4Decoder::parse_ftyp(SrsMp4FileTypeBox* ftyp)
+void SrsMp4Decoder::seek(uint32_t ms)
 {
-    srs_error_t err = srs_success;
+    samples->seek(ms);
     
-    // File Type Box (ftyp)
-    bool legal_brand = false;
-    static SrsMp4BoxBrand legal_brands[] = {
-        SrsMp4BoxBrandISOM, SrsMp4BoxBrandISO2, SrsMp4BoxBrandAVC1, SrsMp4BoxBrandMP41,
-        SrsMp4BoxBrandISO5
-    };
-    for (int i = 0; i < (int)(sizeof(legal_brands)/sizeof(SrsMp4BoxBrand)); i++) {
-        if (ftyp->major_brand == legal_brands[i]) {
+    avcc_written = false;
+    asc_written = false;
+}
+
+void SrsMp4Decoder::read_keyframes(vector<int64_t>& times, int64_t* pduration)
+{
+    SrsMp4TrackSamples* vide = samples->video();
+    SrsMp4TrackSamples* soun = samples->audio();
+    
+    int64_t duration = 0;
+    if (vide && vide->size() > 0) {
+        duration = srs_max(duration, (int64_t)vide->dts_ms(vide->size() - 1));
+    }
+    if (soun && soun->size() > 0) {
+        duration = srs_max(duration, (int64_t)soun->dts_ms(soun->size() - 1));
+    }
+    *pduration = duration;
+    
+    if (vide && vide->size() > 0) {
+        for (uint32_t i = 0; i < vide->size(); i++) {
+            if (vide->keyframes[i]) {
+                times.push_back(vide->dts_ms(i));
+            }
+        }
+        return;
+    }
+    
+    int64_t last_audio = -1;
+    for (uint32_t i = 0; soun && i < soun->size(); i++) {
+        int64_t timestamp = soun->dts_ms(i);
+        if (last_audio < 0 || timestamp - last_audio >= 1000) {
+            last_audio = timestamp;
+            times.push_back(timestamp);
+        }
+    }
+}
+
+srs_error_t SrsMp4Decoder::parse_ftyp(SrsMp4FileTypeBox* ftyp)
+{
+    srs_error_t err = srs_success;
+    
+    // File Type Box (ftyp)
+    bool legal_brand = false;
+    static SrsMp4BoxBrand legal_brands[] = {
+        SrsMp4BoxBrandISOM, SrsMp4BoxBrandISO2, SrsMp4BoxBrandAVC1, SrsMp4BoxBrandMP41,
+        SrsMp4BoxBrandISO5
+    };
+    for (int i = 0; i < (int)(sizeof(legal_brands)/sizeof(SrsMp4BoxBrand)); i++) {
+        if (ftyp->major_brand == legal_brands[i]) {
             legal_brand = true;
             break;
         }
@@ -5597,6 +6089,353 @@ srs_error_t SrsMp4Decoder::do_load_next_box(SrsMp4Box** ppbox, uint32_t required
     return err;
 }
 
+SrsMp4MoovTrimmer::SrsMp4MoovTrimmer()
+{
+    br = new SrsMp4BoxReader();
+    stream = new SrsSimpleStream();
+    ftyp = NULL;
+    moov = NULL;
+    samples = new SrsMp4SampleIndex();
+}
+
+SrsMp4MoovTrimmer::~SrsMp4MoovTrimmer()
+{
+    srs_freep(br);
+    srs_freep(stream);
+    srs_freep(ftyp);
+    srs_freep(moov);
+    srs_freep(samples);
+}
+
+srs_error_t SrsMp4MoovTrimmer::initialize(ISrsReadSeeker* rs)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = br->initialize(rs)) != srs_success) {
+        return srs_error_wrap(err, "init box reader");
+    }
+    
+    while (!moov) {
+        SrsMp4Box* box = NULL;
+        if ((err = br->read(stream, &box)) != srs_success) {
+            return srs_error_wrap(err, "read box");
+        }
+        
+        // Only decode the ftyp and moov, and the header of mdat to skip it.
+        SrsBuffer* buffer = new SrsBuffer(stream->bytes(), stream->length());
+        SrsAutoFree(SrsBuffer, buffer);
+        if (box->is_ftyp() || box->is_moov() || box->is_mdat()) {
+            err = box->decode(buffer);
+        }
+        if (err == srs_success) {
+            err = br->skip(box, stream);
+        }
+        if (err != srs_success) {
+            srs_freep(box);
+            return srs_error_wrap(err, "decode box");
+        }
+        
+        if (box->is_ftyp()) {
+            srs_freep(ftyp);
+            ftyp = dynamic_cast<SrsMp4FileTypeBox*>(box);
+        } else if (box->is_moov()) {
+            moov = dynamic_cast<SrsMp4MovieBox*>(box);
+        } else {
+            srs_freep(box);
+        }
+    }
+    
+    if (!ftyp) {
+        return srs_error_new(ERROR_MP4_BOX_ILLEGAL_SCHEMA, "missing ftyp");
+    }
+    if (!moov->mvhd()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "missing mvhd");
+    }
+    if (moov->mvex()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "fragmented mp4");
+    }
+    
+    if ((err = samples->load(moov)) != srs_success) {
+        return srs_error_wrap(err, "load samples");
+    }
+    
+    if (!samples->video() && !samples->audio()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "missing audio and video track");
+    }
+    
+    // The other tracks point to the samples which are not sent.
+    moov->retain_traks(moov->video(), moov->audio());
+    
+    return err;
+}
+
+uint32_t SrsMp4MoovTrimmer::keyframe_at(uint32_t ms)
+{
+    SrsMp4TrackSamples* track = samples->video();
+    bool keyframe = (track != NULL);
+    if (!track) {
+        track = samples->audio();
+    }
+    
+    uint32_t index = start_of(track, ms, keyframe);
+    return (index < track->size())? track->dts_ms(index) : 0;
+}
+
+srs_error_t SrsMp4MoovTrimmer::trim(uint32_t ms, string& header, int64_t* pstart, int64_t* pend)
+{
+    srs_error_t err = srs_success;
+    
+    SrsMp4TrackSamples* vide = samples->video();
+    SrsMp4TrackSamples* soun = samples->audio();
+    
+    // Start the video at the keyframe, and the audio at the same time, in the timeline of file,
+    // so the adjust of audio for A/V to monotonically increase is applied for the audio.
+    uint32_t keyframe = keyframe_at(ms);
+    uint32_t vi = vide? start_of(vide, keyframe, true) : 0;
+    uint32_t ai = 0;
+    if (soun) {
+        int64_t ams = (int64_t)keyframe + (vide? soun->adjust : 0);
+        ai = soun->lower_bound((uint32_t)srs_max(0, ams));
+    }
+    
+    // The range of samples in file, the samples are sorted by offset.
+    uint64_t start = 0, end = 0;
+    bool empty = true;
+    if (vide && vi < vide->size()) {
+        start = vide->offsets[vi];
+        end = vide->offsets[vide->size() - 1] + vide->sizes[vide->size() - 1];
+        empty = false;
+    }
+    if (soun && ai < soun->size()) {
+        uint64_t astart = soun->offsets[ai];
+        uint64_t aend = soun->offsets[soun->size() - 1] + soun->sizes[soun->size() - 1];
+        start = empty? astart : srs_min(start, astart);
+        end = empty? aend : srs_max(end, aend);
+        empty = false;
+    }
+    if (empty) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "no samples after %dms", keyframe);
+    }
+    
+    // Rebuild the tables, the chunk offsets are relative to the first sample.
+    SrsMp4MovieHeaderBox* mvhd = moov->mvhd();
+    uint64_t duration = 0;
+    
+    SrsMp4TrackBox* tracks[] = {vide? moov->video() : NULL, soun? moov->audio() : NULL};
+    SrsMp4TrackSamples* ts[] = {vide, soun};
+    uint32_t indexes[] = {vi, ai};
+    for (int i = 0; i < 2; i++) {
+        if (!tracks[i]) {
+            continue;
+        }
+        
+        uint64_t tduration = 0;
+        if ((err = trim_track(tracks[i], ts[i], indexes[i], start, &tduration)) != srs_success) {
+            return srs_error_wrap(err, "trim track %d", i);
+        }
+        
+        // Convert to the timescale of movie.
+        SrsMp4MediaHeaderBox* mdhd = tracks[i]->mdhd();
+        tduration = mdhd->timescale? tduration * mvhd->timescale / mdhd->timescale : 0;
+        if (tracks[i]->tkhd()) {
+            tracks[i]->tkhd()->duration = tduration;
+        }
+        duration = srs_max(duration, tduration);
+    }
+    mvhd->duration_in_tbn = duration;
+    
+    // The mdat header is 8 bytes, the stco is 32 bits, so the file must be less than 4GB.
+    int nb_header = ftyp->nb_bytes() + moov->nb_bytes() + 8;
+    if (nb_header + (end - start) > 0xffffffff) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "trim overflow, header=%d, samples=%" PRId64, nb_header, (int64_t)(end - start));
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        SrsMp4ChunkOffsetBox* stco = tracks[i]? tracks[i]->stco() : NULL;
+        for (uint32_t j = 0; stco && j < stco->entry_count; j++) {
+            stco->entries[j] += nb_header;
+        }
+    }
+    
+    header.resize(nb_header);
+    SrsBuffer* buf = new SrsBuffer(&header[0], nb_header);
+    SrsAutoFree(SrsBuffer, buf);
+    
+    if ((err = ftyp->encode(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode ftyp");
+    }
+    if ((err = moov->encode(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode moov");
+    }
+    buf->write_4bytes((int32_t)(8 + end - start));
+    buf->write_4bytes(SrsMp4BoxTypeMDAT);
+    
+    *pstart = (int64_t)start;
+    *pend = (int64_t)end;
+    
+    return err;
+}
+
+uint32_t SrsMp4MoovTrimmer::start_of(SrsMp4TrackSamples* track, uint32_t ms, bool keyframe)
+{
+    uint32_t index = 0;
+    bool found = false;
+    
+    for (uint32_t i = 0; i < track->size() && track->dts_ms(i) <= ms; i++) {
+        if (!keyframe || track->keyframes[i]) {
+            index = i;
+            found = true;
+        }
+    }
+    
+    // Start from the first keyframe, if none before the time.
+    for (uint32_t i = 0; !found && i < track->size(); i++) {
+        if (!keyframe || track->keyframes[i]) {
+            index = i;
+            found = true;
+        }
+    }
+    
+    return found? index : track->size();
+}
+
+srs_error_t SrsMp4MoovTrimmer::trim_track(SrsMp4TrackBox* trak, SrsMp4TrackSamples* track, uint32_t index, uint64_t base, uint64_t* pduration)
+{
+    SrsMp4SampleTableBox* stbl = trak->stbl();
+    SrsMp4MediaHeaderBox* mdhd = trak->mdhd();
+    
+    // The edit list is for the whole track, so remove it.
+    trak->remove(SrsMp4BoxTypeEDTS);
+    
+    uint32_t count = track->size() - srs_min(index, track->size());
+    bool has_stss = (trak->stss() != NULL);
+    
+    SrsMp4DecodingTime2SampleBox* stts = new SrsMp4DecodingTime2SampleBox();
+    SrsMp4CompositionTime2SampleBox* ctts = new SrsMp4CompositionTime2SampleBox();
+    SrsMp4SyncSampleBox* stss = new SrsMp4SyncSampleBox();
+    SrsMp4Sample2ChunkBox* stsc = new SrsMp4Sample2ChunkBox();
+    SrsMp4SampleSizeBox* stsz = new SrsMp4SampleSizeBox();
+    SrsMp4ChunkOffsetBox* stco = new SrsMp4ChunkOffsetBox();
+    
+    vector<uint32_t> keyframes;
+    vector<uint32_t> chunks;
+    vector<SrsMp4StscEntry> stscs;
+    bool has_cts = false;
+    uint64_t duration = 0;
+    uint32_t delta = 0;
+    
+    for (uint32_t i = index; i < track->size(); i++) {
+        uint32_t n = i - index;
+        
+        // The duration of the last sample is the same to the previous one.
+        if (i + 1 < track->size()) {
+            if (track->dtses[i + 1] < track->dtses[i]) {
+                srs_freep(stts); srs_freep(ctts); srs_freep(stss); srs_freep(stsc); srs_freep(stsz); srs_freep(stco);
+                return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "dts not monotonic at %d", i);
+            }
+            delta = (uint32_t)(track->dtses[i + 1] - track->dtses[i]);
+        }
+        duration += delta;
+        
+        if (stts->entries.empty() || stts->entries.back().sample_delta != delta) {
+            SrsMp4SttsEntry entry;
+            entry.sample_count = 0;
+            entry.sample_delta = delta;
+            stts->entries.push_back(entry);
+        }
+        stts->entries.back().sample_count++;
+        
+        int64_t cts = track->ctses[i];
+        has_cts = has_cts || cts != 0;
+        if (cts < 0) {
+            ctts->version = 0x01;
+        }
+        if (ctts->entries.empty() || ctts->entries.back().sample_offset != cts) {
+            SrsMp4CttsEntry entry;
+            entry.sample_count = 0;
+            entry.sample_offset = cts;
+            ctts->entries.push_back(entry);
+        }
+        ctts->entries.back().sample_count++;
+        
+        if (!track->keyframes.empty() && track->keyframes[i]) {
+            keyframes.push_back(n + 1);
+        }
+        
+        // The continuous samples are in the same chunk.
+        bool continuous = (i > index && track->offsets[i] == track->offsets[i - 1] + track->sizes[i - 1]);
+        if (!continuous) {
+            chunks.push_back((uint32_t)(track->offsets[i] - base));
+            
+            SrsMp4StscEntry entry;
+            entry.first_chunk = (uint32_t)chunks.size();
+            entry.samples_per_chunk = 0;
+            entry.sample_description_index = 1;
+            
+            // Merge the chunk to previous entry, when the previous chunk has the same samples.
+            if (stscs.size() >= 2 && stscs.back().samples_per_chunk == stscs[stscs.size() - 2].samples_per_chunk) {
+                stscs.pop_back();
+            }
+            stscs.push_back(entry);
+        }
+        stscs.back().samples_per_chunk++;
+    }
+    
+    // Merge the last entry, which is not merged when the chunk is completed.
+    if (stscs.size() >= 2 && stscs.back().samples_per_chunk == stscs[stscs.size() - 2].samples_per_chunk) {
+        stscs.pop_back();
+    }
+    
+    stsz->sample_size = 0;
+    stsz->sample_count = count;
+    stsz->entry_sizes = new uint32_t[srs_max(count, 1)];
+    for (uint32_t i = 0; i < count; i++) {
+        stsz->entry_sizes[i] = track->sizes[index + i];
+    }
+    
+    stco->entry_count = (uint32_t)chunks.size();
+    stco->entries = new uint32_t[srs_max(stco->entry_count, 1)];
+    for (uint32_t i = 0; i < stco->entry_count; i++) {
+        stco->entries[i] = chunks[i];
+    }
+    
+    stsc->entry_count = (uint32_t)stscs.size();
+    stsc->entries = new SrsMp4StscEntry[srs_max(stsc->entry_count, 1)];
+    for (uint32_t i = 0; i < stsc->entry_count; i++) {
+        stsc->entries[i] = stscs[i];
+    }
+    
+    stss->entry_count = (uint32_t)keyframes.size();
+    stss->sample_numbers = new uint32_t[srs_max(stss->entry_count, 1)];
+    for (uint32_t i = 0; i < stss->entry_count; i++) {
+        stss->sample_numbers[i] = keyframes[i];
+    }
+    
+    stbl->set_stts(stts);
+    stbl->set_stsc(stsc);
+    stbl->set_stsz(stsz);
+    stbl->set_stco(stco);
+    
+    if (has_cts) {
+        stbl->set_ctts(ctts);
+    } else {
+        stbl->remove(SrsMp4BoxTypeCTTS);
+        srs_freep(ctts);
+    }
+    
+    // Without stss, all samples are sync samples.
+    if (has_stss) {
+        stbl->set_stss(stss);
+    } else {
+        srs_freep(stss);
+    }
+    
+    mdhd->duration = duration;
+    *pduration = duration;
+    
+    return srs_success;
+}
+
 SrsMp4Encoder::SrsMp4Encoder()
 {
     wsio = NULL;
@@ -5821,17 +6660,31 @@ srs_error_t SrsMp4Encoder::flush()
             SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
             stbl->set_stsd(stsd);
             
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
-            stsd->append(avc1);
-            
-            avc1->width = width;
-            avc1->height = height;
-            avc1->data_reference_index = 1;
-            
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = pavcc;
+            if (vcodec == SrsVideoCodecIdHEVC) {
+                SrsMp4VisualSampleEntry* hvc1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHVC1);
+                stsd->append(hvc1);
+                
+                hvc1->width = width;
+                hvc1->height = height;
+                hvc1->data_reference_index = 1;
+                
+                SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+                hvc1->set_hvcC(hvcC);
+                
+                hvcC->hevc_config = pavcc;
+            } else {
+                SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+                stsd->append(avc1);
+                
+                avc1->width = width;
+                avc1->height = height;
+                avc1->data_reference_index = 1;
+                
+                SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+                avc1->set_avcC(avcC);
+                
+                avcC->avc_config = pavcc;
+            }
         }
         
         if (nb_audios || !pasc.empty()) {
@@ -5994,6 +6847,7 @@ srs_error_t SrsMp4Encoder::copy_sequence_header(SrsFormat* format, bool vsh, uin
     if (vsh) {
         pavcc = std::vector<char>(sample, sample + nb_sample);
         if (format && format->vcodec) {
+            vcodec = format->vcodec->id;
             width = format->vcodec->width;
             height = format->vcodec->height;
         }
@@ -6045,9 +6899,21 @@ srs_error_t SrsMp4M2tsInitEncoder::initialize(ISrsWriter* w)
 }
 
 srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
+{
+    if (video) {
+        return write(format, tid, 0);
+    }
+    return write(format, 0, tid);
+}
+
+srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, int vtid, int atid)
 {
     srs_error_t err = srs_success;
     
+    if (vtid <= 0 && atid <= 0) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "Missing audio and video track");
+    }
+    
     // Write ftyp box.
     if (true) {
         SrsMp4FileTypeBox* ftyp = new SrsMp4FileTypeBox();
@@ -6072,16 +6938,18 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
         
         mvhd->timescale = 1000; // Use tbn ms.
         mvhd->duration_in_tbn = 0;
-        mvhd->next_track_ID = tid;
+        mvhd->next_track_ID = srs_max(vtid, atid) + 1;
         
-        if (video) {
+        SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
+        
+        if (vtid > 0) {
             SrsMp4TrackBox* trak = new SrsMp4TrackBox();
             moov->add_trak(trak);
             
             SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
             trak->set_tkhd(tkhd);
             
-            tkhd->track_ID = mvhd->next_track_ID++;
+            tkhd->track_ID = vtid;
             tkhd->duration = 0;
             tkhd->width = (format->vcodec->width << 16);
             tkhd->height = (format->vcodec->height << 16);
@@ -6125,17 +6993,31 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
             stbl->set_stsd(stsd);
             
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
-            stsd->append(avc1);
-            
-            avc1->width = format->vcodec->width;
-            avc1->height = format->vcodec->height;
-            avc1->data_reference_index = 1;
-            
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = format->vcodec->avc_extra_data;
+            if (format->vcodec->id == SrsVideoCodecIdHEVC) {
+                SrsMp4VisualSampleEntry* hvc1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHVC1);
+                stsd->append(hvc1);
+                
+                hvc1->width = format->vcodec->width;
+                hvc1->height = format->vcodec->height;
+                hvc1->data_reference_index = 1;
+                
+                SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+                hvc1->set_hvcC(hvcC);
+                
+                hvcC->hevc_config = format->vcodec->avc_extra_data;
+            } else {
+                SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+                stsd->append(avc1);
+                
+                avc1->width = format->vcodec->width;
+                avc1->height = format->vcodec->height;
+                avc1->data_reference_index = 1;
+                
+                SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+                avc1->set_avcC(avcC);
+                
+                avcC->avc_config = format->vcodec->avc_extra_data;
+            }
             
             SrsMp4DecodingTime2SampleBox* stts = new SrsMp4DecodingTime2SampleBox();
             stbl->set_stts(stts);
@@ -6149,15 +7031,14 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4ChunkOffsetBox* stco = new SrsMp4ChunkOffsetBox();
             stbl->set_stco(stco);
             
-            SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
-            moov->set_mvex(mvex);
-            
             SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
-            mvex->set_trex(trex);
+            mvex->add_trex(trex);
             
-            trex->track_ID = tid;
+            trex->track_ID = vtid;
             trex->default_sample_description_index = 1;
-        } else {
+        }
+        
+        if (atid > 0) {
             SrsMp4TrackBox* trak = new SrsMp4TrackBox();
             moov->add_trak(trak);
             
@@ -6165,7 +7046,7 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             tkhd->volume = 0x0100;
             trak->set_tkhd(tkhd);
             
-            tkhd->track_ID = mvhd->next_track_ID++;
+            tkhd->track_ID = atid;
             tkhd->duration = 0;
             
             SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
@@ -6249,15 +7130,14 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4ChunkOffsetBox* stco = new SrsMp4ChunkOffsetBox();
             stbl->set_stco(stco);
             
-            SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
-            moov->set_mvex(mvex);
-            
             SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
-            mvex->set_trex(trex);
+            mvex->add_trex(trex);
             
-            trex->track_ID = tid;
+            trex->track_ID = atid;
             trex->default_sample_description_index = 1;
         }
+        
+        moov->set_mvex(mvex);
 
         if ((err = srs_mp4_write_box(writer, moov)) != srs_success) {
             return srs_error_wrap(err, "write moov");
@@ -6277,6 +7157,7 @@ SrsMp4M2tsSegmentEncoder::SrsMp4M2tsSegmentEncoder()
     decode_basetime = 0;
     styp_bytes = 0;
     mdat_bytes = 0;
+    nb_chunks = 0;
 }
 
 SrsMp4M2tsSegmentEncoder::~SrsMp4M2tsSegmentEncoder()
@@ -6353,12 +7234,47 @@ srs_error_t SrsMp4M2tsSegmentEncoder::write_sample(SrsMp4HandlerType ht,
 
 srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
 {
-    srs_error_t err = srs_success;
-    
     if (!nb_audios && !nb_videos) {
         return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "Missing audio and video track");
     }
+    
+    // The segment is written in chunks, the sidx is unknown when write the first chunk.
+    if (nb_chunks) {
+        return flush_chunk(dts);
+    }
+    
+    return do_flush(dts, true, NULL);
+}
+
+srs_error_t SrsMp4M2tsSegmentEncoder::flush_chunk(uint64_t& dts)
+{
+    srs_error_t err = srs_success;
+    
+    if (samples->samples.empty()) {
+        return err;
+    }
+    
+    uint64_t duration = 0;
+    if ((err = do_flush(dts, false, &duration)) != srs_success) {
+        return srs_error_wrap(err, "chunk %d", nb_chunks);
+    }
+    nb_chunks++;
+    
+    // The next chunk starts after the samples of this chunk.
+    sequence_number++;
+    decode_basetime += (srs_utime_t)duration * SRS_UTIME_MILLISECONDS;
+    
+    srs_freep(samples);
+    samples = new SrsMp4SampleManager();
+    mdat_bytes = 0;
+    
+    return err;
+}
 
+srs_error_t SrsMp4M2tsSegmentEncoder::do_flush(uint64_t& dts, bool sidx_required, uint64_t* pduration)
+{
+    srs_error_t err = srs_success;
+    
     // Although the sidx is not required to start play DASH, but it's required for AV sync.
     SrsMp4SegmentIndexBox* sidx = new SrsMp4SegmentIndexBox();
     SrsAutoFree(SrsMp4SegmentIndexBox, sidx);
@@ -6420,6 +7336,13 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
             return srs_error_wrap(err, "write samples");
         }
         
+        if (pduration) {
+            *pduration = 0;
+            for (int i = 0; i < (int)trun->entries.size(); i++) {
+                *pduration += trun->entries[i]->sample_duration;
+            }
+        }
+        
         // @remark Remember the data_offset of turn is size(moof)+header(mdat), not including styp or sidx.
         int moof_bytes = moof->nb_bytes();
         trun->data_offset = (int32_t)(moof_bytes + mdat->sz_header());
@@ -6428,7 +7351,7 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         // Update the size of sidx.
         SrsMp4SegmentIndexEntry* entry = &sidx->entries[0];
         entry->referenced_size = moof_bytes + mdat->nb_bytes();
-        if ((err = srs_mp4_write_box(writer, sidx)) != srs_success) {
+        if (sidx_required && (err = srs_mp4_write_box(writer, sidx)) != srs_success) {
             return srs_error_wrap(err, "write sidx");
         }
 
@@ -6469,3 +7392,655 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
     return err;
 }
 
+
+SrsMp4FragmentEncoder::SrsMp4FragmentEncoder()
+{
+    writer = NULL;
+    sequence_number = 0;
+    vtid = atid = 0;
+    mdat_bytes = 0;
+}
+
+SrsMp4FragmentEncoder::~SrsMp4FragmentEncoder()
+{
+    clear();
+}
+
+srs_error_t SrsMp4FragmentEncoder::initialize(ISrsWriter* w, uint32_t vid, uint32_t aid)
+{
+    writer = w;
+    vtid = vid;
+    atid = aid;
+    return srs_success;
+}
+
+srs_error_t SrsMp4FragmentEncoder::write_sample(SrsMp4HandlerType ht,
+    uint16_t ft, uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample
+) {
+    srs_error_t err = srs_success;
+    
+    SrsMp4Sample* ps = new SrsMp4Sample();
+    
+    if (ht == SrsMp4HandlerTypeVIDE && vtid > 0) {
+        ps->type = SrsFrameTypeVideo;
+        ps->frame_type = (SrsVideoAvcFrameType)ft;
+        ps->index = (uint32_t)videos.size();
+        videos.push_back(ps);
+    } else if (ht == SrsMp4HandlerTypeSOUN && atid > 0) {
+        ps->type = SrsFrameTypeAudio;
+        ps->index = (uint32_t)audios.size();
+        audios.push_back(ps);
+    } else {
+        srs_freep(ps);
+        return err;
+    }
+    
+    ps->tbn = 1000;
+    ps->dts = dts;
+    ps->pts = pts;
+    
+    // We should copy the sample data, which is shared ptr from video/audio message.
+    ps->data = new uint8_t[nb_sample];
+    memcpy(ps->data, sample, nb_sample);
+    ps->nb_data = nb_sample;
+    
+    mdat_bytes += nb_sample;
+    
+    return err;
+}
+
+bool SrsMp4FragmentEncoder::empty()
+{
+    return videos.empty() && audios.empty();
+}
+
+uint32_t SrsMp4FragmentEncoder::duration()
+{
+    uint32_t v = 0;
+    if (videos.size() > 1) {
+        v = (uint32_t)(videos.back()->dts - videos.front()->dts);
+    }
+    if (audios.size() > 1) {
+        v = srs_max(v, (uint32_t)(audios.back()->dts - audios.front()->dts));
+    }
+    return v;
+}
+
+srs_error_t SrsMp4FragmentEncoder::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if (empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "Missing audio and video sample");
+    }
+    
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+    mdat->nb_data = (int)mdat_bytes;
+    
+    // Write moof, the video samples are before audio samples in mdat.
+    if (true) {
+        SrsMp4MovieFragmentBox* moof = new SrsMp4MovieFragmentBox();
+        SrsAutoFree(SrsMp4MovieFragmentBox, moof);
+        
+        SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+        moof->set_mfhd(mfhd);
+        
+        mfhd->sequence_number = ++sequence_number;
+        
+        SrsMp4TrackFragmentBox* vtraf = NULL;
+        if (!videos.empty()) {
+            vtraf = create_traf(vtid, videos);
+            moof->add_traf(vtraf);
+        }
+        
+        SrsMp4TrackFragmentBox* atraf = NULL;
+        if (!audios.empty()) {
+            atraf = create_traf(atid, audios);
+            moof->add_traf(atraf);
+        }
+        
+        // @remark The data_offset of turn is relative to moof, because of default-base-is-moof.
+        int32_t offset = (int32_t)(moof->nb_bytes() + mdat->sz_header());
+        if (vtraf) {
+            vtraf->trun()->data_offset = offset;
+            
+            vector<SrsMp4Sample*>::iterator it;
+            for (it = videos.begin(); it != videos.end(); ++it) {
+                offset += (int32_t)(*it)->nb_data;
+            }
+        }
+        if (atraf) {
+            atraf->trun()->data_offset = offset;
+        }
+        
+        if ((err = srs_mp4_write_box(writer, moof)) != srs_success) {
+            return srs_error_wrap(err, "write moof");
+        }
+    }
+    
+    // Write mdat.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+        
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+        
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+        
+        if ((err = writer->write(data, nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+        
+        for (int i = 0; i < 2; i++) {
+            vector<SrsMp4Sample*>& samples = (i == 0)? videos : audios;
+            
+            vector<SrsMp4Sample*>::iterator it;
+            for (it = samples.begin(); it != samples.end(); ++it) {
+                SrsMp4Sample* sample = *it;
+                if ((err = writer->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+                    return srs_error_wrap(err, "write sample");
+                }
+            }
+        }
+    }
+    
+    clear();
+    
+    return err;
+}
+
+SrsMp4TrackFragmentBox* SrsMp4FragmentEncoder::create_traf(uint32_t tid, vector<SrsMp4Sample*>& samples)
+{
+    SrsMp4TrackFragmentBox* traf = new SrsMp4TrackFragmentBox();
+    
+    SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+    traf->set_tfhd(tfhd);
+    
+    tfhd->track_id = tid;
+    tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+    
+    SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+    traf->set_tfdt(tfdt);
+    
+    tfdt->version = 1;
+    tfdt->base_media_decode_time = samples[0]->dts;
+    
+    SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+    traf->set_trun(trun);
+    
+    trun->flags = SrsMp4TrunFlagsDataOffset | SrsMp4TrunFlagsSampleDuration
+        | SrsMp4TrunFlagsSampleSize | SrsMp4TrunFlagsSampleFlag | SrsMp4TrunFlagsSampleCtsOffset;
+    
+    // The duration of sample is the delta to the next one, and the last one use the previous delta,
+    // while the tfdt of next fragment corrects the drift.
+    uint32_t delta = (samples[0]->type == SrsFrameTypeVideo)? 40 : 23;
+    for (int i = 0; i < (int)samples.size(); i++) {
+        SrsMp4Sample* sample = samples[i];
+        SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
+        
+        if (i < (int)samples.size() - 1 && samples[i + 1]->dts > sample->dts) {
+            delta = (uint32_t)(samples[i + 1]->dts - sample->dts);
+        }
+        entry->sample_duration = delta;
+        entry->sample_size = sample->nb_data;
+        
+        // For non-keyframe of video, sample_depends_on=1 and sample_is_non_sync_sample=1,
+        // otherwise, sample_depends_on=2 for keyframe and audio.
+        if (sample->type == SrsFrameTypeVideo && sample->frame_type != SrsVideoAvcFrameTypeKeyFrame) {
+            entry->sample_flags = 0x01010000;
+        } else {
+            entry->sample_flags = 0x02000000;
+        }
+        
+        entry->sample_composition_time_offset = (int64_t)sample->pts - (int64_t)sample->dts;
+        if (entry->sample_composition_time_offset < 0) {
+            trun->version = 1;
+        }
+        
+        trun->entries.push_back(entry);
+    }
+    
+    return traf;
+}
+
+void SrsMp4FragmentEncoder::clear()
+{
+    for (int i = 0; i < 2; i++) {
+        vector<SrsMp4Sample*>& samples = (i == 0)? videos : audios;
+        
+        vector<SrsMp4Sample*>::iterator it;
+        for (it = samples.begin(); it != samples.end(); ++it) {
+            SrsMp4Sample* sample = *it;
+            srs_freep(sample);
+        }
+        samples.clear();
+    }
+    
+    mdat_bytes = 0;
+}
+
+SrsMp4Defragmenter::SrsMp4Defragmenter()
+{
+    rsio = NULL;
+    enc = new SrsMp4Encoder();
+    format = new SrsFormat();
+    filesize = offset = 0;
+    vtid = atid = 0;
+    vtimescale = atimescale = 1000;
+    moov_parsed = false;
+}
+
+SrsMp4Defragmenter::~SrsMp4Defragmenter()
+{
+    srs_freep(enc);
+    srs_freep(format);
+}
+
+srs_error_t SrsMp4Defragmenter::initialize(ISrsReadSeeker* rs, ISrsWriteSeeker* ws)
+{
+    srs_error_t err = srs_success;
+    
+    rsio = rs;
+    
+    if ((err = rsio->lseek(0, SEEK_END, &filesize)) != srs_success) {
+        return srs_error_wrap(err, "seek end");
+    }
+    offset = 0;
+    
+    if ((err = format->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init format");
+    }
+    
+    if ((err = enc->initialize(ws)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::step(bool* pdone)
+{
+    srs_error_t err = srs_success;
+    
+    *pdone = false;
+    
+    while (true) {
+        SrsMp4BoxType type = SrsMp4BoxTypeForbidden;
+        uint64_t size = 0;
+        if ((err = read_header(offset, &type, &size)) != srs_success) {
+            return srs_error_wrap(err, "read header at %" PRId64, (int64_t)offset);
+        }
+        
+        // Done for EOF, or the last box is truncated.
+        if (!size) {
+            if (offset < filesize) {
+                srs_warn("MP4 ignore truncated box at %" PRId64 ", file size %" PRId64, (int64_t)offset, (int64_t)filesize);
+            }
+            *pdone = true;
+            return err;
+        }
+        
+        if (type == SrsMp4BoxTypeMOOV) {
+            SrsMp4Box* box = NULL;
+            if ((err = read_box(offset, size, &box)) != srs_success) {
+                return srs_error_wrap(err, "read moov");
+            }
+            SrsAutoFree(SrsMp4Box, box);
+            
+            if ((err = parse_moov(dynamic_cast<SrsMp4MovieBox*>(box))) != srs_success) {
+                return srs_error_wrap(err, "parse moov");
+            }
+            
+            offset += size;
+            continue;
+        }
+        
+        if (type != SrsMp4BoxTypeMOOF) {
+            offset += size;
+            continue;
+        }
+        
+        if (!moov_parsed) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "moof before moov");
+        }
+        
+        // The mdat follows the moof, the fragment is ignored if mdat is truncated.
+        SrsMp4BoxType mdat_type = SrsMp4BoxTypeForbidden;
+        uint64_t mdat_size = 0;
+        if ((err = read_header(offset + size, &mdat_type, &mdat_size)) != srs_success) {
+            return srs_error_wrap(err, "read mdat");
+        }
+        if (!mdat_size) {
+            srs_warn("MP4 ignore truncated fragment at %" PRId64 ", file size %" PRId64, (int64_t)offset, (int64_t)filesize);
+            *pdone = true;
+            return err;
+        }
+        if (mdat_type != SrsMp4BoxTypeMDAT) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "no mdat after moof, type=%#x", mdat_type);
+        }
+        
+        SrsMp4Box* box = NULL;
+        if ((err = read_box(offset, size, &box)) != srs_success) {
+            return srs_error_wrap(err, "read moof");
+        }
+        SrsAutoFree(SrsMp4Box, box);
+        
+        if ((err = parse_moof(dynamic_cast<SrsMp4MovieFragmentBox*>(box), offset)) != srs_success) {
+            return srs_error_wrap(err, "parse moof");
+        }
+        
+        // The samples must be in the mdat.
+        off_t end = offset + (off_t)(size + mdat_size);
+        for (int i = 0; i < (int)samples.size(); i++) {
+            SrsMp4FragmentSample& sample = samples[i];
+            if (sample.offset < offset || sample.offset + (off_t)sample.nb_data > end) {
+                return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "sample %d at %" PRId64 " out of fragment", i, (int64_t)sample.offset);
+            }
+        }
+        
+        if ((err = write_samples()) != srs_success) {
+            return srs_error_wrap(err, "write samples");
+        }
+        
+        offset = end;
+        break;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = enc->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::read_header(off_t pos, SrsMp4BoxType* ptype, uint64_t* psize)
+{
+    srs_error_t err = srs_success;
+    
+    *psize = 0;
+    
+    if (pos + 8 > filesize) {
+        return err;
+    }
+    
+    char buf[16];
+    if ((err = read_at(pos, buf, 8)) != srs_success) {
+        return srs_error_wrap(err, "read box");
+    }
+    
+    SrsBuffer buffer(buf, sizeof(buf));
+    uint64_t size = (uint32_t)buffer.read_4bytes();
+    *ptype = (SrsMp4BoxType)buffer.read_4bytes();
+    
+    if (size == SRS_MP4_USE_LARGE_SIZE) {
+        if (pos + 16 > filesize) {
+            return err;
+        }
+        if ((err = read_at(pos + 8, buf + 8, 8)) != srs_success) {
+            return srs_error_wrap(err, "read largesize");
+        }
+        size = (uint64_t)buffer.read_8bytes();
+    } else if (size == SRS_MP4_EOF_SIZE) {
+        size = (uint64_t)(filesize - pos);
+    }
+    
+    if (size < 8) {
+        return srs_error_new(ERROR_MP4_BOX_OVERFLOW, "invalid box size %" PRId64, (int64_t)size);
+    }
+    
+    if (pos + (off_t)size <= filesize) {
+        *psize = size;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::read_box(off_t pos, uint64_t size, SrsMp4Box** ppbox)
+{
+    srs_error_t err = srs_success;
+    
+    // Only the moov and moof is decoded, which is always small.
+    if (size > 0x7fffffff) {
+        return srs_error_new(ERROR_MP4_BOX_OVERFLOW, "overflow 31bits, size=%" PRId64, (int64_t)size);
+    }
+    
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+    
+    if ((err = read_at(pos, data, (int)size)) != srs_success) {
+        return srs_error_wrap(err, "read box");
+    }
+    
+    SrsBuffer* buffer = new SrsBuffer(data, (int)size);
+    SrsAutoFree(SrsBuffer, buffer);
+    
+    SrsMp4Box* box = NULL;
+    if ((err = SrsMp4Box::discovery(buffer, &box)) != srs_success) {
+        return srs_error_wrap(err, "discovery");
+    }
+    
+    if ((err = box->decode(buffer)) != srs_success) {
+        srs_freep(box);
+        return srs_error_wrap(err, "decode box");
+    }
+    
+    *ppbox = box;
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::read_at(off_t pos, char* buf, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = rsio->lseek(pos, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to %" PRId64, (int64_t)pos);
+    }
+    
+    while (size > 0) {
+        ssize_t nread = 0;
+        if ((err = rsio->read(buf, size, &nread)) != srs_success) {
+            return srs_error_wrap(err, "read %d bytes", size);
+        }
+        buf += nread;
+        size -= (int)nread;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::parse_moov(SrsMp4MovieBox* moov)
+{
+    srs_error_t err = srs_success;
+    
+    if (moov_parsed) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "moov duplicated");
+    }
+    moov_parsed = true;
+    
+    SrsMp4TrackBox* vide = moov->video();
+    SrsMp4TrackBox* soun = moov->audio();
+    if (!vide && !soun) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "missing audio and video track");
+    }
+    
+    if (vide) {
+        SrsMp4AvccBox* avcc = vide->avcc();
+        if (!avcc || avcc->avc_config.empty() || !vide->tkhd() || !vide->mdhd()) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "invalid video track");
+        }
+        
+        vtid = vide->tkhd()->track_ID;
+        vtimescale = srs_max(1, vide->mdhd()->timescale);
+        enc->vcodec = vide->vide_codec();
+        
+        // Parse the width and height from the sequence header, in FLV video tag.
+        std::vector<char> flv(5, 0);
+        flv[0] = (char)0x17;
+        flv.insert(flv.end(), avcc->avc_config.begin(), avcc->avc_config.end());
+        if ((err = format->on_video(0, &flv[0], (int)flv.size())) != srs_success) {
+            return srs_error_wrap(err, "parse avcc");
+        }
+        
+        uint8_t* p = (uint8_t*)&avcc->avc_config[0];
+        uint32_t nb = (uint32_t)avcc->avc_config.size();
+        if ((err = enc->write_sample(format, SrsMp4HandlerTypeVIDE, 0x00, SrsVideoAvcFrameTraitSequenceHeader, 0, 0, p, nb)) != srs_success) {
+            return srs_error_wrap(err, "write avcc");
+        }
+    }
+    
+    if (soun) {
+        SrsMp4AudioSampleEntry* mp4a = soun->mp4a();
+        SrsMp4DecoderSpecificInfo* asc = soun->asc();
+        if (!mp4a || !asc || asc->asc.empty() || !soun->tkhd() || !soun->mdhd()) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "invalid audio track");
+        }
+        
+        atid = soun->tkhd()->track_ID;
+        atimescale = srs_max(1, soun->mdhd()->timescale);
+        enc->acodec = soun->soun_codec();
+        
+        uint32_t sr = mp4a->samplerate>>16;
+        if (sr >= 44100) {
+            enc->sample_rate = SrsAudioSampleRate44100;
+        } else if (sr >= 22050) {
+            enc->sample_rate = SrsAudioSampleRate22050;
+        } else if (sr >= 11025) {
+            enc->sample_rate = SrsAudioSampleRate11025;
+        } else {
+            enc->sample_rate = SrsAudioSampleRate5512;
+        }
+        enc->sound_bits = (mp4a->samplesize == 16)? SrsAudioSampleBits16bit : SrsAudioSampleBits8bit;
+        enc->channels = (mp4a->channelcount == 2)? SrsAudioChannelsStereo : SrsAudioChannelsMono;
+        
+        uint8_t* p = (uint8_t*)&asc->asc[0];
+        uint32_t nb = (uint32_t)asc->asc.size();
+        if ((err = enc->write_sample(NULL, SrsMp4HandlerTypeSOUN, 0x00, SrsAudioAacFrameTraitSequenceHeader, 0, 0, p, nb)) != srs_success) {
+            return srs_error_wrap(err, "write asc");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4Defragmenter::parse_moof(SrsMp4MovieFragmentBox* moof, off_t moof_offset)
+{
+    srs_error_t err = srs_success;
+    
+    samples.clear();
+    
+    vector<SrsMp4TrackFragmentBox*> trafs = moof->trafs();
+    for (int i = 0; i < (int)trafs.size(); i++) {
+        SrsMp4TrackFragmentBox* traf = trafs[i];
+        
+        SrsMp4TrackFragmentHeaderBox* tfhd = traf->tfhd();
+        SrsMp4TrackFragmentDecodeTimeBox* tfdt = traf->tfdt();
+        SrsMp4TrackFragmentRunBox* trun = traf->trun();
+        if (!tfhd || !tfdt || !trun) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "missing tfhd, tfdt or trun");
+        }
+        
+        bool video = vtid && tfhd->track_id == vtid;
+        if (!video && (!atid || tfhd->track_id != atid)) {
+            srs_warn("MP4 ignore fragment of track %d", tfhd->track_id);
+            continue;
+        }
+        uint64_t timescale = video? vtimescale : atimescale;
+        
+        // We only support the base of moof, or the explicit base offset.
+        off_t base = moof_offset;
+        if ((tfhd->flags & SrsMp4TfhdFlagsBaseDataOffset) == SrsMp4TfhdFlagsBaseDataOffset) {
+            base = (off_t)tfhd->base_data_offset;
+        }
+        off_t pos = base + trun->data_offset;
+        
+        uint64_t dts = tfdt->base_media_decode_time;
+        for (int j = 0; j < (int)trun->entries.size(); j++) {
+            SrsMp4TrunEntry* entry = trun->entries[j];
+            
+            uint32_t duration = tfhd->default_sample_duration;
+            if ((trun->flags & SrsMp4TrunFlagsSampleDuration) == SrsMp4TrunFlagsSampleDuration) {
+                duration = entry->sample_duration;
+            }
+            uint32_t size = tfhd->default_sample_size;
+            if ((trun->flags & SrsMp4TrunFlagsSampleSize) == SrsMp4TrunFlagsSampleSize) {
+                size = entry->sample_size;
+            }
+            uint32_t flags = tfhd->default_sample_flags;
+            if ((trun->flags & SrsMp4TrunFlagsSampleFlag) == SrsMp4TrunFlagsSampleFlag) {
+                flags = entry->sample_flags;
+            } else if (j == 0 && (trun->flags & SrsMp4TrunFlagsFirstSample) == SrsMp4TrunFlagsFirstSample) {
+                flags = trun->first_sample_flags;
+            }
+            int64_t cts = 0;
+            if ((trun->flags & SrsMp4TrunFlagsSampleCtsOffset) == SrsMp4TrunFlagsSampleCtsOffset) {
+                cts = entry->sample_composition_time_offset;
+            }
+            
+            SrsMp4FragmentSample sample;
+            sample.handler_type = video? SrsMp4HandlerTypeVIDE : SrsMp4HandlerTypeSOUN;
+            // The sample_is_non_sync_sample is the 16th bit of sample flags.
+            sample.frame_type = (video && (flags & 0x00010000))? SrsVideoAvcFrameTypeInterFrame : SrsVideoAvcFrameTypeKeyFrame;
+            sample.dts = (uint32_t)(dts * 1000 / timescale);
+            sample.pts = (uint32_t)((int64_t)sample.dts + cts * 1000 / (int64_t)timescale);
+            sample.offset = pos;
+            sample.nb_data = size;
+            samples.push_back(sample);
+            
+            dts += duration;
+            pos += size;
+        }
+    }
+    
+    return err;
+}
+
+static bool srs_mp4_fragment_sample_less(const SrsMp4FragmentSample& a, const SrsMp4FragmentSample& b)
+{
+    return a.dts < b.dts;
+}
+
+srs_error_t SrsMp4Defragmenter::write_samples()
+{
+    srs_error_t err = srs_success;
+    
+    // Interleave the audio and video samples by dts.
+    std::stable_sort(samples.begin(), samples.end(), srs_mp4_fragment_sample_less);
+    
+    for (int i = 0; i < (int)samples.size(); i++) {
+        SrsMp4FragmentSample& sample = samples[i];
+        if (!sample.nb_data) {
+            continue;
+        }
+        
+        if (payload.size() < sample.nb_data) {
+            payload.resize(sample.nb_data);
+        }
+        
+        if ((err = read_at(sample.offset, &payload[0], (int)sample.nb_data)) != srs_success) {
+            return srs_error_wrap(err, "read sample");
+        }
+        
+        uint16_t ft = (sample.handler_type == SrsMp4HandlerTypeVIDE)? (uint16_t)sample.frame_type : 0x00;
+        uint16_t ct = (sample.handler_type == SrsMp4HandlerTypeVIDE)? (uint16_t)SrsVideoAvcFrameTraitNALU : (uint16_t)SrsAudioAacFrameTraitRawData;
+        if ((err = enc->write_sample(NULL, sample.handler_type, ft, ct, sample.dts, sample.pts, (uint8_t*)&payload[0], sample.nb_data)) != srs_success) {
+            return srs_error_wrap(err, "write sample");
+        }
+    }
+    
+    samples.clear();
+    
+    return err;
+}
@@ -50,6 +50,7 @@ class SrsMp4AvccBox;
 class SrsMp4DecoderSpecificInfo;
 class SrsMp4VisualSampleEntry;
 class SrsMp4AvccBox;
+class SrsMp4HvcCBox;
 class SrsMp4AudioSampleEntry;
 class SrsMp4EsdsBox;
 class SrsMp4ChunkOffsetBox;
@@ -111,6 +112,8 @@ enum SrsMp4BoxType
     SrsMp4BoxTypeSTZ2 = 0x73747a32, // 'stz2'
     SrsMp4BoxTypeAVC1 = 0x61766331, // 'avc1'
     SrsMp4BoxTypeAVCC = 0x61766343, // 'avcC'
+    SrsMp4BoxTypeHVC1 = 0x68766331, // 'hvc1'
+    SrsMp4BoxTypeHVCC = 0x68766343, // 'hvcC'
     SrsMp4BoxTypeMP4A = 0x6d703461, // 'mp4a'
     SrsMp4BoxTypeESDS = 0x65736473, // 'esds'
     SrsMp4BoxTypeUDTA = 0x75647461, // 'udta'
@@ -330,6 +333,10 @@ public:
     // Get the traf.
     virtual SrsMp4TrackFragmentBox* traf();
     virtual void set_traf(SrsMp4TrackFragmentBox* v);
+    // Add a traf, for fragment with multiple tracks.
+    virtual void add_traf(SrsMp4TrackFragmentBox* v);
+    // Get all trafs, for fragment with multiple tracks.
+    virtual std::vector<SrsMp4TrackFragmentBox*> trafs();
 };
 
 // 8.8.5 Movie Fragment Header Box (mfhd)
@@ -645,6 +652,8 @@ public:
     virtual int nb_vide_tracks();
     // Get the number of audio tracks.
     virtual int nb_soun_tracks();
+    // Remove the tracks except the video and audio track, for example, the hint or text tracks.
+    virtual void retain_traks(SrsMp4TrackBox* vide, SrsMp4TrackBox* soun);
 protected:
     virtual int nb_header();
     virtual srs_error_t encode_header(SrsBuffer* buf);
@@ -723,6 +732,8 @@ public:
     // Get the track extends box.
     virtual SrsMp4TrackExtendsBox* trex();
     virtual void set_trex(SrsMp4TrackExtendsBox* v);
+    // Add a trex, for movie with multiple tracks.
+    virtual void add_trex(SrsMp4TrackExtendsBox* v);
 };
 
 // 8.8.3 Track Extends Box(trex)
@@ -1241,7 +1252,7 @@ public:
     virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
 };
 
-// 8.5.2 Sample Description Box (avc1)
+// 8.5.2 Sample Description Box (avc1 or hvc1)
 // ISO_IEC_14496-12-base-format-2012.pdf, page 44
 class SrsMp4VisualSampleEntry : public SrsMp4SampleEntry
 {
@@ -1268,12 +1279,15 @@ public:
     uint16_t depth;
     int16_t pre_defined2;
 public:
-    SrsMp4VisualSampleEntry();
+    SrsMp4VisualSampleEntry(SrsMp4BoxType boxType = SrsMp4BoxTypeAVC1);
     virtual ~SrsMp4VisualSampleEntry();
 public:
     // For avc1, get the avcc box.
     virtual SrsMp4AvccBox* avcC();
     virtual void set_avcC(SrsMp4AvccBox* v);
+    // For hvc1, get the hvcC box.
+    virtual SrsMp4HvcCBox* hvcC();
+    virtual void set_hvcC(SrsMp4HvcCBox* v);
 protected:
     virtual int nb_header();
     virtual srs_error_t encode_header(SrsBuffer* buf);
@@ -1299,6 +1313,24 @@ public:
     virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
 };
 
+// 8.4.1 HEVC Video Stream Definition (hvcC)
+// ISO_IEC_14496-15-2017.pdf, page 85
+class SrsMp4HvcCBox : public SrsMp4Box
+{
+public:
+    // The HEVCDecoderConfigurationRecord.
+    std::vector<char> hevc_config;
+public:
+    SrsMp4HvcCBox();
+    virtual ~SrsMp4HvcCBox();
+protected:
+    virtual int nb_header();
+    virtual srs_error_t encode_header(SrsBuffer* buf);
+    virtual srs_error_t decode_header(SrsBuffer* buf);
+public:
+    virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
+};
+
 // 8.5.2 Sample Description Box (mp4a)
 // ISO_IEC_14496-12-base-format-2012.pdf, page 45
 class SrsMp4AudioSampleEntry : public SrsMp4SampleEntry
@@ -1924,6 +1956,75 @@ private:
         SrsMp4DecodingTime2SampleBox* stts, SrsMp4CompositionTime2SampleBox* ctts, SrsMp4SyncSampleBox* stss);
 };
 
+// The samples of a track, in struct-of-arrays, without an object for each sample.
+// @remark The samples are sorted by offset, for we read the mdat sequentially.
+class SrsMp4TrackSamples
+{
+public:
+    // The type of track, convert to flv tag type.
+    SrsFrameType type;
+    // The tbn(timebase) of track.
+    uint32_t tbn;
+    // The adjust timestamp in milliseconds, for A/V to monotonically increase.
+    int32_t adjust;
+    // The offset in file, size, dts and cts of each sample, where pts=dts+cts.
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> sizes;
+    std::vector<uint64_t> dtses;
+    std::vector<int64_t> ctses;
+    // For video, whether the sample is a keyframe.
+    std::vector<bool> keyframes;
+public:
+    SrsMp4TrackSamples(SrsFrameType t);
+    virtual ~SrsMp4TrackSamples();
+public:
+    // Load the samples from stco, stsz, stsc, stts, ctts and stss, in a single pass.
+    virtual srs_error_t load(SrsMp4MediaHeaderBox* mdhd, SrsMp4ChunkOffsetBox* stco, SrsMp4SampleSizeBox* stsz,
+        SrsMp4Sample2ChunkBox* stsc, SrsMp4DecodingTime2SampleBox* stts, SrsMp4CompositionTime2SampleBox* ctts,
+        SrsMp4SyncSampleBox* stss);
+    // Get the number of samples.
+    virtual uint32_t size();
+    // Get the adjusted dts in ms of sample at index.
+    virtual uint32_t dts_ms(uint32_t index);
+    // Get the index of the first sample which dts is not less than ms, size() if none.
+    virtual uint32_t lower_bound(uint32_t ms);
+private:
+    // Sort samples by offset, only when the chunks are not in order.
+    virtual void sort();
+};
+
+// The samples index for demuxer, which reads the samples of tracks in the order of offset.
+// @remark Unlike SrsMp4SampleManager, it never allocates an object for each sample, so it's
+//      fast to load a long MP4 file, and the samples of tracks are merged when reading.
+class SrsMp4SampleIndex
+{
+private:
+    SrsMp4TrackSamples* vide;
+    SrsMp4TrackSamples* soun;
+    // The next sample of tracks to read.
+    uint32_t vide_cursor;
+    uint32_t soun_cursor;
+public:
+    SrsMp4SampleIndex();
+    virtual ~SrsMp4SampleIndex();
+public:
+    // Load the samples from moov. There must be atleast one track.
+    virtual srs_error_t load(SrsMp4MovieBox* moov);
+    // Read the next sample information, without the data.
+    // @return false if EOF.
+    virtual bool next(SrsMp4Sample* sample);
+    // Seek the tracks to the first sample at or after the time in ms.
+    virtual void seek(uint32_t ms);
+    // Get the number of samples of all tracks.
+    virtual uint32_t size();
+    // Get the track of samples, NULL if no such track.
+    virtual SrsMp4TrackSamples* video();
+    virtual SrsMp4TrackSamples* audio();
+private:
+    // Pick the track of next sample by the offset, NULL if EOF.
+    virtual SrsMp4TrackSamples* pick(uint32_t vi, uint32_t si);
+};
+
 // The MP4 box reader, to get the RAW boxes without decode.
 // @remark For mdat box, we only decode the header, then skip the data.
 class SrsMp4BoxReader
@@ -1951,9 +2052,8 @@ private:
     // The major brand of decoder, parse from ftyp.
     SrsMp4BoxBrand brand;
     // The samples build from moov.
-    SrsMp4SampleManager* samples;
+    SrsMp4SampleIndex* samples;
     // The current written sample information.
-    uint32_t current_index;
     off_t current_offset;
 public:
     // The video codec of first track, generally there is zero or one track.
@@ -2007,6 +2107,12 @@ public:
     // @remark The decoder will generate the first two audio/video sequence header.
     virtual srs_error_t read_sample(SrsMp4HandlerType* pht, uint16_t* pft, uint16_t* pct,
     uint32_t* pdts, uint32_t* ppts, uint8_t** psample, uint32_t* pnb_sample);
+    // Seek to the samples at or after the time in ms, the sequence headers are generated again.
+    // @remark The video should be seek to the keyframe, see read_keyframes.
+    virtual void seek(uint32_t ms);
+    // Read the seek points in ms, which are the keyframes of video, or the audio every 1s if no video.
+    // @param pduration The output duration in ms, the dts of the last sample.
+    virtual void read_keyframes(std::vector<int64_t>& times, int64_t* pduration);
 private:
     virtual srs_error_t parse_ftyp(SrsMp4FileTypeBox* ftyp);
     virtual srs_error_t parse_moov(SrsMp4MovieBox* moov);
@@ -2018,6 +2124,42 @@ private:
     virtual srs_error_t do_load_next_box(SrsMp4Box** ppbox, uint32_t required_box_type);
 };
 
+// Trim the moov of a progressive MP4 to start at a keyframe, for the pseudo-streaming of vod, for
+// example, x.mp4?start=60, which responses the ftyp, the trimmed moov and the mdat header, then the
+// samples in file from the keyframe, so the player plays from the start without loading the whole moov.
+// @remark The sample tables are rebuilt from the sample index, and the chunk offsets point to the
+//      samples after the header, so the samples are sent from file without any copy.
+// @remark The moov is loaded once, and trimmed for each start time.
+class SrsMp4MoovTrimmer
+{
+private:
+    SrsMp4BoxReader* br;
+    SrsSimpleStream* stream;
+    SrsMp4FileTypeBox* ftyp;
+    SrsMp4MovieBox* moov;
+    SrsMp4SampleIndex* samples;
+public:
+    SrsMp4MoovTrimmer();
+    virtual ~SrsMp4MoovTrimmer();
+public:
+    // Load the ftyp and moov from the reader, the samples are never read.
+    virtual srs_error_t initialize(ISrsReadSeeker* rs);
+    // Get the time in ms of the keyframe at or before the time, to start from.
+    // @remark For pure audio, the sample at or before the time.
+    virtual uint32_t keyframe_at(uint32_t ms);
+    // Trim the moov to start at the keyframe at or before the time.
+    // @param header Output the ftyp, trimmed moov and mdat header to send before samples.
+    // @param pstart Output the offset in file of the first sample to send after header.
+    // @param pend Output the offset in file after the last sample.
+    virtual srs_error_t trim(uint32_t ms, std::string& header, int64_t* pstart, int64_t* pend);
+private:
+    // Get the index of the sample to start from, for the keyframe at or before the time.
+    virtual uint32_t start_of(SrsMp4TrackSamples* track, uint32_t ms, bool keyframe);
+    // Rebuild the sample tables of track from the sample at index, the chunk offsets are relative to base.
+    // @param pduration Output the duration of samples in the timescale of track.
+    virtual srs_error_t trim_track(SrsMp4TrackBox* trak, SrsMp4TrackSamples* track, uint32_t index, uint64_t base, uint64_t* pduration);
+};
+
 // The MP4 muxer.
 class SrsMp4Encoder
 {
@@ -2097,6 +2239,8 @@ public:
     virtual srs_error_t initialize(ISrsWriter* w);
     // Write the sequence header.
     virtual srs_error_t write(SrsFormat* format, bool video, int tid);
+    // Write the sequence header of both tracks, in a moov, ignore the track if its tid is 0.
+    virtual srs_error_t write(SrsFormat* format, int vtid, int atid);
 };
 
 // A fMP4 encoder, to cache segments then flush to disk, because the fMP4 should write
@@ -2115,6 +2259,8 @@ private:
     uint32_t styp_bytes;
     uint64_t mdat_bytes;
     SrsMp4SampleManager* samples;
+    // The number of chunks written, for CMAF chunked segment.
+    uint32_t nb_chunks;
 public:
     SrsMp4M2tsSegmentEncoder();
     virtual ~SrsMp4M2tsSegmentEncoder();
@@ -2132,7 +2278,110 @@ public:
     virtual srs_error_t write_sample(SrsMp4HandlerType ht, uint16_t ft,
         uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
     // Flush the encoder, to write the moof and mdat.
+    // @remark For chunked segment, write the cached samples as the last chunk.
     virtual srs_error_t flush(uint64_t& dts);
+    // Write the cached samples as a CMAF chunk(moof+mdat), without sidx, so the segment is
+    // written chunk by chunk, and the chunks are available to player before segment is done.
+    // @remark Ignore if no sample cached, and the sidx is never written once a chunk is written.
+    virtual srs_error_t flush_chunk(uint64_t& dts);
+private:
+    // @param pduration Output the duration in ms of samples written, ignore if NULL.
+    virtual srs_error_t do_flush(uint64_t& dts, bool sidx_required, uint64_t* pduration);
+};
+
+// A fMP4 encoder for live stream, to write a fragment(moof+mdat) of the audio and video
+// samples, without styp and sidx, so the fragments can be sent one by one after the init.
+// @remark Each track has a traf in the moof, and the samples of track is continuous in mdat.
+class SrsMp4FragmentEncoder
+{
+private:
+    ISrsWriter* writer;
+    uint32_t sequence_number;
+    uint32_t vtid;
+    uint32_t atid;
+private:
+    uint64_t mdat_bytes;
+    std::vector<SrsMp4Sample*> videos;
+    std::vector<SrsMp4Sample*> audios;
+public:
+    SrsMp4FragmentEncoder();
+    virtual ~SrsMp4FragmentEncoder();
+public:
+    // Initialize the encoder with a writer w, and the track id of video and audio in init.
+    virtual srs_error_t initialize(ISrsWriter* w, uint32_t vid, uint32_t aid);
+    // Cache a sample, the dts and pts are in milliseconds.
+    // @param ft, The frame type. For video, it's SrsVideoAvcFrameType.
+    // @remark The sample is copied, user should free it.
+    virtual srs_error_t write_sample(SrsMp4HandlerType ht, uint16_t ft,
+        uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
+    // Whether there is no sample to flush.
+    virtual bool empty();
+    // The duration of cached samples in milliseconds.
+    virtual uint32_t duration();
+    // Flush the cached samples as a fragment, to write the moof and mdat.
+    virtual srs_error_t flush();
+private:
+    virtual SrsMp4TrackFragmentBox* create_traf(uint32_t tid, std::vector<SrsMp4Sample*>& samples);
+    virtual void clear();
+};
+
+// A sample in fragment, which is located by offset in file.
+struct SrsMp4FragmentSample
+{
+    SrsMp4HandlerType handler_type;
+    SrsVideoAvcFrameType frame_type;
+    // The dts and pts in milliseconds.
+    uint32_t dts;
+    uint32_t pts;
+    // The position of payload in file.
+    off_t offset;
+    uint32_t nb_data;
+};
+
+// A converter to remux the fMP4 written by SrsMp4FragmentEncoder to a progressive MP4 with a moov,
+// which is done fragment by fragment, so user can yield between the step for a huge file.
+// @remark The payload is copied from the fMP4 to the MP4 directly, only the moov is kept in memory.
+// @remark A truncated fragment at the end of file, for example, server crash, is ignored.
+class SrsMp4Defragmenter
+{
+private:
+    ISrsReadSeeker* rsio;
+    SrsMp4Encoder* enc;
+    // The object to parse the width and height from avcc.
+    SrsFormat* format;
+    // The size of fMP4 file, and the position of next box.
+    off_t filesize;
+    off_t offset;
+    // The track id and timescale, parsed from moov.
+    uint32_t vtid;
+    uint32_t atid;
+    uint32_t vtimescale;
+    uint32_t atimescale;
+    bool moov_parsed;
+private:
+    // The samples of current fragment, and the buffer to read payload.
+    std::vector<SrsMp4FragmentSample> samples;
+    std::vector<char> payload;
+public:
+    SrsMp4Defragmenter();
+    virtual ~SrsMp4Defragmenter();
+public:
+    // Initialize the converter, to read the fMP4 from rs and write the MP4 to ws.
+    // @remark User must manage the rs and ws.
+    virtual srs_error_t initialize(ISrsReadSeeker* rs, ISrsWriteSeeker* ws);
+    // Convert the next fragment, set pdone to true when no more fragment.
+    virtual srs_error_t step(bool* pdone);
+    // Flush the MP4, to write the moov.
+    virtual srs_error_t flush();
+private:
+    // Read the header of box at pos, return the type and size of box, where size is 0 if truncated or EOF.
+    virtual srs_error_t read_header(off_t pos, SrsMp4BoxType* ptype, uint64_t* psize);
+    // Read and decode the whole box at pos.
+    virtual srs_error_t read_box(off_t pos, uint64_t size, SrsMp4Box** ppbox);
+    virtual srs_error_t read_at(off_t pos, char* buf, int size);
+    virtual srs_error_t parse_moov(SrsMp4MovieBox* moov);
+    virtual srs_error_t parse_moof(SrsMp4MovieFragmentBox* moof, off_t moof_offset);
+    virtual srs_error_t write_samples();
 };
 
 // LCOV_EXCL_START
@@ -0,0 +1,240 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_kernel_recorder.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+#include <string.h>
+#include <time.h>
+using namespace std;
+
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_utility.hpp>
+
+#define SRS_RECORDER_MAGIC "SRSFREC1"
+#define SRS_RECORDER_VERSION 1
+
+const char* srs_recorder_type2str(SrsRecorderEventType type)
+{
+    switch (type) {
+        case SrsRecorderEventSocketWrite: return "writev";
+        case SrsRecorderEventHook: return "hook";
+        case SrsRecorderEventFileIO: return "fileio";
+        case SrsRecorderEventQueueShrink: return "shrink";
+        case SrsRecorderEventSlice: return "slice";
+        default: return "unknown";
+    }
+}
+
+// Read the monotonic clock, which never updates the cached time, because the disk io threads use it.
+static srs_utime_t srs_recorder_clock()
+{
+#if !defined(SRS_AUTO_OSX) && !defined(_WIN32)
+    timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+        return 0;
+    }
+    return ((int64_t)now.tv_sec) * 1000 * 1000 + (int64_t)now.tv_nsec / 1000;
+#else
+    timeval now;
+    if (gettimeofday(&now, NULL) < 0) {
+        return 0;
+    }
+    return ((int64_t)now.tv_sec) * 1000 * 1000 + (int64_t)now.tv_usec;
+#endif
+}
+
+SrsFlightRecorder* _srs_recorder = new SrsFlightRecorder();
+
+SrsFlightRecorder::SrsFlightRecorder()
+{
+    events = NULL;
+    capacity = 0;
+    mask = 0;
+    next = 0;
+    min_duration = 0;
+}
+
+SrsFlightRecorder::~SrsFlightRecorder()
+{
+    srs_freepa(events);
+}
+
+srs_error_t SrsFlightRecorder::initialize(int size, srs_utime_t threshold)
+{
+    srs_error_t err = srs_success;
+    
+    if (events) {
+        return err;
+    }
+    
+    if (size <= 0) {
+        return srs_error_new(ERROR_SYSTEM_RECORDER, "recorder size=%d", size);
+    }
+    
+    capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    mask = capacity - 1;
+    min_duration = threshold;
+    
+    // The zero sequence marks the slot as empty.
+    SrsRecorderEvent* buf = new SrsRecorderEvent[capacity];
+    memset(buf, 0, sizeof(SrsRecorderEvent) * capacity);
+    events = buf;
+    
+    srs_trace("recorder: enabled, events=%d, bytes=%d, threshold=%dus", capacity,
+        (int)(sizeof(SrsRecorderEvent) * capacity), (int)threshold);
+    
+    return err;
+}
+
+bool SrsFlightRecorder::enabled()
+{
+    return events != NULL;
+}
+
+srs_utime_t SrsFlightRecorder::threshold()
+{
+    return min_duration;
+}
+
+srs_utime_t SrsFlightRecorder::begin()
+{
+    if (!events) {
+        return 0;
+    }
+    return srs_recorder_clock();
+}
+
+void SrsFlightRecorder::end(SrsRecorderEventType type, srs_utime_t starttime, int value, int cid)
+{
+    if (!events || starttime <= 0) {
+        return;
+    }
+    
+    srs_utime_t duration = srs_recorder_clock() - starttime;
+    if (duration < min_duration) {
+        return;
+    }
+    
+    record(type, duration, value, cid);
+}
+
+void SrsFlightRecorder::record(SrsRecorderEventType type, srs_utime_t duration, int value, int cid)
+{
+    if (!events) {
+        return;
+    }
+    
+    if (cid < 0) {
+        cid = _srs_context? _srs_context->get_id() : 0;
+    }
+    
+    // Claim the slot, then mark it as writing, publish the sequence after the event is ready.
+    uint64_t sequence = __sync_fetch_and_add(&next, 1);
+    SrsRecorderEvent* ev = &events[sequence & mask];
+    
+    ev->sequence = 0;
+    __sync_synchronize();
+    
+    ev->time = srs_recorder_clock();
+    ev->cid = cid;
+    ev->type = (uint16_t)type;
+    ev->reserved = 0;
+    ev->duration = (int32_t)srs_min(duration, (srs_utime_t)0x7fffffff);
+    ev->value = value;
+    
+    __sync_synchronize();
+    ev->sequence = sequence + 1;
+}
+
+void SrsFlightRecorder::dumps(string& data)
+{
+    SrsRecorderHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SRS_RECORDER_MAGIC, sizeof(header.magic));
+    header.version = SRS_RECORDER_VERSION;
+    header.event_size = sizeof(SrsRecorderEvent);
+    header.monotonic = srs_recorder_clock();
+    header.wall = srs_update_system_time();
+    header.pid = (int32_t)getpid();
+    
+    uint64_t end = next;
+    uint64_t start = (end > (uint64_t)capacity)? end - capacity : 0;
+    header.nn_total = end;
+    
+    data.clear();
+    data.reserve(sizeof(header) + sizeof(SrsRecorderEvent) * (end - start));
+    data.append((char*)&header, sizeof(header));
+    
+    // Copy each event, and drop it if it's being written or overwritten.
+    uint64_t nn_events = 0;
+    for (uint64_t i = start; events && i < end; i++) {
+        SrsRecorderEvent* ev = &events[i & mask];
+        if (ev->sequence != i + 1) {
+            continue;
+        }
+        __sync_synchronize();
+        
+        SrsRecorderEvent copy = *ev;
+        
+        __sync_synchronize();
+        if (ev->sequence != i + 1) {
+            continue;
+        }
+        
+        data.append((char*)&copy, sizeof(copy));
+        nn_events++;
+    }
+    
+    header.nn_events = nn_events;
+    data.replace(0, sizeof(header), (char*)&header, sizeof(header));
+}
+
+srs_error_t SrsFlightRecorder::save(string path)
+{
+    srs_error_t err = srs_success;
+    
+    string data;
+    dumps(data);
+    
+    SrsFileWriter writer;
+    if ((err = writer.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+    
+    if ((err = writer.write((void*)data.data(), data.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write %s", path.c_str());
+    }
+    
+    return err;
+}
+
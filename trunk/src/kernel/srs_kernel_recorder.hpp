@@ -0,0 +1,130 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_KERNEL_RECORDER_HPP
+#define SRS_KERNEL_RECORDER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+// The type of event in flight recorder.
+enum SrsRecorderEventType
+{
+    SrsRecorderEventUnknown = 0,
+    // Write to socket, the value is the bytes written.
+    SrsRecorderEventSocketWrite = 1,
+    // Call the http hook, the value is the error code, 0 for success.
+    SrsRecorderEventHook = 2,
+    // Write or close file, the value is the bytes written.
+    SrsRecorderEventFileIO = 3,
+    // Shrink the queue of consumer, the value is the messages removed.
+    SrsRecorderEventQueueShrink = 4,
+    // The slice of coroutine runs without yielding, recorded when scheduler.profile is on.
+    SrsRecorderEventSlice = 5,
+};
+
+// Get the name of event type, for example, "writev".
+extern const char* srs_recorder_type2str(SrsRecorderEventType type);
+
+// The compact binary event, 32 bytes.
+// @remark The dump is in host byte order, decoded by research/recorder/srs_recorder.py
+struct SrsRecorderEvent
+{
+    // The sequence of event plus one, 0 when the slot is being written.
+    uint64_t sequence;
+    // The monotonic time in us, when the event is done.
+    int64_t time;
+    // The context id of coroutine, 0 if not in coroutine, for example, the disk io thread.
+    int32_t cid;
+    uint16_t type;
+    uint16_t reserved;
+    // The duration in us of event.
+    int32_t duration;
+    int32_t value;
+};
+
+// The header of dump, followed by the events in order.
+struct SrsRecorderHeader
+{
+    // Always "SRSFREC1".
+    char magic[8];
+    uint32_t version;
+    // The bytes of each event.
+    uint32_t event_size;
+    // The monotonic and wall clock time in us when dump, to convert the time of event to wall clock.
+    int64_t monotonic;
+    int64_t wall;
+    // The number of events in dump, and recorded since started.
+    uint64_t nn_events;
+    uint64_t nn_total;
+    int32_t pid;
+    uint32_t reserved;
+};
+
+// The flight recorder, a fixed ring of compact binary events of hot path, such as the slow writev,
+// the hooks, the disk io and the queue shrinks, to diagnose the sporadic stalls.
+// The slot is claimed by an atomic sequence, so it's lock-free for the ST thread and disk io threads,
+// and only the events longer than the threshold are recorded, so it's cheap enough to leave on.
+class SrsFlightRecorder
+{
+private:
+    SrsRecorderEvent* events;
+    // The capacity of ring, always power of 2.
+    int capacity;
+    uint64_t mask;
+    // The sequence of next event.
+    volatile uint64_t next;
+    // Only record the event which is not shorter than it.
+    srs_utime_t min_duration;
+public:
+    SrsFlightRecorder();
+    virtual ~SrsFlightRecorder();
+public:
+    // Enable the recorder.
+    // @param size The max number of events, round up to power of 2.
+    // @param threshold Only record the event which is not shorter than it, 0 to record all.
+    virtual srs_error_t initialize(int size, srs_utime_t threshold);
+    virtual bool enabled();
+    virtual srs_utime_t threshold();
+public:
+    // Get the start time of event, 0 if disabled.
+    virtual srs_utime_t begin();
+    // Record the event from the start time to now, ignored if disabled or shorter than the threshold.
+    // @param cid The context id, -1 to use the current coroutine.
+    virtual void end(SrsRecorderEventType type, srs_utime_t starttime, int value, int cid = -1);
+    // Record the event directly, ignore the threshold.
+    // @param cid The context id, -1 to use the current coroutine.
+    virtual void record(SrsRecorderEventType type, srs_utime_t duration, int value, int cid = -1);
+public:
+    // Dumps the header and events to binary data.
+    virtual void dumps(std::string& data);
+    // Save the dump to file.
+    virtual srs_error_t save(std::string path);
+};
+
+// The global flight recorder, disabled until initialized.
+extern SrsFlightRecorder* _srs_recorder;
+
+#endif
+
@@ -31,10 +31,11 @@
 #endif
 
 #include <fcntl.h>
+#include <errno.h>
 #include <sstream>
 using namespace std;
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 #include <cstring>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -44,11 +45,11 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 
-#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 4
+// Encrypt 64 ts packets in a block, which is 752 blocks of AES, to reduce the calls of cipher and write.
+#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 64
 
 // the mpegts header specifed the video/audio pid.
 #define TS_PMT_NUMBER 1
-#define TS_PMT_PID 0x1001
 #define TS_VIDEO_AVC_PID 0x100
 #define TS_AUDIO_AAC_PID 0x101
 #define TS_AUDIO_MP3_PID 0x102
@@ -62,25 +63,108 @@ string srs_ts_stream2string(SrsTsStream stream)
         case SrsTsStreamAudioAC3: return "AC3";
         case SrsTsStreamAudioDTS: return "AudioDTS";
         case SrsTsStreamVideoH264: return "H.264";
+        case SrsTsStreamVideoHEVC: return "H.265";
         case SrsTsStreamVideoMpeg4: return "MP4";
         case SrsTsStreamAudioMpeg4: return "MP4A";
         default: return "Other";
     }
 }
 
+int64_t srs_ts_packet_pcr(const char* data)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    
+    // The adaptation_field_control is 2 or 3, with the adaptation_field_length and flags.
+    if (p[0] != 0x47 || (p[3] & 0x20) == 0 || p[4] < 7 || (p[5] & 0x10) == 0) {
+        return -1;
+    }
+    
+    int64_t pcr = ((int64_t)p[6] << 25) | ((int64_t)p[7] << 17) | ((int64_t)p[8] << 9) | ((int64_t)p[9] << 1);
+    return pcr | (p[10] >> 7);
+}
+
+int64_t srs_ts_packet_dts(const char* data)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    
+    // The payload_unit_start_indicator with payload.
+    if (p[0] != 0x47 || (p[1] & 0x40) == 0 || (p[3] & 0x10) == 0) {
+        return -1;
+    }
+    
+    int pos = 4;
+    if ((p[3] & 0x20) != 0) {
+        pos += 1 + p[4];
+    }
+    
+    // The PES header with PTS, or PTS and DTS, see Table 2-21 of ISO/IEC 13818-1.
+    if (pos + 19 > SRS_TS_PACKET_SIZE) {
+        return -1;
+    }
+    
+    const uint8_t* q = p + pos;
+    if (q[0] != 0 || q[1] != 0 || q[2] != 1) {
+        return -1;
+    }
+    
+    int flags = q[7] >> 6;
+    if (flags == 3) {
+        q += 14;
+    } else if (flags == 2) {
+        q += 9;
+    } else {
+        return -1;
+    }
+    
+    int64_t v = (int64_t)((q[0] >> 1) & 0x07) << 30;
+    v |= (int64_t)q[1] << 22;
+    v |= (int64_t)(q[2] >> 1) << 15;
+    v |= (int64_t)q[3] << 7;
+    v |= q[4] >> 1;
+    
+    return v;
+}
+
 SrsTsChannel::SrsTsChannel()
 {
     pid = 0;
     apply = SrsTsPidApplyReserved;
     stream = SrsTsStreamReserved;
+    program = 0;
     msg = NULL;
     continuity_counter = 0;
     context = NULL;
+    spare = NULL;
 }
 
 SrsTsChannel::~SrsTsChannel()
 {
     srs_freep(msg);
+    srs_freep(spare);
+}
+
+SrsTsMessage* SrsTsChannel::create_msg(SrsTsPacket* p)
+{
+    if (!spare) {
+        return new SrsTsMessage(this, p);
+    }
+    
+    SrsTsMessage* m = spare;
+    spare = NULL;
+    m->reset(p);
+    return m;
+}
+
+void SrsTsChannel::recycle(SrsTsMessage* m)
+{
+    // The payload is detached by user, it's not worth to reuse.
+    if (!m->payload) {
+        srs_freep(m);
+        return;
+    }
+    
+    srs_freep(spare);
+    spare = m;
 }
 
 SrsTsMessage::SrsTsMessage(SrsTsChannel* c, SrsTsPacket* p)
@@ -145,6 +229,21 @@ bool SrsTsMessage::fresh()
     return payload->length() == 0;
 }
 
+void SrsTsMessage::reset(SrsTsPacket* p)
+{
+    packet = p;
+    
+    dts = pts = 0;
+    sid = (SrsTsPESStreamId)0x00;
+    continuity_counter = 0;
+    PES_packet_length = 0;
+    payload->erase(payload->length());
+    is_discontinuity = false;
+    
+    start_pts = 0;
+    write_pcr = false;
+}
+
 bool SrsTsMessage::is_audio()
 {
     return ((sid >> 5) & 0x07) == SrsTsPESStreamIdAudioChecker;
@@ -200,10 +299,19 @@ SrsTsContext::SrsTsContext()
     sync_byte = 0x47; // ts default sync byte.
     vcodec = SrsVideoCodecIdReserved;
     acodec = SrsAudioCodecIdReserved1;
+    pes_buf = NULL;
+    offload = false;
+    pcr_interval = 0;
+    last_pcr = -1;
+    nb_es_bytes = nb_ts_bytes = 0;
+    packet = NULL;
 }
 
 SrsTsContext::~SrsTsContext()
 {
+    srs_freepa(pes_buf);
+    srs_freep(packet);
+    
     std::map<int, SrsTsChannel*>::iterator it;
     for (it = pids.begin(); it != pids.end(); ++it) {
         SrsTsChannel* channel = it->second;
@@ -235,17 +343,19 @@ void SrsTsContext::reset()
     ready = false;
     vcodec = SrsVideoCodecIdReserved;
     acodec = SrsAudioCodecIdReserved1;
+    last_pcr = -1;
 }
 
 SrsTsChannel* SrsTsContext::get(int pid)
 {
-    if (pids.find(pid) == pids.end()) {
+    std::map<int, SrsTsChannel*>::iterator it = pids.find(pid);
+    if (it == pids.end()) {
         return NULL;
     }
-    return pids[pid];
+    return it->second;
 }
 
-void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
+void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream, int program)
 {
     SrsTsChannel* channel = NULL;
     
@@ -260,6 +370,7 @@ void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
     channel->pid = pid;
     channel->apply = apply_pid;
     channel->stream = stream;
+    channel->program = program;
 }
 
 srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
@@ -269,20 +380,26 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
     // parse util EOF of stream.
     // for example, parse multiple times for the PES_packet_length(0) packet.
     while (!stream->empty()) {
-        SrsTsPacket* packet = new SrsTsPacket(this);
-        SrsAutoFree(SrsTsPacket, packet);
-        
         SrsTsMessage* msg = NULL;
-        if ((err = packet->decode(stream, &msg)) != srs_success) {
-            return srs_error_wrap(err, "ts: ts packet decode");
+        if (!decode_pes_fast(stream, &msg)) {
+            if (!packet) {
+                packet = new SrsTsPacket(this);
+            }
+            
+            if ((err = packet->decode(stream, &msg)) != srs_success) {
+                return srs_error_wrap(err, "ts: ts packet decode");
+            }
         }
         
         if (!msg) {
             continue;
         }
-        SrsAutoFree(SrsTsMessage, msg);
         
-        if ((err = handler->on_ts_message(msg)) != srs_success) {
+        // The message is recycled to channel, for user should never keep it, see ISrsTsHandler.
+        err = handler->on_ts_message(msg);
+        msg->channel->recycle(msg);
+        
+        if (err != srs_success) {
             return srs_error_wrap(err, "ts: handle ts message");
         }
     }
@@ -290,6 +407,54 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
     return err;
 }
 
+bool SrsTsContext::decode_pes_fast(SrsBuffer* stream, SrsTsMessage** ppmsg)
+{
+    // Only for the whole packet, not the one to reparse.
+    if (stream->pos() != 0 || !stream->require(SRS_TS_PACKET_SIZE)) {
+        return false;
+    }
+    
+    uint8_t* p = (uint8_t*)stream->data();
+    if (p[0] != 0x47) {
+        return false;
+    }
+    
+    // The packet without payload_unit_start_indicator and adaptation field, see SrsTsPacket::decode.
+    int8_t payload_unit_start_indicator = (p[1] >> 6) & 0x01;
+    SrsTsAdaptationFieldType adaption_field_control = (SrsTsAdaptationFieldType)((p[3] >> 4) & 0x03);
+    if (payload_unit_start_indicator || adaption_field_control != SrsTsAdaptationFieldTypePayloadOnly) {
+        return false;
+    }
+    
+    int pid = ((p[1] & 0x1f) << 8) | p[2];
+    SrsTsChannel* channel = get(pid);
+    if (!channel || (channel->apply != SrsTsPidApplyVideo && channel->apply != SrsTsPidApplyAudio)) {
+        return false;
+    }
+    
+    // The continuous packet of a partial message, see SrsTsPayloadPES::decode.
+    SrsTsMessage* msg = channel->msg;
+    uint8_t continuity_counter = p[3] & 0x0F;
+    if (!msg || msg->fresh() || msg->completed(0) || ((msg->continuity_counter + 1) & 0x0f) != continuity_counter) {
+        return false;
+    }
+    msg->continuity_counter = continuity_counter;
+    
+    int nb_bytes = SRS_TS_PACKET_SIZE - 4;
+    if (msg->PES_packet_length > 0) {
+        nb_bytes = srs_min(nb_bytes, msg->PES_packet_length - msg->payload->length());
+    }
+    msg->payload->append((char*)p + 4, nb_bytes);
+    stream->skip(4 + nb_bytes);
+    
+    if (msg->completed(0)) {
+        *ppmsg = msg;
+        channel->msg = NULL;
+    }
+    
+    return true;
+}
+
 srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, SrsVideoCodecId vc, SrsAudioCodecId ac)
 {
     srs_error_t err = srs_success;
@@ -301,6 +466,10 @@ srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, Sr
             vs = SrsTsStreamVideoH264;
             video_pid = TS_VIDEO_AVC_PID;
             break;
+        case SrsVideoCodecIdHEVC:
+            vs = SrsTsStreamVideoHEVC;
+            video_pid = TS_VIDEO_AVC_PID;
+            break;
         case SrsVideoCodecIdDisabled:
             vs = SrsTsStreamReserved;
             break;
@@ -312,7 +481,6 @@ srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, Sr
         case SrsVideoCodecIdOn2VP6:
         case SrsVideoCodecIdOn2VP6WithAlphaChannel:
         case SrsVideoCodecIdScreenVideoVersion2:
-        case SrsVideoCodecIdHEVC:
         case SrsVideoCodecIdAV1:
             vs = SrsTsStreamReserved;
             break;
@@ -373,11 +541,31 @@ void SrsTsContext::set_sync_byte(int8_t sb)
     sync_byte = sb;
 }
 
+void SrsTsContext::set_offload(bool v)
+{
+    offload = v;
+}
+
+void SrsTsContext::set_pcr_interval(int64_t v)
+{
+    pcr_interval = v;
+}
+
+int64_t SrsTsContext::es_bytes()
+{
+    return nb_es_bytes;
+}
+
+int64_t SrsTsContext::ts_bytes()
+{
+    return nb_ts_bytes;
+}
+
 srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as)
 {
     srs_error_t err = srs_success;
     
-    if (vs != SrsTsStreamVideoH264 && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
+    if (vs != SrsTsStreamVideoH264 && vs != SrsTsStreamVideoHEVC && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
         return srs_error_new(ERROR_HLS_NO_STREAM, "ts: no PID, vs=%d, as=%d", vs, as);
     }
     
@@ -430,10 +618,28 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
     
     // When PAT and PMT are writen, the context is ready now.
     ready = true;
+    nb_ts_bytes += 2 * SRS_TS_PACKET_SIZE;
 
     return err;
 }
 
+// Encode the 33bits dts or pts of PES, return the position after it.
+static uint8_t* srs_ts_encode_33bits(uint8_t* p, uint8_t fb, int64_t v)
+{
+    int32_t val = int32_t(fb << 4 | (((v >> 30) & 0x07) << 1) | 1);
+    *p++ = (uint8_t)val;
+    
+    val = int32_t((((v >> 15) & 0x7fff) << 1) | 1);
+    *p++ = (uint8_t)(val >> 8);
+    *p++ = (uint8_t)val;
+    
+    val = int32_t((((v) & 0x7fff) << 1) | 1);
+    *p++ = (uint8_t)(val >> 8);
+    *p++ = (uint8_t)val;
+    
+    return p;
+}
+
 srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
 {
     srs_error_t err = srs_success;
@@ -447,7 +653,7 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
         return err;
     }
     
-    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamVideoHEVC && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
         srs_info("ts: ignore the unknown stream, sid=%d", sid);
         return err;
     }
@@ -455,83 +661,243 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
     SrsTsChannel* channel = get(pid);
     srs_assert(channel);
     
-    char* start = msg->payload->bytes();
-    char* end = start + msg->payload->length();
-    char* p = start;
+    if (!pes_buf) {
+        pes_buf = new char[SRS_TS_PES_BATCH * SRS_TS_PACKET_SIZE];
+    }
+    
+    // write pcr according to message.
+    bool write_pcr = msg->write_pcr;
     
-    while (p < end) {
-        SrsTsPacket* pkt = NULL;
-        if (p == start) {
-            // write pcr according to message.
-            bool write_pcr = msg->write_pcr;
-            
-            // for pure audio, always write pcr.
-            // TODO: FIXME: maybe only need to write at begin and end of ts.
-            if (pure_audio && msg->is_audio()) {
-                write_pcr = true;
+    // The PCR PID is the video, or the audio for pure audio, @see SrsTsPacket::create_pmt
+    bool pcr_pid = pure_audio? msg->is_audio() : msg->is_video();
+    
+    // for pure audio, always write pcr, except the interval is specified.
+    if (pcr_pid && pure_audio && !pcr_interval) {
+        write_pcr = true;
+    }
+    
+    // write pcr in the PES of PCR PID by interval, and the first one of segment.
+    if (pcr_pid && pcr_interval > 0 && (last_pcr < 0 || msg->dts - last_pcr >= pcr_interval)) {
+        write_pcr = true;
+    }
+    
+    if (write_pcr) {
+        last_pcr = msg->dts;
+    }
+    
+    // it's ok to set pcr equals to dts,
+    // @see https://github.com/ossrs/srs/issues/311
+    // Fig. 3.18. Program Clock Reference of Digital-Video-and-Audio-Broadcasting-Technology, page 65
+    // In MPEG-2, these are the "Program Clock Refer- ence" (PCR) values which are
+    // nothing else than an up-to-date copy of the STC counter fed into the transport
+    // stream at a certain time. The data stream thus carries an accurate internal
+    // "clock time". All coding and de- coding processes are controlled by this clock
+    // time. To do this, the receiver, i.e. the MPEG decoder, must read out the
+    // "clock time", namely the PCR values, and compare them with its own internal
+    // system clock, that is to say its own 42 bit counter.
+    int64_t pcr = write_pcr? msg->dts : -1;
+    
+    // check sync, the diff of dts and pts should never greater than 1s.
+    if (msg->dts != msg->pts && (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000)) {
+        srs_warn("ts: sync dts=%" PRId64 ", pts=%" PRId64, msg->dts, msg->pts);
+    }
+    
+    SrsTsPesEncoder encoder;
+    encoder.initialize(msg, sync_byte, pid, pcr, channel->continuity_counter);
+    nb_es_bytes += msg->payload->length();
+    
+    // Packetize the PES by the io thread, which takes the payload.
+    SrsFileWriter* fw = offload? dynamic_cast<SrsFileWriter*>(writer) : NULL;
+    if (fw && fw->can_produce()) {
+        int nb_packets = encoder.count();
+        channel->continuity_counter += (uint8_t)nb_packets;
+        nb_ts_bytes += nb_packets * SRS_TS_PACKET_SIZE;
+        
+        SrsTsPesProducer* producer = new SrsTsPesProducer(msg, &encoder);
+        if ((err = fw->write_produce(producer, nb_packets * SRS_TS_PACKET_SIZE)) != srs_success) {
+            return srs_error_wrap(err, "ts: produce packets");
+        }
+        return err;
+    }
+    
+    int nb_packets = 0;
+    while (!encoder.eof()) {
+        encoder.encode((uint8_t*)pes_buf + nb_packets * SRS_TS_PACKET_SIZE);
+        nb_ts_bytes += SRS_TS_PACKET_SIZE;
+        
+        // Write the packets in batch.
+        if (++nb_packets == SRS_TS_PES_BATCH || encoder.eof()) {
+            if ((err = writer->write(pes_buf, nb_packets * SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
+                return srs_error_wrap(err, "ts: write packet");
             }
-            
-            // it's ok to set pcr equals to dts,
-            // @see https://github.com/ossrs/srs/issues/311
-            // Fig. 3.18. Program Clock Reference of Digital-Video-and-Audio-Broadcasting-Technology, page 65
-            // In MPEG-2, these are the "Program Clock Refer- ence" (PCR) values which are
-            // nothing else than an up-to-date copy of the STC counter fed into the transport
-            // stream at a certain time. The data stream thus carries an accurate internal
-            // "clock time". All coding and de- coding processes are controlled by this clock
-            // time. To do this, the receiver, i.e. the MPEG decoder, must read out the
-            // "clock time", namely the PCR values, and compare them with its own internal
-            // system clock, that is to say its own 42 bit counter.
-            int64_t pcr = write_pcr? msg->dts : -1;
-            
+            nb_packets = 0;
+        }
+    }
+    channel->continuity_counter = encoder.continuity_counter();
+    
+    return err;
+}
+
+SrsTsPesEncoder::SrsTsPesEncoder()
+{
+    start = end = p = NULL;
+    sync_byte = 0x47;
+    pid = 0;
+    sid = SrsTsPESStreamIdProgramStreamMap;
+    dts = pts = 0;
+    pcr = -1;
+    discontinuity = false;
+    cc = 0;
+}
+
+SrsTsPesEncoder::~SrsTsPesEncoder()
+{
+}
+
+void SrsTsPesEncoder::initialize(SrsTsMessage* msg, int8_t sb, int16_t pid, int64_t pcr, uint8_t cc)
+{
+    start = p = msg->payload->bytes();
+    end = start + msg->payload->length();
+    
+    sync_byte = sb;
+    this->pid = pid;
+    sid = msg->sid;
+    dts = msg->dts;
+    pts = msg->pts;
+    this->pcr = pcr;
+    discontinuity = msg->is_discontinuity;
+    this->cc = cc;
+}
+
+bool SrsTsPesEncoder::eof()
+{
+    return p >= end;
+}
+
+int SrsTsPesEncoder::count()
+{
+    SrsTsPesEncoder copy = *this;
+    
+    int nn = 0;
+    while (!copy.eof()) {
+        copy.encode(NULL);
+        nn++;
+    }
+    
+    return nn;
+}
+
+void SrsTsPesEncoder::encode(uint8_t* q)
+{
+    bool first = (p == start);
+    
+    // The PES header is 9B with 5B PTS, or 10B PTS and DTS, and the adaptation field of PCR is 8B.
+    int nb_pes_header = first? (dts == pts? 14 : 19) : 0;
+    int nb_af = (first && pcr >= 0)? 8 : 0;
+    int nb_payload = srs_min((int)(end - p), SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes_header);
+    
+    // Padding the adaptation field with stuffings, which is at least 2B when created for stuffings.
+    int nb_stuffings = SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes_header - nb_payload;
+    if (nb_stuffings > 0) {
+        nb_af = nb_af? nb_af + nb_stuffings : srs_max(2, nb_stuffings);
+        nb_payload = SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes_header;
+    }
+    
+    // Only count the packet.
+    if (!q) {
+        p += nb_payload;
+        cc++;
+        return;
+    }
+    
+    // 4B ts packet header.
+    *q++ = (uint8_t)sync_byte;
+    *q++ = (first? 0x40 : 0x00) | ((pid >> 8) & 0x1F);
+    *q++ = (uint8_t)pid;
+    *q++ = (nb_af? 0x30 : 0x10) | (cc++ & 0x0F);
+    
+    // optional: adaptation field.
+    if (nb_af) {
+        *q++ = (uint8_t)(nb_af - 1);
+        
+        int nb_af_stuffings = nb_af - 2;
+        if (first && pcr >= 0) {
             // TODO: FIXME: finger it why use discontinuity of msg.
-            pkt = SrsTsPacket::create_pes_first(this,
-                pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
-                pcr, msg->dts, msg->pts, msg->payload->length()
-            );
+            *q++ = (discontinuity? 0x80 : 0x00) | 0x10;
+            
+            // @remark, use pcr base and ignore the extension
+            // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
+            int64_t pcrv = (0x3F << 9) & 0x7E00;
+            pcrv |= (pcr << 15) & 0xFFFFFFFF8000LL;
+            for (int i = 5; i >= 0; i--) {
+                *q++ = (uint8_t)(pcrv >> (8 * i));
+            }
+            nb_af_stuffings -= 6;
         } else {
-            pkt = SrsTsPacket::create_pes_continue(this, pid, msg->sid, channel->continuity_counter++);
+            *q++ = 0x00;
         }
-        SrsAutoFree(SrsTsPacket, pkt);
         
-        pkt->sync_byte = sync_byte;
+        memset(q, 0xFF, nb_af_stuffings);
+        q += nb_af_stuffings;
+    }
+    
+    // optional: PES header, for the first packet.
+    if (first) {
+        *q++ = 0x00;
+        *q++ = 0x00;
+        *q++ = 0x01;
+        *q++ = (uint8_t)sid;
         
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
+        // the PES_packet_length is the actual bytes size, the pplv write to ts
+        // is the actual bytes plus the header size.
+        int size = (int)(end - start);
+        int nb_header_data = nb_pes_header - 9;
+        int pplv = (size > 0xFFFF)? 0 : size + 3 + nb_header_data;
+        pplv = (pplv > 0xFFFF)? 0 : pplv;
+        *q++ = (uint8_t)(pplv >> 8);
+        *q++ = (uint8_t)pplv;
         
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
+        *q++ = 0x80;
+        *q++ = (dts == pts)? 0x80 : 0xC0;
+        *q++ = (uint8_t)nb_header_data;
         
-        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-        if (nb_stuffings > 0) {
-            // set all bytes to stuffings.
-            memset(buf, 0xFF, SRS_TS_PACKET_SIZE);
-            
-            // padding with stuffings.
-            pkt->padding(nb_stuffings);
-            
-            // size changed, recalc it.
-            nb_buf = pkt->size();
-            srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-            
-            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-            nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-            srs_assert(nb_stuffings == 0);
-        }
-        memcpy(buf + nb_buf, p, left);
-        p += left;
-        
-        SrsBuffer stream(buf, nb_buf);
-        if ((err = pkt->encode(&stream)) != srs_success) {
-            return srs_error_wrap(err, "ts: encode packet");
-        }
-        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
-            return srs_error_wrap(err, "ts: write packet");
+        if (dts == pts) {
+            q = srs_ts_encode_33bits(q, 0x02, pts);
+        } else {
+            q = srs_ts_encode_33bits(q, 0x03, pts);
+            q = srs_ts_encode_33bits(q, 0x01, dts);
         }
     }
     
-    return err;
+    memcpy(q, p, nb_payload);
+    p += nb_payload;
+}
+
+uint8_t SrsTsPesEncoder::continuity_counter()
+{
+    return cc;
+}
+
+SrsTsPesProducer::SrsTsPesProducer(SrsTsMessage* msg, SrsTsPesEncoder* e)
+{
+    // The bytes of payload are not moved, so the encoder is still valid.
+    payload = msg->payload;
+    msg->payload = new SrsSimpleStream();
+    encoder = *e;
+}
+
+SrsTsPesProducer::~SrsTsPesProducer()
+{
+    srs_freep(payload);
+}
+
+void SrsTsPesProducer::produce(char* buf, int size)
+{
+    char* p = buf;
+    while (!encoder.eof() && p + SRS_TS_PACKET_SIZE <= buf + size) {
+        encoder.encode((uint8_t*)p);
+        p += SRS_TS_PACKET_SIZE;
+    }
 }
 
 SrsTsPacket::SrsTsPacket(SrsTsContext* c)
@@ -562,6 +928,10 @@ srs_error_t SrsTsPacket::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
     
     int pos = stream->pos();
     
+    // The packet is reused by context, so reset the optional fields.
+    srs_freep(adaptation_field);
+    srs_freep(payload);
+    
     // 4B ts packet header.
     if (!stream->require(4)) {
         return srs_error_new(ERROR_STREAM_CASTER_TS_HEADER, "ts: decode packet");
@@ -652,18 +1022,20 @@ srs_error_t SrsTsPacket::encode(SrsBuffer* stream)
         return srs_error_new(ERROR_STREAM_CASTER_TS_HEADER, "ts: requires 4+ bytes");
     }
     
-    stream->write_1bytes(sync_byte);
+    char* p = stream->head();
+    srs_write_be<int8_t>(p, sync_byte);
     
     int16_t pidv = pid & 0x1FFF;
     pidv |= (transport_priority << 13) & 0x2000;
     pidv |= (transport_error_indicator << 15) & 0x8000;
     pidv |= (payload_unit_start_indicator << 14) & 0x4000;
-    stream->write_2bytes(pidv);
+    srs_write_be<int16_t>(p, pidv);
     
     int8_t ccv = continuity_counter & 0x0F;
     ccv |= (transport_scrambling_control << 6) & 0xC0;
     ccv |= (adaption_field_control << 4) & 0x30;
-    stream->write_1bytes(ccv);
+    srs_write_be<int8_t>(p, ccv);
+    stream->skip(4);
     
     srs_info("ts: header sync=%#x error=%d unit_start=%d priotiry=%d pid=%d scrambling=%d adaption=%d counter=%d",
              sync_byte, transport_error_indicator, payload_unit_start_indicator, transport_priority, pid,
@@ -773,7 +1145,7 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context,
     pmt->last_section_number = 0;
     
     // must got one valid codec.
-    srs_assert(vs == SrsTsStreamVideoH264 || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
+    srs_assert(vs == SrsTsStreamVideoH264 || vs == SrsTsStreamVideoHEVC || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
     
     // if mp3 or aac specified, use audio to carry pcr.
     if (as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3) {
@@ -783,8 +1155,8 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context,
         pmt->infos.push_back(new SrsTsPayloadPMTESInfo(as, apid));
     }
     
-    // if h.264 specified, use video to carry pcr.
-    if (vs == SrsTsStreamVideoH264) {
+    // if h.264 or h.265 specified, use video to carry pcr.
+    if (vs == SrsTsStreamVideoH264 || vs == SrsTsStreamVideoHEVC) {
         pmt->PCR_PID = vpid;
         pmt->infos.push_back(new SrsTsPayloadPMTESInfo(vs, vpid));
     }
@@ -1158,8 +1530,7 @@ srs_error_t SrsTsAdaptationField::encode(SrsBuffer* stream)
             return srs_error_new(ERROR_STREAM_CASTER_TS_AF, "ts: mux af PCR_flag");
         }
         
-        char* pp = NULL;
-        char* p = stream->data() + stream->pos();
+        char* p = stream->head();
         stream->skip(6);
         
         // @remark, use pcr base and ignore the extension
@@ -1168,13 +1539,9 @@ srs_error_t SrsTsAdaptationField::encode(SrsBuffer* stream)
         pcrv |= (const1_value0 << 9) & 0x7E00;
         pcrv |= (program_clock_reference_base << 15) & 0xFFFFFFFF8000LL;
         
-        pp = (char*)&pcrv;
-        *p++ = pp[5];
-        *p++ = pp[4];
-        *p++ = pp[3];
-        *p++ = pp[2];
-        *p++ = pp[1];
-        *p++ = pp[0];
+        // 6B, the high 4B and low 2B.
+        srs_write_be<uint32_t>(p, (uint32_t)(pcrv >> 16));
+        srs_write_be<uint16_t>(p, (uint16_t)pcrv);
     }
     
     if (OPCR_flag) {
@@ -1294,7 +1661,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
     // init msg.
     SrsTsMessage* msg = channel->msg;
     if (!msg) {
-        msg = new SrsTsMessage(channel, packet);
+        msg = channel->create_msg(packet);
         channel->msg = msg;
     }
     
@@ -1318,7 +1685,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
         
         // reparse current msg.
         stream->skip(stream->pos() * -1);
-        srs_freep(msg);
+        channel->recycle(msg);
         channel->msg = NULL;
         return err;
     }
@@ -1339,7 +1706,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
             
             // reparse current msg.
             stream->skip(stream->pos() * -1);
-            srs_freep(msg);
+            channel->recycle(msg);
             channel->msg = NULL;
             return err;
         }
@@ -1741,15 +2108,23 @@ srs_error_t SrsTsPayloadPES::encode(SrsBuffer* stream)
 {
     srs_error_t err = srs_success;
     
-    // 6B fixed header.
-    if (!stream->require(6)) {
+    // check the packet start prefix.
+    packet_start_code_prefix &= 0xFFFFFF;
+    if (packet_start_code_prefix != 0x01) {
+        return srs_error_new(ERROR_STREAM_CASTER_TS_PSE, "ts: mux PSE start code failed, expect=0x01, actual=%#x", packet_start_code_prefix);
+    }
+    
+    // 6B fixed header and 3B flags, written as a block.
+    if (!stream->require(9)) {
         return srs_error_new(ERROR_STREAM_CASTER_TS_PSE, "ts: mux PSE");
     }
+    char* p = stream->head();
+    stream->skip(9);
     
     // 3B
-    stream->write_3bytes(packet_start_code_prefix);
+    srs_write_be24(p, packet_start_code_prefix);
     // 1B
-    stream->write_1bytes(stream_id);
+    srs_write_be<int8_t>(p, stream_id);
     // 2B
     // the PES_packet_length is the actual bytes size, the pplv write to ts
     // is the actual bytes plus the header size.
@@ -1758,18 +2133,8 @@ srs_error_t SrsTsPayloadPES::encode(SrsBuffer* stream)
         pplv = PES_packet_length + 3 + PES_header_data_length;
         pplv = (pplv > 0xFFFF)? 0 : pplv;
     }
-    stream->write_2bytes(pplv);
+    srs_write_be<uint16_t>(p, pplv);
     
-    // check the packet start prefix.
-    packet_start_code_prefix &= 0xFFFFFF;
-    if (packet_start_code_prefix != 0x01) {
-        return srs_error_new(ERROR_STREAM_CASTER_TS_PSE, "ts: mux PSE start code failed, expect=0x01, actual=%#x", packet_start_code_prefix);
-    }
-    
-    // 3B flags.
-    if (!stream->require(3)) {
-        return srs_error_new(ERROR_STREAM_CASTER_TS_PSE, "ts: mux PSE flags");
-    }
     // 1B
     int8_t oocv = original_or_copy & 0x01;
     oocv |= (const2bits << 6) & 0xC0;
@@ -1777,7 +2142,7 @@ srs_error_t SrsTsPayloadPES::encode(SrsBuffer* stream)
     oocv |= (PES_priority << 3) & 0x08;
     oocv |= (data_alignment_indicator << 2) & 0x04;
     oocv |= (copyright << 1) & 0x02;
-    stream->write_1bytes(oocv);
+    srs_write_be<int8_t>(p, oocv);
     // 1B
     int8_t pefv = PES_extension_flag & 0x01;
     pefv |= (PTS_DTS_flags << 6) & 0xC0;
@@ -1786,9 +2151,9 @@ srs_error_t SrsTsPayloadPES::encode(SrsBuffer* stream)
     pefv |= (DSM_trick_mode_flag << 3) & 0x08;
     pefv |= (additional_copy_info_flag << 2) & 0x04;
     pefv |= (PES_CRC_flag << 1) & 0x02;
-    stream->write_1bytes(pefv);
+    srs_write_be<int8_t>(p, pefv);
     // 1B
-    stream->write_1bytes(PES_header_data_length);
+    srs_write_be<uint8_t>(p, PES_header_data_length);
     
     // check required together.
     int nb_required = 0;
@@ -2238,8 +2603,10 @@ srs_error_t SrsTsPayloadPAT::psi_decode(SrsBuffer* stream)
             return srs_error_wrap(err, "demux PAT program");
         }
         
-        // update the apply pid table.
-        packet->context->set(program->pid, SrsTsPidApplyPMT);
+        // update the apply pid table, the program 0 is the network PID, not PMT.
+        if (program->number != 0) {
+            packet->context->set(program->pid, SrsTsPidApplyPMT, SrsTsStreamReserved, program->number);
+        }
         
         programs.push_back(program);
     }
@@ -2460,14 +2827,15 @@ srs_error_t SrsTsPayloadPMT::psi_decode(SrsBuffer* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type, program_number);
                 break;
             case SrsTsStreamAudioAAC:
             case SrsTsStreamAudioAC3:
             case SrsTsStreamAudioDTS:
             case SrsTsStreamAudioMp3:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type, program_number);
                 break;
             default:
                 srs_warn("ts: drop pid=%#x, stream=%#x", info->elementary_PID, info->stream_type);
@@ -2476,7 +2844,7 @@ srs_error_t SrsTsPayloadPMT::psi_decode(SrsBuffer* stream)
     }
     
     // update the apply pid table.
-    packet->context->set(packet->pid, SrsTsPidApplyPMT);
+    packet->context->set(packet->pid, SrsTsPidApplyPMT, SrsTsStreamReserved, program_number);
     
     return err;
 }
@@ -2543,6 +2911,7 @@ srs_error_t SrsTsPayloadPMT::psi_encode(SrsBuffer* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
                 packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
                 break;
@@ -2612,94 +2981,132 @@ SrsVideoCodecId SrsTsContextWriter::video_codec()
     return vcodec;
 }
 
+void SrsTsContextWriter::set_video_codec(SrsVideoCodecId v)
+{
+    vcodec = v;
+}
+
 SrsEncFileWriter::SrsEncFileWriter()
 {
-    memset(iv,0,16);
-    
-    buf = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-    memset(buf, 0, HLS_AES_ENCRYPT_BLOCK_LENGTH);
+    // Reserve the space for padding.
+    buf = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH + 16];
+    memset(buf, 0, HLS_AES_ENCRYPT_BLOCK_LENGTH + 16);
     
     nb_buf = 0;
-    key = (unsigned char*)new AES_KEY();
+    ctx = EVP_CIPHER_CTX_new();
+    offload = offloaded = false;
 }
 
 SrsEncFileWriter::~SrsEncFileWriter()
 {
+    // Close to flush the padding and wait for the io thread, which uses the ctx.
+    close();
+
     srs_freepa(buf);
     
-    AES_KEY* k = (AES_KEY*)key;
-    srs_freep(k);
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    EVP_CIPHER_CTX_free(c);
 }
 
 srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
     
-    srs_assert(count == SRS_TS_PACKET_SIZE);
-
-    if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        memcpy(buf + nb_buf, (char*)data, SRS_TS_PACKET_SIZE);
-        nb_buf += SRS_TS_PACKET_SIZE;
-    }
+    // The PES is written in batch of ts packets.
+    srs_assert((count % SRS_TS_PACKET_SIZE) == 0);
     
-    if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        nb_buf = 0;
+    char* p = (char*)data;
+    for (size_t i = 0; i < count; i += SRS_TS_PACKET_SIZE) {
+        memcpy(buf + nb_buf, p + i, SRS_TS_PACKET_SIZE);
+        nb_buf += SRS_TS_PACKET_SIZE;
         
-        char* cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-        SrsAutoFreeA(char, cipher);
+        if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
+            continue;
+        }
+        nb_buf = 0;
         
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
+        // Encrypt in place, or by the io thread when offloaded.
+        if (!offloaded && filter(buf, HLS_AES_ENCRYPT_BLOCK_LENGTH) != 0) {
+            return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "aes encrypt");
+        }
         
-        if ((err = SrsFileWriter::write(cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
+        if ((err = SrsFileWriter::write(buf, HLS_AES_ENCRYPT_BLOCK_LENGTH, NULL)) != srs_success) {
             return srs_error_wrap(err, "write cipher");
         }
     }
     
+    // Always consume the ts packet, even it's cached.
+    if (pnwrite) {
+        *pnwrite = count;
+    }
+    
     return err;
 }
 
+bool SrsEncFileWriter::can_produce()
+{
+    // The ts packets are cached to encrypt in block, so it's never produced by io thread.
+    return false;
+}
+
 srs_error_t SrsEncFileWriter::config_cipher(unsigned char* key, unsigned char* iv)
 {
     srs_error_t err = srs_success;
     
-    memcpy(this->iv, iv, 16);
-  
-    AES_KEY* k = (AES_KEY*)this->key;
-    if (AES_set_encrypt_key(key, 16 * 8, k)) {
+    // The padding is done by ourself, because the data is encrypted in blocks, maybe in another thread.
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    if (EVP_EncryptInit_ex(c, EVP_aes_128_cbc(), NULL, key, iv) != 1) {
         return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "set aes key failed");
     }
+    EVP_CIPHER_CTX_set_padding(c, 0);
+    
+    // Encrypt in the io thread, if the writer is async.
+    offloaded = SrsFileWriter::set_filter(offload? this : NULL) && offload;
     
     return err;
 }
 
+void SrsEncFileWriter::set_offload(bool v)
+{
+    offload = v;
+}
+
+int SrsEncFileWriter::filter(char* buf, int size)
+{
+    int nn = 0;
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    if (EVP_EncryptUpdate(c, (unsigned char*)buf, &nn, (unsigned char*)buf, size) != 1 || nn != size) {
+        return EIO;
+    }
+    return 0;
+}
+
 void SrsEncFileWriter::close()
 {
-    if(nb_buf > 0) {
+    if (nb_buf > 0 && is_open()) {
         int nb_padding = 16 - (nb_buf % 16);
         if (nb_padding > 0) {
             memset(buf + nb_buf, nb_padding, nb_padding);
         }
         
-        char* cipher = new char[nb_buf + nb_padding];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, nb_buf + nb_padding, k, iv, AES_ENCRYPT);
-        
         srs_error_t err = srs_success;
-        if ((err = SrsFileWriter::write(cipher, nb_buf + nb_padding, NULL)) != srs_success) {
+        if (!offloaded && filter(buf, nb_buf + nb_padding) != 0) {
+            err = srs_error_new(ERROR_SYSTEM_FILE_WRITE, "aes encrypt");
+        }
+        if (err == srs_success) {
+            err = SrsFileWriter::write(buf, nb_buf + nb_padding, NULL);
+        }
+        if (err != srs_success) {
             srs_warn("ignore err %s", srs_error_desc(err).c_str());
             srs_error_reset(err);
         }
-
-        nb_buf = 0;
     }
+    nb_buf = 0;
     
     SrsFileWriter::close();
 }
 
-SrsTsMessageCache::SrsTsMessageCache()
+SrsTsMessageCache::SrsTsMessageCache() : memory(SrsMemoryHlsCache)
 {
     audio = NULL;
     video = NULL;
@@ -2741,6 +3148,7 @@ srs_error_t SrsTsMessageCache::cache_audio(SrsAudioFrame* frame, int64_t dts)
             return srs_error_wrap(err, "ts: cache mp3");
         }
     }
+    update_memory();
     
     return err;
 }
@@ -2764,10 +3172,28 @@ srs_error_t SrsTsMessageCache::cache_video(SrsVideoFrame* frame, int64_t dts)
     if ((err = do_cache_avc(frame)) != srs_success) {
         return srs_error_wrap(err, "ts: cache avc");
     }
+    update_memory();
     
     return err;
 }
 
+void SrsTsMessageCache::set_memory(SrsMemoryStat* v)
+{
+    memory.set_stat(v);
+}
+
+void SrsTsMessageCache::update_memory()
+{
+    int64_t nb_bytes = 0;
+    if (audio) {
+        nb_bytes += audio->payload->length();
+    }
+    if (video) {
+        nb_bytes += video->payload->length();
+    }
+    memory.update(nb_bytes);
+}
+
 srs_error_t SrsTsMessageCache::do_cache_mp3(SrsAudioFrame* frame)
 {
     srs_error_t err = srs_success;
@@ -2947,13 +3373,22 @@ srs_error_t SrsTsMessageCache::do_cache_avc(SrsVideoFrame* frame)
         //      9, SI (SI slice)
         // ISO_IEC_14496-10-AVC-2012.pdf, page 105.
         static uint8_t default_aud_nalu[] = { 0x09, 0xf0};
+        // For HEVC, the 2B NALU header of AUD(35), then pic_type 2 for I, P and B slices, with the stop bit.
+        // 7.3.2.5 Access unit delimiter RBSP syntax, T-REC-H.265-201802-S!!PDF-E.pdf, page 40.
+        static uint8_t default_hevc_aud_nalu[] = { 0x46, 0x01, 0x50 };
         srs_avc_insert_aud(video->payload, aud_inserted);
-        video->payload->append((const char*)default_aud_nalu, 2);
+        if (frame->vcodec() && frame->vcodec()->id == SrsVideoCodecIdHEVC) {
+            video->payload->append((const char*)default_hevc_aud_nalu, 3);
+        } else {
+            video->payload->append((const char*)default_aud_nalu, 2);
+        }
     }
     
     SrsVideoCodecConfig* codec = frame->vcodec();
     srs_assert(codec);
     
+    bool hevc = (codec->id == SrsVideoCodecIdHEVC);
+    
     bool is_sps_pps_appended = false;
     
     // all sample use cont nalu header, except the sps-pps before IDR frame.
@@ -2967,11 +3402,22 @@ srs_error_t SrsTsMessageCache::do_cache_avc(SrsVideoFrame* frame)
         
         // 5bits, 7.3.1 NAL unit syntax,
         // ISO_IEC_14496-10-AVC-2012.pdf, page 83.
-        SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(sample->bytes[0] & 0x1f);
+        // For HEVC, the IRAP is the IDR, 7.4.2.2 NAL unit header semantics, T-REC-H.265-201802-S!!PDF-E.pdf, page 85.
+        bool is_idr = false;
+        if (hevc) {
+            SrsHevcNaluType nal_unit_type = SrsHevcNaluTypeParse(sample->bytes[0]);
+            is_idr = nal_unit_type >= SrsHevcNaluTypeCodedSliceBlaWlp && nal_unit_type <= SrsHevcNaluTypeReservedIrap23;
+        } else {
+            is_idr = (SrsAvcNaluType)(sample->bytes[0] & 0x1f) == SrsAvcNaluTypeIDR;
+        }
         
         // Insert sps/pps before IDR when there is no sps/pps in samples.
         // The sps/pps is parsed from sequence header(generally the first flv packet).
-        if (nal_unit_type == SrsAvcNaluTypeIDR && !frame->has_sps_pps && !is_sps_pps_appended) {
+        if (is_idr && !frame->has_sps_pps && !is_sps_pps_appended) {
+            if (hevc && !codec->videoParameterSetNALUnit.empty()) {
+                srs_avc_insert_aud(video->payload, aud_inserted);
+                video->payload->append(&codec->videoParameterSetNALUnit[0], (int)codec->videoParameterSetNALUnit.size());
+            }
             if (!codec->sequenceParameterSetNALUnit.empty()) {
                 srs_avc_insert_aud(video->payload, aud_inserted);
                 video->payload->append(&codec->sequenceParameterSetNALUnit[0], (int)codec->sequenceParameterSetNALUnit.size());
@@ -3078,7 +3524,7 @@ srs_error_t SrsTsTransmuxer::write_video(int64_t timestamp, char* data, int size
         return err;
     }
     
-    if (format->vcodec->id != SrsVideoCodecIdAVC) {
+    if (format->vcodec->id != SrsVideoCodecIdAVC && format->vcodec->id != SrsVideoCodecIdHEVC) {
         return err;
     }
     
@@ -3087,6 +3533,9 @@ srs_error_t SrsTsTransmuxer::write_video(int64_t timestamp, char* data, int size
         return err;
     }
     
+    // The PAT/PMT is written again when codec changed.
+    tscw->set_video_codec(format->vcodec->id);
+    
     int64_t dts = timestamp * 90;
     
     // write video to cache.
@@ -3097,6 +3546,11 @@ srs_error_t SrsTsTransmuxer::write_video(int64_t timestamp, char* data, int size
     return flush_video();
 }
 
+void SrsTsTransmuxer::reset()
+{
+    context->reset();
+}
+
 srs_error_t SrsTsTransmuxer::flush_audio()
 {
     srs_error_t err = srs_success;
@@ -3107,6 +3561,7 @@ srs_error_t SrsTsTransmuxer::flush_audio()
     
     // write success, clear and free the ts message.
     srs_freep(tsmc->audio);
+    tsmc->update_memory();
     
     return err;
 }
@@ -3121,6 +3576,7 @@ srs_error_t SrsTsTransmuxer::flush_video()
     
     // write success, clear and free the ts message.
     srs_freep(tsmc->video);
+    tsmc->update_memory();
     
     return err;
 }
@@ -32,6 +32,7 @@
 #include <map>
 #include <vector>
 
+#include <srs_core_mem_watch.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
 
@@ -51,6 +52,12 @@ class SrsTsContext;
 // Transport Stream packets are 188 bytes in length.
 #define SRS_TS_PACKET_SIZE          188
 
+// The pid of PMT, which is written after PAT when ts starts.
+#define TS_PMT_PID 0x1001
+
+// The max ts packets of PES to write in a batch.
+#define SRS_TS_PES_BATCH 256
+
 // The aggregate pure audio for hls, in ts tbn(ms * 90).
 #define SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE 720 * 90
 
@@ -149,6 +156,8 @@ enum SrsTsStream
     // ITU-T Rec. H.222.0 | ISO/IEC 13818-1 Reserved
     // 0x15-0x7F
     SrsTsStreamVideoH264 = 0x1b,
+    // ITU-T Rec. H.265 | ISO/IEC 23008-2 HEVC
+    SrsTsStreamVideoHEVC = 0x24,
     // User Private
     // 0x80-0xFF
     SrsTsStreamAudioAC3 = 0x81,
@@ -156,19 +165,37 @@ enum SrsTsStream
 };
 std::string srs_ts_stream2string(SrsTsStream stream);
 
+// Get the program_clock_reference_base in 90kHz of a ts packet, which is SRS_TS_PACKET_SIZE bytes.
+// @return The PCR base, or -1 if no PCR in the adaptation field.
+extern int64_t srs_ts_packet_pcr(const char* p);
+// Get the DTS in 90kHz of the PES starts in a ts packet, the PTS if no DTS.
+// @return The DTS, or -1 if not the start of PES, or no timestamp.
+extern int64_t srs_ts_packet_dts(const char* p);
+
 // The ts channel.
 struct SrsTsChannel
 {
     int pid;
     SrsTsPidApply apply;
     SrsTsStream stream;
+    // The program_number of PMT, which the PID belongs to, 0 if unknown.
+    // @remark For MPTS, there are multiple programs in PAT, each has its own PMT and ES.
+    int program;
     SrsTsMessage* msg;
     SrsTsContext* context;
     // for encoder.
     uint8_t continuity_counter;
+    // For decoder, the message which is handled, to reuse for the next PES,
+    // so the payload keeps its capacity and never grows again.
+    SrsTsMessage* spare;
     
     SrsTsChannel();
     virtual ~SrsTsChannel();
+    
+    // Create the message for a fresh PES, reuse the spare one if possible.
+    virtual SrsTsMessage* create_msg(SrsTsPacket* p);
+    // Recycle the message when it's handled or dropped.
+    virtual void recycle(SrsTsMessage* m);
 };
 
 // The stream_id of PES payload of ts packet.
@@ -277,6 +304,8 @@ public:
     virtual bool completed(int8_t payload_unit_start_indicator);
     // Whether the message is fresh.
     virtual bool fresh();
+    // Reset the message to fresh, keep the capacity of payload.
+    virtual void reset(SrsTsPacket* p);
 public:
     // Whether the sid indicates the elementary stream audio.
     virtual bool is_audio();
@@ -300,7 +329,8 @@ public:
     virtual ~ISrsTsHandler();
 public:
     // When ts context got message, use handler to process it.
-    // @param msg the ts msg, user should never free it.
+    // @param msg the ts msg, user should never free or keep it, for it's reused by context,
+    //      use detach() to keep it.
     // @return an int error code.
     virtual srs_error_t on_ts_message(SrsTsMessage* msg) = 0;
 };
@@ -323,6 +353,23 @@ private:
     // when any codec changed, write the PAT/PMT.
     SrsVideoCodecId vcodec;
     SrsAudioCodecId acodec;
+    // The buffer of ts packets for PES, which are written directly without SrsTsPacket.
+    // @remark Allocated when write the first PES, for the context maybe only for decoding.
+    char* pes_buf;
+    // Whether packetize the PES in the io thread, when the writer is async file.
+    bool offload;
+    // The min interval of PCR in the PES of PCR PID in ts tbn, 0 to write PCR at keyframe only.
+    int64_t pcr_interval;
+    // The last PCR in ts tbn, -1 if not written in current segment.
+    int64_t last_pcr;
+    // The bytes of media payload, and the bytes of ts packets including the PSI, for the overhead of ts.
+    int64_t nb_es_bytes;
+    int64_t nb_ts_bytes;
+    // decoder
+private:
+    // The packet to decode, reused for each ts packet, which is also the packet of decoded messages.
+    // @remark Allocated when decode the first packet, for the context maybe only for encoding.
+    SrsTsPacket* packet;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -340,13 +387,18 @@ public:
     // @return the apply channel; NULL for invalid.
     virtual SrsTsChannel* get(int pid);
     // Set the pid apply, the parsed pid.
-    virtual void set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream = SrsTsStreamReserved);
+    // @param program The program_number of PMT, which the pid belongs to.
+    virtual void set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream = SrsTsStreamReserved, int program = 0);
     // decode methods
 public:
     // The stream contains only one ts packet.
     // @param handler the ts message handler to process the msg.
     // @remark we will consume all bytes in stream.
     virtual srs_error_t decode(SrsBuffer* stream, ISrsTsHandler* handler);
+private:
+    // Decode the continuous packet of PES in place, which is most of packets, without SrsTsPacket.
+    // @return Whether the packet is decoded, false to decode it by SrsTsPacket.
+    virtual bool decode_pes_fast(SrsBuffer* stream, SrsTsMessage** ppmsg);
     // encode methods
 public:
     // Write the PES packet, the video/audio stream.
@@ -359,11 +411,76 @@ public:
     // Set sync byte of ts segment.
     // replace the standard ts sync byte to bravo sync byte.
     virtual void set_sync_byte(int8_t sb);
+// io methods
+public:
+    // Whether packetize the PES by the io thread of file writer, which must be async and can produce.
+    // @remark The payload of message is taken by the io thread, and the message is left empty.
+    virtual void set_offload(bool v);
+// pcr and statistic methods
+public:
+    // Set the min interval of PCR in ts tbn, for the PES of PCR PID, 0 to write PCR at keyframe only.
+    // @remark For pure audio, PCR is written in every PES if 0.
+    virtual void set_pcr_interval(int64_t v);
+    // The total bytes of media payload and ts packets encoded, for the overhead of ts.
+    virtual int64_t es_bytes();
+    virtual int64_t ts_bytes();
 private:
     virtual srs_error_t encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
+    // Write the PES to ts packets in buffer, then write them to writer in batch.
     virtual srs_error_t encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
 };
 
+// The encoder to packetize a PES to ts packets, which are generated one by one, so it's able to
+// count the packets first, then generate them later, for example, in the io thread.
+// @remark It's a value object without any ST API, and the payload must be valid until encoded.
+class SrsTsPesEncoder
+{
+private:
+    char* start;
+    char* end;
+    char* p;
+private:
+    int8_t sync_byte;
+    int16_t pid;
+    SrsTsPESStreamId sid;
+    int64_t dts;
+    int64_t pts;
+    // The pcr of first packet, -1 to ignore.
+    int64_t pcr;
+    bool discontinuity;
+    // The continuity counter of next packet.
+    uint8_t cc;
+public:
+    SrsTsPesEncoder();
+    virtual ~SrsTsPesEncoder();
+public:
+    // Initialize the encoder for msg, which is the payload of pid.
+    virtual void initialize(SrsTsMessage* msg, int8_t sb, int16_t pid, int64_t pcr, uint8_t cc);
+    // Whether all packets are encoded.
+    virtual bool eof();
+    // The number of packets left to encode.
+    virtual int count();
+    // Encode the next packet to q, which is SRS_TS_PACKET_SIZE bytes, or skip it if q is NULL.
+    virtual void encode(uint8_t* q);
+    // The continuity counter of next packet.
+    virtual uint8_t continuity_counter();
+};
+
+// The producer to packetize a PES by the io thread, which owns the payload of message.
+class SrsTsPesProducer : public ISrsFileProducer
+{
+private:
+    SrsSimpleStream* payload;
+    SrsTsPesEncoder encoder;
+public:
+    // Take the payload of msg, which is left empty, the encoder must be initialized by msg.
+    SrsTsPesProducer(SrsTsMessage* msg, SrsTsPesEncoder* e);
+    virtual ~SrsTsPesProducer();
+// Interface ISrsFileProducer
+public:
+    virtual void produce(char* buf, int size);
+};
+
 // The packet in ts stream,
 // 2.4.3.2 Transport Stream packet layer, hls-mpeg-ts-iso13818-1.pdf, page 36
 // Transport Stream packets shall be 188 bytes long.
@@ -1278,10 +1395,13 @@ public:
 public:
     // get the video codec of ts muxer.
     virtual SrsVideoCodecId video_codec();
+    // Set the video codec, the PAT/PMT is written when changed.
+    virtual void set_video_codec(SrsVideoCodecId v);
 };
 
-// Used for HLS Encryption
-class SrsEncFileWriter: public SrsFileWriter
+// Used for HLS Encryption, by AES-128-CBC with PKCS7 padding.
+// @remark The EVP of openssl uses the AES-NI or ARMv8-CE if available.
+class SrsEncFileWriter: public SrsFileWriter, public ISrsFileFilter
 {
 public:
     SrsEncFileWriter();
@@ -1289,11 +1409,21 @@ public:
 public:
     virtual srs_error_t write(void* data, size_t count, ssize_t* pnwrite);
     virtual void close();
+    virtual bool can_produce();
 public:
     srs_error_t config_cipher(unsigned char* key, unsigned char* iv);
+    // Whether encrypt in the thread of async io, only works when the writer is async.
+    // @remark User must set it before config_cipher.
+    void set_offload(bool v);
+// Interface ISrsFileFilter
+public:
+    virtual int filter(char* buf, int size);
 private:
-    unsigned char* key;
-    unsigned char iv[16];
+    // The EVP_CIPHER_CTX of openssl.
+    void* ctx;
+    // Whether to encrypt in the thread of async io.
+    bool offload;
+    bool offloaded;
 private:
     char* buf;
     int nb_buf;
@@ -1307,6 +1437,9 @@ public:
     // The current ts message.
     SrsTsMessage* audio;
     SrsTsMessage* video;
+private:
+    // Report the bytes of cached messages to the memory stat.
+    SrsMemoryUsage memory;
 public:
     SrsTsMessageCache();
     virtual ~SrsTsMessageCache();
@@ -1315,6 +1448,10 @@ public:
     virtual srs_error_t cache_audio(SrsAudioFrame* frame, int64_t dts);
     // Write video to muxer.
     virtual srs_error_t cache_video(SrsVideoFrame* frame, int64_t dts);
+    // Report the bytes of cache to the memory stat of stream.
+    virtual void set_memory(SrsMemoryStat* v);
+    // Update the bytes of cache, user must call it after free the audio or video.
+    virtual void update_memory();
 private:
     virtual srs_error_t do_cache_mp3(SrsAudioFrame* frame);
     virtual srs_error_t do_cache_aac(SrsAudioFrame* frame);
@@ -1343,6 +1480,9 @@ public:
     // @remark assert data is not NULL.
     virtual srs_error_t write_audio(int64_t timestamp, char* data, int size);
     virtual srs_error_t write_video(int64_t timestamp, char* data, int size);
+    // Reset the context, to write the PAT/PMT before the next frame.
+    // @remark The continuity counter of each pid is kept.
+    virtual void reset();
 private:
     virtual srs_error_t flush_audio();
     virtual srs_error_t flush_video();
@@ -45,8 +45,16 @@ extern srs_error_t srs_avc_nalu_read_bit(SrsBitBuffer* stream, int8_t& v);
 extern srs_utime_t srs_get_system_time();
 extern srs_utime_t srs_get_system_startup_time();
 // A daemon st-thread updates it.
+// @remark It's the wall time, which jumps when NTP steps the clock, so use it only when really need the wall
+//      time, for example, the time in log or HLS, and use the monotonic time for duration and timeout.
 extern srs_utime_t srs_update_system_time();
 
+// Get the monotonic time in srs_utime_t from cache, which is updated by each tick of ST scheduler,
+// so it's lock-free and no syscall to get it. It never jumps and is not the wall time.
+extern srs_utime_t srs_get_monotonic_time();
+// Read the monotonic clock and update the cache, for the precise duration and the clock of ST.
+extern srs_utime_t srs_update_monotonic_time();
+
 // The "ANY" address to listen, it's "0.0.0.0" for ipv4, and "::" for ipv6.
 // @remark We prefer ipv4, only use ipv6 if ipv4 is disabled.
 extern std::string srs_any_address_for_listener();
@@ -129,6 +137,11 @@ extern std::string srs_path_filext(std::string path);
 // @param pnb_start_code output the size of start code, must >=3. NULL to ignore.
 extern bool srs_avc_startswith_annexb(SrsBuffer* stream, int* pnb_start_code = NULL);
 
+// Find the first annexb start code "N[00] 00 00 01" in [p, end), where N>=0.
+// @return The start of the start code, or end if not found.
+// @remark It's the same to skip byte until srs_avc_startswith_annexb, but scans 16 bytes once by SIMD.
+extern char* srs_avc_find_annexb(char* p, char* end);
+
 // Whether stream starts with the aac ADTS from ISO_IEC_14496-3-AAC-2001.pdf, page 75, 1.A.2.2 ADTS.
 // The start code must be '1111 1111 1111'B, that is 0xFFF
 extern bool srs_aac_startswith_adts(SrsBuffer* stream);
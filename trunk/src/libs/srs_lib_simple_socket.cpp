@@ -58,6 +58,7 @@
 // for srs-librtmp, @see https://github.com/ossrs/srs/issues/213
 #ifndef _WIN32
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -72,6 +73,7 @@
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_consts.hpp>
+#include <srs_kernel_stream.hpp>
 
 // when io not hijacked, use simple socket, the block sync stream.
 #ifndef SRS_HIJACK_IO
@@ -140,6 +142,8 @@ int srs_hijack_io_create_socket(srs_hijack_io_t ctx, srs_rtmp_t owner)
 
     return ERROR_SUCCESS;
 }
+int srs_hijack_io_set_recv_timeout(srs_hijack_io_t ctx, int64_t tm);
+int srs_hijack_io_set_send_timeout(srs_hijack_io_t ctx, int64_t tm);
 int srs_hijack_io_connect(srs_hijack_io_t ctx, const char* server_ip, int port)
 {
     SrsBlockSyncSocket* skt = (SrsBlockSyncSocket*)ctx;
@@ -167,6 +171,10 @@ int srs_hijack_io_connect(srs_hijack_io_t ctx, const char* server_ip, int port)
         SOCKET_RESET(skt->fdv4);
     }
 
+    // The timeout maybe set before the fd is chosen.
+    srs_hijack_io_set_recv_timeout(ctx, skt->rtm);
+    srs_hijack_io_set_send_timeout(ctx, skt->stm);
+
     if(::connect(skt->fd, r->ai_addr, r->ai_addrlen) < 0){
         return ERROR_SOCKET_CONNECT;
     }
@@ -206,6 +214,12 @@ int srs_hijack_io_read(srs_hijack_io_t ctx, void* buf, size_t size, ssize_t* nre
 int srs_hijack_io_set_recv_timeout(srs_hijack_io_t ctx, int64_t tm)
 {
     SrsBlockSyncSocket* skt = (SrsBlockSyncSocket*)ctx;
+    
+    // Apply the timeout when connected, for the fd is not chosen before connect.
+    skt->rtm = tm;
+    if (!SOCKET_VALID(skt->fd)) {
+        return ERROR_SUCCESS;
+    }
 
 #ifdef _WIN32
     DWORD tv = (DWORD)(tm);
@@ -231,8 +245,6 @@ int srs_hijack_io_set_recv_timeout(srs_hijack_io_t ctx, int64_t tm)
     }
 #endif
 
-    skt->rtm = tm;
-
     return ERROR_SUCCESS;
 }
 int64_t srs_hijack_io_get_recv_timeout(srs_hijack_io_t ctx)
@@ -248,6 +260,12 @@ int64_t srs_hijack_io_get_recv_bytes(srs_hijack_io_t ctx)
 int srs_hijack_io_set_send_timeout(srs_hijack_io_t ctx, int64_t tm)
 {
     SrsBlockSyncSocket* skt = (SrsBlockSyncSocket*)ctx;
+    
+    // Apply the timeout when connected, for the fd is not chosen before connect.
+    skt->stm = tm;
+    if (!SOCKET_VALID(skt->fd)) {
+        return ERROR_SUCCESS;
+    }
 
 #ifdef _WIN32
     DWORD tv = (DWORD)(tm);
@@ -273,8 +291,6 @@ int srs_hijack_io_set_send_timeout(srs_hijack_io_t ctx, int64_t tm)
     }
 #endif
     
-    skt->stm = tm;
-    
     return ERROR_SUCCESS;
 }
 int64_t srs_hijack_io_get_send_timeout(srs_hijack_io_t ctx)
@@ -377,6 +393,8 @@ int srs_hijack_io_write(srs_hijack_io_t ctx, void* buf, size_t size, ssize_t* nw
 SimpleSocketStream::SimpleSocketStream()
 {
     io = srs_hijack_io_create();
+    nonblock = false;
+    pending = new SrsSimpleStream();
 }
 
 SimpleSocketStream::~SimpleSocketStream()
@@ -385,6 +403,7 @@ SimpleSocketStream::~SimpleSocketStream()
         srs_hijack_io_destroy(io);
         io = NULL;
     }
+    srs_freep(pending);
 }
 
 srs_hijack_io_t SimpleSocketStream::hijack_io()
@@ -404,11 +423,85 @@ int SimpleSocketStream::connect(const char* server_ip, int port)
     return srs_hijack_io_connect(io, server_ip, port);
 }
 
+int SimpleSocketStream::get_fd()
+{
+#ifndef SRS_HIJACK_IO
+    SrsBlockSyncSocket* skt = (SrsBlockSyncSocket*)io;
+    if (SOCKET_VALID(skt->fd)) {
+        return (int)skt->fd;
+    }
+#endif
+    return -1;
+}
+
+int SimpleSocketStream::set_nonblock(bool v)
+{
+#ifndef SRS_HIJACK_IO
+    SrsBlockSyncSocket* skt = (SrsBlockSyncSocket*)io;
+    if (!SOCKET_VALID(skt->fd)) {
+        return ERROR_SOCKET_NONBLOCK;
+    }
+    
+#ifndef _WIN32
+    int flags = fcntl(skt->fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(skt->fd, F_SETFL, v? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == -1) {
+        return ERROR_SOCKET_NONBLOCK;
+    }
+#else
+    u_long mode = v? 1 : 0;
+    if (ioctlsocket(skt->fd, FIONBIO, &mode) != 0) {
+        return ERROR_SOCKET_NONBLOCK;
+    }
+#endif
+    
+    nonblock = v;
+    return ERROR_SUCCESS;
+#else
+    return ERROR_SOCKET_NONBLOCK;
+#endif
+}
+
+bool SimpleSocketStream::is_nonblock()
+{
+    return nonblock;
+}
+
+srs_error_t SimpleSocketStream::flush()
+{
+    srs_assert(io);
+    
+    while (pending->length() > 0) {
+        ssize_t nn = 0;
+        int ret = srs_hijack_io_write(io, pending->bytes(), pending->length(), &nn);
+        
+        // The socket is not writable, for EAGAIN is the same to timeout.
+        if (ret == ERROR_SOCKET_TIMEOUT) {
+            break;
+        }
+        if (ret != ERROR_SUCCESS) {
+            return srs_error_new(ret, "flush");
+        }
+        
+        pending->erase((int)nn);
+    }
+    
+    return srs_success;
+}
+
+int SimpleSocketStream::pending_bytes()
+{
+    return pending->length();
+}
+
 // Interface ISrsReader
 srs_error_t SimpleSocketStream::read(void* buf, size_t size, ssize_t* nread)
 {
     srs_assert(io);
     int ret = srs_hijack_io_read(io, buf, size, nread);
+    // For non-blocking mode, the EAGAIN is the same to timeout.
+    if (nonblock && ret == ERROR_SOCKET_TIMEOUT) {
+        return srs_error_new(ERROR_SOCKET_WOULD_BLOCK, "read");
+    }
     if (ret != ERROR_SUCCESS) {
         return srs_error_new(ret, "read");
     }
@@ -456,6 +549,11 @@ int64_t SimpleSocketStream::get_send_bytes()
 srs_error_t SimpleSocketStream::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
 {
     srs_assert(io);
+    
+    if (nonblock) {
+        return writev_nonblock(iov, iov_size, nwrite);
+    }
+    
     int ret = srs_hijack_io_writev(io, iov, iov_size, nwrite);
     if (ret != ERROR_SUCCESS) {
         return srs_error_new(ret, "read");
@@ -473,9 +571,28 @@ srs_error_t SimpleSocketStream::read_fully(void* buf, size_t size, ssize_t* nrea
     return srs_success;
 }
 
+// The hijack io has no readv, so we read to the first iov, which is allowed because readv may read less.
+srs_error_t SimpleSocketStream::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    for (int i = 0; i < iov_size; i++) {
+        if (iov[i].iov_len > 0) {
+            return read(iov[i].iov_base, iov[i].iov_len, nread);
+        }
+    }
+    return srs_error_new(ERROR_SOCKET_READ, "readv empty");
+}
+
 srs_error_t SimpleSocketStream::write(void* buf, size_t size, ssize_t* nwrite)
 {
     srs_assert(io);
+    
+    if (nonblock) {
+        iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = size;
+        return writev_nonblock(&iov, 1, nwrite);
+    }
+    
     int ret = srs_hijack_io_write(io, buf, size, nwrite);
     if (ret != ERROR_SUCCESS) {
         return srs_error_new(ret, "read");
@@ -483,4 +600,44 @@ srs_error_t SimpleSocketStream::write(void* buf, size_t size, ssize_t* nwrite)
     return srs_success;
 }
 
+srs_error_t SimpleSocketStream::writev_nonblock(const iovec *iov, int iov_size, ssize_t* nwrite)
+{
+    ssize_t size = 0;
+    for (int i = 0; i < iov_size; i++) {
+        size += iov[i].iov_len;
+    }
+    
+    // All bytes are sent or queued.
+    if (nwrite) {
+        *nwrite = size;
+    }
+    
+    // Write the pending bytes first, to keep the order of bytes.
+    ssize_t nn = 0;
+    if (pending->length() == 0) {
+        int ret = srs_hijack_io_writev(io, iov, iov_size, &nn);
+        if (ret == ERROR_SOCKET_TIMEOUT) {
+            nn = 0;
+        } else if (ret != ERROR_SUCCESS) {
+            return srs_error_new(ret, "writev");
+        }
+    }
+    
+    // Queue the left bytes, which are not written.
+    for (int i = 0; i < iov_size && nn < size; i++) {
+        const iovec* v = iov + i;
+        if (nn >= (ssize_t)v->iov_len) {
+            nn -= v->iov_len;
+            size -= v->iov_len;
+            continue;
+        }
+        
+        pending->append((char*)v->iov_base + nn, (int)(v->iov_len - nn));
+        size -= v->iov_len;
+        nn = 0;
+    }
+    
+    return srs_success;
+}
+
 
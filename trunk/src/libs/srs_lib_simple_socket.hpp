@@ -34,14 +34,21 @@
 #define SOCKET int
 #endif
 
+class SrsSimpleStream;
+
 /**
  * simple socket stream,
  * use tcp socket, sync block mode, for client like srs-librtmp.
+ * @remark For non-blocking mode, the read returns ERROR_SOCKET_WOULD_BLOCK when no data,
+ *      and the write never blocks, the bytes are queued when socket is not writable.
  */
 class SimpleSocketStream : public ISrsProtocolReadWriter
 {
 private:
     srs_hijack_io_t io;
+    bool nonblock;
+    // The bytes to write when socket is writable, for non-blocking mode.
+    SrsSimpleStream* pending;
 public:
     SimpleSocketStream();
     virtual ~SimpleSocketStream();
@@ -49,6 +56,14 @@ public:
     virtual srs_hijack_io_t hijack_io();
     virtual int create_socket(srs_rtmp_t owner);
     virtual int connect(const char* server, int port);
+    // Get the fd of socket, -1 for hijack io or not connected.
+    virtual int get_fd();
+    // Set the socket to non-blocking mode, not supported for hijack io.
+    virtual int set_nonblock(bool v);
+    virtual bool is_nonblock();
+    // For non-blocking mode, write the pending bytes when socket is writable.
+    virtual srs_error_t flush();
+    virtual int pending_bytes();
 // Interface ISrsReader
 public:
     virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
@@ -66,7 +81,10 @@ public:
 // Interface ISrsProtocolReadWriter
 public:
     virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread);
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
+private:
+    virtual srs_error_t writev_nonblock(const iovec *iov, int iov_size, ssize_t* nwrite);
 };
 
 #endif
@@ -118,6 +118,12 @@ struct Context
     int64_t stimeout;
     int64_t rtimeout;
     
+    // Whether the socket is non-blocking, driven by user poll.
+    bool nonblock;
+    // Whether batch the messages to write, sent by one writev when batch end.
+    bool batching;
+    std::vector<SrsSharedPtrMessage*> batch;
+    
     // The RTMP handler level buffer, can used to format packet.
     char buffer[1024];
     
@@ -126,6 +132,8 @@ struct Context
         skt = NULL;
         req = NULL;
         stream_id = 0;
+        nonblock = false;
+        batching = false;
         h264_sps_pps_sent = false;
         h264_sps_changed = false;
         h264_pps_changed = false;
@@ -143,6 +151,12 @@ struct Context
             srs_freep(msg);
         }
         msgs.clear();
+        
+        for (int i = 0; i < (int)batch.size(); i++) {
+            SrsSharedPtrMessage* msg = batch[i];
+            srs_freep(msg);
+        }
+        batch.clear();
     }
 };
 
@@ -997,23 +1011,20 @@ int srs_rtmp_go_packet(Context* context, SrsCommonMessage* msg,
     if (msg->header.is_audio()) {
         *type = SRS_RTMP_TYPE_AUDIO;
         *timestamp = (uint32_t)msg->header.timestamp;
-        *data = (char*)msg->payload;
         *size = (int)msg->size;
         // detach bytes from packet.
-        msg->payload = NULL;
+        *data = msg->detach_payload();
     } else if (msg->header.is_video()) {
         *type = SRS_RTMP_TYPE_VIDEO;
         *timestamp = (uint32_t)msg->header.timestamp;
-        *data = (char*)msg->payload;
         *size = (int)msg->size;
         // detach bytes from packet.
-        msg->payload = NULL;
+        *data = msg->detach_payload();
     } else if (msg->header.is_amf0_data() || msg->header.is_amf3_data()) {
         *type = SRS_RTMP_TYPE_SCRIPT;
-        *data = (char*)msg->payload;
         *size = (int)msg->size;
         // detach bytes from packet.
-        msg->payload = NULL;
+        *data = msg->detach_payload();
     } else if (msg->header.is_aggregate()) {
         if ((ret = srs_rtmp_on_aggregate(context, msg)) != ERROR_SUCCESS) {
             return ret;
@@ -1021,10 +1032,31 @@ int srs_rtmp_go_packet(Context* context, SrsCommonMessage* msg,
         *got_msg = false;
     } else {
         *type = msg->header.message_type;
-        *data = (char*)msg->payload;
         *size = (int)msg->size;
         // detach bytes from packet.
-        msg->payload = NULL;
+        *data = msg->detach_payload();
+    }
+    
+    return ret;
+}
+
+// Recv a message from protocol, for non-blocking mode, parse the bytes in buffer, then
+// read the available bytes once, return ERROR_SOCKET_WOULD_BLOCK when no bytes.
+int srs_rtmp_recv_message(Context* context, SrsCommonMessage** pmsg)
+{
+    int ret = ERROR_SUCCESS;
+    srs_error_t err = srs_success;
+    
+    if (!context->nonblock) {
+        err = context->rtmp->recv_message(pmsg);
+    } else if ((err = context->rtmp->recv_buffered_message(pmsg)) == srs_success && !*pmsg) {
+        err = context->rtmp->read_available();
+    }
+    
+    if (err != srs_success) {
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
     }
     
     return ret;
@@ -1038,7 +1070,6 @@ int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, uint32_t* timestamp, char*
     *size = 0;
     
     int ret = ERROR_SUCCESS;
-    srs_error_t err = srs_success;
     
     srs_assert(rtmp != NULL);
     Context* context = (Context*)rtmp;
@@ -1054,9 +1085,7 @@ int srs_rtmp_read_packet(srs_rtmp_t rtmp, char* type, uint32_t* timestamp, char*
         }
         
         // read from protocol sdk.
-        if (!msg && (err = context->rtmp->recv_message(&msg)) != srs_success) {
-            ret = srs_error_code(err);
-            srs_freep(err);
+        if (!msg && (ret = srs_rtmp_recv_message(context, &msg)) != ERROR_SUCCESS) {
             return ret;
         }
         
@@ -1100,6 +1129,12 @@ int srs_rtmp_write_packet(srs_rtmp_t rtmp, char type, uint32_t timestamp, char*
     
     srs_assert(msg);
     
+    // queue the msg, sent when batch end.
+    if (context->batching) {
+        context->batch.push_back(msg);
+        return ret;
+    }
+    
     // send out encoded msg.
     if ((err = context->rtmp->send_and_free_message(msg, context->stream_id)) != srs_success) {
         ret = srs_error_code(err);
@@ -1142,6 +1177,228 @@ srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size)
     return false;
 }
 
+int srs_rtmp_set_nonblock(srs_rtmp_t rtmp, srs_bool nonblock)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if ((ret = context->skt->set_nonblock(nonblock)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    context->nonblock = nonblock;
+    
+    return ret;
+}
+
+int srs_rtmp_get_fd(srs_rtmp_t rtmp)
+{
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if (!context->skt) {
+        return -1;
+    }
+    
+    return context->skt->get_fd();
+}
+
+srs_bool srs_rtmp_is_would_block(int error_code)
+{
+    return error_code == ERROR_SOCKET_WOULD_BLOCK;
+}
+
+int srs_rtmp_on_readable(srs_rtmp_t rtmp, srs_rtmp_on_packet_t handler, void* param)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    srs_assert(handler != NULL);
+    
+    for (;;) {
+        char type;
+        uint32_t timestamp;
+        char* data = NULL;
+        int size;
+        
+        if ((ret = srs_rtmp_read_packet(rtmp, &type, &timestamp, &data, &size)) != ERROR_SUCCESS) {
+            break;
+        }
+        
+        ret = handler(param, type, timestamp, data, size);
+        srs_freepa(data);
+        
+        if (ret != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    // All available packets are consumed.
+    if (ret == ERROR_SOCKET_WOULD_BLOCK) {
+        return ERROR_SUCCESS;
+    }
+    
+    return ret;
+}
+
+int srs_rtmp_read_packet_to(srs_rtmp_t rtmp, char* type, uint32_t* timestamp, char* buf, int size, int* nb_data)
+{
+    int ret = ERROR_SUCCESS;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    *nb_data = 0;
+    
+    char* data = NULL;
+    int nb_packet = 0;
+    if ((ret = srs_rtmp_read_packet(rtmp, type, timestamp, &data, &nb_packet)) != ERROR_SUCCESS) {
+        return ret;
+    }
+    
+    // Keep the packet to read again, with larger buffer.
+    if (nb_packet > size) {
+        SrsCommonMessage* msg = new SrsCommonMessage();
+        msg->header.message_type = *type;
+        msg->header.timestamp = *timestamp;
+        msg->header.payload_length = nb_packet;
+        msg->header.stream_id = context->stream_id;
+        msg->create_payload(nb_packet);
+        memcpy(msg->payload, data, nb_packet);
+        msg->size = nb_packet;
+        context->msgs.insert(context->msgs.begin(), msg);
+        
+        srs_freepa(data);
+        *nb_data = nb_packet;
+        return ERROR_RTMP_PACKET_SIZE;
+    }
+    
+    if (nb_packet > 0) {
+        memcpy(buf, data, nb_packet);
+    }
+    srs_freepa(data);
+    *nb_data = nb_packet;
+    
+    return ret;
+}
+
+int srs_rtmp_write_packets(srs_rtmp_t rtmp, srs_rtmp_packet_t* pkts, int nb_pkts)
+{
+    int ret = ERROR_SUCCESS;
+    srs_error_t err = srs_success;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if (nb_pkts <= 0) {
+        return ret;
+    }
+    
+    std::vector<SrsSharedPtrMessage*> msgs;
+    for (int i = 0; i < nb_pkts; i++) {
+        srs_rtmp_packet_t* pkt = pkts + i;
+        
+        SrsSharedPtrMessage* msg = NULL;
+        if ((err = srs_rtmp_create_msg(pkt->type, pkt->timestamp, pkt->data, pkt->size, context->stream_id, &msg)) != srs_success) {
+            break;
+        }
+        msgs.push_back(msg);
+    }
+    
+    // Free the data of left packets, which are not created to message.
+    if (err != srs_success) {
+        for (int i = (int)msgs.size() + 1; i < nb_pkts; i++) {
+            srs_freepa(pkts[i].data);
+        }
+        for (int i = 0; i < (int)msgs.size(); i++) {
+            SrsSharedPtrMessage* msg = msgs[i];
+            srs_freep(msg);
+        }
+        
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+    
+    // Queue all messages, sent when batch end.
+    if (context->batching) {
+        context->batch.insert(context->batch.end(), msgs.begin(), msgs.end());
+        return ret;
+    }
+    
+    // Send all messages by writev.
+    if ((err = context->rtmp->send_and_free_messages(&msgs[0], (int)msgs.size(), context->stream_id)) != srs_success) {
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+    
+    return ret;
+}
+
+srs_bool srs_rtmp_want_write(srs_rtmp_t rtmp)
+{
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    return context->skt && context->skt->pending_bytes() > 0;
+}
+
+int srs_rtmp_on_writable(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    srs_error_t err = srs_success;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    if ((err = context->skt->flush()) != srs_success) {
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+    
+    return ret;
+}
+
+int srs_rtmp_batch_begin(srs_rtmp_t rtmp)
+{
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    context->batching = true;
+    
+    return ERROR_SUCCESS;
+}
+
+int srs_rtmp_batch_end(srs_rtmp_t rtmp)
+{
+    int ret = ERROR_SUCCESS;
+    srs_error_t err = srs_success;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    context->batching = false;
+    if (context->batch.empty()) {
+        return ret;
+    }
+    
+    // The messages are freed by protocol, even if error.
+    std::vector<SrsSharedPtrMessage*> msgs;
+    msgs.swap(context->batch);
+    
+    if ((err = context->rtmp->send_and_free_messages(&msgs[0], (int)msgs.size(), context->stream_id)) != srs_success) {
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+    
+    return ret;
+}
+
 /**
  * directly write a audio frame.
  */
@@ -1522,6 +1779,103 @@ int srs_h264_write_raw_frames(srs_rtmp_t rtmp, char* frames, int frames_size, ui
     return error_code_return;
 }
 
+/**
+ * write h264 NALUs of a frame, without annexb start code.
+ */
+int srs_h264_write_nalus(srs_rtmp_t rtmp, const iovec* nalus, int nb_nalus, uint32_t dts, uint32_t pts)
+{
+    int ret = ERROR_SUCCESS;
+    srs_error_t err = srs_success;
+    
+    srs_assert(rtmp != NULL);
+    Context* context = (Context*)rtmp;
+    
+    // The NALUs of I/P/B frame, which refer to the nalus of user.
+    std::vector<iovec> ipb;
+    SrsVideoAvcFrameType frame_type = SrsVideoAvcFrameTypeInterFrame;
+    
+    for (int i = 0; i < nb_nalus; i++) {
+        char* frame = (char*)nalus[i].iov_base;
+        int frame_size = (int)nalus[i].iov_len;
+        
+        // atleast 1bytes for SPS to decode the type
+        if (frame_size <= 0) {
+            continue;
+        }
+        
+        // for sps, the duplicated sps is ignored.
+        if (context->avc_raw.is_sps(frame, frame_size)) {
+            std::string sps;
+            if ((err = context->avc_raw.sps_demux(frame, frame_size, sps)) != srs_success) {
+                ret = srs_error_code(err);
+                srs_freep(err);
+                return ret;
+            }
+            
+            if (context->h264_sps != sps) {
+                context->h264_sps_changed = true;
+                context->h264_sps = sps;
+            }
+            continue;
+        }
+        
+        // for pps, the duplicated pps is ignored.
+        if (context->avc_raw.is_pps(frame, frame_size)) {
+            std::string pps;
+            if ((err = context->avc_raw.pps_demux(frame, frame_size, pps)) != srs_success) {
+                ret = srs_error_code(err);
+                srs_freep(err);
+                return ret;
+            }
+            
+            if (context->h264_pps != pps) {
+                context->h264_pps_changed = true;
+                context->h264_pps = pps;
+            }
+            continue;
+        }
+        
+        // ignore others, for example, AUD and SEI.
+        SrsAvcNaluType nut = (SrsAvcNaluType)(frame[0] & 0x1f);
+        if (nut != SrsAvcNaluTypeIDR && nut != SrsAvcNaluTypeNonIDR) {
+            continue;
+        }
+        
+        if (nut == SrsAvcNaluTypeIDR) {
+            frame_type = SrsVideoAvcFrameTypeKeyFrame;
+        }
+        ipb.push_back(nalus[i]);
+    }
+    
+    // send pps+sps before ipb frames when sps/pps changed.
+    if (!context->h264_sps.empty() && !context->h264_pps.empty()) {
+        if ((ret = srs_write_h264_sps_pps(context, dts, pts)) != ERROR_SUCCESS) {
+            return ret;
+        }
+    }
+    
+    if (ipb.empty()) {
+        return ret;
+    }
+    
+    // when sps or pps not sent, ignore the packet.
+    if (!context->h264_sps_pps_sent) {
+        return ERROR_H264_DROP_BEFORE_SPS_PPS;
+    }
+    
+    // All NALUs of frame in one packet.
+    char* flv = NULL;
+    int nb_flv = 0;
+    if ((err = context->avc_raw.mux_nalus2flv(&ipb[0], (int)ipb.size(), frame_type, dts, pts, &flv, &nb_flv)) != srs_success) {
+        ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+    
+    // the timestamp in rtmp message header is dts.
+    return srs_rtmp_write_packet(context, SRS_RTMP_TYPE_VIDEO, dts, flv, nb_flv);
+}
+
 srs_bool srs_h264_is_dvbsp_error(int error_code)
 {
     return error_code == ERROR_H264_DROP_BEFORE_SPS_PPS;
@@ -2212,7 +2566,7 @@ void srs_amf0_strict_array_append(srs_amf0_t amf0, srs_amf0_t value)
 
 int64_t srs_utils_time_ms()
 {
-    return srs_update_system_time();
+    return srsu2ms(srs_update_system_time());
 }
 
 int64_t srs_utils_send_bytes(srs_rtmp_t rtmp)
@@ -75,6 +75,10 @@ pid_t getpid(void);
 
 #include <stdint.h>
 #include <sys/types.h>
+#ifndef _WIN32
+// for iovec.
+#include <sys/uio.h>
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -320,6 +324,95 @@ extern void srs_rtmp_free_packet(char* data);
  */
 extern srs_bool srs_rtmp_is_onMetaData(char type, char* data, int size);
 
+/*************************************************************
+ **************************************************************
+ * non-blocking RTMP, event-driven by user poll or epoll.
+ **************************************************************
+ *************************************************************/
+/**
+ * Set the socket of RTMP to non-blocking mode, or restore to blocking mode. User should
+ * handshake, connect app and play or publish in blocking mode, then switch to non-blocking
+ * mode, and poll the fd for readable and writable events.
+ * In non-blocking mode:
+ *      the srs_rtmp_read_packet returns ERROR_SOCKET_WOULD_BLOCK when no entire packet,
+ *      the srs_rtmp_write_packet never blocks, the bytes are queued when socket is not writable,
+ *      user should poll for writable when srs_rtmp_want_write, then call srs_rtmp_on_writable.
+ * @remark Not supported for hijack io.
+ * @example /trunk/research/librtmp/srs_async_play.c
+ * @return 0, success; otherswise, failed.
+ */
+extern int srs_rtmp_set_nonblock(srs_rtmp_t rtmp, srs_bool nonblock);
+/**
+ * Get the fd of socket to poll, -1 if not connected or hijack io.
+ */
+extern int srs_rtmp_get_fd(srs_rtmp_t rtmp);
+/**
+ * Whether the error code is would block, that is, try again when socket is readable.
+ */
+extern srs_bool srs_rtmp_is_would_block(int error_code);
+
+/**
+ * The handler for packet, the data is owned by librtmp, and freed after handler return.
+ * @return 0 to continue; otherwise, stop and return the error code.
+ */
+typedef int (*srs_rtmp_on_packet_t)(void* param, char type, uint32_t timestamp, char* data, int size);
+/**
+ * When socket is readable, read all available packets and callback the handler, until
+ * would block.
+ * @return 0, success and would block; otherswise, failed or the error of handler.
+ */
+extern int srs_rtmp_on_readable(srs_rtmp_t rtmp, srs_rtmp_on_packet_t handler, void* param);
+/**
+ * Read a packet to the buffer of user, to avoid a malloc and copy for each packet.
+ * @param buf The buffer of user to read the packet data to.
+ * @param size The size of buffer.
+ * @param nb_data The size of packet data.
+ * @return 0, success; otherswise, failed.
+ * @remark When the buffer is not enough, return ERROR_RTMP_PACKET_SIZE, and set nb_data to
+ *      the required size, the packet is kept and user can read it again with larger buffer.
+ */
+extern int srs_rtmp_read_packet_to(srs_rtmp_t rtmp, char* type, uint32_t* timestamp, char* buf, int size, int* nb_data);
+
+/**
+ * The packet to write in batch.
+ */
+typedef struct {
+    char type;
+    uint32_t timestamp;
+    // User should never free it anymore, even if error.
+    char* data;
+    int size;
+} srs_rtmp_packet_t;
+/**
+ * Write packets in batch, the chunks of all packets are sent by one writev.
+ * @param pkts The packets to write, the data of packets are owned by librtmp.
+ * @param nb_pkts The number of packets.
+ * @return 0, success; otherswise, failed.
+ */
+extern int srs_rtmp_write_packets(srs_rtmp_t rtmp, srs_rtmp_packet_t* pkts, int nb_pkts);
+/**
+ * For non-blocking mode, whether there are bytes queued to write, that is, user should
+ * poll for writable event.
+ */
+extern srs_bool srs_rtmp_want_write(srs_rtmp_t rtmp);
+/**
+ * For non-blocking mode, write the queued bytes when socket is writable.
+ * @return 0, success; otherswise, failed.
+ */
+extern int srs_rtmp_on_writable(srs_rtmp_t rtmp);
+/**
+ * Begin to batch the packets to write, for example, the audio and video of a frame
+ * interval, which are queued and sent by one writev when srs_rtmp_batch_end.
+ * @remark All write functions are batched, for example, srs_h264_write_raw_frames.
+ * @return 0, success; otherswise, failed.
+ */
+extern int srs_rtmp_batch_begin(srs_rtmp_t rtmp);
+/**
+ * End the batch, and send all queued packets by one writev.
+ * @return 0, success; otherswise, failed.
+ */
+extern int srs_rtmp_batch_end(srs_rtmp_t rtmp);
+
 /*************************************************************
  **************************************************************
  * audio raw codec
@@ -463,6 +556,23 @@ extern int srs_aac_adts_frame_size(char* aac_raw_data, int ac_raw_size);
  srs_h264_write_raw_frames('0000000141E02041F8CDDC562BBDEFAD2F......', size, dts, pts)
  */
 extern int srs_h264_write_raw_frames(srs_rtmp_t rtmp, char* frames, int frames_size, uint32_t dts, uint32_t pts);
+/**
+ * write the NALUs of a h.264 frame over RTMP to rtmp server, which are split by user,
+ * to avoid the annexb demux and the copies of srs_h264_write_raw_frames.
+ * @param nalus the NALUs without annexb start code, for instance, the SPS, PPS and IDR
+ *       of a keyframe. The I/P/B NALUs are muxed to one RTMP packet, copied only once.
+ * @param nb_nalus the number of NALUs.
+ * @param dts the dts of h.264 frame.
+ * @param pts the pts of h.264 frame.
+ *
+ * @remark, user should free the nalus.
+ * @remark, the duplicated sps/pps is ignored, and sent again when changed.
+ * @remark, use srs_rtmp_batch_begin to send audio and video by one writev.
+ *
+ * @return 0, success; otherswise, failed.
+ *       for dvbsp error, @see srs_h264_is_dvbsp_error().
+ */
+extern int srs_h264_write_nalus(srs_rtmp_t rtmp, const struct iovec* nalus, int nb_nalus, uint32_t dts, uint32_t pts);
 /**
  * whether error_code is dvbsp(drop video before sps/pps/sequence-header) error.
  *
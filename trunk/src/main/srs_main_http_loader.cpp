@@ -0,0 +1,726 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include <st.h>
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_service_log.hpp>
+#include <srs_service_st.hpp>
+#include <srs_service_http_client.hpp>
+
+// The load generator of HTTP delivery, N viewers of HLS, LL-HLS, HTTP-FLV or HTTP-TS, each in a coroutine,
+// to measure the latency of requests, the rebuffers of players and the throughput of server.
+// It's the HTTP counterpart of research/librtmp/srs_benchmark.
+
+// @global log and context.
+ISrsLog* _srs_log = new SrsConsoleLog(SrsLogLevelTrace, false);
+ISrsThreadContext* _srs_context = new SrsThreadContext();
+
+// The jitter the player tolerates, the media which arrives later than it's played is a rebuffer.
+#define SRS_LOADER_JITTER (500 * SRS_UTIME_MILLISECONDS)
+// The recv timeout of live stream, to check the deadline.
+#define SRS_LOADER_RECV_TIMEOUT (1 * SRS_UTIME_SECONDS)
+// The number of segments or parts from the end of playlist, where the player starts.
+#define SRS_LOADER_HLS_START 3
+
+// The stat of all viewers, which are coroutines of the same thread.
+struct SrsLoaderStat
+{
+    // The latencies in ms of requests.
+    vector<int> playlists;
+    vector<int> blockings;
+    vector<int> medias;
+    // The time in ms to first frame of live stream.
+    vector<int> ttffs;
+    int64_t nn_requests;
+    int64_t nn_errors;
+    int64_t bytes;
+    int64_t nn_rebuffers;
+    srs_utime_t stalled;
+    int nn_failed;
+};
+SrsLoaderStat stat;
+
+// The buffer of player, which plays from the first media, and stalls when the media arrives later
+// than it's played, then the play clock is delayed by the stall.
+class SrsLoaderBuffer
+{
+private:
+    // The time the first media arrived, -1 if not started.
+    srs_utime_t starttime;
+    srs_utime_t stalled;
+public:
+    SrsLoaderBuffer() {
+        starttime = -1;
+        stalled = 0;
+    }
+public:
+    // The media at position, the duration since the first media, arrived now.
+    void on_media(srs_utime_t now, srs_utime_t position) {
+        if (starttime < 0) {
+            starttime = now;
+        }
+    
+        srs_utime_t clock = now - starttime - stalled - SRS_LOADER_JITTER;
+        if (clock > position) {
+            stat.nn_rebuffers++;
+            stat.stalled += clock - position;
+            stalled += clock - position;
+        }
+    }
+};
+
+// The viewer of stream, which plays until the deadline.
+class SrsLoaderViewer
+{
+protected:
+    SrsHttpUri* uri;
+    SrsHttpClient* hc;
+    SrsLoaderBuffer* buffer;
+    srs_utime_t deadline;
+public:
+    SrsLoaderViewer(SrsHttpUri* u, srs_utime_t d) {
+        uri = u;
+        hc = new SrsHttpClient();
+        buffer = new SrsLoaderBuffer();
+        deadline = d;
+    }
+    virtual ~SrsLoaderViewer() {
+        srs_freep(hc);
+        srs_freep(buffer);
+    }
+public:
+    virtual srs_error_t play() = 0;
+protected:
+    // Request the path, check the status and count the request.
+    virtual srs_error_t request(string path, ISrsHttpMessage** pmsg);
+};
+
+srs_error_t SrsLoaderViewer::request(string path, ISrsHttpMessage** pmsg)
+{
+    srs_error_t err = srs_success;
+    
+    stat.nn_requests++;
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = hc->get(path, "", &msg)) != srs_success) {
+        stat.nn_errors++;
+        return srs_error_wrap(err, "get %s", path.c_str());
+    }
+    
+    if (msg->status_code() != SRS_CONSTS_HTTP_OK) {
+        stat.nn_errors++;
+        int code = msg->status_code();
+        srs_freep(msg);
+        return srs_error_new(ERROR_HTTP_STATUS_INVALID, "get %s, status=%d", path.c_str(), code);
+    }
+    
+    *pmsg = msg;
+    
+    return err;
+}
+
+// The segment or part in playlist.
+struct SrsLoaderItem
+{
+    string uri;
+    srs_utime_t duration;
+    int msn;
+    // The index of part in segment, -1 for segment.
+    int part;
+};
+
+// The viewer of HLS, which polls the playlist and fetches the new segments, or the new parts by the
+// blocking reload of LL-HLS, if the server supports it.
+class SrsHlsViewer : public SrsLoaderViewer
+{
+private:
+    string playlist;
+    // The last fetched segment or part, -1 if none.
+    int last_msn;
+    int last_part;
+    // The position of next media, the duration since the first one.
+    srs_utime_t position;
+public:
+    SrsHlsViewer(SrsHttpUri* u, srs_utime_t d);
+    virtual ~SrsHlsViewer();
+public:
+    virtual srs_error_t play();
+private:
+    // Fetch the playlist, a blocking reload if msn is not -1.
+    virtual srs_error_t fetch_playlist(int msn, int part, string& body);
+    virtual srs_error_t fetch_media(SrsLoaderItem& item);
+    // Parse the playlist, and the variant of master playlist, if any.
+    virtual void parse(string body, vector<SrsLoaderItem>& segments, vector<SrsLoaderItem>& parts,
+        srs_utime_t& target, bool& blocking, string& variant);
+    // Resolve the uri in playlist to path.
+    virtual string resolve(string u);
+};
+
+SrsHlsViewer::SrsHlsViewer(SrsHttpUri* u, srs_utime_t d) : SrsLoaderViewer(u, d)
+{
+    playlist = u->get_path();
+    last_msn = last_part = -1;
+    position = 0;
+}
+
+SrsHlsViewer::~SrsHlsViewer()
+{
+}
+
+srs_error_t SrsHlsViewer::play()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = hc->initialize(uri->get_host(), uri->get_port())) != srs_success) {
+        return srs_error_wrap(err, "init client");
+    }
+    
+    bool started = false;
+    bool blocking = false;
+    int next_msn = -1;
+    int next_part = 0;
+    while (srs_update_system_time() < deadline) {
+        // The blocking reload of LL-HLS waits for the next part.
+        string body;
+        if ((err = fetch_playlist(blocking? next_msn : -1, next_part, body)) != srs_success) {
+            return srs_error_wrap(err, "fetch playlist");
+        }
+    
+        vector<SrsLoaderItem> segments, parts;
+        srs_utime_t target = 0;
+        string variant;
+        parse(body, segments, parts, target, blocking, variant);
+    
+        if (!variant.empty()) {
+            playlist = resolve(variant);
+            continue;
+        }
+    
+        // Play the parts for LL-HLS, or the segments.
+        blocking = blocking && !parts.empty();
+        vector<SrsLoaderItem>& items = blocking? parts : segments;
+    
+        if (!started && !items.empty()) {
+            started = true;
+            SrsLoaderItem& item = items.at(srs_max(0, (int)items.size() - 1 - SRS_LOADER_HLS_START));
+            last_msn = item.msn;
+            last_part = item.part;
+        }
+    
+        int nn_fetched = 0;
+        for (int i = 0; i < (int)items.size() && srs_update_system_time() < deadline; i++) {
+            SrsLoaderItem& item = items.at(i);
+            if (item.msn < last_msn || (item.msn == last_msn && item.part <= last_part)) {
+                continue;
+            }
+    
+            if ((err = fetch_media(item)) != srs_success) {
+                return srs_error_wrap(err, "fetch media");
+            }
+    
+            last_msn = item.msn;
+            last_part = item.part;
+            nn_fetched++;
+        }
+    
+        // The next part is the first one of next segment, if the segment of last part is complete.
+        next_msn = last_msn;
+        next_part = last_part + 1;
+        if (!segments.empty() && segments.back().msn >= last_msn) {
+            next_msn = last_msn + 1;
+            next_part = 0;
+        }
+    
+        // Poll the playlist by the target duration, or half of it if unchanged.
+        if (!blocking) {
+            srs_usleep(nn_fetched? target : target / 2);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsViewer::fetch_playlist(int msn, int part, string& body)
+{
+    srs_error_t err = srs_success;
+    
+    string path = playlist;
+    if (msn >= 0) {
+        path += "?_HLS_msn=" + srs_int2str(msn) + "&_HLS_part=" + srs_int2str(part);
+    }
+    
+    srs_utime_t starttime = srs_update_system_time();
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = request(path, &msg)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    if ((err = msg->body_read_all(body)) != srs_success) {
+        stat.nn_errors++;
+        return srs_error_wrap(err, "read body");
+    }
+    stat.bytes += body.length();
+    
+    int latency = srsu2msi(srs_update_system_time() - starttime);
+    if (msn >= 0) {
+        stat.blockings.push_back(latency);
+    } else {
+        stat.playlists.push_back(latency);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHlsViewer::fetch_media(SrsLoaderItem& item)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = srs_update_system_time();
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = request(resolve(item.uri), &msg)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    string body;
+    if ((err = msg->body_read_all(body)) != srs_success) {
+        stat.nn_errors++;
+        return srs_error_wrap(err, "read body");
+    }
+    stat.bytes += body.length();
+    
+    srs_utime_t now = srs_update_system_time();
+    stat.medias.push_back(srsu2msi(now - starttime));
+    
+    buffer->on_media(now, position);
+    position += item.duration;
+    
+    return err;
+}
+
+void SrsHlsViewer::parse(string body, vector<SrsLoaderItem>& segments, vector<SrsLoaderItem>& parts,
+    srs_utime_t& target, bool& blocking, string& variant)
+{
+    int msn = 0;
+    int part = 0;
+    bool stream_inf = false;
+    srs_utime_t duration = 0;
+    blocking = false;
+    
+    vector<string> lines = srs_string_split(body, "\n");
+    for (int i = 0; i < (int)lines.size(); i++) {
+        string line = srs_string_trim_end(lines.at(i), "\r");
+        if (line.empty()) {
+            continue;
+        }
+    
+        if (srs_string_starts_with(line, "#EXT-X-TARGETDURATION:")) {
+            target = ::atoi(line.substr(22).c_str()) * SRS_UTIME_SECONDS;
+        } else if (srs_string_starts_with(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            msn = ::atoi(line.substr(22).c_str());
+        } else if (srs_string_starts_with(line, "#EXT-X-SERVER-CONTROL:")) {
+            blocking = srs_string_contains(line, "CAN-BLOCK-RELOAD=YES");
+        } else if (srs_string_starts_with(line, "#EXT-X-STREAM-INF")) {
+            stream_inf = true;
+        } else if (srs_string_starts_with(line, "#EXTINF:")) {
+            duration = (srs_utime_t)(::atof(line.substr(8).c_str()) * SRS_UTIME_SECONDS);
+        } else if (srs_string_starts_with(line, "#EXT-X-PART:")) {
+            size_t pos = line.find("DURATION=");
+            size_t start = line.find("URI=\"");
+            size_t end = (start == string::npos)? string::npos : line.find("\"", start + 5);
+            if (pos == string::npos || end == string::npos) {
+                continue;
+            }
+    
+            SrsLoaderItem item;
+            item.uri = line.substr(start + 5, end - start - 5);
+            item.duration = (srs_utime_t)(::atof(line.substr(pos + 9).c_str()) * SRS_UTIME_SECONDS);
+            item.msn = msn;
+            item.part = part++;
+            parts.push_back(item);
+        } else if (line.at(0) != '#') {
+            // The first variant of master playlist.
+            if (stream_inf) {
+                variant = line;
+                return;
+            }
+    
+            SrsLoaderItem item;
+            item.uri = line;
+            item.duration = duration;
+            item.msn = msn++;
+            item.part = -1;
+            segments.push_back(item);
+            part = 0;
+        }
+    }
+    
+    // Use the default target duration of SRS, for example, the playlist without segments.
+    if (target <= 0) {
+        target = 10 * SRS_UTIME_SECONDS;
+    }
+}
+
+string SrsHlsViewer::resolve(string u)
+{
+    if (srs_string_starts_with(u, "http://", "https://")) {
+        SrsHttpUri r;
+        srs_error_t err = r.initialize(u);
+        srs_freep(err);
+        return r.get_path() + (r.get_query().empty()? "" : "?" + r.get_query());
+    }
+    
+    if (srs_string_starts_with(u, "/")) {
+        return u;
+    }
+    
+    return srs_path_dirname(playlist) + "/" + u;
+}
+
+// The viewer of HTTP-FLV or HTTP-TS, which reads the live stream, and parses the timestamp of frames.
+class SrsLiveViewer : public SrsLoaderViewer, public ISrsTsHandler
+{
+private:
+    bool is_ts;
+    SrsSimpleStream* cache;
+    SrsTsContext* context;
+    // Whether the header of FLV is parsed.
+    bool header_parsed;
+    srs_utime_t starttime;
+    // The timestamp in ms of the first frame, -1 if no frame.
+    int64_t base;
+public:
+    SrsLiveViewer(SrsHttpUri* u, srs_utime_t d);
+    virtual ~SrsLiveViewer();
+public:
+    virtual srs_error_t play();
+private:
+    virtual srs_error_t parse_flv();
+    virtual srs_error_t parse_ts();
+    virtual void on_frame(int64_t timestamp);
+// Interface ISrsTsHandler
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* msg);
+};
+
+SrsLiveViewer::SrsLiveViewer(SrsHttpUri* u, srs_utime_t d) : SrsLoaderViewer(u, d)
+{
+    is_ts = srs_string_ends_with(u->get_path(), ".ts");
+    cache = new SrsSimpleStream();
+    context = new SrsTsContext();
+    header_parsed = false;
+    starttime = 0;
+    base = -1;
+}
+
+SrsLiveViewer::~SrsLiveViewer()
+{
+    srs_freep(cache);
+    srs_freep(context);
+}
+
+srs_error_t SrsLiveViewer::play()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = hc->initialize(uri->get_host(), uri->get_port())) != srs_success) {
+        return srs_error_wrap(err, "init client");
+    }
+    
+    string path = uri->get_path() + (uri->get_query().empty()? "" : "?" + uri->get_query());
+    starttime = srs_update_system_time();
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = request(path, &msg)) != srs_success) {
+        return srs_error_wrap(err, "request");
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    hc->set_recv_timeout(SRS_LOADER_RECV_TIMEOUT);
+    
+    char buf[SRS_HTTP_READ_CACHE_BYTES];
+    ISrsHttpResponseReader* reader = msg->body_reader();
+    while (!reader->eof() && srs_update_system_time() < deadline) {
+        ssize_t nn = 0;
+        if ((err = reader->read(buf, sizeof(buf), &nn)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                srs_freep(err);
+                continue;
+            }
+            stat.nn_errors++;
+            return srs_error_wrap(err, "read body");
+        }
+    
+        stat.bytes += nn;
+        cache->append(buf, (int)nn);
+    
+        if ((err = (is_ts? parse_ts() : parse_flv())) != srs_success) {
+            stat.nn_errors++;
+            return srs_error_wrap(err, "parse");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLiveViewer::parse_flv()
+{
+    srs_error_t err = srs_success;
+    
+    // The FLV header and the first previous tag size.
+    if (!header_parsed) {
+        if (cache->length() < 13) {
+            return err;
+        }
+        if (cache->bytes()[0] != 'F' || cache->bytes()[1] != 'L' || cache->bytes()[2] != 'V') {
+            return srs_error_new(ERROR_HTTP_DATA_INVALID, "invalid flv header");
+        }
+        cache->erase(13);
+        header_parsed = true;
+    }
+    
+    while (cache->length() >= 11) {
+        uint8_t* p = (uint8_t*)cache->bytes();
+        int size = (int)((uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+        if (cache->length() < 11 + size + 4) {
+            break;
+        }
+    
+        if (p[0] == 8 || p[0] == 9) {
+            int64_t timestamp = (int64_t)((uint32_t)p[7] << 24 | (uint32_t)p[4] << 16 | (uint32_t)p[5] << 8 | p[6]);
+            on_frame(timestamp);
+        }
+        cache->erase(11 + size + 4);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsLiveViewer::parse_ts()
+{
+    srs_error_t err = srs_success;
+    
+    int nn_packets = cache->length() / SRS_TS_PACKET_SIZE;
+    for (int i = 0; i < nn_packets; i++) {
+        SrsBuffer stream(cache->bytes() + i * SRS_TS_PACKET_SIZE, SRS_TS_PACKET_SIZE);
+        if ((err = context->decode(&stream, this)) != srs_success) {
+            return srs_error_wrap(err, "decode ts");
+        }
+    }
+    cache->erase(nn_packets * SRS_TS_PACKET_SIZE);
+    
+    return err;
+}
+
+void SrsLiveViewer::on_frame(int64_t timestamp)
+{
+    srs_utime_t now = srs_update_system_time();
+    
+    // Rebase when the timestamp jumps back, for example, the stream is republished.
+    if (base < 0 || timestamp < base) {
+        if (base < 0) {
+            stat.ttffs.push_back(srsu2msi(now - starttime));
+        }
+        base = timestamp;
+    }
+    
+    buffer->on_media(now, (timestamp - base) * SRS_UTIME_MILLISECONDS);
+}
+
+srs_error_t SrsLiveViewer::on_ts_message(SrsTsMessage* msg)
+{
+    if (msg->is_audio() || msg->is_video()) {
+        on_frame(msg->dts / 90);
+    }
+    return srs_success;
+}
+
+void* loader_viewer_cycle(void* arg)
+{
+    SrsLoaderViewer* viewer = (SrsLoaderViewer*)arg;
+    
+    srs_error_t err = viewer->play();
+    if (err != srs_success) {
+        stat.nn_failed++;
+        srs_warn("viewer failed, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    return NULL;
+}
+
+// Get the percentile of sorted values.
+int loader_percentile(vector<int>& values, int percent)
+{
+    if (values.empty()) {
+        return -1;
+    }
+    int i = ((int)values.size() * percent + 99) / 100 - 1;
+    return values.at(srs_max(0, i));
+}
+
+void loader_report(const char* label, vector<int>& values)
+{
+    if (values.empty()) {
+        return;
+    }
+    
+    std::sort(values.begin(), values.end());
+    printf("%s: %d samples, p50=%dms, p90=%dms, p99=%dms, max=%dms\n", label, (int)values.size(),
+        loader_percentile(values, 50), loader_percentile(values, 90), loader_percentile(values, 99),
+        loader_percentile(values, 100));
+}
+
+srs_error_t do_load(string url, int nb_viewers, int duration, int ramp)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_st_init()) != srs_success) {
+        return srs_error_wrap(err, "initialize st");
+    }
+    
+    SrsHttpUri uri;
+    if ((err = uri.initialize(url)) != srs_success) {
+        return srs_error_wrap(err, "parse uri=%s", url.c_str());
+    }
+    
+    bool is_hls = srs_string_ends_with(uri.get_path(), ".m3u8");
+    srs_trace("start %d %s viewers of %s, duration=%ds", nb_viewers, is_hls? "hls" : "live", url.c_str(), duration);
+    
+    srs_utime_t starttime = srs_update_system_time();
+    srs_utime_t deadline = starttime + (srs_utime_t)nb_viewers * ramp * SRS_UTIME_MILLISECONDS + duration * SRS_UTIME_SECONDS;
+    
+    vector<SrsLoaderViewer*> viewers;
+    vector<st_thread_t> trds;
+    for (int i = 0; i < nb_viewers; i++) {
+        SrsLoaderViewer* viewer = NULL;
+        if (is_hls) {
+            viewer = new SrsHlsViewer(&uri, deadline);
+        } else {
+            viewer = new SrsLiveViewer(&uri, deadline);
+        }
+        viewers.push_back(viewer);
+    
+        st_thread_t trd = st_thread_create(loader_viewer_cycle, viewer, 1, 0);
+        if (!trd) {
+            return srs_error_new(ERROR_ST_CREATE_CYCLE_THREAD, "create viewer %d", i);
+        }
+        trds.push_back(trd);
+    
+        if (ramp > 0) {
+            srs_usleep(ramp * SRS_UTIME_MILLISECONDS);
+        }
+    }
+    
+    for (int i = 0; i < (int)trds.size(); i++) {
+        st_thread_join(trds.at(i), NULL);
+    }
+    for (int i = 0; i < (int)viewers.size(); i++) {
+        SrsLoaderViewer* viewer = viewers.at(i);
+        srs_freep(viewer);
+    }
+    
+    int elapsed = srsu2msi(srs_update_system_time() - starttime);
+    
+    printf("\n");
+    printf("viewers: %d, ok=%d, failed=%d\n", nb_viewers, nb_viewers - stat.nn_failed, stat.nn_failed);
+    printf("requests: %" PRId64 ", errors=%" PRId64 "\n", stat.nn_requests, stat.nn_errors);
+    printf("throughput: %d kbps, %d kbps per viewer\n", (int)(elapsed > 0? stat.bytes * 8 / elapsed : 0),
+        (int)(elapsed > 0? stat.bytes * 8 / elapsed / nb_viewers : 0));
+    loader_report("playlist", stat.playlists);
+    loader_report("blocking", stat.blockings);
+    loader_report("media", stat.medias);
+    loader_report("ttff", stat.ttffs);
+    printf("rebuffer: %" PRId64 " events, %.2f per viewer, stalled %dms\n", stat.nn_rebuffers,
+        (double)stat.nn_rebuffers / nb_viewers, srsu2msi(stat.stalled));
+    
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    printf("SRS HTTP loader/%d.%d.%d, load test by N viewers of HLS, LL-HLS, HTTP-FLV or HTTP-TS.\n",
+           VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION);
+    
+    string url;
+    int nb_viewers = 10;
+    int duration = 30;
+    int ramp = 10;
+    for (int opt = 0; opt < argc - 1; opt++) {
+        char* p = argv[opt];
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+        switch (p[1]) {
+            case 'i': url = argv[opt + 1]; break;
+            case 'n': nb_viewers = ::atoi(argv[opt + 1]); break;
+            case 'd': duration = ::atoi(argv[opt + 1]); break;
+            case 'r': ramp = ::atoi(argv[opt + 1]); break;
+            default: break;
+        }
+    }
+    
+    if (url.empty() || nb_viewers <= 0 || duration <= 0) {
+        printf("Usage: %s <-i url> [-n viewers] [-d duration] [-r ramp]\n"
+               "        url         The url to play, the .m3u8 for HLS or LL-HLS, the .flv or .ts for live stream.\n"
+               "                    The LL-HLS is played by parts and blocking reload, if the server supports it.\n"
+               "        viewers     The number of viewers, each in a coroutine. Default to 10.\n"
+               "        duration    The seconds to play. Default to 30.\n"
+               "        ramp        The interval in ms to start each viewer. Default to 10.\n"
+               "For example:\n"
+               "        %s -i http://127.0.0.1:8080/live/livestream.m3u8 -n 100\n"
+               "        %s -i http://127.0.0.1:8080/live/livestream.flv -n 1000 -d 60\n",
+               argv[0], argv[0], argv[0]);
+        exit(-1);
+    }
+    
+    srs_error_t err = do_load(url, nb_viewers, duration, ramp);
+    int code = srs_error_code(err);
+    
+    if (err != srs_success) {
+        srs_error("Load error %s", srs_error_desc(err).c_str());
+    }
+    
+    srs_freep(err);
+    return (code || stat.nn_failed)? -1 : 0;
+}
+
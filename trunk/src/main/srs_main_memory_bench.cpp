@@ -0,0 +1,441 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <st.h>
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_service_log.hpp>
+#include <srs_service_st.hpp>
+#include <srs_service_http_client.hpp>
+#include <srs_service_rtmp_conn.hpp>
+
+// The benchmark of memory of each connection, which opens N idle RTMP, N RTMP players and N HTTP-FLV players
+// in turn, and reports the delta of server memory per connection, by the /api/v1/memory of server.
+
+// @global log and context.
+ISrsLog* _srs_log = new SrsConsoleLog(SrsLogLevelWarn, false);
+ISrsThreadContext* _srs_context = new SrsThreadContext();
+
+// The timeout to connect and recv, also the interval for player to check the stop.
+#define SRS_BENCH_TIMEOUT (3 * SRS_UTIME_SECONDS)
+#define SRS_BENCH_RECV_TIMEOUT (1 * SRS_UTIME_SECONDS)
+// The max times to poll the server, to wait for the connections to be closed.
+#define SRS_BENCH_MAX_POLLS 30
+
+// The snapshot of memory of server, in bytes.
+struct SrsMemorySnapshot
+{
+    int64_t conns;
+    int64_t rss;
+    int64_t stack;
+    int64_t recv;
+    int64_t queue;
+    int64_t protocol;
+    int64_t statistic;
+};
+
+// The delta of memory per connection for a kind of connections.
+struct SrsMemoryResult
+{
+    string label;
+    int nn_conns;
+    SrsMemorySnapshot delta;
+};
+
+// Whether to stop the players.
+bool stopping = false;
+// The number of players failed.
+int nn_failed = 0;
+
+// The integer property of object, 0 if not found.
+int64_t bench_integer(SrsJsonObject* obj, string name)
+{
+    SrsJsonAny* prop = obj->ensure_property_integer(name);
+    return prop? prop->to_integer() : 0;
+}
+
+srs_error_t bench_snapshot(SrsHttpUri* api, SrsMemorySnapshot& s)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpClient hc;
+    if ((err = hc.initialize(api->get_host(), api->get_port(), SRS_BENCH_TIMEOUT)) != srs_success) {
+        return srs_error_wrap(err, "init client");
+    }
+    
+    ISrsHttpMessage* msg = NULL;
+    if ((err = hc.get("/api/v1/memory", "", &msg)) != srs_success) {
+        return srs_error_wrap(err, "get memory");
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    string body;
+    if ((err = msg->body_read_all(body)) != srs_success) {
+        return srs_error_wrap(err, "read body");
+    }
+    
+    SrsJsonAny* info = SrsJsonAny::loads(body);
+    if (!info || !info->is_object()) {
+        srs_freep(info);
+        return srs_error_new(ERROR_JSON_LOADS, "invalid memory %s", body.c_str());
+    }
+    SrsAutoFree(SrsJsonAny, info);
+    
+    SrsJsonAny* prop = NULL;
+    if ((prop = info->to_object()->ensure_property_object("data")) == NULL) {
+        return srs_error_new(ERROR_JSON_LOADS, "no data %s", body.c_str());
+    }
+    SrsJsonObject* data = prop->to_object();
+    
+    if ((prop = data->ensure_property_object("stacks")) == NULL) {
+        return srs_error_new(ERROR_JSON_LOADS, "no stacks %s", body.c_str());
+    }
+    SrsJsonObject* stacks = prop->to_object();
+    
+    if ((prop = data->ensure_property_object("subsystems")) == NULL) {
+        return srs_error_new(ERROR_JSON_LOADS, "no subsystems %s", body.c_str());
+    }
+    SrsJsonObject* subsystems = prop->to_object();
+    
+    s.conns = bench_integer(data, "conns");
+    s.rss = bench_integer(data, "rss");
+    s.stack = bench_integer(stacks, "resident");
+    s.recv = bench_integer(subsystems, "recv") + bench_integer(subsystems, "play_recv");
+    s.queue = bench_integer(subsystems, "queue");
+    s.protocol = bench_integer(subsystems, "protocol");
+    s.statistic = bench_integer(subsystems, "statistic");
+    
+    return err;
+}
+
+// Wait for the connections of server to be the baseline, that is, the connections of last kind are closed.
+srs_error_t bench_wait_closed(SrsHttpUri* api, SrsMemorySnapshot& baseline)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < SRS_BENCH_MAX_POLLS; i++) {
+        SrsMemorySnapshot s;
+        if ((err = bench_snapshot(api, s)) != srs_success) {
+            return srs_error_wrap(err, "snapshot");
+        }
+        if (s.conns <= baseline.conns) {
+            return err;
+        }
+        srs_usleep(SRS_BENCH_RECV_TIMEOUT);
+    }
+    
+    return srs_error_new(ERROR_SOCKET_TIMEOUT, "connections not closed");
+}
+
+// The idle RTMP connection, which is connected and never publish or play.
+void* bench_rtmp_idle(void* arg)
+{
+    SrsBasicRtmpClient* sdk = (SrsBasicRtmpClient*)arg;
+    
+    srs_error_t err = sdk->connect();
+    if (err != srs_success) {
+        nn_failed++;
+        srs_warn("idle failed, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return NULL;
+    }
+    
+    while (!stopping) {
+        srs_usleep(SRS_BENCH_RECV_TIMEOUT);
+    }
+    
+    return NULL;
+}
+
+// The RTMP player, which drops all messages.
+void* bench_rtmp_play(void* arg)
+{
+    SrsBasicRtmpClient* sdk = (SrsBasicRtmpClient*)arg;
+    
+    srs_error_t err = srs_success;
+    if ((err = sdk->connect()) != srs_success || (err = sdk->play(SRS_CONSTS_RTMP_SRS_CHUNK_SIZE)) != srs_success) {
+        nn_failed++;
+        srs_warn("play failed, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return NULL;
+    }
+    
+    sdk->set_recv_timeout(SRS_BENCH_RECV_TIMEOUT);
+    while (!stopping) {
+        SrsCommonMessage* msg = NULL;
+        if ((err = sdk->recv_message(&msg)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                srs_freep(err);
+                continue;
+            }
+            nn_failed++;
+            srs_warn("recv failed, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            break;
+        }
+        srs_freep(msg);
+    }
+    
+    return NULL;
+}
+
+// The HTTP-FLV player, which drops all bytes.
+void* bench_flv_play(void* arg)
+{
+    SrsHttpUri* uri = (SrsHttpUri*)arg;
+    
+    srs_error_t err = srs_success;
+    
+    SrsHttpClient hc;
+    ISrsHttpMessage* msg = NULL;
+    if ((err = hc.initialize(uri->get_host(), uri->get_port(), SRS_BENCH_TIMEOUT)) != srs_success
+        || (err = hc.get(uri->get_path(), "", &msg)) != srs_success) {
+        nn_failed++;
+        srs_warn("flv failed, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return NULL;
+    }
+    SrsAutoFree(ISrsHttpMessage, msg);
+    
+    hc.set_recv_timeout(SRS_BENCH_RECV_TIMEOUT);
+    
+    char buf[SRS_HTTP_READ_CACHE_BYTES];
+    ISrsHttpResponseReader* reader = msg->body_reader();
+    while (!stopping && !reader->eof()) {
+        ssize_t nn = 0;
+        if ((err = reader->read(buf, sizeof(buf), &nn)) != srs_success) {
+            if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                srs_freep(err);
+                continue;
+            }
+            nn_failed++;
+            srs_warn("flv read failed, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            break;
+        }
+    }
+    
+    return NULL;
+}
+
+// Open N connections of a kind, snapshot the memory after settle, then close them.
+srs_error_t bench_run(SrsHttpUri* api, string label, string url, int nn_conns, int settle, SrsMemoryResult& result)
+{
+    srs_error_t err = srs_success;
+    
+    SrsMemorySnapshot baseline;
+    if ((err = bench_snapshot(api, baseline)) != srs_success) {
+        return srs_error_wrap(err, "baseline");
+    }
+    
+    SrsHttpUri uri;
+    if ((err = uri.initialize(url)) != srs_success) {
+        return srs_error_wrap(err, "parse %s", url.c_str());
+    }
+    
+    stopping = false;
+    nn_failed = 0;
+    
+    vector<SrsBasicRtmpClient*> sdks;
+    vector<st_thread_t> trds;
+    for (int i = 0; i < nn_conns; i++) {
+        st_thread_t trd = NULL;
+        if (label == "flv") {
+            trd = st_thread_create(bench_flv_play, &uri, 1, 0);
+        } else {
+            SrsBasicRtmpClient* sdk = new SrsBasicRtmpClient(url, SRS_BENCH_TIMEOUT, SRS_BENCH_TIMEOUT);
+            sdks.push_back(sdk);
+            trd = st_thread_create(label == "idle"? bench_rtmp_idle : bench_rtmp_play, sdk, 1, 0);
+        }
+        if (!trd) {
+            return srs_error_new(ERROR_ST_CREATE_CYCLE_THREAD, "create %s %d", label.c_str(), i);
+        }
+        trds.push_back(trd);
+    }
+    
+    srs_usleep(settle * SRS_UTIME_SECONDS);
+    
+    SrsMemorySnapshot s;
+    err = bench_snapshot(api, s);
+    
+    stopping = true;
+    for (int i = 0; i < (int)trds.size(); i++) {
+        st_thread_join(trds.at(i), NULL);
+    }
+    for (int i = 0; i < (int)sdks.size(); i++) {
+        SrsBasicRtmpClient* sdk = sdks.at(i);
+        srs_freep(sdk);
+    }
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "snapshot");
+    }
+    if (nn_failed > 0) {
+        return srs_error_new(ERROR_SYSTEM_IO_INVALID, "%d of %d %s failed", nn_failed, nn_conns, label.c_str());
+    }
+    
+    result.label = label;
+    result.nn_conns = nn_conns;
+    result.delta.conns = s.conns - baseline.conns;
+    result.delta.rss = (s.rss - baseline.rss) / nn_conns;
+    result.delta.stack = (s.stack - baseline.stack) / nn_conns;
+    result.delta.recv = (s.recv - baseline.recv) / nn_conns;
+    result.delta.queue = (s.queue - baseline.queue) / nn_conns;
+    result.delta.protocol = (s.protocol - baseline.protocol) / nn_conns;
+    result.delta.statistic = (s.statistic - baseline.statistic) / nn_conns;
+    
+    if ((err = bench_wait_closed(api, baseline)) != srs_success) {
+        return srs_error_wrap(err, "wait %s closed", label.c_str());
+    }
+    
+    return err;
+}
+
+void bench_report(vector<SrsMemoryResult>& results)
+{
+    printf("\nbytes per connection:\n");
+    printf("%-12s", "");
+    for (int i = 0; i < (int)results.size(); i++) {
+        printf("%12s", results.at(i).label.c_str());
+    }
+    printf("\n");
+    
+    const char* names[] = {"rss", "stack", "recv", "queue", "protocol", "statistic", "accounted", "other"};
+    for (int j = 0; j < (int)(sizeof(names) / sizeof(names[0])); j++) {
+        printf("%-12s", names[j]);
+        for (int i = 0; i < (int)results.size(); i++) {
+            SrsMemorySnapshot& d = results.at(i).delta;
+            int64_t accounted = d.stack + d.recv + d.queue + d.protocol + d.statistic;
+            int64_t values[] = {d.rss, d.stack, d.recv, d.queue, d.protocol, d.statistic, accounted, d.rss - accounted};
+            printf("%12" PRId64, values[j]);
+        }
+        printf("\n");
+    }
+    
+    printf("%-12s", "conns");
+    for (int i = 0; i < (int)results.size(); i++) {
+        printf("%8d/%-3" PRId64, results.at(i).nn_conns, results.at(i).delta.conns);
+    }
+    printf("\n");
+    printf("note: the subsystems are reserved bytes while rss is resident pages reused by later kinds, so other may be negative.\n");
+}
+
+srs_error_t do_bench(string api_url, string rtmp_url, string flv_url, int nn_conns, int settle)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_st_init()) != srs_success) {
+        return srs_error_wrap(err, "initialize st");
+    }
+    
+    SrsHttpUri api;
+    if ((err = api.initialize(api_url)) != srs_success) {
+        return srs_error_wrap(err, "parse api %s", api_url.c_str());
+    }
+    
+    vector<SrsMemoryResult> results;
+    
+    const char* labels[] = {"idle", "rtmp", "flv"};
+    string urls[] = {rtmp_url, rtmp_url, flv_url};
+    for (int i = 0; i < 3; i++) {
+        if (urls[i].empty()) {
+            continue;
+        }
+    
+        printf("open %d %s connections, settle %ds\n", nn_conns, labels[i], settle);
+    
+        SrsMemoryResult result;
+        if ((err = bench_run(&api, labels[i], urls[i], nn_conns, settle, result)) != srs_success) {
+            return srs_error_wrap(err, "run %s", labels[i]);
+        }
+        results.push_back(result);
+    }
+    
+    bench_report(results);
+    
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    printf("SRS memory bench/%d.%d.%d, the memory per connection of idle RTMP, RTMP and HTTP-FLV players.\n",
+           VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION);
+    
+    string api_url = "http://127.0.0.1:1985";
+    string rtmp_url;
+    string flv_url;
+    int nn_conns = 100;
+    int settle = 3;
+    for (int opt = 0; opt < argc - 1; opt++) {
+        char* p = argv[opt];
+        if (p[0] != '-' || p[1] == 0 || p[2] != 0) {
+            continue;
+        }
+        switch (p[1]) {
+            case 'a': api_url = argv[opt + 1]; break;
+            case 'r': rtmp_url = argv[opt + 1]; break;
+            case 'f': flv_url = argv[opt + 1]; break;
+            case 'n': nn_conns = ::atoi(argv[opt + 1]); break;
+            case 's': settle = ::atoi(argv[opt + 1]); break;
+            default: break;
+        }
+    }
+    
+    if ((rtmp_url.empty() && flv_url.empty()) || nn_conns <= 0 || settle <= 0) {
+        printf("Usage: %s [-a api] <-r rtmp_url> [-f flv_url] [-n conns] [-s settle]\n"
+               "        api         The HTTP API of server. Default to http://127.0.0.1:1985\n"
+               "        rtmp_url    The RTMP stream for idle connections and players, which is published.\n"
+               "        flv_url     The HTTP-FLV stream for players, optional.\n"
+               "        conns       The number of connections of each kind. Default to 100.\n"
+               "        settle      The seconds to wait before snapshot, less than the RTMP timeout 30s. Default to 3.\n"
+               "For example:\n"
+               "        %s -r rtmp://127.0.0.1/live/livestream -f http://127.0.0.1:8080/live/livestream.flv -n 500\n",
+               argv[0], argv[0]);
+        exit(-1);
+    }
+    
+    srs_error_t err = do_bench(api_url, rtmp_url, flv_url, nn_conns, settle);
+    int code = srs_error_code(err);
+    
+    if (err != srs_success) {
+        srs_error("Bench error %s", srs_error_desc(err).c_str());
+    }
+    
+    srs_freep(err);
+    return code;
+}
+
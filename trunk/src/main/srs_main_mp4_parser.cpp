@@ -88,6 +88,27 @@ srs_error_t parse(std::string mp4_file, bool verbose)
         
         stringstream ss;
         fprintf(stderr, "%s", box->dumps(ss, ctx).str().c_str());
+        
+        // Show the samples index of moov, which is used by demuxer.
+        if (box->is_moov()) {
+            SrsMp4MovieBox* moov = dynamic_cast<SrsMp4MovieBox*>(box);
+            
+            SrsMp4SampleIndex samples;
+            if ((err = samples.load(moov)) != srs_success) {
+                return srs_error_wrap(err, "load samples");
+            }
+            
+            SrsMp4TrackSamples* vide = samples.video();
+            SrsMp4TrackSamples* soun = samples.audio();
+            
+            int nn_keyframes = 0;
+            for (uint32_t i = 0; vide && i < vide->size(); i++) {
+                nn_keyframes += vide->keyframes[i]? 1 : 0;
+            }
+            
+            fprintf(stderr, "    samples %d, video %d(%d keyframes), audio %d(adjust %dms)\n", samples.size(),
+                vide? vide->size() : 0, nn_keyframes, soun? soun->size() : 0, soun? soun->adjust : 0);
+        }
     }
     
     return err;
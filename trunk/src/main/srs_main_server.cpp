@@ -49,6 +49,8 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_app_worker.hpp>
+#include <srs_app_upgrade.hpp>
 
 // pre-declare
 srs_error_t run(SrsServer* svr);
@@ -100,6 +102,12 @@ srs_error_t do_main(int argc, char** argv)
 #warning "gmp is not used for memory leak, please use gmc instead."
 #endif
     
+    // Measure the phases of startup, from the process start.
+    _srs_startup->start();
+    
+    // Save the command line to exec the new binary for upgrade, before chdir to work_dir.
+    _srs_upgrade->set_argv(argc, argv);
+    
     // never use srs log(srs_trace, srs_error, etc) before config parse the option,
     // which will load the log config and apply it.
     if ((err = _srs_config->parse_options(argc, argv)) != srs_success) {
@@ -177,6 +185,7 @@ srs_error_t do_main(int argc, char** argv)
     if ((err = _srs_config->check_config()) != srs_success) {
         return srs_error_wrap(err, "check config");
     }
+    _srs_startup->on_phase("config");
     
     // features
     show_macro_features();
@@ -396,6 +405,7 @@ srs_error_t run(SrsServer* svr)
     if ((err = svr->initialize(NULL)) != srs_success) {
         return srs_error_wrap(err, "server initialize");
     }
+    _srs_startup->on_phase("initialize");
 
     // Load daemon from config, disable it for docker.
     // @see https://github.com/ossrs/srs/issues/1594
@@ -404,6 +414,13 @@ srs_error_t run(SrsServer* svr)
         srs_warn("disable daemon for docker");
         in_daemon = false;
     }
+    
+    // For gracefully upgrade, the old process waits on the pid of new process, and it's already
+    // detached, so the new process should never fork again.
+    if (in_daemon && _srs_upgrade->upgrading()) {
+        srs_trace("disable daemon for upgrade");
+        in_daemon = false;
+    }
 
     // If not daemon, directly run master.
     if (!in_daemon) {
@@ -455,22 +472,49 @@ srs_error_t run_master(SrsServer* svr)
 {
     srs_error_t err = srs_success;
     
+    // Fork workers before initialize ST, because the epoll fd can not be shared by processes.
+    // The master holds the pid file, only the workers continue to run the server.
+    if (_srs_config->get_workers_enabled()) {
+        if ((err = svr->acquire_pid_file()) != srs_success) {
+            return srs_error_wrap(err, "acquire pid file");
+        }
+        
+        SrsWorkerMaster master;
+        if ((err = master.run()) != srs_success) {
+            return srs_error_wrap(err, "workers");
+        }
+    }
+    
     if ((err = svr->initialize_st()) != srs_success) {
         return srs_error_wrap(err, "initialize st");
     }
+    _srs_startup->on_phase("st");
     
     if ((err = svr->initialize_signal()) != srs_success) {
         return srs_error_wrap(err, "initialize signal");
     }
     
-    if ((err = svr->acquire_pid_file()) != srs_success) {
-        return srs_error_wrap(err, "acquire pid file");
+    if (_srs_worker_index < 0) {
+        if ((err = svr->acquire_pid_file()) != srs_success) {
+            return srs_error_wrap(err, "acquire pid file");
+        }
+    }
+    
+    // For gracefully upgrade, the listeners are inherited from the old process.
+    if ((err = _srs_upgrade->inherit()) != srs_success) {
+        return srs_error_wrap(err, "upgrade inherit");
     }
     
     if ((err = svr->listen()) != srs_success) {
         return srs_error_wrap(err, "listen");
     }
     
+    // Notify the old process to stop accepting, the new process accepts right now.
+    if ((err = _srs_upgrade->ready()) != srs_success) {
+        return srs_error_wrap(err, "upgrade ready");
+    }
+    _srs_startup->on_phase("listen");
+    
     if ((err = svr->register_signal()) != srs_success) {
         return srs_error_wrap(err, "register signal");
     }
@@ -478,10 +522,13 @@ srs_error_t run_master(SrsServer* svr)
     if ((err = svr->http_handle()) != srs_success) {
         return srs_error_wrap(err, "http handle");
     }
+    _srs_startup->on_phase("http");
     
     if ((err = svr->ingest()) != srs_success) {
         return srs_error_wrap(err, "ingest");
     }
+    _srs_startup->on_phase("ingest");
+    _srs_startup->on_ready();
     
     if ((err = svr->cycle()) != srs_success) {
         return srs_error_wrap(err, "main cycle");
@@ -0,0 +1,450 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_http2_stack.hpp>
+
+#include <string.h>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+
+SrsHttp2FrameHeader::SrsHttp2FrameHeader()
+{
+    length = 0;
+    type = 0;
+    flags = 0;
+    stream_id = 0;
+}
+
+SrsHttp2FrameHeader::SrsHttp2FrameHeader(int l, uint8_t t, uint8_t f, uint32_t id)
+{
+    length = l;
+    type = t;
+    flags = f;
+    stream_id = id;
+}
+
+SrsHttp2FrameHeader::~SrsHttp2FrameHeader()
+{
+}
+
+void SrsHttp2FrameHeader::decode(const char* p)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    length = (b[0] << 16) | (b[1] << 8) | b[2];
+    type = b[3];
+    flags = b[4];
+    // Ignore the reserved bit.
+    stream_id = ((uint32_t)(b[5] & 0x7f) << 24) | (b[6] << 16) | (b[7] << 8) | b[8];
+}
+
+void SrsHttp2FrameHeader::encode(char* p)
+{
+    uint8_t* b = (uint8_t*)p;
+    b[0] = (uint8_t)(length >> 16);
+    b[1] = (uint8_t)(length >> 8);
+    b[2] = (uint8_t)length;
+    b[3] = type;
+    b[4] = flags;
+    b[5] = (uint8_t)((stream_id >> 24) & 0x7f);
+    b[6] = (uint8_t)(stream_id >> 16);
+    b[7] = (uint8_t)(stream_id >> 8);
+    b[8] = (uint8_t)stream_id;
+}
+
+// The static table, see RFC7541 appendix A.
+#define SRS_HPACK_STATIC_TABLE_SIZE 61
+static const char* srs_hpack_static_table[SRS_HPACK_STATIC_TABLE_SIZE][2] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+    {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+    {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+    {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+    {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""},
+    {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""},
+    {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""},
+    {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+    {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""},
+    {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+    {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+};
+
+// The bits of code of each symbol, the last is EOS, see RFC7541 appendix B.
+// @remark The code is canonical, that is, the codes of same length are consecutive in order of symbol,
+//      so we build the codes by the lengths, rather than the table of codes.
+#define SRS_HPACK_HUFFMAN_SYMBOLS 257
+#define SRS_HPACK_HUFFMAN_EOS 256
+#define SRS_HPACK_HUFFMAN_MAX_BITS 30
+static const uint8_t srs_hpack_huffman_bits[SRS_HPACK_HUFFMAN_SYMBOLS] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+// The canonical code, built from the bits of symbols.
+struct SrsHpackHuffmanCode
+{
+    // The number of codes of each length.
+    int count[SRS_HPACK_HUFFMAN_MAX_BITS + 1];
+    // The first code of each length.
+    uint32_t first[SRS_HPACK_HUFFMAN_MAX_BITS + 1];
+    // The index in symbols of the first code of each length.
+    int offset[SRS_HPACK_HUFFMAN_MAX_BITS + 1];
+    // The symbols in order of code.
+    uint16_t symbols[SRS_HPACK_HUFFMAN_SYMBOLS];
+    
+    SrsHpackHuffmanCode() {
+        memset(count, 0, sizeof(count));
+        for (int i = 0; i < SRS_HPACK_HUFFMAN_SYMBOLS; i++) {
+            count[srs_hpack_huffman_bits[i]]++;
+        }
+        
+        uint32_t code = 0;
+        int index = 0;
+        for (int bits = 1; bits <= SRS_HPACK_HUFFMAN_MAX_BITS; bits++) {
+            code = (code + (bits > 1? count[bits - 1] : 0)) << 1;
+            first[bits] = code;
+            offset[bits] = index;
+            for (int i = 0; i < SRS_HPACK_HUFFMAN_SYMBOLS; i++) {
+                if (srs_hpack_huffman_bits[i] == bits) {
+                    symbols[index++] = (uint16_t)i;
+                }
+            }
+        }
+    }
+};
+
+srs_error_t srs_hpack_huffman_decode(const char* data, int size, string& out)
+{
+    // Only used by the thread of connection, so the lazy initialization is safe.
+    static SrsHpackHuffmanCode hc;
+    
+    uint32_t code = 0;
+    int bits = 0;
+    for (int i = 0; i < size; i++) {
+        uint8_t v = (uint8_t)data[i];
+        for (int j = 7; j >= 0; j--) {
+            code = (code << 1) | ((v >> j) & 0x01);
+            bits++;
+            
+            if (bits > SRS_HPACK_HUFFMAN_MAX_BITS) {
+                return srs_error_new(ERROR_HTTP2_HPACK, "huffman code overflow");
+            }
+            
+            // The code of this length is [first, first+count).
+            uint32_t delta = code - hc.first[bits];
+            if (code < hc.first[bits] || delta >= (uint32_t)hc.count[bits]) {
+                continue;
+            }
+            
+            uint16_t symbol = hc.symbols[hc.offset[bits] + delta];
+            if (symbol == SRS_HPACK_HUFFMAN_EOS) {
+                return srs_error_new(ERROR_HTTP2_HPACK, "huffman EOS");
+            }
+            
+            out.push_back((char)symbol);
+            code = 0;
+            bits = 0;
+        }
+    }
+    
+    // The padding is the most significant bits of EOS, which is all ones, less than a byte.
+    if (bits > 7 || code != (uint32_t)((1 << bits) - 1)) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "huffman padding bits=%d", bits);
+    }
+    
+    return srs_success;
+}
+
+// Decode the integer with prefix bits, see RFC7541 section 5.1.
+static srs_error_t srs_hpack_decode_integer(const uint8_t*& p, const uint8_t* end, int prefix, int& v)
+{
+    if (p >= end) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "integer empty");
+    }
+    
+    int mask = (1 << prefix) - 1;
+    v = *p++ & mask;
+    if (v < mask) {
+        return srs_success;
+    }
+    
+    for (int shift = 0; ; shift += 7) {
+        if (p >= end) {
+            return srs_error_new(ERROR_HTTP2_HPACK, "integer incomplete");
+        }
+        // Never exceeds the int, which is large enough for any field or table size.
+        if (shift > 21) {
+            return srs_error_new(ERROR_HTTP2_HPACK, "integer overflow");
+        }
+        
+        uint8_t b = *p++;
+        v += (b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+    }
+    
+    return srs_success;
+}
+
+// Decode the string literal, see RFC7541 section 5.2.
+static srs_error_t srs_hpack_decode_string(const uint8_t*& p, const uint8_t* end, string& v)
+{
+    srs_error_t err = srs_success;
+    
+    if (p >= end) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "string empty");
+    }
+    bool huffman = (*p & 0x80) != 0;
+    
+    int size = 0;
+    if ((err = srs_hpack_decode_integer(p, end, 7, size)) != srs_success) {
+        return srs_error_wrap(err, "string length");
+    }
+    if (size > end - p) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "string size=%d, left=%d", size, (int)(end - p));
+    }
+    
+    v.clear();
+    if (huffman) {
+        if ((err = srs_hpack_huffman_decode((const char*)p, size, v)) != srs_success) {
+            return srs_error_wrap(err, "huffman");
+        }
+    } else {
+        v.assign((const char*)p, size);
+    }
+    p += size;
+    
+    return err;
+}
+
+// Encode the integer with prefix bits, the flags is the high bits of first byte.
+static void srs_hpack_encode_integer(string& block, uint8_t flags, int prefix, int v)
+{
+    int mask = (1 << prefix) - 1;
+    if (v < mask) {
+        block.push_back((char)(flags | v));
+        return;
+    }
+    
+    block.push_back((char)(flags | mask));
+    for (v -= mask; v >= 0x80; v >>= 7) {
+        block.push_back((char)((v & 0x7f) | 0x80));
+    }
+    block.push_back((char)v);
+}
+
+static void srs_hpack_encode_string(string& block, const string& v)
+{
+    srs_hpack_encode_integer(block, 0x00, 7, (int)v.length());
+    block.append(v);
+}
+
+SrsHpackDecoder::SrsHpackDecoder()
+{
+    size = 0;
+    max_size = limit = SRS_HTTP2_DEFAULT_TABLE_SIZE;
+}
+
+SrsHpackDecoder::~SrsHpackDecoder()
+{
+}
+
+srs_error_t SrsHpackDecoder::decode(const char* data, int nb_data, vector<pair<string, string> >& fields)
+{
+    srs_error_t err = srs_success;
+    
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + nb_data;
+    
+    while (p < end) {
+        uint8_t b = *p;
+        
+        // Indexed header field, see RFC7541 section 6.1.
+        if (b & 0x80) {
+            int index = 0;
+            if ((err = srs_hpack_decode_integer(p, end, 7, index)) != srs_success) {
+                return srs_error_wrap(err, "indexed");
+            }
+            
+            pair<string, string> field;
+            if ((err = lookup(index, field)) != srs_success) {
+                return srs_error_wrap(err, "indexed");
+            }
+            fields.push_back(field);
+            continue;
+        }
+        
+        // Dynamic table size update, see RFC7541 section 6.3.
+        if ((b & 0xe0) == 0x20) {
+            int v = 0;
+            if ((err = srs_hpack_decode_integer(p, end, 5, v)) != srs_success) {
+                return srs_error_wrap(err, "table size");
+            }
+            if (v > limit) {
+                return srs_error_new(ERROR_HTTP2_HPACK, "table size=%d exceeds %d", v, limit);
+            }
+            max_size = v;
+            evict(0);
+            continue;
+        }
+        
+        // Literal header field with incremental indexing, or without indexing and never indexed,
+        // see RFC7541 section 6.2.
+        bool indexing = (b & 0xc0) == 0x40;
+        int index = 0;
+        if ((err = srs_hpack_decode_integer(p, end, indexing? 6 : 4, index)) != srs_success) {
+            return srs_error_wrap(err, "literal");
+        }
+        
+        pair<string, string> field;
+        if (index) {
+            if ((err = lookup(index, field)) != srs_success) {
+                return srs_error_wrap(err, "literal name");
+            }
+        } else if ((err = srs_hpack_decode_string(p, end, field.first)) != srs_success) {
+            return srs_error_wrap(err, "literal name");
+        }
+        
+        if ((err = srs_hpack_decode_string(p, end, field.second)) != srs_success) {
+            return srs_error_wrap(err, "literal value");
+        }
+        
+        if (indexing) {
+            insert(field.first, field.second);
+        }
+        fields.push_back(field);
+    }
+    
+    return err;
+}
+
+int SrsHpackDecoder::table_size()
+{
+    return size;
+}
+
+srs_error_t SrsHpackDecoder::lookup(int index, pair<string, string>& field)
+{
+    if (index <= 0) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "invalid index=%d", index);
+    }
+    
+    if (index <= SRS_HPACK_STATIC_TABLE_SIZE) {
+        field.first = srs_hpack_static_table[index - 1][0];
+        field.second = srs_hpack_static_table[index - 1][1];
+        return srs_success;
+    }
+    
+    index -= SRS_HPACK_STATIC_TABLE_SIZE + 1;
+    if (index >= (int)table.size()) {
+        return srs_error_new(ERROR_HTTP2_HPACK, "invalid index=%d, table=%d", index + SRS_HPACK_STATIC_TABLE_SIZE + 1, (int)table.size());
+    }
+    
+    field = table[index];
+    return srs_success;
+}
+
+void SrsHpackDecoder::insert(const string& name, const string& value)
+{
+    // The size of entry, see RFC7541 section 4.1.
+    int required = (int)(name.length() + value.length() + 32);
+    
+    // The entry larger than table empties the table, see RFC7541 section 4.4.
+    if (required > max_size) {
+        table.clear();
+        size = 0;
+        return;
+    }
+    
+    evict(required);
+    table.push_front(make_pair(name, value));
+    size += required;
+}
+
+void SrsHpackDecoder::evict(int required)
+{
+    while (!table.empty() && size + required > max_size) {
+        pair<string, string>& field = table.back();
+        size -= (int)(field.first.length() + field.second.length() + 32);
+        table.pop_back();
+    }
+}
+
+void srs_hpack_encode(const vector<pair<string, string> >& fields, string& block)
+{
+    vector<pair<string, string> >::const_iterator it;
+    for (it = fields.begin(); it != fields.end(); ++it) {
+        const string& name = it->first;
+        const string& value = it->second;
+        
+        // Find the index of field, or the index of name in static table.
+        int index = 0;
+        bool indexed = false;
+        for (int i = 0; i < SRS_HPACK_STATIC_TABLE_SIZE; i++) {
+            if (name != srs_hpack_static_table[i][0]) {
+                continue;
+            }
+            if (!index) {
+                index = i + 1;
+            }
+            if (value == srs_hpack_static_table[i][1]) {
+                index = i + 1;
+                indexed = true;
+                break;
+            }
+        }
+        
+        // Indexed header field, for example, the ":status 200".
+        if (indexed) {
+            srs_hpack_encode_integer(block, 0x80, 7, index);
+            continue;
+        }
+        
+        // Literal header field without indexing, with indexed name or new name.
+        srs_hpack_encode_integer(block, 0x00, 4, index);
+        if (!index) {
+            srs_hpack_encode_string(block, name);
+        }
+        srs_hpack_encode_string(block, value);
+    }
+}
+
@@ -0,0 +1,156 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_PROTOCOL_HTTP2_HPP
+#define SRS_PROTOCOL_HTTP2_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+
+// The connection preface of client, see RFC7540 section 3.5.
+#define SRS_HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define SRS_HTTP2_PREFACE_SIZE 24
+
+// The size of frame header, see RFC7540 section 4.1.
+#define SRS_HTTP2_FRAME_HEADER_SIZE 9
+
+// The initial values of settings, see RFC7540 section 6.5.2.
+#define SRS_HTTP2_DEFAULT_WINDOW 65535
+#define SRS_HTTP2_DEFAULT_FRAME_SIZE 16384
+#define SRS_HTTP2_MAX_FRAME_SIZE 16777215
+#define SRS_HTTP2_MAX_WINDOW 2147483647
+#define SRS_HTTP2_DEFAULT_TABLE_SIZE 4096
+
+// The type of frame, see RFC7540 section 6.
+enum SrsHttp2FrameType
+{
+    SrsHttp2FrameTypeData = 0x00,
+    SrsHttp2FrameTypeHeaders = 0x01,
+    SrsHttp2FrameTypePriority = 0x02,
+    SrsHttp2FrameTypeRstStream = 0x03,
+    SrsHttp2FrameTypeSettings = 0x04,
+    SrsHttp2FrameTypePushPromise = 0x05,
+    SrsHttp2FrameTypePing = 0x06,
+    SrsHttp2FrameTypeGoaway = 0x07,
+    SrsHttp2FrameTypeWindowUpdate = 0x08,
+    SrsHttp2FrameTypeContinuation = 0x09,
+};
+
+// The flags of frame, the END_STREAM and ACK share the same bit.
+#define SRS_HTTP2_FLAG_END_STREAM 0x01
+#define SRS_HTTP2_FLAG_ACK 0x01
+#define SRS_HTTP2_FLAG_END_HEADERS 0x04
+#define SRS_HTTP2_FLAG_PADDED 0x08
+#define SRS_HTTP2_FLAG_PRIORITY 0x20
+
+// The parameters of SETTINGS, see RFC7540 section 6.5.2.
+enum SrsHttp2Setting
+{
+    SrsHttp2SettingHeaderTableSize = 0x01,
+    SrsHttp2SettingEnablePush = 0x02,
+    SrsHttp2SettingMaxConcurrentStreams = 0x03,
+    SrsHttp2SettingInitialWindowSize = 0x04,
+    SrsHttp2SettingMaxFrameSize = 0x05,
+    SrsHttp2SettingMaxHeaderListSize = 0x06,
+};
+
+// The error codes of RST_STREAM and GOAWAY, see RFC7540 section 7.
+enum SrsHttp2ErrorCode
+{
+    SrsHttp2ErrorNo = 0x00,
+    SrsHttp2ErrorProtocol = 0x01,
+    SrsHttp2ErrorInternal = 0x02,
+    SrsHttp2ErrorFlowControl = 0x03,
+    SrsHttp2ErrorStreamClosed = 0x05,
+    SrsHttp2ErrorFrameSize = 0x06,
+    SrsHttp2ErrorRefusedStream = 0x07,
+    SrsHttp2ErrorCancel = 0x08,
+    SrsHttp2ErrorCompression = 0x09,
+    SrsHttp2ErrorHttp11Required = 0x0d,
+};
+
+// The header of HTTP/2 frame, see RFC7540 section 4.1.
+//      +-----------------------------------------------+
+//      |                 Length (24)                   |
+//      +---------------+---------------+---------------+
+//      |   Type (8)    |   Flags (8)   |
+//      +-+-------------+---------------+-------------------------------+
+//      |R|                 Stream Identifier (31)                      |
+//      +=+=============================================================+
+class SrsHttp2FrameHeader
+{
+public:
+    int length;
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+public:
+    SrsHttp2FrameHeader();
+    SrsHttp2FrameHeader(int l, uint8_t t, uint8_t f, uint32_t id);
+    virtual ~SrsHttp2FrameHeader();
+public:
+    // Decode from the bytes, which must be SRS_HTTP2_FRAME_HEADER_SIZE bytes.
+    virtual void decode(const char* p);
+    // Encode to the bytes, which must be SRS_HTTP2_FRAME_HEADER_SIZE bytes.
+    virtual void encode(char* p);
+};
+
+// The HPACK decoder of a connection, which owns the dynamic table, see RFC7541.
+// @remark The header block must be complete, that is, the HEADERS and all CONTINUATION frames.
+class SrsHpackDecoder
+{
+private:
+    // The dynamic table, the newest field at front, which is index 62.
+    std::deque<std::pair<std::string, std::string> > table;
+    // The size of dynamic table, sum of name, value and 32 bytes of each field.
+    int size;
+    // The max size updated by encoder, which never exceeds the limit.
+    int max_size;
+    // The limit of size, which is the SETTINGS_HEADER_TABLE_SIZE of us.
+    int limit;
+public:
+    SrsHpackDecoder();
+    virtual ~SrsHpackDecoder();
+public:
+    // Decode the header block to fields in order, the name is in lower case for HTTP/2.
+    virtual srs_error_t decode(const char* data, int size, std::vector<std::pair<std::string, std::string> >& fields);
+    // The size of dynamic table, for utest.
+    virtual int table_size();
+private:
+    virtual srs_error_t lookup(int index, std::pair<std::string, std::string>& field);
+    virtual void insert(const std::string& name, const std::string& value);
+    virtual void evict(int required);
+};
+
+// Encode the fields to header block, by the static table and literals without indexing,
+// so the encoder is stateless, and the peer never needs to track our dynamic table.
+extern void srs_hpack_encode(const std::vector<std::pair<std::string, std::string> >& fields, std::string& block);
+
+// Decode the string by the static Huffman code, see RFC7541 section 5.2 and appendix B.
+extern srs_error_t srs_hpack_huffman_decode(const char* data, int size, std::string& out);
+
+#endif
+
@@ -26,6 +26,7 @@
 #if !defined(SRS_EXPORT_LIBRTMP)
 
 #include <stdlib.h>
+#include <strings.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -37,6 +38,9 @@ using namespace std;
 #include <srs_protocol_json.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
 // @see ISrsHttpMessage._http_ts_send_buffer
@@ -124,6 +128,35 @@ string srs_go_http_detect(char* data, int size)
     return "application/octet-stream"; // fallback
 }
 
+bool srs_http_accept_encoding(string accept_encoding, string coding)
+{
+    bool wildcard = false;
+    
+    vector<string> codings = srs_string_split(accept_encoding, ",");
+    for (int i = 0; i < (int)codings.size(); i++) {
+        vector<string> params = srs_string_split(codings.at(i), ";");
+        string name = srs_string_trim_end(srs_string_trim_start(params.at(0), " \t"), " \t");
+        
+        double q = 1.0;
+        for (int j = 1; j < (int)params.size(); j++) {
+            string param = srs_string_trim_start(params.at(j), " \t");
+            if (srs_string_starts_with(param, "q=")) {
+                q = ::atof(param.substr(2).c_str());
+            }
+        }
+        
+        // The explicit coding overwrites the wildcard.
+        if (strcasecmp(name.c_str(), coding.c_str()) == 0) {
+            return q > 0;
+        }
+        if (name == "*") {
+            wildcard = q > 0;
+        }
+    }
+    
+    return wildcard;
+}
+
 srs_error_t srs_go_http_error(ISrsHttpResponseWriter* w, int code)
 {
     return srs_go_http_error(w, code, srs_generate_http_status_text(code));
@@ -152,16 +185,25 @@ SrsHttpHeader::~SrsHttpHeader()
 {
 }
 
-void SrsHttpHeader::set(string key, string value)
+void SrsHttpHeader::set(const string& key, const string& value)
 {
-    headers[key] = value;
+    vector<pair<string, string> >::iterator it = find(key);
+    if (it != headers.end()) {
+        it->second = value;
+        return;
+    }
+
+    if (headers.capacity() == 0) {
+        headers.reserve(SRS_HTTP_HEADER_RESERVED);
+    }
+    headers.push_back(make_pair(key, value));
 }
 
-string SrsHttpHeader::get(string key)
+string SrsHttpHeader::get(const string& key)
 {
     std::string v;
 
-    map<string, string>::iterator it = headers.find(key);
+    vector<pair<string, string> >::iterator it = find(key);
     if (it != headers.end()) {
         v = it->second;
     }
@@ -169,9 +211,9 @@ string SrsHttpHeader::get(string key)
     return v;
 }
 
-void SrsHttpHeader::del(string key)
+void SrsHttpHeader::del(const string& key)
 {
-    map<string, string>::iterator it = headers.find(key);
+    vector<pair<string, string> >::iterator it = find(key);
     if (it != headers.end()) {
         headers.erase(it);
     }
@@ -182,15 +224,35 @@ int SrsHttpHeader::count()
     return (int)headers.size();
 }
 
+void SrsHttpHeader::clear()
+{
+    headers.clear();
+}
+
+vector<pair<string, string> >::iterator SrsHttpHeader::find(const string& key)
+{
+    vector<pair<string, string> >::iterator it;
+    for (it = headers.begin(); it != headers.end(); ++it) {
+        if (it->first == key) {
+            break;
+        }
+    }
+    return it;
+}
+
 void SrsHttpHeader::dumps(SrsJsonObject* o)
 {
-    map<string, string>::iterator it;
+    vector<pair<string, string> >::iterator it;
     for (it = headers.begin(); it != headers.end(); ++it) {
-        string v = it->second;
-        o->set(it->first, SrsJsonAny::str(v.c_str()));
+        o->set(it->first, SrsJsonAny::str(it->second.c_str()));
     }
 }
 
+const vector<pair<string, string> >& SrsHttpHeader::fields()
+{
+    return headers;
+}
+
 int64_t SrsHttpHeader::content_length()
 {
     std::string cl = get("Content-Length");
@@ -219,7 +281,7 @@ void SrsHttpHeader::set_content_type(string ct)
 
 void SrsHttpHeader::write(stringstream& ss)
 {
-    map<string, string>::iterator it;
+    vector<pair<string, string> >::iterator it;
     for (it = headers.begin(); it != headers.end(); ++it) {
         ss << it->first << ": " << it->second << SRS_HTTP_CRLF;
     }
@@ -233,6 +295,14 @@ ISrsHttpResponseWriter::~ISrsHttpResponseWriter()
 {
 }
 
+ISrsHttpSendfileWriter::ISrsHttpSendfileWriter()
+{
+}
+
+ISrsHttpSendfileWriter::~ISrsHttpSendfileWriter()
+{
+}
+
 ISrsHttpResponseReader::ISrsHttpResponseReader()
 {
 }
@@ -333,6 +403,52 @@ string srs_http_fs_fullpath(string dir, string pattern, string upath)
     return fullpath;
 }
 
+string srs_http_fs_mime(string fullpath)
+{
+    static std::map<std::string, std::string> _mime;
+    if (_mime.empty()) {
+        _mime[".ts"] = "video/MP2T";
+        _mime[".flv"] = "video/x-flv";
+        _mime[".m4v"] = "video/x-m4v";
+        _mime[".3gpp"] = "video/3gpp";
+        _mime[".3gp"] = "video/3gpp";
+        _mime[".mp4"] = "video/mp4";
+        _mime[".aac"] = "audio/x-aac";
+        _mime[".mp3"] = "audio/mpeg";
+        _mime[".m4a"] = "audio/x-m4a";
+        _mime[".ogg"] = "audio/ogg";
+        // @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 5.
+        _mime[".m3u8"] = "application/vnd.apple.mpegurl"; // application/x-mpegURL
+        _mime[".rss"] = "application/rss+xml";
+        _mime[".json"] = "application/json";
+        _mime[".swf"] = "application/x-shockwave-flash";
+        _mime[".doc"] = "application/msword";
+        _mime[".zip"] = "application/zip";
+        _mime[".rar"] = "application/x-rar-compressed";
+        _mime[".xml"] = "text/xml";
+        _mime[".html"] = "text/html";
+        _mime[".js"] = "text/javascript";
+        _mime[".css"] = "text/css";
+        _mime[".ico"] = "image/x-icon";
+        _mime[".png"] = "image/png";
+        _mime[".jpeg"] = "image/jpeg";
+        _mime[".jpg"] = "image/jpeg";
+        _mime[".gif"] = "image/gif";
+        // For MPEG-DASH.
+        //_mime[".mpd"] = "application/dash+xml";
+        _mime[".mpd"] = "text/xml";
+        _mime[".m4s"] = "video/iso.segment";
+        _mime[".mp4v"] = "video/mp4";
+    }
+    
+    std::string ext = srs_path_filext(fullpath);
+    std::map<std::string, std::string>::iterator it = _mime.find(ext);
+    if (it == _mime.end()) {
+        return "application/octet-stream";
+    }
+    return it->second;
+}
+
 SrsHttpFileServer::SrsHttpFileServer(string root_dir)
 {
     dir = root_dir;
@@ -401,51 +517,7 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
     // unset the content length to encode in chunked encoding.
     w->header()->set_content_length(length);
     
-    static std::map<std::string, std::string> _mime;
-    if (_mime.empty()) {
-        _mime[".ts"] = "video/MP2T";
-        _mime[".flv"] = "video/x-flv";
-        _mime[".m4v"] = "video/x-m4v";
-        _mime[".3gpp"] = "video/3gpp";
-        _mime[".3gp"] = "video/3gpp";
-        _mime[".mp4"] = "video/mp4";
-        _mime[".aac"] = "audio/x-aac";
-        _mime[".mp3"] = "audio/mpeg";
-        _mime[".m4a"] = "audio/x-m4a";
-        _mime[".ogg"] = "audio/ogg";
-        // @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 5.
-        _mime[".m3u8"] = "application/vnd.apple.mpegurl"; // application/x-mpegURL
-        _mime[".rss"] = "application/rss+xml";
-        _mime[".json"] = "application/json";
-        _mime[".swf"] = "application/x-shockwave-flash";
-        _mime[".doc"] = "application/msword";
-        _mime[".zip"] = "application/zip";
-        _mime[".rar"] = "application/x-rar-compressed";
-        _mime[".xml"] = "text/xml";
-        _mime[".html"] = "text/html";
-        _mime[".js"] = "text/javascript";
-        _mime[".css"] = "text/css";
-        _mime[".ico"] = "image/x-icon";
-        _mime[".png"] = "image/png";
-        _mime[".jpeg"] = "image/jpeg";
-        _mime[".jpg"] = "image/jpeg";
-        _mime[".gif"] = "image/gif";
-        // For MPEG-DASH.
-        //_mime[".mpd"] = "application/dash+xml";
-        _mime[".mpd"] = "text/xml";
-        _mime[".m4s"] = "video/iso.segment";
-        _mime[".mp4v"] = "video/mp4";
-    }
-    
-    if (true) {
-        std::string ext = srs_path_filext(fullpath);
-        
-        if (_mime.find(ext) == _mime.end()) {
-            w->header()->set_content_type("application/octet-stream");
-        } else {
-            w->header()->set_content_type(_mime[ext]);
-        }
-    }
+    w->header()->set_content_type(srs_http_fs_mime(fullpath));
 
     // Enter chunked mode, because we didn't set the content-length.
     w->write_header(SRS_CONSTS_HTTP_OK);
@@ -465,6 +537,15 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
 
 srs_error_t SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
+    // For time based seek, in seconds, for example, x.flv?starttime=60.5
+    std::string starttime = r->query_get("starttime");
+    if (!starttime.empty()) {
+        srs_utime_t v = (srs_utime_t)(::atof(starttime.c_str()) * SRS_UTIME_SECONDS);
+        if (v > 0) {
+            return serve_flv_seek(w, r, fullpath, v);
+        }
+    }
+    
     std::string start = r->query_get("start");
     if (start.empty()) {
         return serve_file(w, r, fullpath);
@@ -480,6 +561,15 @@ srs_error_t SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHtt
 
 srs_error_t SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
+    // For time based seek, in seconds, for example, x.mp4?start=60.5
+    std::string starttime = r->query_get("start");
+    if (!starttime.empty()) {
+        srs_utime_t v = (srs_utime_t)(::atof(starttime.c_str()) * SRS_UTIME_SECONDS);
+        if (v > 0) {
+            return serve_mp4_seek(w, r, fullpath, v);
+        }
+    }
+    
     // for flash to request mp4 range in query string.
     std::string range = r->query_get("range");
     // or, use bytes to request range.
@@ -529,6 +619,12 @@ srs_error_t SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsH
     return serve_file(w, r, fullpath);
 }
 
+srs_error_t SrsHttpFileServer::serve_flv_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t starttime)
+{
+    // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
+    return serve_file(w, r, fullpath);
+}
+
 srs_error_t SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int start, int end)
 {
     // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
@@ -536,10 +632,27 @@ srs_error_t SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsH
     return serve_file(w, r, fullpath);
 }
 
+srs_error_t SrsHttpFileServer::serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t starttime)
+{
+    // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
+    return serve_file(w, r, fullpath);
+}
+
 srs_error_t SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size)
 {
     srs_error_t err = srs_success;
     
+    // Send the file in kernel, without copy to user space.
+    ISrsHttpSendfileWriter* sw = dynamic_cast<ISrsHttpSendfileWriter*>(w);
+    if (sw && fs->get_fd() >= 0 && sw->sendfile_enabled()) {
+        int64_t offset = fs->tellg();
+        if ((err = sw->sendfile(fs->get_fd(), offset, size)) != srs_success) {
+            return srs_error_wrap(err, "sendfile offset=%d, size=%d", (int)offset, size);
+        }
+        fs->seek2(offset + size);
+        return err;
+    }
+    
     int left = size;
     char* buf = new char[SRS_HTTP_TS_SEND_BUFFER_SIZE];
     SrsAutoFreeA(char, buf);
@@ -572,6 +685,95 @@ SrsHttpMuxEntry::~SrsHttpMuxEntry()
     srs_freep(handler);
 }
 
+SrsHttpMuxNode::SrsHttpMuxNode()
+{
+    exact = dir = NULL;
+}
+
+SrsHttpMuxNode::~SrsHttpMuxNode()
+{
+    std::map<std::string, SrsHttpMuxNode*>::iterator it;
+    for (it = children.begin(); it != children.end(); ++it) {
+        SrsHttpMuxNode* node = it->second;
+        srs_freep(node);
+    }
+    children.clear();
+}
+
+void SrsHttpMuxNode::set(string pattern, SrsHttpMuxEntry* entry)
+{
+    SrsHttpMuxNode* node = this;
+    
+    // The pattern ends with '/' is the dir entry of its parent segment.
+    bool is_dir = !pattern.empty() && pattern.at(pattern.length() - 1) == '/';
+    size_t end = is_dir? pattern.length() - 1 : pattern.length();
+    
+    size_t pos = 0;
+    while (true) {
+        size_t next = pattern.find('/', pos);
+        if (next == string::npos || next > end) {
+            next = end;
+        }
+        
+        string segment = pattern.substr(pos, next - pos);
+        std::map<std::string, SrsHttpMuxNode*>::iterator it = node->children.find(segment);
+        if (it != node->children.end()) {
+            node = it->second;
+        } else {
+            SrsHttpMuxNode* child = new SrsHttpMuxNode();
+            node->children[segment] = child;
+            node = child;
+        }
+        
+        if (next >= end) {
+            break;
+        }
+        pos = next + 1;
+    }
+    
+    if (is_dir) {
+        node->dir = entry;
+    } else {
+        node->exact = entry;
+    }
+}
+
+SrsHttpMuxEntry* SrsHttpMuxNode::match(const string& path)
+{
+    SrsHttpMuxEntry* matched = NULL;
+    SrsHttpMuxNode* node = this;
+    
+    size_t pos = 0;
+    while (true) {
+        size_t next = path.find('/', pos);
+        if (next == string::npos) {
+            next = path.length();
+        }
+        
+        std::map<std::string, SrsHttpMuxNode*>::iterator it = node->children.find(path.substr(pos, next - pos));
+        if (it == node->children.end()) {
+            break;
+        }
+        node = it->second;
+        
+        // Exact match is always the longest one.
+        if (next == path.length()) {
+            if (node->exact && node->exact->enabled) {
+                matched = node->exact;
+            }
+            break;
+        }
+        
+        // The dir matches all paths under it, the deeper is the longer.
+        if (node->dir && node->dir->enabled) {
+            matched = node->dir;
+        }
+        pos = next + 1;
+    }
+    
+    return matched;
+}
+
 ISrsHttpMatchHijacker::ISrsHttpMatchHijacker()
 {
 }
@@ -590,10 +792,13 @@ ISrsHttpServeMux::~ISrsHttpServeMux()
 
 SrsHttpServeMux::SrsHttpServeMux()
 {
+    root = new SrsHttpMuxNode();
 }
 
 SrsHttpServeMux::~SrsHttpServeMux()
 {
+    srs_freep(root);
+    
     std::map<std::string, SrsHttpMuxEntry*>::iterator it;
     for (it = entries.begin(); it != entries.end(); ++it) {
         SrsHttpMuxEntry* entry = it->second;
@@ -667,6 +872,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             srs_freep(exists);
         }
         entries[pattern] = entry;
+        root->set(pattern, entry);
     }
     
     // Helpful behavior:
@@ -692,6 +898,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             entry->handler->entry = entry;
             
             entries[rpattern] = entry;
+            root->set(rpattern, entry);
         }
     }
     
@@ -757,57 +964,12 @@ srs_error_t SrsHttpServeMux::match(ISrsHttpMessage* r, ISrsHttpHandler** ph)
         path = r->host() + path;
     }
     
-    int nb_matched = 0;
-    ISrsHttpHandler* h = NULL;
-    
-    std::map<std::string, SrsHttpMuxEntry*>::iterator it;
-    for (it = entries.begin(); it != entries.end(); ++it) {
-        std::string pattern = it->first;
-        SrsHttpMuxEntry* entry = it->second;
-        
-        if (!entry->enabled) {
-            continue;
-        }
-        
-        if (!path_match(pattern, path)) {
-            continue;
-        }
-        
-        if (!h || (int)pattern.length() > nb_matched) {
-            nb_matched = (int)pattern.length();
-            h = entry->handler;
-        }
-    }
-    
-    *ph = h;
+    SrsHttpMuxEntry* entry = root->match(path);
+    *ph = entry? entry->handler : NULL;
     
     return srs_success;
 }
 
-bool SrsHttpServeMux::path_match(string pattern, string path)
-{
-    if (pattern.empty()) {
-        return false;
-    }
-    
-    int n = (int)pattern.length();
-    
-    // not endswith '/', exactly match.
-    if (pattern.at(n - 1) != '/') {
-        return pattern == path;
-    }
-    
-    // endswith '/', match any,
-    // for example, '/api/' match '/api/[N]'
-    if ((int)path.length() >= n) {
-        if (memcmp(pattern.data(), path.data(), n) == 0) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 SrsHttpCorsMux::SrsHttpCorsMux()
 {
     next = NULL;
@@ -957,6 +1119,51 @@ string SrsHttpUri::get_uri_field(string uri, void* php_u, int ifield)
     return uri.substr(offset, len);
 }
 
+bool srs_http_is_websocket(ISrsHttpMessage* r)
+{
+    string upgrade = r->header()->get("Upgrade");
+    return !strcasecmp(upgrade.c_str(), "websocket") && !r->header()->get("Sec-WebSocket-Key").empty();
+}
+
+string srs_websocket_accept(string key)
+{
+    // The GUID of WebSocket, @see RFC6455 section 1.3
+    string v = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1((const unsigned char*)v.data(), v.length(), digest);
+    
+    char cipher[SRS_AV_BASE64_SIZE(SHA_DIGEST_LENGTH)];
+    int nn_cipher = EVP_EncodeBlock((unsigned char*)cipher, digest, SHA_DIGEST_LENGTH);
+    
+    return string(cipher, nn_cipher);
+}
+
+int srs_websocket_frame_header(char* buf, int opcode, int64_t size)
+{
+    // The FIN bit, without the RSV bits.
+    buf[0] = (char)(0x80 | (opcode & 0x0f));
+    
+    // The payload length, without the mask bit.
+    if (size < 126) {
+        buf[1] = (char)size;
+        return 2;
+    }
+    
+    if (size <= 0xffff) {
+        buf[1] = 126;
+        buf[2] = (char)(size >> 8);
+        buf[3] = (char)size;
+        return 4;
+    }
+    
+    buf[1] = 127;
+    for (int i = 0; i < 8; i++) {
+        buf[2 + i] = (char)(size >> (56 - 8 * i));
+    }
+    return SRS_WEBSOCKET_FRAME_HEADER_MAX;
+}
+
 // For #if !defined(SRS_EXPORT_LIBRTMP)
 #endif
 
@@ -69,6 +69,9 @@ class ISrsFileReaderFactory;
 // For ead all of http body, read each time.
 #define SRS_HTTP_READ_CACHE_BYTES 4096
 
+// The initial capacity of the flat header table, enough for a normal request.
+#define SRS_HTTP_HEADER_RESERVED 16
+
 // For http parser macros
 #define SRS_CONSTS_HTTP_OPTIONS HTTP_OPTIONS
 #define SRS_CONSTS_HTTP_GET HTTP_GET
@@ -96,6 +99,10 @@ extern bool srs_go_http_body_allowd(int status);
 // returns "application/octet-stream".
 extern std::string srs_go_http_detect(char* data, int size);
 
+// Whether the Accept-Encoding of request accepts the content-coding, for example, gzip.
+// The coding is rejected by q=0, and the "*" matches any coding, see RFC7231, section 5.3.4.
+extern bool srs_http_accept_encoding(std::string accept_encoding, std::string coding);
+
 // The state of HTTP message
 enum SrsHttpParseState {
     SrsHttpParseStateInit = 0,
@@ -114,27 +121,35 @@ private:
     // general-header fields first, followed by request-header or response-
     // header fields, and ending with the entity-header fields.
     // @doc https://tools.ietf.org/html/rfc2616#section-4.2
-    std::map<std::string, std::string> headers;
+    // @remark A request seldom carries more than a dozen fields, so we use a flat table in the received order, which
+    //      is cheaper to fill and scan than a map, by one allocation rather than a node per field.
+    std::vector<std::pair<std::string, std::string> > headers;
 public:
     SrsHttpHeader();
     virtual ~SrsHttpHeader();
 public:
     // Add adds the key, value pair to the header.
     // It appends to any existing values associated with key.
-    virtual void set(std::string key, std::string value);
+    virtual void set(const std::string& key, const std::string& value);
     // Get gets the first value associated with the given key.
     // If there are no values associated with the key, Get returns "".
     // To access multiple values of a key, access the map directly
     // with CanonicalHeaderKey.
-    virtual std::string get(std::string key);
+    virtual std::string get(const std::string& key);
     // Delete the http header indicated by key.
     // Return the removed header field.
-    virtual void del(std::string);
+    virtual void del(const std::string& key);
     // Get the count of headers.
     virtual int count();
+    // Remove all fields, but keep the capacity of table for reuse.
+    virtual void clear();
+private:
+    std::vector<std::pair<std::string, std::string> >::iterator find(const std::string& key);
 public:
     // Dumps to a JSON object.
     virtual void dumps(SrsJsonObject* o);
+    // Get all fields in order, for example, to encode by HPACK.
+    virtual const std::vector<std::pair<std::string, std::string> >& fields();
 public:
     // Get the content length. -1 if not set.
     virtual int64_t content_length();
@@ -216,6 +231,20 @@ public:
     virtual void write_header(int code) = 0;
 };
 
+// The response writer which could send the file as body in kernel, for example, sendfile.
+// @remark Only for the response with content-length, and after write_header.
+class ISrsHttpSendfileWriter
+{
+public:
+    ISrsHttpSendfileWriter();
+    virtual ~ISrsHttpSendfileWriter();
+public:
+    // Whether the body could be sent by sendfile now.
+    virtual bool sendfile_enabled() = 0;
+    // Send size bytes of file fd from offset as body.
+    virtual srs_error_t sendfile(int fd, int64_t offset, int size) = 0;
+};
+
 // The reader interface for http response.
 class ISrsHttpResponseReader : public ISrsReader
 {
@@ -277,6 +306,9 @@ typedef bool (*_pfn_srs_path_exists)(std::string path);
 // Build the file path from request r.
 extern std::string srs_http_fs_fullpath(std::string dir, std::string pattern, std::string upath);
 
+// Get the Content-Type of file by its extension.
+extern std::string srs_http_fs_mime(std::string fullpath);
+
 // FileServer returns a handler that serves HTTP requests
 // with the contents of the file system rooted at root.
 //
@@ -302,19 +334,26 @@ private:
     virtual void set_path_check(_pfn_srs_path_exists pfn);
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
-private:
+protected:
     // Serve the file by specified path
     virtual srs_error_t serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+private:
     virtual srs_error_t serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
 protected:
     // When access flv file with x.flv?start=xxx
     virtual srs_error_t serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
+    // When access flv file with x.flv?starttime=xxx
+    // @param starttime the start time to seek to, the keyframe at or before it is served.
+    virtual srs_error_t serve_flv_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t starttime);
     // When access mp4 file with x.mp4?range=start-end
     // @param start the start offset in bytes.
     // @param end the end offset in bytes. -1 to end of file.
     // @remark response data in [start, end].
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
+    // When access mp4 file with x.mp4?start=xxx
+    // @param starttime the start time to seek to, the keyframe at or before it is served.
+    virtual srs_error_t serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t starttime);
 protected:
     // Copy the fs to response writer in size bytes.
     virtual srs_error_t copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int size);
@@ -334,6 +373,28 @@ public:
     virtual ~SrsHttpMuxEntry();
 };
 
+// The node of trie for http mux, keyed by the segment of path between '/', so the
+// cost of match is the length of path, never the number of patterns.
+// For example, the pattern /live/livestream.flv is exact entry of node [""]["live"]["livestream.flv"],
+// while pattern /api/ is the dir entry of node [""]["api"], and ossrs.net/api/ of node ["ossrs.net"]["api"].
+class SrsHttpMuxNode
+{
+public:
+    // The entry of pattern not ends with '/', which matches the path exactly.
+    SrsHttpMuxEntry* exact;
+    // The entry of pattern ends with '/', which matches all paths under it.
+    SrsHttpMuxEntry* dir;
+    std::map<std::string, SrsHttpMuxNode*> children;
+public:
+    SrsHttpMuxNode();
+    virtual ~SrsHttpMuxNode();
+public:
+    // Set the entry for pattern, NULL to reset it.
+    virtual void set(std::string pattern, SrsHttpMuxEntry* entry);
+    // Match the enabled entry of the longest pattern for path, NULL if not matched.
+    virtual SrsHttpMuxEntry* match(const std::string& path);
+};
+
 // The hijacker for http pattern match.
 class ISrsHttpMatchHijacker
 {
@@ -389,6 +450,8 @@ class SrsHttpServeMux : public ISrsHttpServeMux
 private:
     // The pattern handler, to handle the http request.
     std::map<std::string, SrsHttpMuxEntry*> entries;
+    // The trie of entries to match the request path.
+    SrsHttpMuxNode* root;
     // The vhost handler.
     // When find the handler to process the request,
     // append the matched vhost when pattern not starts with /,
@@ -419,7 +482,6 @@ public:
     virtual srs_error_t find_handler(ISrsHttpMessage* r, ISrsHttpHandler** ph);
 private:
     virtual srs_error_t match(ISrsHttpMessage* r, ISrsHttpHandler** ph);
-    virtual bool path_match(std::string pattern, std::string path);
 };
 
 // The filter http mux, directly serve the http CORS requests,
@@ -546,6 +608,22 @@ private:
     virtual std::string get_uri_field(std::string uri, void* hp_u, int field);
 };
 
+// The opcode of WebSocket frames, @see RFC6455 section 5.2
+#define SRS_WEBSOCKET_OPCODE_BINARY 0x02
+#define SRS_WEBSOCKET_OPCODE_CLOSE 0x08
+// The max header of frame sent by server, which is never masked.
+#define SRS_WEBSOCKET_FRAME_HEADER_MAX 10
+
+// Whether the request is to upgrade to WebSocket.
+extern bool srs_http_is_websocket(ISrsHttpMessage* r);
+
+// Generate the Sec-WebSocket-Accept for the Sec-WebSocket-Key of request.
+extern std::string srs_websocket_accept(std::string key);
+
+// Encode the header of a final frame without mask to buf, of SRS_WEBSOCKET_FRAME_HEADER_MAX bytes.
+// @return The size of header.
+extern int srs_websocket_frame_header(char* buf, int opcode, int64_t size);
+
 // For #if !defined(SRS_EXPORT_LIBRTMP)
 #endif
 
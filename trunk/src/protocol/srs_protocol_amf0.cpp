@@ -26,11 +26,13 @@
 #include <utility>
 #include <vector>
 #include <sstream>
+#include <string.h>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_protocol_json.hpp>
 
 using namespace srs_internal;
@@ -1167,6 +1169,189 @@ void SrsAmf0StrictArray::append(SrsAmf0Any* any)
     _count = (int32_t)properties.size();
 }
 
+SrsAmf0ObjectView::SrsAmf0ObjectView()
+{
+    _marker = RTMP_AMF0_Invalid;
+    _count = 0;
+    bytes = NULL;
+    nb_bytes = 0;
+}
+
+SrsAmf0ObjectView::~SrsAmf0ObjectView()
+{
+}
+
+srs_error_t SrsAmf0ObjectView::read(SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    // marker
+    if (!stream->require(1)) {
+        return srs_error_new(ERROR_RTMP_AMF0_DECODE, "object requires 1 only %d bytes", stream->left());
+    }
+    
+    char marker = stream->read_1bytes();
+    if (marker != RTMP_AMF0_Object && marker != RTMP_AMF0_EcmaArray) {
+        return srs_error_new(ERROR_RTMP_AMF0_DECODE, "object invalid marker=%#x", marker);
+    }
+    
+    // count of ecma array, ignored because we count the properties.
+    if (marker == RTMP_AMF0_EcmaArray) {
+        if (!stream->require(4)) {
+            return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires 4 only %d bytes", stream->left());
+        }
+        stream->skip(4);
+    }
+    
+    _marker = marker;
+    _count = 0;
+    bytes = stream->data() + stream->pos();
+    
+    // value
+    while (!stream->empty()) {
+        // detect whether is eof.
+        if (srs_amf0_is_object_eof(stream)) {
+            stream->skip(3);
+            break;
+        }
+        
+        // property-name: utf8 string
+        if (!stream->require(2)) {
+            return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires 2 only %d bytes", stream->left());
+        }
+        int16_t len = stream->read_2bytes();
+        if (len > 0 && !stream->require(len)) {
+            return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires %d only %d bytes", len, stream->left());
+        }
+        stream->skip(srs_max(0, len));
+        
+        // property-value: any
+        if ((err = srs_amf0_skip_any(stream)) != srs_success) {
+            return srs_error_wrap(err, "skip property value");
+        }
+        _count++;
+    }
+    
+    nb_bytes = (int)(stream->data() + stream->pos() - bytes);
+    
+    return err;
+}
+
+bool SrsAmf0ObjectView::accept(SrsBuffer* stream)
+{
+    if (!stream->require(1)) {
+        return false;
+    }
+    
+    char marker = stream->data()[stream->pos()];
+    return marker == RTMP_AMF0_Object || marker == RTMP_AMF0_EcmaArray;
+}
+
+bool SrsAmf0ObjectView::is_object()
+{
+    return _marker == RTMP_AMF0_Object;
+}
+
+bool SrsAmf0ObjectView::is_ecma_array()
+{
+    return _marker == RTMP_AMF0_EcmaArray;
+}
+
+int SrsAmf0ObjectView::count()
+{
+    return _count;
+}
+
+bool SrsAmf0ObjectView::get_string(const char* name, std::string& value)
+{
+    int pos = find(name);
+    if (pos < 0 || bytes[pos] != RTMP_AMF0_String) {
+        return false;
+    }
+    
+    SrsBuffer stream(bytes + pos, nb_bytes - pos);
+    srs_error_t err = srs_amf0_read_string(&stream, value);
+    
+    // never fail, for the property is checked when read.
+    srs_assert(err == srs_success);
+    return true;
+}
+
+bool SrsAmf0ObjectView::get_number(const char* name, double& value)
+{
+    int pos = find(name);
+    if (pos < 0 || bytes[pos] != RTMP_AMF0_Number) {
+        return false;
+    }
+    
+    SrsBuffer stream(bytes + pos, nb_bytes - pos);
+    srs_error_t err = srs_amf0_read_number(&stream, value);
+    
+    // never fail, for the property is checked when read.
+    srs_assert(err == srs_success);
+    return true;
+}
+
+bool SrsAmf0ObjectView::get_boolean(const char* name, bool& value)
+{
+    int pos = find(name);
+    if (pos < 0 || bytes[pos] != RTMP_AMF0_Boolean) {
+        return false;
+    }
+    
+    SrsBuffer stream(bytes + pos, nb_bytes - pos);
+    srs_error_t err = srs_amf0_read_boolean(&stream, value);
+    
+    // never fail, for the property is checked when read.
+    srs_assert(err == srs_success);
+    return true;
+}
+
+srs_error_t SrsAmf0ObjectView::copy_to(SrsAmf0Object* obj)
+{
+    srs_error_t err = srs_success;
+    
+    SrsBuffer stream(bytes, nb_bytes);
+    while (!stream.empty() && !srs_amf0_is_object_eof(&stream)) {
+        std::string property_name;
+        if ((err = srs_amf0_read_utf8(&stream, property_name)) != srs_success) {
+            return srs_error_wrap(err, "read property name");
+        }
+        
+        SrsAmf0Any* property_value = NULL;
+        if ((err = srs_amf0_read_any(&stream, &property_value)) != srs_success) {
+            return srs_error_wrap(err, "read property value, name=%s", property_name.c_str());
+        }
+        
+        obj->set(property_name, property_value);
+    }
+    
+    return err;
+}
+
+int SrsAmf0ObjectView::find(const char* name)
+{
+    int size = (int)strlen(name);
+    
+    // the properties is checked when read, so we never check the bytes again.
+    SrsBuffer stream(bytes, nb_bytes);
+    while (!stream.empty() && !srs_amf0_is_object_eof(&stream)) {
+        int16_t len = stream.read_2bytes();
+        len = srs_max(0, len);
+        bool matched = (len == size && memcmp(stream.data() + stream.pos(), name, size) == 0);
+        stream.skip(len);
+        
+        if (matched) {
+            return stream.pos();
+        }
+        
+        srs_error_t err = srs_amf0_skip_any(&stream);
+        srs_assert(err == srs_success);
+    }
+    
+    return -1;
+}
+
 int SrsAmf0Size::utf8(string value)
 {
     return (int)(2 + value.length());
@@ -1518,6 +1703,71 @@ srs_error_t srs_amf0_read_any(SrsBuffer* stream, SrsAmf0Any** ppvalue)
     return err;
 }
 
+srs_error_t srs_amf0_skip_any(SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    // detect the object-eof specially
+    if (srs_amf0_is_object_eof(stream)) {
+        stream->skip(3);
+        return err;
+    }
+    
+    // marker
+    if (!stream->require(1)) {
+        return srs_error_new(ERROR_RTMP_AMF0_DECODE, "marker requires 1 only %d bytes", stream->left());
+    }
+    
+    char marker = stream->read_1bytes();
+    
+    // the size of value, -1 for variable size.
+    int size = -1;
+    switch (marker) {
+        case RTMP_AMF0_Number: size = 8; break;
+        case RTMP_AMF0_Boolean: size = 1; break;
+        case RTMP_AMF0_Null:
+        case RTMP_AMF0_Undefined: size = 0; break;
+        case RTMP_AMF0_Date: size = 10; break;
+        case RTMP_AMF0_String: {
+            if (!stream->require(2)) {
+                return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires 2 only %d bytes", stream->left());
+            }
+            int16_t len = stream->read_2bytes();
+            size = srs_max(0, len);
+            break;
+        }
+        case RTMP_AMF0_Object:
+        case RTMP_AMF0_EcmaArray: {
+            stream->skip(-1);
+            SrsAmf0ObjectView obj;
+            return obj.read(stream);
+        }
+        case RTMP_AMF0_StrictArray: {
+            if (!stream->require(4)) {
+                return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires 4 only %d bytes", stream->left());
+            }
+            int32_t count = stream->read_4bytes();
+            for (int i = 0; i < count && !stream->empty(); i++) {
+                if ((err = srs_amf0_skip_any(stream)) != srs_success) {
+                    return srs_error_wrap(err, "skip elem");
+                }
+            }
+            return err;
+        }
+        case RTMP_AMF0_Invalid:
+        default: {
+            return srs_error_new(ERROR_RTMP_AMF0_INVALID, "invalid amf0 message, marker=%#x", marker);
+        }
+    }
+    
+    if (!stream->require(size)) {
+        return srs_error_new(ERROR_RTMP_AMF0_DECODE, "requires %d only %d bytes", size, stream->left());
+    }
+    stream->skip(size);
+    
+    return err;
+}
+
 srs_error_t srs_amf0_read_string(SrsBuffer* stream, string& value)
 {
     // marker
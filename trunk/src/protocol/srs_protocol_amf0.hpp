@@ -557,6 +557,62 @@ public:
     virtual void append(SrsAmf0Any* any);
 };
 
+/**
+ * the read-only view of AMF0 object or ecma array in bytes,
+ * which never decodes and copies the properties to heap, but
+ * find and decode the property lazily when get it, so it's
+ * used to parse the command and metadata without allocation.
+ * @remark user must ensure the bytes is valid when using the view,
+ *       for instance, the payload of message.
+ */
+class SrsAmf0ObjectView
+{
+private:
+    char _marker;
+    int _count;
+    // the properties, from the first property to the object EOF.
+    char* bytes;
+    int nb_bytes;
+public:
+    SrsAmf0ObjectView();
+    virtual ~SrsAmf0ObjectView();
+public:
+    /**
+     * read the object or ecma array from stream, which checks and skips
+     * all properties, while the bytes is kept for lazy lookup.
+     */
+    virtual srs_error_t read(SrsBuffer* stream);
+    /**
+     * whether the stream is an object or ecma array, which can be read by view.
+     */
+    static bool accept(SrsBuffer* stream);
+    virtual bool is_object();
+    virtual bool is_ecma_array();
+    /**
+     * get the count of properties.
+     */
+    virtual int count();
+    // property get.
+public:
+    /**
+     * get the string or number or boolean property.
+     * @return false if not found or not the required type.
+     */
+    virtual bool get_string(const char* name, std::string& value);
+    virtual bool get_number(const char* name, double& value);
+    virtual bool get_boolean(const char* name, bool& value);
+    /**
+     * decode all properties and set to the object.
+     */
+    virtual srs_error_t copy_to(SrsAmf0Object* obj);
+private:
+    /**
+     * find the property by name.
+     * @return the position of value in bytes, -1 if not found.
+     */
+    virtual int find(const char* name);
+};
+
 /**
  * the class to get amf0 object size
  */
@@ -584,6 +640,11 @@ public:
  */
 extern srs_error_t srs_amf0_read_any(SrsBuffer* stream, SrsAmf0Any** ppvalue);
 
+/**
+ * skip anything in stream, without decoding it.
+ */
+extern srs_error_t srs_amf0_skip_any(SrsBuffer* stream);
+
 /**
  * read amf0 string from stream.
  * 2.4 String Type
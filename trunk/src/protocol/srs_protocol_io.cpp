@@ -55,3 +55,19 @@ ISrsProtocolReadWriter::~ISrsProtocolReadWriter()
 {
 }
 
+ISrsSendfileWriter::ISrsSendfileWriter()
+{
+}
+
+ISrsSendfileWriter::~ISrsSendfileWriter()
+{
+}
+
+ISrsZeroCopyWriter::ISrsZeroCopyWriter()
+{
+}
+
+ISrsZeroCopyWriter::~ISrsZeroCopyWriter()
+{
+}
+
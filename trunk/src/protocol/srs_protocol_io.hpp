@@ -92,6 +92,11 @@ public:
     // Read specified size bytes of data
     // @param nread, the actually read size, NULL to ignore.
     virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread) = 0;
+// For chunk reassembly.
+public:
+    // Read bytes to the iovs by a syscall, which may read less than the total size of iovs.
+    // @param nread, the actually read size, NULL to ignore.
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread) = 0;
 };
 
 /**
@@ -121,5 +126,41 @@ public:
     virtual ~ISrsProtocolReadWriter();
 };
 
+/**
+ * The writer to send file to peer in kernel, without copy to user space.
+ */
+class ISrsSendfileWriter
+{
+public:
+    ISrsSendfileWriter();
+    virtual ~ISrsSendfileWriter();
+public:
+    // Send count bytes of file fd from the offset, then update the offset.
+    // @param nwrite, the actual sent bytes, ignore if NULL.
+    virtual srs_error_t sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite) = 0;
+};
+
+/**
+ * The writer to send by MSG_ZEROCOPY, the kernel sends the user pages without copy, so the
+ * bytes must not be changed or freed until the kernel completes the send.
+ */
+class ISrsZeroCopyWriter
+{
+public:
+    ISrsZeroCopyWriter();
+    virtual ~ISrsZeroCopyWriter();
+public:
+    // Enable the MSG_ZEROCOPY of socket, error if not supported, for example, linux before 4.14.
+    virtual srs_error_t enable_zerocopy() = 0;
+    // Write the iovs by MSG_ZEROCOPY.
+    // @param pid Output the id of send, to check whether it's completed, even when error.
+    // @param nwrite, the actual write bytes, ignore if NULL.
+    virtual srs_error_t writev_zerocopy(const iovec* iov, int iov_size, uint32_t* pid, ssize_t* nwrite) = 0;
+    // Reap the completions of kernel, never block.
+    virtual srs_error_t reap_zerocopy() = 0;
+    // Whether the send of id is completed, then the bytes are free to change.
+    virtual bool zerocopy_completed(uint32_t id) = 0;
+};
+
 #endif
 
@@ -1572,11 +1572,37 @@ SrsJsonArray* SrsJsonAny::to_array()
     return p;
 }
 
+// Escape the string, for example, the SDP with CRLF, @see https://tools.ietf.org/html/rfc8259#section-7
+static string srs_json_escape(const string& str)
+{
+    string escaped;
+    for (int i = 0; i < (int)str.length(); i++) {
+        char ch = str.at(i);
+        switch (ch) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default: {
+                if ((uint8_t)ch < 0x20) {
+                    char tmp[8];
+                    snprintf(tmp, sizeof(tmp), "\\u%04x", (uint8_t)ch);
+                    escaped += tmp;
+                } else {
+                    escaped.push_back(ch);
+                }
+            }
+        }
+    }
+    return escaped;
+}
+
 string SrsJsonAny::dumps()
 {
     switch (marker) {
         case SRS_JSON_String: {
-            return "\"" + to_str() + "\"";
+            return "\"" + srs_json_escape(to_str()) + "\"";
         }
         case SRS_JSON_Boolean: {
             return to_boolean()? "true" : "false";
@@ -2018,6 +2044,152 @@ SrsAmf0Any* SrsJsonArray::to_amf0()
     return arr;
 }
 
+SrsJsonWriter::SrsJsonWriter()
+{
+    after_field = false;
+}
+
+SrsJsonWriter::~SrsJsonWriter()
+{
+}
+
+SrsJsonWriter* SrsJsonWriter::object_start()
+{
+    prefix();
+    buf.append(SRS_JOBJECT_START);
+    empties.push_back(true);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::object_end()
+{
+    srs_assert(!empties.empty());
+    empties.pop_back();
+    buf.append(SRS_JOBJECT_END);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::array_start()
+{
+    prefix();
+    buf.append(SRS_JARRAY_START);
+    empties.push_back(true);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::array_end()
+{
+    srs_assert(!empties.empty());
+    empties.pop_back();
+    buf.append(SRS_JARRAY_END);
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::field(const char* name)
+{
+    prefix();
+    buf.append("\"");
+    buf.append(name);
+    buf.append("\":");
+    after_field = true;
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::str(const string& value)
+{
+    prefix();
+    
+    buf.append("\"");
+    for (int i = 0; i < (int)value.length(); i++) {
+        char ch = value.at(i);
+        if (ch == '"' || ch == '\\') {
+            buf.push_back('\\');
+            buf.push_back(ch);
+        } else if ((uint8_t)ch < 0x20) {
+            char tmp[8];
+            snprintf(tmp, sizeof(tmp), "\\u%04x", (uint8_t)ch);
+            buf.append(tmp);
+        } else {
+            buf.push_back(ch);
+        }
+    }
+    buf.append("\"");
+    
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::boolean(bool value)
+{
+    prefix();
+    buf.append(value? "true" : "false");
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::integer(int64_t value)
+{
+    prefix();
+    
+    char tmp[22];
+    snprintf(tmp, sizeof(tmp), "%" PRId64, value);
+    buf.append(tmp);
+    
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::number(double value)
+{
+    prefix();
+    
+    // Same to SrsJsonAny::dumps, len(max int64_t) is 20, plus one "+-."
+    char tmp[22];
+    snprintf(tmp, sizeof(tmp), "%.2f", value);
+    buf.append(tmp);
+    
+    return this;
+}
+
+SrsJsonWriter* SrsJsonWriter::null()
+{
+    prefix();
+    buf.append("null");
+    return this;
+}
+
+const string& SrsJsonWriter::dumps()
+{
+    return buf;
+}
+
+int SrsJsonWriter::size()
+{
+    return (int)buf.length();
+}
+
+void SrsJsonWriter::clear()
+{
+    buf.clear();
+    empties.clear();
+    after_field = false;
+}
+
+void SrsJsonWriter::prefix()
+{
+    // The value of field, never write the separator.
+    if (after_field) {
+        after_field = false;
+        return;
+    }
+    
+    if (empties.empty()) {
+        return;
+    }
+    
+    if (!empties.back()) {
+        buf.append(SRS_JFIELD_CONT);
+    }
+    empties.back() = false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -168,5 +168,50 @@ public:
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 // JSON encode, please use JSON.dumps() to encode json object.
+// Or use SrsJsonWriter to stream a large json without building the tree.
+
+// The streaming json encoder, which writes the tokens to a growable buffer directly, without building a tree of
+// SrsJsonAny, that allocates lots of small objects for a large array, for example, the clients of http api.
+// For example:
+//      SrsJsonWriter jw;
+//      jw.object_start()->field("code")->integer(0);
+//      jw.field("clients")->array_start();
+//      for (...) { jw.object_start()->field("id")->integer(id)->object_end(); }
+//      jw.array_end()->object_end();
+//      const std::string& json = jw.dumps();
+// @remark The field name is written as is, while the string value is escaped.
+class SrsJsonWriter
+{
+private:
+    std::string buf;
+    // For each level of object or array, whether it's empty, to write the separator before next element.
+    std::vector<bool> empties;
+    // Whether the field name is written, so the value follows it without separator.
+    bool after_field;
+public:
+    SrsJsonWriter();
+    virtual ~SrsJsonWriter();
+public:
+    virtual SrsJsonWriter* object_start();
+    virtual SrsJsonWriter* object_end();
+    virtual SrsJsonWriter* array_start();
+    virtual SrsJsonWriter* array_end();
+    // Write the name of field in object, the value should follow it.
+    virtual SrsJsonWriter* field(const char* name);
+public:
+    virtual SrsJsonWriter* str(const std::string& value);
+    virtual SrsJsonWriter* boolean(bool value);
+    virtual SrsJsonWriter* integer(int64_t value);
+    virtual SrsJsonWriter* number(double value);
+    virtual SrsJsonWriter* null();
+public:
+    // Get the json in buffer, which is valid until next write.
+    virtual const std::string& dumps();
+    virtual int size();
+    // Reset the writer, but keep the capacity of buffer for reuse.
+    virtual void clear();
+private:
+    virtual void prefix();
+};
 
 #endif
@@ -113,7 +113,7 @@ SrsWallClock::~SrsWallClock()
 
 srs_utime_t SrsWallClock::now()
 {
-    return srs_get_system_time();
+    return srs_get_monotonic_time();
 }
 
 SrsKbps::SrsKbps(SrsWallClock* c) : is(c), os(c)
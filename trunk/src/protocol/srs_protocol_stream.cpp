@@ -52,7 +52,7 @@ IMergeReadHandler::~IMergeReadHandler()
 }
 #endif
 
-SrsFastStream::SrsFastStream(int size)
+SrsFastStream::SrsFastStream(int size, int max_size) : memory(SrsMemoryRecvBuffer)
 {
 #ifdef SRS_PERF_MERGED_READ
     merged_read = false;
@@ -60,8 +60,11 @@ SrsFastStream::SrsFastStream(int size)
 #endif
     
     nb_buffer = size? size:SRS_DEFAULT_RECV_BUFFER_SIZE;
+    nb_initial = nb_buffer;
+    nb_max = max_size;
     buffer = (char*)malloc(nb_buffer);
     p = end = buffer;
+    memory.update(nb_buffer);
 }
 
 SrsFastStream::~SrsFastStream()
@@ -70,6 +73,27 @@ SrsFastStream::~SrsFastStream()
     buffer = NULL;
 }
 
+void SrsFastStream::set_memory(SrsMemoryStat* v, SrsMemoryType type)
+{
+    memory.set_type(type);
+    memory.set_stat(v);
+}
+
+int SrsFastStream::capacity()
+{
+    return nb_buffer;
+}
+
+void SrsFastStream::shrink()
+{
+    // Keep the buffer when it's small, or the bytes in buffer never fit.
+    if (nb_buffer <= nb_initial || (int)(end - p) > nb_initial) {
+        return;
+    }
+    
+    resize(nb_initial);
+}
+
 int SrsFastStream::size()
 {
     return (int)(end - p);
@@ -96,13 +120,7 @@ void SrsFastStream::set_buffer(int buffer_size)
     }
     
     // realloc for buffer change bigger.
-    int start = (int)(p - buffer);
-    int nb_bytes = (int)(end - p);
-    
-    buffer = (char*)realloc(buffer, nb_resize_buf);
-    nb_buffer = nb_resize_buf;
-    p = buffer + start;
-    end = p + nb_bytes;
+    resize(nb_resize_buf);
 }
 
 char SrsFastStream::read_1byte()
@@ -165,6 +183,11 @@ srs_error_t SrsFastStream::grow(ISrsReader* reader, int required_size)
             end = p + nb_exists_bytes;
         }
         
+        // grow the adaptive buffer to contain the required size.
+        if (nb_max > 0 && required_size > nb_buffer && required_size <= SRS_MAX_SOCKET_BUFFER) {
+            resize(srs_max(required_size, srs_min(nb_buffer * 2, nb_max)));
+        }
+        
         // check whether enough free space in buffer.
         nb_free_space = (int)(buffer + nb_buffer - end);
         if (nb_exists_bytes + nb_free_space < required_size) {
@@ -195,11 +218,86 @@ srs_error_t SrsFastStream::grow(ISrsReader* reader, int required_size)
         srs_assert((int)nread > 0);
         end += nread;
         nb_free_space -= (int)nread;
+        
+        // double the adaptive buffer when a read fills it, to read more bytes in a syscall.
+        if (nb_max > 0 && nb_free_space == 0 && nb_buffer < nb_max) {
+            resize(srs_min(nb_buffer * 2, nb_max));
+            nb_free_space = (int)(buffer + nb_buffer - end);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsFastStream::read_to(ISrsProtocolReader* reader, char* dst, int size)
+{
+    srs_error_t err = srs_success;
+    
+    // must be positive.
+    srs_assert(size > 0);
+    
+    // consume the bytes already in buffer.
+    int nn = srs_min(size, (int)(end - p));
+    if (nn > 0) {
+        memcpy(dst, p, nn);
+        p += nn;
+    }
+    
+    if (nn == size) {
+        return err;
+    }
+    
+    // reset the buffer for it's empty now, to readv to the whole free space.
+    p = end = buffer;
+    
+    while (nn < size) {
+        iovec iovs[2];
+        iovs[0].iov_base = dst + nn;
+        iovs[0].iov_len = size - nn;
+        iovs[1].iov_base = end;
+        iovs[1].iov_len = buffer + nb_buffer - end;
+        
+        ssize_t nread;
+        if ((err = reader->readv(iovs, 2, &nread)) != srs_success) {
+            return srs_error_wrap(err, "readv bytes");
+        }
+        
+#ifdef SRS_PERF_MERGED_READ
+        if (merged_read && _handler) {
+            _handler->on_read(nread);
+        }
+#endif
+        
+        // the bytes more than size are read to buffer.
+        srs_assert((int)nread > 0);
+        if ((int)nread > size - nn) {
+            end += (int)nread - (size - nn);
+            nn = size;
+        } else {
+            nn += (int)nread;
+        }
     }
     
     return err;
 }
 
+void SrsFastStream::resize(int size)
+{
+    int nb_bytes = (int)(end - p);
+    srs_assert(size >= nb_bytes);
+    
+    // move the left bytes to start of buffer, then realloc.
+    if (nb_bytes > 0 && p > buffer) {
+        memmove(buffer, p, nb_bytes);
+    }
+    
+    buffer = (char*)realloc(buffer, size);
+    nb_buffer = size;
+    p = buffer;
+    end = p + nb_bytes;
+    memory.update(nb_buffer);
+}
+
 #ifdef SRS_PERF_MERGED_READ
 void SrsFastStream::set_merge_read(bool v, IMergeReadHandler* handler)
 {
@@ -28,6 +28,7 @@
 
 #include <srs_protocol_io.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_core_mem_watch.hpp>
 #include <srs_kernel_stream.hpp>
 
 #ifdef SRS_PERF_MERGED_READ
@@ -83,11 +84,25 @@ private:
     char* buffer;
     // the size of buffer.
     int nb_buffer;
+    // the initial size of buffer, to shrink to.
+    int nb_initial;
+    // the max size to grow adaptively, 0 for a fixed size buffer.
+    int nb_max;
+    // Report the size of buffer to the memory stat.
+    SrsMemoryUsage memory;
 public:
     // If buffer is 0, use default size.
-    SrsFastStream(int size=0);
+    // @param max_size, grow the buffer when a read fills it or required util max_size, 0 to never grow.
+    SrsFastStream(int size=0, int max_size=0);
     virtual ~SrsFastStream();
 public:
+    // Report the size of buffer to the memory stat of stream, as the type such as recv buffer of player.
+    virtual void set_memory(SrsMemoryStat* v, SrsMemoryType type = SrsMemoryRecvBuffer);
+    // Get the size of buffer, not the bytes in buffer.
+    virtual int capacity();
+    // Shrink the buffer to the initial size, when the bytes in buffer fit it.
+    // @remark when buffer changed, the previous ptr maybe invalid.
+    virtual void shrink();
     /**
      * get the size of current bytes in buffer.
      */
@@ -136,6 +151,17 @@ public:
      * @remark, we actually maybe read more than required_size, maybe 4k for example.
      */
     virtual srs_error_t grow(ISrsReader* reader, int required_size);
+    /**
+     * read size bytes to dst, the bytes in buffer first, then read the left bytes directly to dst,
+     * and the bytes read more than size are kept in the free space of buffer.
+     * @param reader, readv from reader to dst and the free space of buffer.
+     * @param dst, the dst to read to, which should be atleast size bytes.
+     * @remark, used to read large chunk body to payload, to avoid the copy of buffer.
+     */
+    virtual srs_error_t read_to(ISrsProtocolReader* reader, char* dst, int size);
+private:
+    // Realloc the buffer to size, which must be larger than the bytes in buffer.
+    virtual void resize(int size);
 public:
 #ifdef SRS_PERF_MERGED_READ
     /**
@@ -79,7 +79,7 @@ void srs_vhost_resolve(string& vhost, string& app, string& param)
             }
         }
     }
-
+    
     // vhost with params.
     if ((pos = vhost.find("?")) != std::string::npos) {
         vhost = vhost.substr(0, pos);
@@ -148,6 +148,30 @@ void srs_parse_query_string(string q, map<string,string>& query)
     }
 }
 
+string srs_query_remove(string param, string mark)
+{
+    if (!srs_string_contains(param, mark)) {
+        return param;
+    }
+    
+    bool prefixed = srs_string_starts_with(param, "?");
+    vector<string> items = srs_string_split(prefixed? param.substr(1) : param, "&");
+    
+    string v;
+    for (int i = 0; i < (int)items.size(); i++) {
+        string item = items.at(i);
+        if (item.empty() || srs_string_contains(item, mark)) {
+            continue;
+        }
+        v += (v.empty()? "" : "&") + item;
+    }
+    
+    if (v.empty()) {
+        return "";
+    }
+    return prefixed? "?" + v : v;
+}
+
 void srs_random_generate(char* bytes, int size)
 {
     static bool _random_initialized = false;
@@ -203,7 +227,7 @@ string srs_generate_stream_with_query(string host, string vhost, string stream,
     
     // Remove the start & when param is empty.
     query = srs_string_trim_start(query, "&");
-
+    
     // Prefix query with ?.
     if (!query.empty() && !srs_string_starts_with(query, "?")) {
         url += "?";
@@ -287,11 +311,14 @@ srs_error_t srs_rtmp_create_msg(char type, uint32_t timestamp, char* data, int s
     return err;
 }
 
-string srs_generate_stream_url(string vhost, string app, string stream)
+string srs_generate_stream_url(const string& vhost, const string& app, const string& stream)
 {
     std::string url = "";
     
-    if (SRS_CONSTS_RTMP_DEFAULT_VHOST != vhost){
+    bool has_vhost = SRS_CONSTS_RTMP_DEFAULT_VHOST != vhost;
+    url.reserve((has_vhost? vhost.length() : 0) + app.length() + stream.length() + 2);
+    
+    if (has_vhost){
         url += vhost;
     }
     url += "/";
@@ -302,6 +329,63 @@ string srs_generate_stream_url(string vhost, string app, string stream)
     return url;
 }
 
+#define SRS_FNV1A_OFFSET 0xcbf29ce484222325ULL
+#define SRS_FNV1A_PRIME 0x100000001b3ULL
+
+static uint64_t srs_fnv1a(uint64_t h, const char* p, int size)
+{
+    for (int i = 0; i < size; i++) {
+        h ^= (uint8_t)p[i];
+        h *= SRS_FNV1A_PRIME;
+    }
+    return h;
+}
+
+uint64_t srs_generate_stream_hash(const string& vhost, const string& app, const string& stream)
+{
+    uint64_t h = SRS_FNV1A_OFFSET;
+    
+    if (SRS_CONSTS_RTMP_DEFAULT_VHOST != vhost) {
+        h = srs_fnv1a(h, vhost.data(), (int)vhost.length());
+    }
+    h = srs_fnv1a(h, "/", 1);
+    h = srs_fnv1a(h, app.data(), (int)app.length());
+    h = srs_fnv1a(h, "/", 1);
+    h = srs_fnv1a(h, stream.data(), (int)stream.length());
+    
+    return h;
+}
+
+uint64_t srs_hash_stream_url(const string& url)
+{
+    return srs_fnv1a(SRS_FNV1A_OFFSET, url.data(), (int)url.length());
+}
+
+bool srs_stream_url_equals(const string& url, const string& vhost, const string& app, const string& stream)
+{
+    size_t nn_vhost = (SRS_CONSTS_RTMP_DEFAULT_VHOST != vhost)? vhost.length() : 0;
+    if (url.length() != nn_vhost + app.length() + stream.length() + 2) {
+        return false;
+    }
+    
+    size_t pos = 0;
+    if (url.compare(pos, nn_vhost, vhost, 0, nn_vhost) != 0) {
+        return false;
+    }
+    pos += nn_vhost;
+    
+    if (url.at(pos++) != '/' || url.compare(pos, app.length(), app) != 0) {
+        return false;
+    }
+    pos += app.length();
+    
+    if (url.at(pos++) != '/' || url.compare(pos, stream.length(), stream) != 0) {
+        return false;
+    }
+    
+    return true;
+}
+
 void srs_parse_rtmp_url(string url, string& tcUrl, string& stream)
 {
     size_t pos;
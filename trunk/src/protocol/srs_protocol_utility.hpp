@@ -64,6 +64,9 @@ extern void srs_discovery_tc_url(std::string tcUrl, std::string& schema, std::st
 // parse query string to map(k,v).
 // must format as key=value&...&keyN=valueN
 extern void srs_parse_query_string(std::string q, std::map<std::string, std::string>& query);
+// Remove the items of query string which contains the mark, for example, the internal marks from client.
+// @remark The leading "?" of param is kept, return empty if no item left.
+extern std::string srs_query_remove(std::string param, std::string mark);
 
 /**
  * generate ramdom data for handshake.
@@ -91,7 +94,13 @@ extern srs_error_t srs_rtmp_create_msg(char type, uint32_t timestamp, char* data
 extern srs_error_t srs_rtmp_create_msg(char type, uint32_t timestamp, char* data, int size, int stream_id, SrsCommonMessage** ppmsg);
 
 // get the stream identify, vhost/app/stream.
-extern std::string srs_generate_stream_url(std::string vhost, std::string app, std::string stream);
+extern std::string srs_generate_stream_url(const std::string& vhost, const std::string& app, const std::string& stream);
+// Get the hash of stream url, without generating the url, which equals to srs_hash_stream_url.
+extern uint64_t srs_generate_stream_hash(const std::string& vhost, const std::string& app, const std::string& stream);
+// Get the 64 bits FNV-1a hash of stream url.
+extern uint64_t srs_hash_stream_url(const std::string& url);
+// Whether the url equals to the stream url of vhost/app/stream, without generating the url.
+extern bool srs_stream_url_equals(const std::string& url, const std::string& vhost, const std::string& app, const std::string& stream);
 
 // parse the rtmp url to tcUrl/stream,
 // for example, rtmp://v.ossrs.net/live/livestream to
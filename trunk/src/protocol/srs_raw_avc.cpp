@@ -24,6 +24,7 @@
 #include <srs_raw_avc.hpp>
 
 #include <string.h>
+#include <sys/uio.h>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -59,11 +60,10 @@ srs_error_t SrsRawH264Stream::annexb_demux(SrsBuffer* stream, char** pframe, int
         
         // find the last frame prefixed by annexb format.
         stream->skip(pnb_start_code);
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            stream->skip(1);
+        if (!stream->empty()) {
+            char* p = stream->data() + stream->pos();
+            char* pp = srs_avc_find_annexb(p, stream->data() + stream->size());
+            stream->skip((int)(pp - p));
         }
         
         // demux the frame.
@@ -280,6 +280,39 @@ srs_error_t SrsRawH264Stream::mux_avc2flv(string video, int8_t frame_type, int8_
     return err;
 }
 
+srs_error_t SrsRawH264Stream::mux_nalus2flv(const iovec* nalus, int nb_nalus, int8_t frame_type, uint32_t dts, uint32_t pts, char** flv, int* nb_flv)
+{
+    srs_error_t err = srs_success;
+    
+    // The 5bytes header, and each NALU in IBMF, with 4bytes length.
+    int size = 5;
+    for (int i = 0; i < nb_nalus; i++) {
+        size += 4 + (int)nalus[i].iov_len;
+    }
+    
+    char* data = new char[size];
+    SrsBuffer stream(data, size);
+    
+    // @see: E.4.3 Video Tags, video_file_format_spec_v10_1.pdf, page 78
+    stream.write_1bytes((frame_type << 4) | SrsVideoCodecIdAVC);
+    stream.write_1bytes(SrsVideoAvcFrameTraitNALU);
+    
+    // CompositionTime, cts = pts - dts.
+    stream.write_3bytes((int32_t)(pts - dts));
+    
+    // 5.3.4.2.1 Syntax, ISO_IEC_14496-15-AVC-format-2012.pdf, page 16
+    for (int i = 0; i < nb_nalus; i++) {
+        const iovec* nalu = nalus + i;
+        stream.write_4bytes((int32_t)nalu->iov_len);
+        stream.write_bytes((char*)nalu->iov_base, (int)nalu->iov_len);
+    }
+    
+    *flv = data;
+    *nb_flv = size;
+    
+    return err;
+}
+
 SrsRawAacStream::SrsRawAacStream()
 {
 }
@@ -31,6 +31,7 @@
 #include <srs_kernel_codec.hpp>
 
 class SrsBuffer;
+struct iovec;
 
 // The raw h.264 stream, in annexb.
 class SrsRawH264Stream
@@ -68,6 +69,10 @@ public:
     // @param flv output the muxed flv packet.
     // @param nb_flv output the muxed flv size.
     virtual srs_error_t mux_avc2flv(std::string video, int8_t frame_type, int8_t avc_packet_type, uint32_t dts, uint32_t pts, char** flv, int* nb_flv);
+    // Mux the NALUs of a frame to flv ibp packet, the NALUs are copied once to the packet.
+    // @param nalus the NALUs without annexb start code.
+    // @param flv output the muxed flv packet, user should free it.
+    virtual srs_error_t mux_nalus2flv(const iovec* nalus, int nb_nalus, int8_t frame_type, uint32_t dts, uint32_t pts, char** flv, int* nb_flv);
 };
 
 // The header of adts sample.
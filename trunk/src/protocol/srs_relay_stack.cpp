@@ -0,0 +1,669 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_relay_stack.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_utility.hpp>
+
+// The size of message header in frames, type(1B) timestamp(4B).
+#define SRS_RELAY_MESSAGE_HEADER 5
+// The max frames buffered by receiver, for the GOPs in flight.
+#define SRS_RELAY_MAX_FRAMES (2 * SRS_RELAY_MAX_INFLIGHT / SRS_RELAY_MAX_PAYLOAD)
+
+SrsRelayPacket::SrsRelayPacket()
+{
+    type = SrsRelayPacketPing;
+    conn_id = 0;
+    code = 0;
+    pn = base_gop = gop = seq = prev = 0;
+    flags = 0;
+    payload = NULL;
+    size = 0;
+}
+
+SrsRelayPacket::~SrsRelayPacket()
+{
+}
+
+srs_error_t SrsRelayPacket::decode(char* data, int nb_data)
+{
+    srs_error_t err = srs_success;
+    
+    SrsBuffer stream(data, nb_data);
+    if (!stream.require(5)) {
+        return srs_error_new(ERROR_RELAY_DECODE, "requires 5 only %d bytes", nb_data);
+    }
+    
+    type = (SrsRelayPacketType)(uint8_t)stream.read_1bytes();
+    conn_id = (uint32_t)stream.read_4bytes();
+    
+    if (type == SrsRelayPacketConnect) {
+        if (!stream.require(2)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "connect requires 2 bytes");
+        }
+        int nn = (uint16_t)stream.read_2bytes();
+        if (!stream.require(nn)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "connect requires %d bytes", nn);
+        }
+        url = stream.read_string(nn);
+        if ((err = decode_token(&stream)) != srs_success) {
+            return srs_error_wrap(err, "connect");
+        }
+    } else if (type == SrsRelayPacketRetry || type == SrsRelayPacketChallenge || type == SrsRelayPacketResponse) {
+        if ((err = decode_token(&stream)) != srs_success) {
+            return srs_error_wrap(err, "type %d", type);
+        }
+    } else if (type == SrsRelayPacketAccept || type == SrsRelayPacketClose) {
+        if (!stream.require(2)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "type %d requires 2 bytes", type);
+        }
+        code = (uint16_t)stream.read_2bytes();
+    } else if (type == SrsRelayPacketData) {
+        if (!stream.require(21)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "data requires 21 bytes");
+        }
+        pn = (uint32_t)stream.read_4bytes();
+        base_gop = (uint32_t)stream.read_4bytes();
+        gop = (uint32_t)stream.read_4bytes();
+        seq = (uint32_t)stream.read_4bytes();
+        prev = (uint32_t)stream.read_4bytes();
+        flags = (uint8_t)stream.read_1bytes();
+        payload = data + stream.pos();
+        size = stream.left();
+    } else if (type == SrsRelayPacketAck) {
+        if (!stream.require(1)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "ack requires 1 byte");
+        }
+        int nn = (uint8_t)stream.read_1bytes();
+        if (!stream.require(nn * 8)) {
+            return srs_error_new(ERROR_RELAY_DECODE, "ack requires %d bytes", nn * 8);
+        }
+        ranges.clear();
+        for (int i = 0; i < nn; i++) {
+            uint32_t start = (uint32_t)stream.read_4bytes();
+            uint32_t end = (uint32_t)stream.read_4bytes();
+            if (start > end) {
+                return srs_error_new(ERROR_RELAY_DECODE, "ack range [%u, %u]", start, end);
+            }
+            ranges.push_back(make_pair(start, end));
+        }
+    } else if (type != SrsRelayPacketPing) {
+        return srs_error_new(ERROR_RELAY_DECODE, "invalid type %d", type);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRelayPacket::encode(SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (!stream->require(nb_bytes())) {
+        return srs_error_new(ERROR_RELAY_DECODE, "requires %d only %d bytes", nb_bytes(), stream->left());
+    }
+    
+    stream->write_1bytes((int8_t)type);
+    stream->write_4bytes((int32_t)conn_id);
+    
+    if (type == SrsRelayPacketConnect) {
+        stream->write_2bytes((int16_t)url.length());
+        stream->write_string(url);
+        stream->write_1bytes((int8_t)token.length());
+        stream->write_string(token);
+    } else if (type == SrsRelayPacketRetry || type == SrsRelayPacketChallenge || type == SrsRelayPacketResponse) {
+        stream->write_1bytes((int8_t)token.length());
+        stream->write_string(token);
+    } else if (type == SrsRelayPacketAccept || type == SrsRelayPacketClose) {
+        stream->write_2bytes((int16_t)code);
+    } else if (type == SrsRelayPacketData) {
+        stream->write_4bytes((int32_t)pn);
+        stream->write_4bytes((int32_t)base_gop);
+        stream->write_4bytes((int32_t)gop);
+        stream->write_4bytes((int32_t)seq);
+        stream->write_4bytes((int32_t)prev);
+        stream->write_1bytes((int8_t)flags);
+        if (size > 0) {
+            stream->write_bytes((char*)payload, size);
+        }
+    } else if (type == SrsRelayPacketAck) {
+        int nn = srs_min((int)ranges.size(), SRS_RELAY_MAX_RANGES);
+        stream->write_1bytes((int8_t)nn);
+        for (int i = 0; i < nn; i++) {
+            stream->write_4bytes((int32_t)ranges.at(i).first);
+            stream->write_4bytes((int32_t)ranges.at(i).second);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRelayPacket::decode_token(SrsBuffer* stream)
+{
+    if (!stream->require(1)) {
+        return srs_error_new(ERROR_RELAY_DECODE, "token requires 1 byte");
+    }
+    int nn = (uint8_t)stream->read_1bytes();
+    if (nn > SRS_RELAY_TOKEN_SIZE || !stream->require(nn)) {
+        return srs_error_new(ERROR_RELAY_DECODE, "token requires %d bytes", nn);
+    }
+    token = stream->read_string(nn);
+    return srs_success;
+}
+
+int SrsRelayPacket::nb_bytes()
+{
+    int nn = 5;
+    
+    if (type == SrsRelayPacketConnect) {
+        nn += 2 + (int)url.length() + 1 + (int)token.length();
+    } else if (type == SrsRelayPacketRetry || type == SrsRelayPacketChallenge || type == SrsRelayPacketResponse) {
+        nn += 1 + (int)token.length();
+    } else if (type == SrsRelayPacketAccept || type == SrsRelayPacketClose) {
+        nn += 2;
+    } else if (type == SrsRelayPacketData) {
+        nn += 21 + size;
+    } else if (type == SrsRelayPacketAck) {
+        nn += 1 + 8 * srs_min((int)ranges.size(), SRS_RELAY_MAX_RANGES);
+    }
+    
+    return nn;
+}
+
+SrsRelaySender::SrsRelaySender(uint32_t cid)
+{
+    conn_id = cid;
+    next_pn = 0;
+    gop = seq = prev = base_gop = 0;
+    inflight_bytes = 0;
+    largest_acked = 0;
+    has_acked = false;
+    
+    srtt = SRS_RELAY_INITIAL_RTT;
+    rttvar = SRS_RELAY_INITIAL_RTT / 2;
+    has_rtt = false;
+    pto_count = 0;
+    last_ack_eliciting = 0;
+    headers_lost = false;
+    
+    nn_packets = nn_retransmits = nn_abandoned = 0;
+}
+
+SrsRelaySender::~SrsRelaySender()
+{
+    std::map<uint32_t, SrsRelayFrame*>::iterator it;
+    for (it = inflight.begin(); it != inflight.end(); ++it) {
+        SrsRelayFrame* frame = it->second;
+        srs_freep(frame);
+    }
+    inflight.clear();
+}
+
+srs_error_t SrsRelaySender::on_message(SrsSharedPtrMessage* msg, srs_utime_t now, vector<string>& pkts)
+{
+    srs_error_t err = srs_success;
+    
+    bool is_vsh = msg->is_video() && SrsFlvVideo::sh(msg->payload, msg->size);
+    bool is_ash = msg->is_audio() && SrsFlvAudio::sh(msg->payload, msg->size);
+    bool keyframe = msg->is_video() && !is_vsh && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    bool header = !msg->is_av() || is_vsh || is_ash;
+    
+    // Serialize the message to frames, type(1B) timestamp(4B) payload, where the shared message only keeps
+    // the audio, video and metadata of stream.
+    char type = SrsFrameTypeScript;
+    if (msg->is_audio()) {
+        type = SrsFrameTypeAudio;
+    } else if (msg->is_video()) {
+        type = SrsFrameTypeVideo;
+    }
+    
+    string bytes(SRS_RELAY_MESSAGE_HEADER + msg->size, 0);
+    if (true) {
+        SrsBuffer stream((char*)bytes.data(), (int)bytes.length());
+        stream.write_1bytes(type);
+        stream.write_4bytes((int32_t)msg->timestamp);
+        if (msg->size > 0) {
+            stream.write_bytes(msg->payload, msg->size);
+        }
+    }
+    
+    // Start a GOP at keyframe, and abandon the GOPs before the previous one, which the receiver skips, while the
+    // lost frames of the previous GOP are still retransmitted.
+    if (keyframe) {
+        prev = seq;
+        gop++;
+        seq = 0;
+        
+        abandon(gop - 1);
+        
+        // The link is too slow for the stream, abandon the previous GOP also, to catch up the live.
+        if (inflight_bytes > SRS_RELAY_MAX_INFLIGHT) {
+            abandon(gop);
+        }
+        
+        // The metadata or sequence headers are abandoned, send them again before the keyframe.
+        if (headers_lost) {
+            headers_lost = false;
+            
+            string* headers[] = {&meta, &vsh, &ash};
+            for (int i = 0; i < 3; i++) {
+                if (!headers[i]->empty()) {
+                    packetize(*headers[i], true, now, pkts);
+                }
+            }
+        }
+    }
+    
+    if (inflight_bytes > 2 * SRS_RELAY_MAX_INFLIGHT) {
+        return srs_error_new(ERROR_RELAY_CONGESTED, "inflight %" PRId64 " bytes, srtt=%dms", inflight_bytes, srsu2msi(srtt));
+    }
+    
+    if (header) {
+        string& cache = is_vsh? vsh : (is_ash? ash : meta);
+        cache = bytes;
+    }
+    
+    packetize(bytes, header, now, pkts);
+    
+    return err;
+}
+
+void SrsRelaySender::on_ack(SrsRelayPacket* ack, srs_utime_t now, vector<string>& pkts)
+{
+    if (ack->ranges.empty()) {
+        return;
+    }
+    
+    // Sample the RTT by the largest acked, when it's newly acked.
+    uint32_t largest = ack->ranges.at(0).second;
+    std::map<uint32_t, SrsRelayFrame*>::iterator it = inflight.find(largest);
+    if (it != inflight.end()) {
+        srs_utime_t rtt = now - it->second->sent_at;
+        if (!has_rtt) {
+            srtt = rtt;
+            rttvar = rtt / 2;
+            has_rtt = true;
+        } else {
+            rttvar = (3 * rttvar + srs_max(srtt - rtt, rtt - srtt)) / 4;
+            srtt = (7 * srtt + rtt) / 8;
+        }
+    }
+    
+    if (!has_acked || largest > largest_acked) {
+        largest_acked = largest;
+        has_acked = true;
+    }
+    
+    // Remove the acked frames.
+    for (int i = 0; i < (int)ack->ranges.size(); i++) {
+        std::pair<uint32_t, uint32_t>& range = ack->ranges.at(i);
+        
+        it = inflight.lower_bound(range.first);
+        while (it != inflight.end() && it->first <= range.second) {
+            SrsRelayFrame* frame = it->second;
+            inflight_bytes -= frame->payload.length();
+            srs_freep(frame);
+            inflight.erase(it++);
+            pto_count = 0;
+        }
+    }
+    
+    // The frame is lost, when the frames sent later are acked, or it's too old.
+    // @see https://tools.ietf.org/html/rfc9002#section-6.1
+    srs_utime_t loss_delay = srs_max(9 * srtt / 8, SRS_UTIME_MILLISECONDS);
+    
+    vector<SrsRelayFrame*> lost;
+    for (it = inflight.begin(); it != inflight.end() && it->first < largest_acked;) {
+        SrsRelayFrame* frame = it->second;
+        if (largest_acked - it->first >= SRS_RELAY_PACKET_THRESHOLD || now - frame->sent_at > loss_delay) {
+            lost.push_back(frame);
+            inflight.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (int i = 0; i < (int)lost.size(); i++) {
+        nn_retransmits++;
+        send_frame(lost.at(i), now, pkts);
+    }
+}
+
+void SrsRelaySender::on_timer(srs_utime_t now, vector<string>& pkts)
+{
+    if (inflight.empty() || now - last_ack_eliciting < pto()) {
+        return;
+    }
+    
+    // Probe by the two oldest frames, @see https://tools.ietf.org/html/rfc9002#section-6.2.4
+    pto_count++;
+    for (int i = 0; i < 2 && !inflight.empty(); i++) {
+        SrsRelayFrame* frame = inflight.begin()->second;
+        inflight.erase(inflight.begin());
+        
+        nn_retransmits++;
+        send_frame(frame, now, pkts);
+    }
+}
+
+srs_utime_t SrsRelaySender::get_srtt()
+{
+    return srtt;
+}
+
+int SrsRelaySender::nn_inflight()
+{
+    return (int)inflight.size();
+}
+
+void SrsRelaySender::packetize(const string& bytes, bool header, srs_utime_t now, vector<string>& pkts)
+{
+    int nb_bytes = (int)bytes.length();
+    for (int pos = 0; pos < nb_bytes; pos += SRS_RELAY_MAX_PAYLOAD) {
+        int size = srs_min(SRS_RELAY_MAX_PAYLOAD, nb_bytes - pos);
+        
+        SrsRelayFrame* frame = new SrsRelayFrame();
+        frame->gop = gop;
+        frame->seq = seq++;
+        frame->prev = prev;
+        frame->flags = (pos == 0? SRS_RELAY_FLAG_FIRST : 0) | (pos + size == nb_bytes? SRS_RELAY_FLAG_LAST : 0);
+        frame->payload = bytes.substr(pos, size);
+        frame->header = header;
+        
+        inflight_bytes += size;
+        send_frame(frame, now, pkts);
+    }
+}
+
+void SrsRelaySender::send_frame(SrsRelayFrame* frame, srs_utime_t now, vector<string>& pkts)
+{
+    // The frame is sent in a new packet number, even for retransmit.
+    uint32_t pn = next_pn++;
+    inflight[pn] = frame;
+    frame->sent_at = now;
+    last_ack_eliciting = now;
+    
+    SrsRelayPacket pkt;
+    pkt.type = SrsRelayPacketData;
+    pkt.conn_id = conn_id;
+    pkt.pn = pn;
+    pkt.base_gop = base_gop;
+    pkt.gop = frame->gop;
+    pkt.seq = frame->seq;
+    pkt.prev = frame->prev;
+    pkt.flags = frame->flags;
+    pkt.payload = frame->payload.data();
+    pkt.size = (int)frame->payload.length();
+    
+    string bytes(pkt.nb_bytes(), 0);
+    SrsBuffer stream((char*)bytes.data(), (int)bytes.length());
+    srs_error_t err = pkt.encode(&stream);
+    srs_assert(err == srs_success);
+    
+    pkts.push_back(bytes);
+    nn_packets++;
+}
+
+void SrsRelaySender::abandon(uint32_t g)
+{
+    if (g <= base_gop) {
+        return;
+    }
+    base_gop = g;
+    
+    std::map<uint32_t, SrsRelayFrame*>::iterator it;
+    for (it = inflight.begin(); it != inflight.end();) {
+        SrsRelayFrame* frame = it->second;
+        if (frame->gop >= base_gop) {
+            ++it;
+            continue;
+        }
+        
+        if (frame->header) {
+            headers_lost = true;
+        }
+        
+        nn_abandoned++;
+        inflight_bytes -= frame->payload.length();
+        srs_freep(frame);
+        inflight.erase(it++);
+    }
+}
+
+srs_utime_t SrsRelaySender::pto()
+{
+    srs_utime_t timeout = srtt + srs_max(4 * rttvar, SRS_UTIME_MILLISECONDS) + SRS_RELAY_ACK_DELAY;
+    return timeout << srs_min(pto_count, 6);
+}
+
+SrsRelayReceiver::SrsRelayReceiver()
+{
+    gop = seq = 0;
+    nn_unacked = 0;
+    unacked_at = 0;
+    nn_packets = nn_duplicated = nn_skipped = 0;
+}
+
+SrsRelayReceiver::~SrsRelayReceiver()
+{
+    std::map<uint64_t, SrsRelayFrame*>::iterator it;
+    for (it = frames.begin(); it != frames.end(); ++it) {
+        SrsRelayFrame* frame = it->second;
+        srs_freep(frame);
+    }
+    frames.clear();
+}
+
+srs_error_t SrsRelayReceiver::on_data(SrsRelayPacket* pkt, srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+    
+    // ACK the packet, even it's duplicated, for the ACK may be lost.
+    on_pn(pkt->pn);
+    if (!nn_unacked++) {
+        unacked_at = now;
+    }
+    nn_packets++;
+    
+    skip(pkt->base_gop);
+    
+    // The number of frames of previous GOP, to move to the GOP when all frames delivered.
+    if (pkt->gop > gop) {
+        counts[pkt->gop - 1] = pkt->prev;
+    }
+    
+    // Ignore the frame delivered or abandoned.
+    uint64_t key = ((uint64_t)pkt->gop << 32) | pkt->seq;
+    if (pkt->gop < gop || (pkt->gop == gop && pkt->seq < seq) || frames.find(key) != frames.end()) {
+        nn_duplicated++;
+        return err;
+    }
+    
+    if ((int)frames.size() >= SRS_RELAY_MAX_FRAMES) {
+        return srs_error_new(ERROR_RELAY_CONGESTED, "frames %d, gop=%u, seq=%u", (int)frames.size(), gop, seq);
+    }
+    
+    SrsRelayFrame* frame = new SrsRelayFrame();
+    frame->gop = pkt->gop;
+    frame->seq = pkt->seq;
+    frame->prev = pkt->prev;
+    frame->flags = pkt->flags;
+    frame->payload.assign(pkt->payload, pkt->size);
+    frame->header = false;
+    frame->sent_at = 0;
+    frames[key] = frame;
+    
+    return err;
+}
+
+srs_error_t SrsRelayReceiver::fetch(SrsCommonMessage** pmsg)
+{
+    srs_error_t err = srs_success;
+    
+    *pmsg = NULL;
+    
+    while (true) {
+        // Move to the next GOP, when all frames of current GOP are delivered.
+        std::map<uint32_t, uint32_t>::iterator it = counts.find(gop);
+        if (it != counts.end() && seq >= it->second) {
+            counts.erase(it);
+            gop++;
+            seq = 0;
+            partial.clear();
+            continue;
+        }
+        
+        std::map<uint64_t, SrsRelayFrame*>::iterator found = frames.find(((uint64_t)gop << 32) | seq);
+        if (found == frames.end()) {
+            return err;
+        }
+        
+        SrsRelayFrame* frame = found->second;
+        frames.erase(found);
+        seq++;
+        
+        if ((frame->flags & SRS_RELAY_FLAG_FIRST) == SRS_RELAY_FLAG_FIRST) {
+            partial.clear();
+        }
+        partial.append(frame->payload);
+        
+        bool last = (frame->flags & SRS_RELAY_FLAG_LAST) == SRS_RELAY_FLAG_LAST;
+        srs_freep(frame);
+        
+        if (!last) {
+            continue;
+        }
+        
+        // Decode the message, type(1B) timestamp(4B) payload.
+        if ((int)partial.length() < SRS_RELAY_MESSAGE_HEADER) {
+            return srs_error_new(ERROR_RELAY_DECODE, "message %d bytes, gop=%u, seq=%u", (int)partial.length(), gop, seq);
+        }
+        
+        SrsBuffer stream((char*)partial.data(), (int)partial.length());
+        char type = stream.read_1bytes();
+        uint32_t timestamp = (uint32_t)stream.read_4bytes();
+        
+        int size = stream.left();
+        char* data = new char[size];
+        memcpy(data, partial.data() + SRS_RELAY_MESSAGE_HEADER, size);
+        partial.clear();
+        
+        // The data is owned by the message.
+        if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, pmsg)) != srs_success) {
+            return srs_error_wrap(err, "create message");
+        }
+        
+        return err;
+    }
+    
+    return err;
+}
+
+bool SrsRelayReceiver::should_ack(srs_utime_t now)
+{
+    return nn_unacked >= SRS_RELAY_ACK_PACKETS || (nn_unacked > 0 && now - unacked_at >= SRS_RELAY_ACK_DELAY);
+}
+
+srs_utime_t SrsRelayReceiver::ack_deadline()
+{
+    return nn_unacked > 0? unacked_at + SRS_RELAY_ACK_DELAY : 0;
+}
+
+void SrsRelayReceiver::ack(SrsRelayPacket* pkt)
+{
+    pkt->type = SrsRelayPacketAck;
+    pkt->ranges = ranges;
+    nn_unacked = 0;
+}
+
+void SrsRelayReceiver::on_pn(uint32_t pn)
+{
+    // Find the position in the descending ranges, ignore if duplicated.
+    std::vector<std::pair<uint32_t, uint32_t> >::iterator it;
+    for (it = ranges.begin(); it != ranges.end(); ++it) {
+        if (pn > it->second) {
+            break;
+        }
+        if (pn >= it->first) {
+            return;
+        }
+    }
+    
+    it = ranges.insert(it, make_pair(pn, pn));
+    
+    // Merge with the lower range.
+    std::vector<std::pair<uint32_t, uint32_t> >::iterator next = it + 1;
+    if (next != ranges.end() && next->second + 1 == pn) {
+        it->first = next->first;
+        ranges.erase(next);
+    }
+    
+    // Merge with the higher range.
+    if (it != ranges.begin()) {
+        std::vector<std::pair<uint32_t, uint32_t> >::iterator higher = it - 1;
+        if (higher->first == it->second + 1) {
+            higher->first = it->first;
+            ranges.erase(it);
+        }
+    }
+    
+    // Forget the oldest ranges, which the sender should have got.
+    if ((int)ranges.size() > SRS_RELAY_MAX_RANGES) {
+        ranges.resize(SRS_RELAY_MAX_RANGES);
+    }
+}
+
+void SrsRelayReceiver::skip(uint32_t base_gop)
+{
+    if (base_gop <= gop) {
+        return;
+    }
+    
+    // The frames of GOPs before it are abandoned, with the message partially reassembled.
+    nn_skipped += base_gop - gop;
+    gop = base_gop;
+    seq = 0;
+    partial.clear();
+    
+    std::map<uint64_t, SrsRelayFrame*>::iterator it;
+    for (it = frames.begin(); it != frames.end() && it->first < ((uint64_t)base_gop << 32);) {
+        SrsRelayFrame* frame = it->second;
+        srs_freep(frame);
+        frames.erase(it++);
+    }
+    
+    counts.erase(counts.begin(), counts.lower_bound(base_gop));
+}
+
+#endif
+
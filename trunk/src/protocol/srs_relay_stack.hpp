@@ -0,0 +1,262 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_PROTOCOL_RELAY_STACK_HPP
+#define SRS_PROTOCOL_RELAY_STACK_HPP
+
+#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string>
+#include <vector>
+#include <map>
+
+class SrsBuffer;
+class SrsCommonMessage;
+class SrsSharedPtrMessage;
+
+// The relay over UDP, for the edge to pull stream from origin over the lossy links, where the TCP stalls
+// all queued messages for a lost packet. The design borrows from QUIC:
+// 1. Each GOP is an ordered stream of frames, and the sender abandons the old GOPs when the next keyframe
+//      comes, so the receiver skips the lost tail of old GOP, instead of waiting for it.
+// 2. The packet number is never reused, the lost frame is retransmitted in a new packet, so the ACK is
+//      never ambiguous, @see https://tools.ietf.org/html/rfc9002
+// 3. The session is identified by the connection id, not the address, so it survives the NAT rebinding
+//      and the migration of edge, without restarting from a keyframe.
+// 4. Each packet is authenticated by the MAC of a shared secret between servers, the origin never creates the
+//      session before the edge echoes the cookie of its address, and never migrates before the new path
+//      echoes the challenge, so the spoofed packets never amplify or hijack the session.
+// @remark There is no encryption, it's for the links between servers.
+
+// The max payload of frame, to avoid the IP fragmentation.
+#define SRS_RELAY_MAX_PAYLOAD 1200
+// The max size of relay packet.
+#define SRS_RELAY_MAX_PACKET 1500
+// The max number of ranges in ACK.
+#define SRS_RELAY_MAX_RANGES 32
+// The size of token, for the cookie of connect and the challenge of path.
+#define SRS_RELAY_TOKEN_SIZE 16
+// The size of MAC appended to each packet, the truncated HMAC-SHA256 of packet by the shared secret.
+#define SRS_RELAY_MAC_SIZE 16
+// The receiver sends ACK for each number of packets, or after the delay.
+#define SRS_RELAY_ACK_PACKETS 2
+#define SRS_RELAY_ACK_DELAY (10 * SRS_UTIME_MILLISECONDS)
+// The packet is lost when there are packets after it acked, @see https://tools.ietf.org/html/rfc9002#section-6.1.1
+#define SRS_RELAY_PACKET_THRESHOLD 3
+// The initial RTT before any sample.
+#define SRS_RELAY_INITIAL_RTT (100 * SRS_UTIME_MILLISECONDS)
+// The max bytes in flight, the sender abandons all old GOPs when exceeded, and fails if the GOP exceeds twice.
+#define SRS_RELAY_MAX_INFLIGHT (16 * 1024 * 1024)
+
+// The type of relay packet.
+enum SrsRelayPacketType
+{
+    // The edge connects to origin, to play the stream by url.
+    SrsRelayPacketConnect = 1,
+    // The origin accepts or rejects the connect, by code.
+    SrsRelayPacketAccept = 2,
+    // The frame of GOP, from origin to edge.
+    SrsRelayPacketData = 3,
+    // The ranges of packet numbers received, from edge to origin.
+    SrsRelayPacketAck = 4,
+    // The keepalive, and the probe of new address when edge migrates.
+    SrsRelayPacketPing = 5,
+    // Close the session, by code.
+    SrsRelayPacketClose = 6,
+    // The origin requires the edge to connect again with the cookie, to validate the address of edge.
+    SrsRelayPacketRetry = 7,
+    // The origin validates the new address of edge by the token, before the session migrates to it.
+    SrsRelayPacketChallenge = 8,
+    // The edge echoes the token of challenge.
+    SrsRelayPacketResponse = 9,
+};
+
+// The flags of frame, for the fragments of message.
+#define SRS_RELAY_FLAG_FIRST 0x01
+#define SRS_RELAY_FLAG_LAST 0x02
+
+// The packet of relay, all fields are in network order.
+//      type(1B) conn_id(4B)
+//      Connect: url_size(2B) url token_size(1B) token
+//      Retry, Challenge, Response: token_size(1B) token
+//      Accept, Close: code(2B)
+//      Data: pn(4B) base_gop(4B) gop(4B) seq(4B) prev(4B) flags(1B) payload
+//      Ack: nb_ranges(1B) [start(4B) end(4B)]...
+class SrsRelayPacket
+{
+public:
+    SrsRelayPacketType type;
+    uint32_t conn_id;
+public:
+    // For Connect, the RTMP url of stream.
+    std::string url;
+    // For Connect, the cookie from Retry, empty for the first one.
+    // For Retry, the cookie. For Challenge and Response, the token of path.
+    std::string token;
+    // For Accept and Close, the error code, 0 for success.
+    uint16_t code;
+public:
+    // For Data, the packet number.
+    uint32_t pn;
+    // For Data, the GOPs before base_gop are abandoned by sender.
+    uint32_t base_gop;
+    // For Data, the frame is the seq-th of the GOP, and the previous GOP has prev frames.
+    uint32_t gop;
+    uint32_t seq;
+    uint32_t prev;
+    uint8_t flags;
+    // For Data, the payload, which points to the packet when decoded.
+    const char* payload;
+    int size;
+public:
+    // For Ack, the ranges of pn [start, end] received, in descending order.
+    std::vector<std::pair<uint32_t, uint32_t> > ranges;
+public:
+    SrsRelayPacket();
+    virtual ~SrsRelayPacket();
+public:
+    virtual srs_error_t decode(char* data, int size);
+    virtual srs_error_t encode(SrsBuffer* stream);
+    virtual int nb_bytes();
+private:
+    virtual srs_error_t decode_token(SrsBuffer* stream);
+};
+
+// The frame sent and not acked yet.
+struct SrsRelayFrame
+{
+    uint32_t gop;
+    uint32_t seq;
+    uint32_t prev;
+    uint8_t flags;
+    std::string payload;
+    // Whether the frame carries the metadata or sequence header.
+    bool header;
+    srs_utime_t sent_at;
+};
+
+// The sender of origin, which packetizes the messages to the frames of GOPs,
+// and retransmits the lost frames by ACK, except the abandoned GOPs.
+class SrsRelaySender
+{
+private:
+    uint32_t conn_id;
+    uint32_t next_pn;
+    // The current GOP, and the next seq of frame in it, the GOP 0 is the one before first keyframe.
+    uint32_t gop;
+    uint32_t seq;
+    // The number of frames of the previous GOP.
+    uint32_t prev;
+    // The GOPs before it are abandoned.
+    uint32_t base_gop;
+    // The frames in flight, by pn.
+    std::map<uint32_t, SrsRelayFrame*> inflight;
+    int64_t inflight_bytes;
+    uint32_t largest_acked;
+    bool has_acked;
+private:
+    // The RTT estimator, @see https://tools.ietf.org/html/rfc9002#section-5
+    srs_utime_t srtt;
+    srs_utime_t rttvar;
+    bool has_rtt;
+    // The probe timeout is doubled for each PTO without ACK.
+    int pto_count;
+    srs_utime_t last_ack_eliciting;
+private:
+    // The latest metadata and sequence headers, which are sent again at the keyframe, when they are abandoned.
+    std::string meta;
+    std::string vsh;
+    std::string ash;
+    bool headers_lost;
+public:
+    // The statistics of sender.
+    int64_t nn_packets;
+    int64_t nn_retransmits;
+    int64_t nn_abandoned;
+public:
+    SrsRelaySender(uint32_t cid);
+    virtual ~SrsRelaySender();
+public:
+    // Packetize the message to the current GOP, start a GOP and abandon the old ones at keyframe.
+    // @param pkts The packets to send.
+    virtual srs_error_t on_message(SrsSharedPtrMessage* msg, srs_utime_t now, std::vector<std::string>& pkts);
+    // Remove the acked frames, then retransmit the lost ones.
+    virtual void on_ack(SrsRelayPacket* ack, srs_utime_t now, std::vector<std::string>& pkts);
+    // Probe by the oldest frames, when no ACK for the probe timeout.
+    virtual void on_timer(srs_utime_t now, std::vector<std::string>& pkts);
+    virtual srs_utime_t get_srtt();
+    virtual int nn_inflight();
+private:
+    virtual void packetize(const std::string& bytes, bool header, srs_utime_t now, std::vector<std::string>& pkts);
+    virtual void send_frame(SrsRelayFrame* frame, srs_utime_t now, std::vector<std::string>& pkts);
+    virtual void abandon(uint32_t gop);
+    virtual srs_utime_t pto();
+};
+
+// The receiver of edge, which reassembles the messages of GOPs in order,
+// skips the GOPs abandoned by sender, and generates the ACK of packets.
+class SrsRelayReceiver
+{
+private:
+    // The GOP and seq of next frame to deliver.
+    uint32_t gop;
+    uint32_t seq;
+    // The frames received and not delivered, by gop<<32 | seq.
+    std::map<uint64_t, SrsRelayFrame*> frames;
+    // The number of frames of GOPs, by the prev of the next GOP.
+    std::map<uint32_t, uint32_t> counts;
+    // The fragments of message to reassemble.
+    std::string partial;
+private:
+    // The ranges of pn [start, end] received, in descending order.
+    std::vector<std::pair<uint32_t, uint32_t> > ranges;
+    // The packets received since last ACK, and when the first one received.
+    int nn_unacked;
+    srs_utime_t unacked_at;
+public:
+    // The statistics of receiver.
+    int64_t nn_packets;
+    int64_t nn_duplicated;
+    int64_t nn_skipped;
+public:
+    SrsRelayReceiver();
+    virtual ~SrsRelayReceiver();
+public:
+    virtual srs_error_t on_data(SrsRelayPacket* pkt, srs_utime_t now);
+    // Fetch the next message in order, NULL if not available.
+    virtual srs_error_t fetch(SrsCommonMessage** pmsg);
+    // Whether to send ACK, and the time to send ACK if not, 0 if nothing to ACK.
+    virtual bool should_ack(srs_utime_t now);
+    virtual srs_utime_t ack_deadline();
+    // Generate the ACK packet of ranges.
+    virtual void ack(SrsRelayPacket* pkt);
+private:
+    virtual void on_pn(uint32_t pn);
+    virtual void skip(uint32_t base_gop);
+};
+
+#endif
+
+#endif
+
@@ -0,0 +1,937 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_rtc_stack.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string.h>
+#include <strings.h>
+#include <sstream>
+using namespace std;
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+
+// The magic cookie of STUN, @see https://tools.ietf.org/html/rfc5389#section-6
+#define SRS_STUN_MAGIC_COOKIE 0x2112A442
+// The XOR value of FINGERPRINT, @see https://tools.ietf.org/html/rfc5389#section-15.5
+#define SRS_STUN_FINGERPRINT_XOR 0x5354554e
+
+// The attributes of STUN.
+#define SRS_STUN_USERNAME 0x0006
+#define SRS_STUN_MESSAGE_INTEGRITY 0x0008
+#define SRS_STUN_XOR_MAPPED_ADDRESS 0x0020
+#define SRS_STUN_USE_CANDIDATE 0x0025
+#define SRS_STUN_FINGERPRINT 0x8028
+
+// The types of RTCP feedback, @see https://tools.ietf.org/html/rfc4585#section-6.1
+#define SRS_RTCP_RTPFB 205
+#define SRS_RTCP_PSFB 206
+
+// The type of H.264 NALU in RTP payload, @see https://tools.ietf.org/html/rfc6184#section-5.2
+#define SRS_RTP_STAP_A 24
+#define SRS_RTP_FU_A 28
+
+bool srs_is_stun(const char* data, int size)
+{
+    return size >= 20 && (data[0] == 0 || data[0] == 1);
+}
+
+bool srs_is_dtls(const char* data, int size)
+{
+    return size >= 13 && (uint8_t)data[0] >= 20 && (uint8_t)data[0] <= 63;
+}
+
+bool srs_is_rtp_or_rtcp(const char* data, int size)
+{
+    return size >= 8 && (uint8_t)data[0] >= 128 && (uint8_t)data[0] <= 191;
+}
+
+bool srs_is_rtcp(const char* data, int size)
+{
+    return size >= 8 && (uint8_t)data[1] >= 192 && (uint8_t)data[1] <= 223;
+}
+
+// Get the size of RTP header, with the CSRC and extension, -1 if invalid.
+int srs_rtp_header_size(const char* buf, int nb_buf)
+{
+    if (nb_buf < SRS_RTP_HEADER) {
+        return -1;
+    }
+    
+    int size = SRS_RTP_HEADER + (buf[0] & 0x0f) * 4;
+    
+    // The extension, @see https://tools.ietf.org/html/rfc3550#section-5.3.1
+    if ((buf[0] & 0x10) != 0) {
+        if (nb_buf < size + 4) {
+            return -1;
+        }
+        size += 4 + (((uint8_t)buf[size + 2] << 8) | (uint8_t)buf[size + 3]) * 4;
+    }
+    
+    return (size <= nb_buf)? size : -1;
+}
+
+SrsStunPacket::SrsStunPacket()
+{
+    message_type = SrsStunBindingRequest;
+    use_candidate = false;
+    mapped_address = 0;
+    mapped_port = 0;
+    integrity_offset = -1;
+}
+
+SrsStunPacket::~SrsStunPacket()
+{
+}
+
+string SrsStunPacket::local_ufrag()
+{
+    size_t pos = username.find(":");
+    return (pos == string::npos)? username : username.substr(0, pos);
+}
+
+string SrsStunPacket::remote_ufrag()
+{
+    size_t pos = username.find(":");
+    return (pos == string::npos)? "" : username.substr(pos + 1);
+}
+
+srs_error_t SrsStunPacket::decode(const char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    SrsBuffer stream((char*)buf, nb_buf);
+    if (!stream.require(20)) {
+        return srs_error_new(ERROR_RTC_STUN, "requires 20 only %d bytes", nb_buf);
+    }
+    
+    message_type = (SrsStunMessageType)(uint16_t)stream.read_2bytes();
+    uint16_t length = (uint16_t)stream.read_2bytes();
+    uint32_t cookie = (uint32_t)stream.read_4bytes();
+    transaction_id = stream.read_string(12);
+    
+    if (cookie != SRS_STUN_MAGIC_COOKIE) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid cookie %#x", cookie);
+    }
+    if ((length & 0x03) != 0 || 20 + length > nb_buf) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid length=%d, size=%d", length, nb_buf);
+    }
+    
+    integrity_offset = -1;
+    while (stream.pos() < 20 + length) {
+        if (!stream.require(4)) {
+            return srs_error_new(ERROR_RTC_STUN, "requires 4 only %d bytes", stream.left());
+        }
+        
+        int start = stream.pos();
+        uint16_t type = (uint16_t)stream.read_2bytes();
+        uint16_t len = (uint16_t)stream.read_2bytes();
+        
+        // The value is padded to 4 bytes, @see https://tools.ietf.org/html/rfc5389#section-15
+        int padded = (len + 3) / 4 * 4;
+        if (!stream.require(padded)) {
+            return srs_error_new(ERROR_RTC_STUN, "attr %#x requires %d only %d bytes", type, padded, stream.left());
+        }
+        string value = stream.read_string(len);
+        stream.skip(padded - len);
+        
+        if (type == SRS_STUN_USERNAME) {
+            username = value;
+        } else if (type == SRS_STUN_USE_CANDIDATE) {
+            use_candidate = true;
+        } else if (type == SRS_STUN_MESSAGE_INTEGRITY) {
+            integrity_offset = start;
+        } else if (type == SRS_STUN_XOR_MAPPED_ADDRESS && len >= 8 && value.at(1) == 0x01) {
+            const uint8_t* p = (const uint8_t*)value.data();
+            mapped_port = (uint16_t)(((p[2] << 8) | p[3]) ^ (SRS_STUN_MAGIC_COOKIE >> 16));
+            mapped_address = (uint32_t)((p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7]) ^ SRS_STUN_MAGIC_COOKIE;
+        }
+    }
+    
+    return err;
+}
+
+bool SrsStunPacket::verify(const char* buf, int nb_buf, string pwd)
+{
+    if (integrity_offset < 20 || integrity_offset + 24 > nb_buf) {
+        return false;
+    }
+    
+    // The length covers the MESSAGE-INTEGRITY, @see https://tools.ietf.org/html/rfc5389#section-15.4
+    string data(buf, integrity_offset);
+    uint16_t length = (uint16_t)(integrity_offset - 20 + 24);
+    data[2] = (char)(length >> 8);
+    data[3] = (char)length;
+    
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int nb_digest = 0;
+    if (!HMAC(EVP_sha1(), pwd.data(), (int)pwd.length(), (const uint8_t*)data.data(), data.length(), digest, &nb_digest)) {
+        return false;
+    }
+    
+    return nb_digest == 20 && CRYPTO_memcmp(digest, buf + integrity_offset + 4, 20) == 0;
+}
+
+srs_error_t SrsStunPacket::encode(string pwd, SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    if (transaction_id.length() != 12) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid transaction id %d bytes", (int)transaction_id.length());
+    }
+    
+    int nb_username = (int)(username.length() + 3) / 4 * 4;
+    int size = 20 + (username.empty()? 0 : 4 + nb_username) + 12 + 4 + 24 + 8;
+    if (!stream->require(size)) {
+        return srs_error_new(ERROR_RTC_STUN, "requires %d only %d bytes", size, stream->left());
+    }
+    
+    int begin = stream->pos();
+    stream->write_2bytes((int16_t)message_type);
+    stream->write_2bytes(0);
+    stream->write_4bytes(SRS_STUN_MAGIC_COOKIE);
+    stream->write_string(transaction_id);
+    
+    if (!username.empty()) {
+        stream->write_2bytes(SRS_STUN_USERNAME);
+        stream->write_2bytes((int16_t)username.length());
+        stream->write_string(username);
+        stream->write_string(string(nb_username - username.length(), '\0'));
+    }
+    
+    if (message_type == SrsStunBindingSuccessResponse) {
+        stream->write_2bytes(SRS_STUN_XOR_MAPPED_ADDRESS);
+        stream->write_2bytes(8);
+        stream->write_1bytes(0);
+        stream->write_1bytes(0x01);
+        stream->write_2bytes((int16_t)(mapped_port ^ (SRS_STUN_MAGIC_COOKIE >> 16)));
+        stream->write_4bytes((int32_t)(mapped_address ^ SRS_STUN_MAGIC_COOKIE));
+    }
+    
+    if (use_candidate) {
+        stream->write_2bytes(SRS_STUN_USE_CANDIDATE);
+        stream->write_2bytes(0);
+    }
+    
+    // The length covers the attribute being appended, @see https://tools.ietf.org/html/rfc5389#section-15.4
+    char* p = stream->data() + begin;
+    if (true) {
+        int nn = stream->pos() - begin;
+        uint16_t length = (uint16_t)(nn - 20 + 24);
+        p[2] = (char)(length >> 8);
+        p[3] = (char)length;
+        
+        uint8_t digest[EVP_MAX_MD_SIZE];
+        unsigned int nb_digest = 0;
+        if (!HMAC(EVP_sha1(), pwd.data(), (int)pwd.length(), (const uint8_t*)p, nn, digest, &nb_digest)) {
+            return srs_error_new(ERROR_RTC_STUN, "hmac-sha1");
+        }
+        
+        stream->write_2bytes(SRS_STUN_MESSAGE_INTEGRITY);
+        stream->write_2bytes(20);
+        stream->write_bytes((char*)digest, 20);
+    }
+    
+    // The FINGERPRINT, @see https://tools.ietf.org/html/rfc5389#section-15.5
+    if (true) {
+        int nn = stream->pos() - begin;
+        uint16_t length = (uint16_t)(nn - 20 + 8);
+        p[2] = (char)(length >> 8);
+        p[3] = (char)length;
+        
+        uint32_t crc32 = srs_crc32_ieee(p, nn) ^ SRS_STUN_FINGERPRINT_XOR;
+        stream->write_2bytes((int16_t)SRS_STUN_FINGERPRINT);
+        stream->write_2bytes(4);
+        stream->write_4bytes((int32_t)crc32);
+    }
+    
+    return err;
+}
+
+SrsSrtp::SrsSrtp()
+{
+    memset(rtp_key, 0, sizeof(rtp_key));
+    memset(rtp_salt, 0, sizeof(rtp_salt));
+    memset(rtp_auth, 0, sizeof(rtp_auth));
+    memset(rtcp_key, 0, sizeof(rtcp_key));
+    memset(rtcp_salt, 0, sizeof(rtcp_salt));
+    memset(rtcp_auth, 0, sizeof(rtcp_auth));
+    
+    ctx = EVP_CIPHER_CTX_new();
+    srtcp_index = 0;
+}
+
+SrsSrtp::~SrsSrtp()
+{
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
+}
+
+srs_error_t SrsSrtp::initialize(const char* key, const char* salt)
+{
+    srs_error_t err = srs_success;
+    
+    const uint8_t* k = (const uint8_t*)key;
+    const uint8_t* s = (const uint8_t*)salt;
+    
+    // The labels of session keys, @see https://tools.ietf.org/html/rfc3711#section-4.3.2
+    if ((err = derive(k, s, 0x00, rtp_key, sizeof(rtp_key))) != srs_success) {
+        return srs_error_wrap(err, "rtp key");
+    }
+    if ((err = derive(k, s, 0x01, rtp_auth, sizeof(rtp_auth))) != srs_success) {
+        return srs_error_wrap(err, "rtp auth");
+    }
+    if ((err = derive(k, s, 0x02, rtp_salt, sizeof(rtp_salt))) != srs_success) {
+        return srs_error_wrap(err, "rtp salt");
+    }
+    if ((err = derive(k, s, 0x03, rtcp_key, sizeof(rtcp_key))) != srs_success) {
+        return srs_error_wrap(err, "rtcp key");
+    }
+    if ((err = derive(k, s, 0x04, rtcp_auth, sizeof(rtcp_auth))) != srs_success) {
+        return srs_error_wrap(err, "rtcp auth");
+    }
+    if ((err = derive(k, s, 0x05, rtcp_salt, sizeof(rtcp_salt))) != srs_success) {
+        return srs_error_wrap(err, "rtcp salt");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsSrtp::protect_rtp(char* buf, int* pnb_buf, uint32_t roc)
+{
+    srs_error_t err = srs_success;
+    
+    int size = *pnb_buf;
+    int nb_header = srs_rtp_header_size(buf, size);
+    if (nb_header < 0) {
+        return srs_error_new(ERROR_RTC_SRTP, "invalid rtp size=%d", size);
+    }
+    
+    uint32_t ssrc = ((uint8_t)buf[8] << 24) | ((uint8_t)buf[9] << 16) | ((uint8_t)buf[10] << 8) | (uint8_t)buf[11];
+    uint16_t seq = ((uint8_t)buf[2] << 8) | (uint8_t)buf[3];
+    uint64_t index = ((uint64_t)roc << 16) | seq;
+    
+    if ((err = cipher(rtp_key, rtp_salt, ssrc, index, buf + nb_header, size - nb_header)) != srs_success) {
+        return srs_error_wrap(err, "encrypt");
+    }
+    
+    // The auth tag is HMAC-SHA1 of the packet and ROC, @see https://tools.ietf.org/html/rfc3711#section-4.2
+    SrsBuffer stream(buf + size, 4);
+    stream.write_4bytes((int32_t)roc);
+    
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int nb_digest = 0;
+    if (!HMAC(EVP_sha1(), rtp_auth, sizeof(rtp_auth), (const uint8_t*)buf, size + 4, digest, &nb_digest)) {
+        return srs_error_new(ERROR_RTC_SRTP, "hmac-sha1");
+    }
+    
+    memcpy(buf + size, digest, SRS_SRTP_AUTH_TAG);
+    *pnb_buf = size + SRS_SRTP_AUTH_TAG;
+    
+    return err;
+}
+
+srs_error_t SrsSrtp::unprotect_rtp(char* buf, int* pnb_buf, uint32_t roc)
+{
+    srs_error_t err = srs_success;
+    
+    int size = *pnb_buf - SRS_SRTP_AUTH_TAG;
+    int nb_header = srs_rtp_header_size(buf, size);
+    if (nb_header < 0) {
+        return srs_error_new(ERROR_RTC_SRTP, "invalid srtp size=%d", *pnb_buf);
+    }
+    
+    char tag[SRS_SRTP_AUTH_TAG];
+    memcpy(tag, buf + size, SRS_SRTP_AUTH_TAG);
+    
+    SrsBuffer stream(buf + size, 4);
+    stream.write_4bytes((int32_t)roc);
+    
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int nb_digest = 0;
+    if (!HMAC(EVP_sha1(), rtp_auth, sizeof(rtp_auth), (const uint8_t*)buf, size + 4, digest, &nb_digest)) {
+        return srs_error_new(ERROR_RTC_SRTP, "hmac-sha1");
+    }
+    if (CRYPTO_memcmp(digest, tag, SRS_SRTP_AUTH_TAG) != 0) {
+        return srs_error_new(ERROR_RTC_SRTP, "auth failed, size=%d, roc=%u", size, roc);
+    }
+    
+    uint32_t ssrc = ((uint8_t)buf[8] << 24) | ((uint8_t)buf[9] << 16) | ((uint8_t)buf[10] << 8) | (uint8_t)buf[11];
+    uint16_t seq = ((uint8_t)buf[2] << 8) | (uint8_t)buf[3];
+    uint64_t index = ((uint64_t)roc << 16) | seq;
+    
+    if ((err = cipher(rtp_key, rtp_salt, ssrc, index, buf + nb_header, size - nb_header)) != srs_success) {
+        return srs_error_wrap(err, "decrypt");
+    }
+    
+    *pnb_buf = size;
+    
+    return err;
+}
+
+srs_error_t SrsSrtp::protect_rtcp(char* buf, int* pnb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    int size = *pnb_buf;
+    if (size < 8) {
+        return srs_error_new(ERROR_RTC_SRTP, "invalid rtcp size=%d", size);
+    }
+    
+    uint32_t ssrc = ((uint8_t)buf[4] << 24) | ((uint8_t)buf[5] << 16) | ((uint8_t)buf[6] << 8) | (uint8_t)buf[7];
+    uint32_t index = srtcp_index++ & 0x7fffffff;
+    
+    // The first 8 bytes are not encrypted, @see https://tools.ietf.org/html/rfc3711#section-3.4
+    if ((err = cipher(rtcp_key, rtcp_salt, ssrc, index, buf + 8, size - 8)) != srs_success) {
+        return srs_error_wrap(err, "encrypt");
+    }
+    
+    SrsBuffer stream(buf + size, SRS_SRTCP_INDEX);
+    stream.write_4bytes((int32_t)(0x80000000 | index));
+    
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int nb_digest = 0;
+    if (!HMAC(EVP_sha1(), rtcp_auth, sizeof(rtcp_auth), (const uint8_t*)buf, size + SRS_SRTCP_INDEX, digest, &nb_digest)) {
+        return srs_error_new(ERROR_RTC_SRTP, "hmac-sha1");
+    }
+    
+    memcpy(buf + size + SRS_SRTCP_INDEX, digest, SRS_SRTP_AUTH_TAG);
+    *pnb_buf = size + SRS_SRTCP_INDEX + SRS_SRTP_AUTH_TAG;
+    
+    return err;
+}
+
+srs_error_t SrsSrtp::unprotect_rtcp(char* buf, int* pnb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    int size = *pnb_buf - SRS_SRTCP_INDEX - SRS_SRTP_AUTH_TAG;
+    if (size < 8) {
+        return srs_error_new(ERROR_RTC_SRTP, "invalid srtcp size=%d", *pnb_buf);
+    }
+    
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int nb_digest = 0;
+    if (!HMAC(EVP_sha1(), rtcp_auth, sizeof(rtcp_auth), (const uint8_t*)buf, size + SRS_SRTCP_INDEX, digest, &nb_digest)) {
+        return srs_error_new(ERROR_RTC_SRTP, "hmac-sha1");
+    }
+    if (CRYPTO_memcmp(digest, buf + size + SRS_SRTCP_INDEX, SRS_SRTP_AUTH_TAG) != 0) {
+        return srs_error_new(ERROR_RTC_SRTP, "auth failed, size=%d", size);
+    }
+    
+    SrsBuffer stream(buf + size, SRS_SRTCP_INDEX);
+    uint32_t index = (uint32_t)stream.read_4bytes();
+    
+    // Decrypt when the E flag is set.
+    if ((index & 0x80000000) != 0) {
+        uint32_t ssrc = ((uint8_t)buf[4] << 24) | ((uint8_t)buf[5] << 16) | ((uint8_t)buf[6] << 8) | (uint8_t)buf[7];
+        if ((err = cipher(rtcp_key, rtcp_salt, ssrc, index & 0x7fffffff, buf + 8, size - 8)) != srs_success) {
+            return srs_error_wrap(err, "decrypt");
+        }
+    }
+    
+    *pnb_buf = size;
+    
+    return err;
+}
+
+srs_error_t SrsSrtp::derive(const uint8_t* key, const uint8_t* salt, uint8_t label, uint8_t* out, int size)
+{
+    // The x = key_id XOR master_salt, where key_id = label || r, and r is 0 for key_derivation_rate is 0.
+    uint8_t iv[16];
+    memcpy(iv, salt, 14);
+    iv[7] ^= label;
+    iv[14] = iv[15] = 0;
+    
+    // The session key is the keystream of AES-CM, that is to encrypt zeros.
+    uint8_t zeros[32];
+    memset(zeros, 0, sizeof(zeros));
+    srs_assert(size <= (int)sizeof(zeros));
+    
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    int nb_out = 0;
+    if (EVP_EncryptInit_ex(c, EVP_aes_128_ctr(), NULL, key, iv) != 1
+        || EVP_EncryptUpdate(c, out, &nb_out, zeros, size) != 1) {
+        return srs_error_new(ERROR_RTC_SRTP, "derive label=%d", label);
+    }
+    
+    return srs_success;
+}
+
+srs_error_t SrsSrtp::cipher(const uint8_t* key, const uint8_t* salt, uint32_t ssrc, uint64_t index, char* buf, int size)
+{
+    // The IV = (k_s * 2^16) XOR (SSRC * 2^64) XOR (i * 2^16), @see https://tools.ietf.org/html/rfc3711#section-4.1.1
+    uint8_t iv[16];
+    memcpy(iv, salt, 14);
+    iv[14] = iv[15] = 0;
+    
+    for (int i = 0; i < 4; i++) {
+        iv[4 + i] ^= (uint8_t)(ssrc >> (24 - i * 8));
+    }
+    for (int i = 0; i < 6; i++) {
+        iv[8 + i] ^= (uint8_t)(index >> (40 - i * 8));
+    }
+    
+    if (size <= 0) {
+        return srs_success;
+    }
+    
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    int nb_out = 0;
+    if (EVP_EncryptInit_ex(c, EVP_aes_128_ctr(), NULL, key, iv) != 1
+        || EVP_EncryptUpdate(c, (uint8_t*)buf, &nb_out, (const uint8_t*)buf, size) != 1) {
+        return srs_error_new(ERROR_RTC_SRTP, "aes-cm size=%d", size);
+    }
+    
+    return srs_success;
+}
+
+SrsRtcSdpMedia::SrsRtcSdpMedia()
+{
+    port = 0;
+    rtcp_mux = false;
+    ssrc = 0;
+}
+
+SrsRtcSdpMedia::~SrsRtcSdpMedia()
+{
+}
+
+int SrsRtcSdpMedia::find_h264()
+{
+    int found = -1;
+    
+    for (int i = 0; i < (int)payload_types.size(); i++) {
+        int pt = payload_types.at(i);
+        
+        string rtpmap = rtpmaps[pt];
+        if (strncasecmp(rtpmap.c_str(), "H264/90000", 10) != 0) {
+            continue;
+        }
+        
+        // The single NAL unit mode is not supported, for we need FU-A for the large NALUs.
+        string fmtp = fmtps[pt];
+        if (fmtp.find("packetization-mode=1") == string::npos) {
+            continue;
+        }
+        
+        if (fmtp.find("profile-level-id=42e01f") != string::npos) {
+            return pt;
+        }
+        if (found < 0) {
+            found = pt;
+        }
+    }
+    
+    return found;
+}
+
+SrsRtcSdp::SrsRtcSdp()
+{
+    ice_lite = false;
+}
+
+SrsRtcSdp::~SrsRtcSdp()
+{
+}
+
+srs_error_t SrsRtcSdp::parse(string sdp)
+{
+    srs_error_t err = srs_success;
+    
+    vector<string> lines = srs_string_split(sdp, "\n");
+    for (int i = 0; i < (int)lines.size(); i++) {
+        string line = srs_string_trim_end(lines.at(i), "\r");
+        if (line.length() < 2 || line.at(1) != '=') {
+            continue;
+        }
+        
+        char type = line.at(0);
+        string value = line.substr(2);
+        
+        if (type == 'o') {
+            vector<string> vs = srs_string_split(value, " ");
+            if (vs.size() > 1) {
+                session_id = vs.at(1);
+            }
+            continue;
+        }
+        
+        // The media, for example, m=video 9 UDP/TLS/RTP/SAVPF 96 97
+        if (type == 'm') {
+            vector<string> vs = srs_string_split(value, " ");
+            if (vs.size() < 4) {
+                return srs_error_new(ERROR_RTC_SDP, "invalid media %s", value.c_str());
+            }
+            
+            SrsRtcSdpMedia media;
+            media.type = vs.at(0);
+            media.port = ::atoi(vs.at(1).c_str());
+            media.protocol = vs.at(2);
+            for (int j = 3; j < (int)vs.size(); j++) {
+                media.payload_types.push_back(::atoi(vs.at(j).c_str()));
+            }
+            medias.push_back(media);
+            continue;
+        }
+        
+        if (type != 'a') {
+            continue;
+        }
+        
+        size_t pos = value.find(":");
+        string key = value.substr(0, pos);
+        string v = (pos == string::npos)? "" : value.substr(pos + 1);
+        
+        // The session attributes, which are also allowed in media.
+        if (key == "ice-ufrag") {
+            ice_ufrag = v;
+        } else if (key == "ice-pwd") {
+            ice_pwd = v;
+        } else if (key == "ice-lite") {
+            ice_lite = true;
+        } else if (key == "setup") {
+            setup = v;
+        } else if (key == "fingerprint") {
+            size_t sp = v.find(" ");
+            if (sp != string::npos) {
+                fingerprint_algo = v.substr(0, sp);
+                fingerprint = v.substr(sp + 1);
+            }
+        } else if (key == "msid-semantic") {
+            msid_semantic = srs_string_trim_start(v, " ");
+        }
+        
+        if (medias.empty()) {
+            continue;
+        }
+        SrsRtcSdpMedia& media = medias.back();
+        
+        if (key == "mid") {
+            media.mid = v;
+        } else if (key == "sendonly" || key == "recvonly" || key == "sendrecv" || key == "inactive") {
+            media.direction = key;
+        } else if (key == "rtcp-mux") {
+            media.rtcp_mux = true;
+        } else if (key == "rtpmap" || key == "fmtp" || key == "rtcp-fb") {
+            size_t sp = v.find(" ");
+            if (sp == string::npos) {
+                continue;
+            }
+            int pt = ::atoi(v.substr(0, sp).c_str());
+            string desc = v.substr(sp + 1);
+            
+            if (key == "rtpmap") {
+                media.rtpmaps[pt] = desc;
+            } else if (key == "fmtp") {
+                media.fmtps[pt] = desc;
+            } else {
+                media.rtcp_fbs[pt].push_back(desc);
+            }
+        } else if (key == "ssrc") {
+            size_t sp = v.find(" ");
+            if (sp == string::npos) {
+                continue;
+            }
+            media.ssrc = (uint32_t)::strtoul(v.substr(0, sp).c_str(), NULL, 10);
+            
+            string attr = v.substr(sp + 1);
+            if (srs_string_starts_with(attr, "cname:")) {
+                media.cname = attr.substr(6);
+            } else if (srs_string_starts_with(attr, "msid:")) {
+                media.msid = attr.substr(5);
+            }
+        }
+    }
+    
+    if (medias.empty()) {
+        return srs_error_new(ERROR_RTC_SDP, "no media");
+    }
+    
+    return err;
+}
+
+string SrsRtcSdp::encode()
+{
+    stringstream ss;
+    
+    ss << "v=0" << "\r\n"
+        << "o=SRS/" << RTMP_SIG_SRS_VERSION << " " << session_id << " 2 IN IP4 0.0.0.0" << "\r\n"
+        << "s=" << RTMP_SIG_SRS_KEY << "\r\n"
+        << "t=0 0" << "\r\n";
+    
+    if (ice_lite) {
+        ss << "a=ice-lite" << "\r\n";
+    }
+    
+    // The medias which are not rejected are bundled, @see https://tools.ietf.org/html/rfc8843
+    string bundle;
+    for (int i = 0; i < (int)medias.size(); i++) {
+        const SrsRtcSdpMedia& media = medias.at(i);
+        if (media.port) {
+            bundle += " " + media.mid;
+        }
+    }
+    if (!bundle.empty()) {
+        ss << "a=group:BUNDLE" << bundle << "\r\n";
+    }
+    
+    if (!msid_semantic.empty()) {
+        ss << "a=msid-semantic: " << msid_semantic << "\r\n";
+    }
+    
+    for (int i = 0; i < (int)medias.size(); i++) {
+        const SrsRtcSdpMedia& media = medias.at(i);
+        
+        ss << "m=" << media.type << " " << media.port << " " << media.protocol;
+        for (int j = 0; j < (int)media.payload_types.size(); j++) {
+            ss << " " << media.payload_types.at(j);
+        }
+        ss << "\r\n";
+        ss << "c=IN IP4 0.0.0.0" << "\r\n";
+        
+        // The rejected media only requires the mid, @see https://tools.ietf.org/html/rfc8829#section-5.3.1
+        if (!media.port) {
+            ss << "a=mid:" << media.mid << "\r\n";
+            continue;
+        }
+        
+        ss << "a=ice-ufrag:" << ice_ufrag << "\r\n"
+            << "a=ice-pwd:" << ice_pwd << "\r\n"
+            << "a=fingerprint:" << fingerprint_algo << " " << fingerprint << "\r\n"
+            << "a=setup:" << setup << "\r\n"
+            << "a=mid:" << media.mid << "\r\n";
+        if (!media.direction.empty()) {
+            ss << "a=" << media.direction << "\r\n";
+        }
+        if (media.rtcp_mux) {
+            ss << "a=rtcp-mux" << "\r\n";
+        }
+        
+        for (int j = 0; j < (int)media.payload_types.size(); j++) {
+            int pt = media.payload_types.at(j);
+            
+            map<int, string>::const_iterator it = media.rtpmaps.find(pt);
+            if (it != media.rtpmaps.end()) {
+                ss << "a=rtpmap:" << pt << " " << it->second << "\r\n";
+            }
+            
+            map<int, vector<string> >::const_iterator fbs = media.rtcp_fbs.find(pt);
+            for (int k = 0; fbs != media.rtcp_fbs.end() && k < (int)fbs->second.size(); k++) {
+                ss << "a=rtcp-fb:" << pt << " " << fbs->second.at(k) << "\r\n";
+            }
+            
+            it = media.fmtps.find(pt);
+            if (it != media.fmtps.end()) {
+                ss << "a=fmtp:" << pt << " " << it->second << "\r\n";
+            }
+        }
+        
+        if (media.ssrc) {
+            ss << "a=ssrc:" << media.ssrc << " cname:" << media.cname << "\r\n";
+            if (!media.msid.empty()) {
+                ss << "a=ssrc:" << media.ssrc << " msid:" << media.msid << "\r\n";
+            }
+        }
+        
+        for (int j = 0; j < (int)candidates.size(); j++) {
+            ss << "a=candidate:" << candidates.at(j) << "\r\n";
+        }
+    }
+    
+    return ss.str();
+}
+
+SrsRtpH264Packetizer::SrsRtpH264Packetizer(uint8_t pt, uint32_t s)
+{
+    payload_type = pt;
+    ssrc = s;
+    sequence = 0;
+}
+
+SrsRtpH264Packetizer::~SrsRtpH264Packetizer()
+{
+}
+
+void SrsRtpH264Packetizer::packetize_sps_pps(uint32_t timestamp, const vector<char>& sps, const vector<char>& pps, vector<string>& packets)
+{
+    if (sps.empty() || pps.empty()) {
+        return;
+    }
+    
+    // Send them in single NAL unit, when too large for STAP-A.
+    if (1 + 2 + sps.size() + 2 + pps.size() > SRS_RTP_MAX_PAYLOAD) {
+        packets.push_back(header(timestamp, false) + string(&sps[0], sps.size()));
+        packets.push_back(header(timestamp, false) + string(&pps[0], pps.size()));
+        return;
+    }
+    
+    // The NRI of STAP-A is the max of NALUs, @see https://tools.ietf.org/html/rfc6184#section-5.7.1
+    string packet = header(timestamp, false);
+    packet.push_back((char)(srs_max(sps[0] & 0x60, pps[0] & 0x60) | SRS_RTP_STAP_A));
+    
+    packet.push_back((char)(sps.size() >> 8));
+    packet.push_back((char)sps.size());
+    packet.append(&sps[0], sps.size());
+    
+    packet.push_back((char)(pps.size() >> 8));
+    packet.push_back((char)pps.size());
+    packet.append(&pps[0], pps.size());
+    
+    packets.push_back(packet);
+}
+
+void SrsRtpH264Packetizer::packetize(uint32_t timestamp, SrsSample* samples, int nb_samples, vector<string>& packets)
+{
+    // The AUD is useless for RTP, which is framed by the marker.
+    int last = -1;
+    for (int i = 0; i < nb_samples; i++) {
+        SrsSample* sample = samples + i;
+        if (sample->size > 0 && (SrsAvcNaluType)(sample->bytes[0] & 0x1f) != SrsAvcNaluTypeAccessUnitDelimiter) {
+            last = i;
+        }
+    }
+    
+    for (int i = 0; i <= last; i++) {
+        SrsSample* sample = samples + i;
+        if (sample->size <= 0 || (SrsAvcNaluType)(sample->bytes[0] & 0x1f) == SrsAvcNaluTypeAccessUnitDelimiter) {
+            continue;
+        }
+        
+        // The single NAL unit packet, @see https://tools.ietf.org/html/rfc6184#section-5.6
+        if (sample->size <= SRS_RTP_MAX_PAYLOAD) {
+            packets.push_back(header(timestamp, i == last) + string(sample->bytes, sample->size));
+            continue;
+        }
+        
+        // The FU-A, without the NALU header, which is in the FU indicator and header,
+        // @see https://tools.ietf.org/html/rfc6184#section-5.8
+        uint8_t nalu_header = (uint8_t)sample->bytes[0];
+        char* p = sample->bytes + 1;
+        int left = sample->size - 1;
+        bool start = true;
+        
+        while (left > 0) {
+            int size = srs_min(left, SRS_RTP_MAX_PAYLOAD - 2);
+            bool end = (size == left);
+            
+            string packet = header(timestamp, end && i == last);
+            packet.push_back((char)((nalu_header & 0xe0) | SRS_RTP_FU_A));
+            packet.push_back((char)((start? 0x80 : 0) | (end? 0x40 : 0) | (nalu_header & 0x1f)));
+            packet.append(p, size);
+            packets.push_back(packet);
+            
+            p += size;
+            left -= size;
+            start = false;
+        }
+    }
+}
+
+string SrsRtpH264Packetizer::header(uint32_t timestamp, bool marker)
+{
+    char buf[SRS_RTP_HEADER];
+    SrsBuffer stream(buf, sizeof(buf));
+    
+    // The version is 2, without padding, extension and CSRC, @see https://tools.ietf.org/html/rfc3550#section-5.1
+    stream.write_1bytes((int8_t)0x80);
+    stream.write_1bytes((int8_t)((marker? 0x80 : 0) | (payload_type & 0x7f)));
+    stream.write_2bytes((int16_t)sequence++);
+    stream.write_4bytes((int32_t)timestamp);
+    stream.write_4bytes((int32_t)ssrc);
+    
+    return string(buf, sizeof(buf));
+}
+
+SrsRtcpFeedback::SrsRtcpFeedback()
+{
+    keyframe = false;
+}
+
+SrsRtcpFeedback::~SrsRtcpFeedback()
+{
+}
+
+srs_error_t SrsRtcpFeedback::decode(const char* buf, int nb_buf)
+{
+    srs_error_t err = srs_success;
+    
+    SrsBuffer stream((char*)buf, nb_buf);
+    while (!stream.empty()) {
+        if (!stream.require(4)) {
+            return srs_error_new(ERROR_RTC_RTCP, "requires 4 only %d bytes", stream.left());
+        }
+        
+        int start = stream.pos();
+        uint8_t b0 = (uint8_t)stream.read_1bytes();
+        uint8_t pt = (uint8_t)stream.read_1bytes();
+        int size = ((uint16_t)stream.read_2bytes() + 1) * 4;
+        
+        if ((b0 >> 6) != 2) {
+            return srs_error_new(ERROR_RTC_RTCP, "invalid version %d", b0 >> 6);
+        }
+        if (!stream.require(size - 4)) {
+            return srs_error_new(ERROR_RTC_RTCP, "requires %d only %d bytes", size - 4, stream.left());
+        }
+        
+        // The FMT of feedback, @see https://tools.ietf.org/html/rfc4585#section-6.1
+        int fmt = b0 & 0x1f;
+        
+        // The generic NACK, the PID and BLP after the SSRCs, @see https://tools.ietf.org/html/rfc4585#section-6.2.1
+        if (pt == SRS_RTCP_RTPFB && fmt == 1 && size >= 12) {
+            stream.skip(8);
+            for (int pos = 12; pos + 4 <= size; pos += 4) {
+                uint16_t pid = (uint16_t)stream.read_2bytes();
+                uint16_t blp = (uint16_t)stream.read_2bytes();
+                
+                nacks.push_back(pid);
+                for (int i = 0; i < 16; i++) {
+                    if ((blp & (1 << i)) != 0) {
+                        nacks.push_back((uint16_t)(pid + i + 1));
+                    }
+                }
+            }
+        }
+        
+        // The PLI and FIR, @see https://tools.ietf.org/html/rfc4585#section-6.3.1
+        if (pt == SRS_RTCP_PSFB && (fmt == 1 || fmt == 4)) {
+            keyframe = true;
+        }
+        
+        stream.skip(start + size - stream.pos());
+    }
+    
+    return err;
+}
+
+#endif
+
@@ -0,0 +1,249 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_PROTOCOL_RTC_STACK_HPP
+#define SRS_PROTOCOL_RTC_STACK_HPP
+
+#include <srs_core.hpp>
+
+#if !defined(SRS_EXPORT_LIBRTMP)
+
+#include <string>
+#include <vector>
+#include <map>
+
+class SrsBuffer;
+class SrsSample;
+
+// The max payload size of RTP, to avoid the IP fragmentation, for the MTU of path is about 1500 bytes,
+// while there are the headers of IP, UDP, RTP and SRTP, and maybe the TURN or VPN.
+#define SRS_RTP_MAX_PAYLOAD 1200
+// The max size of RTP or RTCP packet, with the SRTP or SRTCP trailer.
+#define SRS_RTP_MAX_PACKET 1500
+// The size of RTP header, without the CSRC and extension.
+#define SRS_RTP_HEADER 12
+// The size of auth tag of AES_CM_128_HMAC_SHA1_80.
+#define SRS_SRTP_AUTH_TAG 10
+// The size of SRTCP index, with the E flag.
+#define SRS_SRTCP_INDEX 4
+// The size of master key and salt of AES_CM_128_HMAC_SHA1_80.
+#define SRS_SRTP_MASTER_KEY 16
+#define SRS_SRTP_MASTER_SALT 14
+
+// Demux the packets on the same port by the first byte, @see https://tools.ietf.org/html/rfc7983
+extern bool srs_is_stun(const char* data, int size);
+extern bool srs_is_dtls(const char* data, int size);
+extern bool srs_is_rtp_or_rtcp(const char* data, int size);
+// Whether the RTP or RTCP packet is RTCP, by the payload type, @see https://tools.ietf.org/html/rfc5761#section-4
+extern bool srs_is_rtcp(const char* data, int size);
+
+// The type of STUN message.
+enum SrsStunMessageType
+{
+    SrsStunBindingRequest = 0x0001,
+    SrsStunBindingSuccessResponse = 0x0101,
+};
+
+// The STUN binding request and response for ICE-lite, which is authenticated by the short-term
+// credential, that is the ice-pwd of receiver.
+// @see https://tools.ietf.org/html/rfc5389
+// @see https://tools.ietf.org/html/rfc8445#section-7.3
+class SrsStunPacket
+{
+public:
+    SrsStunMessageType message_type;
+    // The transaction id in 12 bytes.
+    std::string transaction_id;
+    // The USERNAME, which is "receiver_ufrag:sender_ufrag".
+    std::string username;
+    // Whether the controlling agent nominates the candidate pair.
+    bool use_candidate;
+    // The XOR-MAPPED-ADDRESS of response, the IPv4 address and port in host order.
+    uint32_t mapped_address;
+    uint16_t mapped_port;
+private:
+    // The offset of MESSAGE-INTEGRITY in the decoded packet, -1 if no.
+    int integrity_offset;
+public:
+    SrsStunPacket();
+    virtual ~SrsStunPacket();
+public:
+    // The ufrag of receiver and sender, parsed from the USERNAME.
+    virtual std::string local_ufrag();
+    virtual std::string remote_ufrag();
+public:
+    // Decode the STUN packet, the MESSAGE-INTEGRITY is verified by verify().
+    virtual srs_error_t decode(const char* buf, int nb_buf);
+    // Verify the MESSAGE-INTEGRITY of the decoded packet, by the pwd of receiver.
+    virtual bool verify(const char* buf, int nb_buf, std::string pwd);
+    // Encode the packet, with the MESSAGE-INTEGRITY by pwd and the FINGERPRINT.
+    // @remark The buffer should be at least SRS_RTP_MAX_PACKET bytes.
+    virtual srs_error_t encode(std::string pwd, SrsBuffer* stream);
+};
+
+// The SRTP and SRTCP context of a direction, by the keying material exported from DTLS. Only the
+// crypto suite AES_CM_128_HMAC_SHA1_80 is supported, which is the default profile of WebRTC.
+// @see https://tools.ietf.org/html/rfc3711
+// @see https://tools.ietf.org/html/rfc5764
+class SrsSrtp
+{
+private:
+    // The session keys derived from master key and salt.
+    uint8_t rtp_key[16];
+    uint8_t rtp_salt[14];
+    uint8_t rtp_auth[20];
+    uint8_t rtcp_key[16];
+    uint8_t rtcp_salt[14];
+    uint8_t rtcp_auth[20];
+    // The EVP_CIPHER_CTX of AES-128-CTR.
+    void* ctx;
+    // The index of the next SRTCP packet to protect.
+    uint32_t srtcp_index;
+public:
+    SrsSrtp();
+    virtual ~SrsSrtp();
+public:
+    // Initialize by the master key and salt of the sender.
+    virtual srs_error_t initialize(const char* key, const char* salt);
+    // Encrypt the RTP packet in place, and append the auth tag.
+    // @param roc The rollover counter, the high 32 bits of the 48 bits index of packet.
+    // @remark The buf must have SRS_SRTP_AUTH_TAG bytes more space.
+    virtual srs_error_t protect_rtp(char* buf, int* pnb_buf, uint32_t roc);
+    // Authenticate then decrypt the SRTP packet in place, and remove the auth tag.
+    virtual srs_error_t unprotect_rtp(char* buf, int* pnb_buf, uint32_t roc);
+    // Encrypt the compound RTCP packet in place, and append the SRTCP index and auth tag.
+    // @remark The buf must have SRS_SRTCP_INDEX + SRS_SRTP_AUTH_TAG bytes more space.
+    virtual srs_error_t protect_rtcp(char* buf, int* pnb_buf);
+    // Authenticate then decrypt the SRTCP packet in place, and remove the SRTCP index and auth tag.
+    virtual srs_error_t unprotect_rtcp(char* buf, int* pnb_buf);
+private:
+    // Derive the session key by label, @see https://tools.ietf.org/html/rfc3711#section-4.3
+    virtual srs_error_t derive(const uint8_t* key, const uint8_t* salt, uint8_t label, uint8_t* out, int size);
+    // Encrypt or decrypt by AES-CM, @see https://tools.ietf.org/html/rfc3711#section-4.1.1
+    virtual srs_error_t cipher(const uint8_t* key, const uint8_t* salt, uint32_t ssrc, uint64_t index, char* buf, int size);
+};
+
+// The media description of SDP, @see https://tools.ietf.org/html/rfc4566#section-5.14
+class SrsRtcSdpMedia
+{
+public:
+    // The media type, audio or video.
+    std::string type;
+    // The port, 0 for rejected media.
+    int port;
+    std::string protocol;
+    std::vector<int> payload_types;
+    std::string mid;
+    // The direction, for example, sendonly or recvonly.
+    std::string direction;
+    bool rtcp_mux;
+    // The rtpmap, fmtp and rtcp-fb of payload types, for example, H264/90000.
+    std::map<int, std::string> rtpmaps;
+    std::map<int, std::string> fmtps;
+    std::map<int, std::vector<std::string> > rtcp_fbs;
+    // The SSRC of sender, 0 if no.
+    uint32_t ssrc;
+    std::string cname;
+    std::string msid;
+public:
+    SrsRtcSdpMedia();
+    virtual ~SrsRtcSdpMedia();
+public:
+    // Find the payload type of H.264 with packetization-mode=1, prefer the constrained baseline profile.
+    // @return The payload type, -1 if not found.
+    virtual int find_h264();
+};
+
+// The SDP of WebRTC, to parse the offer of player and encode the answer of server.
+// @see https://tools.ietf.org/html/rfc8829
+class SrsRtcSdp
+{
+public:
+    std::string session_id;
+    // Whether the server is ICE-lite, which only responds to the binding requests.
+    bool ice_lite;
+    std::string ice_ufrag;
+    std::string ice_pwd;
+    // The hash and fingerprint of DTLS certificate, for example, sha-256 and AB:CD:...:EF
+    std::string fingerprint_algo;
+    std::string fingerprint;
+    // The DTLS role, active, passive or actpass.
+    std::string setup;
+    std::string msid_semantic;
+    // The candidates of server, for example, "1 udp 2130706431 192.168.1.10 8000 typ host".
+    std::vector<std::string> candidates;
+    std::vector<SrsRtcSdpMedia> medias;
+public:
+    SrsRtcSdp();
+    virtual ~SrsRtcSdp();
+public:
+    // Parse the SDP, the ICE and DTLS of media are parsed to session, which are the same for BUNDLE.
+    virtual srs_error_t parse(std::string sdp);
+    // Encode the SDP, the ICE, DTLS and candidates are in each media, the medias of port are bundled.
+    virtual std::string encode();
+};
+
+// The packetizer of H.264 to RTP, by single NAL unit, STAP-A and FU-A,
+// @see https://tools.ietf.org/html/rfc6184
+class SrsRtpH264Packetizer
+{
+private:
+    uint8_t payload_type;
+    uint32_t ssrc;
+    // The sequence of the next packet.
+    uint16_t sequence;
+public:
+    SrsRtpH264Packetizer(uint8_t pt, uint32_t s);
+    virtual ~SrsRtpH264Packetizer();
+public:
+    // Packetize the SPS and PPS in a STAP-A, which is sent before the IDR.
+    // @param timestamp The RTP timestamp in 90kHz.
+    virtual void packetize_sps_pps(uint32_t timestamp, const std::vector<char>& sps, const std::vector<char>& pps,
+        std::vector<std::string>& packets);
+    // Packetize the NALUs of a frame, and mark the last packet.
+    // @param samples The NALUs, without the start code or size.
+    virtual void packetize(uint32_t timestamp, SrsSample* samples, int nb_samples, std::vector<std::string>& packets);
+private:
+    virtual std::string header(uint32_t timestamp, bool marker);
+};
+
+// The feedback of player in the compound RTCP, @see https://tools.ietf.org/html/rfc4585#section-6
+class SrsRtcpFeedback
+{
+public:
+    // The sequences of lost packets, by the generic NACK.
+    std::vector<uint16_t> nacks;
+    // Whether request the keyframe by PLI or FIR.
+    bool keyframe;
+public:
+    SrsRtcpFeedback();
+    virtual ~SrsRtcpFeedback();
+public:
+    // Decode the unprotected compound RTCP packet, ignore the others such as RR.
+    virtual srs_error_t decode(const char* buf, int nb_buf);
+};
+
+#endif
+
+#endif
+
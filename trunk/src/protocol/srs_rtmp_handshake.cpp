@@ -153,6 +153,86 @@ namespace srs_internal
         return err;
     }
 
+    // The HMAC contexts of current thread, which are reused for each digest,
+    // to avoid creating the context and hashing the fixed genuine keys for each handshake.
+    // @remark The context of genuine key is initialized once, then reset by init without key.
+    #define SRS_HMAC_CACHED_KEYS 4
+    static __thread HMAC_CTX* _srs_hmac_ctx = NULL;
+    static __thread HMAC_CTX* _srs_hmac_cached_ctxs[SRS_HMAC_CACHED_KEYS];
+    static __thread const void* _srs_hmac_cached_keys[SRS_HMAC_CACHED_KEYS];
+    static __thread int _srs_hmac_cached_key_sizes[SRS_HMAC_CACHED_KEYS];
+    
+    // Init the HMAC context with key, NULL key to reset it by the previous key.
+    srs_error_t openssl_HMAC_init(HMAC_CTX* ctx, const void* key, int key_size)
+    {
+        if (!HMAC_Init_ex(ctx, key, key_size, EVP_sha256(), NULL)) {
+            return srs_error_new(ERROR_OpenSslSha256Init, "hmac init");
+        }
+        return srs_success;
+    }
+    
+    // Create a HMAC context which is initialized with key.
+    srs_error_t openssl_HMAC_new(const void* key, int key_size, HMAC_CTX** pctx)
+    {
+        srs_error_t err = srs_success;
+        
+        HMAC_CTX* ctx = HMAC_CTX_new();
+        if (ctx == NULL) {
+            return srs_error_new(ERROR_OpenSslCreateHMAC, "hmac new");
+        }
+        
+        if ((err = openssl_HMAC_init(ctx, key, key_size)) != srs_success) {
+            HMAC_CTX_free(ctx);
+            return srs_error_wrap(err, "hmac new");
+        }
+        
+        *pctx = ctx;
+        return err;
+    }
+    
+    // Get the HMAC context which is initialized with key.
+    srs_error_t openssl_HMAC_ctx(const void* key, int key_size, HMAC_CTX** pctx)
+    {
+        srs_error_t err = srs_success;
+        
+        // Only cache the genuine keys, because the address of temporary key maybe reused.
+        bool genuine = (key == SrsGenuineFMSKey || key == SrsGenuineFPKey);
+        
+        for (int i = 0; genuine && i < SRS_HMAC_CACHED_KEYS; i++) {
+            HMAC_CTX* ctx = _srs_hmac_cached_ctxs[i];
+            
+            if (ctx && _srs_hmac_cached_keys[i] == key && _srs_hmac_cached_key_sizes[i] == key_size) {
+                if ((err = openssl_HMAC_init(ctx, NULL, 0)) != srs_success) {
+                    return srs_error_wrap(err, "hmac reset");
+                }
+                *pctx = ctx;
+                return err;
+            }
+            
+            if (!ctx) {
+                if ((err = openssl_HMAC_new(key, key_size, &ctx)) != srs_success) {
+                    return srs_error_wrap(err, "hmac cache");
+                }
+                _srs_hmac_cached_ctxs[i] = ctx;
+                _srs_hmac_cached_keys[i] = key;
+                _srs_hmac_cached_key_sizes[i] = key_size;
+                *pctx = ctx;
+                return err;
+            }
+        }
+        
+        if (!_srs_hmac_ctx) {
+            if ((err = openssl_HMAC_new(key, key_size, &_srs_hmac_ctx)) != srs_success) {
+                return srs_error_wrap(err, "hmac ctx");
+            }
+        } else if ((err = openssl_HMAC_init(_srs_hmac_ctx, key, key_size)) != srs_success) {
+            return srs_error_wrap(err, "hmac ctx");
+        }
+        *pctx = _srs_hmac_ctx;
+        
+        return err;
+    }
+    
     /**
      * sha256 digest algorithm.
      * @param key the sha256 key, NULL to use EVP_Digest, for instance,
@@ -164,7 +244,6 @@ namespace srs_internal
         
         unsigned int digest_size = 0;
         
-        unsigned char* temp_key = (unsigned char*)key;
         unsigned char* temp_digest = (unsigned char*)digest;
         
         if (key == NULL) {
@@ -175,22 +254,15 @@ namespace srs_internal
                 return srs_error_new(ERROR_OpenSslSha256EvpDigest, "evp digest");
             }
         } else {
-            // use key-data to digest.
-            HMAC_CTX *ctx = HMAC_CTX_new();
-            if (ctx == NULL) {
-                return srs_error_new(ERROR_OpenSslCreateHMAC, "hmac new");
-            }
+            // use key-data to digest, by the reused context.
             // @remark, if no key, use EVP_Digest to digest,
             // for instance, in python, hashlib.sha256(data).digest().
-            if (HMAC_Init_ex(ctx, temp_key, key_size, EVP_sha256(), NULL) < 0) {
-                HMAC_CTX_free(ctx);
-                return srs_error_new(ERROR_OpenSslSha256Init, "hmac init");
+            HMAC_CTX *ctx = NULL;
+            if ((err = openssl_HMAC_ctx(key, key_size, &ctx)) != srs_success) {
+                return srs_error_wrap(err, "hmac ctx");
             }
             
-            err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size);
-            HMAC_CTX_free(ctx);
-            
-            if (err != srs_success) {
+            if ((err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size)) != srs_success) {
                 return srs_error_wrap(err, "hmac sha256");
             }
         }
@@ -253,6 +325,11 @@ namespace srs_internal
         return err;
     }
     
+    bool SrsDH::ready()
+    {
+        return pdh != NULL;
+    }
+    
     srs_error_t SrsDH::copy_public_key(char* pkey, int32_t& pkey_size)
     {
         srs_error_t err = srs_success;
@@ -343,8 +420,9 @@ namespace srs_internal
             return srs_error_new(ERROR_OpenSslSetG, "set word");
         }
         
-        // 4. Set the key length
-        DH_set_length(pdh, bits_count);
+        // 4. Set the length of private key, which must be less than the bits of p for OpenSSL 3.0+,
+        // or generate key failed.
+        DH_set_length(pdh, bits_count - 1);
         
         // 5. Generate private and public key
         // @see ./test/dhtest.c:152
@@ -579,17 +657,22 @@ namespace srs_internal
     {
         srs_error_t err = srs_success;
         
-        SrsDH dh;
+        // Use the pre-generated key pair, or generate it when pool is empty.
+        SrsDH* dh = _srs_dh_pool->fetch();
+        if (!dh) {
+            dh = new SrsDH();
+        }
+        SrsAutoFree(SrsDH, dh);
         
         // ensure generate 128bytes public key.
-        if ((err = dh.initialize(true)) != srs_success) {
+        if (!dh->ready() && (err = dh->initialize(true)) != srs_success) {
             return srs_error_wrap(err, "dh init");
         }
         
         // directly generate the public key.
         // @see: https://github.com/ossrs/srs/issues/148
         int pkey_size = 128;
-        if ((err = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
+        if ((err = dh->copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
             return srs_error_wrap(err, "copy shared key");
         }
         
@@ -1333,3 +1416,60 @@ srs_error_t SrsComplexHandshake::handshake_with_server(SrsHandshakeBytes* hs_byt
     return err;
 }
 
+SrsDHPool* _srs_dh_pool = new SrsDHPool();
+
+SrsDHPool::SrsDHPool()
+{
+    capacity = 0;
+}
+
+SrsDHPool::~SrsDHPool()
+{
+    set_capacity(0);
+}
+
+void SrsDHPool::set_capacity(int v)
+{
+    capacity = srs_max(0, v);
+    
+    while ((int)keys.size() > capacity) {
+        SrsDH* dh = keys.back();
+        keys.pop_back();
+        srs_freep(dh);
+    }
+}
+
+SrsDH* SrsDHPool::fetch()
+{
+    if (keys.empty()) {
+        return NULL;
+    }
+    
+    SrsDH* dh = keys.back();
+    keys.pop_back();
+    return dh;
+}
+
+srs_error_t SrsDHPool::refill(int max)
+{
+    srs_error_t err = srs_success;
+    
+    for (int i = 0; i < max && (int)keys.size() < capacity; i++) {
+        SrsDH* dh = new SrsDH();
+        
+        // ensure generate 128bytes public key.
+        if ((err = dh->initialize(true)) != srs_success) {
+            srs_freep(dh);
+            return srs_error_wrap(err, "dh init");
+        }
+        
+        keys.push_back(dh);
+    }
+    
+    return err;
+}
+
+int SrsDHPool::size()
+{
+    return (int)keys.size();
+}
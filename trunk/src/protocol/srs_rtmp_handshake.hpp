@@ -26,6 +26,8 @@
 
 #include <srs_core.hpp>
 
+#include <vector>
+
 class ISrsProtocolReadWriter;
 class SrsComplexHandshake;
 class SrsHandshakeBytes;
@@ -59,6 +61,8 @@ namespace srs_internal
         //       sometimes openssl generate 127bytes public key.
         //       default to false to donot ensure.
         virtual srs_error_t initialize(bool ensure_128bytes_public_key = false);
+        // Whether the key pair is generated.
+        virtual bool ready();
         // Copy the public key.
         // @param pkey the bytes to copy the public key.
         // @param pkey_size the max public key size, output the actual public key size.
@@ -441,4 +445,30 @@ public:
     virtual srs_error_t handshake_with_server(SrsHandshakeBytes* hs_bytes, ISrsProtocolReadWriter* io);
 };
 
+// The pool of pre-generated DH key pairs for complex handshake, because it's expensive to generate
+// the key pair, about 0.6ms for each connection, so we generate them in idle time for connection storm.
+// @remark Each key pair is used only once, the handshake generates the key itself when pool is empty.
+// @remark Disabled when capacity is 0, for example, the srs-librtmp.
+class SrsDHPool
+{
+private:
+    std::vector<srs_internal::SrsDH*> keys;
+    int capacity;
+public:
+    SrsDHPool();
+    virtual ~SrsDHPool();
+public:
+    // Set the max number of keys in pool, the keys exceed it are freed.
+    virtual void set_capacity(int v);
+    // Fetch a key pair from pool, user must free it.
+    // @return NULL if pool is empty, user should generate it.
+    virtual srs_internal::SrsDH* fetch();
+    // Generate at most max keys, util the pool is full.
+    virtual srs_error_t refill(int max);
+    virtual int size();
+};
+
+// The global DH key pool.
+extern SrsDHPool* _srs_dh_pool;
+
 #endif
@@ -224,9 +224,27 @@ SrsProtocol::AckWindowSize::AckWindowSize()
     nb_recv_bytes = 0;
 }
 
+SrsZeroCopySend::SrsZeroCopySend()
+{
+    id = 0;
+    headers = NULL;
+}
+
+SrsZeroCopySend::~SrsZeroCopySend()
+{
+    std::vector<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+    msgs.clear();
+    
+    srs_freepa(headers);
+}
+
 SrsProtocol::SrsProtocol(ISrsProtocolReadWriter* io)
 {
-    in_buffer = new SrsFastStream();
+    in_buffer = new SrsFastStream(SRS_PERF_RECV_BUFFER_MIN, SRS_PERF_RECV_BUFFER_MAX);
     skt = io;
     
     in_chunk_size = SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE;
@@ -242,6 +260,10 @@ SrsProtocol::SrsProtocol(ISrsProtocolReadWriter* io)
     show_debug_info = true;
     in_buffer_length = 0;
     
+    chunk_streams = NULL;
+    nb_chunk_streams = 0;
+    nb_cs_misses = 0;
+    
     cs_cache = NULL;
     if (SRS_PERF_CHUNK_STREAM_CACHE > 0) {
         cs_cache = new SrsChunkStream*[SRS_PERF_CHUNK_STREAM_CACHE];
@@ -256,20 +278,29 @@ SrsProtocol::SrsProtocol(ISrsProtocolReadWriter* io)
     }
 
     out_c0c3_caches = new char[SRS_CONSTS_C0C3_HEADERS_MAX];
+    
+    memory = new SrsMemoryUsage(SrsMemoryProtocolCache);
+    memory->add(sizeof(iovec) * nb_out_iovs + SRS_CONSTS_C0C3_HEADERS_MAX);
+    memory->add((sizeof(SrsChunkStream*) + sizeof(SrsChunkStream)) * SRS_PERF_CHUNK_STREAM_CACHE);
+    
+    zc = NULL;
+    zc_threshold = 0;
+    corked = false;
 }
 
 SrsProtocol::~SrsProtocol()
 {
-    if (true) {
-        std::map<int, SrsChunkStream*>::iterator it;
-        
-        for (it = chunk_streams.begin(); it != chunk_streams.end(); ++it) {
-            SrsChunkStream* stream = it->second;
-            srs_freep(stream);
-        }
-        
-        chunk_streams.clear();
+    for (int i = 0; i < (int)corked_msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = corked_msgs.at(i);
+        srs_freep(msg);
+    }
+    corked_msgs.clear();
+    
+    for (int i = 0; i < nb_chunk_streams; i++) {
+        SrsChunkStream* cs = chunk_streams[i];
+        srs_freep(cs);
     }
+    srs_freepa(chunk_streams);
     
     if (true) {
         std::vector<SrsPacket*>::iterator it;
@@ -296,6 +327,15 @@ SrsProtocol::~SrsProtocol()
     srs_freepa(cs_cache);
 
     srs_freepa(out_c0c3_caches);
+    srs_freep(memory);
+    
+    // The pages are pinned by kernel, it's safe to free them, and the socket is closing.
+    std::deque<SrsZeroCopySend*>::iterator it;
+    for (it = zc_sends.begin(); it != zc_sends.end(); ++it) {
+        SrsZeroCopySend* send = *it;
+        srs_freep(send);
+    }
+    zc_sends.clear();
 }
 
 void SrsProtocol::set_auto_response(bool v)
@@ -339,6 +379,62 @@ void SrsProtocol::set_recv_buffer(int buffer_size)
 }
 #endif
 
+void SrsProtocol::set_memory(SrsMemoryStat* v, SrsMemoryType type)
+{
+    in_buffer->set_memory(v, type);
+    memory->set_stat(v);
+}
+
+void SrsProtocol::shrink_recv_buffer()
+{
+    in_buffer->shrink();
+}
+
+srs_error_t SrsProtocol::set_zerocopy(int threshold)
+{
+    srs_error_t err = srs_success;
+    
+    ISrsZeroCopyWriter* writer = dynamic_cast<ISrsZeroCopyWriter*>(skt);
+    if (!writer) {
+        return srs_error_new(ERROR_SOCKET_ZEROCOPY, "zerocopy not supported");
+    }
+    
+    if ((err = writer->enable_zerocopy()) != srs_success) {
+        return srs_error_wrap(err, "enable zerocopy");
+    }
+    
+    zc = writer;
+    zc_threshold = threshold;
+    
+    return err;
+}
+
+void SrsProtocol::cork()
+{
+    corked = true;
+}
+
+srs_error_t SrsProtocol::uncork()
+{
+    srs_error_t err = srs_success;
+    
+    if (!corked) {
+        return err;
+    }
+    corked = false;
+    
+    if ((err = flush_corked()) != srs_success) {
+        return srs_error_wrap(err, "flush corked");
+    }
+    
+    // The responses queued when corked.
+    if ((err = manual_response_flush()) != srs_success) {
+        return srs_error_wrap(err, "manual flush response");
+    }
+    
+    return err;
+}
+
 void SrsProtocol::set_recv_timeout(srs_utime_t tm)
 {
     return skt->set_recv_timeout(tm);
@@ -369,6 +465,11 @@ int64_t SrsProtocol::get_send_bytes()
     return skt->get_send_bytes();
 }
 
+int64_t SrsProtocol::get_chunk_stream_misses()
+{
+    return nb_cs_misses;
+}
+
 srs_error_t SrsProtocol::set_in_window_ack_size(int ack_size)
 {
     in_ack_size.window = ack_size;
@@ -376,14 +477,79 @@ srs_error_t SrsProtocol::set_in_window_ack_size(int ack_size)
 }
 
 srs_error_t SrsProtocol::recv_message(SrsCommonMessage** pmsg)
+{
+    return do_recv_message(pmsg, false);
+}
+
+srs_error_t SrsProtocol::recv_messages(SrsCommonMessage** pmsgs, int max, int& count)
+{
+    srs_error_t err = srs_success;
+    
+    count = 0;
+    srs_assert(max > 0);
+    
+    // Block to recv the first message.
+    if ((err = do_recv_message(&pmsgs[0], false)) != srs_success) {
+        return srs_error_wrap(err, "recv message");
+    }
+    count = 1;
+    
+    // Parse the messages in buffer.
+    while (count < max) {
+        SrsCommonMessage* msg = NULL;
+        if ((err = do_recv_message(&msg, true)) != srs_success) {
+            for (int i = 0; i < count; i++) {
+                srs_freep(pmsgs[i]);
+            }
+            count = 0;
+            return srs_error_wrap(err, "recv message in buffer");
+        }
+        
+        if (!msg) {
+            break;
+        }
+        pmsgs[count++] = msg;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsProtocol::read_available()
+{
+    srs_error_t err = srs_success;
+    
+    // Require one more byte, so it reads once for the available bytes.
+    if ((err = in_buffer->grow(skt, in_buffer->size() + 1)) != srs_success) {
+        return srs_error_wrap(err, "read available");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsProtocol::recv_buffered_message(SrsCommonMessage** pmsg)
+{
+    return do_recv_message(pmsg, true);
+}
+
+srs_error_t SrsProtocol::do_recv_message(SrsCommonMessage** pmsg, bool in_buffer_only)
 {
     *pmsg = NULL;
     
     srs_error_t err = srs_success;
     
+    // Never wait for the peer, which may wait for the corked responses.
+    if (!in_buffer_only && (err = uncork()) != srs_success) {
+        return srs_error_wrap(err, "uncork");
+    }
+    
     while (true) {
         SrsCommonMessage* msg = NULL;
         
+        // Stop when not enough bytes for a chunk, the chunk stream keeps the partial message.
+        if (in_buffer_only && !chunk_in_buffer()) {
+            return err;
+        }
+        
         if ((err = recv_interlaced_message(&msg)) != srs_success) {
             srs_freep(msg);
             return srs_error_wrap(err, "recv interlaced message");
@@ -468,15 +634,28 @@ srs_error_t SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msg
         char* p = msg->payload;
         char* pend = msg->payload + msg->size;
         
+        // Use the chunk headers cached in message, which is shared by all consumers.
+        char* c0 = NULL;
+        char* c3 = NULL;
+        int nb_c0 = 0;
+        int nb_c3 = 0;
+        bool cached = msg->cached_chunk_header(&c0, &nb_c0, &c3, &nb_c3);
+        
         // always write the header event payload is empty.
         while (p < pend) {
             // always has header
-            int nb_cache = SRS_CONSTS_C0C3_HEADERS_MAX - c0c3_cache_index;
-            int nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+            int nbh = 0;
+            if (cached) {
+                nbh = (p == msg->payload)? nb_c0 : nb_c3;
+                iovs[0].iov_base = (p == msg->payload)? c0 : c3;
+            } else {
+                int nb_cache = SRS_CONSTS_C0C3_HEADERS_MAX - c0c3_cache_index;
+                nbh = msg->chunk_header(c0c3_cache, nb_cache, p == msg->payload);
+                iovs[0].iov_base = c0c3_cache;
+            }
             srs_assert(nbh > 0);
             
             // header iov
-            iovs[0].iov_base = c0c3_cache;
             iovs[0].iov_len = nbh;
             
             // payload iov
@@ -495,6 +674,7 @@ srs_error_t SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msg
                 nb_out_iovs = 2 * nb_out_iovs;
                 int realloc_size = sizeof(iovec) * nb_out_iovs;
                 out_iovs = (iovec*)realloc(out_iovs, realloc_size);
+                memory->add(sizeof(iovec) * (nb_out_iovs - ov));
                 srs_warn("resize iovs %d => %d, max_msgs=%d", ov, nb_out_iovs, SRS_PERF_MW_MSGS);
             }
             
@@ -502,6 +682,11 @@ srs_error_t SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msg
             iov_index += 2;
             iovs = out_iovs + iov_index;
             
+            // the cached header never consume the c0c3 header cache.
+            if (cached) {
+                continue;
+            }
+            
             // to next c0c3 header cache
             c0c3_cache_index += nbh;
             c0c3_cache = out_c0c3_caches + c0c3_cache_index;
@@ -540,6 +725,10 @@ srs_error_t SrsProtocol::do_send_messages(SrsSharedPtrMessage** msgs, int nb_msg
         return err;
     }
     
+    if (zc) {
+        return do_zerocopy_send(msgs, nb_msgs, out_iovs, iov_index, c0c3_cache_index);
+    }
+    
     return do_iovs_send(out_iovs, iov_index);
 #else
     // try to send use the c0c3 header cache,
@@ -599,6 +788,59 @@ srs_error_t SrsProtocol::do_iovs_send(iovec* iovs, int size)
     return srs_write_large_iovs(skt, iovs, size);
 }
 
+srs_error_t SrsProtocol::do_zerocopy_send(SrsSharedPtrMessage** msgs, int nb_msgs, iovec* iovs, int size, int nb_headers)
+{
+    srs_error_t err = srs_success;
+    
+    // Free the messages of completed sends.
+    if ((err = zc->reap_zerocopy()) != srs_success) {
+        return srs_error_wrap(err, "reap zerocopy");
+    }
+    while (!zc_sends.empty() && zc->zerocopy_completed(zc_sends.front()->id)) {
+        SrsZeroCopySend* send = zc_sends.front();
+        zc_sends.pop_front();
+        srs_freep(send);
+    }
+    
+    // Copy the small send, and when too many sends in flight, for example, the peer is slow.
+    int64_t nn = 0;
+    for (int i = 0; i < size; i++) {
+        nn += iovs[i].iov_len;
+    }
+    if (nn < zc_threshold || zc_sends.size() >= SRS_ZEROCOPY_MAX_SENDS) {
+        return do_iovs_send(iovs, size);
+    }
+    
+    SrsZeroCopySend* send = new SrsZeroCopySend();
+    zc_sends.push_back(send);
+    
+    // The c0c3 cache is overwritten by next send, so we move the headers in it to the send.
+    if (nb_headers > 0) {
+        send->headers = new char[nb_headers];
+        memcpy(send->headers, out_c0c3_caches, nb_headers);
+        
+        for (int i = 0; i < size; i++) {
+            char* p = (char*)iovs[i].iov_base;
+            if (p >= out_c0c3_caches && p < out_c0c3_caches + nb_headers) {
+                iovs[i].iov_base = send->headers + (p - out_c0c3_caches);
+            }
+        }
+    }
+    
+    // The payload and the cached headers are shared by the copies.
+    for (int i = 0; i < nb_msgs; i++) {
+        if (msgs[i]) {
+            send->msgs.push_back(msgs[i]->copy());
+        }
+    }
+    
+    if ((err = zc->writev_zerocopy(iovs, size, &send->id, NULL)) != srs_success) {
+        return srs_error_wrap(err, "writev zerocopy");
+    }
+    
+    return err;
+}
+
 srs_error_t SrsProtocol::do_send_and_free_packet(SrsPacket* packet, int stream_id)
 {
     srs_error_t err = srs_success;
@@ -623,6 +865,21 @@ srs_error_t SrsProtocol::do_send_and_free_packet(SrsPacket* packet, int stream_i
         return srs_error_wrap(err, "send packet");
     }
     
+    // The corked messages are chunked when flushed, so the ones larger than a chunk must be sent by the old size.
+    if (corked && msg->header.is_set_chunk_size()) {
+        SrsSetChunkSizePacket* pkt = dynamic_cast<SrsSetChunkSizePacket*>(packet);
+        int min_chunk_size = srs_min(out_chunk_size, pkt->chunk_size);
+        
+        for (int i = 0; i < (int)corked_msgs.size(); i++) {
+            if (corked_msgs.at(i)->size > min_chunk_size) {
+                if ((err = flush_corked()) != srs_success) {
+                    return srs_error_wrap(err, "flush corked");
+                }
+                break;
+            }
+        }
+    }
+    
     if ((err = on_send_packet(&msg->header, packet)) != srs_success) {
         return srs_error_wrap(err, "on send packet");
     }
@@ -630,6 +887,30 @@ srs_error_t SrsProtocol::do_send_and_free_packet(SrsPacket* packet, int stream_i
     return err;
 }
 
+srs_error_t SrsProtocol::flush_corked()
+{
+    srs_error_t err = srs_success;
+    
+    if (corked_msgs.empty()) {
+        return err;
+    }
+    
+    // The stream id of message is updated when queued.
+    err = do_send_messages(&corked_msgs[0], (int)corked_msgs.size());
+    
+    for (int i = 0; i < (int)corked_msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = corked_msgs.at(i);
+        srs_freep(msg);
+    }
+    corked_msgs.clear();
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "send messages");
+    }
+    
+    return err;
+}
+
 srs_error_t SrsProtocol::do_decode_message(SrsMessageHeader& header, SrsBuffer* stream, SrsPacket** ppacket)
 {
     srs_error_t err = srs_success;
@@ -805,6 +1086,18 @@ srs_error_t SrsProtocol::send_and_free_messages(SrsSharedPtrMessage** msgs, int
     srs_assert(msgs);
     srs_assert(nb_msgs > 0);
     
+    // Queue the messages, which are sent by uncork.
+    if (corked) {
+        for (int i = 0; i < nb_msgs; i++) {
+            SrsSharedPtrMessage* msg = msgs[i];
+            if (msg) {
+                msg->check(stream_id);
+                corked_msgs.push_back(msg);
+            }
+        }
+        return srs_success;
+    }
+    
     // update the stream id in header.
     for (int i = 0; i < nb_msgs; i++) {
         SrsSharedPtrMessage* msg = msgs[i];
@@ -883,14 +1176,19 @@ srs_error_t SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
         // already init, use it direclty
         chunk = cs_cache[cid];
     } else {
-        // chunk stream cache miss, use map.
-        if (chunk_streams.find(cid) == chunk_streams.end()) {
+        // chunk stream cache miss, use the flat table.
+        nb_cs_misses++;
+        
+        if (cid >= nb_chunk_streams) {
+            grow_chunk_streams(cid);
+        }
+        
+        if ((chunk = chunk_streams[cid]) == NULL) {
             chunk = chunk_streams[cid] = new SrsChunkStream(cid);
+            memory->add(sizeof(SrsChunkStream));
             // set the perfer cid of chunk,
             // which will copy to the message received.
             chunk->header.perfer_cid = cid;
-        } else {
-            chunk = chunk_streams[cid];
         }
     }
     
@@ -914,6 +1212,95 @@ srs_error_t SrsProtocol::recv_interlaced_message(SrsCommonMessage** pmsg)
     return err;
 }
 
+bool SrsProtocol::chunk_in_buffer()
+{
+    int size = in_buffer->size();
+    uint8_t* p = (uint8_t*)in_buffer->bytes();
+    
+    // The basic header, @see read_basic_header.
+    if (size < 1) {
+        return false;
+    }
+    
+    char fmt = (p[0] >> 6) & 0x03;
+    int cid = p[0] & 0x3f;
+    int bh_size = 1;
+    if (cid == 0) {
+        if (size < 2) {
+            return false;
+        }
+        cid = 64 + p[1];
+        bh_size = 2;
+    } else if (cid == 1) {
+        if (size < 3) {
+            return false;
+        }
+        cid = 64 + p[1] + p[2] * 256;
+        bh_size = 3;
+    }
+    
+    SrsChunkStream* chunk = NULL;
+    if (cid < SRS_PERF_CHUNK_STREAM_CACHE) {
+        chunk = cs_cache[cid];
+    } else if (cid < nb_chunk_streams) {
+        chunk = chunk_streams[cid];
+    }
+    
+    // For fresh chunk, the fmt2 and fmt3 fail without reading, see read_message_header.
+    bool fresh = (!chunk || chunk->msg_count == 0);
+    if (fresh && fmt > RTMP_FMT_TYPE1) {
+        return true;
+    }
+    
+    // The message header, @see read_message_header.
+    static int mh_sizes[] = {11, 7, 3, 0};
+    int mh_size = mh_sizes[(int)fmt];
+    if (size < bh_size + mh_size) {
+        return false;
+    }
+    
+    uint8_t* mh = p + bh_size;
+    bool extended_timestamp = false;
+    if (fmt <= RTMP_FMT_TYPE2) {
+        int32_t timestamp_delta = (mh[0] << 16) | (mh[1] << 8) | mh[2];
+        extended_timestamp = (timestamp_delta >= RTMP_EXTENDED_TIMESTAMP);
+    } else {
+        extended_timestamp = chunk->extended_timestamp;
+    }
+    
+    int32_t payload_length = 0;
+    if (fmt <= RTMP_FMT_TYPE1) {
+        payload_length = (mh[3] << 16) | (mh[4] << 8) | mh[5];
+    } else {
+        payload_length = chunk->header.payload_length;
+    }
+    
+    // The chunk payload, @see read_message_payload.
+    int nb_read = (!fresh && chunk->msg)? chunk->msg->size : 0;
+    int payload_size = srs_max(0, srs_min(payload_length - nb_read, in_chunk_size));
+    
+    return size >= bh_size + mh_size + (extended_timestamp? 4 : 0) + payload_size;
+}
+
+void SrsProtocol::grow_chunk_streams(int cid)
+{
+    srs_assert(cid <= SRS_CONSTS_RTMP_MAX_CID);
+    
+    // Double the table to avoid growing for each new cid.
+    int size = srs_min(SRS_CONSTS_RTMP_MAX_CID + 1, srs_max(cid + 1, 2 * nb_chunk_streams));
+    
+    SrsChunkStream** table = new SrsChunkStream*[size];
+    memset(table, 0, sizeof(SrsChunkStream*) * size);
+    if (nb_chunk_streams > 0) {
+        memcpy(table, chunk_streams, sizeof(SrsChunkStream*) * nb_chunk_streams);
+    }
+    
+    srs_freepa(chunk_streams);
+    memory->add(sizeof(SrsChunkStream*) * (size - nb_chunk_streams));
+    chunk_streams = table;
+    nb_chunk_streams = size;
+}
+
 /**
  * 6.1.1. Chunk Basic Header
  * The Chunk Basic Header encodes the chunk stream ID and the chunk
@@ -1285,11 +1672,19 @@ srs_error_t SrsProtocol::read_message_payload(SrsChunkStream* chunk, SrsCommonMe
         chunk->msg->create_payload(chunk->header.payload_length);
     }
     
-    // read payload to buffer
-    if ((err = in_buffer->grow(skt, payload_size)) != srs_success) {
-        return srs_error_wrap(err, "read %d bytes payload", payload_size);
+    // read large chunk body directly to payload, to avoid the copy of buffer.
+    char* dst = chunk->msg->payload + chunk->msg->size;
+    if (SRS_PERF_CHUNK_DIRECT_READ > 0 && payload_size - in_buffer->size() >= SRS_PERF_CHUNK_DIRECT_READ) {
+        if ((err = in_buffer->read_to(skt, dst, payload_size)) != srs_success) {
+            return srs_error_wrap(err, "read %d bytes payload", payload_size);
+        }
+    } else {
+        // read payload to buffer
+        if ((err = in_buffer->grow(skt, payload_size)) != srs_success) {
+            return srs_error_wrap(err, "read %d bytes payload", payload_size);
+        }
+        memcpy(dst, in_buffer->read_slice(payload_size), payload_size);
     }
-    memcpy(chunk->msg->payload + chunk->msg->size, in_buffer->read_slice(payload_size), payload_size);
     chunk->msg->size += payload_size;
     
     // got entire RTMP message?
@@ -1530,6 +1925,70 @@ SrsChunkStream::~SrsChunkStream()
     srs_freep(msg);
 }
 
+std::multimap<uint64_t, SrsStreamKey*> SrsStreamKey::keys;
+
+SrsStreamKey::SrsStreamKey(uint64_t h, string u)
+{
+    hash = h;
+    url = u;
+}
+
+SrsStreamKey::~SrsStreamKey()
+{
+}
+
+SrsStreamKey* SrsStreamKey::intern(const string& vhost, const string& app, const string& stream)
+{
+    SrsStreamKey* key = find(vhost, app, stream);
+    if (key) {
+        return key;
+    }
+    
+    uint64_t hash = srs_generate_stream_hash(vhost, app, stream);
+    key = new SrsStreamKey(hash, srs_generate_stream_url(vhost, app, stream));
+    keys.insert(std::make_pair(hash, key));
+    
+    return key;
+}
+
+SrsStreamKey* SrsStreamKey::find(const string& vhost, const string& app, const string& stream)
+{
+    uint64_t hash = srs_generate_stream_hash(vhost, app, stream);
+    
+    // Resolve the collision of hash by url.
+    std::pair<std::multimap<uint64_t, SrsStreamKey*>::iterator, std::multimap<uint64_t, SrsStreamKey*>::iterator> range;
+    range = keys.equal_range(hash);
+    for (std::multimap<uint64_t, SrsStreamKey*>::iterator it = range.first; it != range.second; ++it) {
+        SrsStreamKey* key = it->second;
+        if (srs_stream_url_equals(key->url, vhost, app, stream)) {
+            return key;
+        }
+    }
+    
+    return NULL;
+}
+
+SrsStreamKey* SrsStreamKey::find(const string& url)
+{
+    uint64_t hash = srs_hash_stream_url(url);
+    
+    std::pair<std::multimap<uint64_t, SrsStreamKey*>::iterator, std::multimap<uint64_t, SrsStreamKey*>::iterator> range;
+    range = keys.equal_range(hash);
+    for (std::multimap<uint64_t, SrsStreamKey*>::iterator it = range.first; it != range.second; ++it) {
+        SrsStreamKey* key = it->second;
+        if (key->url == url) {
+            return key;
+        }
+    }
+    
+    return NULL;
+}
+
+int SrsStreamKey::size()
+{
+    return (int)keys.size();
+}
+
 SrsRequest::SrsRequest()
 {
     objectEncoding = RTMP_SIG_AMF0_VER;
@@ -1599,6 +2058,14 @@ string SrsRequest::get_stream_url()
     return srs_generate_stream_url(vhost, app, stream);
 }
 
+SrsStreamKey* SrsRequest::get_stream_key(bool create)
+{
+    if (create) {
+        return SrsStreamKey::intern(vhost, app, stream);
+    }
+    return SrsStreamKey::find(vhost, app, stream);
+}
+
 void SrsRequest::strip()
 {
     // remove the unsupported chars in names.
@@ -1857,6 +2324,16 @@ srs_error_t SrsRtmpClient::recv_message(SrsCommonMessage** pmsg)
     return protocol->recv_message(pmsg);
 }
 
+srs_error_t SrsRtmpClient::read_available()
+{
+    return protocol->read_available();
+}
+
+srs_error_t SrsRtmpClient::recv_buffered_message(SrsCommonMessage** pmsg)
+{
+    return protocol->recv_buffered_message(pmsg);
+}
+
 srs_error_t SrsRtmpClient::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
 {
     return protocol->decode_message(msg, ppacket);
@@ -2221,6 +2698,21 @@ void SrsRtmpServer::set_recv_buffer(int buffer_size)
 }
 #endif
 
+void SrsRtmpServer::set_memory(SrsMemoryStat* v, SrsMemoryType type)
+{
+    protocol->set_memory(v, type);
+}
+
+void SrsRtmpServer::shrink_recv_buffer()
+{
+    protocol->shrink_recv_buffer();
+}
+
+srs_error_t SrsRtmpServer::set_zerocopy(int threshold)
+{
+    return protocol->set_zerocopy(threshold);
+}
+
 void SrsRtmpServer::set_recv_timeout(srs_utime_t tm)
 {
     protocol->set_recv_timeout(tm);
@@ -2251,11 +2743,31 @@ int64_t SrsRtmpServer::get_send_bytes()
     return protocol->get_send_bytes();
 }
 
+int64_t SrsRtmpServer::get_chunk_stream_misses()
+{
+    return protocol->get_chunk_stream_misses();
+}
+
 srs_error_t SrsRtmpServer::recv_message(SrsCommonMessage** pmsg)
 {
     return protocol->recv_message(pmsg);
 }
 
+srs_error_t SrsRtmpServer::recv_messages(SrsCommonMessage** pmsgs, int max, int& count)
+{
+    return protocol->recv_messages(pmsgs, max, count);
+}
+
+srs_error_t SrsRtmpServer::read_available()
+{
+    return protocol->read_available();
+}
+
+srs_error_t SrsRtmpServer::recv_buffered_message(SrsCommonMessage** pmsg)
+{
+    return protocol->recv_buffered_message(pmsg);
+}
+
 srs_error_t SrsRtmpServer::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
 {
     return protocol->decode_message(msg, ppacket);
@@ -2276,6 +2788,16 @@ srs_error_t SrsRtmpServer::send_and_free_packet(SrsPacket* packet, int stream_id
     return protocol->send_and_free_packet(packet, stream_id);
 }
 
+void SrsRtmpServer::cork()
+{
+    protocol->cork();
+}
+
+srs_error_t SrsRtmpServer::uncork()
+{
+    return protocol->uncork();
+}
+
 srs_error_t SrsRtmpServer::handshake()
 {
     srs_error_t err = srs_success;
@@ -2305,40 +2827,103 @@ srs_error_t SrsRtmpServer::connect_app(SrsRequest* req)
 {
     srs_error_t err = srs_success;
     
+    // Parse the connect app by the view of command object, which never decodes the properties to heap,
+    // because we only use some of them.
     SrsCommonMessage* msg = NULL;
-    SrsConnectAppPacket* pkt = NULL;
-    if ((err = expect_message<SrsConnectAppPacket>(&msg, &pkt)) != srs_success) {
-        return srs_error_wrap(err, "expect connect app response");
-    }
     SrsAutoFree(SrsCommonMessage, msg);
-    SrsAutoFree(SrsConnectAppPacket, pkt);
     
-    SrsAmf0Any* prop = NULL;
+    SrsAmf0ObjectView command_object;
+    if ((err = expect_connect_app(req, &msg, &command_object)) != srs_success) {
+        return srs_error_wrap(err, "expect connect app");
+    }
     
-    if ((prop = pkt->command_object->ensure_property_string("tcUrl")) == NULL) {
+    if (!command_object.get_string("tcUrl", req->tcUrl)) {
         return srs_error_new(ERROR_RTMP_REQ_CONNECT, "invalid request without tcUrl");
     }
-    req->tcUrl = prop->to_str();
     
-    if ((prop = pkt->command_object->ensure_property_string("pageUrl")) != NULL) {
-        req->pageUrl = prop->to_str();
+    command_object.get_string("pageUrl", req->pageUrl);
+    command_object.get_string("swfUrl", req->swfUrl);
+    command_object.get_number("objectEncoding", req->objectEncoding);
+    
+    srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
+    req->strip();
+    
+    return err;
+}
+
+srs_error_t SrsRtmpServer::expect_connect_app(SrsRequest* req, SrsCommonMessage** pmsg, SrsAmf0ObjectView* command_object)
+{
+    srs_error_t err = srs_success;
+    
+    SrsCommonMessage* msg = NULL;
+    SrsBuffer* stream = NULL;
+    
+    // Drop all messages util the connect app, like expect_message.
+    while (true) {
+        if ((err = protocol->recv_message(&msg)) != srs_success) {
+            return srs_error_wrap(err, "recv message");
+        }
+        
+        SrsMessageHeader& h = msg->header;
+        if (h.is_amf0_command() || h.is_amf3_command()) {
+            srs_freep(stream);
+            stream = new SrsBuffer(msg->payload, msg->size);
+            
+            // skip 1bytes to decode the amf3 command.
+            if (h.is_amf3_command() && stream->require(1)) {
+                stream->skip(1);
+            }
+            
+            std::string command_name;
+            if ((err = srs_amf0_read_string(stream, command_name)) != srs_success) {
+                srs_freep(stream);
+                srs_freep(msg);
+                return srs_error_wrap(err, "command_name");
+            }
+            
+            if (command_name == RTMP_AMF0_COMMAND_CONNECT) {
+                break;
+            }
+        }
+        
+        srs_freep(msg);
     }
+    SrsAutoFree(SrsBuffer, stream);
     
-    if ((prop = pkt->command_object->ensure_property_string("swfUrl")) != NULL) {
-        req->swfUrl = prop->to_str();
+    // The msg is returned even error, because the command object refers to its payload.
+    *pmsg = msg;
+    
+    double transaction_id = 0;
+    if ((err = srs_amf0_read_number(stream, transaction_id)) != srs_success) {
+        return srs_error_wrap(err, "transaction_id");
     }
     
-    if ((prop = pkt->command_object->ensure_property_number("objectEncoding")) != NULL) {
-        req->objectEncoding = prop->to_number();
+    // some client donot send id=1.0, so we only warn user if not match.
+    if (transaction_id != 1.0) {
+        srs_warn("invalid transaction_id=%.2f", transaction_id);
     }
     
-    if (pkt->args) {
-        srs_freep(req->args);
-        req->args = pkt->args->copy()->to_object();
+    if ((err = command_object->read(stream)) != srs_success) {
+        return srs_error_wrap(err, "command_object");
     }
     
-    srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
-    req->strip();
+    // The args is optional, and rarely used, so decode it if exists.
+    // see: https://github.com/ossrs/srs/issues/186
+    // the args maybe any amf0, for instance, a string. we should drop if not object.
+    if (!stream->empty()) {
+        SrsAmf0Any* any = NULL;
+        if ((err = srs_amf0_read_any(stream, &any)) != srs_success) {
+            return srs_error_wrap(err, "args");
+        }
+        
+        if (!any->is_object()) {
+            srs_warn("drop the args, see: '4.1.1. connect', marker=%#x", (uint8_t)any->marker);
+            srs_freep(any);
+        } else {
+            srs_freep(req->args);
+            req->args = any->to_object();
+        }
+    }
     
     return err;
 }
@@ -2575,73 +3160,138 @@ srs_error_t SrsRtmpServer::set_chunk_size(int chunk_size)
     return err;
 }
 
-srs_error_t SrsRtmpServer::start_play(int stream_id)
+// Encode the packet to a shared message, which can be copied to send to many peers.
+srs_error_t srs_rtmp_create_shared_message(SrsPacket* packet, int stream_id, SrsSharedPtrMessage** pmsg)
 {
     srs_error_t err = srs_success;
     
-    // StreamBegin
-    if (true) {
-        SrsUserControlPacket* pkt = new SrsUserControlPacket();
-        pkt->event_type = SrcPCUCStreamBegin;
-        pkt->event_data = stream_id;
-        if ((err = protocol->send_and_free_packet(pkt, 0)) != srs_success) {
-            return srs_error_wrap(err, "send StreamBegin");
-        }
+    SrsAutoFree(SrsPacket, packet);
+    
+    SrsCommonMessage* msg = new SrsCommonMessage();
+    SrsAutoFree(SrsCommonMessage, msg);
+    
+    if ((err = packet->to_msg(msg, stream_id)) != srs_success) {
+        return srs_error_wrap(err, "to message");
     }
     
-    // onStatus(NetStream.Play.Reset)
-    if (true) {
-        SrsOnStatusCallPacket* pkt = new SrsOnStatusCallPacket();
-        
-        pkt->data->set(StatusLevel, SrsAmf0Any::str(StatusLevelStatus));
-        pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeStreamReset));
-        pkt->data->set(StatusDescription, SrsAmf0Any::str("Playing and resetting stream."));
-        pkt->data->set(StatusDetails, SrsAmf0Any::str("stream"));
-        pkt->data->set(StatusClientId, SrsAmf0Any::str(RTMP_SIG_CLIENT_ID));
-        
-        if ((err = protocol->send_and_free_packet(pkt, stream_id)) != srs_success) {
-            return srs_error_wrap(err, "send NetStream.Play.Reset");
-        }
+    SrsSharedPtrMessage* shared_msg = new SrsSharedPtrMessage();
+    if ((err = shared_msg->create(msg)) != srs_success) {
+        srs_freep(shared_msg);
+        return srs_error_wrap(err, "create message");
     }
     
-    // onStatus(NetStream.Play.Start)
-    if (true) {
-        SrsOnStatusCallPacket* pkt = new SrsOnStatusCallPacket();
+    *pmsg = shared_msg;
+    
+    return err;
+}
+
+// The responses of play, except the StreamBegin, are the same for all players, so we encode them once.
+std::vector<SrsSharedPtrMessage*> _srs_play_start_msgs;
+
+srs_error_t srs_rtmp_play_start_messages(std::vector<SrsSharedPtrMessage*>& msgs)
+{
+    srs_error_t err = srs_success;
+    
+    if (_srs_play_start_msgs.empty()) {
+        std::vector<SrsPacket*> pkts;
         
-        pkt->data->set(StatusLevel, SrsAmf0Any::str(StatusLevelStatus));
-        pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeStreamStart));
-        pkt->data->set(StatusDescription, SrsAmf0Any::str("Started playing stream."));
-        pkt->data->set(StatusDetails, SrsAmf0Any::str("stream"));
-        pkt->data->set(StatusClientId, SrsAmf0Any::str(RTMP_SIG_CLIENT_ID));
+        // onStatus(NetStream.Play.Reset)
+        if (true) {
+            SrsOnStatusCallPacket* pkt = new SrsOnStatusCallPacket();
+            pkt->data->set(StatusLevel, SrsAmf0Any::str(StatusLevelStatus));
+            pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeStreamReset));
+            pkt->data->set(StatusDescription, SrsAmf0Any::str("Playing and resetting stream."));
+            pkt->data->set(StatusDetails, SrsAmf0Any::str("stream"));
+            pkt->data->set(StatusClientId, SrsAmf0Any::str(RTMP_SIG_CLIENT_ID));
+            pkts.push_back(pkt);
+        }
         
-        if ((err = protocol->send_and_free_packet(pkt, stream_id)) != srs_success) {
-            return srs_error_wrap(err, "send NetStream.Play.Start");
+        // onStatus(NetStream.Play.Start)
+        if (true) {
+            SrsOnStatusCallPacket* pkt = new SrsOnStatusCallPacket();
+            pkt->data->set(StatusLevel, SrsAmf0Any::str(StatusLevelStatus));
+            pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeStreamStart));
+            pkt->data->set(StatusDescription, SrsAmf0Any::str("Started playing stream."));
+            pkt->data->set(StatusDetails, SrsAmf0Any::str("stream"));
+            pkt->data->set(StatusClientId, SrsAmf0Any::str(RTMP_SIG_CLIENT_ID));
+            pkts.push_back(pkt);
         }
-    }
-    
-    // |RtmpSampleAccess(false, false)
-    if (true) {
-        SrsSampleAccessPacket* pkt = new SrsSampleAccessPacket();
         
-        // allow audio/video sample.
-        // @see: https://github.com/ossrs/srs/issues/49
-        pkt->audio_sample_access = true;
-        pkt->video_sample_access = true;
+        // |RtmpSampleAccess(false, false)
+        if (true) {
+            SrsSampleAccessPacket* pkt = new SrsSampleAccessPacket();
+            
+            // allow audio/video sample.
+            // @see: https://github.com/ossrs/srs/issues/49
+            pkt->audio_sample_access = true;
+            pkt->video_sample_access = true;
+            pkts.push_back(pkt);
+        }
         
-        if ((err = protocol->send_and_free_packet(pkt, stream_id)) != srs_success) {
-            return srs_error_wrap(err, "send |RtmpSampleAccess true");
+        // onStatus(NetStream.Data.Start)
+        if (true) {
+            SrsOnStatusDataPacket* pkt = new SrsOnStatusDataPacket();
+            pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeDataStart));
+            pkts.push_back(pkt);
+        }
+        
+        for (int i = 0; i < (int)pkts.size(); i++) {
+            SrsSharedPtrMessage* msg = NULL;
+            if ((err = srs_rtmp_create_shared_message(pkts.at(i), 0, &msg)) != srs_success) {
+                for (int j = i + 1; j < (int)pkts.size(); j++) {
+                    srs_freep(pkts[j]);
+                }
+                for (int j = 0; j < (int)_srs_play_start_msgs.size(); j++) {
+                    srs_freep(_srs_play_start_msgs[j]);
+                }
+                _srs_play_start_msgs.clear();
+                return srs_error_wrap(err, "encode play start");
+            }
+            _srs_play_start_msgs.push_back(msg);
         }
     }
     
-    // onStatus(NetStream.Data.Start)
+    for (int i = 0; i < (int)_srs_play_start_msgs.size(); i++) {
+        msgs.push_back(_srs_play_start_msgs.at(i)->copy());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtmpServer::start_play(int stream_id)
+{
+    srs_error_t err = srs_success;
+    
+    std::vector<SrsSharedPtrMessage*> msgs;
+    if ((err = srs_rtmp_play_start_messages(msgs)) != srs_success) {
+        return srs_error_wrap(err, "play start messages");
+    }
+    
+    // Send all responses by one writev.
+    protocol->cork();
+    
+    // StreamBegin
     if (true) {
-        SrsOnStatusDataPacket* pkt = new SrsOnStatusDataPacket();
-        pkt->data->set(StatusCode, SrsAmf0Any::str(StatusCodeDataStart));
-        if ((err = protocol->send_and_free_packet(pkt, stream_id)) != srs_success) {
-            return srs_error_wrap(err, "send NetStream.Data.Start");
+        SrsUserControlPacket* pkt = new SrsUserControlPacket();
+        pkt->event_type = SrcPCUCStreamBegin;
+        pkt->event_data = stream_id;
+        if ((err = protocol->send_and_free_packet(pkt, 0)) != srs_success) {
+            for (int i = 0; i < (int)msgs.size(); i++) {
+                srs_freep(msgs[i]);
+            }
+            return srs_error_wrap(err, "send StreamBegin");
         }
     }
     
+    // onStatus(NetStream.Play.Reset), onStatus(NetStream.Play.Start), |RtmpSampleAccess, onStatus(NetStream.Data.Start)
+    if ((err = protocol->send_and_free_messages(&msgs[0], (int)msgs.size(), stream_id)) != srs_success) {
+        return srs_error_wrap(err, "send play start");
+    }
+    
+    if ((err = protocol->uncork()) != srs_success) {
+        return srs_error_wrap(err, "uncork");
+    }
+    
     return err;
 }
 
@@ -2761,6 +3411,10 @@ srs_error_t SrsRtmpServer::start_fmle_publish(int stream_id)
         SrsAutoFree(SrsCommonMessage, msg);
         SrsAutoFree(SrsPublishPacket, pkt);
     }
+    
+    // Send the publish responses by one writev.
+    protocol->cork();
+    
     // publish response onFCPublish(NetStream.Publish.Start)
     if (true) {
         SrsOnStatusCallPacket* pkt = new SrsOnStatusCallPacket();
@@ -2787,6 +3441,10 @@ srs_error_t SrsRtmpServer::start_fmle_publish(int stream_id)
         }
     }
     
+    if ((err = protocol->uncork()) != srs_success) {
+        return srs_error_wrap(err, "uncork");
+    }
+    
     return err;
 }
 
@@ -4489,29 +5147,27 @@ srs_error_t SrsOnMetaDataPacket::decode(SrsBuffer* stream)
         }
     }
     
-    // the metadata maybe object or ecma array
-    SrsAmf0Any* any = NULL;
-    if ((err = srs_amf0_read_any(stream, &any)) != srs_success) {
-        return srs_error_wrap(err, "metadata");
-    }
-    
-    srs_assert(any);
-    if (any->is_object()) {
-        srs_freep(metadata);
-        metadata = any->to_object();
+    // the metadata maybe object or ecma array, decode the properties to object directly,
+    // never decode the ecma array then copy it.
+    if (SrsAmf0ObjectView::accept(stream)) {
+        SrsAmf0ObjectView view;
+        if ((err = view.read(stream)) != srs_success) {
+            return srs_error_wrap(err, "metadata");
+        }
+        
+        metadata->clear();
+        if ((err = view.copy_to(metadata)) != srs_success) {
+            return srs_error_wrap(err, "metadata");
+        }
         return err;
     }
     
-    SrsAutoFree(SrsAmf0Any, any);
-    
-    if (any->is_ecma_array()) {
-        SrsAmf0EcmaArray* arr = any->to_ecma_array();
-        
-        // if ecma array, copy to object.
-        for (int i = 0; i < arr->count(); i++) {
-            metadata->set(arr->key_at(i), arr->value_at(i)->copy());
-        }
+    // ignore other types of metadata.
+    SrsAmf0Any* any = NULL;
+    if ((err = srs_amf0_read_any(stream, &any)) != srs_success) {
+        return srs_error_wrap(err, "metadata");
     }
+    srs_freep(any);
     
     return err;
 }
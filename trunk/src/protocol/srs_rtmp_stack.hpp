@@ -28,6 +28,7 @@
 
 #include <map>
 #include <vector>
+#include <deque>
 #include <string>
 
 // For srs-librtmp, @see https://github.com/ossrs/srs/issues/213
@@ -39,9 +40,12 @@
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_consts.hpp>
 #include <srs_core_performance.hpp>
+#include <srs_core_mem_watch.hpp>
 #include <srs_kernel_flv.hpp>
 
 class SrsFastStream;
+class SrsMemoryStat;
+class SrsMemoryUsage;
 class SrsBuffer;
 class SrsAmf0Any;
 class SrsMessageHeader;
@@ -59,8 +63,13 @@ class SrsPlayPacket;
 class SrsCommonMessage;
 class SrsPacket;
 class SrsAmf0Object;
+class SrsAmf0ObjectView;
 class IMergeReadHandler;
 class SrsCallPacket;
+class ISrsZeroCopyWriter;
+
+// The max number of sends by MSG_ZEROCOPY in flight, to limit the messages held by a player.
+#define SRS_ZEROCOPY_MAX_SENDS 64
 
 // The amf0 command message, command name macros
 #define RTMP_AMF0_COMMAND_CONNECT               "connect"
@@ -98,6 +107,7 @@ class SrsCallPacket;
 #define StatusCodeConnectRejected               "NetConnection.Connect.Rejected"
 #define StatusCodeStreamReset                   "NetStream.Play.Reset"
 #define StatusCodeStreamStart                   "NetStream.Play.Start"
+#define StatusCodeStreamFailed                  "NetStream.Play.Failed"
 #define StatusCodeStreamPause                   "NetStream.Pause.Notify"
 #define StatusCodeStreamUnpause                 "NetStream.Unpause.Notify"
 #define StatusCodePublishStart                  "NetStream.Publish.Start"
@@ -147,6 +157,21 @@ protected:
     virtual srs_error_t encode_packet(SrsBuffer* stream);
 };
 
+// The send by MSG_ZEROCOPY, which holds the messages until the kernel completes it.
+class SrsZeroCopySend
+{
+public:
+    // The id to check the completion.
+    uint32_t id;
+    // The copies of messages, which share the payload.
+    std::vector<SrsSharedPtrMessage*> msgs;
+    // The chunk headers not cached in messages.
+    char* headers;
+public:
+    SrsZeroCopySend();
+    virtual ~SrsZeroCopySend();
+};
+
 // The protocol provides the rtmp-message-protocol services,
 // To recv RTMP message from RTMP chunk stream,
 // and to send out RTMP message over RTMP chunk stream.
@@ -174,14 +199,20 @@ private:
     std::map<double, std::string> requests;
 // For peer in
 private:
-    // The chunk stream to decode RTMP messages.
-    std::map<int, SrsChunkStream*> chunk_streams;
+    // The chunk stream to decode RTMP messages, a flat table indexed by cid, for cid not in cs_cache.
+    // @remark Allocated when got the first chunk not in cs_cache, and grows to SRS_CONSTS_RTMP_MAX_CID.
+    SrsChunkStream** chunk_streams;
+    int nb_chunk_streams;
+    // The number of chunks whose cid is not in cs_cache.
+    int64_t nb_cs_misses;
     // Cache some frequently used chunk header.
     // cs_cache, the chunk stream cache.
     // @see https://github.com/ossrs/srs/issues/249
     SrsChunkStream** cs_cache;
     // The bytes buffer cache, recv from skt, provide services for stream.
     SrsFastStream* in_buffer;
+    // Report the iovs, c0c3 headers and chunk streams to the memory stat.
+    SrsMemoryUsage* memory;
     // The input chunk size, default to 128, set by peer packet.
     int32_t in_chunk_size;
     // The input ack window, to response acknowledge to peer,
@@ -219,6 +250,15 @@ private:
     bool warned_c0c3_cache_dry;
     // The output chunk size, default to 128, set by config.
     int32_t out_chunk_size;
+    // The writer of MSG_ZEROCOPY, NULL if disabled.
+    ISrsZeroCopyWriter* zc;
+    // The min bytes of a send to use MSG_ZEROCOPY, for the small send is cheaper to copy.
+    int zc_threshold;
+    // The sends by MSG_ZEROCOPY in flight.
+    std::deque<SrsZeroCopySend*> zc_sends;
+    // Whether corked, the messages are queued and sent by one writev when uncork.
+    bool corked;
+    std::vector<SrsSharedPtrMessage*> corked_msgs;
 public:
     SrsProtocol(ISrsProtocolReadWriter* io);
     virtual ~SrsProtocol();
@@ -248,6 +288,18 @@ public:
     // @see https://github.com/ossrs/srs/issues/241
     virtual void set_recv_buffer(int buffer_size);
 #endif
+    // Report the size of recv buffer to the memory stat of stream, as the type by role.
+    virtual void set_memory(SrsMemoryStat* v, SrsMemoryType type);
+    // Shrink the recv buffer to the min size, for example, the player only reads control messages.
+    virtual void shrink_recv_buffer();
+    // Send the messages by MSG_ZEROCOPY, when the bytes of a send is not less than threshold.
+    // @remark Error when the socket does not support it, and the messages are sent by copy.
+    virtual srs_error_t set_zerocopy(int threshold);
+    // Cork the send, queue the messages and packets, then send them by one writev when uncork,
+    // for example, the responses of login, which are many small messages.
+    // @remark The recv always uncorks, for the peer may wait for the responses.
+    virtual void cork();
+    virtual srs_error_t uncork();
 public:
     // To set/get the recv timeout in srs_utime_t.
     // if timeout, recv/send message return ERROR_SOCKET_TIMEOUT.
@@ -260,6 +312,8 @@ public:
     // Get recv/send bytes.
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+    // Get the number of chunks whose cid is not in the chunk stream cache.
+    virtual int64_t get_chunk_stream_misses();
 public:
     // Set the input default ack size. This is generally set by the message from peer,
     // but for some encoder, it never send the ack message while it default to a none zone size.
@@ -277,6 +331,18 @@ public:
     //       never NULL if decode success.
     // @remark, drop message when msg is empty or payload length is empty.
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    // Recv a batch of RTMP messages, block for the first one, then parse all complete messages in the buffer,
+    // which never reads from the socket again.
+    // @param pmsgs, the array to store received messages, user must free them.
+    // @param max, the max number of messages to recv.
+    // @param count, the number of messages received, always 0 if error, at least 1 if success.
+    virtual srs_error_t recv_messages(SrsCommonMessage** pmsgs, int max, int& count);
+    // For non-blocking socket, read the available bytes from socket to buffer once.
+    // @return error when socket failed, or would block, and the error is from socket.
+    virtual srs_error_t read_available();
+    // For non-blocking socket, recv a RTMP message from the bytes in buffer, never read from the socket.
+    // @param pmsg, set the received message, NULL if no entire message in buffer.
+    virtual srs_error_t recv_buffered_message(SrsCommonMessage** pmsg);
     // Decode bytes oriented RTMP message to RTMP packet,
     // @param ppacket, output decoded packet,
     //       always NULL if error, never NULL if success.
@@ -358,8 +424,12 @@ private:
     virtual srs_error_t do_send_messages(SrsSharedPtrMessage** msgs, int nb_msgs);
     // Send iovs. send multiple times if exceed limits.
     virtual srs_error_t do_iovs_send(iovec* iovs, int size);
+    // Send iovs by MSG_ZEROCOPY, hold the messages and the headers in c0c3 cache until completed.
+    virtual srs_error_t do_zerocopy_send(SrsSharedPtrMessage** msgs, int nb_msgs, iovec* iovs, int size, int nb_headers);
     // The underlayer api for send and free packet.
     virtual srs_error_t do_send_and_free_packet(SrsPacket* packet, int stream_id);
+    // Send the corked messages by one writev.
+    virtual srs_error_t flush_corked();
     // The imp for decode_message
     virtual srs_error_t do_decode_message(SrsMessageHeader& header, SrsBuffer* stream, SrsPacket** ppacket);
     // Recv bytes oriented RTMP message from protocol stack.
@@ -367,6 +437,15 @@ private:
     // return success and pmsg set to NULL if no entire message got,
     // return success and pmsg set to entire message if got one.
     virtual srs_error_t recv_interlaced_message(SrsCommonMessage** pmsg);
+    // The imp for recv_message and recv_messages.
+    // @param in_buffer_only, whether only parse the chunks in buffer, never read from the socket.
+    //       if true, set pmsg to NULL when no entire message in buffer.
+    virtual srs_error_t do_recv_message(SrsCommonMessage** pmsg, bool in_buffer_only);
+    // Grow the flat table of chunk streams to contain the cid.
+    virtual void grow_chunk_streams(int cid);
+    // Whether the buffer contains an entire chunk, so it's parsed without reading from the socket.
+    // @remark It's true for the invalid fresh chunk, which fails without reading from the socket.
+    virtual bool chunk_in_buffer();
     // Read the chunk basic header(fmt, cid) from chunk stream.
     // user can discovery a SrsChunkStream by cid.
     virtual srs_error_t read_basic_header(char& fmt, int& cid);
@@ -413,6 +492,32 @@ public:
     virtual ~SrsChunkStream();
 };
 
+// The interned identity of stream, unique for each stream url vhost/app/stream, to key the
+// pools of stream by it, without generating the url and comparing strings for each lookup.
+// @remark The keys are never freed, like the sources.
+class SrsStreamKey
+{
+private:
+    static std::multimap<uint64_t, SrsStreamKey*> keys;
+public:
+    // The precomputed hash of url, by srs_generate_stream_hash.
+    uint64_t hash;
+    // The stream url, vhost/app/stream.
+    std::string url;
+private:
+    SrsStreamKey(uint64_t h, std::string u);
+    virtual ~SrsStreamKey();
+public:
+    // Fetch or create the interned key of stream.
+    static SrsStreamKey* intern(const std::string& vhost, const std::string& app, const std::string& stream);
+    // Find the key of stream, NULL if not interned.
+    static SrsStreamKey* find(const std::string& vhost, const std::string& app, const std::string& stream);
+    // Find the key by the stream url, NULL if not interned.
+    static SrsStreamKey* find(const std::string& url);
+    // The number of interned keys.
+    static int size();
+};
+
 // The original request from client.
 class SrsRequest
 {
@@ -467,6 +572,9 @@ public:
     virtual void update_auth(SrsRequest* req);
     // Get the stream identify, vhost/app/stream.
     virtual std::string get_stream_url();
+    // Get the interned key of stream, for lookup, never generate the url.
+    // @param create Whether intern the key, or NULL if not interned, for the stream never exists.
+    virtual SrsStreamKey* get_stream_key(bool create = true);
     // To strip url, user must strip when update the url.
     virtual void strip();
 public:
@@ -557,6 +665,8 @@ public:
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual srs_error_t read_available();
+    virtual srs_error_t recv_buffered_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg, int stream_id);
     virtual srs_error_t send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs, int stream_id);
@@ -646,6 +756,12 @@ public:
     // @see https://github.com/ossrs/srs/issues/241
     virtual void set_recv_buffer(int buffer_size);
 #endif
+    // Report the size of recv buffer to the memory stat of stream, as the type by role.
+    virtual void set_memory(SrsMemoryStat* v, SrsMemoryType type);
+    // Shrink the recv buffer to the min size, for example, the player only reads control messages.
+    virtual void shrink_recv_buffer();
+    // Send the messages by MSG_ZEROCOPY, see SrsProtocol::set_zerocopy
+    virtual srs_error_t set_zerocopy(int threshold);
     // To set/get the recv timeout in srs_utime_t.
     // if timeout, recv/send message return ERROR_SOCKET_TIMEOUT.
     virtual void set_recv_timeout(srs_utime_t tm);
@@ -657,6 +773,8 @@ public:
     // Get recv/send bytes.
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+    // Get the number of chunks whose cid is not in the chunk stream cache.
+    virtual int64_t get_chunk_stream_misses();
     // Recv a RTMP message, which is bytes oriented.
     // user can use decode_message to get the decoded RTMP packet.
     // @param pmsg, set the received message,
@@ -665,6 +783,17 @@ public:
     //       never NULL if decode success.
     // @remark, drop message when msg is empty or payload length is empty.
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    // Recv a batch of RTMP messages, block for the first one, then parse all complete messages in the buffer,
+    // which never reads from the socket again.
+    // @param pmsgs, the array to store received messages, user must free them.
+    // @param max, the max number of messages to recv.
+    // @param count, the number of messages received, always 0 if error, at least 1 if success.
+    virtual srs_error_t recv_messages(SrsCommonMessage** pmsgs, int max, int& count);
+    // Read the available bytes from socket to buffer once, user should make sure the socket is readable.
+    virtual srs_error_t read_available();
+    // Recv a RTMP message from the bytes in buffer, never read from the socket.
+    // @param pmsg, set the received message, NULL if no entire message in buffer.
+    virtual srs_error_t recv_buffered_message(SrsCommonMessage** pmsg);
     // Decode bytes oriented RTMP message to RTMP packet,
     // @param ppacket, output decoded packet,
     //       always NULL if error, never NULL if success.
@@ -692,6 +821,9 @@ public:
     // @param packet, the packet to send out, never be NULL.
     // @param stream_id, the stream id of packet to send over, 0 for control message.
     virtual srs_error_t send_and_free_packet(SrsPacket* packet, int stream_id);
+    // Cork the send, to coalesce the small responses in one writev, @see SrsProtocol::cork
+    virtual void cork();
+    virtual srs_error_t uncork();
 public:
     // Do handshake with client, try complex then simple.
     virtual srs_error_t handshake();
@@ -776,6 +908,9 @@ public:
         return protocol->expect_message<T>(pmsg, ppacket);
     }
 private:
+    // Expect the connect app message, and read the command object as a view of its payload.
+    // @remark The msg is always returned for the view refers to it, user must free it.
+    virtual srs_error_t expect_connect_app(SrsRequest* req, SrsCommonMessage** pmsg, SrsAmf0ObjectView* command_object);
     virtual srs_error_t identify_create_stream_client(SrsCreateStreamPacket* req, int stream_id, int depth, SrsRtmpConnType& type, std::string& stream_name, srs_utime_t& duration);
     virtual srs_error_t identify_fmle_publish_client(SrsFMLEStartPacket* req, SrsRtmpConnType& type, std::string& stream_name);
     virtual srs_error_t identify_haivision_publish_client(SrsFMLEStartPacket* req, SrsRtmpConnType& type, std::string& stream_name);
@@ -26,6 +26,7 @@
 #if !defined(SRS_EXPORT_LIBRTMP)
 
 #include <stdlib.h>
+#include <strings.h>
 #include <map>
 using namespace std;
 
@@ -137,6 +138,7 @@ SrsRtpPacket::SrsRtpPacket()
     audio = new SrsAudioFrame();
     chunked = false;
     completed = false;
+    chunk_start = false;
 }
 
 SrsRtpPacket::~SrsRtpPacket()
@@ -159,6 +161,7 @@ void SrsRtpPacket::copy(SrsRtpPacket* src)
     
     chunked = src->chunked;
     completed = src->completed;
+    chunk_start = src->chunk_start;
 
     srs_freep(audio);
     audio = new SrsAudioFrame();
@@ -212,6 +215,67 @@ srs_error_t SrsRtpPacket::decode(SrsBuffer* stream)
     return err;
 }
 
+srs_error_t SrsRtpPacket::decode_raw(SrsBuffer* stream)
+{
+    srs_error_t err = srs_success;
+    
+    // 12bytes header
+    if (!stream->require(12)) {
+        return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "requires 12 only %d bytes", stream->left());
+    }
+    
+    int8_t vv = stream->read_1bytes();
+    version = (vv >> 6) & 0x03;
+    padding = (vv >> 5) & 0x01;
+    extension = (vv >> 4) & 0x01;
+    csrc_count = vv & 0x0f;
+    
+    int8_t mv = stream->read_1bytes();
+    marker = (mv >> 7) & 0x01;
+    payload_type = mv & 0x7f;
+    
+    sequence_number = stream->read_2bytes();
+    timestamp = stream->read_4bytes();
+    ssrc = stream->read_4bytes();
+    
+    if (version != 2) {
+        return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "invalid version %d", version);
+    }
+    
+    // 4bytes each CSRC
+    if (!stream->require(csrc_count * 4)) {
+        return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "requires %d CSRC only %d bytes", csrc_count, stream->left());
+    }
+    stream->skip(csrc_count * 4);
+    
+    // 2bytes profile, 2bytes length in 4bytes words, then extension data.
+    if (extension) {
+        if (!stream->require(4)) {
+            return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "requires 4 only %d bytes", stream->left());
+        }
+        stream->skip(2);
+        int nn_extension = 4 * stream->read_2bytes();
+        if (!stream->require(nn_extension)) {
+            return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "requires %d only %d bytes", nn_extension, stream->left());
+        }
+        stream->skip(nn_extension);
+    }
+    
+    // The last byte of padding is the number of padding bytes.
+    int nn_payload = stream->left();
+    if (padding && nn_payload > 0) {
+        nn_payload -= (uint8_t)stream->data()[stream->size() - 1];
+    }
+    if (nn_payload < 0) {
+        return srs_error_new(ERROR_RTP_HEADER_CORRUPT, "invalid padding, payload=%d", nn_payload);
+    }
+    
+    payload->append(stream->data() + stream->pos(), nn_payload);
+    completed = true;
+    
+    return err;
+}
+
 srs_error_t SrsRtpPacket::decode_97(SrsBuffer* stream)
 {
     srs_error_t err = srs_success;
@@ -297,6 +361,7 @@ srs_error_t SrsRtpPacket::decode_96(SrsBuffer* stream)
     if (fu_indicator == 0x1c && (first_chunk || last_chunk || contious_chunk)) {
         chunked = true;
         completed = last_chunk;
+        chunk_start = first_chunk;
         
         // generate and append the first byte NALU.
         if (first_chunk) {
@@ -442,6 +507,11 @@ srs_error_t SrsRtspSdp::parse(string token)
                     }
                 }
             } else if (desc_key == "control") {
+                if (state == SrsRtspSdpStateVideo) {
+                    video_control = attr_str;
+                } else if (state == SrsRtspSdpStateAudio) {
+                    audio_control = attr_str;
+                }
                 for (int i = 0; i < (int)attrs.size(); i++) {
                     std::string attr = attrs.at(i);
                     if ((err = parse_control_attribute(attr)) != srs_success) {
@@ -599,6 +669,10 @@ SrsRtspTransport::SrsRtspTransport()
 {
     client_port_min = 0;
     client_port_max = 0;
+    server_port_min = 0;
+    server_port_max = 0;
+    interleaved_min = -1;
+    interleaved_max = -1;
 }
 
 SrsRtspTransport::~SrsRtspTransport()
@@ -652,12 +726,52 @@ srs_error_t SrsRtspTransport::parse(string attr)
             }
             client_port_min = ::atoi(sport.c_str());
             client_port_max = ::atoi(eport.c_str());
+        } else if (item_key == "server_port" || item_key == "interleaved") {
+            std::string sport = item_value;
+            std::string eport = item_value;
+            if ((pos = eport.find("-")) != string::npos) {
+                sport = eport.substr(0, pos);
+                eport = eport.substr(pos + 1);
+            }
+            if (item_key == "server_port") {
+                server_port_min = ::atoi(sport.c_str());
+                server_port_max = ::atoi(eport.c_str());
+            } else {
+                interleaved_min = ::atoi(sport.c_str());
+                interleaved_max = ::atoi(eport.c_str());
+            }
+        } else if (item_key == "ssrc") {
+            ssrc = item_value;
         }
     }
     
     return err;
 }
 
+string SrsRtspTransport::encode()
+{
+    std::stringstream ss;
+    
+    ss << transport << "/" << profile;
+    if (!lower_transport.empty()) {
+        ss << "/" << lower_transport;
+    }
+    if (!cast_type.empty()) {
+        ss << ";" << cast_type;
+    }
+    if (client_port_min > 0) {
+        ss << ";client_port=" << client_port_min << "-" << client_port_max;
+    }
+    if (interleaved_min >= 0) {
+        ss << ";interleaved=" << interleaved_min << "-" << interleaved_max;
+    }
+    if (!mode.empty()) {
+        ss << ";mode=" << mode;
+    }
+    
+    return ss.str();
+}
+
 SrsRtspRequest::SrsRtspRequest()
 {
     seq = 0;
@@ -693,14 +807,51 @@ bool SrsRtspRequest::is_record()
     return method == SRS_METHOD_RECORD;
 }
 
+srs_error_t SrsRtspRequest::encode(stringstream& ss)
+{
+    // request line
+    ss << method << SRS_RTSP_SP << uri << SRS_RTSP_SP << SRS_RTSP_VERSION << SRS_RTSP_CRLF;
+    
+    // cseq
+    ss << SRS_RTSP_TOKEN_CSEQ << ":" << SRS_RTSP_SP << seq << SRS_RTSP_CRLF;
+    ss << SRS_RTSP_TOKEN_USER_AGENT << ":" << SRS_RTSP_SP << RTMP_SIG_SRS_SERVER << SRS_RTSP_CRLF;
+    
+    // optional headers.
+    if (!accept.empty()) {
+        ss << SRS_RTSP_TOKEN_ACCEPT << ":" << SRS_RTSP_SP << accept << SRS_RTSP_CRLF;
+    }
+    if (!authorization.empty()) {
+        ss << SRS_RTSP_TOKEN_AUTHORIZATION << ":" << SRS_RTSP_SP << authorization << SRS_RTSP_CRLF;
+    }
+    if (transport) {
+        ss << SRS_RTSP_TOKEN_TRANSPORT << ":" << SRS_RTSP_SP << transport->encode() << SRS_RTSP_CRLF;
+    }
+    if (!session.empty()) {
+        ss << SRS_RTSP_TOKEN_SESSION << ":" << SRS_RTSP_SP << session << SRS_RTSP_CRLF;
+    }
+    if (!range.empty()) {
+        ss << SRS_RTSP_TOKEN_RANGE << ":" << SRS_RTSP_SP << range << SRS_RTSP_CRLF;
+    }
+    
+    // header EOF.
+    ss << SRS_RTSP_CRLF;
+    
+    return srs_success;
+}
+
 SrsRtspResponse::SrsRtspResponse(int cseq)
 {
     seq = cseq;
     status = SRS_CONSTS_RTSP_OK;
+    content_length = 0;
+    sdp = NULL;
+    transport = NULL;
 }
 
 SrsRtspResponse::~SrsRtspResponse()
 {
+    srs_freep(sdp);
+    srs_freep(transport);
 }
 
 srs_error_t SrsRtspResponse::encode(stringstream& ss)
@@ -852,6 +1003,78 @@ srs_error_t SrsRtspStack::send_message(SrsRtspResponse* res)
     return err;
 }
 
+srs_error_t SrsRtspStack::send_request(SrsRtspRequest* req)
+{
+    srs_error_t err = srs_success;
+    
+    std::stringstream ss;
+    // encode the message to string.
+    if ((err = req->encode(ss)) != srs_success) {
+        return srs_error_wrap(err, "encode request");
+    }
+    
+    std::string str = ss.str();
+    srs_assert(!str.empty());
+    
+    if ((err = skt->write((char*)str.c_str(), (int)str.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "write request");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspStack::recv_response(SrsRtspResponse** pres)
+{
+    srs_error_t err = srs_success;
+    
+    SrsRtspResponse* res = new SrsRtspResponse(0);
+    if ((err = do_recv_response(res)) != srs_success) {
+        srs_freep(res);
+        return srs_error_wrap(err, "recv response");
+    }
+    
+    *pres = res;
+    
+    return err;
+}
+
+srs_error_t SrsRtspStack::recv_interleaved(int* pchannel, std::string& data, SrsRtspResponse** pres)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = grow(1)) != srs_success) {
+        return srs_error_wrap(err, "grow");
+    }
+    
+    // Not interleaved data, it must be the response of request, for example, keepalive.
+    if (buf->bytes()[0] != SRS_RTSP_INTERLEAVED_MAGIC) {
+        *pchannel = -1;
+        return recv_response(pres);
+    }
+    
+    // $ + 1B channel + 2B length
+    if ((err = grow(4)) != srs_success) {
+        return srs_error_wrap(err, "grow");
+    }
+    
+    uint8_t* p = (uint8_t*)buf->bytes();
+    int channel = p[1];
+    int size = ((int)p[2] << 8) | p[3];
+    if (size <= 0) {
+        return srs_error_new(ERROR_RTSP_INTERLEAVED_CORRUPT, "invalid interleaved size=%d, channel=%d", size, channel);
+    }
+    
+    if ((err = grow(4 + size)) != srs_success) {
+        return srs_error_wrap(err, "grow");
+    }
+    
+    data.assign(buf->bytes() + 4, size);
+    buf->erase(4 + size);
+    *pchannel = channel;
+    
+    return err;
+}
+
 srs_error_t SrsRtspStack::do_recv_message(SrsRtspRequest* req)
 {
     srs_error_t err = srs_success;
@@ -961,6 +1184,125 @@ srs_error_t SrsRtspStack::do_recv_message(SrsRtspRequest* req)
     return err;
 }
 
+srs_error_t SrsRtspStack::do_recv_response(SrsRtspResponse* res)
+{
+    srs_error_t err = srs_success;
+    
+    // parse status line, the reason phrase is optional.
+    std::string version;
+    if ((err = recv_token_normal(version)) != srs_success) {
+        return srs_error_wrap(err, "version");
+    }
+    
+    std::string status;
+    SrsRtspTokenState state = SrsRtspTokenStateError;
+    if ((err = recv_token(status, state)) != srs_success) {
+        return srs_error_wrap(err, "status");
+    }
+    res->status = ::atoi(status.c_str());
+    
+    if (state == SrsRtspTokenStateNormal) {
+        std::string reason;
+        if ((err = recv_token_util_eof(reason)) != srs_success) {
+            return srs_error_wrap(err, "reason");
+        }
+    }
+    
+    // parse headers, some servers use lowercase name, for example, Cseq.
+    for (;;) {
+        std::string token;
+        if ((err = recv_token_normal(token)) != srs_success) {
+            if (srs_error_code(err) == ERROR_RTSP_REQUEST_HEADER_EOF) {
+                srs_error_reset(err);
+                break;
+            }
+            return srs_error_wrap(err, "recv token");
+        }
+        
+        // The value maybe contains SP, for example, Date or WWW-Authenticate.
+        std::string value;
+        if ((err = recv_token_util_eof(value)) != srs_success) {
+            return srs_error_wrap(err, "value of %s", token.c_str());
+        }
+        
+        if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_CSEQ)) {
+            res->seq = ::atol(value.c_str());
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_CONTENT_TYPE)) {
+            res->content_type = value;
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_CONTENT_LENGTH)) {
+            res->content_length = ::atol(value.c_str());
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_CONTENT_BASE)) {
+            res->content_base = value;
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_WWW_AUTHENTICATE)) {
+            // Prefer the first one, generally the Digest.
+            if (res->www_authenticate.empty()) {
+                res->www_authenticate = value;
+            }
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_SESSION)) {
+            res->session = value;
+        } else if (!strcasecmp(token.c_str(), SRS_RTSP_TOKEN_TRANSPORT)) {
+            if (!res->transport) {
+                res->transport = new SrsRtspTransport();
+            }
+            if ((err = res->transport->parse(value)) != srs_success) {
+                return srs_error_wrap(err, "parse transport=%s", value.c_str());
+            }
+        }
+    }
+    
+    if (res->content_length <= 0) {
+        return err;
+    }
+    
+    // Read the whole body, because the last line of sdp maybe not ends with CRLF.
+    if ((err = grow((int)res->content_length)) != srs_success) {
+        return srs_error_wrap(err, "body");
+    }
+    std::string body(buf->bytes(), res->content_length);
+    buf->erase((int)res->content_length);
+    
+    if (res->content_type != "application/sdp") {
+        return err;
+    }
+    
+    res->sdp = new SrsRtspSdp();
+    
+    size_t pos = string::npos;
+    while (!body.empty()) {
+        std::string line = body;
+        if ((pos = body.find(SRS_RTSP_LF)) != string::npos) {
+            line = body.substr(0, pos);
+            body = body.substr(pos + 1);
+        } else {
+            body = "";
+        }
+        line = srs_string_trim_end(line, SRS_RTSP_CRLF);
+        
+        if ((err = res->sdp->parse(line)) != srs_success) {
+            return srs_error_wrap(err, "parse sdp %s", line.c_str());
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsRtspStack::grow(int size)
+{
+    srs_error_t err = srs_success;
+    
+    while (buf->length() < size) {
+        char buffer[SRS_RTSP_BUFFER];
+        ssize_t nb_read = 0;
+        if ((err = skt->read(buffer, SRS_RTSP_BUFFER, &nb_read)) != srs_success) {
+            return srs_error_wrap(err, "recv data");
+        }
+        
+        buf->append(buffer, (int)nb_read);
+    }
+    
+    return err;
+}
+
 srs_error_t SrsRtspStack::recv_token_normal(std::string& token)
 {
     srs_error_t err = srs_success;
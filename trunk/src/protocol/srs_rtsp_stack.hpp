@@ -60,6 +60,12 @@ class ISrsProtocolReadWriter;
 #define SRS_RTSP_TOKEN_CONTENT_LENGTH "Content-Length"
 #define SRS_RTSP_TOKEN_TRANSPORT "Transport"
 #define SRS_RTSP_TOKEN_SESSION "Session"
+#define SRS_RTSP_TOKEN_CONTENT_BASE "Content-Base"
+#define SRS_RTSP_TOKEN_ACCEPT "Accept"
+#define SRS_RTSP_TOKEN_RANGE "Range"
+#define SRS_RTSP_TOKEN_AUTHORIZATION "Authorization"
+#define SRS_RTSP_TOKEN_USER_AGENT "User-Agent"
+#define SRS_RTSP_TOKEN_WWW_AUTHENTICATE "WWW-Authenticate"
 
 // RTSP methods
 #define SRS_METHOD_OPTIONS            "OPTIONS"
@@ -74,6 +80,11 @@ class ISrsProtocolReadWriter;
 #define SRS_METHOD_REDIRECT           "REDIRECT"
 #define SRS_METHOD_RECORD             "RECORD"
 // Embedded (Interleaved) Binary Data
+// 10.12 Embedded (Interleaved) Binary Data, @see rfc2326-1998-rtsp.pdf, page 40
+// The stream data such as RTP packets is encapsulated by an ASCII dollar sign (24 hexadecimal),
+// followed by a one-byte channel identifier, followed by the length of the encapsulated binary
+// data as a binary, two-byte integer in network byte order.
+#define SRS_RTSP_INTERLEAVED_MAGIC '$'
 
 // RTSP-Version
 #define SRS_RTSP_VERSION "RTSP/1.0"
@@ -251,6 +262,8 @@ public:
     // normal message always completed.
     // while chunked completed when the last chunk arriaved.
     bool completed;
+    // Whether it's the first chunk of chunked message.
+    bool chunk_start;
     
     // The audio samples, one rtp packets may contains multiple audio samples.
     SrsAudioFrame* audio;
@@ -264,6 +277,9 @@ public:
     virtual void reap(SrsRtpPacket* src);
     // decode rtp packet from stream.
     virtual srs_error_t decode(SrsBuffer* stream);
+    // Decode the rtp header, skip the CSRC, extension and padding, then append the payload,
+    // which is not parsed because the payload type is dynamic, defined by sdp.
+    virtual srs_error_t decode_raw(SrsBuffer* stream);
 private:
     virtual srs_error_t decode_97(SrsBuffer* stream);
     virtual srs_error_t decode_96(SrsBuffer* stream);
@@ -303,6 +319,8 @@ public:
     std::string video_codec;
     std::string video_sample_rate;
     std::string video_stream_id;
+    // The control url of video, for client to setup the track.
+    std::string video_control;
     // The fmtp
     std::string video_packetization_mode;
     std::string video_sps; // sequence header: sps.
@@ -316,6 +334,8 @@ public:
     std::string audio_sample_rate;
     std::string audio_channel;
     std::string audio_stream_id;
+    // The control url of audio, for client to setup the track.
+    std::string audio_control;
     // The fmtp
     std::string audio_profile_level_id;
     std::string audio_mode;
@@ -373,12 +393,27 @@ public:
     //      [client_port_min, client_port_max)
     int client_port_min;
     int client_port_max;
+    // The port pair of server to send the RTP/RTCP, for example,
+    //      server_port=6970-6971
+    int server_port_min;
+    int server_port_max;
+    // The channel pair of interleaved RTP/RTCP over the RTSP connection, for example,
+    //      interleaved=0-1
+    // It's -1 when not interleaved.
+    int interleaved_min;
+    int interleaved_max;
+    // The SSRC of the stream, in hex, for example,
+    //      ssrc=6B8B4567
+    // It's empty when not specified by server.
+    std::string ssrc;
 public:
     SrsRtspTransport();
     virtual ~SrsRtspTransport();
 public:
     // Parse a line of token for transport.
     virtual srs_error_t parse(std::string attr);
+    // Encode the transport to string, for client to setup.
+    virtual std::string encode();
 };
 
 // The rtsp request message.
@@ -431,6 +466,10 @@ public:
     SrsRtspTransport* transport;
     // For setup message, parse the stream id from uri.
     int stream_id;
+    // For client, the optional headers, ignored when empty.
+    std::string accept;
+    std::string range;
+    std::string authorization;
 public:
     SrsRtspRequest();
     virtual ~SrsRtspRequest();
@@ -439,6 +478,9 @@ public:
     virtual bool is_announce();
     virtual bool is_setup();
     virtual bool is_record();
+public:
+    // Encode the request to string, for client.
+    virtual srs_error_t encode(std::stringstream& ss);
 };
 
 // The rtsp response message.
@@ -479,6 +521,15 @@ public:
     long seq;
     // The session id.
     std::string session;
+    // For client, the headers and body parsed from server.
+    std::string content_type;
+    long content_length;
+    std::string content_base;
+    std::string www_authenticate;
+    // The sdp in describe, NULL for no sdp.
+    SrsRtspSdp* sdp;
+    // The transport in setup, NULL for no transport.
+    SrsRtspTransport* transport;
 public:
     SrsRtspResponse(int cseq);
     virtual ~SrsRtspResponse();
@@ -555,9 +606,26 @@ public:
     // @param res the rtsp response message, which user should never free it.
     // @return an int error code.
     virtual srs_error_t send_message(SrsRtspResponse* res);
+// For client.
+public:
+    // Send rtsp request over underlayer io.
+    // @param req the rtsp request message, which user should never free it.
+    virtual srs_error_t send_request(SrsRtspRequest* req);
+    // Recv rtsp response from underlayer io.
+    // @param pres the output rtsp response message, which user must free it.
+    virtual srs_error_t recv_response(SrsRtspResponse** pres);
+    // Recv the interleaved binary data, or the response of request, from underlayer io.
+    // @param pchannel the output channel of data, -1 if got response.
+    // @param data the output binary data, for example, RTP packet.
+    // @param pres the output rtsp response message when pchannel is -1, which user must free it.
+    virtual srs_error_t recv_interleaved(int* pchannel, std::string& data, SrsRtspResponse** pres);
 private:
     // Recv the rtsp message.
     virtual srs_error_t do_recv_message(SrsRtspRequest* req);
+    // Recv the rtsp response.
+    virtual srs_error_t do_recv_response(SrsRtspResponse* res);
+    // Read from io until the buffer is at least size bytes.
+    virtual srs_error_t grow(int size);
     // Read a normal token from io, error when token state is not normal.
     virtual srs_error_t recv_token_normal(std::string& token);
     // Read a normal token from io, error when token state is not eof.
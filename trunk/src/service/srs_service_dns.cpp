@@ -0,0 +1,556 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <srs_service_dns.hpp>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_service_st.hpp>
+
+// The default timeout for each nameserver.
+#define SRS_DNS_TIMEOUT (3 * SRS_UTIME_SECONDS)
+// The max TTL to cache the record.
+#define SRS_DNS_MAX_TTL (3600 * SRS_UTIME_SECONDS)
+// The TTL of negative cache, when no SOA in response.
+#define SRS_DNS_NEGATIVE_TTL (10 * SRS_UTIME_SECONDS)
+// The max number of cached entries, to clear the expired ones.
+#define SRS_DNS_MAX_ENTRIES 1024
+// The max size of UDP response, @see RFC 1035 4.2.1
+#define SRS_DNS_MAX_SIZE 512
+
+SrsDnsEntry::SrsDnsEntry()
+{
+    ttl = expire = 0;
+}
+
+SrsDnsEntry::~SrsDnsEntry()
+{
+}
+
+SrsDnsResolver* SrsDnsResolver::_instance = NULL;
+
+SrsDnsResolver::SrsDnsResolver()
+{
+    loaded = false;
+    qid = (uint16_t)(srs_get_system_time() ^ getpid());
+    
+    nn_hits = nn_negative_hits = 0;
+    nn_queries = nn_failures = 0;
+}
+
+SrsDnsResolver::~SrsDnsResolver()
+{
+    std::map<std::string, SrsDnsEntry*>::iterator it;
+    for (it = cache.begin(); it != cache.end(); ++it) {
+        SrsDnsEntry* entry = it->second;
+        srs_freep(entry);
+    }
+    cache.clear();
+}
+
+SrsDnsResolver* SrsDnsResolver::instance()
+{
+    if (_instance == NULL) {
+        _instance = new SrsDnsResolver();
+    }
+    return _instance;
+}
+
+srs_error_t SrsDnsResolver::resolve(string host, srs_utime_t timeout, string& ip)
+{
+    srs_error_t err = srs_success;
+    
+    if (host.empty()) {
+        return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "empty host");
+    }
+    
+    // Ignore if host is an address.
+    in6_addr addr;
+    if (inet_pton(AF_INET, host.c_str(), &addr) > 0 || inet_pton(AF_INET6, host.c_str(), &addr) > 0) {
+        ip = host;
+        return err;
+    }
+    
+    load_system_config();
+    
+    std::map<std::string, std::string>::iterator it = hosts.find(host);
+    if (it != hosts.end()) {
+        ip = it->second;
+        return err;
+    }
+    
+    SrsDnsEntry* entry = NULL;
+    std::map<std::string, SrsDnsEntry*>::iterator ite = cache.find(host);
+    if (ite != cache.end() && (entry = ite->second)->expire > srs_get_system_time()) {
+        if (entry->ip.empty()) {
+            nn_negative_hits++;
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "resolve %s, negative cached", host.c_str());
+        }
+        
+        nn_hits++;
+        ip = entry->ip;
+        return err;
+    }
+    
+    if (timeout <= 0 || timeout > SRS_DNS_TIMEOUT) {
+        timeout = SRS_DNS_TIMEOUT;
+    }
+    
+    // For the host without dot, try the search domains first.
+    vector<string> names;
+    if (host.find(".") == string::npos) {
+        for (int i = 0; i < (int)domains.size(); i++) {
+            names.push_back(host + "." + domains.at(i));
+        }
+    }
+    names.push_back(host);
+    
+    nn_queries++;
+    
+    srs_utime_t ttl = 0;
+    for (int i = 0; i < (int)names.size(); i++) {
+        string v;
+        if ((err = do_resolve(names.at(i), timeout, v, ttl)) != srs_success) {
+            nn_failures++;
+            return srs_error_wrap(err, "resolve %s", host.c_str());
+        }
+        
+        if (!v.empty()) {
+            update_cache(host, v, ttl);
+            srs_trace("dns: resolve %s to %s, ttl=%ds", names.at(i).c_str(), v.c_str(), srsu2msi(ttl) / 1000);
+            ip = v;
+            return err;
+        }
+    }
+    
+    // All names are NXDOMAIN or NODATA, use the TTL of the last one.
+    update_cache(host, "", ttl);
+    return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "resolve %s, no address", host.c_str());
+}
+
+srs_error_t SrsDnsResolver::do_resolve(string host, srs_utime_t timeout, string& ip, srs_utime_t& ttl)
+{
+    srs_error_t err = srs_success;
+    
+    // Try each nameserver, until got the answer or NXDOMAIN.
+    for (int i = 0; i < (int)servers.size(); i++) {
+        std::string server = servers.at(i);
+        if ((err = query(server, host, timeout, ip, ttl)) == srs_success) {
+            return err;
+        }
+        
+        srs_warn("dns: ignore server=%s, host=%s, err %s", server.c_str(), host.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "no answer from %d servers", (int)servers.size());
+}
+
+srs_error_t SrsDnsResolver::dumps(SrsJsonObject* obj)
+{
+    srs_error_t err = srs_success;
+    
+    SrsJsonArray* arr = SrsJsonAny::array();
+    obj->set("servers", arr);
+    for (int i = 0; i < (int)servers.size(); i++) {
+        arr->append(SrsJsonAny::str(servers.at(i).c_str()));
+    }
+    
+    obj->set("hits", SrsJsonAny::integer(nn_hits));
+    obj->set("negative_hits", SrsJsonAny::integer(nn_negative_hits));
+    obj->set("queries", SrsJsonAny::integer(nn_queries));
+    obj->set("failures", SrsJsonAny::integer(nn_failures));
+    
+    srs_utime_t now = srs_get_system_time();
+    
+    arr = SrsJsonAny::array();
+    obj->set("entries", arr);
+    std::map<std::string, SrsDnsEntry*>::iterator it;
+    for (it = cache.begin(); it != cache.end(); ++it) {
+        SrsDnsEntry* entry = it->second;
+        arr->append(SrsJsonAny::object()
+            ->set("host", SrsJsonAny::str(it->first.c_str()))
+            ->set("ip", SrsJsonAny::str(entry->ip.c_str()))
+            ->set("ttl", SrsJsonAny::integer(srsu2ms(entry->ttl) / 1000))
+            ->set("expire", SrsJsonAny::integer(srsu2ms(entry->expire - now))));
+    }
+    
+    return err;
+}
+
+void SrsDnsResolver::load_system_config()
+{
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+    
+    string line;
+    
+    ifstream resolv("/etc/resolv.conf");
+    while (std::getline(resolv, line)) {
+        stringstream ss(line);
+        string key, value;
+        ss >> key >> value;
+        
+        // We only use the ipv4 nameservers.
+        in_addr addr;
+        if (key == "nameserver" && inet_pton(AF_INET, value.c_str(), &addr) > 0) {
+            servers.push_back(value);
+        }
+        
+        // The search list, the last one wins, @see man resolv.conf
+        if (key == "search" || key == "domain") {
+            domains.clear();
+            while (!value.empty()) {
+                domains.push_back(value);
+                value = "";
+                ss >> value;
+            }
+        }
+    }
+    
+    // Use the local nameserver if not specified, like glibc.
+    if (servers.empty()) {
+        servers.push_back("127.0.0.1");
+    }
+    
+    ifstream etc_hosts("/etc/hosts");
+    while (std::getline(etc_hosts, line)) {
+        line = line.substr(0, line.find("#"));
+        
+        stringstream ss(line);
+        string ip, name;
+        ss >> ip;
+        
+        in_addr addr;
+        if (inet_pton(AF_INET, ip.c_str(), &addr) <= 0) {
+            continue;
+        }
+        
+        // The first one wins.
+        while (ss >> name) {
+            if (hosts.find(name) == hosts.end()) {
+                hosts[name] = ip;
+            }
+        }
+    }
+    
+    if (hosts.find("localhost") == hosts.end()) {
+        hosts["localhost"] = "127.0.0.1";
+    }
+    
+    srs_trace("dns: load %d servers, %d hosts", (int)servers.size(), (int)hosts.size());
+}
+
+void SrsDnsResolver::update_cache(string host, string ip, srs_utime_t ttl)
+{
+    srs_utime_t now = srs_get_system_time();
+    
+    // Clear the expired entries, or all if still too many.
+    if ((int)cache.size() >= SRS_DNS_MAX_ENTRIES && cache.find(host) == cache.end()) {
+        std::map<std::string, SrsDnsEntry*>::iterator it;
+        for (it = cache.begin(); it != cache.end();) {
+            SrsDnsEntry* entry = it->second;
+            if ((int)cache.size() >= SRS_DNS_MAX_ENTRIES || entry->expire <= now) {
+                srs_freep(entry);
+                cache.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    SrsDnsEntry* entry = cache[host];
+    if (!entry) {
+        entry = cache[host] = new SrsDnsEntry();
+    }
+    
+    entry->ip = ip;
+    entry->ttl = srs_min(ttl, SRS_DNS_MAX_TTL);
+    entry->expire = now + entry->ttl;
+}
+
+srs_error_t SrsDnsResolver::query(string server, string host, srs_utime_t timeout, string& ip, srs_utime_t& ttl)
+{
+    srs_error_t err = srs_success;
+    
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(53);
+    if (inet_pton(AF_INET, server.c_str(), &addr.sin_addr) <= 0) {
+        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "invalid server %s", server.c_str());
+    }
+    
+    uint16_t id = qid++;
+    string req;
+    if ((err = encode_query(id, host, req)) != srs_success) {
+        return srs_error_wrap(err, "encode");
+    }
+    
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        return srs_error_new(ERROR_SOCKET_CREATE, "create socket");
+    }
+    
+    srs_netfd_t stfd = srs_netfd_open_socket(fd);
+    if (stfd == NULL) {
+        ::close(fd);
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "open socket");
+    }
+    
+    if (srs_sendto(stfd, (void*)req.data(), (int)req.length(), (sockaddr*)&addr, sizeof(addr), timeout) <= 0) {
+        srs_close_stfd(stfd);
+        return srs_error_new(ERROR_SOCKET_WRITE, "send to %s", server.c_str());
+    }
+    
+    // Ignore the stray responses, which is not for this query.
+    char buf[SRS_DNS_MAX_SIZE];
+    int nread = 0;
+    srs_utime_t starttime = srs_update_system_time();
+    while (true) {
+        srs_utime_t elapsed = srs_update_system_time() - starttime;
+        if (elapsed >= timeout) {
+            srs_close_stfd(stfd);
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "recv from %s timeout", server.c_str());
+        }
+        
+        sockaddr_in from;
+        int nb_from = sizeof(from);
+        nread = srs_recvfrom(stfd, buf, sizeof(buf), (sockaddr*)&from, &nb_from, timeout - elapsed);
+        if (nread <= 0) {
+            srs_close_stfd(stfd);
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "recv from %s, nread=%d", server.c_str(), nread);
+        }
+        
+        if (from.sin_addr.s_addr != addr.sin_addr.s_addr || nread < 2 || (uint16_t)((uint8_t)buf[0] << 8 | (uint8_t)buf[1]) != id) {
+            continue;
+        }
+        
+        break;
+    }
+    srs_close_stfd(stfd);
+    
+    // TODO: FIXME: Retry by TCP if truncated.
+    return decode_response(id, buf, nread, ip, ttl);
+}
+
+srs_error_t SrsDnsResolver::encode_query(uint16_t id, string host, string& data)
+{
+    srs_error_t err = srs_success;
+    
+    char buf[SRS_DNS_MAX_SIZE];
+    SrsBuffer b(buf, sizeof(buf));
+    
+    // The header, RD(recursion desired) and 1 question.
+    b.write_2bytes(id);
+    b.write_2bytes(0x0100);
+    b.write_2bytes(1);
+    b.write_2bytes(0);
+    b.write_2bytes(0);
+    b.write_2bytes(0);
+    
+    // The QNAME in labels.
+    vector<string> labels = srs_string_split(host, ".");
+    for (int i = 0; i < (int)labels.size(); i++) {
+        string label = labels.at(i);
+        if (label.empty()) {
+            continue;
+        }
+        if (label.length() > 63 || !b.require(1 + (int)label.length() + 5)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "invalid host %s", host.c_str());
+        }
+        b.write_1bytes((int8_t)label.length());
+        b.write_string(label);
+    }
+    b.write_1bytes(0);
+    
+    // The QTYPE A and QCLASS IN.
+    b.write_2bytes(1);
+    b.write_2bytes(1);
+    
+    data = string(buf, b.pos());
+    return err;
+}
+
+srs_error_t SrsDnsResolver::decode_response(uint16_t id, char* data, int size, string& ip, srs_utime_t& ttl)
+{
+    srs_error_t err = srs_success;
+    
+    SrsBuffer b(data, size);
+    if (!b.require(12)) {
+        return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "requires 12 only %d bytes", b.left());
+    }
+    
+    uint16_t rid = (uint16_t)b.read_2bytes();
+    uint16_t flags = (uint16_t)b.read_2bytes();
+    int nn_questions = (uint16_t)b.read_2bytes();
+    int nn_answers = (uint16_t)b.read_2bytes();
+    int nn_authorities = (uint16_t)b.read_2bytes();
+    b.skip(2);
+    
+    if (rid != id || (flags & 0x8000) == 0) {
+        return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "invalid id=%d/%d, flags=%#x", rid, id, flags);
+    }
+    
+    // Only NOERROR and NXDOMAIN are answers, others like SERVFAIL should try next server.
+    int rcode = flags & 0x0f;
+    if (rcode != 0 && rcode != 3) {
+        return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "rcode=%d", rcode);
+    }
+    
+    for (int i = 0; i < nn_questions; i++) {
+        if ((err = skip_name(&b)) != srs_success) {
+            return srs_error_wrap(err, "question");
+        }
+        if (!b.require(4)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "question requires 4 only %d bytes", b.left());
+        }
+        b.skip(4);
+    }
+    
+    // Use the min TTL of answers, for the CNAME chain.
+    ip = "";
+    int64_t min_ttl = -1;
+    for (int i = 0; rcode == 0 && i < nn_answers; i++) {
+        if ((err = skip_name(&b)) != srs_success) {
+            return srs_error_wrap(err, "answer");
+        }
+        if (!b.require(10)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "answer requires 10 only %d bytes", b.left());
+        }
+        
+        int type = (uint16_t)b.read_2bytes();
+        int klass = (uint16_t)b.read_2bytes();
+        int64_t v = (uint32_t)b.read_4bytes();
+        int nn_rdata = (uint16_t)b.read_2bytes();
+        if (!b.require(nn_rdata)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "rdata requires %d only %d bytes", nn_rdata, b.left());
+        }
+        
+        if (min_ttl < 0 || v < min_ttl) {
+            min_ttl = v;
+        }
+        
+        if (type == 1 && klass == 1 && nn_rdata == 4 && ip.empty()) {
+            uint8_t* p = (uint8_t*)(b.data() + b.pos());
+            char addr[16];
+            snprintf(addr, sizeof(addr), "%d.%d.%d.%d", p[0], p[1], p[2], p[3]);
+            ip = addr;
+        }
+        b.skip(nn_rdata);
+    }
+    
+    if (!ip.empty()) {
+        ttl = min_ttl * SRS_UTIME_SECONDS;
+        return err;
+    }
+    
+    // For NXDOMAIN or NODATA, the TTL of negative cache is the min of SOA TTL and SOA.MINIMUM.
+    ttl = SRS_DNS_NEGATIVE_TTL;
+    for (int i = 0; i < nn_authorities; i++) {
+        if ((err = skip_name(&b)) != srs_success) {
+            return srs_error_wrap(err, "authority");
+        }
+        if (!b.require(10)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "authority requires 10 only %d bytes", b.left());
+        }
+        
+        int type = (uint16_t)b.read_2bytes();
+        b.skip(2);
+        int64_t v = (uint32_t)b.read_4bytes();
+        int nn_rdata = (uint16_t)b.read_2bytes();
+        if (!b.require(nn_rdata)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "rdata requires %d only %d bytes", nn_rdata, b.left());
+        }
+        
+        if (type != 6) {
+            b.skip(nn_rdata);
+            continue;
+        }
+        
+        // The MNAME, RNAME, SERIAL, REFRESH, RETRY, EXPIRE and MINIMUM.
+        SrsBuffer soa(b.data() + b.pos(), nn_rdata);
+        if ((err = skip_name(&soa)) != srs_success || (err = skip_name(&soa)) != srs_success) {
+            return srs_error_wrap(err, "soa");
+        }
+        if (!soa.require(20)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "soa requires 20 only %d bytes", soa.left());
+        }
+        soa.skip(16);
+        int64_t minimum = (uint32_t)soa.read_4bytes();
+        
+        ttl = srs_min(v, minimum) * SRS_UTIME_SECONDS;
+        break;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDnsResolver::skip_name(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if (!buf->require(1)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "name requires 1 byte");
+        }
+        
+        uint8_t v = (uint8_t)buf->read_1bytes();
+        if (v == 0) {
+            return err;
+        }
+        
+        // The compressed name, a pointer to previous name, @see RFC 1035 4.1.4
+        if ((v & 0xc0) == 0xc0) {
+            if (!buf->require(1)) {
+                return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "pointer requires 1 byte");
+            }
+            buf->skip(1);
+            return err;
+        }
+        
+        if (!buf->require(v)) {
+            return srs_error_new(ERROR_SYSTEM_DNS_RESOLVE, "label requires %d only %d bytes", v, buf->left());
+        }
+        buf->skip(v);
+    }
+    
+    return err;
+}
+
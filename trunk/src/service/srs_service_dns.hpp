@@ -0,0 +1,100 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013-2020 Winlin
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SRS_SERVICE_DNS_HPP
+#define SRS_SERVICE_DNS_HPP
+
+#include <srs_core.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class SrsBuffer;
+class SrsJsonObject;
+
+// The resolved result of host, cached until expired.
+struct SrsDnsEntry
+{
+public:
+    // The resolved ipv4 address, empty for negative cache.
+    std::string ip;
+    // The TTL of record, and the time to expire.
+    srs_utime_t ttl;
+    srs_utime_t expire;
+public:
+    SrsDnsEntry();
+    virtual ~SrsDnsEntry();
+};
+
+// The DNS resolver over UDP by ST, which never blocks the other coroutines like getaddrinfo.
+// It resolves the A record of host, and caches the result in the TTL of record,
+// and caches the failure like NXDOMAIN in the TTL of SOA, @see RFC 2308.
+// @remark The nameservers and search domains are loaded from /etc/resolv.conf, and the hosts from /etc/hosts.
+class SrsDnsResolver
+{
+private:
+    static SrsDnsResolver* _instance;
+private:
+    bool loaded;
+    // The nameservers in ipv4.
+    std::vector<std::string> servers;
+    // The search domains, for the host without dot.
+    std::vector<std::string> domains;
+    // The static hosts, key is host, value is ip.
+    std::map<std::string, std::string> hosts;
+    // The cached entries, key is host.
+    std::map<std::string, SrsDnsEntry*> cache;
+    // The id of query.
+    uint16_t qid;
+private:
+    // The statistic of resolver.
+    int64_t nn_hits;
+    int64_t nn_negative_hits;
+    int64_t nn_queries;
+    int64_t nn_failures;
+public:
+    SrsDnsResolver();
+    virtual ~SrsDnsResolver();
+public:
+    static SrsDnsResolver* instance();
+public:
+    // Resolve the host to ipv4, return the host itself if it's an address.
+    // @param timeout The timeout in srs_utime_t for each nameserver.
+    virtual srs_error_t resolve(std::string host, srs_utime_t timeout, std::string& ip);
+    // Dumps the statistic and cache entries.
+    virtual srs_error_t dumps(SrsJsonObject* obj);
+private:
+    virtual void load_system_config();
+    virtual srs_error_t do_resolve(std::string host, srs_utime_t timeout, std::string& ip, srs_utime_t& ttl);
+    virtual void update_cache(std::string host, std::string ip, srs_utime_t ttl);
+    // Query the host from nameserver.
+    // @param ttl The TTL of record, or negative cache if ip is empty.
+    virtual srs_error_t query(std::string server, std::string host, srs_utime_t timeout, std::string& ip, srs_utime_t& ttl);
+    virtual srs_error_t encode_query(uint16_t id, std::string host, std::string& data);
+    virtual srs_error_t decode_response(uint16_t id, char* data, int size, std::string& ip, srs_utime_t& ttl);
+    virtual srs_error_t skip_name(SrsBuffer* buf);
+};
+
+#endif
+
@@ -35,12 +35,160 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_service_http_conn.hpp>
 
+SrsHttpClientPool* SrsHttpClientPool::_instance = NULL;
+
+SrsHttpClientPool::SrsHttpClientPool()
+{
+    max_idle = SRS_HTTP_CLIENT_POOL_MAX_IDLE;
+    max_active = SRS_HTTP_CLIENT_POOL_MAX_ACTIVE;
+    idle_timeout = SRS_HTTP_CLIENT_POOL_IDLE_TIMEOUT;
+    nn_hits = nn_creates = 0;
+}
+
+SrsHttpClientPool::~SrsHttpClientPool()
+{
+    std::map<std::string, SrsHttpClientHost*>::iterator it;
+    for (it = hosts.begin(); it != hosts.end(); ++it) {
+        SrsHttpClientHost* h = it->second;
+        
+        std::vector<SrsTcpClient*>::iterator tit;
+        for (tit = h->idles.begin(); tit != h->idles.end(); ++tit) {
+            SrsTcpClient* transport = *tit;
+            srs_freep(transport);
+        }
+        
+        srs_cond_destroy(h->cond);
+        srs_freep(h);
+    }
+    hosts.clear();
+}
+
+SrsHttpClientPool* SrsHttpClientPool::instance()
+{
+    if (!_instance) {
+        _instance = new SrsHttpClientPool();
+    }
+    return _instance;
+}
+
+void SrsHttpClientPool::set_limits(int idle, int active, srs_utime_t tm)
+{
+    max_idle = idle;
+    max_active = active;
+    idle_timeout = tm;
+}
+
+srs_error_t SrsHttpClientPool::fetch(string host, int port, srs_utime_t tm, SrsTcpClient** ptransport, bool* preused)
+{
+    srs_error_t err = srs_success;
+    
+    SrsHttpClientHost* h = fetch_host(host, port);
+    
+    while (true) {
+        // Close the idle transports which are too old, the server may close them.
+        srs_utime_t now = srs_get_system_time();
+        while (!h->idles.empty() && now - h->idle_at.back() > idle_timeout) {
+            SrsTcpClient* transport = h->idles.back();
+            srs_freep(transport);
+            h->idles.pop_back();
+            h->idle_at.pop_back();
+        }
+        
+        // Reuse the most recently used transport.
+        if (!h->idles.empty()) {
+            *ptransport = h->idles.back();
+            *preused = true;
+            h->idles.pop_back();
+            h->idle_at.pop_back();
+            h->nn_active++;
+            nn_hits++;
+            return err;
+        }
+        
+        if (max_active <= 0 || h->nn_active < max_active) {
+            break;
+        }
+        
+        // Wait for other client to release transport.
+        if (srs_cond_timedwait(h->cond, tm) != 0) {
+            return srs_error_new(ERROR_HTTP_CLIENT_POOL_FULL, "pool full, active=%d, to=%dms", h->nn_active, srsu2msi(tm));
+        }
+    }
+    
+    // Count the connecting one as active, to limit the connections.
+    h->nn_active++;
+    nn_creates++;
+    
+    SrsTcpClient* transport = new SrsTcpClient(host, port, tm);
+    if ((err = transport->connect()) != srs_success) {
+        srs_freep(transport);
+        h->nn_active--;
+        srs_cond_signal(h->cond);
+        return srs_error_wrap(err, "connect %s:%d", host.c_str(), port);
+    }
+    
+    *ptransport = transport;
+    *preused = false;
+    
+    return err;
+}
+
+void SrsHttpClientPool::release(string host, int port, SrsTcpClient* transport, bool reusable)
+{
+    SrsHttpClientHost* h = fetch_host(host, port);
+    
+    h->nn_active--;
+    srs_cond_signal(h->cond);
+    
+    if (reusable && (int)h->idles.size() < max_idle) {
+        h->idles.push_back(transport);
+        h->idle_at.push_back(srs_get_system_time());
+        return;
+    }
+    
+    srs_freep(transport);
+}
+
+int64_t SrsHttpClientPool::hits()
+{
+    return nn_hits;
+}
+
+int64_t SrsHttpClientPool::creates()
+{
+    return nn_creates;
+}
+
+int SrsHttpClientPool::nb_idles(string host, int port)
+{
+    return (int)fetch_host(host, port)->idles.size();
+}
+
+SrsHttpClientHost* SrsHttpClientPool::fetch_host(string host, int port)
+{
+    string key = host + ":" + srs_int2str(port);
+    
+    std::map<std::string, SrsHttpClientHost*>::iterator it = hosts.find(key);
+    if (it != hosts.end()) {
+        return it->second;
+    }
+    
+    SrsHttpClientHost* h = new SrsHttpClientHost();
+    h->nn_active = 0;
+    h->cond = srs_cond_new();
+    hosts[key] = h;
+    
+    return h;
+}
+
 SrsHttpClient::SrsHttpClient()
 {
     transport = NULL;
     clk = new SrsWallClock();
     kbps = new SrsKbps(clk);
     parser = NULL;
+    pool = NULL;
+    reusable = false;
     recv_timeout = timeout = SRS_UTIME_NO_TIMEOUT;
     port = 0;
 }
@@ -93,7 +241,27 @@ SrsHttpClient* SrsHttpClient::set_header(string k, string v)
     return this;
 }
 
+void SrsHttpClient::set_pool(SrsHttpClientPool* p)
+{
+    pool = p;
+}
+
 srs_error_t SrsHttpClient::post(string path, string req, ISrsHttpMessage** ppmsg)
+{
+    return request("POST", path, req, ppmsg);
+}
+
+srs_error_t SrsHttpClient::get(string path, string req, ISrsHttpMessage** ppmsg)
+{
+    return request("GET", path, req, ppmsg);
+}
+
+srs_error_t SrsHttpClient::put(string path, string req, ISrsHttpMessage** ppmsg)
+{
+    return request("PUT", path, req, ppmsg);
+}
+
+srs_error_t SrsHttpClient::request(string method, string path, string req, ISrsHttpMessage** ppmsg)
 {
     *ppmsg = NULL;
     
@@ -102,60 +270,40 @@ srs_error_t SrsHttpClient::post(string path, string req, ISrsHttpMessage** ppmsg
     // always set the content length.
     headers["Content-Length"] = srs_int2str(req.length());
     
-    if ((err = connect()) != srs_success) {
-        return srs_error_wrap(err, "http: connect server");
-    }
-    
-    // send POST request to uri
-    // POST %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n\r\n%s
-    std::stringstream ss;
-    ss << "POST " << path << " " << "HTTP/1.1" << SRS_HTTP_CRLF;
-    for (map<string, string>::iterator it = headers.begin(); it != headers.end(); ++it) {
-        string key = it->first;
-        string value = it->second;
-        ss << key << ": " << value << SRS_HTTP_CRLF;
-    }
-    ss << SRS_HTTP_CRLF << req;
-    
-    std::string data = ss.str();
-    if ((err = transport->write((void*)data.c_str(), data.length(), NULL)) != srs_success) {
-        // Disconnect the transport when channel error, reconnect for next operation.
-        disconnect();
-        return srs_error_wrap(err, "http: write");
-    }
-    
-    ISrsHttpMessage* msg = NULL;
-    if ((err = parser->parse_message(transport, &msg)) != srs_success) {
-        return srs_error_wrap(err, "http: parse response");
-    }
-    srs_assert(msg);
-    
-    if (ppmsg) {
-        *ppmsg = msg;
-    } else {
-        srs_freep(msg);
+    while (true) {
+        bool reused = false;
+        if ((err = connect(&reused)) != srs_success) {
+            return srs_error_wrap(err, "http: connect server");
+        }
+        
+        if ((err = do_request(method, path, req, ppmsg)) == srs_success) {
+            break;
+        }
+        
+        // The idle transport from pool may be closed by server, retry with another one.
+        if (!reused) {
+            return err;
+        }
+        srs_freep(err);
+        
+        srs_freep(parser);
+        parser = new SrsHttpParser();
+        if ((err = parser->initialize(HTTP_RESPONSE, false)) != srs_success) {
+            return srs_error_wrap(err, "http: init parser");
+        }
     }
     
     return err;
 }
 
-srs_error_t SrsHttpClient::get(string path, string req, ISrsHttpMessage** ppmsg)
+srs_error_t SrsHttpClient::do_request(string method, string path, string req, ISrsHttpMessage** ppmsg)
 {
-    *ppmsg = NULL;
-    
     srs_error_t err = srs_success;
     
-    // always set the content length.
-    headers["Content-Length"] = srs_int2str(req.length());
-    
-    if ((err = connect()) != srs_success) {
-        return srs_error_wrap(err, "http: connect server");
-    }
-    
-    // send POST request to uri
-    // GET %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n\r\n%s
+    // send POST/GET request to uri
+    // POST %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n\r\n%s
     std::stringstream ss;
-    ss << "GET " << path << " " << "HTTP/1.1" << SRS_HTTP_CRLF;
+    ss << method << " " << path << " " << "HTTP/1.1" << SRS_HTTP_CRLF;
     for (map<string, string>::iterator it = headers.begin(); it != headers.end(); ++it) {
         string key = it->first;
         string value = it->second;
@@ -163,6 +311,9 @@ srs_error_t SrsHttpClient::get(string path, string req, ISrsHttpMessage** ppmsg)
     }
     ss << SRS_HTTP_CRLF << req;
     
+    // Not reusable until got a keep-alive response.
+    reusable = false;
+    
     std::string data = ss.str();
     if ((err = transport->write((void*)data.c_str(), data.length(), NULL)) != srs_success) {
         // Disconnect the transport when channel error, reconnect for next operation.
@@ -172,10 +323,14 @@ srs_error_t SrsHttpClient::get(string path, string req, ISrsHttpMessage** ppmsg)
     
     ISrsHttpMessage* msg = NULL;
     if ((err = parser->parse_message(transport, &msg)) != srs_success) {
+        // The transport is corrupt, reconnect for next operation.
+        disconnect();
         return srs_error_wrap(err, "http: parse response");
     }
     srs_assert(msg);
     
+    reusable = msg->is_keep_alive();
+    
     if (ppmsg) {
         *ppmsg = msg;
     } else {
@@ -188,6 +343,10 @@ srs_error_t SrsHttpClient::get(string path, string req, ISrsHttpMessage** ppmsg)
 void SrsHttpClient::set_recv_timeout(srs_utime_t tm)
 {
     recv_timeout = tm;
+    
+    if (transport) {
+        transport->set_recv_timeout(tm);
+    }
 }
 
 void SrsHttpClient::kbps_sample(const char* label, int64_t age)
@@ -207,23 +366,39 @@ void SrsHttpClient::kbps_sample(const char* label, int64_t age)
 void SrsHttpClient::disconnect()
 {
     kbps->set_io(NULL, NULL);
+    
+    if (pool && transport) {
+        pool->release(host, port, transport, reusable);
+        transport = NULL;
+    }
+    reusable = false;
+    
     srs_freep(transport);
 }
 
-srs_error_t SrsHttpClient::connect()
+srs_error_t SrsHttpClient::connect(bool* preused)
 {
     srs_error_t err = srs_success;
     
     // When transport connected, ignore.
     if (transport) {
+        *preused = true;
         return err;
     }
+    *preused = false;
     
-    transport = new SrsTcpClient(host, port, timeout);
-    if ((err = transport->connect()) != srs_success) {
-        disconnect();
-        return srs_error_wrap(err, "http: tcp connect %s:%d to=%dms, rto=%dms",
-            host.c_str(), port, srsu2msi(timeout), srsu2msi(recv_timeout));
+    if (pool) {
+        if ((err = pool->fetch(host, port, timeout, &transport, preused)) != srs_success) {
+            return srs_error_wrap(err, "http: pool fetch %s:%d to=%dms, rto=%dms",
+                host.c_str(), port, srsu2msi(timeout), srsu2msi(recv_timeout));
+        }
+    } else {
+        transport = new SrsTcpClient(host, port, timeout);
+        if ((err = transport->connect()) != srs_success) {
+            disconnect();
+            return srs_error_wrap(err, "http: tcp connect %s:%d to=%dms, rto=%dms",
+                host.c_str(), port, srsu2msi(timeout), srsu2msi(recv_timeout));
+        }
     }
     
     // Set the recv/send timeout in srs_utime_t.
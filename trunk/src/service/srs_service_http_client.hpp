@@ -28,6 +28,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include <srs_service_st.hpp>
 #include <srs_http_stack.hpp>
@@ -43,6 +44,66 @@ class SrsTcpClient;
 // The default timeout for http client.
 #define SRS_HTTP_CLIENT_TIMEOUT (30 * SRS_UTIME_SECONDS)
 
+// The max idle keep-alive connections to cache for each upstream host.
+#define SRS_HTTP_CLIENT_POOL_MAX_IDLE 8
+// The max connections in use for each upstream host, the client waits when exceed it.
+#define SRS_HTTP_CLIENT_POOL_MAX_ACTIVE 64
+// The idle connection older than this is closed, because most servers close it soon.
+#define SRS_HTTP_CLIENT_POOL_IDLE_TIMEOUT (10 * SRS_UTIME_SECONDS)
+
+// The idle or active connections of an upstream host.
+struct SrsHttpClientHost
+{
+    // The idle transports, the last one is the most recently used.
+    std::vector<SrsTcpClient*> idles;
+    // The time each idle transport is returned to pool.
+    std::vector<srs_utime_t> idle_at;
+    // The number of transports fetched and not released.
+    int nn_active;
+    // Signaled when a transport is released.
+    srs_cond_t cond;
+};
+
+// The keep-alive TCP connection pool for HTTP clients, keyed by host:port,
+// to avoid the TCP handshake for each HTTP callback or heartbeat.
+// @remark Only the transport with a keep-alive response is reusable, and the stale
+//      one closed by server is detected and renewed by client.
+class SrsHttpClientPool
+{
+private:
+    static SrsHttpClientPool* _instance;
+private:
+    std::map<std::string, SrsHttpClientHost*> hosts;
+    int max_idle;
+    int max_active;
+    srs_utime_t idle_timeout;
+private:
+    // Statistics.
+    int64_t nn_hits;
+    int64_t nn_creates;
+public:
+    SrsHttpClientPool();
+    virtual ~SrsHttpClientPool();
+public:
+    static SrsHttpClientPool* instance();
+public:
+    // Set the per-host limits of pool.
+    virtual void set_limits(int idle, int active, srs_utime_t tm);
+    // Fetch a connected transport to host:port, reuse the idle one if possible.
+    // @param preused Output whether the transport is reused from pool.
+    // @remark User must release the transport by release.
+    virtual srs_error_t fetch(std::string host, int port, srs_utime_t tm, SrsTcpClient** ptransport, bool* preused);
+    // Release the transport to pool, which is freed if not reusable.
+    virtual void release(std::string host, int port, SrsTcpClient* transport, bool reusable);
+public:
+    virtual int64_t hits();
+    virtual int64_t creates();
+    // Get the number of idle connections of host:port.
+    virtual int nb_idles(std::string host, int port);
+private:
+    virtual SrsHttpClientHost* fetch_host(std::string host, int port);
+};
+
 // The client to GET/POST/PUT/DELETE over HTTP.
 // @remark We will reuse the TCP transport until initialize or channel error,
 //      such as send/recv failed.
@@ -50,6 +111,8 @@ class SrsTcpClient;
 //      SrsHttpClient hc;
 //      hc.initialize("127.0.0.1", 80, 9000);
 //      hc.post("/api/v1/version", "Hello world!", NULL);
+// @remark Use set_pool to share the keep-alive transport with other clients, and
+//      the transport is returned to pool when initialize or destroy the client.
 class SrsHttpClient
 {
 private:
@@ -60,6 +123,11 @@ private:
     std::map<std::string, std::string> headers;
     SrsKbps* kbps;
     SrsWallClock* clk;
+    // The pool to fetch transport from, NULL to not use pool.
+    SrsHttpClientPool* pool;
+    // Whether the transport is reusable, that is, the last response is keep-alive
+    // and there is no channel error.
+    bool reusable;
 private:
     // The timeout in srs_utime_t.
     srs_utime_t timeout;
@@ -78,6 +146,9 @@ public:
     // Set HTTP request header in header[k]=v.
     // @return the HTTP client itself.
     virtual SrsHttpClient* set_header(std::string k, std::string v);
+    // Use the pool for transport, which should be set before initialize.
+    // @remark User must read the whole body of response, or the transport is corrupt.
+    virtual void set_pool(SrsHttpClientPool* p);
 public:
     // Post data to the uri.
     // @param the path to request on.
@@ -91,13 +162,23 @@ public:
     // @param ppmsg output the http message to read the response.
     // @remark user must free the ppmsg if not NULL.
     virtual srs_error_t get(std::string path, std::string req, ISrsHttpMessage** ppmsg);
+    // Put data to the uri, for example, to upload an object.
+    // @param the path to request on.
+    // @param req the data put to uri.
+    // @param ppmsg output the http message to read the response.
+    // @remark user must free the ppmsg if not NULL.
+    virtual srs_error_t put(std::string path, std::string req, ISrsHttpMessage** ppmsg);
 private:
-    virtual void set_recv_timeout(srs_utime_t tm);
+    // Send the request and parse the response, retry once for a stale transport from pool.
+    virtual srs_error_t request(std::string method, std::string path, std::string req, ISrsHttpMessage** ppmsg);
+    virtual srs_error_t do_request(std::string method, std::string path, std::string req, ISrsHttpMessage** ppmsg);
 public:
+    // Set the recv timeout, applied to the connected transport, for example, to read a live stream.
+    virtual void set_recv_timeout(srs_utime_t tm);
     virtual void kbps_sample(const char* label, int64_t age);
 private:
     virtual void disconnect();
-    virtual srs_error_t connect();
+    virtual srs_error_t connect(bool* preused);
 };
 
 #endif
@@ -48,13 +48,13 @@ SrsHttpParser::SrsHttpParser()
 SrsHttpParser::~SrsHttpParser()
 {
     srs_freep(buffer);
-    srs_freep(header);
 }
 
-srs_error_t SrsHttpParser::initialize(enum http_parser_type type, bool allow_jsonp)
+srs_error_t SrsHttpParser::initialize(enum http_parser_type t, bool allow_jsonp)
 {
     srs_error_t err = srs_success;
     
+    type = t;
     jsonp = allow_jsonp;
     
     memset(&settings, 0, sizeof(settings));
@@ -85,22 +85,34 @@ srs_error_t SrsHttpParser::parse_message(ISrsReader* reader, ISrsHttpMessage** p
     // The body that we have read from cache.
     p_body_start = p_header_tail = NULL;
     // We must reset the field name and value, because we may get a partial value in on_header_value.
-    field_name = field_value = "";
-    // The header of the request.
-    srs_freep(header);
-    header = new SrsHttpHeader();
+    // @remark Use clear to keep the capacity, so the fields of next request won't allocate again.
+    field_name.clear();
+    field_value.clear();
+    // Like the field, the url may also be partial, when it crosses the end of buffer.
+    url.clear();
+    
+    // Reset the parser for each message, because the body is read by the message rather than the parser,
+    // so the parser stays in the body of previous message, for example, the keep-alive response with
+    // content-length, and parses the next message as that body.
+    http_parser_init(&parser, type);
+    parser.data = (void*)this;
+
+    // Create the msg first, then parse the fields to its header directly, rather than to a temporary header which
+    // should be copied to the msg again.
+    SrsHttpMessage* msg = new SrsHttpMessage(reader, buffer);
+    header = msg->header();
     
     // do parse
-    if ((err = parse_message_imp(reader)) != srs_success) {
+    err = parse_message_imp(reader);
+    header = NULL;
+    if (err != srs_success) {
+        srs_freep(msg);
         return srs_error_wrap(err, "parse message");
     }
-    
-    // create msg
-    SrsHttpMessage* msg = new SrsHttpMessage(reader, buffer);
 
     // Initialize the basic information.
     msg->set_basic(hp_header.method, hp_header.status_code, hp_header.content_length);
-    msg->set_header(header, http_should_keep_alive(&hp_header));
+    msg->set_header(msg->header(), http_should_keep_alive(&hp_header));
     if ((err = msg->set_url(url, jsonp)) != srs_success) {
         srs_freep(msg);
         return srs_error_wrap(err, "set url=%s, jsonp=%d", url.c_str(), jsonp);
@@ -112,6 +124,21 @@ srs_error_t SrsHttpParser::parse_message(ISrsReader* reader, ISrsHttpMessage** p
     return err;
 }
 
+bool SrsHttpParser::pipelined()
+{
+    char* p = buffer->bytes();
+    char* end = p + buffer->size();
+    
+    // The header of message ends with CRLFCRLF.
+    for (; p + 3 < end; p++) {
+        if (p[0] == SRS_HTTP_CR && p[1] == SRS_HTTP_LF && p[2] == SRS_HTTP_CR && p[3] == SRS_HTTP_LF) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 srs_error_t SrsHttpParser::parse_message_imp(ISrsReader* reader)
 {
     srs_error_t err = srs_success;
@@ -121,8 +148,15 @@ srs_error_t SrsHttpParser::parse_message_imp(ISrsReader* reader)
             ssize_t consumed = http_parser_execute(&parser, &settings, buffer->bytes(), buffer->size());
 
             // The error is set in http_errno.
-            enum http_errno code;
-	        if ((code = HTTP_PARSER_ERRNO(&parser)) != HPE_OK) {
+            enum http_errno code = HTTP_PARSER_ERRNO(&parser);
+            
+            // Resume the parser paused at the end of message, for the next pipelined message.
+            if (code == HPE_PAUSED) {
+                http_parser_pause(&parser, 0);
+                code = HPE_OK;
+            }
+            
+	        if (code != HPE_OK) {
 	            return srs_error_new(ERROR_HTTP_PARSE_HEADER, "parse %dB, nparsed=%d, err=%d/%s %s",
 	                buffer->size(), consumed, code, http_errno_name(code), http_errno_description(code));
 	        }
@@ -204,6 +238,9 @@ int SrsHttpParser::on_message_complete(http_parser* parser)
     // save the parser when body parse completed.
     obj->state = SrsHttpParseStateMessageComplete;
     
+    // Stop at the end of message, so the pipelined message is left in buffer for next parse.
+    http_parser_pause(parser, 1);
+    
     srs_info("***MESSAGE COMPLETE***\n");
     
     return 0;
@@ -215,7 +252,7 @@ int SrsHttpParser::on_url(http_parser* parser, const char* at, size_t length)
     srs_assert(obj);
     
     if (length > 0) {
-        obj->url = string(at, (int)length);
+        obj->url.append(at, length);
     }
 
     // When header parsed, we must save the position of start for body,
@@ -235,7 +272,8 @@ int SrsHttpParser::on_header_field(http_parser* parser, const char* at, size_t l
 
     if (!obj->field_value.empty()) {
         obj->header->set(obj->field_name, obj->field_value);
-        obj->field_name = obj->field_value = "";
+        obj->field_name.clear();
+        obj->field_value.clear();
     }
     
     if (length > 0) {
@@ -323,7 +361,10 @@ void SrsHttpMessage::set_basic(uint8_t method, uint16_t status, int64_t content_
 
 void SrsHttpMessage::set_header(SrsHttpHeader* header, bool keep_alive)
 {
-    _header = *header;
+    // The parser fills our header in place, so there is nothing to copy.
+    if (header != &_header) {
+        _header = *header;
+    }
     _keep_alive = keep_alive;
 
     // whether chunked.
@@ -675,6 +716,7 @@ ISrsHttpHeaderFilter::~ISrsHttpHeaderFilter()
 SrsHttpResponseWriter::SrsHttpResponseWriter(ISrsProtocolReadWriter* io)
 {
     skt = io;
+    sf = dynamic_cast<ISrsSendfileWriter*>(io);
     hdr = new SrsHttpHeader();
     header_wrote = false;
     status = SRS_CONSTS_HTTP_OK;
@@ -780,6 +822,41 @@ srs_error_t SrsHttpResponseWriter::write(char* data, int size)
     return err;
 }
 
+bool SrsHttpResponseWriter::sendfile_enabled()
+{
+    // Only for response with content length, the chunked response must copy the body.
+    return sf && header_wrote && content_length != -1;
+}
+
+srs_error_t SrsHttpResponseWriter::sendfile(int fd, int64_t offset, int size)
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(sendfile_enabled());
+    
+    // whatever header is wrote, we should try to send header.
+    if ((err = send_header(NULL, 0)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+    
+    // check the bytes send and content length.
+    written += size;
+    if (written > content_length) {
+        return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%d, max=%d", (int)written, (int)content_length);
+    }
+    
+    if (size <= 0) {
+        return err;
+    }
+    
+    off_t pos = (off_t)offset;
+    if ((err = sf->sendfile(fd, &pos, size, NULL)) != srs_success) {
+        return srs_error_wrap(err, "sendfile");
+    }
+    
+    return err;
+}
+
 srs_error_t SrsHttpResponseWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
@@ -872,6 +949,11 @@ void SrsHttpResponseWriter::write_header(int code)
     
     // parse the content length from header.
     content_length = hdr->content_length();
+    
+    // The 1xx, 204 and 304 response has no body, so never use chunked encoding, see RFC7230 section 3.3.
+    if (content_length == -1 && !srs_go_http_body_allowd(code)) {
+        content_length = 0;
+    }
 }
 
 srs_error_t SrsHttpResponseWriter::send_header(char* data, int size)
@@ -906,8 +988,10 @@ srs_error_t SrsHttpResponseWriter::send_header(char* data, int size)
         hdr->set("Transfer-Encoding", "chunked");
     }
     
-    // keep alive to make vlc happy.
-    hdr->set("Connection", "Keep-Alive");
+    // keep alive to make vlc happy, except the upgrade.
+    if (hdr->get("Connection").empty()) {
+        hdr->set("Connection", "Keep-Alive");
+    }
 
     // Filter the header before writing it.
     if (hf && ((err = hf->filter(hdr)) != srs_success)) {
@@ -931,6 +1015,8 @@ SrsHttpResponseReader::SrsHttpResponseReader(SrsHttpMessage* msg, ISrsReader* re
     is_eof = false;
     nb_total_read = 0;
     nb_left_chunk = 0;
+    nb_chunk = 0;
+    chunk_end = false;
     buffer = body;
 }
 
@@ -947,13 +1033,36 @@ srs_error_t SrsHttpResponseReader::read(void* data, size_t nb_data, ssize_t* nb_
 {
     srs_error_t err = srs_success;
     
+    char* p = NULL;
+    ssize_t nn = 0;
+    if ((err = read_slice(nb_data, &p, &nn)) != srs_success) {
+        return err;
+    }
+    
+    if (nn > 0) {
+        memcpy(data, p, nn);
+    }
+    if (nb_read) {
+        *nb_read = nn;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsHttpResponseReader::read_slice(size_t nb_data, char** pdata, ssize_t* nb_read)
+{
+    srs_error_t err = srs_success;
+    
+    *pdata = NULL;
+    *nb_read = 0;
+    
     if (is_eof) {
         return srs_error_new(ERROR_HTTP_RESPONSE_EOF, "EOF");
     }
     
     // chunked encoding.
     if (owner->is_chunked()) {
-        return read_chunked(data, nb_data, nb_read);
+        return read_chunked(nb_data, pdata, nb_read);
     }
     
     // read by specified content-length
@@ -966,13 +1075,13 @@ srs_error_t SrsHttpResponseReader::read(void* data, size_t nb_data, ssize_t* nb_
         
         // change the max to read.
         nb_data = srs_min(nb_data, max);
-        return read_specified(data, nb_data, nb_read);
+        return read_specified(nb_data, pdata, nb_read);
     }
     
     // infinite chunked mode, directly read.
     if (owner->is_infinite_chunked()) {
         srs_assert(!owner->is_chunked() && owner->content_length() == -1);
-        return read_specified(data, nb_data, nb_read);
+        return read_specified(nb_data, pdata, nb_read);
     }
     
     // infinite chunked mode, but user not set it,
@@ -982,10 +1091,19 @@ srs_error_t SrsHttpResponseReader::read(void* data, size_t nb_data, ssize_t* nb_
     return err;
 }
 
-srs_error_t SrsHttpResponseReader::read_chunked(void* data, size_t nb_data, ssize_t* nb_read)
+srs_error_t SrsHttpResponseReader::read_chunked(size_t nb_data, char** pdata, ssize_t* nb_read)
 {
     srs_error_t err = srs_success;
     
+    // the CRLF of last chunk payload end.
+    if (chunk_end) {
+        if ((err = buffer->grow(skt, 2)) != srs_success) {
+            return srs_error_wrap(err, "grow buffer");
+        }
+        buffer->read_slice(2);
+        chunk_end = false;
+    }
+    
     // when no bytes left in chunk,
     // parse the chunk length first.
     if (nb_left_chunk <= 0) {
@@ -1040,41 +1158,33 @@ srs_error_t SrsHttpResponseReader::read_chunked(void* data, size_t nb_data, ssiz
     if (nb_chunk <= 0) {
         // for the last chunk, eof.
         is_eof = true;
-        *nb_read = 0;
     } else {
         // for not the last chunk, there must always exists bytes.
         // left bytes in chunk, read some.
         srs_assert(nb_left_chunk);
         
         size_t nb_bytes = srs_min(nb_left_chunk, nb_data);
-        err = read_specified(data, nb_bytes, (ssize_t*)&nb_bytes);
-        
-        // the nb_bytes used for output already read size of bytes.
-        if (nb_read) {
-            *nb_read = nb_bytes;
-        }
-        nb_left_chunk -= nb_bytes;
-
-        if (err != srs_success) {
+        if ((err = read_specified(nb_bytes, pdata, nb_read)) != srs_success) {
             return srs_error_wrap(err, "read specified");
         }
-
+        nb_left_chunk -= (size_t)*nb_read;
+        
         // If still left bytes in chunk, ignore and read in future.
-        if (nb_left_chunk > 0) {
-            return err;
-        }
+        chunk_end = (nb_left_chunk == 0);
+        return err;
     }
     
-    // for both the last or not, the CRLF of chunk payload end.
+    // for the last chunk, the CRLF of chunk payload end.
     if ((err = buffer->grow(skt, 2)) != srs_success) {
         return srs_error_wrap(err, "grow buffer");
     }
     buffer->read_slice(2);
+    chunk_end = false;
     
     return err;
 }
 
-srs_error_t SrsHttpResponseReader::read_specified(void* data, size_t nb_data, ssize_t* nb_read)
+srs_error_t SrsHttpResponseReader::read_specified(size_t nb_data, char** pdata, ssize_t* nb_read)
 {
     srs_error_t err = srs_success;
     
@@ -1087,13 +1197,10 @@ srs_error_t SrsHttpResponseReader::read_specified(void* data, size_t nb_data, ss
     
     size_t nb_bytes = srs_min(nb_data, (size_t)buffer->size());
     
-    // read data to buffer.
+    // slice the data in buffer.
     srs_assert(nb_bytes);
-    char* p = buffer->read_slice(nb_bytes);
-    memcpy(data, p, nb_bytes);
-    if (nb_read) {
-        *nb_read = nb_bytes;
-    }
+    *pdata = buffer->read_slice(nb_bytes);
+    *nb_read = nb_bytes;
     
     // increase the total read to determine whether EOF.
     nb_total_read += nb_bytes;
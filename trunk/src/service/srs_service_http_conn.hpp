@@ -36,6 +36,7 @@ class SrsRequest;
 class ISrsReader;
 class SrsHttpResponseReader;
 class ISrsProtocolReadWriter;
+class ISrsSendfileWriter;
 
 // A wrapper for http-parser,
 // provides HTTP message originted service.
@@ -44,6 +45,8 @@ class SrsHttpParser
 private:
     http_parser_settings settings;
     http_parser parser;
+    // The type of parser, to reset it for each message.
+    enum http_parser_type type;
     // The global parse buffer.
     SrsFastStream* buffer;
     // Whether allow jsonp parse.
@@ -54,6 +57,7 @@ private:
     SrsHttpParseState state;
     http_parser hp_header;
     std::string url;
+    // The header of the message in parsing, which is not owned by the parser.
     SrsHttpHeader* header;
 private:
     // Point to the start of body.
@@ -74,6 +78,9 @@ public:
     // @remark, if success, *ppmsg always NOT-NULL, *ppmsg always is_complete().
     // @remark user must free the ppmsg if not NULL.
     virtual srs_error_t parse_message(ISrsReader* reader, ISrsHttpMessage** ppmsg);
+    // Whether the header of next message is already in buffer, that is, the requests are pipelined.
+    // @remark The body of current message should be read before, or it may be regarded as header.
+    virtual bool pipelined();
 private:
     // parse the HTTP message to member field: msg.
     virtual srs_error_t parse_message_imp(ISrsReader* reader);
@@ -212,10 +219,12 @@ public:
 };
 
 // Response writer use st socket
-class SrsHttpResponseWriter : public ISrsHttpResponseWriter
+class SrsHttpResponseWriter : public ISrsHttpResponseWriter, public ISrsHttpSendfileWriter
 {
 private:
     ISrsProtocolReadWriter* skt;
+    // The sendfile of skt, NULL if not supported.
+    ISrsSendfileWriter* sf;
     SrsHttpHeader* hdr;
     // Before writing header, there is a chance to filter it,
     // such as remove some headers or inject new.
@@ -250,6 +259,10 @@ public:
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
     virtual void write_header(int code);
     virtual srs_error_t send_header(char* data, int size);
+// Interface ISrsHttpSendfileWriter
+public:
+    virtual bool sendfile_enabled();
+    virtual srs_error_t sendfile(int fd, int64_t offset, int size);
 };
 
 // Response reader use st socket.
@@ -264,6 +277,9 @@ private:
     size_t nb_left_chunk;
     // The number of bytes of current chunk.
     size_t nb_chunk;
+    // Whether the CRLF of chunk payload end is left, which is consumed by the next read,
+    // because the buffer maybe moved when grow, while the slice of last read must be valid.
+    bool chunk_end;
     // Already read total bytes.
     int64_t nb_total_read;
 public:
@@ -275,9 +291,16 @@ public:
 public:
     virtual bool eof();
     virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+public:
+    // Read the body in place from the buffer of connection, without copy.
+    // @param size The max bytes to read.
+    // @param pdata The bytes in the buffer of connection, which is valid until the next read.
+    // @param nread The bytes read, which is less than size when the buffer or chunk is not enough,
+    //      and 0 when EOF.
+    virtual srs_error_t read_slice(size_t size, char** pdata, ssize_t* nread);
 private:
-    virtual srs_error_t read_chunked(void* buf, size_t size, ssize_t* nread);
-    virtual srs_error_t read_specified(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t read_chunked(size_t size, char** pdata, ssize_t* nread);
+    virtual srs_error_t read_specified(size_t size, char** pdata, ssize_t* nread);
 };
 
 #endif
@@ -73,6 +73,12 @@ int SrsThreadContext::set_id(int v)
     return ov;
 }
 
+int SrsThreadContext::find_id(srs_thread_t thread)
+{
+    std::map<srs_thread_t, int>::iterator it = cache.find(thread);
+    return (it != cache.end())? it->second : 0;
+}
+
 void SrsThreadContext::clear_cid()
 {
     srs_thread_t self = srs_thread_self();
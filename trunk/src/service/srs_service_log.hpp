@@ -44,6 +44,8 @@ public:
     virtual int generate_id();
     virtual int get_id();
     virtual int set_id(int v);
+    // Find the id of specified thread, 0 if not found.
+    virtual int find_id(srs_thread_t thread);
 public:
     virtual void clear_cid();
 };
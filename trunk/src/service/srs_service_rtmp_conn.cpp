@@ -229,8 +229,31 @@ srs_error_t SrsBasicRtmpClient::send_and_free_message(SrsSharedPtrMessage* msg)
     return client->send_and_free_message(msg, stream_id);
 }
 
+srs_error_t SrsBasicRtmpClient::send_and_free_packet(SrsPacket* packet, int stream_id)
+{
+    return client->send_and_free_packet(packet, stream_id);
+}
+
+srs_error_t SrsBasicRtmpClient::set_window_ack_size(int ack_size)
+{
+    srs_error_t err = srs_success;
+    
+    SrsSetWindowAckSizePacket* pkt = new SrsSetWindowAckSizePacket();
+    pkt->ackowledgement_window_size = ack_size;
+    if ((err = client->send_and_free_packet(pkt, 0)) != srs_success) {
+        return srs_error_wrap(err, "send ack size");
+    }
+    
+    return err;
+}
+
 void SrsBasicRtmpClient::set_recv_timeout(srs_utime_t timeout)
 {
     transport->set_recv_timeout(timeout);
 }
 
+int64_t SrsBasicRtmpClient::get_send_bytes()
+{
+    return client->get_send_bytes();
+}
+
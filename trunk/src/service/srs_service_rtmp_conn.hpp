@@ -84,8 +84,13 @@ public:
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual srs_error_t send_and_free_messages(SrsSharedPtrMessage** msgs, int nb_msgs);
     virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg);
+    virtual srs_error_t send_and_free_packet(SrsPacket* packet, int stream_id);
+    // Request the server to ack every ack_size bytes received.
+    virtual srs_error_t set_window_ack_size(int ack_size);
 public:
     virtual void set_recv_timeout(srs_utime_t timeout);
+    // Get the total bytes sent over the transport, including the handshake.
+    virtual int64_t get_send_bytes();
 };
 
 #endif
@@ -27,6 +27,18 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <limits.h>
+#ifndef SRS_AUTO_OSX
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
+#endif
+#include <openssl/ssl.h>
+#include <openssl/err.h>
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -34,10 +46,48 @@ using namespace std;
 #include <srs_kernel_log.hpp>
 #include <srs_service_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_service_dns.hpp>
+#include <srs_kernel_recorder.hpp>
+#include <srs_kernel_file.hpp>
 
 // nginx also set to 512
 #define SERVER_LISTEN_BACKLOG 512
 
+// The max plaintext of a TLS record, to merge the iovs.
+#define SRS_TLS_RECORD_SIZE 16384
+
+// The size of keys of session tickets, the name, HMAC and AES keys.
+#define SRS_TLS_TICKET_KEYS_SIZE 80
+
+// The MSG_ZEROCOPY since linux 4.14, maybe not defined by old headers.
+#ifndef SRS_AUTO_OSX
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#endif
+
+// Get the description of last error of OpenSSL.
+string srs_tls_error()
+{
+    unsigned long code = ERR_peek_last_error();
+    if (!code) {
+        return "";
+    }
+    
+    char buf[256];
+    ERR_error_string_n(code, buf, sizeof(buf));
+    return buf;
+}
+
 #ifdef __linux__
 #include <sys/epoll.h>
 
@@ -54,6 +104,25 @@ bool srs_st_epoll_is_supported(void)
 }
 #endif
 
+// Whether use the io_uring event system.
+static bool _srs_st_io_uring = false;
+
+srs_error_t srs_st_set_io_uring(int entries, bool write)
+{
+    if (st_uring_set(entries, write? 1 : 0) == -1) {
+        return srs_error_new(ERROR_ST_SET_EPOLL, "st io_uring entries=%d, write=%d", entries, write);
+    }
+    
+    _srs_st_io_uring = true;
+    return srs_success;
+}
+
+// The clock of ST, which also updates the cache of monotonic time for each tick of scheduler.
+static st_utime_t srs_st_utime()
+{
+    return (st_utime_t)srs_update_monotonic_time();
+}
+
 srs_error_t srs_st_init()
 {
 #ifdef __linux__
@@ -64,12 +133,22 @@ srs_error_t srs_st_init()
     }
 #endif
     
+    // Use the io_uring if enabled, which falls back to epoll if not supported by kernel.
+    if (_srs_st_io_uring && st_set_eventsys(ST_EVENTSYS_IO_URING) == -1) {
+        return srs_error_new(ERROR_ST_SET_EPOLL, "st enable io_uring failed");
+    }
+    
     // Select the best event system available on the OS. In Linux this is
     // epoll(). On BSD it will be kqueue.
-    if (st_set_eventsys(ST_EVENTSYS_ALT) == -1) {
+    if (!_srs_st_io_uring && st_set_eventsys(ST_EVENTSYS_ALT) == -1) {
         return srs_error_new(ERROR_ST_SET_EPOLL, "st enable st failed, current is %s", st_get_eventsys_name());
     }
     
+    // Use the monotonic clock for the timers of ST, which never jump when NTP steps the wall clock.
+    if (st_set_utime_function(srs_st_utime) == -1) {
+        return srs_error_new(ERROR_ST_INITIALIZE, "st set utime function");
+    }
+    
     int r0 = 0;
     if((r0 = st_init()) != 0){
         return srs_error_new(ERROR_ST_INITIALIZE, "st initialize failed, r0=%d", r0);
@@ -137,12 +216,38 @@ srs_error_t srs_fd_keepalive(int fd)
 	return srs_success;
 }
 
+srs_error_t srs_fd_defer_accept(int fd, int seconds)
+{
+#ifdef TCP_DEFER_ACCEPT
+    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(int)) == -1) {
+        srs_warn("TCP_DEFER_ACCEPT failed for fd=%d", fd);
+    }
+#else
+    srs_warn("TCP_DEFER_ACCEPT is not supported by your OS");
+#endif
+
+	return srs_success;
+}
+
+srs_error_t srs_fd_fastopen(int fd, int qlen)
+{
+#ifdef TCP_FASTOPEN
+    if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(int)) == -1) {
+        srs_warn("TCP_FASTOPEN failed for fd=%d", fd);
+    }
+#else
+    srs_warn("TCP_FASTOPEN is not supported by your OS");
+#endif
+
+	return srs_success;
+}
+
 srs_thread_t srs_thread_self()
 {
     return (srs_thread_t)st_thread_self();
 }
 
-srs_error_t srs_tcp_connect(string server, int port, srs_utime_t tm, srs_netfd_t* pstfd)
+srs_error_t do_srs_connect(string server, int port, int type, srs_utime_t tm, srs_netfd_t* pstfd)
 {
     st_utime_t timeout = ST_UTIME_NO_TIMEOUT;
     if (tm != SRS_UTIME_NO_TIMEOUT) {
@@ -152,18 +257,26 @@ srs_error_t srs_tcp_connect(string server, int port, srs_utime_t tm, srs_netfd_t
     *pstfd = NULL;
     srs_netfd_t stfd = NULL;
 
+    // Resolve the host by ST, for the getaddrinfo blocks all coroutines.
+    string ip;
+    srs_error_t err = SrsDnsResolver::instance()->resolve(server, tm, ip);
+    if (err != srs_success) {
+        return srs_error_wrap(err, "connect to %s:%d", server.c_str(), port);
+    }
+    
     char sport[8];
     snprintf(sport, sizeof(sport), "%d", port);
     
     addrinfo hints;
     memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_socktype = type;
+    hints.ai_flags = AI_NUMERICHOST;
     
     addrinfo* r  = NULL;
     SrsAutoFree(addrinfo, r);
-    if(getaddrinfo(server.c_str(), sport, (const addrinfo*)&hints, &r)) {
-        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "get address info");
+    if(getaddrinfo(ip.c_str(), sport, (const addrinfo*)&hints, &r)) {
+        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "get address info of %s", ip.c_str());
     }
     
     int sock = socket(r->ai_family, r->ai_socktype, r->ai_protocol);
@@ -187,6 +300,16 @@ srs_error_t srs_tcp_connect(string server, int port, srs_utime_t tm, srs_netfd_t
     return srs_success;
 }
 
+srs_error_t srs_tcp_connect(string server, int port, srs_utime_t tm, srs_netfd_t* pstfd)
+{
+    return do_srs_connect(server, port, SOCK_STREAM, tm, pstfd);
+}
+
+srs_error_t srs_udp_connect(string server, int port, srs_utime_t tm, srs_netfd_t* pstfd)
+{
+    return do_srs_connect(server, port, SOCK_DGRAM, tm, pstfd);
+}
+
 srs_error_t do_srs_tcp_listen(int fd, addrinfo* r, srs_netfd_t* pfd)
 {
 	srs_error_t err = srs_success;
@@ -254,6 +377,55 @@ srs_error_t srs_tcp_listen(std::string ip, int port, srs_netfd_t* pfd)
         ::close(fd);
         return srs_error_wrap(err, "fd=%d", fd);
     }
+    
+    return err;
+}
+
+srs_error_t do_srs_unix_listen(int fd, string path, srs_netfd_t* pfd)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = srs_fd_closeexec(fd)) != srs_success) {
+        return srs_error_wrap(err, "set closeexec");
+    }
+    
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.length() >= sizeof(addr.sun_path)) {
+        return srs_error_new(ERROR_SOCKET_BIND, "path too long %d", (int)path.length());
+    }
+    memcpy(addr.sun_path, path.data(), path.length());
+    
+    ::unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+        return srs_error_new(ERROR_SOCKET_BIND, "bind %s", path.c_str());
+    }
+    
+    if (::listen(fd, SERVER_LISTEN_BACKLOG) == -1) {
+        return srs_error_new(ERROR_SOCKET_LISTEN, "listen");
+    }
+    
+    if ((*pfd = srs_netfd_open_socket(fd)) == NULL){
+        return srs_error_new(ERROR_ST_OPEN_SOCKET, "st open");
+    }
+    
+    return err;
+}
+
+srs_error_t srs_unix_listen(string path, srs_netfd_t* pfd)
+{
+    srs_error_t err = srs_success;
+    
+    int fd = 0;
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        return srs_error_new(ERROR_SOCKET_CREATE, "socket unix");
+    }
+    
+    if ((err = do_srs_unix_listen(fd, path, pfd)) != srs_success) {
+        ::close(fd);
+        return srs_error_wrap(err, "fd=%d", fd);
+    }
 
     return err;
 }
@@ -344,6 +516,11 @@ int srs_cond_signal(srs_cond_t cond)
     return st_cond_signal((st_cond_t)cond);
 }
 
+int srs_cond_broadcast(srs_cond_t cond)
+{
+    return st_cond_broadcast((st_cond_t)cond);
+}
+
 srs_mutex_t srs_mutex_new()
 {
     return (srs_mutex_t)st_mutex_new();
@@ -392,6 +569,67 @@ int srs_recvfrom(srs_netfd_t stfd, void *buf, int len, struct sockaddr *from, in
     return st_recvfrom((st_netfd_t)stfd, buf, len, from, fromlen, (st_utime_t)timeout);
 }
 
+int srs_sendto(srs_netfd_t stfd, void *buf, int len, const struct sockaddr *to, int tolen, srs_utime_t timeout)
+{
+    return st_sendto((st_netfd_t)stfd, buf, len, to, tolen, (st_utime_t)timeout);
+}
+
+#ifdef SRS_PERF_UDP_RECVMMSG
+int srs_recvmmsg(srs_netfd_t stfd, struct mmsghdr* msgvec, unsigned int vlen, srs_utime_t timeout)
+{
+    st_utime_t tm = (timeout == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : (st_utime_t)timeout;
+    int osfd = st_netfd_fileno((st_netfd_t)stfd);
+    
+    while (true) {
+        int n = ::recvmmsg(osfd, msgvec, vlen, MSG_DONTWAIT, NULL);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN) {
+            return -1;
+        }
+        
+        // Wait for the fd to be readable, switch to other coroutines.
+        if (st_netfd_poll((st_netfd_t)stfd, POLLIN, tm) < 0) {
+            return -1;
+        }
+    }
+    
+    return -1;
+}
+#endif
+
+#ifdef SRS_PERF_UDP_SENDMMSG
+int srs_sendmmsg(srs_netfd_t stfd, struct mmsghdr* msgvec, unsigned int vlen, srs_utime_t timeout)
+{
+    st_utime_t tm = (timeout == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : (st_utime_t)timeout;
+    int osfd = st_netfd_fileno((st_netfd_t)stfd);
+    
+    while (true) {
+        int n = ::sendmmsg(osfd, msgvec, vlen, MSG_DONTWAIT);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN) {
+            return -1;
+        }
+        
+        // Wait for the fd to be writable, switch to other coroutines.
+        if (st_netfd_poll((st_netfd_t)stfd, POLLOUT, tm) < 0) {
+            return -1;
+        }
+    }
+    
+    return -1;
+}
+#endif
+
 srs_netfd_t srs_accept(srs_netfd_t stfd, struct sockaddr *addr, int *addrlen, srs_utime_t timeout)
 {
     return (srs_netfd_t)st_accept((st_netfd_t)stfd, addr, addrlen, (st_utime_t)timeout);
@@ -407,15 +645,163 @@ bool srs_is_never_timeout(srs_utime_t tm)
     return tm == SRS_UTIME_NO_TIMEOUT;
 }
 
+SrsTlsContext::SrsTlsContext()
+{
+    ctx = NULL;
+    h2 = false;
+}
+
+SrsTlsContext::~SrsTlsContext()
+{
+    if (ctx) {
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+    }
+}
+
+srs_error_t SrsTlsContext::initialize(string cert, string key, bool ktls, bool tickets, string ticket_key, srs_utime_t timeout)
+{
+    srs_error_t err = srs_success;
+    
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    SSL_library_init();
+    SSL_load_error_strings();
+#endif
+    
+    if ((ctx = SSL_CTX_new(SSLv23_server_method())) == NULL) {
+        return srs_error_new(ERROR_TLS_CONTEXT, "new ctx, %s", srs_tls_error().c_str());
+    }
+    
+    SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION | SSL_OP_CIPHER_SERVER_PREFERENCE);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // Take the close without close_notify as EOF, like the plaintext socket.
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+    // Release the buffers of idle connections, for lots of players.
+    SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_RELEASE_BUFFERS);
+    
+    // Set the crypto of records to kernel, then writev and sendfile without copy to user space,
+    // and offload to NIC when supported.
+    if (ktls) {
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#else
+        srs_warn("tls: ignore ktls for %s", OPENSSL_VERSION_TEXT);
+#endif
+    }
+    
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) != 1) {
+        return srs_error_new(ERROR_TLS_CONTEXT, "certificate %s, %s", cert.c_str(), srs_tls_error().c_str());
+    }
+    if (SSL_CTX_use_PrivateKey_file(ctx, key.c_str(), SSL_FILETYPE_PEM) != 1) {
+        return srs_error_new(ERROR_TLS_CONTEXT, "key %s, %s", key.c_str(), srs_tls_error().c_str());
+    }
+    if (SSL_CTX_check_private_key(ctx) != 1) {
+        return srs_error_new(ERROR_TLS_CONTEXT, "check key %s, %s", key.c_str(), srs_tls_error().c_str());
+    }
+    
+    // Select the protocol of HTTPS, the RTMPS client never sends the ALPN.
+    SSL_CTX_set_alpn_select_cb(ctx, on_alpn_select, this);
+    
+    // Resume the sessions, to make the reconnecting cheap, without the key exchange.
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char*)"SRS", 3);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(ctx, (long)(timeout / SRS_UTIME_SECONDS));
+    
+    if (!tickets) {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    } else if (!ticket_key.empty()) {
+        SrsFileReader fr;
+        if ((err = fr.open(ticket_key)) != srs_success) {
+            return srs_error_wrap(err, "open ticket key %s", ticket_key.c_str());
+        }
+        
+        char keys[SRS_TLS_TICKET_KEYS_SIZE];
+        ssize_t nread = 0;
+        if ((err = fr.read(keys, sizeof(keys), &nread)) != srs_success) {
+            return srs_error_wrap(err, "read ticket key %s", ticket_key.c_str());
+        }
+        if (nread != sizeof(keys) || SSL_CTX_set_tlsext_ticket_keys(ctx, keys, sizeof(keys)) != 1) {
+            return srs_error_new(ERROR_TLS_CONTEXT, "ticket key %s, size=%d", ticket_key.c_str(), (int)nread);
+        }
+    }
+    
+    srs_trace("tls: %s, cert=%s, ktls=%d, tickets=%d, ticket_key=%s, timeout=%ds", OPENSSL_VERSION_TEXT, cert.c_str(),
+        ktls, tickets, ticket_key.c_str(), (int)(timeout / SRS_UTIME_SECONDS));
+    
+    return err;
+}
+
+SSL_CTX* SrsTlsContext::context()
+{
+    return ctx;
+}
+
+void SrsTlsContext::set_h2(bool v)
+{
+    h2 = v;
+}
+
+int SrsTlsContext::on_alpn_select(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+    const unsigned char* in, unsigned int inlen, void* arg)
+{
+    SrsTlsContext* tls = (SrsTlsContext*)arg;
+    
+    // Prefer h2 to http/1.1, whatever the order of client.
+    static const char* protocols[] = {"h2", "http/1.1"};
+    for (int i = tls->h2? 0 : 1; i < 2; i++) {
+        size_t size = strlen(protocols[i]);
+        
+        // The protocols of client is a list of length-prefixed strings.
+        for (const unsigned char* p = in; p < in + inlen; p += 1 + p[0]) {
+            if (p[0] == size && p + 1 + size <= in + inlen && memcmp(p + 1, protocols[i], size) == 0) {
+                *out = p + 1;
+                *outlen = (unsigned char)size;
+                return SSL_TLSEXT_ERR_OK;
+            }
+        }
+    }
+    
+    return SSL_TLSEXT_ERR_NOACK;
+}
+
+SrsZeroCopyStat* _srs_zerocopy = new SrsZeroCopyStat();
+
+SrsZeroCopyStat::SrsZeroCopyStat()
+{
+    zerocopy_bytes = 0;
+    copied_bytes = 0;
+    fallback_bytes = 0;
+}
+
+SrsZeroCopyStat::~SrsZeroCopyStat()
+{
+}
+
 SrsStSocket::SrsStSocket()
 {
     stfd = NULL;
     stm = rtm = SRS_UTIME_NO_TIMEOUT;
     rbytes = sbytes = 0;
+    ssl = NULL;
+    ktls_send = false;
+    tls_buf = NULL;
+    zerocopy = false;
+    zc_next = zc_done = 0;
+    stall_time = 0;
+    nn_stalls = 0;
 }
 
 SrsStSocket::~SrsStSocket()
 {
+    if (ssl) {
+        // Send the close_notify without waiting for peer, ignore any error.
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        ERR_clear_error();
+    }
+    
+    srs_freepa(tls_buf);
 }
 
 srs_error_t SrsStSocket::initialize(srs_netfd_t fd)
@@ -424,6 +810,53 @@ srs_error_t SrsStSocket::initialize(srs_netfd_t fd)
     return srs_success;
 }
 
+srs_error_t SrsStSocket::tls_accept(SrsTlsContext* tls)
+{
+    srs_error_t err = srs_success;
+    
+    srs_assert(!ssl);
+    if ((ssl = SSL_new(tls->context())) == NULL) {
+        return srs_error_new(ERROR_TLS_HANDSHAKE, "new ssl, %s", srs_tls_error().c_str());
+    }
+    
+    // The socket BIO over the fd, required by kTLS.
+    if (SSL_set_fd(ssl, srs_netfd_fileno(stfd)) != 1) {
+        return srs_error_new(ERROR_TLS_HANDSHAKE, "set fd, %s", srs_tls_error().c_str());
+    }
+    
+    while (true) {
+        ERR_clear_error();
+        
+        int r0 = SSL_accept(ssl);
+        if (r0 == 1) {
+            break;
+        }
+        
+        if (tls_wait(r0, rtm) < 0) {
+            if (errno == ETIME) {
+                return srs_error_new(ERROR_SOCKET_TIMEOUT, "handshake timeout %d ms", srsu2msi(rtm));
+            }
+            return srs_error_new(ERROR_TLS_HANDSHAKE, "handshake, %s", srs_tls_error().c_str());
+        }
+    }
+    
+    bool ktls_recv = false;
+#ifdef BIO_get_ktls_send
+    ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl));
+    ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+#endif
+    
+    srs_trace("tls: %s %s, resumed=%d, ktls send=%d, recv=%d", SSL_get_version(ssl), SSL_get_cipher_name(ssl),
+        SSL_session_reused(ssl), ktls_send, ktls_recv);
+    
+    return err;
+}
+
+bool SrsStSocket::is_tls()
+{
+    return ssl != NULL;
+}
+
 void SrsStSocket::set_recv_timeout(srs_utime_t tm)
 {
     rtm = tm;
@@ -454,12 +887,54 @@ int64_t SrsStSocket::get_send_bytes()
     return sbytes;
 }
 
+srs_utime_t SrsStSocket::get_stall_time()
+{
+    return stall_time;
+}
+
+int64_t SrsStSocket::get_stalls()
+{
+    return nn_stalls;
+}
+
+bool SrsStSocket::readable()
+{
+    // The decrypted bytes in TLS, which never make the socket readable.
+    if (ssl && SSL_pending(ssl) > 0) {
+        return true;
+    }
+    
+    pollfd pd;
+    pd.fd = srs_netfd_fileno(stfd);
+    pd.events = POLLIN;
+    pd.revents = 0;
+    
+    // The POLLHUP and POLLERR are also readable, for read to get the error.
+    if (!zerocopy) {
+        return ::poll(&pd, 1, 0) > 0;
+    }
+    
+    // The completions of MSG_ZEROCOPY in error queue also make POLLERR, while the read blocks, so we reap
+    // them and ignore the POLLERR, because the connection reset always makes POLLHUP.
+    srs_error_t err = reap_zerocopy();
+    if (err != srs_success) {
+        srs_freep(err);
+        return true;
+    }
+    
+    return ::poll(&pd, 1, 0) > 0 && (pd.revents & (POLLIN | POLLHUP)) != 0;
+}
+
 srs_error_t SrsStSocket::read(void* buf, size_t size, ssize_t* nread)
 {
     srs_error_t err = srs_success;
     
     ssize_t nb_read;
-    if (rtm == SRS_UTIME_NO_TIMEOUT) {
+    if (ssl) {
+        nb_read = tls_read(buf, size, rtm);
+    } else if (zerocopy) {
+        nb_read = zc_read(buf, size, rtm);
+    } else if (rtm == SRS_UTIME_NO_TIMEOUT) {
         nb_read = st_read((st_netfd_t)stfd, buf, size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_read = st_read((st_netfd_t)stfd, buf, size, rtm);
@@ -495,7 +970,11 @@ srs_error_t SrsStSocket::read_fully(void* buf, size_t size, ssize_t* nread)
     srs_error_t err = srs_success;
     
     ssize_t nb_read;
-    if (rtm == SRS_UTIME_NO_TIMEOUT) {
+    if (ssl) {
+        nb_read = tls_read_fully(buf, size, rtm);
+    } else if (zerocopy) {
+        nb_read = zc_read_fully(buf, size, rtm);
+    } else if (rtm == SRS_UTIME_NO_TIMEOUT) {
         nb_read = st_read_fully((st_netfd_t)stfd, buf, size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_read = st_read_fully((st_netfd_t)stfd, buf, size, rtm);
@@ -526,17 +1005,77 @@ srs_error_t SrsStSocket::read_fully(void* buf, size_t size, ssize_t* nread)
     return err;
 }
 
+srs_error_t SrsStSocket::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nb_read;
+    if (ssl || zerocopy) {
+        // Read to the first iov, the readv is allowed to read less.
+        int i = 0;
+        while (i < iov_size - 1 && !iov[i].iov_len) {
+            i++;
+        }
+        if (ssl) {
+            nb_read = tls_read(iov[i].iov_base, iov[i].iov_len, rtm);
+        } else {
+            nb_read = zc_read(iov[i].iov_base, iov[i].iov_len, rtm);
+        }
+    } else if (rtm == SRS_UTIME_NO_TIMEOUT) {
+        nb_read = st_readv((st_netfd_t)stfd, iov, iov_size, ST_UTIME_NO_TIMEOUT);
+    } else {
+        nb_read = st_readv((st_netfd_t)stfd, iov, iov_size, rtm);
+    }
+    
+    if (nread) {
+        *nread = nb_read;
+    }
+    
+    // On success, the readv() function returns the number of bytes read, like read(), which
+    // is 0 when the network connection is closed or end of file is reached.
+    // Otherwise, a value of -1 is returned and errno is set to indicate the error.
+    if (nb_read <= 0) {
+        // @see https://github.com/ossrs/srs/issues/200
+        if (nb_read < 0 && errno == ETIME) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "timeout %d ms", srsu2msi(rtm));
+        }
+        
+        if (nb_read == 0) {
+            errno = ECONNRESET;
+        }
+        
+        return srs_error_new(ERROR_SOCKET_READ, "readv");
+    }
+    
+    rbytes += nb_read;
+    
+    return err;
+}
+
 srs_error_t SrsStSocket::write(void* buf, size_t size, ssize_t* nwrite)
 {
     srs_error_t err = srs_success;
     
+    srs_utime_t starttime = _srs_recorder->begin();
+    srs_utime_t writetime = srs_update_monotonic_time();
+    
     ssize_t nb_write;
-    if (stm == SRS_UTIME_NO_TIMEOUT) {
+    if (ssl && !ktls_send) {
+        nb_write = tls_write(buf, size, stm);
+    } else if (zerocopy) {
+        iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = size;
+        nb_write = zc_sendmsg(&iov, 1, 0, stm);
+    } else if (stm == SRS_UTIME_NO_TIMEOUT) {
         nb_write = st_write((st_netfd_t)stfd, buf, size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_write = st_write((st_netfd_t)stfd, buf, size, stm);
     }
     
+    _srs_recorder->end(SrsRecorderEventSocketWrite, starttime, (int)nb_write);
+    on_write(writetime);
+    
     if (nwrite) {
         *nwrite = nb_write;
     }
@@ -561,13 +1100,23 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
 {
     srs_error_t err = srs_success;
     
+    srs_utime_t starttime = _srs_recorder->begin();
+    srs_utime_t writetime = srs_update_monotonic_time();
+    
     ssize_t nb_write;
-    if (stm == SRS_UTIME_NO_TIMEOUT) {
+    if (ssl && !ktls_send) {
+        nb_write = tls_writev(iov, iov_size, stm);
+    } else if (zerocopy) {
+        nb_write = zc_sendmsg(iov, iov_size, 0, stm);
+    } else if (stm == SRS_UTIME_NO_TIMEOUT) {
         nb_write = st_writev((st_netfd_t)stfd, iov, iov_size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_write = st_writev((st_netfd_t)stfd, iov, iov_size, stm);
     }
     
+    _srs_recorder->end(SrsRecorderEventSocketWrite, starttime, (int)nb_write);
+    on_write(writetime);
+    
     if (nwrite) {
         *nwrite = nb_write;
     }
@@ -588,6 +1137,465 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
     return err;
 }
 
+srs_error_t SrsStSocket::sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+    
+    st_utime_t timeout = (stm == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : stm;
+    
+    size_t left = count;
+    
+    // Read the file and write over TLS, when kernel does not encrypt the records.
+    while (ssl && !ktls_send && left > 0) {
+        if (!tls_buf) {
+            tls_buf = new char[SRS_TLS_RECORD_SIZE];
+        }
+        
+        ssize_t nb_read = ::pread(fd, tls_buf, srs_min(left, (size_t)SRS_TLS_RECORD_SIZE), *offset);
+        if (nb_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nb_read <= 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendfile read, left=%d", (int)left);
+        }
+        
+        ssize_t nb_write = tls_write(tls_buf, nb_read, stm);
+        if (nb_write < 0) {
+            if (errno == ETIME) {
+                return srs_error_new(ERROR_SOCKET_TIMEOUT, "sendfile timeout %d ms", srsu2msi(stm));
+            }
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendfile tls");
+        }
+        
+        *offset += nb_write;
+        left -= nb_write;
+        sbytes += nb_write;
+    }
+    
+    while (left > 0) {
+#ifndef SRS_AUTO_OSX
+        ssize_t nb_write = ::sendfile(srs_netfd_fileno(stfd), fd, offset, left);
+#else
+        // For OSX, the sendfile is different, so we read and write it.
+        char buf[4096];
+        ssize_t nb_write = ::pread(fd, buf, srs_min(left, sizeof(buf)), *offset);
+        if (nb_write > 0) {
+            nb_write = st_write((st_netfd_t)stfd, buf, nb_write, timeout);
+            if (nb_write > 0) {
+                *offset += nb_write;
+            }
+        }
+#endif
+        
+        if (nb_write < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        // The socket is non-blocking, wait for it to be writable.
+        if (nb_write < 0 && errno == EAGAIN) {
+            if (st_netfd_poll((st_netfd_t)stfd, POLLOUT, timeout) < 0) {
+                if (errno == ETIME) {
+                    return srs_error_new(ERROR_SOCKET_TIMEOUT, "sendfile timeout %d ms", srsu2msi(stm));
+                }
+                return srs_error_new(ERROR_SOCKET_WRITE, "sendfile poll");
+            }
+            continue;
+        }
+        
+        if (nb_write < 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendfile");
+        }
+        
+        // The file is shorter than count.
+        if (nb_write == 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendfile eof, left=%d", (int)left);
+        }
+        
+        left -= nb_write;
+        sbytes += nb_write;
+    }
+    
+    if (nwrite) {
+        *nwrite = count - left;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsStSocket::enable_zerocopy()
+{
+    srs_error_t err = srs_success;
+    
+    // The TLS in user space always copies the bytes to encrypt.
+    if (ssl) {
+        return srs_error_new(ERROR_SOCKET_ZEROCOPY, "zerocopy over tls");
+    }
+    
+#ifdef SRS_AUTO_OSX
+    return srs_error_new(ERROR_SOCKET_ZEROCOPY, "zerocopy not supported");
+#else
+    int fd = srs_netfd_fileno(stfd);
+    
+    int v = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v)) < 0) {
+        return srs_error_new(ERROR_SOCKET_ZEROCOPY, "setsockopt fd=%d SO_ZEROCOPY", fd);
+    }
+    
+    zerocopy = true;
+    
+    return err;
+#endif
+}
+
+srs_error_t SrsStSocket::writev_zerocopy(const iovec* iov, int iov_size, uint32_t* pid, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = _srs_recorder->begin();
+    srs_utime_t writetime = srs_update_monotonic_time();
+    
+#ifdef SRS_AUTO_OSX
+    ssize_t nb_write = zc_sendmsg(iov, iov_size, 0, stm);
+#else
+    ssize_t nb_write = zc_sendmsg(iov, iov_size, zerocopy? MSG_ZEROCOPY : 0, stm);
+#endif
+    
+    _srs_recorder->end(SrsRecorderEventSocketWrite, starttime, (int)nb_write);
+    on_write(writetime);
+    
+    // The sent bytes are pinned until the last sendmsg completed, even when error.
+    if (pid) {
+        *pid = zc_next;
+    }
+    
+    if (nwrite) {
+        *nwrite = nb_write;
+    }
+    
+    if (nb_write <= 0) {
+        if (nb_write < 0 && errno == ETIME) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "writev timeout %d ms", srsu2msi(stm));
+        }
+        
+        return srs_error_new(ERROR_SOCKET_WRITE, "writev zerocopy");
+    }
+    
+    sbytes += nb_write;
+    
+    return err;
+}
+
+srs_error_t SrsStSocket::reap_zerocopy()
+{
+    srs_error_t err = srs_success;
+    
+#ifndef SRS_AUTO_OSX
+    int fd = srs_netfd_fileno(stfd);
+    
+    while (zc_done != zc_next) {
+        char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+        
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            return srs_error_new(ERROR_SOCKET_ZEROCOPY, "recvmsg fd=%d errqueue", fd);
+        }
+        
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if ((cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR)
+                && (cm->cmsg_level != SOL_IPV6 || cm->cmsg_type != IPV6_RECVERR)) {
+                continue;
+            }
+            
+            sock_extended_err* ee = (sock_extended_err*)CMSG_DATA(cm);
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            
+            // The sends in [ee_info, ee_data] are completed, and they are in order for TCP.
+            bool copied = (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+            uint32_t end = ee->ee_data + 1;
+            while (zc_done != end && !zc_bytes.empty()) {
+                if (copied) {
+                    _srs_zerocopy->copied_bytes += zc_bytes.front();
+                } else {
+                    _srs_zerocopy->zerocopy_bytes += zc_bytes.front();
+                }
+                zc_bytes.pop_front();
+                zc_done++;
+            }
+        }
+    }
+#endif
+    
+    return err;
+}
+
+bool SrsStSocket::zerocopy_completed(uint32_t id)
+{
+    // The id maybe overflow, so we compare the distance.
+    return (int32_t)(zc_done - id) >= 0;
+}
+
+ssize_t SrsStSocket::zc_read(void* buf, size_t size, srs_utime_t tm)
+{
+    int fd = srs_netfd_fileno(stfd);
+    
+    while (true) {
+        ssize_t r0 = ::read(fd, buf, size);
+        if (r0 >= 0) {
+            return r0;
+        }
+        
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+        
+        if (zc_wait(POLLIN, tm) < 0) {
+            return -1;
+        }
+    }
+}
+
+ssize_t SrsStSocket::zc_read_fully(void* buf, size_t size, srs_utime_t tm)
+{
+    size_t nn = 0;
+    while (nn < size) {
+        ssize_t nb_read = zc_read((char*)buf + nn, size - nn, tm);
+        if (nb_read < 0) {
+            return -1;
+        }
+        if (nb_read == 0) {
+            break;
+        }
+        nn += nb_read;
+    }
+    
+    return (ssize_t)nn;
+}
+
+ssize_t SrsStSocket::zc_sendmsg(const iovec* iov, int iov_size, int flags, srs_utime_t tm)
+{
+    int fd = srs_netfd_fileno(stfd);
+    
+    // The iovs to send, updated for partial write.
+    std::vector<iovec> iovs(iov, iov + iov_size);
+    int index = 0;
+    
+    ssize_t nn = 0;
+    bool fallback = false;
+    while (true) {
+        while (index < iov_size && !iovs[index].iov_len) {
+            index++;
+        }
+        if (index >= iov_size) {
+            break;
+        }
+        
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iovs[index];
+        msg.msg_iovlen = srs_min(iov_size - index, IOV_MAX);
+        
+        ssize_t r0 = ::sendmsg(fd, &msg, flags);
+        if (r0 < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+#ifndef SRS_AUTO_OSX
+            // Fallback to copy when fail to pin the pages, for example, exceed the optmem_max.
+            if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+                flags &= ~MSG_ZEROCOPY;
+                fallback = true;
+                continue;
+            }
+#endif
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            if (zc_wait(POLLOUT, tm) < 0) {
+                return -1;
+            }
+            continue;
+        }
+        
+#ifndef SRS_AUTO_OSX
+        // Each sendmsg with MSG_ZEROCOPY is an id, to match the completions.
+        if (flags & MSG_ZEROCOPY) {
+            zc_bytes.push_back(r0);
+            zc_next++;
+        } else if (fallback) {
+            _srs_zerocopy->fallback_bytes += r0;
+        }
+#endif
+        nn += r0;
+        
+        // Skip the sent iovs, and move the partial one.
+        while (r0 > 0) {
+            size_t size = srs_min((size_t)r0, iovs[index].iov_len);
+            iovs[index].iov_base = (char*)iovs[index].iov_base + size;
+            iovs[index].iov_len -= size;
+            r0 -= size;
+            if (!iovs[index].iov_len) {
+                index++;
+            }
+        }
+    }
+    
+    return nn;
+}
+
+int SrsStSocket::zc_wait(int how, srs_utime_t tm)
+{
+    st_utime_t timeout = (tm == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : tm;
+    
+    srs_error_t err = reap_zerocopy();
+    if (err != srs_success) {
+        srs_warn("ignore reap err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    
+    return st_netfd_poll((st_netfd_t)stfd, how, timeout);
+}
+
+int SrsStSocket::tls_wait(int r0, srs_utime_t tm)
+{
+    st_utime_t timeout = (tm == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : tm;
+    
+    int r1 = SSL_get_error(ssl, r0);
+    if (r1 == SSL_ERROR_WANT_READ) {
+        return st_netfd_poll((st_netfd_t)stfd, POLLIN, timeout);
+    }
+    if (r1 == SSL_ERROR_WANT_WRITE) {
+        return st_netfd_poll((st_netfd_t)stfd, POLLOUT, timeout);
+    }
+    
+    // The close_notify, or EOF without close_notify for OpenSSL 1.x.
+    if (r1 == SSL_ERROR_ZERO_RETURN || (r1 == SSL_ERROR_SYSCALL && errno == 0)) {
+        errno = ECONNRESET;
+    } else if (r1 != SSL_ERROR_SYSCALL) {
+        errno = EPROTO;
+    }
+    
+    return -1;
+}
+
+ssize_t SrsStSocket::tls_read(void* buf, size_t size, srs_utime_t tm)
+{
+    while (true) {
+        ERR_clear_error();
+        
+        int r0 = SSL_read(ssl, buf, (int)srs_min(size, (size_t)INT_MAX));
+        if (r0 > 0) {
+            return r0;
+        }
+        
+        if (tls_wait(r0, tm) < 0) {
+            return (errno == ECONNRESET)? 0 : -1;
+        }
+    }
+}
+
+ssize_t SrsStSocket::tls_read_fully(void* buf, size_t size, srs_utime_t tm)
+{
+    size_t nn = 0;
+    while (nn < size) {
+        ssize_t nb_read = tls_read((char*)buf + nn, size - nn, tm);
+        if (nb_read < 0) {
+            return -1;
+        }
+        if (nb_read == 0) {
+            break;
+        }
+        nn += nb_read;
+    }
+    
+    return (ssize_t)nn;
+}
+
+ssize_t SrsStSocket::tls_write(const void* buf, size_t size, srs_utime_t tm)
+{
+    size_t nn = 0;
+    while (nn < size) {
+        ERR_clear_error();
+        
+        // Without partial write, the SSL_write returns when all bytes are written.
+        int r0 = SSL_write(ssl, (const char*)buf + nn, (int)srs_min(size - nn, (size_t)INT_MAX));
+        if (r0 > 0) {
+            nn += r0;
+            continue;
+        }
+        
+        if (tls_wait(r0, tm) < 0) {
+            return -1;
+        }
+    }
+    
+    return (ssize_t)nn;
+}
+
+ssize_t SrsStSocket::tls_writev(const iovec* iov, int iov_size, srs_utime_t tm)
+{
+    if (!tls_buf) {
+        tls_buf = new char[SRS_TLS_RECORD_SIZE];
+    }
+    
+    ssize_t nn = 0;
+    int nb_buf = 0;
+    for (int i = 0; i < iov_size; i++) {
+        const char* p = (const char*)iov[i].iov_base;
+        size_t size = iov[i].iov_len;
+        
+        // Flush the merged iovs when full.
+        if (nb_buf > 0 && nb_buf + size > SRS_TLS_RECORD_SIZE) {
+            if (tls_write(tls_buf, nb_buf, tm) < 0) {
+                return -1;
+            }
+            nn += nb_buf;
+            nb_buf = 0;
+        }
+        
+        // Write the large iov directly, without copy.
+        if (size >= SRS_TLS_RECORD_SIZE) {
+            if (tls_write(p, size, tm) < 0) {
+                return -1;
+            }
+            nn += size;
+            continue;
+        }
+        
+        memcpy(tls_buf + nb_buf, p, size);
+        nb_buf += (int)size;
+    }
+    
+    if (nb_buf > 0) {
+        if (tls_write(tls_buf, nb_buf, tm) < 0) {
+            return -1;
+        }
+        nn += nb_buf;
+    }
+    
+    return nn;
+}
+
+void SrsStSocket::on_write(srs_utime_t starttime)
+{
+    srs_utime_t elapsed = srs_update_monotonic_time() - starttime;
+    if (elapsed >= SRS_ST_STALL_THRESHOLD) {
+        stall_time += elapsed;
+        nn_stalls++;
+    }
+}
+
 SrsTcpClient::SrsTcpClient(string h, int p, srs_utime_t tm)
 {
     stfd = NULL;
@@ -673,6 +1681,11 @@ srs_error_t SrsTcpClient::read_fully(void* buf, size_t size, ssize_t* nread)
     return io->read_fully(buf, size, nread);
 }
 
+srs_error_t SrsTcpClient::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    return io->readv(iov, iov_size, nread);
+}
+
 srs_error_t SrsTcpClient::write(void* buf, size_t size, ssize_t* nwrite)
 {
     return io->write(buf, size, nwrite);
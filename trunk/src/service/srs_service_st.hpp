@@ -27,6 +27,7 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <deque>
 
 #include <srs_protocol_io.hpp>
 
@@ -36,9 +37,18 @@ typedef void* srs_thread_t;
 typedef void* srs_cond_t;
 typedef void* srs_mutex_t;
 
+// The types of OpenSSL, to avoid including the headers.
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_st SSL;
+
 // Initialize st, requires epoll.
 extern srs_error_t srs_st_init();
 
+// Use the io_uring event system of ST, with the number of SQ entries, and whether write by
+// io_uring, which falls back to epoll if not supported.
+// @remark Must be called before srs_st_init.
+extern srs_error_t srs_st_set_io_uring(int entries, bool write);
+
 // Close the netfd, and close the underlayer fd.
 // @remark when close, user must ensure io completed.
 extern void srs_close_stfd(srs_netfd_t& stfd);
@@ -55,6 +65,12 @@ extern srs_error_t srs_fd_reuseport(int fd);
 // Set the SO_KEEPALIVE of fd.
 extern srs_error_t srs_fd_keepalive(int fd);
 
+// Set the TCP_DEFER_ACCEPT in seconds of listen fd, ignore if not supported.
+extern srs_error_t srs_fd_defer_accept(int fd, int seconds);
+
+// Set the queue length of TCP_FASTOPEN of listen fd, ignore if not supported.
+extern srs_error_t srs_fd_fastopen(int fd, int qlen);
+
 // Get current coroutine/thread.
 extern srs_thread_t srs_thread_self();
 
@@ -62,9 +78,16 @@ extern srs_thread_t srs_thread_self();
 // @param tm The timeout in srs_utime_t.
 extern srs_error_t srs_tcp_connect(std::string server, int port, srs_utime_t tm, srs_netfd_t* pstfd);
 
+// For client, to open the UDP socket connected to server, to send and recv without address.
+// @param tm The timeout in srs_utime_t, to resolve the server.
+extern srs_error_t srs_udp_connect(std::string server, int port, srs_utime_t tm, srs_netfd_t* pstfd);
+
 // For server, listen at TCP endpoint.
 extern srs_error_t srs_tcp_listen(std::string ip, int port, srs_netfd_t* pfd);
 
+// For server, listen at unix domain socket, the file of path is removed if exists.
+extern srs_error_t srs_unix_listen(std::string path, srs_netfd_t* pfd);
+
 // For server, listen at UDP endpoint.
 extern srs_error_t srs_udp_listen(std::string ip, int port, srs_netfd_t* pfd);
 
@@ -74,6 +97,7 @@ extern int srs_cond_destroy(srs_cond_t cond);
 extern int srs_cond_wait(srs_cond_t cond);
 extern int srs_cond_timedwait(srs_cond_t cond, srs_utime_t timeout);
 extern int srs_cond_signal(srs_cond_t cond);
+extern int srs_cond_broadcast(srs_cond_t cond);
 
 extern srs_mutex_t srs_mutex_new();
 extern int srs_mutex_destroy(srs_mutex_t mutex);
@@ -88,6 +112,19 @@ extern srs_netfd_t srs_netfd_open_socket(int osfd);
 extern srs_netfd_t srs_netfd_open(int osfd);
 
 extern int srs_recvfrom(srs_netfd_t stfd, void *buf, int len, struct sockaddr *from, int *fromlen, srs_utime_t timeout);
+extern int srs_sendto(srs_netfd_t stfd, void *buf, int len, const struct sockaddr *to, int tolen, srs_utime_t timeout);
+#ifdef SRS_PERF_UDP_RECVMMSG
+struct mmsghdr;
+// Receive at most vlen udp packets, wait until at least one packet is ready.
+// @return The number of packets, or -1 for error.
+extern int srs_recvmmsg(srs_netfd_t stfd, struct mmsghdr* msgvec, unsigned int vlen, srs_utime_t timeout);
+#endif
+#ifdef SRS_PERF_UDP_SENDMMSG
+struct mmsghdr;
+// Send at most vlen udp packets, wait until the fd is writable if the buffer is full.
+// @return The number of packets sent, or -1 for error.
+extern int srs_sendmmsg(srs_netfd_t stfd, struct mmsghdr* msgvec, unsigned int vlen, srs_utime_t timeout);
+#endif
 
 extern srs_netfd_t srs_accept(srs_netfd_t stfd, struct sockaddr *addr, int *addrlen, srs_utime_t timeout);
 
@@ -115,9 +152,59 @@ public:
     }
 };
 
+// The TLS context of server, shared by all connections of RTMPS and HTTPS,
+// which holds the certificate, and the keys of session tickets to resume sessions.
+// @remark Create it before fork workers, so the random keys of tickets are shared by workers.
+class SrsTlsContext
+{
+private:
+    SSL_CTX* ctx;
+    // Whether select the h2 by ALPN, for HTTP/2 over TLS.
+    bool h2;
+public:
+    SrsTlsContext();
+    virtual ~SrsTlsContext();
+public:
+    // Initialize the context.
+    // @param cert The file of certificate chain in PEM.
+    // @param key The file of private key in PEM.
+    // @param ktls Whether enable the kernel TLS after handshake, fallback to user space if not supported.
+    // @param tickets Whether resume the sessions by tickets.
+    // @param ticket_key The file of 80 bytes keys of tickets, to share by servers, empty to generate it.
+    // @param timeout The lifetime of sessions.
+    virtual srs_error_t initialize(std::string cert, std::string key, bool ktls, bool tickets, std::string ticket_key, srs_utime_t timeout);
+    virtual SSL_CTX* context();
+    // Whether select the h2 for client by ALPN, or http/1.1 only.
+    virtual void set_h2(bool v);
+private:
+    static int on_alpn_select(SSL* ssl, const unsigned char** out, unsigned char* outlen,
+        const unsigned char* in, unsigned int inlen, void* arg);
+};
+
+// The statistics of MSG_ZEROCOPY of all sockets.
+class SrsZeroCopyStat
+{
+public:
+    // The bytes sent without copy.
+    int64_t zerocopy_bytes;
+    // The bytes copied by kernel, for example, over loopback or the NIC without scatter-gather.
+    int64_t copied_bytes;
+    // The bytes sent by copy, when the kernel fails to pin the pages, for example, ENOBUFS.
+    int64_t fallback_bytes;
+public:
+    SrsZeroCopyStat();
+    virtual ~SrsZeroCopyStat();
+};
+
+extern SrsZeroCopyStat* _srs_zerocopy;
+
+// The write which takes longer than it is a stall, that the coroutine waits for the socket to be
+// writable on EAGAIN, because the write to socket buffer never takes so long.
+#define SRS_ST_STALL_THRESHOLD (1 * SRS_UTIME_MILLISECONDS)
+
 // the socket provides TCP socket over st,
 // that is, the sync socket mechanism.
-class SrsStSocket : public ISrsProtocolReadWriter
+class SrsStSocket : public ISrsProtocolReadWriter, public ISrsSendfileWriter, public ISrsZeroCopyWriter
 {
 private:
     // The recv/send timeout in srs_utime_t.
@@ -129,12 +216,34 @@ private:
     int64_t sbytes;
     // The underlayer st fd.
     srs_netfd_t stfd;
+    // The TLS session, NULL for plaintext.
+    SSL* ssl;
+    // Whether the kernel encrypts the sent data, so we writev and sendfile to fd directly.
+    bool ktls_send;
+    // The buffer to merge iovs and read file, for TLS in user space.
+    char* tls_buf;
+    // Whether the MSG_ZEROCOPY is enabled, then we reap the completions before wait for the socket,
+    // because the completions in error queue always wake up the poll.
+    bool zerocopy;
+    // The id of next sendmsg with MSG_ZEROCOPY, and the id of first incomplete one.
+    uint32_t zc_next;
+    uint32_t zc_done;
+    // The bytes of each incomplete sendmsg, from zc_done to zc_next.
+    std::deque<ssize_t> zc_bytes;
+    // The total time and number of stalls to write, @see SRS_ST_STALL_THRESHOLD
+    srs_utime_t stall_time;
+    int64_t nn_stalls;
 public:
     SrsStSocket();
     virtual ~SrsStSocket();
 public:
     // Initialize the socket with stfd, user must manage it.
     virtual srs_error_t initialize(srs_netfd_t fd);
+    // Do TLS handshake as server, then all IO of socket is over TLS.
+    // @remark Use the recv and send timeout.
+    virtual srs_error_t tls_accept(SrsTlsContext* tls);
+    // Whether the IO is over TLS.
+    virtual bool is_tls();
 public:
     virtual void set_recv_timeout(srs_utime_t tm);
     virtual srs_utime_t get_recv_timeout();
@@ -142,13 +251,50 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+    // Get the total time and number of stalls to write, when the peer is slower than the stream.
+    virtual srs_utime_t get_stall_time();
+    virtual int64_t get_stalls();
+    // Whether there are bytes to read or the peer closed, never block.
+    // @remark It's used to check the peer in the coroutine which is sending, without a receiving coroutine.
+    virtual bool readable();
 public:
     // @param nread, the actual read bytes, ignore if NULL.
     virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
     virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread);
     // @param nwrite, the actual write bytes, ignore if NULL.
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsSendfileWriter
+public:
+    virtual srs_error_t sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite);
+// Interface ISrsZeroCopyWriter
+public:
+    virtual srs_error_t enable_zerocopy();
+    virtual srs_error_t writev_zerocopy(const iovec* iov, int iov_size, uint32_t* pid, ssize_t* nwrite);
+    virtual srs_error_t reap_zerocopy();
+    virtual bool zerocopy_completed(uint32_t id);
+private:
+    // Read and write over TLS, return the bytes like st_read and st_write,
+    // -1 and errno ETIME when timeout, 0 for read when peer closed.
+    virtual ssize_t tls_read(void* buf, size_t size, srs_utime_t tm);
+    virtual ssize_t tls_read_fully(void* buf, size_t size, srs_utime_t tm);
+    virtual ssize_t tls_write(const void* buf, size_t size, srs_utime_t tm);
+    // Merge the iovs to records of 16KB, to avoid a record for each small iov.
+    virtual ssize_t tls_writev(const iovec* iov, int iov_size, srs_utime_t tm);
+    // Wait for the socket when TLS wants to read or write.
+    virtual int tls_wait(int r0, srs_utime_t tm);
+private:
+    // Read and write when zerocopy is enabled, return the bytes like st_read and st_writev.
+    virtual ssize_t zc_read(void* buf, size_t size, srs_utime_t tm);
+    virtual ssize_t zc_read_fully(void* buf, size_t size, srs_utime_t tm);
+    // Send all iovs by sendmsg, with MSG_ZEROCOPY in flags or not.
+    virtual ssize_t zc_sendmsg(const iovec* iov, int iov_size, int flags, srs_utime_t tm);
+    // Reap the completions then wait for the socket, like st_netfd_poll.
+    virtual int zc_wait(int how, srs_utime_t tm);
+private:
+    // Account the stall if the write started at starttime takes too long.
+    virtual void on_write(srs_utime_t starttime);
 };
 
 // The client to connect to server over TCP.
@@ -194,6 +340,7 @@ public:
     virtual int64_t get_send_bytes();
     virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
     virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread);
+    virtual srs_error_t readv(const iovec *iov, int iov_size, ssize_t* nread);
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
 };
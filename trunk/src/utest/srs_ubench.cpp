@@ -0,0 +1,1274 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2020 Winlin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// The micro-benchmark of kernel codecs and muxers, to find the hot path and regression of the CPU and allocations.
+// Each benchmark runs the operation N times on a fixed corpus, and N grows until it takes the minimum duration,
+// like the benchmark of golang. For example:
+//      ./objs/srs_ubench
+//      ./objs/srs_ubench -t 3000 -f rtmp -o objs/ubench.json
+// @remark The corpus is generated in memory, and never depends on any file or network.
+
+#include <srs_core.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_io.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_amf0.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_io.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_rtmp_handshake.hpp>
+#include <srs_service_http_conn.hpp>
+#include <srs_http_stack.hpp>
+
+// kernel module.
+ISrsLog* _srs_log = new ISrsLog();
+ISrsThreadContext* _srs_context = new ISrsThreadContext();
+// app module.
+class SrsConfig;
+class SrsServer;
+SrsConfig* _srs_config = NULL;
+SrsServer* _srs_server = NULL;
+bool _srs_in_docker = false;
+
+// The number of allocations by operator new, which is replaced by the benchmark.
+static int64_t _srs_bench_allocs = 0;
+
+void* operator new(size_t size)
+{
+    _srs_bench_allocs++;
+    void* p = ::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    _srs_bench_allocs++;
+    void* p = ::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    ::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    ::free(p);
+}
+
+// The sized deallocation of C++14, also replaced to pair with the above.
+void operator delete(void* p, size_t) throw()
+{
+    ::free(p);
+}
+
+void operator delete[](void* p, size_t) throw()
+{
+    ::free(p);
+}
+
+// The monotonic clock in ns, for the resolution of us is not enough for fast operations.
+static int64_t srs_bench_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// The in-memory writer, which keeps the capacity when reset, to never allocate in the steady state.
+class SrsBenchWriter : public ISrsWriteSeeker
+{
+public:
+    std::vector<char> data;
+    off_t pos;
+public:
+    SrsBenchWriter() {
+        pos = 0;
+    }
+    virtual ~SrsBenchWriter() {
+    }
+public:
+    void reset() {
+        data.clear();
+        pos = 0;
+    }
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite) {
+        if ((size_t)pos + size > data.size()) {
+            data.resize(pos + size);
+        }
+        memcpy(&data[pos], buf, size);
+        pos += size;
+        if (nwrite) {
+            *nwrite = size;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* nwrite) {
+        ssize_t nn = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            write(iov[i].iov_base, iov[i].iov_len, NULL);
+            nn += iov[i].iov_len;
+        }
+        if (nwrite) {
+            *nwrite = nn;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t lseek(off_t offset, int whence, off_t* seeked) {
+        if (whence == SEEK_SET) {
+            pos = offset;
+        } else if (whence == SEEK_CUR) {
+            pos += offset;
+        } else if (whence == SEEK_END) {
+            pos = data.size() + offset;
+        }
+        if (seeked) {
+            *seeked = pos;
+        }
+        return srs_success;
+    }
+};
+
+// The in-memory socket, which discards the sent bytes, and reads the corpus in cycle, so the reader never EOF.
+class SrsBenchIO : public ISrsProtocolReadWriter
+{
+public:
+    // The sent bytes, only kept when capture is true.
+    std::string out;
+    bool capture;
+    // The corpus to read, in cycle.
+    std::string in;
+    size_t in_pos;
+    int64_t rbytes;
+    int64_t sbytes;
+    srs_utime_t rtm;
+    srs_utime_t stm;
+public:
+    SrsBenchIO() {
+        capture = false;
+        in_pos = 0;
+        rbytes = sbytes = 0;
+        rtm = stm = SRS_UTIME_NO_TIMEOUT;
+    }
+    virtual ~SrsBenchIO() {
+    }
+public:
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread) {
+        if (in.empty()) {
+            return srs_error_new(ERROR_SOCKET_READ, "no corpus");
+        }
+        size_t nn = srs_min(size, in.size() - in_pos);
+        memcpy(buf, in.data() + in_pos, nn);
+        in_pos = (in_pos + nn) % in.size();
+        rbytes += nn;
+        if (nread) {
+            *nread = nn;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t read_fully(void* buf, size_t size, ssize_t* nread) {
+        size_t nn = 0;
+        while (nn < size) {
+            ssize_t nb = 0;
+            srs_error_t err = read((char*)buf + nn, size - nn, &nb);
+            if (err != srs_success) {
+                return err;
+            }
+            nn += nb;
+        }
+        if (nread) {
+            *nread = nn;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t readv(const iovec* iov, int iovcnt, ssize_t* nread) {
+        ssize_t nn = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            ssize_t nb = 0;
+            srs_error_t err = read_fully(iov[i].iov_base, iov[i].iov_len, &nb);
+            if (err != srs_success) {
+                return err;
+            }
+            nn += nb;
+        }
+        if (nread) {
+            *nread = nn;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite) {
+        if (capture) {
+            out.append((char*)buf, size);
+        }
+        sbytes += size;
+        if (nwrite) {
+            *nwrite = size;
+        }
+        return srs_success;
+    }
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* nwrite) {
+        ssize_t nn = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            write(iov[i].iov_base, iov[i].iov_len, NULL);
+            nn += iov[i].iov_len;
+        }
+        if (nwrite) {
+            *nwrite = nn;
+        }
+        return srs_success;
+    }
+    virtual void set_recv_timeout(srs_utime_t tm) {
+        rtm = tm;
+    }
+    virtual srs_utime_t get_recv_timeout() {
+        return rtm;
+    }
+    virtual int64_t get_recv_bytes() {
+        return rbytes;
+    }
+    virtual void set_send_timeout(srs_utime_t tm) {
+        stm = tm;
+    }
+    virtual srs_utime_t get_send_timeout() {
+        return stm;
+    }
+    virtual int64_t get_send_bytes() {
+        return sbytes;
+    }
+};
+
+// The corpus of a GOP in FLV tags, with the sequence headers, about 1s of 720p at 25fps with AAC.
+class SrsBenchCorpus
+{
+public:
+    std::string avc_sh;
+    std::string aac_sh;
+    // The audio and video tags, interleaved in timestamp.
+    std::vector<std::string> tags;
+    std::vector<bool> videos;
+    std::vector<uint32_t> timestamps;
+public:
+    SrsBenchCorpus() {
+        uint8_t sh[] = {
+            0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        avc_sh.assign((char*)sh, sizeof(sh));
+        uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+        aac_sh.assign((char*)ash, sizeof(ash));
+
+        // The pseudo-random payload, fixed seed for stable result.
+        uint32_t seed = 0x20200314;
+        for (int i = 0; i < 25; i++) {
+            // An IDR of 40KB then P frames of 4KB.
+            int nb_nalu = (i == 0)? 40 * 1024 : 4 * 1024;
+            std::string v;
+            v.append(1, (char)((i == 0)? 0x17 : 0x27));
+            v.append(1, (char)0x01);
+            v.append(3, (char)0x00);
+            v.append(1, (char)((nb_nalu >> 24) & 0xff));
+            v.append(1, (char)((nb_nalu >> 16) & 0xff));
+            v.append(1, (char)((nb_nalu >> 8) & 0xff));
+            v.append(1, (char)(nb_nalu & 0xff));
+            v.append(1, (char)((i == 0)? 0x65 : 0x41));
+            for (int j = 1; j < nb_nalu; j++) {
+                seed = seed * 1103515245 + 12345;
+                v.append(1, (char)(seed >> 16));
+            }
+            tags.push_back(v); videos.push_back(true); timestamps.push_back(i * 40);
+
+            // Two AAC frames of 256B for each video frame, about 43 frames per second.
+            for (int k = 0; k < 2; k++) {
+                std::string a;
+                a.append(1, (char)0xaf);
+                a.append(1, (char)0x01);
+                for (int j = 0; j < 256; j++) {
+                    seed = seed * 1103515245 + 12345;
+                    a.append(1, (char)(seed >> 16));
+                }
+                tags.push_back(a); videos.push_back(false); timestamps.push_back(i * 40 + k * 23);
+            }
+        }
+    }
+public:
+    SrsSharedPtrMessage* create(const std::string& payload, bool video, uint32_t timestamp) {
+        SrsMessageHeader h;
+        if (video) {
+            h.initialize_video((int)payload.size(), timestamp, 1);
+        } else {
+            h.initialize_audio((int)payload.size(), timestamp, 1);
+        }
+
+        char* p = new char[payload.size()];
+        memcpy(p, payload.data(), payload.size());
+
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        srs_error_t err = msg->create(&h, p, (int)payload.size());
+        srs_assert(err == srs_success);
+        return msg;
+    }
+};
+
+// The case of benchmark, setup once and run N times.
+class SrsBenchCase
+{
+public:
+    SrsBenchCorpus* corpus;
+public:
+    SrsBenchCase() {
+        corpus = NULL;
+    }
+    virtual ~SrsBenchCase() {
+    }
+public:
+    virtual const char* name() = 0;
+    virtual srs_error_t setup() {
+        return srs_success;
+    }
+    // Prepare for the next n times, which is not timed, for the state consumed by each operation.
+    virtual srs_error_t prepare(int /*n*/) {
+        return srs_success;
+    }
+    // Run the operation for n times, without setup.
+    virtual srs_error_t run(int n) = 0;
+};
+
+// Encode the AVC frames in annexb to TS packets, by SrsTsContext::encode.
+class SrsBenchTsEncode : public SrsBenchCase
+{
+private:
+    SrsTsContext ctx;
+    SrsBenchWriter writer;
+    std::vector<SrsTsMessage*> msgs;
+public:
+    virtual ~SrsBenchTsEncode() {
+        for (int i = 0; i < (int)msgs.size(); i++) {
+            srs_freep(msgs[i]);
+        }
+    }
+    virtual const char* name() {
+        return "ts_encode_video";
+    }
+    virtual srs_error_t setup() {
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            if (!corpus->videos[i]) {
+                continue;
+            }
+
+            // Convert the NALU from ibmf to annexb.
+            const std::string& tag = corpus->tags[i];
+            SrsTsMessage* msg = new SrsTsMessage();
+            msg->sid = SrsTsPESStreamIdVideoCommon;
+            msg->dts = msg->pts = corpus->timestamps[i] * 90;
+            msg->write_pcr = (tag[0] == 0x17);
+            msg->payload->append("\x00\x00\x00\x01\x09\xf0", 6);
+            msg->payload->append("\x00\x00\x00\x01", 4);
+            msg->payload->append(tag.data() + 9, (int)tag.size() - 9);
+            msgs.push_back(msg);
+        }
+        return srs_success;
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            if ((i % msgs.size()) == 0) {
+                writer.reset();
+            }
+            SrsTsMessage* msg = msgs[i % msgs.size()];
+            if ((err = ctx.encode(&writer, msg, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC)) != srs_success) {
+                return srs_error_wrap(err, "encode");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Packetize a PES of 16KB to TS packets, by SrsTsContext::encode, like SrsBenchTsEncode but the size is fixed.
+class SrsBenchTsEncodePes : public SrsBenchCase
+{
+private:
+    SrsTsContext ctx;
+    SrsBenchWriter writer;
+    SrsTsMessage msg;
+public:
+    virtual const char* name() {
+        return "ts_encode_pes_16kb";
+    }
+    virtual srs_error_t setup() {
+        msg.sid = SrsTsPESStreamIdVideoCommon;
+        msg.payload->append(std::string(16 * 1024, 'x').data(), 16 * 1024);
+        // Write the PAT and PMT with the first PES.
+        return ctx.encode(&writer, &msg, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC);
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            writer.reset();
+            msg.dts = msg.pts = (int64_t)i * 3600;
+            if ((err = ctx.encode(&writer, &msg, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC)) != srs_success) {
+                return srs_error_wrap(err, "encode");
+            }
+        }
+
+        return err;
+    }
+};
+
+// The handler to count the demuxed messages, which never keeps the message.
+class SrsBenchTsHandler : public ISrsTsHandler
+{
+public:
+    int64_t nn_msgs;
+    int64_t nn_bytes;
+public:
+    SrsBenchTsHandler() {
+        nn_msgs = nn_bytes = 0;
+    }
+    virtual ~SrsBenchTsHandler() {
+    }
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* msg) {
+        nn_msgs++;
+        nn_bytes += msg->payload->length();
+        return srs_success;
+    }
+};
+
+// Demux the TS packets of audio and video to messages, by SrsTsContext::decode, like the UDP TS ingest.
+class SrsBenchTsDecode : public SrsBenchCase
+{
+private:
+    SrsTsContext ctx;
+    SrsBenchTsHandler handler;
+    SrsBenchWriter writer;
+public:
+    virtual ~SrsBenchTsDecode() {
+    }
+    virtual const char* name() {
+        return "ts_decode";
+    }
+    virtual srs_error_t setup() {
+        srs_error_t err = srs_success;
+
+        SrsTsContext enc;
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            const std::string& tag = corpus->tags[i];
+
+            SrsTsMessage msg;
+            msg.dts = msg.pts = corpus->timestamps[i] * 90;
+            if (corpus->videos[i]) {
+                msg.sid = SrsTsPESStreamIdVideoCommon;
+                msg.write_pcr = (tag[0] == 0x17);
+                msg.payload->append("\x00\x00\x00\x01", 4);
+                msg.payload->append(tag.data() + 9, (int)tag.size() - 9);
+            } else {
+                msg.sid = SrsTsPESStreamIdAudioCommon;
+                msg.payload->append(tag.data() + 2, (int)tag.size() - 2);
+            }
+
+            if ((err = enc.encode(&writer, &msg, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC)) != srs_success) {
+                return srs_error_wrap(err, "encode");
+            }
+        }
+        return err;
+    }
+    // Each operation decodes a ts packet, and the corpus is decoded in cycle.
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        int count = (int)writer.data.size() / SRS_TS_PACKET_SIZE;
+        for (int i = 0; i < n; i++) {
+            SrsBuffer stream(&writer.data[(i % count) * SRS_TS_PACKET_SIZE], SRS_TS_PACKET_SIZE);
+            if ((err = ctx.decode(&stream, &handler)) != srs_success) {
+                return srs_error_wrap(err, "decode");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Write the FLV tags in batch, by SrsFlvTransmuxer::write_tags, like the HTTP-FLV stream.
+class SrsBenchFlvWriteTags : public SrsBenchCase
+{
+private:
+    SrsFlvTransmuxer enc;
+    SrsBenchWriter writer;
+    std::vector<SrsSharedPtrMessage*> msgs;
+public:
+    virtual ~SrsBenchFlvWriteTags() {
+        for (int i = 0; i < (int)msgs.size(); i++) {
+            srs_freep(msgs[i]);
+        }
+    }
+    virtual const char* name() {
+        return "flv_write_tags";
+    }
+    virtual srs_error_t setup() {
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            msgs.push_back(corpus->create(corpus->tags[i], corpus->videos[i], corpus->timestamps[i]));
+        }
+        return enc.initialize(&writer);
+    }
+    // Each operation writes a tag, but in batch of the corpus, like the consumer.
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        int count = (int)msgs.size();
+        for (int i = 0; i < n; i += count) {
+            writer.reset();
+            if ((err = enc.write_tags(&msgs[0], srs_min(count, n - i))) != srs_success) {
+                return srs_error_wrap(err, "write tags");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Mux the audio and video samples to MP4, by SrsMp4Encoder::write_sample, and flush for each corpus.
+class SrsBenchMp4Encoder : public SrsBenchCase
+{
+private:
+    SrsBenchWriter writer;
+public:
+    virtual const char* name() {
+        return "mp4_write_sample";
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n;) {
+            writer.reset();
+
+            SrsMp4Encoder enc;
+            SrsFormat fmt;
+            if ((err = enc.initialize(&writer)) != srs_success) {
+                return srs_error_wrap(err, "init encoder");
+            }
+            if ((err = fmt.initialize()) != srs_success) {
+                return srs_error_wrap(err, "init format");
+            }
+            if ((err = write(&enc, &fmt, corpus->avc_sh, true, 0)) != srs_success) {
+                return srs_error_wrap(err, "avc sh");
+            }
+            if ((err = write(&enc, &fmt, corpus->aac_sh, false, 0)) != srs_success) {
+                return srs_error_wrap(err, "aac sh");
+            }
+
+            for (int j = 0; j < (int)corpus->tags.size() && i < n; j++, i++) {
+                if ((err = write(&enc, &fmt, corpus->tags[j], corpus->videos[j], corpus->timestamps[j])) != srs_success) {
+                    return srs_error_wrap(err, "write sample");
+                }
+            }
+
+            if ((err = enc.flush()) != srs_success) {
+                return srs_error_wrap(err, "flush");
+            }
+        }
+
+        return err;
+    }
+private:
+    srs_error_t write(SrsMp4Encoder* enc, SrsFormat* fmt, const std::string& tag, bool video, uint32_t timestamp) {
+        srs_error_t err = srs_success;
+
+        if (video) {
+            if ((err = fmt->on_video(timestamp, (char*)tag.data(), (int)tag.size())) != srs_success) {
+                return srs_error_wrap(err, "demux video");
+            }
+            return enc->write_sample(fmt, SrsMp4HandlerTypeVIDE, fmt->video->frame_type, fmt->video->avc_packet_type,
+                timestamp, timestamp, (uint8_t*)fmt->raw, fmt->nb_raw);
+        }
+
+        if ((err = fmt->on_audio(timestamp, (char*)tag.data(), (int)tag.size())) != srs_success) {
+            return srs_error_wrap(err, "demux audio");
+        }
+        return enc->write_sample(fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt->audio->aac_packet_type,
+            timestamp, timestamp, (uint8_t*)fmt->raw, fmt->nb_raw);
+    }
+};
+
+// Demux the AVC frames to NALUs, by SrsFormat::on_video, which is used by HLS, DVR and so on.
+class SrsBenchFormatOnVideo : public SrsBenchCase
+{
+private:
+    SrsFormat fmt;
+    std::vector<int> videos;
+public:
+    virtual const char* name() {
+        return "format_on_video";
+    }
+    virtual srs_error_t setup() {
+        srs_error_t err = srs_success;
+
+        if ((err = fmt.initialize()) != srs_success) {
+            return srs_error_wrap(err, "init format");
+        }
+        if ((err = fmt.on_video(0, (char*)corpus->avc_sh.data(), (int)corpus->avc_sh.size())) != srs_success) {
+            return srs_error_wrap(err, "avc sh");
+        }
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            if (corpus->videos[i]) {
+                videos.push_back(i);
+            }
+        }
+
+        return err;
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            int j = videos[i % videos.size()];
+            const std::string& tag = corpus->tags[j];
+            if ((err = fmt.on_video(corpus->timestamps[j], (char*)tag.data(), (int)tag.size())) != srs_success) {
+                return srs_error_wrap(err, "demux video");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Decode the AMF0 object of RTMP connect command, by SrsAmf0Object::read.
+class SrsBenchAmf0Decode : public SrsBenchCase
+{
+private:
+    std::vector<char> bytes;
+public:
+    virtual const char* name() {
+        return "amf0_decode_object";
+    }
+    virtual srs_error_t setup() {
+        srs_error_t err = srs_success;
+
+        SrsAmf0Object* obj = SrsAmf0Any::object();
+        SrsAutoFree(SrsAmf0Object, obj);
+
+        obj->set("app", SrsAmf0Any::str("live"));
+        obj->set("flashVer", SrsAmf0Any::str("FMLE/3.0 (compatible; FMSc/1.0)"));
+        obj->set("swfUrl", SrsAmf0Any::str("rtmp://ossrs.net/live"));
+        obj->set("tcUrl", SrsAmf0Any::str("rtmp://ossrs.net/live?vhost=__defaultVhost__"));
+        obj->set("fpad", SrsAmf0Any::boolean(false));
+        obj->set("capabilities", SrsAmf0Any::number(239));
+        obj->set("audioCodecs", SrsAmf0Any::number(3575));
+        obj->set("videoCodecs", SrsAmf0Any::number(252));
+        obj->set("videoFunction", SrsAmf0Any::number(1));
+        obj->set("pageUrl", SrsAmf0Any::str("http://ossrs.net/players/srs_player.html"));
+        obj->set("objectEncoding", SrsAmf0Any::number(0));
+
+        bytes.resize(obj->total_size());
+        SrsBuffer b(&bytes[0], (int)bytes.size());
+        if ((err = obj->write(&b)) != srs_success) {
+            return srs_error_wrap(err, "encode");
+        }
+
+        return err;
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            SrsBuffer b(&bytes[0], (int)bytes.size());
+            SrsAmf0Object* obj = SrsAmf0Any::object();
+            err = obj->read(&b);
+            srs_freep(obj);
+            if (err != srs_success) {
+                return srs_error_wrap(err, "decode");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Encode the audio and video messages to RTMP chunks, by SrsProtocol::send_and_free_messages.
+class SrsBenchRtmpEncode : public SrsBenchCase
+{
+private:
+    SrsBenchIO io;
+    SrsProtocol* proto;
+    std::vector<SrsSharedPtrMessage*> msgs;
+public:
+    SrsBenchRtmpEncode() {
+        proto = new SrsProtocol(&io);
+    }
+    virtual ~SrsBenchRtmpEncode() {
+        srs_freep(proto);
+        for (int i = 0; i < (int)msgs.size(); i++) {
+            srs_freep(msgs[i]);
+        }
+    }
+    virtual const char* name() {
+        return "rtmp_chunk_encode";
+    }
+    virtual srs_error_t setup() {
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            msgs.push_back(corpus->create(corpus->tags[i], corpus->videos[i], corpus->timestamps[i]));
+        }
+        return srs_success;
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            // The protocol frees the message, so we send a copy which only references the payload.
+            SrsSharedPtrMessage* msg = msgs[i % msgs.size()]->copy();
+            if ((err = proto->send_and_free_messages(&msg, 1, 1)) != srs_success) {
+                return srs_error_wrap(err, "send");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Decode the RTMP chunks to messages, by SrsProtocol::recv_message.
+class SrsBenchRtmpDecode : public SrsBenchCase
+{
+private:
+    SrsBenchIO io;
+    SrsProtocol* proto;
+public:
+    SrsBenchRtmpDecode() {
+        proto = new SrsProtocol(&io);
+    }
+    virtual ~SrsBenchRtmpDecode() {
+        srs_freep(proto);
+    }
+    virtual const char* name() {
+        return "rtmp_chunk_decode";
+    }
+    // Encode the corpus to chunks by another protocol, then read it in cycle.
+    virtual srs_error_t setup() {
+        srs_error_t err = srs_success;
+
+        SrsBenchIO w;
+        w.capture = true;
+        SrsProtocol p(&w);
+        for (int i = 0; i < (int)corpus->tags.size(); i++) {
+            SrsSharedPtrMessage* msg = corpus->create(corpus->tags[i], corpus->videos[i], corpus->timestamps[i]);
+            if ((err = p.send_and_free_messages(&msg, 1, 1)) != srs_success) {
+                return srs_error_wrap(err, "send");
+            }
+        }
+        io.in = w.out;
+
+        return err;
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            SrsCommonMessage* msg = NULL;
+            if ((err = proto->recv_message(&msg)) != srs_success) {
+                return srs_error_wrap(err, "recv");
+            }
+            srs_freep(msg);
+        }
+
+        return err;
+    }
+};
+
+// The complex handshake of RTMP server, by SrsComplexHandshake::handshake_with_client, which generates
+// the DH key for each handshake, or fetches the pre-generated key from _srs_dh_pool.
+class SrsBenchComplexHandshake : public SrsBenchCase
+{
+private:
+    bool use_pool;
+    SrsBenchIO io;
+public:
+    SrsBenchComplexHandshake(bool p) {
+        use_pool = p;
+    }
+    virtual ~SrsBenchComplexHandshake() {
+        _srs_dh_pool->set_capacity(0);
+    }
+    virtual const char* name() {
+        return use_pool? "rtmp_complex_handshake_pool" : "rtmp_complex_handshake";
+    }
+    // The c0c1 and c2 of client, which is read in cycle for each handshake.
+    virtual srs_error_t setup() {
+        srs_error_t err = srs_success;
+
+        char c0c1[1537];
+        c0c1[0] = 0x03;
+
+        srs_internal::c1s1 c1;
+        if ((err = c1.c1_create(srs_internal::srs_schema1)) != srs_success) {
+            return srs_error_wrap(err, "create c1");
+        }
+        if ((err = c1.dump(c0c1 + 1, 1536)) != srs_success) {
+            return srs_error_wrap(err, "dump c1");
+        }
+
+        char c2[1536];
+        srs_random_generate(c2, sizeof(c2));
+
+        io.in.append(c0c1, sizeof(c0c1));
+        io.in.append(c2, sizeof(c2));
+
+        return err;
+    }
+    // Generate the DH keys for pool, like the idle time of server.
+    virtual srs_error_t prepare(int n) {
+        if (!use_pool) {
+            return srs_success;
+        }
+        _srs_dh_pool->set_capacity(n);
+        return _srs_dh_pool->refill(n);
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            SrsHandshakeBytes bytes;
+            SrsComplexHandshake hs;
+            if ((err = hs.handshake_with_client(&bytes, &io)) != srs_success) {
+                return srs_error_wrap(err, "handshake");
+            }
+        }
+
+        return err;
+    }
+};
+
+// Parse the HTTP request of HTTP-FLV player, by SrsHttpParser::parse_message.
+class SrsBenchHttpParse : public SrsBenchCase
+{
+private:
+    SrsBenchIO io;
+    SrsHttpParser parser;
+public:
+    virtual const char* name() {
+        return "http_parse_request";
+    }
+    virtual srs_error_t setup() {
+        io.in = "GET /live/livestream.flv?vhost=__defaultVhost__&token=a0b1c2d3e4f5 HTTP/1.1\r\n"
+            "Host: ossrs.net:8080\r\n"
+            "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_3) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+            "Accept: */*\r\n"
+            "Accept-Encoding: identity;q=1, *;q=0\r\n"
+            "Accept-Language: en-US,en;q=0.9\r\n"
+            "Origin: http://ossrs.net\r\n"
+            "Referer: http://ossrs.net/players/srs_player.html\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n";
+        return parser.initialize(HTTP_REQUEST, false);
+    }
+    virtual srs_error_t run(int n) {
+        srs_error_t err = srs_success;
+
+        for (int i = 0; i < n; i++) {
+            ISrsHttpMessage* msg = NULL;
+            if ((err = parser.parse_message(&io, &msg)) != srs_success) {
+                return srs_error_wrap(err, "parse");
+            }
+            srs_freep(msg);
+        }
+
+        return err;
+    }
+};
+
+// Write the fields of 1, 2, 3, 4 and 8 bytes, by the integer accessors of SrsBuffer, which check each field.
+class SrsBenchBufferWrite : public SrsBenchCase
+{
+private:
+    char bytes[4096];
+public:
+    virtual const char* name() {
+        return "buffer_write_fields";
+    }
+    virtual srs_error_t run(int n) {
+        SrsBuffer b(bytes, sizeof(bytes));
+        for (int i = 0; i < n; i++) {
+            if (!b.require(18)) {
+                b.skip(-b.pos());
+            }
+            b.write_1bytes((int8_t)i);
+            b.write_2bytes((int16_t)i);
+            b.write_3bytes(i);
+            b.write_4bytes(i);
+            b.write_8bytes(i);
+        }
+        return srs_success;
+    }
+};
+
+// Write the same fields as SrsBenchBufferWrite, by srs_write_be, which checks the space of block once.
+class SrsBenchBeWrite : public SrsBenchCase
+{
+private:
+    char bytes[4096];
+public:
+    virtual const char* name() {
+        return "be_write_fields";
+    }
+    virtual srs_error_t run(int n) {
+        SrsBuffer b(bytes, sizeof(bytes));
+        for (int i = 0; i < n; i++) {
+            if (!b.require(18)) {
+                b.skip(-b.pos());
+            }
+            char* p = b.head();
+            srs_write_be<int8_t>(p, (int8_t)i);
+            srs_write_be<int16_t>(p, (int16_t)i);
+            srs_write_be24(p, i);
+            srs_write_be<int32_t>(p, i);
+            srs_write_be<int64_t>(p, i);
+            b.skip(18);
+        }
+        return srs_success;
+    }
+};
+
+extern char* __srs_avc_find_annexb_scalar(char* p, char* end);
+
+// The way to find the annexb start code.
+enum SrsBenchAnnexbType
+{
+    // Skip byte until srs_avc_startswith_annexb, the original way.
+    SrsBenchAnnexbTypeStartswith = 0,
+    // The scalar scan of srs_avc_find_annexb.
+    SrsBenchAnnexbTypeScalar,
+    // The srs_avc_find_annexb, which scans 16 bytes once by SIMD if available.
+    SrsBenchAnnexbTypeFind,
+};
+
+// Find the annexb start code in an IDR of 4K about 1MB, without any start code, so it scans the whole frame.
+class SrsBenchAnnexbFind : public SrsBenchCase
+{
+private:
+    SrsBenchAnnexbType type;
+    std::vector<char> data;
+public:
+    SrsBenchAnnexbFind(SrsBenchAnnexbType t) {
+        type = t;
+    }
+    virtual const char* name() {
+        if (type == SrsBenchAnnexbTypeStartswith) {
+            return "annexb_startswith_1mb";
+        } else if (type == SrsBenchAnnexbTypeScalar) {
+            return "annexb_scalar_1mb";
+        }
+        return "annexb_find_1mb";
+    }
+    virtual srs_error_t setup() {
+        // The pseudo-random payload, fixed seed for stable result, and escape the start code.
+        uint32_t seed = 0x20200314;
+        data.resize(1024 * 1024);
+        for (int i = 0; i < (int)data.size(); i++) {
+            seed = seed * 1103515245 + 12345;
+            data[i] = (char)(seed >> 16);
+            if (i >= 2 && data[i] == 0x01 && data[i - 1] == 0x00 && data[i - 2] == 0x00) {
+                data[i] = 0x03;
+            }
+        }
+        return srs_success;
+    }
+    virtual srs_error_t run(int n) {
+        char* p = &data[0];
+        char* end = p + data.size();
+        for (int i = 0; i < n; i++) {
+            char* found = NULL;
+            if (type == SrsBenchAnnexbTypeStartswith) {
+                SrsBuffer stream(p, (int)data.size());
+                while (!stream.empty() && !srs_avc_startswith_annexb(&stream, NULL)) {
+                    stream.skip(1);
+                }
+                found = stream.data() + stream.pos();
+            } else if (type == SrsBenchAnnexbTypeScalar) {
+                found = __srs_avc_find_annexb_scalar(p, end);
+            } else {
+                found = srs_avc_find_annexb(p, end);
+            }
+            if (found != end) {
+                return srs_error_new(ERROR_HLS_DECODE_ERROR, "start code at %d", (int)(found - p));
+            }
+        }
+        return srs_success;
+    }
+};
+
+extern void __crc32_make_table(uint32_t t[256], uint32_t poly, bool reflect_in);
+extern uint32_t __crc32_table_driven(uint32_t* t, const void* buf, int size, uint32_t previous, bool reflect_in, uint32_t xor_in, bool reflect_out, uint32_t xor_out);
+extern uint32_t __crc32_ieee_slicing8(const void* buf, int size, uint32_t previous);
+
+// The way to calculate the CRC32 of IEEE.
+enum SrsBenchCrc32Type
+{
+    // The bytewise table driven, the original way.
+    SrsBenchCrc32TypeTable = 0,
+    // The slicing-by-8 table driven.
+    SrsBenchCrc32TypeSlicing8,
+    // The srs_crc32_ieee, which uses the CRC32 instructions if available.
+    SrsBenchCrc32TypeDispatch,
+};
+
+// Calculate the CRC32 of a HLS segment of 2MB, which is about 10s of 1.5Mbps, for the checksum sidecar.
+class SrsBenchCrc32 : public SrsBenchCase
+{
+private:
+    SrsBenchCrc32Type type;
+    uint32_t table[256];
+    std::vector<char> data;
+    uint32_t checksum;
+public:
+    SrsBenchCrc32(SrsBenchCrc32Type t) {
+        type = t;
+        checksum = 0;
+    }
+    virtual const char* name() {
+        if (type == SrsBenchCrc32TypeTable) {
+            return "crc32_table_2mb";
+        } else if (type == SrsBenchCrc32TypeSlicing8) {
+            return "crc32_slicing8_2mb";
+        }
+        return "crc32_ieee_2mb";
+    }
+    virtual srs_error_t setup() {
+        __crc32_make_table(table, 0x4c11db7, true);
+
+        // The pseudo-random payload, fixed seed for stable result.
+        uint32_t seed = 0x20200314;
+        data.resize(2 * 1024 * 1024);
+        for (int i = 0; i < (int)data.size(); i++) {
+            seed = seed * 1103515245 + 12345;
+            data[i] = (char)(seed >> 16);
+        }
+        return srs_success;
+    }
+    virtual srs_error_t run(int n) {
+        for (int i = 0; i < n; i++) {
+            if (type == SrsBenchCrc32TypeTable) {
+                checksum = __crc32_table_driven(table, &data[0], (int)data.size(), 0, true, 0xffffffff, true, 0xffffffff);
+            } else if (type == SrsBenchCrc32TypeSlicing8) {
+                checksum = __crc32_ieee_slicing8(&data[0], (int)data.size(), 0);
+            } else {
+                checksum = srs_crc32_ieee(&data[0], (int)data.size(), 0);
+            }
+        }
+        return srs_success;
+    }
+};
+
+// The result of a benchmark.
+struct SrsBenchResult
+{
+    std::string name;
+    int iterations;
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+// Run the case, grow the iterations until it takes the min duration, like golang.
+srs_error_t srs_bench_run(SrsBenchCase* c, int64_t min_ns, SrsBenchResult* r)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = c->setup()) != srs_success) {
+        return srs_error_wrap(err, "setup %s", c->name());
+    }
+
+    int n = 1;
+    int64_t elapsed = 0, allocs = 0;
+    while (true) {
+        if ((err = c->prepare(n)) != srs_success) {
+            return srs_error_wrap(err, "prepare %s n=%d", c->name(), n);
+        }
+
+        int64_t starttime = srs_bench_now();
+        int64_t start_allocs = _srs_bench_allocs;
+
+        if ((err = c->run(n)) != srs_success) {
+            return srs_error_wrap(err, "run %s n=%d", c->name(), n);
+        }
+
+        elapsed = srs_bench_now() - starttime;
+        allocs = _srs_bench_allocs - start_allocs;
+        if (elapsed >= min_ns || n >= 1000000000) {
+            break;
+        }
+
+        // Predict the iterations by the last run, 20% more, but never grow more than 100x.
+        int64_t next = (elapsed > 0)? (int64_t)((double)min_ns * n / elapsed * 1.2) : (int64_t)n * 100;
+        next = srs_min(next, (int64_t)n * 100);
+        next = srs_max(next, (int64_t)n + 1);
+        n = (int)srs_min(next, (int64_t)1000000000);
+    }
+
+    r->name = c->name();
+    r->iterations = n;
+    r->ns_per_op = (double)elapsed / n;
+    r->allocs_per_op = (double)allocs / n;
+
+    return err;
+}
+
+void usage(char* argv0)
+{
+    printf("Usage: %s [-t duration_ms] [-f filter] [-o output.json]\n", argv0);
+    printf("    -t  The min duration in ms for each benchmark. Default: 1000\n");
+    printf("    -f  Only run the benchmark whose name contains the filter.\n");
+    printf("    -o  Write the results in json to the file.\n");
+}
+
+int main(int argc, char** argv)
+{
+    srs_error_t err = srs_success;
+
+    int64_t duration = 1000;
+    std::string filter, output;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:f:o:h")) != -1) {
+        if (opt == 't') {
+            duration = ::atoi(optarg);
+        } else if (opt == 'f') {
+            filter = optarg;
+        } else if (opt == 'o') {
+            output = optarg;
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (duration <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    SrsBenchCorpus corpus;
+
+    std::vector<SrsBenchCase*> cases;
+    cases.push_back(new SrsBenchTsEncode());
+    cases.push_back(new SrsBenchTsEncodePes());
+    cases.push_back(new SrsBenchTsDecode());
+    cases.push_back(new SrsBenchFlvWriteTags());
+    cases.push_back(new SrsBenchMp4Encoder());
+    cases.push_back(new SrsBenchFormatOnVideo());
+    cases.push_back(new SrsBenchAmf0Decode());
+    cases.push_back(new SrsBenchRtmpEncode());
+    cases.push_back(new SrsBenchRtmpDecode());
+    cases.push_back(new SrsBenchComplexHandshake(false));
+    cases.push_back(new SrsBenchComplexHandshake(true));
+    cases.push_back(new SrsBenchHttpParse());
+    cases.push_back(new SrsBenchBufferWrite());
+    cases.push_back(new SrsBenchBeWrite());
+    cases.push_back(new SrsBenchAnnexbFind(SrsBenchAnnexbTypeStartswith));
+    cases.push_back(new SrsBenchAnnexbFind(SrsBenchAnnexbTypeScalar));
+    cases.push_back(new SrsBenchAnnexbFind(SrsBenchAnnexbTypeFind));
+    cases.push_back(new SrsBenchCrc32(SrsBenchCrc32TypeTable));
+    cases.push_back(new SrsBenchCrc32(SrsBenchCrc32TypeSlicing8));
+    cases.push_back(new SrsBenchCrc32(SrsBenchCrc32TypeDispatch));
+
+    SrsJsonObject* root = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, root);
+
+    SrsJsonArray* arr = SrsJsonAny::array();
+    root->set("duration_ms", SrsJsonAny::integer(duration));
+    root->set("benchmarks", arr);
+
+    for (int i = 0; i < (int)cases.size() && err == srs_success; i++) {
+        SrsBenchCase* c = cases[i];
+        if (!filter.empty() && !strstr(c->name(), filter.c_str())) {
+            continue;
+        }
+
+        SrsBenchResult r;
+        c->corpus = &corpus;
+        if ((err = srs_bench_run(c, duration * 1000000, &r)) != srs_success) {
+            break;
+        }
+
+        printf("%-24s %12d %14.1f ns/op %10.2f allocs/op\n", r.name.c_str(), r.iterations, r.ns_per_op, r.allocs_per_op);
+        fflush(stdout);
+
+        SrsJsonObject* obj = SrsJsonAny::object();
+        arr->append(obj);
+
+        obj->set("name", SrsJsonAny::str(r.name.c_str()));
+        obj->set("iterations", SrsJsonAny::integer(r.iterations));
+        obj->set("ns_per_op", SrsJsonAny::number(r.ns_per_op));
+        obj->set("allocs_per_op", SrsJsonAny::number(r.allocs_per_op));
+    }
+
+    for (int i = 0; i < (int)cases.size(); i++) {
+        srs_freep(cases[i]);
+    }
+
+    if (err != srs_success) {
+        fprintf(stderr, "Failed, %s\n", srs_error_desc(err).c_str());
+        int ret = srs_error_code(err);
+        srs_freep(err);
+        return ret;
+    }
+
+    if (!output.empty()) {
+        FILE* f = fopen(output.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "Failed, open %s\n", output.c_str());
+            return -1;
+        }
+        std::string json = root->dumps();
+        fwrite(json.data(), 1, json.size(), f);
+        fclose(f);
+    }
+
+    return 0;
+}
@@ -2493,6 +2493,171 @@ VOID TEST(ProtocolAMF0Test, Amf0Object2)
     }
 }
 
+VOID TEST(ProtocolAMF0Test, ObjectView)
+{
+    srs_error_t err;
+
+    SrsAmf0Object* o = SrsAmf0Any::object();
+    SrsAutoFree(SrsAmf0Object, o);
+    o->set("tcUrl", SrsAmf0Any::str("rtmp://127.0.0.1/live"));
+    o->set("fpad", SrsAmf0Any::boolean(true));
+    o->set("key", SrsAmf0Any::null());
+    o->set("audioCodecs", SrsAmf0Any::number(3575.0));
+
+    SrsAmf0Object* child = SrsAmf0Any::object();
+    child->set("tcUrl", SrsAmf0Any::str("rtmp://child/live"));
+    SrsAmf0StrictArray* arr = SrsAmf0Any::strict_array();
+    arr->append(SrsAmf0Any::number(1.0));
+    arr->append(SrsAmf0Any::str("hello"));
+    arr->append(SrsAmf0Any::date(100));
+    child->set("arr", arr);
+    o->set("child", child);
+    o->set("objectEncoding", SrsAmf0Any::number(3.0));
+
+    int nn = o->total_size() + 1;
+    char* b = new char[nn];
+    SrsAutoFreeA(char, b);
+
+    if (true) {
+        SrsBuffer buf(b, nn);
+        HELPER_ASSERT_SUCCESS(o->write(&buf));
+        buf.write_1bytes(0x05);
+        buf.skip(-1 * buf.pos());
+
+        EXPECT_TRUE(SrsAmf0ObjectView::accept(&buf));
+
+        SrsAmf0ObjectView v;
+        HELPER_ASSERT_SUCCESS(v.read(&buf));
+        EXPECT_EQ(nn - 1, buf.pos());
+        EXPECT_TRUE(v.is_object());
+        EXPECT_FALSE(v.is_ecma_array());
+        EXPECT_EQ(6, v.count());
+
+        std::string s;
+        EXPECT_TRUE(v.get_string("tcUrl", s));
+        EXPECT_STREQ("rtmp://127.0.0.1/live", s.c_str());
+
+        double d = 0;
+        EXPECT_TRUE(v.get_number("objectEncoding", d));
+        EXPECT_EQ(3.0, d);
+        EXPECT_TRUE(v.get_number("audioCodecs", d));
+        EXPECT_EQ(3575.0, d);
+
+        bool f = false;
+        EXPECT_TRUE(v.get_boolean("fpad", f));
+        EXPECT_TRUE(f);
+
+        // Not found or not the required type.
+        EXPECT_FALSE(v.get_string("pageUrl", s));
+        EXPECT_FALSE(v.get_string("tcUr", s));
+        EXPECT_FALSE(v.get_string("fpad", s));
+        EXPECT_FALSE(v.get_number("key", d));
+        EXPECT_FALSE(v.get_boolean("child", f));
+        EXPECT_FALSE(v.get_number("arr", d));
+
+        SrsAmf0Object* c = SrsAmf0Any::object();
+        SrsAutoFree(SrsAmf0Object, c);
+        HELPER_ASSERT_SUCCESS(v.copy_to(c));
+        EXPECT_EQ(6, c->count());
+        EXPECT_EQ(o->total_size(), c->total_size());
+
+        SrsAmf0Any* prop = c->get_property("child");
+        ASSERT_TRUE(prop && prop->is_object());
+        prop = prop->to_object()->get_property("arr");
+        ASSERT_TRUE(prop && prop->is_strict_array());
+        EXPECT_EQ(3, prop->to_strict_array()->count());
+    }
+
+    // The ecma array.
+    if (true) {
+        SrsAmf0EcmaArray* a = SrsAmf0Any::ecma_array();
+        SrsAutoFree(SrsAmf0EcmaArray, a);
+        a->set("width", SrsAmf0Any::number(1280));
+        a->set("encoder", SrsAmf0Any::str("Lavf"));
+
+        int nb = a->total_size();
+        char* p = new char[nb];
+        SrsAutoFreeA(char, p);
+
+        SrsBuffer buf(p, nb);
+        HELPER_ASSERT_SUCCESS(a->write(&buf));
+        buf.skip(-1 * buf.pos());
+
+        SrsAmf0ObjectView v;
+        HELPER_ASSERT_SUCCESS(v.read(&buf));
+        EXPECT_TRUE(buf.empty());
+        EXPECT_TRUE(v.is_ecma_array());
+        EXPECT_EQ(2, v.count());
+
+        double d = 0;
+        EXPECT_TRUE(v.get_number("width", d));
+        EXPECT_EQ(1280, d);
+
+        std::string s;
+        EXPECT_TRUE(v.get_string("encoder", s));
+        EXPECT_STREQ("Lavf", s.c_str());
+    }
+
+    // Not object, or corrupt object.
+    if (true) {
+        SrsBuffer buf(b, nn);
+        HELPER_ASSERT_SUCCESS(o->write(&buf));
+
+        SrsBuffer b0(b + 1, nn - 1);
+        EXPECT_FALSE(SrsAmf0ObjectView::accept(&b0));
+
+        SrsAmf0ObjectView v0;
+        HELPER_EXPECT_FAILED(v0.read(&b0));
+
+        // In the middle of the value of tcUrl.
+        SrsBuffer b1(b, 15);
+        SrsAmf0ObjectView v1;
+        HELPER_EXPECT_FAILED(v1.read(&b1));
+    }
+}
+
+VOID TEST(ProtocolAMF0Test, SkipAny)
+{
+    srs_error_t err;
+
+    SrsAmf0Any* values[] = {
+        SrsAmf0Any::str("hello"), SrsAmf0Any::str(), SrsAmf0Any::boolean(true), SrsAmf0Any::number(3.0),
+        SrsAmf0Any::null(), SrsAmf0Any::undefined(), SrsAmf0Any::date(1), SrsAmf0Any::object(),
+        SrsAmf0Any::ecma_array(), SrsAmf0Any::strict_array(),
+    };
+    values[7]->to_object()->set("id", SrsAmf0Any::str("srs"));
+    values[8]->to_ecma_array()->set("id", SrsAmf0Any::number(1));
+    values[9]->to_strict_array()->append(SrsAmf0Any::object());
+
+    for (int i = 0; i < (int)(sizeof(values) / sizeof(SrsAmf0Any*)); i++) {
+        SrsAmf0Any* v = values[i];
+        SrsAutoFree(SrsAmf0Any, v);
+
+        int nn = v->total_size();
+        char* b = new char[nn];
+        SrsAutoFreeA(char, b);
+
+        SrsBuffer buf(b, nn);
+        HELPER_ASSERT_SUCCESS(v->write(&buf));
+        buf.skip(-1 * buf.pos());
+
+        HELPER_EXPECT_SUCCESS(srs_amf0_skip_any(&buf));
+        EXPECT_TRUE(buf.empty());
+
+        // Corrupt value.
+        if (nn > 1) {
+            SrsBuffer b1(b, nn - 1);
+            HELPER_EXPECT_FAILED(srs_amf0_skip_any(&b1));
+        }
+    }
+
+    if (true) {
+        char b[] = {0x0d};
+        SrsBuffer buf(b, sizeof(b));
+        HELPER_EXPECT_FAILED(srs_amf0_skip_any(&buf));
+    }
+}
+
 VOID TEST(ProtocolJSONTest, Interfaces)
 {
     if (true) {
@@ -2574,6 +2739,12 @@ VOID TEST(ProtocolJSONTest, Dumps)
         srs_freep(p);
     }
 
+    if (true) {
+        SrsJsonAny* p = SrsJsonAny::str("v=0\r\na=\"x\\y\"");
+        EXPECT_STREQ("\"v=0\\r\\na=\\\"x\\\\y\\\"\"", p->dumps().c_str());
+        srs_freep(p);
+    }
+
     if (true) {
         SrsJsonAny* p = SrsJsonAny::boolean(true);
         EXPECT_STREQ("true", p->dumps().c_str());
@@ -2771,6 +2942,49 @@ VOID TEST(ProtocolJSONTest, ArrayAPI)
     srs_freep(a);
 }
 
+VOID TEST(ProtocolJSONTest, Writer)
+{
+    // Same to the dumps of tree.
+    if (true) {
+        SrsJsonObject* p = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, p);
+        p->set("code", SrsJsonAny::integer(0));
+        p->set("ok", SrsJsonAny::boolean(true));
+        p->set("fragment", SrsJsonAny::number(3.1));
+        p->set("video", SrsJsonAny::null());
+
+        SrsJsonArray* arr = SrsJsonAny::array();
+        p->set("clients", arr);
+        arr->add(SrsJsonAny::str("srs"));
+        arr->add(SrsJsonAny::object());
+
+        SrsJsonWriter jw;
+        jw.object_start();
+        jw.field("code")->integer(0)->field("ok")->boolean(true);
+        jw.field("fragment")->number(3.1)->field("video")->null();
+        jw.field("clients")->array_start()->str("srs")->object_start()->object_end()->array_end();
+        jw.object_end();
+        EXPECT_STREQ(p->dumps().c_str(), jw.dumps().c_str());
+    }
+
+    // The string value is escaped.
+    if (true) {
+        SrsJsonWriter jw;
+        jw.array_start()->str("a\"b\\c\n")->array_end();
+        EXPECT_STREQ("[\"a\\\"b\\\\c\\u000a\"]", jw.dumps().c_str());
+
+        SrsJsonAny* j = SrsJsonAny::loads(jw.dumps());
+        EXPECT_TRUE(j && j->is_array());
+        srs_freep(j);
+
+        // Reuse the writer.
+        jw.clear();
+        EXPECT_EQ(0, jw.size());
+        jw.integer(-1);
+        EXPECT_STREQ("-1", jw.dumps().c_str());
+    }
+}
+
 VOID TEST(ProtocolJSONTest, ParseSpecial)
 {
     if (true) {
@@ -251,6 +251,23 @@ VOID TEST(SrsAVCTest, H264IPBFrame)
         EXPECT_EQ(0, (uint8_t)frame.at(2)); EXPECT_EQ(5, (uint8_t)frame.at(3));
         EXPECT_STREQ("Hello", frame.substr(4).c_str());
     }
+
+    // For muxing NALUs to flv frame.
+    if (true) {
+        SrsRawH264Stream h; int nb_flv = 0; char* flv = NULL;
+        iovec nalus[2];
+        nalus[0].iov_base = (char*)"Hello"; nalus[0].iov_len = 5;
+        nalus[1].iov_base = (char*)"SRS"; nalus[1].iov_len = 3;
+        HELPER_ASSERT_SUCCESS(h.mux_nalus2flv(nalus, 2, SrsVideoAvcFrameTypeKeyFrame, 0, 0x010203, &flv, &nb_flv));
+        EXPECT_EQ(5+4+5+4+3, nb_flv);
+        EXPECT_EQ(SrsVideoAvcFrameTypeKeyFrame, uint8_t((flv[0]>>4)&0x0f));
+        EXPECT_EQ(SrsVideoCodecIdAVC, uint8_t(flv[0]&0x0f));
+        EXPECT_EQ(SrsVideoAvcFrameTraitNALU, uint8_t(flv[1]));
+        EXPECT_EQ(01, flv[2]); EXPECT_EQ(02, flv[3]); EXPECT_EQ(03, flv[4]);
+        EXPECT_EQ(5, flv[8]); EXPECT_STREQ("Hello", HELPER_ARR2STR(flv+9, 5).c_str());
+        EXPECT_EQ(3, flv[17]); EXPECT_STREQ("SRS", HELPER_ARR2STR(flv+18, 3).c_str());
+        srs_freepa(flv);
+    }
 }
 
 VOID TEST(SrsAVCTest, AACDemuxADTS)
@@ -30,6 +30,7 @@ using namespace std;
 #include <srs_app_source.hpp>
 #include <srs_core_performance.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_app_utility.hpp>
 #include <srs_service_st.hpp>
 #include <srs_rtmp_stack.hpp>
 #include <srs_utest_kernel.hpp>
@@ -923,6 +924,20 @@ VOID TEST(ConfigMainTest, CheckConf_srs_log_file)
         MockSrsConfig conf;
         HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "srs_log_files ./objs/srs.log;"));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_log_async());
+        EXPECT_EQ(4096, conf.get_log_async_size());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "srs_log_async on; srs_log_async_size 1024;"));
+        EXPECT_TRUE(conf.get_log_async());
+        EXPECT_EQ(1024, conf.get_log_async_size());
+    }
 }
 
 VOID TEST(ConfigMainTest, CheckConf_daemon)
@@ -1075,6 +1090,577 @@ VOID TEST(ConfigMainTest, CheckConf_stats)
     }
 }
 
+VOID TEST(ConfigMainTest, CheckConf_workers)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_workers_enabled());
+        EXPECT_EQ(2, conf.get_workers_count());
+        EXPECT_EQ(19350, conf.get_workers_relay_port());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "workers{enabled on;count 8;relay_port 29350;}"));
+        EXPECT_TRUE(conf.get_workers_enabled());
+        EXPECT_EQ(8, conf.get_workers_count());
+        EXPECT_EQ(29350, conf.get_workers_relay_port());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "workers{counts 2;}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "workers{count 0;}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "workers{count 2;relay_port 65535;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_affinity)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_TRUE(conf.get_affinity_cpus().empty());
+        EXPECT_STREQ("off", conf.get_memory_huge_pages().c_str());
+        EXPECT_FALSE(conf.get_memory_numa());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "affinity{cpus off;}"));
+        EXPECT_TRUE(conf.get_affinity_cpus().empty());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "affinity{cpus 0-3,8;}memory{huge_pages transparent;numa on;}"));
+        EXPECT_STREQ("0-3,8", conf.get_affinity_cpus().c_str());
+        EXPECT_STREQ("transparent", conf.get_memory_huge_pages().c_str());
+        EXPECT_TRUE(conf.get_memory_numa());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "affinity{cpus 3-1;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "affinity{cpu 1;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "memory{huge_pages on;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "memory{pages on;}"));
+    }
+    
+    if (true) {
+        vector<int> cpus;
+        HELPER_EXPECT_SUCCESS(srs_parse_cpus("0-2, 5,7-7", cpus));
+        ASSERT_EQ(5, (int)cpus.size());
+        EXPECT_EQ(0, cpus.at(0));
+        EXPECT_EQ(2, cpus.at(2));
+        EXPECT_EQ(5, cpus.at(3));
+        EXPECT_EQ(7, cpus.at(4));
+        
+        cpus.clear();
+        HELPER_EXPECT_SUCCESS(srs_parse_cpus("", cpus));
+        EXPECT_TRUE(cpus.empty());
+        
+        HELPER_EXPECT_FAILED(srs_parse_cpus("a-2", cpus));
+        HELPER_EXPECT_FAILED(srs_parse_cpus("1-", cpus));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_tls)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_tls_enabled());
+        EXPECT_TRUE(conf.get_tls_rtmps().empty());
+        EXPECT_TRUE(conf.get_tls_https().empty());
+        EXPECT_TRUE(conf.get_tls_ktls());
+        EXPECT_TRUE(conf.get_tls_session_tickets());
+        EXPECT_TRUE(conf.get_tls_ticket_key().empty());
+        EXPECT_EQ(300 * SRS_UTIME_SECONDS, conf.get_tls_session_timeout());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "tls{enabled on;rtmps 1443;https 127.0.0.1:8443;certificate a.crt;key a.key;"
+            "ktls off;session_tickets off;ticket_key t.key;session_timeout 60;}"));
+        EXPECT_TRUE(conf.get_tls_enabled());
+        EXPECT_STREQ("1443", conf.get_tls_rtmps().c_str());
+        EXPECT_STREQ("127.0.0.1:8443", conf.get_tls_https().c_str());
+        EXPECT_STREQ("a.crt", conf.get_tls_certificate().c_str());
+        EXPECT_STREQ("a.key", conf.get_tls_key().c_str());
+        EXPECT_FALSE(conf.get_tls_ktls());
+        EXPECT_FALSE(conf.get_tls_session_tickets());
+        EXPECT_STREQ("t.key", conf.get_tls_ticket_key().c_str());
+        EXPECT_EQ(60 * SRS_UTIME_SECONDS, conf.get_tls_session_timeout());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "tls{rtmps off;https off;ticket_key off;}"));
+        EXPECT_TRUE(conf.get_tls_rtmps().empty());
+        EXPECT_TRUE(conf.get_tls_https().empty());
+        EXPECT_TRUE(conf.get_tls_ticket_key().empty());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "tls{enabled on;rtmps 1443;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "tls{cert a.crt;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_srt)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_srt_enabled());
+        EXPECT_EQ(10080, conf.get_srt_listen());
+        EXPECT_EQ(120, conf.get_srt_latency());
+        EXPECT_EQ(-1, conf.get_srt_maxbw());
+        EXPECT_EQ(1316, conf.get_srt_payload_size());
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_srt_peer_idle_timeout());
+        EXPECT_STREQ("live", conf.get_srt_default_app().c_str());
+        EXPECT_EQ(120, conf.get_vhost_srt_latency("v"));
+        EXPECT_TRUE(conf.get_vhost_srt_tlpktdrop("v"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "srt_server{enabled on;listen 9000;latency 200;maxbw 1000000;payload_size 188;"
+            "peer_idle_timeout 3000;default_app srt;} vhost v{srt{latency 500;tlpktdrop off;}} vhost x{}"));
+        EXPECT_TRUE(conf.get_srt_enabled());
+        EXPECT_EQ(9000, conf.get_srt_listen());
+        EXPECT_EQ(200, conf.get_srt_latency());
+        EXPECT_EQ(1000000, conf.get_srt_maxbw());
+        EXPECT_EQ(188, conf.get_srt_payload_size());
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_srt_peer_idle_timeout());
+        EXPECT_STREQ("srt", conf.get_srt_default_app().c_str());
+        EXPECT_EQ(500, conf.get_vhost_srt_latency("v"));
+        EXPECT_FALSE(conf.get_vhost_srt_tlpktdrop("v"));
+        EXPECT_EQ(200, conf.get_vhost_srt_latency("x"));
+        EXPECT_TRUE(conf.get_vhost_srt_tlpktdrop("x"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{multicast{enabled on;channel live/a udp://239.1.1.1:5000;"
+            "channel live/b rtp://239.1.1.2:5000;ttl 4;interface 10.0.0.1;delay 300;}} vhost x{}"));
+        EXPECT_TRUE(conf.get_vhost_multicast_enabled("v"));
+        EXPECT_STREQ("udp://239.1.1.1:5000", conf.get_vhost_multicast_channel("v", "live/a").c_str());
+        EXPECT_STREQ("rtp://239.1.1.2:5000", conf.get_vhost_multicast_channel("v", "live/b").c_str());
+        EXPECT_STREQ("", conf.get_vhost_multicast_channel("v", "live/c").c_str());
+        EXPECT_EQ(4, conf.get_vhost_multicast_ttl("v"));
+        EXPECT_STREQ("10.0.0.1", conf.get_vhost_multicast_interface("v").c_str());
+        EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, conf.get_vhost_multicast_delay("v"));
+        
+        EXPECT_FALSE(conf.get_vhost_multicast_enabled("x"));
+        EXPECT_EQ(16, conf.get_vhost_multicast_ttl("x"));
+        EXPECT_STREQ("", conf.get_vhost_multicast_interface("x").c_str());
+        EXPECT_EQ(100 * SRS_UTIME_MILLISECONDS, conf.get_vhost_multicast_delay("x"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "vhost v{multicast{channel live/a;}}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "srt_server{payload_size 1400;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "srt_server{passphrase abc;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "vhost v{srt{maxbw 100;}}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_disk_io)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_disk_io_enabled());
+        EXPECT_EQ(2, conf.get_disk_io_threads());
+        EXPECT_EQ(16 * 1024 * 1024, conf.get_disk_io_max_pending());
+        EXPECT_FALSE(conf.get_disk_io_fsync());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "disk_io{enabled on;threads 4;max_pending 1024;fsync on;}"));
+        EXPECT_TRUE(conf.get_disk_io_enabled());
+        EXPECT_EQ(4, conf.get_disk_io_threads());
+        EXPECT_EQ(1024 * 1024, conf.get_disk_io_max_pending());
+        EXPECT_TRUE(conf.get_disk_io_fsync());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "disk_io{thread 2;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_io_uring)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_io_uring_enabled());
+        EXPECT_EQ(4096, conf.get_io_uring_entries());
+        EXPECT_TRUE(conf.get_io_uring_write());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "io_uring{enabled on;entries 1024;write off;}"));
+        EXPECT_TRUE(conf.get_io_uring_enabled());
+        EXPECT_EQ(1024, conf.get_io_uring_entries());
+        EXPECT_FALSE(conf.get_io_uring_write());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "io_uring{entry 1024;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_accept)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(16, conf.get_accept_batch());
+        EXPECT_EQ(0, conf.get_accept_rate());
+        EXPECT_EQ(0, conf.get_accept_defer());
+        EXPECT_EQ(0, conf.get_accept_fastopen());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "accept{batch 0;rate 1000;defer 3;fastopen 128;}"));
+        EXPECT_EQ(1, conf.get_accept_batch());
+        EXPECT_EQ(1000, conf.get_accept_rate());
+        EXPECT_EQ(3, conf.get_accept_defer());
+        EXPECT_EQ(128, conf.get_accept_fastopen());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "accept{backlog 1024;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_overload)
+{
+    srs_error_t err;
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_overload_enabled());
+        EXPECT_EQ(100 * SRS_UTIME_MILLISECONDS, conf.get_overload_max_lag());
+        EXPECT_EQ(90, conf.get_overload_max_cpu());
+        EXPECT_EQ(0.3, conf.get_overload_drop_ratio());
+        EXPECT_FALSE(conf.get_vhost_low_priority("__defaultVhost__"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "overload{enabled on;max_lag 50;max_cpu 80;drop_ratio 0.5;}"
+            "vhost v{low_priority on;}"));
+        EXPECT_TRUE(conf.get_overload_enabled());
+        EXPECT_EQ(50 * SRS_UTIME_MILLISECONDS, conf.get_overload_max_lag());
+        EXPECT_EQ(80, conf.get_overload_max_cpu());
+        EXPECT_EQ(0.5, conf.get_overload_drop_ratio());
+        EXPECT_TRUE(conf.get_vhost_low_priority("v"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "overload{lag 50;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_handshake)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(128, conf.get_handshake_dh_pool());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "handshake{dh_pool 0;}"));
+        EXPECT_EQ(0, conf.get_handshake_dh_pool());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "handshake{pool 0;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_admission)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_admission_enabled());
+        EXPECT_EQ(0, conf.get_admission_max_kbps());
+        EXPECT_EQ(0, (int)conf.get_admission_rtmp_redirect().size());
+        EXPECT_EQ(0, (int)conf.get_admission_http_redirect().size());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "admission{enabled on;max_kbps 800000;rtmp_redirect a:1935 b:1935;http_redirect a:8080;}"));
+        EXPECT_TRUE(conf.get_admission_enabled());
+        EXPECT_EQ(800000, conf.get_admission_max_kbps());
+        EXPECT_EQ(2, (int)conf.get_admission_rtmp_redirect().size());
+        EXPECT_EQ(1, (int)conf.get_admission_http_redirect().size());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "admission{redirect a:1935;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_access_log)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_access_log_enabled());
+        EXPECT_STREQ("./objs/access.log", conf.get_access_log_path().c_str());
+        EXPECT_STREQ("json", conf.get_access_log_format().c_str());
+        EXPECT_EQ(1000, conf.get_access_log_rate());
+        EXPECT_EQ(2000, conf.get_access_log_burst());
+        EXPECT_EQ(100, conf.get_vhost_access_log_sample("__defaultVhost__"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "access_log{enabled on;path /tmp/a.log;format binary;rate 0;burst 10;}"
+            "vhost v{access_log_sample 10;}"));
+        EXPECT_TRUE(conf.get_access_log_enabled());
+        EXPECT_STREQ("/tmp/a.log", conf.get_access_log_path().c_str());
+        EXPECT_STREQ("binary", conf.get_access_log_format().c_str());
+        EXPECT_EQ(0, conf.get_access_log_rate());
+        EXPECT_EQ(10, conf.get_access_log_burst());
+        EXPECT_EQ(10, conf.get_vhost_access_log_sample("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "access_log{format text;}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "access_log{sample 10;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_scheduler)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_scheduler_profile());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "scheduler{profile on;}"));
+        EXPECT_TRUE(conf.get_scheduler_profile());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "scheduler{delay on;}"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(65536, conf.get_scheduler_slice());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "scheduler{slice 0;}"));
+        EXPECT_EQ(0, conf.get_scheduler_slice());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "scheduler{slice 1024;}"));
+        EXPECT_EQ(1024, conf.get_scheduler_slice());
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_flight_recorder)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_TRUE(conf.get_flight_recorder_enabled());
+        EXPECT_EQ(65536, conf.get_flight_recorder_events());
+        EXPECT_EQ(1 * SRS_UTIME_MILLISECONDS, conf.get_flight_recorder_threshold());
+        EXPECT_STREQ("./objs/srs.recorder", conf.get_flight_recorder_file().c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "flight_recorder{enabled off;events 1024;threshold 0.5;file /tmp/r;}"));
+        EXPECT_FALSE(conf.get_flight_recorder_enabled());
+        EXPECT_EQ(1024, conf.get_flight_recorder_events());
+        EXPECT_EQ(500, conf.get_flight_recorder_threshold());
+        EXPECT_STREQ("/tmp/r", conf.get_flight_recorder_file().c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "flight_recorder{size 1024;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_transcode_scheduler)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_transcode_scheduler_enabled());
+        EXPECT_EQ(0, conf.get_transcode_scheduler_slots("cpu"));
+        EXPECT_EQ(0, conf.get_transcode_scheduler_slots("nvenc"));
+        EXPECT_EQ(0, conf.get_transcode_scheduler_slots("qsv"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "transcode_scheduler{enabled on;cpu 16;nvenc 3;qsv -1;}"));
+        EXPECT_TRUE(conf.get_transcode_scheduler_enabled());
+        EXPECT_EQ(16, conf.get_transcode_scheduler_slots("cpu"));
+        EXPECT_EQ(3, conf.get_transcode_scheduler_slots("nvenc"));
+        EXPECT_EQ(0, conf.get_transcode_scheduler_slots("qsv"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "transcode_scheduler{gpu 1;}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{transcode{priority 10;group on;engine e{vcodec h264_nvenc;resource nvenc;}}}"));
+        SrsConfDirective* trans = conf.get_transcode("v", "");
+        EXPECT_EQ(10, conf.get_transcode_priority(trans));
+        EXPECT_TRUE(conf.get_transcode_group(trans));
+        EXPECT_FALSE(conf.get_transcode_group(NULL));
+        EXPECT_EQ(0, conf.get_transcode_priority(NULL));
+
+        vector<SrsConfDirective*> engines = conf.get_transcode_engines(trans);
+        ASSERT_EQ(1, (int)engines.size());
+        EXPECT_STREQ("nvenc", conf.get_engine_resource(engines[0]).c_str());
+        EXPECT_STREQ("", conf.get_engine_resource(NULL).c_str());
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckConf_rtsp_client)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(58000, conf.get_rtsp_client_rtp_port_min());
+        EXPECT_EQ(58008, conf.get_rtsp_client_rtp_port_max());
+        EXPECT_EQ(5 * SRS_UTIME_SECONDS, conf.get_rtsp_client_timeout());
+        EXPECT_EQ(16, conf.get_rtsp_client_rtp_reorder_depth());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "rtsp_client{rtp_port_min 60000;rtp_port_max 60100;timeout 3;rtp_reorder_depth 0;}"));
+        EXPECT_EQ(60000, conf.get_rtsp_client_rtp_port_min());
+        EXPECT_EQ(60100, conf.get_rtsp_client_rtp_port_max());
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_rtsp_client_timeout());
+        EXPECT_EQ(0, conf.get_rtsp_client_rtp_reorder_depth());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "rtsp_client{timeout 0;rtp_reorder_depth -1;}"));
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_rtsp_client_timeout());
+        EXPECT_EQ(0, conf.get_rtsp_client_rtp_reorder_depth());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "rtsp_client{rtp_port 58000;}"));
+    }
+}
+
 VOID TEST(ConfigMainTest, CheckConf_http_stream)
 {
     srs_error_t err;
@@ -1971,6 +2557,14 @@ VOID TEST(ConfigUnitTest, CheckDefaultValuesVhost)
 	    EXPECT_EQ(70 * SRS_UTIME_SECONDS, conf.get_dash_timeshift("v"));
     }
 
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_EQ(0, conf.get_dash_chunk_duration(""));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{dash{dash_chunk_duration 0.5;}}"));
+	    EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_dash_chunk_duration("v"));
+    }
+
     if (true) {
 	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
 	    EXPECT_EQ(srs_utime_t(9.9 * SRS_UTIME_SECONDS), conf.get_heartbeat_interval());
@@ -2008,6 +2602,16 @@ VOID TEST(ConfigUnitTest, CheckDefaultValuesVhost)
 	    EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_dvr_duration("v"));
     }
 
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_EQ(0, conf.get_dvr_mp4_fragment(""));
+	    EXPECT_FALSE(conf.get_dvr_mp4_finalize(""));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{dvr{dvr_mp4_fragment 2.5;dvr_mp4_finalize on;}}"));
+	    EXPECT_EQ(2500 * SRS_UTIME_MILLISECONDS, conf.get_dvr_mp4_fragment("v"));
+	    EXPECT_TRUE(conf.get_dvr_mp4_finalize("v"));
+    }
+
     if (true) {
 	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
 	    EXPECT_EQ(0, conf.get_hls_dispose(""));
@@ -2018,6 +2622,10 @@ VOID TEST(ConfigUnitTest, CheckDefaultValuesVhost)
 	    EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_hls_dispose("v"));
 	    EXPECT_EQ(20 * SRS_UTIME_SECONDS, conf.get_hls_fragment("v"));
 	    EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_hls_window("v"));
+	    EXPECT_EQ(0, conf.get_hls_fast_start("v"));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{hls{hls_fast_start 1.5;}}"));
+	    EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, conf.get_hls_fast_start("v"));
     }
 
     if (true) {
@@ -2047,6 +2655,17 @@ VOID TEST(ConfigUnitTest, CheckDefaultValuesVhost)
 	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{http_remux{fast_cache 10;}}"));
 	    EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_vhost_http_remux_fast_cache("v"));
     }
+
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_vhost_http_remux_mp4_fragment(""));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{http_remux{mp4_fragment 0;}}"));
+	    EXPECT_EQ(0, conf.get_vhost_http_remux_mp4_fragment("v"));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{http_remux{mp4_fragment 0.2;}}"));
+	    EXPECT_EQ(200 * SRS_UTIME_MILLISECONDS, conf.get_vhost_http_remux_mp4_fragment("v"));
+    }
 }
 
 VOID TEST(ConfigUnitTest, CheckDefaultValuesGlobal)
@@ -2156,6 +2775,51 @@ VOID TEST(ConfigUnitTest, DirectiveEquals)
     }
 }
 
+VOID TEST(ConfigUnitTest, DirectiveFingerprint)
+{
+    srs_error_t err;
+
+    EXPECT_EQ(0, (int)srs_directive_fingerprint(NULL));
+
+    if (true) {
+        MockSrsConfig a, b;
+        HELPER_ASSERT_SUCCESS(a.parse(_MIN_OK_CONF "vhost v{hls{enabled on;hls_fragment 10;}}"));
+        HELPER_ASSERT_SUCCESS(b.parse(_MIN_OK_CONF "vhost   v {\n hls {enabled on; hls_fragment 10;}\n}"));
+        EXPECT_EQ(srs_directive_fingerprint(a.get_vhost("v")), srs_directive_fingerprint(b.get_vhost("v")));
+        EXPECT_NE(0, (int)srs_directive_fingerprint(a.get_vhost("v")));
+    }
+
+    if (true) {
+        MockSrsConfig a, b;
+        HELPER_ASSERT_SUCCESS(a.parse(_MIN_OK_CONF "vhost v{hls{enabled on;hls_fragment 10;}}"));
+        HELPER_ASSERT_SUCCESS(b.parse(_MIN_OK_CONF "vhost v{hls{enabled on;hls_fragment 11;}}"));
+        EXPECT_NE(srs_directive_fingerprint(a.get_vhost("v")), srs_directive_fingerprint(b.get_vhost("v")));
+    }
+
+    // The args and children are separated.
+    if (true) {
+        MockSrsConfig a, b;
+        HELPER_ASSERT_SUCCESS(a.parse(_MIN_OK_CONF "vhost v{refer a b;}"));
+        HELPER_ASSERT_SUCCESS(b.parse(_MIN_OK_CONF "vhost v{refer ab;}"));
+        EXPECT_NE(srs_directive_fingerprint(a.get_vhost("v")), srs_directive_fingerprint(b.get_vhost("v")));
+    }
+
+    if (true) {
+        SrsConfDirective a, b;
+        a.get_or_create("b"); a.get_or_create("c");
+        b.get_or_create("b")->get_or_create("c");
+        EXPECT_NE(srs_directive_fingerprint(&a), srs_directive_fingerprint(&b));
+    }
+
+    // The order of children matters.
+    if (true) {
+        SrsConfDirective a, b;
+        a.get_or_create("b"); a.get_or_create("c");
+        b.get_or_create("c"); b.get_or_create("b");
+        EXPECT_NE(srs_directive_fingerprint(&a), srs_directive_fingerprint(&b));
+    }
+}
+
 VOID TEST(ConfigUnitTest, OperatorEquals)
 {
     EXPECT_TRUE(srs_config_hls_is_on_error_ignore("ignore"));
@@ -2759,6 +3423,30 @@ VOID TEST(ConfigMainTest, CheckGlobalConfig)
         MockSrsConfig conf;
         HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "daemon on; asprocess on;"));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(0, conf.get_grace_drain_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "grace_drain_timeout 30000;"));
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_grace_drain_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(0, conf.get_ingest_start_jitter());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "ingest_start_jitter 5000;"));
+        EXPECT_EQ(5 * SRS_UTIME_SECONDS, conf.get_ingest_start_jitter());
+    }
 }
 
 VOID TEST(ConfigMainTest, CheckStreamCaster)
@@ -2833,6 +3521,16 @@ VOID TEST(ConfigMainTest, CheckStreamCaster)
         EXPECT_STREQ("xxx", conf.get_stream_caster_output(arr.at(0)).c_str());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stream_caster {capture ./mpegts.cap;}"));
+        
+        vector<SrsConfDirective*> arr = conf.get_stream_casters();
+        ASSERT_EQ(1, arr.size());
+        
+        EXPECT_STREQ("./mpegts.cap", conf.get_stream_caster_capture(arr.at(0)).c_str());
+    }
+    
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stream_caster;"));
@@ -2892,6 +3590,17 @@ VOID TEST(ConfigMainTest, CheckStreamCaster)
 
         EXPECT_EQ(8080, conf.get_stream_caster_rtp_port_max(arr.at(0)));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stream_caster; stream_caster {rtp_reorder_depth 0;}"));
+
+        vector<SrsConfDirective*> arr = conf.get_stream_casters();
+        ASSERT_EQ(2, arr.size());
+
+        EXPECT_EQ(16, conf.get_stream_caster_rtp_reorder_depth(arr.at(0)));
+        EXPECT_EQ(0, conf.get_stream_caster_rtp_reorder_depth(arr.at(1)));
+    }
 }
 
 VOID TEST(ConfigMainTest, CheckVhostConfig2)
@@ -2960,6 +3669,34 @@ VOID TEST(ConfigMainTest, CheckVhostConfig2)
         EXPECT_EQ(10000, conf.get_publish_1stpkt_timeout("ossrs.net"));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{publish {latency_marker 1000;}}"));
+        EXPECT_EQ(0, conf.get_publish_latency_marker("__defaultVhost__"));
+        EXPECT_EQ(1000 * SRS_UTIME_MILLISECONDS, conf.get_publish_latency_marker("ossrs.net"));
+        EXPECT_EQ(1000 * SRS_UTIME_MILLISECONDS, conf.get_vhost_snapshot("ossrs.net")->latency_marker);
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{publish {reconnect_grace 2000;}}"));
+        EXPECT_EQ(0, conf.get_publish_reconnect_grace("__defaultVhost__"));
+        EXPECT_EQ(2000 * SRS_UTIME_MILLISECONDS, conf.get_publish_reconnect_grace("ossrs.net"));
+        EXPECT_EQ(2000 * SRS_UTIME_MILLISECONDS, conf.get_vhost_snapshot("ossrs.net")->reconnect_grace);
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{publish {reconnect_grace 2000;}}"));
+        EXPECT_TRUE(conf.get_publish_capture("ossrs.net").empty());
+        EXPECT_FALSE(conf.get_publish_capture_any());
+        
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{publish {capture ./[stream].cap;}}"));
+        EXPECT_TRUE(conf.get_publish_capture("__defaultVhost__").empty());
+        EXPECT_STREQ("./[stream].cap", conf.get_publish_capture("ossrs.net").c_str());
+        EXPECT_TRUE(conf.get_publish_capture_any());
+    }
+    
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play {reduce_sequence_header on;}}"));
@@ -2990,6 +3727,59 @@ VOID TEST(ConfigMainTest, CheckVhostConfig2)
         EXPECT_EQ(10000, conf.get_mw_sleep("ossrs.net"));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{mw_adaptive on;}}"));
+        EXPECT_TRUE(conf.get_mw_adaptive("ossrs.net"));
+        EXPECT_FALSE(conf.get_mw_adaptive("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{mw_aggregate on;}}"));
+        EXPECT_TRUE(conf.get_mw_aggregate("ossrs.net"));
+        EXPECT_FALSE(conf.get_mw_aggregate("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{tcp_congestion bbr; pacing_factor 1.5;}}"));
+        EXPECT_STREQ("bbr", conf.get_tcp_congestion("ossrs.net").c_str());
+        EXPECT_EQ(1.5, conf.get_pacing_factor("ossrs.net"));
+        EXPECT_TRUE(conf.get_tcp_congestion("v").empty());
+        EXPECT_EQ(0, conf.get_pacing_factor("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{notsent_lowat 32;}}"));
+        EXPECT_EQ(32 * 1024, conf.get_play_notsent_lowat("ossrs.net"));
+        EXPECT_EQ(0, conf.get_play_notsent_lowat("v"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{drop_ratio 0.5;}} vhost v{play{drop_ratio 1.5;}}"));
+        EXPECT_EQ(0.5, conf.get_drop_ratio("ossrs.net"));
+        EXPECT_EQ(0, conf.get_drop_ratio("v"));
+        EXPECT_EQ(0, conf.get_drop_ratio("none"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{resume 10;}}"));
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_vhost_play_resume("ossrs.net"));
+        EXPECT_EQ(0, conf.get_vhost_play_resume("none"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{play{egress_share 30;}} vhost v{play{egress_share 130;}}"));
+        EXPECT_EQ(30, conf.get_vhost_egress_share("ossrs.net"));
+        EXPECT_EQ(0, conf.get_vhost_egress_share("v"));
+        EXPECT_EQ(0, conf.get_vhost_egress_share("none"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{publish{mr_latency 10;}}"));
@@ -3131,8 +3921,17 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_TRUE(conf.get_vhost_edge_origin("ossrs.net") == NULL);
         EXPECT_FALSE(conf.get_vhost_edge_token_traverse("ossrs.net"));
         EXPECT_STREQ("[vhost]", conf.get_vhost_edge_transform_vhost("ossrs.net").c_str());
+        EXPECT_STREQ("round_robin", conf.get_vhost_edge_origin_balance("ossrs.net").c_str());
+        EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, conf.get_vhost_edge_origin_stagger("ossrs.net"));
+        EXPECT_STREQ("rtmp", conf.get_vhost_edge_protocol("ossrs.net").c_str());
+        EXPECT_EQ(2, conf.get_vhost_edge_mux_connections("ossrs.net"));
+        EXPECT_EQ(0, (int)conf.get_vhost_edge_peers("ossrs.net").size());
+        EXPECT_EQ(0, conf.get_vhost_edge_publish_window("ossrs.net"));
+        EXPECT_EQ(0, conf.get_vhost_edge_publish_inflight("ossrs.net"));
+        EXPECT_FALSE(conf.get_vhost_edge_publish_rtt_chunk("ossrs.net"));
         EXPECT_FALSE(conf.get_vhost_origin_cluster("ossrs.net"));
         EXPECT_EQ(0, conf.get_vhost_coworkers("ossrs.net").size());
+        EXPECT_EQ(0, (int)conf.get_vhost_standby("ossrs.net").size());
         EXPECT_FALSE(conf.get_security_enabled("ossrs.net"));
         EXPECT_TRUE(conf.get_security_rules("ossrs.net") == NULL);
     }
@@ -3155,6 +3954,12 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_EQ(1, conf.get_vhost_coworkers("ossrs.net").size());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{standby 127.0.0.1:19350 127.0.0.1:19351;}}"));
+        EXPECT_EQ(2, (int)conf.get_vhost_standby("ossrs.net").size());
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_cluster on;}}"));
@@ -3167,6 +3972,60 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_FALSE(conf.get_vhost_edge_transform_vhost("ossrs.net").empty());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_balance consistent_hash;}}"));
+        EXPECT_STREQ("consistent_hash", conf.get_vhost_edge_origin_balance("ossrs.net").c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_stagger 0;}}"));
+        EXPECT_EQ(0, conf.get_vhost_edge_origin_stagger("ossrs.net"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{protocol flv;}}"));
+        EXPECT_STREQ("flv", conf.get_vhost_edge_protocol("ossrs.net").c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{protocol mux; mux_connections 4;}}"));
+        EXPECT_STREQ("mux", conf.get_vhost_edge_protocol("ossrs.net").c_str());
+        EXPECT_EQ(4, conf.get_vhost_edge_mux_connections("ossrs.net"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{mux_connections 0;}}"));
+        EXPECT_EQ(1, conf.get_vhost_edge_mux_connections("ossrs.net"));
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{peers 127.0.0.1:1985 127.0.0.1:1986;}}"));
+        EXPECT_EQ(2, (int)conf.get_vhost_edge_peers("ossrs.net").size());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{hls_origin 127.0.0.1:8080 127.0.0.1:8081; hls_playlist_ttl 500;}}"));
+        EXPECT_EQ(0, (int)conf.get_vhost_edge_hls_origin("__defaultVhost__").size());
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_vhost_edge_hls_playlist_ttl("__defaultVhost__"));
+        EXPECT_EQ(2, (int)conf.get_vhost_edge_hls_origin("ossrs.net").size());
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_vhost_edge_hls_playlist_ttl("ossrs.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{publish_window 2500000; publish_inflight 10000000; publish_rtt_chunk on;}}"));
+        EXPECT_EQ(2500000, conf.get_vhost_edge_publish_window("ossrs.net"));
+        EXPECT_EQ(10000000, conf.get_vhost_edge_publish_inflight("ossrs.net"));
+        EXPECT_TRUE(conf.get_vhost_edge_publish_rtt_chunk("ossrs.net"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{token_traverse on;}}"));
@@ -3221,6 +4080,15 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_TRUE(conf.get_vhost_on_hls("ossrs.net") != NULL);
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{http_hooks{cache_ttl 3; batch_interval 0.5;}}"));
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_vhost_http_hooks_cache_ttl("ossrs.net"));
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_vhost_http_hooks_batch_interval("ossrs.net"));
+        EXPECT_EQ(0, conf.get_vhost_http_hooks_cache_ttl("v"));
+        EXPECT_EQ(0, conf.get_vhost_http_hooks_batch_interval("v"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{http_hooks{on_dvr xxx;}}"));
@@ -3506,6 +4374,26 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_STREQ("xxx4", conf.get_ingest_input_url(conf.get_ingest_by_id("ossrs.net", "xxx")).c_str());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{ingest xxx{enabled on;input{type hls;url xxx4;}}ingest yyy{input{type http_ts;prefetch 0;}}ingest zzz{input{type hls;prefetch 5;}}}"));
+        EXPECT_TRUE(srs_config_ingest_is_hls(conf.get_ingest_input_type(conf.get_ingest_by_id("ossrs.net", "xxx"))));
+        EXPECT_TRUE(srs_config_ingest_is_http_ts(conf.get_ingest_input_type(conf.get_ingest_by_id("ossrs.net", "yyy"))));
+        EXPECT_EQ(3, conf.get_ingest_input_prefetch(conf.get_ingest_by_id("ossrs.net", "xxx")));
+        EXPECT_EQ(1, conf.get_ingest_input_prefetch(conf.get_ingest_by_id("ossrs.net", "yyy")));
+        EXPECT_EQ(5, conf.get_ingest_input_prefetch(conf.get_ingest_by_id("ossrs.net", "zzz")));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{ingest xxx{input{type rtsp;}}ingest yyy{input{type rtsp;transport tcp;}}}"));
+        EXPECT_TRUE(srs_config_ingest_is_rtsp(conf.get_ingest_input_type(conf.get_ingest_by_id("ossrs.net", "xxx"))));
+        EXPECT_FALSE(srs_config_ingest_is_rtsp("stream"));
+        EXPECT_FALSE(conf.get_ingest_input_rtsp_tcp(conf.get_ingest_by_id("ossrs.net", "xxx")));
+        EXPECT_TRUE(conf.get_ingest_input_rtsp_tcp(conf.get_ingest_by_id("ossrs.net", "yyy")));
+        EXPECT_FALSE(conf.get_ingest_input_rtsp_tcp(NULL));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "srs_log_tank xxx;srs_log_level xxx2;srs_log_file xxx3;ff_log_dir xxx4; ff_log_level xxx5;"));
@@ -3566,6 +4454,58 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_STREQ("xxx3", conf.get_hls_key_url("ossrs.net").c_str());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_keys on;}}"));
+        EXPECT_FALSE(conf.get_hls_key_offload("ossrs.net"));
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_keys on;hls_key_offload on;}}"));
+        EXPECT_TRUE(conf.get_hls_key_offload("ossrs.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{enabled on;}}"));
+        EXPECT_FALSE(conf.get_hls_checksum("ossrs.net"));
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_checksum on;}}"));
+        EXPECT_TRUE(conf.get_hls_checksum("ossrs.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{enabled on;}}"));
+        EXPECT_FALSE(conf.get_hls_memory("ossrs.net"));
+        EXPECT_TRUE(conf.get_hls_memory_archive("ossrs.net"));
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_memory on;hls_memory_archive off;}}"));
+        EXPECT_TRUE(conf.get_hls_memory("ossrs.net"));
+        EXPECT_FALSE(conf.get_hls_memory_archive("ossrs.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{enabled on;}}"));
+        EXPECT_FALSE(conf.get_hls_ll("ossrs.net"));
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_hls_ll_part("ossrs.net"));
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_ll on;hls_ll_part 0.5;}}"));
+        EXPECT_TRUE(conf.get_hls_ll("ossrs.net"));
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_hls_ll_part("ossrs.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{enabled on;}}"));
+        EXPECT_TRUE(conf.get_hls_variants("ossrs.net").empty());
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_variants _ld:500000 _hd:1500000:1280x720;}}"));
+        vector<string> variants = conf.get_hls_variants("ossrs.net");
+        ASSERT_EQ(2, (int)variants.size());
+        EXPECT_STREQ("_ld:500000", variants.at(0).c_str());
+        EXPECT_STREQ("_hd:1500000:1280x720", variants.at(1).c_str());
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hds{enabled on;hds_path xxx;hds_fragment 10;hds_window 10;}}"));
@@ -3599,6 +4539,31 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_TRUE(conf.get_raw_api_allow_update());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{enabled on;}"));
+        EXPECT_FALSE(conf.get_snapshot_enabled());
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_snapshot_interval());
+        EXPECT_TRUE(conf.get_snapshot_ffmpeg().empty());
+        EXPECT_EQ(2, conf.get_snapshot_decoders());
+        EXPECT_EQ(5 * SRS_UTIME_SECONDS, conf.get_snapshot_timeout());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{enabled on;snapshot {enabled on;interval 0.5;ffmpeg xxx;decoders 4;timeout 3;}}"));
+        EXPECT_TRUE(conf.get_snapshot_enabled());
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_snapshot_interval());
+        EXPECT_STREQ("xxx", conf.get_snapshot_ffmpeg().c_str());
+        EXPECT_EQ(4, conf.get_snapshot_decoders());
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_snapshot_timeout());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "http_api{snapshot {xxx on;}}"));
+    }
+    
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_server{enabled on;listen xxx;dir xxx2;crossdomain on;}"));
@@ -3606,6 +4571,29 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_STREQ("xxx", conf.get_http_stream_listen().c_str());
         EXPECT_STREQ("xxx2", conf.get_http_stream_dir().c_str());
         EXPECT_TRUE(conf.get_http_stream_crossdomain());
+        EXPECT_EQ(0, conf.get_http_stream_segment_max_age());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_server{segment_max_age 3600;}"));
+        EXPECT_EQ(3600, conf.get_http_stream_segment_max_age());
+        EXPECT_FALSE(conf.get_http_stream_lazy_mount());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_server{lazy_mount on;}"));
+        EXPECT_TRUE(conf.get_http_stream_lazy_mount());
+        EXPECT_FALSE(conf.get_http_stream_http2());
+        EXPECT_EQ(100, conf.get_http_stream_http2_max_streams());
+    }
+    
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_server{http2 on;http2_max_streams 16;}"));
+        EXPECT_TRUE(conf.get_http_stream_http2());
+        EXPECT_EQ(16, conf.get_http_stream_http2_max_streams());
     }
 
     if (true) {
@@ -3642,3 +4630,148 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
     }
 }
 
+
+VOID TEST(ConfigMainTest, CheckVhostSnapshot)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{play{atc on;gop_cache off;queue_length 20;}} vhost v{play{atc off;}}"));
+
+        SrsVhostSnapshot* snapshot = conf.get_vhost_snapshot("v");
+        EXPECT_TRUE(snapshot->atc);
+        EXPECT_FALSE(snapshot->gop_cache);
+        EXPECT_EQ(20 * SRS_UTIME_SECONDS, snapshot->queue_length);
+        EXPECT_TRUE(snapshot == conf.get_vhost_snapshot("v"));
+
+        // Never match the unknown vhost without default vhost.
+        EXPECT_TRUE(conf.get_vhost("x") == NULL);
+        snapshot = conf.get_vhost_snapshot("x");
+        EXPECT_FALSE(snapshot->atc);
+        EXPECT_TRUE(snapshot->gop_cache);
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{play{mw_latency 500;}} vhost v{}"));
+
+        // The unknown vhost share the default vhost.
+        SrsVhostSnapshot* snapshot = conf.get_vhost_snapshot("x");
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, snapshot->mw_sleep);
+        EXPECT_TRUE(snapshot == conf.get_vhost_snapshot("y"));
+        EXPECT_TRUE(snapshot != conf.get_vhost_snapshot("v"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckVhostGopCache)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{}"));
+        EXPECT_EQ(0, conf.get_gop_cache_max_duration("v"));
+        EXPECT_EQ(0, conf.get_gop_cache_max_size("v"));
+        EXPECT_EQ(0, conf.get_gop_cache_fast_start("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{play{gop_cache_max_duration 3000;gop_cache_max_size 1024;gop_cache_fast_start 500;}}"));
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_gop_cache_max_duration("v"));
+        EXPECT_EQ(1024 * 1024, conf.get_gop_cache_max_size("v"));
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, conf.get_gop_cache_fast_start("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{}"));
+        EXPECT_EQ(0, conf.get_time_shift("v"));
+        EXPECT_EQ(0, conf.get_time_shift_max_size("v"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{play{time_shift 300;time_shift_max_size 1024;}}"));
+        EXPECT_EQ(300 * SRS_UTIME_SECONDS, conf.get_time_shift("v"));
+        EXPECT_EQ(1024 * 1024, conf.get_time_shift_max_size("v"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckVhostAbr)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{abr{enabled on;renditions _sd _ld;down_queue 1.5;up_stable 10;}} vhost x{}"));
+        EXPECT_TRUE(conf.get_vhost_abr_enabled("v"));
+        EXPECT_EQ(2, (int)conf.get_vhost_abr_renditions("v").size());
+        EXPECT_STREQ("_ld", conf.get_vhost_abr_renditions("v").at(1).c_str());
+        EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, conf.get_vhost_abr_down_queue("v"));
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_vhost_abr_up_stable("v"));
+
+        EXPECT_FALSE(conf.get_vhost_abr_enabled("x"));
+        EXPECT_TRUE(conf.get_vhost_abr_renditions("x").empty());
+        EXPECT_EQ(2 * SRS_UTIME_SECONDS, conf.get_vhost_abr_down_queue("x"));
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_vhost_abr_up_stable("x"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "vhost v{abr{xxx 1;}}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckFanout)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_fanout_enabled());
+        EXPECT_EQ(4, conf.get_fanout_threads());
+        EXPECT_EQ(4 * 1024 * 1024, conf.get_fanout_max_pending());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "fanout{enabled on;threads 8;max_pending 1024;}"));
+        EXPECT_TRUE(conf.get_fanout_enabled());
+        EXPECT_EQ(8, conf.get_fanout_threads());
+        EXPECT_EQ(1024 * 1024, conf.get_fanout_max_pending());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "fanout{xxx 1;}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CheckAsyncCall)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(4, conf.get_async_call_lanes());
+        EXPECT_EQ(1024, conf.get_async_call_max_tasks());
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_async_call_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "async_call{lanes 8;max_tasks 0;timeout 5;}"));
+        EXPECT_EQ(8, conf.get_async_call_lanes());
+        EXPECT_EQ(0, conf.get_async_call_max_tasks());
+        EXPECT_EQ(5 * SRS_UTIME_SECONDS, conf.get_async_call_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "async_call{xxx 1;}"));
+    }
+}
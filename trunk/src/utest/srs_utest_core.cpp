@@ -25,6 +25,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace std;
 
 #include <srs_core_autofree.hpp>
+#include <srs_core_mem_watch.hpp>
+
+#include <pthread.h>
+#include <vector>
 
 VOID TEST(CoreAutoFreeTest, Free)
 {
@@ -91,3 +95,174 @@ VOID TEST(CoreLogger, CheckVsnprintf)
     }
 }
 
+
+VOID TEST(CoreMemoryPool, AllocFree)
+{
+    // The size class by size.
+    if (true) {
+        SrsMemoryPoolStat* s0 = srs_pool_stat(0);
+        SrsMemoryPoolStat* s1 = srs_pool_stat(1);
+        EXPECT_EQ(32, s0->block_size);
+        EXPECT_EQ(64, s1->block_size);
+        EXPECT_TRUE(srs_pool_stat(-1) == NULL);
+        EXPECT_TRUE(srs_pool_stat(SRS_MEMORY_POOL_CLASSES) == NULL);
+
+        int64_t nn_alloc = s1->nn_alloc;
+        void* p = srs_pool_alloc(33);
+        EXPECT_EQ(nn_alloc + 1, s1->nn_alloc);
+        srs_pool_free(p);
+    }
+
+    // Reuse the freed block.
+    if (true) {
+        SrsMemoryPoolStat* stat = srs_pool_stat(2);
+
+        void* p = srs_pool_alloc(100);
+        srs_pool_free(p);
+        int nn_cached = stat->nn_cached;
+        int64_t nn_reuse = stat->nn_reuse;
+
+        void* q = srs_pool_alloc(128);
+        EXPECT_TRUE(p == q);
+        EXPECT_EQ(nn_reuse + 1, stat->nn_reuse);
+        EXPECT_EQ(nn_cached - 1, stat->nn_cached);
+        srs_pool_free(q);
+    }
+
+    // Never cache the large block.
+    if (true) {
+        void* p = srs_pool_alloc(1024 * 1024);
+        memset(p, 0, 1024 * 1024);
+        srs_pool_free(p);
+        srs_pool_free(NULL);
+    }
+}
+
+// The arena is enabled for the thread, so run in a new thread to not change the pool of utest.
+void* mock_arena_thread(void* arg)
+{
+    bool* ok = (bool*)arg;
+
+    if (srs_pool_enable_arena(SrsMemoryHugePagesTransparent, -1) != 0) {
+        return NULL;
+    }
+    if (srs_pool_arena_bytes() != SRS_MEMORY_ARENA_CHUNK) {
+        return NULL;
+    }
+
+    // The blocks are carved from the chunk, one by one.
+    char* p = (char*)srs_pool_alloc(1000);
+    char* q = (char*)srs_pool_alloc(1000);
+    if (q - p != 1024 + 16) {
+        return NULL;
+    }
+    memset(p, 0, 1000);
+
+    // Always recycle the blocks of arena, even exceed the max cached bytes.
+    SrsMemoryPoolStat* stat = srs_pool_stat(11);
+    std::vector<void*> blocks;
+    for (int i = 0; i < 100; i++) {
+        blocks.push_back(srs_pool_alloc(64 * 1024));
+    }
+    for (int i = 0; i < (int)blocks.size(); i++) {
+        srs_pool_free(blocks.at(i));
+    }
+    if (stat->nn_cached != 100 || stat->nn_recycle != 100) {
+        return NULL;
+    }
+
+    // The chunks are mapped when the chunk is full.
+    if (srs_pool_arena_bytes() != 4 * SRS_MEMORY_ARENA_CHUNK) {
+        return NULL;
+    }
+
+    // Never use arena for the large block.
+    void* large = srs_pool_alloc(1024 * 1024);
+    srs_pool_free(large);
+    if (srs_pool_arena_bytes() != 4 * SRS_MEMORY_ARENA_CHUNK) {
+        return NULL;
+    }
+
+    srs_pool_free(p);
+    srs_pool_free(q);
+
+    *ok = true;
+    return NULL;
+}
+
+VOID TEST(CoreMemoryPool, Arena)
+{
+    EXPECT_EQ(0, srs_pool_arena_bytes());
+
+    bool ok = false;
+    pthread_t trd;
+    EXPECT_EQ(0, pthread_create(&trd, NULL, mock_arena_thread, &ok));
+    pthread_join(trd, NULL);
+    EXPECT_TRUE(ok);
+
+    // The arena of other thread is not changed.
+    EXPECT_EQ(0, srs_pool_arena_bytes());
+}
+
+VOID TEST(CoreMemoryUsage, Account)
+{
+    SrsMemoryStat* global = srs_memory_global();
+    int64_t nn_global = global->bytes[SrsMemoryQueue];
+
+    // Without stream, only report to global.
+    if (true) {
+        SrsMemoryUsage usage(SrsMemoryQueue);
+        usage.add(100);
+        usage.add(-30);
+        EXPECT_EQ(70, usage.get());
+        EXPECT_EQ(nn_global + 70, global->bytes[SrsMemoryQueue]);
+    }
+    EXPECT_EQ(nn_global, global->bytes[SrsMemoryQueue]);
+
+    // Move the bytes when attach or detach the stream.
+    if (true) {
+        SrsMemoryStat s0, s1;
+        SrsMemoryUsage usage(SrsMemoryQueue);
+        usage.update(100);
+
+        usage.set_stat(&s0);
+        EXPECT_EQ(100, s0.bytes[SrsMemoryQueue]);
+        EXPECT_EQ(100, s0.total());
+
+        usage.update(40);
+        EXPECT_EQ(40, s0.bytes[SrsMemoryQueue]);
+        EXPECT_EQ(nn_global + 40, global->bytes[SrsMemoryQueue]);
+
+        usage.set_stat(&s1);
+        EXPECT_EQ(0, s0.bytes[SrsMemoryQueue]);
+        EXPECT_EQ(40, s1.bytes[SrsMemoryQueue]);
+
+        usage.set_stat(NULL);
+        EXPECT_EQ(0, s1.bytes[SrsMemoryQueue]);
+    }
+    EXPECT_EQ(nn_global, global->bytes[SrsMemoryQueue]);
+
+    EXPECT_STREQ("gop", srs_memory_type2str(SrsMemoryGopCache));
+    EXPECT_STREQ("recv", srs_memory_type2str(SrsMemoryRecvBuffer));
+    EXPECT_STREQ("play_recv", srs_memory_type2str(SrsMemoryPlayBuffer));
+    EXPECT_STREQ("protocol", srs_memory_type2str(SrsMemoryProtocolCache));
+    EXPECT_STREQ("statistic", srs_memory_type2str(SrsMemoryStatistic));
+
+    // Move the bytes when change the type, for example, the recv buffer of player.
+    if (true) {
+        int64_t nn_recv = global->bytes[SrsMemoryRecvBuffer];
+        int64_t nn_play = global->bytes[SrsMemoryPlayBuffer];
+
+        SrsMemoryStat s0;
+        SrsMemoryUsage usage(SrsMemoryRecvBuffer);
+        usage.set_stat(&s0);
+        usage.update(100);
+
+        usage.set_type(SrsMemoryPlayBuffer);
+        EXPECT_EQ(0, s0.bytes[SrsMemoryRecvBuffer]);
+        EXPECT_EQ(100, s0.bytes[SrsMemoryPlayBuffer]);
+        EXPECT_EQ(nn_recv, global->bytes[SrsMemoryRecvBuffer]);
+        EXPECT_EQ(nn_play + 100, global->bytes[SrsMemoryPlayBuffer]);
+        usage.set_stat(NULL);
+    }
+}
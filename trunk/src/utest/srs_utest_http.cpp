@@ -23,16 +23,27 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_utest_http.hpp>
 
 #include <sstream>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_http_stack.hpp>
+#include <srs_http2_stack.hpp>
 #include <srs_service_http_conn.hpp>
 #include <srs_utest_protocol.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_buffer.hpp>
 #include <srs_utest_kernel.hpp>
 #include <srs_app_http_static.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_dash.hpp>
+#include <srs_app_http_stream.hpp>
+#include <srs_app_http2.hpp>
+#include <srs_core_autofree.hpp>
 #include <srs_service_utility.hpp>
 
 class MockMSegmentsReader : public ISrsReader
@@ -347,6 +358,81 @@ VOID TEST(ProtocolHTTPTest, ResponseWriter)
     }
 }
 
+class MockSendfileIO : public MockBufferIO, public ISrsSendfileWriter
+{
+public:
+    MockSendfileIO() {
+    }
+    virtual ~MockSendfileIO() {
+    }
+public:
+    virtual srs_error_t sendfile(int fd, off_t* offset, size_t count, ssize_t* nwrite) {
+        char buf[1024];
+        ssize_t nn = ::pread(fd, buf, srs_min(count, sizeof(buf)), *offset);
+        if (nn <= 0) {
+            return srs_error_new(-1, "pread");
+        }
+        *offset += nn;
+        out_buffer.append(buf, (int)nn);
+        if (nwrite) {
+            *nwrite = nn;
+        }
+        return srs_success;
+    }
+};
+
+VOID TEST(ProtocolHTTPTest, ResponseWriterSendfile)
+{
+    srs_error_t err;
+
+    string path = "/tmp/srs-utest-sendfile.txt";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(path));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"Hello, world!", 13, NULL));
+    }
+
+    SrsFileReader fr;
+    HELPER_ASSERT_SUCCESS(fr.open(path));
+    ASSERT_TRUE(fr.get_fd() > 0);
+
+    // The io without sendfile, should copy the body.
+    if (true) {
+        MockBufferIO io;
+        SrsHttpResponseWriter w(&io);
+        w.header()->set_content_length(6);
+        w.write_header(200);
+        EXPECT_FALSE(w.sendfile_enabled());
+    }
+
+    // The chunked response, should copy the body.
+    if (true) {
+        MockSendfileIO io;
+        SrsHttpResponseWriter w(&io);
+        w.write_header(200);
+        EXPECT_FALSE(w.sendfile_enabled());
+    }
+
+    // Send part of file with content-length.
+    if (true) {
+        MockSendfileIO io;
+        SrsHttpResponseWriter w(&io);
+        w.header()->set_content_length(6);
+        w.write_header(200);
+        ASSERT_TRUE(w.sendfile_enabled());
+        HELPER_EXPECT_SUCCESS(w.sendfile(fr.get_fd(), 7, 6));
+
+        string av = HELPER_BUFFER2STR(&io.out_buffer);
+        EXPECT_TRUE(av.find("Content-Length: 6") != string::npos);
+        EXPECT_STREQ("world!", av.substr(av.length() - 6).c_str());
+
+        // Overflow the content-length.
+        HELPER_EXPECT_FAILED(w.sendfile(fr.get_fd(), 0, 1));
+    }
+
+    ::unlink(path.c_str());
+}
+
 VOID TEST(ProtocolHTTPTest, ChunkSmallBuffer)
 {
     srs_error_t err;
@@ -423,6 +509,49 @@ VOID TEST(ProtocolHTTPTest, ChunkSmallBuffer)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, ChunkReadSlice)
+{
+    srs_error_t err;
+
+    // The slice is in the buffer of connection, and never crosses the chunk.
+    if (true) {
+        MockMSegmentsReader io;
+        io.append(mock_http_response2(200, "05\r\n"));
+        io.append("Hello\r\n08\r\n, world!\r\n");
+        io.append("0\r\n\r\n");
+
+        SrsHttpParser hp; HELPER_ASSERT_SUCCESS(hp.initialize(HTTP_RESPONSE, false));
+        ISrsHttpMessage* msg = NULL; HELPER_ASSERT_SUCCESS(hp.parse_message(&io, &msg));
+
+        SrsHttpResponseReader* r = dynamic_cast<SrsHttpResponseReader*>(msg->body_reader());
+        ASSERT_TRUE(r != NULL);
+
+        char* p = NULL; ssize_t nread = 0;
+        HELPER_ASSERT_SUCCESS(r->read_slice(32, &p, &nread));
+        EXPECT_EQ(5, nread);
+        EXPECT_EQ(0, memcmp(p, "Hello", 5));
+
+        HELPER_ASSERT_SUCCESS(r->read_slice(3, &p, &nread));
+        EXPECT_EQ(3, nread);
+        EXPECT_EQ(0, memcmp(p, ", w", 3));
+
+        HELPER_ASSERT_SUCCESS(r->read_slice(32, &p, &nread));
+        EXPECT_EQ(5, nread);
+        EXPECT_EQ(0, memcmp(p, "orld!", 5));
+        EXPECT_FALSE(r->eof());
+
+        HELPER_ASSERT_SUCCESS(r->read_slice(32, &p, &nread));
+        EXPECT_EQ(0, nread);
+        EXPECT_TRUE(r->eof());
+
+        err = r->read_slice(32, &p, &nread);
+        EXPECT_EQ(ERROR_HTTP_RESPONSE_EOF, srs_error_code(err));
+        srs_freep(err);
+
+        srs_freep(msg);
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, ClientSmallBuffer)
 {
     srs_error_t err;
@@ -598,6 +727,56 @@ VOID TEST(ProtocolHTTPTest, HTTPHeader)
     srs_freep(o);
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPHeaderFlatTable)
+{
+    SrsHttpHeader h;
+    h.set("Server", "SRS");
+    h.set("Content-Type", "text/plain");
+    h.set("Server", "SRS/3");
+    EXPECT_EQ(2, h.count());
+    EXPECT_STREQ("SRS/3", h.get("Server").c_str());
+
+    // Write in the order of set, and overwrite in place.
+    stringstream ss;
+    h.write(ss);
+    EXPECT_STREQ("Server: SRS/3\r\nContent-Type: text/plain\r\n", ss.str().c_str());
+
+    h.clear();
+    EXPECT_EQ(0, h.count());
+    EXPECT_TRUE(h.get("Server").empty());
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPParserKeepAliveRequests)
+{
+    srs_error_t err;
+
+    string req = "GET /live/livestream.flv?vhost=ossrs.net&token=xxx HTTP/1.1\r\n"
+        "Host: ossrs.net\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\nAccept: */*\r\n"
+        "Accept-Encoding: identity\r\nReferer: http://ossrs.net/players/srs_player.html\r\n"
+        "Connection: keep-alive\r\n\r\n";
+
+    MockBufferIO io;
+
+    SrsHttpParser hp;
+    HELPER_ASSERT_SUCCESS(hp.initialize(HTTP_REQUEST, false));
+
+    // See the http_parse_request of srs_ubench for the throughput.
+    for (int i = 0; i < 3; i++) {
+        // Like a keep-alive connection, the next request arrives after the previous one is parsed.
+        io.append(req);
+
+        ISrsHttpMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(hp.parse_message(&io, &msg));
+        SrsAutoFree(ISrsHttpMessage, msg);
+
+        EXPECT_EQ(6, msg->header()->count());
+        EXPECT_STREQ("ossrs.net", msg->header()->get("Host").c_str());
+        EXPECT_STREQ("keep-alive", msg->header()->get("Connection").c_str());
+        EXPECT_STREQ("/live/livestream.flv", msg->path().c_str());
+        EXPECT_STREQ("xxx", msg->query_get("token").c_str());
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPServerMuxerVhost)
 {
     srs_error_t err;
@@ -796,6 +975,82 @@ VOID TEST(ProtocolHTTPTest, HTTPServerMuxerHijack)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPServerMuxerTrie)
+{
+    srs_error_t err;
+
+    // Match the longest pattern in many mounts.
+    if (true) {
+        SrsHttpServeMux s;
+        HELPER_ASSERT_SUCCESS(s.initialize());
+
+        HELPER_ASSERT_SUCCESS(s.handle("/", new MockHttpHandler("Root")));
+        HELPER_ASSERT_SUCCESS(s.handle("/live/", new MockHttpHandler("Live")));
+        for (int i = 0; i < 1000; i++) {
+            string pattern = "/live/livestream" + srs_int2str(i) + ".flv";
+            HELPER_ASSERT_SUCCESS(s.handle(pattern, new MockHttpHandler(pattern)));
+        }
+
+        SrsHttpMuxEntry* entry = s.root->match("/live/livestream999.flv");
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_STREQ("/live/livestream999.flv", entry->pattern.c_str());
+
+        entry = s.root->match("/live/livestream1000.flv");
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_STREQ("/live/", entry->pattern.c_str());
+
+        entry = s.root->match("/vod/livestream1.flv");
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_STREQ("/", entry->pattern.c_str());
+
+        // The path not under dir, for example, /live is not under /live/
+        entry = s.root->match("/live");
+        ASSERT_TRUE(entry != NULL);
+        EXPECT_STREQ("/live/", entry->pattern.c_str());
+        EXPECT_FALSE(entry->explicit_match);
+    }
+
+    // Fall back to the shorter pattern when entry disabled.
+    if (true) {
+        SrsHttpServeMux s;
+        HELPER_ASSERT_SUCCESS(s.initialize());
+
+        HELPER_ASSERT_SUCCESS(s.handle("/", new MockHttpHandler("Root")));
+        MockHttpHandler* h = new MockHttpHandler("Stream");
+        HELPER_ASSERT_SUCCESS(s.handle("/live/livestream.flv", h));
+
+        h->entry->enabled = false;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.flv", false));
+
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Root", w);
+    }
+
+    // The vhost is the first segment of pattern.
+    if (true) {
+        SrsHttpServeMux s;
+        HELPER_ASSERT_SUCCESS(s.initialize());
+
+        HELPER_ASSERT_SUCCESS(s.handle("/live/livestream.flv", new MockHttpHandler("Default")));
+        HELPER_ASSERT_SUCCESS(s.handle("ossrs.net/live/livestream.flv", new MockHttpHandler("Vhost")));
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+
+        SrsHttpHeader h;
+        h.set("Host", "ossrs.net");
+        r.set_header(&h, false);
+
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.flv", false));
+
+        HELPER_ASSERT_SUCCESS(s.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Vhost", w);
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPServerMuxerBasic)
 {
     srs_error_t err;
@@ -1201,191 +1456,1175 @@ VOID TEST(ProtocolHTTPTest, VodStreamHandlers)
     }
 }
 
-VOID TEST(ProtocolHTTPTest, BasicHandlers)
+VOID TEST(ProtocolHTTPTest, VodStreamSeekByTime)
 {
     srs_error_t err;
 
+    string filename = "srs-utest-http-vod-index.flv";
+    string filepath = "/tmp/" + filename;
+
+    // Mux a flv file of 5s, keyframe every second.
+    vector<int64_t> keyframes;
     if (true) {
-        SrsHttpMuxEntry e;
-        e.pattern = "/";
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(filepath));
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_always_exists);
-        h.entry = &e;
+        SrsFlvTransmuxer enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+        HELPER_ASSERT_SUCCESS(enc.write_header());
 
-        MockResponseWriter w;
-        SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=0", false));
+        uint8_t vsh[] = {0x17, 0x00, 0x00, 0x00, 0x00, 0x01};
+        HELPER_ASSERT_SUCCESS(enc.write_video(0, (char*)vsh, sizeof(vsh)));
+        uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+        HELPER_ASSERT_SUCCESS(enc.write_audio(0, (char*)ash, sizeof(ash)));
 
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+        for (int i = 0; i < 50; i++) {
+            int64_t ts = i * 100;
+            uint8_t video[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03};
+            if ((ts % 1000) == 0) {
+                video[0] = 0x17;
+                keyframes.push_back(fw.tellg());
+            }
+            HELPER_ASSERT_SUCCESS(enc.write_video(ts, (char*)video, sizeof(video)));
+
+            uint8_t audio[] = {0xaf, 0x01, 0x00, 0x01, 0x02, 0x03};
+            HELPER_ASSERT_SUCCESS(enc.write_audio(ts, (char*)audio, sizeof(audio)));
+        }
     }
 
+    string content;
     if (true) {
-        SrsHttpMuxEntry e;
-        e.pattern = "/";
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(filepath));
+        content.resize(fr.filesize());
+        HELPER_ASSERT_SUCCESS(fr.read(&content[0], content.size(), NULL));
+    }
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_always_exists);
-        h.entry = &e;
+    SrsFlvVodIndexCache cache(1);
 
-        MockResponseWriter w;
-        SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4", false));
+    // Build the index and cache it.
+    if (true) {
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(filepath));
 
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
-    }
+        SrsFlvVodIndex* index = NULL;
+        HELPER_ASSERT_SUCCESS(cache.fetch(filepath, &fr, &index));
+        ASSERT_TRUE(index != NULL);
+        EXPECT_EQ(1, cache.size());
+        EXPECT_EQ((int64_t)content.size(), index->size);
 
-    if (true) {
-        SrsHttpMuxEntry e;
-        e.pattern = "/";
+        EXPECT_EQ(0, memcmp(index->header, content.data(), 13));
+        EXPECT_EQ(11 + 6 + 4 + 11 + 4 + 4, (int)index->sh.size());
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_always_exists);
-        h.entry = &e;
+        ASSERT_EQ(5, (int)index->times.size());
+        for (int i = 0; i < 5; i++) {
+            EXPECT_EQ(i * 1000, index->times.at(i));
+            EXPECT_EQ(keyframes.at(i), index->offsets.at(i));
+        }
 
-        MockResponseWriter w;
-        SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=12-3", false));
+        EXPECT_EQ(keyframes.at(0), index->seek(0));
+        EXPECT_EQ(keyframes.at(2), index->seek(2500 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(keyframes.at(3), index->seek(3000 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(keyframes.at(4), index->seek(100 * SRS_UTIME_SECONDS));
 
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+        // Hit the cache for the same file.
+        SrsFlvVodIndex* index2 = NULL;
+        HELPER_ASSERT_SUCCESS(cache.fetch(filepath, &fr, &index2));
+        EXPECT_TRUE(index == index2);
+        EXPECT_EQ(1, cache.size());
     }
 
+    // Serve the stream from the keyframe before starttime.
     if (true) {
         SrsHttpMuxEntry e;
         e.pattern = "/";
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        SrsVodStream h("/tmp", &cache);
         h.set_path_check(_mock_srs_path_always_exists);
         h.entry = &e;
 
         MockResponseWriter w;
         SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=2-3", false));
+        HELPER_ASSERT_SUCCESS(r.set_url("/" + filename + "?starttime=2.5", false));
 
         HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        string ev = content.substr(keyframes.at(2));
+        ASSERT_TRUE(av.length() > ev.length());
+        EXPECT_TRUE(av.substr(av.length() - ev.length()) == ev);
+        EXPECT_TRUE(av.find("Content-Length: " + srs_int2str(13 + 40 + ev.length())) != string::npos);
     }
 
+    ::unlink(filepath.c_str());
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamHlsInMemory)
+{
+    srs_error_t err;
+
+    // The bytes are shared by copies, and freed by the last one.
     if (true) {
-        SrsHttpMuxEntry e;
-        e.pattern = "/";
+        SrsHlsMemoryStore store;
+        store.update("./objs/nginx/html//live/livestream.m3u8", new SrsHlsMemoryFile("#EXTM3U", 7));
+        EXPECT_EQ(1, store.size());
+        EXPECT_EQ(7, store.bytes());
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_always_exists);
-        h.entry = &e;
+        SrsHlsMemoryFile* file = store.fetch("objs/nginx/html/live/livestream.m3u8");
+        ASSERT_TRUE(file != NULL);
+        SrsAutoFree(SrsHlsMemoryFile, file);
 
-        MockResponseWriter w;
-        SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.flv?start=2", false));
+        store.update("./objs/nginx/html/live/livestream.m3u8", new SrsHlsMemoryFile("#EXTM3U\n", 8));
+        EXPECT_EQ(1, store.size());
+        EXPECT_EQ(8, store.bytes());
+        EXPECT_EQ(7, file->size());
+        EXPECT_EQ(0, memcmp("#EXTM3U", file->data(), 7));
 
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+        store.remove("./objs/nginx/html/live/livestream.m3u8");
+        EXPECT_EQ(0, store.size());
+        EXPECT_EQ(0, store.bytes());
+        EXPECT_TRUE(store.fetch("./objs/nginx/html/live/livestream.m3u8") == NULL);
     }
 
+    // Serve the m3u8 in memory, even the file not exists.
     if (true) {
+        _srs_hls_memory->update("/tmp/live/livestream.m3u8", new SrsHlsMemoryFile("#EXTM3U", 7));
+
         SrsHttpMuxEntry e;
         e.pattern = "/";
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_always_exists);
+        SrsVodStream h("/tmp");
+        h.set_path_check(_mock_srs_path_not_exists);
         h.entry = &e;
 
         MockResponseWriter w;
         SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.flv", false));
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8", false));
 
         HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+        __MOCK_HTTP_EXPECT_STREQ(200, "#EXTM3U", w);
+
+        _srs_hls_memory->remove("/tmp/live/livestream.m3u8");
     }
 
+    // Fallback to disk when not in memory.
     if (true) {
         SrsHttpMuxEntry e;
         e.pattern = "/";
 
-        SrsHttpFileServer h("/tmp");
+        SrsVodStream h("/tmp");
         h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
         h.set_path_check(_mock_srs_path_always_exists);
         h.entry = &e;
 
         MockResponseWriter w;
         SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream-0.ts", false));
 
         HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
         __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
     }
+}
+
+VOID TEST(ProtocolHTTPTest, AcceptEncoding)
+{
+    EXPECT_TRUE(srs_http_accept_encoding("gzip, deflate, br", "gzip"));
+    EXPECT_TRUE(srs_http_accept_encoding("deflate,GZIP;q=0.5", "gzip"));
+    EXPECT_TRUE(srs_http_accept_encoding("*", "gzip"));
+    EXPECT_FALSE(srs_http_accept_encoding("", "gzip"));
+    EXPECT_FALSE(srs_http_accept_encoding("identity", "gzip"));
+    EXPECT_FALSE(srs_http_accept_encoding("gzip;q=0", "gzip"));
+    EXPECT_FALSE(srs_http_accept_encoding("*, gzip; q=0.0", "gzip"));
+    EXPECT_FALSE(srs_http_accept_encoding("identity;q=1, *;q=0", "gzip"));
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamHlsGzip)
+{
+    srs_error_t err;
+
+    string m3u8 = "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:10\n";
+    for (int i = 0; i < 100; i++) {
+        m3u8 += "#EXTINF:10.000, no desc\nlivestream-" + srs_int2str(i) + ".ts\n";
+    }
 
+    // The small playlist is never compressed.
     if (true) {
-        SrsHttpMuxEntry e;
-        e.pattern = "/";
+        SrsHlsMemoryFile file("#EXTM3U", 7);
+        file.compress();
+        EXPECT_TRUE(file.gzip().empty());
+    }
 
-        SrsHttpFileServer h("/tmp");
-        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
-        h.set_path_check(_mock_srs_path_not_exists);
-        h.entry = &e;
+    SrsHlsMemoryFile* file = new SrsHlsMemoryFile(m3u8.data(), (int)m3u8.length());
+    file->set_etag("\"abc\"");
+    file->compress();
+    ASSERT_FALSE(file->gzip().empty());
+    EXPECT_LT((int)file->gzip().length(), (int)m3u8.length() / 4);
+    EXPECT_EQ((char)0x1f, file->gzip().at(0));
+    EXPECT_EQ((char)0x8b, file->gzip().at(1));
+    _srs_hls_memory->update("/tmp/live/livestream.m3u8", file);
+
+    SrsHttpMuxEntry e;
+    e.pattern = "/";
+
+    SrsVodStream h("/tmp");
+    h.set_path_check(_mock_srs_path_not_exists);
+    h.entry = &e;
 
+    // Send the gzip variant when accepted.
+    if (true) {
         MockResponseWriter w;
         SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
 
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(404, "Not Found", w);
-    }
+        SrsHttpHeader hdr;
+        hdr.set("Accept-Encoding", "gzip, deflate");
+        r.set_header(&hdr, false);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8", false));
 
-    if (true) {
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/").c_str());
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/index.html").c_str());
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/", "/index.html").c_str());
-        EXPECT_STREQ("/tmp/ndex.html", srs_http_fs_fullpath("/tmp/", "//", "/index.html").c_str());
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/api", "/api/index.html").c_str());
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "ossrs.net/api", "/api/index.html").c_str());
-        EXPECT_STREQ("/tmp/views/index.html", srs_http_fs_fullpath("/tmp/", "/api", "/api/views/index.html").c_str());
-        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/api/", "/api/index.html").c_str());
-        EXPECT_STREQ("/tmp/ndex.html", srs_http_fs_fullpath("/tmp/", "/api//", "/api/index.html").c_str());
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+        EXPECT_TRUE(av.find("Content-Encoding: gzip") != string::npos);
+        EXPECT_TRUE(av.find("Vary: Accept-Encoding") != string::npos);
+        EXPECT_TRUE(av.find("ETag: \"abc-gzip\"") != string::npos);
+        EXPECT_TRUE(av.find("Content-Length: " + srs_int2str(file->gzip().length())) != string::npos);
+        EXPECT_TRUE(av.find("#EXTINF") == string::npos);
     }
 
+    // Send the identity when not accepted.
     if (true) {
-        SrsHttpRedirectHandler h("/api", 500);
-        EXPECT_FALSE(h.is_not_found());
-
         MockResponseWriter w;
         SrsHttpMessage r(NULL, NULL);
-        HELPER_ASSERT_SUCCESS(r.set_url("/api?v=2.0", false));
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8", false));
 
         HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
-        __MOCK_HTTP_EXPECT_STREQ(500, "Redirect to /api?v=2.0", w);
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+        EXPECT_TRUE(av.find("Content-Encoding") == string::npos);
+        EXPECT_TRUE(av.find("Vary: Accept-Encoding") != string::npos);
+        EXPECT_TRUE(av.find("ETag: \"abc\"") != string::npos);
+        EXPECT_STREQ(m3u8.c_str(), av.substr(av.length() - m3u8.length()).c_str());
     }
 
+    // The gzip variant is revalidated by its own ETag.
     if (true) {
-        SrsHttpNotFoundHandler h;
-
         MockResponseWriter w;
-        HELPER_ASSERT_SUCCESS(h.serve_http(&w, NULL));
-        __MOCK_HTTP_EXPECT_STREQ(404, "Not Found", w);
-        EXPECT_TRUE(h.is_not_found());
+        SrsHttpMessage r(NULL, NULL);
+
+        SrsHttpHeader hdr;
+        hdr.set("Accept-Encoding", "gzip");
+        hdr.set("If-None-Match", "\"abc-gzip\"");
+        r.set_header(&hdr, false);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 304") == 0);
     }
+
+    _srs_hls_memory->remove("/tmp/live/livestream.m3u8");
 }
 
-VOID TEST(ProtocolHTTPTest, MSegmentsReader)
+VOID TEST(ProtocolHTTPTest, VodStreamFileMetaCache)
 {
     srs_error_t err;
 
-    MockMSegmentsReader r;
-    r.in_bytes.push_back("GET /api/v1/versions HTTP/1.1\r\n");
-    r.in_bytes.push_back("Host: ossrs.net\r\n");
+    string path = "/tmp/srs-utest-meta.m3u8";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(path));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"#EXTM3U", 7, NULL));
+    }
+
+    // Only the hls and dash files are cached.
+    EXPECT_TRUE(SrsHttpFileMetaCache::is_cacheable("/live/livestream.m3u8"));
+    EXPECT_TRUE(SrsHttpFileMetaCache::is_cacheable("/live/livestream-0.ts"));
+    EXPECT_TRUE(SrsHttpFileMetaCache::is_cacheable("/live/livestream.mpd"));
+    EXPECT_TRUE(SrsHttpFileMetaCache::is_cacheable("/live/livestream-0.m4s"));
+    EXPECT_FALSE(SrsHttpFileMetaCache::is_cacheable("/live/livestream.flv"));
+    EXPECT_FALSE(SrsHttpFileMetaCache::is_cacheable("/live/livestream.mp4"));
 
+    // The Cache-Control for playlists and segments.
     if (true) {
-        char buf[1024];
-        HELPER_ARRAY_INIT(buf, 1024, 0);
+        SrsHttpFileMetaCache cache;
+        EXPECT_STREQ("", cache.cache_control("/live/livestream-0.ts").c_str());
+
+        cache.set_max_age(3600);
+        EXPECT_STREQ("no-cache", cache.cache_control("/live/livestream.m3u8").c_str());
+        EXPECT_STREQ("no-cache", cache.cache_control("/live/livestream.mpd").c_str());
+        EXPECT_STREQ("public, max-age=3600, immutable", cache.cache_control("/live/livestream-0.ts").c_str());
+    }
+
+    // Stat the file once, until invalidated by normalized path.
+    if (true) {
+        SrsHttpFileMetaCache cache;
+
+        SrsHttpFileMeta meta;
+        EXPECT_FALSE(cache.fetch("/tmp/srs-utest-meta-not-exists.m3u8", meta));
+        ASSERT_TRUE(cache.fetch(path, meta));
+        EXPECT_EQ(7, meta.size);
+        EXPECT_FALSE(meta.etag.empty());
+        EXPECT_FALSE(meta.last_modified.empty());
+        EXPECT_STREQ("application/vnd.apple.mpegurl", meta.content_type.c_str());
+        EXPECT_EQ(1, cache.size());
+        EXPECT_EQ(2, cache.nn_misses);
+
+        SrsHttpFileMeta v;
+        ASSERT_TRUE(cache.fetch("/tmp//srs-utest-meta.m3u8", v));
+        EXPECT_STREQ(meta.etag.c_str(), v.etag.c_str());
+        EXPECT_EQ(1, cache.nn_hits);
+
+        cache.invalidate("/tmp//srs-utest-meta.m3u8");
+        EXPECT_EQ(0, cache.size());
+    }
+
+    // Response 200 with validators, and 304 for the conditional request.
+    if (true) {
+        SrsHttpFileMeta meta;
+        ASSERT_TRUE(_srs_http_file_meta->fetch(path, meta));
+
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.entry = &e;
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-meta.m3u8", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+            EXPECT_TRUE(av.find("ETag: " + meta.etag) != string::npos);
+            EXPECT_TRUE(av.find("Content-Length: 7") != string::npos);
+            EXPECT_STREQ("#EXTM3U", av.substr(av.length() - 7).c_str());
+        }
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+
+            SrsHttpHeader hdr;
+            hdr.set("If-None-Match", meta.etag);
+            r.set_header(&hdr, false);
+            HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-meta.m3u8", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 304") == 0);
+            EXPECT_TRUE(av.find("#EXTM3U") == string::npos);
+            EXPECT_TRUE(av.find("chunked") == string::npos);
+        }
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+
+            SrsHttpHeader hdr;
+            hdr.set("If-Modified-Since", meta.last_modified);
+            r.set_header(&hdr, false);
+            HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-meta.m3u8", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 304") == 0);
+        }
+
+        // The file is removed by others, drop the stale meta.
+        ::unlink(path.c_str());
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-meta.m3u8", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 404") == 0);
+            EXPECT_FALSE(_srs_http_file_meta->fetch(path, meta));
+        }
+    }
+
+    ::unlink(path.c_str());
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamFileCache)
+{
+    srs_error_t err;
+
+    string path = "/tmp/srs-utest-file-cache.txt";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(path));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"Hello", 5, NULL));
+    }
+
+    // The small file is cached in memory, and the fd is closed.
+    if (true) {
+        SrsHttpFileCache cache;
+        EXPECT_FALSE(cache.enabled());
+        cache.set_limits(2, 10 * SRS_UTIME_SECONDS, 1024, 1024);
+        EXPECT_TRUE(cache.enabled());
+
+        SrsHttpOpenFile* file = NULL;
+        HELPER_EXPECT_SUCCESS(cache.open("/tmp/srs-utest-file-cache-not-exists.txt", &file));
+        EXPECT_TRUE(file == NULL);
+
+        HELPER_ASSERT_SUCCESS(cache.open(path, &file));
+        ASSERT_TRUE(file != NULL);
+        EXPECT_EQ(-1, file->fd);
+        ASSERT_TRUE(file->content != NULL);
+        EXPECT_EQ(5, file->content->size());
+        EXPECT_EQ(5, cache.memory());
+        cache.release(file);
+
+        SrsHttpOpenFile* file2 = NULL;
+        HELPER_ASSERT_SUCCESS(cache.open("/tmp//srs-utest-file-cache.txt", &file2));
+        EXPECT_TRUE(file == file2);
+        EXPECT_EQ(1, cache.nn_hits);
+        EXPECT_EQ(1, cache.nn_memory_hits);
+        cache.release(file2);
+    }
+
+    // The large file is opened, and freed when released after evicted.
+    if (true) {
+        SrsHttpFileCache cache;
+        cache.set_limits(2, 10 * SRS_UTIME_SECONDS, 1024, 0);
+
+        SrsHttpOpenFile* file = NULL;
+        HELPER_ASSERT_SUCCESS(cache.open(path, &file));
+        ASSERT_TRUE(file != NULL);
+        EXPECT_TRUE(file->fd >= 0);
+        EXPECT_TRUE(file->content == NULL);
+        EXPECT_EQ(5, file->size);
+
+        cache.invalidate(path);
+        EXPECT_EQ(0, cache.size());
+        EXPECT_TRUE(file->evicted);
+        EXPECT_EQ(1, file->refs);
+        cache.release(file);
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamHlsPackager)
+{
+    srs_error_t err;
+
+    // Only the m3u8 and segments of mp4 or flv file.
+    if (true) {
+        string file, name;
+        EXPECT_TRUE(SrsVodHlsCache::parse("/vod/a.mp4/index.m3u8", file, name));
+        EXPECT_STREQ("/vod/a.mp4", file.c_str());
+        EXPECT_STREQ("index.m3u8", name.c_str());
+
+        EXPECT_TRUE(SrsVodHlsCache::parse("/vod/a.flv/seg-10.ts", file, name));
+        EXPECT_STREQ("/vod/a.flv", file.c_str());
+        EXPECT_STREQ("seg-10.ts", name.c_str());
+
+        EXPECT_FALSE(SrsVodHlsCache::parse("/live/livestream.m3u8", file, name));
+        EXPECT_FALSE(SrsVodHlsCache::parse("/vod/a.mp4/live.m3u8", file, name));
+        EXPECT_FALSE(SrsVodHlsCache::parse("/vod/a.mp4/seg-.ts", file, name));
+        EXPECT_FALSE(SrsVodHlsCache::parse("/vod/a.mp4/seg-1a.ts", file, name));
+    }
+
+    // Cut at the first seek point after the fragment, the last one is shorter.
+    if (true) {
+        SrsVodHlsIndex index;
+
+        vector<int64_t> points;
+        points.push_back(0); points.push_back(4000); points.push_back(8000);
+        points.push_back(12000); points.push_back(20000); points.push_back(24000);
+
+        vector<int> starts = index.cut(points, 26000, 10 * SRS_UTIME_SECONDS);
+        ASSERT_EQ(3, index.nb_segments());
+        ASSERT_EQ(3, (int)starts.size());
+        EXPECT_EQ(-1, starts.at(0));
+        EXPECT_EQ(3, starts.at(1));
+        EXPECT_EQ(5, starts.at(2));
+
+        ASSERT_EQ(4, (int)index.times.size());
+        EXPECT_EQ(0, index.times.at(0));
+        EXPECT_EQ(12000, index.times.at(1));
+        EXPECT_EQ(24000, index.times.at(2));
+        EXPECT_EQ(26000, index.times.at(3));
+    }
+
+    // Not exists file.
+    if (true) {
+        SrsVodHlsCache cache;
+        cache.set_capacity(2, 10 * SRS_UTIME_SECONDS);
+        EXPECT_TRUE(cache.enabled());
+
+        SrsHlsMemoryFile* file = NULL;
+        HELPER_EXPECT_SUCCESS(cache.fetch("/tmp/srs-utest-not-exists.mp4", "index.m3u8", &file));
+        EXPECT_TRUE(file == NULL);
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamMp4Seek)
+{
+    srs_error_t err;
+
+    // Encode 300 frames of A/V, with keyframe each 30 frames, that is each 1200ms.
+    MockSrsFileWriter f;
+    if (true) {
+        SrsMp4Encoder enc; SrsFormat fmt;
+        HELPER_EXPECT_SUCCESS(enc.initialize(&f));
+        HELPER_EXPECT_SUCCESS(fmt.initialize());
+
+        uint8_t vsh[] = {
+            0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)vsh, sizeof(vsh)));
+        HELPER_EXPECT_SUCCESS(enc.write_sample(
+            &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+        ));
+
+        uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+        HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+        HELPER_EXPECT_SUCCESS(enc.write_sample(
+            &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+        ));
+
+        uint8_t payload[64];
+        for (int i = 0; i < 300; i++) {
+            memset(payload, (uint8_t)i, sizeof(payload));
+            uint16_t ft = (i % 30 == 0)? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, ft, SrsVideoAvcFrameTraitNALU, i * 40, i * 40 + 80, payload, 16 + (i % 48)
+            ));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, SrsAudioAacFrameTraitRawData, i * 23 + 10, i * 23 + 10, payload, 8 + (i % 32)
+            ));
+        }
+
+        HELPER_EXPECT_SUCCESS(enc.flush());
+    }
+
+    string filepath = "/tmp/srs-utest-vod-seek.mp4";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(filepath));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)f.data(), f.filesize(), NULL));
+    }
+
+    // Start at the keyframe before the time, the audio at the same time.
+    string body;
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-vod-seek.mp4?start=5", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_mp4_file(&w, &r, filepath));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+        EXPECT_TRUE(av.find("Content-Length: ") != string::npos);
+
+        size_t pos = av.find("\r\n\r\n");
+        ASSERT_TRUE(pos != string::npos);
+        body = av.substr(pos + 4);
+    }
+
+    string trimmedpath = "/tmp/srs-utest-vod-seek-trimmed.mp4";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(trimmedpath));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)body.data(), body.length(), NULL));
+    }
+
+    // The trimmed mp4 starts from the keyframe at 4800ms, and the offsets point to the samples.
+    if (true) {
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(trimmedpath));
+
+        SrsMp4MoovTrimmer trimmer;
+        HELPER_ASSERT_SUCCESS(trimmer.initialize(&fr));
+
+        SrsMp4TrackSamples* vide = trimmer.samples->video();
+        ASSERT_TRUE(vide != NULL);
+        ASSERT_EQ(180, (int)vide->size());
+        EXPECT_TRUE(vide->keyframes[0]);
+        EXPECT_FALSE(vide->keyframes[1]);
+        EXPECT_TRUE(vide->keyframes[30]);
+        EXPECT_EQ(0, (int)vide->dts_ms(0));
+        EXPECT_EQ(40, (int)vide->dts_ms(1));
+        EXPECT_EQ(16 + 120 % 48, (int)vide->sizes[0]);
+        EXPECT_EQ(120, (uint8_t)body.at(vide->offsets[0]));
+        EXPECT_EQ(299, (uint8_t)body.at(vide->offsets[179]) + 256);
+
+        SrsMp4TrackSamples* soun = trimmer.samples->audio();
+        ASSERT_TRUE(soun != NULL);
+        ASSERT_EQ(91, (int)soun->size());
+        EXPECT_EQ(8 + 209 % 32, (int)soun->sizes[0]);
+        EXPECT_EQ(209, (uint8_t)body.at(soun->offsets[0]));
+        EXPECT_EQ((int64_t)body.length(), (int64_t)(soun->offsets[90] + soun->sizes[90]));
+    }
+
+    // The trimmed moov is cached by the keyframe, so the time in the same gop hits.
+    if (true) {
+        SrsMp4VodMoovCache cache;
+        cache.set_capacity(1);
+
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(filepath));
+
+        SrsMp4VodMoov* moov = NULL;
+        HELPER_ASSERT_SUCCESS(cache.fetch(filepath, &fr, 5 * SRS_UTIME_SECONDS, &moov));
+        SrsAutoFree(SrsMp4VodMoov, moov);
+        EXPECT_EQ(0, cache.hits());
+        EXPECT_EQ(1, cache.misses());
+        EXPECT_EQ(1, cache.size());
+        EXPECT_EQ((int64_t)body.length(), (int64_t)moov->header.size() + moov->end - moov->start);
+
+        SrsMp4VodMoov* moov2 = NULL;
+        HELPER_ASSERT_SUCCESS(cache.fetch(filepath, &fr, 5500 * SRS_UTIME_MILLISECONDS, &moov2));
+        SrsAutoFree(SrsMp4VodMoov, moov2);
+        EXPECT_EQ(1, cache.hits());
+        EXPECT_TRUE(moov->header == moov2->header);
+
+        // Evict the least recently used one.
+        SrsMp4VodMoov* moov3 = NULL;
+        HELPER_ASSERT_SUCCESS(cache.fetch(filepath, &fr, 1 * SRS_UTIME_SECONDS, &moov3));
+        SrsAutoFree(SrsMp4VodMoov, moov3);
+        EXPECT_EQ(2, cache.misses());
+        EXPECT_EQ(1, cache.size());
+        EXPECT_EQ((int64_t)moov3->header.size(), cache.bytes());
+        EXPECT_TRUE(moov3->start < moov->start);
+    }
+
+    ::unlink(filepath.c_str());
+    ::unlink(trimmedpath.c_str());
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamDashGrowing)
+{
+    srs_error_t err;
+
+    // The growing segments, keyed by the normalized path.
+    if (true) {
+        SrsDashGrowingStore store;
+        EXPECT_FALSE(store.is_growing("./objs/nginx/html/live/livestream/video-1.m4s"));
+
+        store.update("./objs/nginx/html/live/livestream/video-1.m4s");
+        store.update("objs/nginx/html/live//livestream/video-1.m4s");
+        EXPECT_TRUE(store.is_growing("objs/nginx/html/live/livestream/video-1.m4s"));
+        EXPECT_FALSE(store.is_growing("./objs/nginx/html/live/livestream/video-2.m4s"));
+
+        store.complete("./objs/nginx/html/live/livestream/video-1.m4s");
+        EXPECT_FALSE(store.is_growing("./objs/nginx/html/live/livestream/video-1.m4s"));
+    }
+
+    string path = "/tmp/srs-utest-dash-1.m4s";
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(path));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)"Hello", 5, NULL));
+    }
+
+    // The segment is complete when serving, response the bytes in chunked encoding.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-dash-1.m4s", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_growing_segment(&w, &r, path));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+        EXPECT_TRUE(av.find("Transfer-Encoding: chunked") != string::npos);
+        EXPECT_TRUE(av.find("5\r\nHello\r\n0\r\n\r\n") != string::npos);
+    }
+
+    // The segment is removed.
+    ::unlink(path.c_str());
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/srs-utest-dash-1.m4s", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_growing_segment(&w, &r, path));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 404") == 0);
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamDashMpd)
+{
+    srs_error_t err;
+
+    // The MPD is static when the segments are continuous.
+    if (true) {
+        SrsMpdWriter mpd;
+        mpd.fragment = 2 * SRS_UTIME_SECONDS;
+        mpd.timeshit = 10 * SRS_UTIME_SECONDS;
+
+        for (int i = 100; i < 110; i++) {
+            mpd.append(mpd.vruns, i);
+        }
+        mpd.append(mpd.vruns, 109);
+        ASSERT_EQ(1, (int)mpd.vruns.size());
+        EXPECT_EQ(104, mpd.vruns.at(0).start);
+        EXPECT_EQ(6, mpd.vruns.at(0).count);
+
+        string v = mpd.segment_template(mpd.vruns, "");
+        EXPECT_TRUE(v.find("duration=\"2\"") != string::npos);
+        EXPECT_TRUE(v.find("SegmentTimeline") == string::npos);
+    }
+
+    // The discontinuity is described by SegmentTimeline, until it's out of window.
+    if (true) {
+        SrsMpdWriter mpd;
+        mpd.fragment = 2 * SRS_UTIME_SECONDS;
+        mpd.timeshit = 10 * SRS_UTIME_SECONDS;
+
+        mpd.append(mpd.vruns, 100);
+        mpd.append(mpd.vruns, 101);
+        mpd.append(mpd.vruns, 103);
+        ASSERT_EQ(2, (int)mpd.vruns.size());
+
+        string v = mpd.segment_template(mpd.vruns, "");
+        EXPECT_TRUE(v.find("startNumber=\"100\"") != string::npos);
+        EXPECT_TRUE(v.find("<S t=\"200000\" n=\"100\" d=\"2000\" r=\"1\" />") != string::npos);
+        EXPECT_TRUE(v.find("<S t=\"206000\" n=\"103\" d=\"2000\" />") != string::npos);
+
+        for (int i = 104; i < 108; i++) {
+            mpd.append(mpd.vruns, i);
+        }
+        ASSERT_EQ(1, (int)mpd.vruns.size());
+        EXPECT_EQ(103, mpd.vruns.at(0).start);
+    }
+
+    // Serve the MPD in memory, revalidated by ETag.
+    if (true) {
+        SrsHlsMemoryFile* file = new SrsHlsMemoryFile("<MPD/>", 6);
+        file->set_etag("\"mpd-1\"");
+        _srs_hls_memory->update("/tmp/live/livestream.mpd", file);
+
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.set_path_check(_mock_srs_path_not_exists);
+        h.entry = &e;
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.mpd", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 200") == 0);
+            EXPECT_TRUE(av.find("ETag: \"mpd-1\"") != string::npos);
+            EXPECT_STREQ("<MPD/>", av.substr(av.length() - 6).c_str());
+        }
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+
+            SrsHttpHeader hdr;
+            hdr.set("If-None-Match", "\"mpd-1\"");
+            r.set_header(&hdr, false);
+            HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.mpd", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(av.find("HTTP/1.1 304") == 0);
+            EXPECT_TRUE(av.find("<MPD/>") == string::npos);
+        }
+
+        _srs_hls_memory->remove("/tmp/live/livestream.mpd");
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, VodStreamHlsBlockingReload)
+{
+    srs_error_t err;
+
+    // Segment 10 is complete, and part 1 of segment 11 is ready.
+    SrsHlsPlaylistState state;
+    state.complete = 10;
+    state.msn = 11;
+    state.part = 1;
+    state.timeout = 1 * SRS_UTIME_SECONDS;
+
+    EXPECT_TRUE(state.ready(10, -1));
+    EXPECT_FALSE(state.ready(11, -1));
+    EXPECT_TRUE(state.ready(10, 5));
+    EXPECT_TRUE(state.ready(11, 0));
+    EXPECT_TRUE(state.ready(11, 1));
+    EXPECT_FALSE(state.ready(11, 2));
+    EXPECT_FALSE(state.ready(12, 0));
+
+    _srs_hls_memory->update("/tmp/live/livestream.m3u8", new SrsHlsMemoryFile("#EXTM3U", 7));
+    _srs_hls_memory->update_state("/tmp/live/livestream.m3u8", state);
+
+    // The part is ready, response immediately.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.set_path_check(_mock_srs_path_not_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8?_HLS_msn=11&_HLS_part=1", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "#EXTM3U", w);
+    }
+
+    // The msn is too far in the future.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.set_path_check(_mock_srs_path_not_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/live/livestream.m3u8?_HLS_msn=14", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        string av = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(av.find("HTTP/1.1 400") == 0);
+    }
+
+    // The preload hint part.
+    if (true) {
+        SrsHlsPlaylistState hint = state;
+        hint.hint = "/tmp/live/livestream-11.part2.ts";
+        _srs_hls_memory->update_state("/tmp/live/livestream.m3u8", hint);
+        EXPECT_TRUE(_srs_hls_memory->is_hint("/tmp/live//livestream-11.part2.ts"));
+        EXPECT_FALSE(_srs_hls_memory->is_hint("/tmp/live/livestream-11.part1.ts"));
+    }
+
+    _srs_hls_memory->remove("/tmp/live/livestream.m3u8");
+    _srs_hls_memory->remove_state("/tmp/live/livestream.m3u8");
+
+    SrsHlsPlaylistState v;
+    EXPECT_FALSE(_srs_hls_memory->fetch_state("/tmp/live/livestream.m3u8", v));
+}
+
+VOID TEST(ProtocolHTTPTest, HlsPlaylistIncremental)
+{
+    SrsHlsPlaylist playlist;
+    EXPECT_EQ(0, playlist.size());
+    EXPECT_STREQ("#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-MEDIA-SEQUENCE:0\n#EXT-X-TARGETDURATION:10\n", playlist.dumps(0, 10).c_str());
+
+    playlist.append("#EXTINF:10.000, no desc\nlivestream-0.ts\n");
+    playlist.append("#EXTINF:9.500, no desc\nlivestream-1.ts\n");
+    playlist.append("#EXT-X-DISCONTINUITY\n#EXTINF:10.000, no desc\nlivestream-2.ts\n");
+    EXPECT_EQ(3, playlist.size());
+
+    // Remove the first one, which is compacted lazily.
+    playlist.shift(1);
+    EXPECT_EQ(2, playlist.size());
+    EXPECT_STREQ("#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-MEDIA-SEQUENCE:1\n#EXT-X-TARGETDURATION:10\n"
+        "#EXTINF:9.500, no desc\nlivestream-1.ts\n"
+        "#EXT-X-DISCONTINUITY\n#EXTINF:10.000, no desc\nlivestream-2.ts\n", playlist.dumps(1, 10).c_str());
+
+    // Remove more than the entries.
+    playlist.shift(1);
+    playlist.append("#EXTINF:8.000, no desc\nlivestream-3.ts\n");
+    EXPECT_EQ(2, playlist.size());
+    EXPECT_STREQ("#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-MEDIA-SEQUENCE:2\n#EXT-X-TARGETDURATION:10\n"
+        "#EXT-X-DISCONTINUITY\n#EXTINF:10.000, no desc\nlivestream-2.ts\n"
+        "#EXTINF:8.000, no desc\nlivestream-3.ts\n", playlist.dumps(2, 10).c_str());
+
+    playlist.shift(3);
+    EXPECT_EQ(0, playlist.size());
+    EXPECT_EQ(0, playlist.offset);
+    EXPECT_TRUE(playlist.entries.empty());
+
+    // Keep a long window, the entries are always the latest ones.
+    for (int i = 0; i < 1000; i++) {
+        playlist.append("livestream-" + srs_int2str(i) + ".ts\n");
+        if (playlist.size() > 100) {
+            playlist.shift(1);
+        }
+    }
+    EXPECT_EQ(100, playlist.size());
+    string content = playlist.dumps(900, 10);
+    EXPECT_TRUE(srs_string_ends_with(content, "livestream-999.ts\n"));
+    EXPECT_TRUE(content.find("#EXT-X-TARGETDURATION:10\nlivestream-900.ts\n") != string::npos);
+    EXPECT_LT((int)playlist.entries.length(), 2 * 100 * 19);
+
+    playlist.clear();
+    EXPECT_EQ(0, playlist.size());
+}
+
+VOID TEST(ProtocolHTTPTest, HlsVariantGroup)
+{
+    SrsHlsVariantGroup group("ossrs.net", "/tmp/live/livestream_master.m3u8", "live/livestream_master.m3u8");
+    SrsHlsVariant* ld = group.fetch_or_create("_ld");
+    SrsHlsVariant* hd = group.fetch_or_create("_hd");
+    EXPECT_TRUE(ld == group.fetch_or_create("_ld"));
+
+    srs_utime_t fragment = 10 * SRS_UTIME_SECONDS;
+
+    // The first overflow variant leads the cut.
+    EXPECT_FALSE(group.should_cut(ld, 9000, 9 * SRS_UTIME_SECONDS, false, false));
+    EXPECT_TRUE(group.should_cut(ld, 10000, fragment, true, false));
+    group.cut(ld, 10000);
+    EXPECT_EQ(1, ld->cursor);
+
+    // The other follows the cut at the keyframe of same timestamp, even not overflow.
+    EXPECT_FALSE(group.should_cut(hd, 8000, 8 * SRS_UTIME_SECONDS, false, false));
+    EXPECT_TRUE(group.should_cut(hd, 9950, 9950 * SRS_UTIME_MILLISECONDS, false, false));
+    group.cut(hd, 9950);
+    EXPECT_EQ(1, hd->cursor);
+
+    // Never lead a new cut by overflow of follower, for the leader may cut later.
+    EXPECT_TRUE(group.should_cut(hd, 20000, fragment, true, false));
+    group.cut(hd, 20000);
+    EXPECT_EQ(2, hd->cursor);
+    EXPECT_FALSE(group.should_cut(ld, 19000, 9 * SRS_UTIME_SECONDS, true, false));
+    EXPECT_TRUE(group.should_cut(ld, 20000, fragment, false, false));
+    group.cut(ld, 20000);
+    EXPECT_EQ(2, ld->cursor);
+
+    // Cut to keep the sequence, when not aligned and absolutely overflow.
+    EXPECT_TRUE(group.should_cut(hd, 30000, fragment, true, false));
+    group.cut(hd, 30000);
+    EXPECT_FALSE(group.should_cut(ld, 5000, 2 * fragment, true, false));
+    EXPECT_TRUE(group.should_cut(ld, 5000, 2 * fragment, true, true));
+    group.cut(ld, 5000);
+    EXPECT_EQ(3, ld->cursor);
+    EXPECT_EQ(3, hd->cursor);
+
+    // Never cut a very small segment, when the follower is ahead.
+    EXPECT_TRUE(group.should_cut(hd, 40000, fragment, true, false));
+    group.cut(hd, 40000);
+    EXPECT_FALSE(group.should_cut(ld, 41000, 0, false, false));
+    EXPECT_TRUE(group.should_cut(ld, 41000, SRS_UTIME_SECONDS, false, false));
+    group.cut(ld, 41000);
+    EXPECT_EQ(4, ld->cursor);
+
+    // Catch up the others by the cuts before the keyframe, when the variant is late.
+    group.cut(hd, 50000);
+    group.cut(hd, 60000);
+    EXPECT_EQ(6, hd->cursor);
+    EXPECT_TRUE(group.should_cut(ld, 60000, fragment, false, false));
+    group.cut(ld, 60000);
+    EXPECT_EQ(6, ld->cursor);
+
+    // Skip the cuts which are not kept, when the variant is too late.
+    for (int i = 0; i < 100; i++) {
+        group.cut(hd, 70000 + i * 10000);
+    }
+    EXPECT_EQ(106, hd->cursor);
+    EXPECT_FALSE(group.should_cut(ld, 61000, SRS_UTIME_SECONDS, false, false));
+    EXPECT_EQ(106 - 64, ld->cursor);
+}
+
+VOID TEST(ProtocolHTTPTest, BasicHandlers)
+{
+    srs_error_t err;
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=0", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=12-3", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?range=2-3", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.flv?start=2", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.flv", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_not_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(404, "Not Found", w);
+    }
+
+    if (true) {
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/").c_str());
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/index.html").c_str());
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/", "/index.html").c_str());
+        EXPECT_STREQ("/tmp/ndex.html", srs_http_fs_fullpath("/tmp/", "//", "/index.html").c_str());
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/api", "/api/index.html").c_str());
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "ossrs.net/api", "/api/index.html").c_str());
+        EXPECT_STREQ("/tmp/views/index.html", srs_http_fs_fullpath("/tmp/", "/api", "/api/views/index.html").c_str());
+        EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp/", "/api/", "/api/index.html").c_str());
+        EXPECT_STREQ("/tmp/ndex.html", srs_http_fs_fullpath("/tmp/", "/api//", "/api/index.html").c_str());
+    }
+
+    if (true) {
+        SrsHttpRedirectHandler h("/api", 500);
+        EXPECT_FALSE(h.is_not_found());
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/api?v=2.0", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(500, "Redirect to /api?v=2.0", w);
+    }
+
+    if (true) {
+        SrsHttpNotFoundHandler h;
+
+        MockResponseWriter w;
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, NULL));
+        __MOCK_HTTP_EXPECT_STREQ(404, "Not Found", w);
+        EXPECT_TRUE(h.is_not_found());
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, MSegmentsReader)
+{
+    srs_error_t err;
+
+    MockMSegmentsReader r;
+    r.in_bytes.push_back("GET /api/v1/versions HTTP/1.1\r\n");
+    r.in_bytes.push_back("Host: ossrs.net\r\n");
+
+    if (true) {
+        char buf[1024];
+        HELPER_ARRAY_INIT(buf, 1024, 0);
 
         ssize_t nn = 0;
         HELPER_EXPECT_SUCCESS(r.read(buf, 1024, &nn));
@@ -1404,6 +2643,67 @@ VOID TEST(ProtocolHTTPTest, MSegmentsReader)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPParserPipelined)
+{
+    srs_error_t err;
+
+    MockMSegmentsReader r;
+    r.in_bytes.push_back("GET /live/a.m3u8 HTTP/1.1\r\nHost: ossrs.net\r\n\r\n"
+        "GET /live/b.m3u8 HTTP/1.1\r\nHost: ossrs.net\r\n\r\n"
+        "GET /live/c.m3u8 HTTP/1.1\r\n");
+
+    SrsHttpParser p;
+    HELPER_ASSERT_SUCCESS(p.initialize(HTTP_REQUEST, false));
+
+    ISrsHttpMessage* msg = NULL;
+    HELPER_ASSERT_SUCCESS(p.parse_message(&r, &msg));
+    EXPECT_STREQ("/live/a.m3u8", msg->path().c_str());
+    srs_freep(msg);
+    EXPECT_TRUE(p.pipelined());
+
+    // The partial header of next request is not pipelined.
+    HELPER_ASSERT_SUCCESS(p.parse_message(&r, &msg));
+    EXPECT_STREQ("/live/b.m3u8", msg->path().c_str());
+    srs_freep(msg);
+    EXPECT_FALSE(p.pipelined());
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPParserKeepAliveResponse)
+{
+    srs_error_t err;
+
+    // The keep-alive responses with body, on the same connection.
+    MockMSegmentsReader r;
+    r.in_bytes.push_back("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nHello");
+    r.in_bytes.push_back("HTTP/1.1 404 Not Found\r\nContent-Length: 6\r\n\r\nWorld!");
+
+    SrsHttpParser p;
+    HELPER_ASSERT_SUCCESS(p.initialize(HTTP_RESPONSE, false));
+
+    if (true) {
+        ISrsHttpMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(p.parse_message(&r, &msg));
+        EXPECT_EQ(200, msg->status_code());
+
+        string body;
+        HELPER_ASSERT_SUCCESS(msg->body_read_all(body));
+        EXPECT_STREQ("Hello", body.c_str());
+        srs_freep(msg);
+    }
+
+    // The next response is not parsed as the body of previous one.
+    if (true) {
+        ISrsHttpMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(p.parse_message(&r, &msg));
+        EXPECT_EQ(404, msg->status_code());
+
+        string body;
+        HELPER_ASSERT_SUCCESS(msg->body_read_all(body));
+        EXPECT_STREQ("World!", body.c_str());
+        srs_freep(msg);
+    }
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPMessageParser)
 {
     srs_error_t err;
@@ -1767,3 +3067,296 @@ VOID TEST(ProtocolHTTPTest, GetOriginalIP)
         EXPECT_STREQ("", srs_get_original_ip(&m).c_str());
     }
 }
+
+VOID TEST(ProtocolHTTPTest, Mp4StreamEncoder)
+{
+    srs_error_t err;
+
+    uint8_t vsh[] = {
+        0x17,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+        0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+        0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+    uint8_t ash[] = {0xaf, 0x00, 0x12, 0x10};
+    uint8_t key[] = {0x17, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x65, 0x88};
+    uint8_t inter[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x41, 0x9a};
+    uint8_t audio[] = {0xaf, 0x01, 0x21, 0x10};
+
+    // The fragment starts from keyframe, or when duration exceeds the fragment.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4StreamEncoder enc(100 * SRS_UTIME_MILLISECONDS);
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+
+        // The sequence header writes nothing.
+        HELPER_ASSERT_SUCCESS(enc.write_video(0, (char*)vsh, sizeof(vsh)));
+        HELPER_ASSERT_SUCCESS(enc.write_audio(0, (char*)ash, sizeof(ash)));
+        EXPECT_EQ(0, (int)fw.filesize());
+        EXPECT_EQ(0, enc.inits());
+
+        // The init is written before the first sample.
+        HELPER_ASSERT_SUCCESS(enc.write_video(0, (char*)key, sizeof(key)));
+        EXPECT_EQ(1, enc.inits());
+        int64_t size = fw.filesize();
+        EXPECT_TRUE(size > 0);
+
+        HELPER_ASSERT_SUCCESS(enc.write_audio(10, (char*)audio, sizeof(audio)));
+        HELPER_ASSERT_SUCCESS(enc.write_video(40, (char*)inter, sizeof(inter)));
+        HELPER_ASSERT_SUCCESS(enc.write_video(80, (char*)inter, sizeof(inter)));
+        HELPER_ASSERT_SUCCESS(enc.write_video(120, (char*)inter, sizeof(inter)));
+        EXPECT_EQ(size, fw.filesize());
+
+        // Flush the key fragment for duration exceeds.
+        HELPER_ASSERT_SUCCESS(enc.write_video(160, (char*)inter, sizeof(inter)));
+        EXPECT_TRUE(fw.filesize() > size);
+        EXPECT_TRUE(enc.key_fragment());
+        size = fw.filesize();
+
+        // Flush the fragment starts with non-keyframe, for keyframe.
+        HELPER_ASSERT_SUCCESS(enc.write_video(200, (char*)key, sizeof(key)));
+        EXPECT_TRUE(fw.filesize() > size);
+        EXPECT_FALSE(enc.key_fragment());
+        size = fw.filesize();
+
+        // The new init for sequence header changed, after flush the previous fragment.
+        HELPER_ASSERT_SUCCESS(enc.write_video(240, (char*)vsh, sizeof(vsh)));
+        EXPECT_TRUE(fw.filesize() > size);
+        EXPECT_TRUE(enc.key_fragment());
+        EXPECT_EQ(1, enc.inits());
+        HELPER_ASSERT_SUCCESS(enc.write_video(240, (char*)key, sizeof(key)));
+        EXPECT_EQ(2, enc.inits());
+    }
+
+    // For pure audio, each fragment is key fragment.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4StreamEncoder enc(100 * SRS_UTIME_MILLISECONDS);
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+
+        HELPER_ASSERT_SUCCESS(enc.write_audio(0, (char*)ash, sizeof(ash)));
+        for (int i = 0; i < 10; i++) {
+            HELPER_ASSERT_SUCCESS(enc.write_audio(i * 23, (char*)audio, sizeof(audio)));
+        }
+        EXPECT_EQ(1, enc.inits());
+        EXPECT_TRUE(enc.key_fragment());
+
+        // The non-AAC audio is ignored.
+        int64_t size = fw.filesize();
+        uint8_t mp3[] = {0x2f, 0xff, 0xfb};
+        HELPER_ASSERT_SUCCESS(enc.write_audio(1000, (char*)mp3, sizeof(mp3)));
+        EXPECT_EQ(size, fw.filesize());
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, WebSocketFrame)
+{
+    srs_error_t err;
+
+    // The example of RFC6455 section 1.3
+    EXPECT_STREQ("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", srs_websocket_accept("dGhlIHNhbXBsZSBub25jZQ==").c_str());
+
+    if (true) {
+        char buf[SRS_WEBSOCKET_FRAME_HEADER_MAX];
+        EXPECT_EQ(2, srs_websocket_frame_header(buf, SRS_WEBSOCKET_OPCODE_BINARY, 125));
+        EXPECT_EQ((char)0x82, buf[0]); EXPECT_EQ(125, buf[1]);
+
+        EXPECT_EQ(4, srs_websocket_frame_header(buf, SRS_WEBSOCKET_OPCODE_BINARY, 0x1234));
+        EXPECT_EQ(126, buf[1]); EXPECT_EQ(0x12, buf[2]); EXPECT_EQ(0x34, buf[3]);
+
+        EXPECT_EQ(10, srs_websocket_frame_header(buf, SRS_WEBSOCKET_OPCODE_BINARY, 0x10000));
+        EXPECT_EQ(127, buf[1]); EXPECT_EQ(0x01, buf[7]); EXPECT_EQ(0, buf[8]); EXPECT_EQ(0, buf[9]);
+    }
+
+    // All iovs of a writev are in a frame.
+    if (true) {
+        MockBufferIO io;
+        SrsWebSocketWriter w(&io);
+
+        iovec iovs[2];
+        iovs[0].iov_base = (char*)"Hello"; iovs[0].iov_len = 5;
+        iovs[1].iov_base = (char*)"World"; iovs[1].iov_len = 5;
+        HELPER_ASSERT_SUCCESS(w.writev(iovs, 2, NULL));
+        HELPER_ASSERT_SUCCESS(w.write_close(1000));
+
+        ASSERT_EQ(16, io.out_buffer.length());
+        EXPECT_EQ((char)0x82, io.out_buffer.bytes()[0]);
+        EXPECT_EQ(10, io.out_buffer.bytes()[1]);
+        EXPECT_EQ(0, memcmp("HelloWorld", io.out_buffer.bytes() + 2, 10));
+        EXPECT_EQ((char)0x88, io.out_buffer.bytes()[12]);
+        EXPECT_EQ(2, io.out_buffer.bytes()[13]);
+        EXPECT_EQ(0x03, io.out_buffer.bytes()[14]);
+        EXPECT_EQ((char)0xe8, io.out_buffer.bytes()[15]);
+    }
+}
+
+static string mock_hex_bytes(const char* hex)
+{
+    string v;
+    for (const char* p = hex; p[0] && p[1]; p += 2) {
+        char b[3] = {p[0], p[1], 0};
+        v.append(1, (char)::strtol(b, NULL, 16));
+    }
+    return v;
+}
+
+VOID TEST(ProtocolHTTPTest, Http2FrameHeader)
+{
+    char buf[SRS_HTTP2_FRAME_HEADER_SIZE];
+    SrsHttp2FrameHeader(0x123456, SrsHttp2FrameTypeHeaders, SRS_HTTP2_FLAG_END_HEADERS, 0x80000003).encode(buf);
+    EXPECT_EQ(0, memcmp("\x12\x34\x56\x01\x04\x00\x00\x00\x03", buf, sizeof(buf)));
+
+    // The reserved bit of stream identifier is ignored.
+    buf[5] = (char)0x80;
+    SrsHttp2FrameHeader fh;
+    fh.decode(buf);
+    EXPECT_EQ(0x123456, fh.length);
+    EXPECT_EQ(SrsHttp2FrameTypeHeaders, fh.type);
+    EXPECT_EQ(SRS_HTTP2_FLAG_END_HEADERS, fh.flags);
+    EXPECT_EQ(3, (int)fh.stream_id);
+}
+
+VOID TEST(ProtocolHTTPTest, Http2HpackHuffman)
+{
+    srs_error_t err;
+
+    // The examples of RFC7541 appendix C.4 and C.6.
+    string v;
+    HELPER_ASSERT_SUCCESS(srs_hpack_huffman_decode("\xf1\xe3\xc2\xe5\xf2\x3a\x6b\xa0\xab\x90\xf4\xff", 12, v));
+    EXPECT_STREQ("www.example.com", v.c_str());
+
+    v.clear();
+    HELPER_ASSERT_SUCCESS(srs_hpack_huffman_decode("\xa8\xeb\x10\x64\x9c\xbf", 6, v));
+    EXPECT_STREQ("no-cache", v.c_str());
+
+    v.clear();
+    HELPER_ASSERT_SUCCESS(srs_hpack_huffman_decode("\x64\x02", 2, v));
+    EXPECT_STREQ("302", v.c_str());
+
+    string date = mock_hex_bytes("d07abe941054d444a8200595040b8166e082a62d1bff");
+    v.clear();
+    HELPER_ASSERT_SUCCESS(srs_hpack_huffman_decode(date.data(), (int)date.length(), v));
+    EXPECT_STREQ("Mon, 21 Oct 2013 20:13:21 GMT", v.c_str());
+
+    // The padding longer than 7 bits, or not the MSB of EOS, is an error.
+    // @remark The decoded string is appended to the output.
+    HELPER_EXPECT_FAILED(srs_hpack_huffman_decode("\xa8\xeb\x10\x64\x9c\xbf\xff", 7, v));
+    HELPER_EXPECT_FAILED(srs_hpack_huffman_decode("\x00", 1, v));
+}
+
+VOID TEST(ProtocolHTTPTest, Http2HpackDecoder)
+{
+    srs_error_t err;
+
+    // The requests with Huffman of RFC7541 appendix C.4, which share the dynamic table.
+    SrsHpackDecoder hpack;
+
+    if (true) {
+        string b = mock_hex_bytes("828684418cf1e3c2e5f23a6ba0ab90f4ff");
+        vector<pair<string, string> > fields;
+        HELPER_ASSERT_SUCCESS(hpack.decode(b.data(), (int)b.length(), fields));
+        ASSERT_EQ(4, (int)fields.size());
+        EXPECT_STREQ(":method", fields[0].first.c_str()); EXPECT_STREQ("GET", fields[0].second.c_str());
+        EXPECT_STREQ(":scheme", fields[1].first.c_str()); EXPECT_STREQ("http", fields[1].second.c_str());
+        EXPECT_STREQ(":path", fields[2].first.c_str()); EXPECT_STREQ("/", fields[2].second.c_str());
+        EXPECT_STREQ(":authority", fields[3].first.c_str()); EXPECT_STREQ("www.example.com", fields[3].second.c_str());
+        EXPECT_EQ(57, hpack.table_size());
+    }
+
+    if (true) {
+        string b = mock_hex_bytes("828684be5886a8eb10649cbf");
+        vector<pair<string, string> > fields;
+        HELPER_ASSERT_SUCCESS(hpack.decode(b.data(), (int)b.length(), fields));
+        ASSERT_EQ(5, (int)fields.size());
+        EXPECT_STREQ("www.example.com", fields[3].second.c_str());
+        EXPECT_STREQ("cache-control", fields[4].first.c_str()); EXPECT_STREQ("no-cache", fields[4].second.c_str());
+        EXPECT_EQ(110, hpack.table_size());
+    }
+
+    if (true) {
+        string b = mock_hex_bytes("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+        vector<pair<string, string> > fields;
+        HELPER_ASSERT_SUCCESS(hpack.decode(b.data(), (int)b.length(), fields));
+        ASSERT_EQ(5, (int)fields.size());
+        EXPECT_STREQ("https", fields[1].second.c_str());
+        EXPECT_STREQ("/index.html", fields[2].second.c_str());
+        EXPECT_STREQ("custom-key", fields[4].first.c_str()); EXPECT_STREQ("custom-value", fields[4].second.c_str());
+        EXPECT_EQ(164, hpack.table_size());
+    }
+
+    // The index out of tables, and the truncated block.
+    if (true) {
+        vector<pair<string, string> > fields;
+        HELPER_EXPECT_FAILED(hpack.decode("\xff\x00", 2, fields));
+        HELPER_EXPECT_FAILED(hpack.decode("\x41\x8c\xf1\xe3", 4, fields));
+        HELPER_EXPECT_FAILED(hpack.decode("\x80", 1, fields));
+    }
+}
+
+VOID TEST(ProtocolHTTPTest, Http2HpackEncoder)
+{
+    srs_error_t err;
+
+    vector<pair<string, string> > fields;
+    fields.push_back(make_pair(":status", "200"));
+    fields.push_back(make_pair("content-type", "application/vnd.apple.mpegurl"));
+    fields.push_back(make_pair("x-custom", "v"));
+
+    string b;
+    srs_hpack_encode(fields, b);
+
+    // The full match of static table is indexed, others are literals without indexing.
+    EXPECT_EQ((char)0x88, b[0]);
+    EXPECT_EQ(0x0f, b[1]); EXPECT_EQ(0x10, b[2]);
+
+    SrsHpackDecoder hpack;
+    vector<pair<string, string> > decoded;
+    HELPER_ASSERT_SUCCESS(hpack.decode(b.data(), (int)b.length(), decoded));
+    ASSERT_EQ(3, (int)decoded.size());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_STREQ(fields[i].first.c_str(), decoded[i].first.c_str());
+        EXPECT_STREQ(fields[i].second.c_str(), decoded[i].second.c_str());
+    }
+
+    // Never changes the dynamic table of peer.
+    EXPECT_EQ(0, hpack.table_size());
+}
+
+VOID TEST(ProtocolHTTPTest, Http2PrefaceReader)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockBufferIO io;
+        io.append(SRS_HTTP2_PREFACE);
+
+        bool h2 = false;
+        SrsHttp2PrefaceReader r(&io);
+        HELPER_ASSERT_SUCCESS(r.detect(h2));
+        EXPECT_TRUE(h2);
+    }
+
+    // The request of HTTP/1.1 is replayed to parser.
+    if (true) {
+        MockBufferIO io;
+        io.append("GET / HTTP/1.1\r\n\r\n");
+
+        bool h2 = true;
+        SrsHttp2PrefaceReader r(&io);
+        HELPER_ASSERT_SUCCESS(r.detect(h2));
+        EXPECT_FALSE(h2);
+
+        char buf[32];
+        ssize_t nn = 0;
+        string v;
+        while (v.length() < 18) {
+            HELPER_ASSERT_SUCCESS(r.read(buf, sizeof(buf), &nn));
+            v.append(buf, nn);
+        }
+        EXPECT_STREQ("GET / HTTP/1.1\r\n\r\n", v.c_str());
+    }
+}
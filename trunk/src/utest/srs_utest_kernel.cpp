@@ -37,8 +37,11 @@ using namespace std;
 #include <srs_kernel_mp3.hpp>
 #include <srs_kernel_ts.hpp>
 #include <srs_kernel_mp4.hpp>
+#include <srs_kernel_recorder.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <openssl/evp.h>
+
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
 
 MockSrsFile::MockSrsFile()
@@ -476,6 +479,60 @@ VOID TEST(KernelBufferTest, AppendBytes)
     EXPECT_EQ('n', b.bytes()[11]);
 }
 
+VOID TEST(KernelBufferTest, BigEndianCodec)
+{
+    // The block codec writes the same bytes as SrsBuffer.
+    if (true) {
+        char a[18], b[18];
+
+        SrsBuffer buf(a, sizeof(a));
+        buf.write_1bytes(-2);
+        buf.write_2bytes(-3);
+        buf.write_3bytes(0x123456);
+        buf.write_4bytes(-5);
+        buf.write_8bytes(0x0102030405060708LL);
+        EXPECT_TRUE(buf.empty());
+
+        char* p = b;
+        srs_write_be<int8_t>(p, -2);
+        srs_write_be<int16_t>(p, -3);
+        srs_write_be24(p, 0x123456);
+        srs_write_be<int32_t>(p, -5);
+        srs_write_be<int64_t>(p, 0x0102030405060708LL);
+        EXPECT_EQ(18, p - b);
+        EXPECT_EQ(0, memcmp(a, b, sizeof(a)));
+        EXPECT_EQ((char)0xff, b[1]);
+        EXPECT_EQ((char)0xfd, b[2]);
+        EXPECT_EQ(0x12, b[3]);
+        EXPECT_EQ(0x01, b[10]);
+        EXPECT_EQ(0x08, b[17]);
+
+        p = b;
+        EXPECT_EQ(-2, srs_read_be<int8_t>(p));
+        EXPECT_EQ(-3, srs_read_be<int16_t>(p));
+        EXPECT_EQ(0x123456, srs_read_be24(p));
+        EXPECT_EQ(-5, srs_read_be<int32_t>(p));
+        EXPECT_EQ(0x0102030405060708LL, srs_read_be<int64_t>(p));
+    }
+
+    // The 3bytes is unsigned, and SrsBuffer reads the same value.
+    if (true) {
+        char a[8];
+        char* p = a;
+        srs_write_be24(p, 0xfffffe);
+        srs_write_be<uint32_t>(p, 0xfedcba98);
+
+        SrsBuffer buf(a, sizeof(a));
+        EXPECT_EQ(0xfffffe, buf.read_3bytes());
+        EXPECT_EQ((int32_t)0xfedcba98, buf.read_4bytes());
+
+        EXPECT_EQ(a, buf.data());
+        EXPECT_EQ(a + 7, buf.head());
+        buf.skip(-7);
+        EXPECT_EQ(a, buf.head());
+    }
+}
+
 VOID TEST(KernelBufferTest, EraseBytes)
 {
     SrsSimpleStream b;
@@ -583,6 +640,48 @@ VOID TEST(KernelFastBufferTest, Grow)
     }
 }
 
+VOID TEST(KernelFastBufferTest, AdaptiveGrowAndShrink)
+{
+    srs_error_t err;
+
+    // Double the buffer when a read fills it, util the max size.
+    if (true) {
+        SrsFastStream b(4, 16);
+        MockBufferReader r("Hello, world! Hello, SRS!");
+
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 1));
+        EXPECT_EQ(8, b.capacity());
+        EXPECT_EQ(4, b.size());
+
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 8));
+        EXPECT_EQ(16, b.capacity());
+        EXPECT_EQ('H', b.read_1byte());
+
+        // Grow for the required size, even larger than the max size.
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 20));
+        EXPECT_EQ(20, b.capacity());
+        EXPECT_EQ('e', b.read_1byte());
+
+        // Never shrink when the bytes in buffer never fit.
+        b.shrink();
+        EXPECT_EQ(20, b.capacity());
+
+        b.skip(b.size());
+        b.shrink();
+        EXPECT_EQ(4, b.capacity());
+    }
+
+    // Never grow the buffer of fixed size.
+    if (true) {
+        SrsFastStream b(4);
+        MockBufferReader r("Hello, world!");
+
+        HELPER_ASSERT_SUCCESS(b.grow(&r, 4));
+        EXPECT_EQ(4, b.capacity());
+        HELPER_ASSERT_FAILED(b.grow(&r, 5));
+    }
+}
+
 /**
 * test the codec,
 * whether H.264 keyframe
@@ -619,6 +718,82 @@ VOID TEST(KernelCodecTest, IsH264)
     EXPECT_FALSE(SrsFlvVideo::h264(&data, 1));
 }
 
+/**
+* test the codec,
+* whether non-reference video frame
+*/
+VOID TEST(KernelCodecTest, IsDisposable)
+{
+    uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x06, 0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x00};
+
+    // The disposable inter frame, or keyframe.
+    EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, 0));
+    data[0] = 0x37;
+    EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, 1));
+    data[0] = 0x17;
+    EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data)));
+
+    // The SEI and slice of nal_ref_idc 0.
+    data[0] = 0x27;
+    EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, sizeof(data)));
+
+    // The slice of nal_ref_idc 2.
+    data[15] = 0x41;
+    EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data)));
+    data[15] = 0x01;
+
+    // Only the SEI, or corrupt NALU.
+    EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, 11));
+    EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data) - 1));
+}
+
+/**
+* test the codec,
+* mark the video by timestamp in SEI
+*/
+VOID TEST(KernelCodecTest, TimestampMarker)
+{
+    uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x00};
+
+    char* marked = NULL;
+    int nb_marked = 0;
+    int64_t timestamp = 0;
+
+    // Not marked, or not h264 NALUs.
+    EXPECT_FALSE(SrsFlvVideo::marker((char*)data, sizeof(data), &timestamp));
+    EXPECT_FALSE(SrsFlvVideo::mark((char*)data, 4, 1, &marked, &nb_marked));
+    data[1] = 0x00;
+    EXPECT_FALSE(SrsFlvVideo::mark((char*)data, sizeof(data), 1, &marked, &nb_marked));
+    data[1] = 0x01;
+
+    // Corrupt NALU.
+    EXPECT_FALSE(SrsFlvVideo::mark((char*)data, sizeof(data) - 1, 1, &marked, &nb_marked));
+
+    int64_t now = 1602577199123456LL;
+    ASSERT_TRUE(SrsFlvVideo::mark((char*)data, sizeof(data), now, &marked, &nb_marked));
+    SrsAutoFreeA(char, marked);
+    EXPECT_EQ((int)sizeof(data) + SRS_FLV_VIDEO_MARKER_SIZE, nb_marked);
+
+    // Insert the SEI as the first NALU, and keep the others.
+    EXPECT_EQ(0x27, (uint8_t)marked[0]);
+    EXPECT_EQ(SrsAvcNaluTypeSEI, marked[9]);
+    EXPECT_EQ(0x80, (uint8_t)marked[5 + SRS_FLV_VIDEO_MARKER_SIZE - 1]);
+    EXPECT_TRUE(srs_bytes_equals(marked + 5 + SRS_FLV_VIDEO_MARKER_SIZE, (char*)data + 5, sizeof(data) - 5));
+    EXPECT_TRUE(SrsFlvVideo::disposable(marked, nb_marked));
+
+    EXPECT_TRUE(SrsFlvVideo::marker(marked, nb_marked, &timestamp));
+    EXPECT_EQ(now, timestamp);
+
+    // Never mark again.
+    char* marked2 = NULL;
+    int nb_marked2 = 0;
+    EXPECT_FALSE(SrsFlvVideo::mark(marked, nb_marked, now, &marked2, &nb_marked2));
+
+    // The uuid of SEI mismatch.
+    marked[12] = 'x';
+    EXPECT_FALSE(SrsFlvVideo::marker(marked, nb_marked, &timestamp));
+}
+
 /**
 * test the codec,
 * whether H.264 video sequence header
@@ -2230,6 +2405,77 @@ VOID TEST(KernelUtility, AvcUev)
     }
 }
 
+VOID TEST(KernelUtility, BitBufferWord)
+{
+    srs_error_t err;
+
+    // Read the bits across bytes, the byte of stream is consumed when the first bit read.
+    if (true) {
+        uint8_t data[] = {0xa5, 0x0f, 0xf0, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+        SrsBuffer buf((char*)data, sizeof(data));
+        SrsBitBuffer bb(&buf);
+        EXPECT_EQ(72, bb.left_bits());
+        EXPECT_EQ((uint32_t)0xa50ff001, bb.peek_32bits());
+
+        EXPECT_EQ(1, bb.read_bit());
+        EXPECT_EQ(1, buf.pos());
+        EXPECT_EQ((uint32_t)0x12, bb.read_bits(6));
+        EXPECT_EQ(1, buf.pos());
+        EXPECT_EQ((uint32_t)0x10f, bb.read_bits(9));
+        EXPECT_EQ(2, buf.pos());
+
+        bb.skip_bits(8);
+        EXPECT_EQ(3, buf.pos());
+        EXPECT_EQ((uint32_t)0x01020304, bb.read_bits(32));
+        EXPECT_EQ(16, bb.left_bits());
+        EXPECT_EQ((uint32_t)0x05060000, bb.peek_32bits());
+        EXPECT_EQ((uint32_t)0, bb.read_bits(0));
+        EXPECT_EQ((uint32_t)0x0506, bb.read_bits(16));
+        EXPECT_TRUE(bb.empty());
+        EXPECT_TRUE(buf.empty());
+    }
+
+    // The ue(v) of 30 leading zero bits, which exceeds a byte.
+    if (true) {
+        uint8_t data[] = {0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x18};
+        SrsBuffer buf((char*)data, sizeof(data));
+        SrsBitBuffer bb(&buf);
+
+        int32_t v = 0;
+        HELPER_EXPECT_SUCCESS(srs_avc_nalu_read_uev(&bb, v));
+        EXPECT_EQ((1 << 30) - 1 + 3, v);
+        EXPECT_EQ(3, bb.left_bits());
+    }
+
+    // The ue(v) overflow and no bytes.
+    if (true) {
+        uint8_t data[] = {0x00, 0x00, 0x00, 0x00, 0x80};
+        SrsBuffer buf((char*)data, sizeof(data));
+        SrsBitBuffer bb(&buf);
+
+        int32_t v = 0;
+        HELPER_EXPECT_FAILED(srs_avc_nalu_read_uev(&bb, v));
+    }
+
+    if (true) {
+        uint8_t data[] = {0x00, 0x08};
+        SrsBuffer buf((char*)data, sizeof(data));
+        SrsBitBuffer bb(&buf);
+
+        int32_t v = 0;
+        HELPER_EXPECT_FAILED(srs_avc_nalu_read_uev(&bb, v));
+    }
+
+    if (true) {
+        uint8_t data[] = {0x00};
+        SrsBuffer buf((char*)data, sizeof(data));
+        SrsBitBuffer bb(&buf);
+
+        int32_t v = 0;
+        HELPER_EXPECT_FAILED(srs_avc_nalu_read_uev(&bb, v));
+    }
+}
+
 extern void __crc32_make_table(uint32_t t[256], uint32_t poly, bool reflect_in);
 
 VOID TEST(KernelUtility, CRC32MakeTable)
@@ -2381,6 +2627,67 @@ VOID TEST(KernelUtility, CRC32MPEGTS)
     }
 }
 
+extern uint32_t __crc32_table_driven(uint32_t* t, const void* buf, int size, uint32_t previous, bool reflect_in, uint32_t xor_in, bool reflect_out, uint32_t xor_out);
+extern uint32_t __crc32_ieee_slicing8(const void* buf, int size, uint32_t previous);
+
+VOID TEST(KernelUtility, CRC32Equivalence)
+{
+    uint32_t ieee[256], mpeg[256];
+    __crc32_make_table(ieee, 0x4c11db7, true);
+    __crc32_make_table(mpeg, 0x4c11db7, false);
+    
+    char buf[4096 + 7];
+    for (int i = 0; i < (int)sizeof(buf); i++) {
+        buf[i] = (char)(random() & 0xff);
+    }
+    
+    // Covers the unaligned start, the tail less than 8/16/64 bytes, and the hardware blocks.
+    int sizes[] = {0, 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 127, 128, 188, 1000, 1316, 4096};
+    for (int i = 0; i < (int)(sizeof(sizes)/sizeof(int)); i++) {
+        for (int offset = 0; offset < 8; offset++) {
+            char* p = buf + offset;
+            int size = sizes[i];
+            
+            uint32_t expect = __crc32_table_driven(ieee, p, size, 0, true, 0xffffffff, true, 0xffffffff);
+            EXPECT_EQ(expect, __crc32_ieee_slicing8(p, size, 0));
+            EXPECT_EQ(expect, srs_crc32_ieee(p, size, 0));
+            
+            expect = __crc32_table_driven(ieee, p, size, 0xcbf43926, true, 0xffffffff, true, 0xffffffff);
+            EXPECT_EQ(expect, srs_crc32_ieee(p, size, 0xcbf43926));
+            
+            expect = __crc32_table_driven(mpeg, p, size, 0, false, 0xffffffff, false, 0);
+            EXPECT_EQ(expect, srs_crc32_mpegts(p, size));
+        }
+    }
+    
+    // The crc of blocks should equal to the crc of whole data.
+    if (true) {
+        uint32_t previous = 0;
+        for (int i = 0; i < 4096; i += 1000) {
+            previous = srs_crc32_ieee(buf + i, srs_min(1000, 4096 - i), previous);
+        }
+        EXPECT_EQ(srs_crc32_ieee(buf, 4096), previous);
+    }
+}
+
+VOID TEST(KernelUtility, CRC32LargeBuffer)
+{
+    uint32_t ieee[256];
+    __crc32_make_table(ieee, 0x4c11db7, true);
+    
+    // A HLS segment of 2MB, which is about 10s of 1.5Mbps, see the crc32 of srs_ubench for the throughput.
+    int size = 2 * 1024 * 1024;
+    char* buf = new char[size];
+    SrsAutoFreeA(char, buf);
+    for (int i = 0; i < size; i++) {
+        buf[i] = (char)(random() & 0xff);
+    }
+    
+    uint32_t expect = __crc32_table_driven(ieee, buf, size, 0, true, 0xffffffff, true, 0xffffffff);
+    EXPECT_EQ(expect, __crc32_ieee_slicing8(buf, size, 0));
+    EXPECT_EQ(expect, srs_crc32_ieee(buf, size, 0));
+}
+
 VOID TEST(KernelUtility, Base64Decode)
 {
 	srs_error_t err;
@@ -2649,6 +2956,84 @@ VOID TEST(KernelUtility, AnnexbUtils)
     }
 }
 
+
+// The original way to find the start code, skip byte until srs_avc_startswith_annexb.
+char* mock_avc_find_annexb(char* p, char* end)
+{
+    SrsBuffer stream(p, (int)(end - p));
+    while (!stream.empty()) {
+        if (srs_avc_startswith_annexb(&stream, NULL)) {
+            break;
+        }
+        stream.skip(1);
+    }
+    return stream.data() + stream.pos();
+}
+
+extern char* __srs_avc_find_annexb_scalar(char* p, char* end);
+
+VOID TEST(KernelUtility, AnnexbFind)
+{
+    if (true) {
+        char data[] = {0x00, 0x00, 0x01};
+        EXPECT_EQ(data, srs_avc_find_annexb(data, data + 3));
+        EXPECT_EQ(data + 2, srs_avc_find_annexb(data, data + 2));
+        EXPECT_EQ(data, srs_avc_find_annexb(data, data));
+    }
+    
+    if (true) {
+        char data[] = {0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x65};
+        EXPECT_EQ(data + 3, srs_avc_find_annexb(data, data + sizeof(data)));
+        EXPECT_EQ(data + 4, srs_avc_find_annexb(data + 4, data + sizeof(data)));
+    }
+    
+    // The start code at each position of 16 bytes block, and cross blocks.
+    for (int pos = 0; pos < 40; pos++) {
+        char data[48];
+        memset(data, 0x65, sizeof(data));
+        if (pos + 3 <= (int)sizeof(data)) {
+            data[pos] = data[pos + 1] = 0x00; data[pos + 2] = 0x01;
+        }
+        EXPECT_EQ(mock_avc_find_annexb(data, data + sizeof(data)), srs_avc_find_annexb(data, data + sizeof(data)));
+    }
+    
+    // Random data with lots of zeros, compare with the original way.
+    if (true) {
+        char data[1024];
+        for (int i = 0; i < 1000; i++) {
+            for (int j = 0; j < (int)sizeof(data); j++) {
+                int v = random() % 8;
+                data[j] = (v < 4)? 0x00 : ((v < 6)? 0x01 : (char)(random() & 0xff));
+            }
+            
+            int size = random() % sizeof(data);
+            int offset = random() % (size + 1);
+            char* p = data + offset;
+            char* end = data + size;
+            EXPECT_EQ(mock_avc_find_annexb(p, end), srs_avc_find_annexb(p, end));
+        }
+    }
+}
+
+VOID TEST(KernelUtility, AnnexbFindLargeFrame)
+{
+    // A 4K IDR frame about 1MB, without start code, see the annexb of srs_ubench for the throughput.
+    int size = 1024 * 1024;
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+    for (int i = 0; i < size; i++) {
+        data[i] = (char)(random() & 0xff);
+        if (i >= 2 && data[i] == 0x01 && data[i - 1] == 0x00 && data[i - 2] == 0x00) {
+            data[i] = 0x03;
+        }
+    }
+    
+    char* end = data + size;
+    EXPECT_EQ(end, mock_avc_find_annexb(data, end));
+    EXPECT_EQ(end, __srs_avc_find_annexb_scalar(data, end));
+    EXPECT_EQ(end, srs_avc_find_annexb(data, end));
+}
+
 VOID TEST(KernelUtility, AdtsUtils)
 {
     if (true) {
@@ -3020,6 +3405,124 @@ VOID TEST(KernelLBRRTest, CoverAll)
     }
 }
 
+VOID TEST(KernelLBCHashTest, SelectAndFeedback)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+    
+    // Always select the same server for the same key, by different balancers.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash lb0(&stats), lb1(&stats);
+        
+        for (int i = 0; i < 10; i++) {
+            char key[32];
+            snprintf(key, sizeof(key), "live/stream%d", i);
+            
+            string s0 = lb0.select(servers, key);
+            EXPECT_TRUE(s0 == lb1.select(servers, key));
+            EXPECT_TRUE(s0 == lb0.select(servers, key));
+        }
+    }
+    
+    // Fallback to other server when failed, and recover later.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash lb(&stats);
+        
+        string s0 = lb.select(servers, "live/livestream");
+        lb.on_failure();
+        EXPECT_FALSE(stats.fetch(s0)->is_healthy(srs_get_system_time()));
+        
+        string s1 = lb.select(servers, "live/livestream");
+        EXPECT_TRUE(s0 != s1);
+        
+        // Recover when down expired, and reset by success.
+        stats.fetch(s0)->down_until = 0;
+        EXPECT_TRUE(s0 == lb.select(servers, "live/livestream"));
+        lb.on_success(10 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(0, stats.fetch(s0)->failures);
+        EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, stats.fetch(s0)->srtt);
+    }
+    
+    // The winner of connect race takes the load of selected server.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash lb(&stats);
+        
+        string s0 = lb.select(servers, "live/livestream");
+        lb.on_success(0);
+        EXPECT_EQ(1, stats.fetch(s0)->load);
+        
+        string s1 = (s0 == "s0")? "s1" : "s0";
+        lb.on_winner(s1);
+        EXPECT_TRUE(s1 == lb.selected());
+        EXPECT_EQ(0, stats.fetch(s0)->load);
+        EXPECT_EQ(1, stats.fetch(s1)->load);
+        
+        lb.on_close();
+        EXPECT_EQ(0, stats.fetch(s1)->load);
+    }
+    
+    // All servers down, select the one which recovers first.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash lb(&stats);
+        
+        for (int i = 0; i < (int)servers.size(); i++) {
+            stats.fetch(servers.at(i))->on_failure(srs_get_system_time());
+        }
+        stats.fetch("s1")->down_until -= SRS_UTIME_SECONDS;
+        EXPECT_TRUE("s1" == lb.select(servers, "live/livestream"));
+    }
+    
+    // The load is bounded, and released when closed.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash* lbs[6];
+        map<string, int> loads;
+        
+        for (int i = 0; i < 6; i++) {
+            lbs[i] = new SrsLbConsistentHash(&stats);
+            loads[lbs[i]->select(servers, "live/livestream")]++;
+            lbs[i]->on_success(0);
+        }
+        
+        // The bound of load is ceil(1.25*6/3)=3 for the last one.
+        for (int i = 0; i < (int)servers.size(); i++) {
+            EXPECT_LE(loads[servers.at(i)], 3);
+            EXPECT_EQ(loads[servers.at(i)], stats.fetch(servers.at(i))->load);
+        }
+        
+        for (int i = 0; i < 6; i++) {
+            srs_freep(lbs[i]);
+        }
+        for (int i = 0; i < (int)servers.size(); i++) {
+            EXPECT_EQ(0, stats.fetch(servers.at(i))->load);
+        }
+    }
+    
+    // Prefer the next server, if the rtt is much smaller.
+    if (true) {
+        SrsLbServerStats stats;
+        SrsLbConsistentHash lb(&stats);
+        
+        vector<SrsLbServerStat*> cands;
+        lb.build_ring(servers);
+        cands = lb.candidates("live/livestream");
+        ASSERT_EQ(3, (int)cands.size());
+        
+        cands.at(0)->srtt = 400 * SRS_UTIME_MILLISECONDS;
+        cands.at(1)->srtt = 100 * SRS_UTIME_MILLISECONDS;
+        EXPECT_TRUE(cands.at(1)->server == lb.select(servers, "live/livestream"));
+        
+        cands.at(1)->srtt = 200 * SRS_UTIME_MILLISECONDS;
+        EXPECT_TRUE(cands.at(0)->server == lb.select(servers, "live/livestream"));
+    }
+}
+
 VOID TEST(KernelCodecTest, CoverAll)
 {
     if (true) {
@@ -3212,6 +3715,27 @@ VOID TEST(KernelCodecTest, AVFrame)
         HELPER_EXPECT_FAILED(err);
     }
     
+    // The samples are kept when moved to the overflow cache, which is reused for next frame.
+    if (true) {
+        SrsVideoFrame f;
+        SrsVideoCodecConfig cc;
+        HELPER_EXPECT_SUCCESS(f.initialize(&cc));
+        for (int i = 0; i < SrsInlineNbSamples + 1; i++) {
+            HELPER_EXPECT_SUCCESS(f.SrsFrame::add_sample((char*)(int64_t)(i + 1), i));
+        }
+        EXPECT_EQ(SrsInlineNbSamples + 1, f.nb_samples);
+        for (int i = 0; i < f.nb_samples; i++) {
+            EXPECT_TRUE((char*)(int64_t)(i + 1) == f.samples[i].bytes);
+            EXPECT_EQ(i, f.samples[i].size);
+        }
+        
+        SrsSample* overflow = f.samples;
+        HELPER_EXPECT_SUCCESS(f.initialize(&cc));
+        HELPER_EXPECT_SUCCESS(f.SrsFrame::add_sample((char*)1, 1));
+        EXPECT_TRUE(overflow == f.samples);
+        EXPECT_EQ(1, f.nb_samples);
+    }
+    
     if (true) {
         SrsVideoFrame f;
         SrsVideoCodecConfig cc;
@@ -3544,6 +4068,37 @@ VOID TEST(KernelCodecTest, VideoFormatSepcial)
     }
 }
 
+VOID TEST(KernelCodecTest, VideoFormatSameSequenceHeader)
+{
+    srs_error_t err;
+
+    uint8_t spspps[] = {
+        0x17,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+        0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+        0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+
+    SrsFormat f;
+    HELPER_EXPECT_SUCCESS(f.initialize());
+
+    HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)spspps, sizeof(spspps)));
+    EXPECT_EQ(768, f.vcodec->width);
+    EXPECT_TRUE(f.is_avc_sequence_header());
+
+    // The same sequence header is not parsed again.
+    f.vcodec->width = 0;
+    HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)spspps, sizeof(spspps)));
+    EXPECT_EQ(0, f.vcodec->width);
+    EXPECT_TRUE(f.is_avc_sequence_header());
+
+    // The changed sequence header is parsed.
+    spspps[8] = 0x1f;
+    HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)spspps, sizeof(spspps)));
+    EXPECT_EQ(768, f.vcodec->width);
+    EXPECT_EQ(0x1f, f.vcodec->avc_level);
+}
+
 VOID TEST(KernelCodecTest, VideoFormat)
 {
 	srs_error_t err;
@@ -3646,6 +4201,27 @@ VOID TEST(KernelCodecTest, VideoFormat)
         HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)rawIBMF, sizeof(rawIBMF)));
         EXPECT_EQ(1, f.video->nb_samples);
     }
+    
+    // Skip the NALUs when not demux samples, but parse the sequence header.
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+        f.demux_samples = false;
+        
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)spspps, sizeof(spspps)));
+        EXPECT_TRUE(f.is_avc_sequence_header());
+        EXPECT_EQ(768, f.vcodec->width);
+        
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)rawIBMF, sizeof(rawIBMF)));
+        EXPECT_EQ(0, f.video->nb_samples);
+        EXPECT_EQ(2, f.video->frame_type);
+        EXPECT_EQ(1, f.video->avc_packet_type);
+        EXPECT_EQ((int)sizeof(rawIBMF) - 5, f.nb_raw);
+        
+        f.demux_samples = true;
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)rawIBMF, sizeof(rawIBMF)));
+        EXPECT_EQ(1, f.video->nb_samples);
+    }
 }
 
 VOID TEST(KernelFileTest, FileWriteReader)
@@ -3972,30 +4548,277 @@ VOID TEST(KernelFileTest, ReadWriteCase)
 	EXPECT_STREQ("Hello", buf);
 }
 
-VOID TEST(KernelFLVTest, CoverAll)
+class MockAsyncFileIO : public ISrsAsyncFileIO
 {
-	srs_error_t err;
+public:
+    int nn_writes;
+    int nn_produces;
+    int nn_closes;
+public:
+    MockAsyncFileIO() {
+        nn_writes = nn_produces = nn_closes = 0;
+    }
+    virtual ~MockAsyncFileIO() {
+    }
+public:
+    virtual srs_error_t submit_write(int fd, char* buf, int size, int64_t offset, ISrsFileFilter* filter) {
+        nn_writes++;
+        if (filter && filter->filter(buf, size) != 0) {
+            srs_freepa(buf);
+            return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "filter");
+        }
+        ssize_t nn = ::pwrite(fd, buf, size, offset);
+        srs_freepa(buf);
+        if (nn != size) {
+            return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "pwrite");
+        }
+        return srs_success;
+    }
+    virtual srs_error_t submit_produce(int fd, ISrsFileProducer* producer, int size, int64_t offset, ISrsFileFilter* filter) {
+        nn_produces++;
+        char* buf = new char[size];
+        producer->produce(buf, size);
+        srs_freep(producer);
+        return submit_write(fd, buf, size, offset, filter);
+    }
+    virtual srs_error_t submit_close(int fd) {
+        nn_closes++;
+        ::close(fd);
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelFileTest, AsyncWriter)
+{
+    srs_error_t err;
 
+    string filepath = _srs_tmp_file_prefix + "kernel-file-async-writer";
+    MockFileRemover _mfr(filepath);
+
+    MockAsyncFileIO io;
     if (true) {
-        SrsMessageHeader h;
-        h.message_type = RTMP_MSG_SetChunkSize;
-        EXPECT_TRUE(h.is_set_chunk_size());
-        
-        h.message_type = RTMP_MSG_SetPeerBandwidth;
-        EXPECT_TRUE(h.is_set_peer_bandwidth());
-        
-        h.message_type = RTMP_MSG_AggregateMessage;
-        EXPECT_TRUE(h.is_aggregate());
-        
-        h.initialize_amf0_script(10, 20);
-        EXPECT_EQ(RTMP_MSG_AMF0DataMessage, h.message_type);
-        EXPECT_EQ(10, h.payload_length);
-        EXPECT_EQ(20, h.stream_id);
-        
-        h.initialize_audio(10, 30, 20);
-        EXPECT_EQ(RTMP_MSG_AudioMessage, h.message_type);
-        EXPECT_EQ(10, h.payload_length);
-        EXPECT_EQ(20, h.stream_id);
+        SrsFileWriter w;
+        w.set_async(&io);
+        HELPER_ASSERT_SUCCESS(w.open(filepath));
+
+        // Small writes are cached in writer.
+        HELPER_EXPECT_SUCCESS(w.write((void*)"Hello, ", 7, NULL));
+        HELPER_EXPECT_SUCCESS(w.write((void*)"world!", 6, NULL));
+        EXPECT_EQ(13, w.tellg());
+        EXPECT_EQ(0, io.nn_writes);
+
+        // Seek flush the cache, then overwrite it.
+        w.seek2(0);
+        EXPECT_EQ(1, io.nn_writes);
+        EXPECT_EQ(0, w.tellg());
+        HELPER_EXPECT_SUCCESS(w.write((void*)"J", 1, NULL));
+
+        off_t pos = 0;
+        HELPER_EXPECT_SUCCESS(w.lseek(0, SEEK_END, &pos));
+        EXPECT_EQ(13, pos);
+        EXPECT_EQ(2, io.nn_writes);
+
+        // Large write is submit directly.
+        string large(100 * 1024, 'x');
+        HELPER_EXPECT_SUCCESS(w.write((void*)large.data(), large.length(), NULL));
+        EXPECT_EQ(3, io.nn_writes);
+        EXPECT_EQ(13 + 100 * 1024, w.tellg());
+
+        w.close();
+        EXPECT_EQ(1, io.nn_closes);
+        EXPECT_FALSE(w.is_open());
+    }
+
+    SrsFileReader r;
+    HELPER_ASSERT_SUCCESS(r.open(filepath));
+    EXPECT_EQ(13 + 100 * 1024, r.filesize());
+
+    char buf[14] = {0};
+    HELPER_EXPECT_SUCCESS(r.read(buf, 13, NULL));
+    EXPECT_STREQ("Jello, world!", buf);
+}
+
+int mock_nn_writes = 0;
+
+ssize_t mock_count_write(int fildes, const void* buf, size_t nbyte) {
+    mock_nn_writes++;
+    return ::write(fildes, buf, nbyte);
+}
+
+VOID TEST(KernelFileTest, BufferedWriter)
+{
+    srs_error_t err;
+
+    string filepath = _srs_tmp_file_prefix + "kernel-file-buffered-writer";
+    MockFileRemover _mfr(filepath);
+
+    MockSystemIO _mockio(NULL, mock_count_write);
+    mock_nn_writes = 0;
+    if (true) {
+        SrsFileWriter w;
+        w.set_buffer(1024, false);
+        HELPER_ASSERT_SUCCESS(w.open(filepath));
+
+        // Small writes are cached in writer.
+        HELPER_EXPECT_SUCCESS(w.write((void*)"Hello, ", 7, NULL));
+        HELPER_EXPECT_SUCCESS(w.write((void*)"world!", 6, NULL));
+        EXPECT_EQ(13, w.tellg());
+        EXPECT_EQ(0, mock_nn_writes);
+
+        // Seek flush the cache, then overwrite it.
+        w.seek2(0);
+        EXPECT_EQ(1, mock_nn_writes);
+        EXPECT_EQ(0, w.tellg());
+        HELPER_EXPECT_SUCCESS(w.write((void*)"J", 1, NULL));
+        HELPER_EXPECT_SUCCESS(w.flush());
+        EXPECT_EQ(2, mock_nn_writes);
+
+        // The cache is written when full, and large write is written directly.
+        w.seek2(13);
+        string data(1000, 'x');
+        HELPER_EXPECT_SUCCESS(w.write((void*)data.data(), data.length(), NULL));
+        HELPER_EXPECT_SUCCESS(w.write((void*)data.data(), data.length(), NULL));
+        EXPECT_EQ(3, mock_nn_writes);
+        string large(4096, 'y');
+        HELPER_EXPECT_SUCCESS(w.write((void*)large.data(), large.length(), NULL));
+        EXPECT_EQ(5, mock_nn_writes);
+        HELPER_EXPECT_SUCCESS(w.write((void*)"z", 1, NULL));
+        EXPECT_EQ(13 + 2000 + 4096 + 1, w.tellg());
+
+        // Close flush the cache.
+        w.close();
+        EXPECT_EQ(6, mock_nn_writes);
+    }
+
+    SrsFileReader r;
+    HELPER_ASSERT_SUCCESS(r.open(filepath));
+    EXPECT_EQ(13 + 2000 + 4096 + 1, r.filesize());
+
+    char buf[14] = {0};
+    HELPER_EXPECT_SUCCESS(r.read(buf, 13, NULL));
+    EXPECT_STREQ("Jello, world!", buf);
+}
+
+string mock_file_read_all(string filepath)
+{
+    SrsFileReader r;
+    if (r.open(filepath) != srs_success) {
+        return "";
+    }
+
+    string v(r.filesize(), 0);
+    srs_error_t err = r.read((void*)v.data(), v.length(), NULL);
+    srs_freep(err);
+    return v;
+}
+
+VOID TEST(KernelFileTest, EncFileWriter)
+{
+    srs_error_t err;
+
+    unsigned char key[16], iv[16];
+    for (int i = 0; i < 16; i++) {
+        key[i] = (unsigned char)i;
+        iv[i] = (unsigned char)(0xff - i);
+    }
+
+    // Not aligned to the block, so there is padding.
+    int nn_packets = 100;
+    string plain(SRS_TS_PACKET_SIZE * nn_packets, 0);
+    for (int i = 0; i < (int)plain.length(); i++) {
+        plain[i] = (char)(i & 0xff);
+    }
+
+    // The expect cipher, by AES-128-CBC with PKCS7 padding.
+    string expect(plain.length() + 16, 0);
+    if (true) {
+        int nn = 0, nn_final = 0;
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv);
+        EVP_EncryptUpdate(ctx, (unsigned char*)expect.data(), &nn, (unsigned char*)plain.data(), (int)plain.length());
+        EVP_EncryptFinal_ex(ctx, (unsigned char*)expect.data() + nn, &nn_final);
+        EVP_CIPHER_CTX_free(ctx);
+        expect.resize(nn + nn_final);
+    }
+
+    string filepath = _srs_tmp_file_prefix + "kernel-file-enc-writer";
+    MockFileRemover _mfr(filepath);
+
+    // Encrypt in current thread.
+    if (true) {
+        SrsEncFileWriter w;
+        HELPER_ASSERT_SUCCESS(w.open(filepath));
+        HELPER_ASSERT_SUCCESS(w.config_cipher(key, iv));
+        for (int i = 0; i < nn_packets; i++) {
+            HELPER_ASSERT_SUCCESS(w.write((void*)(plain.data() + i * SRS_TS_PACKET_SIZE), SRS_TS_PACKET_SIZE, NULL));
+        }
+        w.close();
+
+        string v = mock_file_read_all(filepath);
+        EXPECT_EQ(expect.length(), v.length());
+        EXPECT_TRUE(v == expect);
+    }
+
+    // Encrypt by the async io.
+    if (true) {
+        MockAsyncFileIO io;
+        SrsEncFileWriter w;
+        w.set_async(&io);
+        w.set_offload(true);
+        HELPER_ASSERT_SUCCESS(w.open(filepath));
+        HELPER_ASSERT_SUCCESS(w.config_cipher(key, iv));
+        for (int i = 0; i < nn_packets; i++) {
+            HELPER_ASSERT_SUCCESS(w.write((void*)(plain.data() + i * SRS_TS_PACKET_SIZE), SRS_TS_PACKET_SIZE, NULL));
+        }
+        w.close();
+        EXPECT_EQ(1, io.nn_closes);
+
+        string v = mock_file_read_all(filepath);
+        EXPECT_EQ(expect.length(), v.length());
+        EXPECT_TRUE(v == expect);
+    }
+
+    // The async io without offload, encrypt in current thread.
+    if (true) {
+        MockAsyncFileIO io;
+        SrsEncFileWriter w;
+        w.set_async(&io);
+        HELPER_ASSERT_SUCCESS(w.open(filepath));
+        HELPER_ASSERT_SUCCESS(w.config_cipher(key, iv));
+        for (int i = 0; i < nn_packets; i++) {
+            HELPER_ASSERT_SUCCESS(w.write((void*)(plain.data() + i * SRS_TS_PACKET_SIZE), SRS_TS_PACKET_SIZE, NULL));
+        }
+        w.close();
+
+        string v = mock_file_read_all(filepath);
+        EXPECT_TRUE(v == expect);
+    }
+}
+
+VOID TEST(KernelFLVTest, CoverAll)
+{
+	srs_error_t err;
+
+    if (true) {
+        SrsMessageHeader h;
+        h.message_type = RTMP_MSG_SetChunkSize;
+        EXPECT_TRUE(h.is_set_chunk_size());
+        
+        h.message_type = RTMP_MSG_SetPeerBandwidth;
+        EXPECT_TRUE(h.is_set_peer_bandwidth());
+        
+        h.message_type = RTMP_MSG_AggregateMessage;
+        EXPECT_TRUE(h.is_aggregate());
+        
+        h.initialize_amf0_script(10, 20);
+        EXPECT_EQ(RTMP_MSG_AMF0DataMessage, h.message_type);
+        EXPECT_EQ(10, h.payload_length);
+        EXPECT_EQ(20, h.stream_id);
+        
+        h.initialize_audio(10, 30, 20);
+        EXPECT_EQ(RTMP_MSG_AudioMessage, h.message_type);
+        EXPECT_EQ(10, h.payload_length);
+        EXPECT_EQ(20, h.stream_id);
         EXPECT_EQ(30, h.timestamp_delta);
         EXPECT_EQ(30, h.timestamp);
         
@@ -4042,6 +4865,44 @@ VOID TEST(KernelFLVTest, CoverAll)
         
         EXPECT_EQ(16, f.tellg());
     }
+    
+    // The tag header is cached by the first consumer, and shared by others with the same timestamp.
+    if (true) {
+        SrsMessageHeader h;
+        h.initialize_video(1, 30, 20);
+        
+        SrsSharedPtrMessage m;
+        HELPER_EXPECT_SUCCESS(m.create(&h, new char[1], 1));
+        
+        string tags[3];
+        for (int i = 0; i < 3; i++) {
+            SrsSharedPtrMessage* msg = m.copy();
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            if (i == 2) {
+                msg->timestamp = 40;
+            }
+            
+            MockSrsFileWriter f;
+            HELPER_EXPECT_SUCCESS(f.open(""));
+            SrsFlvTransmuxer mux;
+            HELPER_EXPECT_SUCCESS(mux.initialize(&f));
+            HELPER_EXPECT_SUCCESS(mux.write_tags(&msg, 1));
+            tags[i] = string(f.data(), f.filesize());
+        }
+        
+        bool fresh = true;
+        EXPECT_TRUE(m.cached_flv_tag(&fresh) != NULL);
+        EXPECT_FALSE(fresh);
+        
+        ASSERT_EQ(16, (int)tags[0].length());
+        EXPECT_TRUE(tags[0] == tags[1]);
+        EXPECT_EQ(30, (uint8_t)tags[0][6]);
+        
+        // Generated by consumer for another timestamp.
+        ASSERT_EQ(16, (int)tags[2].length());
+        EXPECT_EQ(40, (uint8_t)tags[2][6]);
+        EXPECT_EQ(12, (uint8_t)tags[2][15]);
+    }
 }
 
 VOID TEST(KernelFLVTest, CoverSharedPtrMessage)
@@ -4084,6 +4945,63 @@ VOID TEST(KernelFLVTest, CoverSharedPtrMessage)
 		EXPECT_FALSE(m.check(1));
 		EXPECT_TRUE(m.check(1));
 	}
+
+	// The copy for each consumer is a plain handle, and the hot fields of payload are in one cache line.
+	if (true) {
+		EXPECT_EQ(32, (int)sizeof(SrsSharedPtrMessage));
+
+		SrsMessageHeader h;
+		SrsSharedPtrMessage m;
+		HELPER_EXPECT_SUCCESS(m.create(&h, NULL, 0));
+
+		char* base = (char*)m.ptr;
+		EXPECT_LE((char*)&m.ptr->flv_timestamp + sizeof(int64_t) - base, 64);
+
+		SrsSharedPtrMessage* copy = m.copy();
+		EXPECT_EQ(1, m.count());
+		EXPECT_TRUE(copy->ptr == m.ptr);
+		srs_freep(copy);
+		EXPECT_EQ(0, m.count());
+	}
+}
+
+VOID TEST(KernelFLVTest, CoverSharedPtrMessageChunkHeader)
+{
+    srs_error_t err;
+
+    if (true) {
+        SrsMessageHeader h;
+        h.initialize_video(10, 30, 1);
+        h.perfer_cid = 6;
+
+        SrsSharedPtrMessage m;
+        HELPER_EXPECT_SUCCESS(m.create(&h, new char[10], 10));
+
+        char* c0 = NULL; char* c3 = NULL; int nb_c0 = 0; int nb_c3 = 0;
+        EXPECT_TRUE(m.cached_chunk_header(&c0, &nb_c0, &c3, &nb_c3));
+        EXPECT_EQ(12, nb_c0);
+        EXPECT_EQ(1, nb_c3);
+
+        char buf[16];
+        EXPECT_EQ(12, m.chunk_header(buf, sizeof(buf), true));
+        EXPECT_TRUE(!memcmp(buf, c0, 12));
+        EXPECT_EQ(1, m.chunk_header(buf, sizeof(buf), false));
+        EXPECT_EQ(buf[0], c3[0]);
+
+        // The copy with the same timestamp shares the headers.
+        SrsSharedPtrMessage* cp = m.copy();
+        SrsAutoFree(SrsSharedPtrMessage, cp);
+
+        char* cc0 = NULL; char* cc3 = NULL; int nb_cc0 = 0; int nb_cc3 = 0;
+        EXPECT_TRUE(cp->cached_chunk_header(&cc0, &nb_cc0, &cc3, &nb_cc3));
+        EXPECT_EQ(c0, cc0);
+        EXPECT_EQ(c3, cc3);
+
+        // The copy with another timestamp never use the cached headers.
+        cp->timestamp = 100;
+        EXPECT_FALSE(cp->cached_chunk_header(&cc0, &nb_cc0, &cc3, &nb_cc3));
+        EXPECT_TRUE(m.cached_chunk_header(&c0, &nb_c0, &c3, &nb_c3));
+    }
 }
 
 VOID TEST(KernelLogTest, CoverAll)
@@ -4647,7 +5565,7 @@ VOID TEST(KernelTSTest, CoverContextEncode)
         srs_error_t err = ctx.encode(&f, &m, SrsVideoCodecIdDisabled, SrsAudioCodecIdDisabled);
         HELPER_EXPECT_FAILED(err);
         
-        err = ctx.encode(&f, &m, SrsVideoCodecIdHEVC, SrsAudioCodecIdOpus);
+        err = ctx.encode(&f, &m, SrsVideoCodecIdOn2VP6, SrsAudioCodecIdOpus);
         HELPER_EXPECT_FAILED(err);
 
         err = ctx.encode(&f, &m, SrsVideoCodecIdAV1, SrsAudioCodecIdOpus);
@@ -4678,6 +5596,225 @@ VOID TEST(KernelTSTest, CoverContextEncode)
     }
 }
 
+// Encode the PES by SrsTsPacket, as the reference of SrsTsContext::encode_pes.
+srs_error_t mock_ts_encode_pes(SrsTsContext* ctx, ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid)
+{
+    srs_error_t err = srs_success;
+
+    SrsTsChannel* channel = ctx->get(pid);
+    char* start = msg->payload->bytes();
+    char* end = start + msg->payload->length();
+    char* p = start;
+
+    while (p < end) {
+        SrsTsPacket* pkt = NULL;
+        if (p == start) {
+            int64_t pcr = msg->write_pcr? msg->dts : -1;
+            pkt = SrsTsPacket::create_pes_first(ctx, pid, msg->sid, channel->continuity_counter++,
+                msg->is_discontinuity, pcr, msg->dts, msg->pts, msg->payload->length());
+        } else {
+            pkt = SrsTsPacket::create_pes_continue(ctx, pid, msg->sid, channel->continuity_counter++);
+        }
+        SrsAutoFree(SrsTsPacket, pkt);
+
+        char buf[SRS_TS_PACKET_SIZE];
+        memset(buf, 0xFF, SRS_TS_PACKET_SIZE);
+
+        int nb_buf = pkt->size();
+        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
+        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
+        if (nb_stuffings > 0) {
+            pkt->padding(nb_stuffings);
+            nb_buf = pkt->size();
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
+        }
+        memcpy(buf + nb_buf, p, left);
+        p += left;
+
+        SrsBuffer stream(buf, nb_buf);
+        if ((err = pkt->encode(&stream)) != srs_success) {
+            return srs_error_wrap(err, "encode");
+        }
+        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write");
+        }
+    }
+
+    return err;
+}
+
+VOID TEST(KernelTSTest, EncodePESDirectly)
+{
+    srs_error_t err;
+
+    // The size of payload, to cover the stuffings of 0, 1, 2 and more bytes, for the first and continue packets.
+    int sizes[] = {1, 13, 150, 169, 170, 171, 174, 175, 176, 183, 184, 185, 353, 354, 355, 356, 357, 1000, 64 * 1024, 256 * 184 + 7};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        for (int j = 0; j < 4; j++) {
+            SrsTsContext ctx, ref;
+            MockSrsFileWriter f, fref;
+            HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+            HELPER_ASSERT_SUCCESS(ref.encode_pat_pmt(&fref, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+            // Whether write pcr, and whether dts equals to pts.
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.write_pcr = (j & 0x01);
+            m.is_discontinuity = (j & 0x01);
+            m.dts = 0x1ABCDEF12LL;
+            m.pts = (j & 0x02)? m.dts + 3600 : m.dts;
+            for (int k = 0; k < sizes[i]; k++) {
+                char v = (char)k;
+                m.payload->append(&v, 1);
+            }
+
+            // Write twice, to check the continuity counter.
+            for (int k = 0; k < 2; k++) {
+                HELPER_ASSERT_SUCCESS(ctx.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+                HELPER_ASSERT_SUCCESS(mock_ts_encode_pes(&ref, &fref, &m, 0x100));
+            }
+
+            ASSERT_EQ(0, (int)(f.filesize() % SRS_TS_PACKET_SIZE));
+            ASSERT_EQ(fref.filesize(), f.filesize());
+            EXPECT_TRUE(fref.str() == f.str()) << "size=" << sizes[i] << ", case=" << j;
+        }
+    }
+
+    // Always write pcr for pure audio.
+    if (true) {
+        SrsTsContext ctx;
+        MockSrsFileWriter f;
+        HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamReserved, 0x101, SrsTsStreamAudioAAC));
+        f.seek2(0);
+
+        SrsTsMessage m;
+        m.sid = SrsTsPESStreamIdAudioCommon;
+        m.payload->append("Hello, world!", 13);
+        HELPER_ASSERT_SUCCESS(ctx.encode_pes(&f, &m, 0x101, SrsTsStreamAudioAAC, true));
+
+        // The adaptation field with PCR.
+        uint8_t* p = (uint8_t*)f.data();
+        EXPECT_EQ(0x47, p[0]);
+        EXPECT_EQ(0x41, p[1]);
+        EXPECT_EQ(0x01, p[2]);
+        EXPECT_EQ(0x30, p[3] & 0xF0);
+        EXPECT_EQ(0x10, p[5] & 0x10);
+    }
+}
+
+VOID TEST(KernelTSTest, EncodePCRInterval)
+{
+    srs_error_t err;
+
+    // The pure audio writes pcr by interval 100ms, instead of every PES.
+    SrsTsContext ctx;
+    ctx.set_pcr_interval(100 * 90);
+
+    MockSrsFileWriter f;
+    HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamReserved, 0x101, SrsTsStreamAudioAAC));
+
+    for (int i = 0; i < 6; i++) {
+        // Start a new segment, which starts with pcr.
+        if (i == 5) {
+            ctx.reset();
+            HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamReserved, 0x101, SrsTsStreamAudioAAC));
+        }
+
+        SrsTsMessage m;
+        m.sid = SrsTsPESStreamIdAudioCommon;
+        m.dts = m.pts = i * 40 * 90;
+        m.payload->append("Hello, world!", 13);
+        HELPER_ASSERT_SUCCESS(ctx.encode_pes(&f, &m, 0x101, SrsTsStreamAudioAAC, true));
+    }
+
+    // The PAT/PMT and one packet for each PES.
+    ASSERT_EQ(10 * SRS_TS_PACKET_SIZE, (int)f.filesize());
+    EXPECT_EQ(6 * 13, ctx.es_bytes());
+    EXPECT_EQ(10 * SRS_TS_PACKET_SIZE, ctx.ts_bytes());
+
+    int64_t pcrs[] = {0, -1, -1, 120 * 90, -1, 200 * 90};
+    int offsets[] = {2, 3, 4, 5, 6, 9};
+    for (int i = 0; i < 6; i++) {
+        const char* p = f.data() + offsets[i] * SRS_TS_PACKET_SIZE;
+        EXPECT_EQ(pcrs[i], srs_ts_packet_pcr(p)) << "pes=" << i;
+    }
+}
+
+VOID TEST(KernelTSTest, EncodePESOffload)
+{
+    srs_error_t err;
+
+    string filepath = _srs_tmp_file_prefix + "kernel-ts-offload";
+    MockFileRemover _mfr(filepath);
+
+    MockAsyncFileIO io;
+    SrsTsContext ref;
+    MockSrsFileWriter fref;
+    HELPER_ASSERT_SUCCESS(ref.encode_pat_pmt(&fref, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+    if (true) {
+        SrsTsContext ctx;
+        ctx.set_offload(true);
+
+        SrsFileWriter f;
+        f.set_async(&io);
+        HELPER_ASSERT_SUCCESS(f.open(filepath));
+        HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+        int sizes[] = {1, 170, 184, 185, 1000, 64 * 1024};
+        for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.write_pcr = (i & 0x01);
+            m.dts = 0x1ABCDEF12LL + i * 3600;
+            m.pts = m.dts + 3600;
+            for (int k = 0; k < sizes[i]; k++) {
+                char v = (char)k;
+                m.payload->append(&v, 1);
+            }
+
+            HELPER_ASSERT_SUCCESS(mock_ts_encode_pes(&ref, &fref, &m, 0x100));
+
+            // The payload is taken by the producer.
+            HELPER_ASSERT_SUCCESS(ctx.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+            EXPECT_EQ(0, m.payload->length());
+            EXPECT_EQ(ref.get(0x100)->continuity_counter, ctx.get(0x100)->continuity_counter);
+        }
+        EXPECT_EQ(6, io.nn_produces);
+
+        f.close();
+    }
+
+    SrsFileReader r;
+    HELPER_ASSERT_SUCCESS(r.open(filepath));
+    ASSERT_EQ(fref.filesize(), r.filesize());
+
+    string data(fref.filesize(), 0);
+    HELPER_ASSERT_SUCCESS(r.read((void*)data.data(), data.length(), NULL));
+    EXPECT_TRUE(fref.str() == data);
+}
+
+VOID TEST(KernelTSTest, EncodePESPackets)
+{
+    srs_error_t err;
+
+    SrsTsContext ctx;
+    MockSrsFileWriter f;
+    HELPER_ASSERT_SUCCESS(ctx.encode_pat_pmt(&f, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+    SrsTsMessage m;
+    m.sid = SrsTsPESStreamIdVideoCommon;
+    m.payload->append(string(16 * 1024, 'x').data(), 16 * 1024);
+
+    // The PES of 16KB is always 90 packets, see the ts_encode_pes_16kb of srs_ubench for the throughput.
+    for (int i = 0; i < 4; i++) {
+        f.seek2(0);
+        m.dts = m.pts = i * 3600;
+        HELPER_ASSERT_SUCCESS(ctx.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+        EXPECT_EQ(90 * SRS_TS_PACKET_SIZE, (int)f.tellg());
+    }
+}
+
 VOID TEST(KernelTSTest, CoverContextDecode)
 {
 	srs_error_t err;
@@ -4733,6 +5870,167 @@ VOID TEST(KernelTSTest, CoverContextDecode)
     }
 }
 
+VOID TEST(KernelTSTest, DecodeMultipleProgram)
+{
+    srs_error_t err;
+
+    SrsTsContext ctx;
+    MockTsHandler h;
+
+    // The PAT with the network PID 0x10, program 1 of PMT 0x1001, program 2 of PMT 0x1002.
+    if (true) {
+        uint8_t raw[] = {
+            0x47, 0x40, 0x00, 0x10, 0x00, 0x00, 0xb0, 0x15, 0x00, 0x01, 0xc1, 0x00, 0x00, 0x00, 0x00, 0xe0,
+            0x10, 0x00, 0x01, 0xf0, 0x01, 0x00, 0x02, 0xf0, 0x02, 0xb1, 0x4f, 0x60, 0x0c, 0xff
+        };
+        SrsBuffer b((char*)raw, sizeof(raw));
+        HELPER_EXPECT_SUCCESS(ctx.decode(&b, &h));
+    }
+
+    EXPECT_TRUE(ctx.get(0x10) == NULL);
+    ASSERT_TRUE(ctx.get(0x1001) != NULL);
+    EXPECT_EQ(SrsTsPidApplyPMT, ctx.get(0x1001)->apply);
+    EXPECT_EQ(1, ctx.get(0x1001)->program);
+    ASSERT_TRUE(ctx.get(0x1002) != NULL);
+    EXPECT_EQ(2, ctx.get(0x1002)->program);
+
+    // The PMT of program 1, video 0x100 and audio 0x101.
+    if (true) {
+        uint8_t raw[] = {
+            0x47, 0x50, 0x01, 0x10, 0x00, 0x02, 0xb0, 0x17, 0x00, 0x01, 0xc1, 0x00, 0x00, 0xe1, 0x00, 0xf0,
+            0x00, 0x1b, 0xe1, 0x00, 0xf0, 0x00, 0x0f, 0xe1, 0x01, 0xf0, 0x00, 0x2f, 0x44, 0xb9, 0x9b, 0xff
+        };
+        SrsBuffer b((char*)raw, sizeof(raw));
+        HELPER_EXPECT_SUCCESS(ctx.decode(&b, &h));
+    }
+
+    // The PMT of program 2, video 0x200 and audio 0x201.
+    if (true) {
+        uint8_t raw[] = {
+            0x47, 0x50, 0x02, 0x10, 0x00, 0x02, 0xb0, 0x17, 0x00, 0x02, 0xc1, 0x00, 0x00, 0xe2, 0x00, 0xf0,
+            0x00, 0x1b, 0xe2, 0x00, 0xf0, 0x00, 0x0f, 0xe2, 0x01, 0xf0, 0x00, 0x12, 0x82, 0xdc, 0x83, 0xff
+        };
+        SrsBuffer b((char*)raw, sizeof(raw));
+        HELPER_EXPECT_SUCCESS(ctx.decode(&b, &h));
+    }
+
+    ASSERT_TRUE(ctx.get(0x100) != NULL);
+    EXPECT_EQ(SrsTsPidApplyVideo, ctx.get(0x100)->apply);
+    EXPECT_EQ(1, ctx.get(0x100)->program);
+    ASSERT_TRUE(ctx.get(0x101) != NULL);
+    EXPECT_EQ(1, ctx.get(0x101)->program);
+    ASSERT_TRUE(ctx.get(0x200) != NULL);
+    EXPECT_EQ(SrsTsPidApplyVideo, ctx.get(0x200)->apply);
+    EXPECT_EQ(2, ctx.get(0x200)->program);
+    ASSERT_TRUE(ctx.get(0x201) != NULL);
+    EXPECT_EQ(SrsTsPidApplyAudio, ctx.get(0x201)->apply);
+    EXPECT_EQ(2, ctx.get(0x201)->program);
+    EXPECT_EQ(2, ctx.get(0x1002)->program);
+}
+
+// The handler to copy the payload of messages, which never keeps the message.
+class MockTsCopyHandler : public ISrsTsHandler
+{
+public:
+    std::vector<std::string> payloads;
+    std::vector<SrsTsMessage*> msgs;
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* m) {
+        payloads.push_back(string(m->payload->bytes(), m->payload->length()));
+        msgs.push_back(m);
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelTSTest, DecodeReuseMessage)
+{
+    srs_error_t err;
+
+    SrsTsContext enc;
+    MockSrsFileWriter f;
+    HELPER_ASSERT_SUCCESS(enc.encode_pat_pmt(&f, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+    int sizes[] = {1000, 5000, 300, 10};
+    for (int i = 0; i < 4; i++) {
+        SrsTsMessage m;
+        m.sid = SrsTsPESStreamIdVideoCommon;
+        m.write_pcr = (i == 0);
+        for (int k = 0; k < sizes[i]; k++) {
+            char v = (char)(k + i);
+            m.payload->append(&v, 1);
+        }
+        HELPER_ASSERT_SUCCESS(enc.encode_pes(&f, &m, 0x100, SrsTsStreamVideoH264, false));
+    }
+
+    SrsTsContext ctx;
+    MockTsCopyHandler h;
+    string data = f.str();
+    for (int i = 0; i < (int)data.length(); i += SRS_TS_PACKET_SIZE) {
+        SrsBuffer b((char*)data.data() + i, SRS_TS_PACKET_SIZE);
+        HELPER_ASSERT_SUCCESS(ctx.decode(&b, &h));
+    }
+
+    ASSERT_EQ(4, (int)h.payloads.size());
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(sizes[i], (int)h.payloads[i].length());
+        EXPECT_EQ((char)(sizes[i] - 1 + i), h.payloads[i][sizes[i] - 1]);
+    }
+
+    // The handled message is reused by the next PES.
+    EXPECT_TRUE(h.msgs[0] == h.msgs[1]);
+    EXPECT_TRUE(h.msgs[0] == h.msgs[3]);
+    ASSERT_TRUE(ctx.get(0x100) != NULL);
+    EXPECT_TRUE(ctx.get(0x100)->spare == h.msgs[3]);
+}
+
+static void mock_ts_timestamp(uint8_t* p, int prefix, int64_t v)
+{
+    p[0] = (uint8_t)((prefix << 4) | (((v >> 30) & 0x07) << 1) | 1);
+    p[1] = (uint8_t)(v >> 22);
+    p[2] = (uint8_t)((((v >> 15) & 0x7f) << 1) | 1);
+    p[3] = (uint8_t)(v >> 7);
+    p[4] = (uint8_t)(((v & 0x7f) << 1) | 1);
+}
+
+VOID TEST(KernelTSTest, PacketClock)
+{
+    uint8_t p[SRS_TS_PACKET_SIZE];
+
+    // The PES start of video, with PCR in adaptation field, and PTS and DTS.
+    if (true) {
+        memset(p, 0xff, sizeof(p));
+        uint8_t h[] = {0x47, 0x41, 0x00, 0x30, 0x07, 0x10};
+        memcpy(p, h, sizeof(h));
+
+        int64_t pcr = 0x123456789LL;
+        p[6] = (uint8_t)(pcr >> 25); p[7] = (uint8_t)(pcr >> 17); p[8] = (uint8_t)(pcr >> 9);
+        p[9] = (uint8_t)(pcr >> 1); p[10] = (uint8_t)(((pcr & 0x01) << 7) | 0x7e); p[11] = 0;
+
+        uint8_t pes[] = {0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0xc0, 0x0a};
+        memcpy(p + 12, pes, sizeof(pes));
+        mock_ts_timestamp(p + 21, 0x03, 0x1000);
+        mock_ts_timestamp(p + 26, 0x01, 0x1ffffff00LL);
+
+        EXPECT_EQ(0x123456789LL, srs_ts_packet_pcr((char*)p));
+        EXPECT_EQ(0x1ffffff00LL, srs_ts_packet_dts((char*)p));
+    }
+
+    // The PES start of audio, without adaptation field, only PTS.
+    if (true) {
+        memset(p, 0xff, sizeof(p));
+        uint8_t h[] = {0x47, 0x41, 0x01, 0x10, 0x00, 0x00, 0x01, 0xc0, 0x00, 0x00, 0x80, 0x80, 0x05};
+        memcpy(p, h, sizeof(h));
+        mock_ts_timestamp(p + 13, 0x02, 90000);
+
+        EXPECT_EQ(-1, srs_ts_packet_pcr((char*)p));
+        EXPECT_EQ(90000, srs_ts_packet_dts((char*)p));
+
+        // Not the start of PES.
+        p[1] = 0x01;
+        EXPECT_EQ(-1, srs_ts_packet_dts((char*)p));
+    }
+}
+
 VOID TEST(KernelTSTest, CoverTransmuxer)
 {
 	srs_error_t err;
@@ -4788,6 +6086,65 @@ VOID TEST(KernelTSTest, CoverTransmuxer)
     }
 }
 
+VOID TEST(KernelTSTest, HEVCTransmuxer)
+{
+    srs_error_t err;
+
+    // The hvcC with one VPS, SPS and PPS, for 1280x720.
+    uint8_t sh[] = {
+        0x1c, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0, 0x00, 0xfc,
+        0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+        0xa0, 0x00, 0x01, 0x00, 0x18,
+        0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09,
+        0xa1, 0x00, 0x01, 0x00, 0x18,
+        0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+        0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2d, 0x14,
+        0xa2, 0x00, 0x01, 0x00, 0x07,
+        0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40
+    };
+    // The IDR_W_RADL frame.
+    uint8_t idr[] = {
+        0x1c, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x06, 0x26, 0x01, 0xaf, 0x0a, 0x3b, 0x21
+    };
+
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)sh, sizeof(sh)));
+        EXPECT_TRUE(f.is_avc_sequence_header());
+        EXPECT_EQ(SrsVideoCodecIdHEVC, f.vcodec->id);
+        EXPECT_EQ(3, f.vcodec->NAL_unit_length);
+        EXPECT_EQ(24, (int)f.vcodec->videoParameterSetNALUnit.size());
+        EXPECT_EQ(24, (int)f.vcodec->sequenceParameterSetNALUnit.size());
+        EXPECT_EQ(7, (int)f.vcodec->pictureParameterSetNALUnit.size());
+        EXPECT_EQ(1280, f.vcodec->width);
+        EXPECT_EQ(720, f.vcodec->height);
+
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)idr, sizeof(idr)));
+        EXPECT_EQ(1, f.video->nb_samples);
+        EXPECT_TRUE(f.video->has_idr);
+        EXPECT_FALSE(f.video->has_aud);
+    }
+
+    if (true) {
+        SrsTsTransmuxer m;
+        MockSrsFileWriter f;
+        HELPER_EXPECT_SUCCESS(m.initialize(&f));
+
+        HELPER_EXPECT_SUCCESS(m.write_video(0, (char*)sh, sizeof(sh)));
+        HELPER_EXPECT_SUCCESS(m.write_video(40, (char*)idr, sizeof(idr)));
+
+        // The PMT signals the HEVC stream type, and the IDR is prefixed by the AUD and VPS.
+        string ts = f.str();
+        EXPECT_TRUE(ts.find(string("\x24\xe1\x00", 3)) != string::npos);
+        EXPECT_TRUE(ts.find(string("\x00\x00\x00\x01\x46\x01\x50\x00\x00\x01\x40\x01", 12)) != string::npos);
+    }
+}
+
 VOID TEST(KernelMP4Test, CoverMP4All)
 {
 	if (true) {
@@ -4914,6 +6271,118 @@ VOID TEST(KernelMP4Test, CoverMP4CodecSingleFrame)
     }
 }
 
+VOID TEST(KernelMP4Test, SampleIndexEquivalence)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter f;
+
+    // Encode 300 frames of A/V, with keyframe each 30 frames and cts.
+    if (true) {
+        SrsMp4Encoder enc; SrsFormat fmt;
+        HELPER_EXPECT_SUCCESS(enc.initialize(&f));
+        HELPER_EXPECT_SUCCESS(fmt.initialize());
+
+        if (true) {
+            uint8_t raw[] = {
+                0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        if (true) {
+            uint8_t raw[] = {
+                0xaf, 0x00, 0x12, 0x10
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        uint8_t payload[64];
+        memset(payload, 0x5a, sizeof(payload));
+        for (int i = 0; i < 300; i++) {
+            uint16_t ft = (i % 30 == 0)? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, ft, SrsVideoAvcFrameTraitNALU, i * 40, i * 40 + 80, payload, 16 + (i % 48)
+            ));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, SrsAudioAacFrameTraitRawData, i * 23 + 10, i * 23 + 10, payload, 8 + (i % 32)
+            ));
+        }
+
+        HELPER_EXPECT_SUCCESS(enc.flush());
+    }
+
+    // Load the moov box, from a real file because we need to seek over the mdat.
+    string filepath = _srs_tmp_file_prefix + "kernel-mp4-sample-index";
+    MockFileRemover _mfr(filepath);
+    if (true) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(filepath));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)f.data(), f.filesize(), NULL));
+    }
+    
+    SrsMp4MovieBox* moov = NULL;
+    if (true) {
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(filepath));
+        
+        SrsMp4BoxReader br;
+        HELPER_EXPECT_SUCCESS(br.initialize(&fr));
+
+        SrsSimpleStream stream;
+        while (!moov) {
+            SrsMp4Box* box = NULL;
+            HELPER_ASSERT_SUCCESS(br.read(&stream, &box));
+
+            SrsBuffer buffer(stream.bytes(), stream.length());
+            HELPER_ASSERT_SUCCESS(box->decode(&buffer));
+            HELPER_ASSERT_SUCCESS(br.skip(box, &stream));
+
+            if (box->is_moov()) {
+                moov = dynamic_cast<SrsMp4MovieBox*>(box);
+            } else {
+                srs_freep(box);
+            }
+        }
+    }
+    SrsAutoFree(SrsMp4MovieBox, moov);
+
+    // The index must be the same to the samples manager.
+    SrsMp4SampleManager mgr;
+    HELPER_EXPECT_SUCCESS(mgr.load(moov));
+
+    SrsMp4SampleIndex index;
+    HELPER_EXPECT_SUCCESS(index.load(moov));
+    EXPECT_EQ(600, (int)index.size());
+    EXPECT_EQ(mgr.samples.size(), index.size());
+
+    for (int i = 0; i < (int)mgr.samples.size(); i++) {
+        SrsMp4Sample* expect = mgr.samples.at(i);
+
+        SrsMp4Sample sample;
+        EXPECT_TRUE(index.next(&sample));
+        EXPECT_EQ(expect->type, sample.type);
+        EXPECT_EQ(expect->index, sample.index);
+        EXPECT_EQ(expect->offset, sample.offset);
+        EXPECT_EQ(expect->nb_data, sample.nb_data);
+        EXPECT_EQ(expect->dts, sample.dts);
+        EXPECT_EQ(expect->pts, sample.pts);
+        EXPECT_EQ(expect->tbn, sample.tbn);
+        EXPECT_EQ(expect->adjust, sample.adjust);
+        EXPECT_EQ(expect->frame_type, sample.frame_type);
+        EXPECT_EQ(expect->dts_ms(), sample.dts_ms());
+    }
+
+    SrsMp4Sample sample;
+    EXPECT_FALSE(index.next(&sample));
+}
+
 VOID TEST(KernelMP4Test, CoverMP4MultipleVideos)
 {
 	srs_error_t err;
@@ -5338,3 +6807,59 @@ VOID TEST(KernelMP4Test, CoverMP4M2tsSegmentEncoder)
     HELPER_EXPECT_SUCCESS(enc.flush(dts));
 }
 
+
+VOID TEST(KernelRecorderTest, RingAndDump)
+{
+    srs_error_t err;
+
+    // Disabled until initialized.
+    if (true) {
+        SrsFlightRecorder recorder;
+        EXPECT_FALSE(recorder.enabled());
+        EXPECT_EQ(0, recorder.begin());
+        recorder.record(SrsRecorderEventQueueShrink, 0, 1, 0);
+
+        std::string data;
+        recorder.dumps(data);
+        ASSERT_EQ(sizeof(SrsRecorderHeader), data.length());
+        EXPECT_EQ(0, (int)((SrsRecorderHeader*)data.data())->nn_events);
+    }
+
+    // Keep the last events, round up to power of 2.
+    if (true) {
+        SrsFlightRecorder recorder;
+        HELPER_EXPECT_SUCCESS(recorder.initialize(5, 0));
+        for (int i = 0; i < 10; i++) {
+            recorder.record(SrsRecorderEventSocketWrite, 100 + i, i, 0);
+        }
+
+        std::string data;
+        recorder.dumps(data);
+        ASSERT_EQ(sizeof(SrsRecorderHeader) + 8 * sizeof(SrsRecorderEvent), data.length());
+
+        SrsRecorderHeader* h = (SrsRecorderHeader*)data.data();
+        EXPECT_EQ(0, memcmp(h->magic, "SRSFREC1", 8));
+        EXPECT_EQ(8, (int)h->nn_events);
+        EXPECT_EQ(10, (int)h->nn_total);
+
+        SrsRecorderEvent* ev = (SrsRecorderEvent*)(data.data() + sizeof(SrsRecorderHeader));
+        EXPECT_EQ(3, (int)ev[0].sequence);
+        EXPECT_EQ(2, ev[0].value);
+        EXPECT_EQ(102, ev[0].duration);
+        EXPECT_EQ(SrsRecorderEventSocketWrite, ev[7].type);
+        EXPECT_EQ(9, ev[7].value);
+    }
+
+    // Ignore the event shorter than threshold.
+    if (true) {
+        SrsFlightRecorder recorder;
+        HELPER_EXPECT_SUCCESS(recorder.initialize(16, 10 * SRS_UTIME_SECONDS));
+        recorder.end(SrsRecorderEventHook, recorder.begin(), 0, 0);
+
+        std::string data;
+        recorder.dumps(data);
+        EXPECT_EQ(0, (int)((SrsRecorderHeader*)data.data())->nn_events);
+
+        HELPER_EXPECT_FAILED(SrsFlightRecorder().initialize(0, 0));
+    }
+}
@@ -1837,3 +1837,342 @@ VOID TEST(KernelMp4Test, SrsMp4M2tsInitEncoder)
     }
 }
 
+
+VOID TEST(KernelMp4Test, SrsMp4FragmentEncoder)
+{
+    srs_error_t err;
+
+    SrsFormat fmt;
+    HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+    uint8_t vsh[] = {
+        0x17,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+        0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+        0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)vsh, sizeof(vsh)));
+
+    uint8_t ash[] = {
+        0xaf, 0x00, 0x12, 0x10
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+
+    // The init contains both tracks.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4M2tsInitEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+        HELPER_ASSERT_SUCCESS(enc.write(&fmt, 1, 2));
+
+        SrsBuffer b(fw.data(), (int)fw.filesize());
+
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+        EXPECT_TRUE(box->is_ftyp());
+
+        SrsMp4Box* moov = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &moov));
+        SrsAutoFree(SrsMp4Box, moov);
+        HELPER_ASSERT_SUCCESS(moov->decode(&b));
+        ASSERT_TRUE(moov->is_moov());
+
+        SrsMp4MovieBox* mv = dynamic_cast<SrsMp4MovieBox*>(moov);
+        ASSERT_TRUE(mv->video() != NULL);
+        ASSERT_TRUE(mv->audio() != NULL);
+        EXPECT_EQ(1, (int)mv->video()->tkhd()->track_ID);
+        EXPECT_EQ(2, (int)mv->audio()->tkhd()->track_ID);
+        EXPECT_EQ(3, (int)mv->mvhd()->next_track_ID);
+        EXPECT_TRUE(mv->mvex() != NULL);
+    }
+
+    // No track to write.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4M2tsInitEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+        HELPER_EXPECT_FAILED(enc.write(&fmt, 0, 0));
+    }
+
+    // The fragment contains a traf for each track, and the samples in mdat.
+    if (true) {
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+        SrsMp4FragmentEncoder enc;
+        HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1, 2));
+        EXPECT_TRUE(enc.empty());
+        HELPER_EXPECT_FAILED(enc.flush());
+
+        uint8_t v0[] = {0x00, 0x00, 0x00, 0x02, 0x65, 0x88};
+        uint8_t v1[] = {0x00, 0x00, 0x00, 0x02, 0x41, 0x9a};
+        uint8_t a0[] = {0x21, 0x10};
+        uint8_t a1[] = {0x21, 0x11};
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 1000, 1040, v0, sizeof(v0)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0, 1010, 1010, a0, sizeof(a0)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 1040, 1040, v1, sizeof(v1)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0, 1033, 1033, a1, sizeof(a1)));
+        EXPECT_FALSE(enc.empty());
+        EXPECT_EQ(40, (int)enc.duration());
+
+        HELPER_ASSERT_SUCCESS(enc.flush());
+        EXPECT_TRUE(enc.empty());
+
+        SrsBuffer b(fw.data(), (int)fw.filesize());
+
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+
+        SrsMp4MovieFragmentBox* moof = dynamic_cast<SrsMp4MovieFragmentBox*>(box);
+        ASSERT_TRUE(moof != NULL);
+        EXPECT_EQ(1, (int)moof->mfhd()->sequence_number);
+
+        SrsMp4TrackFragmentBox* traf = moof->traf();
+        EXPECT_EQ(1, (int)traf->tfhd()->track_id);
+        EXPECT_EQ(1000, (int)traf->tfdt()->base_media_decode_time);
+
+        SrsMp4TrackFragmentRunBox* trun = traf->trun();
+        ASSERT_EQ(2, (int)trun->entries.size());
+        EXPECT_EQ(40, (int)trun->entries[0]->sample_duration);
+        EXPECT_EQ(40, (int)trun->entries[0]->sample_composition_time_offset);
+        EXPECT_EQ(0x02000000, (int)trun->entries[0]->sample_flags);
+        EXPECT_EQ(0x01010000, (int)trun->entries[1]->sample_flags);
+
+        // The video samples followed by audio samples in mdat.
+        int mdat = (int)moof->sz();
+        EXPECT_EQ(mdat + 8, trun->data_offset);
+        ASSERT_EQ(mdat + 8 + 16, (int)fw.filesize());
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 4, "mdat", 4));
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 8, v0, sizeof(v0)));
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 14, v1, sizeof(v1)));
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 20, a0, sizeof(a0)));
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 22, a1, sizeof(a1)));
+
+        // The sample of track not in init is ignored.
+        SrsMp4FragmentEncoder venc;
+        HELPER_ASSERT_SUCCESS(venc.initialize(&fw, 1, 0));
+        HELPER_ASSERT_SUCCESS(venc.write_sample(SrsMp4HandlerTypeSOUN, 0, 1010, 1010, a0, sizeof(a0)));
+        EXPECT_TRUE(venc.empty());
+    }
+}
+
+VOID TEST(KernelMp4Test, SrsMp4M2tsSegmentEncoderChunked)
+{
+    srs_error_t err;
+
+    uint8_t v0[] = {0x00, 0x00, 0x00, 0x02, 0x65, 0x88};
+    uint8_t v1[] = {0x00, 0x00, 0x00, 0x02, 0x41, 0x9a};
+    uint8_t v2[] = {0x00, 0x00, 0x00, 0x02, 0x41, 0x9b};
+
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.m4s"));
+
+    SrsMp4M2tsSegmentEncoder enc;
+    HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 10, 1000 * SRS_UTIME_MILLISECONDS, 1));
+    int nb_styp = (int)fw.filesize();
+
+    // Nothing to write when no sample.
+    uint64_t dts = 960;
+    HELPER_ASSERT_SUCCESS(enc.flush_chunk(dts));
+    EXPECT_EQ(nb_styp, (int)fw.filesize());
+
+    // The first chunk, without sidx.
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 1000, 1000, v0, sizeof(v0)));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 1040, 1040, v1, sizeof(v1)));
+    HELPER_ASSERT_SUCCESS(enc.flush_chunk(dts));
+    EXPECT_EQ(1040, (int)dts);
+    int nb_chunk0 = (int)fw.filesize();
+
+    // The last chunk is written by flush.
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 1080, 1080, v2, sizeof(v2)));
+    HELPER_ASSERT_SUCCESS(enc.flush(dts));
+    EXPECT_EQ(1080, (int)dts);
+
+    // The styp, then the moof and mdat of each chunk.
+    if (true) {
+        SrsBuffer b(fw.data(), nb_styp);
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        EXPECT_EQ(SrsMp4BoxTypeSTYP, box->type);
+    }
+
+    if (true) {
+        SrsBuffer b(fw.data() + nb_styp, nb_chunk0 - nb_styp);
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+
+        SrsMp4MovieFragmentBox* moof = dynamic_cast<SrsMp4MovieFragmentBox*>(box);
+        ASSERT_TRUE(moof != NULL);
+        EXPECT_EQ(10, (int)moof->mfhd()->sequence_number);
+        EXPECT_EQ(1000, (int)moof->traf()->tfdt()->base_media_decode_time);
+        ASSERT_EQ(2, (int)moof->traf()->trun()->entries.size());
+        EXPECT_EQ(40, (int)moof->traf()->trun()->entries[0]->sample_duration);
+        EXPECT_EQ(40, (int)moof->traf()->trun()->entries[1]->sample_duration);
+
+        int mdat = nb_styp + (int)moof->sz();
+        EXPECT_EQ(nb_chunk0, mdat + 8 + 12);
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 4, "mdat", 4));
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 8, v0, sizeof(v0)));
+    }
+
+    if (true) {
+        SrsBuffer b(fw.data() + nb_chunk0, (int)fw.filesize() - nb_chunk0);
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+
+        // The chunk continues the sequence and decode time of previous chunk.
+        SrsMp4MovieFragmentBox* moof = dynamic_cast<SrsMp4MovieFragmentBox*>(box);
+        ASSERT_TRUE(moof != NULL);
+        EXPECT_EQ(11, (int)moof->mfhd()->sequence_number);
+        EXPECT_EQ(1080, (int)moof->traf()->tfdt()->base_media_decode_time);
+        ASSERT_EQ(1, (int)moof->traf()->trun()->entries.size());
+
+        int mdat = nb_chunk0 + (int)moof->sz();
+        EXPECT_EQ((int)fw.filesize(), mdat + 8 + 6);
+        EXPECT_EQ(0, memcmp(fw.data() + mdat + 8, v2, sizeof(v2)));
+    }
+}
+
+VOID TEST(KernelMp4Test, SrsMp4Defragmenter)
+{
+    srs_error_t err;
+
+    SrsFormat fmt;
+    HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+    uint8_t vsh[] = {
+        0x17,
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+        0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+        0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)vsh, sizeof(vsh)));
+
+    uint8_t ash[] = {
+        0xaf, 0x00, 0x12, 0x10
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)ash, sizeof(ash)));
+
+    // Write the fMP4 with init and two fragments.
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    SrsMp4M2tsInitEncoder init;
+    HELPER_ASSERT_SUCCESS(init.initialize(&fw));
+    HELPER_ASSERT_SUCCESS(init.write(&fmt, 1, 2));
+    int nb_init = (int)fw.filesize();
+
+    uint8_t v0[] = {0x00, 0x00, 0x00, 0x02, 0x65, 0x88};
+    uint8_t v1[] = {0x00, 0x00, 0x00, 0x02, 0x41, 0x9a};
+    uint8_t a0[] = {0x21, 0x10};
+    uint8_t a1[] = {0x21, 0x11};
+
+    SrsMp4FragmentEncoder enc;
+    HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1, 2));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 0, 40, v0, sizeof(v0)));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0, 10, 10, a0, sizeof(a0)));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 40, 40, v1, sizeof(v1)));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0, 33, 33, a1, sizeof(a1)));
+    HELPER_ASSERT_SUCCESS(enc.flush());
+    int first = (int)fw.filesize();
+
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 80, 80, v0, sizeof(v0)));
+    HELPER_ASSERT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeSOUN, 0, 56, 56, a0, sizeof(a0)));
+    HELPER_ASSERT_SUCCESS(enc.flush());
+
+    // Convert to MP4, the samples are interleaved by dts.
+    if (true) {
+        MockSrsFileReader fr(fw.data(), (int)fw.filesize());
+        MockSrsFileWriter mw;
+        HELPER_ASSERT_SUCCESS(mw.open("test.mp4"));
+
+        SrsMp4Defragmenter defrag;
+        HELPER_ASSERT_SUCCESS(defrag.initialize(&fr, &mw));
+
+        bool done = false;
+        HELPER_ASSERT_SUCCESS(defrag.step(&done));
+        EXPECT_FALSE(done);
+        HELPER_ASSERT_SUCCESS(defrag.step(&done));
+        EXPECT_FALSE(done);
+        HELPER_ASSERT_SUCCESS(defrag.step(&done));
+        EXPECT_TRUE(done);
+        HELPER_ASSERT_SUCCESS(defrag.flush());
+
+        // Should be same to the MP4 written by samples in dts order.
+        MockSrsFileWriter pw;
+        HELPER_ASSERT_SUCCESS(pw.open("test.mp4"));
+
+        SrsMp4Encoder penc;
+        HELPER_ASSERT_SUCCESS(penc.initialize(&pw));
+        penc.vcodec = SrsVideoCodecIdAVC;
+        penc.acodec = SrsAudioCodecIdAAC;
+        penc.sample_rate = SrsAudioSampleRate44100;
+        penc.sound_bits = SrsAudioSampleBits16bit;
+        penc.channels = SrsAudioChannelsStereo;
+
+        HELPER_ASSERT_SUCCESS(penc.write_sample(&fmt, SrsMp4HandlerTypeVIDE, 0, SrsVideoAvcFrameTraitSequenceHeader, 0, 0,
+            (uint8_t*)&fmt.vcodec->avc_extra_data[0], (uint32_t)fmt.vcodec->avc_extra_data.size()));
+        HELPER_ASSERT_SUCCESS(penc.write_sample(&fmt, SrsMp4HandlerTypeSOUN, 0, SrsAudioAacFrameTraitSequenceHeader, 0, 0,
+            (uint8_t*)&fmt.acodec->aac_extra_data[0], (uint32_t)fmt.acodec->aac_extra_data.size()));
+
+        uint32_t dtses[] = {0, 10, 33, 40, 56, 80};
+        uint32_t ptses[] = {40, 10, 33, 40, 56, 80};
+        SrsMp4HandlerType hts[] = {SrsMp4HandlerTypeVIDE, SrsMp4HandlerTypeSOUN, SrsMp4HandlerTypeSOUN,
+            SrsMp4HandlerTypeVIDE, SrsMp4HandlerTypeSOUN, SrsMp4HandlerTypeVIDE};
+        uint16_t fts[] = {SrsVideoAvcFrameTypeKeyFrame, 0, 0, SrsVideoAvcFrameTypeInterFrame, 0, SrsVideoAvcFrameTypeKeyFrame};
+        uint8_t* samples[] = {v0, a0, a1, v1, a0, v0};
+        for (int i = 0; i < 6; i++) {
+            bool video = hts[i] == SrsMp4HandlerTypeVIDE;
+            uint16_t ct = video? (uint16_t)SrsVideoAvcFrameTraitNALU : (uint16_t)SrsAudioAacFrameTraitRawData;
+            HELPER_ASSERT_SUCCESS(penc.write_sample(&fmt, hts[i], fts[i], ct, dtses[i], ptses[i], samples[i], video? 6 : 2));
+        }
+        HELPER_ASSERT_SUCCESS(penc.flush());
+
+        ASSERT_EQ(pw.filesize(), mw.filesize());
+        EXPECT_EQ(0, memcmp(pw.data(), mw.data(), (int)mw.filesize()));
+    }
+
+    // The truncated fragment is ignored, for example, server crash.
+    if (true) {
+        MockSrsFileReader fr(fw.data(), (int)fw.filesize() - 1);
+        MockSrsFileWriter mw;
+        HELPER_ASSERT_SUCCESS(mw.open("test.mp4"));
+
+        SrsMp4Defragmenter defrag;
+        HELPER_ASSERT_SUCCESS(defrag.initialize(&fr, &mw));
+
+        bool done = false;
+        HELPER_ASSERT_SUCCESS(defrag.step(&done));
+        EXPECT_FALSE(done);
+        HELPER_ASSERT_SUCCESS(defrag.step(&done));
+        EXPECT_TRUE(done);
+        HELPER_ASSERT_SUCCESS(defrag.flush());
+        EXPECT_EQ(first, (int)defrag.offset);
+    }
+
+    // The moof must follow the moov.
+    if (true) {
+        MockSrsFileReader fr(fw.data() + nb_init, first - nb_init);
+        MockSrsFileWriter mw;
+        HELPER_ASSERT_SUCCESS(mw.open("test.mp4"));
+
+        SrsMp4Defragmenter defrag;
+        HELPER_ASSERT_SUCCESS(defrag.initialize(&fr, &mw));
+
+        bool done = false;
+        HELPER_EXPECT_FAILED(defrag.step(&done));
+    }
+}
@@ -91,6 +91,11 @@ srs_error_t MockEmptyIO::read(void* /*buf*/, size_t /*size*/, ssize_t* /*nread*/
     return srs_success;
 }
 
+srs_error_t MockEmptyIO::readv(const iovec* /*iov*/, int /*iov_size*/, ssize_t* /*nread*/)
+{
+    return srs_success;
+}
+
 MockBufferIO::MockBufferIO()
 {
     rtm = stm = SRS_UTIME_NO_TIMEOUT;
@@ -258,6 +263,32 @@ srs_error_t MockBufferIO::read(void* buf, size_t size, ssize_t* nread)
     return srs_success;
 }
 
+srs_error_t MockBufferIO::readv(const iovec *iov, int iov_size, ssize_t* nread)
+{
+    if (in_err != srs_success) {
+        return srs_error_copy(in_err);
+    }
+
+    if (in_buffer.length() <= 0) {
+        return srs_error_new(ERROR_SOCKET_READ, "readv");
+    }
+
+    ssize_t total = 0;
+    for (int i = 0; i < iov_size && in_buffer.length() > 0; i++) {
+        size_t available = srs_min(in_buffer.length(), (int)iov[i].iov_len);
+        memcpy(iov[i].iov_base, in_buffer.bytes(), available);
+        in_buffer.erase(available);
+        total += available;
+    }
+
+    rbytes += total;
+    if (nread) {
+        *nread = total;
+    }
+
+    return srs_success;
+}
+
 MockStatistic::MockStatistic()
 {
     in = out = 0;
@@ -569,6 +600,128 @@ VOID TEST(ProtocolHandshakeTest, SimpleHandshake)
     }
 }
 
+VOID TEST(ProtocolHandshakeTest, HMACsha256Cached)
+{
+    srs_error_t err;
+
+    char data[1504];
+    srs_random_generate(data, sizeof(data));
+
+    // Copy the genuine key, which is never cached.
+    uint8_t key[68];
+    memcpy(key, SrsGenuineFMSKey, sizeof(key));
+
+    char d0[32], d1[32], d2[32];
+    HELPER_EXPECT_SUCCESS(openssl_HMACsha256(key, 68, data, sizeof(data), d0));
+    HELPER_EXPECT_SUCCESS(openssl_HMACsha256(SrsGenuineFMSKey, 68, data, sizeof(data), d1));
+    HELPER_EXPECT_SUCCESS(openssl_HMACsha256(SrsGenuineFMSKey, 68, data, sizeof(data), d2));
+    EXPECT_TRUE(srs_bytes_equals(d0, d1, 32));
+    EXPECT_TRUE(srs_bytes_equals(d0, d2, 32));
+
+    // The same key in different size.
+    HELPER_EXPECT_SUCCESS(openssl_HMACsha256(key, 36, data, sizeof(data), d0));
+    HELPER_EXPECT_SUCCESS(openssl_HMACsha256(SrsGenuineFMSKey, 36, data, sizeof(data), d1));
+    EXPECT_TRUE(srs_bytes_equals(d0, d1, 32));
+    EXPECT_FALSE(srs_bytes_equals(d0, d2, 32));
+}
+
+VOID TEST(ProtocolHandshakeTest, DHPool)
+{
+    srs_error_t err;
+
+    SrsDHPool pool;
+    EXPECT_TRUE(NULL == pool.fetch());
+
+    // Never generate when disabled.
+    HELPER_EXPECT_SUCCESS(pool.refill(2));
+    EXPECT_EQ(0, pool.size());
+
+    pool.set_capacity(3);
+    HELPER_EXPECT_SUCCESS(pool.refill(2));
+    EXPECT_EQ(2, pool.size());
+    HELPER_EXPECT_SUCCESS(pool.refill(2));
+    EXPECT_EQ(3, pool.size());
+
+    // Each key is used once.
+    SrsDH* dh0 = pool.fetch();
+    SrsAutoFree(SrsDH, dh0);
+    SrsDH* dh1 = pool.fetch();
+    SrsAutoFree(SrsDH, dh1);
+    ASSERT_TRUE(dh0 && dh1);
+    EXPECT_TRUE(dh0->ready());
+    EXPECT_EQ(1, pool.size());
+
+    char k0[128], k1[128];
+    int size = 128;
+    HELPER_EXPECT_SUCCESS(dh0->copy_public_key(k0, size));
+    EXPECT_EQ(128, size);
+    HELPER_EXPECT_SUCCESS(dh1->copy_public_key(k1, size));
+    EXPECT_EQ(128, size);
+    EXPECT_FALSE(srs_bytes_equals(k0, k1, 128));
+
+    // The shared key of both sides is the same.
+    char s0[128], s1[128];
+    int s0_size = 128, s1_size = 128;
+    HELPER_EXPECT_SUCCESS(dh0->copy_shared_key(k1, 128, s0, s0_size));
+    HELPER_EXPECT_SUCCESS(dh1->copy_shared_key(k0, 128, s1, s1_size));
+    EXPECT_EQ(s0_size, s1_size);
+    EXPECT_TRUE(srs_bytes_equals(s0, s1, s0_size));
+
+    pool.set_capacity(0);
+    EXPECT_EQ(0, pool.size());
+}
+
+// Mock the complex handshake from client.
+srs_error_t mock_complex_handshake(char* c0c1, int loops)
+{
+    srs_error_t err = srs_success;
+
+    char c2[1536];
+    srs_random_generate(c2, sizeof(c2));
+
+    for (int i = 0; i < loops; i++) {
+        MockBufferIO io;
+        io.append((uint8_t*)c0c1, 1537);
+        io.append((uint8_t*)c2, 1536);
+
+        SrsHandshakeBytes bytes;
+        SrsComplexHandshake hs;
+        if ((err = hs.handshake_with_client(&bytes, &io)) != srs_success) {
+            return srs_error_wrap(err, "handshake %d", i);
+        }
+    }
+
+    return err;
+}
+
+VOID TEST(ProtocolHandshakeTest, ComplexHandshakeDHPool)
+{
+    srs_error_t err;
+
+    char c0c1[1537];
+    c0c1[0] = 0x03;
+    if (true) {
+        c1s1 c1;
+        HELPER_ASSERT_SUCCESS(c1.c1_create(srs_schema1));
+        HELPER_ASSERT_SUCCESS(c1.dump(c0c1 + 1, 1536));
+    }
+
+    // See the rtmp_complex_handshake of srs_ubench for the throughput.
+    int loops = 2;
+
+    // Generate the DH key for each handshake.
+    HELPER_EXPECT_SUCCESS(mock_complex_handshake(c0c1, loops));
+
+    // Use the pre-generated DH keys, which is generated in idle time.
+    _srs_dh_pool->set_capacity(loops);
+    HELPER_EXPECT_SUCCESS(_srs_dh_pool->refill(loops));
+    EXPECT_EQ(loops, _srs_dh_pool->size());
+
+    HELPER_EXPECT_SUCCESS(mock_complex_handshake(c0c1, loops));
+    EXPECT_EQ(0, _srs_dh_pool->size());
+    _srs_dh_pool->set_capacity(0);
+}
+
 /**
 * bytes equal utility
 */
@@ -608,6 +761,19 @@ VOID TEST(ProtocolUtilityTest, GenerateTcUrl)
     EXPECT_STREQ("rtmp://demo:19351/live", tcUrl.c_str());
 }
 
+/**
+* remove the marked items from query string
+*/
+VOID TEST(ProtocolUtilityTest, QueryRemove)
+{
+    EXPECT_STREQ("", srs_query_remove("", "mark").c_str());
+    EXPECT_STREQ("?a=1", srs_query_remove("?a=1", "mark").c_str());
+    EXPECT_STREQ("", srs_query_remove("?mark=1", "mark").c_str());
+    EXPECT_STREQ("?a=1&b=2", srs_query_remove("?a=1&mark=1&b=2", "mark").c_str());
+    EXPECT_STREQ("?a=1", srs_query_remove("?mark=0&a=1&mark=1", "mark").c_str());
+    EXPECT_STREQ("a=1", srs_query_remove("a=1&&xmark=1", "mark").c_str());
+}
+
 /**
 * shared ptr message array test
 */
@@ -4621,6 +4787,322 @@ VOID TEST(ProtocolStackTest, ProtocolRecvVCid3BNormal4)
     EXPECT_EQ(0x02 + (0x10*256) + 64, msg->header.perfer_cid);
 }
 
+/**
+* the chunk streams not in cache, in flat table.
+*/
+VOID TEST(ProtocolStackTest, ProtocolRecvChunkStreamMisses)
+{
+    srs_error_t err;
+
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+
+    // video message with 1B payload, the basic header is filled later.
+    uint8_t msg[] = {
+        0x00, 0x00, 0x00, // timestamp
+        0x00, 0x00, 0x01, // length, 1
+        0x09, // message_type
+        0x00, 0x00, 0x00, 0x00, // stream_id
+        0x17,
+    };
+
+    // cid 3 in cache, 100 by 2B, 65599 by 3B, then 100 again.
+    uint8_t headers[][3] = {{0x03}, {0x00, 100 - 64}, {0x01, 0xFF, 0xFF}, {0x00, 100 - 64}};
+    int sizes[] = {1, 2, 3, 2};
+    int cids[] = {3, 100, 65599, 100};
+    for (int i = 0; i < 4; i++) {
+        bio.in_buffer.append((char*)headers[i], sizes[i]);
+        bio.in_buffer.append((char*)msg, sizeof(msg));
+    }
+
+    int64_t misses[] = {0, 1, 2, 3};
+    int tables[] = {0, 101, 65600, 65600};
+    for (int i = 0; i < 4; i++) {
+        SrsCommonMessage* m = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&m));
+        SrsAutoFree(SrsCommonMessage, m);
+        EXPECT_TRUE(m->header.is_video());
+        EXPECT_EQ(cids[i], m->header.perfer_cid);
+        EXPECT_EQ(misses[i], proto.get_chunk_stream_misses());
+        EXPECT_EQ(tables[i], proto.nb_chunk_streams);
+    }
+
+    // The chunk stream is reused.
+    ASSERT_TRUE(proto.chunk_streams[100] != NULL);
+    EXPECT_EQ(2, proto.chunk_streams[100]->msg_count);
+    EXPECT_TRUE(proto.chunk_streams[101] == NULL);
+}
+
+VOID TEST(ProtocolStackTest, ProtocolCacheMemory)
+{
+    srs_error_t err;
+
+    SrsMemoryStat* global = srs_memory_global();
+    int64_t nn_global = global->bytes[SrsMemoryProtocolCache];
+
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+
+        // The iovs, c0c3 headers and the cached chunk streams.
+        int64_t nn_proto = global->bytes[SrsMemoryProtocolCache] - nn_global;
+        EXPECT_LT(SRS_CONSTS_C0C3_HEADERS_MAX, nn_proto);
+
+        // Move the bytes to the stat of stream.
+        SrsMemoryStat stat;
+        proto.set_memory(&stat, SrsMemoryRecvBuffer);
+        EXPECT_EQ(nn_proto, stat.bytes[SrsMemoryProtocolCache]);
+
+        // The table and chunk stream for cid 100, which is not in cache.
+        uint8_t data[] = {0x00, 100 - 64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x09, 0x00, 0x00, 0x00, 0x00, 0x17};
+        bio.in_buffer.append((char*)data, sizeof(data));
+
+        SrsCommonMessage* m = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&m));
+        srs_freep(m);
+
+        int64_t nn_cs = 101 * sizeof(SrsChunkStream*) + sizeof(SrsChunkStream);
+        EXPECT_EQ(nn_proto + nn_cs, stat.bytes[SrsMemoryProtocolCache]);
+        EXPECT_EQ(nn_global + nn_proto + nn_cs, global->bytes[SrsMemoryProtocolCache]);
+
+        proto.set_memory(NULL, SrsMemoryRecvBuffer);
+        EXPECT_EQ(0, stat.bytes[SrsMemoryProtocolCache]);
+    }
+
+    EXPECT_EQ(nn_global, global->bytes[SrsMemoryProtocolCache]);
+}
+
+VOID TEST(ProtocolStackTest, ProtocolRecvMessages)
+{
+    srs_error_t err;
+
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+
+    // video message with 1B payload, in fmt0.
+    uint8_t msg0[] = {
+        0x03,
+        0x00, 0x00, 0x00, // timestamp
+        0x00, 0x00, 0x01, // length, 1
+        0x09, // message_type
+        0x00, 0x00, 0x00, 0x00, // stream_id
+        0x17,
+    };
+    // video message with 1B payload, in fmt3.
+    uint8_t msg3[] = {0xC3, 0x27};
+    // video message with 2B payload, in fmt0, only the first byte is sent.
+    uint8_t partial[] = {
+        0x03,
+        0x00, 0x00, 0x00, // timestamp
+        0x00, 0x00, 0x02, // length, 2
+        0x09, // message_type
+        0x00, 0x00, 0x00, 0x00, // stream_id
+        0x17,
+    };
+    bio.in_buffer.append((char*)msg0, sizeof(msg0));
+    bio.in_buffer.append((char*)msg3, sizeof(msg3));
+    bio.in_buffer.append((char*)msg3, sizeof(msg3));
+    bio.in_buffer.append((char*)partial, sizeof(partial));
+
+    SrsCommonMessage* msgs[8];
+
+    // Got the complete messages, never block for the partial one.
+    if (true) {
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(proto.recv_messages(msgs, 8, count));
+        ASSERT_EQ(3, count);
+        for (int i = 0; i < count; i++) {
+            EXPECT_TRUE(msgs[i]->header.is_video());
+            EXPECT_EQ(1, msgs[i]->size);
+            srs_freep(msgs[i]);
+        }
+    }
+
+    // Limited by the max messages.
+    bio.in_buffer.append((char*)"\x17", 1);
+    bio.in_buffer.append((char*)msg3, sizeof(msg3));
+    if (true) {
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(proto.recv_messages(msgs, 1, count));
+        ASSERT_EQ(1, count);
+        EXPECT_EQ(2, msgs[0]->size);
+        srs_freep(msgs[0]);
+    }
+
+    // The fmt3 message in buffer, which reuses the last header of 2B payload.
+    if (true) {
+        EXPECT_FALSE(proto.chunk_in_buffer());
+        bio.in_buffer.append((char*)"\x27", 1);
+
+        int count = 0;
+        HELPER_ASSERT_SUCCESS(proto.recv_messages(msgs, 8, count));
+        ASSERT_EQ(1, count);
+        EXPECT_EQ(2, msgs[0]->size);
+        srs_freep(msgs[0]);
+    }
+}
+
+VOID TEST(ProtocolStackTest, ProtocolRecvBufferedMessage)
+{
+    srs_error_t err;
+
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+
+    // video message with 1B payload, in fmt0.
+    uint8_t msg0[] = {
+        0x03,
+        0x00, 0x00, 0x00, // timestamp
+        0x00, 0x00, 0x01, // length, 1
+        0x09, // message_type
+        0x00, 0x00, 0x00, 0x00, // stream_id
+        0x17,
+    };
+    bio.in_buffer.append((char*)msg0, sizeof(msg0) - 1);
+
+    // Never read from socket, no message in buffer.
+    SrsCommonMessage* msg = NULL;
+    HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+    EXPECT_TRUE(msg == NULL);
+
+    // Read the partial message, which is not parsed.
+    HELPER_ASSERT_SUCCESS(proto.read_available());
+    EXPECT_EQ(0, bio.in_buffer.length());
+    HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+    EXPECT_TRUE(msg == NULL);
+
+    // Got the message when the last byte is read.
+    bio.in_buffer.append((char*)"\x17", 1);
+    HELPER_ASSERT_SUCCESS(proto.read_available());
+    HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+    ASSERT_TRUE(msg != NULL);
+    EXPECT_TRUE(msg->header.is_video());
+    EXPECT_EQ(1, msg->size);
+    srs_freep(msg);
+
+    // Fail when socket has no data.
+    err = proto.read_available();
+    EXPECT_TRUE(err != srs_success);
+    srs_freep(err);
+
+    // The fresh fmt3 chunk fails without reading from socket.
+    bio.in_buffer.append((char*)"\xC4\x27", 2);
+    HELPER_ASSERT_SUCCESS(proto.read_available());
+    err = proto.recv_buffered_message(&msg);
+    EXPECT_TRUE(err != srs_success);
+    srs_freep(err);
+}
+
+VOID TEST(ProtocolStackTest, ProtocolReadAvailable)
+{
+    srs_error_t err;
+
+    // video message with 1B payload, in fmt0.
+    uint8_t msg0[] = {
+        0x03,
+        0x00, 0x00, 0x00, // timestamp
+        0x00, 0x00, 0x01, // length, 1
+        0x09, // message_type
+        0x00, 0x00, 0x00, 0x00, // stream_id
+        0x17,
+    };
+
+    // No buffered bytes, never read from socket.
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+        bio.in_buffer.append((char*)msg0, sizeof(msg0));
+
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        EXPECT_TRUE(msg == NULL);
+        EXPECT_EQ((int)sizeof(msg0), bio.in_buffer.length());
+    }
+
+    // A partial chunk header is buffered, which is kept for the next read.
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+        bio.in_buffer.append((char*)msg0, 5);
+
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.read_available());
+        EXPECT_EQ(0, bio.in_buffer.length());
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        EXPECT_TRUE(msg == NULL);
+
+        bio.in_buffer.append((char*)msg0 + 5, sizeof(msg0) - 5);
+        HELPER_ASSERT_SUCCESS(proto.read_available());
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_EQ(1, msg->size);
+        srs_freep(msg);
+    }
+
+    // A complete message in two chunks, the first chunk is kept in the chunk stream.
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+
+        // video message with 200B payload, in fmt0 of 128B, then fmt3 of 72B.
+        uint8_t header[] = {
+            0x03,
+            0x00, 0x00, 0x00, // timestamp
+            0x00, 0x00, 0xC8, // length, 200
+            0x09, // message_type
+            0x00, 0x00, 0x00, 0x00, // stream_id
+        };
+        string payload(200, (char)0x27);
+        payload[0] = 0x17;
+        bio.in_buffer.append((char*)header, sizeof(header));
+        bio.in_buffer.append(payload.data(), 128);
+
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.read_available());
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        EXPECT_TRUE(msg == NULL);
+        EXPECT_FALSE(proto.chunk_in_buffer());
+
+        bio.in_buffer.append((char*)"\xC3", 1);
+        bio.in_buffer.append(payload.data() + 128, 72);
+        HELPER_ASSERT_SUCCESS(proto.read_available());
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_TRUE(msg->header.is_video());
+        EXPECT_EQ(200, msg->size);
+        EXPECT_TRUE(srs_bytes_equals(msg->payload, (void*)payload.data(), 200));
+        srs_freep(msg);
+    }
+
+    // Several messages are read once, then consumed one by one.
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+
+        // video message with 1B payload, in fmt3.
+        uint8_t msg3[] = {0xC3, 0x27};
+        bio.in_buffer.append((char*)msg0, sizeof(msg0));
+        bio.in_buffer.append((char*)msg3, sizeof(msg3));
+        bio.in_buffer.append((char*)msg3, sizeof(msg3));
+
+        HELPER_ASSERT_SUCCESS(proto.read_available());
+        EXPECT_EQ(0, bio.in_buffer.length());
+
+        for (int i = 0; i < 3; i++) {
+            SrsCommonMessage* msg = NULL;
+            HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+            ASSERT_TRUE(msg != NULL);
+            EXPECT_EQ(1, msg->size);
+            EXPECT_EQ(i == 0? 0x17 : 0x27, (uint8_t)msg->payload[0]);
+            srs_freep(msg);
+        }
+
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_buffered_message(&msg));
+        EXPECT_TRUE(msg == NULL);
+    }
+}
+
 /**
 * a video message, in 2 chunks packet.
 * use 3B chunk header, max chunk id is 65599.
@@ -26,6 +26,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace std;
 
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
 
 MockReloadHandler::MockReloadHandler()
 {
@@ -351,6 +352,25 @@ VOID TEST(ConfigReloadTest, ReloadListen)
     handler.reset();
 }
 
+VOID TEST(ConfigReloadTest, ReloadVhostSnapshot)
+{
+    MockReloadHandler handler;
+    MockSrsReloadConfig conf;
+    
+    conf.subscribe(&handler);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.parse(_MIN_OK_CONF"vhost a{play{atc on;}}"));
+    
+    SrsVhostSnapshot* snapshot = conf.get_vhost_snapshot("a");
+    EXPECT_TRUE(snapshot->atc);
+    
+    // The pointer is kept, and updated by reload.
+    EXPECT_TRUE(ERROR_SUCCESS == conf.do_reload(_MIN_OK_CONF"vhost a{play{atc off;}}"));
+    EXPECT_TRUE(handler.vhost_play_reloaded);
+    EXPECT_FALSE(snapshot->atc);
+    EXPECT_TRUE(snapshot == conf.get_vhost_snapshot("a"));
+    handler.reset();
+}
+
 VOID TEST(ConfigReloadTest, ReloadPid)
 {
     MockReloadHandler handler;
@@ -729,6 +749,40 @@ VOID TEST(ConfigReloadTest, ReloadVhostTimeJitter)
     handler.reset();
 }
 
+VOID TEST(ConfigReloadTest, ReloadManyVhosts)
+{
+    MockReloadHandler handler;
+    MockSrsReloadConfig conf;
+    
+    std::string vhosts;
+    for (int i = 0; i < 300; i++) {
+        vhosts += "vhost v" + srs_int2str(i) + "{hls {enabled on;}}";
+    }
+    
+    conf.subscribe(&handler);
+    EXPECT_TRUE(ERROR_SUCCESS == conf.parse(_MIN_OK_CONF + vhosts));
+    EXPECT_TRUE(ERROR_SUCCESS == conf.do_reload(_MIN_OK_CONF + vhosts));
+    EXPECT_TRUE(handler.all_false());
+    handler.reset();
+    
+    // Only the changed vhost is reloaded.
+    EXPECT_TRUE(ERROR_SUCCESS == conf.do_reload(_MIN_OK_CONF + vhosts + "vhost v250{hls {enabled off;}}"));
+    EXPECT_TRUE(handler.all_false());
+    handler.reset();
+    
+    std::string changed = vhosts;
+    changed.replace(changed.find("vhost v250{hls {enabled on;}}"), 29, "vhost v250{hls {enabled off;}}");
+    EXPECT_TRUE(ERROR_SUCCESS == conf.do_reload(_MIN_OK_CONF + changed));
+    EXPECT_TRUE(handler.vhost_hls_reloaded);
+    EXPECT_EQ(1, handler.count_true());
+    handler.reset();
+    
+    EXPECT_TRUE(ERROR_SUCCESS == conf.do_reload(_MIN_OK_CONF + changed + "vhost x{}"));
+    EXPECT_TRUE(handler.vhost_added_reloaded);
+    EXPECT_EQ(1, handler.count_true());
+    handler.reset();
+}
+
 VOID TEST(ConfigReloadTest, ReloadVhostForward)
 {
     MockReloadHandler handler;
@@ -0,0 +1,702 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013-2020 Winlin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <srs_utest_rtc.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_rtc_stack.hpp>
+#include <srs_relay_stack.hpp>
+#include <srs_app_relay.hpp>
+#include <srs_kernel_flv.hpp>
+
+// Decode the hex string, for example, "E1F9" to "\xE1\xF9".
+static string mock_hex_decode(string hex)
+{
+    string bytes;
+    for (int i = 0; i + 1 < (int)hex.length(); i += 2) {
+        bytes.push_back((char)::strtol(hex.substr(i, 2).c_str(), NULL, 16));
+    }
+    return bytes;
+}
+
+VOID TEST(RTCTest, SrtpKeyDerivation)
+{
+    srs_error_t err;
+    
+    // The test vectors of key derivation, @see https://tools.ietf.org/html/rfc3711#appendix-B.3
+    string key = mock_hex_decode("E1F97A0D3E018BE0D64FA32C06DE4139");
+    string salt = mock_hex_decode("0EC675AD498AFEEBB6960B3AABE6");
+    
+    SrsSrtp srtp;
+    HELPER_EXPECT_SUCCESS(srtp.initialize(key.data(), salt.data()));
+    
+    EXPECT_EQ(mock_hex_decode("C61E7A93744F39EE10734AFE3FF7A087"), string((char*)srtp.rtp_key, 16));
+    EXPECT_EQ(mock_hex_decode("30CBBC08863D8C85D49DB34A9AE1"), string((char*)srtp.rtp_salt, 14));
+    EXPECT_EQ(mock_hex_decode("CEBE321F6FF7716B6FD4AB49AF256A156D38BAA4"), string((char*)srtp.rtp_auth, 20));
+}
+
+VOID TEST(RTCTest, SrtpProtectUnprotect)
+{
+    srs_error_t err;
+    
+    string key = mock_hex_decode("E1F97A0D3E018BE0D64FA32C06DE4139");
+    string salt = mock_hex_decode("0EC675AD498AFEEBB6960B3AABE6");
+    
+    SrsSrtp sender, receiver;
+    HELPER_EXPECT_SUCCESS(sender.initialize(key.data(), salt.data()));
+    HELPER_EXPECT_SUCCESS(receiver.initialize(key.data(), salt.data()));
+    
+    // The RTP packet, seq=0x1234, ssrc=0x01020304, with 100 bytes payload.
+    char rtp[SRS_RTP_MAX_PACKET];
+    memset(rtp, 0, sizeof(rtp));
+    rtp[0] = (char)0x80; rtp[1] = 102; rtp[2] = 0x12; rtp[3] = 0x34;
+    rtp[8] = 0x01; rtp[9] = 0x02; rtp[10] = 0x03; rtp[11] = 0x04;
+    for (int i = 0; i < 100; i++) {
+        rtp[SRS_RTP_HEADER + i] = (char)i;
+    }
+    string plaintext(rtp, SRS_RTP_HEADER + 100);
+    
+    if (true) {
+        char buf[SRS_RTP_MAX_PACKET];
+        memcpy(buf, plaintext.data(), plaintext.length());
+        
+        int size = (int)plaintext.length();
+        HELPER_EXPECT_SUCCESS(sender.protect_rtp(buf, &size, 1));
+        EXPECT_EQ((int)plaintext.length() + SRS_SRTP_AUTH_TAG, size);
+        // The header is not encrypted, while the payload is.
+        EXPECT_EQ(plaintext.substr(0, SRS_RTP_HEADER), string(buf, SRS_RTP_HEADER));
+        EXPECT_NE(plaintext, string(buf, plaintext.length()));
+        
+        // The ROC is authenticated, so the wrong ROC fails.
+        char copy[SRS_RTP_MAX_PACKET];
+        memcpy(copy, buf, size);
+        int nn = size;
+        HELPER_EXPECT_FAILED(receiver.unprotect_rtp(copy, &nn, 0));
+        
+        HELPER_EXPECT_SUCCESS(receiver.unprotect_rtp(buf, &size, 1));
+        EXPECT_EQ(plaintext, string(buf, size));
+    }
+    
+    // The tampered packet fails.
+    if (true) {
+        char buf[SRS_RTP_MAX_PACKET];
+        memcpy(buf, plaintext.data(), plaintext.length());
+        
+        int size = (int)plaintext.length();
+        HELPER_EXPECT_SUCCESS(sender.protect_rtp(buf, &size, 0));
+        buf[SRS_RTP_HEADER + 10] ^= 0x01;
+        HELPER_EXPECT_FAILED(receiver.unprotect_rtp(buf, &size, 0));
+    }
+    
+    // The RTCP with the SRTCP index and E flag.
+    if (true) {
+        char buf[SRS_RTP_MAX_PACKET];
+        memset(buf, 0, sizeof(buf));
+        buf[0] = (char)0x81; buf[1] = (char)205; buf[3] = 3;
+        buf[4] = 0x01; buf[8] = 0x02; buf[12] = 0x03;
+        string rtcp(buf, 16);
+        
+        int size = 16;
+        HELPER_EXPECT_SUCCESS(sender.protect_rtcp(buf, &size));
+        EXPECT_EQ(16 + SRS_SRTCP_INDEX + SRS_SRTP_AUTH_TAG, size);
+        EXPECT_EQ((uint8_t)0x80, (uint8_t)buf[16]);
+        EXPECT_EQ(1, (int)sender.srtcp_index);
+        
+        HELPER_EXPECT_SUCCESS(receiver.unprotect_rtcp(buf, &size));
+        EXPECT_EQ(rtcp, string(buf, size));
+    }
+}
+
+VOID TEST(RTCTest, StunBinding)
+{
+    srs_error_t err;
+    
+    // The check value of CRC32 for FINGERPRINT.
+    EXPECT_EQ((uint32_t)0xCBF43926, srs_crc32_ieee("123456789", 9));
+    
+    char buf[SRS_RTP_MAX_PACKET];
+    int size = 0;
+    
+    if (true) {
+        SrsStunPacket req;
+        req.message_type = SrsStunBindingRequest;
+        req.transaction_id = "0123456789ab";
+        req.username = "server:player";
+        req.use_candidate = true;
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(req.encode("password", &stream));
+        size = stream.pos();
+        EXPECT_TRUE(srs_is_stun(buf, size));
+        EXPECT_FALSE(srs_is_dtls(buf, size));
+        EXPECT_EQ(size - 20, ((uint8_t)buf[2] << 8) | (uint8_t)buf[3]);
+    }
+    
+    if (true) {
+        SrsStunPacket req;
+        HELPER_EXPECT_SUCCESS(req.decode(buf, size));
+        EXPECT_EQ(SrsStunBindingRequest, req.message_type);
+        EXPECT_STREQ("0123456789ab", req.transaction_id.c_str());
+        EXPECT_STREQ("server", req.local_ufrag().c_str());
+        EXPECT_STREQ("player", req.remote_ufrag().c_str());
+        EXPECT_TRUE(req.use_candidate);
+        EXPECT_TRUE(req.verify(buf, size, "password"));
+        EXPECT_FALSE(req.verify(buf, size, "passwore"));
+    }
+    
+    if (true) {
+        SrsStunPacket res;
+        res.message_type = SrsStunBindingSuccessResponse;
+        res.transaction_id = "0123456789ab";
+        res.mapped_address = 0xc0a8010a;
+        res.mapped_port = 50000;
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(res.encode("password", &stream));
+        
+        SrsStunPacket pkt;
+        HELPER_EXPECT_SUCCESS(pkt.decode(buf, stream.pos()));
+        EXPECT_EQ(SrsStunBindingSuccessResponse, pkt.message_type);
+        EXPECT_EQ((uint32_t)0xc0a8010a, pkt.mapped_address);
+        EXPECT_EQ(50000, pkt.mapped_port);
+        EXPECT_TRUE(pkt.verify(buf, stream.pos(), "password"));
+    }
+    
+    // The invalid magic cookie.
+    if (true) {
+        buf[4] = 0;
+        SrsStunPacket pkt;
+        HELPER_EXPECT_FAILED(pkt.decode(buf, size));
+    }
+}
+
+VOID TEST(RTCTest, SdpOfferAnswer)
+{
+    srs_error_t err;
+    
+    string offer = "v=0\r\n"
+        "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+        "s=-\r\n"
+        "t=0 0\r\n"
+        "a=group:BUNDLE 0 1\r\n"
+        "a=msid-semantic: WMS\r\n"
+        "m=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"
+        "c=IN IP4 0.0.0.0\r\n"
+        "a=ice-ufrag:abcd\r\n"
+        "a=ice-pwd:0123456789abcdef01234567\r\n"
+        "a=fingerprint:sha-256 AB:CD:EF\r\n"
+        "a=setup:actpass\r\n"
+        "a=mid:0\r\n"
+        "a=recvonly\r\n"
+        "a=rtcp-mux\r\n"
+        "a=rtpmap:111 opus/48000/2\r\n"
+        "m=video 9 UDP/TLS/RTP/SAVPF 96 102 108\r\n"
+        "c=IN IP4 0.0.0.0\r\n"
+        "a=mid:1\r\n"
+        "a=recvonly\r\n"
+        "a=rtcp-mux\r\n"
+        "a=rtpmap:96 VP8/90000\r\n"
+        "a=rtpmap:102 H264/90000\r\n"
+        "a=rtcp-fb:102 nack\r\n"
+        "a=rtcp-fb:102 nack pli\r\n"
+        "a=fmtp:102 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42001f\r\n"
+        "a=rtpmap:108 H264/90000\r\n"
+        "a=fmtp:108 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n";
+    
+    SrsRtcSdp sdp;
+    HELPER_EXPECT_SUCCESS(sdp.parse(offer));
+    EXPECT_STREQ("4611731400430051336", sdp.session_id.c_str());
+    EXPECT_STREQ("abcd", sdp.ice_ufrag.c_str());
+    EXPECT_STREQ("0123456789abcdef01234567", sdp.ice_pwd.c_str());
+    EXPECT_STREQ("sha-256", sdp.fingerprint_algo.c_str());
+    EXPECT_STREQ("AB:CD:EF", sdp.fingerprint.c_str());
+    ASSERT_EQ(2, (int)sdp.medias.size());
+    
+    SrsRtcSdpMedia& audio = sdp.medias.at(0);
+    EXPECT_STREQ("audio", audio.type.c_str());
+    EXPECT_EQ(-1, audio.find_h264());
+    
+    // Prefer the constrained baseline profile.
+    SrsRtcSdpMedia& video = sdp.medias.at(1);
+    EXPECT_STREQ("1", video.mid.c_str());
+    EXPECT_STREQ("recvonly", video.direction.c_str());
+    EXPECT_TRUE(video.rtcp_mux);
+    ASSERT_EQ(3, (int)video.payload_types.size());
+    EXPECT_EQ(2, (int)video.rtcp_fbs[102].size());
+    EXPECT_EQ(108, video.find_h264());
+    
+    // The answer bundles the accepted media only.
+    SrsRtcSdp answer;
+    answer.ice_lite = true;
+    answer.ice_ufrag = "srs";
+    answer.ice_pwd = "pwd";
+    answer.fingerprint_algo = "sha-256";
+    answer.fingerprint = "01:02";
+    answer.setup = "passive";
+    answer.candidates.push_back("1 udp 2130706431 192.168.1.10 8000 typ host");
+    
+    SrsRtcSdpMedia rejected;
+    rejected.type = "audio";
+    rejected.protocol = "UDP/TLS/RTP/SAVPF";
+    rejected.mid = "0";
+    rejected.payload_types.push_back(111);
+    answer.medias.push_back(rejected);
+    
+    SrsRtcSdpMedia accepted;
+    accepted.type = "video";
+    accepted.port = 9;
+    accepted.protocol = "UDP/TLS/RTP/SAVPF";
+    accepted.mid = "1";
+    accepted.direction = "sendonly";
+    accepted.rtcp_mux = true;
+    accepted.payload_types.push_back(108);
+    accepted.rtpmaps[108] = "H264/90000";
+    accepted.fmtps[108] = "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f";
+    accepted.ssrc = 100;
+    accepted.cname = "srs";
+    answer.medias.push_back(accepted);
+    
+    string s = answer.encode();
+    EXPECT_TRUE(s.find("a=ice-lite\r\n") != string::npos);
+    EXPECT_TRUE(s.find("a=group:BUNDLE 1\r\n") != string::npos);
+    EXPECT_TRUE(s.find("m=audio 0 UDP/TLS/RTP/SAVPF 111\r\n") != string::npos);
+    EXPECT_TRUE(s.find("m=video 9 UDP/TLS/RTP/SAVPF 108\r\n") != string::npos);
+    EXPECT_TRUE(s.find("a=rtpmap:108 H264/90000\r\n") != string::npos);
+    EXPECT_TRUE(s.find("a=ssrc:100 cname:srs\r\n") != string::npos);
+    EXPECT_TRUE(s.find("a=candidate:1 udp 2130706431 192.168.1.10 8000 typ host\r\n") != string::npos);
+    
+    // The answer is parsed again.
+    SrsRtcSdp parsed;
+    HELPER_EXPECT_SUCCESS(parsed.parse(s));
+    EXPECT_TRUE(parsed.ice_lite);
+    EXPECT_STREQ("passive", parsed.setup.c_str());
+    ASSERT_EQ(2, (int)parsed.medias.size());
+    EXPECT_EQ(0, parsed.medias.at(0).port);
+    EXPECT_EQ(108, parsed.medias.at(1).find_h264());
+}
+
+VOID TEST(RTCTest, H264Packetizer)
+{
+    SrsRtpH264Packetizer packetizer(102, 0x01020304);
+    vector<string> packets;
+    
+    // The SPS and PPS in a STAP-A.
+    if (true) {
+        char sps[] = {0x67, 0x42, 0x00, 0x1f};
+        char pps[] = {0x68, (char)0xce, 0x3c};
+        packetizer.packetize_sps_pps(90000, vector<char>(sps, sps + 4), vector<char>(pps, pps + 3), packets);
+        ASSERT_EQ(1, (int)packets.size());
+        
+        string& p = packets.at(0);
+        EXPECT_EQ(SRS_RTP_HEADER + 1 + 2 + 4 + 2 + 3, (int)p.length());
+        EXPECT_EQ(102, (uint8_t)p[1]);
+        EXPECT_EQ(0x60 | 24, (uint8_t)p[SRS_RTP_HEADER]);
+        EXPECT_EQ(4, (uint8_t)p[SRS_RTP_HEADER + 2]);
+    }
+    
+    // The small NALU in single NAL unit, and the large one in FU-A, with AUD ignored.
+    if (true) {
+        vector<char> aud(2, 0x09);
+        vector<char> small(100, 0x01);
+        small[0] = 0x06;
+        vector<char> large(3000, 0x02);
+        large[0] = 0x65;
+        
+        SrsSample samples[3];
+        samples[0].bytes = &aud[0]; samples[0].size = 2;
+        samples[1].bytes = &small[0]; samples[1].size = 100;
+        samples[2].bytes = &large[0]; samples[2].size = 3000;
+        
+        packets.clear();
+        packetizer.packetize(180000, samples, 3, packets);
+        
+        // The 2999 bytes of FU-A are in 3 packets, at most 1198 bytes each.
+        ASSERT_EQ(4, (int)packets.size());
+        EXPECT_EQ(SRS_RTP_HEADER + 100, (int)packets.at(0).length());
+        EXPECT_EQ(0, (uint8_t)packets.at(0)[1] & 0x80);
+        
+        EXPECT_EQ(0x60 | 28, (uint8_t)packets.at(1)[SRS_RTP_HEADER]);
+        EXPECT_EQ(0x80 | 5, (uint8_t)packets.at(1)[SRS_RTP_HEADER + 1]);
+        EXPECT_EQ(5, (uint8_t)packets.at(2)[SRS_RTP_HEADER + 1]);
+        EXPECT_EQ(0x40 | 5, (uint8_t)packets.at(3)[SRS_RTP_HEADER + 1]);
+        EXPECT_EQ(SRS_RTP_MAX_PAYLOAD + SRS_RTP_HEADER, (int)packets.at(1).length());
+        
+        int total = 0;
+        for (int i = 1; i < 4; i++) {
+            total += (int)packets.at(i).length() - SRS_RTP_HEADER - 2;
+        }
+        EXPECT_EQ(2999, total);
+        
+        // Only the last packet has the marker, and the sequence increases.
+        EXPECT_EQ(0x80, (uint8_t)packets.at(3)[1] & 0x80);
+        EXPECT_EQ(0, (uint8_t)packets.at(2)[1] & 0x80);
+        EXPECT_EQ(1, (uint8_t)packets.at(0)[3]);
+        EXPECT_EQ(4, (uint8_t)packets.at(3)[3]);
+    }
+}
+
+VOID TEST(RTCTest, RtcpFeedback)
+{
+    srs_error_t err;
+    
+    // The compound RTCP of RR, NACK and PLI.
+    uint8_t rtcp[] = {
+        // RR, without report block.
+        0x80, 201, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        // NACK, PID=100, BLP=0x0005
+        0x81, 205, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x01, 0x02, 0x03, 0x04, 0x00, 100, 0x00, 0x05,
+        // PLI
+        0x81, 206, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x01, 0x02, 0x03, 0x04,
+    };
+    EXPECT_TRUE(srs_is_rtp_or_rtcp((char*)rtcp, sizeof(rtcp)));
+    EXPECT_TRUE(srs_is_rtcp((char*)rtcp, sizeof(rtcp)));
+    
+    SrsRtcpFeedback feedback;
+    HELPER_EXPECT_SUCCESS(feedback.decode((char*)rtcp, sizeof(rtcp)));
+    ASSERT_EQ(3, (int)feedback.nacks.size());
+    EXPECT_EQ(100, feedback.nacks.at(0));
+    EXPECT_EQ(101, feedback.nacks.at(1));
+    EXPECT_EQ(103, feedback.nacks.at(2));
+    EXPECT_TRUE(feedback.keyframe);
+    
+    // The truncated packet fails.
+    SrsRtcpFeedback truncated;
+    HELPER_EXPECT_FAILED(truncated.decode((char*)rtcp, 14));
+}
+
+
+VOID TEST(RelayTest, PacketEncodeDecode)
+{
+    srs_error_t err;
+    
+    char buf[SRS_RELAY_MAX_PACKET];
+    
+    if (true) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketData;
+        pkt.conn_id = 0x01020304;
+        pkt.pn = 10; pkt.base_gop = 1; pkt.gop = 2; pkt.seq = 3; pkt.prev = 4;
+        pkt.flags = SRS_RELAY_FLAG_FIRST;
+        pkt.payload = "Hello"; pkt.size = 5;
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+        EXPECT_EQ(pkt.nb_bytes(), stream.pos());
+        
+        SrsRelayPacket decoded;
+        HELPER_EXPECT_SUCCESS(decoded.decode(buf, stream.pos()));
+        EXPECT_EQ(SrsRelayPacketData, decoded.type);
+        EXPECT_EQ(0x01020304, (int)decoded.conn_id);
+        EXPECT_EQ(10, (int)decoded.pn);
+        EXPECT_EQ(1, (int)decoded.base_gop);
+        EXPECT_EQ(2, (int)decoded.gop);
+        EXPECT_EQ(3, (int)decoded.seq);
+        EXPECT_EQ(4, (int)decoded.prev);
+        EXPECT_EQ(SRS_RELAY_FLAG_FIRST, decoded.flags);
+        EXPECT_EQ("Hello", string(decoded.payload, decoded.size));
+        
+        // The truncated packet fails.
+        SrsRelayPacket truncated;
+        HELPER_EXPECT_FAILED(truncated.decode(buf, 20));
+    }
+    
+    if (true) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketAck;
+        pkt.ranges.push_back(make_pair(7, 9));
+        pkt.ranges.push_back(make_pair(0, 5));
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+        
+        SrsRelayPacket decoded;
+        HELPER_EXPECT_SUCCESS(decoded.decode(buf, stream.pos()));
+        ASSERT_EQ(2, (int)decoded.ranges.size());
+        EXPECT_EQ(7, (int)decoded.ranges.at(0).first);
+        EXPECT_EQ(9, (int)decoded.ranges.at(0).second);
+        EXPECT_EQ(0, (int)decoded.ranges.at(1).first);
+        EXPECT_EQ(5, (int)decoded.ranges.at(1).second);
+    }
+    
+    if (true) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketConnect;
+        pkt.url = "rtmp://127.0.0.1:1935/live/livestream";
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+        
+        SrsRelayPacket decoded;
+        HELPER_EXPECT_SUCCESS(decoded.decode(buf, stream.pos()));
+        EXPECT_EQ(SrsRelayPacketConnect, decoded.type);
+        EXPECT_EQ(pkt.url, decoded.url);
+    }
+}
+
+VOID TEST(RelayTest, PacketToken)
+{
+    srs_error_t err;
+    
+    char buf[SRS_RELAY_MAX_PACKET];
+    
+    if (true) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketConnect;
+        pkt.url = "rtmp://127.0.0.1:1935/live/livestream";
+        pkt.token = string(SRS_RELAY_TOKEN_SIZE, 'x');
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+        EXPECT_EQ(pkt.nb_bytes(), stream.pos());
+        
+        SrsRelayPacket decoded;
+        HELPER_EXPECT_SUCCESS(decoded.decode(buf, stream.pos()));
+        EXPECT_EQ(pkt.url, decoded.url);
+        EXPECT_EQ(pkt.token, decoded.token);
+    }
+    
+    if (true) {
+        SrsRelayPacket pkt;
+        pkt.type = SrsRelayPacketChallenge;
+        pkt.conn_id = 100;
+        pkt.token = "challenge";
+        
+        SrsBuffer stream(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+        
+        SrsRelayPacket decoded;
+        HELPER_EXPECT_SUCCESS(decoded.decode(buf, stream.pos()));
+        EXPECT_EQ(SrsRelayPacketChallenge, decoded.type);
+        EXPECT_EQ("challenge", decoded.token);
+        
+        // The token exceeds the max size fails.
+        pkt.token = string(SRS_RELAY_TOKEN_SIZE + 1, 'x');
+        SrsBuffer large(buf, sizeof(buf));
+        HELPER_EXPECT_SUCCESS(pkt.encode(&large));
+        HELPER_EXPECT_FAILED(decoded.decode(buf, large.pos()));
+    }
+}
+
+VOID TEST(RelayTest, SignAndVerify)
+{
+    srs_error_t err;
+    
+    char buf[SRS_RELAY_MAX_PACKET + SRS_RELAY_MAC_SIZE];
+    
+    SrsRelayPacket pkt;
+    pkt.type = SrsRelayPacketPing;
+    pkt.conn_id = 100;
+    
+    SrsBuffer stream(buf, SRS_RELAY_MAX_PACKET);
+    HELPER_EXPECT_SUCCESS(pkt.encode(&stream));
+    
+    int size = stream.pos();
+    HELPER_EXPECT_SUCCESS(srs_relay_sign("secret", buf, size));
+    EXPECT_EQ(stream.pos() + SRS_RELAY_MAC_SIZE, size);
+    
+    // The packet signed by other secret, or tampered, fails.
+    if (true) {
+        int nn = size;
+        HELPER_EXPECT_FAILED(srs_relay_verify("other", buf, nn));
+    }
+    if (true) {
+        int nn = size;
+        buf[1] ^= 0x01;
+        HELPER_EXPECT_FAILED(srs_relay_verify("secret", buf, nn));
+        buf[1] ^= 0x01;
+    }
+    if (true) {
+        int nn = SRS_RELAY_MAC_SIZE;
+        HELPER_EXPECT_FAILED(srs_relay_verify("secret", buf, nn));
+    }
+    
+    HELPER_EXPECT_SUCCESS(srs_relay_verify("secret", buf, size));
+    EXPECT_EQ(stream.pos(), size);
+    
+    SrsRelayPacket decoded;
+    HELPER_EXPECT_SUCCESS(decoded.decode(buf, size));
+    EXPECT_EQ(100, (int)decoded.conn_id);
+}
+
+VOID TEST(RelayTest, ReceiverAckRanges)
+{
+    SrsRelayReceiver receiver;
+    
+    uint32_t pns[] = {0, 1, 2, 5, 4, 2};
+    for (int i = 0; i < (int)(sizeof(pns) / sizeof(uint32_t)); i++) {
+        receiver.on_pn(pns[i]);
+    }
+    
+    ASSERT_EQ(2, (int)receiver.ranges.size());
+    EXPECT_EQ(4, (int)receiver.ranges.at(0).first);
+    EXPECT_EQ(5, (int)receiver.ranges.at(0).second);
+    EXPECT_EQ(0, (int)receiver.ranges.at(1).first);
+    EXPECT_EQ(2, (int)receiver.ranges.at(1).second);
+    
+    // The gap is filled, merged to one range.
+    receiver.on_pn(3);
+    ASSERT_EQ(1, (int)receiver.ranges.size());
+    EXPECT_EQ(0, (int)receiver.ranges.at(0).first);
+    EXPECT_EQ(5, (int)receiver.ranges.at(0).second);
+}
+
+// Create the video message, the keyframe if key, and the sequence header if sh.
+static SrsSharedPtrMessage* mock_relay_video(int64_t timestamp, bool key, bool sh, int size)
+{
+    char* payload = new char[size];
+    memset(payload, 0, size);
+    payload[0] = key? 0x17 : 0x27;
+    payload[1] = sh? 0x00 : 0x01;
+    
+    SrsMessageHeader header;
+    header.message_type = RTMP_MSG_VideoMessage;
+    header.timestamp = timestamp;
+    
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&header, payload, size);
+    srs_freep(err);
+    return msg;
+}
+
+// Send the message by sender, and deliver its packets to receiver, except the dropped ones.
+static void mock_relay_send(SrsRelaySender* sender, SrsRelayReceiver* receiver, SrsSharedPtrMessage* msg, bool drop)
+{
+    vector<string> pkts;
+    srs_error_t err = sender->on_message(msg, 0, pkts);
+    srs_freep(err);
+    srs_freep(msg);
+    
+    for (int i = 0; i < (int)pkts.size() && !drop; i++) {
+        SrsRelayPacket pkt;
+        err = pkt.decode((char*)pkts.at(i).data(), (int)pkts.at(i).length());
+        if (err == srs_success) {
+            err = receiver->on_data(&pkt, 0);
+        }
+        srs_freep(err);
+    }
+}
+
+VOID TEST(RelayTest, RetransmitLostFrame)
+{
+    srs_error_t err;
+    
+    SrsRelaySender sender(100);
+    SrsRelayReceiver receiver;
+    
+    // The keyframe of 3000 bytes is in 3 frames, the second one is lost.
+    vector<string> pkts;
+    SrsSharedPtrMessage* key = mock_relay_video(40, true, false, 3000);
+    HELPER_EXPECT_SUCCESS(sender.on_message(key, 0, pkts));
+    srs_freep(key);
+    ASSERT_EQ(3, (int)pkts.size());
+    EXPECT_EQ(3, sender.nn_inflight());
+    
+    for (int i = 0; i < 3; i++) {
+        SrsRelayPacket pkt;
+        HELPER_EXPECT_SUCCESS(pkt.decode((char*)pkts.at(i).data(), (int)pkts.at(i).length()));
+        if (i != 1) {
+            HELPER_EXPECT_SUCCESS(receiver.on_data(&pkt, 0));
+        }
+    }
+    
+    // The following inter frames are received, but not delivered before the lost frame.
+    for (int i = 0; i < 3; i++) {
+        mock_relay_send(&sender, &receiver, mock_relay_video(80 + 40 * i, false, false, 100), false);
+    }
+    
+    SrsCommonMessage* msg = NULL;
+    HELPER_EXPECT_SUCCESS(receiver.fetch(&msg));
+    EXPECT_TRUE(msg == NULL);
+    
+    // The ACK removes the received frames, and the lost frame is retransmitted by packet threshold.
+    SrsRelayPacket ack;
+    EXPECT_TRUE(receiver.should_ack(0));
+    receiver.ack(&ack);
+    
+    pkts.clear();
+    sender.on_ack(&ack, 10 * SRS_UTIME_MILLISECONDS, pkts);
+    ASSERT_EQ(1, (int)pkts.size());
+    EXPECT_EQ(1, sender.nn_retransmits);
+    EXPECT_EQ(1, sender.nn_inflight());
+    
+    SrsRelayPacket pkt;
+    HELPER_EXPECT_SUCCESS(pkt.decode((char*)pkts.at(0).data(), (int)pkts.at(0).length()));
+    EXPECT_EQ(6, (int)pkt.pn);
+    EXPECT_EQ(1, (int)pkt.seq);
+    HELPER_EXPECT_SUCCESS(receiver.on_data(&pkt, 0));
+    
+    // All messages are delivered in order.
+    int64_t timestamps[] = {40, 80, 120, 160};
+    int sizes[] = {3000, 100, 100, 100};
+    for (int i = 0; i < 4; i++) {
+        HELPER_EXPECT_SUCCESS(receiver.fetch(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_TRUE(msg->header.is_video());
+        EXPECT_EQ(timestamps[i], msg->header.timestamp);
+        EXPECT_EQ(sizes[i], msg->size);
+        srs_freep(msg);
+    }
+    
+    HELPER_EXPECT_SUCCESS(receiver.fetch(&msg));
+    EXPECT_TRUE(msg == NULL);
+}
+
+VOID TEST(RelayTest, AbandonGop)
+{
+    srs_error_t err;
+    
+    SrsRelaySender sender(100);
+    SrsRelayReceiver receiver;
+    
+    // The sequence header and the first GOP are lost.
+    mock_relay_send(&sender, &receiver, mock_relay_video(0, true, true, 50), true);
+    mock_relay_send(&sender, &receiver, mock_relay_video(0, true, false, 100), true);
+    mock_relay_send(&sender, &receiver, mock_relay_video(40, false, false, 100), true);
+    
+    // The receiver waits for the first GOP, which is abandoned by sender at the third GOP.
+    mock_relay_send(&sender, &receiver, mock_relay_video(80, true, false, 100), false);
+    
+    SrsCommonMessage* msg = NULL;
+    HELPER_EXPECT_SUCCESS(receiver.fetch(&msg));
+    EXPECT_TRUE(msg == NULL);
+    
+    mock_relay_send(&sender, &receiver, mock_relay_video(120, true, false, 100), false);
+    EXPECT_EQ(2, receiver.nn_skipped);
+    EXPECT_EQ(3, sender.nn_abandoned);
+    
+    // The sequence header is abandoned with the GOP before first keyframe, so it's sent again before
+    // the keyframe of second GOP.
+    bool sh[] = {true, false, false};
+    int64_t timestamps[] = {0, 80, 120};
+    for (int i = 0; i < 3; i++) {
+        HELPER_EXPECT_SUCCESS(receiver.fetch(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_EQ(sh[i], SrsFlvVideo::sh(msg->payload, msg->size));
+        EXPECT_EQ(timestamps[i], msg->header.timestamp);
+        srs_freep(msg);
+    }
+}
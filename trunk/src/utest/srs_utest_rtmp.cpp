@@ -34,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <srs_service_http_conn.hpp>
 #include <srs_kernel_buffer.hpp>
 #include <srs_kernel_codec.hpp>
+#include <srs_protocol_stream.hpp>
 
 #define SRS_DEFAULT_RECV_BUFFER_SIZE 131072
 
@@ -1211,6 +1212,39 @@ VOID TEST(ProtocolRTMPTest, RecvMessage3)
         EXPECT_STREQ("//", req.get_stream_url().c_str());
     }
 
+    if (true) {
+        EXPECT_EQ(srs_hash_stream_url("/live/livestream"), srs_generate_stream_hash("__defaultVhost__", "live", "livestream"));
+        EXPECT_EQ(srs_hash_stream_url("ossrs.net/live/livestream"), srs_generate_stream_hash("ossrs.net", "live", "livestream"));
+        EXPECT_NE(srs_generate_stream_hash("", "live", "livestream"), srs_generate_stream_hash("", "live", "livestream2"));
+
+        EXPECT_TRUE(srs_stream_url_equals("/live/livestream", "__defaultVhost__", "live", "livestream"));
+        EXPECT_TRUE(srs_stream_url_equals("ossrs.net/live/livestream", "ossrs.net", "live", "livestream"));
+        EXPECT_FALSE(srs_stream_url_equals("ossrs.net/live/livestream", "ossrs.net", "live", "livestream2"));
+        EXPECT_FALSE(srs_stream_url_equals("ossrs.net/live/livestream", "ossrs.net", "live/livestream", ""));
+    }
+
+    if (true) {
+        int nn = SrsStreamKey::size();
+        EXPECT_TRUE(NULL == SrsStreamKey::find("utest.ossrs.net", "live", "interned"));
+        EXPECT_EQ(nn, SrsStreamKey::size());
+
+        SrsRequest req;
+        req.vhost = "utest.ossrs.net";
+        req.app = "live";
+        req.stream = "interned";
+        EXPECT_TRUE(NULL == req.get_stream_key(false));
+
+        SrsStreamKey* key = req.get_stream_key();
+        EXPECT_TRUE(key != NULL);
+        EXPECT_STREQ("utest.ossrs.net/live/interned", key->url.c_str());
+        EXPECT_EQ(nn + 1, SrsStreamKey::size());
+
+        EXPECT_TRUE(key == SrsStreamKey::intern("utest.ossrs.net", "live", "interned"));
+        EXPECT_TRUE(key == SrsStreamKey::find("utest.ossrs.net/live/interned"));
+        EXPECT_TRUE(key == req.get_stream_key(false));
+        EXPECT_EQ(nn + 1, SrsStreamKey::size());
+    }
+
     if (true) {
         SrsRequest req;
         EXPECT_STREQ("", req.schema.c_str());
@@ -2277,6 +2311,106 @@ VOID TEST(ProtocolRTMPTest, ServerRecursiveDepth)
     }
 }
 
+VOID TEST(ProtocolRTMPTest, ServerCorkedResponses)
+{
+    srs_error_t err;
+    
+    // The responses of connect app are sent by uncork.
+    if (true) {
+        MockBufferIO io;
+        SrsRtmpServer r(&io);
+        SrsRequest req;
+        
+        r.cork();
+        HELPER_EXPECT_SUCCESS(r.set_window_ack_size(2500000));
+        HELPER_EXPECT_SUCCESS(r.set_peer_bandwidth(2500000, 2));
+        HELPER_EXPECT_SUCCESS(r.set_chunk_size(60000));
+        HELPER_EXPECT_SUCCESS(r.response_connect_app(&req, "127.0.0.1"));
+        HELPER_EXPECT_SUCCESS(r.on_bw_done());
+        EXPECT_EQ(0, io.out_length());
+        
+        HELPER_EXPECT_SUCCESS(r.uncork());
+        EXPECT_TRUE(io.out_length() > 0);
+        
+        // The _result is larger than 128 bytes, chunked by the new chunk size.
+        if (true) {
+            MockBufferIO tio;
+            tio.in_buffer.append(&io.out_buffer);
+            
+            SrsProtocol p(&tio);
+            p.requests[1] = RTMP_AMF0_COMMAND_CONNECT;
+            
+            SrsCommonMessage* msg = NULL;
+            SrsConnectAppResPacket* pkt = NULL;
+            HELPER_ASSERT_SUCCESS(p.expect_message(&msg, &pkt));
+            EXPECT_TRUE(msg->size > 128);
+            EXPECT_EQ(60000, p.in_chunk_size);
+            srs_freep(msg);
+            srs_freep(pkt);
+            
+            SrsCallPacket* bw = NULL;
+            HELPER_ASSERT_SUCCESS(p.expect_message(&msg, &bw));
+            srs_freep(msg);
+            srs_freep(bw);
+        }
+    }
+    
+    // The large messages queued are sent before the chunk size changes.
+    if (true) {
+        MockBufferIO io;
+        SrsRtmpServer r(&io);
+        SrsRequest req;
+        
+        r.cork();
+        HELPER_EXPECT_SUCCESS(r.response_connect_app(&req, "127.0.0.1"));
+        EXPECT_EQ(0, io.out_length());
+        
+        HELPER_EXPECT_SUCCESS(r.set_chunk_size(60000));
+        int nn = io.out_length();
+        EXPECT_TRUE(nn > 0);
+        
+        HELPER_EXPECT_SUCCESS(r.on_bw_done());
+        EXPECT_EQ(nn, io.out_length());
+        
+        HELPER_EXPECT_SUCCESS(r.uncork());
+        EXPECT_TRUE(io.out_length() > nn);
+        
+        if (true) {
+            MockBufferIO tio;
+            tio.in_buffer.append(&io.out_buffer);
+            
+            SrsProtocol p(&tio);
+            p.requests[1] = RTMP_AMF0_COMMAND_CONNECT;
+            
+            SrsCommonMessage* msg = NULL;
+            SrsConnectAppResPacket* pkt = NULL;
+            HELPER_ASSERT_SUCCESS(p.expect_message(&msg, &pkt));
+            srs_freep(msg);
+            srs_freep(pkt);
+            
+            SrsCallPacket* bw = NULL;
+            HELPER_ASSERT_SUCCESS(p.expect_message(&msg, &bw));
+            EXPECT_EQ(60000, p.in_chunk_size);
+            srs_freep(msg);
+            srs_freep(bw);
+        }
+    }
+    
+    // The recv uncorks, for the peer may wait for the responses.
+    if (true) {
+        MockBufferIO io;
+        SrsRtmpServer r(&io);
+        
+        r.cork();
+        HELPER_EXPECT_SUCCESS(r.on_bw_done());
+        EXPECT_EQ(0, io.out_length());
+        
+        SrsCommonMessage* msg = NULL;
+        HELPER_EXPECT_FAILED(r.recv_message(&msg));
+        EXPECT_TRUE(io.out_length() > 0);
+    }
+}
+
 VOID TEST(ProtocolRTMPTest, ServerResponseCommands)
 {
     srs_error_t err;
@@ -3526,3 +3660,93 @@ VOID TEST(ProtocolRTMPTest, DiscoveryTcUrl)
     }
 }
 
+
+// The mock io which reads small bytes by read, to make sure the chunk body is not in buffer.
+class MockSmallReadIO : public MockBufferIO
+{
+public:
+    int max_read;
+public:
+    MockSmallReadIO(int v) : max_read(v) {
+    }
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread) {
+        return MockBufferIO::read(buf, srs_min(max_read, (int)size), nread);
+    }
+};
+
+VOID TEST(ProtocolRTMPTest, RecvMessageDirectRead)
+{
+    srs_error_t err;
+
+    // The message of 10000 bytes in chunks of 6000 bytes, then a small message.
+    string payload;
+    for (int i = 0; i < 10000; i++) {
+        payload.append(1, (char)(i % 251));
+    }
+
+    MockSmallReadIO io(16);
+    SrsProtocol p(&io);
+    p.in_chunk_size = 6000;
+
+    uint8_t h0[] = {0x03, 0,0,0, 0x00,0x27,0x10, 9, 0,0,0,0};
+    io.in_buffer.append((char*)h0, sizeof(h0));
+    io.in_buffer.append(payload.data(), 6000);
+
+    uint8_t h3[] = {0xc3};
+    io.in_buffer.append((char*)h3, sizeof(h3));
+    io.in_buffer.append(payload.data() + 6000, 4000);
+
+    uint8_t m1[] = {0x04, 0,0,0, 0,0,3, 8, 0,0,0,0, 7,8,9};
+    io.in_buffer.append((char*)m1, sizeof(m1));
+
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(p.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+
+        EXPECT_TRUE(msg->header.is_video());
+        ASSERT_EQ(10000, msg->size);
+        EXPECT_TRUE(0 == memcmp(payload.data(), msg->payload, 10000));
+    }
+
+    // The next message is read ahead to buffer by readv.
+    EXPECT_EQ(0, io.in_buffer.length());
+    EXPECT_EQ((int)sizeof(m1), p.in_buffer->size());
+
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(p.recv_message(&msg));
+        SrsAutoFree(SrsCommonMessage, msg);
+
+        EXPECT_TRUE(msg->header.is_audio());
+        ASSERT_EQ(3, msg->size);
+        EXPECT_EQ(7, msg->payload[0]); EXPECT_EQ(9, msg->payload[2]);
+    }
+}
+
+VOID TEST(ProtocolRTMPTest, FastStreamReadTo)
+{
+    srs_error_t err;
+
+    MockSmallReadIO io(4);
+    io.in_buffer.append("HelloWorld, SRS", 15);
+
+    SrsFastStream b;
+    HELPER_EXPECT_SUCCESS(b.grow(&io, 1));
+    EXPECT_EQ(4, b.size());
+
+    // Copy from buffer, then readv to dst and buffer.
+    char dst[10];
+    HELPER_EXPECT_SUCCESS(b.read_to(&io, dst, 10));
+    EXPECT_TRUE(0 == memcmp("HelloWorld", dst, 10));
+    EXPECT_EQ(5, b.size());
+    EXPECT_TRUE(0 == memcmp(", SRS", b.bytes(), 5));
+
+    // All in buffer.
+    HELPER_EXPECT_SUCCESS(b.read_to(&io, dst, 2));
+    EXPECT_TRUE(0 == memcmp(", ", dst, 2));
+    EXPECT_EQ(3, b.size());
+
+    // Failed when no more data.
+    HELPER_EXPECT_FAILED(b.read_to(&io, dst, 5));
+}
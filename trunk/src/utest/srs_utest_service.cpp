@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace std;
 
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_app_listener.hpp>
 #include <srs_service_st.hpp>
 #include <srs_service_utility.hpp>
@@ -38,8 +39,10 @@ using namespace std;
 #include <srs_service_utility.hpp>
 #include <srs_service_http_client.hpp>
 #include <srs_service_rtmp_conn.hpp>
+#include <srs_service_dns.hpp>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <arpa/inet.h>
 
 class MockSrsConnection : public ISrsConnection
 {
@@ -64,6 +67,19 @@ VOID TEST(ServiceTimeTest, TimeUnit)
     EXPECT_FALSE(srs_is_never_timeout(0));
 }
 
+VOID TEST(ServiceTimeTest, MonotonicTime)
+{
+    srs_utime_t starttime = srs_update_monotonic_time();
+    EXPECT_TRUE(starttime > 0);
+    EXPECT_EQ(starttime, srs_get_monotonic_time());
+
+    // The cache is updated by the clock of ST, when coroutine switched.
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+    srs_utime_t elapsed = srs_get_monotonic_time() - starttime;
+    EXPECT_TRUE(elapsed >= 10 * SRS_UTIME_MILLISECONDS);
+    EXPECT_TRUE(elapsed < 1 * SRS_UTIME_SECONDS);
+}
+
 class MockTcpHandler : public ISrsTcpHandler
 {
 private:
@@ -91,6 +107,67 @@ srs_error_t MockTcpHandler::on_tcp_client(srs_netfd_t stfd)
 	return srs_success;
 }
 
+class MockUdpHandler : public ISrsUdpHandler
+{
+public:
+    int nn_packets;
+    int nn_batches;
+    int nn_bytes;
+public:
+    MockUdpHandler() {
+        nn_packets = nn_batches = nn_bytes = 0;
+    }
+    virtual ~MockUdpHandler() {
+    }
+public:
+    virtual srs_error_t on_udp_packet(const sockaddr* /*from*/, const int /*fromlen*/, char* /*buf*/, int nb_buf) {
+        nn_packets++;
+        nn_bytes += nb_buf;
+        return srs_success;
+    }
+    virtual srs_error_t on_udp_packets(SrsUdpPacket** pkts, int nn_pkts) {
+        nn_batches++;
+        return ISrsUdpHandler::on_udp_packets(pkts, nn_pkts);
+    }
+};
+
+VOID TEST(UDPServerTest, BatchRecv)
+{
+    srs_error_t err;
+
+    MockUdpHandler h;
+    SrsUdpListener l(&h, _srs_tmp_host, _srs_tmp_port);
+    l.set_batch(16);
+    HELPER_ASSERT_SUCCESS(l.listen());
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_TRUE(fd > 0);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_srs_tmp_port);
+    addr.sin_addr.s_addr = inet_addr(_srs_tmp_host.c_str());
+
+    char buf[188 * 7];
+    memset(buf, 0x47, sizeof(buf));
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ((ssize_t)sizeof(buf), ::sendto(fd, buf, sizeof(buf), 0, (sockaddr*)&addr, sizeof(addr)));
+    }
+    ::close(fd);
+
+    // Let the listener to receive packets.
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+
+    EXPECT_EQ(10, h.nn_packets);
+    EXPECT_EQ(10 * (int)sizeof(buf), h.nn_bytes);
+#ifdef SRS_PERF_UDP_RECVMMSG
+    EXPECT_TRUE(h.nn_batches < 10);
+#else
+    EXPECT_EQ(10, h.nn_batches);
+#endif
+}
+
 VOID TEST(TCPServerTest, PingPong)
 {
 	srs_error_t err;
@@ -181,6 +258,66 @@ VOID TEST(TCPServerTest, PingPong)
 	}
 }
 
+class MockTcpBatchHandler : public ISrsTcpHandler
+{
+public:
+    std::vector<srs_netfd_t> fds;
+public:
+    MockTcpBatchHandler();
+    virtual ~MockTcpBatchHandler();
+public:
+    virtual srs_error_t on_tcp_client(srs_netfd_t stfd);
+};
+
+MockTcpBatchHandler::MockTcpBatchHandler()
+{
+}
+
+MockTcpBatchHandler::~MockTcpBatchHandler()
+{
+    for (int i = 0; i < (int)fds.size(); i++) {
+        srs_close_stfd(fds[i]);
+    }
+}
+
+srs_error_t MockTcpBatchHandler::on_tcp_client(srs_netfd_t stfd)
+{
+    fds.push_back(stfd);
+    return srs_success;
+}
+
+VOID TEST(TCPServerTest, AcceptInBatch)
+{
+    srs_error_t err;
+
+    MockTcpBatchHandler h;
+    SrsTcpListener l(&h, _srs_tmp_host, _srs_tmp_port);
+    l.set_batch(4);
+    HELPER_ASSERT_SUCCESS(l.listen());
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_srs_tmp_port);
+    addr.sin_addr.s_addr = inet_addr(_srs_tmp_host.c_str());
+
+    // The clients are queued in backlog, then accepted in batches.
+    int fds[6];
+    for (int i = 0; i < 6; i++) {
+        fds[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_TRUE(fds[i] > 0);
+        EXPECT_EQ(0, ::connect(fds[i], (sockaddr*)&addr, sizeof(addr)));
+    }
+
+    // Let the listener to accept clients.
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(6, (int)h.fds.size());
+
+    for (int i = 0; i < 6; i++) {
+        ::close(fds[i]);
+	}
+}
+
 VOID TEST(TCPServerTest, PingPongWithTimeout)
 {
 	srs_error_t err;
@@ -245,6 +382,41 @@ VOID TEST(TCPServerTest, PingPongWithTimeout)
 	}
 }
 
+VOID TEST(TCPServerTest, SocketReadable)
+{
+	srs_error_t err;
+
+	MockTcpHandler h;
+	SrsTcpListener l(&h, _srs_tmp_host, _srs_tmp_port);
+	HELPER_EXPECT_SUCCESS(l.listen());
+
+	SrsTcpClient* c = new SrsTcpClient(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+	HELPER_EXPECT_SUCCESS(c->connect());
+
+	SrsStSocket skt;
+	ASSERT_TRUE(h.fd != NULL);
+	HELPER_EXPECT_SUCCESS(skt.initialize(h.fd));
+
+	// Nothing to read, never block.
+	EXPECT_FALSE(skt.readable());
+
+	// Readable until all bytes are read.
+	HELPER_EXPECT_SUCCESS(c->write((void*)"Hello", 5, NULL));
+	srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+	EXPECT_TRUE(skt.readable());
+
+	char buf[16] = {0};
+	HELPER_EXPECT_SUCCESS(skt.read_fully(buf, 5, NULL));
+	EXPECT_STREQ(buf, "Hello");
+	EXPECT_FALSE(skt.readable());
+
+	// Readable when peer closed, for read to get the error.
+	srs_freep(c);
+	srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+	EXPECT_TRUE(skt.readable());
+	HELPER_EXPECT_FAILED(skt.read(buf, sizeof(buf), NULL));
+}
+
 VOID TEST(TCPServerTest, StringIsDigital)
 {
     EXPECT_EQ(0, ::atoi("0"));
@@ -1222,6 +1394,98 @@ VOID TEST(TCPServerTest, HTTPClientUtility)
     }
 }
 
+VOID TEST(TCPServerTest, HTTPClientPool)
+{
+    srs_error_t err;
+
+    // Reuse the keep-alive transport by pool.
+    if (true) {
+        SrsHttpClientPool pool;
+        MockOnCycleThread4 trd;
+        HELPER_ASSERT_SUCCESS(trd.start("127.0.0.1", 8080));
+
+        for (int i = 0; i < 3; i++) {
+            SrsHttpClient client;
+            client.set_pool(&pool);
+            HELPER_ASSERT_SUCCESS(client.initialize("127.0.0.1", 8080, 1*SRS_UTIME_SECONDS));
+
+            ISrsHttpMessage* res = NULL;
+            HELPER_ASSERT_SUCCESS(client.post("/api/v1", "", &res));
+            SrsAutoFree(ISrsHttpMessage, res);
+
+            string body;
+            HELPER_ASSERT_SUCCESS(res->body_read_all(body));
+            EXPECT_STREQ("OK", body.c_str());
+        }
+
+        EXPECT_EQ(1, pool.creates());
+        EXPECT_EQ(2, pool.hits());
+        EXPECT_EQ(1, pool.nb_idles("127.0.0.1", 8080));
+    }
+
+    // Renew the stale transport closed by server.
+    if (true) {
+        SrsHttpClientPool pool;
+
+        if (true) {
+            MockOnCycleThread4 trd;
+            HELPER_ASSERT_SUCCESS(trd.start("127.0.0.1", 8080));
+
+            SrsHttpClient client;
+            client.set_pool(&pool);
+            HELPER_ASSERT_SUCCESS(client.initialize("127.0.0.1", 8080, 1*SRS_UTIME_SECONDS));
+
+            ISrsHttpMessage* res = NULL;
+            HELPER_ASSERT_SUCCESS(client.get("/api/v1", "", &res));
+            SrsAutoFree(ISrsHttpMessage, res);
+
+            string body;
+            HELPER_ASSERT_SUCCESS(res->body_read_all(body));
+        }
+        EXPECT_EQ(1, pool.nb_idles("127.0.0.1", 8080));
+
+        MockOnCycleThread4 trd;
+        HELPER_ASSERT_SUCCESS(trd.start("127.0.0.1", 8080));
+
+        SrsHttpClient client;
+        client.set_pool(&pool);
+        HELPER_ASSERT_SUCCESS(client.initialize("127.0.0.1", 8080, 1*SRS_UTIME_SECONDS));
+
+        ISrsHttpMessage* res = NULL;
+        HELPER_ASSERT_SUCCESS(client.get("/api/v1", "", &res));
+        SrsAutoFree(ISrsHttpMessage, res);
+
+        string body;
+        HELPER_ASSERT_SUCCESS(res->body_read_all(body));
+        EXPECT_STREQ("OK", body.c_str());
+        EXPECT_EQ(2, pool.creates());
+        EXPECT_EQ(1, pool.hits());
+    }
+
+    // Wait for the active transport when exceed limit.
+    if (true) {
+        SrsHttpClientPool pool;
+        pool.set_limits(1, 1, SRS_HTTP_CLIENT_POOL_IDLE_TIMEOUT);
+
+        MockOnCycleThread4 trd;
+        HELPER_ASSERT_SUCCESS(trd.start("127.0.0.1", 8080));
+
+        SrsTcpClient* transport = NULL; bool reused = false;
+        HELPER_ASSERT_SUCCESS(pool.fetch("127.0.0.1", 8080, 1*SRS_UTIME_SECONDS, &transport, &reused));
+        EXPECT_FALSE(reused);
+
+        SrsTcpClient* t2 = NULL;
+        HELPER_EXPECT_FAILED(pool.fetch("127.0.0.1", 8080, 10*SRS_UTIME_MILLISECONDS, &t2, &reused));
+
+        pool.release("127.0.0.1", 8080, transport, true);
+        HELPER_ASSERT_SUCCESS(pool.fetch("127.0.0.1", 8080, 10*SRS_UTIME_MILLISECONDS, &t2, &reused));
+        EXPECT_TRUE(reused);
+        EXPECT_TRUE(transport == t2);
+        pool.release("127.0.0.1", 8080, t2, false);
+        EXPECT_EQ(0, pool.nb_idles("127.0.0.1", 8080));
+    }
+}
+
 class MockConnectionManager : public IConnectionManager
 {
 public:
@@ -1286,3 +1550,180 @@ VOID TEST(TCPServerTest, ContextUtility)
     }
 }
 
+
+VOID TEST(ServiceDnsTest, EncodeDecode)
+{
+    srs_error_t err;
+
+    const char question[] = {
+        0x05, 'o', 's', 's', 'r', 's', 0x03, 'n', 'e', 't', 0x00, 0x00, 0x01, 0x00, 0x01
+    };
+
+    if (true) {
+        SrsDnsResolver dns;
+        string v;
+        HELPER_EXPECT_SUCCESS(dns.encode_query(0x1234, "ossrs.net", v));
+
+        const char expect[] = {
+            0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+        ASSERT_EQ(sizeof(expect) + sizeof(question), v.length());
+        EXPECT_TRUE(!memcmp(expect, v.data(), sizeof(expect)));
+        EXPECT_TRUE(!memcmp(question, v.data() + sizeof(expect), sizeof(question)));
+    }
+
+    // The A record after CNAME, use the min TTL.
+    if (true) {
+        const char header[] = {
+            0x12, 0x34, (char)0x81, (char)0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00
+        };
+        const char answers[] = {
+            (char)0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x02, (char)0xc0, 0x0c,
+            (char)0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, (char)0xc0, (char)0xa8, 0x01, 0x64
+        };
+        string data = string(header, sizeof(header)) + string(question, sizeof(question)) + string(answers, sizeof(answers));
+
+        SrsDnsResolver dns;
+        string ip; srs_utime_t ttl = 0;
+        HELPER_EXPECT_SUCCESS(dns.decode_response(0x1234, (char*)data.data(), (int)data.length(), ip, ttl));
+        EXPECT_STREQ("192.168.1.100", ip.c_str());
+        EXPECT_EQ(60 * SRS_UTIME_SECONDS, ttl);
+
+        // Invalid id or truncated.
+        HELPER_EXPECT_FAILED(dns.decode_response(0x1235, (char*)data.data(), (int)data.length(), ip, ttl));
+        HELPER_EXPECT_FAILED(dns.decode_response(0x1234, (char*)data.data(), (int)data.length() - 2, ip, ttl));
+    }
+
+    // The NXDOMAIN, use the min of SOA TTL and MINIMUM.
+    if (true) {
+        const char header[] = {
+            0x12, 0x34, (char)0x81, (char)0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+        };
+        const char authorities[] = {
+            (char)0xc0, 0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x18,
+            (char)0xc0, 0x0c, (char)0xc0, 0x0c, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+            0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x1e
+        };
+        string data = string(header, sizeof(header)) + string(question, sizeof(question)) + string(authorities, sizeof(authorities));
+
+        SrsDnsResolver dns;
+        string ip; srs_utime_t ttl = 0;
+        HELPER_EXPECT_SUCCESS(dns.decode_response(0x1234, (char*)data.data(), (int)data.length(), ip, ttl));
+        EXPECT_TRUE(ip.empty());
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, ttl);
+    }
+
+    // The SERVFAIL, should try next server.
+    if (true) {
+        const char header[] = {
+            0x12, 0x34, (char)0x81, (char)0x82, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+
+        SrsDnsResolver dns;
+        string ip; srs_utime_t ttl = 0;
+        HELPER_EXPECT_FAILED(dns.decode_response(0x1234, (char*)header, sizeof(header), ip, ttl));
+    }
+}
+
+VOID TEST(ServiceDnsTest, Cache)
+{
+    srs_error_t err;
+
+    // The address is not resolved.
+    if (true) {
+        SrsDnsResolver dns;
+        string ip;
+        HELPER_EXPECT_SUCCESS(dns.resolve("192.168.1.100", 0, ip));
+        EXPECT_STREQ("192.168.1.100", ip.c_str());
+        HELPER_EXPECT_SUCCESS(dns.resolve("::1", 0, ip));
+        EXPECT_STREQ("::1", ip.c_str());
+        EXPECT_EQ(0, dns.nn_queries);
+    }
+
+    if (true) {
+        SrsDnsResolver dns;
+        string ip;
+        HELPER_EXPECT_SUCCESS(dns.resolve("localhost", 0, ip));
+        EXPECT_STREQ("127.0.0.1", ip.c_str());
+        EXPECT_EQ(0, dns.nn_queries);
+    }
+
+    // The cached and negative cached entries.
+    if (true) {
+        SrsDnsResolver dns;
+        dns.load_system_config();
+        dns.update_cache("ossrs.net", "192.168.1.100", 60 * SRS_UTIME_SECONDS);
+        dns.update_cache("none.ossrs.net", "", 10 * SRS_UTIME_SECONDS);
+
+        string ip;
+        HELPER_EXPECT_SUCCESS(dns.resolve("ossrs.net", 0, ip));
+        EXPECT_STREQ("192.168.1.100", ip.c_str());
+        EXPECT_EQ(1, dns.nn_hits);
+
+        HELPER_EXPECT_FAILED(dns.resolve("none.ossrs.net", 0, ip));
+        EXPECT_EQ(1, dns.nn_negative_hits);
+        EXPECT_EQ(0, dns.nn_queries);
+
+        // The TTL is limited.
+        dns.update_cache("ossrs.net", "192.168.1.100", 7200 * SRS_UTIME_SECONDS);
+        EXPECT_EQ(3600 * SRS_UTIME_SECONDS, dns.cache["ossrs.net"]->ttl);
+    }
+}
+
+VOID TEST(ServiceStSocketTest, ZeroCopy)
+{
+    srs_error_t err;
+    
+    // The id maybe overflow.
+    if (true) {
+        SrsStSocket skt;
+        skt.zc_done = 0xfffffffe;
+        EXPECT_TRUE(skt.zerocopy_completed(0xfffffffe));
+        EXPECT_FALSE(skt.zerocopy_completed(0xffffffff));
+        EXPECT_FALSE(skt.zerocopy_completed(1));
+        
+        skt.zc_done = 1;
+        EXPECT_TRUE(skt.zerocopy_completed(0xffffffff));
+        EXPECT_TRUE(skt.zerocopy_completed(1));
+        EXPECT_FALSE(skt.zerocopy_completed(2));
+    }
+    
+#ifndef SRS_AUTO_OSX
+    // The bytes are sent, and completed by copy for loopback.
+    if (true) {
+        MockTcpHandler h;
+        SrsTcpListener l(&h, _srs_tmp_host, _srs_tmp_port);
+        HELPER_EXPECT_SUCCESS(l.listen());
+        
+        SrsTcpClient c(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+        HELPER_EXPECT_SUCCESS(c.connect());
+        
+        SrsStSocket skt;
+        ASSERT_TRUE(h.fd != NULL);
+        HELPER_EXPECT_SUCCESS(skt.initialize(h.fd));
+        HELPER_EXPECT_SUCCESS(skt.enable_zerocopy());
+        
+        iovec iovs[2];
+        iovs[0].iov_base = (char*)"Hello";
+        iovs[0].iov_len = 5;
+        iovs[1].iov_base = (char*)" SRS";
+        iovs[1].iov_len = 4;
+        
+        uint32_t id = 0; ssize_t nn = 0;
+        HELPER_EXPECT_SUCCESS(skt.writev_zerocopy(iovs, 2, &id, &nn));
+        EXPECT_EQ(9, nn);
+        EXPECT_EQ(1, (int)id);
+        
+        char buf[16] = {0};
+        HELPER_EXPECT_SUCCESS(c.read_fully(buf, 9, NULL));
+        EXPECT_STREQ(buf, "Hello SRS");
+        
+        for (int i = 0; i < 100 && !skt.zerocopy_completed(id); i++) {
+            HELPER_EXPECT_SUCCESS(skt.reap_zerocopy());
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_TRUE(skt.zerocopy_completed(id));
+        EXPECT_TRUE(skt.zc_bytes.empty());
+    }
+#endif
+}